@@ -439,7 +439,7 @@ struct __DRIdamageExtensionRec {
  * SWRast Loader extension.
  */
 #define __DRI_SWRAST_LOADER "DRI_SWRastLoader"
-#define __DRI_SWRAST_LOADER_VERSION 1
+#define __DRI_SWRAST_LOADER_VERSION 2
 struct __DRIswrastLoaderExtensionRec {
     __DRIextension base;
 
@@ -463,6 +463,19 @@ struct __DRIswrastLoaderExtensionRec {
     void (*getImage)(__DRIdrawable *readable,
 		     int x, int y, int width, int height,
 		     char *data, void *loaderPrivate);
+
+    /**
+     * Put image to drawable from a SysV shared memory segment, which the
+     * loader can hand to the X server instead of sending the pixels.
+     * shmaddr is where the driver attached the segment, and the image
+     * starts offset bytes into it.
+     *
+     * \since 2
+     */
+    void (*putImageShm)(__DRIdrawable *drawable, int op,
+			int x, int y, int width, int height, int stride,
+			int shmid, char *shmaddr, unsigned offset,
+			void *loaderPrivate);
 };
 
 /**
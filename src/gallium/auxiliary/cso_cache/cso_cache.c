@@ -28,6 +28,8 @@
 /* Authors:  Zack Rusin <zack@tungstengraphics.com>
  */
 
+#include "os/os_thread.h"
+#include "util/u_counter.h"
 #include "util/u_debug.h"
 
 #include "util/u_memory.h"
@@ -44,36 +46,30 @@ struct cso_cache {
    void                 *sanitize_data;
 };
 
-#if 1
+/* MurmurHash3 over 32-bit words.  A plain xor of the words, as used
+ * before, ignores their order and cancels out equal words, so states
+ * differing in two fields often collided. */
 static unsigned hash_key(const void *key, unsigned key_size)
 {
-   unsigned *ikey = (unsigned *)key;
-   unsigned hash = 0, i;
+   const unsigned *ikey = (const unsigned *)key;
+   unsigned hash = key_size, i;
 
    assert(key_size % 4 == 0);
 
-   /* I'm sure this can be improved on:
-    */
-   for (i = 0; i < key_size/4; i++)
-      hash ^= ikey[i];
+   for (i = 0; i < key_size/4; i++) {
+      unsigned k = ikey[i] * 0xcc9e2d51;
+      k = (k << 15) | (k >> 17);
+      hash ^= k * 0x1b873593;
+      hash = ((hash << 13) | (hash >> 19)) * 5 + 0xe6546b64;
+   }
 
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6b;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35;
+   hash ^= hash >> 16;
    return hash;
 }
-#else
-static unsigned hash_key(const unsigned char *p, int n)
-{
-   unsigned h = 0;
-   unsigned g;
-
-   while (n--) {
-      h = (h << 4) + *p++;
-      if ((g = (h & 0xf0000000)) != 0)
-         h ^= g >> 23;
-      h &= ~g;
-   }
-   return h;
-}
-#endif
 
 unsigned cso_construct_key(void *item, int item_size)
 {
@@ -152,13 +148,40 @@ static INLINE void delete_cso(void *state, enum cso_cache_type type)
 }
 
 
+/** Size of the cso_* struct cached for type, counted in mem-cso */
+static unsigned cso_state_size(enum cso_cache_type type)
+{
+   switch (type) {
+   case CSO_BLEND:
+      return sizeof(struct cso_blend);
+   case CSO_SAMPLER:
+      return sizeof(struct cso_sampler);
+   case CSO_DEPTH_STENCIL_ALPHA:
+      return sizeof(struct cso_depth_stencil_alpha);
+   case CSO_RASTERIZER:
+      return sizeof(struct cso_rasterizer);
+   case CSO_VELEMENTS:
+      return sizeof(struct cso_velements);
+   default:
+      return 0;
+   }
+}
+
 static INLINE void sanitize_hash(struct cso_cache *sc,
                                  struct cso_hash *hash,
                                  enum cso_cache_type type,
                                  int max_size)
 {
-   if (sc->sanitize_cb)
+   if (sc->sanitize_cb) {
+      int size = cso_hash_size(hash);
+
       sc->sanitize_cb(hash, type, max_size, sc->sanitize_data);
+
+      /* The callback frees what it takes out of the hash. */
+      util_counter_mem_free(UTIL_COUNTER_MEM_CSO,
+                            (size - cso_hash_size(hash)) *
+                            cso_state_size(type));
+   }
 }
 
 
@@ -188,9 +211,14 @@ cso_insert_state(struct cso_cache *sc,
                  void *state)
 {
    struct cso_hash *hash = _cso_hash_for_type(sc, type);
+   struct cso_hash_iter iter;
+
    sanitize_hash(sc, hash, type, sc->max_size);
 
-   return cso_hash_insert(hash, hash_key, state);
+   iter = cso_hash_insert(hash, hash_key, state);
+   if (!cso_hash_iter_is_null(iter))
+      util_counter_mem_alloc(UTIL_COUNTER_MEM_CSO, cso_state_size(type));
+   return iter;
 }
 
 struct cso_hash_iter
@@ -209,7 +237,10 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 				        int size )
 {
    struct cso_hash_iter iter = cso_hash_find(hash, hash_key);
-   while (!cso_hash_iter_is_null(iter)) {
+   /* Nodes with the same key are adjacent, the following ones are in
+    * other buckets. */
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
       void *iter_data = cso_hash_iter_data(iter);
       if (!memcmp(iter_data, templ, size)) {
 	 /* We found a match
@@ -229,10 +260,13 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
    struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
    while (!cso_hash_iter_is_null(iter)) {
       void *iter_data = cso_hash_iter_data(iter);
+      if (cso_hash_iter_key(iter) != hash_key)
+         break;
       if (!memcmp(iter_data, templ, size))
          return iter;
       iter = cso_hash_iter_next(iter);
    }
+   iter.node = NULL;
    return iter;
 }
 
@@ -240,7 +274,11 @@ void * cso_take_state(struct cso_cache *sc,
                       unsigned hash_key, enum cso_cache_type type)
 {
    struct cso_hash *hash = _cso_hash_for_type(sc, type);
-   return cso_hash_take(hash, hash_key);
+   void *state = cso_hash_take(hash, hash_key);
+
+   if (state)
+      util_counter_mem_free(UTIL_COUNTER_MEM_CSO, cso_state_size(type));
+   return state;
 }
 
 struct cso_cache *cso_cache_create(void)
@@ -291,8 +329,11 @@ void cso_cache_delete(struct cso_cache *sc)
    cso_for_each_state(sc, CSO_SAMPLER, delete_sampler_state, 0);
    cso_for_each_state(sc, CSO_VELEMENTS, delete_velements, 0);
 
-   for (i = 0; i < CSO_CACHE_MAX; i++)
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      util_counter_mem_free(UTIL_COUNTER_MEM_CSO,
+                            cso_hash_size(sc->hashes[i]) * cso_state_size(i));
       cso_hash_delete(sc->hashes[i]);
+   }
 
    FREE(sc);
 }
@@ -320,3 +361,221 @@ void cso_cache_set_sanitize_callback(struct cso_cache *sc,
    sc->sanitize_data = user_data;
 }
 
+
+
+/*
+ * Screen-wide cache of driver state objects, shared by the cso_contexts of
+ * a screen whose driver reports PIPE_CAP_SHAREABLE_STATE_OBJECTS.
+ *
+ * The entries are spread over shards by their key, each
+ * with its own lock, so contexts running on different threads rarely
+ * contend.  Entries are never evicted, as they may be bound in any context;
+ * a full shard makes the context fall back to its private objects.  They
+ * are deleted when the last context of the screen releases the cache.
+ */
+
+#define CSO_SCREEN_CACHE_SHARDS 16
+#define CSO_SCREEN_CACHE_SHARD_SIZE 1024
+
+struct cso_shared_state {
+   void *data;
+   cso_state_callback delete_state;
+   unsigned size;
+   /* followed by the state template */
+};
+
+struct cso_screen_cache_shard {
+   pipe_mutex mutex;
+   struct cso_hash *hashes[CSO_CACHE_MAX];
+   int size;
+};
+
+struct cso_screen_cache {
+   struct pipe_screen *screen;
+   int refcount;   /* protected by screen_caches_mutex */
+   struct cso_screen_cache *next;
+
+   struct cso_screen_cache_shard shards[CSO_SCREEN_CACHE_SHARDS];
+};
+
+pipe_static_mutex(screen_caches_mutex);
+static struct cso_screen_cache *screen_caches;
+
+
+static INLINE struct cso_screen_cache_shard *
+screen_cache_shard(struct cso_screen_cache *cache, unsigned hash_key)
+{
+   return &cache->shards[(hash_key >> 16) % CSO_SCREEN_CACHE_SHARDS];
+}
+
+static struct cso_shared_state *
+screen_cache_search(struct cso_hash *hash, unsigned hash_key,
+                    const void *templ, unsigned size)
+{
+   struct cso_hash_iter iter = cso_hash_find(hash, hash_key);
+
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
+      struct cso_shared_state *entry = cso_hash_iter_data(iter);
+
+      if (entry->size == size && !memcmp(entry + 1, templ, size))
+         return entry;
+      iter = cso_hash_iter_next(iter);
+   }
+   return NULL;
+}
+
+
+/**
+ * Get the state cache shared by the contexts of \p screen, creating it for
+ * the first one.  Balance with cso_screen_cache_release().
+ */
+struct cso_screen_cache *
+cso_screen_cache_acquire(struct pipe_screen *screen)
+{
+   struct cso_screen_cache *cache;
+   unsigned i, type;
+
+   pipe_mutex_lock(screen_caches_mutex);
+
+   for (cache = screen_caches; cache; cache = cache->next) {
+      if (cache->screen == screen) {
+         cache->refcount++;
+         pipe_mutex_unlock(screen_caches_mutex);
+         return cache;
+      }
+   }
+
+   cache = CALLOC_STRUCT(cso_screen_cache);
+   if (cache) {
+      cache->screen = screen;
+      cache->refcount = 1;
+      for (i = 0; i < CSO_SCREEN_CACHE_SHARDS; i++) {
+         pipe_mutex_init(cache->shards[i].mutex);
+         for (type = 0; type < CSO_CACHE_MAX; type++)
+            cache->shards[i].hashes[type] = cso_hash_create();
+      }
+      cache->next = screen_caches;
+      screen_caches = cache;
+   }
+
+   pipe_mutex_unlock(screen_caches_mutex);
+   return cache;
+}
+
+
+/**
+ * Drop a reference to the shared cache.  The last one deletes the shared
+ * state objects with \p pipe, which must have unbound them already.
+ */
+void
+cso_screen_cache_release(struct cso_screen_cache *cache,
+                         struct pipe_context *pipe)
+{
+   struct cso_screen_cache **link;
+   unsigned i, type;
+
+   pipe_mutex_lock(screen_caches_mutex);
+   if (--cache->refcount > 0) {
+      pipe_mutex_unlock(screen_caches_mutex);
+      return;
+   }
+   for (link = &screen_caches; *link != cache; link = &(*link)->next)
+      ;
+   *link = cache->next;
+   pipe_mutex_unlock(screen_caches_mutex);
+
+   for (i = 0; i < CSO_SCREEN_CACHE_SHARDS; i++) {
+      struct cso_screen_cache_shard *shard = &cache->shards[i];
+
+      for (type = 0; type < CSO_CACHE_MAX; type++) {
+         struct cso_hash_iter iter = cso_hash_first_node(shard->hashes[type]);
+
+         while (!cso_hash_iter_is_null(iter)) {
+            struct cso_shared_state *entry = cso_hash_iter_data(iter);
+
+            iter = cso_hash_iter_next(iter);
+            if (entry->delete_state)
+               entry->delete_state(pipe, entry->data);
+            util_counter_mem_free(UTIL_COUNTER_MEM_CSO,
+                                  sizeof(*entry) + entry->size);
+            FREE(entry);
+         }
+         cso_hash_delete(shard->hashes[type]);
+      }
+      pipe_mutex_destroy(shard->mutex);
+   }
+
+   FREE(cache);
+}
+
+
+/**
+ * Look for the driver object another context created for \p templ.
+ * \return the object or NULL
+ */
+void *
+cso_screen_cache_find(struct cso_screen_cache *cache,
+                      enum cso_cache_type type, unsigned hash_key,
+                      const void *templ, unsigned size)
+{
+   struct cso_screen_cache_shard *shard = screen_cache_shard(cache, hash_key);
+   struct cso_shared_state *entry;
+   void *data;
+
+   pipe_mutex_lock(shard->mutex);
+   entry = screen_cache_search(shard->hashes[type], hash_key, templ, size);
+   data = entry ? entry->data : NULL;
+   pipe_mutex_unlock(shard->mutex);
+
+   return data;
+}
+
+
+/**
+ * Hand the driver object created for \p templ over to the shared cache.
+ *
+ * \return \p data if it was added, the object of another context that added
+ *         the same state in the meantime, in which case the caller should
+ *         delete its own, or NULL if the cache is full and the caller keeps
+ *         \p data to itself
+ */
+void *
+cso_screen_cache_add(struct cso_screen_cache *cache,
+                     enum cso_cache_type type, unsigned hash_key,
+                     const void *templ, unsigned size,
+                     void *data, cso_state_callback delete_state)
+{
+   struct cso_screen_cache_shard *shard = screen_cache_shard(cache, hash_key);
+   struct cso_shared_state *entry;
+
+   pipe_mutex_lock(shard->mutex);
+
+   entry = screen_cache_search(shard->hashes[type], hash_key, templ, size);
+   if (entry) {
+      data = entry->data;
+   }
+   else if (shard->size >= CSO_SCREEN_CACHE_SHARD_SIZE ||
+            !(entry = MALLOC(sizeof(*entry) + size))) {
+      data = NULL;
+   }
+   else {
+      entry->data = data;
+      entry->delete_state = delete_state;
+      entry->size = size;
+      memcpy(entry + 1, templ, size);
+
+      if (cso_hash_iter_is_null(cso_hash_insert(shard->hashes[type],
+                                                hash_key, entry))) {
+         FREE(entry);
+         data = NULL;
+      }
+      else {
+         shard->size++;
+         util_counter_mem_alloc(UTIL_COUNTER_MEM_CSO, sizeof(*entry) + size);
+      }
+   }
+
+   pipe_mutex_unlock(shard->mutex);
+   return data;
+}
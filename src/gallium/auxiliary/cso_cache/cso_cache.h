@@ -168,6 +168,19 @@ void * cso_take_state(struct cso_cache *sc, unsigned hash_key,
 void cso_set_maximum_cache_size(struct cso_cache *sc, int number);
 int cso_maximum_cache_size(const struct cso_cache *sc);
 
+struct cso_screen_cache;
+
+struct cso_screen_cache *cso_screen_cache_acquire(struct pipe_screen *screen);
+void cso_screen_cache_release(struct cso_screen_cache *cache,
+                              struct pipe_context *pipe);
+void *cso_screen_cache_find(struct cso_screen_cache *cache,
+                            enum cso_cache_type type, unsigned hash_key,
+                            const void *templ, unsigned size);
+void *cso_screen_cache_add(struct cso_screen_cache *cache,
+                           enum cso_cache_type type, unsigned hash_key,
+                           const void *templ, unsigned size,
+                           void *data, cso_state_callback delete_state);
+
 #ifdef	__cplusplus
 }
 #endif
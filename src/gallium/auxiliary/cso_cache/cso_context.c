@@ -79,6 +79,7 @@ struct sampler_info
 struct cso_context {
    struct pipe_context *pipe;
    struct cso_cache *cache;
+   struct cso_screen_cache *screen_cache; /**< or NULL if not shared */
    struct u_vbuf *vbuf;
 
    boolean has_geometry_shader;
@@ -234,6 +235,48 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
    }
 }
 
+/**
+ * Reuse the driver object another context of the screen created for this
+ * state.  Entries of the private cache that borrow such an object have no
+ * delete_state.
+ */
+static void *
+cso_find_shared_state(struct cso_context *ctx, enum cso_cache_type type,
+                      unsigned hash_key, const void *state, unsigned size)
+{
+   if (!ctx->screen_cache)
+      return NULL;
+
+   return cso_screen_cache_find(ctx->screen_cache, type, hash_key,
+                                state, size);
+}
+
+/**
+ * Offer a newly created driver object to the other contexts of the screen.
+ */
+static void
+cso_share_state(struct cso_context *ctx, enum cso_cache_type type,
+                unsigned hash_key, const void *state, unsigned size,
+                void **data, cso_state_callback *delete_state)
+{
+   void *shared;
+
+   if (!ctx->screen_cache || !*data)
+      return;
+
+   shared = cso_screen_cache_add(ctx->screen_cache, type, hash_key,
+                                 state, size, *data, *delete_state);
+   if (!shared)
+      return;
+
+   if (shared != *data) {
+      /* Another context won the race. */
+      (*delete_state)(ctx->pipe, *data);
+      *data = shared;
+   }
+   *delete_state = NULL;
+}
+
 static void cso_init_vbuf(struct cso_context *cso)
 {
    struct u_vbuf_caps caps;
@@ -273,6 +316,11 @@ struct cso_context *cso_create_context( struct pipe_context *pipe )
 
    ctx->aux_vertex_buffer_index = 0; /* 0 for now */
 
+   if (pipe->screen->get_param(pipe->screen,
+                               PIPE_CAP_SHAREABLE_STATE_OBJECTS)) {
+      ctx->screen_cache = cso_screen_cache_acquire(pipe->screen);
+   }
+
    cso_init_vbuf(ctx);
 
    /* Enable for testing: */
@@ -359,6 +407,11 @@ void cso_release_all( struct cso_context *ctx )
       cso_cache_delete( ctx->cache );
       ctx->cache = NULL;
    }
+
+   if (ctx->screen_cache) {
+      cso_screen_cache_release(ctx->screen_cache, ctx->pipe);
+      ctx->screen_cache = NULL;
+   }
 }
 
 
@@ -369,6 +422,8 @@ void cso_release_all( struct cso_context *ctx )
 void cso_destroy_context( struct cso_context *ctx )
 {
    if (ctx) {
+      if (ctx->screen_cache)
+         cso_screen_cache_release(ctx->screen_cache, ctx->pipe);
       if (ctx->vbuf)
          u_vbuf_destroy(ctx->vbuf);
       FREE( ctx );
@@ -407,8 +462,16 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 
       memset(&cso->state, 0, sizeof cso->state);
       memcpy(&cso->state, templ, key_size);
-      cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
-      cso->delete_state = (cso_state_callback)ctx->pipe->delete_blend_state;
+      cso->data = cso_find_shared_state(ctx, CSO_BLEND, hash_key,
+                                        &cso->state, key_size);
+      cso->delete_state = NULL;
+      if (!cso->data) {
+         cso->data = ctx->pipe->create_blend_state(ctx->pipe, &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_blend_state;
+         cso_share_state(ctx, CSO_BLEND, hash_key, &cso->state, key_size,
+                         &cso->data, &cso->delete_state);
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
@@ -466,10 +529,18 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
-                                                              &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+      cso->data = cso_find_shared_state(ctx, CSO_DEPTH_STENCIL_ALPHA,
+                                        hash_key, &cso->state, key_size);
+      cso->delete_state = NULL;
+      if (!cso->data) {
+         cso->data = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe,
+                                                                 &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
+         cso_share_state(ctx, CSO_DEPTH_STENCIL_ALPHA, hash_key,
+                         &cso->state, key_size,
+                         &cso->data, &cso->delete_state);
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key,
@@ -528,9 +599,17 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, templ, sizeof(*templ));
-      cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe, &cso->state);
-      cso->delete_state =
-         (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+      cso->data = cso_find_shared_state(ctx, CSO_RASTERIZER, hash_key,
+                                        &cso->state, key_size);
+      cso->delete_state = NULL;
+      if (!cso->data) {
+         cso->data = ctx->pipe->create_rasterizer_state(ctx->pipe,
+                                                        &cso->state);
+         cso->delete_state =
+            (cso_state_callback)ctx->pipe->delete_rasterizer_state;
+         cso_share_state(ctx, CSO_RASTERIZER, hash_key, &cso->state,
+                         key_size, &cso->data, &cso->delete_state);
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
@@ -884,10 +963,18 @@ cso_set_vertex_elements(struct cso_context *ctx,
          return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy(&cso->state, &velems_state, key_size);
-      cso->data = ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
-                                                      &cso->state.velems[0]);
-      cso->delete_state =
-         (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
+      cso->data = cso_find_shared_state(ctx, CSO_VELEMENTS, hash_key,
+                                        &cso->state, key_size);
+      cso->delete_state = NULL;
+      if (!cso->data) {
+         cso->data =
+            ctx->pipe->create_vertex_elements_state(ctx->pipe, count,
+                                                    &cso->state.velems[0]);
+         cso->delete_state =
+            (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
+         cso_share_state(ctx, CSO_VELEMENTS, hash_key, &cso->state,
+                         key_size, &cso->data, &cso->delete_state);
+      }
       cso->context = ctx->pipe;
 
       iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
@@ -1033,9 +1120,17 @@ single_sampler(struct cso_context *ctx,
             return PIPE_ERROR_OUT_OF_MEMORY;
 
          memcpy(&cso->state, templ, sizeof(*templ));
-         cso->data = ctx->pipe->create_sampler_state(ctx->pipe, &cso->state);
-         cso->delete_state =
-            (cso_state_callback) ctx->pipe->delete_sampler_state;
+         cso->data = cso_find_shared_state(ctx, CSO_SAMPLER, hash_key,
+                                           &cso->state, key_size);
+         cso->delete_state = NULL;
+         if (!cso->data) {
+            cso->data = ctx->pipe->create_sampler_state(ctx->pipe,
+                                                        &cso->state);
+            cso->delete_state =
+               (cso_state_callback) ctx->pipe->delete_sampler_state;
+            cso_share_state(ctx, CSO_SAMPLER, hash_key, &cso->state,
+                            key_size, &cso->data, &cso->delete_state);
+         }
          cso->context = ctx->pipe;
 
          iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
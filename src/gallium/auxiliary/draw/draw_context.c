@@ -942,6 +942,7 @@ draw_set_mapped_texture(struct draw_context *draw,
                         uint32_t width, uint32_t height, uint32_t depth,
                         uint32_t first_level, uint32_t last_level,
                         const void *base_ptr,
+                        boolean tiled,
                         uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                         uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
                         uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS])
@@ -952,7 +953,7 @@ draw_set_mapped_texture(struct draw_context *draw,
                                    shader_stage,
                                    sview_idx,
                                    width, height, depth, first_level,
-                                   last_level, base_ptr,
+                                   last_level, base_ptr, tiled,
                                    row_stride, img_stride, mip_offsets);
 #endif
 }
@@ -1010,6 +1011,10 @@ void
 draw_collect_pipeline_statistics(struct draw_context *draw,
                                  boolean enable)
 {
+   /* the choice of middle end depends on it */
+   if (draw->collect_statistics != enable)
+      draw_do_flush(draw, DRAW_FLUSH_STATE_CHANGE);
+
    draw->collect_statistics = enable;
 }
 
@@ -38,6 +38,7 @@
 
 #include "pipe/p_shader_tokens.h"
 
+#include "util/u_counter.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
@@ -550,19 +551,32 @@ int draw_geometry_shader_run(struct draw_geometry_shader *shader,
       u_decomposed_prims_for_vertices(shader->output_primitive,
                                       shader->max_output_vertices)
       * num_in_primitives;
+   unsigned output_size;
 
    //Assume at least one primitive
    max_out_prims = MAX2(max_out_prims, 1);
 
+   /* we allocate exactly one extra vertex per primitive to allow the GS to emit
+    * overflown vertices into some area where they won't harm anyone */
+   output_size = vertex_size * max_out_prims * shader->primitive_boundary;
+
+   /* Only grow the output buffers, rather than allocating them for
+    * every run.
+    */
+   if (output_size > shader->output_buffer_size) {
+      FREE(shader->output_buffer);
+      shader->output_buffer = MALLOC(output_size);
+      shader->output_buffer_size = shader->output_buffer ? output_size : 0;
+   }
+   if (max_out_prims > shader->max_primitive_lengths) {
+      FREE(shader->primitive_lengths);
+      shader->primitive_lengths = MALLOC(max_out_prims * sizeof(unsigned));
+      shader->max_primitive_lengths = max_out_prims;
+   }
 
    output_verts->vertex_size = vertex_size;
    output_verts->stride = output_verts->vertex_size;
-   /* we allocate exactly one extra vertex per primitive to allow the GS to emit
-    * overflown vertices into some area where they won't harm anyone */
-   output_verts->verts =
-      (struct vertex_header *)MALLOC(output_verts->vertex_size *
-                                     max_out_prims *
-                                     shader->primitive_boundary);
+   output_verts->verts = shader->output_buffer;
 
 #if 0
    debug_printf("%s count = %d (in prims # = %d)\n",
@@ -584,8 +598,6 @@ int draw_geometry_shader_run(struct draw_geometry_shader *shader,
    shader->input_vertex_stride = input_stride;
    shader->input = input;
    shader->input_info = input_info;
-   FREE(shader->primitive_lengths);
-   shader->primitive_lengths = MALLOC(max_out_prims * sizeof(unsigned));
 
 
 #ifdef HAVE_LLVM
@@ -671,10 +683,10 @@ void draw_geometry_shader_prepare(struct draw_geometry_shader *shader,
 #else
    boolean use_llvm = FALSE;
 #endif
-   if (!use_llvm && shader && shader->machine->Tokens != shader->state.tokens) {
-      tgsi_exec_machine_bind_shader(shader->machine,
-                                    shader->state.tokens,
-                                    draw->gs.tgsi.sampler);
+   if (!use_llvm && shader && shader->machine->Decoded != shader->decoded) {
+      tgsi_exec_machine_bind_decoded(shader->machine,
+                                     shader->decoded,
+                                     draw->gs.tgsi.sampler);
    }
 }
 
@@ -742,7 +754,16 @@ draw_create_geometry_shader(struct draw_context *draw,
       return NULL;
    }
 
-   tgsi_scan_shader(state->tokens, &gs->info);
+   gs->decoded = tgsi_decode_shader(gs->state.tokens);
+   if (!gs->decoded) {
+      FREE((void*) gs->state.tokens);
+      FREE(gs);
+      return NULL;
+   }
+
+   tgsi_scan_decoded_shader(gs->decoded, &gs->info);
+   util_counter_mem_alloc(UTIL_COUNTER_MEM_TGSI,
+                          tgsi_tokens_size(gs->state.tokens));
 
    /* setup the defaults */
    gs->input_primitive = PIPE_PRIM_TRIANGLES;
@@ -892,7 +913,15 @@ void draw_delete_geometry_shader(struct draw_context *draw,
    }
 #endif
 
+   if (dgs->machine && dgs->machine->Decoded == dgs->decoded) {
+      tgsi_exec_machine_bind_decoded(dgs->machine, NULL, NULL);
+   }
+
    FREE(dgs->primitive_lengths);
+   FREE(dgs->output_buffer);
+   tgsi_free_decoded_shader(dgs->decoded);
+   util_counter_mem_free(UTIL_COUNTER_MEM_TGSI,
+                         tgsi_tokens_size(dgs->state.tokens));
    FREE((void*) dgs->state.tokens);
    FREE(dgs);
 }
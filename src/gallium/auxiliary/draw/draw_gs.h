@@ -63,6 +63,7 @@ struct draw_geometry_shader {
 
    /* This member will disappear shortly:*/
    struct pipe_shader_state state;
+   struct tgsi_decoded_shader *decoded;
 
    struct tgsi_shader_info info;
    unsigned position_output;
@@ -76,6 +77,7 @@ struct draw_geometry_shader {
    unsigned output_primitive;
 
    unsigned *primitive_lengths;
+   unsigned max_primitive_lengths;
    unsigned emitted_vertices;
    unsigned emitted_primitives;
 
@@ -90,6 +92,10 @@ struct draw_geometry_shader {
    unsigned vector_length;
    unsigned max_out_prims;
 
+   /** Output vertices, kept from one run to the next */
+   struct vertex_header *output_buffer;
+   unsigned output_buffer_size;
+
 #ifdef HAVE_LLVM
    struct draw_gs_inputs *gs_input;
    struct draw_gs_jit_context *jit_context;
@@ -123,6 +129,8 @@ void draw_geometry_shader_new_instance(struct draw_geometry_shader *gs);
  * Returns the number of vertices emitted.
  * The vertex shader can emit any number of vertices as long as it's
  * smaller than the GS_MAX_OUTPUT_VERTICES shader property.
+ * The output vertices belong to the shader and stay valid until the
+ * next run, so the caller mustn't free them.
  */
 int draw_geometry_shader_run(struct draw_geometry_shader *shader,
                              const void *constants[PIPE_MAX_CONSTANT_BUFFERS], 
@@ -138,6 +138,8 @@ create_jit_texture_type(struct gallivm_state *gallivm, const char *struct_name)
    elem_types[DRAW_JIT_TEXTURE_IMG_STRIDE] =
    elem_types[DRAW_JIT_TEXTURE_MIP_OFFSETS] =
       LLVMArrayType(int32_type, PIPE_MAX_TEXTURE_LEVELS);
+   elem_types[DRAW_JIT_TEXTURE_CACHE] =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
 
    texture_type = LLVMStructTypeInContext(gallivm->context, elem_types,
                                           Elements(elem_types), 0);
@@ -178,6 +180,9 @@ create_jit_texture_type(struct gallivm_state *gallivm, const char *struct_name)
    LP_CHECK_MEMBER_OFFSET(struct draw_jit_texture, mip_offsets,
                           target, texture_type,
                           DRAW_JIT_TEXTURE_MIP_OFFSETS);
+   LP_CHECK_MEMBER_OFFSET(struct draw_jit_texture, cache,
+                          target, texture_type,
+                          DRAW_JIT_TEXTURE_CACHE);
 
    LP_CHECK_STRUCT_SIZE(struct draw_jit_texture, target, texture_type);
 
@@ -515,6 +520,9 @@ get_vertex_header_ptr_type(struct draw_llvm_variant *variant)
 }
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(texel_cache_stats, "DRAW_TEXEL_CACHE_STATS", FALSE)
+
+
 /**
  * Create per-context LLVM info.
  */
@@ -537,16 +545,44 @@ draw_llvm_create(struct draw_context *draw)
    llvm->nr_gs_variants = 0;
    make_empty_list(&llvm->gs_variants_list);
 
+   llvm->vs_texel_cache = CALLOC_STRUCT(lp_build_format_cache);
+   llvm->gs_texel_cache = CALLOC_STRUCT(lp_build_format_cache);
+
    return llvm;
 }
 
 
+static void
+draw_llvm_texel_cache_stats(const char *name,
+                            const struct lp_build_format_cache *cache)
+{
+   uint64_t total;
+
+   if (!cache)
+      return;
+
+   total = cache->hits + cache->misses;
+   debug_printf("draw: %s texel cache: %llu fetches, %llu hits (%.1f%%)\n",
+                name, (unsigned long long) total,
+                (unsigned long long) cache->hits,
+                total ? 100.0 * cache->hits / total : 0.0);
+}
+
+
 /**
  * Free per-context LLVM info.
  */
 void
 draw_llvm_destroy(struct draw_llvm *llvm)
 {
+   if (debug_get_option_texel_cache_stats()) {
+      draw_llvm_texel_cache_stats("VS", llvm->vs_texel_cache);
+      draw_llvm_texel_cache_stats("GS", llvm->gs_texel_cache);
+   }
+
+   FREE(llvm->vs_texel_cache);
+   FREE(llvm->gs_texel_cache);
+
    /* XXX free other draw_llvm data? */
    FREE(llvm);
 }
@@ -574,6 +610,7 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    variant->llvm = llvm;
 
    variant->gallivm = gallivm_create();
+   variant->gallivm->owner = GALLIVM_OWNER_DRAW_VS;
 
    create_jit_types(variant);
 
@@ -764,7 +801,7 @@ generate_fetch(struct gallivm_state *gallivm,
                                     format_desc,
                                     lp_float32_vec4_type(),
                                     map_ptr,
-                                    zero, zero, zero);
+                                    zero, zero, zero, NULL);
       LLVMBuildStore(builder, val, temp_ptr);
    }
    lp_build_endif(&if_ctx);
@@ -1878,6 +1915,7 @@ draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
    for (i = 0 ; i < key->nr_sampler_views; i++) {
       lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
                                       llvm->draw->sampler_views[PIPE_SHADER_VERTEX][i]);
+      draw_sampler[i].texture_state.tiled = (llvm->vs_tiled_textures >> i) & 1;
    }
 
    return key;
@@ -1920,12 +1958,14 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
                              uint32_t width, uint32_t height, uint32_t depth,
                              uint32_t first_level, uint32_t last_level,
                              const void *base_ptr,
+                             boolean tiled,
                              uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                              uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
                              uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS])
 {
    unsigned j;
    struct draw_jit_texture *jit_tex;
+   uint32_t *tiled_textures;
 
    assert(shader_stage == PIPE_SHADER_VERTEX ||
           shader_stage == PIPE_SHADER_GEOMETRY);
@@ -1934,10 +1974,14 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
       assert(sview_idx < Elements(draw->llvm->jit_context.textures));
 
       jit_tex = &draw->llvm->jit_context.textures[sview_idx];
+      jit_tex->cache = draw->llvm->vs_texel_cache;
+      tiled_textures = &draw->llvm->vs_tiled_textures;
    } else if (shader_stage == PIPE_SHADER_GEOMETRY) {
       assert(sview_idx < Elements(draw->llvm->gs_jit_context.textures));
 
       jit_tex = &draw->llvm->gs_jit_context.textures[sview_idx];
+      jit_tex->cache = draw->llvm->gs_texel_cache;
+      tiled_textures = &draw->llvm->gs_tiled_textures;
    } else {
       assert(0);
       return;
@@ -1950,6 +1994,15 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
    jit_tex->last_level = last_level;
    jit_tex->base = base_ptr;
 
+   /* The layout is static state, picked up by the next variant key. */
+   if (tiled)
+      *tiled_textures |= 1u << sview_idx;
+   else
+      *tiled_textures &= ~(1u << sview_idx);
+
+   /* The texture may have been written to since it was last mapped. */
+   lp_build_format_cache_clear(jit_tex->cache);
+
    for (j = first_level; j <= last_level; j++) {
       jit_tex->mip_offsets[j] = mip_offsets[j];
       jit_tex->row_stride[j] = row_stride[j];
@@ -2226,6 +2279,7 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    variant->shader = shader;
 
    variant->gallivm = gallivm_create();
+   variant->gallivm->owner = GALLIVM_OWNER_DRAW_GS;
 
    create_gs_jit_types(variant);
 
@@ -2304,6 +2358,7 @@ draw_gs_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
    for (i = 0 ; i < key->nr_sampler_views; i++) {
       lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
                                       llvm->draw->sampler_views[PIPE_SHADER_GEOMETRY][i]);
+      draw_sampler[i].texture_state.tiled = (llvm->gs_tiled_textures >> i) & 1;
    }
 
    return key;
@@ -35,6 +35,7 @@
 
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_limits.h"
+#include "gallivm/lp_bld_format.h"
 
 #include "pipe/p_context.h"
 #include "util/u_simple_list.h"
@@ -55,6 +56,7 @@ struct draw_jit_texture
    uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS];
    uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS];
    uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS];
+   struct lp_build_format_cache *cache;
 };
 
 
@@ -89,6 +91,7 @@ enum {
    DRAW_JIT_TEXTURE_ROW_STRIDE,
    DRAW_JIT_TEXTURE_IMG_STRIDE,
    DRAW_JIT_TEXTURE_MIP_OFFSETS,
+   DRAW_JIT_TEXTURE_CACHE,
    DRAW_JIT_TEXTURE_NUM_FIELDS  /* number of fields above */
 };
 
@@ -457,6 +460,14 @@ struct draw_llvm {
 
    struct draw_gs_llvm_variant_list_item gs_variants_list;
    int nr_gs_variants;
+
+   /** Caches of the texels fetched through the util_format fallbacks */
+   struct lp_build_format_cache *vs_texel_cache;
+   struct lp_build_format_cache *gs_texel_cache;
+
+   /** Masks of the sampler views mapped with a tiled layout */
+   uint32_t vs_tiled_textures;
+   uint32_t gs_tiled_textures;
 };
 
 
@@ -524,6 +535,7 @@ draw_llvm_set_mapped_texture(struct draw_context *draw,
                              uint32_t width, uint32_t height, uint32_t depth,
                              uint32_t first_level, uint32_t last_level,
                              const void *base_ptr,
+                             boolean tiled,
                              uint32_t row_stride[PIPE_MAX_TEXTURE_LEVELS],
                              uint32_t img_stride[PIPE_MAX_TEXTURE_LEVELS],
                              uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS]);
@@ -357,6 +357,7 @@ generate_aaline_fs(struct aaline_stage *aaline)
 
    aaline_fs = *orig_fs; /* copy to init */
    aaline_fs.tokens = tgsi_alloc_tokens(newLen);
+   aaline_fs.hash = 0;
    if (aaline_fs.tokens == NULL)
       return FALSE;
 
@@ -502,6 +502,7 @@ generate_aapoint_fs(struct aapoint_stage *aapoint)
 
    aapoint_fs = *orig_fs; /* copy to init */
    aapoint_fs.tokens = tgsi_alloc_tokens(newLen);
+   aapoint_fs.hash = 0;
    if (aapoint_fs.tokens == NULL)
       return FALSE;
 
@@ -347,6 +347,7 @@ generate_pstip_fs(struct pstip_stage *pstip)
 
    pstip_fs = *orig_fs; /* copy to init */
    pstip_fs.tokens = tgsi_alloc_tokens(newLen);
+   pstip_fs.hash = 0;
    if (pstip_fs.tokens == NULL)
       return FALSE;
 
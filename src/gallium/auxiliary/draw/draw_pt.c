@@ -101,7 +101,9 @@ draw_pt_arrays(struct draw_context *draw,
    } else {
       if (opt == 0)
          middle = draw->pt.middle.fetch_emit;
-      else if (opt == PT_SHADE && !draw->pt.no_fse)
+      /* fetch_shade_emit doesn't count pipeline statistics */
+      else if (opt == PT_SHADE && !draw->pt.no_fse &&
+               !draw->collect_statistics)
          middle = draw->pt.middle.fetch_shade_emit;
       else
          middle = draw->pt.middle.general;
@@ -148,6 +150,10 @@ draw_pt_arrays(struct draw_context *draw,
 
    frontend->run( frontend, start, count );
 
+   /* The vertex buffers may be unmapped once the draw returns. */
+   if (middle->sync)
+      middle->sync(middle);
+
    return TRUE;
 }
 
@@ -125,6 +125,13 @@ struct draw_pt_middle_end {
    int (*get_max_vertex_count)( struct draw_pt_middle_end * );
 
    void (*finish)( struct draw_pt_middle_end * );
+
+   /**
+    * Complete the runs so far, which the middle end may still be
+    * working on in the background, before the draw returns.  Optional.
+    */
+   void (*sync)( struct draw_pt_middle_end * );
+
    void (*destroy)( struct draw_pt_middle_end * );
 };
 
@@ -31,6 +31,7 @@
   */
 
 #include "util/u_memory.h"
+#include "util/u_prim.h"
 #include "draw/draw_context.h"
 #include "draw/draw_private.h"
 #include "draw/draw_vbuf.h"
@@ -78,6 +79,7 @@ struct fetch_emit_middle_end {
 
    struct translate *translate;
    const struct vertex_info *vinfo;
+   unsigned prim;
 
    /* Cache point size somewhere it's address won't change:
     */
@@ -102,6 +104,7 @@ static void fetch_emit_prepare( struct draw_pt_middle_end *middle,
                            prim);
 
    draw->render->set_primitive(draw->render, gs_out_prim);
+   feme->prim = prim;
 
    /* Must do this after set_primitive() above:
     */
@@ -187,6 +190,23 @@ fetch_emit_bind_parameters(struct draw_pt_middle_end *middle)
 }
 
 
+/**
+ * Passthrough has no shader stages and no clipper, so only the input
+ * assembly statistics apply.
+ */
+static void
+fetch_emit_statistics(struct fetch_emit_middle_end *feme, unsigned count)
+{
+   struct draw_context *draw = feme->draw;
+
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += count;
+      draw->statistics.ia_primitives +=
+         u_decomposed_prims_for_vertices(feme->prim, count);
+   }
+}
+
+
 static void fetch_emit_run( struct draw_pt_middle_end *middle,
                             const unsigned *fetch_elts,
                             unsigned fetch_count,
@@ -202,6 +222,8 @@ static void fetch_emit_run( struct draw_pt_middle_end *middle,
     */
    draw_do_flush( draw, DRAW_FLUSH_BACKEND );
 
+   fetch_emit_statistics(feme, draw_count);
+
    draw->render->allocate_vertices( draw->render,
                                     (ushort)feme->translate->key.output_stride,
                                     (ushort)fetch_count );
@@ -261,6 +283,8 @@ static void fetch_emit_run_linear( struct draw_pt_middle_end *middle,
     */
    draw_do_flush( draw, DRAW_FLUSH_BACKEND );
 
+   fetch_emit_statistics(feme, count);
+
    if (!draw->render->allocate_vertices( draw->render,
                                          (ushort)feme->translate->key.output_stride,
                                          (ushort)count ))
@@ -321,6 +345,8 @@ static boolean fetch_emit_run_linear_elts( struct draw_pt_middle_end *middle,
     */
    draw_do_flush( draw, DRAW_FLUSH_BACKEND );
 
+   fetch_emit_statistics(feme, draw_count);
+
    if (!draw->render->allocate_vertices( draw->render,
                                          (ushort)feme->translate->key.output_stride,
                                          (ushort)count ))
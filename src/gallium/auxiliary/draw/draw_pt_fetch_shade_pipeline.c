@@ -298,7 +298,8 @@ static void fetch_pipeline_generic( struct draw_pt_middle_end *middle,
    if (prim_info->count == 0) {
       debug_printf("GS/IA didn't emit any vertices!\n");
       
-      FREE(vert_info->verts);
+      if (vert_info != &gs_vert_info)
+         FREE(vert_info->verts);
       if (free_prim_info) {
          FREE(prim_info->primitive_lengths);
       }
@@ -335,7 +336,8 @@ static void fetch_pipeline_generic( struct draw_pt_middle_end *middle,
          emit( fpme->emit, vert_info, prim_info );
       }
    }
-   FREE(vert_info->verts);
+   if (vert_info != &gs_vert_info)
+      FREE(vert_info->verts);
    if (free_prim_info) {
       FREE(prim_info->primitive_lengths);
    }
@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -39,6 +40,54 @@
 #include "gallivm/lp_bld_init.h"
 
 
+/** Max threads, including the calling one, for DRAW_THREADS */
+#define DRAW_MAX_THREADS 16
+
+/** Don't hand out chunks of fewer vertices than this to a thread */
+#define DRAW_THREAD_MIN_VERTS 256
+
+/** Send the whole run down the pipeline rather than in more spans */
+#define LLVM_MAX_CLIP_SPANS 16
+
+DEBUG_GET_ONCE_NUM_OPTION(draw_threads, "DRAW_THREADS", 0)
+
+
+struct llvm_middle_end;
+
+/**
+ * A job running the vertex shader on a slice of the vertices.
+ */
+struct llvm_vs_slice {
+   struct llvm_middle_end *fpme;
+   struct util_queue_fence fence;
+
+   const struct draw_fetch_info *fetch_info;
+   struct vertex_header *verts;
+   unsigned start;
+   unsigned count;
+   int clipped;
+};
+
+
+/**
+ * A run whose vertices the worker threads may still be shading, see
+ * llvm_queue_run().  The element lists are copies, as the front end
+ * reuses its buffers for the next run.
+ */
+struct llvm_pending_run {
+   struct draw_fetch_info fetch_info;
+   struct draw_prim_info prim_info;
+   struct draw_vertex_info vert_info;
+   unsigned prim_length;
+   unsigned num_slices;
+
+   unsigned *fetch_elts;
+   unsigned max_fetch_elts;
+   ushort *draw_elts;
+   unsigned max_draw_elts;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -56,6 +105,15 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   struct util_queue *queue;
+   unsigned num_threads;  /**< worker threads, not counting the caller */
+   struct llvm_vs_slice slices[DRAW_MAX_THREADS - 1];
+
+   struct llvm_pending_run runs[2];
+   struct llvm_pending_run *pending;  /**< being shaded, not emitted yet */
+   unsigned next_run;
+   boolean emitting;
 };
 
 
@@ -304,70 +362,336 @@ static void emit(struct pt_emit *emit,
    }
 }
 
-static void
-llvm_pipeline_generic( struct draw_pt_middle_end *middle,
-                       const struct draw_fetch_info *fetch_info,
-                       const struct draw_prim_info *in_prim_info )
+/**
+ * Sort out a list of lines or triangles in which some vertices
+ * were clipped, before the clip stage sees them one by one: primitives
+ * entirely outside one of the planes are dropped, those entirely inside
+ * all of them are emitted straight to the render, and only those
+ * crossing a plane go down the pipeline.  Consecutive primitives of the
+ * same kind make up a span, and the spans are drawn in order.  Returns
+ * FALSE, having drawn nothing, if the run doesn't qualify or alternates
+ * too often.
+ */
+static boolean
+llvm_clip_triage(struct llvm_middle_end *fpme,
+                 const struct draw_vertex_info *vert_info,
+                 const struct draw_prim_info *prim_info)
 {
-   struct llvm_middle_end *fpme = (struct llvm_middle_end *)middle;
-   struct draw_context *draw = fpme->draw;
-   struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
-   struct draw_prim_info gs_prim_info;
-   struct draw_vertex_info llvm_vert_info;
-   struct draw_vertex_info gs_vert_info;
-   struct draw_vertex_info *vert_info;
-   struct draw_prim_info ia_prim_info;
-   struct draw_vertex_info ia_vert_info;
-   const struct draw_prim_info *prim_info = in_prim_info;
-   boolean free_prim_info = FALSE;
-   unsigned opt = fpme->opt;
-   unsigned clipped = 0;
+   struct {
+      unsigned start;
+      unsigned count;
+      unsigned min_index;
+      unsigned max_index;
+      boolean clip;
+   } spans[LLVM_MAX_CLIP_SPANS];
+   const char *verts = (const char *) vert_info->verts;
+   const unsigned stride = vert_info->stride;
+   unsigned verts_per_prim, nr_prims, nr_spans = 0, n = 0;
+   unsigned i, j;
+   ushort *elts;
+
+   if (fpme->draw->gs.geometry_shader ||
+       prim_info->prim != fpme->input_prim ||
+       prim_info->primitive_count != 1 ||
+       vert_info->count > 0xffff)
+      return FALSE;
+
+   switch (prim_info->prim) {
+   case PIPE_PRIM_TRIANGLES:
+      verts_per_prim = 3;
+      break;
+   case PIPE_PRIM_LINES:
+      verts_per_prim = 2;
+      break;
+   default:
+      return FALSE;
+   }
 
-   llvm_vert_info.count = fetch_info->count;
-   llvm_vert_info.vertex_size = fpme->vertex_size;
-   llvm_vert_info.stride = fpme->vertex_size;
-   llvm_vert_info.verts =
-      (struct vertex_header *)MALLOC(fpme->vertex_size *
-                                     align(fetch_info->count,  lp_native_vector_width / 32));
-   if (!llvm_vert_info.verts) {
-      assert(0);
-      return;
+   nr_prims = prim_info->count / verts_per_prim;
+   elts = MALLOC(nr_prims * verts_per_prim * sizeof(ushort));
+   if (!elts)
+      return FALSE;
+
+   for (i = 0; i < nr_prims; i++) {
+      unsigned index[3];
+      unsigned mask_or = 0, mask_and = ~0;
+      boolean clip;
+
+      for (j = 0; j < verts_per_prim; j++) {
+         const unsigned k = i * verts_per_prim + j;
+         const struct vertex_header *v;
+
+         index[j] = prim_info->linear ? prim_info->start + k :
+                                        prim_info->elts[k];
+         v = (const struct vertex_header *) (verts + index[j] * stride);
+         mask_or |= v->clipmask;
+         mask_and &= v->clipmask;
+      }
+
+      if (mask_and)
+         continue;
+
+      clip = mask_or != 0;
+      if (!nr_spans || spans[nr_spans - 1].clip != clip) {
+         if (nr_spans == LLVM_MAX_CLIP_SPANS) {
+            FREE(elts);
+            return FALSE;
+         }
+         spans[nr_spans].start = n;
+         spans[nr_spans].count = 0;
+         spans[nr_spans].min_index = ~0;
+         spans[nr_spans].max_index = 0;
+         spans[nr_spans].clip = clip;
+         nr_spans++;
+      }
+
+      for (j = 0; j < verts_per_prim; j++) {
+         spans[nr_spans - 1].min_index =
+            MIN2(spans[nr_spans - 1].min_index, index[j]);
+         spans[nr_spans - 1].max_index =
+            MAX2(spans[nr_spans - 1].max_index, index[j]);
+         elts[n++] = (ushort) index[j];
+      }
+      spans[nr_spans - 1].count += verts_per_prim;
    }
 
-   if (draw->collect_statistics) {
-      draw->statistics.ia_vertices += prim_info->count;
-      draw->statistics.ia_primitives +=
-         u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
-      draw->statistics.vs_invocations += fetch_info->count;
+   for (i = 0; i < nr_spans; i++) {
+      struct draw_vertex_info span_vert_info = *vert_info;
+      struct draw_prim_info span_prim_info = *prim_info;
+
+      span_prim_info.linear = FALSE;
+      span_prim_info.start = 0;
+      span_prim_info.count = spans[i].count;
+      span_prim_info.elts = elts + spans[i].start;
+      span_prim_info.primitive_lengths = &spans[i].count;
+
+      if (spans[i].clip) {
+         pipeline(fpme, vert_info, &span_prim_info);
+      }
+      else {
+         /* Only translate the vertices this span uses. */
+         const unsigned min_index = spans[i].min_index;
+
+         for (j = 0; j < spans[i].count; j++)
+            elts[spans[i].start + j] -= min_index;
+
+         span_vert_info.verts = (struct vertex_header *)
+            (verts + min_index * stride);
+         span_vert_info.count = spans[i].max_index - min_index + 1;
+         emit(fpme->emit, &span_vert_info, &span_prim_info);
+      }
    }
 
+   FREE(elts);
+   return TRUE;
+}
+
+
+/**
+ * Run the vertex shader on vertices [start, start + count) of the fetch,
+ * writing them to the start of verts.
+ */
+static int
+llvm_run_vs_range(struct llvm_middle_end *fpme,
+                  const struct draw_fetch_info *fetch_info,
+                  struct vertex_header *verts,
+                  unsigned start,
+                  unsigned count)
+{
+   struct draw_context *draw = fpme->draw;
+
    if (fetch_info->linear)
-      clipped = fpme->current_variant->jit_func( &fpme->llvm->jit_context,
-                                       llvm_vert_info.verts,
+      return fpme->current_variant->jit_func( &fpme->llvm->jit_context,
+                                       verts,
                                        draw->pt.user.vbuffer,
-                                       fetch_info->start,
-                                       fetch_info->count,
+                                       fetch_info->start + start,
+                                       count,
                                        fpme->vertex_size,
                                        draw->pt.vertex_buffer,
                                        draw->instance_id,
                                        draw->start_index);
    else
-      clipped = fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
-                                            llvm_vert_info.verts,
+      return fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
+                                            verts,
                                             draw->pt.user.vbuffer,
-                                            fetch_info->elts,
+                                            fetch_info->elts + start,
                                             draw->pt.user.eltMax,
-                                            fetch_info->count,
+                                            count,
                                             fpme->vertex_size,
                                             draw->pt.vertex_buffer,
                                             draw->instance_id,
                                             draw->pt.user.eltBias);
+}
 
-   /* Finished with fetch and vs:
-    */
-   fetch_info = NULL;
-   vert_info = &llvm_vert_info;
 
+static void
+llvm_vs_slice_execute(void *job, unsigned thread_index)
+{
+   struct llvm_vs_slice *slice = (struct llvm_vs_slice *) job;
+
+   slice->clipped = llvm_run_vs_range(slice->fpme, slice->fetch_info,
+                                      slice->verts,
+                                      slice->start, slice->count);
+}
+
+
+/**
+ * Get DRAW_THREADS - 1 workers from the shared thread pool.
+ */
+static void
+llvm_vs_threads_create(struct llvm_middle_end *fpme)
+{
+   unsigned num_threads = (unsigned) debug_get_option_draw_threads();
+   unsigned i;
+
+   num_threads = MIN2(num_threads, DRAW_MAX_THREADS);
+   if (num_threads <= 1)
+      return;
+
+   fpme->queue = util_queue_ref_shared();
+   if (!fpme->queue)
+      return;
+
+   num_threads = MIN2(num_threads - 1, util_queue_num_threads(fpme->queue));
+   for (i = 0; i < num_threads; i++) {
+      fpme->slices[i].fpme = fpme;
+      util_queue_fence_init(&fpme->slices[i].fence);
+   }
+   fpme->num_threads = num_threads;
+
+   /* The texel cache isn't thread safe. */
+   FREE(fpme->llvm->vs_texel_cache);
+   fpme->llvm->vs_texel_cache = NULL;
+}
+
+
+static void
+llvm_vs_threads_destroy(struct llvm_middle_end *fpme)
+{
+   unsigned i;
+
+   for (i = 0; i < fpme->num_threads; i++) {
+      util_queue_fence_wait(&fpme->slices[i].fence);
+      util_queue_fence_destroy(&fpme->slices[i].fence);
+   }
+   fpme->num_threads = 0;
+
+   util_queue_unref_shared(fpme->queue);
+   fpme->queue = NULL;
+}
+
+
+/**
+ * Hand the vertices [start, count) of the fetch to the worker threads,
+ * in slices of slice_size.  Returns the number of threads used.
+ */
+static unsigned
+llvm_vs_threads_dispatch(struct llvm_middle_end *fpme,
+                         const struct draw_fetch_info *fetch_info,
+                         struct vertex_header *verts,
+                         unsigned start,
+                         unsigned count,
+                         unsigned slice_size)
+{
+   unsigned i;
+
+   for (i = 0; i < fpme->num_threads && start < count; i++) {
+      struct llvm_vs_slice *slice = &fpme->slices[i];
+
+      slice->fetch_info = fetch_info;
+      slice->verts = (struct vertex_header *)
+         ((char *) verts + start * fpme->vertex_size);
+      slice->start = start;
+      slice->count = MIN2(slice_size, count - start);
+      util_queue_add_job(fpme->queue, slice, &slice->fence,
+                         llvm_vs_slice_execute, UTIL_QUEUE_PRIORITY_HIGH);
+
+      start += slice_size;
+   }
+
+   return i;
+}
+
+
+/**
+ * Wait for the first num_used worker threads, returning whether any of
+ * their vertices was clipped.
+ */
+static int
+llvm_vs_threads_wait(struct llvm_middle_end *fpme, unsigned num_used)
+{
+   int clipped = 0;
+   unsigned i;
+
+   for (i = 0; i < num_used; i++) {
+      util_queue_fence_wait(&fpme->slices[i].fence);
+      clipped |= fpme->slices[i].clipped;
+   }
+
+   return clipped;
+}
+
+
+/**
+ * Fetch and shade all the vertices of the fetch into verts, returning
+ * whether any of them was clipped.
+ *
+ * With DRAW_THREADS, large fetches are cut into slices which the worker
+ * threads shade in parallel with the calling thread.  All slices but the
+ * last are a multiple of the SIMD width, so the jit functions never write
+ * past the end of their slice, and the output is the same as when shading
+ * everything at once.  Assembly,
+ * clipping and emitting the primitives stay on the calling thread, in
+ * the primitives' order.
+ */
+static int
+llvm_run_vs(struct llvm_middle_end *fpme,
+            const struct draw_fetch_info *fetch_info,
+            struct vertex_header *verts)
+{
+   const unsigned count = fetch_info->count;
+   unsigned num_slices, slice_size;
+   int clipped;
+
+   num_slices = MIN2(fpme->num_threads + 1, count / DRAW_THREAD_MIN_VERTS);
+   if (num_slices <= 1)
+      return llvm_run_vs_range(fpme, fetch_info, verts, 0, count);
+
+   slice_size = align((count + num_slices - 1) / num_slices,
+                      lp_native_vector_width / 32);
+
+   /* The calling thread takes the first slice. */
+   num_slices = llvm_vs_threads_dispatch(fpme, fetch_info, verts,
+                                         slice_size, count, slice_size);
+
+   clipped = llvm_run_vs_range(fpme, fetch_info, verts, 0, slice_size);
+   clipped |= llvm_vs_threads_wait(fpme, num_slices);
+
+   return clipped;
+}
+
+
+/**
+ * Everything after the vertex shader: geometry shader or primitive
+ * assembly, stream output, clipping and emitting.  Frees the shaded
+ * vertices.
+ */
+static void
+llvm_pipeline_post_vs( struct llvm_middle_end *fpme,
+                       struct draw_vertex_info *llvm_vert_info,
+                       const struct draw_prim_info *in_prim_info,
+                       unsigned clipped )
+{
+   struct draw_context *draw = fpme->draw;
+   struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
+   struct draw_prim_info gs_prim_info;
+   struct draw_vertex_info gs_vert_info;
+   struct draw_vertex_info *vert_info = llvm_vert_info;
+   struct draw_prim_info ia_prim_info;
+   struct draw_vertex_info ia_vert_info;
+   const struct draw_prim_info *prim_info = in_prim_info;
+   boolean free_prim_info = FALSE;
+   unsigned opt = fpme->opt;
 
    if ((opt & PT_SHADE) && gshader) {
       struct draw_vertex_shader *vshader = draw->vs.vertex_shader;
@@ -399,7 +723,8 @@ llvm_pipeline_generic( struct draw_pt_middle_end *middle,
    if (prim_info->count == 0) {
       debug_printf("GS/IA didn't emit any vertices!\n");
       
-      FREE(vert_info->verts);
+      if (vert_info != &gs_vert_info)
+         FREE(vert_info->verts);
       if (free_prim_info) {
          FREE(prim_info->primitive_lengths);
       }
@@ -419,26 +744,188 @@ llvm_pipeline_generic( struct draw_pt_middle_end *middle,
       if ((opt & PT_SHADE) && gshader) {
          clipped = draw_pt_post_vs_run( fpme->post_vs, vert_info, prim_info );
       }
-      if (clipped) {
-         opt |= PT_PIPELINE;
-      }
-
       /* Do we need to run the pipeline? Now will come here if clipped
        */
       if (opt & PT_PIPELINE) {
          pipeline( fpme, vert_info, prim_info );
       }
+      else if (clipped) {
+         if (!llvm_clip_triage( fpme, vert_info, prim_info ))
+            pipeline( fpme, vert_info, prim_info );
+      }
       else {
          emit( fpme->emit, vert_info, prim_info );
       }
    }
-   FREE(vert_info->verts);
+   if (vert_info != &gs_vert_info)
+      FREE(vert_info->verts);
    if (free_prim_info) {
       FREE(prim_info->primitive_lengths);
    }
 }
 
 
+/**
+ * Copy the description of a run into run, with its element lists.
+ */
+static boolean
+llvm_copy_run(struct llvm_pending_run *run,
+              const struct draw_fetch_info *fetch_info,
+              const struct draw_prim_info *prim_info)
+{
+   assert(prim_info->primitive_count == 1);
+
+   if (!fetch_info->linear && run->max_fetch_elts < fetch_info->count) {
+      FREE(run->fetch_elts);
+      run->fetch_elts = MALLOC(fetch_info->count * sizeof(unsigned));
+      run->max_fetch_elts = run->fetch_elts ? fetch_info->count : 0;
+      if (!run->fetch_elts)
+         return FALSE;
+   }
+
+   if (!prim_info->linear && run->max_draw_elts < prim_info->count) {
+      FREE(run->draw_elts);
+      run->draw_elts = MALLOC(prim_info->count * sizeof(ushort));
+      run->max_draw_elts = run->draw_elts ? prim_info->count : 0;
+      if (!run->draw_elts)
+         return FALSE;
+   }
+
+   run->fetch_info = *fetch_info;
+   if (!fetch_info->linear) {
+      memcpy(run->fetch_elts, fetch_info->elts,
+             fetch_info->count * sizeof(unsigned));
+      run->fetch_info.elts = run->fetch_elts;
+   }
+
+   run->prim_info = *prim_info;
+   if (!prim_info->linear) {
+      memcpy(run->draw_elts, prim_info->elts,
+             prim_info->count * sizeof(ushort));
+      run->prim_info.elts = run->draw_elts;
+   }
+   run->prim_length = prim_info->primitive_lengths[0];
+   run->prim_info.primitive_lengths = &run->prim_length;
+
+   return TRUE;
+}
+
+
+/**
+ * Emit the pending run, once the worker threads are done shading it.
+ */
+static void
+llvm_middle_end_sync( struct draw_pt_middle_end *middle )
+{
+   struct llvm_middle_end *fpme = (struct llvm_middle_end *)middle;
+   struct llvm_pending_run *run = fpme->pending;
+   int clipped;
+
+   /* The pipeline may flush the draw module while emitting. */
+   if (!run || fpme->emitting)
+      return;
+
+   clipped = llvm_vs_threads_wait(fpme, run->num_slices);
+   fpme->pending = NULL;
+
+   fpme->emitting = TRUE;
+   llvm_pipeline_post_vs(fpme, &run->vert_info, &run->prim_info, clipped);
+   fpme->emitting = FALSE;
+}
+
+
+/**
+ * Start the worker threads on the vertices of this run, then emit the
+ * previous run on the calling thread while they shade.  With DRAW_THREADS
+ * this overlaps the vertex shader of each run of a draw with the
+ * clipping, setup and binning of the one before; runs are still emitted
+ * in order, and the last one by llvm_middle_end_sync() at the end of the
+ * draw.  Returns FALSE, having shaded nothing, if the run couldn't be
+ * queued.
+ */
+static boolean
+llvm_queue_run(struct llvm_middle_end *fpme,
+               const struct draw_fetch_info *fetch_info,
+               const struct draw_prim_info *prim_info,
+               const struct draw_vertex_info *vert_info)
+{
+   struct llvm_pending_run *run = &fpme->runs[fpme->next_run];
+   struct llvm_pending_run *prev = fpme->pending;
+   const unsigned count = fetch_info->count;
+   unsigned num_slices, slice_size;
+   int clipped = 0;
+
+   assert(run != prev);
+
+   if (!llvm_copy_run(run, fetch_info, prim_info))
+      return FALSE;
+   run->vert_info = *vert_info;
+
+   if (prev)
+      clipped = llvm_vs_threads_wait(fpme, prev->num_slices);
+
+   num_slices = MIN2(fpme->num_threads, count / DRAW_THREAD_MIN_VERTS);
+   num_slices = MAX2(num_slices, 1);
+   slice_size = align((count + num_slices - 1) / num_slices,
+                      lp_native_vector_width / 32);
+   run->num_slices = llvm_vs_threads_dispatch(fpme, &run->fetch_info,
+                                              run->vert_info.verts,
+                                              0, count, slice_size);
+
+   fpme->pending = run;
+   fpme->next_run ^= 1;
+
+   if (prev) {
+      fpme->emitting = TRUE;
+      llvm_pipeline_post_vs(fpme, &prev->vert_info, &prev->prim_info,
+                            clipped);
+      fpme->emitting = FALSE;
+   }
+
+   return TRUE;
+}
+
+
+static void
+llvm_pipeline_generic( struct draw_pt_middle_end *middle,
+                       const struct draw_fetch_info *fetch_info,
+                       const struct draw_prim_info *prim_info )
+{
+   struct llvm_middle_end *fpme = (struct llvm_middle_end *)middle;
+   struct draw_context *draw = fpme->draw;
+   struct draw_vertex_info llvm_vert_info;
+   unsigned clipped;
+
+   llvm_vert_info.count = fetch_info->count;
+   llvm_vert_info.vertex_size = fpme->vertex_size;
+   llvm_vert_info.stride = fpme->vertex_size;
+   llvm_vert_info.verts =
+      (struct vertex_header *)MALLOC(fpme->vertex_size *
+                                     align(fetch_info->count,  lp_native_vector_width / 32));
+   if (!llvm_vert_info.verts) {
+      assert(0);
+      return;
+   }
+
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += prim_info->count;
+      draw->statistics.ia_primitives +=
+         u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
+      draw->statistics.vs_invocations += fetch_info->count;
+   }
+
+   if (fpme->num_threads) {
+      if (llvm_queue_run(fpme, fetch_info, prim_info, &llvm_vert_info))
+         return;
+      llvm_middle_end_sync(middle);
+   }
+
+   clipped = llvm_run_vs(fpme, fetch_info, llvm_vert_info.verts);
+
+   llvm_pipeline_post_vs(fpme, &llvm_vert_info, prim_info, clipped);
+}
+
+
 static void llvm_middle_end_run( struct draw_pt_middle_end *middle,
                                  const unsigned *fetch_elts,
                                  unsigned fetch_count,
@@ -531,12 +1018,21 @@ llvm_middle_end_linear_run_elts( struct draw_pt_middle_end *middle,
 
 static void llvm_middle_end_finish( struct draw_pt_middle_end *middle )
 {
-   /* nothing to do */
+   llvm_middle_end_sync(middle);
 }
 
 static void llvm_middle_end_destroy( struct draw_pt_middle_end *middle )
 {
    struct llvm_middle_end *fpme = (struct llvm_middle_end *)middle;
+   unsigned i;
+
+   llvm_middle_end_sync(middle);
+   llvm_vs_threads_destroy(fpme);
+
+   for (i = 0; i < Elements(fpme->runs); i++) {
+      FREE(fpme->runs[i].fetch_elts);
+      FREE(fpme->runs[i].draw_elts);
+   }
 
    if (fpme->fetch)
       draw_pt_fetch_destroy( fpme->fetch );
@@ -572,6 +1068,7 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
    fpme->base.run_linear      = llvm_middle_end_linear_run;
    fpme->base.run_linear_elts = llvm_middle_end_linear_run_elts;
    fpme->base.finish          = llvm_middle_end_finish;
+   fpme->base.sync            = llvm_middle_end_sync;
    fpme->base.destroy         = llvm_middle_end_destroy;
 
    fpme->draw = draw;
@@ -598,6 +1095,8 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   llvm_vs_threads_create(fpme);
+
    return &fpme->base;
 
  fail:
@@ -38,6 +38,19 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
+/**
+ * A run of consecutive stream output components, from one vertex to one
+ * buffer.  Outputs which are contiguous both in the vertex and in the
+ * buffer are merged, so packed outputs take a single memcpy.
+ */
+struct so_copy {
+   unsigned output_buffer;
+   boolean pre_clip_pos;  /**< copy from pre_clip_pos instead of data */
+   unsigned src_offset;  /**< in bytes */
+   unsigned dst_offset;  /**< in floats */
+   unsigned size;  /**< in bytes */
+};
+
 struct pt_so_emit {
    struct draw_context *draw;
 
@@ -49,6 +62,12 @@ struct pt_so_emit {
    int pos_idx;
    unsigned emitted_primitives;
    unsigned generated_primitives;
+
+   struct so_copy copies[PIPE_MAX_SO_OUTPUTS];
+   unsigned num_copies;
+   unsigned buffers_used;  /**< mask of the buffers written */
+   /** End in bytes of the last output of a vertex, per buffer */
+   unsigned buffer_end[PIPE_MAX_SO_BUFFERS];
 };
 
 static const struct pipe_stream_output_info *
@@ -76,6 +95,57 @@ draw_has_so(const struct draw_context *draw)
    return FALSE;
 }
 
+/**
+ * Turn the stream output info into the list of copies so_emit_prim()
+ * does per vertex.
+ */
+static void
+so_emit_prepare_copies(struct pt_so_emit *emit)
+{
+   const struct pipe_stream_output_info *state = draw_so_info(emit->draw);
+   unsigned slot;
+
+   emit->num_copies = 0;
+   emit->buffers_used = 0;
+   memset(emit->buffer_end, 0, sizeof(emit->buffer_end));
+
+   for (slot = 0; slot < state->num_outputs; ++slot) {
+      const unsigned idx = state->output[slot].register_index;
+      const unsigned start_comp = state->output[slot].start_component;
+      const unsigned ob = state->output[slot].output_buffer;
+      const unsigned dst_offset = state->output[slot].dst_offset;
+      const unsigned size = state->output[slot].num_components * sizeof(float);
+      const boolean pre_clip_pos = emit->use_pre_clip_pos &&
+                                   idx == emit->pos_idx;
+      const unsigned src_offset = pre_clip_pos ?
+         start_comp * sizeof(float) :
+         (idx * 4 + start_comp) * sizeof(float);
+      struct so_copy *copy = emit->num_copies ?
+         &emit->copies[emit->num_copies - 1] : NULL;
+
+      emit->buffers_used |= 1 << ob;
+      emit->buffer_end[ob] = MAX2(emit->buffer_end[ob],
+                                  dst_offset * sizeof(float) + size);
+
+      if (copy &&
+          copy->output_buffer == ob &&
+          copy->pre_clip_pos == pre_clip_pos &&
+          copy->src_offset + copy->size == src_offset &&
+          (copy->dst_offset * sizeof(float)) + copy->size ==
+          dst_offset * sizeof(float)) {
+         copy->size += size;
+         continue;
+      }
+
+      copy = &emit->copies[emit->num_copies++];
+      copy->output_buffer = ob;
+      copy->pre_clip_pos = pre_clip_pos;
+      copy->src_offset = src_offset;
+      copy->dst_offset = dst_offset;
+      copy->size = size;
+   }
+}
+
 void draw_pt_so_emit_prepare(struct pt_so_emit *emit, boolean use_pre_clip_pos)
 {
    struct draw_context *draw = emit->draw;
@@ -102,6 +172,8 @@ void draw_pt_so_emit_prepare(struct pt_so_emit *emit, boolean use_pre_clip_pos)
    if (!emit->has_so)
       return;
 
+   so_emit_prepare_copies(emit);
+
    /* XXX: need to flush to get prim_vbuf.c to release its allocation??
     */
    draw_do_flush( draw, DRAW_FLUSH_BACKEND );
@@ -111,103 +183,55 @@ static void so_emit_prim(struct pt_so_emit *so,
                          unsigned *indices,
                          unsigned num_vertices)
 {
-   unsigned slot, i;
+   unsigned i, c, ob;
    unsigned input_vertex_stride = so->input_vertex_stride;
    struct draw_context *draw = so->draw;
-   const float (*input_ptr)[4];
-   const float *pcp_ptr = NULL;
    const struct pipe_stream_output_info *state = draw_so_info(draw);
-   float *buffer;
-   int buffer_total_bytes[PIPE_MAX_SO_BUFFERS];
-   boolean buffer_written[PIPE_MAX_SO_BUFFERS] = {0};
-
-   input_ptr = so->inputs;
-   if (so->use_pre_clip_pos)
-      pcp_ptr = so->pre_clip_pos;
 
    ++so->generated_primitives;
 
-   for (i = 0; i < draw->so.num_targets; i++) {
-      struct draw_so_target *target = draw->so.targets[i];
-      if (target) {
-         buffer_total_bytes[i] = target->internal_offset;
-      } else {
-         buffer_total_bytes[i] = 0;
-      }
-   }
-
    /* check have we space to emit prim first - if not don't do anything */
-   for (i = 0; i < num_vertices; ++i) {
-      unsigned ob;
-      for (slot = 0; slot < state->num_outputs; ++slot) {
-         unsigned num_comps = state->output[slot].num_components;
-         int ob = state->output[slot].output_buffer;
-         unsigned dst_offset = state->output[slot].dst_offset * sizeof(float);
-         unsigned write_size = num_comps * sizeof(float);
-         /* If a buffer is missing then that's equivalent to
-          * an overflow */
-         if (!draw->so.targets[ob]) {
-            return;
-         }
-         if ((buffer_total_bytes[ob] + write_size + dst_offset) >
-             draw->so.targets[ob]->target.buffer_size) {
-            return;
-         }
-      }
-      for (ob = 0; ob < draw->so.num_targets; ++ob) {
-         buffer_total_bytes[ob] += state->stride[ob] * sizeof(float);
-      }
+   for (ob = 0; ob < PIPE_MAX_SO_BUFFERS; ++ob) {
+      struct draw_so_target *target = draw->so.targets[ob];
+
+      if (!(so->buffers_used & (1 << ob)))
+         continue;
+
+      /* If a buffer is missing then that's equivalent to
+       * an overflow */
+      if (!target)
+         return;
+
+      if (target->internal_offset +
+          (num_vertices - 1) * state->stride[ob] * sizeof(float) +
+          so->buffer_end[ob] > target->target.buffer_size)
+         return;
    }
 
    for (i = 0; i < num_vertices; ++i) {
-      const float (*input)[4];
-      const float *pre_clip_pos = NULL;
-      int ob;
-
-      input = (const float (*)[4])(
-         (const char *)input_ptr + (indices[i] * input_vertex_stride));
-
-      if (pcp_ptr)
-         pre_clip_pos = (const float *)(
-         (const char *)pcp_ptr + (indices[i] * input_vertex_stride));
-
-      for (slot = 0; slot < state->num_outputs; ++slot) {
-         unsigned idx = state->output[slot].register_index;
-         unsigned start_comp = state->output[slot].start_component;
-         unsigned num_comps = state->output[slot].num_components;
-
-         ob = state->output[slot].output_buffer;
-         buffer_written[ob] = TRUE;
-
-         buffer = (float *)((char *)draw->so.targets[ob]->mapping +
-                            draw->so.targets[ob]->target.buffer_offset +
-                            draw->so.targets[ob]->internal_offset) +
-            state->output[slot].dst_offset;
-         
-         if (idx == so->pos_idx && pcp_ptr)
-            memcpy(buffer, &pre_clip_pos[start_comp],
-                   num_comps * sizeof(float));
-         else
-            memcpy(buffer, &input[idx][start_comp],
-                   num_comps * sizeof(float));
-#if 0
-         {
-            int j;
-            debug_printf("VERT[%d], offset = %d, slot[%d] sc = %d, num_c = %d, idx = %d = [",
-                         i + draw->so.targets[ob]->emitted_vertices,
-                         draw->so.targets[ob]->internal_offset,
-                         slot, start_comp, num_comps, idx);
-            for (j = 0; j < num_comps; ++j) {
-               unsigned *ubuffer = (unsigned*)buffer;
-               debug_printf("%d (0x%x), ", ubuffer[j], ubuffer[j]);
-            }
-            debug_printf("]\n");
-         }
-#endif
+      const char *input = (const char *)so->inputs +
+                          indices[i] * input_vertex_stride;
+      const char *pre_clip_pos = NULL;
+
+      if (so->use_pre_clip_pos)
+         pre_clip_pos = (const char *)so->pre_clip_pos +
+                        indices[i] * input_vertex_stride;
+
+      for (c = 0; c < so->num_copies; ++c) {
+         const struct so_copy *copy = &so->copies[c];
+         struct draw_so_target *target = draw->so.targets[copy->output_buffer];
+         float *buffer = (float *)((char *)target->mapping +
+                                   target->target.buffer_offset +
+                                   target->internal_offset) +
+            copy->dst_offset;
+
+         memcpy(buffer,
+                (copy->pre_clip_pos ? pre_clip_pos : input) + copy->src_offset,
+                copy->size);
       }
       for (ob = 0; ob < draw->so.num_targets; ++ob) {
          struct draw_so_target *target = draw->so.targets[ob];
-         if (target && buffer_written[ob]) {
+         if (target && (so->buffers_used & (1 << ob))) {
             target->internal_offset += state->stride[ob] * sizeof(float);
             target->emitted_vertices += 1;
          }
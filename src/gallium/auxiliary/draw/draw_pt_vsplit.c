@@ -23,6 +23,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
@@ -31,7 +32,18 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/*
+ * The fetch elements already in the segment are looked up in a FIFO
+ * set-associative cache of MAP_WAYS ways; DRAW_VSPLIT_CACHE_SIZE picks
+ * the number of entries, a power of two up to MAP_SIZE.
+ */
+#define MAP_SIZE     SEGMENT_SIZE
+#define MAP_WAYS     4
+#define MAP_SETS     (MAP_SIZE / MAP_WAYS)
+
+DEBUG_GET_ONCE_NUM_OPTION(vsplit_cache_size, "DRAW_VSPLIT_CACHE_SIZE", MAP_SIZE)
+DEBUG_GET_ONCE_BOOL_OPTION(vsplit_stats, "DRAW_VSPLIT_STATS", FALSE)
 
 /* The largest possible index withing an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -53,13 +65,17 @@ struct vsplit_frontend {
    ushort identity_draw_elts[SEGMENT_SIZE];
 
    struct {
-      /* map a fetch element to a draw element */
+      /* map a fetch element to a draw element, set by set */
       unsigned fetches[MAP_SIZE];
       ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      ubyte used[MAP_SETS];   /**< valid ways of each set */
+      ubyte next[MAP_SETS];   /**< way to replace once the set is full */
+      unsigned set_mask;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
+
+      uint64_t hits, misses;
    } cache;
 };
 
@@ -67,8 +83,8 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   memset(vsplit->cache.used, 0, vsplit->cache.set_mask + 1);
+   memset(vsplit->cache.next, 0, vsplit->cache.set_mask + 1);
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -87,23 +103,42 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static INLINE void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch, unsigned ofbias)
 {
-   unsigned hash;
-
-   hash = fetch % MAP_SIZE;
+   const unsigned set = fetch & vsplit->cache.set_mask;
+   const unsigned base = set * MAP_WAYS;
+   const unsigned used = vsplit->cache.used[set];
+   unsigned way;
+
+   /* An overflow due to the element bias is always fetched again */
+   if (!ofbias) {
+      for (way = 0; way < used; way++) {
+         if (vsplit->cache.fetches[base + way] == fetch) {
+            vsplit->cache.hits++;
+            vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+               vsplit->cache.draws[base + way];
+            return;
+         }
+      }
+   }
 
-   /* If the value isn't in the cache of it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch || ofbias) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   vsplit->cache.misses++;
 
-      /* add fetch */
-      assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
-      vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
+   /* update cache, replacing the oldest entry of a full set */
+   if (used < MAP_WAYS) {
+      way = used;
+      vsplit->cache.used[set] = used + 1;
    }
-
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   else {
+      way = vsplit->cache.next[set];
+      vsplit->cache.next[set] = (way + 1) % MAP_WAYS;
+   }
+   vsplit->cache.fetches[base + way] = fetch;
+   vsplit->cache.draws[base + way] = vsplit->cache.num_fetch_elts;
+
+   /* add fetch */
+   assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+      vsplit->cache.num_fetch_elts;
+   vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
 }
 
 /**
@@ -198,16 +233,7 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
                       unsigned start, unsigned fetch, int elt_bias)
 {
    struct draw_context *draw = vsplit->draw;
-   unsigned raw_elem_idx = start + fetch + elt_bias;
    VSPLIT_CREATE_IDX(elts, start, fetch, elt_bias);
-
-   /* special care for DRAW_MAX_FETCH_IDX */
-   if (raw_elem_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = fetch % MAP_SIZE;
-      vsplit->cache.fetches[hash] = raw_elem_idx - 1; /* force update */
-      vsplit->cache.has_max_fetch = TRUE;
-   }
-
    vsplit_add_cache(vsplit, elt_idx, ofbias);
 }
 
@@ -279,6 +305,19 @@ static void vsplit_flush(struct draw_pt_front_end *frontend, unsigned flags)
 
 static void vsplit_destroy(struct draw_pt_front_end *frontend)
 {
+   struct vsplit_frontend *vsplit = (struct vsplit_frontend *) frontend;
+
+   if (debug_get_option_vsplit_stats()) {
+      const uint64_t total = vsplit->cache.hits + vsplit->cache.misses;
+
+      debug_printf("draw: vsplit cache of %u entries: %llu hits, "
+                   "%llu misses (%.1f%% hits)\n",
+                   (vsplit->cache.set_mask + 1) * MAP_WAYS,
+                   (unsigned long long) vsplit->cache.hits,
+                   (unsigned long long) vsplit->cache.misses,
+                   total ? 100.0 * vsplit->cache.hits / total : 0.0);
+   }
+
    FREE(frontend);
 }
 
@@ -286,11 +325,17 @@ static void vsplit_destroy(struct draw_pt_front_end *frontend)
 struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
 {
    struct vsplit_frontend *vsplit = CALLOC_STRUCT(vsplit_frontend);
+   unsigned cache_size;
    ushort i;
 
    if (!vsplit)
       return NULL;
 
+   cache_size = debug_get_option_vsplit_cache_size();
+   cache_size = CLAMP(cache_size, MAP_WAYS, MAP_SIZE);
+   cache_size = util_next_power_of_two(cache_size);
+   vsplit->cache.set_mask = cache_size / MAP_WAYS - 1;
+
    vsplit->base.prepare = vsplit_prepare;
    vsplit->base.run     = NULL;
    vsplit->base.flush   = vsplit_flush;
@@ -31,6 +31,7 @@
   *   Brian Paul
   */
 
+#include "util/u_counter.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "pipe/p_shader_tokens.h"
@@ -47,6 +48,7 @@
 struct exec_vertex_shader {
    struct draw_vertex_shader base;
    struct tgsi_exec_machine *machine;
+   struct tgsi_decoded_shader *decoded;
 };
 
 static struct exec_vertex_shader *exec_vertex_shader( struct draw_vertex_shader *vs )
@@ -66,16 +68,68 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
    /* Specify the vertex program to interpret/execute.
     * Avoid rebinding when possible.
     */
-   if (evs->machine->Tokens != shader->state.tokens) {
-      tgsi_exec_machine_bind_shader(evs->machine,
-                                    shader->state.tokens,
-                                    draw->vs.tgsi.sampler);
+   if (evs->machine->Decoded != evs->decoded) {
+      tgsi_exec_machine_bind_decoded(evs->machine,
+                                     evs->decoded,
+                                     draw->vs.tgsi.sampler);
    }
 }
 
 
 
 
+/* How vs_exec_run_linear() copies each output out of the machine.
+ */
+enum vs_exec_output {
+   VS_EXEC_OUTPUT_COPY,
+   VS_EXEC_OUTPUT_CLAMP,
+   VS_EXEC_OUTPUT_FOG
+};
+
+
+/**
+ * Transpose up to four AoS vertices into the machine's SoA inputs.
+ */
+static INLINE void
+vs_exec_fetch_inputs(struct tgsi_exec_machine *machine,
+                     unsigned num_inputs,
+                     const float (*input)[4],
+                     unsigned input_stride,
+                     unsigned count)
+{
+   unsigned slot, j;
+
+   if (count == TGSI_QUAD_SIZE) {
+      const float (*in0)[4] = input;
+      const float (*in1)[4] = (const float (*)[4])((const char *)in0 + input_stride);
+      const float (*in2)[4] = (const float (*)[4])((const char *)in1 + input_stride);
+      const float (*in3)[4] = (const float (*)[4])((const char *)in2 + input_stride);
+
+      for (slot = 0; slot < num_inputs; slot++) {
+         struct tgsi_exec_vector *in = &machine->Inputs[slot];
+
+         for (j = 0; j < TGSI_NUM_CHANNELS; j++) {
+            in->xyzw[j].f[0] = in0[slot][j];
+            in->xyzw[j].f[1] = in1[slot][j];
+            in->xyzw[j].f[2] = in2[slot][j];
+            in->xyzw[j].f[3] = in3[slot][j];
+         }
+      }
+      return;
+   }
+
+   for (j = 0; j < count; j++) {
+      for (slot = 0; slot < num_inputs; slot++) {
+         machine->Inputs[slot].xyzw[0].f[j] = input[slot][0];
+         machine->Inputs[slot].xyzw[1].f[j] = input[slot][1];
+         machine->Inputs[slot].xyzw[2].f[j] = input[slot][2];
+         machine->Inputs[slot].xyzw[3].f[j] = input[slot][3];
+      }
+      input = (const float (*)[4])((const char *)input + input_stride);
+   }
+}
+
+
 /* Simplified vertex shader interface for the pt paths.  Given the
  * complexity of code-generating all the above operations together,
  * it's time to try doing all the other stuff separately.
@@ -92,6 +146,11 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
 {
    struct exec_vertex_shader *evs = exec_vertex_shader(shader);
    struct tgsi_exec_machine *machine = evs->machine;
+   const unsigned num_inputs = shader->info.num_inputs;
+   const unsigned num_outputs = shader->info.num_outputs;
+   unsigned char mode[PIPE_MAX_SHADER_OUTPUTS];
+   unsigned vid = ~0u;
+   unsigned mask_vertices = 0;
    unsigned int i, j;
    unsigned slot;
    boolean clamp_vertex_color = shader->draw->rasterizer->clamp_vertex_color;
@@ -106,50 +165,49 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
          machine->SystemValue[i].i[j] = shader->draw->instance_id;
    }
 
+   if (shader->info.uses_vertexid) {
+      vid = machine->SysSemanticToIndex[TGSI_SEMANTIC_VERTEXID];
+      assert(vid < Elements(machine->SystemValue));
+   }
+
+   /* Decide once per run, rather than per vertex, how to copy each
+    * output.
+    */
+   for (slot = 0; slot < num_outputs; slot++) {
+      unsigned name = shader->info.output_semantic_name[slot];
+      if (clamp_vertex_color &&
+          (name == TGSI_SEMANTIC_COLOR || name == TGSI_SEMANTIC_BCOLOR))
+         mode[slot] = VS_EXEC_OUTPUT_CLAMP;
+      else if (name == TGSI_SEMANTIC_FOG)
+         mode[slot] = VS_EXEC_OUTPUT_FOG;
+      else
+         mode[slot] = VS_EXEC_OUTPUT_COPY;
+   }
+
    for (i = 0; i < count; i += MAX_TGSI_VERTICES) {
       unsigned int max_vertices = MIN2(MAX_TGSI_VERTICES, count - i);
 
       /* Swizzle inputs.  
        */
-      for (j = 0; j < max_vertices; j++) {
-#if 0
-         debug_printf("%d) Input vert:\n", i + j);
-         for (slot = 0; slot < shader->info.num_inputs; slot++) {
-            debug_printf("\t%d: %f %f %f %f\n", slot,
-			 input[slot][0],
-			 input[slot][1],
-			 input[slot][2],
-			 input[slot][3]);
-         }
-#endif
+      vs_exec_fetch_inputs(machine, num_inputs, input, input_stride,
+                           max_vertices);
+      input = (const float (*)[4])((const char *)input +
+                                   max_vertices * input_stride);
 
-         if (shader->info.uses_vertexid) {
-            unsigned vid = machine->SysSemanticToIndex[TGSI_SEMANTIC_VERTEXID];
-            assert(vid < Elements(machine->SystemValue));
+      if (vid != ~0u) {
+         for (j = 0; j < max_vertices; j++)
             machine->SystemValue[vid].i[j] = i + j;
-         }
-
-         for (slot = 0; slot < shader->info.num_inputs; slot++) {
-#if 0
-            assert(!util_is_inf_or_nan(input[slot][0]));
-            assert(!util_is_inf_or_nan(input[slot][1]));
-            assert(!util_is_inf_or_nan(input[slot][2]));
-            assert(!util_is_inf_or_nan(input[slot][3]));
-#endif
-            machine->Inputs[slot].xyzw[0].f[j] = input[slot][0];
-            machine->Inputs[slot].xyzw[1].f[j] = input[slot][1];
-            machine->Inputs[slot].xyzw[2].f[j] = input[slot][2];
-            machine->Inputs[slot].xyzw[3].f[j] = input[slot][3];
-         }
-
-	 input = (const float (*)[4])((const char *)input + input_stride);
-      } 
-
-      tgsi_set_exec_mask(machine,
-                         1,
-                         max_vertices > 1,
-                         max_vertices > 2,
-                         max_vertices > 3);
+      }
+
+      /* Only the last batch can be partial. */
+      if (max_vertices != mask_vertices) {
+         tgsi_set_exec_mask(machine,
+                            1,
+                            max_vertices > 1,
+                            max_vertices > 2,
+                            max_vertices > 3);
+         mask_vertices = max_vertices;
+      }
 
       /* run interpreter */
       tgsi_exec_machine_run( machine );
@@ -157,33 +215,34 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
       /* Unswizzle all output results.  
        */
       for (j = 0; j < max_vertices; j++) {
-         for (slot = 0; slot < shader->info.num_outputs; slot++) {
-            unsigned name = shader->info.output_semantic_name[slot];
-            if(clamp_vertex_color &&
-                  (name == TGSI_SEMANTIC_COLOR || name == TGSI_SEMANTIC_BCOLOR))
-            {
-               output[slot][0] = CLAMP(machine->Outputs[slot].xyzw[0].f[j], 0.0f, 1.0f);
-               output[slot][1] = CLAMP(machine->Outputs[slot].xyzw[1].f[j], 0.0f, 1.0f);
-               output[slot][2] = CLAMP(machine->Outputs[slot].xyzw[2].f[j], 0.0f, 1.0f);
-               output[slot][3] = CLAMP(machine->Outputs[slot].xyzw[3].f[j], 0.0f, 1.0f);
-            }
-            else if (name == TGSI_SEMANTIC_FOG) {
-               output[slot][0] = machine->Outputs[slot].xyzw[0].f[j];
+         for (slot = 0; slot < num_outputs; slot++) {
+            const struct tgsi_exec_vector *out = &machine->Outputs[slot];
+
+            switch (mode[slot]) {
+            case VS_EXEC_OUTPUT_CLAMP:
+               output[slot][0] = CLAMP(out->xyzw[0].f[j], 0.0f, 1.0f);
+               output[slot][1] = CLAMP(out->xyzw[1].f[j], 0.0f, 1.0f);
+               output[slot][2] = CLAMP(out->xyzw[2].f[j], 0.0f, 1.0f);
+               output[slot][3] = CLAMP(out->xyzw[3].f[j], 0.0f, 1.0f);
+               break;
+            case VS_EXEC_OUTPUT_FOG:
+               output[slot][0] = out->xyzw[0].f[j];
                output[slot][1] = 0;
                output[slot][2] = 0;
                output[slot][3] = 1;
-	    } else
-            {
-               output[slot][0] = machine->Outputs[slot].xyzw[0].f[j];
-               output[slot][1] = machine->Outputs[slot].xyzw[1].f[j];
-               output[slot][2] = machine->Outputs[slot].xyzw[2].f[j];
-               output[slot][3] = machine->Outputs[slot].xyzw[3].f[j];
+               break;
+            default:
+               output[slot][0] = out->xyzw[0].f[j];
+               output[slot][1] = out->xyzw[1].f[j];
+               output[slot][2] = out->xyzw[2].f[j];
+               output[slot][3] = out->xyzw[3].f[j];
+               break;
             }
          }
 
 #if 0
 	 debug_printf("%d) Post xform vert:\n", i + j);
-	 for (slot = 0; slot < shader->info.num_outputs; slot++) {
+	 for (slot = 0; slot < num_outputs; slot++) {
 	    debug_printf("\t%d: %f %f %f %f\n", slot,
 			 output[slot][0],
 			 output[slot][1],
@@ -205,6 +264,15 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
 static void
 vs_exec_delete( struct draw_vertex_shader *dvs )
 {
+   struct exec_vertex_shader *evs = exec_vertex_shader(dvs);
+
+   if (evs->machine->Decoded == evs->decoded) {
+      tgsi_exec_machine_bind_decoded(evs->machine, NULL, NULL);
+   }
+
+   tgsi_free_decoded_shader(evs->decoded);
+   util_counter_mem_free(UTIL_COUNTER_MEM_TGSI,
+                         tgsi_tokens_size(dvs->state.tokens));
    FREE((void*) dvs->state.tokens);
    FREE( dvs );
 }
@@ -226,7 +294,17 @@ draw_create_vs_exec(struct draw_context *draw,
       return NULL;
    }
 
-   tgsi_scan_shader(state->tokens, &vs->base.info);
+   /* decoded once, rather than each time the shader is bound */
+   vs->decoded = tgsi_decode_shader(vs->base.state.tokens);
+   if (!vs->decoded) {
+      FREE((void*) vs->base.state.tokens);
+      FREE(vs);
+      return NULL;
+   }
+
+   tgsi_scan_decoded_shader(vs->decoded, &vs->base.info);
+   util_counter_mem_alloc(UTIL_COUNTER_MEM_TGSI,
+                          tgsi_tokens_size(vs->base.state.tokens));
 
    vs->base.state.stream_output = state->stream_output;
    vs->base.draw = draw;
@@ -25,6 +25,7 @@
  *
  **************************************************************************/
 
+#include "util/u_counter.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "pipe/p_shader_tokens.h"
@@ -75,6 +76,8 @@ vs_llvm_delete( struct draw_vertex_shader *dvs )
    }
 
    assert(shader->variants_cached == 0);
+   util_counter_mem_free(UTIL_COUNTER_MEM_TGSI,
+                         tgsi_tokens_size(dvs->state.tokens));
    FREE((void*) dvs->state.tokens);
    FREE( dvs );
 }
@@ -96,6 +99,9 @@ draw_create_vs_llvm(struct draw_context *draw,
       return NULL;
    }
 
+   util_counter_mem_alloc(UTIL_COUNTER_MEM_TGSI,
+                          tgsi_tokens_size(vs->base.state.tokens));
+
    tgsi_scan_shader(state->tokens, &vs->base.info);
 
    vs->variant_key_size = 
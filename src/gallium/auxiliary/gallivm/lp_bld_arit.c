@@ -157,6 +157,18 @@ lp_build_min_simple(struct lp_build_context *bld,
             intrinsic = "llvm.x86.sse41.pminsd";
          }
       }
+      if (util_cpu_caps.has_avx2 && type.width * type.length > 128) {
+         intr_size = 256;
+         if (type.width == 8) {
+            intrinsic = type.sign ? "llvm.x86.avx2.pmins.b" : "llvm.x86.avx2.pminu.b";
+         }
+         else if (type.width == 16) {
+            intrinsic = type.sign ? "llvm.x86.avx2.pmins.w" : "llvm.x86.avx2.pminu.w";
+         }
+         else if (type.width == 32) {
+            intrinsic = type.sign ? "llvm.x86.avx2.pmins.d" : "llvm.x86.avx2.pminu.d";
+         }
+      }
    } else if (util_cpu_caps.has_altivec) {
       intr_size = 128;
       debug_printf("%s: altivec doesn't support nan behavior modes\n",
@@ -334,6 +346,18 @@ lp_build_max_simple(struct lp_build_context *bld,
             intrinsic = "llvm.x86.sse41.pmaxsd";
          }
       }
+      if (util_cpu_caps.has_avx2 && type.width * type.length > 128) {
+         intr_size = 256;
+         if (type.width == 8) {
+            intrinsic = type.sign ? "llvm.x86.avx2.pmaxs.b" : "llvm.x86.avx2.pmaxu.b";
+         }
+         else if (type.width == 16) {
+            intrinsic = type.sign ? "llvm.x86.avx2.pmaxs.w" : "llvm.x86.avx2.pmaxu.w";
+         }
+         else if (type.width == 32) {
+            intrinsic = type.sign ? "llvm.x86.avx2.pmaxs.d" : "llvm.x86.avx2.pmaxu.d";
+         }
+      }
    } else if (util_cpu_caps.has_altivec) {
      intr_size = 128;
      debug_printf("%s: altivec doesn't support nan behavior modes\n",
@@ -496,6 +520,14 @@ lp_build_add(struct lp_build_context *bld,
               intrinsic = type.sign ? "llvm.ppc.altivec.vaddshs" : "llvm.ppc.altivec.vadduhs";
          }
       }
+      else if (type.width * type.length == 256 &&
+               !type.floating && !type.fixed &&
+               util_cpu_caps.has_avx2) {
+         if(type.width == 8)
+            intrinsic = type.sign ? "llvm.x86.avx2.padds.b" : "llvm.x86.avx2.paddus.b";
+         if(type.width == 16)
+            intrinsic = type.sign ? "llvm.x86.avx2.padds.w" : "llvm.x86.avx2.paddus.w";
+      }
    
       if(intrinsic)
          return lp_build_intrinsic_binary(builder, intrinsic, lp_build_vec_type(bld->gallivm, bld->type), a, b);
@@ -777,6 +809,14 @@ lp_build_sub(struct lp_build_context *bld,
               intrinsic = type.sign ? "llvm.ppc.altivec.vsubshs" : "llvm.ppc.altivec.vsubuhs";
          }
       }
+      else if (type.width * type.length == 256 &&
+               !type.floating && !type.fixed &&
+               util_cpu_caps.has_avx2) {
+         if(type.width == 8)
+            intrinsic = type.sign ? "llvm.x86.avx2.psubs.b" : "llvm.x86.avx2.psubus.b";
+         if(type.width == 16)
+            intrinsic = type.sign ? "llvm.x86.avx2.psubs.w" : "llvm.x86.avx2.psubus.w";
+      }
    
       if(intrinsic)
          return lp_build_intrinsic_binary(builder, intrinsic, lp_build_vec_type(bld->gallivm, bld->type), a, b);
@@ -449,6 +449,17 @@ lp_disassemble(LLVMValueRef func, const void *code) {
 }
 
 
+/*
+ * Size in bytes of the machine code of a function, found the same way as
+ * when disassembling it.
+ */
+extern "C" unsigned long
+lp_function_code_size(const void *code)
+{
+   return disassemble(code, llvm::nulls());
+}
+
+
 /*
  * Linux perf profiler integration.
  *
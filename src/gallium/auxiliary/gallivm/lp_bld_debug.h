@@ -92,6 +92,10 @@ void
 lp_profile(LLVMValueRef func, const void *code);
 
 
+unsigned long
+lp_function_code_size(const void *code);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,12 +38,69 @@
 #include "gallivm/lp_bld_init.h"
 
 #include "pipe/p_format.h"
+#include "util/u_pointer.h"
 
 struct util_format_description;
 struct lp_type;
 struct lp_build_context;
 
 
+/*
+ * Texel cache
+ */
+
+#define LP_BUILD_FORMAT_CACHE_ORDER 8
+#define LP_BUILD_FORMAT_CACHE_SIZE (1 << LP_BUILD_FORMAT_CACHE_ORDER)
+
+struct lp_build_format_cache_entry
+{
+   const uint8_t *src;
+   func_pointer fetch;
+   unsigned i, j;
+   union {
+      float f[4];
+      uint8_t ub[4];
+   } data;
+};
+
+/**
+ * Direct mapped cache of the texels fetched through the
+ * util_format_description fetch functions, for formats without a code
+ * path of their own.  Passed to the generated code, which may be called
+ * with a NULL one.  Not thread safe.
+ */
+struct lp_build_format_cache
+{
+   struct lp_build_format_cache_entry entries[LP_BUILD_FORMAT_CACHE_SIZE];
+   boolean dirty;
+
+   uint64_t hits;
+   uint64_t misses;
+};
+
+/** Forget the texels, when the texture might have changed */
+void
+lp_build_format_cache_clear(struct lp_build_format_cache *cache);
+
+void
+lp_build_format_cache_fetch_float(struct lp_build_format_cache *cache,
+                                  void (*fetch)(float *dst,
+                                                const uint8_t *src,
+                                                unsigned i, unsigned j),
+                                  float *dst,
+                                  const uint8_t *src,
+                                  unsigned i, unsigned j);
+
+void
+lp_build_format_cache_fetch_8unorm(struct lp_build_format_cache *cache,
+                                   void (*fetch)(uint8_t *dst,
+                                                 const uint8_t *src,
+                                                 unsigned i, unsigned j),
+                                   uint8_t *dst,
+                                   const uint8_t *src,
+                                   unsigned i, unsigned j);
+
+
 /*
  * AoS
  */
@@ -65,7 +122,8 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
                         LLVMValueRef base_ptr,
                         LLVMValueRef offset,
                         LLVMValueRef i,
-                        LLVMValueRef j);
+                        LLVMValueRef j,
+                        LLVMValueRef cache);
 
 LLVMValueRef
 lp_build_fetch_rgba_aos_array(struct gallivm_state *gallivm,
@@ -106,8 +164,27 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
                         LLVMValueRef offsets,
                         LLVMValueRef i,
                         LLVMValueRef j,
+                        LLVMValueRef cache,
                         LLVMValueRef rgba_out[4]);
 
+/*
+ * S3TC / RGTC
+ */
+
+
+boolean
+lp_build_format_s3tc_supported(const struct util_format_description *format_desc);
+
+LLVMValueRef
+lp_build_fetch_s3tc_rgba_aos(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j);
+
+
 /*
  * YUV
  */
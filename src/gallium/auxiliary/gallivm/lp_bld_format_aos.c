@@ -359,6 +359,8 @@ lp_build_pack_rgba_aos(struct gallivm_state *gallivm,
  * \param ptr  address of the pixel block (or the texel if uncompressed)
  * \param i, j  the sub-block pixel coordinates.  For non-compressed formats
  *              these will always be (0, 0).
+ * \param cache  optional pointer to a struct lp_build_format_cache, used
+ *               when falling back to the util_format fetch functions
  * \return  a 4 element vector with the pixel's RGBA values.
  */
 LLVMValueRef
@@ -368,7 +370,8 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
                         LLVMValueRef base_ptr,
                         LLVMValueRef offset,
                         LLVMValueRef i,
-                        LLVMValueRef j)
+                        LLVMValueRef j,
+                        LLVMValueRef cache)
 {
    LLVMBuilderRef builder = gallivm->builder;
    unsigned num_pixels = type.length / 4;
@@ -499,6 +502,33 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
       return tmp;
    }
 
+   /*
+    * S3TC / RGTC compressed formats
+    */
+
+   if (lp_build_format_s3tc_supported(format_desc)) {
+      struct lp_type tmp_type;
+      LLVMValueRef tmp;
+
+      memset(&tmp_type, 0, sizeof tmp_type);
+      tmp_type.width = 8;
+      tmp_type.length = num_pixels * 4;
+      tmp_type.norm = TRUE;
+
+      tmp = lp_build_fetch_s3tc_rgba_aos(gallivm,
+                                         format_desc,
+                                         num_pixels,
+                                         base_ptr,
+                                         offset,
+                                         i, j);
+
+      lp_build_conv(gallivm,
+                    tmp_type, type,
+                    &tmp, 1, &tmp, 1);
+
+      return tmp;
+   }
+
    /*
     * Fallback to util_format_description::fetch_rgba_8unorm().
     */
@@ -518,6 +548,7 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
       LLVMTypeRef pi8t = LLVMPointerType(i8t, 0);
       LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
       LLVMValueRef function;
+      LLVMValueRef cached_function = NULL;
       LLVMValueRef tmp_ptr;
       LLVMValueRef tmp;
       LLVMValueRef res;
@@ -559,6 +590,30 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
                                      "cast callee");
       }
 
+      if (cache) {
+         /*
+          * Function to call looks like:
+          *   fetch(cache, fetch_rgba_8unorm, uint8_t *dst, const uint8_t *src,
+          *         unsigned i, unsigned j)
+          */
+         LLVMTypeRef arg_types[6];
+
+         arg_types[0] = pi8t;
+         arg_types[1] = pi8t;
+         arg_types[2] = pi8t;
+         arg_types[3] = pi8t;
+         arg_types[4] = i32t;
+         arg_types[5] = i32t;
+
+         cached_function = lp_build_const_func_pointer(gallivm,
+            func_to_pointer((func_pointer) lp_build_format_cache_fetch_8unorm),
+            LLVMVoidTypeInContext(gallivm->context),
+            arg_types, Elements(arg_types),
+            "lp_build_format_cache_fetch_8unorm");
+         cache = LLVMBuildBitCast(builder, cache, pi8t, "");
+         function = LLVMBuildBitCast(builder, function, pi8t, "");
+      }
+
       tmp_ptr = lp_build_alloca(gallivm, i32t, "");
 
       res = LLVMGetUndef(LLVMVectorType(i32t, num_pixels));
@@ -585,7 +640,18 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
             args[3] = LLVMBuildExtractElement(builder, j, index, "");
          }
 
-         LLVMBuildCall(builder, function, args, Elements(args), "");
+         if (cached_function) {
+            LLVMValueRef cached_args[6];
+
+            cached_args[0] = cache;
+            cached_args[1] = function;
+            memcpy(&cached_args[2], args, sizeof args);
+            LLVMBuildCall(builder, cached_function, cached_args,
+                          Elements(cached_args), "");
+         }
+         else {
+            LLVMBuildCall(builder, function, args, Elements(args), "");
+         }
 
          tmp = LLVMBuildLoad(builder, tmp_ptr, "");
 
@@ -623,6 +689,7 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
       LLVMTypeRef pi8t = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
       LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
       LLVMValueRef function;
+      LLVMValueRef cached_function = NULL;
       LLVMValueRef tmp_ptr;
       LLVMValueRef tmps[LP_MAX_VECTOR_LENGTH/4];
       LLVMValueRef res;
@@ -658,6 +725,30 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
                                                 format_desc->short_name);
       }
 
+      if (cache) {
+         /*
+          * Function to call looks like:
+          *   fetch(cache, fetch_rgba_float, float *dst, const uint8_t *src,
+          *         unsigned i, unsigned j)
+          */
+         LLVMTypeRef arg_types[6];
+
+         arg_types[0] = pi8t;
+         arg_types[1] = pi8t;
+         arg_types[2] = pf32t;
+         arg_types[3] = pi8t;
+         arg_types[4] = i32t;
+         arg_types[5] = i32t;
+
+         cached_function = lp_build_const_func_pointer(gallivm,
+            func_to_pointer((func_pointer) lp_build_format_cache_fetch_float),
+            LLVMVoidTypeInContext(gallivm->context),
+            arg_types, Elements(arg_types),
+            "lp_build_format_cache_fetch_float");
+         cache = LLVMBuildBitCast(builder, cache, pi8t, "");
+         function = LLVMBuildBitCast(builder, function, pi8t, "");
+      }
+
       tmp_ptr = lp_build_alloca(gallivm, f32x4t, "");
 
       /*
@@ -682,7 +773,18 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
             args[3] = LLVMBuildExtractElement(builder, j, index, "");
          }
 
-         LLVMBuildCall(builder, function, args, Elements(args), "");
+         if (cached_function) {
+            LLVMValueRef cached_args[6];
+
+            cached_args[0] = cache;
+            cached_args[1] = function;
+            memcpy(&cached_args[2], args, sizeof args);
+            LLVMBuildCall(builder, cached_function, cached_args,
+                          Elements(cached_args), "");
+         }
+         else {
+            LLVMBuildCall(builder, function, args, Elements(args), "");
+         }
 
          tmps[k] = LLVMBuildLoad(builder, tmp_ptr, "");
       }
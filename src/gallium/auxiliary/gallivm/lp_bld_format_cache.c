@@ -0,0 +1,131 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Texel cache for the util_format fetch fallbacks, called from the
+ * generated code.
+ */
+
+
+#include "util/u_memory.h"
+
+#include "lp_bld_format.h"
+
+
+static INLINE struct lp_build_format_cache_entry *
+cache_entry(struct lp_build_format_cache *cache,
+            const uint8_t *src, unsigned i, unsigned j)
+{
+   uint32_t hash = (uint32_t) (uintptr_t) src * 0x9e3779b1;
+
+   hash += ((j << 2) + i) * 0x85ebca77;
+
+   return &cache->entries[hash >> (32 - LP_BUILD_FORMAT_CACHE_ORDER)];
+}
+
+
+void
+lp_build_format_cache_clear(struct lp_build_format_cache *cache)
+{
+   unsigned k;
+
+   if (!cache || !cache->dirty)
+      return;
+
+   for (k = 0; k < LP_BUILD_FORMAT_CACHE_SIZE; k++)
+      cache->entries[k].src = NULL;
+
+   cache->dirty = FALSE;
+}
+
+
+void
+lp_build_format_cache_fetch_float(struct lp_build_format_cache *cache,
+                                  void (*fetch)(float *dst,
+                                                const uint8_t *src,
+                                                unsigned i, unsigned j),
+                                  float *dst,
+                                  const uint8_t *src,
+                                  unsigned i, unsigned j)
+{
+   struct lp_build_format_cache_entry *entry;
+
+   if (!cache) {
+      fetch(dst, src, i, j);
+      return;
+   }
+
+   entry = cache_entry(cache, src, i, j);
+   if (entry->src == src && entry->i == i && entry->j == j &&
+       entry->fetch == (func_pointer) fetch) {
+      cache->hits++;
+   }
+   else {
+      fetch(entry->data.f, src, i, j);
+      entry->src = src;
+      entry->fetch = (func_pointer) fetch;
+      entry->i = i;
+      entry->j = j;
+      cache->misses++;
+      cache->dirty = TRUE;
+   }
+
+   memcpy(dst, entry->data.f, sizeof entry->data.f);
+}
+
+
+void
+lp_build_format_cache_fetch_8unorm(struct lp_build_format_cache *cache,
+                                   void (*fetch)(uint8_t *dst,
+                                                 const uint8_t *src,
+                                                 unsigned i, unsigned j),
+                                   uint8_t *dst,
+                                   const uint8_t *src,
+                                   unsigned i, unsigned j)
+{
+   struct lp_build_format_cache_entry *entry;
+
+   if (!cache) {
+      fetch(dst, src, i, j);
+      return;
+   }
+
+   entry = cache_entry(cache, src, i, j);
+   if (entry->src == src && entry->i == i && entry->j == j &&
+       entry->fetch == (func_pointer) fetch) {
+      cache->hits++;
+   }
+   else {
+      fetch(entry->data.ub, src, i, j);
+      entry->src = src;
+      entry->fetch = (func_pointer) fetch;
+      entry->i = i;
+      entry->j = j;
+      cache->misses++;
+      cache->dirty = TRUE;
+   }
+
+   memcpy(dst, entry->data.ub, sizeof entry->data.ub);
+}
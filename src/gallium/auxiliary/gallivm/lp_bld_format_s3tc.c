@@ -0,0 +1,390 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * S3TC (DXT1/3/5) and RGTC block decoding.
+ *
+ * Each of the n pixels has its own block offset and sub-block coordinates,
+ * and all of them are decoded at once as <n x i32> vectors, with the same
+ * integer arithmetic as the util_format fetch functions.
+ */
+
+
+#include "util/u_format.h"
+#include "util/u_format_s3tc.h"
+
+#include "lp_bld_arit.h"
+#include "lp_bld_type.h"
+#include "lp_bld_const.h"
+#include "lp_bld_gather.h"
+#include "lp_bld_format.h"
+#include "lp_bld_init.h"
+#include "lp_bld_logic.h"
+
+
+struct block_decode
+{
+   struct gallivm_state *gallivm;
+   unsigned n;
+   LLVMValueRef base_ptr;
+   LLVMValueRef offset;
+   LLVMValueRef texel;  /**< 4 * j + i */
+
+   struct lp_build_context bld32;  /**< <n x u32> */
+   struct lp_build_context bld64;  /**< <n x u64> */
+};
+
+
+static LLVMValueRef
+const32(struct block_decode *dec, unsigned val)
+{
+   return lp_build_const_int_vec(dec->gallivm, dec->bld32.type, val);
+}
+
+
+/**
+ * Load 64 bits at the given byte offset in each pixel's block.
+ */
+static LLVMValueRef
+load_block64(struct block_decode *dec, unsigned byte_offset)
+{
+   LLVMValueRef offset = dec->offset;
+
+   if (byte_offset) {
+      offset = LLVMBuildAdd(dec->gallivm->builder, offset,
+                            const32(dec, byte_offset), "");
+   }
+
+   return lp_build_gather(dec->gallivm, dec->n, 64, 64,
+                          dec->base_ptr, offset, FALSE);
+}
+
+
+/**
+ * (val >> shift) & mask, with a 64 bit val and a 32 bit result.
+ */
+static LLVMValueRef
+extract_bits(struct block_decode *dec, LLVMValueRef val,
+             LLVMValueRef shift, unsigned mask)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+
+   shift = LLVMBuildZExt(builder, shift, dec->bld64.vec_type, "");
+   val = LLVMBuildLShr(builder, val, shift, "");
+   val = LLVMBuildTrunc(builder, val, dec->bld32.vec_type, "");
+   return LLVMBuildAnd(builder, val, const32(dec, mask), "");
+}
+
+
+/**
+ * 4 * texel + bias, for indexing bit fields.
+ */
+static LLVMValueRef
+texel_bit(struct block_decode *dec, unsigned bits, unsigned bias)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+   LLVMValueRef res;
+
+   res = LLVMBuildMul(builder, dec->texel, const32(dec, bits), "");
+   if (bias) {
+      res = LLVMBuildAdd(builder, res, const32(dec, bias), "");
+   }
+   return res;
+}
+
+
+/**
+ * Exact x / d for the small numerators that occur here, as
+ * (x * magic) >> 16.
+ */
+static LLVMValueRef
+div_small(struct block_decode *dec, LLVMValueRef x, unsigned magic)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+
+   x = LLVMBuildMul(builder, x, const32(dec, magic), "");
+   return LLVMBuildLShr(builder, x, const32(dec, 16), "");
+}
+
+#define DIV3 21846
+#define DIV5 13108
+#define DIV7 9363
+
+
+static LLVMValueRef
+select_eq(struct block_decode *dec, LLVMValueRef code, unsigned val,
+          LLVMValueRef a, LLVMValueRef b)
+{
+   LLVMValueRef mask = lp_build_cmp(&dec->bld32, PIPE_FUNC_EQUAL,
+                                    code, const32(dec, val));
+   return lp_build_select(&dec->bld32, mask, a, b);
+}
+
+
+/**
+ * Expand a 5 or 6 bit channel of a 565 color to 8 bits.
+ */
+static LLVMValueRef
+expand_565(struct block_decode *dec, LLVMValueRef color,
+           unsigned shift, unsigned bits)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+   LLVMValueRef val, hi, lo;
+
+   val = LLVMBuildLShr(builder, color, const32(dec, shift), "");
+   val = LLVMBuildAnd(builder, val, const32(dec, (1 << bits) - 1), "");
+   hi = LLVMBuildShl(builder, val, const32(dec, 8 - bits), "");
+   lo = LLVMBuildLShr(builder, val, const32(dec, 2 * bits - 8), "");
+   return LLVMBuildOr(builder, hi, lo, "");
+}
+
+
+/**
+ * Decode the color half of a DXT block.
+ *
+ * \param three_color  whether color0 <= color1 selects the 3 color mode
+ *                     (DXT1 only)
+ * \param transparent  returns the mask of pixels decoded as transparent
+ *                     black in the 3 color mode
+ */
+static void
+decode_color_block(struct block_decode *dec, LLVMValueRef block,
+                   boolean three_color, LLVMValueRef rgb[3],
+                   LLVMValueRef *transparent)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+   struct lp_build_context *bld = &dec->bld32;
+   static const unsigned shifts[3] = { 11, 5, 0 };
+   static const unsigned bits[3] = { 5, 6, 5 };
+   LLVMValueRef colors, color0, color1, code, four_color = NULL;
+   unsigned chan;
+
+   colors = LLVMBuildTrunc(builder, block, bld->vec_type, "");
+   color0 = LLVMBuildAnd(builder, colors, const32(dec, 0xffff), "");
+   color1 = LLVMBuildLShr(builder, colors, const32(dec, 16), "");
+   code = extract_bits(dec, block, texel_bit(dec, 2, 32), 0x3);
+
+   if (three_color) {
+      four_color = lp_build_cmp(bld, PIPE_FUNC_GREATER, color0, color1);
+   }
+
+   for (chan = 0; chan < 3; chan++) {
+      LLVMValueRef c0 = expand_565(dec, color0, shifts[chan], bits[chan]);
+      LLVMValueRef c1 = expand_565(dec, color1, shifts[chan], bits[chan]);
+      LLVMValueRef c2, c3;
+
+      /* (2 * c0 + c1) / 3 and (c0 + 2 * c1) / 3 */
+      c2 = LLVMBuildAdd(builder, LLVMBuildShl(builder, c0, const32(dec, 1), ""),
+                        c1, "");
+      c2 = div_small(dec, c2, DIV3);
+      c3 = LLVMBuildAdd(builder, LLVMBuildShl(builder, c1, const32(dec, 1), ""),
+                        c0, "");
+      c3 = div_small(dec, c3, DIV3);
+
+      if (three_color) {
+         /* (c0 + c1) / 2 and black */
+         LLVMValueRef half = LLVMBuildLShr(builder,
+                                           LLVMBuildAdd(builder, c0, c1, ""),
+                                           const32(dec, 1), "");
+         c2 = lp_build_select(bld, four_color, c2, half);
+         c3 = lp_build_select(bld, four_color, c3, bld->zero);
+      }
+
+      rgb[chan] = select_eq(dec, code, 0, c0,
+                  select_eq(dec, code, 1, c1,
+                  select_eq(dec, code, 2, c2, c3)));
+   }
+
+   if (transparent) {
+      LLVMValueRef three = lp_build_cmp(bld, PIPE_FUNC_EQUAL,
+                                        code, const32(dec, 3));
+      assert(three_color);
+      *transparent = LLVMBuildAnd(builder, three,
+                                  LLVMBuildNot(builder, four_color, ""), "");
+   }
+}
+
+
+/**
+ * Decode a DXT5 alpha / RGTC channel block of two 8 bit endpoints and
+ * 3 bit codes.
+ */
+static LLVMValueRef
+decode_channel_block(struct block_decode *dec, LLVMValueRef block)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+   struct lp_build_context *bld = &dec->bld32;
+   LLVMValueRef lo, a0, a1, code, weight, v8, v6, eight;
+
+   lo = LLVMBuildTrunc(builder, block, bld->vec_type, "");
+   a0 = LLVMBuildAnd(builder, lo, const32(dec, 0xff), "");
+   a1 = LLVMBuildAnd(builder, LLVMBuildLShr(builder, lo, const32(dec, 8), ""),
+                     const32(dec, 0xff), "");
+   code = extract_bits(dec, block, texel_bit(dec, 3, 16), 0x7);
+
+   /*
+    * For codes 2..7 (the rest is selected away below):
+    *   a0 > a1:  (a0 * (8 - code) + a1 * (code - 1)) / 7
+    *   else:     (a0 * (6 - code) + a1 * (code - 1)) / 5, codes 2..5
+    */
+   weight = LLVMBuildMul(builder, a1,
+                         LLVMBuildSub(builder, code, const32(dec, 1), ""), "");
+   v8 = LLVMBuildMul(builder, a0,
+                     LLVMBuildSub(builder, const32(dec, 8), code, ""), "");
+   v8 = div_small(dec, LLVMBuildAdd(builder, v8, weight, ""), DIV7);
+   v6 = LLVMBuildMul(builder, a0,
+                     LLVMBuildSub(builder, const32(dec, 6), code, ""), "");
+   v6 = div_small(dec, LLVMBuildAdd(builder, v6, weight, ""), DIV5);
+
+   v6 = select_eq(dec, code, 6, bld->zero,
+        select_eq(dec, code, 7, const32(dec, 0xff), v6));
+
+   eight = lp_build_cmp(bld, PIPE_FUNC_GREATER, a0, a1);
+
+   return select_eq(dec, code, 0, a0,
+          select_eq(dec, code, 1, a1,
+                    lp_build_select(bld, eight, v8, v6)));
+}
+
+
+/**
+ * Decode a DXT3 block's explicit 4 bit alpha.
+ */
+static LLVMValueRef
+decode_explicit_alpha(struct block_decode *dec, LLVMValueRef block)
+{
+   LLVMBuilderRef builder = dec->gallivm->builder;
+   LLVMValueRef alpha;
+
+   alpha = extract_bits(dec, block, texel_bit(dec, 4, 0), 0xf);
+   return LLVMBuildOr(builder, alpha,
+                      LLVMBuildShl(builder, alpha, const32(dec, 4), ""), "");
+}
+
+
+/**
+ * Whether lp_build_fetch_s3tc_rgba_aos() handles this format.
+ */
+boolean
+lp_build_format_s3tc_supported(const struct util_format_description *format_desc)
+{
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      /* sRGB needs the conversion to linear the fetch functions do */
+      return util_format_s3tc_enabled &&
+             format_desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB;
+   }
+
+   return format_desc->format == PIPE_FORMAT_RGTC1_UNORM ||
+          format_desc->format == PIPE_FORMAT_RGTC2_UNORM;
+}
+
+
+/**
+ * Fetch n pixels of a DXT1/3/5 or unsigned RGTC texture.
+ *
+ * \param offset  <n x i32> byte offsets of the pixels' blocks
+ * \param i, j  <n x i32> coordinates of the pixels within their blocks
+ * \return  a <4n x i8> vector with the pixels' RGBA values, as unorm8
+ */
+LLVMValueRef
+lp_build_fetch_s3tc_rgba_aos(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct block_decode dec;
+   struct lp_type type8;
+   LLVMValueRef rgba[4];
+   LLVMValueRef transparent;
+   LLVMValueRef res;
+   unsigned chan;
+
+   assert(lp_build_format_s3tc_supported(format_desc));
+
+   dec.gallivm = gallivm;
+   dec.n = n;
+   dec.base_ptr = base_ptr;
+   dec.offset = offset;
+   lp_build_context_init(&dec.bld32, gallivm, lp_type_uint_vec(32, 32 * n));
+   lp_build_context_init(&dec.bld64, gallivm, lp_type_uint_vec(64, 64 * n));
+
+   dec.texel = LLVMBuildShl(builder, j, const32(&dec, 2), "");
+   dec.texel = LLVMBuildAdd(builder, dec.texel, i, "");
+
+   rgba[3] = const32(&dec, 0xff);
+
+   switch (format_desc->format) {
+   case PIPE_FORMAT_DXT1_RGB:
+      decode_color_block(&dec, load_block64(&dec, 0), TRUE, rgba, NULL);
+      break;
+   case PIPE_FORMAT_DXT1_RGBA:
+      decode_color_block(&dec, load_block64(&dec, 0), TRUE, rgba, &transparent);
+      rgba[3] = lp_build_select(&dec.bld32, transparent,
+                                dec.bld32.zero, rgba[3]);
+      break;
+   case PIPE_FORMAT_DXT3_RGBA:
+      rgba[3] = decode_explicit_alpha(&dec, load_block64(&dec, 0));
+      decode_color_block(&dec, load_block64(&dec, 8), FALSE, rgba, NULL);
+      break;
+   case PIPE_FORMAT_DXT5_RGBA:
+      rgba[3] = decode_channel_block(&dec, load_block64(&dec, 0));
+      decode_color_block(&dec, load_block64(&dec, 8), FALSE, rgba, NULL);
+      break;
+   case PIPE_FORMAT_RGTC1_UNORM:
+      rgba[0] = decode_channel_block(&dec, load_block64(&dec, 0));
+      rgba[1] = dec.bld32.zero;
+      rgba[2] = dec.bld32.zero;
+      break;
+   case PIPE_FORMAT_RGTC2_UNORM:
+      rgba[0] = decode_channel_block(&dec, load_block64(&dec, 0));
+      rgba[1] = decode_channel_block(&dec, load_block64(&dec, 8));
+      rgba[2] = dec.bld32.zero;
+      break;
+   default:
+      assert(0);
+      return lp_build_zero(gallivm, lp_type_unorm(8, 32 * n));
+   }
+
+   /* Pack to RGBA8 in memory order */
+   res = rgba[0];
+   for (chan = 1; chan < 4; chan++) {
+#ifdef PIPE_ARCH_BIG_ENDIAN
+      res = LLVMBuildShl(builder, res, const32(&dec, 8), "");
+      res = LLVMBuildOr(builder, res, rgba[chan], "");
+#else
+      res = LLVMBuildOr(builder, res,
+                        LLVMBuildShl(builder, rgba[chan],
+                                     const32(&dec, 8 * chan), ""), "");
+#endif
+   }
+
+   type8 = lp_type_unorm(8, 32 * n);
+   return LLVMBuildBitCast(builder, res, lp_build_vec_type(gallivm, type8), "");
+}
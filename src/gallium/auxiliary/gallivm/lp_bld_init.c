@@ -28,6 +28,9 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "util/u_counter.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
@@ -117,6 +120,15 @@ enum LLVM_CodeGenOpt_Level {
 };
 
 
+/**
+ * JIT statistics.  Code may be compiled from several threads, so updates
+ * go through stats_mutex.
+ */
+pipe_static_mutex(stats_mutex);
+static struct gallivm_stats gallivm_stats[GALLIVM_OWNER_COUNT];
+static boolean code_size_stats = FALSE;
+
+
 #if HAVE_LLVM <= 0x0206
 /**
  * LLVM 2.6 permits only one ExecutionEngine to be created.  So use the
@@ -126,44 +138,61 @@ static struct gallivm_state *GlobalGallivm = NULL;
 #endif
 
 
+/**
+ * Pool of optimization pass managers.
+ *
+ * The passes don't depend on the module, so rather than building a function
+ * pass manager for every gallivm_state we keep module pass managers around
+ * and lend each to one compile at a time.  Code may be compiled from
+ * several threads, hence the mutex and the handful of entries.
+ */
+#define MAX_PASS_MANAGERS 4
+
+pipe_static_mutex(pass_manager_mutex);
+static LLVMPassManagerRef pass_managers[MAX_PASS_MANAGERS];
+static unsigned num_pass_managers = 0;
+
+
 /**
  * Create the LLVM (optimization) pass manager and install
  * relevant optimization passes.
- * \return  TRUE for success, FALSE for failure
+ * \return  the pass manager, or NULL on failure
  */
-static boolean
-create_pass_manager(struct gallivm_state *gallivm)
+static LLVMPassManagerRef
+create_pass_manager(LLVMTargetDataRef target)
 {
-   assert(!gallivm->passmgr);
-   assert(gallivm->target);
+   LLVMPassManagerRef passmgr;
 
-   gallivm->passmgr = LLVMCreateFunctionPassManager(gallivm->provider);
-   if (!gallivm->passmgr)
-      return FALSE;
+   assert(target);
 
-   LLVMAddTargetData(gallivm->target, gallivm->passmgr);
+   passmgr = LLVMCreatePassManager();
+   if (!passmgr)
+      return NULL;
+
+   /* This adds a copy of the target data */
+   LLVMAddTargetData(target, passmgr);
 
    if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) == 0) {
       /* These are the passes currently listed in llvm-c/Transforms/Scalar.h,
        * but there are more on SVN.
        * TODO: Add more passes.
        */
-      LLVMAddScalarReplAggregatesPass(gallivm->passmgr);
-      LLVMAddLICMPass(gallivm->passmgr);
-      LLVMAddCFGSimplificationPass(gallivm->passmgr);
-      LLVMAddReassociatePass(gallivm->passmgr);
+      LLVMAddScalarReplAggregatesPass(passmgr);
+      LLVMAddLICMPass(passmgr);
+      LLVMAddCFGSimplificationPass(passmgr);
+      LLVMAddReassociatePass(passmgr);
 
       if (HAVE_LLVM >= 0x207 && sizeof(void*) == 4) {
          /* For LLVM >= 2.7 and 32-bit build, use this order of passes to
           * avoid generating bad code.
           * Test with piglit glsl-vs-sqrt-zero test.
           */
-         LLVMAddConstantPropagationPass(gallivm->passmgr);
-         LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
+         LLVMAddConstantPropagationPass(passmgr);
+         LLVMAddPromoteMemoryToRegisterPass(passmgr);
       }
       else {
-         LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
-         LLVMAddConstantPropagationPass(gallivm->passmgr);
+         LLVMAddPromoteMemoryToRegisterPass(passmgr);
+         LLVMAddConstantPropagationPass(passmgr);
       }
 
       if (util_cpu_caps.has_sse4_1) {
@@ -171,18 +200,59 @@ create_pass_manager(struct gallivm_state *gallivm)
           * of fptosi and sitofp (necessary for trunc/floor/ceil/round
           * implementation) somehow becomes invalid code.
           */
-         LLVMAddInstructionCombiningPass(gallivm->passmgr);
+         LLVMAddInstructionCombiningPass(passmgr);
       }
-      LLVMAddGVNPass(gallivm->passmgr);
+      LLVMAddGVNPass(passmgr);
    }
    else {
       /* We need at least this pass to prevent the backends to fail in
        * unexpected ways.
        */
-      LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
+      LLVMAddPromoteMemoryToRegisterPass(passmgr);
    }
 
-   return TRUE;
+   return passmgr;
+}
+
+
+/**
+ * Take a pass manager from the pool, or create a new one.
+ */
+static LLVMPassManagerRef
+acquire_pass_manager(LLVMTargetDataRef target)
+{
+   LLVMPassManagerRef passmgr = NULL;
+
+   pipe_mutex_lock(pass_manager_mutex);
+   if (num_pass_managers) {
+      passmgr = pass_managers[--num_pass_managers];
+   }
+   pipe_mutex_unlock(pass_manager_mutex);
+
+   if (!passmgr) {
+      passmgr = create_pass_manager(target);
+   }
+
+   return passmgr;
+}
+
+
+/**
+ * Return a pass manager to the pool.
+ */
+static void
+release_pass_manager(LLVMPassManagerRef passmgr)
+{
+   pipe_mutex_lock(pass_manager_mutex);
+   if (num_pass_managers < MAX_PASS_MANAGERS) {
+      pass_managers[num_pass_managers++] = passmgr;
+      passmgr = NULL;
+   }
+   pipe_mutex_unlock(pass_manager_mutex);
+
+   if (passmgr) {
+      LLVMDisposePassManager(passmgr);
+   }
 }
 
 
@@ -206,6 +276,11 @@ free_gallivm_state(struct gallivm_state *gallivm)
       LLVMDisposePassManager(gallivm->passmgr);
    }
 
+   /* The memory manager goes with the engine */
+   util_counter_mem_free(UTIL_COUNTER_MEM_JIT, gallivm->jit_memory);
+   gallivm->jit_memory = 0;
+   gallivm->memory_manager = NULL;
+
 #if 0
    /* XXX this seems to crash with all versions of LLVM */
    if (gallivm->provider)
@@ -265,6 +340,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
 
 #if HAVE_LLVM >= 0x0301
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
+                                                    &gallivm->memory_manager,
                                                     gallivm->module,
                                                     (unsigned) optlevel,
                                                     USE_MCJIT,
@@ -334,7 +410,7 @@ static LLVMContextRef gallivm_context = NULL;
  * \return  TRUE for success, FALSE for failure
  */
 static boolean
-init_gallivm_state(struct gallivm_state *gallivm)
+init_gallivm_state(struct gallivm_state *gallivm, LLVMContextRef context)
 {
    assert(!gallivm->context);
    assert(!gallivm->module);
@@ -342,10 +418,15 @@ init_gallivm_state(struct gallivm_state *gallivm)
 
    lp_build_init();
 
-   if (!gallivm_context) {
-      gallivm_context = LLVMContextCreate();
+   if (context) {
+      gallivm->context = context;
+   }
+   else {
+      if (!gallivm_context) {
+         gallivm_context = LLVMContextCreate();
+      }
+      gallivm->context = gallivm_context;
    }
-   gallivm->context = gallivm_context;
    if (!gallivm->context)
       goto fail;
 
@@ -408,9 +489,6 @@ init_gallivm_state(struct gallivm_state *gallivm)
    }
 #endif
 
-   if (!create_pass_manager(gallivm))
-      goto fail;
-
    return TRUE;
 
 fail:
@@ -535,7 +613,7 @@ gallivm_create(void)
 
    gallivm = CALLOC_STRUCT(gallivm_state);
    if (gallivm) {
-      if (!init_gallivm_state(gallivm)) {
+      if (!init_gallivm_state(gallivm, NULL)) {
          FREE(gallivm);
          gallivm = NULL;
       }
@@ -549,6 +627,30 @@ gallivm_create(void)
 }
 
 
+/**
+ * Create a new gallivm_state object in the given LLVM context rather than
+ * the shared one, e.g. to build code on another thread.  The caller keeps
+ * ownership of the context, and must not use it from two threads at once.
+ */
+struct gallivm_state *
+gallivm_create_in_context(LLVMContextRef context)
+{
+   struct gallivm_state *gallivm;
+
+   assert(context);
+
+   gallivm = CALLOC_STRUCT(gallivm_state);
+   if (gallivm) {
+      if (!init_gallivm_state(gallivm, context)) {
+         FREE(gallivm);
+         gallivm = NULL;
+      }
+   }
+
+   return gallivm;
+}
+
+
 /**
  * Destroy a gallivm_state object.
  */
@@ -566,33 +668,8 @@ gallivm_destroy(struct gallivm_state *gallivm)
 
 
 /**
- * Validate and optimze a function.
- */
-static void
-gallivm_optimize_function(struct gallivm_state *gallivm,
-                          LLVMValueRef func)
-{
-   if (0) {
-      debug_printf("optimizing %s...\n", LLVMGetValueName(func));
-   }
-
-   assert(gallivm->passmgr);
-
-   /* Apply optimizations to LLVM IR */
-   LLVMRunFunctionPassManager(gallivm->passmgr, func);
-
-   if (0) {
-      if (gallivm_debug & GALLIVM_DEBUG_IR) {
-         /* Print the LLVM IR to stderr */
-         lp_debug_dump_value(func);
-         debug_printf("\n");
-      }
-   }
-}
-
-
-/**
- * Validate a function.
+ * Validate a function.  It gets optimized along with the rest of the
+ * module in gallivm_compile_module().
  */
 void
 gallivm_verify_function(struct gallivm_state *gallivm,
@@ -606,24 +683,89 @@ gallivm_verify_function(struct gallivm_state *gallivm,
       return;
    }
 #endif
+}
+
+
+/**
+ * Optimize all functions of the module.
+ * \return  the time it took, in microseconds
+ */
+static int64_t
+gallivm_optimize_module(struct gallivm_state *gallivm)
+{
+   LLVMPassManagerRef passmgr;
+   int64_t start = os_time_get();
 
-   gallivm_optimize_function(gallivm, func);
+   assert(gallivm->target);
+
+   passmgr = acquire_pass_manager(gallivm->target);
+   if (passmgr) {
+      /* Apply optimizations to LLVM IR */
+      LLVMRunPassManager(passmgr, gallivm->module);
+      release_pass_manager(passmgr);
+   }
 
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      LLVMValueRef func;
+
       /* Print the LLVM IR to stderr */
-      lp_debug_dump_value(func);
-      debug_printf("\n");
+      for (func = LLVMGetFirstFunction(gallivm->module); func;
+           func = LLVMGetNextFunction(func)) {
+         if (!LLVMIsDeclaration(func)) {
+            lp_debug_dump_value(func);
+            debug_printf("\n");
+         }
+      }
+   }
+
+   return os_time_get() - start;
+}
+
+
+/**
+ * Count the LLVM IR instructions of all functions in the module.
+ */
+static unsigned
+count_instructions(LLVMModuleRef module)
+{
+   LLVMValueRef func;
+   unsigned count = 0;
+
+   for (func = LLVMGetFirstFunction(module); func;
+        func = LLVMGetNextFunction(func)) {
+      LLVMBasicBlockRef block;
+
+      for (block = LLVMGetFirstBasicBlock(func); block;
+           block = LLVMGetNextBasicBlock(block)) {
+         LLVMValueRef inst;
+
+         for (inst = LLVMGetFirstInstruction(block); inst;
+              inst = LLVMGetNextInstruction(inst)) {
+            count++;
+         }
+      }
    }
+
+   return count;
 }
 
 
 void
 gallivm_compile_module(struct gallivm_state *gallivm)
 {
+   unsigned num_instructions;
+   int64_t optimize_time;
+   int64_t start;
+
 #if HAVE_LLVM > 0x206
    assert(!gallivm->compiled);
 #endif
 
+   optimize_time = gallivm_optimize_module(gallivm);
+
+   num_instructions = count_instructions(gallivm->module);
+   start = os_time_get();
+
    /* Dump byte code to a file */
    if (0) {
       LLVMWriteBitcodeToFile(gallivm->module, "llvmpipe.bc");
@@ -640,6 +782,16 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    assert(gallivm->engine);
 
    ++gallivm->compiled;
+
+   pipe_mutex_lock(stats_mutex);
+   gallivm_stats[gallivm->owner].num_compiles++;
+   gallivm_stats[gallivm->owner].num_instructions += num_instructions;
+   gallivm_stats[gallivm->owner].optimize_time += optimize_time;
+   gallivm_stats[gallivm->owner].codegen_time += os_time_get() - start;
+   pipe_mutex_unlock(stats_mutex);
+
+   util_counter_add(UTIL_COUNTER_JIT_USECS,
+                    (int32_t) (optimize_time + os_time_get() - start));
 }
 
 
@@ -650,14 +802,34 @@ gallivm_jit_function(struct gallivm_state *gallivm,
 {
    void *code;
    func_pointer jit_func;
+   uint64_t code_size = 0;
+   int64_t start;
 
    assert(gallivm->compiled);
    assert(gallivm->engine);
 
+   /* Machine code is generated lazily, on the first lookup */
+   start = os_time_get();
    code = LLVMGetPointerToGlobal(gallivm->engine, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
+   if (code_size_stats && code) {
+      code_size = lp_function_code_size(code);
+   }
+
+   pipe_mutex_lock(stats_mutex);
+   gallivm_stats[gallivm->owner].codegen_time += os_time_get() - start;
+   gallivm_stats[gallivm->owner].code_size += code_size;
+   pipe_mutex_unlock(stats_mutex);
+
+   if (gallivm->memory_manager) {
+      size_t jit_memory = lp_jit_memory_manager_size(gallivm->memory_manager);
+      util_counter_mem_alloc(UTIL_COUNTER_MEM_JIT,
+                             jit_memory - gallivm->jit_memory);
+      gallivm->jit_memory = jit_memory;
+   }
+
    if (gallivm_debug & GALLIVM_DEBUG_ASM) {
       lp_disassemble(func, code);
    }
@@ -689,3 +861,41 @@ gallivm_free_function(struct gallivm_state *gallivm,
    LLVMDeleteFunction(func);
 #endif
 }
+
+
+/**
+ * Return the JIT statistics accumulated so far for the given owner, or for
+ * all owners with GALLIVM_OWNER_COUNT.
+ */
+void
+gallivm_get_stats(enum gallivm_owner owner, struct gallivm_stats *stats)
+{
+   unsigned i;
+
+   pipe_mutex_lock(stats_mutex);
+   if (owner < GALLIVM_OWNER_COUNT) {
+      *stats = gallivm_stats[owner];
+   }
+   else {
+      memset(stats, 0, sizeof *stats);
+      for (i = 0; i < GALLIVM_OWNER_COUNT; i++) {
+         stats->num_compiles += gallivm_stats[i].num_compiles;
+         stats->num_instructions += gallivm_stats[i].num_instructions;
+         stats->optimize_time += gallivm_stats[i].optimize_time;
+         stats->codegen_time += gallivm_stats[i].codegen_time;
+         stats->code_size += gallivm_stats[i].code_size;
+      }
+   }
+   pipe_mutex_unlock(stats_mutex);
+}
+
+
+/**
+ * Start measuring the size of generated code.  This walks the machine code
+ * with the disassembler, so it's only done once somebody asks for it.
+ */
+void
+gallivm_enable_code_size_stats(void)
+{
+   code_size_stats = TRUE;
+}
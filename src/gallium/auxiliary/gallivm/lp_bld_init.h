@@ -36,6 +36,33 @@
 #include <llvm-c/ExecutionEngine.h>
 
 
+/**
+ * Who a gallivm_state generates code for, to break down the JIT statistics.
+ */
+enum gallivm_owner
+{
+   GALLIVM_OWNER_OTHER = 0,
+   GALLIVM_OWNER_LP_FS,
+   GALLIVM_OWNER_LP_SETUP,
+   GALLIVM_OWNER_DRAW_VS,
+   GALLIVM_OWNER_DRAW_GS,
+   GALLIVM_OWNER_COUNT
+};
+
+
+/**
+ * Cumulative JIT statistics, see gallivm_get_stats().
+ */
+struct gallivm_stats
+{
+   uint64_t num_compiles;      /**< modules compiled */
+   uint64_t num_instructions;  /**< LLVM IR instructions after optimization */
+   uint64_t optimize_time;     /**< in microseconds */
+   uint64_t codegen_time;      /**< in microseconds */
+   uint64_t code_size;         /**< in bytes, see gallivm_enable_code_size_stats() */
+};
+
+
 struct gallivm_state
 {
    LLVMModuleRef module;
@@ -46,6 +73,9 @@ struct gallivm_state
    LLVMContextRef context;
    LLVMBuilderRef builder;
    unsigned compiled;
+   enum gallivm_owner owner;
+   void *memory_manager;   /**< the engine's, NULL before LLVM 3.1 */
+   size_t jit_memory;      /**< of memory_manager, counted in mem-jit */
 };
 
 
@@ -56,6 +86,9 @@ lp_build_init(void);
 struct gallivm_state *
 gallivm_create(void);
 
+struct gallivm_state *
+gallivm_create_in_context(LLVMContextRef context);
+
 void
 gallivm_destroy(struct gallivm_state *gallivm);
 
@@ -76,6 +109,12 @@ gallivm_free_function(struct gallivm_state *gallivm,
                       LLVMValueRef func,
                       const void * code);
 
+void
+gallivm_get_stats(enum gallivm_owner owner, struct gallivm_stats *stats);
+
+void
+gallivm_enable_code_size_stats(void);
+
 void
 lp_set_load_alignment(LLVMValueRef Inst,
                        unsigned Align);
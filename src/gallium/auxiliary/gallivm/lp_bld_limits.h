@@ -113,6 +113,8 @@ gallivm_get_shader_param(enum pipe_shader_cap param)
    case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
       return PIPE_MAX_SAMPLERS;
    case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
+   case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
+   case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
       return 1;
    default:
       return 0;
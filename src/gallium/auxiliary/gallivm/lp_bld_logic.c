@@ -535,7 +535,9 @@ lp_build_select(struct lp_build_context *bld,
    else if (((util_cpu_caps.has_sse4_1 &&
               type.width * type.length == 128) ||
              (util_cpu_caps.has_avx &&
-              type.width * type.length == 256 && type.width >= 32)) &&
+              type.width * type.length == 256 && type.width >= 32) ||
+             (util_cpu_caps.has_avx2 &&
+              type.width * type.length == 256)) &&
             !LLVMIsConstant(a) &&
             !LLVMIsConstant(b) &&
             !LLVMIsConstant(mask)) {
@@ -545,10 +547,14 @@ lp_build_select(struct lp_build_context *bld,
 
       /*
        *  There's only float blend in AVX but can just cast i32/i64
-       *  to float.
+       *  to float.  AVX2 adds the byte blend for narrower types.
        */
       if (type.width * type.length == 256) {
-         if (type.width == 64) {
+         if (type.width < 32) {
+            intrinsic = "llvm.x86.avx2.pblendvb";
+            arg_type = LLVMVectorType(LLVMInt8TypeInContext(lc), 32);
+         }
+         else if (type.width == 64) {
            intrinsic = "llvm.x86.avx.blendv.pd.256";
            arg_type = LLVMVectorType(LLVMDoubleTypeInContext(lc), 4);
          }
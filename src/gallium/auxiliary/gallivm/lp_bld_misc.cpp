@@ -73,9 +73,21 @@
 #include <llvm/Support/CBindingWrapping.h>
 #endif
 
+#if HAVE_LLVM >= 0x0304
+#include <map>
+#include <string>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#endif
+
 #include "pipe/p_config.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_disk_cache.h"
+#include "util/u_memory.h"
+#include "os/os_thread.h"
 
 #include "lp_bld_misc.h"
 
@@ -241,12 +253,141 @@ lp_set_store_alignment(LLVMValueRef Inst,
 }
 
 
+#if HAVE_LLVM >= 0x0304
+
+namespace {
+
+/**
+ * Persistent cache of MCJIT object files, stored with u_disk_cache.
+ *
+ * The key is the module's bitcode, taken before code generation, plus
+ * everything outside the module that changes the generated code.  Any
+ * difference in the IR, including addresses baked into it, is a miss
+ * rather than a stale hit.  MCJIT relocates the cached object when it is
+ * loaded, just like a freshly compiled one.
+ */
+class lp_object_cache : public llvm::ObjectCache {
+public:
+   lp_object_cache(struct u_disk_cache *disk_cache)
+      : disk_cache(disk_cache)
+   {
+      pipe_mutex_init(mutex);
+   }
+
+   virtual void
+   notifyObjectCompiled(const llvm::Module *M, const llvm::MemoryBuffer *Obj)
+   {
+      std::string key;
+
+      /* The module may have been changed by code generation, so use the
+       * key computed by getObject().
+       */
+      pipe_mutex_lock(mutex);
+      std::map<const llvm::Module *, std::string>::iterator it =
+         pending.find(M);
+      if (it != pending.end()) {
+         key.swap(it->second);
+         pending.erase(it);
+      }
+      pipe_mutex_unlock(mutex);
+
+      if (!key.empty())
+         u_disk_cache_put(disk_cache, key.data(), key.size(),
+                          Obj->getBufferStart(), Obj->getBufferSize());
+   }
+
+   virtual llvm::MemoryBuffer *
+   getObject(const llvm::Module *M)
+   {
+      std::string key;
+      get_key(M, key);
+
+      unsigned size;
+      void *data = u_disk_cache_get(disk_cache, key.data(), key.size(), &size);
+      if (data) {
+         llvm::MemoryBuffer *buffer = llvm::MemoryBuffer::getMemBufferCopy(
+            llvm::StringRef((const char *) data, size),
+            M->getModuleIdentifier());
+         FREE(data);
+         return buffer;
+      }
+
+      pipe_mutex_lock(mutex);
+      pending[M].swap(key);
+      pipe_mutex_unlock(mutex);
+      return NULL;
+   }
+
+private:
+   static void
+   get_key(const llvm::Module *M, std::string &key)
+   {
+      struct {
+         char magic[8];
+         unsigned llvm_version;
+         unsigned debug;
+         struct util_cpu_caps caps;
+      } header;
+
+      memset(&header, 0, sizeof header);
+      memcpy(header.magic, "gallivm", 8);
+      header.llvm_version = HAVE_LLVM;
+#if defined(DEBUG) || defined(PROFILE)
+      header.debug = 1;
+#endif
+      header.caps = util_cpu_caps;
+      header.caps.nr_cpus = 0;
+
+      key.assign((const char *) &header, sizeof header);
+
+      llvm::raw_string_ostream stream(key);
+      llvm::WriteBitcodeToFile(M, stream);
+      stream.flush();
+   }
+
+   struct u_disk_cache *disk_cache;
+   pipe_mutex mutex;
+   std::map<const llvm::Module *, std::string> pending;
+};
+
+}
+
+
+pipe_static_mutex(object_cache_mutex);
+
+
+/**
+ * The object cache, or NULL if MESA_SHADER_CACHE_DIR isn't set.  Like the
+ * LLVM context it is never freed.
+ */
+static llvm::ObjectCache *
+lp_get_object_cache(void)
+{
+   static boolean initialized = FALSE;
+   static llvm::ObjectCache *cache = NULL;
+
+   pipe_mutex_lock(object_cache_mutex);
+   if (!initialized) {
+      struct u_disk_cache *disk_cache = u_disk_cache_create("gallivm");
+      if (disk_cache)
+         cache = new lp_object_cache(disk_cache);
+      initialized = TRUE;
+   }
+   pipe_mutex_unlock(object_cache_mutex);
+
+   return cache;
+}
+
+#endif /* HAVE_LLVM >= 0x0304 */
+
+
 #if HAVE_LLVM >= 0x301
 
 /**
  * Same as LLVMCreateJITCompilerForModule, but:
  * - allows using MCJIT and enabling AVX feature where available.
  * - set target options
+ * - returns the JIT memory manager, for lp_jit_memory_manager_size()
  *
  * See also:
  * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
@@ -256,6 +397,7 @@ lp_set_store_alignment(LLVMValueRef Inst,
 extern "C"
 LLVMBool
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        void **OutMemoryManager,
                                         LLVMModuleRef M,
                                         unsigned OptLevel,
                                         int useMCJIT,
@@ -310,9 +452,15 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       if (util_cpu_caps.has_f16c) {
          MAttrs.push_back("+f16c");
       }
+#if HAVE_LLVM >= 0x0304
+      if (util_cpu_caps.has_avx2) {
+         MAttrs.push_back("+avx2");
+      }
+#endif
       builder.setMAttrs(MAttrs);
    }
-   builder.setJITMemoryManager(JITMemoryManager::CreateDefaultMemManager());
+   JITMemoryManager *MM = JITMemoryManager::CreateDefaultMemManager();
+   builder.setJITMemoryManager(MM);
 
    ExecutionEngine *JIT;
 #if 0
@@ -327,11 +475,40 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT = builder.create(builder.selectTarget(TT, MArch, MCPU, MAttrs));
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0304
+      /* The legacy JIT emits code straight into memory it owns, so only
+       * MCJIT's relocatable objects can be cached.
+       */
+      if (useMCJIT && OptLevel == CodeGenOpt::Default) {
+         llvm::ObjectCache *cache = lp_get_object_cache();
+         if (cache)
+            JIT->setObjectCache(cache);
+      }
+#endif
       *OutJIT = wrap(JIT);
+      *OutMemoryManager = MM;
       return 0;
    }
    *OutError = strdup(Error.c_str());
    return 1;
 }
 
+
+/**
+ * Memory a JIT memory manager holds for code, data and stubs.  It comes in
+ * slabs which only grow, so this is what the engine holds rather than the
+ * size of the code still in use.  Cheap enough to call after each
+ * compilation, unlike lp_function_code_size().
+ */
+extern "C"
+size_t
+lp_jit_memory_manager_size(void *memory_manager)
+{
+   llvm::JITMemoryManager *MM = (llvm::JITMemoryManager *) memory_manager;
+
+   return MM->GetNumCodeSlabs() * MM->GetDefaultCodeSlabSize() +
+          MM->GetNumDataSlabs() * MM->GetDefaultDataSlabSize() +
+          MM->GetNumStubSlabs() * MM->GetDefaultStubSlabSize();
+}
+
 #endif /* HAVE_LLVM >= 0x301 */
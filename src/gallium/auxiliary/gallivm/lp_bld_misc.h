@@ -54,11 +54,15 @@ lp_build_load_volatile(LLVMBuilderRef B, LLVMValueRef PointerVal,
 
 extern int
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        void **OutMemoryManager,
                                         LLVMModuleRef M,
                                         unsigned OptLevel,
                                         int useMCJIT,
                                         char **OutError);
 
+extern size_t
+lp_jit_memory_manager_size(void *memory_manager);
+
 
 #ifdef __cplusplus
 }
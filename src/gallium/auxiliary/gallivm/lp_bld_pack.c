@@ -509,6 +509,37 @@ lp_build_pack2(struct gallivm_state *gallivm,
          break;
       /* default uses generic shuffle below */
       }
+      if (intrinsic && util_cpu_caps.has_avx2 &&
+          src_type.width * src_type.length == 256) {
+         /*
+          * The 256bit AVX2 packs work on each 128bit lane separately, giving
+          * lo0 hi0 lo1 hi1 in 64bit quarters, so swap the middle ones.
+          */
+         LLVMTypeRef intr_vec_type = lp_build_vec_type(gallivm, intr_type);
+         struct lp_type quad_type = lp_type_uint_vec(64, 256);
+         LLVMValueRef shuffles[4];
+
+         if (src_type.width == 32) {
+            intrinsic = dst_type.sign ? "llvm.x86.avx2.packssdw" :
+                                        "llvm.x86.avx2.packusdw";
+         }
+         else {
+            intrinsic = dst_type.sign ? "llvm.x86.avx2.packsswb" :
+                                        "llvm.x86.avx2.packuswb";
+         }
+
+         res = lp_build_intrinsic_binary(builder, intrinsic, intr_vec_type, lo, hi);
+
+         shuffles[0] = lp_build_const_int32(gallivm, 0);
+         shuffles[1] = lp_build_const_int32(gallivm, 2);
+         shuffles[2] = lp_build_const_int32(gallivm, 1);
+         shuffles[3] = lp_build_const_int32(gallivm, 3);
+         res = LLVMBuildBitCast(builder, res,
+                                lp_build_vec_type(gallivm, quad_type), "");
+         res = LLVMBuildShuffleVector(builder, res, res,
+                                      LLVMConstVector(shuffles, 4), "");
+         return LLVMBuildBitCast(builder, res, dst_vec_type, "");
+      }
       if (intrinsic) {
          if (src_type.width * src_type.length == 128) {
             LLVMTypeRef intr_vec_type = lp_build_vec_type(gallivm, intr_type);
@@ -198,6 +198,71 @@ lp_sampler_static_sampler_state(struct lp_static_sampler_state *state,
 }
 
 
+/**
+ * Choose the code path for filtered sampling with the given static state.
+ *
+ * Textures with a single mip level sampled with the same min and mag
+ * filter need neither a lod nor a mip level, so level 0 is used directly.
+ * 8-bit unorm formats with repeat or clamp-to-edge wrapping are filtered in
+ * fixed point.  lp_build_sample_soa() may still take the general path when
+ * the shader supplies per-pixel lods with differing min and mag filters.
+ */
+enum lp_sampler_path
+lp_sampler_static_path(const struct lp_static_texture_state *texture,
+                       const struct lp_static_sampler_state *sampler)
+{
+   const struct util_format_description *format_desc =
+      util_format_description(texture->format);
+   const unsigned dims = texture_dims(texture->target);
+   boolean one_level = texture->level_zero_only &&
+                       sampler->min_img_filter == sampler->mag_img_filter;
+   boolean aos;
+
+   if (!format_desc) {
+      return LP_SAMPLER_PATH_GENERAL;
+   }
+
+   aos = util_format_fits_8unorm(format_desc) &&
+         sampler->compare_mode == PIPE_TEX_COMPARE_NONE;
+
+   /* cube maps are always sampled with clamp-to-edge */
+   if (texture->target != PIPE_TEXTURE_CUBE &&
+       texture->target != PIPE_TEXTURE_CUBE_ARRAY) {
+      aos &= lp_is_simple_wrap_mode(sampler->wrap_s);
+      if (dims > 1) {
+         aos &= lp_is_simple_wrap_mode(sampler->wrap_t);
+         if (dims > 2) {
+            aos &= lp_is_simple_wrap_mode(sampler->wrap_r);
+         }
+      }
+   }
+
+   if (aos) {
+      return one_level ? LP_SAMPLER_PATH_AOS_ONE_LEVEL : LP_SAMPLER_PATH_AOS;
+   }
+   return one_level ? LP_SAMPLER_PATH_GENERAL_ONE_LEVEL : LP_SAMPLER_PATH_GENERAL;
+}
+
+
+const char *
+lp_sampler_path_name(enum lp_sampler_path path)
+{
+   switch (path) {
+   case LP_SAMPLER_PATH_GENERAL:
+      return "general";
+   case LP_SAMPLER_PATH_GENERAL_ONE_LEVEL:
+      return "general_one_level";
+   case LP_SAMPLER_PATH_AOS:
+      return "aos";
+   case LP_SAMPLER_PATH_AOS_ONE_LEVEL:
+      return "aos_one_level";
+   default:
+      assert(0);
+      return "?";
+   }
+}
+
+
 /**
  * Generate code to compute coordinate gradient (rho).
  * \param derivs  partial derivatives of (s, t, r, q) with respect to X and Y
@@ -1846,16 +1911,101 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Compute the partial offset of a pixel block along an axis of a tiled
+ * texture (see LP_TEX_TILE_ORDER).
+ *
+ * The offset is (block / LP_TEX_TILE_SIZE) * tile_stride +
+ * (block % LP_TEX_TILE_SIZE) * stride, for the pixel block containing
+ * coord.  If tile_stride is NULL the axis isn't tiled and this is the
+ * same as lp_build_sample_partial_offset().
+ *
+ * @param stride       number of bytes between successive blocks of a tile
+ * @param tile_stride  number of bytes between successive tiles
+ */
+void
+lp_build_sample_partial_offset_tiled(struct lp_build_context *bld,
+                                     unsigned block_length,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef stride,
+                                     LLVMValueRef tile_stride,
+                                     LLVMValueRef *out_offset,
+                                     LLVMValueRef *out_subcoord)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef block, tile, offset;
+
+   if (!tile_stride) {
+      lp_build_sample_partial_offset(bld, block_length, coord, stride,
+                                     out_offset, out_subcoord);
+      return;
+   }
+
+   /* the block index, and the sub-block coordinate */
+   lp_build_sample_partial_offset(bld, block_length, coord, bld->one,
+                                  &block, out_subcoord);
+
+   tile = LLVMBuildLShr(builder, block,
+                        lp_build_const_int_vec(bld->gallivm, bld->type,
+                                               LP_TEX_TILE_ORDER), "");
+   block = LLVMBuildAnd(builder, block,
+                        lp_build_const_int_vec(bld->gallivm, bld->type,
+                                               LP_TEX_TILE_SIZE - 1), "");
+
+   offset = lp_build_mul(bld, tile, tile_stride);
+   *out_offset = lp_build_add(bld, offset, lp_build_mul(bld, block, stride));
+}
+
+
+/**
+ * Get the strides to pass to lp_build_sample_partial_offset_tiled() for
+ * the x and y axes of a texture with the given row stride.  The tile
+ * strides are NULL unless the texture is tiled.
+ */
+void
+lp_build_sample_strides(struct lp_build_context *bld,
+                        const struct util_format_description *format_desc,
+                        boolean tiled,
+                        LLVMValueRef row_stride,
+                        LLVMValueRef *x_stride,
+                        LLVMValueRef *x_tile_stride,
+                        LLVMValueRef *y_stride,
+                        LLVMValueRef *y_tile_stride)
+{
+   const unsigned block_size = format_desc->block.bits / 8;
+
+   *x_stride = lp_build_const_int_vec(bld->gallivm, bld->type, block_size);
+
+   if (tiled) {
+      *x_tile_stride = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                              block_size *
+                                              LP_TEX_TILE_SIZE *
+                                              LP_TEX_TILE_SIZE);
+      *y_stride = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                         block_size * LP_TEX_TILE_SIZE);
+      *y_tile_stride = row_stride;
+   }
+   else {
+      *x_tile_stride = NULL;
+      *y_stride = row_stride;
+      *y_tile_stride = NULL;
+   }
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
  * x, y, z, y_stride, z_stride are vectors, and they refer to pixels.
+ * If tiled, the texture has the LP_TEX_TILE_ORDER layout and y_stride
+ * is the stride of a row of tiles.
  *
  * Returns the relative offset and i,j sub-block coordinates
  */
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -1865,23 +2015,25 @@ lp_build_sample_offset(struct lp_build_context *bld,
                        LLVMValueRef *out_i,
                        LLVMValueRef *out_j)
 {
-   LLVMValueRef x_stride;
+   LLVMValueRef x_stride, x_tile_stride, y_tile_stride;
    LLVMValueRef offset;
 
-   x_stride = lp_build_const_vec(bld->gallivm, bld->type,
-                                 format_desc->block.bits/8);
+   lp_build_sample_strides(bld, format_desc, tiled && y && y_stride,
+                           y_stride,
+                           &x_stride, &x_tile_stride,
+                           &y_stride, &y_tile_stride);
 
-   lp_build_sample_partial_offset(bld,
-                                  format_desc->block.width,
-                                  x, x_stride,
-                                  &offset, out_i);
+   lp_build_sample_partial_offset_tiled(bld,
+                                        format_desc->block.width,
+                                        x, x_stride, x_tile_stride,
+                                        &offset, out_i);
 
    if (y && y_stride) {
       LLVMValueRef y_offset;
-      lp_build_sample_partial_offset(bld,
-                                     format_desc->block.height,
-                                     y, y_stride,
-                                     &y_offset, out_j);
+      lp_build_sample_partial_offset_tiled(bld,
+                                           format_desc->block.height,
+                                           y, y_stride, y_tile_stride,
+                                           &y_offset, out_j);
       offset = lp_build_add(bld, offset, y_offset);
    }
    else {
@@ -68,6 +68,19 @@ enum lp_sampler_lod_property {
 };
 
 
+/**
+ * Tiled texture layout.
+ *
+ * The images of a texture with lp_static_texture_state::tiled set are
+ * stored as tiles of LP_TEX_TILE_SIZE x LP_TEX_TILE_SIZE pixel blocks.
+ * The blocks of a tile and the tiles of an image are both in row-major
+ * order, and the row stride is the size of a whole row of tiles.  With
+ * 32bpp texels a tile is a 64 byte cache line.
+ */
+#define LP_TEX_TILE_ORDER 2
+#define LP_TEX_TILE_SIZE  (1 << LP_TEX_TILE_ORDER)
+
+
 /**
  * Texture static state.
  *
@@ -89,6 +102,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< LP_TEX_TILE_ORDER layout, set by the driver */
 };
 
 
@@ -122,6 +136,19 @@ struct lp_static_sampler_state
 };
 
 
+/**
+ * Code paths of lp_build_sample_soa() for filtered sampling, from the
+ * general one to the most specialized, see lp_sampler_static_path().
+ */
+enum lp_sampler_path
+{
+   LP_SAMPLER_PATH_GENERAL = 0,        /**< floating point filtering */
+   LP_SAMPLER_PATH_GENERAL_ONE_LEVEL,  /**< same, without lod or mip level */
+   LP_SAMPLER_PATH_AOS,                /**< 8-bit fixed point filtering */
+   LP_SAMPLER_PATH_AOS_ONE_LEVEL       /**< same, without lod or mip level */
+};
+
+
 /**
  * Sampler dynamic state.
  *
@@ -211,6 +238,14 @@ struct lp_sampler_dynamic_state
    LLVMValueRef
    (*border_color)(const struct lp_sampler_dynamic_state *state,
                    struct gallivm_state *gallivm, unsigned sampler_unit);
+
+   /**
+    * Obtain pointer to the texel cache (returns ptr to
+    * struct lp_build_format_cache), optional
+    */
+   LLVMValueRef
+   (*cache_ptr)(const struct lp_sampler_dynamic_state *state,
+                struct gallivm_state *gallivm, unsigned unit);
 };
 
 
@@ -299,6 +334,7 @@ struct lp_build_sample_context
    LLVMValueRef row_stride_array;
    LLVMValueRef img_stride_array;
    LLVMValueRef base_ptr;
+   LLVMValueRef cache;
    LLVMValueRef mip_offsets;
 
    /** Integer vector with texture width, height, depth */
@@ -387,6 +423,14 @@ lp_sampler_static_texture_state(struct lp_static_texture_state *state,
                                 const struct pipe_sampler_view *view);
 
 
+enum lp_sampler_path
+lp_sampler_static_path(const struct lp_static_texture_state *texture,
+                       const struct lp_static_sampler_state *sampler);
+
+const char *
+lp_sampler_path_name(enum lp_sampler_path path);
+
+
 void
 lp_build_lod_selector(struct lp_build_sample_context *bld,
                       unsigned texture_index,
@@ -472,9 +516,31 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+void
+lp_build_sample_partial_offset_tiled(struct lp_build_context *bld,
+                                     unsigned block_length,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef stride,
+                                     LLVMValueRef tile_stride,
+                                     LLVMValueRef *out_offset,
+                                     LLVMValueRef *out_i);
+
+
+void
+lp_build_sample_strides(struct lp_build_context *bld,
+                        const struct util_format_description *format_desc,
+                        boolean tiled,
+                        LLVMValueRef row_stride,
+                        LLVMValueRef *x_stride,
+                        LLVMValueRef *x_tile_stride,
+                        LLVMValueRef *y_stride,
+                        LLVMValueRef *y_tile_stride);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
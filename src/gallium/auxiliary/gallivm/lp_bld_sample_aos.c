@@ -68,6 +68,7 @@
  * \param coord_f  the incoming texcoord (s,t or r) as float vec
  * \param length  the texture size along one dimension
  * \param stride  pixel stride along the coordinate axis (in bytes)
+ * \param tile_stride  tile stride along the axis of tiled textures, or NULL
  * \param offset  the texel offset along the coord axis
  * \param is_pot  if TRUE, length is a power of two
  * \param wrap_mode  one of PIPE_TEX_WRAP_x
@@ -81,6 +82,7 @@ lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
                                  LLVMValueRef coord_f,
                                  LLVMValueRef length,
                                  LLVMValueRef stride,
+                                 LLVMValueRef tile_stride,
                                  LLVMValueRef offset,
                                  boolean is_pot,
                                  unsigned wrap_mode,
@@ -126,8 +128,9 @@ lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
       assert(0);
    }
 
-   lp_build_sample_partial_offset(int_coord_bld, block_length, coord, stride,
-                                  out_offset, out_i);
+   lp_build_sample_partial_offset_tiled(int_coord_bld, block_length, coord,
+                                        stride, tile_stride,
+                                        out_offset, out_i);
 }
 
 
@@ -202,6 +205,7 @@ lp_build_sample_wrap_nearest_float(struct lp_build_sample_context *bld,
  * \param coord_f  the incoming texcoord (s,t or r) as float vec
  * \param length  the texture size along one dimension
  * \param stride  pixel stride along the coordinate axis (in bytes)
+ * \param tile_stride  tile stride along the axis of tiled textures, or NULL
  * \param offset  the texel offset along the coord axis
  * \param is_pot  if TRUE, length is a power of two
  * \param wrap_mode  one of PIPE_TEX_WRAP_x
@@ -218,6 +222,7 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
                                 LLVMValueRef coord_f,
                                 LLVMValueRef length,
                                 LLVMValueRef stride,
+                                LLVMValueRef tile_stride,
                                 LLVMValueRef offset,
                                 boolean is_pot,
                                 unsigned wrap_mode,
@@ -232,15 +237,15 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
    LLVMValueRef lmask, umask, mask;
 
    /*
-    * If the pixel block covers more than one pixel then there is no easy
-    * way to calculate offset1 relative to offset0. Instead, compute them
-    * independently. Otherwise, try to compute offset0 and offset1 with
-    * a single stride multiplication.
+    * If the pixel block covers more than one pixel, or the texture is
+    * tiled, then there is no easy way to calculate offset1 relative to
+    * offset0. Instead, compute them independently. Otherwise, try to
+    * compute offset0 and offset1 with a single stride multiplication.
     */
 
    length_minus_one = lp_build_sub(int_coord_bld, length, int_coord_bld->one);
 
-   if (block_length != 1) {
+   if (block_length != 1 || tile_stride) {
       LLVMValueRef coord1;
       switch(wrap_mode) {
       case PIPE_TEX_WRAP_REPEAT:
@@ -292,10 +297,12 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
          coord1 = int_coord_bld->zero;
          break;
       }
-      lp_build_sample_partial_offset(int_coord_bld, block_length, coord0, stride,
-                                     offset0, i0);
-      lp_build_sample_partial_offset(int_coord_bld, block_length, coord1, stride,
-                                     offset1, i1);
+      lp_build_sample_partial_offset_tiled(int_coord_bld, block_length,
+                                           coord0, stride, tile_stride,
+                                           offset0, i0);
+      lp_build_sample_partial_offset_tiled(int_coord_bld, block_length,
+                                           coord1, stride, tile_stride,
+                                           offset1, i1);
       return;
    }
 
@@ -541,7 +548,8 @@ lp_build_sample_fetch_image_nearest(struct lp_build_sample_context *bld,
                                       u8n.type,
                                       data_ptr, offset,
                                       x_subcoord,
-                                      y_subcoord);
+                                      y_subcoord,
+                                      bld->cache);
    }
 
    *colors = rgba8;
@@ -574,7 +582,7 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
    LLVMValueRef width_vec, height_vec, depth_vec;
    LLVMValueRef s_ipart, t_ipart = NULL, r_ipart = NULL;
    LLVMValueRef s_float, t_float = NULL, r_float = NULL;
-   LLVMValueRef x_stride;
+   LLVMValueRef x_stride, x_tile_stride, y_stride, y_tile_stride;
    LLVMValueRef x_offset, offset;
    LLVMValueRef x_subcoord, y_subcoord, z_subcoord;
 
@@ -639,15 +647,17 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
    }
 
    /* get pixel, row, image strides */
-   x_stride = lp_build_const_vec(bld->gallivm,
-                                 bld->int_coord_bld.type,
-                                 bld->format_desc->block.bits/8);
+   lp_build_sample_strides(&bld->int_coord_bld, bld->format_desc,
+                           bld->static_texture_state->tiled, row_stride_vec,
+                           &x_stride, &x_tile_stride,
+                           &y_stride, &y_tile_stride);
 
    /* Do texcoord wrapping, compute texel offset */
    lp_build_sample_wrap_nearest_int(bld,
                                     bld->format_desc->block.width,
                                     s_ipart, s_float,
-                                    width_vec, x_stride, offsets[0],
+                                    width_vec, x_stride, x_tile_stride,
+                                    offsets[0],
                                     bld->static_texture_state->pot_width,
                                     bld->static_sampler_state->wrap_s,
                                     &x_offset, &x_subcoord);
@@ -657,7 +667,8 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
       lp_build_sample_wrap_nearest_int(bld,
                                        bld->format_desc->block.height,
                                        t_ipart, t_float,
-                                       height_vec, row_stride_vec, offsets[1],
+                                       height_vec, y_stride, y_tile_stride,
+                                       offsets[1],
                                        bld->static_texture_state->pot_height,
                                        bld->static_sampler_state->wrap_t,
                                        &y_offset, &y_subcoord);
@@ -667,7 +678,8 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
          lp_build_sample_wrap_nearest_int(bld,
                                           1, /* block length (depth) */
                                           r_ipart, r_float,
-                                          depth_vec, img_stride_vec, offsets[2],
+                                          depth_vec, img_stride_vec, NULL,
+                                          offsets[2],
                                           bld->static_texture_state->pot_depth,
                                           bld->static_sampler_state->wrap_r,
                                           &z_offset, &z_subcoord);
@@ -769,6 +781,7 @@ lp_build_sample_image_nearest_afloat(struct lp_build_sample_context *bld,
     */
    lp_build_sample_offset(&bld->int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x_icoord, y_icoord,
                           z_icoord,
                           row_stride_vec, img_stride_vec,
@@ -903,7 +916,8 @@ lp_build_sample_fetch_image_linear(struct lp_build_sample_context *bld,
                                                u8n.type,
                                                data_ptr, offset[k][j][i],
                                                x_subcoord[i],
-                                               y_subcoord[j]);
+                                               y_subcoord[j],
+                                               bld->cache);
             }
 
             neighbors[k][j][i] = rgba8;
@@ -994,6 +1008,7 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
    LLVMValueRef t_ipart = NULL, t_fpart = NULL, t_float = NULL;
    LLVMValueRef r_ipart = NULL, r_fpart = NULL, r_float = NULL;
    LLVMValueRef x_stride, y_stride, z_stride;
+   LLVMValueRef x_tile_stride, y_tile_stride;
    LLVMValueRef x_offset0, x_offset1;
    LLVMValueRef y_offset0, y_offset1;
    LLVMValueRef z_offset0, z_offset1;
@@ -1082,16 +1097,18 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
       r_fpart = LLVMBuildAnd(builder, r, i32_c255, "");
 
    /* get pixel, row and image strides */
-   x_stride = lp_build_const_vec(bld->gallivm, bld->int_coord_bld.type,
-                                 bld->format_desc->block.bits/8);
-   y_stride = row_stride_vec;
+   lp_build_sample_strides(&bld->int_coord_bld, bld->format_desc,
+                           bld->static_texture_state->tiled, row_stride_vec,
+                           &x_stride, &x_tile_stride,
+                           &y_stride, &y_tile_stride);
    z_stride = img_stride_vec;
 
    /* do texcoord wrapping and compute texel offsets */
    lp_build_sample_wrap_linear_int(bld,
                                    bld->format_desc->block.width,
                                    s_ipart, &s_fpart, s_float,
-                                   width_vec, x_stride, offsets[0],
+                                   width_vec, x_stride, x_tile_stride,
+                                   offsets[0],
                                    bld->static_texture_state->pot_width,
                                    bld->static_sampler_state->wrap_s,
                                    &x_offset0, &x_offset1,
@@ -1123,7 +1140,8 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
       lp_build_sample_wrap_linear_int(bld,
                                       bld->format_desc->block.height,
                                       t_ipart, &t_fpart, t_float,
-                                      height_vec, y_stride, offsets[1],
+                                      height_vec, y_stride, y_tile_stride,
+                                      offsets[1],
                                       bld->static_texture_state->pot_height,
                                       bld->static_sampler_state->wrap_t,
                                       &y_offset0, &y_offset1,
@@ -1143,7 +1161,7 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
       lp_build_sample_wrap_linear_int(bld,
                                       1, /* block length (depth) */
                                       r_ipart, &r_fpart, r_float,
-                                      depth_vec, z_stride, offsets[2],
+                                      depth_vec, z_stride, NULL, offsets[2],
                                       bld->static_texture_state->pot_depth,
                                       bld->static_sampler_state->wrap_r,
                                       &z_offset0, &z_offset1,
@@ -1190,6 +1208,7 @@ lp_build_sample_image_linear_afloat(struct lp_build_sample_context *bld,
    LLVMValueRef t_fpart = NULL;
    LLVMValueRef r_fpart = NULL;
    LLVMValueRef x_stride, y_stride, z_stride;
+   LLVMValueRef x_tile_stride, y_tile_stride;
    LLVMValueRef x_offset0, x_offset1;
    LLVMValueRef y_offset0, y_offset1;
    LLVMValueRef z_offset0, z_offset1;
@@ -1248,10 +1267,10 @@ lp_build_sample_image_linear_afloat(struct lp_build_sample_context *bld,
     */
 
    /* get pixel, row and image strides */
-   x_stride = lp_build_const_vec(bld->gallivm,
-                                 bld->int_coord_bld.type,
-                                 bld->format_desc->block.bits/8);
-   y_stride = row_stride_vec;
+   lp_build_sample_strides(&bld->int_coord_bld, bld->format_desc,
+                           bld->static_texture_state->tiled, row_stride_vec,
+                           &x_stride, &x_tile_stride,
+                           &y_stride, &y_tile_stride);
    z_stride = img_stride_vec;
 
    /*
@@ -1259,14 +1278,14 @@ lp_build_sample_image_linear_afloat(struct lp_build_sample_context *bld,
     * cannot do offset calc with floats, difficult for block-based formats,
     * and not enough precision anyway.
     */
-   lp_build_sample_partial_offset(&bld->int_coord_bld,
-                                  bld->format_desc->block.width,
-                                  x_icoord0, x_stride,
-                                  &x_offset0, &x_subcoord[0]);
-   lp_build_sample_partial_offset(&bld->int_coord_bld,
-                                  bld->format_desc->block.width,
-                                  x_icoord1, x_stride,
-                                  &x_offset1, &x_subcoord[1]);
+   lp_build_sample_partial_offset_tiled(&bld->int_coord_bld,
+                                        bld->format_desc->block.width,
+                                        x_icoord0, x_stride, x_tile_stride,
+                                        &x_offset0, &x_subcoord[0]);
+   lp_build_sample_partial_offset_tiled(&bld->int_coord_bld,
+                                        bld->format_desc->block.width,
+                                        x_icoord1, x_stride, x_tile_stride,
+                                        &x_offset1, &x_subcoord[1]);
 
    /* add potential cube/array/mip offsets now as they are constant per pixel */
    if (bld->static_texture_state->target == PIPE_TEXTURE_CUBE ||
@@ -1291,14 +1310,14 @@ lp_build_sample_image_linear_afloat(struct lp_build_sample_context *bld,
    }
 
    if (dims >= 2) {
-      lp_build_sample_partial_offset(&bld->int_coord_bld,
-                                     bld->format_desc->block.height,
-                                     y_icoord0, y_stride,
-                                     &y_offset0, &y_subcoord[0]);
-      lp_build_sample_partial_offset(&bld->int_coord_bld,
-                                     bld->format_desc->block.height,
-                                     y_icoord1, y_stride,
-                                     &y_offset1, &y_subcoord[1]);
+      lp_build_sample_partial_offset_tiled(&bld->int_coord_bld,
+                                           bld->format_desc->block.height,
+                                           y_icoord0, y_stride, y_tile_stride,
+                                           &y_offset0, &y_subcoord[0]);
+      lp_build_sample_partial_offset_tiled(&bld->int_coord_bld,
+                                           bld->format_desc->block.height,
+                                           y_icoord1, y_stride, y_tile_stride,
+                                           &y_offset1, &y_subcoord[1]);
       for (z = 0; z < 2; z++) {
          for (x = 0; x < 2; x++) {
             offset[z][0][x] = lp_build_add(&bld->int_coord_bld,
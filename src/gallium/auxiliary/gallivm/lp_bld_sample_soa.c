@@ -138,6 +138,7 @@ lp_build_sample_texel_soa(struct lp_build_sample_context *bld,
    /* convert x,y,z coords to linear offset from start of texture, in bytes */
    lp_build_sample_offset(&bld->int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, y_stride, z_stride,
                           &offset, &i, &j);
    if (mipoffsets) {
@@ -161,6 +162,7 @@ lp_build_sample_texel_soa(struct lp_build_sample_context *bld,
                            bld->texel_type,
                            data_ptr, offset,
                            i, j,
+                           bld->cache,
                            texel_out);
 
    /*
@@ -1478,6 +1480,13 @@ lp_build_sample_common(struct lp_build_sample_context *bld,
          assert(lod_ipart);
          lp_build_nearest_mip_level(bld, texture_index, lod_ipart, ilevel0, NULL);
       }
+      else if (bld->static_texture_state->level_zero_only) {
+         /*
+          * The view has a single level, so first_level is 0.  A constant
+          * lets the mip level size, stride and offset lookups fold away.
+          */
+         *ilevel0 = bld->leveli_bld.zero;
+      }
       else {
          first_level = bld->dynamic_state->first_level(bld->dynamic_state,
                                                        bld->gallivm, texture_index);
@@ -1971,6 +1980,7 @@ lp_build_fetch_texel(struct lp_build_sample_context *bld,
 
    lp_build_sample_offset(int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, row_stride_vec, img_stride_vec,
                           &offset, &i, &j);
 
@@ -1986,6 +1996,7 @@ lp_build_fetch_texel(struct lp_build_sample_context *bld,
                            bld->texel_type,
                            bld->base_ptr, offset,
                            i, j,
+                           bld->cache,
                            colors_out);
 
    if (out_of_bound_ret_zero) {
@@ -2247,6 +2258,8 @@ lp_build_sample_soa(struct gallivm_state *gallivm,
    bld.row_stride_array = dynamic_state->row_stride(dynamic_state, gallivm, texture_index);
    bld.img_stride_array = dynamic_state->img_stride(dynamic_state, gallivm, texture_index);
    bld.base_ptr = dynamic_state->base_ptr(dynamic_state, gallivm, texture_index);
+   if (dynamic_state->cache_ptr)
+      bld.cache = dynamic_state->cache_ptr(dynamic_state, gallivm, texture_index);
    bld.mip_offsets = dynamic_state->mip_offsets(dynamic_state, gallivm, texture_index);
    /* Note that mip_offsets is an array[level] of offsets to texture images */
 
@@ -2292,20 +2305,14 @@ lp_build_sample_soa(struct gallivm_state *gallivm,
    else {
       LLVMValueRef lod_fpart = NULL, lod_positive = NULL;
       LLVMValueRef ilevel0 = NULL, ilevel1 = NULL;
-      boolean use_aos = util_format_fits_8unorm(bld.format_desc) &&
-                        /* not sure this is strictly needed or simply impossible */
-                        derived_sampler_state.compare_mode == PIPE_TEX_COMPARE_NONE &&
-                        lp_is_simple_wrap_mode(derived_sampler_state.wrap_s);
+      enum lp_sampler_path path =
+         lp_sampler_static_path(static_texture_state, &derived_sampler_state);
+      boolean use_aos = path == LP_SAMPLER_PATH_AOS ||
+                        path == LP_SAMPLER_PATH_AOS_ONE_LEVEL;
 
       use_aos &= bld.num_lods <= num_quads ||
                  derived_sampler_state.min_img_filter ==
                     derived_sampler_state.mag_img_filter;
-      if (dims > 1) {
-         use_aos &= lp_is_simple_wrap_mode(derived_sampler_state.wrap_t);
-         if (dims > 2) {
-            use_aos &= lp_is_simple_wrap_mode(derived_sampler_state.wrap_r);
-         }
-      }
 
       if ((gallivm_debug & GALLIVM_DEBUG_PERF) &&
           !use_aos && util_format_fits_8unorm(bld.format_desc)) {
@@ -2372,6 +2379,7 @@ lp_build_sample_soa(struct gallivm_state *gallivm,
          bld4.row_stride_array = bld.row_stride_array;
          bld4.img_stride_array = bld.img_stride_array;
          bld4.base_ptr = bld.base_ptr;
+         bld4.cache = bld.cache;
          bld4.mip_offsets = bld.mip_offsets;
          bld4.int_size = bld.int_size;
 
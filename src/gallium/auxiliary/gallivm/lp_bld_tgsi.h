@@ -245,6 +245,9 @@ lp_build_tgsi_aos(struct gallivm_state *gallivm,
                   const struct tgsi_shader_info *info);
 
 
+/** Number of masks saved at the start of an IF/ELSE or CASE arm */
+#define LP_EXEC_MASK_ARM_MASKS 6
+
 enum lp_exec_mask_break_type {
    LP_EXEC_MASK_BREAK_TYPE_LOOP,
    LP_EXEC_MASK_BREAK_TYPE_SWITCH
@@ -302,6 +305,21 @@ struct lp_exec_mask {
 
    LLVMValueRef exec_mask;
    LLVMValueRef loop_limiter;
+
+   /*
+    * IF/ELSE and CASE arms are only executed when some lane is active, or,
+    * for uniform conditions, when the condition is true.  The masks the
+    * arm may change are saved so that they can be merged at its end.
+    */
+   struct {
+      LLVMBasicBlockRef entry_block;
+      LLVMBasicBlockRef merge_block;
+      LLVMValueRef cond;   /**< i1 condition of a uniform IF */
+      boolean uniform;
+      int switch_level;    /**< switch_stack_size of a CASE arm, -1 for IF */
+      LLVMValueRef masks[LP_EXEC_MASK_ARM_MASKS];
+   } arm_stack[LP_MAX_TGSI_NESTING];
+   int arm_stack_size;
 };
 
 struct lp_build_tgsi_inst_list
@@ -472,6 +490,11 @@ struct lp_build_tgsi_soa_context
    struct lp_build_mask_context *mask;
    struct lp_exec_mask exec_mask;
 
+   /** temporary and address register channels the same in all lanes */
+   boolean uniform_analysed;
+   ubyte uniform_temps[LP_MAX_TGSI_TEMPS * TGSI_NUM_CHANNELS];
+   ubyte uniform_addrs[LP_MAX_TGSI_ADDRS * TGSI_NUM_CHANNELS];
+
    uint num_immediates;
 
 };
@@ -38,6 +38,7 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_shader_tokens.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -54,6 +55,7 @@
 #include "lp_bld_bitarit.h"
 #include "lp_bld_gather.h"
 #include "lp_bld_init.h"
+#include "lp_bld_intr.h"
 #include "lp_bld_logic.h"
 #include "lp_bld_swizzle.h"
 #include "lp_bld_flow.h"
@@ -79,6 +81,7 @@ static void lp_exec_mask_init(struct lp_exec_mask *mask, struct lp_build_context
    mask->loop_stack_size = 0;
    mask->call_stack_size = 0;
    mask->switch_stack_size = 0;
+   mask->arm_stack_size = 0;
 
    mask->int_vec_type = lp_build_int_vec_type(bld->gallivm, mask->bld->type);
    mask->exec_mask = mask->ret_mask = mask->break_mask = mask->cont_mask =
@@ -178,6 +181,187 @@ static void lp_exec_mask_cond_pop(struct lp_exec_mask *mask)
    lp_exec_mask_update(mask);
 }
 
+/*
+ * The masks an IF/ELSE or CASE arm can change.  When the arm is skipped
+ * they keep their values from before it.
+ */
+static void lp_exec_arm_masks(struct lp_exec_mask *mask,
+                              LLVMValueRef *masks[LP_EXEC_MASK_ARM_MASKS])
+{
+   masks[0] = &mask->cond_mask;
+   masks[1] = &mask->cont_mask;
+   masks[2] = &mask->break_mask;
+   masks[3] = &mask->switch_mask;
+   masks[4] = &mask->switch_mask_default;
+   masks[5] = &mask->ret_mask;
+}
+
+/* i1 (val != 0), i.e. whether any lane of the mask is set */
+static LLVMValueRef lp_exec_any(struct lp_exec_mask *mask, LLVMValueRef val)
+{
+   LLVMBuilderRef builder = mask->bld->gallivm->builder;
+   LLVMTypeRef reg_type = LLVMIntTypeInContext(mask->bld->gallivm->context,
+                                               mask->bld->type.width *
+                                               mask->bld->type.length);
+
+   return LLVMBuildICmp(builder, LLVMIntNE,
+                        LLVMBuildBitCast(builder, val, reg_type, ""),
+                        LLVMConstNull(reg_type), "any");
+}
+
+/*
+ * Branch over the code up to lp_exec_arm_end() unless take is true.
+ */
+static void lp_exec_arm_begin(struct lp_exec_mask *mask,
+                              LLVMValueRef take)
+{
+   LLVMBuilderRef builder = mask->bld->gallivm->builder;
+   LLVMValueRef *masks[LP_EXEC_MASK_ARM_MASKS];
+   LLVMBasicBlockRef arm_block;
+   unsigned i;
+
+   assert(mask->arm_stack_size);
+
+   lp_exec_arm_masks(mask, masks);
+   for (i = 0; i < LP_EXEC_MASK_ARM_MASKS; i++) {
+      mask->arm_stack[mask->arm_stack_size - 1].masks[i] = *masks[i];
+   }
+
+   mask->arm_stack[mask->arm_stack_size - 1].entry_block =
+      LLVMGetInsertBlock(builder);
+   mask->arm_stack[mask->arm_stack_size - 1].merge_block =
+      lp_build_insert_new_block(mask->bld->gallivm, "endarm");
+   arm_block = lp_build_insert_new_block(mask->bld->gallivm, "arm");
+
+   LLVMBuildCondBr(builder, take, arm_block,
+                   mask->arm_stack[mask->arm_stack_size - 1].merge_block);
+   LLVMPositionBuilderAtEnd(builder, arm_block);
+}
+
+static void lp_exec_arm_end(struct lp_exec_mask *mask)
+{
+   LLVMBuilderRef builder = mask->bld->gallivm->builder;
+   LLVMValueRef *masks[LP_EXEC_MASK_ARM_MASKS];
+   LLVMBasicBlockRef blocks[2];
+   unsigned i;
+
+   assert(mask->arm_stack_size);
+
+   blocks[0] = mask->arm_stack[mask->arm_stack_size - 1].entry_block;
+   blocks[1] = LLVMGetInsertBlock(builder);
+
+   LLVMBuildBr(builder, mask->arm_stack[mask->arm_stack_size - 1].merge_block);
+   LLVMPositionBuilderAtEnd(builder,
+                            mask->arm_stack[mask->arm_stack_size - 1].merge_block);
+
+   lp_exec_arm_masks(mask, masks);
+   for (i = 0; i < LP_EXEC_MASK_ARM_MASKS; i++) {
+      LLVMValueRef vals[2];
+      LLVMValueRef phi;
+
+      vals[0] = mask->arm_stack[mask->arm_stack_size - 1].masks[i];
+      vals[1] = *masks[i];
+      if (vals[0] == vals[1])
+         continue;
+
+      phi = LLVMBuildPhi(builder, LLVMTypeOf(vals[0]), "");
+      LLVMAddIncoming(phi, vals, blocks, 2);
+      *masks[i] = phi;
+   }
+
+   lp_exec_mask_update(mask);
+}
+
+/*
+ * IF with the condition val.  A uniform condition is branched on directly
+ * and leaves the masks alone, otherwise the arm is masked and skipped when
+ * no lane is active.
+ */
+static void lp_exec_if(struct lp_exec_mask *mask,
+                       LLVMValueRef val,
+                       boolean uniform)
+{
+   LLVMValueRef take;
+
+   assert(mask->arm_stack_size < LP_MAX_TGSI_NESTING);
+
+   if (uniform) {
+      take = lp_exec_any(mask, val);
+   }
+   else {
+      lp_exec_mask_cond_push(mask, val);
+      take = lp_exec_any(mask, mask->exec_mask);
+   }
+
+   mask->arm_stack[mask->arm_stack_size].cond = take;
+   mask->arm_stack[mask->arm_stack_size].uniform = uniform;
+   mask->arm_stack[mask->arm_stack_size].switch_level = -1;
+   mask->arm_stack_size++;
+
+   lp_exec_arm_begin(mask, take);
+}
+
+static void lp_exec_else(struct lp_exec_mask *mask)
+{
+   LLVMBuilderRef builder = mask->bld->gallivm->builder;
+   LLVMValueRef take;
+
+   assert(mask->arm_stack_size);
+   assert(mask->arm_stack[mask->arm_stack_size - 1].switch_level < 0);
+
+   lp_exec_arm_end(mask);
+
+   if (mask->arm_stack[mask->arm_stack_size - 1].uniform) {
+      take = LLVMBuildNot(builder,
+                          mask->arm_stack[mask->arm_stack_size - 1].cond, "");
+   }
+   else {
+      lp_exec_mask_cond_invert(mask);
+      take = lp_exec_any(mask, mask->exec_mask);
+   }
+
+   lp_exec_arm_begin(mask, take);
+}
+
+static void lp_exec_endif(struct lp_exec_mask *mask)
+{
+   assert(mask->arm_stack_size);
+   assert(mask->arm_stack[mask->arm_stack_size - 1].switch_level < 0);
+
+   lp_exec_arm_end(mask);
+
+   if (!mask->arm_stack[--mask->arm_stack_size].uniform) {
+      lp_exec_mask_cond_pop(mask);
+   }
+}
+
+/*
+ * Skip the code of a CASE/DEFAULT when no lane executes it.  This is
+ * only done where the switch mask was actually updated; a deferred
+ * DEFAULT is emitted unskipped.
+ */
+static void lp_exec_case_arm_begin(struct lp_exec_mask *mask)
+{
+   assert(mask->arm_stack_size < LP_MAX_TGSI_NESTING);
+
+   mask->arm_stack[mask->arm_stack_size].cond = NULL;
+   mask->arm_stack[mask->arm_stack_size].uniform = FALSE;
+   mask->arm_stack[mask->arm_stack_size].switch_level = mask->switch_stack_size;
+   mask->arm_stack_size++;
+
+   lp_exec_arm_begin(mask, lp_exec_any(mask, mask->exec_mask));
+}
+
+static void lp_exec_case_arm_end(struct lp_exec_mask *mask)
+{
+   if (mask->arm_stack_size &&
+       mask->arm_stack[mask->arm_stack_size - 1].switch_level ==
+       mask->switch_stack_size) {
+      lp_exec_arm_end(mask);
+      mask->arm_stack_size--;
+   }
+}
+
 static void lp_exec_bgnloop(struct lp_exec_mask *mask)
 {
    LLVMBuilderRef builder = mask->bld->gallivm->builder;
@@ -624,7 +808,8 @@ static void lp_exec_mask_ret(struct lp_exec_mask *mask, int *pc)
    if (mask->cond_stack_size == 0 &&
        mask->loop_stack_size == 0 &&
        mask->switch_stack_size == 0 &&
-       mask->call_stack_size == 0) {
+       mask->call_stack_size == 0 &&
+       mask->arm_stack_size == 0) {
       /* returning from main() */
       *pc = -1;
       return;
@@ -743,6 +928,30 @@ build_gather(struct lp_build_context *bld,
    LLVMValueRef res = bld->undef;
    unsigned i;
 
+#if HAVE_LLVM >= 0x0304
+   if (util_cpu_caps.has_avx2 &&
+       bld->type.floating && bld->type.width == 32 &&
+       (bld->type.length == 4 || bld->type.length == 8)) {
+      LLVMTypeRef i8t = LLVMInt8TypeInContext(bld->gallivm->context);
+      LLVMValueRef args[5];
+
+      args[0] = bld->undef;
+      args[1] = LLVMBuildBitCast(builder, base_ptr,
+                                 LLVMPointerType(i8t, 0), "");
+      args[2] = indexes;
+      /* only the sign bits of the mask matter */
+      args[3] = LLVMConstBitCast(LLVMConstAllOnes(bld->int_vec_type),
+                                 bld->vec_type);
+      args[4] = LLVMConstInt(i8t, 4, 0);
+
+      return lp_build_intrinsic(builder,
+                                bld->type.length == 8 ?
+                                "llvm.x86.avx2.gather.d.ps.256" :
+                                "llvm.x86.avx2.gather.d.ps",
+                                bld->vec_type, args, Elements(args));
+   }
+#endif
+
    /*
     * Loop over elements of index_vec, load scalar value, insert it into 'res'.
     */
@@ -814,6 +1023,281 @@ emit_mask_scatter(struct lp_build_tgsi_soa_context *bld,
 }
 
 
+static void
+analyse_uniform_regs(struct lp_build_tgsi_soa_context *bld);
+
+
+/*
+ * Whether the address register channel used for an indirect access is the
+ * same in all lanes.
+ */
+static boolean
+uniform_indirect(struct lp_build_tgsi_soa_context *bld,
+                 const struct tgsi_ind_register *indirect_reg)
+{
+   unsigned index = indirect_reg->Index * TGSI_NUM_CHANNELS +
+                    indirect_reg->Swizzle;
+
+   if (!bld->uniform_analysed) {
+      analyse_uniform_regs(bld);
+   }
+
+   switch (indirect_reg->File) {
+   case TGSI_FILE_ADDRESS:
+      return indirect_reg->Index < LP_MAX_TGSI_ADDRS &&
+             bld->uniform_addrs[index];
+   case TGSI_FILE_TEMPORARY:
+      return indirect_reg->Index < LP_MAX_TGSI_TEMPS &&
+             bld->uniform_temps[index];
+   default:
+      return FALSE;
+   }
+}
+
+
+/*
+ * Whether the source channels in chan_mask are the same in all lanes.
+ */
+static boolean
+uniform_src(struct lp_build_tgsi_soa_context *bld,
+            const struct tgsi_full_src_register *reg,
+            unsigned chan_mask)
+{
+   const ubyte *uniform_chans;
+   unsigned chan;
+
+   if (!bld->uniform_analysed) {
+      analyse_uniform_regs(bld);
+   }
+
+   if (reg->Register.Dimension && reg->Dimension.Indirect) {
+      return FALSE;
+   }
+
+   if (reg->Register.Indirect) {
+      /* the same element of constant data */
+      return (reg->Register.File == TGSI_FILE_CONSTANT ||
+              reg->Register.File == TGSI_FILE_IMMEDIATE) &&
+             uniform_indirect(bld, &reg->Indirect);
+   }
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_CONSTANT:
+   case TGSI_FILE_IMMEDIATE:
+      return TRUE;
+   case TGSI_FILE_SYSTEM_VALUE:
+      return bld->bld_base.info->system_value_semantic_name[reg->Register.Index] ==
+             TGSI_SEMANTIC_INSTANCEID;
+   case TGSI_FILE_TEMPORARY:
+      if (reg->Register.Index >= LP_MAX_TGSI_TEMPS) {
+         return FALSE;
+      }
+      uniform_chans = bld->uniform_temps;
+      break;
+   case TGSI_FILE_ADDRESS:
+      if (reg->Register.Index >= LP_MAX_TGSI_ADDRS) {
+         return FALSE;
+      }
+      uniform_chans = bld->uniform_addrs;
+      break;
+   default:
+      return FALSE;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (chan_mask & (1 << chan)) {
+         unsigned swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+         if (!uniform_chans[reg->Register.Index * TGSI_NUM_CHANNELS + swizzle]) {
+            return FALSE;
+         }
+      }
+   }
+   return TRUE;
+}
+
+
+/**
+ * Find the temporary and address register channels that are the same in
+ * all lanes.
+ *
+ * A channel is uniform if all instructions writing it only read uniform
+ * values (constants, immediates, the instance ID and uniform registers),
+ * outside of divergent control flow.  Control flow is divergent inside
+ * IF/SWITCH with a non-uniform condition, and in loops/switches with a
+ * divergent break or continue.  This is iterated until nothing changes.
+ */
+static void
+analyse_uniform_regs(struct lp_build_tgsi_soa_context *bld)
+{
+   const struct lp_build_tgsi_context *bld_base = &bld->bld_base;
+   const unsigned num_instructions = bld_base->num_instructions;
+   boolean divergent_stack[LP_MAX_TGSI_NESTING];
+   unsigned block_stack[LP_MAX_TGSI_NESTING];
+   ubyte *divergent_blocks;
+   boolean valid = TRUE;
+   boolean changed;
+   unsigned pc;
+   int depth;
+
+   bld->uniform_analysed = TRUE;
+
+   /*
+    * Subroutines and returns from within control flow leave lanes behind
+    * in ways not tracked here, nor are indirectly addressed temporaries,
+    * so only constant data counts as uniform then.
+    */
+   if (bld->indirect_files & (1 << TGSI_FILE_TEMPORARY)) {
+      valid = FALSE;
+   }
+   depth = 0;
+   for (pc = 0; valid && pc < num_instructions; pc++) {
+      switch (bld_base->instructions[pc].Instruction.Opcode) {
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_UIF:
+      case TGSI_OPCODE_BGNLOOP:
+      case TGSI_OPCODE_SWITCH:
+         if (++depth >= LP_MAX_TGSI_NESTING) {
+            valid = FALSE;
+         }
+         break;
+      case TGSI_OPCODE_ENDIF:
+      case TGSI_OPCODE_ENDLOOP:
+      case TGSI_OPCODE_ENDSWITCH:
+         depth--;
+         break;
+      case TGSI_OPCODE_RET:
+         if (depth) {
+            valid = FALSE;
+         }
+         break;
+      case TGSI_OPCODE_CAL:
+      case TGSI_OPCODE_BGNSUB:
+         valid = FALSE;
+         break;
+      }
+   }
+
+   divergent_blocks = CALLOC(num_instructions, 1);
+   if (!valid || !divergent_blocks) {
+      FREE(divergent_blocks);
+      return;
+   }
+
+   memset(bld->uniform_temps, 1, sizeof bld->uniform_temps);
+   memset(bld->uniform_addrs, 1, sizeof bld->uniform_addrs);
+
+   do {
+      boolean divergent = FALSE;
+      int num_blocks = 0;
+
+      changed = FALSE;
+      depth = 0;
+
+      for (pc = 0; pc < num_instructions; pc++) {
+         const struct tgsi_full_instruction *inst = &bld_base->instructions[pc];
+         const unsigned opcode = inst->Instruction.Opcode;
+         const struct tgsi_opcode_info *info = tgsi_get_opcode_info(opcode);
+         unsigned i, chan;
+         int block;
+
+         switch (opcode) {
+         case TGSI_OPCODE_IF:
+         case TGSI_OPCODE_UIF:
+            divergent_stack[depth++] = divergent;
+            if (!uniform_src(bld, &inst->Src[0], TGSI_WRITEMASK_X)) {
+               divergent = TRUE;
+            }
+            break;
+
+         case TGSI_OPCODE_BGNLOOP:
+         case TGSI_OPCODE_SWITCH:
+            divergent_stack[depth++] = divergent;
+            block_stack[num_blocks++] = pc;
+            if (divergent_blocks[pc] ||
+                (opcode == TGSI_OPCODE_SWITCH &&
+                 !uniform_src(bld, &inst->Src[0], TGSI_WRITEMASK_X))) {
+               divergent = TRUE;
+            }
+            break;
+
+         case TGSI_OPCODE_ENDLOOP:
+         case TGSI_OPCODE_ENDSWITCH:
+            num_blocks--;
+            /* fall through */
+         case TGSI_OPCODE_ENDIF:
+            divergent = divergent_stack[--depth];
+            break;
+
+         case TGSI_OPCODE_BRK:
+         case TGSI_OPCODE_BREAKC:
+         case TGSI_OPCODE_CONT:
+            if (divergent ||
+                (opcode == TGSI_OPCODE_BREAKC &&
+                 !uniform_src(bld, &inst->Src[0], TGSI_WRITEMASK_X))) {
+               /* continue applies to the loop, break to a switch too */
+               for (block = num_blocks - 1; block >= 0; block--) {
+                  if (opcode != TGSI_OPCODE_CONT ||
+                      bld_base->instructions[block_stack[block]].Instruction.Opcode ==
+                      TGSI_OPCODE_BGNLOOP) {
+                     break;
+                  }
+               }
+               if (block >= 0 && !divergent_blocks[block_stack[block]]) {
+                  divergent_blocks[block_stack[block]] = TRUE;
+                  changed = TRUE;
+               }
+            }
+            break;
+
+         default:
+            for (i = 0; i < info->num_dst; i++) {
+               const struct tgsi_full_dst_register *dst = &inst->Dst[i];
+               ubyte *uniform_chans;
+               boolean uniform;
+               unsigned src;
+
+               if (dst->Register.File == TGSI_FILE_TEMPORARY &&
+                   dst->Register.Index < LP_MAX_TGSI_TEMPS) {
+                  uniform_chans = bld->uniform_temps;
+               }
+               else if (dst->Register.File == TGSI_FILE_ADDRESS &&
+                        dst->Register.Index < LP_MAX_TGSI_ADDRS) {
+                  uniform_chans = bld->uniform_addrs;
+               }
+               else {
+                  continue;
+               }
+
+               uniform = !divergent &&
+                         !info->is_tex &&
+                         !inst->Instruction.Predicate &&
+                         !dst->Register.Indirect;
+               for (src = 0; uniform && src < info->num_src; src++) {
+                  uniform = uniform_src(bld, &inst->Src[src],
+                                        TGSI_WRITEMASK_XYZW);
+               }
+               if (uniform) {
+                  continue;
+               }
+
+               uniform_chans += dst->Register.Index * TGSI_NUM_CHANNELS;
+               for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+                  if ((dst->Register.WriteMask & (1 << chan)) &&
+                      uniform_chans[chan]) {
+                     uniform_chans[chan] = FALSE;
+                     changed = TRUE;
+                  }
+               }
+            }
+            break;
+         }
+      }
+   } while (changed);
+
+   FREE(divergent_blocks);
+}
+
+
 /**
  * Read the current value of the ADDR register, convert the floats to
  * ints, add the base index and return the vector of offsets.
@@ -821,22 +1305,14 @@ emit_mask_scatter(struct lp_build_tgsi_soa_context *bld,
  * temporary register file.
  */
 static LLVMValueRef
-get_indirect_index(struct lp_build_tgsi_soa_context *bld,
-                   unsigned reg_file, unsigned reg_index,
-                   const struct tgsi_ind_register *indirect_reg)
+load_indirect_reg(struct lp_build_tgsi_soa_context *bld,
+                  const struct tgsi_ind_register *indirect_reg)
 {
    LLVMBuilderRef builder = bld->bld_base.base.gallivm->builder;
    struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
    /* always use X component of address register */
    unsigned swizzle = indirect_reg->Swizzle;
-   LLVMValueRef base;
    LLVMValueRef rel;
-   LLVMValueRef max_index;
-   LLVMValueRef index;
-
-   assert(bld->indirect_files & (1 << reg_file));
-
-   base = lp_build_const_int_vec(bld->bld_base.base.gallivm, uint_bld->type, reg_index);
 
    assert(swizzle < 4);
    switch (indirect_reg->File) {
@@ -858,6 +1334,27 @@ get_indirect_index(struct lp_build_tgsi_soa_context *bld,
       rel = uint_bld->zero;
    }
 
+   return rel;
+}
+
+
+static LLVMValueRef
+get_indirect_index(struct lp_build_tgsi_soa_context *bld,
+                   unsigned reg_file, unsigned reg_index,
+                   const struct tgsi_ind_register *indirect_reg)
+{
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   LLVMValueRef base;
+   LLVMValueRef rel;
+   LLVMValueRef max_index;
+   LLVMValueRef index;
+
+   assert(bld->indirect_files & (1 << reg_file));
+
+   base = lp_build_const_int_vec(bld->bld_base.base.gallivm, uint_bld->type, reg_index);
+
+   rel = load_indirect_reg(bld, indirect_reg);
+
    index = lp_build_add(uint_bld, base, rel);
 
    max_index = lp_build_const_int_vec(bld->bld_base.base.gallivm,
@@ -870,6 +1367,43 @@ get_indirect_index(struct lp_build_tgsi_soa_context *bld,
    return index;
 }
 
+
+/**
+ * Like get_indirect_index(), for an address that uniform_indirect() says is
+ * the same in all lanes: return it as a scalar, clamped only once.
+ */
+static LLVMValueRef
+get_uniform_indirect_index(struct lp_build_tgsi_soa_context *bld,
+                           unsigned reg_file, unsigned reg_index,
+                           const struct tgsi_ind_register *indirect_reg)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef rel;
+   LLVMValueRef max_index;
+   LLVMValueRef index;
+
+   assert(bld->indirect_files & (1 << reg_file));
+
+   rel = load_indirect_reg(bld, indirect_reg);
+   rel = LLVMBuildExtractElement(builder, rel,
+                                 lp_build_const_int32(gallivm, 0), "");
+
+   index = LLVMBuildAdd(builder, lp_build_const_int32(gallivm, reg_index),
+                        rel, "");
+
+   max_index = lp_build_const_int32(gallivm,
+                                    bld->bld_base.info->file_max[reg_file]);
+
+   /* unsigned, like lp_build_min() on uint_bld */
+   index = LLVMBuildSelect(builder,
+                           LLVMBuildICmp(builder, LLVMIntULT,
+                                         index, max_index, ""),
+                           index, max_index, "");
+
+   return index;
+}
+
 static struct lp_build_context *
 stype_to_fetch(struct lp_build_tgsi_context * bld_base,
 	       enum tgsi_opcode_type stype)
@@ -909,6 +1443,7 @@ emit_fetch_constant(
    LLVMBuilderRef builder = gallivm->builder;
    struct lp_build_context *uint_bld = &bld_base->uint_bld;
    LLVMValueRef indirect_index = NULL;
+   LLVMValueRef uniform_index = NULL;
    unsigned dimension = 0;
    LLVMValueRef dimension_index;
    LLVMValueRef consts_ptr;
@@ -927,13 +1462,22 @@ emit_fetch_constant(
    consts_ptr = lp_build_array_get(gallivm, bld->consts_ptr, dimension_index);
 
    if (reg->Register.Indirect) {
-      indirect_index = get_indirect_index(bld,
-                                          reg->Register.File,
-                                          reg->Register.Index,
-                                          &reg->Indirect);
+      if (uniform_indirect(bld, &reg->Indirect)) {
+         /* all lanes read the same constant, load it once */
+         uniform_index = get_uniform_indirect_index(bld,
+                                                    reg->Register.File,
+                                                    reg->Register.Index,
+                                                    &reg->Indirect);
+      }
+      else {
+         indirect_index = get_indirect_index(bld,
+                                             reg->Register.File,
+                                             reg->Register.Index,
+                                             &reg->Indirect);
+      }
    }
 
-   if (reg->Register.Indirect) {
+   if (indirect_index) {
       LLVMValueRef swizzle_vec =
          lp_build_const_int_vec(bld->bld_base.base.gallivm, uint_bld->type, swizzle);
       LLVMValueRef index_vec;  /* index into the const buffer */
@@ -949,7 +1493,16 @@ emit_fetch_constant(
       LLVMValueRef index;  /* index into the const buffer */
       LLVMValueRef scalar, scalar_ptr;
 
-      index = lp_build_const_int32(gallivm, reg->Register.Index*4 + swizzle);
+      if (uniform_index) {
+         /* index = uniform_index * 4 + swizzle */
+         index = LLVMBuildShl(builder, uniform_index,
+                              lp_build_const_int32(gallivm, 2), "");
+         index = LLVMBuildAdd(builder, index,
+                              lp_build_const_int32(gallivm, swizzle), "");
+      }
+      else {
+         index = lp_build_const_int32(gallivm, reg->Register.Index*4 + swizzle);
+      }
 
       scalar_ptr = LLVMBuildGEP(builder, consts_ptr,
                                 &index, 1, "");
@@ -979,14 +1532,28 @@ emit_fetch_immediate(
    LLVMValueRef res = NULL;
    LLVMValueRef indirect_index = NULL;
 
-   if (reg->Register.Indirect) {
+   if (reg->Register.Indirect && uniform_indirect(bld, &reg->Indirect)) {
+      /* the same immediate in all lanes, load its vector */
+      LLVMValueRef index = get_uniform_indirect_index(bld,
+                                                      reg->Register.File,
+                                                      reg->Register.Index,
+                                                      &reg->Indirect);
+      LLVMValueRef imm_ptr;
+
+      index = LLVMBuildShl(builder, index, lp_build_const_int32(gallivm, 2), "");
+      index = LLVMBuildAdd(builder, index,
+                           lp_build_const_int32(gallivm, swizzle), "");
+      imm_ptr = LLVMBuildGEP(builder, bld->imms_array, &index, 1, "");
+      res = LLVMBuildLoad(builder, imm_ptr, "");
+   }
+   else if (reg->Register.Indirect) {
       indirect_index = get_indirect_index(bld,
                                           reg->Register.File,
                                           reg->Register.Index,
                                           &reg->Indirect);
    }
 
-   if (reg->Register.Indirect) {
+   if (indirect_index) {
       LLVMValueRef swizzle_vec =
          lp_build_const_int_vec(bld->bld_base.base.gallivm,
                                 uint_bld->type, swizzle);
@@ -1021,7 +1588,7 @@ emit_fetch_immediate(
       /* Gather values from the temporary register array */
       res = build_gather(&bld_base->base, imms_array, index_vec);
    }
-   else {
+   else if (!res) {
       res = bld->immediates[reg->Register.Index][swizzle];
    }
 
@@ -2910,7 +3477,8 @@ if_emit(
 
    tmp = lp_build_cmp(&bld_base->base, PIPE_FUNC_NOTEQUAL,
                       emit_data->args[0], bld->bld_base.base.zero);
-   lp_exec_mask_cond_push(&bld->exec_mask, tmp);
+   lp_exec_if(&bld->exec_mask, tmp,
+              uniform_src(bld, &emit_data->inst->Src[0], TGSI_WRITEMASK_X));
 }
 
 static void
@@ -2925,7 +3493,8 @@ uif_emit(
 
    tmp = lp_build_cmp(uint_bld, PIPE_FUNC_NOTEQUAL,
                       emit_data->args[0], uint_bld->zero);
-   lp_exec_mask_cond_push(&bld->exec_mask, tmp);
+   lp_exec_if(&bld->exec_mask, tmp,
+              uniform_src(bld, &emit_data->inst->Src[0], TGSI_WRITEMASK_X));
 }
 
 static void
@@ -2936,7 +3505,11 @@ case_emit(
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
+   lp_exec_case_arm_end(&bld->exec_mask);
    lp_exec_case(&bld->exec_mask, emit_data->args[0]);
+   if (!bld->exec_mask.switch_in_default) {
+      lp_exec_case_arm_begin(&bld->exec_mask);
+   }
 }
 
 static void
@@ -2947,7 +3520,11 @@ default_emit(
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
+   lp_exec_case_arm_end(&bld->exec_mask);
    lp_exec_default(&bld->exec_mask, bld_base);
+   if (bld->exec_mask.switch_in_default && !bld->exec_mask.switch_pc) {
+      lp_exec_case_arm_begin(&bld->exec_mask);
+   }
 }
 
 static void
@@ -2969,6 +3546,7 @@ endswitch_emit(
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
+   lp_exec_case_arm_end(&bld->exec_mask);
    lp_exec_endswitch(&bld->exec_mask, bld_base);
 }
 
@@ -3002,7 +3580,7 @@ else_emit(
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
-   lp_exec_mask_cond_invert(&bld->exec_mask);
+   lp_exec_else(&bld->exec_mask);
 }
 
 static void
@@ -3013,7 +3591,7 @@ endif_emit(
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
-   lp_exec_mask_cond_pop(&bld->exec_mask);
+   lp_exec_endif(&bld->exec_mask);
 }
 
 static void
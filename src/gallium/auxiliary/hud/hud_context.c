@@ -40,6 +40,7 @@
 #include "hud/font.h"
 
 #include "cso_cache/cso_context.h"
+#include "util/u_counter.h"
 #include "util/u_draw_quad.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
@@ -783,6 +784,10 @@ hud_parse_env_var(struct hud_context *hud, const char *env)
             }
          }
 
+         /* driver-internal counters */
+         if (!processed)
+            processed = hud_counter_install(pane, name);
+
          /* driver queries */
          if (!processed) {
             if (!hud_driver_query_install(pane, hud->pipe, name)){
@@ -902,6 +907,9 @@ print_help(struct pipe_screen *screen)
       puts("    cs-invocations");
    }
 
+   for (i = 0; i < UTIL_COUNTER_COUNT; i++)
+      printf("    %s\n", util_counter_get_info(i)->name);
+
    if (screen->get_driver_query_info){
       struct pipe_driver_query_info info;
       num_queries = screen->get_driver_query_info(screen, 0, NULL);
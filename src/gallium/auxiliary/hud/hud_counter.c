@@ -0,0 +1,122 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* This file contains code for displaying the driver-internal counters of
+ * util/u_counter.h on the HUD.
+ */
+
+#include "hud/hud_private.h"
+#include "os/os_time.h"
+#include "util/u_counter.h"
+#include "util/u_memory.h"
+
+struct counter_info {
+   enum util_counter_id id;
+   int32_t last_value;
+   uint64_t last_time;
+   uint64_t cumulative;
+   unsigned num_frames;
+};
+
+static void
+query_counter(struct hud_graph *gr)
+{
+   struct counter_info *info = gr->query_data;
+   enum util_counter_type type = util_counter_get_info(info->id)->type;
+   int32_t value;
+   uint64_t now = os_time_get();
+
+   if (type == UTIL_COUNTER_TYPE_LEVEL || type == UTIL_COUNTER_TYPE_MEMORY) {
+      if (info->last_time + gr->pane->period <= now) {
+         hud_graph_add_value(gr, util_counter_get_level(info->id));
+         info->last_time = now;
+      }
+      return;
+   }
+
+   value = p_atomic_read(&util_counters[info->id]);
+
+   if (info->last_time) {
+      /* the counters wrap, differences don't */
+      info->cumulative += (uint32_t) (value - info->last_value);
+      info->num_frames++;
+
+      if (info->last_time + gr->pane->period <= now) {
+         /* average per frame */
+         hud_graph_add_value(gr, info->cumulative / info->num_frames);
+
+         info->last_time = now;
+         info->cumulative = 0;
+         info->num_frames = 0;
+      }
+   }
+   else {
+      /* initialize */
+      info->last_time = now;
+   }
+
+   info->last_value = value;
+}
+
+static void
+free_query_data(void *p)
+{
+   FREE(p);
+}
+
+boolean
+hud_counter_install(struct hud_pane *pane, const char *name)
+{
+   struct hud_graph *gr;
+   struct counter_info *info;
+   int id = util_counter_find(name);
+
+   if (id < 0)
+      return FALSE;
+
+   gr = CALLOC_STRUCT(hud_graph);
+   if (!gr)
+      return FALSE;
+
+   strcpy(gr->name, name);
+   gr->query_data = CALLOC_STRUCT(counter_info);
+   if (!gr->query_data) {
+      FREE(gr);
+      return FALSE;
+   }
+
+   gr->query_new_value = query_counter;
+   gr->free_query_data = free_query_data;
+
+   info = gr->query_data;
+   info->id = id;
+
+   util_counters_enable();
+
+   hud_pane_add_graph(pane, gr);
+   if (util_counter_get_info(id)->type == UTIL_COUNTER_TYPE_BYTES ||
+       util_counter_get_info(id)->type == UTIL_COUNTER_TYPE_MEMORY)
+      pane->uses_byte_units = TRUE;
+   return TRUE;
+}
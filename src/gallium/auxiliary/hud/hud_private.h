@@ -88,5 +88,6 @@ void hud_pipe_query_install(struct hud_pane *pane, struct pipe_context *pipe,
                             uint64_t max_value, boolean uses_byte_units);
 boolean hud_driver_query_install(struct hud_pane *pane,
                                  struct pipe_context *pipe, const char *name);
+boolean hud_counter_install(struct hud_pane *pane, const char *name);
 
 #endif
@@ -75,6 +75,8 @@ def prolog():
 #include "util/u_debug.h"
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_sse.h"
 
 
 static unsigned out_size_idx( unsigned index_size )
@@ -124,20 +126,30 @@ def tri( intype, outtype, ptr, v0, v1, v2 ):
 def do_point( intype, outtype, ptr, v0 ):
     point( intype, outtype, ptr, v0 )
 
-def do_line( intype, outtype, ptr, v0, v1, inpv, outpv ):
+def line_order( inpv, outpv ):
     if inpv == outpv:
-        line( intype, outtype, ptr, v0, v1 )
+        return (0, 1)
     else:
-        line( intype, outtype, ptr, v1, v0 )
+        return (1, 0)
 
-def do_tri( intype, outtype, ptr, v0, v1, v2, inpv, outpv ):
+def tri_order( inpv, outpv ):
     if inpv == outpv:
-        tri( intype, outtype, ptr, v0, v1, v2 )
-    else: 
+        return (0, 1, 2)
+    else:
         if inpv == FIRST:
-            tri( intype, outtype, ptr, v1, v2, v0 )
+            return (1, 2, 0)
         else:
-            tri( intype, outtype, ptr, v2, v0, v1 )
+            return (2, 0, 1)
+
+def do_line( intype, outtype, ptr, v0, v1, inpv, outpv ):
+    v = (v0, v1)
+    order = line_order( inpv, outpv )
+    line( intype, outtype, ptr, v[order[0]], v[order[1]] )
+
+def do_tri( intype, outtype, ptr, v0, v1, v2, inpv, outpv ):
+    v = (v0, v1, v2)
+    order = tri_order( inpv, outpv )
+    tri( intype, outtype, ptr, v[order[0]], v[order[1]], v[order[2]] )
 
 def do_quad( intype, outtype, ptr, v0, v1, v2, v3, inpv, outpv ):
     do_tri( intype, outtype, ptr+'+0',  v0, v1, v3, inpv, outpv );
@@ -166,16 +178,159 @@ def postamble():
     print '}'
 
 
+INDEX_SIZE = dict(ubyte=1, ushort=2, uint=4)
+
+def simd_pattern(prim, inpv, outpv):
+    '''Return the number of input indices of each primitive and, for each
+    output index of the primitive, the input index it is copied from.'''
+    if prim == 'points':
+        return 1, (0,)
+    if prim == 'lines':
+        return 2, line_order( inpv, outpv )
+    if prim == 'tris':
+        return 3, tri_order( inpv, outpv )
+    if prim == 'quads':
+        order = tri_order( inpv, outpv )
+        t0, t1 = (0, 1, 3), (1, 2, 3)
+        return 4, tuple([t0[k] for k in order] + [t1[k] for k in order])
+    return None
+
+def has_simd(intype, outtype, prim):
+    '''Only the translations u_index_translator() picks, for the primitives
+    that map a fixed number of input indices to a fixed number of output
+    indices.'''
+    if intype == GENERATE or simd_pattern(prim, FIRST, FIRST) is None:
+        return False
+    if intype == UINT:
+        return outtype == UINT
+    return outtype == USHORT
+
+def simd_block(intype, outtype, inpv, outpv, prim):
+    '''Return the number of input and output indices of the smallest run
+    of primitives filling whole registers on both sides.'''
+    stride, pattern = simd_pattern(prim, inpv, outpv)
+    n = 1
+    while ((n * stride * INDEX_SIZE[intype]) % 16 or
+           (n * len(pattern) * INDEX_SIZE[outtype]) % 16):
+        n += 1
+    return n * stride, n * len(pattern)
+
+def simd_is_identity(prim, inpv, outpv):
+    stride, pattern = simd_pattern(prim, inpv, outpv)
+    return stride == len(pattern) and list(pattern) == range(stride)
+
+def simd_name(intype, outtype, inpv, outpv, prim):
+    return name( intype, outtype, inpv, outpv, prim ) + '_sse'
+
+def simd_shuffles(intype, outtype, inpv, outpv, prim):
+    '''For each output register, return the pshufb masks to apply to each
+    input register it takes bytes from.  Bytes widening an index are
+    zeroed by all the masks.'''
+    stride, pattern = simd_pattern(prim, inpv, outpv)
+    in_size, out_size = INDEX_SIZE[intype], INDEX_SIZE[outtype]
+    in_block, out_block = simd_block(intype, outtype, inpv, outpv, prim)
+    regs = []
+    for reg in range(out_block * out_size / 16):
+        masks = {}
+        for byte in range(16):
+            index, k = divmod(reg*16 + byte, out_size)
+            p, t = divmod(index, len(pattern))
+            if k < in_size:
+                src = (p*stride + pattern[t])*in_size + k
+                masks.setdefault(src / 16, ['-128']*16)[byte] = str(src % 16)
+        regs.append(sorted(masks.items()))
+    return regs
+
+def simd_kernel(intype, outtype, inpv, outpv, prim):
+    '''Emit the SSE function translating whole blocks of indices.  Blocks
+    kept in order only need SSE2, the others are reordered with pshufb.
+    Returns whether the function was emitted.'''
+    if not has_simd(intype, outtype, prim):
+        return False
+    in_block, out_block = simd_block(intype, outtype, inpv, outpv, prim)
+    in_regs = in_block * INDEX_SIZE[intype] / 16
+    identity = simd_is_identity(prim, inpv, outpv)
+    print '#if defined(PIPE_ARCH_SSE)'
+    print 'static INLINE void ' + simd_name( intype, outtype, inpv, outpv, prim ) + '('
+    print '    const ' + intype + ' *in,'
+    print '    unsigned blocks,'
+    print '    ' + outtype + ' *out )'
+    print '{'
+    stores = []
+    if identity:
+        if intype == outtype:
+            for reg in range(in_regs):
+                stores.append('in%u' % reg)
+        else:
+            print '  const __m128i zero = _mm_setzero_si128();'
+            for reg in range(in_regs):
+                stores.append('_mm_unpacklo_epi8(in%u, zero)' % reg)
+                stores.append('_mm_unpackhi_epi8(in%u, zero)' % reg)
+    else:
+        num_shuffles = 0
+        for masks in simd_shuffles(intype, outtype, inpv, outpv, prim):
+            terms = []
+            for reg, mask in masks:
+                print '  const __m128i shuffle%u = _mm_setr_epi8(%s);' % (num_shuffles, ', '.join(mask))
+                terms.append('_mm_shuffle_epi8(in%u, shuffle%u)' % (reg, num_shuffles))
+                num_shuffles += 1
+            expr = terms[0]
+            for term in terms[1:]:
+                expr = '_mm_or_si128(' + expr + ', ' + term + ')'
+            stores.append(expr)
+    print '  unsigned k;'
+    print '  for (k = 0; k < blocks; k++) {'
+    for reg in range(in_regs):
+        print '    const __m128i in%u = _mm_loadu_si128((const __m128i *)in + %u);' % (reg, reg)
+    for reg in range(len(stores)):
+        print '    _mm_storeu_si128((__m128i *)out + %u, %s);' % (reg, stores[reg])
+    print '    in += %u;' % in_block
+    print '    out += %u;' % out_block
+    print '  }'
+    print '}'
+    print '#endif'
+    print
+    return True
+
+def simd_call(intype, outtype, inpv, outpv, prim):
+    '''Translate as many whole blocks as possible with the SSE function,
+    leaving the rest to the scalar loop.'''
+    in_block, out_block = simd_block(intype, outtype, inpv, outpv, prim)
+    if simd_is_identity(prim, inpv, outpv):
+        cap = 'has_sse2'
+    else:
+        cap = 'has_ssse3'
+    print '  i = j = 0;'
+    print '#if defined(PIPE_ARCH_SSE)'
+    print '  if (util_cpu_caps.' + cap + ') {'
+    print '    unsigned blocks = nr / %u;' % out_block
+    print '    ' + simd_name( intype, outtype, inpv, outpv, prim ) + '(in, blocks, out);'
+    print '    i = blocks * %u;' % in_block
+    print '    j = blocks * %u;' % out_block
+    print '  }'
+    print '#endif'
+
+
 def points(intype, outtype, inpv, outpv):
+    simd = simd_kernel(intype, outtype, inpv, outpv, prim='points')
     preamble(intype, outtype, inpv, outpv, prim='points')
-    print '  for (i = 0; i < nr; i++) { '
+    if simd:
+        simd_call(intype, outtype, inpv, outpv, prim='points')
+        print '  for (; i < nr; i++) { '
+    else:
+        print '  for (i = 0; i < nr; i++) { '
     do_point( intype, outtype, 'out+i',  'i' );
     print '   }'
     postamble()
 
 def lines(intype, outtype, inpv, outpv):
+    simd = simd_kernel(intype, outtype, inpv, outpv, prim='lines')
     preamble(intype, outtype, inpv, outpv, prim='lines')
-    print '  for (i = 0; i < nr; i+=2) { '
+    if simd:
+        simd_call(intype, outtype, inpv, outpv, prim='lines')
+        print '  for (; i < nr; i+=2) { '
+    else:
+        print '  for (i = 0; i < nr; i+=2) { '
     do_line( intype, outtype, 'out+i',  'i', 'i+1', inpv, outpv );
     print '   }'
     postamble()
@@ -196,8 +351,13 @@ def lineloop(intype, outtype, inpv, outpv):
     postamble()
 
 def tris(intype, outtype, inpv, outpv):
+    simd = simd_kernel(intype, outtype, inpv, outpv, prim='tris')
     preamble(intype, outtype, inpv, outpv, prim='tris')
-    print '  for (i = 0; i < nr; i+=3) { '
+    if simd:
+        simd_call(intype, outtype, inpv, outpv, prim='tris')
+        print '  for (; i < nr; i+=3) { '
+    else:
+        print '  for (i = 0; i < nr; i+=3) { '
     do_tri( intype, outtype, 'out+i',  'i', 'i+1', 'i+2', inpv, outpv );
     print '   }'
     postamble()
@@ -235,8 +395,13 @@ def polygon(intype, outtype, inpv, outpv):
 
 
 def quads(intype, outtype, inpv, outpv):
+    simd = simd_kernel(intype, outtype, inpv, outpv, prim='quads')
     preamble(intype, outtype, inpv, outpv, prim='quads')
-    print '  for (j = i = 0; j < nr; j+=6, i+=4) { '
+    if simd:
+        simd_call(intype, outtype, inpv, outpv, prim='quads')
+        print '  for (; j < nr; j+=6, i+=4) { '
+    else:
+        print '  for (j = i = 0; j < nr; j+=6, i+=4) { '
     do_quad( intype, outtype, 'out+j', 'i+0', 'i+1', 'i+2', 'i+3', inpv, outpv );
     print '   }'
     postamble()
@@ -298,6 +463,7 @@ def emit_init():
     print '  static int firsttime = 1;'
     print '  if (!firsttime) return;'
     print '  firsttime = 0;'
+    print '  util_cpu_detect();'
     emit_all_inits()
     print '}'
 
@@ -45,6 +45,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_debug.h"
 #include "os/os_thread.h"
+#include "os/os_time.h"
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
 
@@ -98,6 +99,18 @@ struct fenced_manager
     * How much temporary CPU memory is being used to hold unvalidated buffers.
     */
    pb_size cpu_total_size;
+
+   struct pb_fenced_stats stats;
+
+   /**
+    * Optional thread waiting on the oldest fence and releasing the buffers
+    * as their fences expire, so that the other threads rarely have to.
+    */
+   boolean has_reaper;
+   boolean reaper_quit;
+   pipe_thread reaper;
+   /** Signalled when a buffer is fenced, or to make the reaper quit */
+   pipe_condvar reaper_cond;
 };
 
 
@@ -280,6 +293,9 @@ fenced_buffer_add_locked(struct fenced_manager *fenced_mgr,
    --fenced_mgr->num_unfenced;
    LIST_ADDTAIL(&fenced_buf->head, &fenced_mgr->fenced);
    ++fenced_mgr->num_fenced;
+
+   if (fenced_mgr->has_reaper && fenced_mgr->num_fenced == 1)
+      pipe_condvar_signal(fenced_mgr->reaper_cond);
 }
 
 
@@ -344,15 +360,20 @@ fenced_buffer_finish_locked(struct fenced_manager *fenced_mgr,
       struct pipe_fence_handle *fence = NULL;
       int finished;
       boolean proceed;
+      int64_t start;
 
       ops->fence_reference(ops, &fence, fenced_buf->fence);
+      ++fenced_mgr->stats.stalls;
 
       pipe_mutex_unlock(fenced_mgr->mutex);
 
-      finished = ops->fence_finish(ops, fenced_buf->fence, 0);
+      start = os_time_get();
+      finished = ops->fence_finish(ops, fence, 0);
 
       pipe_mutex_lock(fenced_mgr->mutex);
 
+      fenced_mgr->stats.stall_usecs += os_time_get() - start;
+
       assert(pipe_is_referenced(&fenced_buf->base.reference));
 
       /*
@@ -411,8 +432,13 @@ fenced_manager_check_signalled_locked(struct fenced_manager *fenced_mgr,
 	 int signaled;
 
 	 if (wait) {
+	    int64_t start = os_time_get();
+
 	    signaled = ops->fence_finish(ops, fenced_buf->fence, 0);
 
+	    ++fenced_mgr->stats.stalls;
+	    fenced_mgr->stats.stall_usecs += os_time_get() - start;
+
 	    /*
 	     * Don't return just now. Instead preemptively check if the
 	     * following buffers' fences already expired, without further waits.
@@ -448,6 +474,52 @@ fenced_manager_check_signalled_locked(struct fenced_manager *fenced_mgr,
 }
 
 
+/**
+ * Reaper thread: wait for the oldest fence without holding the mutex, then
+ * release every buffer whose fence has expired.
+ */
+static PIPE_THREAD_ROUTINE(fenced_manager_reaper, param)
+{
+   struct fenced_manager *fenced_mgr = (struct fenced_manager *)param;
+   struct pb_fence_ops *ops = fenced_mgr->ops;
+
+   pipe_mutex_lock(fenced_mgr->mutex);
+
+   while (!fenced_mgr->reaper_quit) {
+      struct pipe_fence_handle *fence = NULL;
+      struct fenced_buffer *fenced_buf;
+      pb_size num_fenced;
+      int finished;
+
+      if (!fenced_mgr->num_fenced) {
+         pipe_condvar_wait(fenced_mgr->reaper_cond, fenced_mgr->mutex);
+         continue;
+      }
+
+      fenced_buf = LIST_ENTRY(struct fenced_buffer,
+                              fenced_mgr->fenced.next, head);
+      ops->fence_reference(ops, &fence, fenced_buf->fence);
+
+      pipe_mutex_unlock(fenced_mgr->mutex);
+      finished = ops->fence_finish(ops, fence, 0);
+      ops->fence_reference(ops, &fence, NULL);
+      if (finished != 0) {
+         /* Lost device or similar; don't spin. */
+         os_time_sleep(1000);
+      }
+      pipe_mutex_lock(fenced_mgr->mutex);
+
+      num_fenced = fenced_mgr->num_fenced;
+      fenced_manager_check_signalled_locked(fenced_mgr, FALSE);
+      fenced_mgr->stats.reaped += num_fenced - fenced_mgr->num_fenced;
+   }
+
+   pipe_mutex_unlock(fenced_mgr->mutex);
+
+   return 0;
+}
+
+
 /**
  * Try to free some GPU memory by backing it up into CPU memory.
  *
@@ -999,11 +1071,37 @@ fenced_bufmgr_flush(struct pb_manager *mgr)
 }
 
 
+/**
+ * Get the fence waiting statistics of a manager created by
+ * fenced_bufmgr_create().
+ */
+void
+fenced_bufmgr_get_stats(struct pb_manager *mgr,
+                        struct pb_fenced_stats *stats)
+{
+   struct fenced_manager *fenced_mgr = fenced_manager(mgr);
+
+   pipe_mutex_lock(fenced_mgr->mutex);
+   *stats = fenced_mgr->stats;
+   pipe_mutex_unlock(fenced_mgr->mutex);
+}
+
+
 static void
 fenced_bufmgr_destroy(struct pb_manager *mgr)
 {
    struct fenced_manager *fenced_mgr = fenced_manager(mgr);
 
+   if (fenced_mgr->has_reaper) {
+      pipe_mutex_lock(fenced_mgr->mutex);
+      fenced_mgr->reaper_quit = TRUE;
+      pipe_condvar_signal(fenced_mgr->reaper_cond);
+      pipe_mutex_unlock(fenced_mgr->mutex);
+
+      pipe_thread_wait(fenced_mgr->reaper);
+      pipe_condvar_destroy(fenced_mgr->reaper_cond);
+   }
+
    pipe_mutex_lock(fenced_mgr->mutex);
 
    /* Wait on outstanding fences */
@@ -1033,6 +1131,9 @@ fenced_bufmgr_destroy(struct pb_manager *mgr)
 }
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(fence_reaper, "GALLIUM_FENCE_REAPER", FALSE)
+
+
 struct pb_manager *
 fenced_bufmgr_create(struct pb_manager *provider,
                      struct pb_fence_ops *ops,
@@ -1065,5 +1166,12 @@ fenced_bufmgr_create(struct pb_manager *provider,
 
    pipe_mutex_init(fenced_mgr->mutex);
 
+   if (debug_get_option_fence_reaper()) {
+      pipe_condvar_init(fenced_mgr->reaper_cond);
+      fenced_mgr->reaper = pipe_thread_create(fenced_manager_reaper,
+                                              fenced_mgr);
+      fenced_mgr->has_reaper = TRUE;
+   }
+
    return &fenced_mgr->base;
 }
@@ -133,6 +133,22 @@ mm_bufmgr_create_from_buffer(struct pb_buffer *buffer,
                              pb_size size, pb_size align2);
 
 
+/**
+ * Occupancy of a slab sub-allocator.
+ */
+struct pb_slab_stats
+{
+   pb_size bufSize;
+   pb_size numSlabs;
+   /** Buffers in all the slabs, used or not */
+   pb_size numBuffers;
+   pb_size numUsed;
+   pb_size maxUsed;
+   uint64_t slabsCreated;
+   uint64_t slabsDestroyed;
+};
+
+
 /**
  * Slab sub-allocator.
  */
@@ -142,6 +158,10 @@ pb_slab_manager_create(struct pb_manager *provider,
                        pb_size slabSize,
                        const struct pb_desc *desc);
 
+void
+pb_slab_manager_get_stats(struct pb_manager *mgr,
+                          struct pb_slab_stats *stats);
+
 /**
  * Allow a range of buffer size, by aggregating multiple slabs sub-allocators 
  * with different bucket sizes.
@@ -153,6 +173,11 @@ pb_slab_range_manager_create(struct pb_manager *provider,
                              pb_size slabSize,
                              const struct pb_desc *desc);
 
+unsigned
+pb_slab_range_manager_get_stats(struct pb_manager *mgr,
+                                struct pb_slab_stats *stats,
+                                unsigned max_stats);
+
 
 /** 
  * Time-based buffer cache.
@@ -161,7 +186,22 @@ pb_slab_range_manager_create(struct pb_manager *provider,
  */
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
-                     	unsigned usecs); 
+                     	unsigned usecs,
+                        pb_size maximum_cache_size); 
+
+
+struct pb_cache_stats
+{
+   uint64_t hits;  /**< buffers created from the cache */
+   uint64_t misses;  /**< buffers created by the provider */
+   uint64_t evictions;  /**< buffers freed before expiring to stay in size */
+   uint64_t bytes;  /**< size of the cached buffers */
+   unsigned num_buffers;  /**< number of cached buffers */
+};
+
+void
+pb_cache_manager_get_stats(struct pb_manager *mgr,
+                           struct pb_cache_stats *stats);
 
 
 struct pb_fence_ops;
@@ -182,6 +222,25 @@ fenced_bufmgr_create(struct pb_manager *provider,
                      pb_size max_cpu_total_size);
 
 
+/**
+ * How often the threads using a fenced buffer manager had to wait for
+ * the GPU.
+ */
+struct pb_fenced_stats
+{
+   /** Waits for a fence in map, validate or create_buffer */
+   uint64_t stalls;
+   uint64_t stall_usecs;
+   /** Buffers released by the GALLIUM_FENCE_REAPER thread */
+   uint64_t reaped;
+};
+
+
+void
+fenced_bufmgr_get_stats(struct pb_manager *mgr,
+                        struct pb_fenced_stats *stats);
+
+
 struct pb_manager *
 pb_alt_manager_create(struct pb_manager *provider1, 
                       struct pb_manager *provider2);
@@ -28,6 +28,10 @@
 /**
  * \file
  * Buffer cache.
+ *
+ * Destroyed buffers are kept for a while on a list ordered by age, to
+ * expire and evict them oldest first, and on the list of their size class
+ * (power of two), to find a buffer of a given size in O(1).
  * 
  * \author Jose Fonseca <jrfonseca-at-tungstengraphics-dot-com>
  * \author Thomas Hellström <thomas-at-tungstengraphics-dot-com>
@@ -37,6 +41,7 @@
 #include "pipe/p_compiler.h"
 #include "util/u_debug.h"
 #include "os/os_thread.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
 #include "util/u_time.h"
@@ -51,6 +56,10 @@
 #define SUPER(__derived) (&(__derived)->base)
 
 
+/** One bucket per power of two of the buffer size */
+#define PB_CACHE_NUM_BUCKETS 32
+
+
 struct pb_cache_manager;
 
 
@@ -67,7 +76,8 @@ struct pb_cache_buffer
    /** Caching time interval */
    int64_t start, end;
 
-   struct list_head head;
+   struct list_head head;  /**< in pb_cache_manager::delayed */
+   struct list_head bucket_head;  /**< in pb_cache_manager::buckets */
 };
 
 
@@ -77,11 +87,18 @@ struct pb_cache_manager
 
    struct pb_manager *provider;
    unsigned usecs;
+   pb_size maximum_cache_size;
    
    pipe_mutex mutex;
    
+   /** All the cached buffers, oldest first */
    struct list_head delayed;
    pb_size numDelayed;
+
+   /** The cached buffers by util_logbase2() of their size, oldest first */
+   struct list_head buckets[PB_CACHE_NUM_BUCKETS];
+
+   struct pb_cache_stats stats;
 };
 
 
@@ -110,8 +127,10 @@ _pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
    struct pb_cache_manager *mgr = buf->mgr;
 
    LIST_DEL(&buf->head);
+   LIST_DEL(&buf->bucket_head);
    assert(mgr->numDelayed);
    --mgr->numDelayed;
+   mgr->stats.bytes -= buf->base.size;
    assert(!pipe_is_referenced(&buf->base.reference));
    pb_reference(&buf->buffer, NULL);
    FREE(buf);
@@ -156,11 +175,31 @@ pb_cache_buffer_destroy(struct pb_buffer *_buf)
    assert(!pipe_is_referenced(&buf->base.reference));
    
    _pb_cache_buffer_list_check_free(mgr);
+
+   if (mgr->maximum_cache_size) {
+      if (buf->base.size > mgr->maximum_cache_size) {
+         pipe_mutex_unlock(mgr->mutex);
+         pb_reference(&buf->buffer, NULL);
+         FREE(buf);
+         return;
+      }
+
+      /* Make room by evicting the oldest buffers. */
+      while (mgr->stats.bytes + buf->base.size > mgr->maximum_cache_size) {
+         struct pb_cache_buffer *oldest =
+            LIST_ENTRY(struct pb_cache_buffer, mgr->delayed.next, head);
+         _pb_cache_buffer_destroy(oldest);
+         mgr->stats.evictions++;
+      }
+   }
    
    buf->start = os_time_get();
    buf->end = buf->start + mgr->usecs;
    LIST_ADDTAIL(&buf->head, &mgr->delayed);
+   LIST_ADDTAIL(&buf->bucket_head,
+                &mgr->buckets[util_logbase2(MAX2(buf->base.size, 1))]);
    ++mgr->numDelayed;
+   mgr->stats.bytes += buf->base.size;
    pipe_mutex_unlock(mgr->mutex);
 }
 
@@ -256,6 +295,36 @@ pb_cache_is_buffer_compat(struct pb_cache_buffer *buf,
 }
 
 
+/**
+ * Find an idle buffer suitable for (size, desc) in the bucket, oldest
+ * first.  Stops at the first busy one, as the newer ones will most
+ * likely be busy too.
+ */
+static struct pb_cache_buffer *
+pb_cache_bucket_find(struct pb_cache_manager *mgr,
+                     unsigned bucket,
+                     pb_size size,
+                     const struct pb_desc *desc)
+{
+   struct list_head *curr;
+
+   for (curr = mgr->buckets[bucket].next;
+        curr != &mgr->buckets[bucket];
+        curr = curr->next) {
+      struct pb_cache_buffer *buf =
+         LIST_ENTRY(struct pb_cache_buffer, curr, bucket_head);
+      int ret = pb_cache_is_buffer_compat(buf, size, desc);
+
+      if (ret > 0)
+         return buf;
+      if (ret < 0)
+         break;
+   }
+
+   return NULL;
+}
+
+
 static struct pb_buffer *
 pb_cache_manager_create_buffer(struct pb_manager *_mgr, 
                                pb_size size,
@@ -263,60 +332,33 @@ pb_cache_manager_create_buffer(struct pb_manager *_mgr,
 {
    struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
    struct pb_cache_buffer *buf;
-   struct pb_cache_buffer *curr_buf;
-   struct list_head *curr, *next;
-   int64_t now;
-   int ret = 0;
+   unsigned bucket;
 
    pipe_mutex_lock(mgr->mutex);
 
-   buf = NULL;
-   curr = mgr->delayed.next;
-   next = curr->next;
-   
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while(curr != &mgr->delayed) {
-      curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      if(!buf && (ret = pb_cache_is_buffer_compat(curr_buf, size, desc) > 0))
-         buf = curr_buf;
-      else if(os_time_timeout(curr_buf->start, curr_buf->end, now))
-         _pb_cache_buffer_destroy(curr_buf);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
-      if (ret == -1)
-         break;
-      curr = next; 
-      next = curr->next;
-   }
+   _pb_cache_buffer_list_check_free(mgr);
 
-   /* keep searching in the hot buffers */
-   if(!buf && ret != -1) {
-      while(curr != &mgr->delayed) {
-         curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-         ret = pb_cache_is_buffer_compat(curr_buf, size, desc);
-         if (ret > 0) {
-            buf = curr_buf;
-            break;
-         }
-         if (ret == -1)
-            break;
-         /* no need to check the timeout here */
-         curr = next;
-         next = curr->next;
-      }
-   }
+   /* Buffers of [size, 2*size) are either in the bucket of size or in the
+    * next one.
+    */
+   bucket = util_logbase2(MAX2(size, 1));
+   buf = pb_cache_bucket_find(mgr, bucket, size, desc);
+   if (!buf && bucket + 1 < PB_CACHE_NUM_BUCKETS)
+      buf = pb_cache_bucket_find(mgr, bucket + 1, size, desc);
    
    if(buf) {
       LIST_DEL(&buf->head);
+      LIST_DEL(&buf->bucket_head);
       --mgr->numDelayed;
+      mgr->stats.bytes -= buf->base.size;
+      mgr->stats.hits++;
       pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->base.reference, 1);
       return &buf->base;
    }
    
+   mgr->stats.misses++;
    pipe_mutex_unlock(mgr->mutex);
 
    buf = CALLOC_STRUCT(pb_cache_buffer);
@@ -377,6 +419,23 @@ pb_cache_manager_flush(struct pb_manager *_mgr)
 }
 
 
+/**
+ * Get the hit/miss counters and the amount of memory held by a manager
+ * created by pb_cache_manager_create().
+ */
+void
+pb_cache_manager_get_stats(struct pb_manager *_mgr,
+                           struct pb_cache_stats *stats)
+{
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+
+   pipe_mutex_lock(mgr->mutex);
+   *stats = mgr->stats;
+   stats->num_buffers = mgr->numDelayed;
+   pipe_mutex_unlock(mgr->mutex);
+}
+
+
 static void
 pb_cache_manager_destroy(struct pb_manager *mgr)
 {
@@ -385,11 +444,17 @@ pb_cache_manager_destroy(struct pb_manager *mgr)
 }
 
 
+/**
+ * \param maximum_cache_size  most bytes of idle buffers to keep, or 0 for
+ *                            no limit
+ */
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
-                     	unsigned usecs) 
+                     	unsigned usecs,
+                        pb_size maximum_cache_size) 
 {
    struct pb_cache_manager *mgr;
+   unsigned i;
 
    if(!provider)
       return NULL;
@@ -403,8 +468,11 @@ pb_cache_manager_create(struct pb_manager *provider,
    mgr->base.flush = pb_cache_manager_flush;
    mgr->provider = provider;
    mgr->usecs = usecs;
+   mgr->maximum_cache_size = maximum_cache_size;
    LIST_INITHEAD(&mgr->delayed);
    mgr->numDelayed = 0;
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+      LIST_INITHEAD(&mgr->buckets[i]);
    pipe_mutex_init(mgr->mutex);
       
    return &mgr->base;
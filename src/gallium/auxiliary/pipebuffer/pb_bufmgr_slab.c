@@ -40,6 +40,7 @@
 #include "util/u_debug.h"
 #include "os/os_thread.h"
 #include "pipe/p_defines.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
 #include "util/u_time.h"
@@ -62,8 +63,6 @@ struct pb_slab_buffer
    
    struct pb_slab *slab;
    
-   struct list_head head;
-   
    unsigned mapCount;
    
    /** Offset relative to the start of the slab buffer. */
@@ -81,9 +80,16 @@ struct pb_slab_buffer
 struct pb_slab
 {
    struct list_head head;
-   struct list_head freeBuffers;
    pb_size numBuffers;
    pb_size numFree;
+
+   /**
+    * One bit per buffer, set if free.  Buffers are handed out lowest
+    * address first, which keeps the used ones together.
+    */
+   uint32_t *freeMask;
+   /** No free buffer in the words before this one */
+   unsigned firstFreeWord;
    
    struct pb_slab_buffer *buffers;
    struct pb_slab_manager *mgr;
@@ -127,7 +133,11 @@ struct pb_slab_manager
     * immediatly.
     */
    struct list_head slabs;
+
+   /** Occupancy, for tuning the buffer and slab sizes */
+   struct pb_slab_stats stats;
    
+   /** Protects slabs and stats; each size has its own manager and mutex */
    pipe_mutex mutex;
 };
 
@@ -187,9 +197,24 @@ pb_slab_range_manager(struct pb_manager *mgr)
 }
 
 
+static void
+pb_slab_free(struct pb_slab *slab)
+{
+   pb_size i;
+
+   for (i = 0; i < slab->numBuffers; ++i)
+      pipe_condvar_destroy(slab->buffers[i].event);
+
+   pb_reference(&slab->bo, NULL);
+   FREE(slab->freeMask);
+   FREE(slab->buffers);
+   FREE(slab);
+}
+
+
 /**
- * Delete a buffer from the slab delayed list and put
- * it on the slab FREE list.
+ * Mark the buffer free in its slab, putting the slab back on the partial
+ * list, or freeing it once empty.
  */
 static void
 pb_slab_buffer_destroy(struct pb_buffer *_buf)
@@ -197,7 +222,8 @@ pb_slab_buffer_destroy(struct pb_buffer *_buf)
    struct pb_slab_buffer *buf = pb_slab_buffer(_buf);
    struct pb_slab *slab = buf->slab;
    struct pb_slab_manager *mgr = slab->mgr;
-   struct list_head *list = &buf->head;
+   unsigned index = buf - slab->buffers;
+   boolean empty = FALSE;
 
    pipe_mutex_lock(mgr->mutex);
    
@@ -205,23 +231,29 @@ pb_slab_buffer_destroy(struct pb_buffer *_buf)
    
    buf->mapCount = 0;
 
-   LIST_DEL(list);
-   LIST_ADDTAIL(list, &slab->freeBuffers);
+   assert(!(slab->freeMask[index / 32] & (1u << (index % 32))));
+   slab->freeMask[index / 32] |= 1u << (index % 32);
+   slab->firstFreeWord = MIN2(slab->firstFreeWord, index / 32);
    slab->numFree++;
+   mgr->stats.numUsed--;
 
    if (slab->head.next == &slab->head)
       LIST_ADDTAIL(&slab->head, &mgr->slabs);
 
    /* If the slab becomes totally empty, free it */
    if (slab->numFree == slab->numBuffers) {
-      list = &slab->head;
-      LIST_DELINIT(list);
-      pb_reference(&slab->bo, NULL);
-      FREE(slab->buffers);
-      FREE(slab);
+      LIST_DELINIT(&slab->head);
+      mgr->stats.numSlabs--;
+      mgr->stats.numBuffers -= slab->numBuffers;
+      mgr->stats.slabsDestroyed++;
+      empty = TRUE;
    }
 
    pipe_mutex_unlock(mgr->mutex);
+
+   /* Give the memory back without holding up the other threads. */
+   if (empty)
+      pb_slab_free(slab);
 }
 
 
@@ -294,50 +326,50 @@ pb_slab_buffer_vtbl = {
 /**
  * Create a new slab.
  * 
- * Called when we ran out of free slabs.
+ * Called without the manager's mutex when we ran out of free slabs, as
+ * the provider may take a while.
  */
-static enum pipe_error
+static struct pb_slab *
 pb_slab_create(struct pb_slab_manager *mgr)
 {
    struct pb_slab *slab;
    struct pb_slab_buffer *buf;
    unsigned numBuffers;
    unsigned i;
-   enum pipe_error ret;
 
    slab = CALLOC_STRUCT(pb_slab);
    if (!slab)
-      return PIPE_ERROR_OUT_OF_MEMORY;
+      return NULL;
 
    slab->bo = mgr->provider->create_buffer(mgr->provider, mgr->slabSize, &mgr->desc);
-   if(!slab->bo) {
-      ret = PIPE_ERROR_OUT_OF_MEMORY;
+   if(!slab->bo)
       goto out_err0;
-   }
 
    /* Note down the slab virtual address. All mappings are accessed directly 
     * through this address so it is required that the buffer is pinned. */
    slab->virtual = pb_map(slab->bo, 
                           PB_USAGE_CPU_READ |
                           PB_USAGE_CPU_WRITE, NULL);
-   if(!slab->virtual) {
-      ret = PIPE_ERROR_OUT_OF_MEMORY;
+   if(!slab->virtual)
       goto out_err1;
-   }
    pb_unmap(slab->bo);
 
    numBuffers = slab->bo->size / mgr->bufSize;
+   if (!numBuffers)
+      goto out_err1;
 
    slab->buffers = CALLOC(numBuffers, sizeof(*slab->buffers));
-   if (!slab->buffers) {
-      ret = PIPE_ERROR_OUT_OF_MEMORY;
+   if (!slab->buffers)
       goto out_err1;
-   }
+
+   slab->freeMask = CALLOC((numBuffers + 31) / 32, sizeof(*slab->freeMask));
+   if (!slab->freeMask)
+      goto out_err2;
 
    LIST_INITHEAD(&slab->head);
-   LIST_INITHEAD(&slab->freeBuffers);
    slab->numBuffers = numBuffers;
    slab->numFree = 0;
+   slab->firstFreeWord = 0;
    slab->mgr = mgr;
 
    buf = slab->buffers;
@@ -351,21 +383,43 @@ pb_slab_create(struct pb_slab_manager *mgr)
       buf->start = i* mgr->bufSize;
       buf->mapCount = 0;
       pipe_condvar_init(buf->event);
-      LIST_ADDTAIL(&buf->head, &slab->freeBuffers);
+      slab->freeMask[i / 32] |= 1u << (i % 32);
       slab->numFree++;
       buf++;
    }
 
-   /* Add this slab to the list of partial slabs */
-   LIST_ADDTAIL(&slab->head, &mgr->slabs);
-
-   return PIPE_OK;
+   return slab;
 
+out_err2:
+   FREE(slab->buffers);
 out_err1: 
    pb_reference(&slab->bo, NULL);
 out_err0: 
    FREE(slab);
-   return ret;
+   return NULL;
+}
+
+
+/**
+ * Take the lowest free buffer of a slab which has one.
+ */
+static struct pb_slab_buffer *
+pb_slab_take_buffer(struct pb_slab *slab)
+{
+   unsigned word = slab->firstFreeWord;
+   unsigned bit;
+
+   assert(slab->numFree);
+
+   while (!slab->freeMask[word])
+      ++word;
+   slab->firstFreeWord = word;
+
+   bit = ffs(slab->freeMask[word]) - 1;
+   slab->freeMask[word] &= ~(1u << bit);
+   slab->numFree--;
+
+   return &slab->buffers[word * 32 + bit];
 }
 
 
@@ -375,9 +429,8 @@ pb_slab_manager_create_buffer(struct pb_manager *_mgr,
                               const struct pb_desc *desc)
 {
    struct pb_slab_manager *mgr = pb_slab_manager(_mgr);
-   static struct pb_slab_buffer *buf;
+   struct pb_slab_buffer *buf;
    struct pb_slab *slab;
-   struct list_head *list;
 
    /* check size */
    assert(size <= mgr->bufSize);
@@ -398,28 +451,34 @@ pb_slab_manager_create_buffer(struct pb_manager *_mgr,
 
    pipe_mutex_lock(mgr->mutex);
    
-   /* Create a new slab, if we run out of partial slabs */
+   /* Create a new slab, if we run out of partial slabs.  Another thread
+    * may have done the same meanwhile, which only costs a spare slab.
+    */
    if (mgr->slabs.next == &mgr->slabs) {
-      (void) pb_slab_create(mgr);
-      if (mgr->slabs.next == &mgr->slabs) {
-	 pipe_mutex_unlock(mgr->mutex);
-	 return NULL;
-      }
+      pipe_mutex_unlock(mgr->mutex);
+      slab = pb_slab_create(mgr);
+      if (!slab)
+         return NULL;
+      pipe_mutex_lock(mgr->mutex);
+
+      LIST_ADDTAIL(&slab->head, &mgr->slabs);
+      mgr->stats.numSlabs++;
+      mgr->stats.numBuffers += slab->numBuffers;
+      mgr->stats.slabsCreated++;
    }
    
    /* Allocate the buffer from a partial (or just created) slab */
-   list = mgr->slabs.next;
-   slab = LIST_ENTRY(struct pb_slab, list, head);
+   slab = LIST_ENTRY(struct pb_slab, mgr->slabs.next, head);
+   buf = pb_slab_take_buffer(slab);
    
    /* If totally full remove from the partial slab list */
-   if (--slab->numFree == 0)
-      LIST_DELINIT(list);
+   if (slab->numFree == 0)
+      LIST_DELINIT(&slab->head);
 
-   list = slab->freeBuffers.next;
-   LIST_DELINIT(list);
+   mgr->stats.numUsed++;
+   mgr->stats.maxUsed = MAX2(mgr->stats.maxUsed, mgr->stats.numUsed);
 
    pipe_mutex_unlock(mgr->mutex);
-   buf = LIST_ENTRY(struct pb_slab_buffer, list, head);
    
    pipe_reference_init(&buf->base.reference, 1);
    buf->base.alignment = desc->alignment;
@@ -446,10 +505,26 @@ pb_slab_manager_destroy(struct pb_manager *_mgr)
    struct pb_slab_manager *mgr = pb_slab_manager(_mgr);
 
    /* TODO: cleanup all allocated buffers */
+   pipe_mutex_destroy(mgr->mutex);
    FREE(mgr);
 }
 
 
+/**
+ * Get the occupancy of a manager created by pb_slab_manager_create().
+ */
+void
+pb_slab_manager_get_stats(struct pb_manager *_mgr,
+                          struct pb_slab_stats *stats)
+{
+   struct pb_slab_manager *mgr = pb_slab_manager(_mgr);
+
+   pipe_mutex_lock(mgr->mutex);
+   *stats = mgr->stats;
+   pipe_mutex_unlock(mgr->mutex);
+}
+
+
 struct pb_manager *
 pb_slab_manager_create(struct pb_manager *provider,
                        pb_size bufSize,
@@ -470,6 +545,7 @@ pb_slab_manager_create(struct pb_manager *provider,
    mgr->bufSize = bufSize;
    mgr->slabSize = slabSize;
    mgr->desc = *desc;
+   mgr->stats.bufSize = bufSize;
 
    LIST_INITHEAD(&mgr->slabs);
    
@@ -531,6 +607,27 @@ pb_slab_range_manager_destroy(struct pb_manager *_mgr)
 }
 
 
+/**
+ * Get the occupancy of each size of a manager created by
+ * pb_slab_range_manager_create(), smallest first.
+ *
+ * \return the number of sizes, of which the first max_stats are written
+ */
+unsigned
+pb_slab_range_manager_get_stats(struct pb_manager *_mgr,
+                                struct pb_slab_stats *stats,
+                                unsigned max_stats)
+{
+   struct pb_slab_range_manager *mgr = pb_slab_range_manager(_mgr);
+   unsigned i;
+
+   for (i = 0; i < mgr->numBuckets && i < max_stats; ++i)
+      pb_slab_manager_get_stats(mgr->buckets[i], &stats[i]);
+
+   return mgr->numBuckets;
+}
+
+
 struct pb_manager *
 pb_slab_range_manager_create(struct pb_manager *provider,
                              pb_size minBufSize,
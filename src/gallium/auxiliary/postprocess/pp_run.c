@@ -263,6 +263,7 @@ pp_tgsi_to_state(struct pipe_context *pipe, const char *text, bool isvs,
 
    state.tokens = tokens;
    memset(&state.stream_output, 0, sizeof(state.stream_output));
+   state.hash = 0;
 
    if (isvs) {
       ret_state = pipe->create_vs_state(pipe, &state);
@@ -0,0 +1,223 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Ring file of captured TGSI shaders, see tgsi_capture.h.
+ */
+
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+
+#if defined(PIPE_OS_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_string.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_capture.h"
+
+
+#if defined(PIPE_OS_UNIX)
+
+pipe_static_mutex(capture_mutex);
+
+/** 0 until the first capture, then 1 if capturing, -1 if not */
+static int capture_state;
+
+static struct tgsi_capture_header *capture_header;
+static uint8_t *capture_data;
+
+
+static boolean
+capture_init(void)
+{
+   const char *path = debug_get_option("TGSI_CAPTURE", NULL);
+   long size = debug_get_num_option("TGSI_CAPTURE_SIZE", 16 * 1024 * 1024);
+   size_t length;
+   char filename[4096];
+   void *map;
+   int fd;
+
+   if (!path || size < 4096)
+      return FALSE;
+
+   size &= ~7L;
+   length = sizeof(*capture_header) + size;
+
+   util_snprintf(filename, sizeof(filename), "%s.%d", path, (int)getpid());
+
+   fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) {
+      debug_printf("TGSI_CAPTURE: couldn't create %s\n", filename);
+      return FALSE;
+   }
+
+   if (ftruncate(fd, length) != 0) {
+      close(fd);
+      return FALSE;
+   }
+
+   map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED)
+      return FALSE;
+
+   capture_header = (struct tgsi_capture_header *) map;
+   capture_data = (uint8_t *) (capture_header + 1);
+
+   capture_header->size = (uint32_t) size;
+   capture_header->head = 0;
+   capture_header->tail = 0;
+   capture_header->count = 0;
+   capture_header->padding = 0;
+   capture_header->magic = TGSI_CAPTURE_MAGIC;
+
+   return TRUE;
+}
+
+
+/**
+ * Drop the oldest record.
+ */
+static void
+capture_advance_tail(void)
+{
+   const uint32_t size = capture_header->size;
+   uint32_t tail = capture_header->tail;
+   const struct tgsi_capture_record *record;
+
+   if (size - tail < 8) {
+      tail = 0;
+   }
+   else {
+      record = (const struct tgsi_capture_record *) (capture_data + tail);
+      if (record->magic == TGSI_CAPTURE_PAD)
+         tail = 0;
+      else
+         tail += record->size;
+      if (tail >= size)
+         tail = 0;
+   }
+
+   capture_header->tail = tail;
+}
+
+
+static void
+capture_write(const struct tgsi_token *tokens, uint64_t hash)
+{
+   const uint32_t size = capture_header->size;
+   const unsigned num_tokens = tgsi_num_tokens(tokens);
+   const uint32_t record_size =
+      align(sizeof(struct tgsi_capture_record) +
+            num_tokens * sizeof(struct tgsi_token), 8);
+   struct tgsi_capture_record *record;
+   uint32_t head = capture_header->head;
+   uint32_t need = record_size;
+   boolean wrap = FALSE;
+
+   if (record_size > size / 2)
+      return;
+
+   if (head + record_size > size) {
+      wrap = TRUE;
+      need += size - head;
+   }
+
+   /* Keep room between head and tail, so that head == tail means empty. */
+   while (capture_header->tail != head &&
+          (capture_header->tail + size - head) % size <= need)
+      capture_advance_tail();
+
+   if (wrap) {
+      if (size - head >= 8) {
+         record = (struct tgsi_capture_record *) (capture_data + head);
+         record->size = size - head;
+         record->magic = TGSI_CAPTURE_PAD;
+      }
+      if (capture_header->tail == capture_header->head)
+         capture_header->tail = 0;
+      head = 0;
+   }
+
+   record = (struct tgsi_capture_record *) (capture_data + head);
+   record->magic = TGSI_CAPTURE_RECORD;
+   record->size = record_size;
+   record->hash = hash;
+   record->time = os_time_get_nano();
+   record->sequence = capture_header->count;
+   record->num_tokens = num_tokens;
+   memcpy(record + 1, tokens, num_tokens * sizeof(struct tgsi_token));
+
+   /* Publish the record only once it is complete. */
+   head += record_size;
+   capture_header->head = head < size ? head : 0;
+   capture_header->count++;
+}
+
+
+/**
+ * Capture a shader if TGSI_CAPTURE is set.
+ *
+ * \param hash  tgsi_hash_tokens() of the tokens if known, or 0
+ */
+void
+tgsi_capture_tokens(const struct tgsi_token *tokens, uint64_t hash)
+{
+   if (capture_state < 0 || !tokens)
+      return;
+
+   pipe_mutex_lock(capture_mutex);
+
+   if (capture_state == 0)
+      capture_state = capture_init() ? 1 : -1;
+
+   if (capture_state > 0)
+      capture_write(tokens, hash ? hash : tgsi_hash_tokens(tokens));
+
+   pipe_mutex_unlock(capture_mutex);
+}
+
+
+#else /* !PIPE_OS_UNIX */
+
+
+void
+tgsi_capture_tokens(const struct tgsi_token *tokens, uint64_t hash)
+{
+   (void) tokens;
+   (void) hash;
+}
+
+
+#endif /* !PIPE_OS_UNIX */
@@ -0,0 +1,87 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Binary capture of TGSI shaders into a ring file.
+ *
+ * With TGSI_CAPTURE=<path>, tgsi_capture_tokens() appends each shader to
+ * the memory-mapped file <path>.<pid>, overwriting the oldest shaders
+ * once TGSI_CAPTURE_SIZE bytes (default 16 MB) are used.  The file stays
+ * valid if the process dies, and tgsi-capture-dump prints it.
+ */
+
+#ifndef TGSI_CAPTURE_H
+#define TGSI_CAPTURE_H
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_shader_tokens.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+
+#define TGSI_CAPTURE_MAGIC  0x31435054  /* "TPC1" */
+#define TGSI_CAPTURE_RECORD 0x52435054  /* "TPCR" */
+#define TGSI_CAPTURE_PAD    0x50435054  /* "TPCP" */
+
+
+/**
+ * Start of the file, followed by \c size bytes of records.
+ */
+struct tgsi_capture_header
+{
+   uint32_t magic;
+   uint32_t size;
+   uint32_t head;  /**< offset of the next record to write */
+   uint32_t tail;  /**< offset of the oldest record, head if empty */
+   uint32_t count;  /**< number of shaders captured so far */
+   uint32_t padding;
+};
+
+/**
+ * A captured shader, followed by its tokens.  A TGSI_CAPTURE_PAD record
+ * fills the end of the ring when the next record didn't fit, and the
+ * reader also wraps when fewer than 8 bytes are left.
+ */
+struct tgsi_capture_record
+{
+   uint32_t magic;
+   uint32_t size;  /**< of the record and tokens, multiple of 8 */
+   uint64_t hash;  /**< tgsi_hash_tokens() */
+   int64_t time;  /**< os_time_get_nano() */
+   uint32_t sequence;
+   uint32_t num_tokens;
+};
+
+
+void
+tgsi_capture_tokens(const struct tgsi_token *tokens, uint64_t hash);
+
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* TGSI_CAPTURE_H */
@@ -60,6 +60,14 @@
 #include "tgsi_exec.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/u_sse.h"
+
+
+#if defined(PIPE_ARCH_SSE)
+/* The channel micro-ops below work on all four pixels of a quad at once. */
+#define SSE_CHAN_LOAD(chan) _mm_loadu_ps((chan)->f)
+#define SSE_CHAN_STORE(chan, v) _mm_storeu_ps((chan)->f, (v))
+#endif
 
 
 #define DEBUG_EXECUTION 0
@@ -275,10 +283,17 @@ micro_lrp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   const __m128 c = SSE_CHAN_LOAD(src2);
+   SSE_CHAN_STORE(dst, _mm_add_ps(_mm_mul_ps(a, _mm_sub_ps(b, c)), c));
+#else
    dst->f[0] = src0->f[0] * (src1->f[0] - src2->f[0]) + src2->f[0];
    dst->f[1] = src0->f[1] * (src1->f[1] - src2->f[1]) + src2->f[1];
    dst->f[2] = src0->f[2] * (src1->f[2] - src2->f[2]) + src2->f[2];
    dst->f[3] = src0->f[3] * (src1->f[3] - src2->f[3]) + src2->f[3];
+#endif
 }
 
 static void
@@ -287,10 +302,17 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   const __m128 c = SSE_CHAN_LOAD(src2);
+   SSE_CHAN_STORE(dst, _mm_add_ps(_mm_mul_ps(a, b), c));
+#else
    dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
    dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
    dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
    dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+#endif
 }
 
 static void
@@ -360,10 +382,16 @@ micro_seq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_and_ps(_mm_cmpeq_ps(a, b), _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] == src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] == src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] == src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] == src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -371,10 +399,16 @@ micro_sge(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_and_ps(_mm_cmpge_ps(a, b), _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] >= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] >= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] >= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] >= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -402,10 +436,16 @@ micro_sgt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_and_ps(_mm_cmpgt_ps(a, b), _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] > src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] > src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] > src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -423,10 +463,16 @@ micro_sle(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_and_ps(_mm_cmple_ps(a, b), _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] <= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] <= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] <= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] <= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -434,10 +480,16 @@ micro_slt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] < src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] < src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] < src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -445,10 +497,16 @@ micro_sne(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_and_ps(_mm_cmpneq_ps(a, b), _mm_set1_ps(1.0f)));
+#else
    dst->f[0] = src0->f[0] != src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] != src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] != src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] != src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -632,54 +690,55 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 }
 
 
+static void
+translate_instructions(struct tgsi_exec_machine *mach);
+
+static void
+exec_declaration(struct tgsi_exec_machine *mach,
+                 const struct tgsi_full_declaration *decl);
+
+
 /**
- * Initialize machine state by expanding tokens to full instructions,
- * allocating temporary storage, setting up constants, etc.
+ * Initialize machine state from a shader decoded by tgsi_decode_shader(),
+ * loading immediates, allocating temporary storage, etc.
  * After this, we can call tgsi_exec_machine_run() many times.
+ * The machine only refers to the decoded shader, which must stay alive
+ * until another shader is bound.
  */
-void 
-tgsi_exec_machine_bind_shader(
+void
+tgsi_exec_machine_bind_decoded(
    struct tgsi_exec_machine *mach,
-   const struct tgsi_token *tokens,
+   const struct tgsi_decoded_shader *shader,
    struct tgsi_sampler *sampler)
 {
    uint k;
-   struct tgsi_parse_context parse;
-   struct tgsi_full_instruction *instructions;
-   struct tgsi_full_declaration *declarations;
-   uint maxInstructions = 10, numInstructions = 0;
-   uint maxDeclarations = 10, numDeclarations = 0;
-
-#if 0
-   tgsi_dump(tokens, 0);
-#endif
 
    util_init_math();
 
+   if (mach->OwnDecoded && mach->OwnDecoded != shader) {
+      tgsi_free_decoded_shader(mach->OwnDecoded);
+      mach->OwnDecoded = NULL;
+   }
 
-   mach->Tokens = tokens;
+   mach->Decoded = shader;
    mach->Sampler = sampler;
 
-   if (!tokens) {
-      /* unbind and free all */
-      FREE(mach->Declarations);
+   if (!shader) {
+      /* unbind */
+      mach->Tokens = NULL;
+
       mach->Declarations = NULL;
       mach->NumDeclarations = 0;
+      mach->NumRunDeclarations = 0;
 
-      FREE(mach->Instructions);
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
       return;
    }
 
-   k = tgsi_parse_init (&parse, mach->Tokens);
-   if (k != TGSI_PARSE_OK) {
-      debug_printf( "Problem parsing!\n" );
-      return;
-   }
-
-   mach->Processor = parse.FullHeader.Processor.Processor;
+   mach->Tokens = shader->tokens;
+   mach->Processor = shader->header.Processor.Processor;
    mach->ImmLimit = 0;
    mach->NumOutputs = 0;
 
@@ -711,99 +770,82 @@ tgsi_exec_machine_bind_shader(
       mach->UsedGeometryShader = TRUE;
    }
 
-   declarations = (struct tgsi_full_declaration *)
-      MALLOC( maxDeclarations * sizeof(struct tgsi_full_declaration) );
-
-   if (!declarations) {
-      return;
-   }
-
-   instructions = (struct tgsi_full_instruction *)
-      MALLOC( maxInstructions * sizeof(struct tgsi_full_instruction) );
+   for (k = 0; k < shader->num_declarations; k++) {
+      const struct tgsi_full_declaration *decl = &shader->declarations[k];
 
-   if (!instructions) {
-      FREE( declarations );
-      return;
+      if (decl->Declaration.File == TGSI_FILE_OUTPUT) {
+         mach->NumOutputs += decl->Range.Last - decl->Range.First + 1;
+      }
    }
 
-   while( !tgsi_parse_end_of_tokens( &parse ) ) {
+   for (k = 0; k < shader->num_immediates; k++) {
+      const struct tgsi_full_immediate *imm = &shader->immediates[k];
+      uint size = imm->Immediate.NrTokens - 1;
       uint i;
 
-      tgsi_parse_token( &parse );
-      switch( parse.FullToken.Token.Type ) {
-      case TGSI_TOKEN_TYPE_DECLARATION:
-         /* save expanded declaration */
-         if (numDeclarations == maxDeclarations) {
-            declarations = REALLOC(declarations,
-                                   maxDeclarations
-                                   * sizeof(struct tgsi_full_declaration),
-                                   (maxDeclarations + 10)
-                                   * sizeof(struct tgsi_full_declaration));
-            maxDeclarations += 10;
-         }
-         if (parse.FullToken.FullDeclaration.Declaration.File == TGSI_FILE_OUTPUT) {
-            unsigned reg;
-            for (reg = parse.FullToken.FullDeclaration.Range.First;
-                 reg <= parse.FullToken.FullDeclaration.Range.Last;
-                 ++reg) {
-               ++mach->NumOutputs;
-            }
-         }
-         memcpy(declarations + numDeclarations,
-                &parse.FullToken.FullDeclaration,
-                sizeof(declarations[0]));
-         numDeclarations++;
-         break;
+      assert( size <= 4 );
+      assert( mach->ImmLimit + 1 <= TGSI_EXEC_NUM_IMMEDIATES );
 
-      case TGSI_TOKEN_TYPE_IMMEDIATE:
-         {
-            uint size = parse.FullToken.FullImmediate.Immediate.NrTokens - 1;
-            assert( size <= 4 );
-            assert( mach->ImmLimit + 1 <= TGSI_EXEC_NUM_IMMEDIATES );
+      for( i = 0; i < size; i++ ) {
+         mach->Imms[mach->ImmLimit][i] = imm->u[i].Float;
+      }
+      mach->ImmLimit += 1;
+   }
 
-            for( i = 0; i < size; i++ ) {
-               mach->Imms[mach->ImmLimit][i] = 
-		  parse.FullToken.FullImmediate.u[i].Float;
-            }
-            mach->ImmLimit += 1;
-         }
-         break;
+   mach->Declarations = shader->declarations;
+   mach->NumDeclarations = shader->num_declarations;
 
-      case TGSI_TOKEN_TYPE_INSTRUCTION:
+   /* Outside of fragment shaders, declarations only record sampler views
+    * and system value slots, which don't change between runs.
+    */
+   if (mach->Processor == TGSI_PROCESSOR_FRAGMENT) {
+      mach->NumRunDeclarations = mach->NumDeclarations;
+   }
+   else {
+      for (k = 0; k < mach->NumDeclarations; k++) {
+         exec_declaration(mach, mach->Declarations + k);
+      }
+      mach->NumRunDeclarations = 0;
+   }
 
-         /* save expanded instruction */
-         if (numInstructions == maxInstructions) {
-            instructions = REALLOC(instructions,
-                                   maxInstructions
-                                   * sizeof(struct tgsi_full_instruction),
-                                   (maxInstructions + 10)
-                                   * sizeof(struct tgsi_full_instruction));
-            maxInstructions += 10;
-         }
+   mach->Instructions = shader->instructions;
+   mach->NumInstructions = shader->num_instructions;
 
-         memcpy(instructions + numInstructions,
-                &parse.FullToken.FullInstruction,
-                sizeof(instructions[0]));
+   translate_instructions(mach);
+}
 
-         numInstructions++;
-         break;
 
-      case TGSI_TOKEN_TYPE_PROPERTY:
-         break;
+/**
+ * Bind a token stream, decoding it into a copy private to the machine.
+ * Users that bind the same shader again and again should rather keep a
+ * tgsi_decoded_shader and use tgsi_exec_machine_bind_decoded().
+ */
+void 
+tgsi_exec_machine_bind_shader(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_token *tokens,
+   struct tgsi_sampler *sampler)
+{
+   struct tgsi_decoded_shader *shader;
 
-      default:
-         assert( 0 );
-      }
+#if 0
+   tgsi_dump(tokens, 0);
+#endif
+
+   if (!tokens) {
+      /* unbind and free all */
+      tgsi_exec_machine_bind_decoded(mach, NULL, sampler);
+      return;
    }
-   tgsi_parse_free (&parse);
 
-   FREE(mach->Declarations);
-   mach->Declarations = declarations;
-   mach->NumDeclarations = numDeclarations;
+   shader = tgsi_decode_shader(tokens);
+   if (!shader) {
+      debug_printf( "Problem parsing!\n" );
+      return;
+   }
 
-   FREE(mach->Instructions);
-   mach->Instructions = instructions;
-   mach->NumInstructions = numInstructions;
+   tgsi_exec_machine_bind_decoded(mach, shader, sampler);
+   mach->OwnDecoded = shader;
 }
 
 
@@ -864,8 +906,9 @@ void
 tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
-      FREE(mach->Instructions);
-      FREE(mach->Declarations);
+      if (mach->OwnDecoded)
+         tgsi_free_decoded_shader(mach->OwnDecoded);
+      FREE(mach->Ops);
 
       align_free(mach->Inputs);
       align_free(mach->Outputs);
@@ -879,10 +922,16 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_add_ps(a, b));
+#else
    dst->f[0] = src0->f[0] + src1->f[0];
    dst->f[1] = src0->f[1] + src1->f[1];
    dst->f[2] = src0->f[2] + src1->f[2];
    dst->f[3] = src0->f[3] + src1->f[3];
+#endif
 }
 
 static void
@@ -958,10 +1007,16 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_max_ps(a, b));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -969,10 +1024,16 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_min_ps(a, b));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -980,10 +1041,16 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_mul_ps(a, b));
+#else
    dst->f[0] = src0->f[0] * src1->f[0];
    dst->f[1] = src0->f[1] * src1->f[1];
    dst->f[2] = src0->f[2] * src1->f[2];
    dst->f[3] = src0->f[3] * src1->f[3];
+#endif
 }
 
 static void
@@ -1021,10 +1088,16 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_sub_ps(a, b));
+#else
    dst->f[0] = src0->f[0] - src1->f[0];
    dst->f[1] = src0->f[1] - src1->f[1];
    dst->f[2] = src0->f[2] - src1->f[2];
    dst->f[3] = src0->f[3] - src1->f[3];
+#endif
 }
 
 static void
@@ -3178,10 +3251,14 @@ static void
 micro_i2f(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   SSE_CHAN_STORE(dst, _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) src->i)));
+#else
    dst->f[0] = (float)src->i[0];
    dst->f[1] = (float)src->i[1];
    dst->f[2] = (float)src->i[2];
    dst->f[3] = (float)src->i[3];
+#endif
 }
 
 static void
@@ -3258,10 +3335,14 @@ static void
 micro_f2i(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if defined(PIPE_ARCH_SSE)
+   _mm_storeu_si128((__m128i *) dst->i, _mm_cvttps_epi32(SSE_CHAN_LOAD(src)));
+#else
    dst->i[0] = (int)src->f[0];
    dst->i[1] = (int)src->f[1];
    dst->i[2] = (int)src->f[2];
    dst->i[3] = (int)src->f[3];
+#endif
 }
 
 static void
@@ -3269,10 +3350,16 @@ micro_fseq(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_cmpeq_ps(a, b));
+#else
    dst->u[0] = src0->f[0] == src1->f[0] ? ~0 : 0;
    dst->u[1] = src0->f[1] == src1->f[1] ? ~0 : 0;
    dst->u[2] = src0->f[2] == src1->f[2] ? ~0 : 0;
    dst->u[3] = src0->f[3] == src1->f[3] ? ~0 : 0;
+#endif
 }
 
 static void
@@ -3280,10 +3367,16 @@ micro_fsge(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_cmpge_ps(a, b));
+#else
    dst->u[0] = src0->f[0] >= src1->f[0] ? ~0 : 0;
    dst->u[1] = src0->f[1] >= src1->f[1] ? ~0 : 0;
    dst->u[2] = src0->f[2] >= src1->f[2] ? ~0 : 0;
    dst->u[3] = src0->f[3] >= src1->f[3] ? ~0 : 0;
+#endif
 }
 
 static void
@@ -3291,10 +3384,16 @@ micro_fslt(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_cmplt_ps(a, b));
+#else
    dst->u[0] = src0->f[0] < src1->f[0] ? ~0 : 0;
    dst->u[1] = src0->f[1] < src1->f[1] ? ~0 : 0;
    dst->u[2] = src0->f[2] < src1->f[2] ? ~0 : 0;
    dst->u[3] = src0->f[3] < src1->f[3] ? ~0 : 0;
+#endif
 }
 
 static void
@@ -3302,10 +3401,16 @@ micro_fsne(union tgsi_exec_channel *dst,
            const union tgsi_exec_channel *src0,
            const union tgsi_exec_channel *src1)
 {
+#if defined(PIPE_ARCH_SSE)
+   const __m128 a = SSE_CHAN_LOAD(src0);
+   const __m128 b = SSE_CHAN_LOAD(src1);
+   SSE_CHAN_STORE(dst, _mm_cmpneq_ps(a, b));
+#else
    dst->u[0] = src0->f[0] != src1->f[0] ? ~0 : 0;
    dst->u[1] = src0->f[1] != src1->f[1] ? ~0 : 0;
    dst->u[2] = src0->f[2] != src1->f[2] ? ~0 : 0;
    dst->u[3] = src0->f[3] != src1->f[3] ? ~0 : 0;
+#endif
 }
 
 static void
@@ -4438,6 +4543,497 @@ exec_instruction(
 }
 
 
+/*
+ * Pre-translated instructions.
+ *
+ * When a shader is bound, each instruction gets a handler.  Simple ALU
+ * instructions without predication or indirect addressing, which are the
+ * bulk of most shaders, get a specialized one whose operands already
+ * point at the swizzled register channels, so that running them skips
+ * the register file switch, index computation and swizzle lookup of
+ * fetch_source() and store_dest().  Everything else goes through
+ * exec_instruction().
+ */
+
+enum tgsi_exec_operand_kind {
+   TGSI_EXEC_OPERAND_VECTOR,    /**< per-quad register channel */
+   TGSI_EXEC_OPERAND_SCALAR,    /**< immediate, same for all quad elements */
+   TGSI_EXEC_OPERAND_CONSTANT   /**< constant, resolved at run time */
+};
+
+struct tgsi_exec_operand
+{
+   enum tgsi_exec_operand_kind kind;
+   boolean absolute;
+   boolean negate;
+   uint constbuf;
+   union {
+      const union tgsi_exec_channel *vector;
+      const float *scalar;
+      int pos;                  /**< dword offset into the constant buffer */
+   } chan[TGSI_NUM_CHANNELS];
+};
+
+typedef void (* tgsi_exec_op_func)(struct tgsi_exec_machine *mach,
+                                   const struct tgsi_exec_op *op,
+                                   int *pc);
+
+struct tgsi_exec_op
+{
+   tgsi_exec_op_func func;
+   const struct tgsi_full_instruction *inst;
+   uint saturate;
+   /** Written channels, NULL where the write mask is off */
+   union tgsi_exec_channel *dst[TGSI_NUM_CHANNELS];
+   struct tgsi_exec_operand src[3];
+};
+
+
+static INLINE const union tgsi_exec_channel *
+fetch_operand(const struct tgsi_exec_machine *mach,
+              const struct tgsi_exec_operand *src,
+              uint chan,
+              union tgsi_exec_channel *tmp)
+{
+   const union tgsi_exec_channel *val;
+   uint i;
+
+   switch (src->kind) {
+   case TGSI_EXEC_OPERAND_VECTOR:
+      val = src->chan[chan].vector;
+      break;
+
+   case TGSI_EXEC_OPERAND_SCALAR:
+      tmp->f[0] =
+      tmp->f[1] =
+      tmp->f[2] =
+      tmp->f[3] = *src->chan[chan].scalar;
+      val = tmp;
+      break;
+
+   default:
+      {
+         const uint *buf = (const uint *) mach->Consts[src->constbuf];
+         const int pos = src->chan[chan].pos;
+
+         assert(buf);
+         /* const buffer bounds check, as in fetch_src_file_channel() */
+         tmp->u[0] =
+         tmp->u[1] =
+         tmp->u[2] =
+         tmp->u[3] = pos < (int) mach->ConstsSize[src->constbuf] ?
+                     buf[pos] : 0;
+         val = tmp;
+      }
+   }
+
+   if (src->absolute || src->negate) {
+      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         tmp->f[i] = val->f[i];
+      if (src->absolute)
+         micro_abs(tmp, tmp);
+      if (src->negate)
+         micro_neg(tmp, tmp);
+      val = tmp;
+   }
+
+   return val;
+}
+
+static INLINE void
+store_operand(const struct tgsi_exec_machine *mach,
+              const struct tgsi_exec_op *op,
+              uint chan,
+              const union tgsi_exec_channel *val)
+{
+   union tgsi_exec_channel *dst = op->dst[chan];
+   const uint execmask = mach->ExecMask;
+   uint i;
+
+   if (op->saturate == TGSI_SAT_NONE && execmask == 0xf) {
+      *dst = *val;
+      return;
+   }
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      if (execmask & (1 << i)) {
+         if (op->saturate == TGSI_SAT_ZERO_ONE && val->f[i] < 0.0f)
+            dst->f[i] = 0.0f;
+         else if (op->saturate == TGSI_SAT_MINUS_PLUS_ONE && val->f[i] < -1.0f)
+            dst->f[i] = -1.0f;
+         else if (op->saturate != TGSI_SAT_NONE && val->f[i] > 1.0f)
+            dst->f[i] = 1.0f;
+         else
+            dst->i[i] = val->i[i];
+      }
+   }
+}
+
+static INLINE void
+fast_vector_unary(struct tgsi_exec_machine *mach,
+                  const struct tgsi_exec_op *op,
+                  micro_unary_op micro)
+{
+   union tgsi_exec_channel tmp;
+   struct tgsi_exec_vector dst;
+   uint chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         micro(&dst.xyzw[chan], fetch_operand(mach, &op->src[0], chan, &tmp));
+      }
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         store_operand(mach, op, chan, &dst.xyzw[chan]);
+      }
+   }
+}
+
+static INLINE void
+fast_vector_binary(struct tgsi_exec_machine *mach,
+                   const struct tgsi_exec_op *op,
+                   micro_binary_op micro)
+{
+   union tgsi_exec_channel tmp[2];
+   struct tgsi_exec_vector dst;
+   uint chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         micro(&dst.xyzw[chan],
+               fetch_operand(mach, &op->src[0], chan, &tmp[0]),
+               fetch_operand(mach, &op->src[1], chan, &tmp[1]));
+      }
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         store_operand(mach, op, chan, &dst.xyzw[chan]);
+      }
+   }
+}
+
+static INLINE void
+fast_vector_trinary(struct tgsi_exec_machine *mach,
+                    const struct tgsi_exec_op *op,
+                    micro_trinary_op micro)
+{
+   union tgsi_exec_channel tmp[3];
+   struct tgsi_exec_vector dst;
+   uint chan;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         micro(&dst.xyzw[chan],
+               fetch_operand(mach, &op->src[0], chan, &tmp[0]),
+               fetch_operand(mach, &op->src[1], chan, &tmp[1]),
+               fetch_operand(mach, &op->src[2], chan, &tmp[2]));
+      }
+   }
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         store_operand(mach, op, chan, &dst.xyzw[chan]);
+      }
+   }
+}
+
+static INLINE void
+fast_dot(struct tgsi_exec_machine *mach,
+         const struct tgsi_exec_op *op,
+         uint num_chans)
+{
+   union tgsi_exec_channel tmp[2];
+   union tgsi_exec_channel dot;
+   uint chan;
+
+   micro_mul(&dot,
+             fetch_operand(mach, &op->src[0], TGSI_CHAN_X, &tmp[0]),
+             fetch_operand(mach, &op->src[1], TGSI_CHAN_X, &tmp[1]));
+
+   for (chan = TGSI_CHAN_Y; chan < num_chans; chan++) {
+      micro_mad(&dot,
+                fetch_operand(mach, &op->src[0], chan, &tmp[0]),
+                fetch_operand(mach, &op->src[1], chan, &tmp[1]),
+                &dot);
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->dst[chan]) {
+         store_operand(mach, op, chan, &dot);
+      }
+   }
+}
+
+static void
+fast_mov(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_unary(mach, op, micro_mov);
+   (*pc)++;
+}
+
+static void
+fast_add(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_add);
+   (*pc)++;
+}
+
+static void
+fast_sub(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_sub);
+   (*pc)++;
+}
+
+static void
+fast_mul(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_mul);
+   (*pc)++;
+}
+
+static void
+fast_min(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_min);
+   (*pc)++;
+}
+
+static void
+fast_max(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_max);
+   (*pc)++;
+}
+
+static void
+fast_slt(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_slt);
+   (*pc)++;
+}
+
+static void
+fast_sge(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_binary(mach, op, micro_sge);
+   (*pc)++;
+}
+
+static void
+fast_mad(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_trinary(mach, op, micro_mad);
+   (*pc)++;
+}
+
+static void
+fast_lrp(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_vector_trinary(mach, op, micro_lrp);
+   (*pc)++;
+}
+
+static void
+fast_dp3(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_dot(mach, op, 3);
+   (*pc)++;
+}
+
+static void
+fast_dp4(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+         int *pc)
+{
+   fast_dot(mach, op, 4);
+   (*pc)++;
+}
+
+static void
+slow_op(struct tgsi_exec_machine *mach, const struct tgsi_exec_op *op,
+        int *pc)
+{
+   exec_instruction(mach, op->inst, pc);
+}
+
+
+/**
+ * Resolve a source register to channel addresses.
+ * \return FALSE if it needs the general fetch_source() path
+ */
+static boolean
+translate_src(const struct tgsi_exec_machine *mach,
+              const struct tgsi_full_src_register *reg,
+              struct tgsi_exec_operand *src)
+{
+   const int index = reg->Register.Index;
+   uint chan;
+
+   if (reg->Register.Indirect)
+      return FALSE;
+
+   if (reg->Register.Dimension &&
+       (reg->Register.File != TGSI_FILE_CONSTANT || reg->Dimension.Indirect))
+      return FALSE;
+
+   src->absolute = reg->Register.Absolute;
+   src->negate = reg->Register.Negate;
+   src->constbuf = 0;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+   case TGSI_FILE_INPUT:
+   case TGSI_FILE_OUTPUT:
+      {
+         const struct tgsi_exec_vector *vec;
+
+         if (reg->Register.File == TGSI_FILE_TEMPORARY) {
+            assert(index < TGSI_EXEC_NUM_TEMPS);
+            vec = &mach->Temps[index];
+         }
+         else if (reg->Register.File == TGSI_FILE_INPUT)
+            vec = &mach->Inputs[index];
+         else
+            vec = &mach->Outputs[index];
+
+         src->kind = TGSI_EXEC_OPERAND_VECTOR;
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+            uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+            src->chan[chan].vector = &vec->xyzw[swizzle];
+         }
+      }
+      return TRUE;
+
+   case TGSI_FILE_IMMEDIATE:
+      assert(index >= 0 && index < (int) mach->ImmLimit);
+      src->kind = TGSI_EXEC_OPERAND_SCALAR;
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+         src->chan[chan].scalar = &mach->Imms[index][swizzle];
+      }
+      return TRUE;
+
+   case TGSI_FILE_CONSTANT:
+      if (index < 0)
+         return FALSE;
+      if (reg->Register.Dimension) {
+         assert(reg->Dimension.Index < PIPE_MAX_CONSTANT_BUFFERS);
+         src->constbuf = reg->Dimension.Index;
+      }
+      src->kind = TGSI_EXEC_OPERAND_CONSTANT;
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+         src->chan[chan].pos = index * 4 + swizzle;
+      }
+      return TRUE;
+
+   default:
+      return FALSE;
+   }
+}
+
+/**
+ * Pick a specialized handler for the instruction, if it has one.
+ */
+static tgsi_exec_op_func
+translate_op(struct tgsi_exec_machine *mach,
+             const struct tgsi_full_instruction *inst,
+             struct tgsi_exec_op *op)
+{
+   const struct tgsi_full_dst_register *reg = &inst->Dst[0];
+   tgsi_exec_op_func func;
+   struct tgsi_exec_vector *vec;
+   uint i, chan;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_MOV: func = fast_mov; break;
+   case TGSI_OPCODE_ADD: func = fast_add; break;
+   case TGSI_OPCODE_SUB: func = fast_sub; break;
+   case TGSI_OPCODE_MUL: func = fast_mul; break;
+   case TGSI_OPCODE_MIN: func = fast_min; break;
+   case TGSI_OPCODE_MAX: func = fast_max; break;
+   case TGSI_OPCODE_SLT: func = fast_slt; break;
+   case TGSI_OPCODE_SGE: func = fast_sge; break;
+   case TGSI_OPCODE_MAD: func = fast_mad; break;
+   case TGSI_OPCODE_LRP: func = fast_lrp; break;
+   case TGSI_OPCODE_DP3: func = fast_dp3; break;
+   case TGSI_OPCODE_DP4: func = fast_dp4; break;
+   default:
+      return slow_op;
+   }
+
+   if (inst->Instruction.Predicate ||
+       inst->Instruction.NumDstRegs != 1 ||
+       reg->Register.Indirect ||
+       reg->Register.Dimension)
+      return slow_op;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      assert(reg->Register.Index < TGSI_EXEC_NUM_TEMPS);
+      vec = &mach->Temps[reg->Register.Index];
+      break;
+   case TGSI_FILE_OUTPUT:
+      /* geometry shaders move the outputs as vertices are emitted */
+      if (mach->Processor == TGSI_PROCESSOR_GEOMETRY)
+         return slow_op;
+      vec = &mach->Outputs[reg->Register.Index];
+      break;
+   default:
+      return slow_op;
+   }
+
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      if (!translate_src(mach, &inst->Src[i], &op->src[i]))
+         return slow_op;
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      op->dst[chan] = (reg->Register.WriteMask & (1 << chan)) ?
+                      &vec->xyzw[chan] : NULL;
+   }
+   op->saturate = inst->Instruction.Saturate;
+
+   return func;
+}
+
+/**
+ * Build mach->Ops for the bound instructions.  If that fails, the machine
+ * interprets mach->Instructions directly.
+ */
+static void
+translate_instructions(struct tgsi_exec_machine *mach)
+{
+   uint i;
+
+   if (mach->NumInstructions > mach->MaxOps) {
+      FREE(mach->Ops);
+      mach->Ops = MALLOC(mach->NumInstructions * sizeof(*mach->Ops));
+      mach->MaxOps = mach->Ops ? mach->NumInstructions : 0;
+      if (!mach->Ops)
+         return;
+   }
+
+   for (i = 0; i < mach->NumInstructions; i++) {
+      struct tgsi_exec_op *op = &mach->Ops[i];
+
+      op->inst = &mach->Instructions[i];
+      op->func = translate_op(mach, op->inst, op);
+   }
+}
+
+
 /**
  * Run TGSI interpreter.
  * \return bitmask of "alive" quad components
@@ -4476,7 +5072,7 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach )
 
 
    /* execute declarations (interpolants) */
-   for (i = 0; i < mach->NumDeclarations; i++) {
+   for (i = 0; i < mach->NumRunDeclarations; i++) {
       exec_declaration( mach, mach->Declarations+i );
    }
 
@@ -4502,7 +5098,13 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach )
 #endif
 
          assert(pc < (int) mach->NumInstructions);
-         exec_instruction(mach, mach->Instructions + pc, &pc);
+         if (mach->Ops) {
+            const struct tgsi_exec_op *op = &mach->Ops[pc];
+            op->func(mach, op, &pc);
+         }
+         else {
+            exec_instruction(mach, mach->Instructions + pc, &pc);
+         }
 
 #if DEBUG_EXECUTION
          for (i = 0; i < TGSI_EXEC_NUM_TEMPS + TGSI_EXEC_NUM_TEMP_EXTRAS; i++) {
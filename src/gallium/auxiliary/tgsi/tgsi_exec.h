@@ -258,6 +258,9 @@ enum tgsi_break_type {
 
 #define TGSI_EXEC_MAX_BREAK_STACK (TGSI_EXEC_MAX_LOOP_NESTING + TGSI_EXEC_MAX_SWITCH_NESTING)
 
+struct tgsi_decoded_shader;
+struct tgsi_exec_op;
+
 
 /**
  * Run-time virtual machine state for executing TGSI shader.
@@ -347,11 +350,22 @@ struct tgsi_exec_machine
    struct tgsi_call_record CallStack[TGSI_EXEC_MAX_CALL_NESTING];
    int CallStackTop;
 
-   struct tgsi_full_instruction *Instructions;
+   /** The bound shader */
+   const struct tgsi_decoded_shader *Decoded;
+   /** Decoded by tgsi_exec_machine_bind_shader(), freed when unbound */
+   struct tgsi_decoded_shader *OwnDecoded;
+
+   const struct tgsi_full_instruction *Instructions;
    uint NumInstructions;
 
-   struct tgsi_full_declaration *Declarations;
+   const struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
+   /** Declarations executed by each run, only fragment shader inputs */
+   uint NumRunDeclarations;
+
+   /** Instructions translated for dispatch, see translate_instructions() */
+   struct tgsi_exec_op *Ops;
+   uint MaxOps;
 
    struct tgsi_declaration_sampler_view
       SamplerViews[PIPE_MAX_SHADER_SAMPLER_VIEWS];
@@ -372,6 +386,12 @@ tgsi_exec_machine_bind_shader(
    const struct tgsi_token *tokens,
    struct tgsi_sampler *sampler);
 
+void
+tgsi_exec_machine_bind_decoded(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_decoded_shader *shader,
+   struct tgsi_sampler *sampler);
+
 uint
 tgsi_exec_machine_run(
    struct tgsi_exec_machine *mach );
@@ -450,6 +470,8 @@ tgsi_exec_get_shader_param(enum pipe_shader_cap param)
    case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
       return PIPE_MAX_SAMPLERS;
    case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
+   case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
+   case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
       return 1;
    default:
       return 0;
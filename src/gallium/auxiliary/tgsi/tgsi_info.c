@@ -27,6 +27,7 @@
 
 #include "util/u_debug.h"
 #include "util/u_memory.h"
+#include "pipe/p_screen.h"
 #include "tgsi_info.h"
 
 #define NONE TGSI_OUTPUT_NONE
@@ -266,6 +267,120 @@ tgsi_get_processor_name( uint processor )
    }
 }
 
+/**
+ * Generic cost of an opcode, modelled on a typical GPU.
+ */
+void
+tgsi_get_opcode_cost( uint opcode, struct tgsi_opcode_cost *cost )
+{
+   const struct tgsi_opcode_info *info = tgsi_get_opcode_info(opcode);
+
+   cost->latency = 4;
+   cost->throughput = 1;
+   cost->unit = TGSI_UNIT_ALU;
+
+   if (info->is_tex ||
+       (opcode >= TGSI_OPCODE_SAMPLE && opcode <= TGSI_OPCODE_GATHER4) ||
+       opcode == TGSI_OPCODE_SVIEWINFO) {
+      cost->latency = 100;
+      cost->throughput = 4;
+      cost->unit = TGSI_UNIT_TEXTURE;
+      return;
+   }
+
+   if (info->is_branch || info->post_indent || info->pre_dedent) {
+      cost->latency = 1;
+      cost->unit = TGSI_UNIT_FLOW;
+      return;
+   }
+
+   switch (opcode) {
+   case TGSI_OPCODE_NOP:
+   case TGSI_OPCODE_END:
+      cost->latency = 0;
+      cost->throughput = 0;
+      break;
+   case TGSI_OPCODE_KILL_IF:
+   case TGSI_OPCODE_KILL:
+   case TGSI_OPCODE_EMIT:
+   case TGSI_OPCODE_ENDPRIM:
+   case TGSI_OPCODE_BARRIER:
+   case TGSI_OPCODE_MFENCE:
+   case TGSI_OPCODE_LFENCE:
+   case TGSI_OPCODE_SFENCE:
+      cost->latency = 1;
+      cost->unit = TGSI_UNIT_FLOW;
+      break;
+   case TGSI_OPCODE_RCP:
+   case TGSI_OPCODE_RSQ:
+   case TGSI_OPCODE_SQRT:
+   case TGSI_OPCODE_EX2:
+   case TGSI_OPCODE_LG2:
+   case TGSI_OPCODE_SIN:
+   case TGSI_OPCODE_COS:
+      cost->latency = 8;
+      cost->throughput = 4;
+      cost->unit = TGSI_UNIT_TRANSCENDENTAL;
+      break;
+   case TGSI_OPCODE_EXP:
+   case TGSI_OPCODE_LOG:
+   case TGSI_OPCODE_LIT:
+   case TGSI_OPCODE_POW:
+   case TGSI_OPCODE_SCS:
+   case TGSI_OPCODE_DIV:
+      /* usually two or three transcendental ops */
+      cost->latency = 16;
+      cost->throughput = 8;
+      cost->unit = TGSI_UNIT_TRANSCENDENTAL;
+      break;
+   case TGSI_OPCODE_IDIV:
+   case TGSI_OPCODE_UDIV:
+   case TGSI_OPCODE_MOD:
+   case TGSI_OPCODE_UMOD:
+      cost->latency = 32;
+      cost->throughput = 16;
+      cost->unit = TGSI_UNIT_TRANSCENDENTAL;
+      break;
+   case TGSI_OPCODE_LOAD:
+   case TGSI_OPCODE_STORE:
+   case TGSI_OPCODE_ATOMUADD:
+   case TGSI_OPCODE_ATOMXCHG:
+   case TGSI_OPCODE_ATOMCAS:
+   case TGSI_OPCODE_ATOMAND:
+   case TGSI_OPCODE_ATOMOR:
+   case TGSI_OPCODE_ATOMXOR:
+   case TGSI_OPCODE_ATOMUMIN:
+   case TGSI_OPCODE_ATOMUMAX:
+   case TGSI_OPCODE_ATOMIMIN:
+   case TGSI_OPCODE_ATOMIMAX:
+      cost->latency = 100;
+      cost->throughput = 4;
+      cost->unit = TGSI_UNIT_MEMORY;
+      break;
+   default:
+      break;
+   }
+}
+
+
+/**
+ * Cost of an opcode in the given PIPE_SHADER_x stage of a screen.  Starts
+ * from tgsi_get_opcode_cost() and lets the driver adjust it through
+ * pipe_screen::get_shader_opcode_cost.
+ */
+void
+tgsi_get_screen_opcode_cost( struct pipe_screen *screen,
+                             unsigned shader,
+                             uint opcode,
+                             struct tgsi_opcode_cost *cost )
+{
+   tgsi_get_opcode_cost(opcode, cost);
+
+   if (screen && screen->get_shader_opcode_cost)
+      screen->get_shader_opcode_cost(screen, shader, opcode, cost);
+}
+
+
 /**
  * Infer the type (of the dst) of the opcode.
  *
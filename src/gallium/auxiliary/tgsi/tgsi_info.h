@@ -91,6 +91,37 @@ tgsi_get_opcode_name( uint opcode );
 const char *
 tgsi_get_processor_name( uint processor );
 
+/** The kind of unit that executes an opcode. */
+enum tgsi_opcode_unit {
+   TGSI_UNIT_ALU,
+   TGSI_UNIT_TRANSCENDENTAL,   /**< RCP, RSQ, EX2, SIN, integer division */
+   TGSI_UNIT_TEXTURE,
+   TGSI_UNIT_MEMORY,           /**< LOAD, STORE, atomics */
+   TGSI_UNIT_FLOW              /**< branches, calls, KILL, barriers */
+};
+
+/**
+ * Relative cost of an opcode for compiler heuristics, per enabled channel.
+ * The numbers only mean something relative to each other.
+ */
+struct tgsi_opcode_cost
+{
+   ubyte latency;      /**< until the result can be used */
+   ubyte throughput;   /**< until the unit can take another instruction */
+   ubyte unit;         /**< enum tgsi_opcode_unit */
+};
+
+void
+tgsi_get_opcode_cost( uint opcode, struct tgsi_opcode_cost *cost );
+
+struct pipe_screen;
+
+void
+tgsi_get_screen_opcode_cost( struct pipe_screen *screen,
+                             unsigned shader,
+                             uint opcode,
+                             struct tgsi_opcode_cost *cost );
+
 enum tgsi_opcode_type {
    TGSI_TYPE_UNTYPED, /* for MOV */
    TGSI_TYPE_VOID,
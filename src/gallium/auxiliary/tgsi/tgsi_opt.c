@@ -0,0 +1,1035 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * TGSI optimizer.
+ *
+ * Simple optimizations for token streams from front-ends that don't
+ * optimize themselves (ARB programs, the util and draw shaders, etc):
+ *
+ *  - copy propagation of MOVs within basic blocks;
+ *  - constant folding of float ALU instructions with immediate operands,
+ *    which together with copy propagation folds chains of constants;
+ *  - removal of instructions and channels writing temps that are never
+ *    read, and of instructions thereby made dead;
+ *  - renumbering of the temps still used into a single declaration.
+ *
+ * Shaders using predicates, indirect addressing of temps or temps as
+ * address registers are returned unchanged.  Temps read as texture
+ * offsets are kept live and renumbered, but not propagated into.
+ */
+
+
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "tgsi/tgsi_build.h"
+#include "tgsi/tgsi_info.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_transform.h"
+#include "tgsi/tgsi_util.h"
+#include "tgsi/tgsi_opt.h"
+
+
+/** Register a channel of a temp was last copied from with MOV */
+struct opt_copy
+{
+   boolean valid;
+   boolean dimension;
+   unsigned file;
+   int index;
+   int dimension_index;
+   unsigned swizzle;
+};
+
+
+struct opt_context
+{
+   struct tgsi_transform_context base;
+
+   unsigned passes;
+
+   struct tgsi_full_instruction *insts;
+   boolean *dead;
+   uint num_insts;
+
+   union tgsi_immediate_data (*imms)[4];
+   uint num_imms;  /**< immediates of the input shader */
+   uint total_imms;  /**< including those added by constant folding */
+
+   uint num_temps;
+   struct opt_copy *copies;  /**< 4 channels per temp */
+   unsigned *read_mask;  /**< channels of each temp read anywhere */
+   int *temp_map;  /**< compacted index of each temp, -1 if unused */
+   uint num_new_temps;
+   boolean compact;
+
+   /* emission state */
+   uint imms_seen;
+   uint next_inst;
+   boolean temps_declared;
+};
+
+
+static INLINE struct opt_context *
+opt_context(struct tgsi_transform_context *tctx)
+{
+   return (struct opt_context *) tctx;
+}
+
+
+static INLINE unsigned
+src_swizzle(const struct tgsi_full_src_register *src, unsigned chan)
+{
+   return tgsi_util_get_full_src_register_swizzle(src, chan);
+}
+
+
+/**
+ * Channels of a temp read by a texture offset.
+ */
+static INLINE unsigned
+tex_offset_mask(const struct tgsi_texture_offset *offset)
+{
+   return (1 << offset->SwizzleX) |
+          (1 << offset->SwizzleY) |
+          (1 << offset->SwizzleZ);
+}
+
+
+/**
+ * Instructions that end a basic block, after which no copies are known.
+ */
+static boolean
+ends_block(const struct tgsi_full_instruction *inst)
+{
+   const struct tgsi_opcode_info *info =
+      tgsi_get_opcode_info(inst->Instruction.Opcode);
+
+   if (info->is_branch || info->pre_dedent || info->post_indent)
+      return TRUE;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_CAL:
+   case TGSI_OPCODE_RET:
+   case TGSI_OPCODE_BGNSUB:
+   case TGSI_OPCODE_ENDSUB:
+   case TGSI_OPCODE_END:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Instructions without effects other than writing their destinations.
+ */
+static boolean
+is_removable(const struct tgsi_full_instruction *inst)
+{
+   uint i;
+
+   if (inst->Instruction.NumDstRegs == 0)
+      return FALSE;
+
+   for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+      if (inst->Dst[i].Register.File != TGSI_FILE_TEMPORARY)
+         return FALSE;
+   }
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_ATOMUADD:
+   case TGSI_OPCODE_ATOMXCHG:
+   case TGSI_OPCODE_ATOMCAS:
+   case TGSI_OPCODE_ATOMAND:
+   case TGSI_OPCODE_ATOMOR:
+   case TGSI_OPCODE_ATOMXOR:
+   case TGSI_OPCODE_ATOMUMIN:
+   case TGSI_OPCODE_ATOMUMAX:
+   case TGSI_OPCODE_ATOMIMIN:
+   case TGSI_OPCODE_ATOMIMAX:
+      return FALSE;
+   default:
+      return TRUE;
+   }
+}
+
+
+/**
+ * Whether the optimizer can handle the shader at all.
+ */
+static boolean
+is_supported(const struct tgsi_decoded_shader *shader, boolean *compact)
+{
+   uint n, i;
+
+   if (shader->header.Processor.Processor == TGSI_PROCESSOR_COMPUTE)
+      return FALSE;
+
+   *compact = TRUE;
+   for (n = 0; n < shader->num_declarations; n++) {
+      const struct tgsi_full_declaration *decl = &shader->declarations[n];
+
+      if (decl->Declaration.File == TGSI_FILE_TEMPORARY &&
+          decl->Declaration.Array)
+         *compact = FALSE;
+   }
+
+   for (n = 0; n < shader->num_instructions; n++) {
+      const struct tgsi_full_instruction *inst = &shader->instructions[n];
+
+      if (inst->Instruction.Predicate)
+         return FALSE;
+
+      for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+         const struct tgsi_full_src_register *src = &inst->Src[i];
+
+         if ((src->Register.File == TGSI_FILE_TEMPORARY &&
+              (src->Register.Indirect || src->Register.Dimension)) ||
+             (src->Register.Indirect &&
+              src->Indirect.File == TGSI_FILE_TEMPORARY) ||
+             (src->Register.Dimension && src->Dimension.Indirect &&
+              src->DimIndirect.File == TGSI_FILE_TEMPORARY))
+            return FALSE;
+      }
+
+      for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+         const struct tgsi_full_dst_register *dst = &inst->Dst[i];
+
+         if ((dst->Register.File == TGSI_FILE_TEMPORARY &&
+              (dst->Register.Indirect || dst->Register.Dimension)) ||
+             (dst->Register.Indirect &&
+              dst->Indirect.File == TGSI_FILE_TEMPORARY) ||
+             (dst->Register.Dimension && dst->Dimension.Indirect &&
+              dst->DimIndirect.File == TGSI_FILE_TEMPORARY))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+/*
+ * Copy propagation
+ */
+
+static void
+forget_copies(struct opt_context *ctx)
+{
+   uint i;
+
+   for (i = 0; i < ctx->num_temps * 4; i++)
+      ctx->copies[i].valid = FALSE;
+}
+
+
+/**
+ * Forget what is known about the written channels of a temp, and about
+ * the copies made from it.
+ */
+static void
+forget_temp(struct opt_context *ctx, int index, unsigned writemask)
+{
+   uint i;
+
+   for (i = 0; i < ctx->num_temps * 4; i++) {
+      struct opt_copy *copy = &ctx->copies[i];
+
+      if (copy->valid &&
+          copy->file == TGSI_FILE_TEMPORARY && copy->index == index)
+         copy->valid = FALSE;
+   }
+
+   for (i = 0; i < 4; i++) {
+      if (writemask & (1 << i))
+         ctx->copies[index * 4 + i].valid = FALSE;
+   }
+}
+
+
+static boolean
+same_register(const struct opt_copy *a, const struct opt_copy *b)
+{
+   return a->file == b->file &&
+          a->index == b->index &&
+          a->dimension == b->dimension &&
+          (!a->dimension || a->dimension_index == b->dimension_index);
+}
+
+
+/**
+ * Replace a source temp by the register all its used channels were
+ * copied from.
+ */
+static void
+propagate_src(struct opt_context *ctx, struct tgsi_full_instruction *inst,
+              uint src_idx)
+{
+   struct tgsi_full_src_register *src = &inst->Src[src_idx];
+   const struct opt_copy *first = NULL;
+   unsigned swizzle[4];
+   unsigned usage_mask;
+   uint chan;
+
+   if (src->Register.File != TGSI_FILE_TEMPORARY ||
+       src->Register.Index >= (int) ctx->num_temps)
+      return;
+
+   usage_mask = tgsi_util_get_inst_usage_mask(inst, src_idx);
+
+   for (chan = 0; chan < 4; chan++) {
+      const unsigned comp = src_swizzle(src, chan);
+      const struct opt_copy *copy =
+         &ctx->copies[src->Register.Index * 4 + comp];
+
+      swizzle[chan] = TGSI_SWIZZLE_X;
+
+      if (!(usage_mask & (1 << comp)))
+         continue;
+
+      if (!copy->valid || (first && !same_register(first, copy)))
+         return;
+
+      first = copy;
+      swizzle[chan] = copy->swizzle;
+   }
+
+   if (!first)
+      return;
+
+   src->Register.File = first->file;
+   src->Register.Index = first->index;
+   src->Register.Dimension = first->dimension;
+   if (first->dimension) {
+      src->Dimension.Indirect = 0;
+      src->Dimension.Dimension = 0;
+      src->Dimension.Index = first->dimension_index;
+   }
+   src->Register.SwizzleX = swizzle[0];
+   src->Register.SwizzleY = swizzle[1];
+   src->Register.SwizzleZ = swizzle[2];
+   src->Register.SwizzleW = swizzle[3];
+}
+
+
+/**
+ * Remember the channels copied by a plain MOV into a temp.
+ */
+static void
+record_copy(struct opt_context *ctx, const struct tgsi_full_instruction *inst)
+{
+   const struct tgsi_full_dst_register *dst = &inst->Dst[0];
+   const struct tgsi_full_src_register *src = &inst->Src[0];
+   uint chan;
+
+   if (inst->Instruction.Opcode != TGSI_OPCODE_MOV ||
+       inst->Instruction.Saturate != TGSI_SAT_NONE ||
+       dst->Register.File != TGSI_FILE_TEMPORARY ||
+       dst->Register.Index >= (int) ctx->num_temps ||
+       src->Register.Absolute || src->Register.Negate ||
+       src->Register.Indirect)
+      return;
+
+   switch (src->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      if (src->Register.Index == dst->Register.Index)
+         return;
+      /* fall-through */
+   case TGSI_FILE_IMMEDIATE:
+   case TGSI_FILE_INPUT:
+      if (src->Register.Dimension)
+         return;
+      break;
+   case TGSI_FILE_CONSTANT:
+      if (src->Register.Dimension && src->Dimension.Indirect)
+         return;
+      break;
+   default:
+      return;
+   }
+
+   for (chan = 0; chan < 4; chan++) {
+      struct opt_copy *copy = &ctx->copies[dst->Register.Index * 4 + chan];
+
+      if (!(dst->Register.WriteMask & (1 << chan)))
+         continue;
+
+      copy->valid = TRUE;
+      copy->file = src->Register.File;
+      copy->index = src->Register.Index;
+      copy->dimension = src->Register.Dimension;
+      copy->dimension_index = src->Dimension.Index;
+      copy->swizzle = src_swizzle(src, chan);
+   }
+}
+
+
+/*
+ * Constant folding
+ */
+
+static float
+imm_value(const struct opt_context *ctx,
+          const struct tgsi_full_src_register *src, unsigned chan)
+{
+   float value = ctx->imms[src->Register.Index][src_swizzle(src, chan)].Float;
+
+   if (src->Register.Absolute)
+      value = fabsf(value);
+   if (src->Register.Negate)
+      value = -value;
+   return value;
+}
+
+
+/**
+ * Find or add an immediate holding \p value in the channels of \p mask.
+ */
+static int
+find_immediate(struct opt_context *ctx, const union tgsi_immediate_data *value,
+               unsigned mask)
+{
+   uint i, chan;
+
+   for (i = 0; i < ctx->total_imms; i++) {
+      for (chan = 0; chan < 4; chan++) {
+         if ((mask & (1 << chan)) &&
+             ctx->imms[i][chan].Uint != value[chan].Uint)
+            break;
+      }
+      if (chan == 4)
+         return i;
+   }
+
+   /* there is room for one new immediate per instruction */
+   memcpy(ctx->imms[i], value, 4 * sizeof(*value));
+   ctx->total_imms++;
+   return i;
+}
+
+
+/**
+ * Replace a float ALU instruction reading only immediates by a MOV of
+ * its result.
+ */
+static void
+fold_constants(struct opt_context *ctx, struct tgsi_full_instruction *inst)
+{
+   const unsigned opcode = inst->Instruction.Opcode;
+   const unsigned mask = inst->Dst[0].Register.WriteMask;
+   union tgsi_immediate_data result[4];
+   struct tgsi_full_instruction mov;
+   float a[4], b[4], c[4];
+   uint i, chan;
+
+   switch (opcode) {
+   case TGSI_OPCODE_MOV:
+      /* only worth folding for the modifiers */
+      if (!inst->Src[0].Register.Absolute &&
+          !inst->Src[0].Register.Negate &&
+          inst->Instruction.Saturate == TGSI_SAT_NONE)
+         return;
+      break;
+   case TGSI_OPCODE_ABS:
+   case TGSI_OPCODE_FLR:
+   case TGSI_OPCODE_FRC:
+   case TGSI_OPCODE_ADD:
+   case TGSI_OPCODE_SUB:
+   case TGSI_OPCODE_MUL:
+   case TGSI_OPCODE_MIN:
+   case TGSI_OPCODE_MAX:
+   case TGSI_OPCODE_SLT:
+   case TGSI_OPCODE_SGE:
+   case TGSI_OPCODE_SEQ:
+   case TGSI_OPCODE_SNE:
+   case TGSI_OPCODE_SGT:
+   case TGSI_OPCODE_SLE:
+   case TGSI_OPCODE_DP2:
+   case TGSI_OPCODE_DP3:
+   case TGSI_OPCODE_DP4:
+   case TGSI_OPCODE_MAD:
+   case TGSI_OPCODE_LRP:
+      break;
+   default:
+      return;
+   }
+
+   if (inst->Instruction.NumDstRegs != 1 || mask == 0)
+      return;
+
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      const struct tgsi_full_src_register *src = &inst->Src[i];
+
+      if (src->Register.File != TGSI_FILE_IMMEDIATE ||
+          src->Register.Indirect || src->Register.Dimension)
+         return;
+   }
+
+   for (chan = 0; chan < 4; chan++) {
+      a[chan] = imm_value(ctx, &inst->Src[0], chan);
+      b[chan] = inst->Instruction.NumSrcRegs > 1 ?
+         imm_value(ctx, &inst->Src[1], chan) : 0.0f;
+      c[chan] = inst->Instruction.NumSrcRegs > 2 ?
+         imm_value(ctx, &inst->Src[2], chan) : 0.0f;
+   }
+
+   for (chan = 0; chan < 4; chan++) {
+      float r;
+
+      switch (opcode) {
+      case TGSI_OPCODE_MOV:
+         r = a[chan];
+         break;
+      case TGSI_OPCODE_ABS:
+         r = fabsf(a[chan]);
+         break;
+      case TGSI_OPCODE_FLR:
+         r = floorf(a[chan]);
+         break;
+      case TGSI_OPCODE_FRC:
+         r = a[chan] - floorf(a[chan]);
+         break;
+      case TGSI_OPCODE_ADD:
+         r = a[chan] + b[chan];
+         break;
+      case TGSI_OPCODE_SUB:
+         r = a[chan] - b[chan];
+         break;
+      case TGSI_OPCODE_MUL:
+         r = a[chan] * b[chan];
+         break;
+      case TGSI_OPCODE_MIN:
+         r = a[chan] < b[chan] ? a[chan] : b[chan];
+         break;
+      case TGSI_OPCODE_MAX:
+         r = a[chan] > b[chan] ? a[chan] : b[chan];
+         break;
+      case TGSI_OPCODE_SLT:
+         r = a[chan] < b[chan] ? 1.0f : 0.0f;
+         break;
+      case TGSI_OPCODE_SGE:
+         r = a[chan] >= b[chan] ? 1.0f : 0.0f;
+         break;
+      case TGSI_OPCODE_SEQ:
+         r = a[chan] == b[chan] ? 1.0f : 0.0f;
+         break;
+      case TGSI_OPCODE_SNE:
+         r = a[chan] != b[chan] ? 1.0f : 0.0f;
+         break;
+      case TGSI_OPCODE_SGT:
+         r = a[chan] > b[chan] ? 1.0f : 0.0f;
+         break;
+      case TGSI_OPCODE_SLE:
+         r = a[chan] <= b[chan] ? 1.0f : 0.0f;
+         break;
+      case TGSI_OPCODE_DP2:
+         r = a[0] * b[0] + a[1] * b[1];
+         break;
+      case TGSI_OPCODE_DP3:
+         r = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+         break;
+      case TGSI_OPCODE_DP4:
+         r = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+         break;
+      case TGSI_OPCODE_MAD:
+         r = a[chan] * b[chan] + c[chan];
+         break;
+      case TGSI_OPCODE_LRP:
+         r = a[chan] * (b[chan] - c[chan]) + c[chan];
+         break;
+      default:
+         assert(0);
+         return;
+      }
+
+      if (inst->Instruction.Saturate == TGSI_SAT_ZERO_ONE)
+         r = CLAMP(r, 0.0f, 1.0f);
+      else if (inst->Instruction.Saturate == TGSI_SAT_MINUS_PLUS_ONE)
+         r = CLAMP(r, -1.0f, 1.0f);
+
+      result[chan].Float = (mask & (1 << chan)) ? r : 0.0f;
+   }
+
+   mov = tgsi_default_full_instruction();
+   mov.Instruction.Opcode = TGSI_OPCODE_MOV;
+   mov.Instruction.NumDstRegs = 1;
+   mov.Instruction.NumSrcRegs = 1;
+   mov.Dst[0] = inst->Dst[0];
+   mov.Src[0].Register.File = TGSI_FILE_IMMEDIATE;
+   mov.Src[0].Register.Index = find_immediate(ctx, result, mask);
+   *inst = mov;
+}
+
+
+static void
+propagate_and_fold(struct opt_context *ctx)
+{
+   uint n, i;
+
+   for (n = 0; n < ctx->num_insts; n++) {
+      struct tgsi_full_instruction *inst = &ctx->insts[n];
+
+      if (ctx->passes & TGSI_OPT_COPY_PROPAGATE) {
+         for (i = 0; i < inst->Instruction.NumSrcRegs; i++)
+            propagate_src(ctx, inst, i);
+      }
+
+      if (ctx->passes & TGSI_OPT_CONSTANT_FOLD)
+         fold_constants(ctx, inst);
+
+      if (ends_block(inst)) {
+         forget_copies(ctx);
+         continue;
+      }
+
+      for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+         const struct tgsi_full_dst_register *dst = &inst->Dst[i];
+
+         if (dst->Register.File == TGSI_FILE_TEMPORARY &&
+             dst->Register.Index < (int) ctx->num_temps)
+            forget_temp(ctx, dst->Register.Index, dst->Register.WriteMask);
+      }
+
+      record_copy(ctx, inst);
+   }
+}
+
+
+/*
+ * Dead code elimination
+ */
+
+/**
+ * Drop the writes to temp channels that are never read, until no more
+ * instructions become dead.  This ignores control flow, so it is valid
+ * for loops and subroutines too.
+ */
+static void
+eliminate_dead_code(struct opt_context *ctx)
+{
+   boolean progress;
+   uint n, i;
+
+   do {
+      progress = FALSE;
+
+      memset(ctx->read_mask, 0, ctx->num_temps * sizeof(*ctx->read_mask));
+      for (n = 0; n < ctx->num_insts; n++) {
+         const struct tgsi_full_instruction *inst = &ctx->insts[n];
+
+         if (ctx->dead[n])
+            continue;
+
+         for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+            const struct tgsi_full_src_register *src = &inst->Src[i];
+
+            if (src->Register.File == TGSI_FILE_TEMPORARY &&
+                src->Register.Index < (int) ctx->num_temps)
+               ctx->read_mask[src->Register.Index] |=
+                  tgsi_util_get_inst_usage_mask(inst, i);
+         }
+
+         if (!inst->Instruction.Texture)
+            continue;
+
+         for (i = 0; i < inst->Texture.NumOffsets; i++) {
+            const struct tgsi_texture_offset *offset = &inst->TexOffsets[i];
+
+            if (offset->File == TGSI_FILE_TEMPORARY &&
+                offset->Index < (int) ctx->num_temps)
+               ctx->read_mask[offset->Index] |= tex_offset_mask(offset);
+         }
+      }
+
+      for (n = 0; n < ctx->num_insts; n++) {
+         struct tgsi_full_instruction *inst = &ctx->insts[n];
+         boolean live = FALSE;
+
+         if (ctx->dead[n] || !is_removable(inst))
+            continue;
+
+         for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+            const struct tgsi_full_dst_register *dst = &inst->Dst[i];
+
+            if (dst->Register.Index >= (int) ctx->num_temps ||
+                (dst->Register.WriteMask &
+                 ctx->read_mask[dst->Register.Index]))
+               live = TRUE;
+         }
+
+         if (!live) {
+            ctx->dead[n] = TRUE;
+            progress = TRUE;
+            continue;
+         }
+
+         /* Narrowing the writemask may make sources channels unused. */
+         for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+            struct tgsi_full_dst_register *dst = &inst->Dst[i];
+            unsigned mask;
+
+            if (dst->Register.Index >= (int) ctx->num_temps)
+               continue;
+
+            mask = dst->Register.WriteMask &
+                   ctx->read_mask[dst->Register.Index];
+            if (mask && mask != dst->Register.WriteMask) {
+               dst->Register.WriteMask = mask;
+               progress = TRUE;
+            }
+         }
+      }
+   } while (progress);
+}
+
+
+/**
+ * Point the labels of branch instructions at the new instruction numbers.
+ */
+static void
+remap_labels(struct opt_context *ctx)
+{
+   uint *index;
+   uint n, count = 0;
+
+   index = MALLOC((ctx->num_insts + 1) * sizeof(*index));
+   if (!index)
+      return;
+
+   for (n = 0; n < ctx->num_insts; n++) {
+      index[n] = count;
+      if (!ctx->dead[n])
+         count++;
+   }
+   index[n] = count;
+
+   for (n = 0; n < ctx->num_insts; n++) {
+      struct tgsi_full_instruction *inst = &ctx->insts[n];
+
+      if (!ctx->dead[n] && inst->Instruction.Label &&
+          inst->Label.Label <= ctx->num_insts)
+         inst->Label.Label = index[inst->Label.Label];
+   }
+
+   FREE(index);
+}
+
+
+/*
+ * Temp compaction
+ */
+
+static void
+compact_temps(struct opt_context *ctx)
+{
+   uint n, i;
+
+   for (i = 0; i < ctx->num_temps; i++)
+      ctx->temp_map[i] = -1;
+
+   for (n = 0; n < ctx->num_insts; n++) {
+      struct tgsi_full_instruction *inst = &ctx->insts[n];
+
+      if (ctx->dead[n])
+         continue;
+
+      for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+         struct tgsi_src_register *reg = &inst->Src[i].Register;
+
+         if (reg->File == TGSI_FILE_TEMPORARY &&
+             reg->Index < (int) ctx->num_temps) {
+            if (ctx->temp_map[reg->Index] < 0)
+               ctx->temp_map[reg->Index] = ctx->num_new_temps++;
+            reg->Index = ctx->temp_map[reg->Index];
+         }
+      }
+
+      for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+         struct tgsi_dst_register *reg = &inst->Dst[i].Register;
+
+         if (reg->File == TGSI_FILE_TEMPORARY &&
+             reg->Index < (int) ctx->num_temps) {
+            if (ctx->temp_map[reg->Index] < 0)
+               ctx->temp_map[reg->Index] = ctx->num_new_temps++;
+            reg->Index = ctx->temp_map[reg->Index];
+         }
+      }
+
+      if (!inst->Instruction.Texture)
+         continue;
+
+      for (i = 0; i < inst->Texture.NumOffsets; i++) {
+         struct tgsi_texture_offset *offset = &inst->TexOffsets[i];
+
+         if (offset->File == TGSI_FILE_TEMPORARY &&
+             offset->Index < (int) ctx->num_temps) {
+            if (ctx->temp_map[offset->Index] < 0)
+               ctx->temp_map[offset->Index] = ctx->num_new_temps++;
+            offset->Index = ctx->temp_map[offset->Index];
+         }
+      }
+   }
+}
+
+
+/**
+ * Drop the immediates added by constant folding that are no longer read,
+ * such as intermediate results of folded chains.
+ */
+static void
+drop_unused_immediates(struct opt_context *ctx)
+{
+   int *map;
+   uint n, i, count;
+
+   if (ctx->total_imms == ctx->num_imms)
+      return;
+
+   map = MALLOC((ctx->total_imms - ctx->num_imms) * sizeof(*map));
+   if (!map)
+      return;
+
+   for (i = 0; i < ctx->total_imms - ctx->num_imms; i++)
+      map[i] = -1;
+
+   for (n = 0; n < ctx->num_insts; n++) {
+      const struct tgsi_full_instruction *inst = &ctx->insts[n];
+
+      if (ctx->dead[n])
+         continue;
+
+      for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+         const struct tgsi_src_register *reg = &inst->Src[i].Register;
+
+         if (reg->File == TGSI_FILE_IMMEDIATE &&
+             reg->Index >= (int) ctx->num_imms)
+            map[reg->Index - ctx->num_imms] = 0;
+      }
+   }
+
+   count = ctx->num_imms;
+   for (i = 0; i < ctx->total_imms - ctx->num_imms; i++) {
+      if (map[i] < 0)
+         continue;
+      memmove(ctx->imms[count], ctx->imms[ctx->num_imms + i],
+              sizeof(ctx->imms[0]));
+      map[i] = count++;
+   }
+   ctx->total_imms = count;
+
+   for (n = 0; n < ctx->num_insts; n++) {
+      struct tgsi_full_instruction *inst = &ctx->insts[n];
+
+      for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+         struct tgsi_src_register *reg = &inst->Src[i].Register;
+
+         if (!ctx->dead[n] && reg->File == TGSI_FILE_IMMEDIATE &&
+             reg->Index >= (int) ctx->num_imms)
+            reg->Index = map[reg->Index - ctx->num_imms];
+      }
+   }
+
+   FREE(map);
+}
+
+
+/*
+ * Emission, through tgsi_transform_shader()
+ */
+
+static void
+emit_folded_immediates(struct opt_context *ctx)
+{
+   uint i;
+
+   for (i = ctx->num_imms; i < ctx->total_imms; i++) {
+      struct tgsi_full_immediate imm = tgsi_default_full_immediate();
+
+      imm.Immediate.NrTokens = 1 + 4;
+      imm.Immediate.DataType = TGSI_IMM_FLOAT32;
+      memcpy(imm.u, ctx->imms[i], sizeof(imm.u));
+      ctx->base.emit_immediate(&ctx->base, &imm);
+   }
+}
+
+
+static void
+opt_transform_declaration(struct tgsi_transform_context *tctx,
+                          struct tgsi_full_declaration *decl)
+{
+   struct opt_context *ctx = opt_context(tctx);
+
+   if (decl->Declaration.File == TGSI_FILE_TEMPORARY && ctx->compact) {
+      if (ctx->temps_declared || ctx->num_new_temps == 0)
+         return;
+
+      decl->Range.First = 0;
+      decl->Range.Last = ctx->num_new_temps - 1;
+      ctx->temps_declared = TRUE;
+   }
+
+   tctx->emit_declaration(tctx, decl);
+}
+
+
+static void
+opt_transform_immediate(struct tgsi_transform_context *tctx,
+                        struct tgsi_full_immediate *imm)
+{
+   struct opt_context *ctx = opt_context(tctx);
+
+   tctx->emit_immediate(tctx, imm);
+
+   /* keep the numbering of the original immediates */
+   if (++ctx->imms_seen == ctx->num_imms)
+      emit_folded_immediates(ctx);
+}
+
+
+static void
+opt_transform_instruction(struct tgsi_transform_context *tctx,
+                          struct tgsi_full_instruction *inst)
+{
+   struct opt_context *ctx = opt_context(tctx);
+   const uint n = ctx->next_inst++;
+
+   (void) inst;
+
+   if (ctx->num_imms == 0 && n == 0)
+      emit_folded_immediates(ctx);
+
+   if (n < ctx->num_insts && !ctx->dead[n])
+      tctx->emit_instruction(tctx, &ctx->insts[n]);
+}
+
+
+static void
+opt_context_free(struct opt_context *ctx)
+{
+   FREE(ctx->insts);
+   FREE(ctx->dead);
+   FREE(ctx->imms);
+   FREE(ctx->copies);
+   FREE(ctx->read_mask);
+   FREE(ctx->temp_map);
+}
+
+
+/**
+ * Optimize a shader with the TGSI_OPT_x passes in \p passes.
+ *
+ * \return a new token array, to be freed with FREE(), or NULL if out of
+ *         memory.  Shaders the optimizer can't handle are just copied.
+ */
+struct tgsi_token *
+tgsi_optimize(const struct tgsi_token *tokens, unsigned passes)
+{
+   struct tgsi_decoded_shader *shader;
+   struct opt_context ctx;
+   struct tgsi_token *tokens_out = NULL;
+   uint max_tokens, n, i;
+
+   shader = tgsi_decode_shader(tokens);
+   if (!shader)
+      return NULL;
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.passes = passes;
+
+   if (!is_supported(shader, &ctx.compact)) {
+      tgsi_free_decoded_shader(shader);
+      return tgsi_dup_tokens(tokens);
+   }
+   if (!(passes & TGSI_OPT_COMPACT_TEMPS))
+      ctx.compact = FALSE;
+
+   for (n = 0; n < shader->num_declarations; n++) {
+      const struct tgsi_full_declaration *decl = &shader->declarations[n];
+
+      if (decl->Declaration.File == TGSI_FILE_TEMPORARY)
+         ctx.num_temps = MAX2(ctx.num_temps, decl->Range.Last + 1u);
+   }
+
+   ctx.num_insts = shader->num_instructions;
+   ctx.num_imms = shader->num_immediates;
+   ctx.total_imms = ctx.num_imms;
+
+   ctx.insts = MALLOC(MAX2(ctx.num_insts, 1) * sizeof(*ctx.insts));
+   ctx.dead = CALLOC(MAX2(ctx.num_insts, 1), sizeof(*ctx.dead));
+   ctx.imms = CALLOC(ctx.num_imms + ctx.num_insts + 1, sizeof(*ctx.imms));
+   ctx.copies = CALLOC(MAX2(ctx.num_temps, 1) * 4, sizeof(*ctx.copies));
+   ctx.read_mask = CALLOC(MAX2(ctx.num_temps, 1), sizeof(*ctx.read_mask));
+   ctx.temp_map = MALLOC(MAX2(ctx.num_temps, 1) * sizeof(*ctx.temp_map));
+   if (!ctx.insts || !ctx.dead || !ctx.imms || !ctx.copies ||
+       !ctx.read_mask || !ctx.temp_map)
+      goto out;
+
+   memcpy(ctx.insts, shader->instructions,
+          ctx.num_insts * sizeof(*ctx.insts));
+
+   for (n = 0; n < ctx.num_imms; n++) {
+      const struct tgsi_full_immediate *imm = &shader->immediates[n];
+
+      for (i = 0; i < imm->Immediate.NrTokens - 1; i++)
+         ctx.imms[n][i] = imm->u[i];
+   }
+
+   if (passes & (TGSI_OPT_COPY_PROPAGATE | TGSI_OPT_CONSTANT_FOLD))
+      propagate_and_fold(&ctx);
+
+   if (passes & TGSI_OPT_DEAD_CODE) {
+      eliminate_dead_code(&ctx);
+      remap_labels(&ctx);
+   }
+
+   drop_unused_immediates(&ctx);
+
+   if (ctx.compact)
+      compact_temps(&ctx);
+
+   /* Propagated constants may need a dimension token per source. */
+   max_tokens = tgsi_num_tokens(tokens) +
+                (ctx.total_imms - ctx.num_imms) * 5 +
+                ctx.num_insts * TGSI_FULL_MAX_SRC_REGISTERS + 16;
+   tokens_out = tgsi_alloc_tokens(max_tokens);
+   if (!tokens_out)
+      goto out;
+
+   ctx.base.transform_declaration = opt_transform_declaration;
+   ctx.base.transform_immediate = opt_transform_immediate;
+   ctx.base.transform_instruction = opt_transform_instruction;
+
+   if (tgsi_transform_shader(tokens, tokens_out, max_tokens,
+                             &ctx.base) < 0) {
+      FREE(tokens_out);
+      tokens_out = NULL;
+   }
+
+out:
+   opt_context_free(&ctx);
+   tgsi_free_decoded_shader(shader);
+   return tokens_out;
+}
@@ -0,0 +1,56 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef TGSI_OPT_H
+#define TGSI_OPT_H
+
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_shader_tokens.h"
+
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Passes of tgsi_optimize().
+ */
+#define TGSI_OPT_CONSTANT_FOLD   (1 << 0)
+#define TGSI_OPT_COPY_PROPAGATE  (1 << 1)
+#define TGSI_OPT_DEAD_CODE       (1 << 2)
+#define TGSI_OPT_COMPACT_TEMPS   (1 << 3)
+#define TGSI_OPT_ALL             0xf
+
+
+struct tgsi_token *
+tgsi_optimize(const struct tgsi_token *tokens, unsigned passes);
+
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* TGSI_OPT_H */
@@ -291,6 +291,95 @@ tgsi_alloc_tokens(unsigned num_tokens)
 }
 
 
+static INLINE uint64_t
+hash_rotl(uint64_t x, unsigned r)
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+
+/** Final avalanche of MurmurHash3 */
+static INLINE uint64_t
+hash_fmix(uint64_t h)
+{
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   h *= 0xc4ceb9fe1a85ec53ULL;
+   h ^= h >> 33;
+   return h;
+}
+
+
+static uint64_t
+hash_words(uint64_t h, const uint32_t *words, unsigned count)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++) {
+      uint64_t k = words[i] * 0x87c37b91114253d5ULL;
+
+      k = hash_rotl(k, 31) * 0x4cf5ad432745937fULL;
+      h ^= k;
+      h = hash_rotl(h, 27) * 5 + 0x52dce729;
+   }
+
+   return hash_fmix(h ^ count);
+}
+
+
+/**
+ * 64-bit content hash of a shader, for shader caches.
+ *
+ * Declarations and properties are combined independently of their
+ * order, so shaders that only differ in the order of those hash the same.
+ * Immediates and instructions are hashed in order.  Never returns 0.
+ */
+uint64_t
+tgsi_hash_tokens(const struct tgsi_token *tokens)
+{
+   const uint32_t *words = (const uint32_t *) tokens;
+   struct tgsi_parse_context parse;
+   uint64_t decls = 0, props = 0, body = 0;
+   uint32_t final[7];
+   uint64_t hash;
+
+   if (tgsi_parse_init(&parse, tokens) != TGSI_PARSE_OK)
+      return 1;
+
+   while (!tgsi_parse_end_of_tokens(&parse)) {
+      const unsigned start = parse.Position;
+
+      tgsi_parse_token(&parse);
+
+      switch (parse.FullToken.Token.Type) {
+      case TGSI_TOKEN_TYPE_DECLARATION:
+         decls += hash_words(1, words + start, parse.Position - start);
+         break;
+      case TGSI_TOKEN_TYPE_PROPERTY:
+         props += hash_words(2, words + start, parse.Position - start);
+         break;
+      default:
+         body = hash_words(body, words + start, parse.Position - start);
+         break;
+      }
+   }
+
+   tgsi_parse_free(&parse);
+
+   memcpy(&final[0], &parse.FullHeader.Processor, sizeof(final[0]));
+   final[1] = (uint32_t) decls;
+   final[2] = (uint32_t) (decls >> 32);
+   final[3] = (uint32_t) props;
+   final[4] = (uint32_t) (props >> 32);
+   final[5] = (uint32_t) body;
+   final[6] = (uint32_t) (body >> 32);
+
+   hash = hash_words(0, final, Elements(final));
+   return hash ? hash : 1;
+}
+
+
 void
 tgsi_dump_tokens(const struct tgsi_token *tokens)
 {
@@ -305,3 +394,110 @@ tgsi_dump_tokens(const struct tgsi_token *tokens)
       debug_printf("0x%08x,\n", dwords[i]);
    debug_printf("};\n");
 }
+
+
+/**
+ * Decode a whole token stream, see struct tgsi_decoded_shader.
+ * The result is a single allocation, to be freed with
+ * tgsi_free_decoded_shader().
+ * \return NULL if the tokens can't be parsed or we ran out of memory
+ */
+struct tgsi_decoded_shader *
+tgsi_decode_shader(const struct tgsi_token *tokens)
+{
+   struct tgsi_parse_context parse;
+   struct tgsi_decoded_shader *shader;
+   struct tgsi_full_declaration *declarations;
+   struct tgsi_full_immediate *immediates;
+   struct tgsi_full_instruction *instructions;
+   struct tgsi_full_property *properties;
+   unsigned count[TGSI_TOKEN_TYPE_PROPERTY + 1] = { 0 };
+   char *data;
+
+   if (tgsi_parse_init(&parse, tokens) != TGSI_PARSE_OK)
+      return NULL;
+
+   /* Size the arrays first, so the whole thing is a single allocation.
+    * Instructions don't count their first token in NrTokens, so rather than
+    * second-guessing the token headers this is a plain parse.
+    */
+   while (!tgsi_parse_end_of_tokens(&parse)) {
+      tgsi_parse_token(&parse);
+      if (parse.FullToken.Token.Type > TGSI_TOKEN_TYPE_PROPERTY) {
+         tgsi_parse_free(&parse);
+         return NULL;
+      }
+      count[parse.FullToken.Token.Type]++;
+   }
+   parse.Position = parse.FullHeader.Header.HeaderSize;
+
+   data = MALLOC(sizeof(*shader) +
+                 count[TGSI_TOKEN_TYPE_DECLARATION] * sizeof(*declarations) +
+                 count[TGSI_TOKEN_TYPE_IMMEDIATE] * sizeof(*immediates) +
+                 count[TGSI_TOKEN_TYPE_INSTRUCTION] * sizeof(*instructions) +
+                 count[TGSI_TOKEN_TYPE_PROPERTY] * sizeof(*properties));
+   if (!data) {
+      tgsi_parse_free(&parse);
+      return NULL;
+   }
+
+   shader = (struct tgsi_decoded_shader *) data;
+   data += sizeof(*shader);
+   declarations = (struct tgsi_full_declaration *) data;
+   data += count[TGSI_TOKEN_TYPE_DECLARATION] * sizeof(*declarations);
+   immediates = (struct tgsi_full_immediate *) data;
+   data += count[TGSI_TOKEN_TYPE_IMMEDIATE] * sizeof(*immediates);
+   instructions = (struct tgsi_full_instruction *) data;
+   data += count[TGSI_TOKEN_TYPE_INSTRUCTION] * sizeof(*instructions);
+   properties = (struct tgsi_full_property *) data;
+
+   shader->tokens = tokens;
+   shader->header = parse.FullHeader;
+   shader->num_declarations = 0;
+   shader->num_immediates = 0;
+   shader->num_instructions = 0;
+   shader->num_properties = 0;
+   shader->declarations = declarations;
+   shader->immediates = immediates;
+   shader->instructions = instructions;
+   shader->properties = properties;
+
+   while (!tgsi_parse_end_of_tokens(&parse)) {
+      tgsi_parse_token(&parse);
+
+      switch (parse.FullToken.Token.Type) {
+      case TGSI_TOKEN_TYPE_DECLARATION:
+         declarations[shader->num_declarations++] =
+            parse.FullToken.FullDeclaration;
+         break;
+      case TGSI_TOKEN_TYPE_IMMEDIATE:
+         immediates[shader->num_immediates++] = parse.FullToken.FullImmediate;
+         break;
+      case TGSI_TOKEN_TYPE_INSTRUCTION:
+         instructions[shader->num_instructions++] =
+            parse.FullToken.FullInstruction;
+         break;
+      case TGSI_TOKEN_TYPE_PROPERTY:
+         properties[shader->num_properties++] = parse.FullToken.FullProperty;
+         break;
+      default:
+         assert(0);
+      }
+   }
+
+   tgsi_parse_free(&parse);
+
+   assert(shader->num_declarations == count[TGSI_TOKEN_TYPE_DECLARATION]);
+   assert(shader->num_immediates == count[TGSI_TOKEN_TYPE_IMMEDIATE]);
+   assert(shader->num_instructions == count[TGSI_TOKEN_TYPE_INSTRUCTION]);
+   assert(shader->num_properties == count[TGSI_TOKEN_TYPE_PROPERTY]);
+
+   return shader;
+}
+
+
+void
+tgsi_free_decoded_shader(struct tgsi_decoded_shader *shader)
+{
+   FREE(shader);
+}
@@ -30,6 +30,7 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
 
 #if defined __cplusplus
 extern "C" {
@@ -141,6 +142,13 @@ tgsi_num_tokens(const struct tgsi_token *tokens)
    return header.HeaderSize + header.BodySize;
 }
 
+/** Size of the tokens in bytes, as counted in mem-tgsi */
+static INLINE unsigned
+tgsi_tokens_size(const struct tgsi_token *tokens)
+{
+   return tgsi_num_tokens(tokens) * sizeof(struct tgsi_token);
+}
+
 void
 tgsi_dump_tokens(const struct tgsi_token *tokens);
 
@@ -150,6 +158,49 @@ tgsi_dup_tokens(const struct tgsi_token *tokens);
 struct tgsi_token *
 tgsi_alloc_tokens(unsigned num_tokens);
 
+uint64_t
+tgsi_hash_tokens(const struct tgsi_token *tokens);
+
+/**
+ * The content hash of a shader, computed unless the creator provided it.
+ */
+static INLINE uint64_t
+tgsi_shader_state_hash(const struct pipe_shader_state *state)
+{
+   return state->hash ? state->hash : tgsi_hash_tokens(state->tokens);
+}
+
+
+/**
+ * A token stream decoded once into flat arrays of full tokens, so that
+ * code which walks the same shader repeatedly (interpreters binding a
+ * shader, scans of every variant) doesn't re-parse the bitfields.
+ * Declarations, immediates, instructions and properties each keep their
+ * order in the token stream.  The object is immutable once built and
+ * points to, without owning, the tokens it was decoded from.
+ */
+struct tgsi_decoded_shader
+{
+   const struct tgsi_token *tokens;
+   struct tgsi_full_header header;
+
+   unsigned num_declarations;
+   unsigned num_immediates;
+   unsigned num_instructions;
+   unsigned num_properties;
+
+   const struct tgsi_full_declaration *declarations;
+   const struct tgsi_full_immediate *immediates;
+   const struct tgsi_full_instruction *instructions;
+   const struct tgsi_full_property *properties;
+};
+
+struct tgsi_decoded_shader *
+tgsi_decode_shader(const struct tgsi_token *tokens);
+
+void
+tgsi_free_decoded_shader(struct tgsi_decoded_shader *shader);
+
 
 #if defined __cplusplus
 }
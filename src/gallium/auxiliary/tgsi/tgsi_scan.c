@@ -54,231 +54,228 @@ void
 tgsi_scan_shader(const struct tgsi_token *tokens,
                  struct tgsi_shader_info *info)
 {
-   uint procType, i;
-   struct tgsi_parse_context parse;
+   struct tgsi_decoded_shader *shader = tgsi_decode_shader(tokens);
+
+   if (!shader) {
+      uint i;
+
+      debug_printf("tgsi_decode_shader() failed in tgsi_scan_shader()!\n");
+      memset(info, 0, sizeof(*info));
+      for (i = 0; i < TGSI_FILE_COUNT; i++)
+         info->file_max[i] = -1;
+      return;
+   }
+
+   tgsi_scan_decoded_shader(shader, info);
+   tgsi_free_decoded_shader(shader);
+}
+
+
+/**
+ * As tgsi_scan_shader(), for a shader that is already decoded.
+ */
+void
+tgsi_scan_decoded_shader(const struct tgsi_decoded_shader *shader,
+                         struct tgsi_shader_info *info)
+{
+   uint procType, i, n;
 
    memset(info, 0, sizeof(*info));
    for (i = 0; i < TGSI_FILE_COUNT; i++)
       info->file_max[i] = -1;
 
-   /**
-    ** Setup to begin parsing input shader
-    **/
-   if (tgsi_parse_init( &parse, tokens ) != TGSI_PARSE_OK) {
-      debug_printf("tgsi_parse_init() failed in tgsi_scan_shader()!\n");
-      return;
-   }
-   procType = parse.FullHeader.Processor.Processor;
+   procType = shader->header.Processor.Processor;
    assert(procType == TGSI_PROCESSOR_FRAGMENT ||
           procType == TGSI_PROCESSOR_VERTEX ||
           procType == TGSI_PROCESSOR_GEOMETRY ||
           procType == TGSI_PROCESSOR_COMPUTE);
    info->processor = procType;
 
+   info->num_tokens = shader->num_declarations + shader->num_immediates +
+                      shader->num_instructions + shader->num_properties;
 
-   /**
-    ** Loop over incoming program tokens/instructions
+   /* Declarations precede the instructions that refer to them, so scan
+    * them first.
     */
-   while( !tgsi_parse_end_of_tokens( &parse ) ) {
-
-      info->num_tokens++;
+   for (n = 0; n < shader->num_declarations; n++) {
+      const struct tgsi_full_declaration *fulldecl
+         = &shader->declarations[n];
+      const uint file = fulldecl->Declaration.File;
+      uint reg;
+      for (reg = fulldecl->Range.First;
+           reg <= fulldecl->Range.Last;
+           reg++) {
+         unsigned semName = fulldecl->Semantic.Name;
+         unsigned semIndex = fulldecl->Semantic.Index;
+
+         /* only first 32 regs will appear in this bitfield */
+         info->file_mask[file] |= (1 << reg);
+         info->file_count[file]++;
+         info->file_max[file] = MAX2(info->file_max[file], (int)reg);
+
+         if (file == TGSI_FILE_INPUT) {
+            info->input_semantic_name[reg] = (ubyte) semName;
+            info->input_semantic_index[reg] = (ubyte) semIndex;
+            info->input_interpolate[reg] = (ubyte)fulldecl->Interp.Interpolate;
+            info->input_centroid[reg] = (ubyte)fulldecl->Interp.Centroid;
+            info->input_cylindrical_wrap[reg] = (ubyte)fulldecl->Interp.CylindricalWrap;
+            info->num_inputs++;
+
+            if (procType == TGSI_PROCESSOR_FRAGMENT) {
+               if (semName == TGSI_SEMANTIC_POSITION)
+                  info->reads_position = TRUE;
+               else if (semName == TGSI_SEMANTIC_PRIMID)
+                  info->uses_primid = TRUE;
+               else if (semName == TGSI_SEMANTIC_FACE)
+                  info->uses_frontface = TRUE;
+            }
+         }
+         else if (file == TGSI_FILE_SYSTEM_VALUE) {
+            unsigned index = fulldecl->Range.First;
 
-      tgsi_parse_token( &parse );
+            info->system_value_semantic_name[index] = semName;
+            info->num_system_values = MAX2(info->num_system_values,
+                                           index + 1);
 
-      switch( parse.FullToken.Token.Type ) {
-      case TGSI_TOKEN_TYPE_INSTRUCTION:
-         {
-            const struct tgsi_full_instruction *fullinst
-               = &parse.FullToken.FullInstruction;
-            uint i;
-
-            assert(fullinst->Instruction.Opcode < TGSI_OPCODE_LAST);
-            info->opcode_count[fullinst->Instruction.Opcode]++;
-
-            for (i = 0; i < fullinst->Instruction.NumSrcRegs; i++) {
-               const struct tgsi_full_src_register *src =
-                  &fullinst->Src[i];
-               int ind = src->Register.Index;
-
-               /* Mark which inputs are effectively used */
-               if (src->Register.File == TGSI_FILE_INPUT) {
-                  unsigned usage_mask;
-                  usage_mask = tgsi_util_get_inst_usage_mask(fullinst, i);
-                  if (src->Register.Indirect) {
-                     for (ind = 0; ind < info->num_inputs; ++ind) {
-                        info->input_usage_mask[ind] |= usage_mask;
-                     }
-                  } else {
-                     assert(ind >= 0);
-                     assert(ind < PIPE_MAX_SHADER_INPUTS);
-                     info->input_usage_mask[ind] |= usage_mask;
-                  }
-
-                  if (procType == TGSI_PROCESSOR_FRAGMENT &&
-                      info->reads_position &&
-                      src->Register.Index == 0 &&
-                      (src->Register.SwizzleX == TGSI_SWIZZLE_Z ||
-                       src->Register.SwizzleY == TGSI_SWIZZLE_Z ||
-                       src->Register.SwizzleZ == TGSI_SWIZZLE_Z ||
-                       src->Register.SwizzleW == TGSI_SWIZZLE_Z)) {
-                     info->reads_z = TRUE;
-                  }
+            if (semName == TGSI_SEMANTIC_INSTANCEID) {
+               info->uses_instanceid = TRUE;
+            }
+            else if (semName == TGSI_SEMANTIC_VERTEXID) {
+               info->uses_vertexid = TRUE;
+            }
+            else if (semName == TGSI_SEMANTIC_PRIMID) {
+               info->uses_primid = TRUE;
+            }
+         }
+         else if (file == TGSI_FILE_OUTPUT) {
+            info->output_semantic_name[reg] = (ubyte) semName;
+            info->output_semantic_index[reg] = (ubyte) semIndex;
+            info->num_outputs++;
+
+            if (procType == TGSI_PROCESSOR_VERTEX ||
+                procType == TGSI_PROCESSOR_GEOMETRY) {
+               if (semName == TGSI_SEMANTIC_CLIPDIST) {
+                  info->num_written_clipdistance +=
+                     util_bitcount(fulldecl->Declaration.UsageMask);
                }
-
-               /* check for indirect register reads */
-               if (src->Register.Indirect) {
-                  info->indirect_files |= (1 << src->Register.File);
+               else if (semName == TGSI_SEMANTIC_CULLDIST) {
+                  info->num_written_culldistance +=
+                     util_bitcount(fulldecl->Declaration.UsageMask);
                }
+            }
 
-               /* MSAA samplers */
-               if (src->Register.File == TGSI_FILE_SAMPLER) {
-                  assert(fullinst->Instruction.Texture);
-                  assert(src->Register.Index < Elements(info->is_msaa_sampler));
-
-                  if (fullinst->Instruction.Texture &&
-                      (fullinst->Texture.Texture == TGSI_TEXTURE_2D_MSAA ||
-                       fullinst->Texture.Texture == TGSI_TEXTURE_2D_ARRAY_MSAA)) {
-                     info->is_msaa_sampler[src->Register.Index] = TRUE;
-                  }
+            if (procType == TGSI_PROCESSOR_FRAGMENT) {
+               if (semName == TGSI_SEMANTIC_POSITION) {
+                  info->writes_z = TRUE;
+               }
+               else if (semName == TGSI_SEMANTIC_STENCIL) {
+                  info->writes_stencil = TRUE;
                }
             }
 
-            /* check for indirect register writes */
-            for (i = 0; i < fullinst->Instruction.NumDstRegs; i++) {
-               const struct tgsi_full_dst_register *dst = &fullinst->Dst[i];
-               if (dst->Register.Indirect) {
-                  info->indirect_files |= (1 << dst->Register.File);
+            if (procType == TGSI_PROCESSOR_VERTEX) {
+               if (semName == TGSI_SEMANTIC_EDGEFLAG) {
+                  info->writes_edgeflag = TRUE;
                }
             }
 
-            info->num_instructions++;
-         }
-         break;
-
-      case TGSI_TOKEN_TYPE_DECLARATION:
-         {
-            const struct tgsi_full_declaration *fulldecl
-               = &parse.FullToken.FullDeclaration;
-            const uint file = fulldecl->Declaration.File;
-            uint reg;
-            for (reg = fulldecl->Range.First;
-                 reg <= fulldecl->Range.Last;
-                 reg++) {
-               unsigned semName = fulldecl->Semantic.Name;
-               unsigned semIndex = fulldecl->Semantic.Index;
-
-               /* only first 32 regs will appear in this bitfield */
-               info->file_mask[file] |= (1 << reg);
-               info->file_count[file]++;
-               info->file_max[file] = MAX2(info->file_max[file], (int)reg);
-
-               if (file == TGSI_FILE_INPUT) {
-                  info->input_semantic_name[reg] = (ubyte) semName;
-                  info->input_semantic_index[reg] = (ubyte) semIndex;
-                  info->input_interpolate[reg] = (ubyte)fulldecl->Interp.Interpolate;
-                  info->input_centroid[reg] = (ubyte)fulldecl->Interp.Centroid;
-                  info->input_cylindrical_wrap[reg] = (ubyte)fulldecl->Interp.CylindricalWrap;
-                  info->num_inputs++;
-
-                  if (procType == TGSI_PROCESSOR_FRAGMENT) {
-                     if (semName == TGSI_SEMANTIC_POSITION)
-                        info->reads_position = TRUE;
-                     else if (semName == TGSI_SEMANTIC_PRIMID)
-                        info->uses_primid = TRUE;
-                     else if (semName == TGSI_SEMANTIC_FACE)
-                        info->uses_frontface = TRUE;
-                  }
-               }
-               else if (file == TGSI_FILE_SYSTEM_VALUE) {
-                  unsigned index = fulldecl->Range.First;
-
-                  info->system_value_semantic_name[index] = semName;
-                  info->num_system_values = MAX2(info->num_system_values,
-                                                 index + 1);
-
-                  if (semName == TGSI_SEMANTIC_INSTANCEID) {
-                     info->uses_instanceid = TRUE;
-                  }
-                  else if (semName == TGSI_SEMANTIC_VERTEXID) {
-                     info->uses_vertexid = TRUE;
-                  }
-                  else if (semName == TGSI_SEMANTIC_PRIMID) {
-                     info->uses_primid = TRUE;
-                  }
+            if (procType == TGSI_PROCESSOR_GEOMETRY) {
+               if (semName == TGSI_SEMANTIC_VIEWPORT_INDEX) {
+                  info->writes_viewport_index = TRUE;
                }
-               else if (file == TGSI_FILE_OUTPUT) {
-                  info->output_semantic_name[reg] = (ubyte) semName;
-                  info->output_semantic_index[reg] = (ubyte) semIndex;
-                  info->num_outputs++;
-
-                  if (procType == TGSI_PROCESSOR_VERTEX ||
-                      procType == TGSI_PROCESSOR_GEOMETRY) {
-                     if (semName == TGSI_SEMANTIC_CLIPDIST) {
-                        info->num_written_clipdistance +=
-                           util_bitcount(fulldecl->Declaration.UsageMask);
-                     }
-                     else if (semName == TGSI_SEMANTIC_CULLDIST) {
-                        info->num_written_culldistance +=
-                           util_bitcount(fulldecl->Declaration.UsageMask);
-                     }
-                  }
-
-                  if (procType == TGSI_PROCESSOR_FRAGMENT) {
-                     if (semName == TGSI_SEMANTIC_POSITION) {
-                        info->writes_z = TRUE;
-                     }
-                     else if (semName == TGSI_SEMANTIC_STENCIL) {
-                        info->writes_stencil = TRUE;
-                     }
-                  }
-
-                  if (procType == TGSI_PROCESSOR_VERTEX) {
-                     if (semName == TGSI_SEMANTIC_EDGEFLAG) {
-                        info->writes_edgeflag = TRUE;
-                     }
-                  }
-
-                  if (procType == TGSI_PROCESSOR_GEOMETRY) {
-                     if (semName == TGSI_SEMANTIC_VIEWPORT_INDEX) {
-                        info->writes_viewport_index = TRUE;
-                     }
-                     else if (semName == TGSI_SEMANTIC_LAYER) {
-                        info->writes_layer = TRUE;
-                     }
-                  }
+               else if (semName == TGSI_SEMANTIC_LAYER) {
+                  info->writes_layer = TRUE;
                }
             }
          }
-         break;
+      }
+   }
 
-      case TGSI_TOKEN_TYPE_IMMEDIATE:
-         {
-            uint reg = info->immediate_count++;
-            uint file = TGSI_FILE_IMMEDIATE;
+   for (n = 0; n < shader->num_immediates; n++) {
+      uint reg = info->immediate_count++;
+      uint file = TGSI_FILE_IMMEDIATE;
+
+      info->file_mask[file] |= (1 << reg);
+      info->file_count[file]++;
+      info->file_max[file] = MAX2(info->file_max[file], (int)reg);
+   }
 
-            info->file_mask[file] |= (1 << reg);
-            info->file_count[file]++;
-            info->file_max[file] = MAX2(info->file_max[file], (int)reg);
+   for (n = 0; n < shader->num_instructions; n++) {
+      const struct tgsi_full_instruction *fullinst
+         = &shader->instructions[n];
+
+      assert(fullinst->Instruction.Opcode < TGSI_OPCODE_LAST);
+      info->opcode_count[fullinst->Instruction.Opcode]++;
+
+      for (i = 0; i < fullinst->Instruction.NumSrcRegs; i++) {
+         const struct tgsi_full_src_register *src =
+            &fullinst->Src[i];
+         int ind = src->Register.Index;
+
+         /* Mark which inputs are effectively used */
+         if (src->Register.File == TGSI_FILE_INPUT) {
+            unsigned usage_mask;
+            usage_mask = tgsi_util_get_inst_usage_mask(fullinst, i);
+            if (src->Register.Indirect) {
+               for (ind = 0; ind < info->num_inputs; ++ind) {
+                  info->input_usage_mask[ind] |= usage_mask;
+               }
+            } else {
+               assert(ind >= 0);
+               assert(ind < PIPE_MAX_SHADER_INPUTS);
+               info->input_usage_mask[ind] |= usage_mask;
+            }
+
+            if (procType == TGSI_PROCESSOR_FRAGMENT &&
+                info->reads_position &&
+                src->Register.Index == 0 &&
+                (src->Register.SwizzleX == TGSI_SWIZZLE_Z ||
+                 src->Register.SwizzleY == TGSI_SWIZZLE_Z ||
+                 src->Register.SwizzleZ == TGSI_SWIZZLE_Z ||
+                 src->Register.SwizzleW == TGSI_SWIZZLE_Z)) {
+               info->reads_z = TRUE;
+            }
          }
-         break;
 
-      case TGSI_TOKEN_TYPE_PROPERTY:
-         {
-            const struct tgsi_full_property *fullprop
-               = &parse.FullToken.FullProperty;
+         /* check for indirect register reads */
+         if (src->Register.Indirect) {
+            info->indirect_files |= (1 << src->Register.File);
+         }
 
-            info->properties[info->num_properties].name =
-               fullprop->Property.PropertyName;
-            memcpy(info->properties[info->num_properties].data,
-                   fullprop->u, 8 * sizeof(unsigned));;
+         /* MSAA samplers */
+         if (src->Register.File == TGSI_FILE_SAMPLER) {
+            assert(fullinst->Instruction.Texture);
+            assert(src->Register.Index < Elements(info->is_msaa_sampler));
 
-            ++info->num_properties;
+            if (fullinst->Instruction.Texture &&
+                (fullinst->Texture.Texture == TGSI_TEXTURE_2D_MSAA ||
+                 fullinst->Texture.Texture == TGSI_TEXTURE_2D_ARRAY_MSAA)) {
+               info->is_msaa_sampler[src->Register.Index] = TRUE;
+            }
          }
-         break;
+      }
 
-      default:
-         assert( 0 );
+      /* check for indirect register writes */
+      for (i = 0; i < fullinst->Instruction.NumDstRegs; i++) {
+         const struct tgsi_full_dst_register *dst = &fullinst->Dst[i];
+         if (dst->Register.Indirect) {
+            info->indirect_files |= (1 << dst->Register.File);
+         }
       }
+
+      info->num_instructions++;
+   }
+
+   for (n = 0; n < shader->num_properties; n++) {
+      const struct tgsi_full_property *fullprop
+         = &shader->properties[n];
+
+      info->properties[info->num_properties].name =
+         fullprop->Property.PropertyName;
+      memcpy(info->properties[info->num_properties].data,
+             fullprop->u, 8 * sizeof(unsigned));;
+
+      ++info->num_properties;
    }
 
    info->uses_kill = (info->opcode_count[TGSI_OPCODE_KILL_IF] ||
@@ -317,7 +314,240 @@ tgsi_scan_shader(const struct tgsi_token *tokens,
       }
    }
 
-   tgsi_parse_free (&parse);
+}
+
+
+
+static void
+use_temp(struct tgsi_shader_liveness *live, int index, int lo, int hi,
+         unsigned read_mask, unsigned write_mask)
+{
+   struct tgsi_temp_usage *temp;
+
+   if (index < 0 || index >= (int) live->num_temps)
+      return;
+
+   temp = &live->temps[index];
+   if (temp->first < 0 || lo < temp->first)
+      temp->first = lo;
+   temp->last = MAX2(temp->last, hi);
+   temp->read_mask |= read_mask;
+   temp->write_mask |= write_mask;
+}
+
+
+static void
+use_indirect_temp(struct tgsi_shader_liveness *live,
+                  const struct tgsi_ind_register *ind, int lo, int hi)
+{
+   if (ind->File == TGSI_FILE_TEMPORARY)
+      use_temp(live, ind->Index, lo, hi, 1 << ind->Swizzle, 0);
+}
+
+
+static void
+use_const(struct tgsi_shader_liveness *live, unsigned buffer,
+          int first, int last)
+{
+   if (buffer >= PIPE_MAX_CONSTANT_BUFFERS || first > last)
+      return;
+
+   live->const_range[buffer].first = MIN2(live->const_range[buffer].first,
+                                          first);
+   live->const_range[buffer].last = MAX2(live->const_range[buffer].last,
+                                         last);
+}
+
+
+/**
+ * Compute the live range and used channels of every temporary, the loop
+ * nesting of every instruction, and the constants each buffer has read,
+ * for register allocation and constant upload in the drivers.
+ *
+ * The ranges are conservative: a temp accessed inside a loop is live
+ * across the whole outermost loop, and temps accessed indirectly, or in
+ * shaders with subroutine calls, are live across the whole shader.
+ * For constants read indirectly, the declared range is assumed read.
+ *
+ * \return NULL if out of memory.
+ */
+struct tgsi_shader_liveness *
+tgsi_scan_liveness(const struct tgsi_decoded_shader *shader)
+{
+   const uint num_insts = shader->num_instructions;
+   struct tgsi_shader_liveness *live;
+   int decl_first[PIPE_MAX_CONSTANT_BUFFERS];
+   int decl_last[PIPE_MAX_CONSTANT_BUFFERS];
+   int *loop_start, *loop_end;
+   boolean whole_shader = FALSE;
+   int depth = 0;
+   uint n, i, b;
+
+   live = CALLOC_STRUCT(tgsi_shader_liveness);
+   if (!live)
+      return NULL;
+
+   for (b = 0; b < PIPE_MAX_CONSTANT_BUFFERS; b++) {
+      decl_first[b] = live->const_range[b].first = INT_MAX;
+      decl_last[b] = live->const_range[b].last = -1;
+   }
+
+   for (n = 0; n < shader->num_declarations; n++) {
+      const struct tgsi_full_declaration *decl = &shader->declarations[n];
+
+      if (decl->Declaration.File == TGSI_FILE_TEMPORARY) {
+         live->num_temps = MAX2(live->num_temps, decl->Range.Last + 1u);
+      }
+      else if (decl->Declaration.File == TGSI_FILE_CONSTANT) {
+         b = decl->Declaration.Dimension ? decl->Dim.Index2D : 0;
+         if (b < PIPE_MAX_CONSTANT_BUFFERS) {
+            decl_first[b] = MIN2(decl_first[b], (int) decl->Range.First);
+            decl_last[b] = MAX2(decl_last[b], (int) decl->Range.Last);
+         }
+      }
+   }
+
+   live->num_instructions = num_insts;
+   live->temps = MALLOC(MAX2(live->num_temps, 1) * sizeof(*live->temps));
+   live->loop_depth = CALLOC(MAX2(num_insts, 1), sizeof(*live->loop_depth));
+   loop_start = MALLOC(MAX2(num_insts, 1) * sizeof(*loop_start));
+   loop_end = MALLOC(MAX2(num_insts, 1) * sizeof(*loop_end));
+   if (!live->temps || !live->loop_depth || !loop_start || !loop_end) {
+      FREE(loop_start);
+      FREE(loop_end);
+      tgsi_free_liveness(live);
+      return NULL;
+   }
+
+   for (i = 0; i < live->num_temps; i++) {
+      live->temps[i].first = -1;
+      live->temps[i].last = -1;
+      live->temps[i].read_mask = 0;
+      live->temps[i].write_mask = 0;
+   }
+
+   /* Find the extent of the outermost loop around each instruction.
+    * loop_start[n] is the BGNLOOP of that loop, or -1 outside loops, and
+    * loop_end[] is indexed by the BGNLOOP.
+    */
+   for (n = 0; n < num_insts; n++) {
+      const struct tgsi_full_instruction *inst = &shader->instructions[n];
+
+      switch (inst->Instruction.Opcode) {
+      case TGSI_OPCODE_BGNLOOP:
+         loop_start[n] = depth ? loop_start[n - 1] : (int) n;
+         loop_end[n] = num_insts - 1;
+         live->loop_depth[n] = depth;
+         depth++;
+         break;
+      case TGSI_OPCODE_ENDLOOP:
+         if (depth == 0) {
+            /* unbalanced ENDLOOP */
+            loop_start[n] = -1;
+            break;
+         }
+         depth--;
+         live->loop_depth[n] = depth;
+         loop_start[n] = loop_start[n - 1];
+         if (depth == 0)
+            loop_end[loop_start[n]] = n;
+         break;
+      case TGSI_OPCODE_CAL:
+         whole_shader = TRUE;
+         /* fall-through */
+      default:
+         live->loop_depth[n] = depth;
+         loop_start[n] = depth ? loop_start[n - 1] : -1;
+         break;
+      }
+   }
+
+   for (n = 0; n < num_insts; n++) {
+      const struct tgsi_full_instruction *inst = &shader->instructions[n];
+      int lo = n, hi = n;
+
+      if (whole_shader) {
+         lo = 0;
+         hi = num_insts - 1;
+      }
+      else if (loop_start[n] >= 0) {
+         lo = loop_start[n];
+         hi = loop_end[loop_start[n]];
+      }
+
+      for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+         const struct tgsi_full_src_register *src = &inst->Src[i];
+         const int index = src->Register.Index;
+
+         if (src->Register.Indirect)
+            use_indirect_temp(live, &src->Indirect, lo, hi);
+         if (src->Register.Dimension && src->Dimension.Indirect)
+            use_indirect_temp(live, &src->DimIndirect, lo, hi);
+
+         if (src->Register.File == TGSI_FILE_TEMPORARY) {
+            const unsigned mask = tgsi_util_get_inst_usage_mask(inst, i);
+
+            if (src->Register.Indirect) {
+               uint t;
+               for (t = 0; t < live->num_temps; t++)
+                  use_temp(live, t, 0, num_insts - 1, mask, 0);
+            }
+            else {
+               use_temp(live, index, lo, hi, mask, 0);
+            }
+         }
+         else if (src->Register.File == TGSI_FILE_CONSTANT) {
+            if (src->Register.Dimension && src->Dimension.Indirect) {
+               for (b = 0; b < PIPE_MAX_CONSTANT_BUFFERS; b++)
+                  use_const(live, b, decl_first[b], decl_last[b]);
+            }
+            else {
+               b = src->Register.Dimension ? src->Dimension.Index : 0;
+               if (src->Register.Indirect)
+                  use_const(live, b, decl_first[b], decl_last[b]);
+               else
+                  use_const(live, b, index, index);
+            }
+         }
+      }
+
+      for (i = 0; i < inst->Instruction.NumDstRegs; i++) {
+         const struct tgsi_full_dst_register *dst = &inst->Dst[i];
+         const unsigned mask = dst->Register.WriteMask;
+
+         if (dst->Register.Indirect)
+            use_indirect_temp(live, &dst->Indirect, lo, hi);
+         if (dst->Register.Dimension && dst->Dimension.Indirect)
+            use_indirect_temp(live, &dst->DimIndirect, lo, hi);
+
+         if (dst->Register.File != TGSI_FILE_TEMPORARY)
+            continue;
+
+         if (dst->Register.Indirect) {
+            uint t;
+            for (t = 0; t < live->num_temps; t++)
+               use_temp(live, t, 0, num_insts - 1, 0, mask);
+         }
+         else {
+            use_temp(live, dst->Register.Index, lo, hi, 0, mask);
+         }
+      }
+   }
+
+   FREE(loop_start);
+   FREE(loop_end);
+   return live;
+}
+
+
+void
+tgsi_free_liveness(struct tgsi_shader_liveness *liveness)
+{
+   if (liveness) {
+      FREE(liveness->temps);
+      FREE(liveness->loop_depth);
+      FREE(liveness);
+   }
 }
 
 
@@ -101,6 +101,52 @@ extern void
 tgsi_scan_shader(const struct tgsi_token *tokens,
                  struct tgsi_shader_info *info);
 
+struct tgsi_decoded_shader;
+
+extern void
+tgsi_scan_decoded_shader(const struct tgsi_decoded_shader *shader,
+                         struct tgsi_shader_info *info);
+
+
+/**
+ * Live range and channel usage of a temporary register.
+ * Instructions are numbered from zero in program order.
+ */
+struct tgsi_temp_usage
+{
+   int first;  /**< first instruction accessing the temp, -1 if unused */
+   int last;   /**< last instruction the temp is live at */
+   ubyte read_mask;  /**< TGSI_WRITEMASK_x of the channels read */
+   ubyte write_mask;  /**< TGSI_WRITEMASK_x of the channels written */
+};
+
+/**
+ * Results of tgsi_scan_liveness().
+ */
+struct tgsi_shader_liveness
+{
+   uint num_temps;  /**< highest declared temp + 1 */
+   struct tgsi_temp_usage *temps;  /**< num_temps entries */
+
+   uint num_instructions;
+   ubyte *loop_depth;  /**< BGNLOOP nesting of each instruction */
+
+   /**
+    * Range of the constants read from each buffer, including any range
+    * addressed indirectly; first > last if the buffer isn't read.
+    */
+   struct {
+      int first;
+      int last;
+   } const_range[PIPE_MAX_CONSTANT_BUFFERS];
+};
+
+extern struct tgsi_shader_liveness *
+tgsi_scan_liveness(const struct tgsi_decoded_shader *shader);
+
+extern void
+tgsi_free_liveness(struct tgsi_shader_liveness *liveness);
+
 
 extern boolean
 tgsi_is_passthrough_shader(const struct tgsi_token *tokens);
@@ -25,6 +25,7 @@
  * 
  **************************************************************************/
 
+#include "os/os_thread.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
@@ -119,6 +120,152 @@ static boolean str_match_nocase_whole( const char **pcur, const char *str )
    return FALSE;
 }
 
+/*
+ * Hash tables used to look up opcode, semantic and file names without
+ * comparing the word against every name.  They are built on first use
+ * from the tgsi_info and tgsi_strings tables.
+ */
+
+#define NAME_TABLE_SIZE 512   /* power of two, at least twice the names */
+
+struct name_table
+{
+   const char *(*get_name)(unsigned index);
+   unsigned count;
+   ushort entry[NAME_TABLE_SIZE];   /**< index + 1, or 0 if empty */
+};
+
+/* Hash the word at str, up to the first non-identifier character, ignoring
+ * case.  The length of the word is returned in len.
+ */
+static unsigned
+hash_word_nocase(const char *str, unsigned *len)
+{
+   unsigned hash = 2166136261u;
+   unsigned i;
+
+   for (i = 0; is_digit_alpha_underscore(&str[i]); i++)
+      hash = (hash ^ (unsigned char) uprcase(str[i])) * 16777619u;
+
+   *len = i;
+   return hash;
+}
+
+static unsigned
+hash_length_nocase(const char *str, unsigned len)
+{
+   unsigned hash = 2166136261u;
+   unsigned i;
+
+   for (i = 0; i < len; i++)
+      hash = (hash ^ (unsigned char) uprcase(str[i])) * 16777619u;
+
+   return hash;
+}
+
+static void
+name_table_init(struct name_table *table,
+                const char *(*get_name)(unsigned index),
+                unsigned count)
+{
+   unsigned i;
+
+   assert(count * 2 <= NAME_TABLE_SIZE);
+
+   table->get_name = get_name;
+   table->count = count;
+   memset(table->entry, 0, sizeof(table->entry));
+
+   for (i = 0; i < count; i++) {
+      const char *name = get_name(i);
+      unsigned len, slot;
+
+      /* removed opcodes have no name */
+      if (!name[0])
+         continue;
+
+      slot = hash_word_nocase(name, &len) & (NAME_TABLE_SIZE - 1);
+      while (table->entry[slot])
+         slot = (slot + 1) & (NAME_TABLE_SIZE - 1);
+      table->entry[slot] = i + 1;
+   }
+}
+
+/* Return the index of the name equal to the len characters at str,
+ * ignoring case, or -1.
+ */
+static int
+name_table_lookup(const struct name_table *table,
+                  const char *str, unsigned len)
+{
+   unsigned slot = hash_length_nocase(str, len) & (NAME_TABLE_SIZE - 1);
+
+   while (table->entry[slot]) {
+      const unsigned index = table->entry[slot] - 1;
+      const char *name = table->get_name(index);
+      unsigned i;
+
+      for (i = 0; i < len && name[i] == uprcase(str[i]); i++)
+         ;
+      if (i == len && name[len] == '\0')
+         return index;
+
+      slot = (slot + 1) & (NAME_TABLE_SIZE - 1);
+   }
+   return -1;
+}
+
+/* Match the whole word at *pcur against the names in table, and move the
+ * pointer past it on success.
+ */
+static boolean
+name_table_match_whole(const struct name_table *table,
+                       const char **pcur, unsigned *index)
+{
+   unsigned len;
+   int i;
+
+   hash_word_nocase(*pcur, &len);
+   i = name_table_lookup(table, *pcur, len);
+   if (i < 0)
+      return FALSE;
+
+   *pcur += len;
+   *index = i;
+   return TRUE;
+}
+
+static const char *
+opcode_name(unsigned index)
+{
+   return tgsi_get_opcode_info(index)->mnemonic;
+}
+
+static const char *
+semantic_name(unsigned index)
+{
+   return tgsi_semantic_names[index];
+}
+
+static struct name_table opcode_names;
+static struct name_table semantic_names;
+static struct name_table file_names;
+static boolean name_tables_ready;
+pipe_static_mutex(name_tables_mutex);
+
+static void
+init_name_tables(void)
+{
+   pipe_mutex_lock(name_tables_mutex);
+   if (!name_tables_ready) {
+      name_table_init(&opcode_names, opcode_name, TGSI_OPCODE_LAST);
+      name_table_init(&semantic_names, semantic_name, TGSI_SEMANTIC_COUNT);
+      name_table_init(&file_names, tgsi_file_name, TGSI_FILE_COUNT);
+      name_tables_ready = TRUE;
+   }
+   pipe_mutex_unlock(name_tables_mutex);
+}
+
 /* Eat zero or more whitespaces.
  */
 static void eat_opt_white( const char **pcur )
@@ -317,18 +464,7 @@ static boolean parse_label( struct translate_ctx *ctx, uint *val )
 static boolean
 parse_file( const char **pcur, uint *file )
 {
-   uint i;
-
-   for (i = 0; i < TGSI_FILE_COUNT; i++) {
-      const char *cur = *pcur;
-
-      if (str_match_nocase_whole( &cur, tgsi_file_name(i) )) {
-         *pcur = cur;
-         *file = i;
-         return TRUE;
-      }
-   }
-   return FALSE;
+   return name_table_match_whole(&file_names, pcur, file);
 }
 
 static boolean
@@ -841,28 +977,43 @@ parse_src_operand(
 static boolean
 match_inst(const char **pcur,
            unsigned *saturate,
-           const struct tgsi_opcode_info *info)
+           unsigned *opcode)
 {
    const char *cur = *pcur;
+   const char *suffix;
+   unsigned len;
+   int i;
+
+   hash_word_nocase(cur, &len);
 
    /* simple case: the whole string matches the instruction name */
-   if (str_match_nocase_whole(&cur, info->mnemonic)) {
-      *pcur = cur;
+   i = name_table_lookup(&opcode_names, cur, len);
+   if (i >= 0) {
+      *pcur = cur + len;
       *saturate = TGSI_SAT_NONE;
+      *opcode = i;
       return TRUE;
    }
 
-   if (str_match_no_case(&cur, info->mnemonic)) {
-      /* the instruction has a suffix, figure it out */
-      if (str_match_nocase_whole(&cur, "_SAT")) {
-         *pcur = cur;
-         *saturate = TGSI_SAT_ZERO_ONE;
+   /* the instruction has a suffix, figure it out */
+   suffix = cur + len - 6;
+   if (len > 6 && str_match_nocase_whole(&suffix, "_SATNV")) {
+      i = name_table_lookup(&opcode_names, cur, len - 6);
+      if (i >= 0) {
+         *pcur = cur + len;
+         *saturate = TGSI_SAT_MINUS_PLUS_ONE;
+         *opcode = i;
          return TRUE;
       }
+   }
 
-      if (str_match_nocase_whole(&cur, "_SATNV")) {
-         *pcur = cur;
-         *saturate = TGSI_SAT_MINUS_PLUS_ONE;
+   suffix = cur + len - 4;
+   if (len > 4 && str_match_nocase_whole(&suffix, "_SAT")) {
+      i = name_table_lookup(&opcode_names, cur, len - 4);
+      if (i >= 0) {
+         *pcur = cur + len;
+         *saturate = TGSI_SAT_ZERO_ONE;
+         *opcode = i;
          return TRUE;
       }
    }
@@ -924,20 +1075,16 @@ parse_instruction(
    /* Parse instruction name.
     */
    eat_opt_white( &ctx->cur );
-   for (i = 0; i < TGSI_OPCODE_LAST; i++) {
-      cur = ctx->cur;
-
+   cur = ctx->cur;
+   i = TGSI_OPCODE_LAST;
+   if (match_inst(&cur, &saturate, &i)) {
       info = tgsi_get_opcode_info( i );
-      if (match_inst(&cur, &saturate, info)) {
-         if (info->num_dst + info->num_src + info->is_tex == 0) {
-            ctx->cur = cur;
-            break;
-         }
-         else if (*cur == '\0' || eat_white( &cur )) {
-            ctx->cur = cur;
-            break;
-         }
-      }
+      if (info->num_dst + info->num_src + info->is_tex == 0)
+         ctx->cur = cur;
+      else if (*cur == '\0' || eat_white( &cur ))
+         ctx->cur = cur;
+      else
+         i = TGSI_OPCODE_LAST;
    }
    if (i == TGSI_OPCODE_LAST) {
       if (has_label)
@@ -1267,37 +1414,34 @@ static boolean parse_declaration( struct translate_ctx *ctx )
             cur++;
             eat_opt_white( &cur );
 
-            for (i = 0; i < TGSI_SEMANTIC_COUNT; i++) {
-               if (str_match_nocase_whole(&cur, tgsi_semantic_names[i])) {
-                  uint index;
+            if (name_table_match_whole(&semantic_names, &cur, &i)) {
+               uint index;
 
-                  cur2 = cur;
+               cur2 = cur;
+               eat_opt_white( &cur2 );
+               if (*cur2 == '[') {
+                  cur2++;
                   eat_opt_white( &cur2 );
-                  if (*cur2 == '[') {
-                     cur2++;
-                     eat_opt_white( &cur2 );
-                     if (!parse_uint( &cur2, &index )) {
-                        report_error( ctx, "Expected literal integer" );
-                        return FALSE;
-                     }
-                     eat_opt_white( &cur2 );
-                     if (*cur2 != ']') {
-                        report_error( ctx, "Expected `]'" );
-                        return FALSE;
-                     }
-                     cur2++;
-
-                     decl.Semantic.Index = index;
-
-                     cur = cur2;
+                  if (!parse_uint( &cur2, &index )) {
+                     report_error( ctx, "Expected literal integer" );
+                     return FALSE;
                   }
+                  eat_opt_white( &cur2 );
+                  if (*cur2 != ']') {
+                     report_error( ctx, "Expected `]'" );
+                     return FALSE;
+                  }
+                  cur2++;
 
-                  decl.Declaration.Semantic = 1;
-                  decl.Semantic.Name = i;
+                  decl.Semantic.Index = index;
 
-                  ctx->cur = cur;
-                  break;
+                  cur = cur2;
                }
+
+               decl.Declaration.Semantic = 1;
+               decl.Semantic.Name = i;
+
+               ctx->cur = cur;
             }
          }
       }
@@ -1570,22 +1714,59 @@ static boolean translate( struct translate_ctx *ctx )
    return TRUE;
 }
 
+static boolean
+text_translate(struct translate_ctx *ctx,
+               const char *text,
+               struct tgsi_token *tokens,
+               uint num_tokens)
+{
+   init_name_tables();
+
+   memset(ctx, 0, sizeof(*ctx));
+   ctx->text = text;
+   ctx->cur = text;
+   ctx->tokens = tokens;
+   ctx->tokens_cur = tokens;
+   ctx->tokens_end = tokens + num_tokens;
+
+   return translate( ctx );
+}
+
 boolean
 tgsi_text_translate(
    const char *text,
    struct tgsi_token *tokens,
    uint num_tokens )
 {
-   struct translate_ctx ctx = {0};
-
-   ctx.text = text;
-   ctx.cur = text;
-   ctx.tokens = tokens;
-   ctx.tokens_cur = tokens;
-   ctx.tokens_end = tokens + num_tokens;
+   struct translate_ctx ctx;
 
-   if (!translate( &ctx ))
+   if (!text_translate( &ctx, text, tokens, num_tokens ))
       return FALSE;
 
    return tgsi_sanity_check( tokens );
 }
+
+/**
+ * Like tgsi_text_translate(), for text that is known to be valid such as
+ * built-in shaders.  The tokens are only sanity-checked in debug builds.
+ *
+ * \return the number of tokens written, or 0 on error
+ */
+uint
+tgsi_text_assemble(
+   const char *text,
+   struct tgsi_token *tokens,
+   uint num_tokens )
+{
+   struct translate_ctx ctx;
+
+   if (!text_translate( &ctx, text, tokens, num_tokens ))
+      return 0;
+
+#ifdef DEBUG
+   if (!tgsi_sanity_check( tokens ))
+      return 0;
+#endif
+
+   return ctx.tokens_cur - tokens;
+}
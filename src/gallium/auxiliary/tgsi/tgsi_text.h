@@ -42,6 +42,12 @@ tgsi_text_translate(
    struct tgsi_token *tokens,
    uint num_tokens );
 
+uint
+tgsi_text_assemble(
+   const char *text,
+   struct tgsi_token *tokens,
+   uint num_tokens );
+
 #if defined __cplusplus
 }
 #endif
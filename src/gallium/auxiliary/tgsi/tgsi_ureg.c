@@ -32,6 +32,7 @@
 #include "tgsi/tgsi_build.h"
 #include "tgsi/tgsi_info.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_sanity.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
@@ -78,6 +79,7 @@ struct ureg_tokens {
 #define UREG_MAX_OUTPUT PIPE_MAX_SHADER_OUTPUTS
 #define UREG_MAX_CONSTANT_RANGE 32
 #define UREG_MAX_IMMEDIATE 256
+#define UREG_IMMEDIATE_HASH_BITS 10
 #define UREG_MAX_ADDR 2
 #define UREG_MAX_PRED 1
 #define UREG_MAX_ARRAY_TEMPS 256
@@ -141,6 +143,25 @@ struct ureg_program
    } immediate[UREG_MAX_IMMEDIATE];
    unsigned nr_immediates;
 
+   /**
+    * Immediate components by type and value.
+    *
+    * Component c of immediate i is entry i * 4 + c + 1, chained from the
+    * bucket of its type and value through immediate_next.  Zero ends a
+    * chain.
+    */
+   unsigned short immediate_hash[1 << UREG_IMMEDIATE_HASH_BITS];
+   unsigned short immediate_next[UREG_MAX_IMMEDIATE * 4 + 1];
+
+   /**
+    * Immediates of each type which may have room left, in declaration
+    * order.  Each list holds the index plus one of its first and last
+    * immediates, chained through immediate_room_next.  Zero ends a list.
+    */
+   unsigned short immediate_room[TGSI_IMM_INT32 + 1];
+   unsigned short immediate_room_tail[TGSI_IMM_INT32 + 1];
+   unsigned short immediate_room_next[UREG_MAX_IMMEDIATE];
+
    struct ureg_src sampler[PIPE_MAX_SAMPLERS];
    unsigned nr_samplers;
 
@@ -214,6 +235,26 @@ static void tokens_expand( struct ureg_tokens *tokens,
    }
 }
 
+void
+ureg_reserve_tokens( struct ureg_program *ureg,
+                     unsigned nr_decl_tokens,
+                     unsigned nr_insn_tokens )
+{
+   struct ureg_tokens *decl = &ureg->domain[DOMAIN_DECL];
+   struct ureg_tokens *insn = &ureg->domain[DOMAIN_INSN];
+
+   /* The instructions are copied after the declarations and the header
+    * when the shader is finalized.
+    */
+   nr_decl_tokens += nr_insn_tokens + 2;
+
+   if (nr_insn_tokens > insn->size)
+      tokens_expand(insn, nr_insn_tokens - insn->count);
+
+   if (nr_decl_tokens > decl->size)
+      tokens_expand(decl, nr_decl_tokens - decl->count);
+}
+
 static void set_bad( struct ureg_program *ureg )
 {
    tokens_error(&ureg->domain[0]);
@@ -737,40 +778,142 @@ match_or_expand_immediate( const unsigned *v,
 }
 
 
+static INLINE unsigned
+immediate_bucket( unsigned type,
+                  unsigned value )
+{
+   /* Fibonacci hashing */
+   return ((value ^ (type << 29)) * 0x9e3779b1) >> (32 - UREG_IMMEDIATE_HASH_BITS);
+}
+
+
+/**
+ * Add components first .. nr-1 of immediate i to the hash.
+ */
+static void
+hash_immediate( struct ureg_program *ureg,
+                unsigned i,
+                unsigned first )
+{
+   unsigned c;
+
+   for (c = first; c < ureg->immediate[i].nr; c++) {
+      unsigned bucket = immediate_bucket(ureg->immediate[i].type,
+                                         ureg->immediate[i].value.u[c]);
+      unsigned entry = i * 4 + c + 1;
+
+      ureg->immediate_next[entry] = ureg->immediate_hash[bucket];
+      ureg->immediate_hash[bucket] = entry;
+   }
+}
+
+
+/**
+ * Append immediate i to the list of its type with room left.
+ */
+static void
+add_immediate_room( struct ureg_program *ureg,
+                    unsigned i )
+{
+   unsigned type = ureg->immediate[i].type;
+
+   ureg->immediate_room_next[i] = 0;
+   if (ureg->immediate_room_tail[type])
+      ureg->immediate_room_next[ureg->immediate_room_tail[type] - 1] = i + 1;
+   else
+      ureg->immediate_room[type] = i + 1;
+   ureg->immediate_room_tail[type] = i + 1;
+}
+
+
+/**
+ * Try to fit v into immediate i, and hash the components it added.
+ */
+static boolean
+fit_immediate( struct ureg_program *ureg,
+               unsigned i,
+               const unsigned *v,
+               unsigned nr,
+               unsigned *swizzle )
+{
+   unsigned old_nr = ureg->immediate[i].nr;
+
+   if (!match_or_expand_immediate(v,
+                                  nr,
+                                  ureg->immediate[i].value.u,
+                                  &ureg->immediate[i].nr,
+                                  swizzle)) {
+      return FALSE;
+   }
+
+   hash_immediate(ureg, i, old_nr);
+   return TRUE;
+}
+
+
 static struct ureg_src
 decl_immediate( struct ureg_program *ureg,
                 const unsigned *v,
                 unsigned nr,
                 unsigned type )
 {
-   unsigned i, j;
+   unsigned i, j, entry, prev;
    unsigned swizzle = 0;
 
-   /* Could do a first pass where we examine all existing immediates
-    * without expanding.
+   /* Look for the components in the immediates that already hold one of
+    * them, and that hold or have room for the others.
     */
+   for (j = 0; j < nr; j++) {
+      for (entry = ureg->immediate_hash[immediate_bucket(type, v[j])];
+           entry != 0;
+           entry = ureg->immediate_next[entry]) {
+         i = (entry - 1) / 4;
+
+         if (ureg->immediate[i].type == type &&
+             ureg->immediate[i].value.u[(entry - 1) % 4] == v[j] &&
+             fit_immediate(ureg, i, v, nr, &swizzle)) {
+            goto out;
+         }
+      }
+   }
 
-   for (i = 0; i < ureg->nr_immediates; i++) {
-      if (ureg->immediate[i].type != type) {
-         continue;
+   /* Otherwise pack them into the first immediate of the type with room
+    * for them, or a new one.  Immediates found full on the way are
+    * dropped from the list.
+    */
+   prev = 0;
+   entry = ureg->immediate_room[type];
+   while (entry) {
+      unsigned next;
+
+      i = entry - 1;
+      next = ureg->immediate_room_next[i];
+
+      if (ureg->immediate[i].nr == 4) {
+         if (prev)
+            ureg->immediate_room_next[prev - 1] = next;
+         else
+            ureg->immediate_room[type] = next;
+         if (ureg->immediate_room_tail[type] == entry)
+            ureg->immediate_room_tail[type] = prev;
       }
-      if (match_or_expand_immediate(v,
-                                    nr,
-                                    ureg->immediate[i].value.u,
-                                    &ureg->immediate[i].nr,
-                                    &swizzle)) {
-         goto out;
+      else {
+         if (fit_immediate(ureg, i, v, nr, &swizzle)) {
+            goto out;
+         }
+         prev = entry;
       }
+
+      entry = next;
    }
 
    if (ureg->nr_immediates < UREG_MAX_IMMEDIATE) {
       i = ureg->nr_immediates++;
       ureg->immediate[i].type = type;
-      if (match_or_expand_immediate(v,
-                                    nr,
-                                    ureg->immediate[i].value.u,
-                                    &ureg->immediate[i].nr,
-                                    &swizzle)) {
+      if (fit_immediate(ureg, i, v, nr, &swizzle)) {
+         if (ureg->immediate[i].nr < 4) {
+            add_immediate_room(ureg, i);
+         }
          goto out;
       }
    }
@@ -826,6 +969,7 @@ ureg_DECL_immediate_block_uint( struct ureg_program *ureg,
                                 const unsigned *v,
                                 unsigned nr )
 {
+   boolean partial = nr % 4 != 0;
    uint index;
    uint i;
 
@@ -843,9 +987,14 @@ ureg_DECL_immediate_block_uint( struct ureg_program *ureg,
       memcpy(ureg->immediate[i].value.u,
              &v[(i - index) * 4],
              ureg->immediate[i].nr * sizeof(uint));
+      hash_immediate(ureg, i, 0);
       nr -= 4;
    }
 
+   /* The last components of the block can be shared. */
+   if (partial)
+      add_immediate_room(ureg, ureg->nr_immediates - 1);
+
    return ureg_src_register(TGSI_FILE_IMMEDIATE, index);
 }
 
@@ -1698,6 +1847,8 @@ void *ureg_create_shader( struct ureg_program *ureg,
    else
       memset(&state.stream_output, 0, sizeof(state.stream_output));
 
+   state.hash = tgsi_hash_tokens(state.tokens);
+
    if (ureg->processor == TGSI_PROCESSOR_VERTEX)
       return pipe->create_vs_state( pipe, &state );
    else
@@ -94,6 +94,15 @@ struct pipe_context;
 struct ureg_program *
 ureg_create( unsigned processor );
 
+/* Size the token buffers up front for a shader expected to need about
+ * this many declaration and instruction tokens, so that they don't have
+ * to grow while it's built.  Going over is fine, the buffers grow as usual.
+ */
+void
+ureg_reserve_tokens( struct ureg_program *ureg,
+                     unsigned nr_decl_tokens,
+                     unsigned nr_insn_tokens );
+
 const struct tgsi_token *
 ureg_finalize( struct ureg_program * );
 
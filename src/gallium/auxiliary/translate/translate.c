@@ -32,8 +32,181 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_state.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_memory.h"
+#include "rtasm/rtasm_cpu.h"
 #include "translate.h"
 
+
+DEBUG_GET_ONCE_BOOL_OPTION(translate_debug, "TRANSLATE_DEBUG", FALSE)
+
+
+#if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
+
+/**
+ * A translate which runs the elements translate_sse can handle through
+ * it, and only the others through translate_generic.  Both write disjoint
+ * parts of the same output vertices.
+ */
+struct translate_split {
+   struct translate translate;
+   struct translate *fast;
+   struct translate *slow;
+};
+
+
+static void
+split_set_buffer(struct translate *translate, unsigned i,
+                 const void *ptr, unsigned stride, unsigned max_index)
+{
+   struct translate_split *split = (struct translate_split *)translate;
+
+   split->fast->set_buffer(split->fast, i, ptr, stride, max_index);
+   split->slow->set_buffer(split->slow, i, ptr, stride, max_index);
+}
+
+
+static void PIPE_CDECL
+split_run_elts(struct translate *translate, const unsigned *elts,
+               unsigned count, unsigned start_instance,
+               unsigned instance_id, void *output_buffer)
+{
+   struct translate_split *split = (struct translate_split *)translate;
+
+   split->fast->run_elts(split->fast, elts, count,
+                         start_instance, instance_id, output_buffer);
+   split->slow->run_elts(split->slow, elts, count,
+                         start_instance, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+split_run_elts16(struct translate *translate, const uint16_t *elts,
+                 unsigned count, unsigned start_instance,
+                 unsigned instance_id, void *output_buffer)
+{
+   struct translate_split *split = (struct translate_split *)translate;
+
+   split->fast->run_elts16(split->fast, elts, count,
+                           start_instance, instance_id, output_buffer);
+   split->slow->run_elts16(split->slow, elts, count,
+                           start_instance, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+split_run_elts8(struct translate *translate, const uint8_t *elts,
+                unsigned count, unsigned start_instance,
+                unsigned instance_id, void *output_buffer)
+{
+   struct translate_split *split = (struct translate_split *)translate;
+
+   split->fast->run_elts8(split->fast, elts, count,
+                          start_instance, instance_id, output_buffer);
+   split->slow->run_elts8(split->slow, elts, count,
+                          start_instance, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+split_run(struct translate *translate, unsigned start, unsigned count,
+          unsigned start_instance, unsigned instance_id,
+          void *output_buffer)
+{
+   struct translate_split *split = (struct translate_split *)translate;
+
+   split->fast->run(split->fast, start, count,
+                    start_instance, instance_id, output_buffer);
+   split->slow->run(split->slow, start, count,
+                    start_instance, instance_id, output_buffer);
+}
+
+
+static void
+split_release(struct translate *translate)
+{
+   struct translate_split *split = (struct translate_split *)translate;
+
+   if (split->fast)
+      split->fast->release(split->fast);
+   if (split->slow)
+      split->slow->release(split->slow);
+   FREE(split);
+}
+
+
+/**
+ * Called when translate_sse can't do the whole key: find the elements it
+ * can do on their own and leave only the rest to translate_generic.
+ */
+static struct translate *
+translate_split_create(const struct translate_key *key)
+{
+   struct translate_key fast_key, slow_key;
+   struct translate_split *split;
+   unsigned i;
+
+   memset(&fast_key, 0, sizeof fast_key);
+   memset(&slow_key, 0, sizeof slow_key);
+   fast_key.output_stride = key->output_stride;
+   slow_key.output_stride = key->output_stride;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *element = &key->element[i];
+      struct translate_key single;
+      struct translate *translate;
+
+      memset(&single, 0, sizeof single);
+      single.output_stride = key->output_stride;
+      single.nr_elements = 1;
+      single.element[0] = *element;
+
+      translate = translate_sse2_create(&single);
+      if (translate) {
+         translate->release(translate);
+         fast_key.element[fast_key.nr_elements++] = *element;
+      }
+      else {
+         slow_key.element[slow_key.nr_elements++] = *element;
+
+         if (debug_get_option_translate_debug()) {
+            debug_printf("translate: %s to %s is not handled by "
+                         "translate_sse\n",
+                         util_format_name(element->input_format),
+                         util_format_name(element->output_format));
+         }
+      }
+   }
+
+   if (!fast_key.nr_elements || !slow_key.nr_elements)
+      return NULL;
+
+   split = CALLOC_STRUCT(translate_split);
+   if (!split)
+      return NULL;
+
+   split->fast = translate_sse2_create(&fast_key);
+   split->slow = translate_generic_create(&slow_key);
+   if (!split->fast || !split->slow) {
+      split_release(&split->translate);
+      return NULL;
+   }
+
+   split->translate.key = *key;
+   split->translate.release = split_release;
+   split->translate.set_buffer = split_set_buffer;
+   split->translate.run_elts = split_run_elts;
+   split->translate.run_elts16 = split_run_elts16;
+   split->translate.run_elts8 = split_run_elts8;
+   split->translate.run = split_run;
+
+   return &split->translate;
+}
+
+#endif
+
+
 struct translate *translate_create( const struct translate_key *key )
 {
    struct translate *translate = NULL;
@@ -42,10 +215,20 @@ struct translate *translate_create( const struct translate_key *key )
    translate = translate_sse2_create( key );
    if (translate)
       return translate;
+
+   if (rtasm_cpu_has_sse()) {
+      translate = translate_split_create( key );
+      if (translate)
+         return translate;
+   }
 #else
    (void)translate;
 #endif
 
+   if (debug_get_option_translate_debug())
+      debug_printf("translate: using translate_generic for all "
+                   "%u elements\n", key->nr_elements);
+
    return translate_generic_create( key );
 }
 
@@ -42,6 +42,8 @@
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_blitter.h"
+#include "util/u_box.h"
+#include "util/u_counter.h"
 #include "util/u_draw_quad.h"
 #include "util/u_sampler.h"
 #include "util/u_simple_shaders.h"
@@ -51,6 +53,9 @@
 
 #define INVALID_PTR ((void*)~0)
 
+/* Rectangles per draw call for the batched functions. */
+#define BLITTER_MAX_BATCH_RECTS 32
+
 struct blitter_context_priv
 {
    struct blitter_context base;
@@ -314,7 +319,8 @@ struct blitter_context *util_blitter_create(struct pipe_context *pipe)
    for (i = 0; i < 4; i++)
       ctx->vertices[i][0][3] = 1; /*v.w*/
 
-   ctx->upload = u_upload_create(pipe, 65536, 4, PIPE_BIND_VERTEX_BUFFER);
+   ctx->upload = u_upload_create_ring(pipe, 65536, 4, 4,
+                                      PIPE_BIND_VERTEX_BUFFER);
 
    return &ctx->base;
 }
@@ -385,6 +391,7 @@ static void blitter_set_running_flag(struct blitter_context_priv *ctx)
                     __LINE__);
    }
    ctx->base.running = TRUE;
+   util_counter_add(UTIL_COUNTER_BLITS, 1);
 }
 
 static void blitter_unset_running_flag(struct blitter_context_priv *ctx)
@@ -566,8 +573,10 @@ static void blitter_set_rectangle(struct blitter_context_priv *ctx,
 
    for (i = 0; i < 4; i++)
       ctx->vertices[i][0][2] = depth; /*z*/
+}
 
-   /* viewport */
+static void blitter_set_viewport(struct blitter_context_priv *ctx)
+{
    ctx->viewport.scale[0] = 0.5f * ctx->dst_width;
    ctx->viewport.scale[1] = 0.5f * ctx->dst_height;
    ctx->viewport.scale[2] = 1.0f;
@@ -920,6 +929,7 @@ static void blitter_draw(struct blitter_context_priv *ctx,
    unsigned offset = 0;
 
    blitter_set_rectangle(ctx, x1, y1, x2, y2, depth);
+   blitter_set_viewport(ctx);
 
    u_upload_data(ctx->upload, 0, sizeof(ctx->vertices), ctx->vertices,
                  &offset, &buf);
@@ -951,6 +961,71 @@ void util_blitter_draw_rectangle(struct blitter_context *blitter,
    blitter_draw(ctx, x1, y1, x2, y2, depth);
 }
 
+/**
+ * Draw many rectangles at the same depth.  For UTIL_BLITTER_ATTRIB_COLOR,
+ * attribs is a single color; for UTIL_BLITTER_ATTRIB_TEXCOORD, it holds
+ * the texcoords of each rectangle.
+ *
+ * Unless the driver overrides draw_rectangle, they all go out as a single
+ * triangle list.
+ */
+static void blitter_draw_rectangles(struct blitter_context_priv *ctx,
+                                    unsigned num_rects,
+                                    const struct pipe_box *rects,
+                                    float depth,
+                                    enum blitter_attrib_type type,
+                                    const union pipe_color_union *attribs)
+{
+   struct blitter_context *blitter = &ctx->base;
+   struct pipe_resource *buf = NULL;
+   float (*vb)[2][4];
+   unsigned offset = 0;
+   unsigned i;
+
+   if (num_rects == 1 ||
+       blitter->draw_rectangle != util_blitter_draw_rectangle) {
+      for (i = 0; i < num_rects; i++) {
+         blitter->draw_rectangle(blitter, rects[i].x, rects[i].y,
+                                 rects[i].x + rects[i].width,
+                                 rects[i].y + rects[i].height, depth, type,
+                                 type == UTIL_BLITTER_ATTRIB_TEXCOORD ?
+                                 &attribs[i] : attribs);
+      }
+      return;
+   }
+
+   if (type == UTIL_BLITTER_ATTRIB_COLOR)
+      blitter_set_clear_color(ctx, attribs);
+
+   if (u_upload_alloc(ctx->upload, 0, num_rects * 6 * sizeof(ctx->vertices[0]),
+                      &offset, &buf, (void**)&vb) != PIPE_OK)
+      return;
+
+   for (i = 0; i < num_rects; i++) {
+      if (type == UTIL_BLITTER_ATTRIB_TEXCOORD)
+         set_texcoords_in_vertices(attribs[i].f, &ctx->vertices[0][1][0], 8);
+
+      blitter_set_rectangle(ctx, rects[i].x, rects[i].y,
+                            rects[i].x + rects[i].width,
+                            rects[i].y + rects[i].height, depth);
+
+      /* The fan as two triangles. */
+      memcpy(vb[0], ctx->vertices[0], sizeof(vb[0]));
+      memcpy(vb[1], ctx->vertices[1], sizeof(vb[0]));
+      memcpy(vb[2], ctx->vertices[2], sizeof(vb[0]));
+      memcpy(vb[3], ctx->vertices[0], sizeof(vb[0]));
+      memcpy(vb[4], ctx->vertices[2], sizeof(vb[0]));
+      memcpy(vb[5], ctx->vertices[3], sizeof(vb[0]));
+      vb += 6;
+   }
+   u_upload_unmap(ctx->upload);
+
+   blitter_set_viewport(ctx);
+   util_draw_vertex_buffer(ctx->base.pipe, NULL, buf, ctx->base.vb_slot,
+                           offset, PIPE_PRIM_TRIANGLES, num_rects * 6, 2);
+   pipe_resource_reference(&buf, NULL);
+}
+
 static void util_blitter_clear_custom(struct blitter_context *blitter,
                                       unsigned width, unsigned height,
                                       unsigned clear_buffers,
@@ -1191,6 +1266,75 @@ void util_blitter_copy_texture(struct blitter_context *blitter,
    pipe_sampler_view_reference(&src_view, NULL);
 }
 
+/**
+ * Blit a region layer by layer, and sample by sample if copy_all_samples.
+ * The states are already bound, only the framebuffer is set here.
+ */
+static void blitter_blit_layers(struct blitter_context_priv *ctx,
+                                struct pipe_surface *dst,
+                                const struct pipe_box *dstbox,
+                                struct pipe_sampler_view *src,
+                                const struct pipe_box *srcbox,
+                                unsigned src_width0, unsigned src_height0,
+                                struct pipe_framebuffer_state *fb_state,
+                                boolean blit_zs, boolean copy_all_samples)
+{
+   struct pipe_context *pipe = ctx->base.pipe;
+   unsigned src_samples = src->texture->nr_samples;
+   int z;
+
+   for (z = 0; z < dstbox->depth; z++) {
+      struct pipe_surface *old;
+
+      /* Set framebuffer state. */
+      if (blit_zs) {
+         fb_state->zsbuf = dst;
+      } else {
+         fb_state->cbufs[0] = dst;
+      }
+      pipe->set_framebuffer_state(pipe, fb_state);
+
+      /* See if we need to blit a multisample or singlesample buffer. */
+      if (copy_all_samples &&
+          src_samples == dst->texture->nr_samples &&
+          dst->texture->nr_samples > 1) {
+         unsigned i, max_sample = MAX2(dst->texture->nr_samples, 1) - 1;
+
+         for (i = 0; i <= max_sample; i++) {
+            pipe->set_sample_mask(pipe, 1 << i);
+            blitter_set_texcoords(ctx, src, src_width0, src_height0,
+                                  srcbox->z + z,
+                                  i, srcbox->x, srcbox->y,
+                                  srcbox->x + srcbox->width,
+                                  srcbox->y + srcbox->height);
+            blitter_draw(ctx, dstbox->x, dstbox->y,
+                         dstbox->x + dstbox->width,
+                         dstbox->y + dstbox->height, 0);
+         }
+      } else {
+         pipe->set_sample_mask(pipe, ~0);
+         blitter_set_texcoords(ctx, src, src_width0, src_height0,
+                               srcbox->z + z, 0,
+                               srcbox->x, srcbox->y,
+                               srcbox->x + srcbox->width,
+                               srcbox->y + srcbox->height);
+         blitter_draw(ctx, dstbox->x, dstbox->y,
+                      dstbox->x + dstbox->width,
+                      dstbox->y + dstbox->height, 0);
+      }
+
+      /* Get the next surface or (if this is the last iteration)
+       * just unreference the last one. */
+      old = dst;
+      if (z < dstbox->depth-1) {
+         dst = ctx->base.get_next_surface_layer(ctx->base.pipe, dst);
+      }
+      if (z) {
+         pipe_surface_reference(&old, NULL);
+      }
+   }
+}
+
 void util_blitter_blit_generic(struct blitter_context *blitter,
                                struct pipe_surface *dst,
                                const struct pipe_box *dstbox,
@@ -1200,6 +1344,24 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
                                unsigned mask, unsigned filter,
                                const struct pipe_scissor_state *scissor,
                                boolean copy_all_samples)
+{
+   util_blitter_blit_generic_regions(blitter, dst, src,
+                                     src_width0, src_height0,
+                                     1, dstbox, srcbox, mask, filter,
+                                     scissor, copy_all_samples);
+}
+
+void util_blitter_blit_generic_regions(struct blitter_context *blitter,
+                                       struct pipe_surface *dst,
+                                       struct pipe_sampler_view *src,
+                                       unsigned src_width0,
+                                       unsigned src_height0,
+                                       unsigned num_regions,
+                                       const struct pipe_box *dstboxes,
+                                       const struct pipe_box *srcboxes,
+                                       unsigned mask, unsigned filter,
+                                       const struct pipe_scissor_state *scissor,
+                                       boolean copy_all_samples)
 {
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
@@ -1208,7 +1370,9 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
    unsigned src_samples = src->texture->nr_samples;
    boolean has_depth, has_stencil, has_color;
    boolean blit_stencil, blit_depth, blit_color;
+   boolean scaled = FALSE;
    void *sampler_state;
+   unsigned r;
    const struct util_format_description *src_desc =
          util_format_description(src->format);
    const struct util_format_description *dst_desc =
@@ -1226,10 +1390,16 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
    blit_stencil = has_stencil && (mask & PIPE_MASK_S) &&
                   ctx->has_stencil_export;
 
-   if (!blit_stencil && !blit_depth && !blit_color) {
+   if ((!blit_stencil && !blit_depth && !blit_color) || !num_regions) {
       return;
    }
 
+   for (r = 0; r < num_regions; r++) {
+      if (dstboxes[r].width != abs(srcboxes[r].width) ||
+          dstboxes[r].height != abs(srcboxes[r].height))
+         scaled = TRUE;
+   }
+
    /* Check whether the states are properly saved. */
    blitter_set_running_flag(ctx);
    blitter_check_saved_vertex_states(ctx);
@@ -1279,9 +1449,7 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
    /* Set the linear filter only for scaled color non-MSAA blits. */
    if (filter == PIPE_TEX_FILTER_LINEAR &&
        !blit_depth && !blit_stencil &&
-       src_samples <= 1 &&
-       (dstbox->width != abs(srcbox->width) ||
-        dstbox->height != abs(srcbox->height))) {
+       src_samples <= 1 && scaled) {
       if (src_target == PIPE_TEXTURE_RECT) {
          sampler_state = ctx->sampler_state_rect_linear;
       } else {
@@ -1347,16 +1515,15 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
         src_target == PIPE_TEXTURE_2D ||
         src_target == PIPE_TEXTURE_RECT) &&
        src_samples <= 1) {
-      /* Draw the quad with the draw_rectangle callback. */
+      /* Draw the quads with the draw_rectangle callback. */
 
       /* Set texture coordinates. - use a pipe color union
        * for interface purposes.
        * XXX pipe_color_union is a wrong name since we use that to set
        * texture coordinates too.
        */
-      union pipe_color_union coord;
-      get_texcoords(src, src_width0, src_height0, srcbox->x, srcbox->y,
-                    srcbox->x+srcbox->width, srcbox->y+srcbox->height, coord.f);
+      union pipe_color_union coords[BLITTER_MAX_BATCH_RECTS];
+      unsigned i, n;
 
       /* Set framebuffer state. */
       if (blit_depth || blit_stencil) {
@@ -1368,62 +1535,26 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
 
       /* Draw. */
       pipe->set_sample_mask(pipe, ~0);
-      blitter->draw_rectangle(blitter, dstbox->x, dstbox->y,
-                              dstbox->x + dstbox->width,
-                              dstbox->y + dstbox->height, 0,
-                              UTIL_BLITTER_ATTRIB_TEXCOORD, &coord);
-   } else {
-      /* Draw the quad with the generic codepath. */
-      int z;
-      for (z = 0; z < dstbox->depth; z++) {
-         struct pipe_surface *old;
-
-         /* Set framebuffer state. */
-         if (blit_depth || blit_stencil) {
-            fb_state.zsbuf = dst;
-         } else {
-            fb_state.cbufs[0] = dst;
-         }
-         pipe->set_framebuffer_state(pipe, &fb_state);
-
-         /* See if we need to blit a multisample or singlesample buffer. */
-         if (copy_all_samples &&
-             src_samples == dst->texture->nr_samples &&
-             dst->texture->nr_samples > 1) {
-            unsigned i, max_sample = MAX2(dst->texture->nr_samples, 1) - 1;
-
-            for (i = 0; i <= max_sample; i++) {
-               pipe->set_sample_mask(pipe, 1 << i);
-               blitter_set_texcoords(ctx, src, src_width0, src_height0,
-                                     srcbox->z + z,
-                                     i, srcbox->x, srcbox->y,
-                                     srcbox->x + srcbox->width,
-                                     srcbox->y + srcbox->height);
-               blitter_draw(ctx, dstbox->x, dstbox->y,
-                            dstbox->x + dstbox->width,
-                            dstbox->y + dstbox->height, 0);
-            }
-         } else {
-            pipe->set_sample_mask(pipe, ~0);
-            blitter_set_texcoords(ctx, src, src_width0, src_height0,
-                                  srcbox->z + z, 0,
-                                  srcbox->x, srcbox->y,
-                                  srcbox->x + srcbox->width,
-                                  srcbox->y + srcbox->height);
-            blitter_draw(ctx, dstbox->x, dstbox->y,
-                         dstbox->x + dstbox->width,
-                         dstbox->y + dstbox->height, 0);
-         }
+      for (r = 0; r < num_regions; r += n) {
+         n = MIN2(num_regions - r, BLITTER_MAX_BATCH_RECTS);
 
-         /* Get the next surface or (if this is the last iteration)
-          * just unreference the last one. */
-         old = dst;
-         if (z < dstbox->depth-1) {
-            dst = ctx->base.get_next_surface_layer(ctx->base.pipe, dst);
-         }
-         if (z) {
-            pipe_surface_reference(&old, NULL);
+         for (i = 0; i < n; i++) {
+            const struct pipe_box *srcbox = &srcboxes[r + i];
+
+            get_texcoords(src, src_width0, src_height0, srcbox->x, srcbox->y,
+                          srcbox->x+srcbox->width, srcbox->y+srcbox->height,
+                          coords[i].f);
          }
+
+         blitter_draw_rectangles(ctx, n, &dstboxes[r], 0,
+                                 UTIL_BLITTER_ATTRIB_TEXCOORD, coords);
+      }
+   } else {
+      /* Draw the quads with the generic codepath. */
+      for (r = 0; r < num_regions; r++) {
+         blitter_blit_layers(ctx, dst, &dstboxes[r], src, &srcboxes[r],
+                             src_width0, src_height0, &fb_state,
+                             blit_depth || blit_stencil, copy_all_samples);
       }
    }
 
@@ -1476,13 +1607,27 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
                                       const union pipe_color_union *color,
                                       unsigned dstx, unsigned dsty,
                                       unsigned width, unsigned height)
+{
+   struct pipe_box rect;
+
+   u_box_2d(dstx, dsty, width, height, &rect);
+   util_blitter_clear_render_target_rects(blitter, dstsurf, color, 1, &rect);
+}
+
+/* Clear many regions of a color surface to a constant value. */
+void util_blitter_clear_render_target_rects(struct blitter_context *blitter,
+                                            struct pipe_surface *dstsurf,
+                                            const union pipe_color_union *color,
+                                            unsigned num_rects,
+                                            const struct pipe_box *rects)
 {
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
    struct pipe_framebuffer_state fb_state;
+   unsigned i, n;
 
    assert(dstsurf->texture);
-   if (!dstsurf->texture)
+   if (!dstsurf->texture || !num_rects)
       return;
 
    /* check the saved state */
@@ -1509,8 +1654,11 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
 
    blitter_set_common_draw_rect_state(ctx, FALSE);
    blitter_set_dst_dimensions(ctx, dstsurf->width, dstsurf->height);
-   blitter->draw_rectangle(blitter, dstx, dsty, dstx+width, dsty+height, 0,
-                           UTIL_BLITTER_ATTRIB_COLOR, color);
+   for (i = 0; i < num_rects; i += n) {
+      n = MIN2(num_rects - i, BLITTER_MAX_BATCH_RECTS);
+      blitter_draw_rectangles(ctx, n, &rects[i], 0,
+                              UTIL_BLITTER_ATTRIB_COLOR, color);
+   }
 
    blitter_restore_vertex_states(ctx);
    blitter_restore_fragment_states(ctx);
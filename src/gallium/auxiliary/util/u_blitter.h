@@ -253,6 +253,23 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
                                const struct pipe_scissor_state *scissor,
                                boolean copy_all_samples);
 
+/**
+ * Same as util_blitter_blit_generic for many regions between the same
+ * views, with the states set up only once.  For 1D, 2D and RECT sources
+ * without multisampling, the rectangles are drawn in a few draw calls.
+ */
+void util_blitter_blit_generic_regions(struct blitter_context *blitter,
+                                       struct pipe_surface *dst,
+                                       struct pipe_sampler_view *src,
+                                       unsigned src_width0,
+                                       unsigned src_height0,
+                                       unsigned num_regions,
+                                       const struct pipe_box *dstboxes,
+                                       const struct pipe_box *srcboxes,
+                                       unsigned mask, unsigned filter,
+                                       const struct pipe_scissor_state *scissor,
+                                       boolean copy_all_samples);
+
 void util_blitter_blit(struct blitter_context *blitter,
 		       const struct pipe_blit_info *info);
 
@@ -316,6 +333,17 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
                                       unsigned dstx, unsigned dsty,
                                       unsigned width, unsigned height);
 
+/**
+ * Same as util_blitter_clear_render_target for many rectangles, of which
+ * only x, y, width and height are used.  They are drawn in a few draw
+ * calls.
+ */
+void util_blitter_clear_render_target_rects(struct blitter_context *blitter,
+                                            struct pipe_surface *dst,
+                                            const union pipe_color_union *color,
+                                            unsigned num_rects,
+                                            const struct pipe_box *rects);
+
 /**
  * Clear a region of a depth-stencil surface, both stencil and depth
  * or only one of them if this is a combined depth-stencil surface.
@@ -29,8 +29,9 @@
  * @file
  * Improved cache implementation.
  *
- * Fixed size array with linear probing on collision and LRU eviction
- * on full.
+ * Array with linear probing on collision and LRU eviction on full.
+ * With a budget set, the array grows instead of evicting while the misses
+ * outnumber the hits.
  * 
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -79,6 +80,14 @@ struct util_cache
    
    unsigned count;
    struct util_cache_entry lru;
+
+   /** Number of entries the cache may grow to, 0 for a fixed size */
+   uint32_t max_count;
+
+   uint64_t hits, misses, evictions;
+
+   /** Since the last growth */
+   unsigned recent_hits, recent_misses, recent_evictions;
 };
 
 static void
@@ -177,24 +186,92 @@ util_cache_entry_destroy(struct util_cache *cache,
 }
 
 
+/**
+ * Rehash the entries into a table for \p count entries, keeping their LRU
+ * order.  This also drops the DELETED markers.
+ */
+static void
+util_cache_resize(struct util_cache *cache, uint32_t count)
+{
+   struct util_cache_entry *old_entries = cache->entries;
+   struct util_cache_entry *oldest = cache->lru.prev;
+   struct util_cache_entry *old, *entry;
+   uint32_t size = count * CACHE_DEFAULT_ALPHA;
+
+   entry = CALLOC(size, sizeof(struct util_cache_entry));
+   if (!entry)
+      return;
+
+   cache->entries = entry;
+   cache->size = size;
+   make_empty_list(&cache->lru);
+
+   /* The old entries still link to &cache->lru at both ends. */
+   for (old = oldest; old != &cache->lru; old = old->prev) {
+      entry = util_cache_entry_get(cache, old->hash, old->key);
+      assert(entry && entry->state == EMPTY);
+      entry->key = old->key;
+      entry->hash = old->hash;
+      entry->value = old->value;
+      entry->state = FILLED;
+      insert_at_head(&cache->lru, entry);
+   }
+
+   FREE(old_entries);
+
+   cache->recent_hits = 0;
+   cache->recent_misses = 0;
+   cache->recent_evictions = 0;
+}
+
+
+/**
+ * Whether to grow instead of evicting: once a full cache's worth of
+ * entries has been evicted since the last growth while the misses still
+ * outnumber the hits, the working set doesn't fit.
+ */
+static INLINE boolean
+util_cache_should_grow(const struct util_cache *cache)
+{
+   uint32_t count = cache->size / CACHE_DEFAULT_ALPHA;
+
+   return count < cache->max_count &&
+          cache->recent_evictions >= count &&
+          cache->recent_misses > cache->recent_hits;
+}
+
+
 void
 util_cache_set(struct util_cache *cache,
                void *key,
                void *value)
 {
    struct util_cache_entry *entry;
-   uint32_t hash;
+   uint32_t hash, count;
+   boolean replace;
 
    assert(cache);
    if (!cache)
       return;
    hash = cache->hash(key);
+
+   count = cache->size / CACHE_DEFAULT_ALPHA;
+   if (cache->count >= count && util_cache_should_grow(cache))
+      util_cache_resize(cache, MIN2(2 * count, cache->max_count));
+
    entry = util_cache_entry_get(cache, hash, key);
    if (!entry)
       entry = cache->lru.prev;
 
-   if (cache->count >= cache->size / CACHE_DEFAULT_ALPHA)
+   replace = entry->state == FILLED && entry->hash == hash &&
+             cache->compare(key, entry->key) == 0;
+
+   /* Make room, unless the entry of the key itself gets replaced. */
+   if (!replace && cache->count >= cache->size / CACHE_DEFAULT_ALPHA) {
+      cache->evictions++;
+      cache->recent_evictions++;
       util_cache_entry_destroy(cache, cache->lru.prev);
+   }
 
    util_cache_entry_destroy(cache, entry);
    
@@ -225,16 +302,53 @@ util_cache_get(struct util_cache *cache,
       return NULL;
    hash = cache->hash(key);
    entry = util_cache_entry_get(cache, hash, key);
-   if (!entry)
+   if (!entry || entry->state != FILLED) {
+      cache->misses++;
+      cache->recent_misses++;
       return NULL;
+   }
 
-   if (entry->state == FILLED)
-      move_to_head(&cache->lru, entry);
+   cache->hits++;
+   cache->recent_hits++;
+   move_to_head(&cache->lru, entry);
    
    return entry->value;
 }
 
 
+/**
+ * Let the cache grow, when its working set doesn't fit, as long as its
+ * entries stay within \p budget bytes.
+ *
+ * \param entry_size  estimated size of a key and its value
+ */
+void
+util_cache_set_budget(struct util_cache *cache,
+                      size_t budget, size_t entry_size)
+{
+   size_t per_entry = entry_size +
+      CACHE_DEFAULT_ALPHA * sizeof(struct util_cache_entry);
+
+   assert(cache);
+   if (!cache)
+      return;
+
+   cache->max_count = (uint32_t) MIN2(budget / per_entry, UINT32_MAX / 4);
+}
+
+
+void
+util_cache_get_stats(const struct util_cache *cache,
+                     struct util_cache_stats *stats)
+{
+   stats->hits = cache->hits;
+   stats->misses = cache->misses;
+   stats->evictions = cache->evictions;
+   stats->count = cache->count;
+   stats->size = cache->size / CACHE_DEFAULT_ALPHA;
+}
+
+
 void 
 util_cache_clear(struct util_cache *cache)
 {
@@ -83,6 +83,24 @@ void
 util_cache_remove(struct util_cache *cache,
                   const void *key);
 
+void
+util_cache_set_budget(struct util_cache *cache,
+                      size_t budget, size_t entry_size);
+
+
+struct util_cache_stats
+{
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t evictions;
+   uint32_t count;  /**< entries in the cache */
+   uint32_t size;   /**< maximum number of entries at the current size */
+};
+
+void
+util_cache_get_stats(const struct util_cache *cache,
+                     struct util_cache_stats *stats);
+
 
 #ifdef __cplusplus
 }
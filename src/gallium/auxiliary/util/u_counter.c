@@ -0,0 +1,114 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Driver-internal counters, see u_counter.h.
+ */
+
+
+#include "util/u_counter.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_string.h"
+
+
+boolean util_counters_enabled = FALSE;
+int32_t util_counters[UTIL_COUNTER_COUNT];
+
+static util_counter_source_func util_counter_sources[UTIL_COUNTER_COUNT];
+
+
+static const struct util_counter_info util_counter_infos[UTIL_COUNTER_COUNT] =
+{
+   { "shader-compiles", UTIL_COUNTER_TYPE_EVENTS },
+   { "shader-variants", UTIL_COUNTER_TYPE_LEVEL },
+   { "link-time", UTIL_COUNTER_TYPE_USECS },
+   { "jit-time", UTIL_COUNTER_TYPE_USECS },
+   { "validate-time", UTIL_COUNTER_TYPE_USECS },
+   { "upload-bytes", UTIL_COUNTER_TYPE_BYTES },
+   { "blits", UTIL_COUNTER_TYPE_EVENTS },
+   { "mem-glsl-ir", UTIL_COUNTER_TYPE_MEMORY },
+   { "mem-tgsi", UTIL_COUNTER_TYPE_MEMORY },
+   { "mem-jit", UTIL_COUNTER_TYPE_MEMORY },
+   { "mem-scene", UTIL_COUNTER_TYPE_MEMORY },
+   { "mem-upload", UTIL_COUNTER_TYPE_MEMORY },
+   { "mem-cso", UTIL_COUNTER_TYPE_MEMORY },
+};
+
+
+void
+util_counters_enable(void)
+{
+   util_counters_enabled = TRUE;
+}
+
+
+const struct util_counter_info *
+util_counter_get_info(enum util_counter_id id)
+{
+   assert(id < UTIL_COUNTER_COUNT);
+   return &util_counter_infos[id];
+}
+
+
+int
+util_counter_find(const char *name)
+{
+   int i;
+
+   for (i = 0; i < UTIL_COUNTER_COUNT; i++) {
+      if (strcmp(util_counter_infos[i].name, name) == 0)
+         return i;
+   }
+
+   return -1;
+}
+
+
+void
+util_counter_set_source(enum util_counter_id id, util_counter_source_func func)
+{
+   assert(id < UTIL_COUNTER_COUNT);
+   util_counter_sources[id] = func;
+}
+
+
+uint64_t
+util_counter_get_level(enum util_counter_id id)
+{
+   util_counter_source_func source;
+   int32_t value;
+
+   assert(id < UTIL_COUNTER_COUNT);
+
+   source = util_counter_sources[id];
+   if (source)
+      return source();
+
+   value = p_atomic_read(&util_counters[id]);
+   if (util_counter_infos[id].type == UTIL_COUNTER_TYPE_MEMORY)
+      return (uint32_t) value;
+   return MAX2(value, 0);
+}
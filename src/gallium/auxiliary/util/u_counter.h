@@ -0,0 +1,188 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Process-wide counters of driver-internal events, graphed by the HUD.
+ *
+ * Any module can publish into them.  Events, times and bytes are only
+ * counted once util_counters_enable() has been called, which the HUD does
+ * when one of them is graphed, so they cost a load and a branch otherwise.
+ * Levels, like the number of live shader variants, are always kept.
+ *
+ * The values are 32 bits and wrap; readers only use differences.
+ *
+ * The mem-* counters are levels too: the bytes held by a subsystem, kept
+ * by whoever owns the memory with util_counter_mem_alloc() and
+ * util_counter_mem_free() where it allocates and frees it, or polled from
+ * a function given to util_counter_set_source().  They are meant to be
+ * cheap enough for release builds, not exact: they count what the owners
+ * asked for, not the malloc overhead, and wrap at 4 GB.
+ */
+
+#ifndef U_COUNTER_H
+#define U_COUNTER_H
+
+#include "pipe/p_compiler.h"
+#include "os/os_time.h"
+#include "util/u_atomic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* IF YOU CHANGE THIS, UPDATE util_counter_infos! */
+enum util_counter_id
+{
+   UTIL_COUNTER_SHADER_COMPILES,
+   UTIL_COUNTER_SHADER_VARIANTS,
+   UTIL_COUNTER_LINK_USECS,
+   UTIL_COUNTER_JIT_USECS,
+   UTIL_COUNTER_VALIDATE_USECS,
+   UTIL_COUNTER_UPLOAD_BYTES,
+   UTIL_COUNTER_BLITS,
+   /* the memory counters come last, see UTIL_COUNTER_MEM_FIRST */
+   UTIL_COUNTER_MEM_GLSL_IR,
+   UTIL_COUNTER_MEM_TGSI,
+   UTIL_COUNTER_MEM_JIT,
+   UTIL_COUNTER_MEM_SCENE,
+   UTIL_COUNTER_MEM_UPLOAD,
+   UTIL_COUNTER_MEM_CSO,
+   UTIL_COUNTER_COUNT
+};
+
+#define UTIL_COUNTER_MEM_FIRST UTIL_COUNTER_MEM_GLSL_IR
+
+
+enum util_counter_type
+{
+   UTIL_COUNTER_TYPE_EVENTS,
+   UTIL_COUNTER_TYPE_USECS,
+   UTIL_COUNTER_TYPE_BYTES,
+   UTIL_COUNTER_TYPE_LEVEL,
+   UTIL_COUNTER_TYPE_MEMORY   /**< a level in bytes */
+};
+
+
+struct util_counter_info
+{
+   const char *name;
+   enum util_counter_type type;
+};
+
+
+extern boolean util_counters_enabled;
+extern int32_t util_counters[UTIL_COUNTER_COUNT];
+
+
+/** Polled value of a level, see util_counter_set_source() */
+typedef size_t (*util_counter_source_func)(void);
+
+
+void
+util_counters_enable(void);
+
+const struct util_counter_info *
+util_counter_get_info(enum util_counter_id id);
+
+/** \return the counter called name, or -1 */
+int
+util_counter_find(const char *name);
+
+/**
+ * Have the level id read from func instead of util_counters, for memory
+ * that is already counted elsewhere.
+ */
+void
+util_counter_set_source(enum util_counter_id id, util_counter_source_func func);
+
+/** Current value of a level or memory counter */
+uint64_t
+util_counter_get_level(enum util_counter_id id);
+
+
+static INLINE void
+util_counter_adjust(enum util_counter_id id, int32_t value)
+{
+   int32_t old;
+
+   do {
+      old = p_atomic_read(&util_counters[id]);
+   } while (p_atomic_cmpxchg(&util_counters[id], old, old + value) != old);
+}
+
+
+/**
+ * Count events, time or bytes, if enabled.
+ */
+static INLINE void
+util_counter_add(enum util_counter_id id, int32_t value)
+{
+   if (unlikely(util_counters_enabled))
+      util_counter_adjust(id, value);
+}
+
+
+/**
+ * Start timing something for util_counter_end(); 0 if not enabled.
+ */
+static INLINE int64_t
+util_counter_begin(void)
+{
+   return unlikely(util_counters_enabled) ? os_time_get() : 0;
+}
+
+
+static INLINE void
+util_counter_end(enum util_counter_id id, int64_t start)
+{
+   if (start)
+      util_counter_adjust(id, (int32_t) (os_time_get() - start));
+}
+
+
+/**
+ * Account size bytes to the memory counter id.  Always counted.
+ */
+static INLINE void
+util_counter_mem_alloc(enum util_counter_id id, size_t size)
+{
+   util_counter_adjust(id, (int32_t) size);
+}
+
+
+/** Undo util_counter_mem_alloc() */
+static INLINE void
+util_counter_mem_free(enum util_counter_id id, size_t size)
+{
+   util_counter_adjust(id, -(int32_t) size);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_COUNTER_H */
@@ -50,21 +50,6 @@ pipe_static_mutex(serials_mutex);
 static struct util_hash_table* serials_hash;
 static unsigned serials_last;
 
-static unsigned hash_ptr(void* p)
-{
-   return (unsigned)(uintptr_t)p;
-}
-
-static int compare_ptr(void* a, void* b)
-{
-   if(a == b)
-      return 0;
-   else if(a < b)
-      return -1;
-   else
-      return 1;
-}
-
 static boolean debug_serial(void* p, unsigned* pserial)
 {
    unsigned serial;
@@ -80,7 +65,7 @@ static boolean debug_serial(void* p, unsigned* pserial)
 
    pipe_mutex_lock(serials_mutex);
    if(!serials_hash)
-      serials_hash = util_hash_table_create(hash_ptr, compare_ptr);
+      serials_hash = util_hash_table_create_ptr_keys();
    serial = (unsigned)(uintptr_t)util_hash_table_get(serials_hash, p);
    if(!serial)
    {
@@ -0,0 +1,284 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Persistent on-disk cache of compiled shader blobs.
+ */
+
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+
+#if defined(PIPE_OS_UNIX)
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "u_debug.h"
+#include "u_disk_cache.h"
+#include "u_hash.h"
+#include "u_memory.h"
+#include "u_string.h"
+
+
+#define U_DISK_CACHE_MAGIC 0x31434455 /* "UDC1" */
+
+/** Larger entries are neither stored nor read back */
+#define U_DISK_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+
+struct u_disk_cache
+{
+   char *path;
+};
+
+
+/**
+ * Header at the start of each cache file, followed by the key and then
+ * the data.
+ */
+struct u_disk_cache_header
+{
+   uint32_t magic;
+   uint32_t key_size;
+   uint32_t data_size;
+   uint32_t data_crc;
+};
+
+
+#if defined(PIPE_OS_UNIX)
+
+/**
+ * 64-bit FNV-1a hash, only used to name the files.
+ */
+static uint64_t
+disk_cache_hash(const void *key, unsigned key_size)
+{
+   const uint8_t *bytes = (const uint8_t *)key;
+   uint64_t hash = 0xcbf29ce484222325ULL;
+   unsigned i;
+
+   for (i = 0; i < key_size; i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3ULL;
+   }
+
+   return hash;
+}
+
+
+static void
+disk_cache_filename(const struct u_disk_cache *cache,
+                    const void *key, unsigned key_size,
+                    char *filename, size_t size)
+{
+   util_snprintf(filename, size, "%s/%016llx", cache->path,
+                 (unsigned long long)disk_cache_hash(key, key_size));
+}
+
+
+static boolean
+disk_cache_mkdir(const char *path)
+{
+   return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+#endif /* PIPE_OS_UNIX */
+
+
+struct u_disk_cache *
+u_disk_cache_create(const char *name)
+{
+#if defined(PIPE_OS_UNIX)
+   struct u_disk_cache *cache;
+   const char *dir = debug_get_option("MESA_SHADER_CACHE_DIR", NULL);
+   size_t len;
+
+   if (!dir || !*dir)
+      return NULL;
+
+   if (!disk_cache_mkdir(dir))
+      return NULL;
+
+   cache = CALLOC_STRUCT(u_disk_cache);
+   if (!cache)
+      return NULL;
+
+   len = strlen(dir) + strlen(name) + 2;
+   cache->path = MALLOC(len);
+   if (!cache->path) {
+      FREE(cache);
+      return NULL;
+   }
+   util_snprintf(cache->path, len, "%s/%s", dir, name);
+
+   if (!disk_cache_mkdir(cache->path)) {
+      debug_printf("%s: failed to create %s\n", __FUNCTION__, cache->path);
+      u_disk_cache_destroy(cache);
+      return NULL;
+   }
+
+   return cache;
+#else
+   (void)name;
+   return NULL;
+#endif
+}
+
+
+void
+u_disk_cache_destroy(struct u_disk_cache *cache)
+{
+   if (!cache)
+      return;
+
+   FREE(cache->path);
+   FREE(cache);
+}
+
+
+void *
+u_disk_cache_get(struct u_disk_cache *cache,
+                 const void *key, unsigned key_size,
+                 unsigned *size)
+{
+#if defined(PIPE_OS_UNIX)
+   struct u_disk_cache_header header;
+   char filename[4096];
+   void *stored_key = NULL;
+   void *data = NULL;
+   struct stat st;
+   FILE *file;
+
+   disk_cache_filename(cache, key, key_size, filename, sizeof(filename));
+
+   file = fopen(filename, "rb");
+   if (!file)
+      return NULL;
+
+   if (fread(&header, sizeof(header), 1, file) != 1 ||
+       header.magic != U_DISK_CACHE_MAGIC ||
+       header.key_size != key_size ||
+       header.data_size > U_DISK_CACHE_MAX_SIZE)
+      goto miss;
+
+   /* A truncated or corrupt file mustn't make us allocate garbage. */
+   if (fstat(fileno(file), &st) != 0 ||
+       st.st_size != (off_t)(sizeof(header) + key_size + header.data_size))
+      goto miss;
+
+   stored_key = MALLOC(key_size);
+   if (!stored_key ||
+       fread(stored_key, 1, key_size, file) != key_size ||
+       memcmp(stored_key, key, key_size) != 0)
+      goto miss;
+
+   data = MALLOC(header.data_size ? header.data_size : 1);
+   if (!data ||
+       fread(data, 1, header.data_size, file) != header.data_size ||
+       util_hash_crc32(data, header.data_size) != header.data_crc)
+      goto miss;
+
+   FREE(stored_key);
+   fclose(file);
+
+   *size = header.data_size;
+   return data;
+
+miss:
+   FREE(data);
+   FREE(stored_key);
+   fclose(file);
+   return NULL;
+#else
+   (void)cache;
+   (void)key;
+   (void)key_size;
+   (void)size;
+   return NULL;
+#endif
+}
+
+
+void
+u_disk_cache_put(struct u_disk_cache *cache,
+                 const void *key, unsigned key_size,
+                 const void *data, unsigned size)
+{
+#if defined(PIPE_OS_UNIX)
+   struct u_disk_cache_header header;
+   char filename[4096];
+   char tmpname[4096 + 32];
+   boolean ok;
+   FILE *file;
+   int fd;
+
+   if (size > U_DISK_CACHE_MAX_SIZE ||
+       key_size > U_DISK_CACHE_MAX_SIZE)
+      return;
+
+   disk_cache_filename(cache, key, key_size, filename, sizeof(filename));
+
+   /* Write to a private file and rename it into place, so concurrent
+    * writers, in this process or others, never see a partially written
+    * entry.
+    */
+   util_snprintf(tmpname, sizeof(tmpname), "%s.XXXXXX", filename);
+
+   fd = mkstemp(tmpname);
+   if (fd < 0)
+      return;
+
+   file = fdopen(fd, "wb");
+   if (!file) {
+      close(fd);
+      unlink(tmpname);
+      return;
+   }
+
+   header.magic = U_DISK_CACHE_MAGIC;
+   header.key_size = key_size;
+   header.data_size = size;
+   header.data_crc = util_hash_crc32(data, size);
+
+   ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(key, 1, key_size, file) == key_size &&
+        fwrite(data, 1, size, file) == size;
+   ok = fclose(file) == 0 && ok;
+
+   if (!ok || rename(tmpname, filename) != 0)
+      unlink(tmpname);
+#else
+   (void)cache;
+   (void)key;
+   (void)key_size;
+   (void)data;
+   (void)size;
+#endif
+}
@@ -0,0 +1,88 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Persistent on-disk cache of compiled shader blobs.
+ *
+ * Entries are stored one per file under $MESA_SHADER_CACHE_DIR/<name>/,
+ * named after a 64-bit hash of the key.  Every file also holds the full
+ * key, so a hash collision or a stale file is detected on lookup and
+ * simply treated as a miss.  The cache is disabled unless
+ * MESA_SHADER_CACHE_DIR is set.
+ */
+
+#ifndef U_DISK_CACHE_H_
+#define U_DISK_CACHE_H_
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct u_disk_cache;
+
+
+/**
+ * Open the cache directory for the given kind of entries.
+ *
+ * Returns NULL when the cache is disabled or the directory can't be
+ * created.
+ */
+struct u_disk_cache *
+u_disk_cache_create(const char *name);
+
+void
+u_disk_cache_destroy(struct u_disk_cache *cache);
+
+/**
+ * Look up an entry.
+ *
+ * On a hit the data is returned in a MALLOC'ed buffer which the caller
+ * must FREE, and its size is written to *size.
+ */
+void *
+u_disk_cache_get(struct u_disk_cache *cache,
+                 const void *key, unsigned key_size,
+                 unsigned *size);
+
+/**
+ * Store an entry, replacing any previous entry with the same key.
+ * Failures are silently ignored.
+ */
+void
+u_disk_cache_put(struct u_disk_cache *cache,
+                 const void *key, unsigned key_size,
+                 const void *data, unsigned size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_DISK_CACHE_H_ */
@@ -558,11 +558,154 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print '         memcpy(dst, &pixel, sizeof pixel);'
     
 
+SIMD_ZERO = -1
+SIMD_ONE = -2
+
+
+def simd_byte_map(format, unpack):
+    '''For formats of four 8-bit unorm channels, return the source byte of
+    each of the four destination bytes of a pixel when unpacking to (or
+    packing from) rgba_8unorm, or SIMD_ZERO/SIMD_ONE for constants.  Return
+    None for all other formats.'''
+
+    if format.layout != PLAIN or format.block_size() != 32:
+        return None
+    if format.colorspace != RGB:
+        return None
+    for channel in format.channels:
+        if channel.type == VOID:
+            continue
+        if channel.type != UNSIGNED or not channel.norm or channel.pure or channel.size != 8:
+            return None
+
+    if unpack:
+        byte_map = []
+        for i in range(4):
+            swizzle = format.swizzles[i]
+            if swizzle < 4:
+                channel = format.channels[swizzle]
+                if channel.type == VOID:
+                    return None
+                byte_map.append(channel.shift / 8)
+            elif swizzle == SWIZZLE_1:
+                byte_map.append(SIMD_ONE)
+            else:
+                byte_map.append(SIMD_ZERO)
+    else:
+        inv_swizzle = format.inv_swizzles()
+        byte_map = [SIMD_ZERO]*4
+        for i in range(4):
+            channel = format.channels[i]
+            if channel.type != VOID and inv_swizzle[i] is not None:
+                byte_map[channel.shift / 8] = inv_swizzle[i]
+
+    return byte_map
+
+
+def simd_needs_shuffle(byte_map):
+    for i in range(4):
+        if byte_map[i] >= 0 and byte_map[i] != i:
+            return True
+    return False
+
+
+def simd_kernel_name(format, direction, suffix):
+    return 'util_format_%s_%s_%s_sse' % (format.short_name(), direction, suffix)
+
+
+def generate_simd_kernel(format, direction, dst_native_type, dst_suffix, byte_map):
+    '''Generate the SSE function converting four pixels at a time, with
+    a byte shuffle (SSSE3) to reorder the channels when needed.'''
+
+    shuffle = []
+    keep = []
+    ones = []
+    for pixel in range(4):
+        for i in range(4):
+            if byte_map[i] >= 0:
+                shuffle.append('%u' % (pixel*4 + byte_map[i]))
+                keep.append('-1')
+            else:
+                shuffle.append('-128')
+                keep.append('0')
+            if byte_map[i] == SIMD_ONE:
+                ones.append('-1')
+            else:
+                ones.append('0')
+
+    print 'static INLINE void'
+    print '%s(%s *dst, const uint8_t *src, unsigned width)' % (simd_kernel_name(format, direction, dst_suffix), dst_native_type)
+    print '{'
+    if simd_needs_shuffle(byte_map):
+        print '   const __m128i shuffle = _mm_setr_epi8(%s);' % ', '.join(shuffle)
+    elif '0' in keep:
+        print '   const __m128i keep = _mm_setr_epi8(%s);' % ', '.join(keep)
+    if '-1' in ones:
+        print '   const __m128i ones = _mm_setr_epi8(%s);' % ', '.join(ones)
+    if dst_suffix == 'rgba_float':
+        print '   const __m128i zero = _mm_setzero_si128();'
+        print '   const __m128 scale = _mm_set1_ps(1.0f/255.0f);'
+    print '   unsigned x;'
+    print '   for(x = 0; x < width; x += 4) {'
+    print '      __m128i pixels = _mm_loadu_si128((const __m128i *)src);'
+    if simd_needs_shuffle(byte_map):
+        print '      pixels = _mm_shuffle_epi8(pixels, shuffle);'
+    elif '0' in keep:
+        print '      pixels = _mm_and_si128(pixels, keep);'
+    if '-1' in ones:
+        print '      pixels = _mm_or_si128(pixels, ones);'
+    if dst_suffix == 'rgba_float':
+        print '      {'
+        print '         __m128i lo = _mm_unpacklo_epi8(pixels, zero);'
+        print '         __m128i hi = _mm_unpackhi_epi8(pixels, zero);'
+        print '         _mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));'
+        print '         _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));'
+        print '         _mm_storeu_ps(dst + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));'
+        print '         _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));'
+        print '      }'
+    else:
+        print '      _mm_storeu_si128((__m128i *)dst, pixels);'
+    print '      src += 16;'
+    print '      dst += 16;'
+    print '   }'
+    print '}'
+    print
+
+
+def generate_simd_call(format, direction, suffix, byte_map):
+    '''Convert as much of the row as possible with the SSE function, leaving
+    the rest to the scalar loop.'''
+
+    if simd_needs_shuffle(byte_map):
+        cap = 'has_ssse3'
+    else:
+        cap = 'has_sse2'
+
+    print '      x = 0;'
+    print '#if defined(PIPE_ARCH_SSE)'
+    print '      if (util_cpu_caps.%s) {' % cap
+    print '         x = width & ~3;'
+    print '         %s(dst, src, x);' % simd_kernel_name(format, direction, suffix)
+    print '         src += 4*x;'
+    print '         dst += 4*x;'
+    print '      }'
+    print '#endif'
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
     name = format.short_name()
 
+    byte_map = None
+    if dst_suffix in ('rgba_8unorm', 'rgba_float'):
+        byte_map = simd_byte_map(format, True)
+    if byte_map is not None:
+        print '#if defined(PIPE_ARCH_SSE)'
+        generate_simd_kernel(format, 'unpack', dst_native_type, dst_suffix, byte_map)
+        print '#endif'
+        print
+
     print 'static INLINE void'
     print 'util_format_%s_unpack_%s(%s *dst_row, unsigned dst_stride, const uint8_t *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, dst_suffix, dst_native_type)
     print '{'
@@ -572,7 +715,11 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      %s *dst = dst_row;' % (dst_native_type)
         print '      const uint8_t *src = src_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if byte_map is not None:
+            generate_simd_call(format, 'unpack', dst_suffix, byte_map)
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -592,6 +739,15 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
 
     name = format.short_name()
 
+    byte_map = None
+    if src_suffix == 'rgba_8unorm':
+        byte_map = simd_byte_map(format, False)
+    if byte_map is not None:
+        print '#if defined(PIPE_ARCH_SSE)'
+        generate_simd_kernel(format, 'pack', 'uint8_t', src_suffix, byte_map)
+        print '#endif'
+        print
+
     print 'static INLINE void'
     print 'util_format_%s_pack_%s(uint8_t *dst_row, unsigned dst_stride, const %s *src_row, unsigned src_stride, unsigned width, unsigned height)' % (name, src_suffix, src_native_type)
     print '{'
@@ -601,7 +757,11 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      const %s *src = src_row;' % (src_native_type)
         print '      uint8_t *dst = dst_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if byte_map is not None:
+            generate_simd_call(format, 'pack', src_suffix, byte_map)
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
@@ -639,6 +799,7 @@ def is_format_hand_written(format):
 def generate(formats):
     print
     print '#include "pipe/p_compiler.h"'
+    print '#include "u_cpu_detect.h"'
     print '#include "u_math.h"'
     print '#include "u_half.h"'
     print '#include "u_format.h"'
@@ -646,6 +807,7 @@ def generate(formats):
     print '#include "u_format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
+    print '#include "u_sse.h"'
     print
 
     for format in formats:
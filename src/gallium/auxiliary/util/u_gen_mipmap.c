@@ -1619,6 +1619,7 @@ util_gen_mipmap(struct gen_mipmap_state *ctx,
             layer = face;
 
          u_surface_default_template(&surf_templ, pt);
+         surf_templ.format = psv->format;
          surf_templ.u.tex.level = dstLevel;
          surf_templ.u.tex.first_layer = layer;
          surf_templ.u.tex.last_layer = layer;
@@ -29,10 +29,10 @@
  * @file
  * General purpose hash table implementation.
  * 
- * Just uses the cso_hash for now, but it might be better switch to a linear 
- * probing hash table implementation at some point -- as it is said they have 
- * better lookup and cache performance and it appears to be possible to write 
- * a lock-free implementation of such hash tables . 
+ * Open addressing with linear probing.  The keys, values and hashes are
+ * stored inline in a power of two array of slots, which is kept at most
+ * half full (counting the removed slots), so a lookup usually touches a
+ * single cache line and needs no allocation.
  * 
  * @author José Fonseca <jrfonseca@tungstengraphics.com>
  */
@@ -41,43 +41,69 @@
 #include "pipe/p_compiler.h"
 #include "util/u_debug.h"
 
-#include "cso_cache/cso_hash.h"
-
 #include "util/u_memory.h"
 #include "util/u_hash_table.h"
 
 
+#define UTIL_HASH_TABLE_MIN_SIZE 16
+
+#define UTIL_HASH_TABLE_SLOT_EMPTY   0
+#define UTIL_HASH_TABLE_SLOT_USED    1
+#define UTIL_HASH_TABLE_SLOT_DELETED 2
+
+
+struct util_hash_table_slot
+{
+   void *key;
+   void *value;
+   unsigned hash;
+   unsigned state;
+};
+
+
 struct util_hash_table
 {
-   struct cso_hash *cso;   
+   struct util_hash_table_slot *slots;
+   unsigned size;     /**< number of slots, a power of two */
+   unsigned count;    /**< used slots */
+   unsigned deleted;  /**< deleted slots */
    
-   /** Hash function */
+   /** Hash function, NULL for pointer keys */
    unsigned (*hash)(void *key);
    
-   /** Compare two keys */
+   /** Compare two keys, NULL for pointer keys */
    int (*compare)(void *key1, void *key2);
    
    /* TODO: key, value destructors? */
 };
 
 
-struct util_hash_table_item
+/**
+ * Spread the bits of a hash, since linear probing suffers from
+ * clustering with weak hashes such as the identity on aligned pointers.
+ */
+static INLINE unsigned
+util_hash_table_mix(uint64_t k)
 {
-   void *key;
-   void *value;
-};
+   k ^= k >> 33;
+   k *= 0xff51afd7ed558ccdULL;
+   k ^= k >> 33;
+   return (unsigned) k;
+}
 
 
-static INLINE struct util_hash_table_item *
-util_hash_table_item(struct cso_hash_iter iter)
+static INLINE unsigned
+util_hash_table_hash(struct util_hash_table *ht, void *key)
 {
-   return (struct util_hash_table_item *)cso_hash_iter_data(iter);
+   if (!ht->hash)
+      return util_hash_table_mix((uintptr_t) key);
+   return util_hash_table_mix(ht->hash(key));
 }
 
 
-struct util_hash_table *
-util_hash_table_create(unsigned (*hash)(void *key),
-                       int (*compare)(void *key1, void *key2))
+static struct util_hash_table *
+util_hash_table_create_internal(unsigned (*hash)(void *key),
+                                int (*compare)(void *key1, void *key2))
 {
    struct util_hash_table *ht;
    
@@ -85,12 +111,15 @@ util_hash_table_create(unsigned (*hash)(void *key),
    if(!ht)
       return NULL;
    
-   ht->cso = cso_hash_create();
-   if(!ht->cso) {
+   ht->slots = CALLOC(UTIL_HASH_TABLE_MIN_SIZE, sizeof(*ht->slots));
+   if(!ht->slots) {
       FREE(ht);
       return NULL;
    }
    
+   ht->size = UTIL_HASH_TABLE_MIN_SIZE;
+   ht->count = 0;
+   ht->deleted = 0;
    ht->hash = hash;
    ht->compare = compare;
    
@@ -98,43 +127,102 @@ util_hash_table_create(unsigned (*hash)(void *key),
 }
 
 
-static INLINE struct cso_hash_iter
-util_hash_table_find_iter(struct util_hash_table *ht,
+struct util_hash_table *
+util_hash_table_create(unsigned (*hash)(void *key),
+                       int (*compare)(void *key1, void *key2))
+{
+   assert(hash && compare);
+   return util_hash_table_create_internal(hash, compare);
+}
+
+
+struct util_hash_table *
+util_hash_table_create_ptr_keys(void)
+{
+   return util_hash_table_create_internal(NULL, NULL);
+}
+
+
+static INLINE struct util_hash_table_slot *
+util_hash_table_find_slot(struct util_hash_table *ht,
                           void *key,
                           unsigned key_hash)
 {
-   struct cso_hash_iter iter;
-   struct util_hash_table_item *item;
+   const unsigned mask = ht->size - 1;
+   unsigned i = key_hash & mask;
    
-   iter = cso_hash_find(ht->cso, key_hash);
-   while (!cso_hash_iter_is_null(iter)) {
-      item = (struct util_hash_table_item *)cso_hash_iter_data(iter);
-      if (!ht->compare(item->key, key))
-         break;
-      iter = cso_hash_iter_next(iter);
+   for (;;) {
+      struct util_hash_table_slot *slot = &ht->slots[i];
+      
+      if (slot->state == UTIL_HASH_TABLE_SLOT_EMPTY)
+         return NULL;
+      
+      if (slot->state == UTIL_HASH_TABLE_SLOT_USED &&
+          slot->hash == key_hash &&
+          (ht->compare ? !ht->compare(slot->key, key) : slot->key == key))
+         return slot;
+      
+      i = (i + 1) & mask;
    }
+}
+
+
+/**
+ * Insert a key known not to be in the table, reusing deleted slots.
+ */
+static INLINE void
+util_hash_table_insert_slot(struct util_hash_table *ht,
+                            void *key, void *value,
+                            unsigned key_hash)
+{
+   const unsigned mask = ht->size - 1;
+   unsigned i = key_hash & mask;
+   struct util_hash_table_slot *slot;
+   
+   while (ht->slots[i].state == UTIL_HASH_TABLE_SLOT_USED)
+      i = (i + 1) & mask;
    
-   return iter;
+   slot = &ht->slots[i];
+   if (slot->state == UTIL_HASH_TABLE_SLOT_DELETED)
+      ht->deleted--;
+   
+   slot->key = key;
+   slot->value = value;
+   slot->hash = key_hash;
+   slot->state = UTIL_HASH_TABLE_SLOT_USED;
+   ht->count++;
 }
 
 
-static INLINE struct util_hash_table_item *
-util_hash_table_find_item(struct util_hash_table *ht,
-                          void *key,
-                          unsigned key_hash)
+/**
+ * Move all entries to a new array of slots, dropping the deleted ones.
+ */
+static enum pipe_error
+util_hash_table_rehash(struct util_hash_table *ht, unsigned size)
 {
-   struct cso_hash_iter iter;
-   struct util_hash_table_item *item;
+   struct util_hash_table_slot *old_slots = ht->slots;
+   unsigned old_size = ht->size;
+   unsigned i;
+   
+   ht->slots = CALLOC(size, sizeof(*ht->slots));
+   if(!ht->slots) {
+      ht->slots = old_slots;
+      return PIPE_ERROR_OUT_OF_MEMORY;
+   }
    
-   iter = cso_hash_find(ht->cso, key_hash);
-   while (!cso_hash_iter_is_null(iter)) {
-      item = (struct util_hash_table_item *)cso_hash_iter_data(iter);
-      if (!ht->compare(item->key, key))
-         return item;
-      iter = cso_hash_iter_next(iter);
+   ht->size = size;
+   ht->count = 0;
+   ht->deleted = 0;
+   
+   for (i = 0; i < old_size; i++) {
+      const struct util_hash_table_slot *slot = &old_slots[i];
+      
+      if (slot->state == UTIL_HASH_TABLE_SLOT_USED)
+         util_hash_table_insert_slot(ht, slot->key, slot->value, slot->hash);
    }
    
-   return NULL;
+   FREE(old_slots);
+   return PIPE_OK;
 }
 
 
@@ -144,34 +232,35 @@ util_hash_table_set(struct util_hash_table *ht,
                     void *value)
 {
    unsigned key_hash;
-   struct util_hash_table_item *item;
-   struct cso_hash_iter iter;
+   struct util_hash_table_slot *slot;
 
    assert(ht);
    if (!ht)
       return PIPE_ERROR_BAD_INPUT;
 
-   key_hash = ht->hash(key);
+   key_hash = util_hash_table_hash(ht, key);
 
-   item = util_hash_table_find_item(ht, key, key_hash);
-   if(item) {
+   slot = util_hash_table_find_slot(ht, key, key_hash);
+   if(slot) {
       /* TODO: key/value destruction? */
-      item->value = value;
+      slot->value = value;
       return PIPE_OK;
    }
    
-   item = MALLOC_STRUCT(util_hash_table_item);
-   if(!item)
-      return PIPE_ERROR_OUT_OF_MEMORY;
-   
-   item->key = key;
-   item->value = value;
-   
-   iter = cso_hash_insert(ht->cso, key_hash, item);
-   if(cso_hash_iter_is_null(iter)) {
-      FREE(item);
-      return PIPE_ERROR_OUT_OF_MEMORY;
+   /* Keep at least half of the slots empty. */
+   if ((ht->count + ht->deleted + 1) * 2 > ht->size) {
+      unsigned size = ht->size;
+      enum pipe_error ret;
+      
+      while ((ht->count + 1) * 4 > size)
+         size *= 2;
+      
+      ret = util_hash_table_rehash(ht, size);
+      if (ret != PIPE_OK)
+         return ret;
    }
+   
+   util_hash_table_insert_slot(ht, key, value, key_hash);
 
    return PIPE_OK;
 }
@@ -181,20 +270,17 @@ void *
 util_hash_table_get(struct util_hash_table *ht,
                     void *key)
 {
-   unsigned key_hash;
-   struct util_hash_table_item *item;
+   struct util_hash_table_slot *slot;
 
    assert(ht);
    if (!ht)
       return NULL;
 
-   key_hash = ht->hash(key);
-
-   item = util_hash_table_find_item(ht, key, key_hash);
-   if(!item)
+   slot = util_hash_table_find_slot(ht, key, util_hash_table_hash(ht, key));
+   if(!slot)
       return NULL;
    
-   return item->value;
+   return slot->value;
 }
 
 
@@ -202,44 +288,34 @@ void
 util_hash_table_remove(struct util_hash_table *ht,
                        void *key)
 {
-   unsigned key_hash;
-   struct cso_hash_iter iter;
-   struct util_hash_table_item *item;
+   struct util_hash_table_slot *slot;
 
    assert(ht);
    if (!ht)
       return;
 
-   key_hash = ht->hash(key);
-
-   iter = util_hash_table_find_iter(ht, key, key_hash);
-   if(cso_hash_iter_is_null(iter))
+   slot = util_hash_table_find_slot(ht, key, util_hash_table_hash(ht, key));
+   if(!slot)
       return;
    
-   item = util_hash_table_item(iter);
-   assert(item);
-   FREE(item);
-   
-   cso_hash_erase(ht->cso, iter);
+   slot->key = NULL;
+   slot->value = NULL;
+   slot->state = UTIL_HASH_TABLE_SLOT_DELETED;
+   ht->count--;
+   ht->deleted++;
 }
 
 
 void 
 util_hash_table_clear(struct util_hash_table *ht)
 {
-   struct cso_hash_iter iter;
-   struct util_hash_table_item *item;
-
    assert(ht);
    if (!ht)
       return;
 
-   iter = cso_hash_first_node(ht->cso);
-   while (!cso_hash_iter_is_null(iter)) {
-      item = (struct util_hash_table_item *)cso_hash_take(ht->cso, cso_hash_iter_key(iter));
-      FREE(item);
-      iter = cso_hash_first_node(ht->cso);
-   }
+   memset(ht->slots, 0, ht->size * sizeof(*ht->slots));
+   ht->count = 0;
+   ht->deleted = 0;
 }
 
 
@@ -249,21 +325,22 @@ util_hash_table_foreach(struct util_hash_table *ht,
                         (void *key, void *value, void *data),
                      void *data)
 {
-   struct cso_hash_iter iter;
-   struct util_hash_table_item *item;
    enum pipe_error result;
+   unsigned i;
 
    assert(ht);
    if (!ht)
       return PIPE_ERROR_BAD_INPUT;
 
-   iter = cso_hash_first_node(ht->cso);
-   while (!cso_hash_iter_is_null(iter)) {
-      item = (struct util_hash_table_item *)cso_hash_iter_data(iter);
-      result = callback(item->key, item->value, data);
+   for (i = 0; i < ht->size; i++) {
+      const struct util_hash_table_slot *slot = &ht->slots[i];
+      
+      if (slot->state != UTIL_HASH_TABLE_SLOT_USED)
+         continue;
+      
+      result = callback(slot->key, slot->value, data);
       if(result != PIPE_OK)
 	 return result;
-      iter = cso_hash_iter_next(iter);
    }
 
    return PIPE_OK;
@@ -273,21 +350,10 @@ util_hash_table_foreach(struct util_hash_table *ht,
 void
 util_hash_table_destroy(struct util_hash_table *ht)
 {
-   struct cso_hash_iter iter;
-   struct util_hash_table_item *item;
-
    assert(ht);
    if (!ht)
       return;
 
-   iter = cso_hash_first_node(ht->cso);
-   while (!cso_hash_iter_is_null(iter)) {
-      item = (struct util_hash_table_item *)cso_hash_iter_data(iter);
-      FREE(item);
-      iter = cso_hash_iter_next(iter);
-   }
-
-   cso_hash_delete(ht->cso);
-   
+   FREE(ht->slots);
    FREE(ht);
 }
@@ -60,6 +60,15 @@ util_hash_table_create(unsigned (*hash)(void *key),
                        int (*compare)(void *key1, void *key2));
 
 
+/**
+ * Create an hash table whose keys are compared as pointers, which is
+ * faster than passing hash and compare functions.  Also suitable for
+ * integer keys cast to pointers.
+ */
+struct util_hash_table *
+util_hash_table_create_ptr_keys(void);
+
+
 enum pipe_error
 util_hash_table_set(struct util_hash_table *ht,
                     void *key,
@@ -409,7 +409,7 @@ util_pstipple_create_fragment_shader(struct pipe_context *pipe,
    const uint newLen = tgsi_num_tokens(fs->tokens) + NUM_NEW_TOKENS;
    unsigned i;
 
-   new_fs = MALLOC(sizeof(*new_fs));
+   new_fs = CALLOC_STRUCT(pipe_shader_state);
    if (!new_fs)
       return NULL;
 
@@ -0,0 +1,462 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Worker thread pool, see u_queue.h.
+ */
+
+
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+
+
+struct util_queue_job
+{
+   void *job;
+   struct util_queue_fence *fence;
+   util_queue_execute_func execute;
+};
+
+
+/**
+ * Growable ring of jobs.
+ */
+struct util_queue_ring
+{
+   struct util_queue_job *jobs;
+   unsigned first;
+   unsigned count;
+   unsigned size;
+};
+
+
+struct util_queue_thread
+{
+   struct util_queue *queue;
+   unsigned index;
+   pipe_thread thread;
+
+   pipe_mutex mutex;  /**< protects rings */
+   struct util_queue_ring rings[UTIL_QUEUE_PRIORITY_COUNT];
+};
+
+
+struct util_queue
+{
+   /**
+    * Protects pending, next_thread and kill, and orders adding a job with
+    * the workers going to sleep.  Taken before a worker's mutex.
+    */
+   pipe_mutex mutex;
+   pipe_condvar has_jobs;
+
+   /** Jobs in the rings which no worker has claimed yet */
+   unsigned pending;
+   unsigned next_thread;
+   boolean kill;
+
+   unsigned num_threads;
+   struct util_queue_thread threads[UTIL_QUEUE_MAX_THREADS];
+};
+
+
+/** The util_queue_thread the calling thread is, if any */
+static pipe_tsd util_queue_current;
+pipe_static_mutex(util_queue_current_mutex);
+
+pipe_static_mutex(util_queue_shared_mutex);
+static struct util_queue *util_queue_shared;
+static unsigned util_queue_shared_refs;
+
+
+void
+util_queue_fence_init(struct util_queue_fence *fence)
+{
+   pipe_mutex_init(fence->mutex);
+   pipe_condvar_init(fence->cond);
+   fence->signalled = TRUE;
+}
+
+
+void
+util_queue_fence_destroy(struct util_queue_fence *fence)
+{
+   assert(fence->signalled);
+   pipe_condvar_destroy(fence->cond);
+   pipe_mutex_destroy(fence->mutex);
+}
+
+
+void
+util_queue_fence_wait(struct util_queue_fence *fence)
+{
+   pipe_mutex_lock(fence->mutex);
+   while (!fence->signalled)
+      pipe_condvar_wait(fence->cond, fence->mutex);
+   pipe_mutex_unlock(fence->mutex);
+}
+
+
+boolean
+util_queue_fence_is_signalled(struct util_queue_fence *fence)
+{
+   boolean signalled;
+
+   pipe_mutex_lock(fence->mutex);
+   signalled = fence->signalled;
+   pipe_mutex_unlock(fence->mutex);
+
+   return signalled;
+}
+
+
+static void
+util_queue_fence_signal(struct util_queue_fence *fence)
+{
+   pipe_mutex_lock(fence->mutex);
+   fence->signalled = TRUE;
+   pipe_condvar_broadcast(fence->cond);
+   pipe_mutex_unlock(fence->mutex);
+}
+
+
+static boolean
+util_queue_ring_push(struct util_queue_ring *ring,
+                     const struct util_queue_job *job)
+{
+   if (ring->count == ring->size) {
+      unsigned size = MAX2(ring->size * 2, 16);
+      struct util_queue_job *jobs = MALLOC(size * sizeof *jobs);
+      unsigned i;
+
+      if (!jobs)
+         return FALSE;
+
+      for (i = 0; i < ring->count; i++)
+         jobs[i] = ring->jobs[(ring->first + i) % ring->size];
+
+      FREE(ring->jobs);
+      ring->jobs = jobs;
+      ring->first = 0;
+      ring->size = size;
+   }
+
+   ring->jobs[(ring->first + ring->count) % ring->size] = *job;
+   ring->count++;
+   return TRUE;
+}
+
+
+/**
+ * Take the highest priority job, from the worker's own rings first and
+ * then from the other workers'.  The owner takes its oldest job, thieves
+ * the newest.
+ */
+static boolean
+util_queue_take_job(struct util_queue *queue,
+                    struct util_queue_thread *self,
+                    struct util_queue_job *job)
+{
+   int priority;
+   unsigned i;
+
+   for (priority = UTIL_QUEUE_PRIORITY_COUNT - 1; priority >= 0; priority--) {
+      for (i = 0; i < queue->num_threads; i++) {
+         struct util_queue_thread *thread =
+            &queue->threads[(self->index + i) % queue->num_threads];
+         struct util_queue_ring *ring = &thread->rings[priority];
+
+         pipe_mutex_lock(thread->mutex);
+         if (ring->count) {
+            if (thread == self) {
+               *job = ring->jobs[ring->first];
+               ring->first = (ring->first + 1) % ring->size;
+            }
+            else {
+               *job = ring->jobs[(ring->first + ring->count - 1) % ring->size];
+            }
+            ring->count--;
+            pipe_mutex_unlock(thread->mutex);
+            return TRUE;
+         }
+         pipe_mutex_unlock(thread->mutex);
+      }
+   }
+
+   return FALSE;
+}
+
+
+static PIPE_THREAD_ROUTINE(util_queue_thread_func, param)
+{
+   struct util_queue_thread *self = (struct util_queue_thread *) param;
+   struct util_queue *queue = self->queue;
+   struct util_queue_job job;
+
+   pipe_tsd_set(&util_queue_current, self);
+
+   while (1) {
+      pipe_mutex_lock(queue->mutex);
+      while (!queue->pending && !queue->kill)
+         pipe_condvar_wait(queue->has_jobs, queue->mutex);
+      if (!queue->pending) {
+         pipe_mutex_unlock(queue->mutex);
+         break;
+      }
+      queue->pending--;
+      pipe_mutex_unlock(queue->mutex);
+
+      /* Having claimed a job, one is in the rings, but another worker may
+       * take it under our nose while we look at the other rings.
+       */
+      while (!util_queue_take_job(queue, self, &job))
+         ;
+
+      job.execute(job.job, self->index);
+      if (job.fence)
+         util_queue_fence_signal(job.fence);
+   }
+
+   return NULL;
+}
+
+
+/**
+ * Start a pool of num_threads workers, at most UTIL_QUEUE_MAX_THREADS.
+ */
+struct util_queue *
+util_queue_create(unsigned num_threads)
+{
+   struct util_queue *queue;
+   unsigned i;
+
+   num_threads = CLAMP(num_threads, 1, UTIL_QUEUE_MAX_THREADS);
+
+   queue = CALLOC_STRUCT(util_queue);
+   if (!queue)
+      return NULL;
+
+   pipe_mutex_lock(util_queue_current_mutex);
+   if (util_queue_current.initMagic != (int) PIPE_TSD_INIT_MAGIC)
+      pipe_tsd_init(&util_queue_current);
+   pipe_mutex_unlock(util_queue_current_mutex);
+
+   pipe_mutex_init(queue->mutex);
+   pipe_condvar_init(queue->has_jobs);
+
+   for (i = 0; i < num_threads; i++) {
+      struct util_queue_thread *thread = &queue->threads[i];
+
+      thread->queue = queue;
+      thread->index = i;
+      pipe_mutex_init(thread->mutex);
+   }
+   queue->num_threads = num_threads;
+
+   for (i = 0; i < num_threads; i++) {
+      struct util_queue_thread *thread = &queue->threads[i];
+
+      thread->thread = pipe_thread_create(util_queue_thread_func, thread);
+      if (!thread->thread) {
+         /* Run with the threads we got. */
+         if (i == 0) {
+            queue->num_threads = 0;
+            util_queue_destroy(queue);
+            return NULL;
+         }
+         pipe_mutex_lock(queue->mutex);
+         queue->num_threads = i;
+         pipe_mutex_unlock(queue->mutex);
+         break;
+      }
+   }
+
+   return queue;
+}
+
+
+/**
+ * Run the remaining jobs and stop the workers.
+ */
+void
+util_queue_destroy(struct util_queue *queue)
+{
+   unsigned i, j;
+
+   pipe_mutex_lock(queue->mutex);
+   queue->kill = TRUE;
+   pipe_condvar_broadcast(queue->has_jobs);
+   pipe_mutex_unlock(queue->mutex);
+
+   for (i = 0; i < queue->num_threads; i++)
+      pipe_thread_wait(queue->threads[i].thread);
+
+   for (i = 0; i < UTIL_QUEUE_MAX_THREADS; i++) {
+      struct util_queue_thread *thread = &queue->threads[i];
+
+      if (!thread->queue)
+         break;
+      for (j = 0; j < UTIL_QUEUE_PRIORITY_COUNT; j++)
+         FREE(thread->rings[j].jobs);
+      pipe_mutex_destroy(thread->mutex);
+   }
+
+   pipe_condvar_destroy(queue->has_jobs);
+   pipe_mutex_destroy(queue->mutex);
+   FREE(queue);
+}
+
+
+unsigned
+util_queue_num_threads(const struct util_queue *queue)
+{
+   return queue->num_threads;
+}
+
+
+/**
+ * Have execute(job, thread_index) called on a worker thread.
+ *
+ * \param fence  signalled once the job has run, or NULL.  It must be
+ *               signalled, i.e. not in use by another job.
+ */
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   enum util_queue_priority priority)
+{
+   struct util_queue_thread *current = (struct util_queue_thread *)
+      pipe_tsd_get(&util_queue_current);
+   struct util_queue_thread *thread;
+   struct util_queue_job entry;
+   boolean queued;
+
+   assert(priority < UTIL_QUEUE_PRIORITY_COUNT);
+
+   entry.job = job;
+   entry.fence = fence;
+   entry.execute = execute;
+
+   if (fence) {
+      assert(fence->signalled);
+      fence->signalled = FALSE;
+   }
+
+   pipe_mutex_lock(queue->mutex);
+
+   /* Jobs added by a job stay with its worker. */
+   if (current && current->queue != queue)
+      current = NULL;
+
+   if (current) {
+      thread = current;
+   }
+   else {
+      thread = &queue->threads[queue->next_thread % queue->num_threads];
+      queue->next_thread++;
+   }
+
+   pipe_mutex_lock(thread->mutex);
+   queued = util_queue_ring_push(&thread->rings[priority], &entry);
+   pipe_mutex_unlock(thread->mutex);
+
+   if (queued) {
+      queue->pending++;
+      pipe_condvar_signal(queue->has_jobs);
+   }
+
+   pipe_mutex_unlock(queue->mutex);
+
+   /* Out of memory, run the job here. */
+   if (!queued) {
+      execute(job, current ? current->index : queue->num_threads);
+      if (fence)
+         util_queue_fence_signal(fence);
+   }
+}
+
+
+/**
+ * Get a reference to the pool shared by the process, with as many
+ * workers as CPUs unless GALLIUM_THREADS says otherwise.  Returns NULL
+ * with GALLIUM_THREADS=0, in which case the caller should do its work
+ * itself.
+ */
+struct util_queue *
+util_queue_ref_shared(void)
+{
+   struct util_queue *queue;
+
+   pipe_mutex_lock(util_queue_shared_mutex);
+
+   if (!util_queue_shared_refs) {
+      long num_threads;
+
+      util_cpu_detect();
+      num_threads = debug_get_num_option("GALLIUM_THREADS",
+                                         util_cpu_caps.nr_cpus);
+
+      if (num_threads > 0)
+         util_queue_shared = util_queue_create(num_threads);
+   }
+
+   queue = util_queue_shared;
+   if (queue)
+      util_queue_shared_refs++;
+
+   pipe_mutex_unlock(util_queue_shared_mutex);
+
+   return queue;
+}
+
+
+/**
+ * Drop a reference from util_queue_ref_shared(), stopping the workers
+ * with the last one.
+ */
+void
+util_queue_unref_shared(struct util_queue *queue)
+{
+   struct util_queue *destroy = NULL;
+
+   if (!queue)
+      return;
+
+   pipe_mutex_lock(util_queue_shared_mutex);
+   assert(queue == util_queue_shared && util_queue_shared_refs);
+   if (--util_queue_shared_refs == 0) {
+      destroy = util_queue_shared;
+      util_queue_shared = NULL;
+   }
+   pipe_mutex_unlock(util_queue_shared_mutex);
+
+   if (destroy)
+      util_queue_destroy(destroy);
+}
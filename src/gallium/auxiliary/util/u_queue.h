@@ -0,0 +1,130 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Pool of worker threads running jobs in the background.
+ *
+ * Each worker has its own queue of jobs per priority.  Jobs added from
+ * outside the pool are spread over the workers, jobs added by a job go
+ * to the queue of the worker running it, and idle workers steal from the
+ * others.  Higher priority jobs always run first.
+ *
+ * Completion is tracked with util_queue_fence.  A job must not wait for
+ * a fence of a job of the same queue, as all the workers could end up
+ * waiting.
+ *
+ * util_queue_ref_shared() returns a pool shared by the whole process, so
+ * that screens and state trackers don't each start their own threads.
+ */
+
+#ifndef U_QUEUE_H
+#define U_QUEUE_H
+
+#include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define UTIL_QUEUE_MAX_THREADS 32
+
+
+enum util_queue_priority
+{
+   UTIL_QUEUE_PRIORITY_LOW,
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_PRIORITY_COUNT
+};
+
+
+/**
+ * Signalled once the job it was given to has run.
+ */
+struct util_queue_fence
+{
+   pipe_mutex mutex;
+   pipe_condvar cond;
+   int signalled;
+};
+
+
+/**
+ * \param job  the job pointer given to util_queue_add_job()
+ * \param thread_index  index of the worker thread, less than
+ *                      util_queue_num_threads().  If util_queue_add_job()
+ *                      runs out of memory, it runs the job itself with
+ *                      util_queue_num_threads() as the index.
+ */
+typedef void (*util_queue_execute_func)(void *job, unsigned thread_index);
+
+
+struct util_queue;
+
+
+void
+util_queue_fence_init(struct util_queue_fence *fence);
+
+void
+util_queue_fence_destroy(struct util_queue_fence *fence);
+
+void
+util_queue_fence_wait(struct util_queue_fence *fence);
+
+boolean
+util_queue_fence_is_signalled(struct util_queue_fence *fence);
+
+
+struct util_queue *
+util_queue_create(unsigned num_threads);
+
+void
+util_queue_destroy(struct util_queue *queue);
+
+unsigned
+util_queue_num_threads(const struct util_queue *queue);
+
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   enum util_queue_priority priority);
+
+
+struct util_queue *
+util_queue_ref_shared(void);
+
+void
+util_queue_unref_shared(struct util_queue *queue);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_QUEUE_H */
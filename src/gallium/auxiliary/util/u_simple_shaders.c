@@ -343,7 +343,7 @@ util_make_fragment_passthrough_shader(struct pipe_context *pipe,
            tgsi_semantic_names[input_semantic],
            tgsi_interpolate_names[input_interpolate]);
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
+   if (!tgsi_text_assemble(text, tokens, Elements(tokens))) {
       assert(0);
       return NULL;
    }
@@ -428,7 +428,7 @@ util_make_fs_blit_msaa_gen(struct pipe_context *pipe,
 
    sprintf(text, shader_templ, output_semantic, output_mask, type);
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
+   if (!tgsi_text_assemble(text, tokens, Elements(tokens))) {
       puts(text);
       assert(0);
       return NULL;
@@ -517,7 +517,7 @@ util_make_fs_blit_msaa_depthstencil(struct pipe_context *pipe,
 
    sprintf(text, shader_templ, type, type);
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
+   if (!tgsi_text_assemble(text, tokens, Elements(tokens))) {
       assert(0);
       return NULL;
    }
@@ -30,6 +30,10 @@
 
 #define UTIL_SLAB_MAGIC 0xcafe4321
 
+#if defined(PIPE_OS_LINUX) || defined(PIPE_OS_BSD) || defined(PIPE_OS_SOLARIS) || defined(PIPE_OS_APPLE) || defined(PIPE_OS_HAIKU) || defined(PIPE_OS_CYGWIN)
+#define UTIL_SLAB_HAVE_TSD
+#endif
+
 /* The block is either allocated memory or free space. */
 struct util_slab_block {
    /* The header. */
@@ -103,34 +107,179 @@ static void util_slab_free_st(struct util_slab_mempool *pool, void *ptr)
    pool->first_free = block;
 }
 
+static void *util_slab_alloc_st_counted(struct util_slab_mempool *pool)
+{
+   pool->num_allocs++;
+   return util_slab_alloc_st(pool);
+}
+
+static void util_slab_free_st_counted(struct util_slab_mempool *pool,
+                                      void *ptr)
+{
+   pool->num_frees++;
+   util_slab_free_st(pool, ptr);
+}
+
+#ifdef UTIL_SLAB_HAVE_TSD
+pipe_static_mutex(util_slab_thread_mutex);
+static pipe_tsd util_slab_thread_tsd;
+static int util_slab_num_threads;
+#endif
+
+static void util_slab_init_threads(void)
+{
+#ifdef UTIL_SLAB_HAVE_TSD
+   pipe_mutex_lock(util_slab_thread_mutex);
+   if (util_slab_thread_tsd.initMagic != (int) PIPE_TSD_INIT_MAGIC)
+      pipe_tsd_init(&util_slab_thread_tsd);
+   pipe_mutex_unlock(util_slab_thread_mutex);
+#endif
+}
+
+/* Each thread gets a number the first time it uses a pool, which picks
+ * its magazine in all pools. */
+static struct util_slab_magazine *
+util_slab_get_magazine(struct util_slab_mempool *pool)
+{
+#ifdef UTIL_SLAB_HAVE_TSD
+   intptr_t id = (intptr_t) pipe_tsd_get(&util_slab_thread_tsd);
+
+   if (!id) {
+      pipe_mutex_lock(util_slab_thread_mutex);
+      id = ++util_slab_num_threads;
+      pipe_mutex_unlock(util_slab_thread_mutex);
+      pipe_tsd_set(&util_slab_thread_tsd, (void*)id);
+   }
+
+   return &pool->magazines[(id - 1) % UTIL_SLAB_NUM_MAGAZINES].mag;
+#else
+   return &pool->magazines[0].mag;
+#endif
+}
+
+/* Move up to half a magazine of blocks from the pool to the magazine,
+ * called with both locks held. */
+static void util_slab_refill(struct util_slab_mempool *pool,
+                             struct util_slab_magazine *mag)
+{
+   unsigned i;
+
+   for (i = 0; i < UTIL_SLAB_MAGAZINE_SIZE / 2; i++) {
+      struct util_slab_block *block;
+
+      if (!pool->first_free) {
+         if (i)
+            break;
+         util_slab_add_new_page(pool);
+      }
+
+      block = pool->first_free;
+      assert(block->magic == UTIL_SLAB_MAGIC);
+      pool->first_free = block->next_free;
+
+      block->next_free = mag->first_free;
+      mag->first_free = block;
+      mag->num_free++;
+   }
+
+   mag->num_refills++;
+}
+
+/* Move blocks from the magazine to the pool until it has at most
+ * "keep" blocks, called with both locks held. */
+static void util_slab_flush(struct util_slab_mempool *pool,
+                            struct util_slab_magazine *mag, unsigned keep)
+{
+   while (mag->num_free > keep) {
+      struct util_slab_block *block = mag->first_free;
+
+      mag->first_free = block->next_free;
+      mag->num_free--;
+
+      block->next_free = pool->first_free;
+      pool->first_free = block;
+   }
+
+   mag->num_flushes++;
+}
+
 static void *util_slab_alloc_mt(struct util_slab_mempool *pool)
 {
-   void *mem;
+   struct util_slab_magazine *mag = util_slab_get_magazine(pool);
+   struct util_slab_block *block;
+
+   pipe_mutex_lock(mag->mutex);
+
+   if (!mag->first_free) {
+      pipe_mutex_lock(pool->mutex);
+      util_slab_refill(pool, mag);
+      pipe_mutex_unlock(pool->mutex);
+   }
+
+   block = mag->first_free;
+   assert(block->magic == UTIL_SLAB_MAGIC);
+   mag->first_free = block->next_free;
+   mag->num_free--;
+   mag->num_allocs++;
+
+   pipe_mutex_unlock(mag->mutex);
 
-   pipe_mutex_lock(pool->mutex);
-   mem = util_slab_alloc_st(pool);
-   pipe_mutex_unlock(pool->mutex);
-   return mem;
+   return (uint8_t*)block + sizeof(struct util_slab_block);
 }
 
 static void util_slab_free_mt(struct util_slab_mempool *pool, void *ptr)
 {
-   pipe_mutex_lock(pool->mutex);
-   util_slab_free_st(pool, ptr);
-   pipe_mutex_unlock(pool->mutex);
+   struct util_slab_magazine *mag = util_slab_get_magazine(pool);
+   struct util_slab_block *block =
+         (struct util_slab_block*)
+         ((uint8_t*)ptr - sizeof(struct util_slab_block));
+
+   assert(block->magic == UTIL_SLAB_MAGIC);
+
+   pipe_mutex_lock(mag->mutex);
+
+   block->next_free = mag->first_free;
+   mag->first_free = block;
+   mag->num_free++;
+   mag->num_frees++;
+
+   if (mag->num_free > UTIL_SLAB_MAGAZINE_SIZE) {
+      pipe_mutex_lock(pool->mutex);
+      util_slab_flush(pool, mag, UTIL_SLAB_MAGAZINE_SIZE / 2);
+      pipe_mutex_unlock(pool->mutex);
+   }
+
+   pipe_mutex_unlock(mag->mutex);
 }
 
 void util_slab_set_thread_safety(struct util_slab_mempool *pool,
                                     enum util_slab_threading threading)
 {
+   unsigned i;
+
+   /* Give the cached blocks back, the single-threaded mode doesn't use
+    * the magazines. */
+   if (pool->threading && !threading) {
+      for (i = 0; i < UTIL_SLAB_NUM_MAGAZINES; i++) {
+         struct util_slab_magazine *mag = &pool->magazines[i].mag;
+
+         pipe_mutex_lock(mag->mutex);
+         pipe_mutex_lock(pool->mutex);
+         util_slab_flush(pool, mag, 0);
+         pipe_mutex_unlock(pool->mutex);
+         pipe_mutex_unlock(mag->mutex);
+      }
+   }
+
    pool->threading = threading;
 
    if (threading) {
+      util_slab_init_threads();
       pool->alloc = util_slab_alloc_mt;
       pool->free = util_slab_free_mt;
    } else {
-      pool->alloc = util_slab_alloc_st;
-      pool->free = util_slab_free_st;
+      pool->alloc = util_slab_alloc_st_counted;
+      pool->free = util_slab_free_st_counted;
    }
 }
 
@@ -139,6 +288,8 @@ void util_slab_create(struct util_slab_mempool *pool,
                       unsigned num_blocks,
                       enum util_slab_threading threading)
 {
+   unsigned i;
+
    item_size = align(item_size, sizeof(intptr_t));
 
    pool->num_pages = 0;
@@ -148,17 +299,25 @@ void util_slab_create(struct util_slab_mempool *pool,
    pool->page_size = sizeof(struct util_slab_page) +
                      num_blocks * pool->block_size;
    pool->first_free = NULL;
+   pool->num_allocs = 0;
+   pool->num_frees = 0;
+   pool->threading = UTIL_SLAB_SINGLETHREADED;
 
    make_empty_list(&pool->list);
 
    pipe_mutex_init(pool->mutex);
 
+   memset(pool->magazines, 0, sizeof(pool->magazines));
+   for (i = 0; i < UTIL_SLAB_NUM_MAGAZINES; i++)
+      pipe_mutex_init(pool->magazines[i].mag.mutex);
+
    util_slab_set_thread_safety(pool, threading);
 }
 
 void util_slab_destroy(struct util_slab_mempool *pool)
 {
    struct util_slab_page *page, *temp;
+   unsigned i;
 
    if (pool->list.next) {
       foreach_s(page, temp, &pool->list) {
@@ -168,4 +327,32 @@ void util_slab_destroy(struct util_slab_mempool *pool)
    }
 
    pipe_mutex_destroy(pool->mutex);
+   for (i = 0; i < UTIL_SLAB_NUM_MAGAZINES; i++)
+      pipe_mutex_destroy(pool->magazines[i].mag.mutex);
+}
+
+/* The counters are read without locking, so they may be slightly off
+ * while other threads use the pool. */
+void util_slab_get_stats(struct util_slab_mempool *pool,
+                         struct util_slab_stats *stats)
+{
+   unsigned i;
+
+   stats->num_pages = pool->num_pages;
+   stats->num_blocks = pool->num_pages * pool->num_blocks;
+   stats->num_cached = 0;
+   stats->num_allocs = pool->num_allocs;
+   stats->num_frees = pool->num_frees;
+   stats->num_refills = 0;
+   stats->num_flushes = 0;
+
+   for (i = 0; i < UTIL_SLAB_NUM_MAGAZINES; i++) {
+      const struct util_slab_magazine *mag = &pool->magazines[i].mag;
+
+      stats->num_cached += mag->num_free;
+      stats->num_allocs += mag->num_allocs;
+      stats->num_frees += mag->num_frees;
+      stats->num_refills += mag->num_refills;
+      stats->num_flushes += mag->num_flushes;
+   }
 }
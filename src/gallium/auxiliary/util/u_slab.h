@@ -30,6 +30,12 @@
  *
  * Candidates: transfer_map
  *
+ * In the multithreaded mode, each thread allocates from and frees to one
+ * of UTIL_SLAB_NUM_MAGAZINES small caches of free blocks, and only takes
+ * the pool lock to move half a magazine from or to the shared free list.
+ * This keeps the magazines balanced between threads which mostly allocate
+ * and threads which mostly free.
+ *
  * @author Marek Olšák
  */
 
@@ -43,6 +49,9 @@ enum util_slab_threading {
    UTIL_SLAB_MULTITHREADED = TRUE
 };
 
+#define UTIL_SLAB_NUM_MAGAZINES 8
+#define UTIL_SLAB_MAGAZINE_SIZE 32
+
 /* The page is an array of blocks (allocations). */
 struct util_slab_page {
    /* The header (linked-list pointers). */
@@ -52,6 +61,30 @@ struct util_slab_page {
     * The allocated size is always larger than this structure. */
 };
 
+/* A cache of free blocks, used by the threads mapped to it. */
+struct util_slab_magazine {
+   pipe_mutex mutex;
+
+   struct util_slab_block *first_free;
+   unsigned num_free;
+
+   /* Statistics. */
+   uint64_t num_allocs;
+   uint64_t num_frees;
+   unsigned num_refills;  /**< half magazines taken from the pool */
+   unsigned num_flushes;  /**< half magazines given back to the pool */
+};
+
+struct util_slab_stats {
+   unsigned num_pages;
+   unsigned num_blocks;      /**< in all pages */
+   unsigned num_cached;      /**< free blocks in the magazines */
+   uint64_t num_allocs;
+   uint64_t num_frees;
+   unsigned num_refills;
+   unsigned num_flushes;
+};
+
 struct util_slab_mempool {
    /* Public members. */
    void *(*alloc)(struct util_slab_mempool *pool);
@@ -69,6 +102,16 @@ struct util_slab_mempool {
    enum util_slab_threading threading;
 
    pipe_mutex mutex;
+
+   /* Allocations in the single-threaded mode. */
+   uint64_t num_allocs;
+   uint64_t num_frees;
+
+   /* Padded for the magazines not to share cache lines. */
+   union {
+      struct util_slab_magazine mag;
+      uint8_t padding[128];
+   } magazines[UTIL_SLAB_NUM_MAGAZINES];
 };
 
 void util_slab_create(struct util_slab_mempool *pool,
@@ -81,6 +124,9 @@ void util_slab_destroy(struct util_slab_mempool *pool);
 void util_slab_set_thread_safety(struct util_slab_mempool *pool,
                                  enum util_slab_threading threading);
 
+void util_slab_get_stats(struct util_slab_mempool *pool,
+                         struct util_slab_stats *stats);
+
 #define util_slab_alloc(pool)     (pool)->alloc(pool)
 #define util_slab_free(pool, ptr) (pool)->free(pool, ptr)
 
@@ -0,0 +1,260 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Trace spans, see u_trace.h.
+ */
+
+
+#include <stdio.h>
+
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "util/u_atomic.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/u_trace.h"
+
+
+/** Spans kept per thread, 32 bytes each */
+#define UTIL_TRACE_MAX_EVENTS (16 * 1024)
+
+/** Deeper spans aren't recorded */
+#define UTIL_TRACE_MAX_DEPTH 32
+
+
+struct util_trace_event
+{
+   const char *name;
+   uint32_t id;
+   int64_t start;   /**< nanoseconds */
+   int64_t end;
+};
+
+
+struct util_trace_thread
+{
+   struct util_trace_thread *next;
+   unsigned index;
+
+   /** Events written so far.  Only the owner thread writes events, and it
+    * increments this after each one, so readers see complete events.
+    */
+   int32_t num_events;
+   int32_t dropped;
+
+   unsigned depth;
+   struct util_trace_event stack[UTIL_TRACE_MAX_DEPTH];
+
+   struct util_trace_event events[UTIL_TRACE_MAX_EVENTS];
+};
+
+
+int util_trace_state = -1;
+
+pipe_static_mutex(util_trace_mutex);
+static pipe_tsd util_trace_tsd;
+static struct util_trace_thread *util_trace_threads;
+static unsigned util_trace_num_threads;
+static int64_t util_trace_epoch;
+static char util_trace_filename[256];
+
+
+static void
+util_trace_write_at_exit(void)
+{
+   if (!util_trace_write(util_trace_filename))
+      debug_printf("u_trace: couldn't write %s\n", util_trace_filename);
+}
+
+
+/**
+ * Read GALLIUM_TRACE_EVENTS, once.
+ */
+void
+util_trace_init(void)
+{
+   pipe_mutex_lock(util_trace_mutex);
+
+   if (util_trace_state < 0) {
+      const char *filename = debug_get_option("GALLIUM_TRACE_EVENTS", NULL);
+
+      if (filename && filename[0]) {
+         util_snprintf(util_trace_filename, sizeof util_trace_filename,
+                       "%s", filename);
+         util_trace_epoch = os_time_get_nano();
+         pipe_tsd_init(&util_trace_tsd);
+         atexit(util_trace_write_at_exit);
+         util_trace_state = 1;
+      }
+      else {
+         util_trace_state = 0;
+      }
+   }
+
+   pipe_mutex_unlock(util_trace_mutex);
+}
+
+
+static struct util_trace_thread *
+util_trace_get_thread(void)
+{
+   struct util_trace_thread *thread = pipe_tsd_get(&util_trace_tsd);
+
+   if (unlikely(!thread)) {
+      /* Never freed: the spans of finished threads are still written. */
+      thread = CALLOC_STRUCT(util_trace_thread);
+      if (!thread)
+         return NULL;
+
+      pipe_mutex_lock(util_trace_mutex);
+      thread->index = util_trace_num_threads++;
+      thread->next = util_trace_threads;
+      util_trace_threads = thread;
+      pipe_mutex_unlock(util_trace_mutex);
+
+      pipe_tsd_set(&util_trace_tsd, thread);
+   }
+
+   return thread;
+}
+
+
+void
+util_trace_begin_span(const char *name, uint32_t id)
+{
+   struct util_trace_thread *thread = util_trace_get_thread();
+   struct util_trace_event *event;
+
+   if (!thread)
+      return;
+
+   if (thread->depth < UTIL_TRACE_MAX_DEPTH) {
+      event = &thread->stack[thread->depth];
+      event->name = name;
+      if (!id && thread->depth)
+         id = thread->stack[thread->depth - 1].id;
+      event->id = id;
+      event->start = os_time_get_nano();
+   }
+
+   thread->depth++;
+}
+
+
+void
+util_trace_end_span(void)
+{
+   struct util_trace_thread *thread = util_trace_get_thread();
+   int32_t n;
+
+   if (!thread || !thread->depth)
+      return;
+
+   thread->depth--;
+   if (thread->depth >= UTIL_TRACE_MAX_DEPTH) {
+      thread->dropped++;
+      return;
+   }
+
+   n = thread->num_events;
+   if (n == UTIL_TRACE_MAX_EVENTS) {
+      thread->dropped++;
+      return;
+   }
+
+   thread->events[n] = thread->stack[thread->depth];
+   thread->events[n].end = os_time_get_nano();
+   p_atomic_inc(&thread->num_events);
+}
+
+
+void
+util_trace_set_span_id(uint32_t id)
+{
+   struct util_trace_thread *thread = util_trace_get_thread();
+
+   if (thread && thread->depth && thread->depth <= UTIL_TRACE_MAX_DEPTH)
+      thread->stack[thread->depth - 1].id = id;
+}
+
+
+uint32_t
+util_trace_span_id(void)
+{
+   struct util_trace_thread *thread = util_trace_get_thread();
+
+   if (!thread || !thread->depth)
+      return 0;
+
+   return thread->stack[MIN2(thread->depth, UTIL_TRACE_MAX_DEPTH) - 1].id;
+}
+
+
+boolean
+util_trace_write(const char *filename)
+{
+   struct util_trace_thread *thread;
+   const char *separator = "";
+   int32_t dropped = 0;
+   FILE *f;
+
+   f = fopen(filename, "w");
+   if (!f)
+      return FALSE;
+
+   fprintf(f, "{\"traceEvents\":[");
+
+   pipe_mutex_lock(util_trace_mutex);
+
+   for (thread = util_trace_threads; thread; thread = thread->next) {
+      int32_t num_events = p_atomic_read(&thread->num_events);
+      int32_t i;
+
+      for (i = 0; i < num_events; i++) {
+         const struct util_trace_event *event = &thread->events[i];
+
+         fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                 "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"shader\":\"%08x\"}}",
+                 separator, event->name, thread->index,
+                 (event->start - util_trace_epoch) / 1000.0,
+                 (event->end - event->start) / 1000.0, event->id);
+         separator = ",";
+      }
+
+      dropped += p_atomic_read(&thread->dropped);
+   }
+
+   pipe_mutex_unlock(util_trace_mutex);
+
+   fprintf(f, "\n],\"otherData\":{\"dropped\":%d}}\n", dropped);
+
+   if (dropped)
+      debug_printf("u_trace: %d spans dropped\n", dropped);
+
+   return fclose(f) == 0;
+}
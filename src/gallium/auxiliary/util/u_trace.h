@@ -0,0 +1,131 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Timed spans of work, written out in the Chrome trace event format.
+ *
+ * Set GALLIUM_TRACE_EVENTS to a file name to record them; the file is
+ * written at exit and can be loaded in chrome://tracing.  Otherwise
+ * util_trace_begin() and util_trace_end() cost a load and a branch.
+ *
+ * Spans nest, and must be ended on the thread which began them.  Each
+ * thread records into its own buffer without locking.  Once a buffer is
+ * full, the spans of the thread are dropped and counted.
+ *
+ * A span carries the id of the shader it works on, a hash which stays
+ * the same from the GLSL source down to the driver's code generation so
+ * that all the steps of one shader can be found.  A span begun with id
+ * 0 takes the id of the span it's in, and util_trace_set_id() gives an
+ * id to the current span once it is known.  Work done later on the
+ * shader, like compiling a variant at draw time, should keep
+ * util_trace_current_id() at creation and pass it explicitly.
+ *
+ * Names must be string literals or otherwise live until exit.
+ */
+
+#ifndef U_TRACE_H
+#define U_TRACE_H
+
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Whether spans are recorded, < 0 until GALLIUM_TRACE_EVENTS is read */
+extern int util_trace_state;
+
+
+void
+util_trace_init(void);
+
+void
+util_trace_begin_span(const char *name, uint32_t id);
+
+void
+util_trace_end_span(void);
+
+void
+util_trace_set_span_id(uint32_t id);
+
+uint32_t
+util_trace_span_id(void);
+
+/**
+ * Write the spans recorded so far to \p filename.
+ * \return FALSE if the file couldn't be written.
+ */
+boolean
+util_trace_write(const char *filename);
+
+
+static INLINE boolean
+util_trace_enabled(void)
+{
+   if (unlikely(util_trace_state < 0))
+      util_trace_init();
+   return util_trace_state > 0;
+}
+
+
+static INLINE void
+util_trace_begin(const char *name, uint32_t id)
+{
+   if (util_trace_enabled())
+      util_trace_begin_span(name, id);
+}
+
+
+static INLINE void
+util_trace_end(void)
+{
+   if (util_trace_state > 0)
+      util_trace_end_span();
+}
+
+
+/** Set the shader id of the current span, and of the spans begun in it */
+static INLINE void
+util_trace_set_id(uint32_t id)
+{
+   if (util_trace_state > 0)
+      util_trace_set_span_id(id);
+}
+
+
+/** \return the shader id of the current span of this thread, or 0 */
+static INLINE uint32_t
+util_trace_current_id(void)
+{
+   return util_trace_state > 0 ? util_trace_span_id() : 0;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_TRACE_H */
@@ -34,6 +34,7 @@
 #include "pipe/p_context.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
+#include "util/u_counter.h"
 
 #include "u_upload_mgr.h"
 
@@ -51,6 +52,12 @@ struct u_upload_mgr {
    unsigned size;   /* Actual size of the upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+   unsigned own_size; /* Size of the upload buffer if it isn't one of the
+                       * ring, as counted in mem-upload. */
+
+   unsigned num_ring;  /* Number of recycled buffers, 0 if not a ring. */
+   unsigned ring_next; /* Ring buffer to try next, the least recently used. */
+   struct pipe_resource *ring[U_UPLOAD_MAX_RING_BUFFERS];
 };
 
 
@@ -72,6 +79,22 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
    return upload;
 }
 
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned default_size,
+                                           unsigned num_buffers,
+                                           unsigned alignment,
+                                           unsigned bind )
+{
+   struct u_upload_mgr *upload = u_upload_create(pipe, default_size,
+                                                 alignment, bind);
+   if (!upload)
+      return NULL;
+
+   upload->default_size = align(default_size, 4096);
+   upload->num_ring = MIN2(num_buffers, U_UPLOAD_MAX_RING_BUFFERS);
+   return upload;
+}
+
 void u_upload_unmap( struct u_upload_mgr *upload )
 {
    if (upload->transfer) {
@@ -102,16 +125,99 @@ void u_upload_flush( struct u_upload_mgr *upload )
    u_upload_unmap(upload);
    pipe_resource_reference( &upload->buffer, NULL );
    upload->size = 0;
+   util_counter_mem_free(UTIL_COUNTER_MEM_UPLOAD, upload->own_size);
+   upload->own_size = 0;
+}
+
+
+static void
+u_upload_release_ring_buffer( struct u_upload_mgr *upload, unsigned i )
+{
+   if (upload->ring[i]) {
+      pipe_resource_reference(&upload->ring[i], NULL);
+      util_counter_mem_free(UTIL_COUNTER_MEM_UPLOAD, upload->default_size);
+   }
 }
 
 
 void u_upload_destroy( struct u_upload_mgr *upload )
 {
+   unsigned i;
+
    u_upload_flush( upload );
+   for (i = 0; i < upload->num_ring; i++)
+      u_upload_release_ring_buffer(upload, i);
    FREE( upload );
 }
 
 
+/* Switch to the least recently used ring buffer that the GPU is done with.
+ *
+ * A map with PIPE_TRANSFER_DONTBLOCK fails while the buffer is still
+ * referenced by unflushed or unfinished rendering, which spares us from
+ * tracking fences for each buffer.  Empty slots are filled on first use,
+ * and if all buffers are busy, the oldest one is replaced with a new
+ * buffer, leaving the old one to the driver.
+ */
+static enum pipe_error
+u_upload_next_ring_buffer( struct u_upload_mgr *upload )
+{
+   unsigned i;
+
+   for (i = 0; i < upload->num_ring; i++) {
+      unsigned index = (upload->ring_next + i) % upload->num_ring;
+      struct pipe_resource *buffer = upload->ring[index];
+
+      if (!buffer) {
+         upload->ring_next = index;
+         break;
+      }
+
+      upload->map = pipe_buffer_map_range(upload->pipe, buffer,
+                                          0, upload->default_size,
+                                          PIPE_TRANSFER_WRITE |
+                                          PIPE_TRANSFER_FLUSH_EXPLICIT |
+                                          PIPE_TRANSFER_DONTBLOCK,
+                                          &upload->transfer);
+      if (upload->map) {
+         pipe_resource_reference(&upload->buffer, buffer);
+         upload->ring_next = (index + 1) % upload->num_ring;
+         upload->size = upload->default_size;
+         upload->offset = 0;
+         return PIPE_OK;
+      }
+   }
+
+   i = upload->ring_next;
+   u_upload_release_ring_buffer(upload, i);
+   upload->ring[i] = pipe_buffer_create(upload->pipe->screen,
+                                        upload->bind,
+                                        PIPE_USAGE_STREAM,
+                                        upload->default_size);
+   if (upload->ring[i] == NULL) {
+      return PIPE_ERROR_OUT_OF_MEMORY;
+   }
+   util_counter_mem_alloc(UTIL_COUNTER_MEM_UPLOAD, upload->default_size);
+
+   upload->map = pipe_buffer_map_range(upload->pipe, upload->ring[i],
+                                       0, upload->default_size,
+                                       PIPE_TRANSFER_WRITE |
+                                       PIPE_TRANSFER_FLUSH_EXPLICIT,
+                                       &upload->transfer);
+   if (upload->map == NULL) {
+      upload->transfer = NULL;
+      u_upload_release_ring_buffer(upload, i);
+      return PIPE_ERROR_OUT_OF_MEMORY;
+   }
+
+   pipe_resource_reference(&upload->buffer, upload->ring[i]);
+   upload->ring_next = (i + 1) % upload->num_ring;
+   upload->size = upload->default_size;
+   upload->offset = 0;
+   return PIPE_OK;
+}
+
+
 static enum pipe_error 
 u_upload_alloc_buffer( struct u_upload_mgr *upload,
                        unsigned min_size )
@@ -122,6 +228,9 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
     */
    u_upload_flush( upload );
 
+   if (upload->num_ring && min_size <= upload->default_size)
+      return u_upload_next_ring_buffer(upload);
+
    /* Allocate a new one: 
     */
    size = align(MAX2(upload->default_size, min_size), 4096);
@@ -133,6 +242,8 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
    if (upload->buffer == NULL) {
       return PIPE_ERROR_OUT_OF_MEMORY;
    }
+   upload->own_size = size;
+   util_counter_mem_alloc(UTIL_COUNTER_MEM_UPLOAD, size);
 
    /* Map the new buffer. */
    upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
@@ -142,8 +253,7 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
                                        &upload->transfer);
    if (upload->map == NULL) {
       upload->transfer = NULL;
-      upload->size = 0;
-      pipe_resource_reference(&upload->buffer, NULL);
+      u_upload_flush(upload);
       return PIPE_ERROR_OUT_OF_MEMORY;
    }
 
@@ -200,6 +310,8 @@ enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
    assert(offset + size <= upload->buffer->width0);
    assert(size);
 
+   util_counter_add(UTIL_COUNTER_UPLOAD_BYTES, size);
+
    /* Emit the return values: */
    *ptr = upload->map + offset;
    pipe_resource_reference( outbuf, upload->buffer );
@@ -37,6 +37,8 @@
 struct pipe_context;
 struct pipe_resource;
 
+#define U_UPLOAD_MAX_RING_BUFFERS 8
+
 
 /**
  * Create the upload manager.
@@ -51,6 +53,24 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
                                       unsigned alignment,
                                       unsigned bind );
 
+/**
+ * Create an upload manager that recycles a ring of buffers.
+ *
+ * Instead of creating a new buffer whenever the current one fills up or
+ * is flushed, the manager moves on to the next of \p num_buffers buffers of
+ * \p default_size bytes, and reuses it as soon as the GPU is done with it.
+ * Only allocations that don't fit in a ring buffer, or a full ring whose
+ * buffers are all still busy, create a new buffer.
+ *
+ * \param num_buffers  Number of buffers in the ring, at most
+ *                     U_UPLOAD_MAX_RING_BUFFERS.
+ */
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned default_size,
+                                           unsigned num_buffers,
+                                           unsigned alignment,
+                                           unsigned bind );
+
 /**
  * Destroy the upload manager.
  */
@@ -45,6 +45,9 @@
  * All needed uploads and translations are performed every draw command, but
  * only the subset of vertices needed for that draw command is uploaded or
  * translated. (the module never translates whole buffers)
+ * The exception is the translation of ranges of static hardware buffers,
+ * which is kept in a small cache until the source buffer is written to,
+ * see u_vbuf_resource_written().
  *
  *
  * The module consists of two main parts:
@@ -87,6 +90,7 @@
 
 #include "util/u_vbuf.h"
 
+#include "util/u_atomic.h"
 #include "util/u_dump.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
@@ -133,6 +137,33 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+/* Number of translations of static buffers kept around. */
+#define U_VBUF_CACHE_SIZE 32
+
+/* Largest translated buffer we are willing to cache, in bytes. */
+#define U_VBUF_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+/* Write counters of buffers, hashed by address, see u_vbuf_resource_written.
+ * These are global because buffers can be shared between contexts. */
+#define U_VBUF_WRITE_STAMPS 256
+static int32_t u_vbuf_write_stamps[U_VBUF_WRITE_STAMPS];
+
+/* A translated range of hardware vertex buffers. */
+struct u_vbuf_translation {
+   struct translate_key key;
+   unsigned vb_mask;
+   int start;
+   unsigned num;
+   struct pipe_resource *src[PIPE_MAX_ATTRIBS];
+   unsigned src_offset[PIPE_MAX_ATTRIBS];
+   unsigned src_stride[PIPE_MAX_ATTRIBS];
+   int32_t src_stamp[PIPE_MAX_ATTRIBS];
+
+   struct pipe_resource *buffer;
+   unsigned buffer_offset;
+   unsigned last_used;
+};
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -184,6 +215,10 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Translations of static buffers, least recently used replaced first. */
+   struct u_vbuf_translation translations[U_VBUF_CACHE_SIZE];
+   unsigned translation_clock;
 };
 
 static void *
@@ -247,8 +282,8 @@ u_vbuf_create(struct pipe_context *pipe,
    mgr->translate_cache = translate_cache_create();
    memset(mgr->fallback_vbs, ~0, sizeof(mgr->fallback_vbs));
 
-   mgr->uploader = u_upload_create(pipe, 1024 * 1024, 4,
-                                   PIPE_BIND_VERTEX_BUFFER);
+   mgr->uploader = u_upload_create_ring(pipe, 1024 * 1024, 4, 4,
+                                        PIPE_BIND_VERTEX_BUFFER);
 
    return mgr;
 }
@@ -300,6 +335,128 @@ void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
    mgr->ve = u_vbuf_set_vertex_elements_internal(mgr, count, states);
 }
 
+static INLINE int32_t *
+u_vbuf_write_stamp(const struct pipe_resource *resource)
+{
+   uintptr_t h = (uintptr_t)resource;
+
+   return &u_vbuf_write_stamps[((h >> 6) ^ (h >> 14)) % U_VBUF_WRITE_STAMPS];
+}
+
+void u_vbuf_resource_written(struct pipe_resource *resource)
+{
+   if (resource) {
+      p_atomic_inc(u_vbuf_write_stamp(resource));
+   }
+}
+
+static void
+u_vbuf_translation_release(struct u_vbuf_translation *t)
+{
+   unsigned mask = t->vb_mask;
+
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      pipe_resource_reference(&t->src[i], NULL);
+   }
+   pipe_resource_reference(&t->buffer, NULL);
+   t->vb_mask = 0;
+}
+
+/* Whether the translation of these buffers is worth caching: only static
+ * hardware buffers are.  Their writers must call u_vbuf_resource_written. */
+static boolean
+u_vbuf_translation_cacheable(struct u_vbuf *mgr, unsigned vb_mask)
+{
+   unsigned mask = vb_mask;
+
+   if (mgr->user_vb_mask & vb_mask) {
+      return FALSE;
+   }
+
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      struct pipe_resource *buf = mgr->vertex_buffer[i].buffer;
+
+      if (!buf ||
+          (buf->usage != PIPE_USAGE_STATIC &&
+           buf->usage != PIPE_USAGE_IMMUTABLE)) {
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+static struct u_vbuf_translation *
+u_vbuf_translation_find(struct u_vbuf *mgr, const struct translate_key *key,
+                        unsigned vb_mask, int start, unsigned num)
+{
+   unsigned i;
+
+   for (i = 0; i < U_VBUF_CACHE_SIZE; i++) {
+      struct u_vbuf_translation *t = &mgr->translations[i];
+      unsigned mask = vb_mask;
+
+      if (t->vb_mask != vb_mask || t->start != start || t->num != num ||
+          translate_key_compare(&t->key, key) != 0) {
+         continue;
+      }
+
+      while (mask) {
+         unsigned b = u_bit_scan(&mask);
+         const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[b];
+
+         if (t->src[b] != vb->buffer ||
+             t->src_offset[b] != vb->buffer_offset ||
+             t->src_stride[b] != vb->stride ||
+             t->src_stamp[b] != p_atomic_read(u_vbuf_write_stamp(vb->buffer))) {
+            break;
+         }
+      }
+      if (mask) {
+         continue;
+      }
+
+      t->last_used = ++mgr->translation_clock;
+      return t;
+   }
+   return NULL;
+}
+
+/* Pick the slot for a new translation, preferably one whose source buffers
+ * are only kept alive by the cache. */
+static struct u_vbuf_translation *
+u_vbuf_translation_slot(struct u_vbuf *mgr)
+{
+   struct u_vbuf_translation *oldest = &mgr->translations[0];
+   unsigned i;
+
+   for (i = 0; i < U_VBUF_CACHE_SIZE; i++) {
+      struct u_vbuf_translation *t = &mgr->translations[i];
+      unsigned mask = t->vb_mask;
+
+      if (!t->buffer) {
+         return t;
+      }
+
+      while (mask) {
+         unsigned b = u_bit_scan(&mask);
+
+         if (p_atomic_read(&t->src[b]->reference.count) == 1) {
+            u_vbuf_translation_release(t);
+            return t;
+         }
+      }
+
+      if (t->last_used < oldest->last_used) {
+         oldest = t;
+      }
+   }
+
+   u_vbuf_translation_release(oldest);
+   return oldest;
+}
+
 void u_vbuf_destroy(struct u_vbuf *mgr)
 {
    struct pipe_screen *screen = mgr->pipe->screen;
@@ -320,6 +477,10 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    }
    pipe_resource_reference(&mgr->aux_vertex_buffer_saved.buffer, NULL);
 
+   for (i = 0; i < U_VBUF_CACHE_SIZE; i++) {
+      u_vbuf_translation_release(&mgr->translations[i]);
+   }
+
    translate_cache_destroy(mgr->translate_cache);
    u_upload_destroy(mgr->uploader);
    cso_cache_delete(mgr->cso_cache);
@@ -335,11 +496,51 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 {
    struct translate *tr;
    struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
+   struct pipe_transfer *out_transfer = NULL;
    struct pipe_resource *out_buffer = NULL;
-   uint8_t *out_map;
+   struct u_vbuf_translation *cached = NULL;
+   uint8_t *out_map = NULL;
    unsigned out_offset, mask;
    enum pipe_error err;
 
+   /* Reuse the translation of static buffers if they haven't changed. */
+   if (!unroll_indices && start_vertex >= 0 && num_vertices &&
+       u_vbuf_translation_cacheable(mgr, vb_mask)) {
+      struct u_vbuf_translation *t =
+         u_vbuf_translation_find(mgr, key, vb_mask, start_vertex,
+                                 num_vertices);
+
+      if (t) {
+         pipe_resource_reference(&mgr->real_vertex_buffer[out_vb].buffer,
+                                 t->buffer);
+         mgr->real_vertex_buffer[out_vb].buffer_offset = t->buffer_offset;
+         mgr->real_vertex_buffer[out_vb].stride = key->output_stride;
+         return PIPE_OK;
+      }
+
+      if ((uint64_t)key->output_stride * (start_vertex + num_vertices) <=
+          U_VBUF_CACHE_MAX_SIZE) {
+         /* Read the stamps before the buffers, a write in between will
+          * then invalidate the translation. */
+         cached = u_vbuf_translation_slot(mgr);
+         memcpy(&cached->key, key, sizeof(*key));
+         cached->vb_mask = vb_mask;
+         cached->start = start_vertex;
+         cached->num = num_vertices;
+
+         mask = vb_mask;
+         while (mask) {
+            unsigned i = u_bit_scan(&mask);
+            const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+
+            pipe_resource_reference(&cached->src[i], vb->buffer);
+            cached->src_offset[i] = vb->buffer_offset;
+            cached->src_stride[i] = vb->stride;
+            cached->src_stamp[i] = p_atomic_read(u_vbuf_write_stamp(vb->buffer));
+         }
+      }
+   }
+
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
 
@@ -417,18 +618,52 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
          pipe_buffer_unmap(mgr->pipe, transfer);
       }
    } else {
-      /* Create and map the output buffer. */
-      err = u_upload_alloc(mgr->uploader,
-                           key->output_stride * start_vertex,
-                           key->output_stride * num_vertices,
-                           &out_offset, &out_buffer,
-                           (void**)&out_map);
-      if (err != PIPE_OK)
-         return err;
+      if (cached) {
+         /* Translate into a buffer of its own, because the upload buffers
+          * get reused.  Vertex start_vertex lands at the same place as
+          * with the upload buffer. */
+         out_buffer = pipe_buffer_create(mgr->pipe->screen,
+                                         PIPE_BIND_VERTEX_BUFFER,
+                                         PIPE_USAGE_STATIC,
+                                         key->output_stride *
+                                         (start_vertex + num_vertices));
+         if (out_buffer) {
+            out_map = pipe_buffer_map_range(mgr->pipe, out_buffer,
+                                            key->output_stride * start_vertex,
+                                            key->output_stride * num_vertices,
+                                            PIPE_TRANSFER_WRITE |
+                                            PIPE_TRANSFER_DISCARD_RANGE,
+                                            &out_transfer);
+         }
+         if (!out_map) {
+            pipe_resource_reference(&out_buffer, NULL);
+            u_vbuf_translation_release(cached);
+            cached = NULL;
+         }
+         out_offset = 0;
+      }
 
-      out_offset -= key->output_stride * start_vertex;
+      if (!cached) {
+         /* Create and map the output buffer. */
+         err = u_upload_alloc(mgr->uploader,
+                              key->output_stride * start_vertex,
+                              key->output_stride * num_vertices,
+                              &out_offset, &out_buffer,
+                              (void**)&out_map);
+         if (err != PIPE_OK)
+            return err;
+
+         out_offset -= key->output_stride * start_vertex;
+      }
 
       tr->run(tr, 0, num_vertices, 0, 0, out_map);
+
+      if (cached) {
+         pipe_buffer_unmap(mgr->pipe, out_transfer);
+         pipe_resource_reference(&cached->buffer, out_buffer);
+         cached->buffer_offset = out_offset;
+         cached->last_used = ++mgr->translation_clock;
+      }
    }
 
    /* Unmap all buffers. */
@@ -68,6 +68,11 @@ u_vbuf_create(struct pipe_context *pipe,
 
 void u_vbuf_destroy(struct u_vbuf *mgr);
 
+/* Must be called whenever the contents of a buffer change, in any context,
+ * before it is drawn from again.  This invalidates the cached translations
+ * of the buffer. */
+void u_vbuf_resource_written(struct pipe_resource *resource);
+
 /* State and draw functions. */
 void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
                                 const struct pipe_vertex_element *states);
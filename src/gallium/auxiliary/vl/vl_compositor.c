@@ -658,24 +658,13 @@ calc_drawn_area(struct vl_compositor_state *s, struct vl_compositor_layer *layer
 static void
 gen_vertex_data(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rect *dirty)
 {
-   struct vertex2f *vb;
+   struct vertex2f vertex_data[VL_COMPOSITOR_MAX_LAYERS * 20];
+   struct vertex2f *vb = vertex_data;
    struct pipe_transfer *buf_transfer;
-   unsigned i;
+   unsigned i, size;
 
    assert(c);
 
-   vb = pipe_buffer_map(c->pipe, c->vertex_buf.buffer,
-                        PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_RANGE | PIPE_TRANSFER_DONTBLOCK,
-                        &buf_transfer);
-
-   if (!vb) {
-      // If buffer is still locked from last draw create a new one
-      create_vertex_buffer(c);
-      vb = pipe_buffer_map(c->pipe, c->vertex_buf.buffer,
-                           PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_RANGE,
-                           &buf_transfer);
-   }
-
    for (i = 0; i < VL_COMPOSITOR_MAX_LAYERS; i++) {
       if (s->used_layers & (1 << i)) {
          struct vl_compositor_layer *layer = &s->layers[i];
@@ -705,31 +694,99 @@ gen_vertex_data(struct vl_compositor *c, struct vl_compositor_state *s, struct u
       }
    }
 
+   /*
+    * Layers are usually set again for each frame, static ones like
+    * subtitles or an OSD with the same values, so only map the buffer
+    * when the vertices actually changed.
+    */
+   size = (vb - vertex_data) * sizeof(struct vertex2f);
+   if (size == c->vertex_data_size && !memcmp(vertex_data, c->vertex_data, size))
+      return;
+
+   vb = pipe_buffer_map(c->pipe, c->vertex_buf.buffer,
+                        PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_RANGE | PIPE_TRANSFER_DONTBLOCK,
+                        &buf_transfer);
+
+   if (!vb) {
+      // If buffer is still locked from last draw create a new one
+      create_vertex_buffer(c);
+      vb = pipe_buffer_map(c->pipe, c->vertex_buf.buffer,
+                           PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_RANGE,
+                           &buf_transfer);
+   }
+
+   if (!vb) {
+      c->vertex_data_size = 0;
+      return;
+   }
+
+   memcpy(vb, vertex_data, size);
+   memcpy(c->vertex_data, vertex_data, size);
+   c->vertex_data_size = size;
+
    pipe_buffer_unmap(c->pipe, buf_transfer);
 }
 
+static INLINE bool
+same_samplers(struct vl_compositor_layer *a, struct vl_compositor_layer *b)
+{
+   return !memcmp(a->samplers, b->samplers, sizeof(a->samplers)) &&
+          !memcmp(a->sampler_views, b->sampler_views, sizeof(a->sampler_views));
+}
+
+static INLINE bool
+same_viewport(struct vl_compositor_layer *a, struct vl_compositor_layer *b)
+{
+   return !memcmp(&a->viewport, &b->viewport, sizeof(a->viewport));
+}
+
 static void
 draw_layers(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rect *dirty)
 {
-   unsigned vb_index, i;
+   struct vl_compositor_layer *bound = NULL;
+   void *bound_blend = NULL;
+   unsigned vb_index, num_quads, i;
 
    assert(c);
 
-   for (i = 0, vb_index = 0; i < VL_COMPOSITOR_MAX_LAYERS; ++i) {
+   /*
+    * The quads of the layers are consecutive in the vertex buffer, so
+    * following layers using the same shader, samplers, blend and viewport
+    * (e.g. OSD elements from one texture) are drawn with a single call,
+    * and only state which changed between two draws is bound again.
+    */
+   for (i = 0, vb_index = 0, num_quads = 0; i < VL_COMPOSITOR_MAX_LAYERS; ++i) {
       if (s->used_layers & (1 << i)) {
          struct vl_compositor_layer *layer = &s->layers[i];
          struct pipe_sampler_view **samplers = &layer->sampler_views[0];
          unsigned num_sampler_views = !samplers[1] ? 1 : !samplers[2] ? 2 : 3;
          void *blend = layer->blend ? layer->blend : i ? c->blend_add : c->blend_clear;
 
-         c->pipe->bind_blend_state(c->pipe, blend);
-         c->pipe->set_viewport_states(c->pipe, 0, 1, &layer->viewport);
-         c->pipe->bind_fs_state(c->pipe, layer->fs);
-         c->pipe->bind_sampler_states(c->pipe, PIPE_SHADER_FRAGMENT, 0,
-                                      num_sampler_views, layer->samplers);
-         c->pipe->set_fragment_sampler_views(c->pipe, num_sampler_views, samplers);
-         util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, vb_index * 4, 4);
-         vb_index++;
+         if (!bound || blend != bound_blend || layer->fs != bound->fs ||
+             !same_viewport(layer, bound) || !same_samplers(layer, bound)) {
+
+            if (num_quads) {
+               util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, vb_index * 4, num_quads * 4);
+               vb_index += num_quads;
+               num_quads = 0;
+            }
+
+            if (!bound || blend != bound_blend)
+               c->pipe->bind_blend_state(c->pipe, blend);
+            if (!bound || !same_viewport(layer, bound))
+               c->pipe->set_viewport_states(c->pipe, 0, 1, &layer->viewport);
+            if (!bound || layer->fs != bound->fs)
+               c->pipe->bind_fs_state(c->pipe, layer->fs);
+            if (!bound || !same_samplers(layer, bound)) {
+               c->pipe->bind_sampler_states(c->pipe, PIPE_SHADER_FRAGMENT, 0,
+                                            num_sampler_views, layer->samplers);
+               c->pipe->set_fragment_sampler_views(c->pipe, num_sampler_views, samplers);
+            }
+
+            bound = layer;
+            bound_blend = blend;
+         }
+         num_quads++;
 
          if (dirty) {
             // Remember the currently drawn area as dirty for the next draw command
@@ -741,6 +798,9 @@ draw_layers(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rec
          }
       }
    }
+
+   if (num_quads)
+      util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, vb_index * 4, num_quads * 4);
 }
 
 void
@@ -93,6 +93,11 @@ struct vl_compositor
    struct pipe_framebuffer_state fb_state;
    struct pipe_vertex_buffer vertex_buf;
 
+   /* what was last written to the vertex buffer, so unchanged layers
+    * don't need to map it again */
+   struct vertex2f vertex_data[VL_COMPOSITOR_MAX_LAYERS * 20];
+   unsigned vertex_data_size;
+
    void *sampler_linear;
    void *sampler_nearest;
    void *blend_clear, *blend_add;
@@ -0,0 +1,193 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "pipe/p_config.h"
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_cpu_detect.h"
+
+#include "vl_cpu_idct.h"
+
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
+
+/*
+ * The transformation is done as two passes of x' = C^T * x over the
+ * columns of the block, with a transpose after each. C is the orthonormal
+ * dct matrix scaled by 2^14, the first pass keeps two fractional bits and
+ * the second removes the rest. Both implementations below do exactly the
+ * same integer math, so their results are identical.
+ */
+#define PASS1_SHIFT 12
+#define PASS2_SHIFT 16
+
+static const short idct_matrix[8][8] = {
+   { 5793,  5793,  5793,  5793,  5793,  5793,  5793,  5793 },
+   { 8035,  6811,  4551,  1598, -1598, -4551, -6811, -8035 },
+   { 7568,  3135, -3135, -7568, -7568, -3135,  3135,  7568 },
+   { 6811, -1598, -8035, -4551,  4551,  8035,  1598, -6811 },
+   { 5793, -5793, -5793,  5793,  5793, -5793, -5793,  5793 },
+   { 4551, -8035,  1598,  6811, -6811, -1598,  8035, -4551 },
+   { 3135, -7568,  7568, -3135, -3135,  7568, -7568,  3135 },
+   { 1598, -4551,  6811, -8035,  8035, -6811,  4551, -1598 }
+};
+
+static void
+idct_pass_c(short block[64], unsigned shift)
+{
+   short tmp[64];
+   unsigned m, k, col;
+
+   for (m = 0; m < 8; ++m) {
+      for (col = 0; col < 8; ++col) {
+         int sum = 1 << (shift - 1);
+         for (k = 0; k < 8; ++k)
+            sum += idct_matrix[k][m] * block[k * 8 + col];
+         sum >>= shift;
+         /* stored transposed */
+         tmp[col * 8 + m] = CLAMP(sum, -32768, 32767);
+      }
+   }
+
+   memcpy(block, tmp, sizeof(tmp));
+}
+
+static void
+idct_c(short block[64])
+{
+   unsigned i;
+
+   idct_pass_c(block, PASS1_SHIFT);
+   idct_pass_c(block, PASS2_SHIFT);
+
+   for (i = 0; i < 64; ++i)
+      block[i] = CLAMP(block[i], -256, 255);
+}
+
+#if defined(PIPE_ARCH_SSE)
+
+static INLINE void
+transpose_8x8_epi16(__m128i r[8])
+{
+   __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+   __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+   __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+   __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+   __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+   __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+   __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+   __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+   __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+   __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+   __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+   __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+   __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+   __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+   __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+   __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+   r[0] = _mm_unpacklo_epi64(b0, b4);
+   r[1] = _mm_unpackhi_epi64(b0, b4);
+   r[2] = _mm_unpacklo_epi64(b1, b5);
+   r[3] = _mm_unpackhi_epi64(b1, b5);
+   r[4] = _mm_unpacklo_epi64(b2, b6);
+   r[5] = _mm_unpackhi_epi64(b2, b6);
+   r[6] = _mm_unpacklo_epi64(b3, b7);
+   r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static INLINE void
+idct_pass_sse2(__m128i r[8], unsigned shift)
+{
+   const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+   const __m128i count = _mm_cvtsi32_si128(shift);
+   __m128i lo[4], hi[4], out[8];
+   unsigned m, k;
+
+   /* interleave neighbouring rows, so that madd sums two rows at once */
+   for (k = 0; k < 4; ++k) {
+      lo[k] = _mm_unpacklo_epi16(r[k * 2], r[k * 2 + 1]);
+      hi[k] = _mm_unpackhi_epi16(r[k * 2], r[k * 2 + 1]);
+   }
+
+   for (m = 0; m < 8; ++m) {
+      __m128i sum_lo = round, sum_hi = round;
+
+      for (k = 0; k < 4; ++k) {
+         const __m128i c = _mm_set1_epi32(
+            (unsigned short)idct_matrix[k * 2][m] |
+            ((unsigned)(unsigned short)idct_matrix[k * 2 + 1][m] << 16));
+
+         sum_lo = _mm_add_epi32(sum_lo, _mm_madd_epi16(lo[k], c));
+         sum_hi = _mm_add_epi32(sum_hi, _mm_madd_epi16(hi[k], c));
+      }
+
+      sum_lo = _mm_sra_epi32(sum_lo, count);
+      sum_hi = _mm_sra_epi32(sum_hi, count);
+      out[m] = _mm_packs_epi32(sum_lo, sum_hi);
+   }
+
+   for (m = 0; m < 8; ++m)
+      r[m] = out[m];
+
+   transpose_8x8_epi16(r);
+}
+
+static void
+idct_sse2(short block[64])
+{
+   const __m128i min = _mm_set1_epi16(-256);
+   const __m128i max = _mm_set1_epi16(255);
+   __m128i r[8];
+   unsigned i;
+
+   for (i = 0; i < 8; ++i)
+      r[i] = _mm_loadu_si128((const __m128i *)(block + i * 8));
+
+   idct_pass_sse2(r, PASS1_SHIFT);
+   idct_pass_sse2(r, PASS2_SHIFT);
+
+   for (i = 0; i < 8; ++i) {
+      r[i] = _mm_max_epi16(_mm_min_epi16(r[i], max), min);
+      _mm_storeu_si128((__m128i *)(block + i * 8), r[i]);
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+void
+vl_cpu_idct(short block[64])
+{
+#if defined(PIPE_ARCH_SSE)
+   if (util_cpu_caps.has_sse2) {
+      idct_sse2(block);
+      return;
+   }
+#endif
+
+   idct_c(block);
+}
@@ -28,12 +28,15 @@
 #include <math.h>
 #include <assert.h>
 
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_sampler.h"
 #include "util/u_surface.h"
 #include "util/u_video.h"
 
 #include "vl_mpeg12_decoder.h"
+#include "vl_cpu_idct.h"
 #include "vl_defines.h"
 
 #define SCALE_FACTOR_SNORM (32768.0f / 256.0f)
@@ -82,6 +85,15 @@ static const unsigned const_empty_block_mask_420[3][2][2] = {
    { { 0x01, 0x01 },  { 0x01, 0x01 } }
 };
 
+DEBUG_GET_ONCE_BOOL_OPTION(mpeg12_cpu_idct, "VL_MPEG12_CPU_IDCT", FALSE)
+
+/* are the blocks transformed by the idct shaders, or already on the cpu */
+static INLINE bool
+idct_shaders(struct vl_mpeg12_decoder *dec)
+{
+   return dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT && !dec->cpu_idct;
+}
+
 static bool
 init_zscan_buffer(struct vl_mpeg12_decoder *dec, struct vl_mpeg12_buffer *buffer)
 {
@@ -116,7 +128,7 @@ init_zscan_buffer(struct vl_mpeg12_decoder *dec, struct vl_mpeg12_buffer *buffer
    if (!buffer->zscan_source)
       goto error_sampler;
 
-   if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT)
+   if (idct_shaders(dec))
       destination = dec->idct_source->get_surfaces(dec->idct_source);
    else
       destination = dec->mc_source->get_surfaces(dec->mc_source);
@@ -324,13 +336,41 @@ MotionVectorToPipe(const struct pipe_mpeg12_macroblock *mb, unsigned vector,
    return mv;
 }
 
+/* dequantize a block of coefficients from the bitstream decoder the same
+ * way the zscan shader does, plus the saturation and mismatch control of
+ * section 7.4.3 and 7.4.4 of the spec, which the idct shaders do otherwise
+ */
+static void
+dequant_block(const struct pipe_mpeg12_picture_desc *desc, bool intra,
+              const short src[64], short dst[64])
+{
+   const int *scan = desc->alternate_scan ? vl_zscan_alternate : vl_zscan_normal;
+   const uint8_t *matrix = intra ? desc->intra_matrix : desc->non_intra_matrix;
+   int sum = 0;
+   unsigned i;
+
+   for (i = 0; i < 64; ++i) {
+      unsigned pos = scan[i];
+      int weight = intra && pos == 0 ? 1 << (7 - desc->intra_dc_precision) : matrix[pos];
+      int value = src[i] * weight / 16;
+
+      value = CLAMP(value, -2048, 2047);
+      dst[pos] = value;
+      sum += value;
+   }
+
+   if (!(sum & 1))
+      dst[63] ^= 1;
+}
+
 static INLINE void
 UploadYcbcrBlocks(struct vl_mpeg12_decoder *dec,
                   struct vl_mpeg12_buffer *buf,
+                  const struct pipe_mpeg12_picture_desc *desc,
                   const struct pipe_mpeg12_macroblock *mb)
 {
    unsigned intra;
-   unsigned tb, x, y, num_blocks = 0;
+   unsigned i, tb, x, y, num_blocks = 0;
 
    assert(dec && buf);
    assert(mb);
@@ -379,7 +419,22 @@ UploadYcbcrBlocks(struct vl_mpeg12_decoder *dec,
       }
    }
 
-   memcpy(buf->texels, mb->blocks, 64 * sizeof(short) * num_blocks);
+   if (dec->cpu_idct) {
+      /* transform into a local block, the texels are usually write combined */
+      for (i = 0; i < num_blocks; ++i) {
+         short block[64];
+
+         if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM)
+            dequant_block(desc, intra, mb->blocks + i * 64, block);
+         else
+            memcpy(block, mb->blocks + i * 64, sizeof(block));
+
+         vl_cpu_idct(block);
+         memcpy(buf->texels + i * 64, block, sizeof(block));
+      }
+   } else
+      memcpy(buf->texels, mb->blocks, 64 * sizeof(short) * num_blocks);
+
    buf->texels += 64 * num_blocks;
 }
 
@@ -417,7 +472,7 @@ vl_mpeg12_destroy(struct pipe_video_codec *decoder)
    vl_mc_cleanup(&dec->mc_c);
    dec->mc_source->destroy(dec->mc_source);
 
-   if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+   if (idct_shaders(dec)) {
       vl_idct_cleanup(&dec->idct_y);
       vl_idct_cleanup(&dec->idct_c);
       dec->idct_source->destroy(dec->idct_source);
@@ -470,7 +525,7 @@ vl_mpeg12_get_decode_buffer(struct vl_mpeg12_decoder *dec, struct pipe_video_buf
    if (!init_mc_buffer(dec, buffer))
       goto error_mc;
 
-   if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT)
+   if (idct_shaders(dec))
       if (!init_idct_buffer(dec, buffer))
          goto error_idct;
 
@@ -524,7 +579,7 @@ vl_mpeg12_begin_frame(struct pipe_video_codec *decoder,
    buf = vl_mpeg12_get_decode_buffer(dec, target);
    assert(buf);
 
-   if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM) {
+   if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM && !dec->cpu_idct) {
       memcpy(intra_matrix, desc->intra_matrix, sizeof(intra_matrix));
       memcpy(non_intra_matrix, desc->non_intra_matrix, sizeof(non_intra_matrix));
       intra_matrix[0] = 1 << (7 - desc->intra_dc_precision);
@@ -561,7 +616,7 @@ vl_mpeg12_begin_frame(struct pipe_video_codec *decoder,
    for (i = 0; i < VL_MAX_REF_FRAMES; ++i)
       buf->mv_stream[i] = vl_vb_get_mv_stream(&buf->vertex_stream, i);
 
-   if (dec->base.entrypoint >= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+   if (dec->base.entrypoint >= PIPE_VIDEO_ENTRYPOINT_IDCT || dec->cpu_idct) {
       for (i = 0; i < VL_NUM_COMPONENTS; ++i)
          vl_zscan_set_layout(&buf->zscan[i], dec->zscan_linear);
    }
@@ -591,7 +646,7 @@ vl_mpeg12_decode_macroblock(struct pipe_video_codec *decoder,
       unsigned mb_addr = mb->y * dec->width_in_macroblocks + mb->x;
 
       if (mb->macroblock_type & (PIPE_MPEG12_MB_TYPE_PATTERN | PIPE_MPEG12_MB_TYPE_INTRA))
-         UploadYcbcrBlocks(dec, buf, mb);
+         UploadYcbcrBlocks(dec, buf, desc, mb);
 
       MacroBlockTypeToPipeWeights(mb, mv_weights);
 
@@ -656,9 +711,12 @@ vl_mpeg12_decode_bitstream(struct pipe_video_codec *decoder,
    buf = vl_mpeg12_get_decode_buffer(dec, target);
    assert(buf);
 
-   for (i = 0; i < VL_NUM_COMPONENTS; ++i)
-      vl_zscan_set_layout(&buf->zscan[i], desc->alternate_scan ?
-                          dec->zscan_alternate : dec->zscan_normal);
+   /* with the cpu idct the blocks are already in raster order */
+   if (!dec->cpu_idct) {
+      for (i = 0; i < VL_NUM_COMPONENTS; ++i)
+         vl_zscan_set_layout(&buf->zscan[i], desc->alternate_scan ?
+                             dec->zscan_alternate : dec->zscan_normal);
+   }
 
    vl_mpg12_bs_decode(&buf->bs, target, desc, num_buffers, buffers, sizes);
 }
@@ -726,7 +784,7 @@ vl_mpeg12_end_frame(struct pipe_video_codec *decoder,
 
       vl_zscan_render(i ? &dec->zscan_c : & dec->zscan_y, &buf->zscan[i] , buf->num_ycbcr_blocks[i]);
 
-      if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT)
+      if (idct_shaders(dec))
          vl_idct_flush(i ? &dec->idct_c : &dec->idct_y, &buf->idct[i], buf->num_ycbcr_blocks[i]);
    }
 
@@ -743,7 +801,7 @@ vl_mpeg12_end_frame(struct pipe_video_codec *decoder,
          vb[1] = vl_vb_get_ycbcr(&buf->vertex_stream, plane);
          dec->base.context->set_vertex_buffers(dec->base.context, 0, 2, vb);
 
-         if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT)
+         if (idct_shaders(dec))
             vl_idct_prepare_stage2(i ? &dec->idct_c : &dec->idct_y, &buf->idct[plane]);
          else {
             dec->base.context->set_fragment_sampler_views(dec->base.context, 1, &mc_source_sv[plane]);
@@ -857,7 +915,7 @@ init_zscan(struct vl_mpeg12_decoder *dec, const struct format_config* format_con
    dec->zscan_normal = vl_zscan_layout(dec->base.context, vl_zscan_normal, dec->blocks_per_line);
    dec->zscan_alternate = vl_zscan_layout(dec->base.context, vl_zscan_alternate, dec->blocks_per_line);
 
-   num_channels = dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT ? 4 : 1;
+   num_channels = idct_shaders(dec) ? 4 : 1;
 
    if (!vl_zscan_init(&dec->zscan_y, dec->base.context, dec->base.width, dec->base.height,
                       dec->blocks_per_line, dec->num_blocks, num_channels))
@@ -987,7 +1045,7 @@ mc_vert_shader_callback(void *priv, struct vl_mc *mc,
    assert(priv && mc);
    assert(shader);
 
-   if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+   if (idct_shaders(dec)) {
       struct vl_idct *idct = mc == &dec->mc_y ? &dec->idct_y : &dec->idct_c;
       vl_idct_stage2_vert_shader(idct, shader, first_output, tex);
    } else {
@@ -1008,7 +1066,7 @@ mc_frag_shader_callback(void *priv, struct vl_mc *mc,
    assert(priv && mc);
    assert(shader);
 
-   if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+   if (idct_shaders(dec)) {
       struct vl_idct *idct = mc == &dec->mc_y ? &dec->idct_y : &dec->idct_c;
       vl_idct_stage2_frag_shader(idct, shader, first_input, dst);
    } else {
@@ -1093,6 +1151,16 @@ vl_create_mpeg12_decoder(struct pipe_context *context,
       return NULL;
    }
 
+   /* without the formats the idct shaders need, or if asked to, do the idct
+    * on the cpu and only use shaders for the motion compensation
+    */
+   if (templat->entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT &&
+       (!format_config || debug_get_option_mpeg12_cpu_idct())) {
+      dec->cpu_idct = true;
+      util_cpu_detect();
+      format_config = find_format_config(dec, mc_format_config, num_mc_format_configs);
+   }
+
    if (!format_config) {
       FREE(dec);
       return NULL;
@@ -1101,7 +1169,7 @@ vl_create_mpeg12_decoder(struct pipe_context *context,
    if (!init_zscan(dec, format_config))
       goto error_zscan;
 
-   if (templat->entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+   if (idct_shaders(dec)) {
       if (!init_idct(dec, format_config))
          goto error_sources;
    } else {
@@ -1132,7 +1200,7 @@ error_mc_c:
    vl_mc_cleanup(&dec->mc_y);
 
 error_mc_y:
-   if (templat->entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+   if (idct_shaders(dec)) {
       vl_idct_cleanup(&dec->idct_y);
       vl_idct_cleanup(&dec->idct_c);
       dec->idct_source->destroy(dec->idct_source);
@@ -72,6 +72,9 @@ struct vl_mpeg12_decoder
    struct vl_idct idct_y, idct_c;
    struct vl_mc mc_y, mc_c;
 
+   /* idct done on the cpu while uploading the blocks */
+   bool cpu_idct;
+
    void *dsa;
 
    unsigned current_buffer;
@@ -27,6 +27,7 @@
  */
 
 #include <stdarg.h>
+#include <limits.h>
 
 #include "pipe/p_state.h"
 #include "util/u_string.h"
@@ -110,8 +111,8 @@ struct fd3_compile_context {
 	 */
 	regmask_t needs_sy;
 
-	/* inputs start at r0, temporaries start after last input, and
-	 * outputs start after last temporary.
+	/* inputs start at r0, outputs start after last input, and
+	 * temporaries start after last output.
 	 *
 	 * We could be more clever, because this is not a hw restriction,
 	 * but probably best just to implement an optimizing pass to
@@ -120,6 +121,13 @@ struct fd3_compile_context {
 	 */
 	unsigned base_reg[TGSI_FILE_COUNT];
 
+	/* TGSI temporary -> register (relative to base_reg), assigned from
+	 * live ranges by compile_temps().  Internal temps go after the last
+	 * register used by TGSI temporaries.
+	 */
+	unsigned *temp_map;
+	unsigned num_temp_regs;
+
 	/* idx/slot for last compiler generated immediate */
 	unsigned immediate_idx;
 
@@ -145,6 +153,7 @@ static void vectorize(struct fd3_compile_context *ctx,
 		int nsrcs, ...);
 static void create_mov(struct fd3_compile_context *ctx,
 		struct tgsi_dst_register *dst, struct tgsi_src_register *src);
+static void compile_temps(struct fd3_compile_context *ctx);
 
 static unsigned
 compile_init(struct fd3_compile_context *ctx, struct fd3_shader_stateobj *so,
@@ -182,6 +191,8 @@ compile_init(struct fd3_compile_context *ctx, struct fd3_shader_stateobj *so,
 	so->first_immediate = ctx->base_reg[TGSI_FILE_IMMEDIATE];
 	ctx->immediate_idx = 4 * (ctx->info.file_max[TGSI_FILE_IMMEDIATE] + 1);
 
+	compile_temps(ctx);
+
 	ret = tgsi_parse_init(&ctx->parser, tokens);
 	if (ret != TGSI_PARSE_OK)
 		return ret;
@@ -209,9 +220,100 @@ compile_error(struct fd3_compile_context *ctx, const char *format, ...)
 static void
 compile_free(struct fd3_compile_context *ctx)
 {
+	FREE(ctx->temp_map);
 	tgsi_parse_free(&ctx->parser);
 }
 
+/* Assign registers to TGSI temporaries based on their live ranges, so
+ * that temporaries which are never live at the same time share the same
+ * register.  The ranges come from tgsi_scan_liveness(), which keeps a
+ * temporary used in a loop live across the whole loop.  Two temporaries
+ * referenced by the same instruction never share a register, which keeps
+ * the dst/src overlap check in get_dst() valid.  Temporaries which are
+ * written but never read keep their register, since a sfu or tex result
+ * could still land in it after the next instruction.
+ */
+static void
+compile_temps(struct fd3_compile_context *ctx)
+{
+	struct tgsi_decoded_shader *shader;
+	struct tgsi_shader_liveness *live = NULL;
+	unsigned ntemps = ctx->info.file_max[TGSI_FILE_TEMPORARY] + 1;
+	int *reg_last = NULL;
+	unsigned *order = NULL;
+	unsigned i, j;
+
+	ctx->temp_map = CALLOC(MAX2(ntemps, 1), sizeof(*ctx->temp_map));
+	ctx->num_temp_regs = ntemps;
+
+	for (i = 0; i < ntemps; i++)
+		ctx->temp_map[i] = i;
+
+	if (!ntemps || (ctx->info.indirect_files & (1 << TGSI_FILE_TEMPORARY)))
+		return;
+
+	shader = tgsi_decode_shader(ctx->tokens);
+	if (!shader)
+		return;
+
+	live = tgsi_scan_liveness(shader);
+	tgsi_free_decoded_shader(shader);
+
+	reg_last = MALLOC(ntemps * sizeof(*reg_last));
+	order    = MALLOC(ntemps * sizeof(*order));
+	if (!live || live->num_temps < ntemps || !reg_last || !order)
+		goto out;
+
+	/* linear scan, in order of the start of the live range: */
+	for (i = 0; i < ntemps; i++) {
+		for (j = i; j > 0 && live->temps[order[j - 1]].first >
+				live->temps[i].first; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	ctx->num_temp_regs = 0;
+	for (i = 0; i < ntemps; i++) {
+		const struct tgsi_temp_usage *temp = &live->temps[order[i]];
+		unsigned r;
+
+		if (temp->first < 0) {
+			/* never referenced: */
+			ctx->temp_map[order[i]] = 0;
+			continue;
+		}
+
+		for (r = 0; r < ctx->num_temp_regs; r++)
+			if (reg_last[r] < temp->first)
+				break;
+
+		if (r == ctx->num_temp_regs)
+			ctx->num_temp_regs++;
+
+		ctx->temp_map[order[i]] = r;
+		reg_last[r] = temp->read_mask ? temp->last : INT_MAX;
+	}
+
+	DBG("%u temporaries in %u registers", ntemps, ctx->num_temp_regs);
+
+out:
+	tgsi_free_liveness(live);
+	FREE(reg_last);
+	FREE(order);
+}
+
+static unsigned
+temp_reg(struct fd3_compile_context *ctx, unsigned index)
+{
+	unsigned ntemps = ctx->info.file_max[TGSI_FILE_TEMPORARY] + 1;
+
+	/* internal temps are allocated past the end of the TGSI ones: */
+	if (index >= ntemps)
+		return ctx->num_temp_regs + (index - ntemps);
+
+	return ctx->temp_map[index];
+}
+
 struct instr_translater {
 	void (*fxn)(const struct instr_translater *t,
 			struct fd3_compile_context *ctx,
@@ -248,9 +350,11 @@ add_dst_reg(struct fd3_compile_context *ctx, struct ir3_instruction *instr,
 
 	switch (dst->File) {
 	case TGSI_FILE_OUTPUT:
-	case TGSI_FILE_TEMPORARY:
 		num = dst->Index + ctx->base_reg[dst->File];
 		break;
+	case TGSI_FILE_TEMPORARY:
+		num = temp_reg(ctx, dst->Index) + ctx->base_reg[dst->File];
+		break;
 	default:
 		compile_error(ctx, "unsupported dst register file: %s\n",
 			tgsi_file_name(dst->File));
@@ -285,9 +389,11 @@ add_src_reg(struct fd3_compile_context *ctx, struct ir3_instruction *instr,
 		 * clamp()'ing saturated dst instructions
 		 */
 	case TGSI_FILE_INPUT:
-	case TGSI_FILE_TEMPORARY:
 		num = src->Index + ctx->base_reg[src->File];
 		break;
+	case TGSI_FILE_TEMPORARY:
+		num = temp_reg(ctx, src->Index) + ctx->base_reg[src->File];
+		break;
 	default:
 		compile_error(ctx, "unsupported src register file: %s\n",
 			tgsi_file_name(src->File));
@@ -477,8 +583,6 @@ create_mov(struct fd3_compile_context *ctx, struct tgsi_dst_register *dst,
 			instr->cat1.dst_type = type_mov;
 			add_dst_reg(ctx, instr, dst, i);
 			add_src_reg(ctx, instr, src, src_swiz(src, i));
-		} else {
-			ir3_instr_create(ctx->ir, 0, OPC_NOP);
 		}
 	}
 }
@@ -592,12 +696,9 @@ vectorize(struct fd3_compile_context *ctx, struct ir3_instruction *instr,
 		}
 	}
 
-	/* pad w/ nop's.. at least until we are clever enough to
-	 * figure out if we really need to..
+	/* no nop padding needed, schedule() inserts the delay slots which
+	 * are actually required:
 	 */
-	for (; n < 4; n++) {
-		ir3_instr_create(instr->shader, 0, OPC_NOP);
-	}
 }
 
 /*
@@ -1395,7 +1496,6 @@ instr_cat4(const struct instr_translater *t,
 	if (is_const(src))
 		src = get_unconst(ctx, src);
 
-	ir3_instr_create(ctx->ir, 0, OPC_NOP)->repeat = 5;
 	instr = ir3_instr_create(ctx->ir, 4, t->opc);
 
 	vectorize(ctx, instr, dst, 1, src, 0);
@@ -1628,6 +1728,319 @@ compile_instructions(struct fd3_compile_context *ctx)
 		ctx->last_input->flags |= IR3_REG_EI;
 }
 
+/*
+ * Scheduling:
+ *
+ * The alu is not interlocked.  The result of a cat1/cat2/cat3 instruction
+ * needs three delay slots before another alu instruction can use it, and
+ * six before a flow control, sfu, tex or mem instruction can.  The third
+ * src of a mad is not read on the first cycle, so it only needs one.  The
+ * sfu and tex pipelines are synchronized with the (ss)/(sy) flags instead,
+ * see src_flags().
+ *
+ * Within runs of plain alu instructions, independent instructions are
+ * moved into the delay slots of the ones before them, and whatever is
+ * left is filled with nop's.  The pending alu writes are carried across
+ * branches to their targets, so a jump target waits for whichever of its
+ * predecessors is the slowest.
+ */
+
+#define SCHED_WINDOW 8
+
+struct sched_state {
+	/* next issue cycle: */
+	int cycle;
+
+	/* cycle of the last alu write, per register component: */
+	int written[MAX_REG];
+};
+
+struct sched_ctx {
+	struct ir3_shader *ir;
+	unsigned window;
+
+	struct sched_state state;
+
+	/* branch instructions, and their targets: */
+	struct ir3_instruction **branches, **targets;
+	unsigned nbranches;
+
+	/* state at branches whose target is not scheduled yet: */
+	struct {
+		struct ir3_instruction *target;
+		struct sched_state state;
+	} pending[16];
+	unsigned npending;
+};
+
+static bool
+is_alu(struct ir3_instruction *instr)
+{
+	return (1 <= instr->category) && (instr->category <= 3);
+}
+
+static bool
+is_bary(struct ir3_instruction *instr)
+{
+	return (instr->category == 2) && (instr->opc == OPC_BARY_F);
+}
+
+static bool
+is_branch(struct ir3_instruction *instr)
+{
+	return (instr->category == 0) &&
+			((instr->opc == OPC_BR) || (instr->opc == OPC_JUMP));
+}
+
+static bool
+is_gpr(struct ir3_register *reg)
+{
+	return !(reg->flags & (IR3_REG_CONST | IR3_REG_IMMED));
+}
+
+/* alu instructions which can be freely reordered w/ their neighbours,
+ * as long as register dependencies are respected:
+ */
+static bool
+is_schedulable(struct ir3_instruction *instr)
+{
+	if (!is_alu(instr) || instr->repeat || is_bary(instr))
+		return false;
+	if (instr->flags & (IR3_INSTR_SS | IR3_INSTR_SY | IR3_INSTR_JP))
+		return false;
+	return true;
+}
+
+/* does instr (which comes after dep in program order) have to stay
+ * after dep?
+ */
+static bool
+depends(struct ir3_instruction *instr, struct ir3_instruction *dep)
+{
+	unsigned i;
+
+	if (instr->regs[0]->num == dep->regs[0]->num)
+		return true;
+
+	for (i = 1; i < instr->regs_count; i++)
+		if (is_gpr(instr->regs[i]) &&
+				(instr->regs[i]->num == dep->regs[0]->num))
+			return true;
+
+	for (i = 1; i < dep->regs_count; i++)
+		if (is_gpr(dep->regs[i]) &&
+				(dep->regs[i]->num == instr->regs[0]->num))
+			return true;
+
+	return false;
+}
+
+/* # of cycles instr would have to wait if issued now: */
+static int
+sched_stall(struct sched_ctx *ctx, struct ir3_instruction *instr)
+{
+	struct sched_state *state = &ctx->state;
+	int ready = state->cycle;
+	unsigned i, j;
+
+	if (instr->category == 0) {
+		/* br and kill read p0: */
+		if ((instr->opc == OPC_BR) || (instr->opc == OPC_KILL))
+			ready = state->written[regid(REG_P0, 0)] + 6 + 1;
+		return MAX2(ready - state->cycle, 0);
+	}
+
+	/* bary.f reads the input base, which isn't written by the shader: */
+	if (is_bary(instr))
+		return 0;
+
+	for (i = 1; i < instr->regs_count; i++) {
+		struct ir3_register *reg = instr->regs[i];
+		unsigned n = 0;
+		int delay;
+
+		if (!is_gpr(reg))
+			continue;
+
+		if (reg->flags & IR3_REG_R)
+			n = instr->repeat;
+		else if (instr->category >= 5)
+			n = 3;  /* coordinates, etc, are read as a vector */
+
+		if (!is_alu(instr))
+			delay = 6;
+		else if ((instr->category == 3) && is_mad(instr->opc) && (i == 3))
+			delay = 1;
+		else
+			delay = 3;
+
+		/* with (r), each repetition reads the next component: */
+		for (j = 0; j <= n; j++) {
+			int r = (reg->flags & IR3_REG_R) ? j : 0;
+			if (reg->num + j < MAX_REG)
+				ready = MAX2(ready,
+						state->written[reg->num + j] + delay + 1 - r);
+		}
+	}
+
+	return ready - state->cycle;
+}
+
+static void
+sched_merge(struct sched_state *state, const struct sched_state *other)
+{
+	unsigned i;
+	for (i = 0; i < ARRAY_SIZE(state->written); i++) {
+		int w = other->written[i] - other->cycle + state->cycle;
+		state->written[i] = MAX2(state->written[i], w);
+	}
+}
+
+static void
+sched_emit(struct sched_ctx *ctx, struct ir3_instruction *instr)
+{
+	struct sched_state *state = &ctx->state;
+	unsigned i;
+	int stall;
+
+	/* if this is a branch target, the writes pending at the branch are
+	 * still pending here:
+	 */
+	for (i = 0; i < ctx->npending; ) {
+		if (ctx->pending[i].target == instr) {
+			sched_merge(state, &ctx->pending[i].state);
+			ctx->pending[i] = ctx->pending[--ctx->npending];
+		} else {
+			i++;
+		}
+	}
+
+	stall = sched_stall(ctx, instr);
+	if (stall > 0) {
+		ir3_instr_create(ctx->ir, 0, OPC_NOP)->repeat = stall - 1;
+		state->cycle += stall;
+	}
+
+	ir3_instr_insert(ctx->ir, instr);
+
+	if (is_alu(instr)) {
+		for (i = 0; i <= instr->repeat; i++)
+			if (instr->regs[0]->num + i < MAX_REG)
+				state->written[instr->regs[0]->num + i] = state->cycle + i;
+	}
+
+	state->cycle += instr->repeat + 1;
+
+	if (is_branch(instr)) {
+		for (i = 0; i < ctx->nbranches; i++) {
+			if (ctx->branches[i] == instr) {
+				assert(ctx->npending < ARRAY_SIZE(ctx->pending));
+				ctx->pending[ctx->npending].target = ctx->targets[i];
+				ctx->pending[ctx->npending].state = *state;
+				ctx->npending++;
+				break;
+			}
+		}
+	}
+}
+
+/* list-schedule a run of schedulable instructions, picking from the
+ * first few not yet scheduled the first one which can issue without
+ * stalling (or else the one which stalls the least):
+ */
+static void
+sched_block(struct sched_ctx *ctx, struct ir3_instruction **instrs,
+		unsigned n)
+{
+	while (n > 0) {
+		unsigned i, j, best = 0;
+		int best_stall = INT_MAX;
+
+		for (i = 0; i < MIN2(n, ctx->window); i++) {
+			int stall;
+
+			for (j = 0; j < i; j++)
+				if (depends(instrs[i], instrs[j]))
+					break;
+			if (j < i)
+				continue;
+
+			stall = sched_stall(ctx, instrs[i]);
+			if (stall < best_stall) {
+				best = i;
+				best_stall = stall;
+				if (!stall)
+					break;
+			}
+		}
+
+		sched_emit(ctx, instrs[best]);
+
+		n--;
+		memmove(&instrs[best], &instrs[best + 1],
+				(n - best) * sizeof(instrs[0]));
+	}
+}
+
+static void
+schedule(struct fd3_compile_context *ctx)
+{
+	struct ir3_shader *ir = ctx->ir;
+	struct sched_ctx *sched;
+	struct ir3_instruction **instrs;
+	unsigned count = ir->instrs_count, i, start;
+
+	sched = CALLOC_STRUCT(sched_ctx);
+	instrs = MALLOC(count * sizeof(*instrs));
+	sched->branches = MALLOC(count * sizeof(*sched->branches));
+	sched->targets  = MALLOC(count * sizeof(*sched->targets));
+
+	memcpy(instrs, ir->instrs, count * sizeof(*instrs));
+
+	/* remember branch targets, to fix up the offsets afterwards: */
+	for (i = 0; i < count; i++) {
+		struct ir3_instruction *instr = instrs[i];
+		if (is_branch(instr)) {
+			compile_assert(ctx, i + instr->cat0.immed < count);
+			sched->branches[sched->nbranches] = instr;
+			sched->targets[sched->nbranches++] =
+					instrs[i + instr->cat0.immed];
+		}
+	}
+
+	sched->ir = ir;
+	sched->window = (fd_mesa_debug & FD_DBG_NOSCHED) ? 1 : SCHED_WINDOW;
+	for (i = 0; i < ARRAY_SIZE(sched->state.written); i++)
+		sched->state.written[i] = -8;
+
+	ir->instrs_count = 0;
+
+	i = 0;
+	while (i < count) {
+		if (is_schedulable(instrs[i])) {
+			start = i;
+			while ((i < count) && is_schedulable(instrs[i]))
+				i++;
+			sched_block(sched, &instrs[start], i - start);
+		} else {
+			sched_emit(sched, instrs[i++]);
+		}
+	}
+
+	for (i = 0; i < sched->nbranches; i++) {
+		sched->branches[i]->cat0.immed =
+				find_instruction(ctx, sched->targets[i]) -
+				find_instruction(ctx, sched->branches[i]);
+	}
+
+	DBG("scheduled %u instructions into %u", count, ir->instrs_count);
+
+	FREE(instrs);
+	FREE(sched->branches);
+	FREE(sched->targets);
+	FREE(sched);
+}
+
 int
 fd3_compile_shader(struct fd3_shader_stateobj *so,
 		const struct tgsi_token *tokens)
@@ -1649,6 +2062,8 @@ fd3_compile_shader(struct fd3_shader_stateobj *so,
 
 	compile_instructions(&ctx);
 
+	schedule(&ctx);
+
 	compile_free(&ctx);
 
 	return 0;
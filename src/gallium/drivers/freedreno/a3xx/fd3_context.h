@@ -44,8 +44,6 @@ struct fd3_context {
 	 */
 	struct fd_bo *vsc_size_mem;
 
-	struct fd_bo *vsc_pipe_mem;
-
 	/* vertex buf used for clear/gmem->mem vertices, and mem->gmem
 	 * vertices:
 	 */
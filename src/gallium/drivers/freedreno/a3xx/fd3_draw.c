@@ -43,7 +43,7 @@
 
 
 static void
-emit_vertexbufs(struct fd_context *ctx)
+emit_vertexbufs(struct fd_context *ctx, struct fd_ringbuffer *ring)
 {
 	struct fd_vertex_stateobj *vtx = ctx->vtx;
 	struct fd_vertexbuf_stateobj *vertexbuf = &ctx->vertexbuf;
@@ -63,19 +63,17 @@ emit_vertexbufs(struct fd_context *ctx)
 		bufs[i].format = elem->src_format;
 	}
 
-	fd3_emit_vertex_bufs(ctx->ring, &ctx->prog, bufs, vtx->num_elements);
+	fd3_emit_vertex_bufs(ring, &ctx->prog, bufs, vtx->num_elements);
 }
 
 static void
-fd3_draw(struct fd_context *ctx, const struct pipe_draw_info *info)
+draw_impl(struct fd_context *ctx, struct fd_ringbuffer *ring,
+		unsigned dirty, const struct pipe_draw_info *info, bool binning)
 {
-	struct fd_ringbuffer *ring = ctx->ring;
-	unsigned dirty = ctx->dirty;
-
-	fd3_emit_state(ctx, dirty);
+	fd3_emit_state(ctx, ring, dirty, binning);
 
 	if (dirty & FD_DIRTY_VTXBUF)
-		emit_vertexbufs(ctx);
+		emit_vertexbufs(ctx, ring);
 
 	OUT_PKT0(ring, REG_A3XX_PC_VERTEX_REUSE_BLOCK_CNTL, 1);
 	OUT_RING(ring, 0x0000000b);                  /* PC_VERTEX_REUSE_BLOCK_CNTL */
@@ -92,7 +90,20 @@ fd3_draw(struct fd_context *ctx, const struct pipe_draw_info *info)
 	OUT_RING(ring, info->primitive_restart ? /* PC_RESTART_INDEX */
 			info->restart_index : 0xffffffff);
 
-	fd_draw_emit(ctx, info);
+	/* in the rendering pass, use the visibility stream from the binning
+	 * pass (if there was one) to skip primitives which miss the tile:
+	 */
+	fd_draw_emit(ctx, ring, binning ? IGNORE_VISIBILITY : USE_VISIBILITY,
+			info);
+}
+
+static void
+fd3_draw(struct fd_context *ctx, const struct pipe_draw_info *info)
+{
+	unsigned dirty = ctx->dirty;
+
+	draw_impl(ctx, ctx->binning_ring, dirty, info, true);
+	draw_impl(ctx, ctx->ring, dirty, info, false);
 }
 
 static void
@@ -102,10 +113,15 @@ fd3_clear(struct fd_context *ctx, unsigned buffers,
 	struct fd3_context *fd3_ctx = fd3_context(ctx);
 	struct fd_ringbuffer *ring = ctx->ring;
 	unsigned ce, i;
+	unsigned dirty = ctx->dirty & (FD_DIRTY_VIEWPORT |
+			FD_DIRTY_FRAMEBUFFER | FD_DIRTY_SCISSOR);
 
-	/* emit generic state now: */
-	fd3_emit_state(ctx, ctx->dirty & (FD_DIRTY_VIEWPORT |
-			FD_DIRTY_FRAMEBUFFER | FD_DIRTY_SCISSOR));
+	/* emit generic state now.  The clear itself is not part of the
+	 * binning pass, but the state still needs to make it to the binning
+	 * cmds since it is no longer dirty for the next draw:
+	 */
+	fd3_emit_state(ctx, ctx->binning_ring, dirty, true);
+	fd3_emit_state(ctx, ring, dirty, false);
 
 	OUT_PKT0(ring, REG_A3XX_RB_BLEND_ALPHA, 1);
 	OUT_RING(ring, 0X3c0000ff);
@@ -217,8 +233,8 @@ fd3_clear(struct fd_context *ctx, unsigned buffers,
 	OUT_PKT3(ring, CP_EVENT_WRITE, 1);
 	OUT_RING(ring, PERFCOUNTER_STOP);
 
-	fd_draw(ctx, DI_PT_RECTLIST, DI_SRC_SEL_AUTO_INDEX, 2,
-			INDEX_SIZE_IGN, 0, 0, NULL);
+	fd_draw(ctx, ring, DI_PT_RECTLIST, IGNORE_VISIBILITY,
+			DI_SRC_SEL_AUTO_INDEX, 2, INDEX_SIZE_IGN, 0, 0, NULL);
 
 	OUT_WFI (ring);
 }
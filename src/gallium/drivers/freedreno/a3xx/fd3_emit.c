@@ -338,11 +338,13 @@ fd3_emit_vertex_bufs(struct fd_ringbuffer *ring,
 	}
 }
 
+/* emit state into either the rendering or the binning cmds.  The binning
+ * pass doesn't write any color, so the fragment-only state is left out:
+ */
 void
-fd3_emit_state(struct fd_context *ctx, uint32_t dirty)
+fd3_emit_state(struct fd_context *ctx, struct fd_ringbuffer *ring,
+		uint32_t dirty, bool binning)
 {
-	struct fd_ringbuffer *ring = ctx->ring;
-
 	emit_marker(ring, 5);
 
 	if (dirty & FD_DIRTY_SAMPLE_MASK) {
@@ -356,7 +358,8 @@ fd3_emit_state(struct fd_context *ctx, uint32_t dirty)
 		struct fd3_zsa_stateobj *zsa = fd3_zsa_stateobj(ctx->zsa);
 		struct pipe_stencil_ref *sr = &ctx->stencil_ref;
 
-		fd3_emit_rbrc_draw_state(ring, zsa->rb_render_control);
+		fd3_emit_rbrc_draw_state(ring, zsa->rb_render_control |
+				COND(binning, A3XX_RB_RENDER_CONTROL_DISABLE_COLOR_PIPE));
 
 		OUT_PKT0(ring, REG_A3XX_RB_ALPHA_REF, 1);
 		OUT_RING(ring, zsa->rb_alpha_ref);
@@ -447,7 +450,7 @@ fd3_emit_state(struct fd_context *ctx, uint32_t dirty)
 				(prog->dirty & FD_SHADER_DIRTY_FP) ? prog->fp : NULL);
 	}
 
-	if (dirty & FD_DIRTY_BLEND) {
+	if ((dirty & FD_DIRTY_BLEND) && !binning) {
 		struct fd3_blend_stateobj *blend = fd3_blend_stateobj(ctx->blend);
 		uint32_t i;
 
@@ -463,7 +466,7 @@ fd3_emit_state(struct fd_context *ctx, uint32_t dirty)
 	if (dirty & FD_DIRTY_VERTTEX)
 		emit_textures(ring, SB_VERT_TEX, &ctx->verttex);
 
-	if (dirty & FD_DIRTY_FRAGTEX)
+	if ((dirty & FD_DIRTY_FRAGTEX) && !binning)
 		emit_textures(ring, SB_FRAG_TEX, &ctx->fragtex);
 
 	ctx->dirty &= ~dirty;
@@ -58,7 +58,8 @@ struct fd3_vertex_buf {
 void fd3_emit_vertex_bufs(struct fd_ringbuffer *ring,
 		struct fd_program_stateobj *prog,
 		struct fd3_vertex_buf *vbufs, uint32_t n);
-void fd3_emit_state(struct fd_context *ctx, uint32_t dirty);
+void fd3_emit_state(struct fd_context *ctx, struct fd_ringbuffer *ring,
+		uint32_t dirty, bool binning);
 void fd3_emit_restore(struct fd_context *ctx);
 
 
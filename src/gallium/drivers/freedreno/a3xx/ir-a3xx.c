@@ -477,7 +477,7 @@ static struct ir3_register * reg_create(struct ir3_shader *shader,
 	return reg;
 }
 
-static void insert_instr(struct ir3_shader *shader,
+void ir3_instr_insert(struct ir3_shader *shader,
 		struct ir3_instruction *instr)
 {
 	assert(shader->instrs_count < ARRAY_SIZE(shader->instrs));
@@ -492,7 +492,7 @@ struct ir3_instruction * ir3_instr_create(struct ir3_shader *shader,
 	instr->shader = shader;
 	instr->category = category;
 	instr->opc = opc;
-	insert_instr(shader, instr);
+	ir3_instr_insert(shader, instr);
 	return instr;
 }
 
@@ -503,7 +503,7 @@ struct ir3_instruction * ir3_instr_clone(struct ir3_instruction *instr)
 	unsigned i;
 
 	*new_instr = *instr;
-	insert_instr(instr->shader, new_instr);
+	ir3_instr_insert(instr->shader, new_instr);
 
 	/* clone registers: */
 	new_instr->regs_count = 0;
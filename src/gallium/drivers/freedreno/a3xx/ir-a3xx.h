@@ -182,6 +182,7 @@ void * ir3_shader_assemble(struct ir3_shader *shader,
 
 struct ir3_instruction * ir3_instr_create(struct ir3_shader *shader, int category, opc_t opc);
 struct ir3_instruction * ir3_instr_clone(struct ir3_instruction *instr);
+void ir3_instr_insert(struct ir3_shader *shader, struct ir3_instruction *instr);
 
 struct ir3_register * ir3_reg_create(struct ir3_instruction *instr,
 		int num, int flags);
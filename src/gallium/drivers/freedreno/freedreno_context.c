@@ -38,13 +38,16 @@ static void
 fd_context_next_rb(struct pipe_context *pctx)
 {
 	struct fd_context *ctx = fd_context(pctx);
-	struct fd_ringbuffer *ring;
+	struct fd_ringbuffer *ring, *binning_ring;
 	uint32_t ts;
 
 	fd_ringmarker_del(ctx->draw_start);
 	fd_ringmarker_del(ctx->draw_end);
+	fd_ringmarker_del(ctx->binning_start);
+	fd_ringmarker_del(ctx->binning_end);
 
 	/* grab next ringbuffer: */
+	binning_ring = ctx->binning_rings[ctx->rings_idx % ARRAY_SIZE(ctx->rings)];
 	ring = ctx->rings[(ctx->rings_idx++) % ARRAY_SIZE(ctx->rings)];
 
 	/* wait for new rb to be idle: */
@@ -55,11 +58,16 @@ fd_context_next_rb(struct pipe_context *pctx)
 	}
 
 	fd_ringbuffer_reset(ring);
+	fd_ringbuffer_reset(binning_ring);
 
 	ctx->draw_start = fd_ringmarker_new(ring);
 	ctx->draw_end = fd_ringmarker_new(ring);
 
+	ctx->binning_start = fd_ringmarker_new(binning_ring);
+	ctx->binning_end = fd_ringmarker_new(binning_ring);
+
 	ctx->ring = ring;
+	ctx->binning_ring = binning_ring;
 }
 
 /* emit accumulated render cmds, needed for example if render target has
@@ -83,7 +91,9 @@ fd_context_render(struct pipe_context *pctx)
 	/* if size in dwords is more than half the buffer size, then wait and
 	 * wrap around:
 	 */
-	if ((ctx->ring->cur - ctx->ring->start) > ctx->ring->size/8)
+	if (((ctx->ring->cur - ctx->ring->start) > ctx->ring->size/8) ||
+			((ctx->binning_ring->cur - ctx->binning_ring->start) >
+					ctx->binning_ring->size/8))
 		fd_context_next_rb(pctx);
 
 	ctx->needs_flush = false;
@@ -117,6 +127,7 @@ void
 fd_context_destroy(struct pipe_context *pctx)
 {
 	struct fd_context *ctx = fd_context(pctx);
+	unsigned i;
 
 	DBG("");
 
@@ -125,7 +136,21 @@ fd_context_destroy(struct pipe_context *pctx)
 
 	fd_ringmarker_del(ctx->draw_start);
 	fd_ringmarker_del(ctx->draw_end);
-	fd_ringbuffer_del(ctx->ring);
+	fd_ringmarker_del(ctx->binning_start);
+	fd_ringmarker_del(ctx->binning_end);
+
+	for (i = 0; i < ARRAY_SIZE(ctx->rings); i++) {
+		if (ctx->rings[i])
+			fd_ringbuffer_del(ctx->rings[i]);
+		if (ctx->binning_rings[i])
+			fd_ringbuffer_del(ctx->binning_rings[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ctx->pipe); i++) {
+		struct fd_vsc_pipe *pipe = &ctx->pipe[i];
+		if (pipe->bo)
+			fd_bo_del(pipe->bo);
+	}
 
 	FREE(ctx);
 }
@@ -154,6 +179,9 @@ fd_context_init(struct fd_context *ctx,
 		ctx->rings[i] = fd_ringbuffer_new(screen->pipe, 0x400000);
 		if (!ctx->rings[i])
 			goto fail;
+		ctx->binning_rings[i] = fd_ringbuffer_new(screen->pipe, 0x100000);
+		if (!ctx->binning_rings[i])
+			goto fail;
 	}
 
 	fd_context_next_rb(pctx);
@@ -79,6 +79,21 @@ struct fd_vertex_stateobj {
 	unsigned num_elements;
 };
 
+/* visibility stream pipe, covering a rectangle of bins (in units of
+ * bins).  Each pipe has its own buffer for the visibility stream
+ * written in the binning pass:
+ */
+struct fd_vsc_pipe {
+	struct fd_bo *bo;
+	uint8_t x, y, w, h;      /* VSC_PIPE[p].CONFIG */
+};
+
+struct fd_tile {
+	uint8_t p, n;            /* VSC_PIPE[p], slot [n] within the pipe */
+	uint16_t bin_w, bin_h;   /* clipped at right/bottom edge */
+	uint16_t xoff, yoff;
+};
+
 struct fd_gmem_stateobj {
 	struct pipe_scissor_state scissor;
 	uint cpp;
@@ -149,6 +164,15 @@ struct fd_context {
 	struct fd_ringbuffer *ring;
 	struct fd_ringmarker *draw_start, *draw_end;
 
+	/* the same draw cmds as above, minus the fragment-only state, which
+	 * the binning pass (if used) IB's to in order to build the visibility
+	 * streams.  Cycled together with rings[]:
+	 */
+	struct fd_ringbuffer *binning_rings[4];
+
+	struct fd_ringbuffer *binning_ring;
+	struct fd_ringmarker *binning_start, *binning_end;
+
 	struct pipe_scissor_state scissor;
 
 	/* we don't have a disable/enable bit for scissor, so instead we keep
@@ -167,6 +191,8 @@ struct fd_context {
 	 * if out of date with current maximal-scissor/cpp:
 	 */
 	struct fd_gmem_stateobj gmem;
+	struct fd_vsc_pipe      pipe[8];
+	struct fd_tile          tile[512];
 
 	/* which state objects need to be re-emit'd: */
 	enum {
@@ -212,14 +238,10 @@ struct fd_context {
 
 	/* GMEM/tile handling fxns: */
 	void (*emit_tile_init)(struct fd_context *ctx);
-	void (*emit_tile_prep)(struct fd_context *ctx, uint32_t xoff, uint32_t yoff,
-			uint32_t bin_w, uint32_t bin_h);
-	void (*emit_tile_mem2gmem)(struct fd_context *ctx, uint32_t xoff, uint32_t yoff,
-			uint32_t bin_w, uint32_t bin_h);
-	void (*emit_tile_renderprep)(struct fd_context *ctx, uint32_t xoff, uint32_t yoff,
-			uint32_t bin_w, uint32_t bin_h);
-	void (*emit_tile_gmem2mem)(struct fd_context *ctx, uint32_t xoff, uint32_t yoff,
-			uint32_t bin_w, uint32_t bin_h);
+	void (*emit_tile_prep)(struct fd_context *ctx, struct fd_tile *tile);
+	void (*emit_tile_mem2gmem)(struct fd_context *ctx, struct fd_tile *tile);
+	void (*emit_tile_renderprep)(struct fd_context *ctx, struct fd_tile *tile);
+	void (*emit_tile_gmem2mem)(struct fd_context *ctx, struct fd_tile *tile);
 
 	/* optional, for GMEM bypass: */
 	void (*emit_sysmem_prep)(struct fd_context *ctx);
@@ -64,8 +64,20 @@
  * Where the per-tile section handles scissor setup, mem2gmem restore (if
  * needed), IB to draw cmds earlier in the ringbuffer, and then gmem2mem
  * resolve.
+ *
+ * If the hw supports it (a3xx), the draw cmds are also recorded in a
+ * separate binning ringbuffer, minus the fragment-only state, which is
+ * IB'd to once before the first tile to build a visibility
+ * stream per group of tiles (VSC pipe).  The per-tile IB's to the draw
+ * cmds can then skip the primitives which don't touch the tile.
  */
 
+static uint32_t
+div_round_up(uint32_t v, uint32_t a)
+{
+	return (v + a - 1) / a;
+}
+
 static void
 calculate_tiles(struct fd_context *ctx)
 {
@@ -78,6 +90,8 @@ calculate_tiles(struct fd_context *ctx)
 	uint32_t bin_w, bin_h;
 	uint32_t max_width = 992;
 	uint32_t cpp = 4;
+	uint32_t i, j, t, xoff, yoff;
+	uint32_t tpp_x, tpp_y;
 
 	if (pfb->cbufs[0])
 		cpp = util_format_get_blocksize(pfb->cbufs[0]->format);
@@ -137,44 +151,77 @@ calculate_tiles(struct fd_context *ctx)
 	gmem->nbins_y = nbins_y;
 	gmem->width = width;
 	gmem->height = height;
-}
 
-static void
-render_tiles(struct fd_context *ctx)
-{
-	struct fd_gmem_stateobj *gmem = &ctx->gmem;
-	uint32_t i, yoff = gmem->miny;
+	/* figure out number of tiles per pipe, so that the whole screen
+	 * is covered by the (at most 8) visibility stream pipes:
+	 */
+	tpp_x = tpp_y = 1;
+	while (div_round_up(nbins_y, tpp_y) > ARRAY_SIZE(ctx->pipe))
+		tpp_y += 2;
+	while ((div_round_up(nbins_y, tpp_y) *
+			div_round_up(nbins_x, tpp_x)) > ARRAY_SIZE(ctx->pipe))
+		tpp_x += 1;
+
+	/* configure pipes: */
+	xoff = yoff = 0;
+	for (i = 0; i < ARRAY_SIZE(ctx->pipe); i++) {
+		struct fd_vsc_pipe *pipe = &ctx->pipe[i];
+
+		if (xoff >= nbins_x) {
+			xoff = 0;
+			yoff += tpp_y;
+		}
 
-	ctx->emit_tile_init(ctx);
+		if (yoff >= nbins_y)
+			break;
 
-	for (i = 0; i < gmem->nbins_y; i++) {
-		uint32_t j, xoff = gmem->minx;
-		uint32_t bh = gmem->bin_h;
+		pipe->x = xoff;
+		pipe->y = yoff;
+		pipe->w = MIN2(tpp_x, nbins_x - xoff);
+		pipe->h = MIN2(tpp_y, nbins_y - yoff);
 
-		/* clip bin height: */
-		bh = MIN2(bh, gmem->miny + gmem->height - yoff);
+		xoff += tpp_x;
+	}
 
-		for (j = 0; j < gmem->nbins_x; j++) {
-			uint32_t bw = gmem->bin_w;
+	for (; i < ARRAY_SIZE(ctx->pipe); i++) {
+		struct fd_vsc_pipe *pipe = &ctx->pipe[i];
+		pipe->x = pipe->y = pipe->w = pipe->h = 0;
+	}
 
-			/* clip bin width: */
-			bw = MIN2(bw, gmem->minx + gmem->width - xoff);
+	/* configure tiles: */
+	t = 0;
+	yoff = miny;
+	for (i = 0; i < nbins_y; i++) {
+		uint32_t bw, bh;
+
+		xoff = minx;
+
+		/* clip bin height: */
+		bh = MIN2(bin_h, miny + height - yoff);
 
-			DBG("bin_h=%d, yoff=%d, bin_w=%d, xoff=%d",
-					bh, yoff, bw, xoff);
+		for (j = 0; j < nbins_x; j++) {
+			struct fd_tile *tile;
+			struct fd_vsc_pipe *pipe;
+			uint32_t p;
 
-			ctx->emit_tile_prep(ctx, xoff, yoff, bw, bh);
+			assert(t < ARRAY_SIZE(ctx->tile));
+			tile = &ctx->tile[t];
 
-			if (ctx->restore)
-				ctx->emit_tile_mem2gmem(ctx, xoff, yoff, bw, bh);
+			/* clip bin width: */
+			bw = MIN2(bin_w, minx + width - xoff);
 
-			ctx->emit_tile_renderprep(ctx, xoff, yoff, bw, bh);
+			/* pipe number, and slot within the (possibly clipped) pipe: */
+			p = ((i / tpp_y) * div_round_up(nbins_x, tpp_x)) + (j / tpp_x);
+			pipe = &ctx->pipe[p];
 
-			/* emit IB to drawcmds: */
-			OUT_IB(ctx->ring, ctx->draw_start, ctx->draw_end);
+			tile->p = p;
+			tile->n = ((i - pipe->y) * pipe->w) + (j - pipe->x);
+			tile->bin_w = bw;
+			tile->bin_h = bh;
+			tile->xoff = xoff;
+			tile->yoff = yoff;
 
-			/* emit gmem2mem to transfer tile back to system memory: */
-			ctx->emit_tile_gmem2mem(ctx, xoff, yoff, bw, bh);
+			t++;
 
 			xoff += bw;
 		}
@@ -183,6 +230,35 @@ render_tiles(struct fd_context *ctx)
 	}
 }
 
+static void
+render_tiles(struct fd_context *ctx)
+{
+	struct fd_gmem_stateobj *gmem = &ctx->gmem;
+	uint32_t i;
+
+	ctx->emit_tile_init(ctx);
+
+	for (i = 0; i < (gmem->nbins_x * gmem->nbins_y); i++) {
+		struct fd_tile *tile = &ctx->tile[i];
+
+		DBG("bin_h=%d, yoff=%d, bin_w=%d, xoff=%d",
+				tile->bin_h, tile->yoff, tile->bin_w, tile->xoff);
+
+		ctx->emit_tile_prep(ctx, tile);
+
+		if (ctx->restore)
+			ctx->emit_tile_mem2gmem(ctx, tile);
+
+		ctx->emit_tile_renderprep(ctx, tile);
+
+		/* emit IB to drawcmds: */
+		OUT_IB(ctx->ring, ctx->draw_start, ctx->draw_end);
+
+		/* emit gmem2mem to transfer tile back to system memory: */
+		ctx->emit_tile_gmem2mem(ctx, tile);
+	}
+}
+
 static void
 render_sysmem(struct fd_context *ctx)
 {
@@ -211,6 +287,7 @@ fd_gmem_render_tiles(struct pipe_context *pctx)
 
 	/* mark the end of the clear/draw cmds before emitting per-tile cmds: */
 	fd_ringmarker_mark(ctx->draw_end);
+	fd_ringmarker_mark(ctx->binning_end);
 
 	if (sysmem) {
 		DBG("rendering sysmem (%s/%s)",
@@ -231,6 +308,7 @@ fd_gmem_render_tiles(struct pipe_context *pctx)
 
 	/* mark start for next draw cmds: */
 	fd_ringmarker_mark(ctx->draw_start);
+	fd_ringmarker_mark(ctx->binning_start);
 
 	/* update timestamps on render targets: */
 	timestamp = fd_ringbuffer_timestamp(ctx->ring);
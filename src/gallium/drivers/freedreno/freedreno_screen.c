@@ -63,6 +63,8 @@ static const struct debug_named_value debug_options[] = {
 		{"dscis",     FD_DBG_DSCIS,  "Disable scissor optimization"},
 		{"direct",    FD_DBG_DIRECT, "Force inline (SS_DIRECT) state loads"},
 		{"dbypass",   FD_DBG_DBYPASS,"Disable GMEM bypass"},
+		{"nosched",   FD_DBG_NOSCHED,"Disable a3xx shader instruction reordering"},
+		{"nobin",     FD_DBG_NOBIN,  "Disable a3xx hw binning"},
 		DEBUG_NAMED_VALUE_END
 };
 
@@ -232,6 +234,8 @@ fd_screen_get_param(struct pipe_screen *pscreen, enum pipe_cap param)
 
 	case PIPE_CAP_ENDIANNESS:
 		return PIPE_ENDIAN_LITTLE;
+	case PIPE_CAP_SHAREABLE_STATE_OBJECTS:
+		return 0;
 
 	default:
 		DBG("unknown param %d", param);
@@ -311,7 +315,10 @@ fd_screen_get_shader_param(struct pipe_screen *pscreen, unsigned shader,
 		return 1;
 	case PIPE_SHADER_CAP_SUBROUTINES:
 		return 0;
+	case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
+		return 1;
 	case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
+	case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
 	case PIPE_SHADER_CAP_INTEGERS:
 		return 0;
 	case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
@@ -41,6 +41,13 @@ struct i915_optimize_context
 {
    int first_write[TGSI_EXEC_NUM_TEMPS];
    int last_read[TGSI_EXEC_NUM_TEMPS];
+
+   /* whole program passes */
+   unsigned live[TGSI_EXEC_NUM_TEMPS];
+   int temp_first[TGSI_EXEC_NUM_TEMPS];
+   int temp_last[TGSI_EXEC_NUM_TEMPS];
+   int temp_map[TGSI_EXEC_NUM_TEMPS];
+   int reg_end[TGSI_EXEC_NUM_TEMPS];
 };
 
 static boolean same_src_dst_reg(struct i915_full_src_register *s1, struct i915_full_dst_register *d1)
@@ -79,7 +86,7 @@ const static struct {
    [ TGSI_OPCODE_ABS     ] = { false,  false,                  0,  1,  1 },
    [ TGSI_OPCODE_ADD     ] = { false,   true,  TGSI_SWIZZLE_ZERO,  1,  2 },
    [ TGSI_OPCODE_CEIL    ] = { false,  false,                  0,  1,  1 },
-   [ TGSI_OPCODE_CMP     ] = { false,  false,                  0,  1,  2 },
+   [ TGSI_OPCODE_CMP     ] = { false,  false,                  0,  1,  3 },
    [ TGSI_OPCODE_COS     ] = { false,  false,                  0,  1,  1 },
    [ TGSI_OPCODE_DDX     ] = { false,  false,                  0,  1,  0 },
    [ TGSI_OPCODE_DDY     ] = { false,  false,                  0,  1,  0 },
@@ -272,7 +279,7 @@ static void liveness_mark_written(struct i915_optimize_context *ctx,
       dst_reg_index = dst_reg->Register.Index;
       assert(dst_reg_index < TGSI_EXEC_NUM_TEMPS);
       /* dead -> live transition */
-      if (ctx->first_write[dst_reg_index] != -1)
+      if (ctx->first_write[dst_reg_index] == -1)
          ctx->first_write[dst_reg_index] = pos;
    }
 }
@@ -286,7 +293,7 @@ static void liveness_mark_read(struct i915_optimize_context *ctx,
       src_reg_index = src_reg->Register.Index;
       assert(src_reg_index < TGSI_EXEC_NUM_TEMPS);
       /* live -> dead transition */
-      if (ctx->last_read[src_reg_index] != -1)
+      if (ctx->last_read[src_reg_index] == -1)
          ctx->last_read[src_reg_index] = pos;
    }
 }
@@ -375,8 +382,9 @@ static unsigned i915_tex_mask(union i915_full_token *instr)
    /* Get the number of coords */
    mask = mask_for_unswizzled(i915_num_coords(instr->FullInstruction.Texture.Texture));
 
-   /* Add the W component if projective */
-   if (instr->FullInstruction.Instruction.Opcode == TGSI_OPCODE_TXP)
+   /* Add the W component if projective or biased */
+   if (instr->FullInstruction.Instruction.Opcode == TGSI_OPCODE_TXP ||
+       instr->FullInstruction.Instruction.Opcode == TGSI_OPCODE_TXB)
       mask |= TGSI_WRITEMASK_W;
 
    return mask;
@@ -598,6 +606,594 @@ static void i915_fpc_optimize_useless_mov_after_inst(struct i915_optimize_contex
    }
 }
 
+/*
+ * The passes below work on whole programs rather than on neighbouring
+ * instructions.  The i915 has no flow control, so the instructions are
+ * a single basic block, which keeps the dataflow trivial.
+ */
+
+static boolean is_instruction(union i915_full_token *t)
+{
+   return t->Token.Type == TGSI_TOKEN_TYPE_INSTRUCTION;
+}
+
+static boolean is_temp(unsigned file, int indirect)
+{
+   return file == TGSI_FILE_TEMPORARY && !indirect;
+}
+
+static unsigned get_swizzle(struct i915_full_src_register *r, unsigned chan)
+{
+   switch (chan) {
+   case 0: return r->Register.SwizzleX;
+   case 1: return r->Register.SwizzleY;
+   case 2: return r->Register.SwizzleZ;
+   default: return r->Register.SwizzleW;
+   }
+}
+
+static void set_swizzle(struct i915_full_src_register *r, unsigned chan,
+                        unsigned swz)
+{
+   switch (chan) {
+   case 0: r->Register.SwizzleX = swz; break;
+   case 1: r->Register.SwizzleY = swz; break;
+   case 2: r->Register.SwizzleZ = swz; break;
+   default: r->Register.SwizzleW = swz; break;
+   }
+}
+
+/* Opcodes for which result channel c only depends on channel c of the
+ * sources.
+ */
+static boolean op_is_componentwise(unsigned opcode)
+{
+   switch (opcode) {
+   case TGSI_OPCODE_ABS:
+   case TGSI_OPCODE_ADD:
+   case TGSI_OPCODE_CEIL:
+   case TGSI_OPCODE_CMP:
+   case TGSI_OPCODE_FLR:
+   case TGSI_OPCODE_FRC:
+   case TGSI_OPCODE_LRP:
+   case TGSI_OPCODE_MAD:
+   case TGSI_OPCODE_MAX:
+   case TGSI_OPCODE_MIN:
+   case TGSI_OPCODE_MOV:
+   case TGSI_OPCODE_MUL:
+   case TGSI_OPCODE_SEQ:
+   case TGSI_OPCODE_SGE:
+   case TGSI_OPCODE_SGT:
+   case TGSI_OPCODE_SLE:
+   case TGSI_OPCODE_SLT:
+   case TGSI_OPCODE_SNE:
+   case TGSI_OPCODE_SSG:
+   case TGSI_OPCODE_SUB:
+   case TGSI_OPCODE_TRUNC:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+/* Returns the mask of the source register components read by an operand */
+static unsigned src_read_mask(struct i915_full_instruction *inst, int s)
+{
+   struct i915_full_src_register *src = &inst->Src[s];
+   unsigned lanes = TGSI_WRITEMASK_XYZW;
+   unsigned mask = 0;
+   unsigned c;
+
+   if (op_is_componentwise(inst->Instruction.Opcode))
+      lanes = inst->Dst[0].Register.WriteMask;
+
+   for (c = 0; c < 4; c++) {
+      unsigned swz = get_swizzle(src, c);
+      if ((lanes & (1 << c)) && swz <= TGSI_SWIZZLE_W)
+         mask |= 1 << swz;
+   }
+
+   return mask;
+}
+
+/*
+ * Only straight-line code made of the opcodes in op_table is handled,
+ * anything else is left to the translator to complain about.
+ */
+static boolean program_is_optimizable(struct i915_token_list *tokens)
+{
+   int i, s;
+
+   for (i = 0; i < tokens->NumTokens; i++) {
+      union i915_full_token *current = &tokens->Tokens[i];
+      struct i915_full_instruction *inst = &current->FullInstruction;
+      unsigned opcode;
+
+      if (!is_instruction(current))
+         continue;
+
+      opcode = inst->Instruction.Opcode;
+      if (opcode >= TGSI_OPCODE_LAST)
+         return FALSE;
+
+      if (opcode == TGSI_OPCODE_RET)
+         return FALSE;
+
+      if (!op_num_dst(opcode) && !op_num_src(opcode) &&
+          opcode != TGSI_OPCODE_END &&
+          opcode != TGSI_OPCODE_NOP &&
+          opcode != TGSI_OPCODE_KILL)
+         return FALSE;
+
+      if (op_has_dst(opcode) && inst->Dst[0].Register.Indirect)
+         return FALSE;
+
+      for (s = 0; s < op_num_src(opcode); s++)
+         if (inst->Src[s].Register.Indirect)
+            return FALSE;
+   }
+
+   return TRUE;
+}
+
+/*
+ * Checks whether the composed operand "src" can replace operand s of
+ * inst without making the translator emit more code.
+ */
+static boolean can_propagate_into(struct i915_full_instruction *inst, int s,
+                                  struct i915_full_src_register *src)
+{
+   unsigned opcode = inst->Instruction.Opcode;
+   int k;
+
+   if (op_is_texture(opcode)) {
+      union i915_full_token *t = (union i915_full_token *)inst;
+
+      /* a swizzled/negated coordinate costs a MOV, and a phase */
+      return s == 0 &&
+             (src->Register.File == TGSI_FILE_TEMPORARY ||
+              src->Register.File == TGSI_FILE_INPUT) &&
+             !src->Register.Negate && !src->Register.Absolute &&
+             target_is_texture2d(inst->Texture.Texture) &&
+             is_unswizzled(src, i915_tex_mask(t));
+   }
+
+   /* the hw can only read one constant per instruction, don't make the
+    * translator copy one into a temp
+    */
+   if (src->Register.File == TGSI_FILE_CONSTANT ||
+       src->Register.File == TGSI_FILE_IMMEDIATE) {
+      for (k = 0; k < op_num_src(opcode); k++) {
+         struct i915_full_src_register *other = &inst->Src[k];
+
+         if (k == s)
+            continue;
+
+         if ((other->Register.File == TGSI_FILE_CONSTANT ||
+              other->Register.File == TGSI_FILE_IMMEDIATE) &&
+             (other->Register.File != src->Register.File ||
+              other->Register.Index != src->Register.Index))
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+/*
+ * Forwards the source of
+ *    MOV TEMP[0].xy, IN[0].yxxx
+ * to the later readers of TEMP[0].x and TEMP[0].y, as long as neither
+ * register is written in between:
+ *    ADD TEMP[1].xy, TEMP[0].yxxx, CONST[0]
+ * becomes:
+ *    ADD TEMP[1].xy, IN[0].xyyy, CONST[0]
+ * The MOV is then removed by dead code elimination if it has no reads
+ * left.
+ */
+static void i915_fpc_copy_propagate(struct i915_token_list *tokens)
+{
+   int i, j, s;
+
+   for (i = 0; i < tokens->NumTokens; i++) {
+      union i915_full_token *current = &tokens->Tokens[i];
+      struct i915_full_instruction *mov = &current->FullInstruction;
+      struct i915_full_dst_register *dst = &mov->Dst[0];
+      struct i915_full_src_register *src = &mov->Src[0];
+
+      if (!is_instruction(current) ||
+          mov->Instruction.Opcode != TGSI_OPCODE_MOV ||
+          mov->Instruction.Saturate != TGSI_SAT_NONE ||
+          !is_temp(dst->Register.File, dst->Register.Indirect) ||
+          src->Register.Absolute ||
+          same_src_dst_reg(src, dst))
+         continue;
+
+      switch (src->Register.File) {
+      case TGSI_FILE_TEMPORARY:
+      case TGSI_FILE_INPUT:
+      case TGSI_FILE_CONSTANT:
+      case TGSI_FILE_IMMEDIATE:
+         break;
+      default:
+         continue;
+      }
+
+      for (j = i + 1; j < tokens->NumTokens; j++) {
+         union i915_full_token *next = &tokens->Tokens[j];
+         struct i915_full_instruction *inst = &next->FullInstruction;
+         unsigned opcode;
+
+         if (!is_instruction(next))
+            continue;
+
+         opcode = inst->Instruction.Opcode;
+
+         for (s = 0; s < op_num_src(opcode); s++) {
+            struct i915_full_src_register *use = &inst->Src[s];
+            struct i915_full_src_register composed;
+            boolean has_const_swizzle = FALSE;
+            unsigned c;
+
+            if (!same_src_dst_reg(use, dst))
+               continue;
+
+            if (src_read_mask(inst, s) & ~dst->Register.WriteMask)
+               continue;
+
+            composed = *src;
+            for (c = 0; c < 4; c++) {
+               unsigned swz = get_swizzle(use, c);
+
+               if (swz <= TGSI_SWIZZLE_W) {
+                  set_swizzle(&composed, c, get_swizzle(src, swz));
+               } else {
+                  set_swizzle(&composed, c, swz);
+                  has_const_swizzle = TRUE;
+               }
+            }
+
+            /* the negate applies to all channels, including the zero/one
+             * ones which didn't come from the MOV source
+             */
+            if (src->Register.Negate && has_const_swizzle)
+               continue;
+
+            composed.Register.Absolute = use->Register.Absolute;
+            if (use->Register.Absolute)
+               composed.Register.Negate = use->Register.Negate;
+            else
+               composed.Register.Negate = use->Register.Negate ^
+                                          src->Register.Negate;
+
+            if (!can_propagate_into(inst, s, &composed))
+               continue;
+
+            *use = composed;
+         }
+
+         if (op_has_dst(opcode)) {
+            struct i915_full_dst_register *d = &inst->Dst[0];
+
+            if (same_dst_reg(d, dst) &&
+                (d->Register.WriteMask & dst->Register.WriteMask))
+               break;
+
+            if (d->Register.File == src->Register.File &&
+                d->Register.Index == src->Register.Index)
+               break;
+         }
+      }
+   }
+}
+
+/*
+ * Removes the instructions whose results are never read, and drops the
+ * unread channels from the write masks of the others.  Texture
+ * instructions keep their write mask, since a partial one costs the
+ * translator an extra MOV.
+ */
+static void i915_fpc_dead_code(struct i915_optimize_context *ctx,
+                               struct i915_token_list *tokens)
+{
+   unsigned *live = ctx->live;
+   int i, s;
+
+   memset(ctx->live, 0, sizeof(ctx->live));
+
+   for (i = tokens->NumTokens - 1; i >= 0; i--) {
+      union i915_full_token *current = &tokens->Tokens[i];
+      struct i915_full_instruction *inst = &current->FullInstruction;
+      unsigned opcode;
+
+      if (!is_instruction(current))
+         continue;
+
+      opcode = inst->Instruction.Opcode;
+
+      if (op_has_dst(opcode) &&
+          inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY) {
+         struct i915_full_dst_register *dst = &inst->Dst[0];
+         int index = dst->Register.Index;
+         unsigned mask;
+
+         assert(index < TGSI_EXEC_NUM_TEMPS);
+         mask = dst->Register.WriteMask & live[index];
+
+         if (!mask) {
+            inst->Instruction.Opcode = TGSI_OPCODE_NOP;
+            continue;
+         }
+
+         if (!op_is_texture(opcode))
+            dst->Register.WriteMask = mask;
+
+         live[index] &= ~dst->Register.WriteMask;
+      }
+
+      for (s = 0; s < op_num_src(opcode); s++) {
+         struct i915_full_src_register *src = &inst->Src[s];
+
+         if (src->Register.File == TGSI_FILE_TEMPORARY) {
+            assert(src->Register.Index < TGSI_EXEC_NUM_TEMPS);
+            live[src->Register.Index] |= src_read_mask(inst, s);
+         }
+      }
+   }
+}
+
+static boolean reads_reg(struct i915_full_instruction *inst,
+                         unsigned file, int index)
+{
+   int s;
+
+   for (s = 0; s < op_num_src(inst->Instruction.Opcode); s++)
+      if (inst->Src[s].Register.File == file &&
+          inst->Src[s].Register.Index == index)
+         return TRUE;
+
+   return FALSE;
+}
+
+static boolean writes_reg(struct i915_full_instruction *inst,
+                          unsigned file, int index)
+{
+   return op_has_dst(inst->Instruction.Opcode) &&
+          inst->Dst[0].Register.File == file &&
+          inst->Dst[0].Register.Index == index;
+}
+
+/* Can the texture instruction tex be moved before instruction prev? */
+static boolean tex_can_pass(struct i915_full_instruction *tex,
+                            struct i915_full_instruction *prev)
+{
+   struct i915_full_dst_register *dst = &tex->Dst[0];
+   struct i915_full_src_register *coord = &tex->Src[0];
+
+   switch (prev->Instruction.Opcode) {
+   case TGSI_OPCODE_NOP:
+      return TRUE;
+   case TGSI_OPCODE_END:
+   case TGSI_OPCODE_RET:
+      return FALSE;
+   }
+
+   return !writes_reg(prev, coord->Register.File, coord->Register.Index) &&
+          !writes_reg(prev, dst->Register.File, dst->Register.Index) &&
+          !reads_reg(prev, dst->Register.File, dst->Register.Index);
+}
+
+/*
+ * The i915 executes a program in up to four phases, and a texture
+ * sample whose coordinate was computed in the current phase starts a
+ * new one (see i915_emit_texld()).  Hoist each texture instruction up
+ * to the instruction producing its coordinate, so that the independent
+ * samples end up in the same phase instead of being interleaved with
+ * the ALU instructions that follow them in the source.
+ *
+ * Samples written straight to an output start a phase anyway, and are
+ * left in place.
+ */
+static void i915_fpc_schedule_textures(struct i915_token_list *tokens)
+{
+   int i, j;
+
+   for (i = 0; i < tokens->NumTokens; i++) {
+      union i915_full_token *current = &tokens->Tokens[i];
+      struct i915_full_instruction *inst = &current->FullInstruction;
+
+      if (!is_instruction(current) ||
+          !op_is_texture(inst->Instruction.Opcode) ||
+          inst->Dst[0].Register.File != TGSI_FILE_TEMPORARY)
+         continue;
+
+      for (j = i; j > 0; j--) {
+         union i915_full_token tmp;
+
+         if (!is_instruction(&tokens->Tokens[j - 1]) ||
+             !tex_can_pass(&tokens->Tokens[j].FullInstruction,
+                           &tokens->Tokens[j - 1].FullInstruction))
+            break;
+
+         tmp = tokens->Tokens[j - 1];
+         tokens->Tokens[j - 1] = tokens->Tokens[j];
+         tokens->Tokens[j] = tmp;
+      }
+   }
+}
+
+static void temp_range_add(struct i915_optimize_context *ctx, int t, int i)
+{
+   assert(t < TGSI_EXEC_NUM_TEMPS);
+   if (ctx->temp_first[t] == -1)
+      ctx->temp_first[t] = i;
+   ctx->temp_last[t] = i;
+}
+
+/* Gives temp t a register, the first one free at instruction i */
+static void temp_assign(struct i915_optimize_context *ctx, int t, int i,
+                        int *num_regs)
+{
+   int r;
+
+   if (ctx->temp_first[t] != i || ctx->temp_map[t] != -1)
+      return;
+
+   for (r = 0; r < *num_regs; r++)
+      if (ctx->reg_end[r] < i)
+         break;
+
+   if (r == *num_regs)
+      (*num_regs)++;
+
+   ctx->temp_map[t] = r;
+   ctx->reg_end[r] = ctx->temp_last[t];
+}
+
+/*
+ * Computes in ctx->temp_map a mapping of the temps to as few registers
+ * as possible, sharing a register between temps whose live ranges don't
+ * overlap.  Returns the number of registers needed.
+ */
+static int compute_temp_map(struct i915_optimize_context *ctx,
+                            struct i915_token_list *tokens)
+{
+   int num_regs = 0;
+   int i, s, t;
+
+   for (t = 0; t < TGSI_EXEC_NUM_TEMPS; t++) {
+      ctx->temp_first[t] = -1;
+      ctx->temp_last[t] = -1;
+      ctx->temp_map[t] = -1;
+   }
+
+   for (i = 0; i < tokens->NumTokens; i++) {
+      union i915_full_token *current = &tokens->Tokens[i];
+      struct i915_full_instruction *inst = &current->FullInstruction;
+      unsigned opcode;
+
+      if (!is_instruction(current))
+         continue;
+
+      opcode = inst->Instruction.Opcode;
+
+      for (s = 0; s < op_num_src(opcode); s++)
+         if (inst->Src[s].Register.File == TGSI_FILE_TEMPORARY)
+            temp_range_add(ctx, inst->Src[s].Register.Index, i);
+
+      if (op_has_dst(opcode) &&
+          inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY)
+         temp_range_add(ctx, inst->Dst[0].Register.Index, i);
+   }
+
+   /* Linear scan, in order of first use.  A register is only reused
+    * after the instruction of the last use, since the translator expands
+    * some opcodes to sequences which write the destination before all
+    * the sources have been read.
+    */
+   for (i = 0; i < tokens->NumTokens; i++) {
+      union i915_full_token *current = &tokens->Tokens[i];
+      struct i915_full_instruction *inst = &current->FullInstruction;
+      unsigned opcode;
+
+      if (!is_instruction(current))
+         continue;
+
+      opcode = inst->Instruction.Opcode;
+
+      for (s = 0; s < op_num_src(opcode); s++)
+         if (inst->Src[s].Register.File == TGSI_FILE_TEMPORARY)
+            temp_assign(ctx, inst->Src[s].Register.Index, i, &num_regs);
+
+      if (op_has_dst(opcode) &&
+          inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY)
+         temp_assign(ctx, inst->Dst[0].Register.Index, i, &num_regs);
+   }
+
+   return num_regs;
+}
+
+/*
+ * Renames the temps according to compute_temp_map(), so that programs
+ * using many short lived temps fit in the 16 hw registers and leave
+ * more of them free for the translator.
+ */
+static void i915_fpc_compact_temps(struct i915_optimize_context *ctx,
+                                   struct i915_token_list *tokens)
+{
+   int *map = ctx->temp_map;
+   boolean declared = FALSE;
+   int num_regs;
+   int i, s, n;
+
+   num_regs = compute_temp_map(ctx, tokens);
+
+   for (i = 0, n = 0; i < tokens->NumTokens; i++) {
+      union i915_full_token *current = &tokens->Tokens[i];
+
+      if (current->Token.Type == TGSI_TOKEN_TYPE_DECLARATION &&
+          current->FullDeclaration.Declaration.File == TGSI_FILE_TEMPORARY) {
+         /* replace the temp declarations by a single one */
+         if (declared || !num_regs)
+            continue;
+
+         current->FullDeclaration.Range.First = 0;
+         current->FullDeclaration.Range.Last = num_regs - 1;
+         declared = TRUE;
+      }
+      else if (is_instruction(current)) {
+         struct i915_full_instruction *inst = &current->FullInstruction;
+         unsigned opcode = inst->Instruction.Opcode;
+
+         for (s = 0; s < op_num_src(opcode); s++)
+            if (inst->Src[s].Register.File == TGSI_FILE_TEMPORARY)
+               inst->Src[s].Register.Index = map[inst->Src[s].Register.Index];
+
+         if (op_has_dst(opcode) &&
+             inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY)
+            inst->Dst[0].Register.Index = map[inst->Dst[0].Register.Index];
+      }
+
+      tokens->Tokens[n++] = *current;
+   }
+
+   tokens->NumTokens = n;
+}
+
+static void i915_fpc_optimize_program(struct i915_optimize_context *ctx,
+                                      struct i915_token_list *tokens)
+{
+   union i915_full_token *unscheduled;
+   int num_regs;
+
+   if (!program_is_optimizable(tokens))
+      return;
+
+   i915_fpc_copy_propagate(tokens);
+   i915_fpc_dead_code(ctx, tokens);
+
+   /* Hoisting the texture instructions makes their results live longer.
+    * Don't do it if that makes the program run out of registers.
+    */
+   unscheduled = MALLOC(sizeof(union i915_full_token) * tokens->NumTokens);
+   if (unscheduled) {
+      memcpy(unscheduled, tokens->Tokens,
+             sizeof(union i915_full_token) * tokens->NumTokens);
+      num_regs = compute_temp_map(ctx, tokens);
+
+      i915_fpc_schedule_textures(tokens);
+
+      if (compute_temp_map(ctx, tokens) >
+          MAX2(num_regs, I915_MAX_TEMPORARY - 1))
+         memcpy(tokens->Tokens, unscheduled,
+                sizeof(union i915_full_token) * tokens->NumTokens);
+
+      FREE(unscheduled);
+   }
+
+   i915_fpc_compact_temps(ctx, tokens);
+}
+
 struct i915_token_list* i915_optimize(const struct tgsi_token *tokens)
 {
    struct i915_token_list *out_tokens = MALLOC(sizeof(struct i915_token_list));
@@ -646,6 +1242,8 @@ struct i915_token_list* i915_optimize(const struct tgsi_token *tokens)
       i++;
    }
 
+   i915_fpc_optimize_program(ctx, out_tokens);
+
    free(ctx);
 
    return out_tokens;
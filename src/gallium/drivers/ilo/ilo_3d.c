@@ -402,7 +402,7 @@ draw_vbo(struct ilo_3d *hw3d, const struct ilo_context *ilo,
    }
 
    if (max_len > ilo_cp_space(hw3d->cp)) {
-      ilo_cp_flush(hw3d->cp, "out of space");
+      ilo_cp_flush(hw3d->cp, ILO_CP_FLUSH_OUT_OF_SPACE);
       need_flush = false;
       assert(max_len <= ilo_cp_space(hw3d->cp));
    }
@@ -647,13 +647,12 @@ upload_shaders(struct ilo_3d *hw3d, struct ilo_shader_cache *shc)
       return true;
 
    /*
-    * Allocate a new bo.  When this is a new batch, assume the bo is still in
-    * use by the previous batch and force allocation.
-    *
-    * Does it help to make shader cache upload with unsynchronized mapping,
-    * and remove the check for new batch here?
+    * Allocate a new bo only when the kernels do not fit.  The kernels that
+    * may still be in use by previous batches are not overwritten, and the new
+    * ones are uploaded with an unsynchronized mapping.  Keeping the bo across
+    * batches avoids re-emitting the shader states in the new batch.
     */
-   if (hw3d->kernel.used + upload > hw3d->kernel.size || hw3d->new_batch) {
+   if (hw3d->kernel.used + upload > hw3d->kernel.size) {
       unsigned new_size = (hw3d->kernel.size) ?
          hw3d->kernel.size : (8 * 1024);
 
@@ -782,7 +781,7 @@ ilo_texture_barrier(struct pipe_context *pipe)
 
    /* don't know why */
    if (ilo->dev->gen >= ILO_GEN(7))
-      ilo_cp_flush(hw3d->cp, "texture barrier");
+      ilo_cp_flush(hw3d->cp, ILO_CP_FLUSH_TEXTURE_BARRIER);
 }
 
 static void
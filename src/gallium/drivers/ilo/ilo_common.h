@@ -58,10 +58,12 @@ enum ilo_debug {
    ILO_DEBUG_CS        = 1 << 4,
    ILO_DEBUG_DRAW      = ILO_DEBUG_HOT << 5,
    ILO_DEBUG_FLUSH     = 1 << 6,
+   ILO_DEBUG_KCACHE    = 1 << 7,
 
    /* flags that affect the behaviors of the driver */
    ILO_DEBUG_NOHW      = 1 << 20,
    ILO_DEBUG_NOCACHE   = 1 << 21,
+   ILO_DEBUG_NO16      = 1 << 22,
 };
 
 struct ilo_dev_info {
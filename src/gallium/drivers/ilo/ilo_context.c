@@ -84,8 +84,8 @@ ilo_flush(struct pipe_context *pipe,
       *f = (struct pipe_fence_handle *) fence;
    }
 
-   ilo_cp_flush(ilo->cp,
-         (flags & PIPE_FLUSH_END_OF_FRAME) ? "frame end" : "user request");
+   ilo_cp_flush(ilo->cp, (flags & PIPE_FLUSH_END_OF_FRAME) ?
+         ILO_CP_FLUSH_FRAME_END : ILO_CP_FLUSH_USER_REQUEST);
 }
 
 static void
@@ -33,6 +33,23 @@
 /* the size of the private space */
 static const int ilo_cp_private = 2;
 
+/* the initial and the maximum sizes of the parser buffer, in dwords */
+static const int ilo_cp_min_bo_size = 8192;
+static const int ilo_cp_max_bo_size = 8192 * 8;
+
+static const char *ilo_cp_flush_reasons[ILO_CP_FLUSH_REASON_COUNT] = {
+   [ILO_CP_FLUSH_IMPLICIT]          = "out of space (implicit)",
+   [ILO_CP_FLUSH_RING_SWITCH]       = "ring switch",
+   [ILO_CP_FLUSH_OUT_OF_SPACE]      = "out of space",
+   [ILO_CP_FLUSH_OUT_OF_APERTURE]   = "out of aperture",
+   [ILO_CP_FLUSH_QUERY_SYNC]        = "syncing for queries",
+   [ILO_CP_FLUSH_TRANSFER_SYNC]     = "syncing for transfers",
+   [ILO_CP_FLUSH_PWRITE_SYNC]       = "syncing for pwrites",
+   [ILO_CP_FLUSH_TEXTURE_BARRIER]   = "texture barrier",
+   [ILO_CP_FLUSH_FRAME_END]         = "frame end",
+   [ILO_CP_FLUSH_USER_REQUEST]      = "user request",
+};
+
 /**
  * Dump the contents of the parser bo.  This can only be called in the flush
  * callback.
@@ -147,6 +164,34 @@ ilo_cp_upload_buffer(struct ilo_cp *cp)
    return err;
 }
 
+/**
+ * Double the size of the parser buffer, up to ilo_cp_max_bo_size.  This is
+ * called when a flush happens because the buffer is full, so that
+ * applications with heavy batches flush less often.  The new size takes
+ * effect when the bo is reallocated.
+ */
+static void
+ilo_cp_grow_buffer(struct ilo_cp *cp)
+{
+   const int new_size = cp->bo_size * 2;
+
+   if (new_size > ilo_cp_max_bo_size)
+      return;
+
+   if (cp->sys) {
+      uint32_t *sys;
+
+      sys = REALLOC(cp->sys, cp->bo_size * 4, new_size * 4);
+      if (!sys)
+         return;
+
+      cp->sys = sys;
+      cp->ptr = sys;
+   }
+
+   cp->bo_size = new_size;
+}
+
 /**
  * Reallocate the parser bo.
  */
@@ -220,10 +265,20 @@ ilo_cp_exec_bo(struct ilo_cp *cp)
  * is empty, the callback is not invoked.
  */
 void
-ilo_cp_flush_internal(struct ilo_cp *cp)
+ilo_cp_flush(struct ilo_cp *cp, enum ilo_cp_flush_reason reason)
 {
+   const bool full = (reason == ILO_CP_FLUSH_IMPLICIT ||
+                      reason == ILO_CP_FLUSH_OUT_OF_SPACE);
    int err;
 
+   if (ilo_debug & ILO_DEBUG_FLUSH) {
+      ilo_printf("cp flushed for %s with %d+%d DWords (%.1f%%) because of %s\n",
+            (cp->ring == ILO_CP_RING_RENDER) ? "render" : "blt",
+             cp->used, cp->stolen,
+             (float) (100 * (cp->used + cp->stolen)) / cp->bo_size,
+             ilo_cp_flush_reasons[reason]);
+   }
+
    ilo_cp_set_owner(cp, NULL, 0);
 
    /* sanity check */
@@ -236,6 +291,8 @@ ilo_cp_flush_internal(struct ilo_cp *cp)
       return;
    }
 
+   cp->flush_counts[reason]++;
+
    ilo_cp_end_buffer(cp);
 
    /* upload and execute */
@@ -246,16 +303,39 @@ ilo_cp_flush_internal(struct ilo_cp *cp)
    if (likely(!err && cp->flush_callback))
       cp->flush_callback(cp, cp->flush_callback_data);
 
+   if (full)
+      ilo_cp_grow_buffer(cp);
+
    ilo_cp_clear_buffer(cp);
    ilo_cp_realloc_bo(cp);
 }
 
+/**
+ * Print the flush counters.
+ */
+static void
+ilo_cp_dump_flush_counts(const struct ilo_cp *cp)
+{
+   int i;
+
+   ilo_printf("cp flushes with a %d-DWord buffer:\n", cp->bo_size);
+   for (i = 0; i < ILO_CP_FLUSH_REASON_COUNT; i++) {
+      if (cp->flush_counts[i]) {
+         ilo_printf("  %s: %u\n",
+               ilo_cp_flush_reasons[i], cp->flush_counts[i]);
+      }
+   }
+}
+
 /**
  * Destroy the command parser.
  */
 void
 ilo_cp_destroy(struct ilo_cp *cp)
 {
+   if (ilo_debug & ILO_DEBUG_FLUSH)
+      ilo_cp_dump_flush_counts(cp);
+
    if (cp->bo) {
       if (!cp->sys)
          intel_bo_unmap(cp->bo);
@@ -288,7 +368,7 @@ ilo_cp_create(struct intel_winsys *winsys, bool direct_map)
    cp->ring = ILO_CP_RING_RENDER;
    cp->no_implicit_flush = false;
 
-   cp->bo_size = 8192;
+   cp->bo_size = ilo_cp_min_bo_size;
 
    if (!direct_map) {
       cp->sys = MALLOC(cp->bo_size * 4);
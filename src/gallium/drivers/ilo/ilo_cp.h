@@ -41,6 +41,21 @@ enum ilo_cp_ring {
    ILO_CP_RING_COUNT,
 };
 
+enum ilo_cp_flush_reason {
+   ILO_CP_FLUSH_IMPLICIT,
+   ILO_CP_FLUSH_RING_SWITCH,
+   ILO_CP_FLUSH_OUT_OF_SPACE,
+   ILO_CP_FLUSH_OUT_OF_APERTURE,
+   ILO_CP_FLUSH_QUERY_SYNC,
+   ILO_CP_FLUSH_TRANSFER_SYNC,
+   ILO_CP_FLUSH_PWRITE_SYNC,
+   ILO_CP_FLUSH_TEXTURE_BARRIER,
+   ILO_CP_FLUSH_FRAME_END,
+   ILO_CP_FLUSH_USER_REQUEST,
+
+   ILO_CP_FLUSH_REASON_COUNT,
+};
+
 typedef void (*ilo_cp_callback)(struct ilo_cp *cp, void *data);
 
 struct ilo_cp_owner {
@@ -73,6 +88,9 @@ struct ilo_cp {
    int size, used, stolen;
 
    int cmd_cur, cmd_end;
+
+   /* non-empty flushes by reason */
+   unsigned flush_counts[ILO_CP_FLUSH_REASON_COUNT];
 };
 
 /**
@@ -91,21 +109,7 @@ void
 ilo_cp_destroy(struct ilo_cp *cp);
 
 void
-ilo_cp_flush_internal(struct ilo_cp *cp);
-
-static inline void
-ilo_cp_flush(struct ilo_cp *cp, const char *reason)
-{
-   if (ilo_debug & ILO_DEBUG_FLUSH) {
-      ilo_printf("cp flushed for %s with %d+%d DWords (%.1f%%) because of %s\n",
-            (cp->ring == ILO_CP_RING_RENDER) ? "render" : "blt",
-             cp->used, cp->stolen,
-             (float) (100 * (cp->used + cp->stolen)) / cp->bo_size,
-             reason);
-   }
-
-   ilo_cp_flush_internal(cp);
-}
+ilo_cp_flush(struct ilo_cp *cp, enum ilo_cp_flush_reason reason);
 
 void
 ilo_cp_dump(struct ilo_cp *cp);
@@ -138,7 +142,7 @@ ilo_cp_space(struct ilo_cp *cp)
  * Internal function called by functions that flush implicitly.
  */
 static inline void
-ilo_cp_implicit_flush(struct ilo_cp *cp)
+ilo_cp_implicit_flush(struct ilo_cp *cp, enum ilo_cp_flush_reason reason)
 {
    if (cp->no_implicit_flush) {
       assert(!"unexpected command parser flush");
@@ -146,7 +150,7 @@ ilo_cp_implicit_flush(struct ilo_cp *cp)
       cp->used = 0;
    }
 
-   ilo_cp_flush(cp, "out of space (implicit)");
+   ilo_cp_flush(cp, reason);
 }
 
 /**
@@ -156,7 +160,7 @@ static inline void
 ilo_cp_set_ring(struct ilo_cp *cp, enum ilo_cp_ring ring)
 {
    if (cp->ring != ring) {
-      ilo_cp_implicit_flush(cp);
+      ilo_cp_implicit_flush(cp, ILO_CP_FLUSH_RING_SWITCH);
       cp->ring = ring;
    }
 }
@@ -223,7 +227,7 @@ ilo_cp_set_owner(struct ilo_cp *cp, const struct ilo_cp_owner *owner,
       const int extra = reserve - cp->owner_reserve;
 
       if (cp->used > cp->size - extra) {
-         ilo_cp_implicit_flush(cp);
+         ilo_cp_implicit_flush(cp, ILO_CP_FLUSH_IMPLICIT);
          assert(cp->used <= cp->size - reserve);
 
          cp->size -= reserve;
@@ -248,7 +252,7 @@ static inline void
 ilo_cp_begin(struct ilo_cp *cp, int cmd_size)
 {
    if (cp->used + cmd_size > cp->size) {
-      ilo_cp_implicit_flush(cp);
+      ilo_cp_implicit_flush(cp, ILO_CP_FLUSH_IMPLICIT);
       assert(cp->used + cmd_size <= cp->size);
    }
 
@@ -280,7 +284,7 @@ ilo_cp_steal(struct ilo_cp *cp, const char *desc,
 
    /* flush if there is not enough space after stealing */
    if (cp->used > cp->size - steal) {
-      ilo_cp_implicit_flush(cp);
+      ilo_cp_implicit_flush(cp, ILO_CP_FLUSH_IMPLICIT);
 
       pad = (cp->bo_size - cp->stolen - data_size) % align;
       steal = data_size + steal;
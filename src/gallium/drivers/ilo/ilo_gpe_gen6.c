@@ -854,12 +854,14 @@ ilo_gpe_init_fs_cso_gen6(const struct ilo_dev_info *dev,
                          const struct ilo_shader_state *fs,
                          struct ilo_shader_cso *cso)
 {
-   int start_grf, input_count, interps, max_threads;
+   int start_grf, start_grf_16, input_count, interps, max_threads;
    uint32_t dw2, dw4, dw5, dw6;
 
    ILO_GPE_VALID_GEN(dev, 6, 6);
 
    start_grf = ilo_shader_get_kernel_param(fs, ILO_KERNEL_URB_DATA_START_REG);
+   start_grf_16 = ilo_shader_get_kernel_param(fs,
+         ILO_KERNEL_FS_DISPATCH_16_START_REG);
    input_count = ilo_shader_get_kernel_param(fs, ILO_KERNEL_INPUT_COUNT);
    interps = ilo_shader_get_kernel_param(fs,
          ILO_KERNEL_FS_BARYCENTRIC_INTERPOLATIONS);
@@ -869,9 +871,10 @@ ilo_gpe_init_fs_cso_gen6(const struct ilo_dev_info *dev,
 
    dw2 = (true) ? 0 : GEN6_WM_FLOATING_POINT_MODE_ALT;
 
+   /* the SIMD16 kernel is Kernel Start Pointer 2 */
    dw4 = start_grf << GEN6_WM_DISPATCH_START_GRF_SHIFT_0 |
          0 << GEN6_WM_DISPATCH_START_GRF_SHIFT_1 |
-         0 << GEN6_WM_DISPATCH_START_GRF_SHIFT_2;
+         start_grf_16 << GEN6_WM_DISPATCH_START_GRF_SHIFT_2;
 
    dw5 = (max_threads - 1) << GEN6_WM_MAX_THREADS_SHIFT;
 
@@ -930,8 +933,9 @@ ilo_gpe_init_fs_cso_gen6(const struct ilo_dev_info *dev,
    if (true)
       dw5 |= GEN6_WM_DISPATCH_ENABLE;
 
-   assert(!ilo_shader_get_kernel_param(fs, ILO_KERNEL_FS_DISPATCH_16_OFFSET));
    dw5 |= GEN6_WM_8_DISPATCH_ENABLE;
+   if (ilo_shader_get_kernel_param(fs, ILO_KERNEL_FS_DISPATCH_16_OFFSET))
+      dw5 |= GEN6_WM_16_DISPATCH_ENABLE;
 
    dw6 = input_count << GEN6_WM_NUM_SF_OUTPUTS_SHIFT |
          GEN6_WM_POSOFFSET_NONE |
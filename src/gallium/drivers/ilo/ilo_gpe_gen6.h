@@ -1223,6 +1223,7 @@ gen6_emit_3DSTATE_WM(const struct ilo_dev_info *dev,
    const uint8_t cmd_len = 9;
    const int num_samples = 1;
    const struct ilo_shader_cso *fs_cso;
+   uint32_t kernel_offset, kernel_offset_16;
    uint32_t dw2, dw4, dw5, dw6;
 
    ILO_GPE_VALID_GEN(dev, 6, 6);
@@ -1247,6 +1248,12 @@ gen6_emit_3DSTATE_WM(const struct ilo_dev_info *dev,
       return;
    }
 
+   kernel_offset = ilo_shader_get_kernel_offset(fs);
+   kernel_offset_16 = ilo_shader_get_kernel_param(fs,
+         ILO_KERNEL_FS_DISPATCH_16_OFFSET);
+   if (kernel_offset_16)
+      kernel_offset_16 += kernel_offset;
+
    fs_cso = ilo_shader_get_kernel_cso(fs);
    dw2 = fs_cso->payload[0];
    dw4 = fs_cso->payload[1];
@@ -1290,14 +1297,14 @@ gen6_emit_3DSTATE_WM(const struct ilo_dev_info *dev,
 
    ilo_cp_begin(cp, cmd_len);
    ilo_cp_write(cp, cmd | (cmd_len - 2));
-   ilo_cp_write(cp, ilo_shader_get_kernel_offset(fs));
+   ilo_cp_write(cp, kernel_offset);
    ilo_cp_write(cp, dw2);
    ilo_cp_write(cp, 0); /* scratch */
    ilo_cp_write(cp, dw4);
    ilo_cp_write(cp, dw5);
    ilo_cp_write(cp, dw6);
    ilo_cp_write(cp, 0); /* kernel 1 */
-   ilo_cp_write(cp, 0); /* kernel 2 */
+   ilo_cp_write(cp, kernel_offset_16); /* kernel 2 */
    ilo_cp_end(cp);
 }
 
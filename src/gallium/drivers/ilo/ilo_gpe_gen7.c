@@ -131,13 +131,15 @@ ilo_gpe_init_fs_cso_gen7(const struct ilo_dev_info *dev,
                          const struct ilo_shader_state *fs,
                          struct ilo_shader_cso *cso)
 {
-   int start_grf, max_threads;
+   int start_grf, start_grf_16, max_threads;
    uint32_t dw2, dw4, dw5;
    uint32_t wm_interps, wm_dw1;
 
    ILO_GPE_VALID_GEN(dev, 7, 7.5);
 
    start_grf = ilo_shader_get_kernel_param(fs, ILO_KERNEL_URB_DATA_START_REG);
+   start_grf_16 = ilo_shader_get_kernel_param(fs,
+         ILO_KERNEL_FS_DISPATCH_16_START_REG);
 
    dw2 = (true) ? 0 : GEN7_PS_FLOATING_POINT_MODE_ALT;
 
@@ -163,12 +165,14 @@ ilo_gpe_init_fs_cso_gen7(const struct ilo_dev_info *dev,
    if (ilo_shader_get_kernel_param(fs, ILO_KERNEL_INPUT_COUNT))
       dw4 |= GEN7_PS_ATTRIBUTE_ENABLE;
 
-   assert(!ilo_shader_get_kernel_param(fs, ILO_KERNEL_FS_DISPATCH_16_OFFSET));
    dw4 |= GEN7_PS_8_DISPATCH_ENABLE;
+   if (ilo_shader_get_kernel_param(fs, ILO_KERNEL_FS_DISPATCH_16_OFFSET))
+      dw4 |= GEN7_PS_16_DISPATCH_ENABLE;
 
+   /* the SIMD16 kernel is Kernel Start Pointer 2 */
    dw5 = start_grf << GEN7_PS_DISPATCH_START_GRF_SHIFT_0 |
          0 << GEN7_PS_DISPATCH_START_GRF_SHIFT_1 |
-         0 << GEN7_PS_DISPATCH_START_GRF_SHIFT_2;
+         start_grf_16 << GEN7_PS_DISPATCH_START_GRF_SHIFT_2;
 
    /* FS affects 3DSTATE_WM too */
    wm_dw1 = 0;
@@ -624,6 +624,7 @@ gen7_emit_3DSTATE_PS(const struct ilo_dev_info *dev,
    const uint32_t cmd = ILO_GPE_CMD(0x3, 0x0, 0x20);
    const uint8_t cmd_len = 8;
    const struct ilo_shader_cso *cso;
+   uint32_t kernel_offset, kernel_offset_16;
    uint32_t dw2, dw4, dw5;
 
    ILO_GPE_VALID_GEN(dev, 7, 7.5);
@@ -661,6 +662,12 @@ gen7_emit_3DSTATE_PS(const struct ilo_dev_info *dev,
       return;
    }
 
+   kernel_offset = ilo_shader_get_kernel_offset(fs);
+   kernel_offset_16 = ilo_shader_get_kernel_param(fs,
+         ILO_KERNEL_FS_DISPATCH_16_OFFSET);
+   if (kernel_offset_16)
+      kernel_offset_16 += kernel_offset;
+
    cso = ilo_shader_get_kernel_cso(fs);
    dw2 = cso->payload[0];
    dw4 = cso->payload[1];
@@ -673,13 +680,13 @@ gen7_emit_3DSTATE_PS(const struct ilo_dev_info *dev,
 
    ilo_cp_begin(cp, cmd_len);
    ilo_cp_write(cp, cmd | (cmd_len - 2));
-   ilo_cp_write(cp, ilo_shader_get_kernel_offset(fs));
+   ilo_cp_write(cp, kernel_offset);
    ilo_cp_write(cp, dw2);
    ilo_cp_write(cp, 0); /* scratch */
    ilo_cp_write(cp, dw4);
    ilo_cp_write(cp, dw5);
    ilo_cp_write(cp, 0); /* kernel 1 */
-   ilo_cp_write(cp, 0); /* kernel 2 */
+   ilo_cp_write(cp, kernel_offset_16); /* kernel 2 */
    ilo_cp_end(cp);
 }
 
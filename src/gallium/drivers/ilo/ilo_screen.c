@@ -37,6 +37,7 @@
 #include "ilo_resource.h"
 #include "ilo_public.h"
 #include "ilo_screen.h"
+#include "ilo_shader.h"
 
 int ilo_debug;
 
@@ -48,8 +49,10 @@ static const struct debug_named_value ilo_debug_flags[] = {
    { "cs",        ILO_DEBUG_CS,       "Dump compute shaders" },
    { "draw",      ILO_DEBUG_DRAW,     "Show draw information" },
    { "flush",     ILO_DEBUG_FLUSH,    "Show batch buffer flushes" },
+   { "kcache",    ILO_DEBUG_KCACHE,   "Show shader kernel cache statistics" },
    { "nohw",      ILO_DEBUG_NOHW,     "Do not send commands to HW" },
    { "nocache",   ILO_DEBUG_NOCACHE,  "Always invalidate HW caches" },
+   { "no16",      ILO_DEBUG_NO16,     "Do not compile SIMD16 fragment shaders" },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -144,6 +147,7 @@ ilo_get_shader_param(struct pipe_screen *screen, unsigned shader,
    case PIPE_SHADER_CAP_PREFERRED_IR:
       return PIPE_SHADER_IR_TGSI;
    case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
+   case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
       return 1;
 
    default:
@@ -427,6 +431,8 @@ ilo_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return ILO_MAX_VIEWPORTS;
    case PIPE_CAP_ENDIANNESS:
       return PIPE_ENDIAN_LITTLE;
+   case PIPE_CAP_SHAREABLE_STATE_OBJECTS:
+      return 0;
 
    default:
       return 0;
@@ -627,6 +633,8 @@ ilo_screen_destroy(struct pipe_screen *screen)
 {
    struct ilo_screen *is = ilo_screen(screen);
 
+   ilo_kernel_cache_destroy(is->kernel_cache);
+
    /* as it seems, winsys is owned by the screen */
    intel_winsys_destroy(is->winsys);
 
@@ -727,6 +735,12 @@ ilo_screen_create(struct intel_winsys *ws)
       return NULL;
    }
 
+   is->kernel_cache = ilo_kernel_cache_create();
+   if (!is->kernel_cache) {
+      FREE(is);
+      return NULL;
+   }
+
    util_format_s3tc_init();
 
    is->base.destroy = ilo_screen_destroy;
@@ -35,6 +35,7 @@
 
 struct intel_winsys;
 struct intel_bo;
+struct ilo_kernel_cache;
 
 struct ilo_fence {
    struct pipe_reference reference;
@@ -46,6 +47,8 @@ struct ilo_screen {
 
    struct intel_winsys *winsys;
    struct ilo_dev_info dev;
+
+   struct ilo_kernel_cache *kernel_cache;
 };
 
 static inline struct ilo_screen *
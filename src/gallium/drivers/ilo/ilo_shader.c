@@ -25,11 +25,16 @@
  *    Chia-I Wu <olv@lunarg.com>
  */
 
+#include "os/os_thread.h"
 #include "tgsi/tgsi_parse.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_queue.h"
 #include "intel_winsys.h"
 #include "brw_defines.h" /* for SBE setup */
 
 #include "shader/ilo_shader_internal.h"
+#include "ilo_screen.h"
 #include "ilo_state.h"
 #include "ilo_shader.h"
 
@@ -112,24 +117,27 @@ ilo_shader_cache_notify_change(struct ilo_shader_cache *shc,
 static int
 ilo_shader_cache_upload_shader(struct ilo_shader_cache *shc,
                                struct ilo_shader_state *shader,
-                               struct intel_bo *bo, unsigned offset,
-                               bool incremental)
+                               struct intel_bo *bo, void *map,
+                               unsigned offset, bool incremental)
 {
    const unsigned base = offset;
    struct ilo_shader *sh;
 
    LIST_FOR_EACH_ENTRY(sh, &shader->variants, list) {
-      int err;
-
       if (incremental && sh->uploaded)
          continue;
 
       /* kernels must be aligned to 64-byte */
       offset = align(offset, 64);
 
-      err = intel_bo_pwrite(bo, offset, sh->kernel_size, sh->kernel);
-      if (unlikely(err))
-         return -1;
+      if (map) {
+         memcpy((char *) map + offset, sh->kernel, sh->kernel_size);
+      }
+      else {
+         int err = intel_bo_pwrite(bo, offset, sh->kernel_size, sh->kernel);
+         if (unlikely(err))
+            return -1;
+      }
 
       sh->uploaded = true;
       sh->cache_offset = offset;
@@ -191,6 +199,10 @@ ilo_shader_cache_get_upload_size(struct ilo_shader_cache *shc,
 /**
  * Upload managed shaders to the bo.  When incremental is true, only shaders
  * that are changed or added after the last upload are uploaded.
+ *
+ * Incremental uploads write past the kernels that may still be in use by
+ * the GPU, and are done through an unsynchronized mapping so that they do
+ * not wait for the previous batches.
  */
 int
 ilo_shader_cache_upload(struct ilo_shader_cache *shc,
@@ -198,15 +210,20 @@ ilo_shader_cache_upload(struct ilo_shader_cache *shc,
                         bool incremental)
 {
    struct ilo_shader_state *shader, *next;
+   void *map = NULL;
    int size = 0, s;
 
    if (!bo)
       return ilo_shader_cache_get_upload_size(shc, offset, incremental);
 
+   if (incremental && intel_bo_is_busy(bo) &&
+       !intel_bo_map_unsynchronized(bo))
+      map = intel_bo_get_virtual(bo);
+
    if (!incremental) {
       LIST_FOR_EACH_ENTRY(shader, &shc->shaders, list) {
          s = ilo_shader_cache_upload_shader(shc, shader,
-               bo, offset, incremental);
+               bo, map, offset, incremental);
          if (unlikely(s < 0))
             return s;
 
@@ -217,9 +234,12 @@ ilo_shader_cache_upload(struct ilo_shader_cache *shc,
 
    LIST_FOR_EACH_ENTRY_SAFE(shader, next, &shc->changed, list) {
       s = ilo_shader_cache_upload_shader(shc, shader,
-            bo, offset, incremental);
-      if (unlikely(s < 0))
+            bo, map, offset, incremental);
+      if (unlikely(s < 0)) {
+         if (map)
+            intel_bo_unmap(bo);
          return s;
+      }
 
       size += s;
       offset += s;
@@ -228,9 +248,564 @@ ilo_shader_cache_upload(struct ilo_shader_cache *shc,
       list_add(&shader->list, &shc->shaders);
    }
 
+   if (map)
+      intel_bo_unmap(bo);
+
    return size;
 }
 
+/* number of recently selected variants remembered for each program */
+#define ILO_KERNEL_CACHE_RECENT 4
+
+/* evict kernels when they take up more than 2MiB of space */
+#define ILO_KERNEL_CACHE_LIMIT (2 * 1024 * 1024)
+
+/**
+ * A shader program known to the kernel cache.  Shader states created from
+ * the same TGSI tokens, in any context, share the program.
+ */
+struct ilo_kernel_program {
+   unsigned hash;
+   int num_tokens;
+
+   /* tokens are owned by the program */
+   struct ilo_shader_info info;
+
+   /* number of shader states referencing the program */
+   int refcnt;
+
+   /* the most recently selected variants, most recent first */
+   struct ilo_shader_variant recent[ILO_KERNEL_CACHE_RECENT];
+   int num_recent;
+
+   struct list_head kernels;
+   struct list_head list;
+};
+
+/**
+ * A compiled, or being compiled, variant of a program.
+ */
+struct ilo_kernel_entry {
+   struct ilo_kernel_cache *cache;
+   struct ilo_kernel_program *program;
+   struct ilo_shader_variant variant;
+
+   /* NULL until compiled, or when the compilation failed */
+   struct ilo_shader *sh;
+
+   /* compilation in the background */
+   bool pending;
+   int waiters;
+   struct util_queue_fence fence;
+
+   struct list_head list;
+   /* in the LRU list of the cache, once compiled */
+   struct list_head lru;
+};
+
+/**
+ * A screen-wide cache of compiled kernels.  A context always gets copies
+ * of the kernels, and uploads them itself with ilo_shader_cache_upload().
+ */
+struct ilo_kernel_cache {
+   pipe_mutex mutex;
+
+   struct util_hash_table *programs;
+   struct list_head program_list;
+
+   struct list_head lru;
+   int total_size;
+
+   /* NULL when kernels are never compiled in the background */
+   struct util_queue *queue;
+
+   struct {
+      unsigned compiles;
+      unsigned precompiles;
+      unsigned hits;
+      unsigned waits;
+      unsigned evictions;
+      unsigned mispredictions;
+      unsigned mispredictions_cached;
+   } stats;
+};
+
+static unsigned
+ilo_kernel_program_hash(void *key)
+{
+   const struct ilo_kernel_program *prog = key;
+
+   return prog->hash;
+}
+
+static int
+ilo_kernel_program_compare(void *key1, void *key2)
+{
+   const struct ilo_kernel_program *prog1 = key1;
+   const struct ilo_kernel_program *prog2 = key2;
+   const struct pipe_stream_output_info *so1 = &prog1->info.stream_output;
+   const struct pipe_stream_output_info *so2 = &prog2->info.stream_output;
+
+   if (prog1->info.type != prog2->info.type ||
+       prog1->num_tokens != prog2->num_tokens ||
+       so1->num_outputs != so2->num_outputs)
+      return 1;
+
+   if (so1->num_outputs &&
+       (memcmp(so1->stride, so2->stride, sizeof(so1->stride)) ||
+        memcmp(so1->output, so2->output,
+           sizeof(so1->output[0]) * so1->num_outputs)))
+      return 1;
+
+   return memcmp(prog1->info.tokens, prog2->info.tokens,
+         sizeof(prog1->info.tokens[0]) * prog1->num_tokens);
+}
+
+/**
+ * Create a kernel cache.
+ */
+struct ilo_kernel_cache *
+ilo_kernel_cache_create(void)
+{
+   struct ilo_kernel_cache *kc;
+
+   kc = CALLOC_STRUCT(ilo_kernel_cache);
+   if (!kc)
+      return NULL;
+
+   kc->programs = util_hash_table_create(ilo_kernel_program_hash,
+         ilo_kernel_program_compare);
+   if (!kc->programs) {
+      FREE(kc);
+      return NULL;
+   }
+
+   pipe_mutex_init(kc->mutex);
+   list_inithead(&kc->program_list);
+   list_inithead(&kc->lru);
+
+   /* the disassembler is not thread-safe */
+   if (!(ilo_debug & (ILO_DEBUG_VS | ILO_DEBUG_GS |
+                      ILO_DEBUG_FS | ILO_DEBUG_CS)))
+      kc->queue = util_queue_ref_shared();
+
+   return kc;
+}
+
+static void
+ilo_kernel_program_destroy(struct ilo_kernel_cache *kc,
+                           struct ilo_kernel_program *prog)
+{
+   util_hash_table_remove(kc->programs, prog);
+   list_del(&prog->list);
+
+   FREE((struct tgsi_token *) prog->info.tokens);
+   FREE(prog);
+}
+
+static void
+ilo_kernel_entry_destroy(struct ilo_kernel_cache *kc,
+                         struct ilo_kernel_entry *entry)
+{
+   struct ilo_kernel_program *prog = entry->program;
+
+   assert(!entry->waiters);
+
+   /* the worker may still be signalling the fence */
+   util_queue_fence_wait(&entry->fence);
+   util_queue_fence_destroy(&entry->fence);
+
+   if (entry->sh) {
+      list_del(&entry->lru);
+      kc->total_size -= entry->sh->kernel_size;
+      ilo_shader_destroy_kernel(entry->sh);
+   }
+
+   list_del(&entry->list);
+   FREE(entry);
+
+   if (!prog->refcnt && LIST_IS_EMPTY(&prog->kernels))
+      ilo_kernel_program_destroy(kc, prog);
+}
+
+/**
+ * Destroy a kernel cache.  There must be no shader state left.
+ */
+void
+ilo_kernel_cache_destroy(struct ilo_kernel_cache *kc)
+{
+   struct ilo_kernel_program *prog, *next_prog;
+
+   if (ilo_debug & ILO_DEBUG_KCACHE) {
+      ilo_printf("kernel cache: %u compiled on the draw path, "
+            "%u in the background, %u hits (%u waited), %u evicted\n",
+            kc->stats.compiles, kc->stats.precompiles, kc->stats.hits,
+            kc->stats.waits, kc->stats.evictions);
+      ilo_printf("kernel cache: %u mispredicted variants, %u of them "
+            "cached\n", kc->stats.mispredictions,
+            kc->stats.mispredictions_cached);
+   }
+
+   LIST_FOR_EACH_ENTRY_SAFE(prog, next_prog, &kc->program_list, list) {
+      struct ilo_kernel_entry *entry, *next;
+
+      assert(!prog->refcnt);
+
+      LIST_FOR_EACH_ENTRY_SAFE(entry, next, &prog->kernels, list)
+         ilo_kernel_entry_destroy(kc, entry);
+   }
+
+   util_queue_unref_shared(kc->queue);
+   util_hash_table_destroy(kc->programs);
+   pipe_mutex_destroy(kc->mutex);
+
+   FREE(kc);
+}
+
+/**
+ * Get the program of the shader info, adding it to the cache if needed.
+ */
+static struct ilo_kernel_program *
+ilo_kernel_cache_ref_program(struct ilo_kernel_cache *kc,
+                             const struct ilo_shader_info *info)
+{
+   struct ilo_kernel_program key, *prog;
+
+   key.info = *info;
+   key.num_tokens = tgsi_num_tokens(info->tokens);
+   key.hash = util_hash_crc32(info->tokens,
+         sizeof(info->tokens[0]) * key.num_tokens) ^ info->type;
+
+   pipe_mutex_lock(kc->mutex);
+
+   prog = util_hash_table_get(kc->programs, &key);
+   if (!prog) {
+      prog = CALLOC_STRUCT(ilo_kernel_program);
+      if (prog) {
+         prog->hash = key.hash;
+         prog->num_tokens = key.num_tokens;
+         prog->info = *info;
+         prog->info.tokens = tgsi_dup_tokens(info->tokens);
+         list_inithead(&prog->kernels);
+
+         if (!prog->info.tokens ||
+             util_hash_table_set(kc->programs, prog, prog) != PIPE_OK) {
+            FREE((struct tgsi_token *) prog->info.tokens);
+            FREE(prog);
+            prog = NULL;
+         }
+         else {
+            list_add(&prog->list, &kc->program_list);
+         }
+      }
+   }
+
+   if (prog)
+      prog->refcnt++;
+
+   pipe_mutex_unlock(kc->mutex);
+
+   return prog;
+}
+
+static void
+ilo_kernel_cache_unref_program(struct ilo_kernel_cache *kc,
+                               struct ilo_kernel_program *prog)
+{
+   pipe_mutex_lock(kc->mutex);
+
+   assert(prog->refcnt > 0);
+   if (!--prog->refcnt && LIST_IS_EMPTY(&prog->kernels))
+      ilo_kernel_program_destroy(kc, prog);
+
+   pipe_mutex_unlock(kc->mutex);
+}
+
+static struct ilo_kernel_entry *
+ilo_kernel_cache_find(struct ilo_kernel_program *prog,
+                      const struct ilo_shader_variant *variant)
+{
+   struct ilo_kernel_entry *entry;
+
+   LIST_FOR_EACH_ENTRY(entry, &prog->kernels, list) {
+      if (memcmp(&entry->variant, variant, sizeof(*variant)) == 0)
+         return entry;
+   }
+
+   return NULL;
+}
+
+static struct ilo_kernel_entry *
+ilo_kernel_cache_add_entry(struct ilo_kernel_cache *kc,
+                           struct ilo_kernel_program *prog,
+                           const struct ilo_shader_variant *variant)
+{
+   struct ilo_kernel_entry *entry;
+
+   entry = CALLOC_STRUCT(ilo_kernel_entry);
+   if (!entry)
+      return NULL;
+
+   entry->cache = kc;
+   entry->program = prog;
+   entry->variant = *variant;
+   util_queue_fence_init(&entry->fence);
+
+   list_add(&entry->list, &prog->kernels);
+
+   return entry;
+}
+
+/**
+ * Give the compiled kernel to the entry, evicting the least recently used
+ * kernels to make room.
+ */
+static void
+ilo_kernel_cache_set_kernel(struct ilo_kernel_cache *kc,
+                            struct ilo_kernel_entry *entry,
+                            struct ilo_shader *sh)
+{
+   struct ilo_kernel_entry *tmp, *next;
+
+   LIST_FOR_EACH_ENTRY_SAFE_REV(tmp, next, &kc->lru, lru) {
+      if (kc->total_size + sh->kernel_size <= ILO_KERNEL_CACHE_LIMIT)
+         break;
+
+      if (tmp->waiters)
+         continue;
+
+      ilo_kernel_entry_destroy(kc, tmp);
+      kc->stats.evictions++;
+   }
+
+   entry->sh = sh;
+   list_add(&entry->lru, &kc->lru);
+   kc->total_size += sh->kernel_size;
+}
+
+/**
+ * Return a copy of a compiled kernel, that can be added to a shader state.
+ */
+static struct ilo_shader *
+ilo_shader_dup_kernel(const struct ilo_shader *sh)
+{
+   struct ilo_shader *dup;
+
+   dup = MALLOC_STRUCT(ilo_shader);
+   if (!dup)
+      return NULL;
+
+   *dup = *sh;
+
+   dup->kernel = MALLOC(sh->kernel_size);
+   if (!dup->kernel) {
+      FREE(dup);
+      return NULL;
+   }
+   memcpy(dup->kernel, sh->kernel, sh->kernel_size);
+
+   list_inithead(&dup->list);
+   dup->routing_initialized = false;
+   dup->uploaded = false;
+   dup->cache_offset = 0;
+
+   return dup;
+}
+
+static struct ilo_shader *
+ilo_shader_compile_variant(const struct ilo_shader_state *state,
+                           const struct ilo_shader_variant *variant);
+
+static void
+ilo_kernel_cache_compile_job(void *job, unsigned thread_index)
+{
+   struct ilo_kernel_entry *entry = (struct ilo_kernel_entry *) job;
+   struct ilo_kernel_cache *kc = entry->cache;
+   struct ilo_shader_state state;
+   struct ilo_shader *sh;
+
+   /* the program is not modified or destroyed while it has kernels */
+   memset(&state, 0, sizeof(state));
+   state.info = entry->program->info;
+
+   sh = ilo_shader_compile_variant(&state, &entry->variant);
+
+   pipe_mutex_lock(kc->mutex);
+
+   entry->pending = false;
+   if (sh)
+      ilo_kernel_cache_set_kernel(kc, entry, sh);
+
+   pipe_mutex_unlock(kc->mutex);
+}
+
+/**
+ * Compile the recently selected variants of the program, except the most
+ * recent one, in the background.
+ */
+static void
+ilo_kernel_cache_precompile(struct ilo_kernel_cache *kc,
+                            struct ilo_kernel_program *prog)
+{
+   struct ilo_kernel_entry *jobs[ILO_KERNEL_CACHE_RECENT];
+   int num_jobs = 0, i;
+
+   if (!kc->queue)
+      return;
+
+   pipe_mutex_lock(kc->mutex);
+
+   for (i = 1; i < prog->num_recent; i++) {
+      struct ilo_kernel_entry *entry;
+
+      if (ilo_kernel_cache_find(prog, &prog->recent[i]))
+         continue;
+
+      entry = ilo_kernel_cache_add_entry(kc, prog, &prog->recent[i]);
+      if (!entry)
+         break;
+
+      entry->pending = true;
+      jobs[num_jobs++] = entry;
+      kc->stats.precompiles++;
+   }
+
+   pipe_mutex_unlock(kc->mutex);
+
+   /* the job is run right away when the queue is out of memory */
+   for (i = 0; i < num_jobs; i++) {
+      util_queue_add_job(kc->queue, jobs[i], &jobs[i]->fence,
+            ilo_kernel_cache_compile_job, UTIL_QUEUE_PRIORITY_LOW);
+   }
+}
+
+/**
+ * Guess the variant from the recently selected variants of the program.
+ */
+static bool
+ilo_kernel_cache_predict(struct ilo_kernel_cache *kc,
+                         struct ilo_kernel_program *prog,
+                         struct ilo_shader_variant *variant)
+{
+   bool found;
+
+   pipe_mutex_lock(kc->mutex);
+
+   found = (prog->num_recent > 0);
+   if (found)
+      *variant = prog->recent[0];
+
+   pipe_mutex_unlock(kc->mutex);
+
+   return found;
+}
+
+/**
+ * Remember that the variant is selected.  Update the statistics when the
+ * shader state did not have the variant.
+ */
+static void
+ilo_kernel_cache_note_selection(struct ilo_kernel_cache *kc,
+                                struct ilo_kernel_program *prog,
+                                const struct ilo_shader_variant *variant,
+                                bool mispredicted)
+{
+   int i;
+
+   pipe_mutex_lock(kc->mutex);
+
+   for (i = 0; i < prog->num_recent; i++) {
+      if (memcmp(&prog->recent[i], variant, sizeof(*variant)) == 0)
+         break;
+   }
+
+   if (i == prog->num_recent && i < ILO_KERNEL_CACHE_RECENT)
+      prog->num_recent++;
+   if (i == ILO_KERNEL_CACHE_RECENT)
+      i--;
+
+   /* move to front */
+   if (i)
+      memmove(&prog->recent[1], &prog->recent[0], sizeof(*variant) * i);
+   prog->recent[0] = *variant;
+
+   if (mispredicted) {
+      kc->stats.mispredictions++;
+      if (ilo_kernel_cache_find(prog, variant))
+         kc->stats.mispredictions_cached++;
+   }
+
+   pipe_mutex_unlock(kc->mutex);
+}
+
+/**
+ * Get a copy of the kernel of a variant, compiling it on a miss.
+ */
+static struct ilo_shader *
+ilo_kernel_cache_get(struct ilo_kernel_cache *kc,
+                     const struct ilo_shader_state *state,
+                     const struct ilo_shader_variant *variant)
+{
+   struct ilo_kernel_program *prog = state->program;
+   struct ilo_kernel_entry *entry;
+   struct ilo_shader *sh, *dup;
+
+   pipe_mutex_lock(kc->mutex);
+
+   entry = ilo_kernel_cache_find(prog, variant);
+   if (entry && entry->pending) {
+      entry->waiters++;
+      kc->stats.waits++;
+      pipe_mutex_unlock(kc->mutex);
+
+      util_queue_fence_wait(&entry->fence);
+
+      pipe_mutex_lock(kc->mutex);
+      entry->waiters--;
+   }
+
+   if (entry && entry->sh) {
+      list_del(&entry->lru);
+      list_add(&entry->lru, &kc->lru);
+      kc->stats.hits++;
+
+      sh = ilo_shader_dup_kernel(entry->sh);
+      pipe_mutex_unlock(kc->mutex);
+
+      return sh;
+   }
+
+   kc->stats.compiles++;
+   pipe_mutex_unlock(kc->mutex);
+
+   sh = ilo_shader_compile_variant(state, variant);
+   if (!sh)
+      return NULL;
+
+   dup = ilo_shader_dup_kernel(sh);
+   if (!dup)
+      return sh;
+
+   pipe_mutex_lock(kc->mutex);
+
+   /* it may have been added, or failed to compile, in the meantime */
+   entry = ilo_kernel_cache_find(prog, variant);
+   if (!entry)
+      entry = ilo_kernel_cache_add_entry(kc, prog, variant);
+
+   if (entry && !entry->sh && !entry->pending) {
+      ilo_kernel_cache_set_kernel(kc, entry, dup);
+      dup = NULL;
+   }
+
+   pipe_mutex_unlock(kc->mutex);
+
+   if (dup)
+      ilo_shader_destroy_kernel(dup);
+
+   return sh;
+}
+
 /**
  * Initialize a shader variant.
  */
@@ -541,13 +1116,27 @@ ilo_shader_state_create(const struct ilo_context *ilo,
 
    ilo_shader_info_parse_tokens(&state->info);
 
+   if (type != PIPE_SHADER_COMPUTE) {
+      state->kernel_cache = ilo_screen(ilo->base.screen)->kernel_cache;
+      state->program = ilo_kernel_cache_ref_program(state->kernel_cache,
+            &state->info);
+   }
+
    /* guess and compile now */
-   ilo_shader_variant_guess(&variant, &state->info, ilo);
+   if (!state->program ||
+       !ilo_kernel_cache_predict(state->kernel_cache,
+          state->program, &variant))
+      ilo_shader_variant_guess(&variant, &state->info, ilo);
+
    if (!ilo_shader_state_use_variant(state, &variant)) {
       ilo_shader_destroy(state);
       return NULL;
    }
 
+   /* the other variants the program was used with */
+   if (state->program)
+      ilo_kernel_cache_precompile(state->kernel_cache, state->program);
+
    return state;
 }
 
@@ -657,11 +1246,11 @@ copy_so_info(struct ilo_shader *sh,
 }
 
 /**
- * Add a shader variant to the shader state.
+ * Compile a shader variant.
  */
 static struct ilo_shader *
-ilo_shader_state_add_variant(struct ilo_shader_state *state,
-                             const struct ilo_shader_variant *variant)
+ilo_shader_compile_variant(const struct ilo_shader_state *state,
+                           const struct ilo_shader_variant *variant)
 {
    struct ilo_shader *sh;
 
@@ -691,6 +1280,25 @@ ilo_shader_state_add_variant(struct ilo_shader_state *state,
 
    copy_so_info(sh, &state->info.stream_output);
 
+   return sh;
+}
+
+/**
+ * Add a shader variant to the shader state.
+ */
+static struct ilo_shader *
+ilo_shader_state_add_variant(struct ilo_shader_state *state,
+                             const struct ilo_shader_variant *variant)
+{
+   struct ilo_shader *sh;
+
+   if (state->program)
+      sh = ilo_kernel_cache_get(state->kernel_cache, state, variant);
+   else
+      sh = ilo_shader_compile_variant(state, variant);
+   if (!sh)
+      return NULL;
+
    ilo_shader_state_add_shader(state, sh);
 
    return sh;
@@ -823,6 +1431,9 @@ ilo_shader_destroy(struct ilo_shader_state *shader)
    LIST_FOR_EACH_ENTRY_SAFE(sh, next, &shader->variants, list)
       ilo_shader_destroy_kernel(sh);
 
+   if (shader->program)
+      ilo_kernel_cache_unref_program(shader->kernel_cache, shader->program);
+
    FREE((struct tgsi_token *) shader->info.tokens);
    FREE(shader);
 }
@@ -856,6 +1467,12 @@ ilo_shader_select_kernel(struct ilo_shader_state *shader,
       return false;
 
    ilo_shader_variant_init(&variant, &shader->info, ilo);
+
+   if (shader->program) {
+      ilo_kernel_cache_note_selection(shader->kernel_cache, shader->program,
+            &variant, !ilo_shader_state_search_variant(shader, &variant));
+   }
+
    ilo_shader_state_use_variant(shader, &variant);
 
    return (shader->shader != cur);
@@ -1135,7 +1752,10 @@ ilo_shader_get_kernel_param(const struct ilo_shader_state *shader,
       val = kernel->in.barycentric_interpolation_mode;
       break;
    case ILO_KERNEL_FS_DISPATCH_16_OFFSET:
-      val = 0;
+      val = kernel->dispatch_16_offset;
+      break;
+   case ILO_KERNEL_FS_DISPATCH_16_START_REG:
+      val = kernel->dispatch_16_start_grf;
       break;
 
    default:
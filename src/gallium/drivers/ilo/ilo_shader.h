@@ -56,6 +56,7 @@ enum ilo_kernel_param {
    ILO_KERNEL_FS_USE_KILL,
    ILO_KERNEL_FS_BARYCENTRIC_INTERPOLATIONS,
    ILO_KERNEL_FS_DISPATCH_16_OFFSET,
+   ILO_KERNEL_FS_DISPATCH_16_START_REG,
 
    ILO_KERNEL_PARAM_COUNT,
 };
@@ -72,10 +73,18 @@ struct ilo_kernel_routing {
 struct intel_bo;
 struct ilo_context;
 struct ilo_rasterizer_state;
+struct ilo_kernel_cache;
+struct ilo_kernel_program;
 struct ilo_shader_cache;
 struct ilo_shader_state;
 struct ilo_shader_cso;
 
+struct ilo_kernel_cache *
+ilo_kernel_cache_create(void);
+
+void
+ilo_kernel_cache_destroy(struct ilo_kernel_cache *kc);
+
 struct ilo_shader_cache *
 ilo_shader_cache_create(void);
 
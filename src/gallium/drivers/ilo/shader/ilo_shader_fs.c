@@ -1370,7 +1370,9 @@ fs_compile(struct fs_compile_context *fcc)
    toy_compiler_legalize_for_asm(tc);
 
    if (tc->fail) {
-      ilo_err("failed to legalize FS instructions: %s\n", tc->reason);
+      /* SIMD16 is optional and may fail for running out of registers */
+      if (fcc->dispatch_mode == GEN6_WM_8_DISPATCH_ENABLE)
+         ilo_err("failed to legalize FS instructions: %s\n", tc->reason);
       return false;
    }
 
@@ -1741,7 +1743,8 @@ fs_setup_tgsi(struct toy_compiler *tc, const struct tgsi_token *tokens,
 static bool
 fs_setup(struct fs_compile_context *fcc,
          const struct ilo_shader_state *state,
-         const struct ilo_shader_variant *variant)
+         const struct ilo_shader_variant *variant,
+         int dispatch_mode)
 {
    int num_consts;
 
@@ -1755,7 +1758,7 @@ fs_setup(struct fs_compile_context *fcc,
 
    toy_compiler_init(&fcc->tc, state->info.dev);
 
-   fcc->dispatch_mode = GEN6_WM_8_DISPATCH_ENABLE;
+   fcc->dispatch_mode = dispatch_mode;
 
    fcc->tc.templ.access_mode = BRW_ALIGN_1;
    if (fcc->dispatch_mode == GEN6_WM_16_DISPATCH_ENABLE) {
@@ -1835,26 +1838,124 @@ fs_setup(struct fs_compile_context *fcc,
 }
 
 /**
- * Compile the fragment shader.
+ * Return true if the shader can be compiled for SIMD16 dispatch.
  */
-struct ilo_shader *
-ilo_shader_compile_fs(const struct ilo_shader_state *state,
-                      const struct ilo_shader_variant *variant)
+static bool
+fs_can_dispatch_16(struct fs_compile_context *fcc)
+{
+   struct toy_compiler *tc = &fcc->tc;
+   const struct toy_inst *inst;
+
+   /*
+    * Pixel positions, pull constants, and FB write headers are set up for
+    * SIMD8 only.
+    */
+   if (fcc->shader->in.has_pos || fcc->tgsi.uses_kill ||
+       fcc->tgsi.const_indirect || !fcc->shader->skip_cbuf0_upload ||
+       fcc->variant->u.fs.num_cbufs > 1)
+      return false;
+
+   /* there is no SIMD16 control flow, which would need per-half masks */
+   tc_head(tc);
+   while ((inst = tc_next_no_skip(tc)) != NULL) {
+      if (inst->marker)
+         return false;
+
+      switch (inst->opcode) {
+      case BRW_OPCODE_IF:
+      case BRW_OPCODE_BREAK:
+      case BRW_OPCODE_CONTINUE:
+      case TOY_OPCODE_KIL:
+         return false;
+      default:
+         break;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * Compile the fragment shader for the dispatch mode.
+ */
+static struct ilo_shader *
+fs_compile_dispatch(const struct ilo_shader_state *state,
+                    const struct ilo_shader_variant *variant,
+                    int dispatch_mode)
 {
    struct fs_compile_context fcc;
 
-   if (!fs_setup(&fcc, state, variant))
+   if (!fs_setup(&fcc, state, variant, dispatch_mode))
       return NULL;
 
-   fs_write_fb(&fcc);
-
-   if (!fs_compile(&fcc)) {
+   if (dispatch_mode == GEN6_WM_16_DISPATCH_ENABLE &&
+       !fs_can_dispatch_16(&fcc)) {
       FREE(fcc.shader);
       fcc.shader = NULL;
    }
+   else {
+      fs_write_fb(&fcc);
+
+      if (!fs_compile(&fcc)) {
+         FREE(fcc.shader);
+         fcc.shader = NULL;
+      }
+   }
 
    toy_tgsi_cleanup(&fcc.tgsi);
    toy_compiler_cleanup(&fcc.tc);
 
    return fcc.shader;
 }
+
+/**
+ * Append the SIMD16 kernel to the SIMD8 one.
+ */
+static void
+fs_append_dispatch_16(struct ilo_shader *sh, const struct ilo_shader *sh16)
+{
+   const int offset = align(sh->kernel_size, 64);
+   void *kernel;
+
+   kernel = MALLOC(offset + sh16->kernel_size);
+   if (!kernel)
+      return;
+
+   memcpy(kernel, sh->kernel, sh->kernel_size);
+   memset((char *) kernel + sh->kernel_size, 0, offset - sh->kernel_size);
+   memcpy((char *) kernel + offset, sh16->kernel, sh16->kernel_size);
+
+   FREE(sh->kernel);
+   sh->kernel = kernel;
+   sh->kernel_size = offset + sh16->kernel_size;
+
+   sh->dispatch_16 = true;
+   sh->dispatch_16_offset = offset;
+   sh->dispatch_16_start_grf = sh16->in.start_grf;
+}
+
+/**
+ * Compile the fragment shader.
+ *
+ * The SIMD8 kernel is always compiled.  The SIMD16 kernel is compiled
+ * after it when the shader allows, and is dropped when it fails, usually
+ * because of too many live registers.
+ */
+struct ilo_shader *
+ilo_shader_compile_fs(const struct ilo_shader_state *state,
+                      const struct ilo_shader_variant *variant)
+{
+   struct ilo_shader *sh, *sh16;
+
+   sh = fs_compile_dispatch(state, variant, GEN6_WM_8_DISPATCH_ENABLE);
+   if (!sh || (ilo_debug & ILO_DEBUG_NO16))
+      return sh;
+
+   sh16 = fs_compile_dispatch(state, variant, GEN6_WM_16_DISPATCH_ENABLE);
+   if (sh16) {
+      fs_append_dispatch_16(sh, sh16);
+      ilo_shader_destroy_kernel(sh16);
+   }
+
+   return sh;
+}
@@ -109,6 +109,10 @@ struct ilo_shader {
    bool has_kill;
    bool dispatch_16;
 
+   /* the SIMD16 kernel follows the SIMD8 one when dispatch_16 is set */
+   int dispatch_16_offset;
+   int dispatch_16_start_grf;
+
    bool stream_output;
    int svbi_post_inc;
    struct pipe_stream_output_info so_info;
@@ -184,6 +188,10 @@ struct ilo_shader_state {
    /* managed by shader cache */
    struct ilo_shader_cache *cache;
    struct list_head list;
+
+   /* shared with the shader states of other contexts */
+   struct ilo_kernel_cache *kernel_cache;
+   struct ilo_kernel_program *program;
 };
 
 void
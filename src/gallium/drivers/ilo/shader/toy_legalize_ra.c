@@ -43,6 +43,12 @@ struct linear_scan_live_interval {
     */
    bool consecutive;
 
+   /*
+    * the VRF this interval is copied from by the instruction at startpoint,
+    * if any, so that the register can be reused for the copy
+    */
+   int copy_of;
+
    int reg;
 
    struct list_head list;
@@ -53,8 +59,12 @@ struct linear_scan_live_interval {
  */
 struct linear_scan {
    struct linear_scan_live_interval *intervals;
+   struct linear_scan_live_interval **vrf_intervals;
    int max_vrf, num_vrfs;
 
+   /* there is no spilling support */
+   bool failed;
+
    int num_regs;
 
    struct list_head active_list;
@@ -212,7 +222,8 @@ linear_scan_spill(struct linear_scan *ls,
                   struct linear_scan_live_interval *interval,
                   bool is_active)
 {
-   assert(!"no spilling support");
+   /* no spilling support and the allocation fails */
+   ls->failed = true;
 }
 
 /**
@@ -230,6 +241,29 @@ linear_scan_spill_range(struct linear_scan *ls, int first, int count)
    }
 }
 
+/**
+ * Take the register of the interval the given interval is copied from, if
+ * that interval ends at the copy.  The copy becomes a self-move and is
+ * removed after the allocation.
+ */
+static int
+linear_scan_coalesce(struct linear_scan *ls,
+                     struct linear_scan_live_interval *interval)
+{
+   struct linear_scan_live_interval *src;
+
+   if (!interval->copy_of || interval->copy_of > ls->max_vrf)
+      return -1;
+
+   src = ls->vrf_intervals[interval->copy_of];
+   if (!src || src->endpoint != interval->startpoint || src->reg < 0)
+      return -1;
+
+   linear_scan_remove_active(ls, src);
+
+   return src->reg;
+}
+
 /**
  * Perform linear scan to allocate registers for the intervals.
  */
@@ -238,6 +272,9 @@ linear_scan_run(struct linear_scan *ls)
 {
    int i;
 
+   for (i = 0; i < ls->num_vrfs; i++)
+      ls->intervals[i].reg = -1;
+
    i = 0;
    while (i < ls->num_vrfs) {
       struct linear_scan_live_interval *first = &ls->intervals[i];
@@ -256,7 +293,9 @@ linear_scan_run(struct linear_scan *ls)
             break;
       }
 
-      reg = linear_scan_allocate_regs(ls, count);
+      reg = (count == 1) ? linear_scan_coalesce(ls, first) : -1;
+      if (reg < 0)
+         reg = linear_scan_allocate_regs(ls, count);
 
       /* expire intervals that are no longer active and try again */
       if (reg < 0) {
@@ -280,10 +319,8 @@ linear_scan_run(struct linear_scan *ls)
          /* make some room for the new interval */
          linear_scan_spill(ls, last_active, true);
          reg = linear_scan_allocate_regs(ls, count);
-         if (reg < 0) {
-            assert(!"failed to spill any register");
+         if (reg < 0)
             return false;
-         }
       }
 
       while (count--) {
@@ -302,7 +339,7 @@ linear_scan_run(struct linear_scan *ls)
       }
    }
 
-   return true;
+   return !ls->failed;
 }
 
 /**
@@ -322,6 +359,32 @@ linear_scan_add_live_interval(struct linear_scan *ls, int vrf, int pc)
       ls->max_vrf = vrf;
 }
 
+/**
+ * Return true if the instruction is a plain copy of a whole VRF to another
+ * VRF.
+ */
+static bool
+is_coalescable_copy(const struct toy_inst *inst)
+{
+   const struct toy_dst dst = inst->dst;
+   const struct toy_src src = inst->src[0];
+
+   if (inst->opcode != BRW_OPCODE_MOV || inst->saturate ||
+       inst->pred_ctrl != BRW_PREDICATE_NONE ||
+       inst->cond_modifier != BRW_CONDITIONAL_NONE || inst->acc_wr_ctrl)
+      return false;
+
+   if (dst.file != TOY_FILE_VRF || src.file != TOY_FILE_VRF ||
+       dst.indirect || src.indirect ||
+       dst.rect != TOY_RECT_LINEAR || src.rect != TOY_RECT_LINEAR ||
+       dst.type != src.type ||
+       dst.writemask != TOY_WRITEMASK_XYZW ||
+       src.absolute || src.negate || tsrc_is_swizzled(src))
+      return false;
+
+   return (dst.val32 % TOY_REG_WIDTH == 0 && src.val32 % TOY_REG_WIDTH == 0);
+}
+
 /**
  * Perform (oversimplified?) live variable analysis.
  */
@@ -420,6 +483,14 @@ linear_scan_init_live_intervals(struct linear_scan *ls,
          ls->intervals[vrf].endpoint = endpoint;
       }
 
+      /* remember the copy when it defines the destination */
+      if (is_coalescable_copy(inst)) {
+         vrf = inst->dst.val32 / TOY_REG_WIDTH;
+
+         if (ls->intervals[vrf].startpoint == pc)
+            ls->intervals[vrf].copy_of = inst->src[0].val32 / TOY_REG_WIDTH;
+      }
+
       pc++;
    }
 }
@@ -430,6 +501,7 @@ linear_scan_init_live_intervals(struct linear_scan *ls,
 static void
 linear_scan_cleanup(struct linear_scan *ls)
 {
+   FREE(ls->vrf_intervals);
    FREE(ls->vrf_mapping);
    FREE(ls->intervals);
    FREE(ls->free_regs);
@@ -493,12 +565,18 @@ linear_scan_init(struct linear_scan *ls, int num_regs,
    list_inithead(&ls->active_list);
 
    ls->vrf_mapping = CALLOC(ls->max_vrf + 1, sizeof(*ls->vrf_mapping));
-   if (!ls->vrf_mapping) {
+   ls->vrf_intervals = CALLOC(ls->max_vrf + 1, sizeof(*ls->vrf_intervals));
+   if (!ls->vrf_mapping || !ls->vrf_intervals) {
+      FREE(ls->vrf_intervals);
+      FREE(ls->vrf_mapping);
       FREE(ls->intervals);
       FREE(ls->free_regs);
       return false;
    }
 
+   for (i = 0; i < ls->num_vrfs; i++)
+      ls->vrf_intervals[ls->intervals[i].vrf] = &ls->intervals[i];
+
    return true;
 }
 
@@ -519,12 +597,13 @@ linear_scan_allocation(struct toy_compiler *tc,
 
    if (!linear_scan_run(&ls)) {
       tc_fail(tc, "failed to allocate registers");
+      linear_scan_cleanup(&ls);
       return;
    }
 
-
    tc_head(tc);
    while ((inst = tc_next(tc)) != NULL) {
+      const bool copy = is_coalescable_copy(inst);
       int i;
 
       if (inst->dst.file == TOY_FILE_VRF) {
@@ -555,6 +634,10 @@ linear_scan_allocation(struct toy_compiler *tc,
          inst->src[i].file = TOY_FILE_GRF;
          inst->src[i].val32 = reg * TOY_REG_WIDTH + subreg;
       }
+
+      /* coalesced */
+      if (copy && inst->dst.val32 == inst->src[0].val32)
+         tc_discard_inst(tc, inst);
    }
 
    linear_scan_cleanup(&ls);
@@ -613,6 +696,156 @@ trivial_allocation(struct toy_compiler *tc,
       tc_fail(tc, "failed to allocate registers");
 }
 
+/**
+ * Return the number of VRFs written by the instruction.
+ */
+static int
+get_num_dst_vrfs(const struct toy_inst *inst)
+{
+   int num_dst = 1;
+
+   /* see linear_scan_init_live_intervals() */
+   if (inst->opcode == BRW_OPCODE_SEND || inst->opcode == BRW_OPCODE_SENDC) {
+      const uint32_t mdesc = inst->src[1].val32;
+
+      num_dst = (mdesc >> 20) & 0x1f;
+      if (num_dst > 1 && inst->exec_size == BRW_EXECUTE_16)
+         num_dst /= 2;
+   }
+
+   return num_dst;
+}
+
+/**
+ * Return true if the instruction overwrites all channels of its VRF
+ * destination, unconditionally.
+ */
+static bool
+is_complete_write(const struct toy_inst *inst, int num_grf_per_vrf)
+{
+   const struct toy_dst dst = inst->dst;
+   const int exec_size = 1 << inst->exec_size;
+
+   if (inst->pred_ctrl != BRW_PREDICATE_NONE ||
+       dst.indirect || dst.rect != TOY_RECT_LINEAR ||
+       dst.writemask != TOY_WRITEMASK_XYZW ||
+       dst.val32 % TOY_REG_WIDTH)
+      return false;
+
+   return (exec_size * toy_type_size(dst.type) ==
+           TOY_REG_WIDTH * num_grf_per_vrf);
+}
+
+/**
+ * Split the live ranges of VRFs at their complete redefinitions outside of
+ * control flow, by renaming each redefinition and its uses to a new VRF.
+ * TGSI temporaries are often reused for unrelated values, and this keeps
+ * them from being live from their first definition to their last use.
+ */
+static void
+split_live_ranges(struct toy_compiler *tc, int num_grf_per_vrf)
+{
+   const int num_vrfs = tc->next_vrf;
+   struct toy_inst *inst;
+   int *names;
+   unsigned char *flags;
+   int depth, i;
+
+   enum {
+      VRF_DEFINED = 1 << 0,
+      VRF_NO_SPLIT = 1 << 1,
+   };
+
+   names = MALLOC(num_vrfs * sizeof(*names));
+   flags = CALLOC(num_vrfs, sizeof(*flags));
+   if (!names || !flags) {
+      FREE(names);
+      FREE(flags);
+      return;
+   }
+
+   for (i = 0; i < num_vrfs; i++)
+      names[i] = i;
+
+   /* VRFs that must stay consecutive or are accessed indirectly */
+   tc_head(tc);
+   while ((inst = tc_next(tc)) != NULL) {
+      if (inst->dst.file == TOY_FILE_VRF) {
+         const int num_dst = get_num_dst_vrfs(inst);
+
+         if (inst->dst.indirect) {
+            FREE(names);
+            FREE(flags);
+            return;
+         }
+
+         if (num_dst > 1) {
+            const int vrf = inst->dst.val32 / TOY_REG_WIDTH;
+
+            for (i = 0; i < num_dst && vrf + i < num_vrfs; i++)
+               flags[vrf + i] |= VRF_NO_SPLIT;
+         }
+      }
+
+      for (i = 0; i < Elements(inst->src); i++) {
+         if (inst->src[i].file == TOY_FILE_VRF && inst->src[i].indirect) {
+            FREE(names);
+            FREE(flags);
+            return;
+         }
+      }
+   }
+
+   depth = 0;
+   tc_head(tc);
+   while ((inst = tc_next_no_skip(tc)) != NULL) {
+      if (inst->marker) {
+         /* BRW_OPCODE_DO */
+         depth++;
+         continue;
+      }
+
+      for (i = 0; i < Elements(inst->src); i++) {
+         struct toy_src *src = &inst->src[i];
+         int vrf;
+
+         if (src->file != TOY_FILE_VRF)
+            continue;
+
+         vrf = src->val32 / TOY_REG_WIDTH;
+         src->val32 = names[vrf] * TOY_REG_WIDTH + src->val32 % TOY_REG_WIDTH;
+      }
+
+      switch (inst->opcode) {
+      case BRW_OPCODE_IF:
+         depth++;
+         break;
+      case BRW_OPCODE_ENDIF:
+      case BRW_OPCODE_WHILE:
+         depth--;
+         break;
+      default:
+         break;
+      }
+
+      if (inst->dst.file == TOY_FILE_VRF) {
+         const int vrf = inst->dst.val32 / TOY_REG_WIDTH;
+
+         if (!depth && (flags[vrf] & (VRF_DEFINED | VRF_NO_SPLIT)) ==
+               VRF_DEFINED && is_complete_write(inst, num_grf_per_vrf))
+            names[vrf] = tc_alloc_vrf(tc, 1);
+
+         flags[vrf] |= VRF_DEFINED;
+
+         inst->dst.val32 = names[vrf] * TOY_REG_WIDTH +
+            inst->dst.val32 % TOY_REG_WIDTH;
+      }
+   }
+
+   FREE(names);
+   FREE(flags);
+}
+
 /**
  * Allocate GRF registers to VRF registers.
  */
@@ -621,6 +854,8 @@ toy_compiler_allocate_registers(struct toy_compiler *tc,
                                 int start_grf, int end_grf,
                                 int num_grf_per_vrf)
 {
+   split_live_ranges(tc, num_grf_per_vrf);
+
    if (true)
       linear_scan_allocation(tc, start_grf, end_grf, num_grf_per_vrf);
    else
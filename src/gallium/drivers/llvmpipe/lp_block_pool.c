@@ -0,0 +1,268 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Size-class pool of scene memory blocks, see lp_block_pool.h.
+ */
+
+#include "os/os_thread.h"
+#include "util/u_counter.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "lp_block_pool.h"
+
+
+/** A cached block, the link lives in the block itself */
+struct free_block {
+   struct free_block *next;
+};
+
+
+struct block_class {
+   struct free_block *free;
+   unsigned num_free;
+   unsigned num_used;
+   unsigned peak_used;  /**< most blocks in use since the last trim */
+};
+
+
+struct lp_block_pool {
+   pipe_mutex mutex;
+   unsigned base_size;
+   unsigned trim_count;
+   struct block_class classes[LP_BLOCK_POOL_NUM_CLASSES];
+   struct lp_block_pool_stats stats;
+};
+
+
+/**
+ * \param base_size  size of the class 0 blocks
+ */
+struct lp_block_pool *
+lp_block_pool_create(unsigned base_size)
+{
+   struct lp_block_pool *pool = CALLOC_STRUCT(lp_block_pool);
+   if (!pool)
+      return NULL;
+
+   assert(base_size >= sizeof(struct free_block));
+   pool->base_size = base_size;
+   pipe_mutex_init(pool->mutex);
+
+   return pool;
+}
+
+
+void
+lp_block_pool_destroy(struct lp_block_pool *pool)
+{
+   unsigned i;
+
+   for (i = 0; i < LP_BLOCK_POOL_NUM_CLASSES; i++) {
+      struct free_block *block, *next;
+
+      assert(pool->classes[i].num_used == 0);
+
+      for (block = pool->classes[i].free; block; block = next) {
+         next = block->next;
+         FREE(block);
+         util_counter_mem_free(UTIL_COUNTER_MEM_SCENE, pool->base_size << i);
+      }
+   }
+
+   pipe_mutex_destroy(pool->mutex);
+   FREE(pool);
+}
+
+
+/** Size class of a request, LP_BLOCK_POOL_NUM_CLASSES if too large */
+static unsigned
+block_class(const struct lp_block_pool *pool, unsigned size)
+{
+   unsigned i;
+
+   for (i = 0; i < LP_BLOCK_POOL_NUM_CLASSES; i++) {
+      if (size <= pool->base_size << i)
+         break;
+   }
+   return i;
+}
+
+
+/**
+ * Actual size of the block handed out for a request of size bytes.
+ */
+unsigned
+lp_block_pool_block_size(const struct lp_block_pool *pool, unsigned size)
+{
+   unsigned i = block_class(pool, size);
+   return i < LP_BLOCK_POOL_NUM_CLASSES ? pool->base_size << i : size;
+}
+
+
+void *
+lp_block_pool_alloc(struct lp_block_pool *pool, unsigned size)
+{
+   const unsigned i = block_class(pool, size);
+   const unsigned block_size = lp_block_pool_block_size(pool, size);
+   struct free_block *block = NULL;
+
+   pipe_mutex_lock(pool->mutex);
+
+   if (i < LP_BLOCK_POOL_NUM_CLASSES && pool->classes[i].free) {
+      struct block_class *cls = &pool->classes[i];
+
+      block = cls->free;
+      cls->free = block->next;
+      cls->num_free--;
+      pool->stats.bytes_cached -= block_size;
+      pool->stats.hits++;
+   }
+   else {
+      /* Don't hold the lock over malloc. */
+      pipe_mutex_unlock(pool->mutex);
+      block = MALLOC(block_size);
+      if (!block)
+         return NULL;
+      util_counter_mem_alloc(UTIL_COUNTER_MEM_SCENE, block_size);
+      pipe_mutex_lock(pool->mutex);
+   }
+
+   if (i < LP_BLOCK_POOL_NUM_CLASSES) {
+      struct block_class *cls = &pool->classes[i];
+      cls->num_used++;
+      cls->peak_used = MAX2(cls->peak_used, cls->num_used);
+   }
+
+   pool->stats.allocs++;
+   pool->stats.bytes_in_use += block_size;
+   pool->stats.peak_bytes = MAX2(pool->stats.peak_bytes,
+                                 pool->stats.bytes_in_use +
+                                 pool->stats.bytes_cached);
+
+   pipe_mutex_unlock(pool->mutex);
+
+   return block;
+}
+
+
+/**
+ * Give a block back to the pool.
+ * \param size  the size it was allocated with
+ */
+void
+lp_block_pool_free(struct lp_block_pool *pool, void *block, unsigned size)
+{
+   const unsigned i = block_class(pool, size);
+   const unsigned block_size = lp_block_pool_block_size(pool, size);
+
+   if (!block)
+      return;
+
+   pipe_mutex_lock(pool->mutex);
+
+   pool->stats.bytes_in_use -= block_size;
+
+   if (i < LP_BLOCK_POOL_NUM_CLASSES) {
+      struct block_class *cls = &pool->classes[i];
+      struct free_block *fb = (struct free_block *) block;
+
+      assert(cls->num_used > 0);
+      cls->num_used--;
+
+      fb->next = cls->free;
+      cls->free = fb;
+      cls->num_free++;
+      pool->stats.bytes_cached += block_size;
+      block = NULL;
+   }
+
+   pipe_mutex_unlock(pool->mutex);
+
+   if (block) {
+      FREE(block);
+      util_counter_mem_free(UTIL_COUNTER_MEM_SCENE, block_size);
+   }
+}
+
+
+/**
+ * Called once per scene.  Periodically frees the cached blocks of each
+ * class which exceed what the busiest moment since the last trim needed.
+ */
+void
+lp_block_pool_trim(struct lp_block_pool *pool)
+{
+   struct free_block *release = NULL, *block;
+   unsigned released = 0;
+   unsigned i;
+
+   pipe_mutex_lock(pool->mutex);
+
+   if (++pool->trim_count < LP_BLOCK_POOL_TRIM_PERIOD) {
+      pipe_mutex_unlock(pool->mutex);
+      return;
+   }
+   pool->trim_count = 0;
+
+   for (i = 0; i < LP_BLOCK_POOL_NUM_CLASSES; i++) {
+      struct block_class *cls = &pool->classes[i];
+      unsigned keep = cls->peak_used - cls->num_used;
+
+      while (cls->num_free > keep) {
+         block = cls->free;
+         cls->free = block->next;
+         cls->num_free--;
+
+         block->next = release;
+         release = block;
+
+         pool->stats.bytes_cached -= pool->base_size << i;
+         pool->stats.released++;
+         released += pool->base_size << i;
+      }
+
+      cls->peak_used = cls->num_used;
+   }
+
+   pipe_mutex_unlock(pool->mutex);
+
+   while (release) {
+      block = release->next;
+      FREE(release);
+      release = block;
+   }
+
+   util_counter_mem_free(UTIL_COUNTER_MEM_SCENE, released);
+}
+
+
+void
+lp_block_pool_get_stats(struct lp_block_pool *pool,
+                        struct lp_block_pool_stats *stats)
+{
+   pipe_mutex_lock(pool->mutex);
+   *stats = pool->stats;
+   pipe_mutex_unlock(pool->mutex);
+}
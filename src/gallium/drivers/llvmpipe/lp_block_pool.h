@@ -0,0 +1,83 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Screen-wide cache of the memory blocks scenes are built from.
+ *
+ * Blocks come in power-of-two size classes, class 0 being one scene data
+ * block.  Freed blocks are kept on per-class free lists; every
+ * LP_BLOCK_POOL_TRIM_PERIOD calls to lp_block_pool_trim(), the blocks
+ * that weren't needed since the previous trim (above the high-water mark
+ * of the blocks in use) are given back.  Blocks above the largest class
+ * are malloc'ed and freed directly.
+ */
+
+#ifndef LP_BLOCK_POOL_H
+#define LP_BLOCK_POOL_H
+
+#include "pipe/p_compiler.h"
+
+
+#define LP_BLOCK_POOL_NUM_CLASSES 6
+
+#define LP_BLOCK_POOL_TRIM_PERIOD 32
+
+
+struct lp_block_pool;
+
+struct lp_block_pool_stats
+{
+   uint64_t allocs;  /**< blocks handed out */
+   uint64_t hits;  /**< of which came from a free list */
+   uint64_t released;  /**< blocks freed by trimming */
+   uint64_t bytes_in_use;
+   uint64_t bytes_cached;  /**< on the free lists */
+   uint64_t peak_bytes;  /**< maximum of bytes_in_use + bytes_cached */
+};
+
+
+struct lp_block_pool *
+lp_block_pool_create(unsigned base_size);
+
+void
+lp_block_pool_destroy(struct lp_block_pool *pool);
+
+unsigned
+lp_block_pool_block_size(const struct lp_block_pool *pool, unsigned size);
+
+void *
+lp_block_pool_alloc(struct lp_block_pool *pool, unsigned size);
+
+void
+lp_block_pool_free(struct lp_block_pool *pool, void *block, unsigned size);
+
+void
+lp_block_pool_trim(struct lp_block_pool *pool);
+
+void
+lp_block_pool_get_stats(struct lp_block_pool *pool,
+                        struct lp_block_pool_stats *stats);
+
+
+#endif /* LP_BLOCK_POOL_H */
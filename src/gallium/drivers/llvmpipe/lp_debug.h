@@ -59,6 +59,8 @@ st_print_current(void);
 #define PERF_NO_BLEND       0x20  	/* disable blending */
 #define PERF_NO_DEPTH       0x40  	/* disable depth buffering entirely */
 #define PERF_NO_ALPHATEST   0x80  	/* disable alpha testing */
+#define PERF_NO_HIZ         0x100  	/* disable coarse depth rejection */
+#define PERF_TILED_TEX      0x200  	/* tiled layout for sampled textures */
 
 
 extern int LP_PERF;
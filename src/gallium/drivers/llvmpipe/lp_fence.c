@@ -27,6 +27,7 @@
 
 
 #include "pipe/p_screen.h"
+#include "util/u_atomic.h"
 #include "util/u_memory.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
@@ -125,3 +126,35 @@ lp_fence_wait(struct lp_fence *f)
 }
 
 
+/**
+ * Wake up the threads waiting on the fence, without signalling it.
+ * For lp_fence_wait_pending(), after its counter dropped to zero.
+ */
+void
+lp_fence_wake(struct lp_fence *fence)
+{
+   pipe_mutex_lock(fence->mutex);
+   pipe_condvar_broadcast(fence->signalled);
+   pipe_mutex_unlock(fence->mutex);
+}
+
+
+/**
+ * Wait for the fence, or for the counter *pending, which the rendering
+ * threads decrement, to drop to zero, whatever comes first.
+ */
+void
+lp_fence_wait_pending(struct lp_fence *f, const int32_t *pending)
+{
+   if (LP_DEBUG & DEBUG_FENCE)
+      debug_printf("%s %d\n", __FUNCTION__, f->id);
+
+   pipe_mutex_lock(f->mutex);
+   assert(f->issued);
+   while (f->count < f->rank && p_atomic_read(pending) != 0) {
+      pipe_condvar_wait(f->signalled, f->mutex);
+   }
+   pipe_mutex_unlock(f->mutex);
+}
+
+
@@ -65,6 +65,12 @@ lp_fence_signalled(struct lp_fence *fence);
 void
 lp_fence_wait(struct lp_fence *fence);
 
+void
+lp_fence_wake(struct lp_fence *fence);
+
+void
+lp_fence_wait_pending(struct lp_fence *fence, const int32_t *pending);
+
 void
 llvmpipe_init_screen_fence_funcs(struct pipe_screen *screen);
 
@@ -36,7 +36,9 @@
 #include "draw/draw_context.h"
 #include "lp_flush.h"
 #include "lp_context.h"
+#include "lp_fence.h"
 #include "lp_setup.h"
+#include "lp_texture.h"
 
 
 /**
@@ -127,5 +129,22 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
       }
    }
 
+   /* Scenes already queued are rasterized in order, so only CPU access
+    * has to wait for them, and only for the last one using the resource.
+    */
+   if (cpu_access) {
+      struct lp_fence *fence =
+         llvmpipe_resource_busy_fence(pipe->screen, resource, read_only);
+
+      if (fence) {
+         if (do_not_block) {
+            lp_fence_reference(&fence, NULL);
+            return FALSE;
+         }
+         lp_fence_wait(fence);
+         lp_fence_reference(&fence, NULL);
+      }
+   }
+
    return TRUE;
 }
@@ -34,11 +34,17 @@
 
 
 /**
- * Tile size (width and height). This needs to be a power of two.
+ * Default tile size (width and height). This needs to be a power of two.
+ * The rasterizer's tile size is chosen at screen creation (LP_TILE_SIZE),
+ * between the min and max orders below; see lp_scene::tile_order.
  */
 #define TILE_ORDER 6
 #define TILE_SIZE (1 << TILE_ORDER)
 
+#define LP_MIN_TILE_ORDER 5
+#define LP_MAX_TILE_ORDER 7
+#define LP_MAX_TILE_SIZE (1 << LP_MAX_TILE_ORDER)
+
 
 /**
  * Max texture sizes
@@ -61,7 +67,7 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+#define LP_MAX_THREADS 128
 
 
 /**
@@ -81,6 +87,13 @@
  */
 #define LP_MAX_SHADER_INSTRUCTIONS (512*LP_MAX_SHADER_VARIANTS)
 
+/**
+ * Max number of compiled fragment shader variants, and their instructions,
+ * which no context uses any more but the screen keeps for reuse.
+ */
+#define LP_MAX_CACHED_FS_CODE LP_MAX_SHADER_VARIANTS
+#define LP_MAX_CACHED_FS_INSTRUCTIONS LP_MAX_SHADER_INSTRUCTIONS
+
 /**
  * Max number of setup variants that will be kept around.
  *
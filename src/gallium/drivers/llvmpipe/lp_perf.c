@@ -33,6 +33,8 @@
 
 struct lp_counters lp_count;
 
+int lp_count_queries;
+
 
 void
 lp_reset_counters(void)
@@ -98,7 +100,10 @@ lp_print_counters(void)
       debug_printf("llvmpipe:   nr_empty_4x4:               %9u (%3.0f%% of %u)\n", lp_count.nr_empty_4, p1, total_4);
       debug_printf("llvmpipe:   nr_non_empty_4x4:           %9u (%3.0f%% of %u)\n", lp_count.nr_non_empty_4, p4, total_4);
 
+      debug_printf("llvmpipe: nr_hiz_rejected:              %9u\n", lp_count.nr_hiz_rejected);
+
       debug_printf("llvmpipe: nr_color_tile_clear:          %9u\n", lp_count.nr_color_tile_clear);
+      debug_printf("llvmpipe: nr_tile_clear_skipped:        %9u\n", lp_count.nr_tile_clear_skipped);
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
@@ -56,10 +56,12 @@ struct lp_counters
    unsigned nr_fully_covered_4;
    unsigned nr_partially_covered_4;
    unsigned nr_non_empty_4;
+   unsigned nr_hiz_rejected;
    unsigned nr_llvm_compiles;
    int64_t llvm_compile_time;  /**< total, in microseconds */
 
    unsigned nr_color_tile_clear;
+   unsigned nr_tile_clear_skipped;  /**< clears never written to memory */
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
 };
@@ -68,17 +70,27 @@ struct lp_counters
 extern struct lp_counters lp_count;
 
 
-/** Increment the named counter (only for debug builds) */
+/** Number of live driver queries of the counters, see lp_query.c */
+extern int lp_count_queries;
+
+
+/**
+ * Increment the named counter.  Debug builds always count, other builds
+ * only while a driver query of the counters exists.  The rasterizer
+ * threads don't synchronize, so concurrent increments may get lost.
+ */
 #ifdef DEBUG
-#define LP_COUNT(counter) lp_count.counter++
-#define LP_COUNT_ADD(counter, incr)  lp_count.counter += (incr)
-#define LP_COUNT_GET(counter) (lp_count.counter)
+#define LP_COUNT_ENABLED TRUE
 #else
-#define LP_COUNT(counter)
-#define LP_COUNT_ADD(counter, incr) (void)(incr)
-#define LP_COUNT_GET(counter) 0
+#define LP_COUNT_ENABLED (lp_count_queries > 0)
 #endif
 
+#define LP_COUNT(counter) \
+   do { if (LP_COUNT_ENABLED) lp_count.counter++; } while (0)
+#define LP_COUNT_ADD(counter, incr) \
+   do { if (LP_COUNT_ENABLED) lp_count.counter += (incr); } while (0)
+#define LP_COUNT_GET(counter) (lp_count.counter)
+
 
 extern void
 lp_reset_counters(void);
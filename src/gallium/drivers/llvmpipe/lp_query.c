@@ -41,6 +41,9 @@
 #include "lp_screen.h"
 #include "lp_state.h"
 #include "lp_rast.h"
+#include "lp_block_pool.h"
+#include "lp_perf.h"
+#include "util/u_atomic.h"
 
 
 static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
@@ -48,13 +51,248 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+
+/**
+ * Whether all the bins ended a binned query, so that its result is
+ * available though its scene isn't done.
+ */
+static boolean
+binned_result_ready(const struct llvmpipe_query *pq)
+{
+   return pq->early_result && p_atomic_read(&pq->bins_pending) == 0;
+}
+
+/**
+ * Current value of a JIT statistic.
+ */
+static uint64_t
+jit_query_value(unsigned type)
+{
+   unsigned owner = (type - LP_QUERY_JIT_FIRST) / LP_JIT_NUM_STATS;
+   struct gallivm_stats stats;
+
+   gallivm_get_stats(owner, &stats);
+
+   switch ((type - LP_QUERY_JIT_FIRST) % LP_JIT_NUM_STATS) {
+   case LP_JIT_STAT_COMPILES:
+      return stats.num_compiles;
+   case LP_JIT_STAT_INSTRUCTIONS:
+      return stats.num_instructions;
+   case LP_JIT_STAT_OPTIMIZE_TIME:
+      return stats.optimize_time;
+   case LP_JIT_STAT_CODEGEN_TIME:
+      return stats.codegen_time;
+   case LP_JIT_STAT_CODE_SIZE:
+   default:
+      return stats.code_size;
+   }
+}
+
+
+/**
+ * Current value of a lp_perf.h counter.
+ */
+static uint64_t
+counter_query_value(unsigned type)
+{
+   switch (type) {
+   case LP_QUERY_NR_TRIS:
+      return LP_COUNT_GET(nr_tris);
+   case LP_QUERY_NR_CULLED_TRIS:
+      return LP_COUNT_GET(nr_culled_tris);
+   case LP_QUERY_NR_EMPTY_64:
+      return LP_COUNT_GET(nr_empty_64);
+   case LP_QUERY_NR_FULLY_COVERED_64:
+      return LP_COUNT_GET(nr_fully_covered_64);
+   case LP_QUERY_NR_PARTIALLY_COVERED_64:
+      return LP_COUNT_GET(nr_partially_covered_64);
+   case LP_QUERY_NR_SHADE_64:
+      return LP_COUNT_GET(nr_shade_64);
+   case LP_QUERY_NR_SHADE_OPAQUE_64:
+      return LP_COUNT_GET(nr_shade_opaque_64);
+   case LP_QUERY_NR_EMPTY_16:
+      return LP_COUNT_GET(nr_empty_16);
+   case LP_QUERY_NR_FULLY_COVERED_16:
+      return LP_COUNT_GET(nr_fully_covered_16);
+   case LP_QUERY_NR_PARTIALLY_COVERED_16:
+      return LP_COUNT_GET(nr_partially_covered_16);
+   case LP_QUERY_NR_HIZ_REJECTED:
+      return LP_COUNT_GET(nr_hiz_rejected);
+   case LP_QUERY_NR_COLOR_TILE_CLEAR:
+      return LP_COUNT_GET(nr_color_tile_clear);
+   case LP_QUERY_NR_TILE_CLEAR_SKIPPED:
+      return LP_COUNT_GET(nr_tile_clear_skipped);
+   case LP_QUERY_NR_COLOR_TILE_LOAD:
+      return LP_COUNT_GET(nr_color_tile_load);
+   case LP_QUERY_NR_COLOR_TILE_STORE:
+   default:
+      return LP_COUNT_GET(nr_color_tile_store);
+   }
+}
+
+
+/**
+ * Sample the scene statistics at begin (start) or end of a query.  Most
+ * are running totals, of which the query returns the difference; thread
+ * utilization needs two of them, and the scene memory is a level, like the
+ * memory counters which are handled here too.
+ */
+static void
+scene_query_sample(struct llvmpipe_screen *screen, unsigned type,
+                   uint64_t *values)
+{
+   struct lp_rast_stats stats;
+   struct lp_block_pool_stats pool_stats;
+
+   if (type >= LP_QUERY_MEMORY_FIRST) {
+      values[0] = util_counter_get_level(type - LP_QUERY_MEMORY_FIRST +
+                                         UTIL_COUNTER_MEM_FIRST);
+      return;
+   }
+
+   switch (type) {
+   case LP_QUERY_SCENES:
+   case LP_QUERY_RASTER_TIME:
+   case LP_QUERY_THREAD_BUSY:
+      lp_rast_get_stats(screen->rast, &stats);
+      values[0] = type == LP_QUERY_SCENES ? stats.num_scenes :
+                  stats.raster_time;
+      values[1] = stats.busy_time;
+      values[2] = stats.num_threads;
+      break;
+   case LP_QUERY_BIN_TIME:
+      pipe_mutex_lock(screen->rast_mutex);
+      values[0] = screen->bin_time;
+      pipe_mutex_unlock(screen->rast_mutex);
+      break;
+   case LP_QUERY_SCENE_MEMORY:
+   case LP_QUERY_SCENE_MEMORY_CACHED:
+   default:
+      lp_block_pool_get_stats(screen->block_pool, &pool_stats);
+      values[0] = type == LP_QUERY_SCENE_MEMORY ? pool_stats.bytes_in_use :
+                  pool_stats.bytes_cached;
+      break;
+   }
+}
+
+
+/** Result of a scene statistics query from its start and end samples */
+static uint64_t
+scene_query_result(const struct llvmpipe_query *pq)
+{
+   switch (pq->type) {
+   case LP_QUERY_THREAD_BUSY:
+      {
+         uint64_t wall = (pq->end[0] - pq->start[0]) * pq->end[2];
+         uint64_t busy = pq->end[1] - pq->start[1];
+         return wall ? MIN2(busy * 100 / wall, 100) : 0;
+      }
+   case LP_QUERY_SCENE_MEMORY:
+   case LP_QUERY_SCENE_MEMORY_CACHED:
+      return pq->end[0];
+   default:
+      if (pq->type >= LP_QUERY_MEMORY_FIRST)
+         return pq->end[0];
+      return pq->end[0] - pq->start[0];
+   }
+}
+
+
+#define JIT_QUERIES(name, owner) \
+   {"jit-" name "-compiles", LP_QUERY_JIT(owner, LP_JIT_STAT_COMPILES), 0, FALSE}, \
+   {"jit-" name "-ir-instructions", LP_QUERY_JIT(owner, LP_JIT_STAT_INSTRUCTIONS), 0, FALSE}, \
+   {"jit-" name "-optimize-time", LP_QUERY_JIT(owner, LP_JIT_STAT_OPTIMIZE_TIME), 0, FALSE}, \
+   {"jit-" name "-codegen-time", LP_QUERY_JIT(owner, LP_JIT_STAT_CODEGEN_TIME), 0, FALSE}, \
+   {"jit-" name "-code-size", LP_QUERY_JIT(owner, LP_JIT_STAT_CODE_SIZE), 0, TRUE}
+
+static const struct pipe_driver_query_info lp_driver_queries[] = {
+   JIT_QUERIES("fs", GALLIVM_OWNER_LP_FS),
+   JIT_QUERIES("setup", GALLIVM_OWNER_LP_SETUP),
+   JIT_QUERIES("vs", GALLIVM_OWNER_DRAW_VS),
+   JIT_QUERIES("gs", GALLIVM_OWNER_DRAW_GS),
+   JIT_QUERIES("total", GALLIVM_OWNER_COUNT),
+
+   {"nr-triangles", LP_QUERY_NR_TRIS, 0, FALSE},
+   {"nr-culled-triangles", LP_QUERY_NR_CULLED_TRIS, 0, FALSE},
+   {"nr-empty-64", LP_QUERY_NR_EMPTY_64, 0, FALSE},
+   {"nr-fully-covered-64", LP_QUERY_NR_FULLY_COVERED_64, 0, FALSE},
+   {"nr-partially-covered-64", LP_QUERY_NR_PARTIALLY_COVERED_64, 0, FALSE},
+   {"nr-shade-64", LP_QUERY_NR_SHADE_64, 0, FALSE},
+   {"nr-shade-opaque-64", LP_QUERY_NR_SHADE_OPAQUE_64, 0, FALSE},
+   {"nr-empty-16", LP_QUERY_NR_EMPTY_16, 0, FALSE},
+   {"nr-fully-covered-16", LP_QUERY_NR_FULLY_COVERED_16, 0, FALSE},
+   {"nr-partially-covered-16", LP_QUERY_NR_PARTIALLY_COVERED_16, 0, FALSE},
+   {"nr-hiz-rejected", LP_QUERY_NR_HIZ_REJECTED, 0, FALSE},
+   {"nr-color-tile-clear", LP_QUERY_NR_COLOR_TILE_CLEAR, 0, FALSE},
+   {"nr-tile-clear-skipped", LP_QUERY_NR_TILE_CLEAR_SKIPPED, 0, FALSE},
+   {"nr-color-tile-load", LP_QUERY_NR_COLOR_TILE_LOAD, 0, FALSE},
+   {"nr-color-tile-store", LP_QUERY_NR_COLOR_TILE_STORE, 0, FALSE},
+
+   {"scenes", LP_QUERY_SCENES, 0, FALSE},
+   {"bin-time", LP_QUERY_BIN_TIME, 0, FALSE},
+   {"raster-time", LP_QUERY_RASTER_TIME, 0, FALSE},
+   {"raster-thread-busy", LP_QUERY_THREAD_BUSY, 100, FALSE},
+   {"scene-memory", LP_QUERY_SCENE_MEMORY, 0, TRUE},
+   {"scene-memory-cached", LP_QUERY_SCENE_MEMORY_CACHED, 0, TRUE},
+
+   {"mem-glsl-ir", LP_QUERY_MEMORY(UTIL_COUNTER_MEM_GLSL_IR), 0, TRUE},
+   {"mem-tgsi", LP_QUERY_MEMORY(UTIL_COUNTER_MEM_TGSI), 0, TRUE},
+   {"mem-jit", LP_QUERY_MEMORY(UTIL_COUNTER_MEM_JIT), 0, TRUE},
+   {"mem-scene", LP_QUERY_MEMORY(UTIL_COUNTER_MEM_SCENE), 0, TRUE},
+   {"mem-upload", LP_QUERY_MEMORY(UTIL_COUNTER_MEM_UPLOAD), 0, TRUE},
+   {"mem-cso", LP_QUERY_MEMORY(UTIL_COUNTER_MEM_CSO), 0, TRUE}
+};
+
+#undef JIT_QUERIES
+
+
+/**
+ * The JIT statistics are per frame (or whatever the query spans): the
+ * number of modules compiled, their IR instructions, the time spent in
+ * LLVM's optimization passes and code generation (in microseconds), and the
+ * size of the generated code.
+ *
+ * The nr-* counters are those of LP_DEBUG=counters, which non-debug builds
+ * only count while such a query exists.  Then come the number of scenes,
+ * the time spent binning and rasterizing them (in microseconds), the
+ * percentage of that time the rasterizer threads were busy, and the memory
+ * held by the scenes and cached for them.
+ *
+ * Last come the memory counters of util/u_counter.h, which are process-wide
+ * levels in bytes.
+ */
+int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   if (!info)
+      return Elements(lp_driver_queries);
+
+   if (index >= Elements(lp_driver_queries))
+      return 0;
+
+   *info = lp_driver_queries[index];
+   return 1;
+}
+
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type)
 {
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= LP_QUERY_JIT_FIRST && type < LP_QUERY_END));
+
+   if (type >= LP_QUERY_JIT_FIRST && type < LP_QUERY_JIT_END &&
+       (type - LP_QUERY_JIT_FIRST) % LP_JIT_NUM_STATS == LP_JIT_STAT_CODE_SIZE) {
+      gallivm_enable_code_size_stats();
+   }
+
+   if (type >= LP_QUERY_JIT_END && type < LP_QUERY_COUNTERS_END)
+      p_atomic_inc(&lp_count_queries);
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
@@ -84,6 +322,9 @@ llvmpipe_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
       lp_fence_reference(&pq->fence, NULL);
    }
 
+   if (pq->type >= LP_QUERY_JIT_END && pq->type < LP_QUERY_COUNTERS_END)
+      p_atomic_dec(&lp_count_queries);
+
    FREE(pq);
 }
 
@@ -102,14 +343,17 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
 
    if (pq->fence) {
       /* only have a fence if there was a scene */
-      if (!lp_fence_signalled(pq->fence)) {
+      if (!lp_fence_signalled(pq->fence) && !binned_result_ready(pq)) {
          if (!lp_fence_issued(pq->fence))
             llvmpipe_flush(pipe, NULL, __FUNCTION__);
 
          if (!wait)
             return FALSE;
 
-         lp_fence_wait(pq->fence);
+         if (pq->early_result)
+            lp_fence_wait_pending(pq->fence, &pq->bins_pending);
+         else
+            lp_fence_wait(pq->fence);
       }
    }
 
@@ -120,19 +364,19 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
       for (i = 0; i < num_threads; i++) {
-         *result += pq->end[i];
+         *result += pq->threads[i].c.end;
       }
       break;
    case PIPE_QUERY_OCCLUSION_PREDICATE:
       for (i = 0; i < num_threads; i++) {
          /* safer (still not guaranteed) when there's an overflow */
-         vresult->b = vresult->b || pq->end[i];
+         vresult->b = vresult->b || pq->threads[i].c.end;
       }
       break;
    case PIPE_QUERY_TIMESTAMP:
       for (i = 0; i < num_threads; i++) {
-         if (pq->end[i] > *result) {
-            *result = pq->end[i];
+         if (pq->threads[i].c.end > *result) {
+            *result = pq->threads[i].c.end;
          }
       }
       break;
@@ -168,13 +412,21 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
          (struct pipe_query_data_pipeline_statistics *)vresult;
       /* only ps_invocations come from binned query */
       for (i = 0; i < num_threads; i++) {
-         pq->stats.ps_invocations += pq->end[i];
+         pq->stats.ps_invocations += pq->threads[i].c.end;
       }
       pq->stats.ps_invocations *= LP_RASTER_BLOCK_SIZE * LP_RASTER_BLOCK_SIZE;
       *stats = pq->stats;
    }
       break;
    default:
+      if (pq->type >= LP_QUERY_COUNTERS_END) {
+         *result = scene_query_result(pq);
+         break;
+      }
+      if (pq->type >= LP_QUERY_JIT_FIRST) {
+         *result = pq->end[0];
+         break;
+      }
       assert(0);
       break;
    }
@@ -198,8 +450,25 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
+   memset(pq->threads, 0, sizeof(pq->threads));
    memset(pq->start, 0, sizeof(pq->start));
    memset(pq->end, 0, sizeof(pq->end));
+   pq->early_result = FALSE;
+
+   /* JIT statistics and counters don't go through the scene */
+   if (pq->type >= LP_QUERY_COUNTERS_END) {
+      scene_query_sample(llvmpipe_screen(pipe->screen), pq->type, pq->start);
+      return;
+   }
+   if (pq->type >= LP_QUERY_JIT_END) {
+      pq->start[0] = counter_query_value(pq->type);
+      return;
+   }
+   if (pq->type >= LP_QUERY_JIT_FIRST) {
+      pq->start[0] = jit_query_value(pq->type);
+      return;
+   }
+
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -243,6 +512,20 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (pq->type >= LP_QUERY_COUNTERS_END) {
+      scene_query_sample(llvmpipe_screen(pipe->screen), pq->type, pq->end);
+      return;
+   }
+   if (pq->type >= LP_QUERY_JIT_END) {
+      /* the counters are unsigned and may wrap */
+      pq->end[0] = (unsigned) (counter_query_value(pq->type) - pq->start[0]);
+      return;
+   }
+   if (pq->type >= LP_QUERY_JIT_FIRST) {
+      pq->end[0] = jit_query_value(pq->type) - pq->start[0];
+      return;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
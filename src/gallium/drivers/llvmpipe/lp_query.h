@@ -35,16 +35,97 @@
 
 #include <limits.h>
 #include "os/os_thread.h"
+#include "gallivm/lp_bld_init.h"
+#include "util/u_counter.h"
 #include "lp_limits.h"
 
 
+/**
+ * Driver queries of the JIT statistics, see llvmpipe_get_driver_query_info().
+ * Each gallivm_owner, plus GALLIVM_OWNER_COUNT for all of them, has one
+ * query per field of struct gallivm_stats.
+ */
+#define LP_JIT_NUM_STATS      5
+#define LP_JIT_STAT_COMPILES      0
+#define LP_JIT_STAT_INSTRUCTIONS  1
+#define LP_JIT_STAT_OPTIMIZE_TIME 2
+#define LP_JIT_STAT_CODEGEN_TIME  3
+#define LP_JIT_STAT_CODE_SIZE     4
+
+#define LP_QUERY_JIT(owner, stat) \
+   (PIPE_QUERY_DRIVER_SPECIFIC + (owner) * LP_JIT_NUM_STATS + (stat))
+#define LP_QUERY_JIT_FIRST  LP_QUERY_JIT(0, 0)
+#define LP_QUERY_JIT_END    LP_QUERY_JIT(GALLIVM_OWNER_COUNT + 1, 0)
+
+/**
+ * Driver queries of the rasterizer: the lp_perf.h counters, then the
+ * scene statistics.
+ */
+enum lp_query_counter {
+   LP_QUERY_NR_TRIS = LP_QUERY_JIT_END,
+   LP_QUERY_NR_CULLED_TRIS,
+   LP_QUERY_NR_EMPTY_64,
+   LP_QUERY_NR_FULLY_COVERED_64,
+   LP_QUERY_NR_PARTIALLY_COVERED_64,
+   LP_QUERY_NR_SHADE_64,
+   LP_QUERY_NR_SHADE_OPAQUE_64,
+   LP_QUERY_NR_EMPTY_16,
+   LP_QUERY_NR_FULLY_COVERED_16,
+   LP_QUERY_NR_PARTIALLY_COVERED_16,
+   LP_QUERY_NR_HIZ_REJECTED,
+   LP_QUERY_NR_COLOR_TILE_CLEAR,
+   LP_QUERY_NR_TILE_CLEAR_SKIPPED,
+   LP_QUERY_NR_COLOR_TILE_LOAD,
+   LP_QUERY_NR_COLOR_TILE_STORE,
+   LP_QUERY_COUNTERS_END,
+
+   LP_QUERY_SCENES = LP_QUERY_COUNTERS_END,
+   LP_QUERY_BIN_TIME,
+   LP_QUERY_RASTER_TIME,
+   LP_QUERY_THREAD_BUSY,
+   LP_QUERY_SCENE_MEMORY,
+   LP_QUERY_SCENE_MEMORY_CACHED,
+   LP_QUERY_MEMORY_FIRST,
+   LP_QUERY_END = LP_QUERY_MEMORY_FIRST + UTIL_COUNTER_COUNT -
+                  UTIL_COUNTER_MEM_FIRST
+};
+
+/** Driver query of a util/u_counter.h memory counter */
+#define LP_QUERY_MEMORY(id) \
+   (LP_QUERY_MEMORY_FIRST + (id) - UTIL_COUNTER_MEM_FIRST)
+
+
 struct llvmpipe_context;
 
 
+/**
+ * What a rasterizer thread counts for a binned query.  Each thread has
+ * its own, padded for the threads not to share cache lines.
+ */
+union lp_query_thread {
+   struct {
+      uint64_t start;      /* count value at the begin of the query */
+      uint64_t end;        /* accumulated count, or the timestamp */
+      boolean active;      /* between begin and end in the current bin */
+   } c;
+   uint8_t padding[128];
+};
+
+
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   union lp_query_thread threads[LP_MAX_THREADS];
+   uint64_t start[3];               /* begin sample of the other queries */
+   uint64_t end[3];                 /* end sample of the other queries */
    struct lp_fence *fence;          /* fence from last scene this was binned in */
+
+   /**
+    * Bins of the scene of the fence which have yet to execute the end of
+    * the query.  When the last one does, the result is available before
+    * the rest of the scene is done.  Only meaningful if early_result.
+    */
+   int32_t bins_pending;
+   boolean early_result;
+
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
@@ -55,6 +136,10 @@ struct llvmpipe_query {
 
 extern void llvmpipe_init_query_funcs(struct llvmpipe_context * );
 
+extern int llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                                          unsigned index,
+                                          struct pipe_driver_query_info *info);
+
 extern boolean llvmpipe_check_render_cond(struct llvmpipe_context *);
 
 #endif /* LP_QUERY_H */
@@ -26,11 +26,19 @@
  **************************************************************************/
 
 #include <limits.h>
+#include <stdio.h>
+#include "pipe/p_config.h"
+#if defined(PIPE_OS_LINUX)
+#include <sched.h>
+#endif
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
+#include "util/u_string.h"
+#include "util/u_atomic.h"
 
 #include "os/os_time.h"
 
@@ -54,6 +62,11 @@ const struct lp_rasterizer_task *jit_task = NULL;
 #endif
 
 
+static void
+lp_rast_begin_query(struct lp_rasterizer_task *task,
+                    const union lp_rast_cmd_arg arg);
+
+
 /**
  * Begin rasterizing a scene.
  * Called once per scene by one thread.
@@ -63,20 +76,38 @@ lp_rast_begin( struct lp_rasterizer *rast,
                struct lp_scene *scene )
 {
    rast->curr_scene = scene;
+   rast->curr_scene_start = os_time_get();
 
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, rast->num_threads );
 }
 
 
+/**
+ * End rasterizing a scene and signal its fence.
+ * The setup module may reuse the scene as soon as the fence is signalled,
+ * so that is the very last thing done with it.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
+   struct lp_fence *fence = NULL;
+
+   /* ending rasterization drops the scene's fence reference */
+   lp_fence_reference(&fence, rast->curr_scene->fence);
+
    lp_scene_end_rasterization( rast->curr_scene );
 
    rast->curr_scene = NULL;
+   rast->raster_time += os_time_get() - rast->curr_scene_start;
+   rast->num_scenes++;
+
+   if (fence) {
+      lp_fence_signal(fence);
+      lp_fence_reference(&fence, NULL);
+   }
 }
 
 
@@ -90,33 +121,43 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
                    const struct cmd_bin *bin,
                    int x, int y)
 {
+   const unsigned tile_size = task->scene->tile_size;
+   unsigned i;
+
    LP_DBG(DEBUG_RAST, "%s %d,%d\n", __FUNCTION__, x, y);
 
    task->bin = bin;
-   task->x = x * TILE_SIZE;
-   task->y = y * TILE_SIZE;
-   task->width = TILE_SIZE + x * TILE_SIZE > task->scene->fb.width ?
-                    task->scene->fb.width - x * TILE_SIZE : TILE_SIZE;
-   task->height = TILE_SIZE + y * TILE_SIZE > task->scene->fb.height ?
-                    task->scene->fb.height - y * TILE_SIZE : TILE_SIZE;
+   task->x = x * tile_size;
+   task->y = y * tile_size;
+   task->width = tile_size + x * tile_size > task->scene->fb.width ?
+                    task->scene->fb.width - x * tile_size : tile_size;
+   task->height = tile_size + y * tile_size > task->scene->fb.height ?
+                    task->scene->fb.height - y * tile_size : tile_size;
 
    task->thread_data.vis_counter = 0;
    task->ps_invocations = 0;
 
+   for (i = 0; i < task->scene->num_active_queries; ++i) {
+      lp_rast_begin_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
+   }
+
    /* reset pointers to color and depth tile(s) */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
+
+   /* the coarse depth gets filled in as it is needed */
+   task->hiz_valid = 0;
+   task->hiz_exact = 0;
 }
 
 
 /**
- * Clear the rasterizer's current color tile.
- * This is a bin command called during bin processing.
- * Clear commands always clear all bound layers.
+ * Write a clear color to the rasterizer's current color tile, in all
+ * bound layers.
  */
 static void
-lp_rast_clear_color(struct lp_rasterizer_task *task,
-                    const union lp_rast_cmd_arg arg)
+do_clear_color(struct lp_rasterizer_task *task,
+               const union pipe_color_union *color)
 {
    const struct lp_scene *scene = task->scene;
 
@@ -131,20 +172,20 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
           * couldn't handle it)...
           */
          LP_DBG(DEBUG_RAST, "%s pure int 0x%x,0x%x,0x%x,0x%x\n", __FUNCTION__,
-                    arg.clear_color.ui[0],
-                    arg.clear_color.ui[1],
-                    arg.clear_color.ui[2],
-                    arg.clear_color.ui[3]);
+                    color->ui[0],
+                    color->ui[1],
+                    color->ui[2],
+                    color->ui[3]);
 
          for (i = 0; i < scene->fb.nr_cbufs; i++) {
             enum pipe_format format = scene->fb.cbufs[i]->format;
 
             if (util_format_is_pure_sint(format)) {
-               util_format_write_4i(format, arg.clear_color.i, 0, &uc, 0, 0, 0, 1, 1);
+               util_format_write_4i(format, color->i, 0, &uc, 0, 0, 0, 1, 1);
             }
             else {
                assert(util_format_is_pure_uint(format));
-               util_format_write_4ui(format, arg.clear_color.ui, 0, &uc, 0, 0, 0, 1, 1);
+               util_format_write_4ui(format, color->ui, 0, &uc, 0, 0, 0, 1, 1);
             }
 
             util_fill_box(scene->cbufs[i].map,
@@ -164,7 +205,7 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
          uint8_t clear_color[4];
 
          for (i = 0; i < 4; ++i) {
-            clear_color[i] = float_to_ubyte(arg.clear_color.f[i]);
+            clear_color[i] = float_to_ubyte(color->f[i]);
          }
 
          LP_DBG(DEBUG_RAST, "%s 0x%x,0x%x,0x%x,0x%x\n", __FUNCTION__,
@@ -174,7 +215,7 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
                     clear_color[3]);
 
          for (i = 0; i < scene->fb.nr_cbufs; i++) {
-            util_pack_color(arg.clear_color.f,
+            util_pack_color(color->f,
                             scene->fb.cbufs[i]->format, &uc);
 
             util_fill_box(scene->cbufs[i].map,
@@ -192,6 +233,27 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
       }
    }
 
+}
+
+
+/**
+ * Clear the rasterizer's current color tile.
+ * This is a bin command called during bin processing.
+ * Clear commands always clear all bound layers.  The clear is only
+ * written when something else needs the tile, see lp_rast_resolve_clears().
+ */
+static void
+lp_rast_clear_color(struct lp_rasterizer_task *task,
+                    const union lp_rast_cmd_arg arg)
+{
+   if (task->scene->fb.nr_cbufs) {
+      if (task->clear_color_pending)
+         LP_COUNT(nr_tile_clear_skipped);
+
+      task->clear_color = arg.clear_color;
+      task->clear_color_pending = TRUE;
+   }
+
    LP_COUNT(nr_color_tile_clear);
 }
 
@@ -199,17 +261,14 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
 
 
 /**
- * Clear the rasterizer's current z/stencil tile.
- * This is a bin command called during bin processing.
- * Clear commands always clear all bound layers.
+ * Write a z/stencil clear value to the rasterizer's current z/stencil
+ * tile, in all bound layers.
  */
 static void
-lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
-                       const union lp_rast_cmd_arg arg)
+do_clear_zstencil(struct lp_rasterizer_task *task,
+                  uint64_t clear_value64, uint64_t clear_mask64)
 {
    const struct lp_scene *scene = task->scene;
-   uint64_t clear_value64 = arg.clear_zstencil.value;
-   uint64_t clear_mask64 = arg.clear_zstencil.mask;
    uint32_t clear_value = (uint32_t) clear_value64;
    uint32_t clear_mask = (uint32_t) clear_mask64;
    const unsigned height = task->height;
@@ -313,6 +372,70 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
 }
 
 
+/**
+ * Clear the rasterizer's current z/stencil tile.
+ * This is a bin command called during bin processing.
+ * Clear commands always clear all bound layers.  The clear is only
+ * written when something else needs the tile, see lp_rast_resolve_clears().
+ */
+static void
+lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
+                       const union lp_rast_cmd_arg arg)
+{
+   const uint64_t value = arg.clear_zstencil.value;
+   const uint64_t mask = arg.clear_zstencil.mask;
+
+   task->hiz_valid = 0;
+
+   if (!task->scene->fb.zsbuf)
+      return;
+
+   if (task->clear_zs_pending) {
+      /* one clear of the union of the masks does both */
+      task->clear_zs_value = (task->clear_zs_value & ~mask) | (value & mask);
+      task->clear_zs_mask |= mask;
+      LP_COUNT(nr_tile_clear_skipped);
+   }
+   else {
+      task->clear_zs_value = value;
+      task->clear_zs_mask = mask;
+      task->clear_zs_pending = TRUE;
+   }
+}
+
+
+/**
+ * Write the pending clears of the current tile before the command cmd
+ * runs, or at the end of the tile if cmd is LP_RAST_OP_MAX.
+ *
+ * An opaque shader overwrites the whole color tile without looking at
+ * depth and stencil, so a pending color clear is dropped instead, and a
+ * pending z/stencil clear stays pending.
+ */
+static void
+lp_rast_resolve_clears(struct lp_rasterizer_task *task,
+                       unsigned cmd, const union lp_rast_cmd_arg arg)
+{
+   const boolean opaque = (cmd == LP_RAST_OP_SHADE_TILE_OPAQUE &&
+                           task->state &&
+                           !arg.shade_tile->disable &&
+                           task->scene->fb_max_layer == 0);
+
+   if (task->clear_color_pending) {
+      task->clear_color_pending = FALSE;
+      if (opaque)
+         LP_COUNT(nr_tile_clear_skipped);
+      else
+         do_clear_color(task, &task->clear_color);
+   }
+
+   if (task->clear_zs_pending && !opaque) {
+      task->clear_zs_pending = FALSE;
+      do_clear_zstencil(task, task->clear_zs_value, task->clear_zs_mask);
+   }
+}
+
+
 
 /**
  * Run the shader on all blocks in a tile.  This is used when a tile is
@@ -328,7 +451,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
-   unsigned x, y;
+   unsigned x, y, bx, by;
 
    if (inputs->disable) {
       /* This command was partially binned and has been disabled */
@@ -344,44 +467,59 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
-   /* render the whole 64x64 tile in 4x4 chunks */
-   for (y = 0; y < task->height; y += 4){
-      for (x = 0; x < task->width; x += 4) {
-         uint8_t *color[PIPE_MAX_COLOR_BUFS];
-         unsigned stride[PIPE_MAX_COLOR_BUFS];
-         uint8_t *depth = NULL;
-         unsigned depth_stride = 0;
-         unsigned i;
-
-         /* color buffer */
-         for (i = 0; i < scene->fb.nr_cbufs; i++){
-            stride[i] = scene->cbufs[i].stride;
-            color[i] = lp_rast_get_unswizzled_color_block_pointer(task, i, tile_x + x,
-                                                                  tile_y + y, inputs->layer);
-         }
+   /* render the whole tile in 4x4 chunks, skipping the 16x16
+    * blocks which are hidden
+    */
+   for (by = 0; by < task->height; by += LP_HIZ_BLOCK_SIZE) {
+      for (bx = 0; bx < task->width; bx += LP_HIZ_BLOCK_SIZE) {
+         const unsigned x_end = MIN2(bx + LP_HIZ_BLOCK_SIZE, task->width);
+         const unsigned y_end = MIN2(by + LP_HIZ_BLOCK_SIZE, task->height);
+
+         if (lp_rast_hiz_reject(task, inputs, tile_x + bx, tile_y + by,
+                                LP_HIZ_BLOCK_SIZE))
+            continue;
+
+         for (y = by; y < y_end; y += 4) {
+            for (x = bx; x < x_end; x += 4) {
+               uint8_t *color[PIPE_MAX_COLOR_BUFS];
+               unsigned stride[PIPE_MAX_COLOR_BUFS];
+               uint8_t *depth = NULL;
+               unsigned depth_stride = 0;
+               unsigned i;
+
+               /* color buffer */
+               for (i = 0; i < scene->fb.nr_cbufs; i++){
+                  stride[i] = scene->cbufs[i].stride;
+                  color[i] = lp_rast_get_unswizzled_color_block_pointer(task, i, tile_x + x,
+                                                                        tile_y + y, inputs->layer);
+               }
+
+               /* depth buffer */
+               if (scene->zsbuf.map) {
+                  depth = lp_rast_get_unswizzled_depth_block_pointer(task, tile_x + x,
+                                                                     tile_y + y, inputs->layer);
+                  depth_stride = scene->zsbuf.stride;
+               }
 
-         /* depth buffer */
-         if (scene->zsbuf.map) {
-            depth = lp_rast_get_unswizzled_depth_block_pointer(task, tile_x + x,
-                                                               tile_y + y, inputs->layer);
-            depth_stride = scene->zsbuf.stride;
+               /* run shader on 4x4 block */
+               BEGIN_JIT_CALL(state, task);
+               variant->jit_function[RAST_WHOLE]( &state->jit_context,
+                                                  tile_x + x, tile_y + y,
+                                                  inputs->frontfacing,
+                                                  GET_A0(inputs),
+                                                  GET_DADX(inputs),
+                                                  GET_DADY(inputs),
+                                                  color,
+                                                  depth,
+                                                  0xffff,
+                                                  &task->thread_data,
+                                                  stride,
+                                                  depth_stride);
+               END_JIT_CALL();
+            }
          }
 
-         /* run shader on 4x4 block */
-         BEGIN_JIT_CALL(state, task);
-         variant->jit_function[RAST_WHOLE]( &state->jit_context,
-                                            tile_x + x, tile_y + y,
-                                            inputs->frontfacing,
-                                            GET_A0(inputs),
-                                            GET_DADX(inputs),
-                                            GET_DADY(inputs),
-                                            color,
-                                            depth,
-                                            0xffff,
-                                            &task->thread_data,
-                                            stride,
-                                            depth_stride);
-         END_JIT_CALL();
+         lp_rast_hiz_written(task, tile_x + bx, tile_y + by);
       }
    }
 }
@@ -431,8 +569,8 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
    assert(state);
 
    /* Sanity checks */
-   assert(x < scene->tiles_x * TILE_SIZE);
-   assert(y < scene->tiles_y * TILE_SIZE);
+   assert(x < scene->tiles_x * scene->tile_size);
+   assert(y < scene->tiles_y * scene->tile_size);
    assert(x % TILE_VECTOR_WIDTH == 0);
    assert(y % TILE_VECTOR_HEIGHT == 0);
 
@@ -457,7 +595,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
-   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+   if (x - task->x < task->width && y - task->y < task->height) {
       /* not very accurate would need a popcount on the mask */
       /* always count this not worth bothering? */
       task->ps_invocations += 1 * variant->ps_inv_multiplier;
@@ -477,10 +615,125 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                                             stride,
                                             depth_stride);
       END_JIT_CALL();
+
+      lp_rast_hiz_written(task, x, y);
    }
 }
 
 
+/**
+ * Recompute the coarse depth of one 16x16 block from the depth buffer.
+ */
+static void
+lp_rast_hiz_update(struct lp_rasterizer_task *task, unsigned block)
+{
+   const struct lp_scene *scene = task->scene;
+   const unsigned bx = (block % LP_HIZ_BLOCKS_X) * LP_HIZ_BLOCK_SIZE;
+   const unsigned by = (block / LP_HIZ_BLOCKS_X) * LP_HIZ_BLOCK_SIZE;
+   float z[LP_HIZ_BLOCK_SIZE * LP_HIZ_BLOCK_SIZE];
+   float zmax = -1.0f;   /* for blocks outside the framebuffer */
+
+   if (bx < task->width && by < task->height) {
+      const struct util_format_description *desc =
+         util_format_description(scene->fb.zsbuf->format);
+      const unsigned w = MIN2(task->width - bx, LP_HIZ_BLOCK_SIZE);
+      const unsigned h = MIN2(task->height - by, LP_HIZ_BLOCK_SIZE);
+      unsigned i, j;
+
+      desc->unpack_z_float(z, LP_HIZ_BLOCK_SIZE * sizeof z[0],
+                           lp_rast_get_unswizzled_depth_block_pointer(
+                              task, task->x + bx, task->y + by, 0),
+                           scene->zsbuf.stride, w, h);
+
+      /* NaNs are skipped; LESS and LEQUAL fail against them anyway */
+      for (j = 0; j < h; j++) {
+         for (i = 0; i < w; i++) {
+            if (z[j * LP_HIZ_BLOCK_SIZE + i] > zmax)
+               zmax = z[j * LP_HIZ_BLOCK_SIZE + i];
+         }
+      }
+   }
+
+   task->hiz_max[block] = zmax;
+   task->hiz_valid |= (uint64_t)1 << block;
+   task->hiz_exact |= (uint64_t)1 << block;
+}
+
+
+/**
+ * Test the size x size block at x, y (window coords) against the coarse
+ * depth.  Returns TRUE if the primitive's depth is larger than everything
+ * in the depth buffer there, so that LESS and LEQUAL fail for all of it.
+ *
+ * The primitive's depth is bounded by evaluating its z plane at the
+ * corners of the block grown by one pixel, which covers either pixel
+ * center convention.  Bounds which went stale through depth writes are
+ * only recomputed if the stale ones don't reject already.
+ */
+boolean
+lp_rast_hiz_test(struct lp_rasterizer_task *task,
+                 const struct lp_rast_shader_inputs *inputs,
+                 int x, int y, unsigned size)
+{
+   /* covers unorm rounding and float error in the plane evaluation */
+   const float epsilon = 1.0f / 16384.0f;
+   const float (*a0)[4] = GET_A0(inputs);
+   const float (*dadx)[4] = GET_DADX(inputs);
+   const float (*dady)[4] = GET_DADY(inputs);
+   const unsigned tx = x - task->x, ty = y - task->y;
+   const unsigned bx0 = tx / LP_HIZ_BLOCK_SIZE;
+   const unsigned by0 = ty / LP_HIZ_BLOCK_SIZE;
+   const unsigned bx1 = MIN2((tx + size - 1) / LP_HIZ_BLOCK_SIZE,
+                             LP_HIZ_BLOCKS_X - 1);
+   const unsigned by1 = MIN2((ty + size - 1) / LP_HIZ_BLOCK_SIZE,
+                             LP_HIZ_BLOCKS_X - 1);
+   float zmin, zmax;
+   uint64_t stale = 0;
+   unsigned bx, by;
+
+   zmin = a0[0][2] + dadx[0][2] * (x - 1) + dady[0][2] * (y - 1);
+   zmin += MIN2(dadx[0][2] * (size + 2), 0.0f);
+   zmin += MIN2(dady[0][2] * (size + 2), 0.0f);
+   /* unorm depth is clamped */
+   zmin = MIN2(zmin, 1.0f);
+
+   zmax = -1.0f;
+   for (by = by0; by <= by1; by++) {
+      for (bx = bx0; bx <= bx1; bx++) {
+         const unsigned block = by * LP_HIZ_BLOCKS_X + bx;
+
+         if (!(task->hiz_valid & ((uint64_t)1 << block)))
+            lp_rast_hiz_update(task, block);
+         else if (!(task->hiz_exact & ((uint64_t)1 << block)))
+            stale |= (uint64_t)1 << block;
+
+         zmax = MAX2(zmax, task->hiz_max[block]);
+      }
+   }
+
+   if (!(zmin > zmax + epsilon) && stale) {
+      zmax = -1.0f;
+      for (by = by0; by <= by1; by++) {
+         for (bx = bx0; bx <= bx1; bx++) {
+            const unsigned block = by * LP_HIZ_BLOCKS_X + bx;
+
+            if (stale & ((uint64_t)1 << block))
+               lp_rast_hiz_update(task, block);
+
+            zmax = MAX2(zmax, task->hiz_max[block]);
+         }
+      }
+   }
+
+   if (zmin > zmax + epsilon) {
+      LP_COUNT(nr_hiz_rejected);
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
 
 /**
  * Begin a new occlusion query.
@@ -492,25 +745,27 @@ lp_rast_begin_query(struct lp_rasterizer_task *task,
                     const union lp_rast_cmd_arg arg)
 {
    struct llvmpipe_query *pq = arg.query_obj;
+   union lp_query_thread *t = &pq->threads[task->thread_index];
 
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
-      pq->start[task->thread_index] = task->thread_data.vis_counter;
+      t->c.start = task->thread_data.vis_counter;
       break;
    case PIPE_QUERY_PIPELINE_STATISTICS:
-      pq->start[task->thread_index] = task->ps_invocations;
+      t->c.start = task->ps_invocations;
       break;
    default:
       assert(0);
       break;
    }
+   t->c.active = TRUE;
 }
 
 
 /**
- * End the current occlusion query.
- * This is a bin command put in all bins.
+ * End the current occlusion query, in the current bin: at the end of the
+ * tile, and where it was ended.
  * Called per thread.
  */
 static void
@@ -518,21 +773,24 @@ lp_rast_end_query(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
    struct llvmpipe_query *pq = arg.query_obj;
+   union lp_query_thread *t = &pq->threads[task->thread_index];
 
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
-      pq->end[task->thread_index] +=
-         task->thread_data.vis_counter - pq->start[task->thread_index];
-      pq->start[task->thread_index] = 0;
+      if (t->c.active) {
+         t->c.end += task->thread_data.vis_counter - t->c.start;
+         t->c.active = FALSE;
+      }
       break;
    case PIPE_QUERY_TIMESTAMP:
-      pq->end[task->thread_index] = os_time_get_nano();
+      t->c.end = os_time_get_nano();
       break;
    case PIPE_QUERY_PIPELINE_STATISTICS:
-      pq->end[task->thread_index] +=
-         task->ps_invocations - pq->start[task->thread_index];
-      pq->start[task->thread_index] = 0;
+      if (t->c.active) {
+         t->c.end += task->ps_invocations - t->c.start;
+         t->c.active = FALSE;
+      }
       break;
    default:
       assert(0);
@@ -541,11 +799,64 @@ lp_rast_end_query(struct lp_rasterizer_task *task,
 }
 
 
+/**
+ * The EndQuery bin command, put in all bins.
+ * The last bin to get here makes the result available, and wakes up
+ * whoever waits for it.
+ */
+static void
+lp_rast_end_query_cmd(struct lp_rasterizer_task *task,
+                      const union lp_rast_cmd_arg arg)
+{
+   struct llvmpipe_query *pq = arg.query_obj;
+
+   lp_rast_end_query(task, arg);
+
+   if (p_atomic_dec_zero(&pq->bins_pending))
+      lp_fence_wake(task->scene->fence);
+}
+
+
 void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
+   const struct lp_fragment_shader_variant *variant;
+   const struct lp_fragment_shader_variant_key *key;
+   boolean lowers;
+
    task->state = arg.state;
+
+   task->hiz_test = FALSE;
+   task->hiz_write = LP_HIZ_WRITE_NONE;
+
+   if (!task->scene->hiz || !task->state)
+      return;
+
+   variant = task->state->variant;
+   key = &variant->key;
+
+   if (!key->depth.enabled)
+      return;
+
+   /* Depth written by the shader can be anything. */
+   lowers = !variant->shader->info.base.writes_z &&
+            (key->depth.func == PIPE_FUNC_LESS ||
+             key->depth.func == PIPE_FUNC_LEQUAL ||
+             key->depth.func == PIPE_FUNC_EQUAL ||
+             key->depth.func == PIPE_FUNC_NEVER);
+
+   if (key->depth.writemask)
+      task->hiz_write = lowers ? LP_HIZ_WRITE_LOWER : LP_HIZ_WRITE_ANY;
+
+   /* Skipped fragments must not have had any effect, and stencil
+    * operations act on depth test failures too.
+    */
+   task->hiz_test = (!variant->shader->info.base.writes_z &&
+                     (key->depth.func == PIPE_FUNC_LESS ||
+                      key->depth.func == PIPE_FUNC_LEQUAL) &&
+                     !key->stencil[0].enabled &&
+                     !key->stencil[1].enabled);
 }
 
 
@@ -556,8 +867,11 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
 static void
 lp_rast_tile_end(struct lp_rasterizer_task *task)
 {
+   union lp_rast_cmd_arg dummy = {0};
    unsigned i;
 
+   lp_rast_resolve_clears(task, LP_RAST_OP_MAX, dummy);
+
    for (i = 0; i < task->scene->num_active_queries; ++i) {
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
@@ -587,7 +901,7 @@ static lp_rast_cmd_func dispatch[LP_RAST_OP_MAX] =
    lp_rast_shade_tile,
    lp_rast_shade_tile_opaque,
    lp_rast_begin_query,
-   lp_rast_end_query,
+   lp_rast_end_query_cmd,
    lp_rast_set_state,
 };
 
@@ -601,11 +915,19 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
    unsigned k;
 
    if (0)
-      lp_debug_bin(bin, x, y);
+      lp_debug_bin(bin, x, y, task->scene->tile_size);
 
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
-         dispatch[block->cmd[k]]( task, block->arg[k] );
+         const unsigned cmd = block->cmd[k];
+
+         /* the commands which draw into the tile */
+         if (cmd >= LP_RAST_OP_TRIANGLE_1 &&
+             cmd <= LP_RAST_OP_SHADE_TILE_OPAQUE &&
+             (task->clear_color_pending || task->clear_zs_pending))
+            lp_rast_resolve_clears(task, cmd, block->arg[k]);
+
+         dispatch[cmd]( task, block->arg[k] );
       }
    }
 }
@@ -662,6 +984,8 @@ static void
 rasterize_scene(struct lp_rasterizer_task *task,
                 struct lp_scene *scene)
 {
+   int64_t start = os_time_get();
+
    task->scene = scene;
 
    if (!task->rast->no_rast && !scene->discard) {
@@ -671,7 +995,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->thread_index,
+                                                &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
@@ -679,11 +1004,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
 
-   if (scene->fence) {
-      lp_fence_signal(scene->fence);
-   }
-
    task->scene = NULL;
+   task->busy_time += os_time_get() - start;
 }
 
 
@@ -731,20 +1053,137 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * Read the rasterizer's totals.  They are updated by the rasterizer
+ * threads without locking, so they may lag by a scene.
+ */
 void
-lp_rast_finish( struct lp_rasterizer *rast )
+lp_rast_get_stats( struct lp_rasterizer *rast,
+                   struct lp_rast_stats *stats )
 {
-   if (rast->num_threads == 0) {
-      /* nothing to do */
+   unsigned i;
+
+   stats->num_scenes = rast->num_scenes;
+   stats->raster_time = rast->raster_time;
+   stats->num_threads = MAX2(rast->num_threads, 1);
+   stats->busy_time = 0;
+   for (i = 0; i < stats->num_threads; i++)
+      stats->busy_time += rast->tasks[i].busy_time;
+}
+
+
+/**
+ * Socket of a CPU, from sysfs.  CPUs without topology info count as
+ * socket 0.
+ */
+static unsigned
+cpu_package(unsigned cpu)
+{
+   unsigned package = 0;
+#if defined(PIPE_OS_LINUX)
+   char path[128];
+   FILE *f;
+
+   util_snprintf(path, sizeof path,
+                 "/sys/devices/system/cpu/cpu%u/topology/physical_package_id",
+                 cpu);
+   f = fopen(path, "r");
+   if (f) {
+      if (fscanf(f, "%u", &package) != 1)
+         package = 0;
+      fclose(f);
    }
-   else {
-      int i;
+#endif
+   return package;
+}
 
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
+
+/**
+ * Choose the CPU each rasterizer thread gets pinned to.
+ *
+ * The CPUs are ordered by socket then number for a compact placement,
+ * or by their rank within the socket then socket for a scattered one,
+ * and thread i takes the i-th CPU of that order.
+ */
+static void
+init_thread_cpus(struct lp_rasterizer *rast,
+                 enum lp_thread_affinity affinity)
+{
+   unsigned nr_cpus = util_cpu_caps.nr_cpus;
+   unsigned *key, *order;
+   unsigned i, j;
+
+   for (i = 0; i < Elements(rast->tasks); i++)
+      rast->tasks[i].cpu = -1;
+
+#if defined(PIPE_OS_LINUX)
+   if (affinity == LP_THREAD_AFFINITY_NONE || nr_cpus < 2)
+      return;
+
+   key = MALLOC(nr_cpus * sizeof *key);
+   order = MALLOC(nr_cpus * sizeof *order);
+   if (!key || !order)
+      goto out;
+
+   for (i = 0; i < nr_cpus; i++)
+      key[i] = cpu_package(i);
+
+   if (affinity == LP_THREAD_AFFINITY_SCATTER) {
+      for (i = nr_cpus; i-- > 0;) {
+         unsigned rank = 0;
+         for (j = 0; j < i; j++)
+            rank += key[j] == key[i];
+         key[i] = (rank << 16) | key[i];
       }
    }
+   else {
+      for (i = 0; i < nr_cpus; i++)
+         key[i] = (key[i] << 16) | i;
+   }
+
+   /* insertion sort, there are only a few hundred CPUs at most */
+   for (i = 0; i < nr_cpus; i++) {
+      for (j = i; j > 0 && key[order[j - 1]] > key[i]; j--)
+         order[j] = order[j - 1];
+      order[j] = i;
+   }
+
+   for (i = 0; i < rast->num_threads; i++)
+      rast->tasks[i].cpu = order[i % nr_cpus];
+
+out:
+   FREE(key);
+   FREE(order);
+#else
+   (void) affinity;
+   (void) nr_cpus;
+   (void) key;
+   (void) order;
+   (void) j;
+#endif
+}
+
+
+/**
+ * Pin the calling thread to the given CPU.  Memory the thread touches
+ * first afterwards is then allocated on that CPU's node.
+ */
+static void
+pin_thread(int cpu)
+{
+#if defined(PIPE_OS_LINUX)
+   cpu_set_t set;
+
+   if (cpu < 0)
+      return;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+   if (sched_setaffinity(0, sizeof set, &set) != 0)
+      debug_printf("llvmpipe: couldn't pin thread to cpu %d\n", cpu);
+#else
+   (void) cpu;
+#endif
 }
 
 
@@ -753,7 +1192,7 @@ lp_rast_finish( struct lp_rasterizer *rast )
  * It's a simple loop:
  *   1. wait for work
  *   2. do work
- *   3. signal that we're done
+ *   3. thread[0] signals the scene's fence
  */
 static PIPE_THREAD_ROUTINE( thread_function, init_data )
 {
@@ -762,6 +1201,8 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
    boolean debug = false;
    unsigned fpstate = util_fpstate_get();
 
+   pin_thread(task->cpu);
+
    /* Make sure that denorms are treated like zeros. This is 
     * the behavior required by D3D10. OpenGL doesn't care.
     */
@@ -800,17 +1241,15 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       /* wait for all threads to finish with this scene */
       pipe_barrier_wait( &rast->barrier );
 
-      /* XXX: shouldn't be necessary:
+      /* thread[0]: unmap the framebuffer, free the scene's data and
+       * signal its fence
        */
       if (task->thread_index == 0) {
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
    return NULL;
@@ -828,7 +1267,6 @@ create_rast_threads(struct lp_rasterizer *rast)
    /* NOTE: if num_threads is zero, we won't use any threads */
    for (i = 0; i < rast->num_threads; i++) {
       pipe_semaphore_init(&rast->tasks[i].work_ready, 0);
-      pipe_semaphore_init(&rast->tasks[i].work_done, 0);
       rast->threads[i] = pipe_thread_create(thread_function,
                                             (void *) &rast->tasks[i]);
    }
@@ -840,9 +1278,10 @@ create_rast_threads(struct lp_rasterizer *rast)
  * Create new lp_rasterizer.  If num_threads is zero, don't create any
  * new threads, do rendering synchronously.
  * \param num_threads  number of rasterizer threads to create
+ * \param affinity  how to pin the threads to CPUs
  */
 struct lp_rasterizer *
-lp_rast_create( unsigned num_threads )
+lp_rast_create( unsigned num_threads, enum lp_thread_affinity affinity )
 {
    struct lp_rasterizer *rast;
    unsigned i;
@@ -864,6 +1303,7 @@ lp_rast_create( unsigned num_threads )
    }
 
    rast->num_threads = num_threads;
+   init_thread_cpus(rast, affinity);
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
@@ -906,7 +1346,6 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
    /* Clean up per-thread data */
    for (i = 0; i < rast->num_threads; i++) {
       pipe_semaphore_destroy(&rast->tasks[i].work_ready);
-      pipe_semaphore_destroy(&rast->tasks[i].work_done);
    }
 
    /* for synchronizing rasterization threads */
@@ -142,8 +142,18 @@ struct lp_rast_triangle {
 
 
 
+/**
+ * How rasterizer threads are pinned to CPUs (LP_THREAD_AFFINITY).
+ */
+enum lp_thread_affinity {
+   LP_THREAD_AFFINITY_NONE,     /**< leave placement to the OS */
+   LP_THREAD_AFFINITY_COMPACT,  /**< fill one socket before the next */
+   LP_THREAD_AFFINITY_SCATTER   /**< round-robin over the sockets */
+};
+
+
 struct lp_rasterizer *
-lp_rast_create( unsigned num_threads );
+lp_rast_create( unsigned num_threads, enum lp_thread_affinity affinity );
 
 void
 lp_rast_destroy( struct lp_rasterizer * );
@@ -152,8 +162,20 @@ void
 lp_rast_queue_scene( struct lp_rasterizer *rast,
                      struct lp_scene *scene );
 
+
+/**
+ * Running totals of the rasterizer, for the driver queries.
+ */
+struct lp_rast_stats {
+   uint64_t num_scenes;
+   int64_t raster_time;  /**< from begin to end of each scene, usecs */
+   int64_t busy_time;  /**< sum over the threads of their time on scenes */
+   unsigned num_threads;
+};
+
 void
-lp_rast_finish( struct lp_rasterizer *rast );
+lp_rast_get_stats( struct lp_rasterizer *rast,
+                   struct lp_rast_stats *stats );
 
 
 union lp_rast_cmd_arg {
@@ -7,7 +7,8 @@ struct tile {
    int coverage;
    int overdraw;
    const struct lp_rast_state *state;
-   char data[TILE_SIZE][TILE_SIZE];
+   int size;
+   char data[LP_MAX_TILE_SIZE][LP_MAX_TILE_SIZE];
 };
 
 static char get_label( int i )
@@ -138,7 +139,7 @@ debug_shade_tile(int x, int y,
 {
    const struct lp_rast_shader_inputs *inputs = arg.shade_tile;
    boolean blend;
-   unsigned i,j;
+   int i, j;
 
    if (!tile->state)
       return 0;
@@ -148,11 +149,11 @@ debug_shade_tile(int x, int y,
    if (inputs->disable)
       return 0;
 
-   for (i = 0; i < TILE_SIZE; i++)
-      for (j = 0; j < TILE_SIZE; j++)
+   for (i = 0; i < tile->size; i++)
+      for (j = 0; j < tile->size; j++)
          plot(tile, i, j, val, blend);
 
-   return TILE_SIZE * TILE_SIZE;
+   return tile->size * tile->size;
 }
 
 static int
@@ -161,13 +162,13 @@ debug_clear_tile(int x, int y,
                  struct tile *tile,
                  char val)
 {
-   unsigned i,j;
+   int i, j;
 
-   for (i = 0; i < TILE_SIZE; i++)
-      for (j = 0; j < TILE_SIZE; j++)
+   for (i = 0; i < tile->size; i++)
+      for (j = 0; j < tile->size; j++)
          plot(tile, i, j, val, FALSE);
 
-   return TILE_SIZE * TILE_SIZE;
+   return tile->size * tile->size;
 
 }
 
@@ -200,9 +201,9 @@ debug_triangle(int tilex, int tiley,
       nr_planes++;
    }
 
-   for(y = 0; y < TILE_SIZE; y++)
+   for(y = 0; y < tile->size; y++)
    {
-      for(x = 0; x < TILE_SIZE; x++)
+      for(x = 0; x < tile->size; x++)
       {
          for (i = 0; i < nr_planes; i++)
             if (plane[i].c <= 0)
@@ -217,7 +218,7 @@ debug_triangle(int tilex, int tiley,
       }
 
       for (i = 0; i < nr_planes; i++) {
-         plane[i].c += plane[i].dcdx * TILE_SIZE;
+         plane[i].c += plane[i].dcdx * tile->size;
          plane[i].c += plane[i].dcdy;
       }
    }
@@ -232,15 +233,17 @@ static void
 do_debug_bin( struct tile *tile,
               const struct cmd_bin *bin,
               int x, int y,
+              unsigned tile_size,
               boolean print_cmds)
 {
    unsigned k, j = 0;
    const struct cmd_block *block;
 
-   int tx = x * TILE_SIZE;
-   int ty = y * TILE_SIZE;
+   int tx = x * tile_size;
+   int ty = y * tile_size;
 
    memset(tile->data, ' ', sizeof tile->data);
+   tile->size = tile_size;
    tile->coverage = 0;
    tile->overdraw = 0;
    tile->state = NULL;
@@ -287,17 +290,17 @@ do_debug_bin( struct tile *tile,
 }
 
 void
-lp_debug_bin( const struct cmd_bin *bin, int i, int j)
+lp_debug_bin( const struct cmd_bin *bin, int i, int j, unsigned tile_size)
 {
    struct tile tile;
    int x,y;
 
    if (bin->head) {
-      do_debug_bin(&tile, bin, i, j, TRUE);
+      do_debug_bin(&tile, bin, i, j, tile_size, TRUE);
 
       debug_printf("------------------------------------------------------------------\n");
-      for (y = 0; y < TILE_SIZE; y++) {
-         for (x = 0; x < TILE_SIZE; x++) {
+      for (y = 0; y < tile.size; y++) {
+         for (x = 0; x < tile.size; x++) {
             debug_printf("%c", tile.data[y][x]);
          }
          debug_printf("|\n");
@@ -333,6 +336,7 @@ lp_scene_bin_size( const struct lp_scene *scene, unsigned x, unsigned y )
 void
 lp_debug_draw_bins_by_coverage( struct lp_scene *scene )
 {
+   const int tile_area = scene->tile_size * scene->tile_size;
    unsigned x, y;
    unsigned total = 0;
    unsigned possible = 0;
@@ -350,17 +354,17 @@ lp_debug_draw_bins_by_coverage( struct lp_scene *scene )
          struct tile tile;
 
          if (bin->head) {
-            //lp_debug_bin(bin, x, y);
+            //lp_debug_bin(bin, x, y, scene->tile_size);
 
-            do_debug_bin(&tile, bin, x, y, FALSE);
+            do_debug_bin(&tile, bin, x, y, scene->tile_size, FALSE);
 
             total += tile.coverage;
-            possible += 64*64;
+            possible += tile_area;
 
-            if (tile.coverage == 64*64)
+            if (tile.coverage == tile_area)
                debug_printf("*");
             else if (tile.coverage) {
-               int bit = tile.coverage/(64.0*64.0)*10;
+               int bit = tile.coverage/(double)tile_area*10;
                debug_printf("%c", bits[MIN2(bit,10)]);
             }
             else
@@ -42,6 +42,17 @@
 #define TILE_VECTOR_HEIGHT 4
 #define TILE_VECTOR_WIDTH 4
 
+/** Size of the blocks of the coarse depth buffer */
+#define LP_HIZ_BLOCK_SIZE 16
+#define LP_HIZ_BLOCKS_X (LP_MAX_TILE_SIZE / LP_HIZ_BLOCK_SIZE)
+
+/** How drawing with the current state can change depth values */
+enum lp_hiz_write {
+   LP_HIZ_WRITE_NONE,
+   LP_HIZ_WRITE_LOWER,  /**< only to smaller values: LESS, LEQUAL, ... */
+   LP_HIZ_WRITE_ANY
+};
+
 /* If we crash in a jitted function, we can examine jit_line and jit_state
  * to get some info.  This is not thread-safe, however.
  */
@@ -91,26 +102,52 @@ struct lp_rasterizer_task
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
 
+   /**
+    * Clears of the current tile which weren't written to memory yet.
+    * They are written before the first command which reads or partially
+    * writes the tile, or at the end of the tile.
+    */
+   boolean clear_color_pending;
+   boolean clear_zs_pending;
+   union pipe_color_union clear_color;
+   uint64_t clear_zs_value;
+   uint64_t clear_zs_mask;
+
    /** "back" pointer */
    struct lp_rasterizer *rast;
 
    /** "my" index */
    unsigned thread_index;
 
+   /** CPU this thread is pinned to, or -1 */
+   int cpu;
+
+   /** Time spent in rasterize_scene(), in usecs */
+   int64_t busy_time;
+
    /* occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   /**
+    * Coarse depth of the current tile: an upper bound of the depth values
+    * in each 16x16 block, see lp_rast_hiz_test().
+    */
+   float hiz_max[LP_HIZ_BLOCKS_X * LP_HIZ_BLOCKS_X];
+   uint64_t hiz_valid;  /**< blocks whose hiz_max is a bound */
+   uint64_t hiz_exact;  /**< blocks whose hiz_max is the maximum */
+   boolean hiz_test;    /**< may blocks be rejected with the current state? */
+   enum lp_hiz_write hiz_write;
+
    pipe_semaphore work_ready;
-   pipe_semaphore work_done;
 };
 
 
 /**
  * This is the state required while rasterizing tiles.
  * Note that this contains per-thread information too.
- * The tile size is TILE_SIZE x TILE_SIZE pixels.
+ * The tile size is scene->tile_size x scene->tile_size pixels.
  */
 struct lp_rasterizer
 {
@@ -122,6 +159,11 @@ struct lp_rasterizer
 
    /** The scene currently being rasterized by the threads */
    struct lp_scene *curr_scene;
+   int64_t curr_scene_start;
+
+   /** Scenes rasterized so far, and the time they took in total */
+   uint64_t num_scenes;
+   int64_t raster_time;
 
    /** A task object for each rasterization thread */
    struct lp_rasterizer_task tasks[LP_MAX_THREADS];
@@ -140,6 +182,45 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask);
 
+boolean
+lp_rast_hiz_test(struct lp_rasterizer_task *task,
+                 const struct lp_rast_shader_inputs *inputs,
+                 int x, int y, unsigned size);
+
+
+/**
+ * Can shading of the size x size block at x, y (window coords) be skipped
+ * because all of it lies behind what is in the depth buffer?
+ */
+static INLINE boolean
+lp_rast_hiz_reject(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   int x, int y, unsigned size)
+{
+   return task->hiz_test && lp_rast_hiz_test(task, inputs, x, y, size);
+}
+
+
+/**
+ * Update the coarse depth after the shader ran on the 4x4 block at x, y
+ * (window coords).
+ */
+static INLINE void
+lp_rast_hiz_written(struct lp_rasterizer_task *task,
+                    unsigned x, unsigned y)
+{
+   if (task->hiz_write != LP_HIZ_WRITE_NONE) {
+      unsigned block = ((y - task->y) / LP_HIZ_BLOCK_SIZE) * LP_HIZ_BLOCKS_X +
+                       (x - task->x) / LP_HIZ_BLOCK_SIZE;
+
+      /* smaller values keep the bound valid, but no longer exact */
+      if (task->hiz_write == LP_HIZ_WRITE_LOWER)
+         task->hiz_exact &= ~((uint64_t)1 << block);
+      else
+         task->hiz_valid &= ~((uint64_t)1 << block);
+   }
+}
+
 
 
 /**
@@ -152,10 +233,10 @@ lp_rast_get_unswizzled_color_tile_pointer(struct lp_rasterizer_task *task,
    const struct lp_scene *scene = task->scene;
    unsigned format_bytes;
 
-   assert(task->x < scene->tiles_x * TILE_SIZE);
-   assert(task->y < scene->tiles_y * TILE_SIZE);
-   assert(task->x % TILE_SIZE == 0);
-   assert(task->y % TILE_SIZE == 0);
+   assert(task->x < scene->tiles_x * scene->tile_size);
+   assert(task->y < scene->tiles_y * scene->tile_size);
+   assert(task->x % scene->tile_size == 0);
+   assert(task->y % scene->tile_size == 0);
    assert(buf < scene->fb.nr_cbufs);
 
    if (!task->color_tiles[buf]) {
@@ -180,10 +261,10 @@ lp_rast_get_unswizzled_depth_tile_pointer(struct lp_rasterizer_task *task,
    const struct lp_scene *scene = task->scene;
    unsigned format_bytes;
 
-   assert(task->x < scene->tiles_x * TILE_SIZE);
-   assert(task->y < scene->tiles_y * TILE_SIZE);
-   assert(task->x % TILE_SIZE == 0);
-   assert(task->y % TILE_SIZE == 0);
+   assert(task->x < scene->tiles_x * scene->tile_size);
+   assert(task->y < scene->tiles_y * scene->tile_size);
+   assert(task->x % scene->tile_size == 0);
+   assert(task->y % scene->tile_size == 0);
 
    if (!task->depth_tile) {
       struct pipe_surface *dbuf = scene->fb.zsbuf;
@@ -198,7 +279,7 @@ lp_rast_get_unswizzled_depth_tile_pointer(struct lp_rasterizer_task *task,
 
 
 /**
- * Get the pointer to an unswizzled 4x4 color block (within an unswizzled 64x64 tile).
+ * Get the pointer to an unswizzled 4x4 color block (within an unswizzled tile).
  * \param x, y location of 4x4 block in window coords
  */
 static INLINE uint8_t *
@@ -209,8 +290,8 @@ lp_rast_get_unswizzled_color_block_pointer(struct lp_rasterizer_task *task,
    unsigned px, py, pixel_offset, format_bytes;
    uint8_t *color;
 
-   assert(x < task->scene->tiles_x * TILE_SIZE);
-   assert(y < task->scene->tiles_y * TILE_SIZE);
+   assert(x < task->scene->tiles_x * task->scene->tile_size);
+   assert(y < task->scene->tiles_y * task->scene->tile_size);
    assert((x % TILE_VECTOR_WIDTH) == 0);
    assert((y % TILE_VECTOR_HEIGHT) == 0);
    assert(buf < task->scene->fb.nr_cbufs);
@@ -220,8 +301,8 @@ lp_rast_get_unswizzled_color_block_pointer(struct lp_rasterizer_task *task,
    color = lp_rast_get_unswizzled_color_tile_pointer(task, buf, LP_TEX_USAGE_READ_WRITE);
    assert(color);
 
-   px = x % TILE_SIZE;
-   py = y % TILE_SIZE;
+   px = x - task->x;
+   py = y - task->y;
    pixel_offset = px * format_bytes + py * task->scene->cbufs[buf].stride;
 
    color = color + pixel_offset;
@@ -236,7 +317,7 @@ lp_rast_get_unswizzled_color_block_pointer(struct lp_rasterizer_task *task,
 
 
 /**
- * Get the pointer to an unswizzled 4x4 depth block (within an unswizzled 64x64 tile).
+ * Get the pointer to an unswizzled 4x4 depth block (within an unswizzled tile).
  * \param x, y location of 4x4 block in window coords
  */
 static INLINE uint8_t *
@@ -246,8 +327,8 @@ lp_rast_get_unswizzled_depth_block_pointer(struct lp_rasterizer_task *task,
    unsigned px, py, pixel_offset, format_bytes;
    uint8_t *depth;
 
-   assert(x < task->scene->tiles_x * TILE_SIZE);
-   assert(y < task->scene->tiles_y * TILE_SIZE);
+   assert(x < task->scene->tiles_x * task->scene->tile_size);
+   assert(y < task->scene->tiles_y * task->scene->tile_size);
    assert((x % TILE_VECTOR_WIDTH) == 0);
    assert((y % TILE_VECTOR_HEIGHT) == 0);
 
@@ -256,8 +337,8 @@ lp_rast_get_unswizzled_depth_block_pointer(struct lp_rasterizer_task *task,
    depth = lp_rast_get_unswizzled_depth_tile_pointer(task, LP_TEX_USAGE_READ_WRITE);
    assert(depth);
 
-   px = x % TILE_SIZE;
-   py = y % TILE_SIZE;
+   px = x - task->x;
+   py = y - task->y;
    pixel_offset = px * format_bytes + py * task->scene->zsbuf.stride;
 
    depth = depth + pixel_offset;
@@ -306,7 +387,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
     * The rasterizer may produce fragments outside our
     * allocated 4x4 blocks hence need to filter them out here.
     */
-   if ((x % TILE_SIZE) < task->width && (y % TILE_SIZE) < task->height) {
+   if (x - task->x < task->width && y - task->y < task->height) {
       /* not very accurate would need a popcount on the mask */
       /* always count this not worth bothering? */
       task->ps_invocations += 1 * variant->ps_inv_multiplier;
@@ -326,6 +407,8 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
                                          stride,
                                          depth_stride);
       END_JIT_CALL();
+
+      lp_rast_hiz_written(task, x, y);
    }
 }
 
@@ -360,6 +443,6 @@ lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg);
  
 void
-lp_debug_bin( const struct cmd_bin *bin, int x, int y );
+lp_debug_bin( const struct cmd_bin *bin, int x, int y, unsigned tile_size );
 
 #endif
@@ -111,6 +111,48 @@ build_masks(int c,
    *partmask |= build_mask_linear(c + cdiff, dcdx, dcdy);
 }
 
+
+/**
+ * The sign bits of the planes of a triangle at 4x4 positions, or-ed
+ * together: bit i of out is set if position i is outside some plane.
+ */
+struct block_masks {
+   unsigned out;
+   unsigned part;
+};
+
+static INLINE void
+block_masks_init(struct block_masks *m)
+{
+   m->out = 0;
+   m->part = 0;
+}
+
+static INLINE void
+block_masks_add(struct block_masks *m,
+                int c, int cdiff, int dcdx, int dcdy)
+{
+   build_masks(c, cdiff, dcdx, dcdy, &m->out, &m->part);
+}
+
+static INLINE void
+block_masks_add_linear(struct block_masks *m, int c, int dcdx, int dcdy)
+{
+   m->out |= build_mask_linear(c, dcdx, dcdy);
+}
+
+static INLINE unsigned
+block_masks_out(const struct block_masks *m)
+{
+   return m->out;
+}
+
+static INLINE unsigned
+block_masks_part(const struct block_masks *m)
+{
+   return m->part;
+}
+
 void
 lp_rast_triangle_3_16(struct lp_rasterizer_task *task,
                       const union lp_rast_cmd_arg arg)
@@ -143,13 +185,32 @@ lp_rast_triangle_3_4(struct lp_rasterizer_task *task,
 #include "util/u_sse.h"
 
 
+/**
+ * The sign bits of the planes of a triangle at 4x4 positions, or-ed
+ * together: bit i of out is set if position i is outside some plane.
+ *
+ * The values of all the planes are or-ed first, which keeps the sign
+ * bits, so that the packing and movemask are done once per block rather
+ * than once per plane.
+ */
+struct block_masks {
+   __m128i out[4];
+   __m128i part[4];
+};
+
+/* The rows are spelled out, for the accumulators to stay in registers. */
+
 static INLINE void
-build_masks(int c, 
-	    int cdiff,
-	    int dcdx,
-	    int dcdy,
-	    unsigned *outmask,
-	    unsigned *partmask)
+block_masks_init(struct block_masks *m)
+{
+   const __m128i zero = _mm_setzero_si128();
+
+   m->out[0] = m->out[1] = m->out[2] = m->out[3] = zero;
+   m->part[0] = m->part[1] = m->part[2] = m->part[3] = zero;
+}
+
+static INLINE void
+block_masks_add_linear(struct block_masks *m, int c, int dcdx, int dcdy)
 {
    __m128i cstep0 = _mm_setr_epi32(c, c+dcdx, c+dcdx*2, c+dcdx*3);
    __m128i xdcdy = _mm_set1_epi32(dcdy);
@@ -160,40 +221,19 @@ build_masks(int c,
    __m128i cstep2 = _mm_add_epi32(cstep1, xdcdy);
    __m128i cstep3 = _mm_add_epi32(cstep2, xdcdy);
 
-   {
-      __m128i cstep01, cstep23, result;
-
-      cstep01 = _mm_packs_epi32(cstep0, cstep1);
-      cstep23 = _mm_packs_epi32(cstep2, cstep3);
-      result = _mm_packs_epi16(cstep01, cstep23);
-
-      *outmask |= _mm_movemask_epi8(result);
-   }
-
-
-   {
-      __m128i cio4 = _mm_set1_epi32(cdiff);
-      __m128i cstep01, cstep23, result;
-
-      cstep0 = _mm_add_epi32(cstep0, cio4);
-      cstep1 = _mm_add_epi32(cstep1, cio4);
-      cstep2 = _mm_add_epi32(cstep2, cio4);
-      cstep3 = _mm_add_epi32(cstep3, cio4);
-
-      cstep01 = _mm_packs_epi32(cstep0, cstep1);
-      cstep23 = _mm_packs_epi32(cstep2, cstep3);
-      result = _mm_packs_epi16(cstep01, cstep23);
-
-      *partmask |= _mm_movemask_epi8(result);
-   }
+   m->out[0] = _mm_or_si128(m->out[0], cstep0);
+   m->out[1] = _mm_or_si128(m->out[1], cstep1);
+   m->out[2] = _mm_or_si128(m->out[2], cstep2);
+   m->out[3] = _mm_or_si128(m->out[3], cstep3);
 }
 
-
-static INLINE unsigned
-build_mask_linear(int c, int dcdx, int dcdy)
+static INLINE void
+block_masks_add(struct block_masks *m,
+                int c, int cdiff, int dcdx, int dcdy)
 {
    __m128i cstep0 = _mm_setr_epi32(c, c+dcdx, c+dcdx*2, c+dcdx*3);
    __m128i xdcdy = _mm_set1_epi32(dcdy);
+   __m128i cio4 = _mm_set1_epi32(cdiff);
 
    /* Get values across the quad
     */
@@ -201,20 +241,43 @@ build_mask_linear(int c, int dcdx, int dcdy)
    __m128i cstep2 = _mm_add_epi32(cstep1, xdcdy);
    __m128i cstep3 = _mm_add_epi32(cstep2, xdcdy);
 
-   /* pack pairs of results into epi16
-    */
-   __m128i cstep01 = _mm_packs_epi32(cstep0, cstep1);
-   __m128i cstep23 = _mm_packs_epi32(cstep2, cstep3);
+   m->out[0] = _mm_or_si128(m->out[0], cstep0);
+   m->out[1] = _mm_or_si128(m->out[1], cstep1);
+   m->out[2] = _mm_or_si128(m->out[2], cstep2);
+   m->out[3] = _mm_or_si128(m->out[3], cstep3);
 
+   m->part[0] = _mm_or_si128(m->part[0], _mm_add_epi32(cstep0, cio4));
+   m->part[1] = _mm_or_si128(m->part[1], _mm_add_epi32(cstep1, cio4));
+   m->part[2] = _mm_or_si128(m->part[2], _mm_add_epi32(cstep2, cio4));
+   m->part[3] = _mm_or_si128(m->part[3], _mm_add_epi32(cstep3, cio4));
+}
+
+static INLINE unsigned
+sign_bits16(const __m128i *v)
+{
    /* pack into epi8, preserving sign bits
     */
-   __m128i result = _mm_packs_epi16(cstep01, cstep23);
+   __m128i v01 = _mm_packs_epi32(v[0], v[1]);
+   __m128i v23 = _mm_packs_epi32(v[2], v[3]);
+   __m128i result = _mm_packs_epi16(v01, v23);
 
    /* extract sign bits to create mask
     */
    return _mm_movemask_epi8(result);
 }
 
+static INLINE unsigned
+block_masks_out(const struct block_masks *m)
+{
+   return sign_bits16(m->out);
+}
+
+static INLINE unsigned
+block_masks_part(const struct block_masks *m)
+{
+   return sign_bits16(m->part);
+}
+
 static INLINE unsigned
 sign_bits4(const __m128i *cstep, int cdiff)
 {
@@ -35,9 +35,7 @@
  * Prototype for a 8 plane rasterizer function.  Will codegenerate
  * several of these.
  *
- * XXX: Varients for more/fewer planes.
  * XXX: Need ways of dropping planes as we descend.
- * XXX: SIMD
  */
 static void
 TAG(do_block_4)(struct lp_rasterizer_task *task,
@@ -46,15 +44,21 @@ TAG(do_block_4)(struct lp_rasterizer_task *task,
                 int x, int y,
                 const int *c)
 {
-   unsigned mask = 0xffff;
+   struct block_masks masks;
+   unsigned mask;
    int j;
 
+   block_masks_init(&masks);
+
    for (j = 0; j < NR_PLANES; j++) {
-      mask &= ~build_mask_linear(c[j] - 1, 
-				 -plane[j].dcdx,
-				 plane[j].dcdy);
+      block_masks_add_linear(&masks,
+                             c[j] - 1,
+                             -plane[j].dcdx,
+                             plane[j].dcdy);
    }
 
+   mask = ~block_masks_out(&masks) & 0xffff;
+
    /* Now pass to the shader:
     */
    if (mask)
@@ -72,11 +76,11 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
                  int x, int y,
                  const int *c)
 {
+   struct block_masks masks;
    unsigned outmask, inmask, partmask, partial_mask;
    unsigned j;
 
-   outmask = 0;                 /* outside one or more trivial reject planes */
-   partmask = 0;                /* outside one or more trivial accept planes */
+   block_masks_init(&masks);
 
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
@@ -85,13 +89,15 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
       const int ei = plane[j].dcdy - plane[j].dcdx - plane[j].eo;
       const int cio = ei * 4 - 1;
 
-      build_masks(c[j] + cox,
-		  cio - cox,
-		  dcdx, dcdy, 
-		  &outmask,   /* sign bits from c[i][0..15] + cox */
-		  &partmask); /* sign bits from c[i][0..15] + cio */
+      block_masks_add(&masks,
+                      c[j] + cox,   /* sign bits from c[i][0..15] + cox */
+                      cio - cox,    /* sign bits from c[i][0..15] + cio */
+                      dcdx, dcdy);
    }
 
+   outmask = block_masks_out(&masks);   /* outside one or more trivial reject planes */
+   partmask = block_masks_part(&masks); /* outside one or more trivial accept planes */
+
    if (outmask == 0xffff)
       return;
 
@@ -148,68 +154,54 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
 
 
 /**
- * Scan the tile in chunks and figure out which pixels to rasterize
- * for this triangle.
+ * Scan a 64x64 block in 16x16 chunks.  Only the 16x16 chunks in
+ * valid_mask are looked at, which trims the block to smaller tiles.
  */
-void
-TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
-                      const union lp_rast_cmd_arg arg)
+static void
+TAG(do_block_64)(struct lp_rasterizer_task *task,
+                 const struct lp_rast_triangle *tri,
+                 const struct lp_rast_plane *plane,
+                 int x, int y,
+                 const int *c,
+                 unsigned valid_mask)
 {
-   const struct lp_rast_triangle *tri = arg.triangle.tri;
-   unsigned plane_mask = arg.triangle.plane_mask;
-   const struct lp_rast_plane *tri_plane = GET_PLANES(tri);
-   const int x = task->x, y = task->y;
-   struct lp_rast_plane plane[NR_PLANES];
-   int c[NR_PLANES];
+   struct block_masks masks;
    unsigned outmask, inmask, partmask, partial_mask;
-   unsigned j = 0;
-
-   if (tri->inputs.disable) {
-      /* This triangle was partially binned and has been disabled */
-      return;
-   }
+   unsigned j;
 
-   outmask = 0;                 /* outside one or more trivial reject planes */
-   partmask = 0;                /* outside one or more trivial accept planes */
+   block_masks_init(&masks);
 
-   while (plane_mask) {
-      int i = ffs(plane_mask) - 1;
-      plane[j] = tri_plane[i];
-      plane_mask &= ~(1 << i);
-      c[j] = plane[j].c + plane[j].dcdy * y - plane[j].dcdx * x;
-
-      {
-	 const int dcdx = -plane[j].dcdx * 16;
-	 const int dcdy = plane[j].dcdy * 16;
-	 const int cox = plane[j].eo * 16;
-         const int ei = plane[j].dcdy - plane[j].dcdx - plane[j].eo;
-         const int cio = ei * 16 - 1;
-
-	 build_masks(c[j] + cox,
-		     cio - cox,
-		     dcdx, dcdy, 
-		     &outmask,   /* sign bits from c[i][0..15] + cox */
-		     &partmask); /* sign bits from c[i][0..15] + cio */
-      }
+   for (j = 0; j < NR_PLANES; j++) {
+      const int dcdx = -plane[j].dcdx * 16;
+      const int dcdy = plane[j].dcdy * 16;
+      const int cox = plane[j].eo * 16;
+      const int ei = plane[j].dcdy - plane[j].dcdx - plane[j].eo;
+      const int cio = ei * 16 - 1;
 
-      j++;
+      block_masks_add(&masks,
+                      c[j] + cox,   /* sign bits from c[i][0..15] + cox */
+                      cio - cox,    /* sign bits from c[i][0..15] + cio */
+                      dcdx, dcdy);
    }
 
-   if (outmask == 0xffff)
+   outmask = block_masks_out(&masks);   /* outside one or more trivial reject planes */
+   partmask = block_masks_part(&masks); /* outside one or more trivial accept planes */
+
+   if ((outmask & valid_mask) == valid_mask)
       return;
 
    /* Mask of sub-blocks which are inside all trivial accept planes:
     */
-   inmask = ~partmask & 0xffff;
+   inmask = ~partmask & valid_mask;
 
    /* Mask of sub-blocks which are inside all trivial reject planes,
     * but outside at least one trivial accept plane:
     */
-   partial_mask = partmask & ~outmask;
+   partial_mask = partmask & ~outmask & valid_mask;
 
    assert((partial_mask & inmask) == 0);
 
-   LP_COUNT_ADD(nr_empty_16, util_bitcount(0xffff & ~(partial_mask | inmask)));
+   LP_COUNT_ADD(nr_empty_16, util_bitcount(valid_mask & ~(partial_mask | inmask)));
 
    /* Iterate over partials:
     */
@@ -229,7 +221,8 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       partial_mask &= ~(1 << i);
 
       LP_COUNT(nr_partially_covered_16);
-      TAG(do_block_16)(task, tri, plane, px, py, cx);
+      if (!lp_rast_hiz_reject(task, &tri->inputs, px, py, 16))
+         TAG(do_block_16)(task, tri, plane, px, py, cx);
    }
 
    /* Iterate over fulls: 
@@ -244,7 +237,62 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       inmask &= ~(1 << i);
 
       LP_COUNT(nr_fully_covered_16);
-      block_full_16(task, tri, px, py);
+      if (!lp_rast_hiz_reject(task, &tri->inputs, px, py, 16))
+         block_full_16(task, tri, px, py);
+   }
+}
+
+
+/**
+ * Scan the tile in chunks and figure out which pixels to rasterize
+ * for this triangle.
+ */
+void
+TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
+                      const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const unsigned tile_size = task->scene->tile_size;
+   unsigned plane_mask = arg.triangle.plane_mask;
+   const struct lp_rast_plane *tri_plane = GET_PLANES(tri);
+   const int x = task->x, y = task->y;
+   struct lp_rast_plane plane[NR_PLANES];
+   int c[NR_PLANES];
+   unsigned j = 0;
+
+   if (tri->inputs.disable) {
+      /* This triangle was partially binned and has been disabled */
+      return;
+   }
+
+   while (plane_mask) {
+      int i = ffs(plane_mask) - 1;
+      plane[j] = tri_plane[i];
+      plane_mask &= ~(1 << i);
+      c[j] = plane[j].c + plane[j].dcdy * y - plane[j].dcdx * x;
+      j++;
+   }
+
+   if (tile_size <= 64) {
+      /* 32x32 tiles are the top left 2x2 chunks of a 64x64 block */
+      TAG(do_block_64)(task, tri, plane, x, y, c,
+                       tile_size == 64 ? 0xffff : 0x0033);
+   }
+   else {
+      int ix, iy;
+
+      for (iy = 0; iy < (int) task->height; iy += 64) {
+         for (ix = 0; ix < (int) task->width; ix += 64) {
+            int cx[NR_PLANES];
+
+            for (j = 0; j < NR_PLANES; j++)
+               cx[j] = (c[j]
+                        - plane[j].dcdx * ix
+                        + plane[j].dcdy * iy);
+
+            TAG(do_block_64)(task, tri, plane, x + ix, y + iy, cx, 0xffff);
+         }
+      }
    }
 }
 
@@ -293,6 +341,8 @@ TRI_16(struct lp_rasterizer_task *task,
    if (outmask == 0xffff)
       return;
 
+   if (lp_rast_hiz_reject(task, &tri->inputs, x, y, 16))
+      return;
 
    /* Mask of sub-blocks which are inside all trivial reject planes,
     * but outside at least one trivial accept plane:
@@ -337,6 +387,9 @@ TRI_4(struct lp_rasterizer_task *task,
    const int y = task->y + (mask >> 8);
    unsigned j;
 
+   if (lp_rast_hiz_reject(task, &tri->inputs, x, y, 4))
+      return;
+
    /* Iterate over partials:
     */
    {
@@ -25,15 +25,21 @@
  *
  **************************************************************************/
 
+#include <stdlib.h>
+
+#include "util/u_counter.h"
 #include "util/u_framebuffer.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
 #include "util/u_simple_list.h"
 #include "util/u_format.h"
+#include "lp_block_pool.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_screen.h"
+#include "lp_texture.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -46,6 +52,20 @@ struct resource_ref {
 };
 
 
+/**
+ * Memory a scene holds for its whole life, the rest comes from the block
+ * pool.  Counted in mem-scene.
+ */
+static size_t
+scene_fixed_size(const struct lp_scene *scene)
+{
+   unsigned max_bins = TILES_X(scene->tile_order) * TILES_Y(scene->tile_order);
+
+   return sizeof *scene + sizeof *scene->data.head +
+          max_bins * (sizeof *scene->tile + sizeof *scene->bin_order);
+}
+
+
 /**
  * Create a new scene object.
  * \param queue  the queue to put newly rendered/emptied scenes into
@@ -53,29 +73,58 @@ struct resource_ref {
 struct lp_scene *
 lp_scene_create( struct pipe_context *pipe )
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
    struct lp_scene *scene = CALLOC_STRUCT(lp_scene);
+   unsigned max_bins;
+
    if (!scene)
       return NULL;
 
    scene->pipe = pipe;
+   scene->pool = screen->block_pool;
+
+   scene->tile_order = screen->tile_order;
+   scene->tile_size = 1 << scene->tile_order;
+   max_bins = TILES_X(scene->tile_order) * TILES_Y(scene->tile_order);
 
+   /* Each halving of the tiles quadruples the bins, and their commands. */
+   scene->max_size = LP_SCENE_MAX_SIZE;
+   if (scene->tile_order < TILE_ORDER)
+      scene->max_size <<= 2 * (TILE_ORDER - scene->tile_order);
+
+   scene->tile = CALLOC(max_bins, sizeof *scene->tile);
+   scene->bin_order = MALLOC(max_bins * sizeof *scene->bin_order);
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   pipe_mutex_init(scene->mutex);
+   if (!scene->tile || !scene->bin_order || !scene->data.head) {
+      FREE(scene->tile);
+      FREE(scene->bin_order);
+      FREE(scene->data.head);
+      FREE(scene);
+      return NULL;
+   }
+
+   {
+      unsigned i;
+      for (i = 0; i < LP_MAX_THREADS; i++)
+         pipe_mutex_init(scene->queues[i].mutex);
+   }
+
+   util_counter_mem_alloc(UTIL_COUNTER_MEM_SCENE, scene_fixed_size(scene));
 
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
-      size_t maxBins = TILES_X * TILES_Y;
+      size_t maxBins = max_bins;
       size_t maxCommandBytes = sizeof(struct cmd_block) * maxBins;
       size_t maxCommandPlusData = maxCommandBytes + DATA_BLOCK_SIZE;
       /* We'll need at least one command block per bin.  Make sure that's
        * less than the max allowed scene size.
        */
-      assert(maxCommandBytes < LP_SCENE_MAX_SIZE);
+      assert(maxCommandBytes < scene->max_size);
       /* We'll also need space for at least one other data block */
-      assert(maxCommandPlusData <= LP_SCENE_MAX_SIZE);
+      assert(maxCommandPlusData <= scene->max_size);
    }
 #endif
 
@@ -89,10 +138,16 @@ lp_scene_create( struct pipe_context *pipe )
 void
 lp_scene_destroy(struct lp_scene *scene)
 {
+   unsigned i;
+
    lp_fence_reference(&scene->fence, NULL);
-   pipe_mutex_destroy(scene->mutex);
+   for (i = 0; i < LP_MAX_THREADS; i++)
+      pipe_mutex_destroy(scene->queues[i].mutex);
    assert(scene->data.head->next == NULL);
+   util_counter_mem_free(UTIL_COUNTER_MEM_SCENE, scene_fixed_size(scene));
    FREE(scene->data.head);
+   FREE(scene->bin_order);
+   FREE(scene->tile);
    FREE(scene);
 }
 
@@ -106,8 +161,8 @@ lp_scene_is_empty(struct lp_scene *scene )
 {
    unsigned x, y;
 
-   for (y = 0; y < TILES_Y; y++) {
-      for (x = 0; x < TILES_X; x++) {
+   for (y = 0; y < TILES_Y(scene->tile_order); y++) {
+      for (x = 0; x < TILES_X(scene->tile_order); x++) {
          const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
          if (bin->head) {
             return FALSE;
@@ -193,6 +248,12 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
    }
 
    scene->fb_max_layer = max_layer;
+
+   /* The coarse depth only covers the first layer. */
+   scene->hiz = (scene->zsbuf.map &&
+                 scene->fb_max_layer == 0 &&
+                 util_format_description(fb->zsbuf->format)->unpack_z_float &&
+                 !(LP_PERF & PERF_NO_HIZ));
 }
 
 
@@ -269,19 +330,32 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
-   /* Free all scene data blocks:
+   /* Return all scene data blocks to the pool:
     */
    {
       struct data_block_list *list = &scene->data;
       struct data_block *block, *tmp;
+      struct large_block *large, *next;
 
-      for (block = list->head->next; block; block = tmp) {
+      /* The last block of the list is the scene's own, see
+       * lp_scene_create().
+       */
+      for (block = list->head; block->next; block = tmp) {
          tmp = block->next;
-	 FREE(block);
+         lp_block_pool_free(scene->pool, block, sizeof *block);
       }
 
-      list->head->next = NULL;
+      list->head = block;
       list->head->used = 0;
+
+      for (large = scene->large_blocks; large; large = next) {
+         next = large->next;
+         lp_block_pool_free(scene->pool, large, large->size);
+      }
+      scene->large_blocks = NULL;
+      scene->large_size = 0;
+
+      lp_block_pool_trim(scene->pool);
    }
 
    lp_fence_reference(&scene->fence, NULL);
@@ -326,16 +400,17 @@ lp_scene_new_cmd_block( struct lp_scene *scene,
 struct data_block *
 lp_scene_new_data_block( struct lp_scene *scene )
 {
-   if (scene->scene_size + DATA_BLOCK_SIZE > LP_SCENE_MAX_SIZE) {
+   if (scene->scene_size + DATA_BLOCK_SIZE > scene->max_size) {
       if (0) debug_printf("%s: failed\n", __FUNCTION__);
       scene->alloc_failed = TRUE;
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
+      struct data_block *block =
+         lp_block_pool_alloc(scene->pool, sizeof(struct data_block));
       if (block == NULL)
          return NULL;
-      
+
       scene->scene_size += sizeof *block;
 
       block->used = 0;
@@ -347,6 +422,45 @@ lp_scene_new_data_block( struct lp_scene *scene )
 }
 
 
+/**
+ * Allocate a block of its own for an allocation too large to be packed
+ * into the data blocks.  Those have a separate budget, so that a few big
+ * constant buffers don't eat the space for the bins.
+ */
+void *
+lp_scene_alloc_large( struct lp_scene *scene, unsigned size,
+                      unsigned alignment )
+{
+   struct large_block *block;
+   unsigned block_size;
+   uintptr_t data;
+
+   if (LP_DEBUG & DEBUG_MEM)
+      debug_printf("alloc large %u tot %u/%u\n",
+                   size, scene->large_size, LP_SCENE_MAX_LARGE_SIZE);
+
+   block_size = lp_block_pool_block_size(scene->pool,
+                                         sizeof *block + alignment - 1 + size);
+
+   if (scene->large_size + block_size > LP_SCENE_MAX_LARGE_SIZE) {
+      scene->alloc_failed = TRUE;
+      return NULL;
+   }
+
+   block = lp_block_pool_alloc(scene->pool, block_size);
+   if (!block)
+      return NULL;
+
+   block->size = block_size;
+   block->next = scene->large_blocks;
+   scene->large_blocks = block;
+   scene->large_size += block_size;
+
+   data = (uintptr_t) (block + 1);
+   return (void *) ((data + alignment - 1) & ~(uintptr_t) (alignment - 1));
+}
+
+
 /**
  * Return number of bytes used for all bin data within a scene.
  * This does not include resources (textures) referenced by the scene.
@@ -356,9 +470,13 @@ lp_scene_data_size( const struct lp_scene *scene )
 {
    unsigned size = 0;
    const struct data_block *block;
+   const struct large_block *large;
    for (block = scene->data.head; block; block = block->next) {
       size += block->used;
    }
+   for (large = scene->large_blocks; large; large = large->next) {
+      size += large->size - sizeof *large;
+   }
    return size;
 }
 
@@ -445,61 +563,215 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Record the scene's fence in the resources it samples and renders to, so
+ * that CPU access to a resource waits only for the scenes using it (see
+ * llvmpipe_resource_busy_fence()).  Called with the screen's rast_mutex
+ * held, right before the scene is queued for rasterization.
+ */
+void
+lp_scene_fence_resources(struct lp_scene *scene)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
+   const struct resource_ref *ref;
+   unsigned i;
+   int j;
+
+   for (ref = scene->resources; ref; ref = ref->next) {
+      for (j = 0; j < ref->count; j++) {
+         struct llvmpipe_resource *lpr = llvmpipe_resource(ref->resource[j]);
+         lp_fence_reference(&lpr->fence, scene->fence);
+      }
    }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i]) {
+         struct llvmpipe_resource *lpr =
+            llvmpipe_resource(scene->fb.cbufs[i]->texture);
+         lp_fence_reference(&lpr->fence, scene->fence);
+         lp_fence_reference(&lpr->write_fence, scene->fence);
+      }
+   }
+
+   if (scene->fb.zsbuf) {
+      struct llvmpipe_resource *lpr =
+         llvmpipe_resource(scene->fb.zsbuf->texture);
+      lp_fence_reference(&lpr->fence, scene->fence);
+      lp_fence_reference(&lpr->write_fence, scene->fence);
    }
-   return TRUE;
 }
 
 
+/** A bin and its estimated cost, for lp_scene_bin_iter_begin() */
+struct bin_cost {
+   unsigned cost;
+   unsigned bin;
+   unsigned thread;
+};
+
+
+/** qsort callback: most expensive first, raster order among equals */
+static int
+compare_bin_cost(const void *a, const void *b)
+{
+   const struct bin_cost *ba = (const struct bin_cost *) a;
+   const struct bin_cost *bb = (const struct bin_cost *) b;
+
+   if (ba->cost != bb->cost)
+      return ba->cost > bb->cost ? -1 : 1;
+   return ba->bin < bb->bin ? -1 : ba->bin > bb->bin;
+}
+
+
+/**
+ * Distribute the non-empty bins over the queues of num_threads threads
+ * (one if zero).
+ *
+ * The cost of a bin is estimated as the number of commands binned into it.
+ * Bins are handed out most expensive first, each to the thread with the
+ * least work so far, which leaves every queue ordered from expensive to
+ * cheap.  Threads which run dry steal the cheap bins from the end of the
+ * others' queues, see lp_scene_bin_iter_next().
+ */
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_threads )
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned load[LP_MAX_THREADS];
+   unsigned count[LP_MAX_THREADS];
+   struct bin_cost *bins;
+   unsigned num_bins = 0;
+   unsigned num_queues = MAX2(num_threads, 1);
+   unsigned x, y, i, t;
+
+   assert(num_queues <= LP_MAX_THREADS);
+   scene->num_queues = num_queues;
+
+   bins = MALLOC(lp_scene_get_num_bins(scene) * sizeof *bins);
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+         const struct cmd_block *block;
+         unsigned cost = 0;
+
+         if (!bin->head)
+            continue;
+
+         for (block = bin->head; block; block = block->next)
+            cost += block->count;
+
+         if (bins) {
+            bins[num_bins].cost = cost;
+            bins[num_bins].bin = x | (y << 16);
+         }
+         else {
+            scene->bin_order[num_bins] = x | (y << 16);
+         }
+         num_bins++;
+      }
+   }
+
+   for (t = 0; t < num_queues; t++) {
+      scene->queues[t].head = 0;
+      scene->queues[t].tail = 0;
+   }
+
+   if (!bins) {
+      /* Out of memory: everything goes to the first thread, in raster
+       * order, and the others steal from it.
+       */
+      scene->queues[0].tail = num_bins;
+      return;
+   }
+
+   qsort(bins, num_bins, sizeof *bins, compare_bin_cost);
+
+   memset(load, 0, sizeof load);
+   memset(count, 0, sizeof count);
+
+   for (i = 0; i < num_bins; i++) {
+      unsigned best = 0;
+
+      for (t = 1; t < num_queues; t++) {
+         if (load[t] < load[best])
+            best = t;
+      }
+
+      /* plus one for loading and storing the tile */
+      load[best] += bins[i].cost + 1;
+      count[best]++;
+      bins[i].thread = best;
+   }
+
+   for (t = 1; t < num_queues; t++) {
+      scene->queues[t].head = scene->queues[t - 1].head + count[t - 1];
+      scene->queues[t].tail = scene->queues[t].head;
+   }
+
+   for (i = 0; i < num_bins; i++) {
+      struct lp_bin_queue *queue = &scene->queues[bins[i].thread];
+      scene->bin_order[queue->tail++] = bins[i].bin;
+   }
+
+   FREE(bins);
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
+ * Return pointer to the next bin to be rendered by the given thread.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  A thread first works through its own
+ * queue, then steals from the thread with the most bins left.  Returns
+ * NULL once all bins have been handed out.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned thread,
+                        int *x, int *y )
 {
-   struct cmd_bin *bin = NULL;
+   struct lp_bin_queue *queue;
+   unsigned bin;
 
-   pipe_mutex_lock(scene->mutex);
+   assert(thread < scene->num_queues);
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+   queue = &scene->queues[thread];
+   pipe_mutex_lock(queue->mutex);
+   if (queue->head < queue->tail) {
+      bin = scene->bin_order[queue->head++];
+      pipe_mutex_unlock(queue->mutex);
+      goto found;
    }
+   pipe_mutex_unlock(queue->mutex);
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+   for (;;) {
+      unsigned victim = 0, most = 0, i;
+
+      /* Unlocked peek: head only grows and tail only shrinks, so this can
+       * only be stale, never negative.
+       */
+      for (i = 0; i < scene->num_queues; i++) {
+         unsigned left = scene->queues[i].tail - scene->queues[i].head;
+         if (left > most) {
+            most = left;
+            victim = i;
+         }
+      }
+
+      if (!most)
+         return NULL;
+
+      queue = &scene->queues[victim];
+      pipe_mutex_lock(queue->mutex);
+      if (queue->head < queue->tail) {
+         bin = scene->bin_order[--queue->tail];
+         pipe_mutex_unlock(queue->mutex);
+         goto found;
+      }
+      pipe_mutex_unlock(queue->mutex);
+   }
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   pipe_mutex_unlock(scene->mutex);
-   return bin;
+found:
+   *x = bin & 0xffff;
+   *y = bin >> 16;
+   return lp_scene_get_bin(scene, *x, *y);
 }
 
 
@@ -511,11 +783,11 @@ void lp_scene_begin_binning( struct lp_scene *scene,
    scene->discard = discard;
    util_copy_framebuffer_state(&scene->fb, fb);
 
-   scene->tiles_x = align(fb->width, TILE_SIZE) / TILE_SIZE;
-   scene->tiles_y = align(fb->height, TILE_SIZE) / TILE_SIZE;
+   scene->tiles_x = align(fb->width, scene->tile_size) >> scene->tile_order;
+   scene->tiles_y = align(fb->height, scene->tile_size) >> scene->tile_order;
 
-   assert(scene->tiles_x <= TILES_X);
-   assert(scene->tiles_y <= TILES_Y);
+   assert(scene->tiles_x <= TILES_X(scene->tile_order));
+   assert(scene->tiles_y <= TILES_Y(scene->tile_order));
 }
 
 
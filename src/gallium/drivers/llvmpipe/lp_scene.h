@@ -38,6 +38,7 @@
 #include "os/os_thread.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
+#include "lp_limits.h"
 
 struct lp_scene_queue;
 struct lp_rast_state;
@@ -45,8 +46,8 @@ struct lp_rast_state;
 /* We're limited to 2K by 2K for 32bit fixed point rasterization.
  * Will need a 64-bit version for larger framebuffers.
  */
-#define TILES_X (LP_MAX_WIDTH / TILE_SIZE)
-#define TILES_Y (LP_MAX_HEIGHT / TILE_SIZE)
+#define TILES_X(order) (LP_MAX_WIDTH >> (order))
+#define TILES_Y(order) (LP_MAX_HEIGHT >> (order))
 
 
 /* Commands per command block (ideally so sizeof(cmd_block) is a power of
@@ -58,10 +59,18 @@ struct lp_rast_state;
  */
 #define DATA_BLOCK_SIZE (64 * 1024)
 
-/* Scene temporary storage is clamped to this size:
+/* Scene temporary storage is clamped to this size, for the default tile
+ * size.  Smaller tiles scale it up with the number of bins, see
+ * lp_scene::max_size.
  */
 #define LP_SCENE_MAX_SIZE (9*1024*1024)
 
+/* Allocations larger than this, like big constant buffers, get a block of
+ * their own, and are clamped separately to LP_SCENE_MAX_LARGE_SIZE:
+ */
+#define LP_SCENE_LARGE_ALLOC_SIZE (DATA_BLOCK_SIZE / 2)
+#define LP_SCENE_MAX_LARGE_SIZE (32*1024*1024)
+
 /* The maximum amount of texture storage referenced by a scene is
  * clamped ot this size:
  */
@@ -89,6 +98,15 @@ struct data_block {
 };
 
 
+/* A dedicated block for a single large allocation, which follows the
+ * header.
+ */
+struct large_block {
+   struct large_block *next;
+   unsigned size;  /**< as allocated from the pool, with the header */
+};
+
+
 
 /**
  * For each screen tile we have one of these bins.
@@ -100,6 +118,17 @@ struct cmd_bin {
 };
    
 
+/**
+ * Bins handed to one rasterizer thread: scene->bin_order[head..tail).
+ * The owning thread takes bins from the head, threads which ran out of
+ * work of their own steal from the tail.
+ */
+struct lp_bin_queue {
+   pipe_mutex mutex;
+   unsigned head, tail;
+};
+
+
 /**
  * This stores bulk data which is used for all memory allocations
  * within a scene.
@@ -116,6 +145,7 @@ struct data_block_list {
 };
 
 struct resource_ref;
+struct lp_block_pool;
 
 /**
  * All bins and bin data are contained here.
@@ -129,6 +159,9 @@ struct lp_scene {
    struct pipe_context *pipe;
    struct lp_fence *fence;
 
+   /** where the data blocks come from, shared by the screen's scenes */
+   struct lp_block_pool *pool;
+
    /* The queries still active at end of scene */
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
    unsigned num_active_queries;
@@ -164,19 +197,34 @@ struct lp_scene {
     */
    unsigned resource_reference_size;
 
+   /** Dedicated blocks of large allocations, and their total size */
+   struct large_block *large_blocks;
+   unsigned large_size;
+
    boolean alloc_failed;
    boolean has_depthstencil_clear;
    boolean discard;
+   boolean hiz;  /**< can the rasterizer keep a coarse depth buffer? */
    /**
     * Number of active tiles in each dimension.
     * This basically the framebuffer size divided by tile size
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   pipe_mutex mutex;
+   /** Tiles are 1 << tile_order pixels wide and high (the screen's choice) */
+   unsigned tile_order;
+   unsigned tile_size;
+
+   /** Limit of scene_size */
+   unsigned max_size;
 
-   struct cmd_bin tile[TILES_X][TILES_Y];
+   /** Non-empty bins (x | y << 16), grouped by the thread they went to */
+   unsigned *bin_order;
+   struct lp_bin_queue queues[LP_MAX_THREADS];
+   unsigned num_queues;
+
+   /** TILES_X(tile_order) x TILES_Y(tile_order) bins, row by row */
+   struct cmd_bin *tile;
    struct data_block_list data;
 };
 
@@ -192,6 +240,9 @@ boolean lp_scene_is_oom(struct lp_scene *scene );
 
 struct data_block *lp_scene_new_data_block( struct lp_scene *scene );
 
+void *lp_scene_alloc_large( struct lp_scene *scene, unsigned size,
+                            unsigned alignment );
+
 struct cmd_block *lp_scene_new_cmd_block( struct lp_scene *scene,
                                           struct cmd_bin *bin );
 
@@ -202,6 +253,8 @@ boolean lp_scene_add_resource_reference(struct lp_scene *scene,
 boolean lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                         const struct pipe_resource *resource );
 
+void lp_scene_fence_resources(struct lp_scene *scene);
+
 
 /**
  * Allocate space for a command/data in the bin's data buffer.
@@ -213,13 +266,15 @@ lp_scene_alloc( struct lp_scene *scene, unsigned size)
    struct data_block_list *list = &scene->data;
    struct data_block *block = list->head;
 
-   assert(size <= DATA_BLOCK_SIZE);
    assert(block != NULL);
 
+   if (size > LP_SCENE_LARGE_ALLOC_SIZE)
+      return lp_scene_alloc_large(scene, size, 1);
+
    if (LP_DEBUG & DEBUG_MEM)
       debug_printf("alloc %u block %u/%u tot %u/%u\n",
 		   size, block->used, DATA_BLOCK_SIZE,
-		   scene->scene_size, LP_SCENE_MAX_SIZE);
+		   scene->scene_size, scene->max_size);
 
    if (block->used + size > DATA_BLOCK_SIZE) {
       block = lp_scene_new_data_block( scene );
@@ -249,11 +304,14 @@ lp_scene_alloc_aligned( struct lp_scene *scene, unsigned size,
 
    assert(block != NULL);
 
+   if (size + alignment - 1 > LP_SCENE_LARGE_ALLOC_SIZE)
+      return lp_scene_alloc_large(scene, size, alignment);
+
    if (LP_DEBUG & DEBUG_MEM)
       debug_printf("alloc %u block %u/%u tot %u/%u\n",
 		   size + alignment - 1,
 		   block->used, DATA_BLOCK_SIZE,
-		   scene->scene_size, LP_SCENE_MAX_SIZE);
+		   scene->scene_size, scene->max_size);
        
    if (block->used + size + alignment - 1 > DATA_BLOCK_SIZE) {
       block = lp_scene_new_data_block( scene );
@@ -285,7 +343,7 @@ lp_scene_putback_data( struct lp_scene *scene, unsigned size)
 static INLINE struct cmd_bin *
 lp_scene_get_bin(struct lp_scene *scene, unsigned x, unsigned y)
 {
-   return &scene->tile[x][y];
+   return &scene->tile[y * TILES_X(scene->tile_order) + x];
 }
 
 
@@ -379,10 +437,11 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_threads );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned thread,
+                        int *x, int *y );
 
 
 
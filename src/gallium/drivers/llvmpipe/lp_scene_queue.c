@@ -38,7 +38,7 @@
 
 
 
-#define MAX_SCENE_QUEUE 4
+#define MAX_SCENE_QUEUE 16
 
 struct scene_packet {
    struct util_packet header;
@@ -35,6 +35,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
+#include "tgsi/tgsi_info.h"
 #include "gallivm/lp_bld_type.h"
 
 #include "os/os_time.h"
@@ -43,10 +44,14 @@
 #include "lp_jit.h"
 #include "lp_screen.h"
 #include "lp_context.h"
+#include "lp_state_fs.h"
 #include "lp_debug.h"
 #include "lp_public.h"
+#include "lp_query.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_block_pool.h"
+#include "lp_scene.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -80,10 +85,49 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_hiz",         PERF_NO_HIZ, NULL },
+   { "tiled_tex",      PERF_TILED_TEX, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
 
+/**
+ * Parse LP_THREAD_AFFINITY=none|compact|scatter.
+ */
+static enum lp_thread_affinity
+lp_get_thread_affinity(void)
+{
+   const char *policy = debug_get_option("LP_THREAD_AFFINITY", "none");
+
+   if (!strcmp(policy, "compact"))
+      return LP_THREAD_AFFINITY_COMPACT;
+   if (!strcmp(policy, "scatter"))
+      return LP_THREAD_AFFINITY_SCATTER;
+   if (strcmp(policy, "none"))
+      debug_printf("llvmpipe: unknown LP_THREAD_AFFINITY %s\n", policy);
+   return LP_THREAD_AFFINITY_NONE;
+}
+
+
+/**
+ * Parse LP_TILE_SIZE=32|64|128 into a tile order.
+ */
+static unsigned
+lp_get_tile_order(void)
+{
+   unsigned size = debug_get_num_option("LP_TILE_SIZE", TILE_SIZE);
+   unsigned order;
+
+   for (order = LP_MIN_TILE_ORDER; order <= LP_MAX_TILE_ORDER; order++) {
+      if (size == 1u << order)
+         return order;
+   }
+
+   debug_printf("llvmpipe: unsupported LP_TILE_SIZE %u\n", size);
+   return TILE_ORDER;
+}
+
+
 static const char *
 llvmpipe_get_vendor(struct pipe_screen *screen)
 {
@@ -233,6 +277,9 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return PIPE_MAX_VIEWPORTS;
    case PIPE_CAP_ENDIANNESS:
       return PIPE_ENDIAN_NATIVE;
+   case PIPE_CAP_SHAREABLE_STATE_OBJECTS:
+      /* state objects are plain copies of the templates */
+      return 1;
    }
    /* should only get here on unhandled cases */
    debug_printf("Unexpected PIPE_CAP %d query\n", param);
@@ -269,6 +316,43 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
    }
 }
 
+/**
+ * Everything runs on the CPU's SIMD units, so there is no separate
+ * transcendental or texture unit to overlap with.
+ */
+static void
+llvmpipe_get_shader_opcode_cost(struct pipe_screen *screen, unsigned shader,
+                                unsigned opcode, struct tgsi_opcode_cost *cost)
+{
+   switch (opcode) {
+   case TGSI_OPCODE_MAD:
+      /* no fused multiply-add */
+      cost->latency = 8;
+      cost->throughput = 2;
+      return;
+   case TGSI_OPCODE_EX2:
+   case TGSI_OPCODE_LG2:
+   case TGSI_OPCODE_SIN:
+   case TGSI_OPCODE_COS:
+   case TGSI_OPCODE_POW:
+      /* polynomial approximations */
+      cost->latency = 32;
+      cost->throughput = 24;
+      return;
+   default:
+      break;
+   }
+
+   if (cost->unit == TGSI_UNIT_TEXTURE) {
+      /* address calculation, filtering and format conversion in code */
+      cost->latency = 200;
+      cost->throughput = 150;
+   }
+   else if (cost->unit == TGSI_UNIT_TRANSCENDENTAL) {
+      cost->throughput = cost->latency;
+   }
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -403,15 +487,24 @@ static void
 llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
                            struct pipe_resource *resource,
                            unsigned level, unsigned layer,
-                           void *context_private)
+                           void *context_private,
+                           struct pipe_box *sub_box)
 {
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
+   struct lp_fence *fence;
+
+   /* rasterization of the flushed frame may still be in progress */
+   fence = llvmpipe_resource_busy_fence(_screen, resource, TRUE);
+   if (fence) {
+      lp_fence_wait(fence);
+      lp_fence_reference(&fence, NULL);
+   }
 
    assert(texture->dt);
    if (texture->dt)
-      winsys->displaytarget_display(winsys, texture->dt, context_private);
+      winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
 }
 
 
@@ -421,6 +514,9 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
 
+   lp_fs_async_cleanup(screen);
+   lp_fs_cache_cleanup(screen);
+
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
@@ -431,6 +527,19 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    pipe_mutex_destroy(screen->rast_mutex);
 
+   if (LP_DEBUG & DEBUG_MEM) {
+      struct lp_block_pool_stats stats;
+
+      lp_block_pool_get_stats(screen->block_pool, &stats);
+      debug_printf("llvmpipe: scene blocks: %llu allocated, %llu from the "
+                   "pool, %llu trimmed, peak %llu KB\n",
+                   (unsigned long long) stats.allocs,
+                   (unsigned long long) stats.hits,
+                   (unsigned long long) stats.released,
+                   (unsigned long long) (stats.peak_bytes / 1024));
+   }
+   lp_block_pool_destroy(screen->block_pool);
+
    FREE(screen);
 }
 
@@ -519,7 +628,9 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_vendor = llvmpipe_get_vendor;
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
+   screen->base.get_shader_opcode_cost = llvmpipe_get_shader_opcode_cost;
    screen->base.get_paramf = llvmpipe_get_paramf;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
    screen->base.context_create = llvmpipe_create_context;
@@ -540,15 +651,36 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 #endif
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
+   screen->thread_affinity = lp_get_thread_affinity();
+   screen->tile_order = lp_get_tile_order();
 
-   screen->rast = lp_rast_create(screen->num_threads);
+   screen->block_pool = lp_block_pool_create(sizeof(struct data_block));
+   if (!screen->block_pool) {
+      lp_jit_screen_cleanup(screen);
+      FREE(screen);
+      return NULL;
+   }
+
+   if (!lp_fs_cache_init(screen)) {
+      lp_block_pool_destroy(screen->block_pool);
+      lp_jit_screen_cleanup(screen);
+      FREE(screen);
+      return NULL;
+   }
+
+   screen->rast = lp_rast_create(screen->num_threads,
+                                 screen->thread_affinity);
    if (!screen->rast) {
+      lp_fs_cache_cleanup(screen);
+      lp_block_pool_destroy(screen->block_pool);
       lp_jit_screen_cleanup(screen);
       FREE(screen);
       return NULL;
    }
    pipe_mutex_init(screen->rast_mutex);
 
+   lp_fs_async_init(screen);
+
    util_format_s3tc_init();
 
    return &screen->base;
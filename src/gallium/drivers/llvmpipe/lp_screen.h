@@ -40,7 +40,13 @@
 #include "gallivm/lp_bld.h"
 
 
+struct lp_block_pool;
+struct util_hash_table;
+
+
 struct sw_winsys;
+struct lp_fragment_shader_variant;
+struct lp_fs_code;
 
 
 struct llvmpipe_screen
@@ -50,6 +56,8 @@ struct llvmpipe_screen
    struct sw_winsys *winsys;
 
    unsigned num_threads;
+   unsigned thread_affinity;  /**< enum lp_thread_affinity */
+   unsigned tile_order;  /**< log2 of the rasterizer's tile size */
 
    /* Increments whenever textures are modified.  Contexts can track this.
     */
@@ -57,6 +65,30 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /** Memory for the scenes of all contexts, see lp_block_pool.h */
+   struct lp_block_pool *block_pool;
+
+   /** Time all contexts spent binning the queued scenes, in usecs.
+    * Protected by rast_mutex.
+    */
+   int64_t bin_time;
+
+   /** Background compilation of fragment shaders, see lp_state_fs.c */
+   boolean async_compile;
+   boolean async_quit;
+   pipe_thread async_thread;
+   pipe_mutex async_mutex;
+   pipe_condvar async_cond;
+   struct lp_fragment_shader_variant *async_queue;
+
+   /** Compiled fragment shader variants of all contexts, see lp_state_fs.c */
+   pipe_mutex fs_cache_mutex;
+   struct util_hash_table *fs_cache;
+   struct lp_fs_code *fs_cache_idle;  /**< list of the code no variant uses */
+   unsigned fs_cache_idle_count;
+   unsigned fs_cache_idle_instrs;
+   unsigned fs_cache_lookups;
 };
 
 
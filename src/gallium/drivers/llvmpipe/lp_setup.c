@@ -72,16 +72,20 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
    assert(setup->scene == NULL);
 
    setup->scene_idx++;
-   setup->scene_idx %= Elements(setup->scenes);
+   setup->scene_idx %= setup->num_scenes;
 
    setup->scene = setup->scenes[setup->scene_idx];
 
-   if (setup->scene->fence) {
+   /* The rasterizer owns the scene until its fence is signalled. */
+   if (setup->scene_fences[setup->scene_idx]) {
+      struct lp_fence **fence = &setup->scene_fences[setup->scene_idx];
+
       if (LP_DEBUG & DEBUG_SETUP)
          debug_printf("%s: wait for scene %d\n",
-                      __FUNCTION__, setup->scene->fence->id);
+                      __FUNCTION__, (*fence)->id);
 
-      lp_fence_wait(setup->scene->fence);
+      lp_fence_wait(*fence);
+      lp_fence_reference(fence, NULL);
    }
 
    lp_scene_begin_binning(setup->scene, &setup->fb, discard);
@@ -149,7 +153,11 @@ void lp_setup_reset( struct lp_setup_context *setup )
 }
 
 
-/** Rasterize all scene's bins */
+/**
+ * Queue the scene for rasterization.  This doesn't wait: binning of the
+ * next scene overlaps with rasterizing this one, and the scene only gets
+ * reused once its fence is signalled.
+ */
 static void
 lp_setup_rasterize_scene( struct lp_setup_context *setup )
 {
@@ -167,12 +175,15 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
+   lp_fence_reference(&setup->scene_fences[setup->scene_idx], scene->fence);
+
    pipe_mutex_lock(screen->rast_mutex);
+   screen->bin_time += setup->bin_time;
+   setup->bin_time = 0;
+   lp_scene_fence_resources(scene);
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    pipe_mutex_unlock(screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -190,9 +201,10 @@ begin_binning( struct lp_setup_context *setup )
    assert(scene);
    assert(scene->fence == NULL);
 
-   /* Always create a fence:
+   /* Always create a fence, signalled by the rasterizer once the scene
+    * is done with:
     */
-   scene->fence = lp_fence_create(MAX2(1, setup->num_threads));
+   scene->fence = lp_fence_create(1);
    if (!scene->fence)
       return FALSE;
 
@@ -831,9 +843,9 @@ lp_setup_set_fragment_sampler_state(struct lp_setup_context *setup,
 
 
 /**
- * Is the given texture referenced by any scene?
- * Note: we have to check all scenes including any scenes currently
- * being rendered and the current scene being built.
+ * Is the given texture referenced by the scene being built?
+ * Scenes already queued are tracked per resource instead, see
+ * llvmpipe_resource_busy_fence().
  */
 unsigned
 lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
@@ -851,10 +863,9 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
    }
 
    /* check textures referenced by the scene */
-   for (i = 0; i < Elements(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
-         return LP_REFERENCED_FOR_READ;
-      }
+   if (setup->scene &&
+       lp_scene_is_resource_referenced(setup->scene, texture)) {
+      return LP_REFERENCED_FOR_READ;
    }
 
    return LP_UNREFERENCED;
@@ -1117,13 +1128,13 @@ lp_setup_destroy( struct lp_setup_context *setup )
    }
 
    /* free the scenes in the 'empty' queue */
-   for (i = 0; i < Elements(setup->scenes); i++) {
-      struct lp_scene *scene = setup->scenes[i];
-
-      if (scene->fence)
-         lp_fence_wait(scene->fence);
+   for (i = 0; i < setup->num_scenes; i++) {
+      if (setup->scene_fences[i]) {
+         lp_fence_wait(setup->scene_fences[i]);
+         lp_fence_reference(&setup->scene_fences[i], NULL);
+      }
 
-      lp_scene_destroy(scene);
+      lp_scene_destroy(setup->scenes[i]);
    }
 
    lp_fence_reference(&setup->last_fence, NULL);
@@ -1167,7 +1178,10 @@ lp_setup_create( struct pipe_context *pipe,
    draw_set_render(draw, &setup->base);
 
    /* create some empty scenes */
-   for (i = 0; i < MAX_SCENES; i++) {
+   setup->num_scenes = debug_get_num_option("LP_NUM_SCENES", 4);
+   setup->num_scenes = CLAMP(setup->num_scenes, 2, MAX_SCENES);
+
+   for (i = 0; i < setup->num_scenes; i++) {
       setup->scenes[i] = lp_scene_create( pipe );
       if (!setup->scenes[i]) {
          goto no_scenes;
@@ -1267,12 +1281,23 @@ lp_setup_end_query(struct lp_setup_context *setup, struct llvmpipe_query *pq)
              * If there's a zero width/height framebuffer, there's no bins and
              * hence no rast task is ever run. So fill in something here instead.
              */
-            pq->end[0] = os_time_get_nano();
+            pq->threads[0].c.end = os_time_get_nano();
          }
 
+         /* Each bin counts itself off when it ended the query, see
+          * lp_rast_end_query_cmd().
+          */
+         pq->bins_pending = lp_scene_get_num_bins(setup->scene);
+         pq->early_result = pq->bins_pending != 0;
+
          if (!lp_scene_bin_everywhere(setup->scene,
                                       LP_RAST_OP_END_QUERY,
                                       lp_rast_arg_query(pq))) {
+            /* some bins of the flushed scene may have the command, so
+             * the count is off, and the result waits for the fence
+             */
+            pq->early_result = FALSE;
+
             if (!lp_setup_flush_and_restart(setup))
                goto fail;
 
@@ -1281,6 +1306,9 @@ lp_setup_end_query(struct lp_setup_context *setup, struct llvmpipe_query *pq)
                                          lp_rast_arg_query(pq))) {
                goto fail;
             }
+
+            /* the end of the query is in the new scene */
+            lp_fence_reference(&pq->fence, setup->scene->fence);
          }
          setup->scene->had_queries |= TRUE;
       }
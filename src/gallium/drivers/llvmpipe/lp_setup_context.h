@@ -52,8 +52,8 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-#define MAX_SCENES 2
+/** Max number of scenes per context, see LP_NUM_SCENES */
+#define MAX_SCENES 8
 
 
 
@@ -84,11 +84,16 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
+   unsigned num_scenes;
    unsigned scene_idx;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
+   struct lp_fence *scene_fences[MAX_SCENES];  /**< of the queued scenes */
    struct lp_scene *scene;               /**< current scene being built */
 
    struct lp_fence *last_fence;
+
+   /** Time spent binning since the last scene was queued, in usecs */
+   int64_t bin_time;
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
    unsigned active_binned_queries;
 
@@ -165,6 +170,18 @@ struct lp_setup_context
 };
 
 void lp_setup_choose_triangle( struct lp_setup_context *setup );
+
+/** Number of triangles of a list passed to lp_setup_triangles() at once */
+#define LP_SETUP_TRI_BATCH 16
+
+/** The vertices of a triangle of a list, for lp_setup_triangles() */
+struct lp_setup_tri_verts {
+   const float (*v[3])[4];
+};
+
+void lp_setup_triangles( struct lp_setup_context *setup,
+                         const struct lp_setup_tri_verts *tris,
+                         unsigned count );
 void lp_setup_choose_line( struct lp_setup_context *setup );
 void lp_setup_choose_point( struct lp_setup_context *setup );
 
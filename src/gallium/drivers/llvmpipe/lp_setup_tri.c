@@ -321,6 +321,18 @@ do_triangle_ccw(struct lp_setup_context *setup,
    bbox.x0 = MAX2(bbox.x0, 0);
    bbox.y0 = MAX2(bbox.y0, 0);
 
+   /* The scissor planes can only cut the triangle if its bounding box
+    * crosses the scissor rectangle.  Without them, small triangles get
+    * the 3 plane rasterizer functions for 4x4 and 16x16 blocks.
+    */
+   if (nr_planes == 7) {
+      const struct u_rect *scissor = &setup->scissors[scissor_index];
+
+      if (bbox.x0 >= scissor->x0 && bbox.x1 <= scissor->x1 &&
+          bbox.y0 >= scissor->y0 && bbox.y1 <= scissor->y1)
+         nr_planes = 3;
+   }
+
    tri = lp_setup_alloc_triangle(scene,
                                  key->num_inputs,
                                  nr_planes,
@@ -576,6 +588,8 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
                        unsigned scissor_index )
 {
    struct lp_scene *scene = setup->scene;
+   const int tile_size = scene->tile_size;
+   const unsigned tile_order = scene->tile_order;
    struct u_rect trimmed_box = *bbox;   
    int i;
 
@@ -600,23 +614,23 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
 
    /* Determine which tile(s) intersect the triangle's bounding box
     */
-   if (dx < TILE_SIZE)
+   if (dx < tile_size)
    {
-      int ix0 = bbox->x0 / TILE_SIZE;
-      int iy0 = bbox->y0 / TILE_SIZE;
-      unsigned px = bbox->x0 & 63 & ~3;
-      unsigned py = bbox->y0 & 63 & ~3;
+      int ix0 = bbox->x0 / tile_size;
+      int iy0 = bbox->y0 / tile_size;
+      unsigned px = bbox->x0 & (tile_size - 1) & ~3;
+      unsigned py = bbox->y0 & (tile_size - 1) & ~3;
 
-      assert(iy0 == bbox->y1 / TILE_SIZE &&
-	     ix0 == bbox->x1 / TILE_SIZE);
+      assert(iy0 == bbox->y1 / tile_size &&
+	     ix0 == bbox->x1 / tile_size);
 
       if (nr_planes == 3) {
          if (sz < 4)
          {
             /* Triangle is contained in a single 4x4 stamp:
              */
-            assert(px + 4 <= TILE_SIZE);
-            assert(py + 4 <= TILE_SIZE);
+            assert(px + 4 <= tile_size);
+            assert(py + 4 <= tile_size);
             return lp_scene_bin_cmd_with_state( scene, ix0, iy0,
                                                 setup->fs.stored,
                                                 LP_RAST_OP_TRIANGLE_3_4,
@@ -633,11 +647,11 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
              * dimensions if the triangle is 16 pixels in one dimension but 4
              * in the other. So budge the 16x16 back inside the tile.
              */
-            px = MIN2(px, TILE_SIZE - 16);
-            py = MIN2(py, TILE_SIZE - 16);
+            px = MIN2(px, tile_size - 16);
+            py = MIN2(py, tile_size - 16);
 
-            assert(px + 16 <= TILE_SIZE);
-            assert(py + 16 <= TILE_SIZE);
+            assert(px + 16 <= tile_size);
+            assert(py + 16 <= tile_size);
 
             return lp_scene_bin_cmd_with_state( scene, ix0, iy0,
                                                 setup->fs.stored,
@@ -647,11 +661,11 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
       }
       else if (nr_planes == 4 && sz < 16) 
       {
-         px = MIN2(px, TILE_SIZE - 16);
-         py = MIN2(py, TILE_SIZE - 16);
+         px = MIN2(px, tile_size - 16);
+         py = MIN2(py, tile_size - 16);
 
-         assert(px + 16 <= TILE_SIZE);
-         assert(py + 16 <= TILE_SIZE);
+         assert(px + 16 <= tile_size);
+         assert(py + 16 <= tile_size);
 
          return lp_scene_bin_cmd_with_state(scene, ix0, iy0,
                                             setup->fs.stored,
@@ -677,23 +691,23 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
       int ystep[MAX_PLANES];
       int x, y;
 
-      int ix0 = trimmed_box.x0 / TILE_SIZE;
-      int iy0 = trimmed_box.y0 / TILE_SIZE;
-      int ix1 = trimmed_box.x1 / TILE_SIZE;
-      int iy1 = trimmed_box.y1 / TILE_SIZE;
+      int ix0 = trimmed_box.x0 / tile_size;
+      int iy0 = trimmed_box.y0 / tile_size;
+      int ix1 = trimmed_box.x1 / tile_size;
+      int iy1 = trimmed_box.y1 / tile_size;
       
       for (i = 0; i < nr_planes; i++) {
          c[i] = (plane[i].c + 
-                 plane[i].dcdy * iy0 * TILE_SIZE - 
-                 plane[i].dcdx * ix0 * TILE_SIZE);
+                 plane[i].dcdy * iy0 * tile_size - 
+                 plane[i].dcdx * ix0 * tile_size);
 
          ei[i] = (plane[i].dcdy - 
                   plane[i].dcdx - 
-                  plane[i].eo) << TILE_ORDER;
+                  plane[i].eo) << tile_order;
 
-         eo[i] = plane[i].eo << TILE_ORDER;
-         xstep[i] = -(plane[i].dcdx << TILE_ORDER);
-         ystep[i] = plane[i].dcdy << TILE_ORDER;
+         eo[i] = plane[i].eo << tile_order;
+         xstep[i] = -(plane[i].dcdx << tile_order);
+         ystep[i] = plane[i].dcdy << tile_order;
       }
 
 
@@ -1086,6 +1100,31 @@ static void triangle_ccw( struct lp_setup_context *setup,
       retry_triangle_ccw(setup, &position, v0, v1, v2, setup->ccw_is_frontface);
 }
 
+/**
+ * Draw a triangle with its fixed position computed, whatever its
+ * winding.
+ */
+static INLINE void
+triangle_fixed( struct lp_setup_context *setup,
+                struct fixed_position *position,
+                const float (*v0)[4],
+                const float (*v1)[4],
+                const float (*v2)[4] )
+{
+   if (position->area > 0)
+      retry_triangle_ccw( setup, position, v0, v1, v2, setup->ccw_is_frontface );
+   else if (position->area < 0) {
+      if (setup->flatshade_first) {
+         rotate_fixed_position_12( position );
+         retry_triangle_ccw( setup, position, v0, v2, v1, !setup->ccw_is_frontface );
+      } else {
+         rotate_fixed_position_01( position );
+         retry_triangle_ccw( setup, position, v1, v0, v2, !setup->ccw_is_frontface );
+      }
+   }
+}
+
+
 /**
  * Draw triangle whether it's CW or CCW.
  */
@@ -1117,17 +1156,7 @@ static void triangle_both( struct lp_setup_context *setup,
       assert(!util_is_inf_or_nan(v2[0][1]));
    }
 
-   if (position.area > 0)
-      retry_triangle_ccw( setup, &position, v0, v1, v2, setup->ccw_is_frontface );
-   else if (position.area < 0) {
-      if (setup->flatshade_first) {
-         rotate_fixed_position_12( &position );
-         retry_triangle_ccw( setup, &position, v0, v2, v1, !setup->ccw_is_frontface );
-      } else {
-         rotate_fixed_position_01( &position );
-         retry_triangle_ccw( setup, &position, v1, v0, v2, !setup->ccw_is_frontface );
-      }
-   }
+   triangle_fixed( setup, &position, v0, v1, v2 );
 }
 
 
@@ -1139,6 +1168,209 @@ static void triangle_nop( struct lp_setup_context *setup,
 }
 
 
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * subpixel_snap() of four values.
+ */
+static INLINE __m128i
+subpixel_snap4(__m128 a)
+{
+   const __m128 f = _mm_mul_ps(a, _mm_set1_ps((float) FIXED_ONE));
+#if defined(PIPE_ARCH_X86)
+   /* util_iround() uses fistp, which rounds to nearest even */
+   return _mm_cvtps_epi32(f);
+#else
+   /* util_iround() rounds halves away from zero */
+   const __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+   const __m128 half = _mm_or_ps(sign, _mm_set1_ps(0.5f));
+   return _mm_cvttps_epi32(_mm_add_ps(f, half));
+#endif
+}
+
+
+static INLINE __m128i
+min_epi32(__m128i a, __m128i b)
+{
+   const __m128i gt = _mm_cmpgt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+
+static INLINE __m128i
+max_epi32(__m128i a, __m128i b)
+{
+   const __m128i gt = _mm_cmpgt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+
+/**
+ * Set up four triangles (fewer at the end of a list, in which case the
+ * last one is repeated): compute their fixed positions side by side, and
+ * reject those which are culled, have no area, or cover no pixel of the
+ * draw region, before setting up the others one by one.
+ *
+ * \param keep  which signs of the area are drawn: 1 for ccw, 2 for cw
+ */
+static void
+triangles4( struct lp_setup_context *setup,
+            const struct lp_setup_tri_verts *tris,
+            unsigned count,
+            unsigned keep )
+{
+   const struct lp_setup_tri_verts *t[4];
+   const float offset = setup->pixel_offset;
+   const int adj = (setup->pixel_offset != 0) ? 1 : 0;
+   PIPE_ALIGN_VAR(16) int x[3][4], y[3][4], area[4];
+   __m128i vx[3], vy[3];
+   __m128i dx01, dy01, dx20, dy20, varea;
+   __m128i minx, maxx, miny, maxy, x0, x1, y0, y1;
+   __m128i reject, empty;
+   unsigned valid = (1 << count) - 1;
+   unsigned mask, i, j;
+
+   for (i = 0; i < 4; i++)
+      t[i] = &tris[MIN2(i, count - 1)];
+
+   for (j = 0; j < 3; j++) {
+      vx[j] = subpixel_snap4(_mm_sub_ps(_mm_setr_ps(t[0]->v[j][0][0],
+                                                    t[1]->v[j][0][0],
+                                                    t[2]->v[j][0][0],
+                                                    t[3]->v[j][0][0]),
+                                        _mm_set1_ps(offset)));
+      vy[j] = subpixel_snap4(_mm_sub_ps(_mm_setr_ps(t[0]->v[j][0][1],
+                                                    t[1]->v[j][0][1],
+                                                    t[2]->v[j][0][1],
+                                                    t[3]->v[j][0][1]),
+                                        _mm_set1_ps(offset)));
+      _mm_store_si128((__m128i *)x[j], vx[j]);
+      _mm_store_si128((__m128i *)y[j], vy[j]);
+   }
+
+   dx01 = _mm_sub_epi32(vx[0], vx[1]);
+   dy01 = _mm_sub_epi32(vy[0], vy[1]);
+   dx20 = _mm_sub_epi32(vx[2], vx[0]);
+   dy20 = _mm_sub_epi32(vy[2], vy[0]);
+
+   varea = _mm_sub_epi32(mm_mullo_epi32(dx01, dy20),
+                         mm_mullo_epi32(dx20, dy01));
+   _mm_store_si128((__m128i *)area, varea);
+
+   /* Culling and zero area */
+   reject = _mm_cmpeq_epi32(varea, _mm_setzero_si128());
+   if (!(keep & 1))
+      reject = _mm_or_si128(reject, _mm_cmpgt_epi32(varea, _mm_setzero_si128()));
+   if (!(keep & 2))
+      reject = _mm_or_si128(reject, _mm_srai_epi32(varea, 31));
+
+   /* The bounding box, as in do_triangle_ccw() */
+   minx = min_epi32(min_epi32(vx[0], vx[1]), vx[2]);
+   maxx = max_epi32(max_epi32(vx[0], vx[1]), vx[2]);
+   miny = min_epi32(min_epi32(vy[0], vy[1]), vy[2]);
+   maxy = max_epi32(max_epi32(vy[0], vy[1]), vy[2]);
+
+   x0 = _mm_srai_epi32(minx, FIXED_ORDER);
+   x1 = _mm_srai_epi32(_mm_sub_epi32(maxx, _mm_set1_epi32(1)), FIXED_ORDER);
+   y0 = _mm_srai_epi32(_mm_add_epi32(miny, _mm_set1_epi32(adj)), FIXED_ORDER);
+   y1 = _mm_srai_epi32(_mm_add_epi32(maxy, _mm_set1_epi32(adj - 1)), FIXED_ORDER);
+
+   empty = _mm_or_si128(_mm_cmpgt_epi32(x0, x1), _mm_cmpgt_epi32(y0, y1));
+
+   /* The draw region depends on the viewport index of the triangle
+    * otherwise.
+    */
+   if (setup->viewport_index_slot == 0) {
+      const struct u_rect *region = &setup->draw_regions[0];
+
+      empty = _mm_or_si128(empty, _mm_cmpgt_epi32(x0, _mm_set1_epi32(region->x1)));
+      empty = _mm_or_si128(empty, _mm_cmplt_epi32(x1, _mm_set1_epi32(region->x0)));
+      empty = _mm_or_si128(empty, _mm_cmpgt_epi32(y0, _mm_set1_epi32(region->y1)));
+      empty = _mm_or_si128(empty, _mm_cmplt_epi32(y1, _mm_set1_epi32(region->y0)));
+   }
+
+   mask = ~_mm_movemask_ps(_mm_castsi128_ps(reject)) & valid;
+   LP_COUNT_ADD(nr_culled_tris,
+                util_bitcount(_mm_movemask_ps(_mm_castsi128_ps(empty)) & mask));
+   mask &= ~_mm_movemask_ps(_mm_castsi128_ps(empty));
+
+   while (mask) {
+      struct fixed_position position;
+
+      i = ffs(mask) - 1;
+      mask &= mask - 1;
+
+      for (j = 0; j < 3; j++) {
+         position.x[j] = x[j][i];
+         position.y[j] = y[j][i];
+      }
+      position.x[3] = 0;
+      position.y[3] = 0;
+
+      position.dx01 = position.x[0] - position.x[1];
+      position.dy01 = position.y[0] - position.y[1];
+      position.dx20 = position.x[2] - position.x[0];
+      position.dy20 = position.y[2] - position.y[0];
+      position.area = area[i];
+
+      triangle_fixed(setup, &position,
+                     tris[i].v[0], tris[i].v[1], tris[i].v[2]);
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+/**
+ * Draw a list of triangles.
+ *
+ * The same as calling setup->triangle for each, but the first steps of
+ * the setup, up to the culling of triangles which don't cover any pixel,
+ * are done for four triangles at once where possible.
+ */
+void
+lp_setup_triangles( struct lp_setup_context *setup,
+                    const struct lp_setup_tri_verts *tris,
+                    unsigned count )
+{
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+   unsigned i;
+
+   assert(setup->state == SETUP_ACTIVE);
+   lp_setup_choose_triangle( setup );
+
+#if defined(PIPE_ARCH_SSE)
+   /* Subdivided triangles and the clipper statistics are left to the
+    * functions of one triangle.
+    */
+   if (!setup->subdivide_large_triangles &&
+       !lp_context->active_statistics_queries) {
+      unsigned keep;
+
+      if (setup->triangle == triangle_both)
+         keep = 3;
+      else if (setup->triangle == triangle_ccw)
+         keep = 1;
+      else if (setup->triangle == triangle_cw)
+         keep = 2;
+      else
+         keep = 0;
+
+      if (keep) {
+         for (i = 0; i < count; i += 4)
+            triangles4(setup, &tris[i], MIN2(count - i, 4), keep);
+         return;
+      }
+   }
+#else
+   (void) lp_context;
+#endif
+
+   for (i = 0; i < count; i++)
+      setup->triangle( setup, tris[i].v[0], tris[i].v[1], tris[i].v[2] );
+}
+
+
 void 
 lp_setup_choose_triangle( struct lp_setup_context *setup )
 {
@@ -41,6 +41,7 @@
 #include "draw/draw_vbuf.h"
 #include "draw/draw_vertex.h"
 #include "util/u_memory.h"
+#include "os/os_time.h"
 
 
 #define LP_MAX_VBUF_INDEXES 1024
@@ -140,12 +141,15 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    const void *vertex_buffer = setup->vertex_buffer;
    const boolean flatshade_first = setup->flatshade_first;
    unsigned i;
+   int64_t t0;
 
    assert(setup->setup.variant);
 
    if (!lp_setup_update_state(setup, TRUE))
       return;
 
+   t0 = os_time_get();
+
    switch (setup->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
@@ -184,11 +188,21 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
-         setup->triangle( setup,
-                          get_vert(vertex_buffer, indices[i-2], stride),
-                          get_vert(vertex_buffer, indices[i-1], stride),
-                          get_vert(vertex_buffer, indices[i-0], stride) );
+      {
+         struct lp_setup_tri_verts tris[LP_SETUP_TRI_BATCH];
+         unsigned n = 0;
+
+         for (i = 2; i < nr; i += 3) {
+            tris[n].v[0] = get_vert(vertex_buffer, indices[i-2], stride);
+            tris[n].v[1] = get_vert(vertex_buffer, indices[i-1], stride);
+            tris[n].v[2] = get_vert(vertex_buffer, indices[i-0], stride);
+            if (++n == LP_SETUP_TRI_BATCH) {
+               lp_setup_triangles( setup, tris, n );
+               n = 0;
+            }
+         }
+         if (n)
+            lp_setup_triangles( setup, tris, n );
       }
       break;
 
@@ -324,6 +338,8 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   setup->bin_time += os_time_get() - t0;
 }
 
 
@@ -340,10 +356,13 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       (void *) get_vert(setup->vertex_buffer, start, stride);
    const boolean flatshade_first = setup->flatshade_first;
    unsigned i;
+   int64_t t0;
 
    if (!lp_setup_update_state(setup, TRUE))
       return;
 
+   t0 = os_time_get();
+
    switch (setup->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
@@ -382,11 +401,21 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
-         setup->triangle( setup,
-                          get_vert(vertex_buffer, i-2, stride),
-                          get_vert(vertex_buffer, i-1, stride),
-                          get_vert(vertex_buffer, i-0, stride) );
+      {
+         struct lp_setup_tri_verts tris[LP_SETUP_TRI_BATCH];
+         unsigned n = 0;
+
+         for (i = 2; i < nr; i += 3) {
+            tris[n].v[0] = get_vert(vertex_buffer, i-2, stride);
+            tris[n].v[1] = get_vert(vertex_buffer, i-1, stride);
+            tris[n].v[2] = get_vert(vertex_buffer, i-0, stride);
+            if (++n == LP_SETUP_TRI_BATCH) {
+               lp_setup_triangles( setup, tris, n );
+               n = 0;
+            }
+         }
+         if (n)
+            lp_setup_triangles( setup, tris, n );
       }
       break;
 
@@ -519,6 +548,8 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   setup->bin_time += os_time_get() - t0;
 }
 
 
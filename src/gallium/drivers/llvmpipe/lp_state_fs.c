@@ -67,6 +67,9 @@
 #include "util/u_string.h"
 #include "util/u_simple_list.h"
 #include "util/u_dual_blend.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_trace.h"
 #include "os/os_time.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
@@ -101,6 +104,7 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -2370,6 +2374,15 @@ dump_fs_variant_key(const struct lp_fragment_shader_variant_key *key)
                    texture->pot_width,
                    texture->pot_height,
                    texture->pot_depth);
+      if (texture->tiled)
+         debug_printf("  .tiled = 1\n");
+      if (i < key->nr_samplers) {
+         const struct lp_static_sampler_state *sampler =
+            &key->state[i].sampler_state;
+         debug_printf("  .path = %s\n",
+                      lp_sampler_path_name(lp_sampler_static_path(texture,
+                                                                  sampler)));
+      }
    }
 }
 
@@ -2386,29 +2399,625 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
 }
 
 
+/*
+ * Background compilation of RAST_WHOLE functions.
+ *
+ * The RAST_EDGE_TEST function handles whole tiles too (with a full mask),
+ * just more slowly, so with LP_ASYNC_COMPILE only that one is compiled in
+ * the draw path.  The specialized whole-tile function is then built on the
+ * screen's thread and swapped into jit_function[RAST_WHOLE] when ready.
+ *
+ * The thread builds its IR in its own LLVM context, since the shared one
+ * isn't thread safe.  Contexts are never freed, so a single one is shared
+ * by the threads of all screens, under async_context_mutex.
+ */
+
+static LLVMContextRef async_context = NULL;
+pipe_static_mutex(async_context_mutex);
+
+
+static void
+compile_async_variant(struct llvmpipe_screen *screen,
+                      struct lp_fragment_shader_variant *variant)
+{
+   struct lp_fragment_shader *shader = variant->shader;
+   struct lp_fragment_shader_variant *tmp;
+   lp_jit_frag_func func = NULL;
+
+   tmp = CALLOC_STRUCT(lp_fragment_shader_variant);
+   if (!tmp)
+      return;
+
+   util_trace_begin("compile_async_variant", shader->trace_id);
+
+   memcpy(&tmp->key, &variant->key, shader->variant_key_size);
+   tmp->shader = shader;
+   tmp->opaque = variant->opaque;
+   tmp->ps_inv_multiplier = variant->ps_inv_multiplier;
+   tmp->no = variant->no;
+
+   pipe_mutex_lock(async_context_mutex);
+
+   if (!async_context)
+      async_context = LLVMContextCreate();
+
+   if (async_context)
+      tmp->gallivm = gallivm_create_in_context(async_context);
+
+   if (tmp->gallivm) {
+      tmp->gallivm->owner = GALLIVM_OWNER_LP_FS;
+      lp_jit_init_types(tmp);
+
+      /* generate_fragment() only looks at the variant, not the context */
+      generate_fragment(NULL, shader, tmp, RAST_WHOLE);
+
+      gallivm_compile_module(tmp->gallivm);
+      func = (lp_jit_frag_func)
+         gallivm_jit_function(tmp->gallivm, tmp->function[RAST_WHOLE]);
+   }
+
+   pipe_mutex_unlock(async_context_mutex);
+
+   if (func) {
+      struct lp_fs_code *code = variant->code;
+
+      /* the variants of other contexts pick it up from the code */
+      pipe_mutex_lock(screen->fs_cache_mutex);
+      code->async_gallivm = tmp->gallivm;
+      code->async_function = tmp->function[RAST_WHOLE];
+      code->jit_function[RAST_WHOLE] = func;
+      pipe_mutex_unlock(screen->fs_cache_mutex);
+
+      variant->jit_function[RAST_WHOLE] = func;
+   }
+   else if (tmp->gallivm) {
+      pipe_mutex_lock(async_context_mutex);
+      gallivm_destroy(tmp->gallivm);
+      pipe_mutex_unlock(async_context_mutex);
+   }
+
+   FREE(tmp);
+
+   util_trace_end();
+}
+
+
+static PIPE_THREAD_ROUTINE( async_thread_function, data )
+{
+   struct llvmpipe_screen *screen = (struct llvmpipe_screen *) data;
+
+   pipe_mutex_lock(screen->async_mutex);
+
+   while (!screen->async_quit) {
+      struct lp_fragment_shader_variant *variant = screen->async_queue;
+
+      if (!variant) {
+         pipe_condvar_wait(screen->async_cond, screen->async_mutex);
+         continue;
+      }
+
+      screen->async_queue = variant->async_next;
+      variant->async_next = NULL;
+      variant->async_state = LP_ASYNC_RUNNING;
+      pipe_mutex_unlock(screen->async_mutex);
+
+      compile_async_variant(screen, variant);
+
+      pipe_mutex_lock(screen->async_mutex);
+      variant->async_state = LP_ASYNC_DONE;
+      pipe_condvar_broadcast(screen->async_cond);
+   }
+
+   pipe_mutex_unlock(screen->async_mutex);
+
+   return NULL;
+}
+
+
+void
+lp_fs_async_init(struct llvmpipe_screen *screen)
+{
+   screen->async_compile = debug_get_bool_option("LP_ASYNC_COMPILE", FALSE);
+   if (!screen->async_compile)
+      return;
+
+   pipe_mutex_init(screen->async_mutex);
+   pipe_condvar_init(screen->async_cond);
+   screen->async_thread = pipe_thread_create(async_thread_function, screen);
+   if (!screen->async_thread) {
+      pipe_condvar_destroy(screen->async_cond);
+      pipe_mutex_destroy(screen->async_mutex);
+      screen->async_compile = FALSE;
+   }
+}
+
+
+void
+lp_fs_async_cleanup(struct llvmpipe_screen *screen)
+{
+   if (!screen->async_compile)
+      return;
+
+   /* all variants, and so all jobs, are gone by now */
+   assert(!screen->async_queue);
+
+   pipe_mutex_lock(screen->async_mutex);
+   screen->async_quit = TRUE;
+   pipe_condvar_broadcast(screen->async_cond);
+   pipe_mutex_unlock(screen->async_mutex);
+
+   pipe_thread_wait(screen->async_thread);
+   pipe_condvar_destroy(screen->async_cond);
+   pipe_mutex_destroy(screen->async_mutex);
+}
+
+
+static void
+queue_async_variant(struct llvmpipe_screen *screen,
+                    struct lp_fragment_shader_variant *variant)
+{
+   struct lp_fragment_shader_variant **tail;
+
+   pipe_mutex_lock(screen->async_mutex);
+
+   for (tail = &screen->async_queue; *tail; tail = &(*tail)->async_next)
+      ;
+   *tail = variant;
+   variant->async_state = LP_ASYNC_QUEUED;
+
+   pipe_condvar_broadcast(screen->async_cond);
+   pipe_mutex_unlock(screen->async_mutex);
+}
+
+
+/**
+ * Remove the variant from the queue, or wait until the thread is done
+ * with it.  What the thread compiled belongs to the variant's code.
+ */
+static void
+cancel_async_variant(struct llvmpipe_screen *screen,
+                     struct lp_fragment_shader_variant *variant)
+{
+   boolean dequeued = FALSE;
+
+   if (variant->async_state == LP_ASYNC_NONE)
+      return;
+
+   pipe_mutex_lock(screen->async_mutex);
+
+   if (variant->async_state == LP_ASYNC_QUEUED) {
+      struct lp_fragment_shader_variant **link;
+
+      for (link = &screen->async_queue; *link; link = &(*link)->async_next) {
+         if (*link == variant) {
+            *link = variant->async_next;
+            dequeued = TRUE;
+            break;
+         }
+      }
+   }
+
+   while (variant->async_state == LP_ASYNC_RUNNING)
+      pipe_condvar_wait(screen->async_cond, screen->async_mutex);
+
+   variant->async_state = LP_ASYNC_NONE;
+   pipe_mutex_unlock(screen->async_mutex);
+
+   if (dequeued) {
+      /* let the next variant sharing the code queue it again */
+      pipe_mutex_lock(screen->fs_cache_mutex);
+      variant->code->async_queued = FALSE;
+      pipe_mutex_unlock(screen->fs_cache_mutex);
+   }
+}
+
+
+/*
+ * Screen-wide cache of compiled code.
+ *
+ * Every context creates its own variants, but variants with the same
+ * shader tokens and key share one lp_fs_code.  The code of variants which
+ * all contexts have culled stays in the cache until the unused code
+ * exceeds LP_MAX_CACHED_FS_CODE or LP_MAX_CACHED_FS_INSTRUCTIONS, and is
+ * then evicted by fs_code_score().
+ */
+
+
+static unsigned
+fs_code_hash(void *key)
+{
+   const struct lp_fs_code *code = (const struct lp_fs_code *) key;
+
+   return (unsigned) (code->hash ^ (code->hash >> 32));
+}
+
+
+static int
+fs_code_compare(void *key1, void *key2)
+{
+   const struct lp_fs_code *a = (const struct lp_fs_code *) key1;
+   const struct lp_fs_code *b = (const struct lp_fs_code *) key2;
+   unsigned num_tokens;
+
+   if (a->hash != b->hash ||
+       a->key_size != b->key_size ||
+       memcmp(a->key, b->key, a->key_size) != 0)
+      return 1;
+
+   num_tokens = tgsi_num_tokens(a->tokens);
+   if (num_tokens != tgsi_num_tokens(b->tokens))
+      return 1;
+
+   return memcmp(a->tokens, b->tokens,
+                 num_tokens * sizeof(struct tgsi_token)) != 0;
+}
+
+
+/**
+ * Take the code over from a freshly compiled variant.
+ */
+static struct lp_fs_code *
+create_fs_code(struct lp_fragment_shader *shader,
+               struct lp_fragment_shader_variant *variant,
+               uint64_t hash)
+{
+   struct lp_fs_code *code;
+   unsigned i;
+
+   code = CALLOC_STRUCT(lp_fs_code);
+   if (!code)
+      return NULL;
+
+   code->key = MALLOC(shader->variant_key_size);
+   code->tokens = tgsi_dup_tokens(shader->base.tokens);
+   if (!code->key || !code->tokens) {
+      FREE(code->key);
+      FREE((void *) code->tokens);
+      FREE(code);
+      return NULL;
+   }
+
+   code->hash = hash;
+   code->key_size = shader->variant_key_size;
+   memcpy(code->key, &variant->key, shader->variant_key_size);
+
+   code->nr_instrs = variant->nr_instrs;
+   code->gallivm = variant->gallivm;
+   for (i = 0; i < Elements(code->function); i++) {
+      code->function[i] = variant->function[i];
+      code->jit_function[i] = variant->jit_function[i];
+   }
+
+   variant->gallivm = NULL;
+
+   return code;
+}
+
+
+static void
+destroy_fs_code(struct lp_fs_code *code)
+{
+   unsigned i;
+
+   assert(code->refcount == 0);
+
+   /* free all the JIT'd functions */
+   for (i = 0; i < Elements(code->function); i++) {
+      if (code->function[i]) {
+         gallivm_free_function(code->gallivm,
+                               code->function[i],
+                               code->jit_function[i]);
+      }
+   }
+
+   gallivm_destroy(code->gallivm);
+
+   if (code->async_gallivm) {
+      pipe_mutex_lock(async_context_mutex);
+      gallivm_free_function(code->async_gallivm,
+                            code->async_function,
+                            code->jit_function[RAST_WHOLE]);
+      gallivm_destroy(code->async_gallivm);
+      pipe_mutex_unlock(async_context_mutex);
+   }
+
+   FREE(code->key);
+   FREE((void *) code->tokens);
+   FREE(code);
+}
+
+
+static void
+fs_cache_idle_insert(struct llvmpipe_screen *screen, struct lp_fs_code *code)
+{
+   code->idle_prev = NULL;
+   code->idle_next = screen->fs_cache_idle;
+   if (code->idle_next)
+      code->idle_next->idle_prev = code;
+   screen->fs_cache_idle = code;
+
+   screen->fs_cache_idle_count++;
+   screen->fs_cache_idle_instrs += code->nr_instrs;
+}
+
+
+static void
+fs_cache_idle_remove(struct llvmpipe_screen *screen, struct lp_fs_code *code)
+{
+   if (code->idle_prev)
+      code->idle_prev->idle_next = code->idle_next;
+   else
+      screen->fs_cache_idle = code->idle_next;
+   if (code->idle_next)
+      code->idle_next->idle_prev = code->idle_prev;
+   code->idle_prev = code->idle_next = NULL;
+
+   screen->fs_cache_idle_count--;
+   screen->fs_cache_idle_instrs -= code->nr_instrs;
+}
+
+
+/**
+ * What keeping unused code is worth: the compile time it saved per
+ * lookup since it was created, per instruction of memory it takes.
+ */
+static double
+fs_code_score(const struct llvmpipe_screen *screen,
+              const struct lp_fs_code *code)
+{
+   const double rate = (code->hits + 1.0) /
+                       (double) (screen->fs_cache_lookups - code->birth + 1);
+
+   return (double) code->compile_time * rate / MAX2(code->nr_instrs, 1);
+}
+
+
+static void
+fs_cache_evict(struct llvmpipe_screen *screen)
+{
+   while (screen->fs_cache_idle_count > LP_MAX_CACHED_FS_CODE ||
+          screen->fs_cache_idle_instrs > LP_MAX_CACHED_FS_INSTRUCTIONS) {
+      struct lp_fs_code *code, *victim = NULL;
+      double victim_score = 0.0;
+
+      for (code = screen->fs_cache_idle; code; code = code->idle_next) {
+         double score = fs_code_score(screen, code);
+
+         if (!victim || score < victim_score) {
+            victim = code;
+            victim_score = score;
+         }
+      }
+
+      fs_cache_idle_remove(screen, victim);
+      util_hash_table_remove(screen->fs_cache, victim);
+      destroy_fs_code(victim);
+   }
+}
+
+
+/**
+ * Find and reference the code matching the probe, or return NULL.
+ */
+static struct lp_fs_code *
+fs_cache_acquire(struct llvmpipe_screen *screen,
+                 struct lp_fs_code *probe)
+{
+   struct lp_fs_code *code;
+
+   pipe_mutex_lock(screen->fs_cache_mutex);
+
+   screen->fs_cache_lookups++;
+
+   code = (struct lp_fs_code *) util_hash_table_get(screen->fs_cache, probe);
+   if (code) {
+      if (code->refcount++ == 0)
+         fs_cache_idle_remove(screen, code);
+      code->hits++;
+   }
+
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+
+   return code;
+}
+
+
+/**
+ * Add new code, referenced.  If another context added the same code
+ * meanwhile, that is returned instead and the new code freed.
+ */
+static struct lp_fs_code *
+fs_cache_insert(struct llvmpipe_screen *screen,
+                struct lp_fs_code *code)
+{
+   struct lp_fs_code *existing;
+
+   pipe_mutex_lock(screen->fs_cache_mutex);
+
+   existing = (struct lp_fs_code *) util_hash_table_get(screen->fs_cache,
+                                                        code);
+   if (existing) {
+      if (existing->refcount++ == 0)
+         fs_cache_idle_remove(screen, existing);
+      existing->hits++;
+   }
+   else {
+      code->refcount = 1;
+      code->birth = screen->fs_cache_lookups;
+      /* if this fails the code just isn't shared */
+      util_hash_table_set(screen->fs_cache, code, code);
+   }
+
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+
+   if (existing) {
+      destroy_fs_code(code);
+      return existing;
+   }
+
+   return code;
+}
+
+
+static void
+fs_cache_release(struct llvmpipe_screen *screen,
+                 struct lp_fs_code *code)
+{
+   pipe_mutex_lock(screen->fs_cache_mutex);
+
+   assert(code->refcount);
+   if (--code->refcount == 0) {
+      fs_cache_idle_insert(screen, code);
+      fs_cache_evict(screen);
+   }
+
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+}
+
+
+/**
+ * Whether the caller should queue the background compilation of the
+ * code's RAST_WHOLE function.
+ */
+static boolean
+fs_cache_claim_async(struct llvmpipe_screen *screen,
+                     struct lp_fs_code *code)
+{
+   boolean claim = FALSE;
+
+   pipe_mutex_lock(screen->fs_cache_mutex);
+
+   if (!code->function[RAST_WHOLE] && !code->async_queued) {
+      code->async_queued = TRUE;
+      claim = TRUE;
+   }
+
+   pipe_mutex_unlock(screen->fs_cache_mutex);
+
+   return claim;
+}
+
+
+boolean
+lp_fs_cache_init(struct llvmpipe_screen *screen)
+{
+   screen->fs_cache = util_hash_table_create(fs_code_hash, fs_code_compare);
+   if (!screen->fs_cache)
+      return FALSE;
+
+   pipe_mutex_init(screen->fs_cache_mutex);
+   return TRUE;
+}
+
+
+void
+lp_fs_cache_cleanup(struct llvmpipe_screen *screen)
+{
+   /* all variants are gone by now, so all code is unused */
+   while (screen->fs_cache_idle) {
+      struct lp_fs_code *code = screen->fs_cache_idle;
+
+      fs_cache_idle_remove(screen, code);
+      destroy_fs_code(code);
+   }
+
+   util_hash_table_destroy(screen->fs_cache);
+   pipe_mutex_destroy(screen->fs_cache_mutex);
+}
+
+
+/**
+ * Generate and compile the code of a new variant.
+ */
+static struct lp_fs_code *
+compile_variant(struct llvmpipe_context *lp,
+                struct lp_fragment_shader *shader,
+                struct lp_fragment_shader_variant *variant,
+                uint64_t hash)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_code *code;
+   int64_t t0, t1, dt;
+
+   t0 = os_time_get();
+
+   variant->gallivm = gallivm_create();
+   if (!variant->gallivm)
+      return NULL;
+   variant->gallivm->owner = GALLIVM_OWNER_LP_FS;
+
+   if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
+      lp_debug_fs_variant(variant);
+   }
+
+   lp_jit_init_types(variant);
+   
+   generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+
+   if (variant->opaque && !screen->async_compile) {
+      /* Specialized shader, which doesn't need to read the color buffer. */
+      generate_fragment(lp, shader, variant, RAST_WHOLE);
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+               gallivm_jit_function(variant->gallivm,
+                                    variant->function[RAST_WHOLE]);
+   } else if (!variant->jit_function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   t1 = os_time_get();
+   dt = t1 - t0;
+   LP_COUNT_ADD(llvm_compile_time, dt);
+   LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+
+   code = create_fs_code(shader, variant, hash);
+   if (!code) {
+      gallivm_destroy(variant->gallivm);
+      variant->gallivm = NULL;
+      return NULL;
+   }
+
+   code->compile_time = dt;
+
+   return code;
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
- * other state indicated by the key.
+ * other state indicated by the key.  The code is compiled unless some
+ * context already has it.
  */
 static struct lp_fragment_shader_variant *
 generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
+   struct lp_fs_code probe, *code;
    const struct util_format_description *cbuf0_format_desc;
    boolean fullcolormask;
+   unsigned i;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if(!variant)
       return NULL;
 
-   variant->gallivm = gallivm_create();
-   if (!variant->gallivm) {
-      FREE(variant);
-      return NULL;
-   }
-
    variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2442,41 +3051,31 @@ generate_variant(struct llvmpipe_context *lp,
       variant->ps_inv_multiplier = 1;
    }
 
-   if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
-      lp_debug_fs_variant(variant);
-   }
-
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+   memset(&probe, 0, sizeof probe);
+   probe.hash = shader->base.hash ^
+                util_hash_crc32(&variant->key, shader->variant_key_size);
+   probe.tokens = shader->base.tokens;
+   probe.key_size = shader->variant_key_size;
+   probe.key = &variant->key;
 
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
+   code = fs_cache_acquire(screen, &probe);
+   if (!code) {
+      code = compile_variant(lp, shader, variant, probe.hash);
+      if (!code) {
+         FREE(variant);
+         return NULL;
       }
+      code = fs_cache_insert(screen, code);
    }
 
-   /*
-    * Compile everything
-    */
-
-   gallivm_compile_module(variant->gallivm);
+   variant->code = code;
+   variant->nr_instrs = code->nr_instrs;
+   for (i = 0; i < Elements(variant->jit_function); i++)
+      variant->jit_function[i] = code->jit_function[i];
 
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
-   }
-
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
-   }
+   if (variant->opaque && screen->async_compile &&
+       fs_cache_claim_async(screen, code))
+      queue_async_variant(screen, variant);
 
    return variant;
 }
@@ -2497,6 +3096,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       return NULL;
 
    shader->no = fs_no++;
+   shader->trace_id = util_trace_current_id();
    make_empty_list(&shader->variants);
 
    /* get/save the summary info for this shader */
@@ -2504,6 +3104,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
 
    /* we need to keep a local copy of the tokens */
    shader->base.tokens = tgsi_dup_tokens(templ->tokens);
+   shader->base.hash = tgsi_shader_state_hash(templ);
 
    shader->draw_data = draw_create_fragment_shader(llvmpipe->draw, templ);
    if (shader->draw_data == NULL) {
@@ -2602,7 +3203,7 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant)
 {
-   unsigned i;
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
 
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
       debug_printf("llvmpipe: del fs #%u var #%u v created #%u v cached"
@@ -2614,16 +3215,9 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants);
    }
 
-   /* free all the variant's JIT'd functions */
-   for (i = 0; i < Elements(variant->function); i++) {
-      if (variant->function[i]) {
-         gallivm_free_function(variant->gallivm,
-                               variant->function[i],
-                               variant->jit_function[i]);
-      }
-   }
+   cancel_async_variant(screen, variant);
 
-   gallivm_destroy(variant->gallivm);
+   fs_cache_release(screen, variant->code);
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -2739,6 +3333,106 @@ force_dst_alpha_one(unsigned factor, boolean clamped_zero)
 }
 
 
+/**
+ * Whether the blend equation writes the fragment color unmodified.
+ */
+static INLINE boolean
+blend_is_copy(unsigned func, unsigned src_factor, unsigned dst_factor)
+{
+   return (func == PIPE_BLEND_ADD || func == PIPE_BLEND_SUBTRACT) &&
+          src_factor == PIPE_BLENDFACTOR_ONE &&
+          dst_factor == PIPE_BLENDFACTOR_ZERO;
+}
+
+
+/**
+ * Whether the blend equation leaves the destination color unmodified.
+ */
+static INLINE boolean
+blend_is_keep(unsigned func, unsigned src_factor, unsigned dst_factor)
+{
+   return (func == PIPE_BLEND_ADD || func == PIPE_BLEND_REVERSE_SUBTRACT) &&
+          src_factor == PIPE_BLENDFACTOR_ZERO &&
+          dst_factor == PIPE_BLENDFACTOR_ONE;
+}
+
+
+/**
+ * Replace a blend state by the simplest one giving the same results.
+ *
+ * Blending with ONE and ZERO is an opaque copy, which lets the variant use
+ * the opaque tile shading (no destination load at all), and blending with
+ * ZERO and ONE writes nothing.  The factors of MIN and MAX are ignored, and
+ * so is everything but the colormask when blending is disabled, so these
+ * are zeroed for equivalent states to share a variant.  The common states
+ * left (premultiplied over, additive, alpha lerp) are already blended on
+ * unorm8 in the integer domain by lp_build_blend_aos.
+ */
+static void
+canonicalize_blend_rt(struct pipe_rt_blend_state *blend_rt)
+{
+   const unsigned rgb_mask = PIPE_MASK_R | PIPE_MASK_G | PIPE_MASK_B;
+
+   if (blend_rt->blend_enable) {
+      if (blend_rt->rgb_func == PIPE_BLEND_MIN ||
+          blend_rt->rgb_func == PIPE_BLEND_MAX) {
+         blend_rt->rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+         blend_rt->rgb_dst_factor = PIPE_BLENDFACTOR_ONE;
+      }
+      if (blend_rt->alpha_func == PIPE_BLEND_MIN ||
+          blend_rt->alpha_func == PIPE_BLEND_MAX) {
+         blend_rt->alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+         blend_rt->alpha_dst_factor = PIPE_BLENDFACTOR_ONE;
+      }
+
+      if (blend_is_keep(blend_rt->rgb_func,
+                        blend_rt->rgb_src_factor,
+                        blend_rt->rgb_dst_factor)) {
+         blend_rt->colormask &= ~rgb_mask;
+      }
+      if (blend_is_keep(blend_rt->alpha_func,
+                        blend_rt->alpha_src_factor,
+                        blend_rt->alpha_dst_factor)) {
+         blend_rt->colormask &= ~PIPE_MASK_A;
+      }
+
+      if ((!(blend_rt->colormask & rgb_mask) ||
+           blend_is_copy(blend_rt->rgb_func,
+                         blend_rt->rgb_src_factor,
+                         blend_rt->rgb_dst_factor)) &&
+          (!(blend_rt->colormask & PIPE_MASK_A) ||
+           blend_is_copy(blend_rt->alpha_func,
+                         blend_rt->alpha_src_factor,
+                         blend_rt->alpha_dst_factor))) {
+         blend_rt->blend_enable = 0;
+      }
+   }
+
+   if (!blend_rt->blend_enable) {
+      blend_rt->rgb_func = 0;
+      blend_rt->rgb_src_factor = 0;
+      blend_rt->rgb_dst_factor = 0;
+      blend_rt->alpha_func = 0;
+      blend_rt->alpha_src_factor = 0;
+      blend_rt->alpha_dst_factor = 0;
+   }
+}
+
+
+/**
+ * The static texture state of a sampler view, with our texture layout.
+ */
+static void
+texture_static_state(struct lp_static_texture_state *state,
+                     const struct pipe_sampler_view *view)
+{
+   lp_sampler_static_texture_state(state, view);
+
+   if (view && view->texture)
+      state->tiled = llvmpipe_resource_const(view->texture)->tiled;
+}
+
+
 /**
  * We need to generate several variants of the fragment pipeline to match
  * all the combinations of the contributing state atoms.
@@ -2863,6 +3557,11 @@ make_variant_key(struct llvmpipe_context *lp,
          blend_rt->alpha_src_factor = blend_rt->rgb_src_factor;
          blend_rt->alpha_dst_factor = blend_rt->rgb_dst_factor;
       }
+
+      /*
+       * Reduce the blend state, now that the fixups above are done.
+       */
+      canonicalize_blend_rt(blend_rt);
    }
 
    /* This value will be the same for all the variants of a given shader:
@@ -2885,8 +3584,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1 << i)) {
-            lp_sampler_static_texture_state(&key->state[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            texture_static_state(&key->state[i].texture_state,
+                                 lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -2894,8 +3593,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
-            lp_sampler_static_texture_state(&key->state[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            texture_static_state(&key->state[i].texture_state,
+                                 lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -2932,10 +3631,13 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
        * deletion of shader's when we have too many.
        */
       move_to_head(&lp->fs_variants_list, &variant->list_item_global);
+
+      /* pick up a RAST_WHOLE function compiled for another context */
+      variant->jit_function[RAST_WHOLE] =
+         variant->code->jit_function[RAST_WHOLE];
    }
    else {
       /* variant not found, create it now */
-      int64_t t0, t1, dt;
       unsigned i;
       unsigned variants_to_cull;
 
@@ -2983,12 +3685,9 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       /*
        * Generate the new variant.
        */
-      t0 = os_time_get();
+      util_trace_begin("generate_variant", shader->trace_id);
       variant = generate_variant(lp, shader, &key);
-      t1 = os_time_get();
-      dt = t1 - t0;
-      LP_COUNT_ADD(llvm_compile_time, dt);
-      LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+      util_trace_end();
 
       llvmpipe_variant_count++;
 
@@ -92,6 +92,45 @@ struct lp_fs_variant_list_item
 };
 
 
+/** lp_fragment_shader_variant::async_state */
+#define LP_ASYNC_NONE     0
+#define LP_ASYNC_QUEUED   1
+#define LP_ASYNC_RUNNING  2
+#define LP_ASYNC_DONE     3
+
+
+/**
+ * Compiled code of a fragment shader variant.  It is shared by the
+ * variants of all contexts with the same tokens and key, through the
+ * screen's fs_cache, and outlives them until it is evicted.
+ */
+struct lp_fs_code
+{
+   uint64_t hash;
+   const struct tgsi_token *tokens;
+   unsigned key_size;
+   struct lp_fragment_shader_variant_key *key;
+
+   /* Protected by the screen's fs_cache_mutex */
+   unsigned refcount;    /**< variants using the code */
+   unsigned hits;        /**< lookups which found it */
+   unsigned birth;       /**< fs_cache_lookups when it was created */
+   struct lp_fs_code *idle_prev, *idle_next;   /**< if refcount is 0 */
+   boolean async_queued; /**< RAST_WHOLE is or was being compiled */
+
+   int64_t compile_time; /**< usecs */
+   unsigned nr_instrs;
+
+   struct gallivm_state *gallivm;
+   LLVMValueRef function[2];
+   lp_jit_frag_func jit_function[2];
+
+   /* The RAST_WHOLE function from the background thread */
+   struct gallivm_state *async_gallivm;
+   LLVMValueRef async_function;
+};
+
+
 struct lp_fragment_shader_variant
 {
    struct lp_fragment_shader_variant_key key;
@@ -99,6 +138,7 @@ struct lp_fragment_shader_variant
    boolean opaque;
    uint8_t ps_inv_multiplier;
 
+   /* Only used while generating code, which is then owned by \c code */
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -109,6 +149,16 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   struct lp_fs_code *code;
+
+   /*
+    * With LP_ASYNC_COMPILE the RAST_WHOLE function is compiled on the
+    * screen's background thread, and jit_function[RAST_WHOLE] points to the
+    * RAST_EDGE_TEST function until it is ready.
+    */
+   unsigned async_state;   /**< LP_ASYNC_x */
+   struct lp_fragment_shader_variant *async_next;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
@@ -137,6 +187,9 @@ struct lp_fragment_shader
    unsigned variants_created;
    unsigned variants_cached;
 
+   /** u_trace shader id of the state tracker's span creating the shader */
+   uint32_t trace_id;
+
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
 };
@@ -152,5 +205,19 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
 boolean
 llvmpipe_rasterization_disabled(struct llvmpipe_context *lp);
 
+struct llvmpipe_screen;
+
+void
+lp_fs_async_init(struct llvmpipe_screen *screen);
+
+void
+lp_fs_async_cleanup(struct llvmpipe_screen *screen);
+
+boolean
+lp_fs_cache_init(struct llvmpipe_screen *screen);
+
+void
+lp_fs_cache_cleanup(struct llvmpipe_screen *screen);
+
 
 #endif /* LP_STATE_FS_H_ */
@@ -72,15 +72,18 @@ llvmpipe_create_rasterizer_state(struct pipe_context *pipe,
 
    /* We rely on draw module to do unfilled polyons, AA lines and
     * points and stipple.
+    *
+    * Only the triangle conditions matter here: the flags in clear_flags()
+    * are all about polygons, and draw decides per primitive whether AA or
+    * stippled lines and points need its pipeline.  Keying this on
+    * point_smooth or line_smooth would push every triangle drawn with
+    * such state through draw's twoside and offset stages.
     * 
     * Over time, reduce this list of conditions, and expand the list
     * of flags which get cleared in clear_flags().
     */
    need_pipeline = (rast->fill_front != PIPE_POLYGON_MODE_FILL ||
 		    rast->fill_back != PIPE_POLYGON_MODE_FILL ||
-		    rast->point_smooth ||
-		    rast->line_smooth ||
-		    rast->line_stipple_enable ||
 		    rast->poly_stipple_enable);
 
    /* If not using the pipeline, clear out the flags which we can
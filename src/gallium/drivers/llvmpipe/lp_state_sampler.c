@@ -38,6 +38,7 @@
 #include "lp_screen.h"
 #include "lp_state.h"
 #include "lp_debug.h"
+#include "lp_flush.h"
 #include "state_tracker/sw_winsys.h"
 
 
@@ -262,6 +263,14 @@ prepare_shader_sampling(
           */
          pipe_resource_reference(&mapped_tex[i], tex);
 
+         /* The threads may still be rendering to it in a flushed scene.
+          */
+         llvmpipe_flush_resource(&lp->pipe, tex, 0,
+                                 TRUE, /* read_only */
+                                 TRUE, /* cpu_access */
+                                 FALSE, /* do_not_block */
+                                 __FUNCTION__);
+
          if (!lp_tex->dt) {
             /* regular texture - setup array of mipmap level offsets */
             struct pipe_resource *res = view->texture;
@@ -339,7 +348,7 @@ prepare_shader_sampling(
                                  i,
                                  width0, tex->height0, num_layers,
                                  first_level, last_level,
-                                 addr,
+                                 addr, lp_tex->tiled,
                                  row_stride, img_stride, mip_offsets);
       }
    }
@@ -720,6 +720,7 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    if (!variant->gallivm) {
       goto fail;
    }
+   gallivm->owner = GALLIVM_OWNER_LP_SETUP;
 
    builder = gallivm->builder;
 
@@ -80,8 +80,9 @@ lp_resource_copy(struct pipe_context *pipe,
                            FALSE, /* do_not_block */
                            "blit src");
 
-   /* Fallback for buffers. */
-   if (dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER) {
+   /* Fallback for buffers, and through transfers for tiled textures. */
+   if ((dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER) ||
+       src_tex->tiled || dst_tex->tiled) {
       util_resource_copy_region(pipe, dst, dst_level, dstx, dsty, dstz,
                                 src, src_level, src_box);
       return;
@@ -249,6 +250,11 @@ llvmpipe_create_surface(struct pipe_context *pipe,
    if (!(pt->bind & (PIPE_BIND_DEPTH_STENCIL | PIPE_BIND_RENDER_TARGET)))
       debug_printf("Illegal surface creation without bind flag\n");
 
+   /* the rasterizer only renders to linear images */
+   if (llvmpipe_resource_is_texture(pt) &&
+       !llvmpipe_resource_untile(pipe, llvmpipe_resource(pt)))
+      return NULL;
+
    ps = CALLOC_STRUCT(pipe_surface);
    if (ps) {
       pipe_reference_init(&ps->reference, 1);
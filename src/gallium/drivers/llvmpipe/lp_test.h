@@ -54,6 +54,13 @@
 #define LP_TEST_NUM_SAMPLES 32
 
 
+/**
+ * Set by -b.  The tests then write their results, including the cycles
+ * per element, to stdout if no -o file was given.
+ */
+extern boolean benchmark_mode;
+
+
 void
 write_tsv_header(FILE *fp);
 
@@ -93,6 +100,10 @@ rdtsc(void)
 
 
 
+double
+average_cycles(const int64_t *cycles, unsigned n);
+
+
 float
 random_float(void);
 
@@ -47,7 +47,9 @@ write_tsv_header(FILE *fp)
 {
    fprintf(fp,
            "result\t"
-           "format\n");
+           "cycles_per_elem\t"
+           "type\t"
+           "function\n");
 
    fflush(fp);
 }
@@ -289,14 +291,32 @@ unary_tests[] = {
 };
 
 
+static void
+write_tsv_row(FILE *fp,
+              const struct unary_test_t *test,
+              struct lp_type type,
+              double cycles,
+              boolean success)
+{
+   fprintf(fp, "%s\t", success ? "pass" : "fail");
+
+   fprintf(fp, "%.1f\t", cycles / type.length);
+
+   dump_type(fp, type);
+   fprintf(fp, "\t%s\n", test->name);
+
+   fflush(fp);
+}
+
+
 /*
  * Build LLVM function that exercises the unary operator builder.
  */
 static LLVMValueRef
 build_unary_test_func(struct gallivm_state *gallivm,
-                      const struct unary_test_t *test)
+                      const struct unary_test_t *test,
+                      struct lp_type type)
 {
-   struct lp_type type = lp_type_float_vec(32, lp_native_vector_width);
    LLVMContextRef context = gallivm->context;
    LLVMModuleRef module = gallivm->module;
    LLVMTypeRef vf32t = lp_build_vec_type(gallivm, type);
@@ -336,14 +356,15 @@ build_unary_test_func(struct gallivm_state *gallivm,
  * Test one LLVM unary arithmetic builder function.
  */
 static boolean
-test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test)
+test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test,
+           struct lp_type type)
 {
    struct gallivm_state *gallivm;
    LLVMValueRef test_func;
    unary_func_t test_func_jit;
    boolean success = TRUE;
    int i, j;
-   int length = lp_native_vector_width / 32;
+   int length = type.length;
    float *in, *out;
 
    in = align_malloc(length * 4, length * 4);
@@ -356,7 +377,7 @@ test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test)
 
    gallivm = gallivm_create();
 
-   test_func = build_unary_test_func(gallivm, test);
+   test_func = build_unary_test_func(gallivm, test, type);
 
    gallivm_compile_module(gallivm);
 
@@ -401,6 +422,19 @@ test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test)
       }
    }
 
+   if (fp) {
+      int64_t cycles[LP_TEST_NUM_SAMPLES];
+
+      for (i = 0; i < LP_TEST_NUM_SAMPLES; i++) {
+         int64_t start_counter = rdtsc();
+         test_func_jit(out, in);
+         cycles[i] = rdtsc() - start_counter;
+      }
+
+      write_tsv_row(fp, test, type,
+                    average_cycles(cycles, LP_TEST_NUM_SAMPLES), success);
+   }
+
    gallivm_free_function(gallivm, test_func, test_func_jit);
 
    gallivm_destroy(gallivm);
@@ -416,11 +450,17 @@ boolean
 test_all(unsigned verbose, FILE *fp)
 {
    boolean success = TRUE;
+   unsigned width;
    int i;
 
-   for (i = 0; i < Elements(unary_tests); ++i) {
-      if (!test_unary(verbose, fp, &unary_tests[i])) {
-         success = FALSE;
+   /* 4 wide, and the full native width if that's wider */
+   for (width = 128; width <= lp_native_vector_width; width *= 2) {
+      struct lp_type type = lp_type_float_vec(32, width);
+
+      for (i = 0; i < Elements(unary_tests); ++i) {
+         if (!test_unary(verbose, fp, &unary_tests[i], type)) {
+            success = FALSE;
+         }
       }
    }
 
@@ -285,36 +285,7 @@ test_one(unsigned verbose,
       }
    }
 
-   /*
-    * Unfortunately the output of cycle counter is not very reliable as it comes
-    * -- sometimes we get outliers (due IRQs perhaps?) which are
-    * better removed to avoid random or biased data.
-    */
-   {
-      double sum = 0.0, sum2 = 0.0;
-      double avg, std;
-      unsigned m;
-
-      for(i = 0; i < n; ++i) {
-         sum += cycles[i];
-         sum2 += cycles[i]*cycles[i];
-      }
-
-      avg = sum/n;
-      std = sqrtf((sum2 - n*avg*avg)/n);
-
-      m = 0;
-      sum = 0.0;
-      for(i = 0; i < n; ++i) {
-         if(fabs(cycles[i] - avg) <= 4.0*std) {
-            sum += cycles[i];
-            ++m;
-         }
-      }
-
-      cycles_avg = sum/m;
-
-   }
+   cycles_avg = average_cycles(cycles, n);
 
    if(fp)
       write_tsv_row(fp, src_type, dst_type, cycles_avg, success);
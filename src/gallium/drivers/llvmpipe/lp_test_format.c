@@ -50,6 +50,8 @@ write_tsv_header(FILE *fp)
 {
    fprintf(fp,
            "result\t"
+           "cycles_per_pixel\t"
+           "type\t"
            "format\n");
 
    fflush(fp);
@@ -59,11 +61,16 @@ write_tsv_header(FILE *fp)
 static void
 write_tsv_row(FILE *fp,
               const struct util_format_description *desc,
+              struct lp_type type,
+              double cycles,
               boolean success)
 {
    fprintf(fp, "%s\t", success ? "pass" : "fail");
 
-   fprintf(fp, "%s\n", desc->name);
+   fprintf(fp, "%.1f\t", cycles);
+
+   dump_type(fp, type);
+   fprintf(fp, "\t%s\n", desc->name);
 
    fflush(fp);
 }
@@ -74,6 +81,28 @@ typedef void
                unsigned i, unsigned j);
 
 
+/*
+ * Average cycles of fetching a pixel from packed.
+ */
+static double
+time_fetch(fetch_ptr_t fetch_ptr, void *unpacked, const uint8_t *packed)
+{
+   int64_t cycles[LP_TEST_NUM_SAMPLES];
+   unsigned i;
+
+   if (!packed)
+      return 0.0;
+
+   for (i = 0; i < LP_TEST_NUM_SAMPLES; i++) {
+      int64_t start_counter = rdtsc();
+      fetch_ptr(unpacked, packed, 0, 0);
+      cycles[i] = rdtsc() - start_counter;
+   }
+
+   return average_cycles(cycles, LP_TEST_NUM_SAMPLES);
+}
+
+
 static LLVMValueRef
 add_fetch_rgba_test(struct gallivm_state *gallivm, unsigned verbose,
                     const struct util_format_description *desc,
@@ -113,7 +142,7 @@ add_fetch_rgba_test(struct gallivm_state *gallivm, unsigned verbose,
    LLVMPositionBuilderAtEnd(builder, block);
 
    rgba = lp_build_fetch_rgba_aos(gallivm, desc, type,
-                                  packed_ptr, offset, i, j);
+                                  packed_ptr, offset, i, j, NULL);
 
    LLVMBuildStore(builder, rgba, rgba_ptr);
 
@@ -134,6 +163,8 @@ test_format_float(unsigned verbose, FILE *fp,
    LLVMValueRef fetch = NULL;
    fetch_ptr_t fetch_ptr;
    PIPE_ALIGN_VAR(16) float unpacked[4];
+   const uint8_t *packed = NULL;
+   double cycles = 0.0;
    boolean first = TRUE;
    boolean success = TRUE;
    unsigned i, j, k, l;
@@ -151,11 +182,13 @@ test_format_float(unsigned verbose, FILE *fp,
 
       if (test->format == desc->format) {
 
-         if (first) {
+         packed = test->packed;
+
+         if (first && (!benchmark_mode || verbose)) {
             printf("Testing %s (float) ...\n",
                    desc->name);
-            first = FALSE;
          }
+         first = FALSE;
 
          for (i = 0; i < desc->block.height; ++i) {
             for (j = 0; j < desc->block.width; ++j) {
@@ -199,12 +232,15 @@ test_format_float(unsigned verbose, FILE *fp,
       }
    }
 
+   if (fp)
+      cycles = time_fetch(fetch_ptr, unpacked, packed);
+
    gallivm_free_function(gallivm, fetch, fetch_ptr);
 
    gallivm_destroy(gallivm);
 
    if(fp)
-      write_tsv_row(fp, desc, success);
+      write_tsv_row(fp, desc, lp_float32_vec4_type(), cycles, success);
 
    return success;
 }
@@ -219,6 +255,8 @@ test_format_unorm8(unsigned verbose, FILE *fp,
    LLVMValueRef fetch = NULL;
    fetch_ptr_t fetch_ptr;
    uint8_t unpacked[4];
+   const uint8_t *packed = NULL;
+   double cycles = 0.0;
    boolean first = TRUE;
    boolean success = TRUE;
    unsigned i, j, k, l;
@@ -236,11 +274,13 @@ test_format_unorm8(unsigned verbose, FILE *fp,
 
       if (test->format == desc->format) {
 
-         if (first) {
+         packed = test->packed;
+
+         if (first && (!benchmark_mode || verbose)) {
             printf("Testing %s (unorm8) ...\n",
                    desc->name);
-            first = FALSE;
          }
+         first = FALSE;
 
          for (i = 0; i < desc->block.height; ++i) {
             for (j = 0; j < desc->block.width; ++j) {
@@ -284,12 +324,15 @@ test_format_unorm8(unsigned verbose, FILE *fp,
       }
    }
 
+   if (fp)
+      cycles = time_fetch(fetch_ptr, unpacked, packed);
+
    gallivm_free_function(gallivm, fetch, fetch_ptr);
 
    gallivm_destroy(gallivm);
 
    if(fp)
-      write_tsv_row(fp, desc, success);
+      write_tsv_row(fp, desc, lp_unorm8_vec4_type(), cycles, success);
 
    return success;
 }
@@ -36,6 +36,7 @@
 
 #include "util/u_cpu_detect.h"
 #include "util/u_math.h"
+#include "util/u_memory.h"
 
 #include "gallivm/lp_bld_const.h"
 #include "gallivm/lp_bld_init.h"
@@ -43,6 +44,9 @@
 #include "lp_test.h"
 
 
+boolean benchmark_mode = FALSE;
+
+
 void
 dump_type(FILE *fp,
           struct lp_type type)
@@ -362,6 +366,111 @@ dump_vec(FILE *fp, struct lp_type type, const void *src)
 }
 
 
+/**
+ * Average of the cycle counts of several runs.
+ *
+ * Unfortunately the output of cycle counter is not very reliable as it comes
+ * -- sometimes we get outliers (due IRQs perhaps?) which are
+ * better removed to avoid random or biased data.
+ */
+double
+average_cycles(const int64_t *cycles, unsigned n)
+{
+   double sum = 0.0, sum2 = 0.0;
+   double avg, std;
+   unsigned i, m;
+
+   for(i = 0; i < n; ++i) {
+      sum += cycles[i];
+      sum2 += cycles[i]*cycles[i];
+   }
+
+   avg = sum/n;
+   std = sqrtf((sum2 - n*avg*avg)/n);
+
+   m = 0;
+   sum = 0.0;
+   for(i = 0; i < n; ++i) {
+      if(fabs(cycles[i] - avg) <= 4.0*std) {
+         sum += cycles[i];
+         ++m;
+      }
+   }
+
+   return m ? sum/m : avg;
+}
+
+
+/**
+ * Describe the build and CPU in "# key=value" lines, so that benchmark
+ * results from different Mesa/LLVM versions and machines can be told apart.
+ */
+static void
+write_tsv_comments(FILE *fp, const char *cpu_level)
+{
+#ifdef PACKAGE_VERSION
+   fprintf(fp, "# mesa=%s\n", PACKAGE_VERSION);
+#endif
+   fprintf(fp, "# llvm=%u.%u\n", HAVE_LLVM >> 8, HAVE_LLVM & 0xff);
+   fprintf(fp, "# cpu_level=%s\n", cpu_level);
+   fprintf(fp, "# cpu_caps=%s%s%s%s%s%s%s%s\n",
+           util_cpu_caps.has_sse2 ? "sse2" : "none",
+           util_cpu_caps.has_sse3 ? ",sse3" : "",
+           util_cpu_caps.has_ssse3 ? ",ssse3" : "",
+           util_cpu_caps.has_sse4_1 ? ",sse4.1" : "",
+           util_cpu_caps.has_sse4_2 ? ",sse4.2" : "",
+           util_cpu_caps.has_avx ? ",avx" : "",
+           util_cpu_caps.has_avx2 ? ",avx2" : "",
+           util_cpu_caps.has_f16c ? ",f16c" : "");
+   fprintf(fp, "# vector_width=%u\n", lp_native_vector_width);
+   fprintf(fp, "# samples=%u\n", LP_TEST_NUM_SAMPLES);
+}
+
+
+/**
+ * Hide the CPU features above a level, so that the code generated for
+ * older CPUs can be measured on the same machine.
+ */
+static boolean
+limit_cpu_caps(const char *level)
+{
+   static const char *levels[] = {
+      "sse2", "sse3", "ssse3", "sse4.1", "sse4.2", "avx", "avx2"
+   };
+   unsigned i;
+
+   if (strcmp(level, "native") == 0)
+      return TRUE;
+
+   for (i = 0; i < Elements(levels); i++) {
+      if (strcmp(level, levels[i]) == 0)
+         break;
+   }
+   if (i == Elements(levels))
+      return FALSE;
+
+   if (i < 1)
+      util_cpu_caps.has_sse3 = 0;
+   if (i < 2)
+      util_cpu_caps.has_ssse3 = 0;
+   if (i < 3)
+      util_cpu_caps.has_sse4_1 = 0;
+   if (i < 4) {
+      util_cpu_caps.has_sse4_2 = 0;
+      util_cpu_caps.has_popcnt = 0;
+   }
+   if (i < 5) {
+      util_cpu_caps.has_avx = 0;
+      util_cpu_caps.has_f16c = 0;
+      util_cpu_caps.has_xop = 0;
+   }
+   if (i < 6)
+      util_cpu_caps.has_avx2 = 0;
+
+   return TRUE;
+}
+
+
 int main(int argc, char **argv)
 {
    unsigned verbose = 0;
@@ -370,6 +479,7 @@ int main(int argc, char **argv)
    unsigned i;
    boolean success;
    boolean single = FALSE;
+   const char *cpu_level = "native";
    unsigned fpstate;
 
    util_cpu_detect();
@@ -383,10 +493,21 @@ int main(int argc, char **argv)
          single = TRUE;
       else if(strcmp(argv[i], "-o") == 0)
          fp = fopen(argv[++i], "wt");
+      else if(strcmp(argv[i], "-b") == 0)
+         benchmark_mode = TRUE;
+      else if(strcmp(argv[i], "-c") == 0)
+         cpu_level = argv[++i];
       else
          n = atoi(argv[i]);
    }
 
+   /* Before lp_build_init(), which picks the vector width from these */
+   if (!limit_cpu_caps(cpu_level)) {
+      fprintf(stderr, "unknown CPU level %s, expected native, sse2, sse3, "
+              "ssse3, sse4.1, sse4.2, avx or avx2\n", cpu_level);
+      return 1;
+   }
+
    lp_build_init();
 
 #ifdef DEBUG
@@ -398,13 +519,20 @@ int main(int argc, char **argv)
 
    util_cpu_detect();
 
+   if (benchmark_mode && !fp) {
+      fp = stdout;
+   }
+
    if(fp) {
       /* Warm up the caches */
       test_some(0, NULL, 100);
 
+      if (benchmark_mode)
+         write_tsv_comments(fp, cpu_level);
       write_tsv_header(fp);
    }
-      
+
+
    if (single)
       success = test_single(verbose, fp);
    else if (n)
@@ -412,7 +540,7 @@ int main(int argc, char **argv)
    else
       success = test_all(verbose, fp);
 
-   if(fp)
+   if(fp && fp != stdout)
       fclose(fp);
 
    return success ? 0 : 1;
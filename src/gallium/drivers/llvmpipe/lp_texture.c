@@ -36,14 +36,20 @@
 #include "pipe/p_defines.h"
 
 #include "util/u_inlines.h"
+#include "util/u_box.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
+#include "util/u_surface.h"
 #include "util/u_transfer.h"
 
+#include "gallivm/lp_bld_sample.h"
+
 #include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_fence.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
@@ -109,6 +115,14 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
                                              align(height, align_y));
          block_size = util_format_get_blocksize(pt->format);
 
+         if (lpr->tiled) {
+            /* Whole tiles.  As the block size is a power of two the
+             * cache line alignment below keeps this.
+             */
+            nblocksx = align(nblocksx, LP_TEX_TILE_SIZE);
+            nblocksy = align(nblocksy, LP_TEX_TILE_SIZE);
+         }
+
          if (util_format_is_compressed(pt->format))
             lpr->row_stride[level] = nblocksx * block_size;
          else
@@ -121,6 +135,10 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
          }
 
          lpr->img_stride[level] = lpr->row_stride[level] * nblocksy;
+
+         /* the row stride of a tiled image is that of a row of tiles */
+         if (lpr->tiled)
+            lpr->row_stride[level] *= LP_TEX_TILE_SIZE;
       }
 
       /* Number of 3D image slices, cube faces or texture array layers */
@@ -166,6 +184,49 @@ fail:
 }
 
 
+/**
+ * Can the texture be stored with the tiled layout?  It must be one the
+ * sampler code can address that way, and not a buffer we'd share or
+ * render to from the start.  Render targets are allowed, as most
+ * textures have the bind flag without ever being rendered to, and
+ * untiled when a surface is created for them.
+ */
+static boolean
+llvmpipe_resource_tileable(const struct llvmpipe_resource *lpr)
+{
+   const struct pipe_resource *pt = &lpr->base;
+   const struct util_format_description *desc =
+      util_format_description(pt->format);
+
+   if (!(LP_PERF & PERF_TILED_TEX))
+      return FALSE;
+
+   if (!(pt->bind & PIPE_BIND_SAMPLER_VIEW) ||
+       (pt->bind & ~(PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_RENDER_TARGET)))
+      return FALSE;
+
+   /* staging textures are mapped all the time */
+   if (pt->usage == PIPE_USAGE_STAGING || pt->nr_samples > 1)
+      return FALSE;
+
+   switch (pt->target) {
+   case PIPE_TEXTURE_2D:
+   case PIPE_TEXTURE_2D_ARRAY:
+   case PIPE_TEXTURE_RECT:
+   case PIPE_TEXTURE_3D:
+   case PIPE_TEXTURE_CUBE:
+      break;
+   default:
+      return FALSE;
+   }
+
+   return desc &&
+          desc->block.width == desc->block.height &&
+          desc->block.bits >= 8 &&
+          util_is_power_of_two(desc->block.bits);
+}
+
+
 /**
  * Check the size of the texture specified by 'res'.
  * \return TRUE if OK, FALSE if too large.
@@ -245,6 +306,7 @@ llvmpipe_resource_create(struct pipe_screen *_screen,
       }
       else {
          /* texture map */
+         lpr->tiled = llvmpipe_resource_tileable(lpr);
          if (!llvmpipe_texture_layout(screen, lpr))
             goto fail;
       }
@@ -301,7 +363,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->linear_img.data) {
+      if (lpr->linear_img.data && !lpr->userBuffer) {
          align_free(lpr->linear_img.data);
          lpr->linear_img.data = NULL;
       }
@@ -316,6 +378,9 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
       remove_from_list(lpr);
 #endif
 
+   lp_fence_reference(&lpr->fence, NULL);
+   lp_fence_reference(&lpr->write_fence, NULL);
+
    FREE(lpr);
 }
 
@@ -462,6 +527,76 @@ no_lpr:
 }
 
 
+/**
+ * Create a resource which uses the given user memory as storage.
+ * Buffers we render to need padding past the end, so those are refused.
+ * Single level 2D textures are accepted when the user memory matches the
+ * layout we would have allocated, which is the case when the width fills
+ * whole cache lines and the height is a multiple of the raster block size.
+ */
+static struct pipe_resource *
+llvmpipe_resource_from_user_memory(struct pipe_screen *screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory)
+{
+   struct llvmpipe_resource *lpr;
+
+   if (templat->target == PIPE_BUFFER) {
+      if (templat->bind & PIPE_BIND_RENDER_TARGET)
+         return NULL;
+   }
+   else if (templat->target != PIPE_TEXTURE_2D &&
+            templat->target != PIPE_TEXTURE_RECT) {
+      return NULL;
+   }
+   else if (templat->last_level != 0 ||
+            templat->depth0 != 1 ||
+            templat->array_size != 1 ||
+            util_format_is_compressed(templat->format) ||
+            (templat->bind & (PIPE_BIND_DISPLAY_TARGET |
+                              PIPE_BIND_SCANOUT |
+                              PIPE_BIND_SHARED))) {
+      return NULL;
+   }
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = screen;
+
+   lpr->userBuffer = TRUE;
+
+   if (llvmpipe_resource_is_texture(&lpr->base)) {
+      unsigned stride = util_format_get_stride(templat->format,
+                                               templat->width0);
+
+      if (!llvmpipe_texture_layout(llvmpipe_screen(screen), lpr) ||
+          lpr->row_stride[0] != stride ||
+          lpr->img_stride[0] != stride * templat->height0) {
+         FREE(lpr);
+         return NULL;
+      }
+
+      lpr->linear_img.data = user_memory;
+   }
+   else {
+      lpr->data = user_memory;
+      lpr->row_stride[0] = templat->width0;
+   }
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
 static boolean
 llvmpipe_resource_get_handle(struct pipe_screen *screen,
                             struct pipe_resource *pt,
@@ -478,6 +613,127 @@ llvmpipe_resource_get_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Copy a box of a tiled texture level to linear memory, or back.
+ * The box is in pixels, and must be aligned to the pixel blocks.
+ */
+static void
+tiled_copy_box(struct llvmpipe_resource *lpr, unsigned level,
+               const struct pipe_box *box,
+               ubyte *linear, unsigned stride, unsigned layer_stride,
+               boolean to_tiled)
+{
+   const enum pipe_format format = lpr->base.format;
+   const unsigned block_size = util_format_get_blocksize(format);
+   const unsigned tile_size =
+      block_size * LP_TEX_TILE_SIZE * LP_TEX_TILE_SIZE;
+   const unsigned bx0 = box->x / util_format_get_blockwidth(format);
+   const unsigned by0 = box->y / util_format_get_blockheight(format);
+   const unsigned nblocksx = util_format_get_nblocksx(format, box->width);
+   const unsigned nblocksy = util_format_get_nblocksy(format, box->height);
+   unsigned x, y;
+   int z;
+
+   assert(lpr->tiled);
+
+   for (z = 0; z < box->depth; z++) {
+      ubyte *image = llvmpipe_get_texture_image_address(lpr, box->z + z,
+                                                        level);
+      ubyte *row = linear + z * layer_stride;
+
+      for (y = 0; y < nblocksy; y++) {
+         const unsigned by = by0 + y;
+         ubyte *tile_row = image +
+            (by >> LP_TEX_TILE_ORDER) * lpr->row_stride[level] +
+            (by & (LP_TEX_TILE_SIZE - 1)) * LP_TEX_TILE_SIZE * block_size;
+
+         /* the blocks of a row are contiguous within a tile */
+         for (x = 0; x < nblocksx; ) {
+            const unsigned bx = bx0 + x;
+            const unsigned n = MIN2(LP_TEX_TILE_SIZE -
+                                    (bx & (LP_TEX_TILE_SIZE - 1)),
+                                    nblocksx - x);
+            ubyte *tiled = tile_row +
+               (bx >> LP_TEX_TILE_ORDER) * tile_size +
+               (bx & (LP_TEX_TILE_SIZE - 1)) * block_size;
+
+            if (to_tiled)
+               memcpy(tiled, row + x * block_size, n * block_size);
+            else
+               memcpy(row + x * block_size, tiled, n * block_size);
+
+            x += n;
+         }
+
+         row += stride;
+      }
+   }
+}
+
+
+/**
+ * Convert a tiled texture to the linear layout, before rendering to it.
+ * The linear images take the same space as the tiled ones, only the
+ * row strides change, so this is done in place.
+ * \return FALSE if out of memory
+ */
+boolean
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct llvmpipe_resource *lpr)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lpr->base.screen);
+   unsigned level;
+   ubyte *tmp = NULL;
+
+   if (!lpr->tiled)
+      return TRUE;
+
+   /* wait for the scenes sampling it */
+   llvmpipe_flush_resource(pipe, &lpr->base, 0,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           __FUNCTION__);
+
+   if (lpr->linear_img.data) {
+      /* level zero has the largest images */
+      tmp = CALLOC(1, lpr->img_stride[0]);
+      if (!tmp)
+         return FALSE;
+   }
+
+   for (level = 0; level <= lpr->base.last_level; level++) {
+      if (tmp) {
+         const unsigned stride = lpr->row_stride[level] / LP_TEX_TILE_SIZE;
+         struct pipe_box box;
+         unsigned slice;
+
+         u_box_2d(0, 0,
+                  u_minify(lpr->base.width0, level),
+                  u_minify(lpr->base.height0, level), &box);
+
+         for (slice = 0; slice < lpr->num_slices_faces[level]; slice++) {
+            box.z = slice;
+            tiled_copy_box(lpr, level, &box, tmp, stride, 0, FALSE);
+            memcpy(llvmpipe_get_texture_image_address(lpr, slice, level),
+                   tmp, lpr->img_stride[level]);
+         }
+      }
+
+      lpr->row_stride[level] /= LP_TEX_TILE_SIZE;
+   }
+
+   FREE(tmp);
+
+   lpr->tiled = FALSE;
+
+   /* have the contexts pick up the new layout */
+   screen->timestamp++;
+
+   return TRUE;
+}
+
+
 static void *
 llvmpipe_transfer_map( struct pipe_context *pipe,
                        struct pipe_resource *resource,
@@ -499,6 +755,10 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   /* tiled textures can't be mapped directly */
+   if (lpr->tiled && (usage & PIPE_TRANSFER_MAP_DIRECTLY))
+      return NULL;
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush the
     * context if necessary.
@@ -585,6 +845,29 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       screen->timestamp++;
    }
 
+   if (lpr->tiled) {
+      /* map a linear copy of the box, written back at unmap */
+      pt->stride = util_format_get_stride(format, box->width);
+      pt->layer_stride = util_format_get_2d_size(format, pt->stride,
+                                                 box->height);
+      lpt->staging = MALLOC(pt->layer_stride * box->depth);
+      if (!map || !lpt->staging) {
+         FREE(lpt->staging);
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         *transfer = NULL;
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_TRANSFER_DISCARD_RANGE |
+                     PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))) {
+         tiled_copy_box(lpr, level, box, lpt->staging,
+                        pt->stride, pt->layer_stride, FALSE);
+      }
+
+      return lpt->staging;
+   }
+
    map +=
       box->y / util_format_get_blockheight(format) * pt->stride +
       box->x / util_format_get_blockwidth(format) * util_format_get_blocksize(format);
@@ -597,6 +880,8 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
    llvmpipe_resource_unmap(transfer->resource,
@@ -605,8 +890,34 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
 
    /* Effectively do the texture_update work here - if texture images
     * needed post-processing to put them into hardware layout, this is
-    * where it would happen.  For llvmpipe, nothing to do.
+    * where it would happen.  For llvmpipe, only tiled textures need it.
     */
+   if (lpt->staging) {
+      struct llvmpipe_resource *lpr = llvmpipe_resource(transfer->resource);
+      const struct pipe_box *box = &transfer->box;
+
+      if (!(transfer->usage & PIPE_TRANSFER_WRITE)) {
+         /* nothing to write back */
+      }
+      else if (lpr->tiled) {
+         tiled_copy_box(lpr, transfer->level, box, lpt->staging,
+                        transfer->stride, transfer->layer_stride, TRUE);
+      }
+      else {
+         /* untiled while mapped */
+         util_copy_box(llvmpipe_get_texture_image_address(lpr, box->z,
+                                                          transfer->level),
+                       lpr->base.format,
+                       lpr->row_stride[transfer->level],
+                       lpr->img_stride[transfer->level],
+                       box->x, box->y, 0,
+                       box->width, box->height, box->depth,
+                       lpt->staging, transfer->stride, transfer->layer_stride,
+                       0, 0, 0);
+      }
+      FREE(lpt->staging);
+   }
+
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
    FREE(transfer);
@@ -634,6 +945,32 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
 }
 
 
+/**
+ * Fence to wait on before the CPU may access the resource: the last queued
+ * scene writing it for reads, the last one using it at all for writes.
+ * Scenes are rasterized in order, so earlier ones are done by then too.
+ * Returns a new reference, or NULL if no rasterization is pending.
+ */
+struct lp_fence *
+llvmpipe_resource_busy_fence(struct pipe_screen *pscreen,
+                             struct pipe_resource *resource,
+                             boolean read_only)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(pscreen);
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   struct lp_fence *fence = NULL;
+
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_fence_reference(&fence, read_only ? lpr->write_fence : lpr->fence);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   if (fence && lp_fence_signalled(fence))
+      lp_fence_reference(&fence, NULL);
+
+   return fence;
+}
+
+
 /**
  * Returns the largest possible alignment for a format in llvmpipe
  */
@@ -949,6 +1286,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
    screen->resource_create = llvmpipe_resource_create;
    screen->resource_destroy = llvmpipe_resource_destroy;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
+   screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
    screen->can_create_resource = llvmpipe_can_create_resource;
 }
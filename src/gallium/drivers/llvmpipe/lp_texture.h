@@ -45,6 +45,7 @@ enum lp_texture_usage
 struct pipe_context;
 struct pipe_screen;
 struct llvmpipe_context;
+struct lp_fence;
 
 struct sw_displaytarget;
 
@@ -92,9 +93,24 @@ struct llvmpipe_resource
     */
    void *data;
 
+   /**
+    * Are the images stored in LP_TEX_TILE_SIZE square tiles of blocks?
+    * Only textures which are just sampled are laid out this way, see
+    * llvmpipe_resource_untile().  row_stride is then the size of a row of
+    * tiles, and transfers go through a linear staging copy.
+    */
+   boolean tiled;
+
    boolean userBuffer;  /** Is this a user-space buffer? */
    unsigned timestamp;
 
+   /**
+    * Fences of the last queued scenes using and writing this resource,
+    * protected by the screen's rast_mutex.  See lp_scene_fence_resources().
+    */
+   struct lp_fence *fence;
+   struct lp_fence *write_fence;
+
    unsigned id;  /**< temporary, for debugging */
 
 #ifdef DEBUG
@@ -109,6 +125,9 @@ struct llvmpipe_transfer
    struct pipe_transfer base;
 
    unsigned long offset;
+
+   /** Linear copy of the box, for tiled textures */
+   ubyte *staging;
 };
 
 
@@ -240,6 +259,10 @@ llvmpipe_get_texture_tile_linear(struct llvmpipe_resource *lpr,
                                  enum lp_texture_usage usage,
                                  unsigned x, unsigned y);
 
+boolean
+llvmpipe_resource_untile(struct pipe_context *pipe,
+                         struct llvmpipe_resource *lpr);
+
 
 extern void
 llvmpipe_print_resources(void);
@@ -254,6 +277,11 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
                                  struct pipe_resource *presource,
                                  unsigned level);
 
+struct lp_fence *
+llvmpipe_resource_busy_fence(struct pipe_screen *screen,
+                             struct pipe_resource *resource,
+                             boolean read_only);
+
 unsigned
 llvmpipe_get_format_alignment(enum pipe_format format);
 
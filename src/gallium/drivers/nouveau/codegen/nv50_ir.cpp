@@ -1168,6 +1168,8 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
    prog->dbgFlags = info->dbgFlags;
    prog->optLevel = info->optLevel;
 
+   nv50_ir::PassTimer timer(prog->dbgFlags & NV50_IR_DEBUG_TIMING);
+
    switch (info->bin.sourceRep) {
 #if 0
    case PIPE_IR_LLVM:
@@ -1182,6 +1184,7 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
       ret = prog->makeFromTGSI(info) ? 0 : -2;
       break;
    }
+   timer.mark("translate");
    if (ret < 0)
       goto out;
    if (prog->dbgFlags & NV50_IR_DEBUG_VERBOSE)
@@ -1191,12 +1194,14 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
    prog->getTarget()->runLegalizePass(prog, nv50_ir::CG_STAGE_PRE_SSA);
 
    prog->convertToSSA();
+   timer.mark("SSA");
 
    if (prog->dbgFlags & NV50_IR_DEBUG_VERBOSE)
       prog->print();
 
    prog->optimizeSSA(info->optLevel);
    prog->getTarget()->runLegalizePass(prog, nv50_ir::CG_STAGE_SSA);
+   timer.mark("optimize SSA");
 
    if (prog->dbgFlags & NV50_IR_DEBUG_BASIC)
       prog->print();
@@ -1205,14 +1210,17 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
       ret = -4;
       goto out;
    }
+   timer.mark("register allocation");
    prog->getTarget()->runLegalizePass(prog, nv50_ir::CG_STAGE_POST_RA);
 
    prog->optimizePostRA(info->optLevel);
+   timer.mark("optimize post-RA");
 
    if (!prog->emitBinary(info)) {
       ret = -5;
       goto out;
    }
+   timer.mark("emit");
 
 out:
    INFO_DBG(prog->dbgFlags, VERBOSE, "nv50_ir_generate_code: ret = %i\n", ret);
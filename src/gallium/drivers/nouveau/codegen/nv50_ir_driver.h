@@ -68,6 +68,7 @@ struct nv50_ir_varying
 # define NV50_IR_DEBUG_VERBOSE   0
 # define NV50_IR_DEBUG_REG_ALLOC 0
 #endif
+#define NV50_IR_DEBUG_TIMING     (1 << 3) /* also in release builds */
 
 #define NV50_SEMANTIC_CLIPDISTANCE  (TGSI_SEMANTIC_COUNT + 0)
 #define NV50_SEMANTIC_VIEWPORTINDEX (TGSI_SEMANTIC_COUNT + 4)
@@ -209,6 +210,9 @@ extern void nv50_ir_relocate_code(void *relocData, uint32_t *code,
                                   uint32_t libPos,
                                   uint32_t dataPos);
 
+/* size of the relocation data, for copying it */
+extern unsigned nv50_ir_get_reloc_size(const void *relocData);
+
 /* obtain code that will be shared among programs */
 extern void nv50_ir_get_target_library(uint32_t chipset,
                                        const uint32_t **code, uint32_t *size);
@@ -25,6 +25,9 @@
 
 #include <stack>
 #include <limits>
+#include <queue>
+#include <vector>
+#include <algorithm>
 
 namespace nv50_ir {
 
@@ -585,9 +588,9 @@ RegAlloc::BuildIntervalsPass::visit(BasicBlock *bb)
 
    // remaining live-outs are live until end
    if (bb->getExit()) {
-      for (unsigned int j = 0; j < bb->liveSet.getSize(); ++j)
-         if (bb->liveSet.test(j))
-            addLiveRange(func->getLValue(j), bb, bb->getExit()->serial + 1);
+      for (int j = bb->liveSet.findSet(0); j >= 0;
+           j = bb->liveSet.findSet(j + 1))
+         addLiveRange(func->getLValue(j), bb, bb->getExit()->serial + 1);
    }
 
    for (Instruction *i = bb->getExit(); i && i->op != OP_PHI; i = i->prev) {
@@ -695,6 +698,7 @@ private:
 
    void simplifyEdge(RIG_Node *, RIG_Node *);
    void simplifyNode(RIG_Node *);
+   RIG_Node *selectSpillCandidate();
 
    bool coalesceValues(Value *, Value *, bool force);
    void resolveSplitsAndMerges();
@@ -702,12 +706,28 @@ private:
 
    inline void checkInterference(const RIG_Node *, Graph::EdgeIterator&);
 
-   inline void insertOrderedTail(std::list<RIG_Node *>&, RIG_Node *);
-   void checkList(std::list<RIG_Node *>&);
+   static bool beginsBefore(const RIG_Node *, const RIG_Node *);
+   void checkList(std::vector<RIG_Node *>&);
 
 private:
    std::stack<uint32_t> stack;
 
+   // spill candidates by weight / degree, lowest first; as degrees only
+   // decrease, entries may be stale and are re-queued with their new score
+   struct SpillCandidate
+   {
+      float score;
+      uint32_t id;
+
+      bool operator<(const SpillCandidate& that) const
+      {
+         if (score != that.score)
+            return score > that.score;
+         return id < that.id;
+      }
+   };
+   std::priority_queue<SpillCandidate> spillCandidates;
+
    // list headers for simplify() phase
    RIG_Node lo[2];
    RIG_Node hi;
@@ -1042,11 +1062,11 @@ GCRA::~GCRA()
 }
 
 void
-GCRA::checkList(std::list<RIG_Node *>& lst)
+GCRA::checkList(std::vector<RIG_Node *>& lst)
 {
    GCRA::RIG_Node *prev = NULL;
 
-   for (std::list<RIG_Node *>::iterator it = lst.begin();
+   for (std::vector<RIG_Node *>::iterator it = lst.begin();
         it != lst.end();
         ++it) {
       assert((*it)->getValue()->join == (*it)->getValue());
@@ -1056,56 +1076,61 @@ GCRA::checkList(std::list<RIG_Node *>& lst)
    }
 }
 
-void
-GCRA::insertOrderedTail(std::list<RIG_Node *>& list, RIG_Node *node)
+bool
+GCRA::beginsBefore(const RIG_Node *a, const RIG_Node *b)
 {
-   if (node->livei.isEmpty())
-      return;
-   // only the intervals of joined values don't necessarily arrive in order
-   std::list<RIG_Node *>::iterator prev, it;
-   for (it = list.end(); it != list.begin(); it = prev) {
-      prev = it;
-      --prev;
-      if ((*prev)->livei.begin() <= node->livei.begin())
-         break;
-   }
-   list.insert(it, node);
+   return a->livei.begin() < b->livei.begin();
 }
 
 void
 GCRA::buildRIG(ArrayList& insns)
 {
-   std::list<RIG_Node *> values, active;
+   std::vector<RIG_Node *> values;
+   std::list<RIG_Node *> active[LAST_REGISTER_FILE + 1];
+
+   values.reserve(nodeCount);
 
    for (std::deque<ValueDef>::iterator it = func->ins.begin();
         it != func->ins.end(); ++it)
-      insertOrderedTail(values, getNode(it->get()->asLValue()));
+      values.push_back(getNode(it->get()->asLValue()));
 
    for (int i = 0; i < insns.getSize(); ++i) {
       Instruction *insn = reinterpret_cast<Instruction *>(insns.get(i));
       for (int d = 0; insn->defExists(d); ++d)
          if (insn->getDef(d)->rep() == insn->getDef(d))
-            insertOrderedTail(values, getNode(insn->getDef(d)->asLValue()));
-   }
+            values.push_back(getNode(insn->getDef(d)->asLValue()));
+   }
+
+   // Values mostly arrive in order already, only the intervals of joined
+   // values don't.  The sort is stable so the edge order stays the same.
+   std::vector<RIG_Node *>::iterator end = values.begin();
+   for (std::vector<RIG_Node *>::iterator it = values.begin();
+        it != values.end(); ++it)
+      if (!(*it)->livei.isEmpty())
+         *end++ = *it;
+   values.erase(end, values.end());
+   std::stable_sort(values.begin(), values.end(), beginsBefore);
    checkList(values);
 
-   while (!values.empty()) {
-      RIG_Node *cur = values.front();
+   // Only values of the same file can interfere, so keep one list of active
+   // values per file.
+   for (unsigned int i = 0; i < values.size(); ++i) {
+      RIG_Node *cur = values[i];
+      std::list<RIG_Node *>& list = active[cur->f];
 
-      for (std::list<RIG_Node *>::iterator it = active.begin();
-           it != active.end();) {
+      for (std::list<RIG_Node *>::iterator it = list.begin();
+           it != list.end();) {
          RIG_Node *node = *it;
 
          if (node->livei.end() <= cur->livei.begin()) {
-            it = active.erase(it);
+            it = list.erase(it);
          } else {
-            if (node->f == cur->f && node->livei.overlaps(cur->livei))
+            if (node->livei.overlaps(cur->livei))
                cur->addInterference(node);
             ++it;
          }
       }
-      values.pop_front();
-      active.push_back(cur);
+      list.push_back(cur);
    }
 }
 
@@ -1140,6 +1165,10 @@ GCRA::calculateSpillWeights()
             l = 1;
          DLLIST_ADDHEAD(&lo[l], &nodes[i]);
       } else {
+         SpillCandidate c;
+         c.score = nodes[i].weight / (float)nodes[i].degree;
+         c.id = i;
+         spillCandidates.push(c);
          DLLIST_ADDHEAD(&hi, &nodes[i]);
       }
    }
@@ -1197,17 +1226,8 @@ GCRA::simplify()
          simplifyNode(lo[1].next);
       } else
       if (!DLLIST_EMPTY(&hi)) {
-         RIG_Node *best = hi.next;
-         float bestScore = best->weight / (float)best->degree;
-         // spill candidate
-         for (RIG_Node *it = best->next; it != &hi; it = it->next) {
-            float score = it->weight / (float)it->degree;
-            if (score < bestScore) {
-               best = it;
-               bestScore = score;
-            }
-         }
-         if (isinf(bestScore)) {
+         RIG_Node *best = selectSpillCandidate();
+         if (!best) {
             ERROR("no viable spill candidates left\n");
             break;
          }
@@ -1218,6 +1238,34 @@ GCRA::simplify()
    }
 }
 
+// Returns the node in hi with the lowest weight / degree, or NULL if all of
+// them are unspillable.
+GCRA::RIG_Node *
+GCRA::selectSpillCandidate()
+{
+   while (!spillCandidates.empty()) {
+      SpillCandidate c = spillCandidates.top();
+      RIG_Node *node = &nodes[c.id];
+
+      spillCandidates.pop();
+
+      // already simplified or moved to lo
+      if (DLLIST_EMPTY(node) || node->degree < node->degreeLimit)
+         continue;
+
+      const float score = node->weight / (float)node->degree;
+      if (score > c.score) {
+         c.score = score;
+         spillCandidates.push(c);
+         continue;
+      }
+      if (isinf(score))
+         return NULL;
+      return node;
+   }
+   return NULL;
+}
+
 void
 GCRA::checkInterference(const RIG_Node *node, Graph::EdgeIterator& ei)
 {
@@ -1349,8 +1397,11 @@ GCRA::allocateRegisters(ArrayList& insns)
       }
    }
 
+   PassTimer timer(prog->dbgFlags & NV50_IR_DEBUG_TIMING);
+
    // coalesce first, we use only 1 RIG node for a group of joined values
    ret = coalesce(insns);
+   timer.mark("RA: coalesce");
    if (!ret)
       goto out;
 
@@ -1358,15 +1409,19 @@ GCRA::allocateRegisters(ArrayList& insns)
       func->printLiveIntervals();
 
    buildRIG(insns);
+   timer.mark("RA: build RIG");
    calculateSpillWeights();
    simplify();
+   timer.mark("RA: simplify");
 
    ret = selectRegisters();
+   timer.mark("RA: select");
    if (!ret) {
       INFO_DBG(prog->dbgFlags, REG_ALLOC,
                "selectRegisters failed, inserting spill code ...\n");
       regs.reset(FILE_GPR, true);
       spill.run(mustSpill);
+      timer.mark("RA: spill");
       if (prog->dbgFlags & NV50_IR_DEBUG_REG_ALLOC)
          func->print();
    } else {
@@ -1382,6 +1437,8 @@ void
 GCRA::cleanup(const bool success)
 {
    mustSpill.clear();
+   while (!spillCandidates.empty())
+      spillCandidates.pop();
 
    for (ArrayList::Iterator it = func->allLValues.iterator();
         !it.end(); it.next()) {
@@ -1615,17 +1672,21 @@ RegAlloc::execFunc()
       if (prog->dbgFlags & NV50_IR_DEBUG_REG_ALLOC)
          func->print();
 
+      PassTimer timer(prog->dbgFlags & NV50_IR_DEBUG_TIMING);
+
       // spilling to registers may add live ranges, need to rebuild everything
       ret = true;
       for (sequence = func->cfg.nextSequence(), i = 0;
            ret && i <= func->loopNestingBound;
            sequence = func->cfg.nextSequence(), ++i)
          ret = buildLiveSets(BasicBlock::get(func->cfg.getRoot()));
+      timer.mark("RA: live sets");
       if (!ret)
          break;
       func->orderInstructions(this->insns);
 
       ret = buildIntervals.run(func);
+      timer.mark("RA: live intervals");
       if (!ret)
          break;
       ret = gcra.allocateRegisters(insns);
@@ -457,6 +457,15 @@ nv50_ir_relocate_code(void *relocData, uint32_t *code,
       info->entry[i].apply(code, info);
 }
 
+unsigned
+nv50_ir_get_reloc_size(const void *relocData)
+{
+   const nv50_ir::RelocInfo *info =
+      reinterpret_cast<const nv50_ir::RelocInfo *>(relocData);
+
+   return sizeof(nv50_ir::RelocInfo) + info->count * sizeof(info->entry[0]);
+}
+
 void
 nv50_ir_get_target_library(uint32_t chipset,
                            const uint32_t **code, uint32_t *size)
@@ -368,6 +368,25 @@ int BitSet::findFreeRange(unsigned int count) const
    return ((pos + count) <= size) ? pos : -1;
 }
 
+int BitSet::findSet(unsigned int i) const
+{
+   const unsigned int end = (size + 31) / 32;
+   unsigned int w = i / 32;
+   uint32_t bits;
+
+   if (i >= size)
+      return -1;
+   bits = data[w] & (0xffffffff << (i % 32));
+   while (!bits) {
+      if (++w >= end)
+         return -1;
+      bits = data[w];
+   }
+   i = w * 32 + ffs(bits) - 1;
+
+   return (i < size) ? i : -1;
+}
+
 void BitSet::print() const
 {
    unsigned int n = 0;
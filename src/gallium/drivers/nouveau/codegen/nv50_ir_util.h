@@ -35,6 +35,7 @@
 
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "os/os_time.h"
 
 #define ERROR(args...) debug_printf("ERROR: " args)
 #define WARN(args...) debug_printf("WARNING: " args)
@@ -470,6 +471,28 @@ private:
    Range *tail;
 };
 
+// Prints the time spent since the previous mark, if enabled.
+class PassTimer
+{
+public:
+   PassTimer(bool enable) : enabled(enable), last(enable ? os_time_get_nano() : 0)
+   {
+   }
+
+   inline void mark(const char *name)
+   {
+      if (enabled) {
+         const int64_t now = os_time_get_nano();
+         INFO("%s: %.3f ms\n", name, (now - last) * 1e-6);
+         last = now;
+      }
+   }
+
+private:
+   bool enabled;
+   int64_t last;
+};
+
 class BitSet
 {
 public:
@@ -537,6 +560,9 @@ public:
    // Find a range of size (<= 32) clear bits aligned to roundup_pow2(size).
    int findFreeRange(unsigned int size) const;
 
+   // Index of the first set bit at or after i, -1 if there is none.
+   int findSet(unsigned int i) const;
+
    BitSet& operator|=(const BitSet&);
 
    BitSet& operator=(const BitSet& set)
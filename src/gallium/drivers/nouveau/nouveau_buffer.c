@@ -523,6 +523,58 @@ nouveau_resource_map_offset(struct nouveau_context *nv,
    return (uint8_t *)res->bo->map + res->offset + offset;
 }
 
+/* Writes to VRAM buffers too large for the pushbuf would get their own GART
+ * staging allocation through transfer_map. The data is only needed until
+ * the copy is emitted, so put it into the context's scratch ring instead.
+ */
+static void
+nouveau_buffer_transfer_inline_write(struct pipe_context *pipe,
+                                     struct pipe_resource *resource,
+                                     unsigned level, unsigned usage,
+                                     const struct pipe_box *box,
+                                     const void *data,
+                                     unsigned stride, unsigned layer_stride)
+{
+   struct nouveau_context *nv = nouveau_context(pipe);
+   struct nv04_resource *buf = nv04_resource(resource);
+   struct nouveau_bo *bo;
+   uint64_t addr;
+   uint8_t *map = NULL;
+
+   if (buf->domain == NOUVEAU_BO_VRAM &&
+       box->width > NOUVEAU_TRANSFER_PUSHBUF_THRESHOLD &&
+       box->width <= nv->scratch.bo_size)
+      map = nouveau_scratch_get(nv, box->width, &addr, &bo);
+   if (!map) {
+      u_default_transfer_inline_write(pipe, resource, level, usage, box,
+                                      data, stride, layer_stride);
+      return;
+   }
+   memcpy(map, data, box->width);
+
+   NOUVEAU_DRV_STAT(nv->screen, buf_transfers_wr, 1);
+   NOUVEAU_DRV_STAT(nv->screen, buf_write_bytes_staging_vid, box->width);
+
+   if (usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE)
+      buf->status &= NOUVEAU_BUFFER_STATUS_REALLOC_MASK;
+   if (buf->status & NOUVEAU_BUFFER_STATUS_GPU_WRITING) {
+      align_free(buf->data);
+      buf->data = NULL;
+   }
+   if (buf->data)
+      memcpy(buf->data + box->x, data, box->width);
+   else
+      buf->status |= NOUVEAU_BUFFER_STATUS_DIRTY;
+
+   nv->copy_data(nv, buf->bo, buf->offset + box->x, buf->domain,
+                 bo, addr - bo->offset, NOUVEAU_BO_GART, box->width);
+   nouveau_scratch_done(nv);
+
+   if (buf->base.bind & (PIPE_BIND_VERTEX_BUFFER | PIPE_BIND_INDEX_BUFFER))
+      nv->vbo_dirty = TRUE;
+   if (buf->base.bind & PIPE_BIND_CONSTANT_BUFFER)
+      nv->cb_dirty = TRUE;
+}
 
 const struct u_resource_vtbl nouveau_buffer_vtbl =
 {
@@ -531,7 +583,7 @@ const struct u_resource_vtbl nouveau_buffer_vtbl =
    nouveau_buffer_transfer_map,          /* transfer_map */
    nouveau_buffer_transfer_flush_region, /* transfer_flush_region */
    nouveau_buffer_transfer_unmap,        /* transfer_unmap */
-   u_default_transfer_inline_write    /* transfer_inline_write */
+   nouveau_buffer_transfer_inline_write  /* transfer_inline_write */
 };
 
 struct pipe_resource *
@@ -21,6 +21,7 @@
 #include "nouveau_fence.h"
 #include "nouveau_mm.h"
 #include "nouveau_buffer.h"
+#include "nouveau_shader_cache.h"
 
 /* XXX this should go away */
 #include "state_tracker/drm_driver.h"
@@ -188,12 +189,19 @@ nouveau_screen_init(struct nouveau_screen *screen, struct nouveau_device *dev)
 					    NOUVEAU_BO_GART | NOUVEAU_BO_MAP,
 					    &mm_config);
 	screen->mm_VRAM = nouveau_mm_create(dev, NOUVEAU_BO_VRAM, &mm_config);
+
+	if (dev->chipset >= 0x50 &&
+	    !debug_get_bool_option("NOUVEAU_NO_SHADER_CACHE", FALSE))
+		screen->shader_cache = nouveau_shader_cache_create(
+			dev->chipset >= 0xc0 ? "nvc0" : "nv50");
 	return 0;
 }
 
 void
 nouveau_screen_fini(struct nouveau_screen *screen)
 {
+	nouveau_shader_cache_destroy(screen->shader_cache);
+
 	nouveau_mm_destroy(screen->mm_GART);
 	nouveau_mm_destroy(screen->mm_VRAM);
 
@@ -14,6 +14,7 @@ typedef uint16_t u16;
 extern int nouveau_mesa_debug;
 
 struct nouveau_bo;
+struct nouveau_shader_cache;
 
 struct nouveau_screen {
 	struct pipe_screen base;
@@ -49,6 +50,8 @@ struct nouveau_screen {
 
 	boolean hint_buf_keep_sysmem_copy;
 
+	struct nouveau_shader_cache *shader_cache; /* nv50 and nvc0 only */
+
 #ifdef NOUVEAU_ENABLE_DRIVER_STATISTICS
    union {
       uint64_t v[29];
@@ -0,0 +1,216 @@
+#include "os/os_thread.h"
+#include "util/u_disk_cache.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_memory.h"
+
+#include <string.h>
+
+#include "nouveau_shader_cache.h"
+
+/* programs translated after this much is in memory only go to disk */
+#define NOUVEAU_SHADER_CACHE_MEMORY_LIMIT (32 << 20)
+
+/* entries written by another build of the driver must not be used */
+#ifdef PACKAGE_VERSION
+#define NOUVEAU_SHADER_CACHE_VERSION PACKAGE_VERSION
+#else
+#define NOUVEAU_SHADER_CACHE_VERSION ""
+#endif
+
+struct nouveau_shader_cache_key {
+	unsigned hash;
+	unsigned size;
+	const void *data;
+};
+
+/* followed by the key and the data */
+struct nouveau_shader_cache_entry {
+	struct nouveau_shader_cache_key key;
+	unsigned size;
+};
+
+struct nouveau_shader_cache {
+	pipe_mutex mutex;
+	struct util_hash_table *table;
+	unsigned memory_size;
+
+	struct u_disk_cache *disk;
+};
+
+static unsigned
+nouveau_shader_cache_hash(void *key)
+{
+	return ((struct nouveau_shader_cache_key *)key)->hash;
+}
+
+static int
+nouveau_shader_cache_compare(void *key1, void *key2)
+{
+	struct nouveau_shader_cache_key *a = key1;
+	struct nouveau_shader_cache_key *b = key2;
+
+	return a->hash != b->hash || a->size != b->size ||
+	       memcmp(a->data, b->data, a->size);
+}
+
+static enum pipe_error
+nouveau_shader_cache_free_entry(void *key, void *value, void *data)
+{
+	FREE(value);
+	return PIPE_OK;
+}
+
+struct nouveau_shader_cache *
+nouveau_shader_cache_create(const char *name)
+{
+	struct nouveau_shader_cache *cache =
+		CALLOC_STRUCT(nouveau_shader_cache);
+	if (!cache)
+		return NULL;
+
+	cache->table = util_hash_table_create(nouveau_shader_cache_hash,
+					      nouveau_shader_cache_compare);
+	if (!cache->table) {
+		FREE(cache);
+		return NULL;
+	}
+	cache->disk = u_disk_cache_create(name);
+	pipe_mutex_init(cache->mutex);
+	return cache;
+}
+
+void
+nouveau_shader_cache_destroy(struct nouveau_shader_cache *cache)
+{
+	if (!cache)
+		return;
+
+	util_hash_table_foreach(cache->table, nouveau_shader_cache_free_entry,
+				NULL);
+	util_hash_table_destroy(cache->table);
+	u_disk_cache_destroy(cache->disk);
+	pipe_mutex_destroy(cache->mutex);
+	FREE(cache);
+}
+
+/* the disk key is the version string followed by the key */
+static void *
+nouveau_shader_cache_disk_key(const void *key, unsigned key_size,
+			      unsigned *disk_key_size)
+{
+	const unsigned version_size = sizeof(NOUVEAU_SHADER_CACHE_VERSION);
+	uint8_t *disk_key = MALLOC(version_size + key_size);
+	if (!disk_key)
+		return NULL;
+
+	memcpy(disk_key, NOUVEAU_SHADER_CACHE_VERSION, version_size);
+	memcpy(disk_key + version_size, key, key_size);
+	*disk_key_size = version_size + key_size;
+	return disk_key;
+}
+
+/* must be called with the mutex held */
+static void
+nouveau_shader_cache_insert(struct nouveau_shader_cache *cache,
+			    const struct nouveau_shader_cache_key *key,
+			    const void *data, unsigned size)
+{
+	struct nouveau_shader_cache_entry *entry;
+	const unsigned entry_size = sizeof(*entry) + key->size + size;
+	uint8_t *ptr;
+
+	if (cache->memory_size + entry_size > NOUVEAU_SHADER_CACHE_MEMORY_LIMIT ||
+	    util_hash_table_get(cache->table, (void *)key))
+		return;
+
+	entry = MALLOC(entry_size);
+	if (!entry)
+		return;
+	ptr = (uint8_t *)(entry + 1);
+	memcpy(ptr, key->data, key->size);
+	memcpy(ptr + key->size, data, size);
+
+	entry->key.hash = key->hash;
+	entry->key.size = key->size;
+	entry->key.data = ptr;
+	entry->size = size;
+
+	if (util_hash_table_set(cache->table, &entry->key, entry) != PIPE_OK) {
+		FREE(entry);
+		return;
+	}
+	cache->memory_size += entry_size;
+}
+
+void *
+nouveau_shader_cache_get(struct nouveau_shader_cache *cache,
+			 const void *key, unsigned key_size, unsigned *size)
+{
+	struct nouveau_shader_cache_key lookup;
+	struct nouveau_shader_cache_entry *entry;
+	unsigned disk_key_size;
+	void *disk_key;
+	void *data = NULL;
+
+	if (!cache)
+		return NULL;
+
+	lookup.hash = util_hash_crc32(key, key_size);
+	lookup.size = key_size;
+	lookup.data = key;
+
+	pipe_mutex_lock(cache->mutex);
+	entry = util_hash_table_get(cache->table, &lookup);
+	if (entry) {
+		data = mem_dup((uint8_t *)(entry + 1) + key_size, entry->size);
+		if (data)
+			*size = entry->size;
+	}
+	pipe_mutex_unlock(cache->mutex);
+
+	if (data || !cache->disk)
+		return data;
+
+	disk_key = nouveau_shader_cache_disk_key(key, key_size, &disk_key_size);
+	if (!disk_key)
+		return NULL;
+	data = u_disk_cache_get(cache->disk, disk_key, disk_key_size, size);
+	FREE(disk_key);
+
+	if (data) {
+		pipe_mutex_lock(cache->mutex);
+		nouveau_shader_cache_insert(cache, &lookup, data, *size);
+		pipe_mutex_unlock(cache->mutex);
+	}
+	return data;
+}
+
+void
+nouveau_shader_cache_put(struct nouveau_shader_cache *cache,
+			 const void *key, unsigned key_size,
+			 const void *data, unsigned size)
+{
+	struct nouveau_shader_cache_key entry_key;
+	unsigned disk_key_size;
+	void *disk_key;
+
+	if (!cache)
+		return;
+
+	entry_key.hash = util_hash_crc32(key, key_size);
+	entry_key.size = key_size;
+	entry_key.data = key;
+
+	pipe_mutex_lock(cache->mutex);
+	nouveau_shader_cache_insert(cache, &entry_key, data, size);
+	pipe_mutex_unlock(cache->mutex);
+
+	if (!cache->disk)
+		return;
+	disk_key = nouveau_shader_cache_disk_key(key, key_size, &disk_key_size);
+	if (disk_key) {
+		u_disk_cache_put(cache->disk, disk_key, disk_key_size, data, size);
+		FREE(disk_key);
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef __NOUVEAU_SHADER_CACHE_H__
+#define __NOUVEAU_SHADER_CACHE_H__
+
+#include "pipe/p_compiler.h"
+
+/*
+ * Screen-level cache of translated programs for nv50 and nvc0.
+ *
+ * Entries are opaque blobs keyed by arbitrary bytes: the TGSI tokens and
+ * everything else the translation depends on.  They are kept in memory up
+ * to a size limit and, if MESA_SHADER_CACHE_DIR is set, on disk.
+ */
+
+struct nouveau_shader_cache;
+
+struct nouveau_shader_cache *
+nouveau_shader_cache_create(const char *name);
+
+void
+nouveau_shader_cache_destroy(struct nouveau_shader_cache *);
+
+/* On a hit, returns a MALLOC'ed copy of the data and its size in *size. */
+void *
+nouveau_shader_cache_get(struct nouveau_shader_cache *,
+			 const void *key, unsigned key_size, unsigned *size);
+
+void
+nouveau_shader_cache_put(struct nouveau_shader_cache *,
+			 const void *key, unsigned key_size,
+			 const void *data, unsigned size);
+
+#endif
@@ -24,6 +24,9 @@
 #include "nv50/nv50_context.h"
 
 #include "codegen/nv50_ir_driver.h"
+#include "tgsi/tgsi_parse.h"
+
+#include "nouveau_shader_cache.h"
 
 static INLINE unsigned
 bitcount4(const uint32_t val)
@@ -299,10 +302,124 @@ nv50_program_create_strmout_state(const struct nv50_ir_prog_info *info,
    return so;
 }
 
+/* Everything the translation depends on, followed by the TGSI tokens. */
+struct nv50_program_cache_key {
+   uint16_t chipset;
+   uint8_t type;
+   uint8_t clpd_nr;
+   struct pipe_stream_output_info so;
+};
+
+/* The translated program, followed by the code, the relocations and the
+ * stream output state.
+ */
+struct nv50_program_cache_data {
+   struct nv50_program prog;
+   unsigned fixups_size;
+};
+
+static void *
+nv50_program_cache_key(const struct nv50_program *prog, uint16_t chipset,
+                       unsigned *size)
+{
+   const unsigned tokens_size =
+      tgsi_num_tokens(prog->pipe.tokens) * sizeof(struct tgsi_token);
+   struct nv50_program_cache_key *key =
+      CALLOC(1, sizeof(*key) + tokens_size);
+   if (!key)
+      return NULL;
+
+   key->chipset = chipset;
+   key->type = prog->type;
+   key->clpd_nr = prog->vp.clpd_nr;
+   key->so = prog->pipe.stream_output;
+   memcpy(key + 1, prog->pipe.tokens, tokens_size);
+
+   *size = sizeof(*key) + tokens_size;
+   return key;
+}
+
+static void
+nv50_program_cache_store(const struct nv50_program *prog,
+                         struct nouveau_shader_cache *cache,
+                         const void *key, unsigned key_size)
+{
+   struct nv50_program_cache_data *data;
+   const unsigned fixups_size =
+      prog->fixups ? nv50_ir_get_reloc_size(prog->fixups) : 0;
+   const unsigned so_size = prog->so ? sizeof(*prog->so) : 0;
+   const unsigned size =
+      sizeof(*data) + prog->code_size + fixups_size + so_size;
+   uint8_t *ptr;
+
+   data = MALLOC(size);
+   if (!data)
+      return;
+   data->prog = *prog;
+   data->fixups_size = fixups_size;
+
+   ptr = (uint8_t *)(data + 1);
+   memcpy(ptr, prog->code, prog->code_size);
+   ptr += prog->code_size;
+   memcpy(ptr, prog->fixups, fixups_size);
+   ptr += fixups_size;
+   memcpy(ptr, prog->so, so_size);
+
+   nouveau_shader_cache_put(cache, key, key_size, data, size);
+   FREE(data);
+}
+
+static boolean
+nv50_program_cache_load(struct nv50_program *prog,
+                        const void *buf, unsigned size)
+{
+   const struct nv50_program_cache_data *data = buf;
+   const struct nv50_program *cached = &data->prog;
+   const uint8_t *ptr = (const uint8_t *)(data + 1);
+   const unsigned so_size = cached->so ? sizeof(*cached->so) : 0;
+
+   if (size < sizeof(*data) ||
+       size != sizeof(*data) + cached->code_size + data->fixups_size + so_size)
+      return FALSE;
+
+   prog->code = cached->code_size ? mem_dup(ptr, cached->code_size) : NULL;
+   ptr += cached->code_size;
+   prog->fixups = data->fixups_size ? mem_dup(ptr, data->fixups_size) : NULL;
+   ptr += data->fixups_size;
+   prog->so = so_size ? mem_dup(ptr, so_size) : NULL;
+
+   if ((cached->code_size && !prog->code) ||
+       (data->fixups_size && !prog->fixups) || (so_size && !prog->so)) {
+      FREE(prog->code);
+      FREE(prog->fixups);
+      FREE(prog->so);
+      prog->code = NULL;
+      prog->fixups = NULL;
+      prog->so = NULL;
+      return FALSE;
+   }
+
+   prog->code_size = cached->code_size;
+   prog->tls_space = cached->tls_space;
+   prog->max_gpr = cached->max_gpr;
+   prog->max_out = cached->max_out;
+   prog->in_nr = cached->in_nr;
+   prog->out_nr = cached->out_nr;
+   memcpy(prog->in, cached->in, sizeof(prog->in));
+   memcpy(prog->out, cached->out, sizeof(prog->out));
+   prog->vp = cached->vp;
+   prog->fp = cached->fp;
+   prog->gp = cached->gp;
+   return TRUE;
+}
+
 boolean
-nv50_program_translate(struct nv50_program *prog, uint16_t chipset)
+nv50_program_translate(struct nv50_program *prog, uint16_t chipset,
+                       struct nouveau_shader_cache *cache)
 {
    struct nv50_ir_prog_info *info;
+   void *key = NULL;
+   unsigned key_size;
    int ret;
    const uint8_t map_undef = (prog->type == PIPE_SHADER_VERTEX) ? 0x40 : 0x80;
 
@@ -338,6 +455,23 @@ nv50_program_translate(struct nv50_program *prog, uint16_t chipset)
    info->optLevel = 3;
 #endif
 
+   /* the debug output is expected to appear when translating */
+   if (cache && !info->dbgFlags) {
+      key = nv50_program_cache_key(prog, chipset, &key_size);
+      if (key) {
+         unsigned size;
+         void *data = nouveau_shader_cache_get(cache, key, key_size, &size);
+         if (data) {
+            boolean hit = nv50_program_cache_load(prog, data, size);
+            FREE(data);
+            if (hit) {
+               ret = 0;
+               goto out;
+            }
+         }
+      }
+   }
+
    ret = nv50_ir_generate_code(info);
    if (ret) {
       NOUVEAU_ERR("shader translation failed: %i\n", ret);
@@ -364,7 +498,11 @@ nv50_program_translate(struct nv50_program *prog, uint16_t chipset)
       prog->so = nv50_program_create_strmout_state(info,
                                                    &prog->pipe.stream_output);
 
+   if (key)
+      nv50_program_cache_store(prog, cache, key, key_size);
+
 out:
+   FREE(key);
    FREE(info);
    return !ret;
 }
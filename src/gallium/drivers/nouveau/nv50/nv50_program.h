@@ -99,7 +99,10 @@ struct nv50_program {
    struct nv50_stream_output_state *so;
 };
 
-boolean nv50_program_translate(struct nv50_program *, uint16_t chipset);
+struct nouveau_shader_cache;
+
+boolean nv50_program_translate(struct nv50_program *, uint16_t chipset,
+                               struct nouveau_shader_cache *);
 boolean nv50_program_upload_code(struct nv50_context *, struct nv50_program *);
 void nv50_program_destroy(struct nv50_context *, struct nv50_program *);
 
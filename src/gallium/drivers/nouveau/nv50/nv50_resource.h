@@ -135,6 +135,15 @@ nv50_miptree_transfer_map(struct pipe_context *pctx,
 void
 nv50_miptree_transfer_unmap(struct pipe_context *pcontext,
                             struct pipe_transfer *ptx);
+void
+nv50_miptree_transfer_inline_write(struct pipe_context *pctx,
+                                   struct pipe_resource *res,
+                                   unsigned level,
+                                   unsigned usage,
+                                   const struct pipe_box *box,
+                                   const void *data,
+                                   unsigned stride,
+                                   unsigned layer_stride);
 
 #endif /* __NVC0_RESOURCE_H__ */
 
@@ -113,7 +113,8 @@ nv50_program_validate(struct nv50_context *nv50, struct nv50_program *prog)
 {
    if (!prog->translated) {
       prog->translated = nv50_program_translate(
-         prog, nv50->screen->base.device->chipset);
+         prog, nv50->screen->base.device->chipset,
+         nv50->screen->base.shader_cache);
       if (!prog->translated)
          return FALSE;
    } else
@@ -371,6 +371,74 @@ nv50_miptree_transfer_unmap(struct pipe_context *pctx,
    FREE(tx);
 }
 
+/* Stage the data in the scratch ring rather than in a new bo per transfer. */
+void
+nv50_miptree_transfer_inline_write(struct pipe_context *pctx,
+                                   struct pipe_resource *res,
+                                   unsigned level,
+                                   unsigned usage,
+                                   const struct pipe_box *box,
+                                   const void *data,
+                                   unsigned stride,
+                                   unsigned layer_stride)
+{
+   struct nv50_context *nv50 = nv50_context(pctx);
+   struct nv50_miptree *mt = nv50_miptree(res);
+   struct nv50_m2mf_rect rect[2];
+   struct nouveau_bo *bo;
+   unsigned nblocksx, nblocksy, line, size, i, y;
+   uint64_t addr;
+   uint8_t *map = NULL;
+
+   if (util_format_is_plain(res->format)) {
+      nblocksx = box->width << mt->ms_x;
+      nblocksy = box->height << mt->ms_y;
+   } else {
+      nblocksx = util_format_get_nblocksx(res->format, box->width);
+      nblocksy = util_format_get_nblocksy(res->format, box->height);
+   }
+   line = nblocksx * util_format_get_blocksize(res->format);
+   size = line * nblocksy;
+
+   if (size * box->depth <= nv50->base.scratch.bo_size)
+      map = nouveau_scratch_get(&nv50->base, size * box->depth, &addr, &bo);
+   if (!map) {
+      u_default_transfer_inline_write(pctx, res, level, usage, box,
+                                      data, stride, layer_stride);
+      return;
+   }
+
+   for (i = 0; i < box->depth; ++i) {
+      const uint8_t *src = (const uint8_t *)data + i * layer_stride;
+      for (y = 0; y < nblocksy; ++y, src += stride, map += line)
+         memcpy(map, src, line);
+   }
+
+   nv50_m2mf_rect_setup(&rect[0], res, level, box->x, box->y, box->z);
+
+   memset(&rect[1], 0, sizeof(rect[1]));
+   rect[1].bo = bo;
+   rect[1].base = addr - bo->offset;
+   rect[1].cpp = rect[0].cpp;
+   rect[1].width = nblocksx;
+   rect[1].height = nblocksy;
+   rect[1].depth = 1;
+   rect[1].pitch = line;
+   rect[1].domain = NOUVEAU_BO_GART;
+
+   for (i = 0; i < box->depth; ++i) {
+      nv50_m2mf_transfer_rect(nv50, &rect[0], &rect[1], nblocksx, nblocksy);
+      if (mt->layout_3d)
+         rect[0].z++;
+      else
+         rect[0].base += mt->layer_stride;
+      rect[1].base += size;
+   }
+   nouveau_scratch_done(&nv50->base);
+
+   NOUVEAU_DRV_STAT(&nv50->screen->base, tex_transfers_wr, 1);
+}
+
 void
 nv50_cb_push(struct nouveau_context *nv,
              struct nouveau_bo *bo, unsigned domain,
@@ -131,7 +131,8 @@ nvc0_compute_validate_program(struct nvc0_context *nvc0)
 
    if (!prog->translated) {
       prog->translated = nvc0_program_translate(
-         prog, nvc0->screen->base.device->chipset);
+         prog, nvc0->screen->base.device->chipset,
+         nvc0->screen->base.shader_cache);
       if (!prog->translated)
          return FALSE;
    }
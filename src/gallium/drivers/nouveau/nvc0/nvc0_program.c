@@ -21,12 +21,15 @@
  */
 
 #include "pipe/p_defines.h"
+#include "tgsi/tgsi_parse.h"
 
 #include "nvc0/nvc0_context.h"
 
 #include "codegen/nv50_ir_driver.h"
 #include "nvc0/nve4_compute.h"
 
+#include "nouveau_shader_cache.h"
+
 /* NOTE: Using a[0x270] in FP may cause an error even if we're using less than
  * 124 scalar varying values.
  */
@@ -521,10 +524,153 @@ nvc0_program_dump(struct nvc0_program *prog)
 }
 #endif
 
+/* Everything the translation depends on, followed by the TGSI tokens. */
+struct nvc0_program_cache_key {
+   uint16_t chipset;
+   uint8_t type;
+   uint8_t num_ucps;
+   struct pipe_stream_output_info so;
+};
+
+/* The translated program, followed by the code, the immediates, the
+ * relocations, the transform feedback state and the symbols.
+ */
+struct nvc0_program_cache_data {
+   struct nvc0_program prog;
+   unsigned relocs_size;
+   unsigned syms_size;
+};
+
+static void *
+nvc0_program_cache_key(const struct nvc0_program *prog, uint16_t chipset,
+                       unsigned *size)
+{
+   const unsigned tokens_size =
+      tgsi_num_tokens(prog->pipe.tokens) * sizeof(struct tgsi_token);
+   struct nvc0_program_cache_key *key =
+      CALLOC(1, sizeof(*key) + tokens_size);
+   if (!key)
+      return NULL;
+
+   key->chipset = chipset;
+   key->type = prog->type;
+   key->num_ucps = prog->vp.num_ucps;
+   key->so = prog->pipe.stream_output;
+   memcpy(key + 1, prog->pipe.tokens, tokens_size);
+
+   *size = sizeof(*key) + tokens_size;
+   return key;
+}
+
+static void
+nvc0_program_cache_store(const struct nvc0_program *prog,
+                         struct nouveau_shader_cache *cache,
+                         const void *key, unsigned key_size)
+{
+   struct nvc0_program_cache_data *data;
+   const unsigned relocs_size =
+      prog->relocs ? nv50_ir_get_reloc_size(prog->relocs) : 0;
+   const unsigned tfb_size = prog->tfb ? sizeof(*prog->tfb) : 0;
+   const unsigned syms_size = prog->type == PIPE_SHADER_COMPUTE ?
+      prog->cp.num_syms * sizeof(struct nv50_ir_prog_symbol) : 0;
+   const unsigned size = sizeof(*data) + prog->code_size + prog->immd_size +
+      relocs_size + tfb_size + syms_size;
+   uint8_t *ptr;
+
+   data = MALLOC(size);
+   if (!data)
+      return;
+   data->prog = *prog;
+   data->relocs_size = relocs_size;
+   data->syms_size = syms_size;
+
+   ptr = (uint8_t *)(data + 1);
+   memcpy(ptr, prog->code, prog->code_size);
+   ptr += prog->code_size;
+   memcpy(ptr, prog->immd_data, prog->immd_size);
+   ptr += prog->immd_size;
+   memcpy(ptr, prog->relocs, relocs_size);
+   ptr += relocs_size;
+   memcpy(ptr, prog->tfb, tfb_size);
+   ptr += tfb_size;
+   memcpy(ptr, prog->cp.syms, syms_size);
+
+   nouveau_shader_cache_put(cache, key, key_size, data, size);
+   FREE(data);
+}
+
+static void *
+nvc0_program_cache_dup(const uint8_t **ptr, unsigned size, boolean *ok)
+{
+   void *copy = NULL;
+
+   if (size) {
+      copy = mem_dup(*ptr, size);
+      if (!copy)
+         *ok = FALSE;
+      *ptr += size;
+   }
+   return copy;
+}
+
+static boolean
+nvc0_program_cache_load(struct nvc0_program *prog,
+                        const void *buf, unsigned size)
+{
+   const struct nvc0_program_cache_data *data = buf;
+   const struct nvc0_program *cached = &data->prog;
+   const uint8_t *ptr = (const uint8_t *)(data + 1);
+   const unsigned tfb_size = cached->tfb ? sizeof(*cached->tfb) : 0;
+   boolean ok = TRUE;
+
+   if (size < sizeof(*data) ||
+       size != sizeof(*data) + cached->code_size + cached->immd_size +
+       data->relocs_size + tfb_size + data->syms_size)
+      return FALSE;
+
+   prog->need_tls = cached->need_tls;
+   prog->num_gprs = cached->num_gprs;
+   prog->code_size = cached->code_size;
+   prog->immd_size = cached->immd_size;
+   memcpy(prog->hdr, cached->hdr, sizeof(prog->hdr));
+   memcpy(prog->flags, cached->flags, sizeof(prog->flags));
+   prog->vp = cached->vp;
+   prog->fp = cached->fp;
+   prog->tp = cached->tp;
+   prog->num_barriers = cached->num_barriers;
+
+   prog->code = nvc0_program_cache_dup(&ptr, cached->code_size, &ok);
+   prog->immd_data = nvc0_program_cache_dup(&ptr, cached->immd_size, &ok);
+   prog->relocs = nvc0_program_cache_dup(&ptr, data->relocs_size, &ok);
+   prog->tfb = nvc0_program_cache_dup(&ptr, tfb_size, &ok);
+   if (prog->type == PIPE_SHADER_COMPUTE) {
+      prog->cp.syms = nvc0_program_cache_dup(&ptr, data->syms_size, &ok);
+      prog->cp.num_syms = cached->cp.num_syms;
+   }
+
+   if (!ok) {
+      FREE(prog->code);
+      FREE(prog->immd_data);
+      FREE(prog->relocs);
+      FREE(prog->tfb);
+      prog->code = prog->immd_data = NULL;
+      prog->relocs = NULL;
+      prog->tfb = NULL;
+      if (prog->type == PIPE_SHADER_COMPUTE) {
+         FREE(prog->cp.syms);
+         prog->cp.syms = NULL;
+      }
+   }
+   return ok;
+}
+
 boolean
-nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset)
+nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset,
+                       struct nouveau_shader_cache *cache)
 {
    struct nv50_ir_prog_info *info;
+   void *key = NULL;
+   unsigned key_size;
    int ret;
 
    info = CALLOC_STRUCT(nv50_ir_prog_info);
@@ -568,6 +714,23 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset)
    info->optLevel = 3;
 #endif
 
+   /* the debug output is expected to appear when translating */
+   if (cache && !info->dbgFlags) {
+      key = nvc0_program_cache_key(prog, chipset, &key_size);
+      if (key) {
+         unsigned size;
+         void *data = nouveau_shader_cache_get(cache, key, key_size, &size);
+         if (data) {
+            boolean hit = nvc0_program_cache_load(prog, data, size);
+            FREE(data);
+            if (hit) {
+               ret = 0;
+               goto out;
+            }
+         }
+      }
+   }
+
    ret = nv50_ir_generate_code(info);
    if (ret) {
       NOUVEAU_ERR("shader translation failed: %i\n", ret);
@@ -644,7 +807,11 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset)
       prog->tfb = nvc0_program_create_tfb_state(info,
                                                 &prog->pipe.stream_output);
 
+   if (key)
+      nvc0_program_cache_store(prog, cache, key, key_size);
+
 out:
+   FREE(key);
    FREE(info);
    return !ret;
 }
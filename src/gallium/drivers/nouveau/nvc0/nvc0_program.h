@@ -63,6 +63,8 @@ struct nvc0_program {
    struct nvc0_transform_feedback_state *tfb;
 
    struct nouveau_heap *mem;
+
+   uint32_t trace_id; /* u_trace shader id when the state was created */
 };
 
 #endif
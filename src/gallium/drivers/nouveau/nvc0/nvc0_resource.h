@@ -54,5 +54,14 @@ nvc0_miptree_transfer_map(struct pipe_context *pctx,
 void
 nvc0_miptree_transfer_unmap(struct pipe_context *pcontext,
                             struct pipe_transfer *ptx);
+void
+nvc0_miptree_transfer_inline_write(struct pipe_context *pctx,
+                                   struct pipe_resource *res,
+                                   unsigned level,
+                                   unsigned usage,
+                                   const struct pipe_box *box,
+                                   const void *data,
+                                   unsigned stride,
+                                   unsigned layer_stride);
 
 #endif
@@ -24,6 +24,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_state.h"
 #include "util/u_inlines.h"
+#include "util/u_trace.h"
 
 #include "nvc0/nvc0_context.h"
 
@@ -70,8 +71,11 @@ nvc0_program_validate(struct nvc0_context *nvc0, struct nvc0_program *prog)
       return TRUE;
 
    if (!prog->translated) {
+      util_trace_begin("nvc0_program_translate", prog->trace_id);
       prog->translated = nvc0_program_translate(
-         prog, nvc0->screen->base.device->chipset);
+         prog, nvc0->screen->base.device->chipset,
+         nvc0->screen->base.shader_cache);
+      util_trace_end();
       if (!prog->translated)
          return FALSE;
    }
@@ -23,6 +23,7 @@
 #include "pipe/p_defines.h"
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
+#include "util/u_trace.h"
 #include "util/u_transfer.h"
 
 #include "tgsi/tgsi_parse.h"
@@ -686,6 +687,7 @@ nvc0_sp_state_create(struct pipe_context *pipe,
       return NULL;
 
    prog->type = type;
+   prog->trace_id = util_trace_current_id();
 
    if (cso->tokens)
       prog->pipe.tokens = tgsi_dup_tokens(cso->tokens);
@@ -505,6 +505,78 @@ nvc0_miptree_transfer_unmap(struct pipe_context *pctx,
    FREE(tx);
 }
 
+/* Small texture uploads would each get their own GART bo through
+ * transfer_map. The data is only needed until the copy is emitted, so use
+ * the context's scratch ring instead.
+ */
+void
+nvc0_miptree_transfer_inline_write(struct pipe_context *pctx,
+                                   struct pipe_resource *res,
+                                   unsigned level,
+                                   unsigned usage,
+                                   const struct pipe_box *box,
+                                   const void *data,
+                                   unsigned stride,
+                                   unsigned layer_stride)
+{
+   struct nvc0_context *nvc0 = nvc0_context(pctx);
+   struct nv50_miptree *mt = nv50_miptree(res);
+   struct nv50_m2mf_rect rect[2];
+   struct nouveau_bo *bo;
+   unsigned nblocksx, nblocksy, line, size, i, y;
+   uint64_t addr;
+   uint8_t *map = NULL;
+
+   if (util_format_is_plain(res->format)) {
+      nblocksx = box->width << mt->ms_x;
+      nblocksy = box->height << mt->ms_y;
+   } else {
+      nblocksx = util_format_get_nblocksx(res->format, box->width);
+      nblocksy = util_format_get_nblocksy(res->format, box->height);
+   }
+   line = nblocksx * util_format_get_blocksize(res->format);
+   size = line * nblocksy;
+
+   if (!nvc0_mt_transfer_can_map_directly(mt) &&
+       size * box->depth <= nvc0->base.scratch.bo_size)
+      map = nouveau_scratch_get(&nvc0->base, size * box->depth, &addr, &bo);
+   if (!map) {
+      u_default_transfer_inline_write(pctx, res, level, usage, box,
+                                      data, stride, layer_stride);
+      return;
+   }
+
+   for (i = 0; i < box->depth; ++i) {
+      const uint8_t *src = (const uint8_t *)data + i * layer_stride;
+      for (y = 0; y < nblocksy; ++y, src += stride, map += line)
+         memcpy(map, src, line);
+   }
+
+   nv50_m2mf_rect_setup(&rect[0], res, level, box->x, box->y, box->z);
+
+   memset(&rect[1], 0, sizeof(rect[1]));
+   rect[1].bo = bo;
+   rect[1].base = addr - bo->offset;
+   rect[1].cpp = rect[0].cpp;
+   rect[1].width = nblocksx;
+   rect[1].height = nblocksy;
+   rect[1].depth = 1;
+   rect[1].pitch = line;
+   rect[1].domain = NOUVEAU_BO_GART;
+
+   for (i = 0; i < box->depth; ++i) {
+      nvc0->m2mf_copy_rect(nvc0, &rect[0], &rect[1], nblocksx, nblocksy);
+      if (mt->layout_3d)
+         rect[0].z++;
+      else
+         rect[0].base += mt->layer_stride;
+      rect[1].base += size;
+   }
+   nouveau_scratch_done(&nvc0->base);
+
+   NOUVEAU_DRV_STAT(&nvc0->screen->base, tex_transfers_wr, 1);
+}
+
 /* This happens rather often with DTD9/st. */
 void
 nvc0_cb_push(struct nouveau_context *nv,
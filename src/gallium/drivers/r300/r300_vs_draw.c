@@ -320,6 +320,7 @@ void r300_draw_init_vertex_shader(struct r300_context *r300,
 
     tgsi_scan_shader(vs->state.tokens, &info);
 
+    memset(&new_vs, 0, sizeof(new_vs));
     new_vs.tokens = tgsi_alloc_tokens(newLen);
     if (new_vs.tokens == NULL)
         return;
@@ -367,6 +368,7 @@ void r300_draw_init_vertex_shader(struct r300_context *r300,
 
     /* Instead of duplicating and freeing the tokens, copy the pointer directly. */
     vs->state.tokens = new_vs.tokens;
+    vs->state.hash = 0;
 
     /* Init the VS output table for the rasterizer. */
     r300_init_vs_outputs(r300, vs);
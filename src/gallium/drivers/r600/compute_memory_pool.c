@@ -26,6 +26,7 @@
 #include "pipe/p_state.h"
 #include "pipe/p_context.h"
 #include "util/u_blitter.h"
+#include "util/u_box.h"
 #include "util/u_double_list.h"
 #include "util/u_transfer.h"
 #include "util/u_surface.h"
@@ -64,7 +65,6 @@ static void compute_memory_pool_init(struct compute_memory_pool * pool,
 	COMPUTE_DBG(pool->screen, "* compute_memory_pool_init() initial_size_in_dw = %ld\n",
 		initial_size_in_dw);
 
-	pool->shadow = (uint32_t*)CALLOC(initial_size_in_dw, 4);
 	pool->next_id = 1;
 	pool->size_in_dw = initial_size_in_dw;
 	pool->bo = (struct r600_resource*)r600_compute_buffer_alloc_vram(pool->screen,
@@ -76,7 +76,10 @@ static void compute_memory_pool_init(struct compute_memory_pool * pool,
  */
 void compute_memory_pool_delete(struct compute_memory_pool* pool)
 {
-	COMPUTE_DBG(pool->screen, "* compute_memory_pool_delete()\n");
+	COMPUTE_DBG(pool->screen, "* compute_memory_pool_delete() "
+		"moved %u items (%"PRIu64" bytes), grew %u times "
+		"(%"PRIu64" bytes copied)\n", pool->num_moves, pool->bytes_moved,
+		pool->num_grows, pool->bytes_grown);
 	free(pool->shadow);
 	if (pool->bo) {
 		pool->screen->b.b.resource_destroy((struct pipe_screen *)
@@ -86,38 +89,58 @@ void compute_memory_pool_delete(struct compute_memory_pool* pool)
 }
 
 /**
- * Searches for an empty space in the pool, return with the pointer to the
- * allocatable space in the pool, returns -1 on failure.
+ * Searches for the smallest free space that fits size_in_dw and ends at
+ * or before limit_in_dw.  Items start at 1024 dword boundaries.
  */
-int64_t compute_memory_prealloc_chunk(
+static int64_t compute_memory_find_hole(
 	struct compute_memory_pool* pool,
-	int64_t size_in_dw)
+	int64_t size_in_dw,
+	int64_t limit_in_dw)
 {
 	struct compute_memory_item *item;
-
-	int last_end = 0;
-
-	assert(size_in_dw <= pool->size_in_dw);
-
-	COMPUTE_DBG(pool->screen, "* compute_memory_prealloc_chunk() size_in_dw = %ld\n",
-		size_in_dw);
+	int64_t best = -1, best_size = 0;
+	int64_t last_end = 0;
 
 	for (item = pool->item_list; item; item = item->next) {
 		if (item->start_in_dw > -1) {
-			if (item->start_in_dw-last_end > size_in_dw) {
-				return last_end;
+			int64_t end = MIN2(item->start_in_dw, limit_in_dw);
+
+			if (end - last_end >= size_in_dw &&
+			    (best == -1 || end - last_end < best_size)) {
+				best = last_end;
+				best_size = end - last_end;
 			}
 
-			last_end = item->start_in_dw + item->size_in_dw;
-			last_end += (1024 - last_end % 1024);
+			last_end = align(item->start_in_dw + item->size_in_dw, 1024);
 		}
 	}
 
-	if (pool->size_in_dw - last_end < size_in_dw) {
-		return -1;
+	limit_in_dw = MIN2(limit_in_dw, pool->size_in_dw);
+	if (limit_in_dw - last_end >= size_in_dw &&
+	    (best == -1 || limit_in_dw - last_end < best_size)) {
+		best = last_end;
 	}
 
-	return last_end;
+	return best;
+}
+
+/**
+ * Searches for an empty space in the pool, return with the pointer to the
+ * allocatable space in the pool, returns -1 on failure.
+ *
+ * The smallest space that fits is used (best fit), so that allocating and
+ * freeing many buffers of different sizes fragments the pool less.
+ */
+int64_t compute_memory_prealloc_chunk(
+	struct compute_memory_pool* pool,
+	int64_t size_in_dw)
+{
+	assert(size_in_dw <= pool->size_in_dw);
+
+	COMPUTE_DBG(pool->screen, "* compute_memory_prealloc_chunk() size_in_dw = %ld\n",
+		size_in_dw);
+
+	return compute_memory_find_hole(pool, size_in_dw, pool->size_in_dw);
 }
 
 /**
@@ -155,6 +178,23 @@ struct compute_memory_item* compute_memory_postalloc_chunk(
 	return NULL;
 }
 
+/**
+ * Only the range up to the end of the last allocated item holds data.
+ */
+static int64_t compute_memory_used_size(struct compute_memory_pool* pool)
+{
+	struct compute_memory_item *item;
+	int64_t end = 0;
+
+	for (item = pool->item_list; item; item = item->next) {
+		if (item->start_in_dw > -1) {
+			end = MAX2(end, item->start_in_dw + item->size_in_dw);
+		}
+	}
+
+	return end;
+}
+
 /**
  * Reallocates pool, conserves data
  */
@@ -169,20 +209,34 @@ void compute_memory_grow_pool(struct compute_memory_pool* pool,
 	if (!pool->bo) {
 		compute_memory_pool_init(pool, MAX2(new_size_in_dw, 1024 * 16));
 	} else {
+		struct r600_resource *old_bo = pool->bo;
+		int64_t used_in_dw = compute_memory_used_size(pool);
+
 		new_size_in_dw += 1024 - (new_size_in_dw % 1024);
 
 		COMPUTE_DBG(pool->screen, "  Aligned size = %d\n", new_size_in_dw);
 
-		compute_memory_shadow(pool, pipe, 1);
-		pool->shadow = realloc(pool->shadow, new_size_in_dw*4);
 		pool->size_in_dw = new_size_in_dw;
-		pool->screen->b.b.resource_destroy(
-			(struct pipe_screen *)pool->screen,
-			(struct pipe_resource *)pool->bo);
 		pool->bo = (struct r600_resource*)r600_compute_buffer_alloc_vram(
 							pool->screen,
 							pool->size_in_dw * 4);
-		compute_memory_shadow(pool, pipe, 0);
+
+		/* Copy on the GPU instead of going through a host shadow
+		 * of the whole pool. */
+		if (used_in_dw) {
+			struct pipe_box box;
+
+			u_box_1d(0, used_in_dw * 4, &box);
+			pipe->resource_copy_region(pipe,
+				(struct pipe_resource *)pool->bo, 0, 0, 0, 0,
+				(struct pipe_resource *)old_bo, 0, &box);
+			pool->bytes_grown += used_in_dw * 4;
+		}
+		pool->num_grows++;
+
+		pool->screen->b.b.resource_destroy(
+			(struct pipe_screen *)pool->screen,
+			(struct pipe_resource *)old_bo);
 	}
 }
 
@@ -197,6 +251,8 @@ void compute_memory_shadow(struct compute_memory_pool* pool,
 	COMPUTE_DBG(pool->screen, "* compute_memory_shadow() device_to_host = %d\n",
 		device_to_host);
 
+	pool->shadow = realloc(pool->shadow, pool->size_in_dw * 4);
+
 	chunk.id = 0;
 	chunk.start_in_dw = 0;
 	chunk.size_in_dw = pool->size_in_dw;
@@ -205,6 +261,124 @@ void compute_memory_shadow(struct compute_memory_pool* pool,
 				pool->shadow, 0, pool->size_in_dw*4);
 }
 
+/**
+ * Links a placed item into the item list, which is ordered by start_in_dw.
+ */
+static void compute_memory_link_item(struct compute_memory_pool* pool,
+	struct compute_memory_item *item)
+{
+	item->next = NULL;
+	item->prev = NULL;
+
+	if (pool->item_list) {
+		struct compute_memory_item *pos;
+
+		pos = compute_memory_postalloc_chunk(pool, item->start_in_dw);
+		if (pos) {
+			item->prev = pos;
+			item->next = pos->next;
+			pos->next = item;
+			if (item->next) {
+				item->next->prev = item;
+			}
+		} else {
+			/* Add item to the front of the list */
+			item->next = pool->item_list;
+			item->prev = pool->item_list->prev;
+			pool->item_list->prev = item;
+			pool->item_list = item;
+		}
+	}
+	else {
+		pool->item_list = item;
+	}
+}
+
+static void compute_memory_unlink_item(struct compute_memory_pool* pool,
+	struct compute_memory_item *item)
+{
+	if (item->prev) {
+		item->prev->next = item->next;
+	}
+	else {
+		pool->item_list = item->next;
+	}
+
+	if (item->next) {
+		item->next->prev = item->prev;
+	}
+}
+
+/**
+ * Copies an item to new_start_in_dw on the GPU.  The new place must not
+ * overlap the old one.
+ */
+static void compute_memory_move_item(struct compute_memory_pool* pool,
+	struct pipe_context * pipe, struct compute_memory_item *item,
+	int64_t new_start_in_dw)
+{
+	struct pipe_box box;
+
+	COMPUTE_DBG(pool->screen, "  + Moving item id = %"PRIi64" from %"PRIi64
+		" to %"PRIi64" (%"PRIi64" bytes)\n", item->id, item->start_in_dw,
+		new_start_in_dw, item->size_in_dw * 4);
+
+	assert(new_start_in_dw + item->size_in_dw <= item->start_in_dw ||
+	       item->start_in_dw + item->size_in_dw <= new_start_in_dw);
+
+	u_box_1d(item->start_in_dw * 4, item->size_in_dw * 4, &box);
+	pipe->resource_copy_region(pipe,
+		(struct pipe_resource *)pool->bo, 0, new_start_in_dw * 4, 0, 0,
+		(struct pipe_resource *)pool->bo, 0, &box);
+
+	compute_memory_unlink_item(pool, item);
+	item->start_in_dw = new_start_in_dw;
+	compute_memory_link_item(pool, item);
+
+	pool->bytes_moved += item->size_in_dw * 4;
+	pool->num_moves++;
+}
+
+int64_t compute_memory_compact(struct compute_memory_pool* pool,
+	struct pipe_context * pipe, int64_t size_in_dw)
+{
+	int64_t budget_in_dw = pool->size_in_dw / 4;
+	int64_t start_in_dw;
+
+	COMPUTE_DBG(pool->screen, "* compute_memory_compact() size_in_dw = %ld\n",
+		size_in_dw);
+
+	/* Moving the last item down makes the free space at the end of the
+	 * pool bigger, and it is the only item that can't block that. */
+	while ((start_in_dw = compute_memory_prealloc_chunk(pool,
+							size_in_dw)) == -1) {
+		struct compute_memory_item *last = pool->item_list;
+		int64_t hole;
+
+		if (!last) {
+			break;
+		}
+		while (last->next) {
+			last = last->next;
+		}
+
+		if (last->size_in_dw > budget_in_dw) {
+			break;
+		}
+
+		hole = compute_memory_find_hole(pool, last->size_in_dw,
+						last->start_in_dw);
+		if (hole == -1) {
+			break;
+		}
+
+		compute_memory_move_item(pool, pipe, last, hole);
+		budget_in_dw -= last->size_in_dw;
+	}
+
+	return start_in_dw;
+}
+
 /**
  * Allocates pending allocations in the pool
  */
@@ -294,9 +468,17 @@ void compute_memory_finalize_pending(struct compute_memory_pool* pool,
 	for (item = pending_list; item; item = next) {
 		next = item->next;
 
-		/* Search for free space in the pool for this item. */
-		while ((start_in_dw=compute_memory_prealloc_chunk(pool,
-						item->size_in_dw)) == -1) {
+		/* Search for free space in the pool for this item.  If the
+		 * free space is too fragmented, compact the pool a bit before
+		 * falling back to growing it. */
+		start_in_dw = compute_memory_prealloc_chunk(pool, item->size_in_dw);
+		if (start_in_dw == -1 &&
+		    pool->size_in_dw - allocated >= item->size_in_dw) {
+			start_in_dw = compute_memory_compact(pool, pipe,
+							     item->size_in_dw);
+		}
+
+		while (start_in_dw == -1) {
 			int64_t need = item->size_in_dw+2048 -
 						(pool->size_in_dw - allocated);
 
@@ -314,6 +496,9 @@ void compute_memory_finalize_pending(struct compute_memory_pool* pool,
 						pipe,
 						pool->size_in_dw + need);
 			}
+
+			start_in_dw = compute_memory_prealloc_chunk(pool,
+							item->size_in_dw);
 		}
 		COMPUTE_DBG(pool->screen, "  + Found space for Item %p id = %u "
 			"start_in_dw = %u (%u bytes) size_in_dw = %u (%u bytes)\n",
@@ -321,34 +506,15 @@ void compute_memory_finalize_pending(struct compute_memory_pool* pool,
 			item->size_in_dw, item->size_in_dw * 4);
 
 		item->start_in_dw = start_in_dw;
-		item->next = NULL;
-		item->prev = NULL;
-
-		if (pool->item_list) {
-			struct compute_memory_item *pos;
-
-			pos = compute_memory_postalloc_chunk(pool, start_in_dw);
-			if (pos) {
-				item->prev = pos;
-				item->next = pos->next;
-				pos->next = item;
-				if (item->next) {
-					item->next->prev = item;
-				}
-			} else {
-				/* Add item to the front of the list */
-				item->next = pool->item_list;
-				item->prev = pool->item_list->prev;
-				pool->item_list->prev = item;
-				pool->item_list = item;
-			}
-		}
-		else {
-			pool->item_list = item;
-		}
+		compute_memory_link_item(pool, item);
 
 		allocated += item->size_in_dw;
 	}
+
+	COMPUTE_DBG(pool->screen, "  Pool stats: moved %u items (%"PRIu64
+		" bytes), grew %u times (%"PRIu64" bytes copied)\n",
+		pool->num_moves, pool->bytes_moved, pool->num_grows,
+		pool->bytes_grown);
 }
 
 
@@ -362,16 +528,7 @@ void compute_memory_free(struct compute_memory_pool* pool, int64_t id)
 		next = item->next;
 
 		if (item->id == id) {
-			if (item->prev) {
-				item->prev->next = item->next;
-			}
-			else {
-				pool->item_list = item->next;
-			}
-
-			if (item->next) {
-				item->next->prev = item->prev;
-			}
+			compute_memory_unlink_item(pool, item);
 
 			free(item);
 
@@ -53,19 +53,24 @@ struct compute_memory_pool
 	struct compute_memory_item* item_list; ///Allocated memory chunks in the buffer,they must be ordered by "start_in_dw"
 	struct r600_screen *screen;
 
-	uint32_t *shadow; ///host copy of the pool, used for defragmentation
+	uint32_t *shadow; ///host copy of the pool, only allocated by compute_memory_shadow()
+
+	uint64_t bytes_moved; ///Bytes copied on the GPU to compact the pool
+	uint64_t bytes_grown; ///Bytes copied on the GPU to grow the pool
+	unsigned num_moves; ///Number of items relocated by compaction
+	unsigned num_grows; ///Number of times the pool was reallocated
 };
 
 
 struct compute_memory_pool* compute_memory_pool_new(struct r600_screen *rscreen); ///Creates a new pool
 void compute_memory_pool_delete(struct compute_memory_pool* pool); ///Frees all stuff in the pool and the pool struct itself too
 
-int64_t compute_memory_prealloc_chunk(struct compute_memory_pool* pool, int64_t size_in_dw); ///searches for an empty space in the pool, return with the pointer to the allocatable space in the pool, returns -1 on failure
+int64_t compute_memory_prealloc_chunk(struct compute_memory_pool* pool, int64_t size_in_dw); ///searches for the smallest empty space in the pool that fits, return with the pointer to the allocatable space in the pool, returns -1 on failure
 
 struct compute_memory_item* compute_memory_postalloc_chunk(struct compute_memory_pool* pool, int64_t start_in_dw); ///search for the chunk where we can link our new chunk after it
 
-/** 
- * reallocates pool, conserves data
+/**
+ * reallocates pool, conserves data by copying it on the GPU
  */
 void compute_memory_grow_pool(struct compute_memory_pool* pool, struct pipe_context * pipe,
 	int new_size_in_dw);
@@ -76,6 +81,14 @@ void compute_memory_grow_pool(struct compute_memory_pool* pool, struct pipe_cont
 void compute_memory_shadow(struct compute_memory_pool* pool,
 	struct pipe_context * pipe, int device_to_host);
 
+/**
+ * Moves items from the end of the pool into holes closer to its start
+ * until size_in_dw fits, copying at most a quarter of the pool.
+ * Returns the start of the free space like compute_memory_prealloc_chunk().
+ */
+int64_t compute_memory_compact(struct compute_memory_pool* pool,
+	struct pipe_context * pipe, int64_t size_in_dw);
+
 /**
  * Allocates pending allocations in the pool
  */
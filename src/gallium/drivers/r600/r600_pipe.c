@@ -589,6 +589,8 @@ static int r600_get_param(struct pipe_screen* pscreen, enum pipe_cap param)
 		return PIPE_QUIRK_TEXTURE_BORDER_COLOR_SWIZZLE_R600;
 	case PIPE_CAP_ENDIANNESS:
 		return PIPE_ENDIAN_LITTLE;
+	case PIPE_CAP_SHAREABLE_STATE_OBJECTS:
+		return 0;
 	}
 	return 0;
 }
@@ -661,7 +663,10 @@ static int r600_get_shader_param(struct pipe_screen* pscreen, unsigned shader, e
 	case PIPE_SHADER_CAP_TGSI_CONT_SUPPORTED:
 		return 1;
 	case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
+	case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
 		return 0;
+	case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
+		return 1;
 	case PIPE_SHADER_CAP_INDIRECT_INPUT_ADDR:
 	case PIPE_SHADER_CAP_INDIRECT_OUTPUT_ADDR:
 	case PIPE_SHADER_CAP_INDIRECT_TEMP_ADDR:
@@ -997,7 +1002,9 @@ static int r600_get_driver_query_info(struct pipe_screen *screen,
 		{"draw-calls", R600_QUERY_DRAW_CALLS, 0},
 		{"requested-VRAM", R600_QUERY_REQUESTED_VRAM, rscreen->b.info.vram_size, TRUE},
 		{"requested-GTT", R600_QUERY_REQUESTED_GTT, rscreen->b.info.gart_size, TRUE},
-		{"buffer-wait-time", R600_QUERY_BUFFER_WAIT_TIME, 0, FALSE}
+		{"buffer-wait-time", R600_QUERY_BUFFER_WAIT_TIME, 0, FALSE},
+		{"cs-ioctl-time", R600_QUERY_CS_IOCTL_TIME, 0, FALSE},
+		{"cs-wait-time", R600_QUERY_CS_WAIT_TIME, 0, FALSE}
 	};
 
 	if (!info)
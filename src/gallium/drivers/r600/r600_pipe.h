@@ -69,6 +69,8 @@
 #define R600_QUERY_REQUESTED_VRAM	(PIPE_QUERY_DRIVER_SPECIFIC + 1)
 #define R600_QUERY_REQUESTED_GTT	(PIPE_QUERY_DRIVER_SPECIFIC + 2)
 #define R600_QUERY_BUFFER_WAIT_TIME	(PIPE_QUERY_DRIVER_SPECIFIC + 3)
+#define R600_QUERY_CS_IOCTL_TIME	(PIPE_QUERY_DRIVER_SPECIFIC + 4)
+#define R600_QUERY_CS_WAIT_TIME		(PIPE_QUERY_DRIVER_SPECIFIC + 5)
 
 struct r600_context;
 struct r600_bytecode;
@@ -294,6 +296,9 @@ struct r600_pipe_shader_selector {
 	unsigned	type;
 
 	unsigned	nr_ps_max_color_exports;
+
+	/* u_trace shader id of the state tracker's span creating the shader */
+	uint32_t	trace_id;
 };
 
 struct r600_pipe_sampler_state {
@@ -48,6 +48,8 @@ static struct r600_resource *r600_new_query_buffer(struct r600_context *ctx, uns
 	case R600_QUERY_REQUESTED_VRAM:
 	case R600_QUERY_REQUESTED_GTT:
 	case R600_QUERY_BUFFER_WAIT_TIME:
+	case R600_QUERY_CS_IOCTL_TIME:
+	case R600_QUERY_CS_WAIT_TIME:
 		return NULL;
 	}
 
@@ -346,6 +348,8 @@ static struct pipe_query *r600_create_query(struct pipe_context *ctx, unsigned q
 	case R600_QUERY_REQUESTED_VRAM:
 	case R600_QUERY_REQUESTED_GTT:
 	case R600_QUERY_BUFFER_WAIT_TIME:
+	case R600_QUERY_CS_IOCTL_TIME:
+	case R600_QUERY_CS_WAIT_TIME:
 		skip_allocation = true;
 		break;
 	default:
@@ -404,6 +408,12 @@ static void r600_begin_query(struct pipe_context *ctx, struct pipe_query *query)
 	case R600_QUERY_BUFFER_WAIT_TIME:
 		rquery->begin_result = rctx->b.ws->query_value(rctx->b.ws, RADEON_BUFFER_WAIT_TIME_NS);
 		return;
+	case R600_QUERY_CS_IOCTL_TIME:
+		rquery->begin_result = rctx->b.ws->query_value(rctx->b.ws, RADEON_CS_IOCTL_TIME_NS);
+		return;
+	case R600_QUERY_CS_WAIT_TIME:
+		rquery->begin_result = rctx->b.ws->query_value(rctx->b.ws, RADEON_CS_WAIT_TIME_NS);
+		return;
 	}
 
 	/* Discard the old query buffers. */
@@ -450,6 +460,12 @@ static void r600_end_query(struct pipe_context *ctx, struct pipe_query *query)
 	case R600_QUERY_BUFFER_WAIT_TIME:
 		rquery->end_result = rctx->b.ws->query_value(rctx->b.ws, RADEON_BUFFER_WAIT_TIME_NS);
 		return;
+	case R600_QUERY_CS_IOCTL_TIME:
+		rquery->end_result = rctx->b.ws->query_value(rctx->b.ws, RADEON_CS_IOCTL_TIME_NS);
+		return;
+	case R600_QUERY_CS_WAIT_TIME:
+		rquery->end_result = rctx->b.ws->query_value(rctx->b.ws, RADEON_CS_WAIT_TIME_NS);
+		return;
 	}
 
 	r600_emit_query_end(rctx, rquery);
@@ -492,6 +508,8 @@ static boolean r600_get_query_buffer_result(struct r600_context *ctx,
 	case R600_QUERY_REQUESTED_VRAM:
 	case R600_QUERY_REQUESTED_GTT:
 	case R600_QUERY_BUFFER_WAIT_TIME:
+	case R600_QUERY_CS_IOCTL_TIME:
+	case R600_QUERY_CS_WAIT_TIME:
 		result->u64 = query->end_result - query->begin_result;
 		return TRUE;
 	}
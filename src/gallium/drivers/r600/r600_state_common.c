@@ -34,6 +34,7 @@
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
 #include "util/u_math.h"
+#include "util/u_trace.h"
 #include "tgsi/tgsi_parse.h"
 
 #define R600_PRIM_RECTANGLE_LIST PIPE_PRIM_MAX
@@ -743,7 +744,9 @@ static int r600_shader_select(struct pipe_context *ctx,
 		shader = CALLOC(1, sizeof(struct r600_pipe_shader));
 		shader->selector = sel;
 
+		util_trace_begin("r600_pipe_shader_create", sel->trace_id);
 		r = r600_pipe_shader_create(ctx, shader, key);
+		util_trace_end();
 		if (unlikely(r)) {
 			R600_ERR("Failed to build shader variant (type=%u) %d\n",
 				 sel->type, r);
@@ -789,6 +792,7 @@ static void *r600_create_shader_state(struct pipe_context *ctx,
 	sel->type = pipe_shader_type;
 	sel->tokens = tgsi_dup_tokens(state->tokens);
 	sel->so = state->stream_output;
+	sel->trace_id = util_trace_current_id();
 
 	r = r600_shader_select(ctx, sel, NULL);
 	if (r)
@@ -905,6 +909,18 @@ static void r600_delete_vs_state(struct pipe_context *ctx, void *state)
 	r600_delete_shader_selector(ctx, sel);
 }
 
+/* size of the variant selected at creation, later variants aren't counted */
+static int r600_get_shader_code_size(struct pipe_context *ctx, unsigned shader,
+				     void *state)
+{
+	struct r600_pipe_shader_selector *sel = (struct r600_pipe_shader_selector *)state;
+
+	if (!sel->current)
+		return -1;
+
+	return sel->current->shader.bc.ndw * 4;
+}
+
 void r600_constant_buffers_dirty(struct r600_context *rctx, struct r600_constbuf_state *state)
 {
 	if (state->dirty_mask) {
@@ -2092,6 +2108,7 @@ void r600_init_common_state_functions(struct r600_context *rctx)
 	rctx->b.b.delete_sampler_state = r600_delete_sampler_state;
 	rctx->b.b.delete_vertex_elements_state = r600_delete_vertex_elements;
 	rctx->b.b.delete_vs_state = r600_delete_vs_state;
+	rctx->b.b.get_shader_code_size = r600_get_shader_code_size;
 	rctx->b.b.set_blend_color = r600_set_blend_color;
 	rctx->b.b.set_clip_state = r600_set_clip_state;
 	rctx->b.b.set_constant_buffer = r600_set_constant_buffer;
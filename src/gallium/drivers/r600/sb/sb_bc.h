@@ -35,6 +35,7 @@ extern "C" {
 #include <cstdio>
 #include <string>
 #include <vector>
+#include <map>
 #include <stack>
 
 struct r600_bytecode;
@@ -627,6 +628,14 @@ public:
 	static unsigned dskip_end;
 	static unsigned dskip_mode;
 
+	// shaders larger than budget_ndw dwords skip the optional passes,
+	// shaders larger than max_ndw aren't optimized at all (0 - no limit)
+	static unsigned budget_ndw;
+	static unsigned max_ndw;
+
+	// accumulated time of each pass in ns, collected with dump_stat
+	std::map<std::string, int64_t> pass_time;
+
 	sb_context() : src_stats(), opt_stats(), isa(0),
 			hw_chip(HW_CHIP_UNKNOWN), hw_class(HW_CLASS_UNKNOWN) {}
 
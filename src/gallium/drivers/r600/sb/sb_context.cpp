@@ -40,6 +40,9 @@ unsigned sb_context::dskip_start = 0;
 unsigned sb_context::dskip_end = 0;
 unsigned sb_context::dskip_mode = 0;
 
+unsigned sb_context::budget_ndw = 0;
+unsigned sb_context::max_ndw = 0;
+
 int sb_context::init(r600_isa *isa, sb_hw_chip chip, sb_hw_class cclass) {
 	if (chip == HW_CHIP_UNKNOWN || cclass == HW_CLASS_UNKNOWN)
 		return -1;
@@ -28,8 +28,10 @@
 
 extern "C" {
 #include "os/os_time.h"
+#include "util/u_memory.h"
 #include "r600_pipe.h"
 #include "r600_shader.h"
+#include "../radeon/radeon_shader_cache.h"
 
 #include "sb_public.h"
 }
@@ -47,6 +49,109 @@ using namespace r600_sb;
 static sb_hw_class translate_chip_class(enum chip_class cc);
 static sb_hw_chip translate_chip(enum radeon_family rf);
 
+// everything the optimized bytecode depends on besides the source
+// bytecode, the arrays and the inputs that follow it in the cache key
+struct sb_cache_key {
+	unsigned family;
+	unsigned type;
+	unsigned has_pshader;
+	unsigned ngpr;
+	unsigned nstack;
+	unsigned ndw;
+	unsigned safe_math;
+	unsigned budget_ndw;
+	unsigned max_ndw;
+	unsigned indirect_files;
+	unsigned num_arrays;
+	unsigned ninput;
+};
+
+// cached result, followed by the optimized bytecode
+struct sb_cache_data {
+	unsigned ngpr;
+	unsigned nstack;
+	unsigned ndw;
+};
+
+static void sb_cache_make_key(struct r600_context *rctx,
+                              struct r600_bytecode *bc,
+                              struct r600_shader *pshader,
+                              std::vector<uint8_t> &key) {
+	sb_cache_key k;
+
+	memset(&k, 0, sizeof(k));
+	k.family = rctx->b.family;
+	k.type = bc->type;
+	k.has_pshader = pshader != NULL;
+	k.ngpr = bc->ngpr;
+	k.nstack = bc->nstack;
+	k.ndw = bc->ndw;
+	k.safe_math = sb_context::safe_math;
+	k.budget_ndw = sb_context::budget_ndw;
+	k.max_ndw = sb_context::max_ndw;
+	if (pshader) {
+		k.indirect_files = pshader->indirect_files;
+		k.num_arrays = pshader->num_arrays;
+		k.ninput = pshader->ninput;
+	}
+
+	const uint8_t *p = (const uint8_t*)&k;
+	key.assign(p, p + sizeof(k));
+
+	p = (const uint8_t*)bc->bytecode;
+	key.insert(key.end(), p, p + bc->ndw * 4);
+
+	if (pshader) {
+		p = (const uint8_t*)pshader->arrays;
+		key.insert(key.end(), p,
+				p + pshader->num_arrays * sizeof(r600_shader_array));
+		p = (const uint8_t*)pshader->input;
+		key.insert(key.end(), p,
+				p + pshader->ninput * sizeof(r600_shader_io));
+	}
+}
+
+static bool sb_cache_load(struct r600_context *rctx, struct r600_bytecode *bc,
+                          const std::vector<uint8_t> &key) {
+	unsigned size;
+	sb_cache_data *data = (sb_cache_data*)radeon_shader_cache_get(
+			rctx->screen->b.shader_cache, &key[0], key.size(), &size);
+	bool found = false;
+
+	if (!data)
+		return false;
+
+	if (size >= sizeof(*data) && size - sizeof(*data) == data->ndw * 4) {
+		uint32_t *bytecode = (uint32_t*) malloc(data->ndw << 2);
+		if (bytecode) {
+			memcpy(bytecode, data + 1, data->ndw << 2);
+			free(bc->bytecode);
+			bc->bytecode = bytecode;
+			bc->ndw = data->ndw;
+			bc->ngpr = data->ngpr;
+			bc->nstack = data->nstack;
+			found = true;
+		}
+	}
+
+	FREE(data);
+	return found;
+}
+
+static void sb_cache_store(struct r600_context *rctx, struct r600_bytecode *bc,
+                           const std::vector<uint8_t> &key) {
+	std::vector<uint8_t> data(sizeof(sb_cache_data) + bc->ndw * 4);
+	sb_cache_data *d = (sb_cache_data*)&data[0];
+
+	d->ngpr = bc->ngpr;
+	d->nstack = bc->nstack;
+	d->ndw = bc->ndw;
+	memcpy(d + 1, bc->bytecode, bc->ndw * 4);
+
+	radeon_shader_cache_put(rctx->screen->b.shader_cache, &key[0],
+			key.size(), &data[0], data.size());
+}
+
 sb_context *r600_sb_context_create(struct r600_context *rctx) {
 
 	sb_context *sctx = new sb_context();
@@ -69,6 +174,9 @@ sb_context *r600_sb_context_create(struct r600_context *rctx) {
 	sb_context::dskip_end = debug_get_num_option("R600_SB_DSKIP_END", 0);
 	sb_context::dskip_mode = debug_get_num_option("R600_SB_DSKIP_MODE", 0);
 
+	sb_context::budget_ndw = debug_get_num_option("R600_SB_BUDGET", 0);
+	sb_context::max_ndw = debug_get_num_option("R600_SB_MAX_DW", 0);
+
 	return sctx;
 }
 
@@ -83,6 +191,15 @@ void r600_sb_context_destroy(void * sctx) {
 			ctx->opt_stats.dump();
 			sblog << "context diff: ";
 			ctx->src_stats.dump_diff(ctx->opt_stats);
+
+			sblog << "context pass times (ms):";
+			for (std::map<std::string, int64_t>::iterator
+					I = ctx->pass_time.begin(), E = ctx->pass_time.end();
+					I != E; ++I) {
+				sblog << " " << I->first.c_str() << " "
+						<< ((double)I->second)/1000000.0;
+			}
+			sblog << "\n";
 		}
 
 		delete ctx;
@@ -102,6 +219,17 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 		rctx->sb_context = ctx = r600_sb_context_create(rctx);
 	}
 
+	// results are cached only when nothing is printed and no shaders
+	// are skipped for debugging
+	std::vector<uint8_t> cache_key;
+	if (rctx->screen->b.shader_cache && optimize && !dump_bytecode &&
+			!sb_context::dump_pass && !sb_context::dump_stat &&
+			!sb_context::dry_run && !sb_context::dskip_mode) {
+		sb_cache_make_key(rctx, bc, pshader, cache_key);
+		if (sb_cache_load(rctx, bc, cache_key))
+			return 0;
+	}
+
 	int64_t time_start = 0;
 	if (sb_context::dump_stat) {
 		time_start = os_time_get_nano();
@@ -152,16 +280,44 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 		}
 	}
 
+	/* compile time budget, see notes.markdown */
+	if (sb_context::max_ndw && bc->ndw > sb_context::max_ndw) {
+		SB_DUMP_STAT( sblog << "sb: skipped shader " << shader_id << " : "
+				<< bc->ndw << " dw > R600_SB_MAX_DW\n"; );
+		delete sh;
+		return 0;
+	}
+
+	bool full_opt = !sb_context::budget_ndw ||
+			bc->ndw <= sb_context::budget_ndw;
+
+	if (!full_opt) {
+		SB_DUMP_STAT( sblog << "sb: shader " << shader_id << " : "
+				<< bc->ndw << " dw > R600_SB_BUDGET, "
+				"skipping optional passes\n"; );
+	}
+
 	if ((r = parser.prepare())) {
 		assert(!"sb: bytecode parsing error");
 		return r;
 	}
 
+	// (pass name, time in ns) in the order of execution, for dump_stat
+	std::vector<std::pair<const char*, int64_t> > pass_times;
+
 	SB_DUMP_PASS( sblog << "\n\n###### after parse\n"; sh->dump_ir(); );
 
 #define SB_RUN_PASS(n, dump) \
 	do { \
+		int64_t pass_start = 0; \
+		if (sb_context::dump_stat) \
+			pass_start = os_time_get_nano(); \
 		r = n(*sh).run(); \
+		if (sb_context::dump_stat) { \
+			int64_t pt = os_time_get_nano() - pass_start; \
+			pass_times.push_back(std::make_pair(#n, pt)); \
+			ctx->pass_time[#n] += pt; \
+		} \
 		if (r) { \
 			sblog << "sb: error (" << r << ") in the " << #n << " pass.\n"; \
 			if (sb_context::no_fallback) \
@@ -189,21 +345,25 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 
 	sh->set_undef(sh->root->live_before);
 
-	SB_RUN_PASS(if_conversion,		1);
+	// the passes below up to ra_split only improve the code, over the
+	// budget we go straight to the passes required to produce it
+	if (full_opt) {
+		SB_RUN_PASS(if_conversion,		1);
 
-	// if_conversion breaks info about uses, but next pass (peephole)
-	// doesn't need it, so we can skip def/use update here
-	// until it's really required
-	//SB_RUN_PASS(def_use,			0);
+		// if_conversion breaks info about uses, but next pass (peephole)
+		// doesn't need it, so we can skip def/use update here
+		// until it's really required
+		//SB_RUN_PASS(def_use,			0);
 
-	SB_RUN_PASS(peephole,			1);
-	SB_RUN_PASS(def_use,			0);
+		SB_RUN_PASS(peephole,			1);
+		SB_RUN_PASS(def_use,			0);
 
-	SB_RUN_PASS(gvn,				1);
+		SB_RUN_PASS(gvn,				1);
 
-	SB_RUN_PASS(liveness,			0);
-	SB_RUN_PASS(dce_cleanup,		1);
-	SB_RUN_PASS(def_use,			0);
+		SB_RUN_PASS(liveness,			0);
+		SB_RUN_PASS(dce_cleanup,		1);
+		SB_RUN_PASS(def_use,			0);
+	}
 
 	SB_RUN_PASS(ra_split,			0);
 	SB_RUN_PASS(def_use,			0);
@@ -255,6 +415,9 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 
 		bc->ngpr = sh->ngpr;
 		bc->nstack = sh->nstack;
+
+		if (!cache_key.empty())
+			sb_cache_store(rctx, bc, cache_key);
 	} else {
 		SB_DUMP_STAT( sblog << "sb: dry run: optimized bytecode is not used\n"; );
 	}
@@ -265,6 +428,13 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 		sblog << "sb: processing shader " << shader_id << " done ( "
 				<< ((double)t)/1000000.0 << " ms ).\n";
 
+		sblog << "pass times (ms):";
+		for (unsigned i = 0; i < pass_times.size(); ++i) {
+			sblog << " " << pass_times[i].first << " "
+					<< ((double)pass_times[i].second)/1000000.0;
+		}
+		sblog << "\n";
+
 		sh->opt_stats.ndw = bc->ndw;
 		sh->collect_stats(true);
 
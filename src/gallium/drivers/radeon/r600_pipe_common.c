@@ -26,6 +26,7 @@
 
 #include "r600_pipe_common.h"
 #include "r600_cs.h"
+#include "radeon_shader_cache.h"
 #include "tgsi/tgsi_parse.h"
 #include "util/u_format_s3tc.h"
 
@@ -44,6 +45,9 @@ static const struct debug_named_value common_debug_options[] = {
 	{ "ps", DBG_PS, "Print pixel shaders" },
 	{ "cs", DBG_CS, "Print compute shaders" },
 
+	/* features */
+	{ "noshadercache", DBG_NO_SHADER_CACHE, "Disable the shader binary cache" },
+
 	DEBUG_NAMED_VALUE_END /* must be last */
 };
 
@@ -175,12 +179,18 @@ bool r600_common_screen_init(struct r600_common_screen *rscreen,
 
 	util_format_s3tc_init();
 
+	if (!(rscreen->debug_flags & DBG_NO_SHADER_CACHE)) {
+		rscreen->shader_cache = radeon_shader_cache_create(
+			rscreen->chip_class >= SI ? "radeonsi" : "r600");
+	}
+
 	pipe_mutex_init(rscreen->aux_context_lock);
 	return true;
 }
 
 void r600_common_screen_cleanup(struct r600_common_screen *rscreen)
 {
+	radeon_shader_cache_destroy(rscreen->shader_cache);
 	pipe_mutex_destroy(rscreen->aux_context_lock);
 	rscreen->aux_context->destroy(rscreen->aux_context);
 }
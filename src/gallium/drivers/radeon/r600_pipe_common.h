@@ -74,9 +74,11 @@
 #define DBG_CS			(1 << 12)
 /* features */
 #define DBG_NO_HYPERZ		(1 << 13)
+#define DBG_NO_SHADER_CACHE	(1 << 14)
 /* The maximum allowed bit is 15. */
 
 struct r600_common_context;
+struct radeon_shader_cache;
 
 struct r600_resource {
 	struct u_resource		b;
@@ -166,6 +168,9 @@ struct r600_common_screen {
 	 * It must be locked prior to using and flushed before unlocking. */
 	struct pipe_context		*aux_context;
 	pipe_mutex			aux_context_lock;
+
+	/* Compiled shaders, shared by all contexts. NULL if disabled. */
+	struct radeon_shader_cache	*shader_cache;
 };
 
 /* This encapsulates a state or an operation which can emitted into the GPU
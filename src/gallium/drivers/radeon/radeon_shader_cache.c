@@ -0,0 +1,246 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "radeon_shader_cache.h"
+
+#include "os/os_thread.h"
+#include "util/u_disk_cache.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+#include "util/u_memory.h"
+
+#include <string.h>
+
+/* Memory used by the entries kept in memory.  Shaders compiled after
+ * the limit is reached only go to the disk cache. */
+#define RADEON_SHADER_CACHE_MEMORY_LIMIT	(32 * 1024 * 1024)
+
+/* Disk entries written by another build of the driver must not be
+ * picked up, so the version is part of the disk key. */
+#ifdef PACKAGE_VERSION
+#define RADEON_SHADER_CACHE_VERSION	PACKAGE_VERSION
+#else
+#define RADEON_SHADER_CACHE_VERSION	""
+#endif
+
+struct radeon_shader_cache_key {
+	unsigned hash;
+	unsigned size;
+	const void *data;
+};
+
+/* An entry in the memory cache, followed by the key and the data. */
+struct radeon_shader_cache_entry {
+	struct radeon_shader_cache_key key;
+	unsigned data_size;
+};
+
+struct radeon_shader_cache {
+	pipe_mutex mutex;
+	struct util_hash_table *table;
+	unsigned memory_size;
+
+	struct u_disk_cache *disk_cache;
+};
+
+static unsigned radeon_shader_cache_hash(void *key)
+{
+	return ((struct radeon_shader_cache_key *)key)->hash;
+}
+
+static int radeon_shader_cache_compare(void *key1, void *key2)
+{
+	struct radeon_shader_cache_key *a = key1;
+	struct radeon_shader_cache_key *b = key2;
+
+	return a->hash != b->hash || a->size != b->size ||
+	       memcmp(a->data, b->data, a->size);
+}
+
+static enum pipe_error radeon_shader_cache_free_entry(void *key, void *value,
+						      void *data)
+{
+	FREE(value);
+	return PIPE_OK;
+}
+
+struct radeon_shader_cache *radeon_shader_cache_create(const char *name)
+{
+	struct radeon_shader_cache *cache = CALLOC_STRUCT(radeon_shader_cache);
+
+	if (!cache)
+		return NULL;
+
+	cache->table = util_hash_table_create(radeon_shader_cache_hash,
+					      radeon_shader_cache_compare);
+	if (!cache->table) {
+		FREE(cache);
+		return NULL;
+	}
+
+	cache->disk_cache = u_disk_cache_create(name);
+	pipe_mutex_init(cache->mutex);
+	return cache;
+}
+
+void radeon_shader_cache_destroy(struct radeon_shader_cache *cache)
+{
+	if (!cache)
+		return;
+
+	util_hash_table_foreach(cache->table, radeon_shader_cache_free_entry,
+				NULL);
+	util_hash_table_destroy(cache->table);
+	u_disk_cache_destroy(cache->disk_cache);
+	pipe_mutex_destroy(cache->mutex);
+	FREE(cache);
+}
+
+/* The disk key is the version string followed by the key. */
+static void *radeon_shader_cache_disk_key(const void *key, unsigned key_size,
+					  unsigned *disk_key_size)
+{
+	unsigned version_size = sizeof(RADEON_SHADER_CACHE_VERSION);
+	uint8_t *disk_key = MALLOC(version_size + key_size);
+
+	if (!disk_key)
+		return NULL;
+
+	memcpy(disk_key, RADEON_SHADER_CACHE_VERSION, version_size);
+	memcpy(disk_key + version_size, key, key_size);
+	*disk_key_size = version_size + key_size;
+	return disk_key;
+}
+
+/* Must be called with the mutex held. */
+static void radeon_shader_cache_insert(struct radeon_shader_cache *cache,
+				       const struct radeon_shader_cache_key *key,
+				       const void *data, unsigned size)
+{
+	struct radeon_shader_cache_entry *entry;
+	unsigned entry_size = sizeof(*entry) + key->size + size;
+	uint8_t *ptr;
+
+	if (cache->memory_size + entry_size > RADEON_SHADER_CACHE_MEMORY_LIMIT ||
+	    util_hash_table_get(cache->table, (void *)key))
+		return;
+
+	entry = MALLOC(entry_size);
+	if (!entry)
+		return;
+
+	ptr = (uint8_t *)(entry + 1);
+	memcpy(ptr, key->data, key->size);
+	memcpy(ptr + key->size, data, size);
+
+	entry->key.hash = key->hash;
+	entry->key.size = key->size;
+	entry->key.data = ptr;
+	entry->data_size = size;
+
+	if (util_hash_table_set(cache->table, &entry->key, entry) != PIPE_OK) {
+		FREE(entry);
+		return;
+	}
+
+	cache->memory_size += entry_size;
+}
+
+void *radeon_shader_cache_get(struct radeon_shader_cache *cache,
+			      const void *key, unsigned key_size,
+			      unsigned *size)
+{
+	struct radeon_shader_cache_key lookup;
+	struct radeon_shader_cache_entry *entry;
+	void *data = NULL;
+
+	if (!cache)
+		return NULL;
+
+	lookup.hash = util_hash_crc32(key, key_size);
+	lookup.size = key_size;
+	lookup.data = key;
+
+	pipe_mutex_lock(cache->mutex);
+	entry = util_hash_table_get(cache->table, &lookup);
+	if (entry) {
+		data = MALLOC(entry->data_size);
+		if (data) {
+			memcpy(data, (uint8_t *)(entry + 1) + key_size,
+			       entry->data_size);
+			*size = entry->data_size;
+		}
+	}
+	pipe_mutex_unlock(cache->mutex);
+
+	if (data || !cache->disk_cache)
+		return data;
+
+	{
+		unsigned disk_key_size;
+		void *disk_key = radeon_shader_cache_disk_key(key, key_size,
+							      &disk_key_size);
+
+		if (!disk_key)
+			return NULL;
+
+		data = u_disk_cache_get(cache->disk_cache, disk_key,
+					disk_key_size, size);
+		FREE(disk_key);
+	}
+
+	if (data) {
+		pipe_mutex_lock(cache->mutex);
+		radeon_shader_cache_insert(cache, &lookup, data, *size);
+		pipe_mutex_unlock(cache->mutex);
+	}
+	return data;
+}
+
+void radeon_shader_cache_put(struct radeon_shader_cache *cache,
+			     const void *key, unsigned key_size,
+			     const void *data, unsigned size)
+{
+	struct radeon_shader_cache_key entry_key;
+
+	if (!cache)
+		return;
+
+	entry_key.hash = util_hash_crc32(key, key_size);
+	entry_key.size = key_size;
+	entry_key.data = key;
+
+	pipe_mutex_lock(cache->mutex);
+	radeon_shader_cache_insert(cache, &entry_key, data, size);
+	pipe_mutex_unlock(cache->mutex);
+
+	if (cache->disk_cache) {
+		unsigned disk_key_size;
+		void *disk_key = radeon_shader_cache_disk_key(key, key_size,
+							      &disk_key_size);
+
+		if (disk_key) {
+			u_disk_cache_put(cache->disk_cache, disk_key,
+					 disk_key_size, data, size);
+			FREE(disk_key);
+		}
+	}
+}
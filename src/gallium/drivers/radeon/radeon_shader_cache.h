@@ -0,0 +1,72 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Screen-level cache of compiled shader binaries for r600g and radeonsi.
+ *
+ * Entries are opaque blobs keyed by arbitrary bytes; the drivers put
+ * everything the compiled code depends on into the key (shader tokens or
+ * bytecode, variant key, chip family).  Entries are kept in memory up to
+ * a size limit and, when MESA_SHADER_CACHE_DIR is set, also on disk, so
+ * they survive the process.
+ */
+
+#ifndef RADEON_SHADER_CACHE_H
+#define RADEON_SHADER_CACHE_H
+
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct radeon_shader_cache;
+
+/**
+ * \param name  name of the disk cache directory, e.g. the driver name
+ */
+struct radeon_shader_cache *radeon_shader_cache_create(const char *name);
+
+void radeon_shader_cache_destroy(struct radeon_shader_cache *cache);
+
+/**
+ * Look up an entry, in memory first and then on disk.
+ *
+ * On a hit a copy of the data is returned in a MALLOC'ed buffer which the
+ * caller must FREE, and its size is written to *size.  Returns NULL on a
+ * miss.
+ */
+void *radeon_shader_cache_get(struct radeon_shader_cache *cache,
+			      const void *key, unsigned key_size,
+			      unsigned *size);
+
+/**
+ * Store an entry.  Failures are silently ignored.
+ */
+void radeon_shader_cache_put(struct radeon_shader_cache *cache,
+			     const void *key, unsigned key_size,
+			     const void *data, unsigned size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RADEON_SHADER_CACHE_H */
@@ -451,6 +451,8 @@ static int r600_get_param(struct pipe_screen* pscreen, enum pipe_cap param)
 		return 7;
 	case PIPE_CAP_ENDIANNESS:
 		return PIPE_ENDIAN_LITTLE;
+	case PIPE_CAP_SHAREABLE_STATE_OBJECTS:
+		return 0;
 	}
 	return 0;
 }
@@ -524,6 +526,9 @@ static int r600_get_shader_param(struct pipe_screen* pscreen, unsigned shader, e
 		return 1;
 	case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
 		return 0;
+	case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
+	case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
+		return 1;
 	case PIPE_SHADER_CAP_INDIRECT_INPUT_ADDR:
 	case PIPE_SHADER_CAP_INDIRECT_OUTPUT_ADDR:
 	case PIPE_SHADER_CAP_INDIRECT_TEMP_ADDR:
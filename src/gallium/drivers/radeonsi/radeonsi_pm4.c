@@ -174,6 +174,21 @@ struct si_pm4_state * si_pm4_alloc_state(struct r600_context *rctx)
 	return pm4;
 }
 
+/* Returns true if both states emit exactly the same packets. */
+bool si_pm4_state_equal(const struct si_pm4_state *a,
+			const struct si_pm4_state *b)
+{
+	return a->ndw == b->ndw &&
+	       a->nbo == b->nbo &&
+	       a->nrelocs == b->nrelocs &&
+	       a->cp_coher_cntl == b->cp_coher_cntl &&
+	       a->compute_pkt == b->compute_pkt &&
+	       !memcmp(a->pm4, b->pm4, a->ndw * 4) &&
+	       !memcmp(a->bo, b->bo, a->nbo * sizeof(a->bo[0])) &&
+	       !memcmp(a->bo_usage, b->bo_usage, a->nbo * sizeof(a->bo_usage[0])) &&
+	       !memcmp(a->relocs, b->relocs, a->nrelocs * sizeof(a->relocs[0]));
+}
+
 uint32_t si_pm4_sync_flags(struct r600_context *rctx)
 {
 	uint32_t cp_coher_cntl = 0;
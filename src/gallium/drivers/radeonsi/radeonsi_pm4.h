@@ -85,6 +85,8 @@ void si_pm4_free_state(struct r600_context *rctx,
 		       struct si_pm4_state *state,
 		       unsigned idx);
 struct si_pm4_state * si_pm4_alloc_state(struct r600_context *rctx);
+bool si_pm4_state_equal(const struct si_pm4_state *a,
+			const struct si_pm4_state *b);
 
 uint32_t si_pm4_sync_flags(struct r600_context *rctx);
 unsigned si_pm4_dirty_dw(struct r600_context *rctx);
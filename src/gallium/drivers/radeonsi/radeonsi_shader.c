@@ -37,6 +37,7 @@
 #include "gallivm/lp_bld_flow.h"
 #include "radeon_llvm.h"
 #include "radeon_llvm_emit.h"
+#include "radeon_shader_cache.h"
 #include "util/u_memory.h"
 #include "tgsi/tgsi_info.h"
 #include "tgsi/tgsi_parse.h"
@@ -1779,32 +1780,164 @@ static void preload_streamout_buffers(struct si_shader_context *si_shader_ctx)
 	}
 }
 
-int si_compile_llvm(struct r600_context *rctx, struct si_pipe_shader *shader,
-							LLVMModuleRef mod)
+/* Everything a shader variant built by si_pipe_shader_create() depends on.
+ * The shader cache key is this, followed by the TGSI tokens. */
+struct si_shader_cache_key {
+	unsigned			llvm_version;
+	unsigned			family;
+	unsigned			nr_cbufs;
+	union si_shader_key		key;
+	struct pipe_stream_output_info	so;
+};
+
+/* A shader cache entry, followed by the machine code. */
+struct si_shader_cache_data {
+	struct si_shader		shader;
+	unsigned			num_sgprs;
+	unsigned			num_vgprs;
+	unsigned			lds_size;
+	unsigned			spi_ps_input_ena;
+	unsigned			spi_shader_col_format;
+	unsigned			cb_shader_mask;
+	unsigned			code_size;
+};
+
+static void *si_shader_cache_key(struct r600_context *rctx,
+				 struct si_pipe_shader *shader,
+				 unsigned *key_size)
+{
+	struct si_pipe_shader_selector *sel = shader->selector;
+	unsigned tokens_size = tgsi_num_tokens(sel->tokens) *
+			       sizeof(struct tgsi_token);
+	struct si_shader_cache_key *key;
+
+	*key_size = sizeof(*key) + tokens_size;
+	key = CALLOC(1, *key_size);
+	if (!key)
+		return NULL;
+
+	key->llvm_version = HAVE_LLVM;
+	key->family = rctx->screen->b.family;
+	key->nr_cbufs = rctx->framebuffer.nr_cbufs;
+	key->key = shader->key;
+	key->so = sel->so;
+	memcpy(key + 1, sel->tokens, tokens_size);
+	return key;
+}
+
+static int si_shader_upload(struct r600_context *rctx,
+			    struct si_pipe_shader *shader,
+			    const unsigned char *code, unsigned code_size)
 {
-	unsigned i;
 	uint32_t *ptr;
-	struct radeon_llvm_binary binary;
+	unsigned i;
+
+	r600_resource_reference(&shader->bo, NULL);
+	shader->bo = r600_resource_create_custom(rctx->b.b.screen, PIPE_USAGE_IMMUTABLE,
+					       code_size);
+	if (shader->bo == NULL) {
+		return -ENOMEM;
+	}
+
+	ptr = (uint32_t*)rctx->b.ws->buffer_map(shader->bo->cs_buf, rctx->b.rings.gfx.cs, PIPE_TRANSFER_WRITE);
+	if (0 /*R600_BIG_ENDIAN*/) {
+		for (i = 0; i < code_size / 4; ++i) {
+			ptr[i] = util_bswap32(*(uint32_t*)(code + i*4));
+		}
+	} else {
+		memcpy(ptr, code, code_size);
+	}
+	rctx->b.ws->buffer_unmap(shader->bo->cs_buf);
+
+	return 0;
+}
+
+/* Returns true and sets up the shader if it was found in the cache. */
+static bool si_shader_cache_load(struct r600_context *rctx,
+				 struct si_pipe_shader *shader,
+				 const void *key, unsigned key_size)
+{
+	struct si_shader_cache_data *data;
+	unsigned size;
+	bool found = false;
+
+	data = radeon_shader_cache_get(rctx->screen->b.shader_cache,
+				       key, key_size, &size);
+	if (!data)
+		return false;
+
+	if (size >= sizeof(*data) && size - sizeof(*data) == data->code_size &&
+	    si_shader_upload(rctx, shader, (unsigned char *)(data + 1),
+			     data->code_size) == 0) {
+		shader->shader = data->shader;
+		shader->num_sgprs = data->num_sgprs;
+		shader->num_vgprs = data->num_vgprs;
+		shader->lds_size = data->lds_size;
+		shader->spi_ps_input_ena = data->spi_ps_input_ena;
+		shader->spi_shader_col_format = data->spi_shader_col_format;
+		shader->cb_shader_mask = data->cb_shader_mask;
+		found = true;
+	}
+
+	FREE(data);
+	return found;
+}
+
+static void si_shader_cache_store(struct r600_context *rctx,
+				  struct si_pipe_shader *shader,
+				  const void *key, unsigned key_size,
+				  const struct radeon_llvm_binary *binary)
+{
+	struct si_shader_cache_data *data;
+	unsigned size = sizeof(*data) + binary->code_size;
+
+	data = CALLOC(1, size);
+	if (!data)
+		return;
+
+	data->shader = shader->shader;
+	data->num_sgprs = shader->num_sgprs;
+	data->num_vgprs = shader->num_vgprs;
+	data->lds_size = shader->lds_size;
+	data->spi_ps_input_ena = shader->spi_ps_input_ena;
+	data->spi_shader_col_format = shader->spi_shader_col_format;
+	data->cb_shader_mask = shader->cb_shader_mask;
+	data->code_size = binary->code_size;
+	memcpy(data + 1, binary->code, binary->code_size);
+
+	radeon_shader_cache_put(rctx->screen->b.shader_cache, key, key_size,
+				data, size);
+	FREE(data);
+}
+
+/* Compile the module and read the register config into the shader.
+ * The caller must free binary->code and binary->config. */
+static void si_compile_llvm_binary(struct r600_context *rctx,
+				   struct si_pipe_shader *shader,
+				   LLVMModuleRef mod,
+				   struct radeon_llvm_binary *binary)
+{
+	unsigned i;
 	bool dump = r600_can_dump_shader(&rctx->screen->b,
 			shader->selector ? shader->selector->tokens : NULL);
-	memset(&binary, 0, sizeof(binary));
-	radeon_llvm_compile(mod, &binary,
+	memset(binary, 0, sizeof(*binary));
+	radeon_llvm_compile(mod, binary,
 		r600_get_llvm_processor_name(rctx->screen->b.family), dump);
-	if (dump && ! binary.disassembled) {
+	if (dump && ! binary->disassembled) {
 		fprintf(stderr, "SI CODE:\n");
-		for (i = 0; i < binary.code_size; i+=4 ) {
-			fprintf(stderr, "%02x%02x%02x%02x\n", binary.code[i + 3],
-				binary.code[i + 2], binary.code[i + 1],
-				binary.code[i]);
+		for (i = 0; i < binary->code_size; i+=4 ) {
+			fprintf(stderr, "%02x%02x%02x%02x\n", binary->code[i + 3],
+				binary->code[i + 2], binary->code[i + 1],
+				binary->code[i]);
 		}
 	}
 
 	/* XXX: We may be able to emit some of these values directly rather than
 	 * extracting fields to be emitted later.
 	 */
-	for (i = 0; i < binary.config_size; i+= 8) {
-		unsigned reg = util_le32_to_cpu(*(uint32_t*)(binary.config + i));
-		unsigned value = util_le32_to_cpu(*(uint32_t*)(binary.config + i + 4));
+	for (i = 0; i < binary->config_size; i+= 8) {
+		unsigned reg = util_le32_to_cpu(*(uint32_t*)(binary->config + i));
+		unsigned value = util_le32_to_cpu(*(uint32_t*)(binary->config + i + 4));
 		switch (reg) {
 		case R_00B028_SPI_SHADER_PGM_RSRC1_PS:
 		case R_00B128_SPI_SHADER_PGM_RSRC1_VS:
@@ -1828,29 +1961,23 @@ int si_compile_llvm(struct r600_context *rctx, struct si_pipe_shader *shader,
 			break;
 		}
 	}
+}
 
-	/* copy new shader */
-	r600_resource_reference(&shader->bo, NULL);
-	shader->bo = r600_resource_create_custom(rctx->b.b.screen, PIPE_USAGE_IMMUTABLE,
-					       binary.code_size);
-	if (shader->bo == NULL) {
-		return -ENOMEM;
-	}
+int si_compile_llvm(struct r600_context *rctx, struct si_pipe_shader *shader,
+							LLVMModuleRef mod)
+{
+	struct radeon_llvm_binary binary;
+	int r;
 
-	ptr = (uint32_t*)rctx->b.ws->buffer_map(shader->bo->cs_buf, rctx->b.rings.gfx.cs, PIPE_TRANSFER_WRITE);
-	if (0 /*R600_BIG_ENDIAN*/) {
-		for (i = 0; i < binary.code_size / 4; ++i) {
-			ptr[i] = util_bswap32(*(uint32_t*)(binary.code + i*4));
-		}
-	} else {
-		memcpy(ptr, binary.code, binary.code_size);
-	}
-	rctx->b.ws->buffer_unmap(shader->bo->cs_buf);
+	si_compile_llvm_binary(rctx, shader, mod, &binary);
+
+	/* copy new shader */
+	r = si_shader_upload(rctx, shader, binary.code, binary.code_size);
 
 	free(binary.code);
 	free(binary.config);
 
-	return 0;
+	return r;
 }
 
 int si_pipe_shader_create(
@@ -1862,7 +1989,10 @@ int si_pipe_shader_create(
 	struct si_shader_context si_shader_ctx;
 	struct tgsi_shader_info shader_info;
 	struct lp_build_tgsi_context * bld_base;
+	struct radeon_llvm_binary binary;
 	LLVMModuleRef mod;
+	void *cache_key = NULL;
+	unsigned cache_key_size = 0;
 	int r = 0;
 	bool dump = r600_can_dump_shader(&rctx->screen->b, shader->selector->tokens);
 
@@ -1870,6 +2000,16 @@ int si_pipe_shader_create(
 	assert(shader->shader.ninterp == 0);
 	assert(shader->shader.ninput == 0);
 
+	/* Dumps are only printed while compiling, so skip the cache. */
+	if (rctx->screen->b.shader_cache && !dump) {
+		cache_key = si_shader_cache_key(rctx, shader, &cache_key_size);
+		if (cache_key &&
+		    si_shader_cache_load(rctx, shader, cache_key, cache_key_size)) {
+			FREE(cache_key);
+			return 0;
+		}
+	}
+
 	memset(&si_shader_ctx, 0, sizeof(si_shader_ctx));
 	radeon_llvm_context_init(&si_shader_ctx.radeon_bld);
 	bld_base = &si_shader_ctx.radeon_bld.soa.bld_base;
@@ -1924,13 +2064,22 @@ int si_pipe_shader_create(
 		FREE(si_shader_ctx.constants);
 		FREE(si_shader_ctx.resources);
 		FREE(si_shader_ctx.samplers);
+		FREE(cache_key);
 		return -EINVAL;
 	}
 
 	radeon_llvm_finalize_module(&si_shader_ctx.radeon_bld);
 
 	mod = bld_base->base.gallivm->module;
-	r = si_compile_llvm(rctx, shader, mod);
+	si_compile_llvm_binary(rctx, shader, mod, &binary);
+	r = si_shader_upload(rctx, shader, binary.code, binary.code_size);
+	if (r == 0 && cache_key && binary.code_size) {
+		si_shader_cache_store(rctx, shader, cache_key, cache_key_size,
+				      &binary);
+	}
+	free(binary.code);
+	free(binary.config);
+	FREE(cache_key);
 
 	radeon_llvm_dispose(&si_shader_ctx.radeon_bld);
 	tgsi_parse_free(&si_shader_ctx.parse);
@@ -122,6 +122,7 @@ static void si_init_descriptors(struct r600_context *rctx,
 	desc->element_dw_size = element_dw_size;
 	desc->num_elements = num_elements;
 	desc->context_size = num_elements * element_dw_size * 4;
+	desc->shadow = CALLOC(num_elements, element_dw_size * 4);
 
 	desc->buffer = (struct r600_resource*)
 		pipe_buffer_create(rctx->b.b.screen, PIPE_BIND_CUSTOM,
@@ -140,6 +141,7 @@ static void si_init_descriptors(struct r600_context *rctx,
 static void si_release_descriptors(struct si_descriptors *desc)
 {
 	pipe_resource_reference((struct pipe_resource**)&desc->buffer, NULL);
+	FREE(desc->shadow);
 }
 
 static void si_update_descriptors(struct r600_context *rctx,
@@ -169,6 +171,19 @@ static void si_emit_shader_pointer(struct r600_context *rctx,
 	radeon_emit(cs, (desc->shader_userdata_reg - SI_SH_REG_OFFSET) >> 2);
 	radeon_emit(cs, va);
 	radeon_emit(cs, va >> 32);
+
+	desc->pointer_dirty = false;
+}
+
+/* Emit the shader pointer at the start of a new CS, unless the descriptors
+ * are going to be emitted anyway, which emits the pointer too. */
+static void si_descriptors_begin_new_cs(struct r600_context *rctx,
+					struct si_descriptors *desc)
+{
+	desc->pointer_dirty = true;
+
+	if (!desc->atom.dirty)
+		si_emit_shader_pointer(rctx, desc);
 }
 
 static void si_emit_descriptors(struct r600_context *rctx,
@@ -180,19 +195,48 @@ static void si_emit_descriptors(struct r600_context *rctx,
 	int packet_start;
 	int packet_size = 0;
 	int last_index = desc->num_elements; /* point to a non-existing element */
+	unsigned element_size = desc->element_dw_size * 4;
 	unsigned dirty_mask = desc->dirty_mask;
+	unsigned copy_mask, mask;
 	unsigned new_context_id = (desc->current_context_id + 1) % SI_NUM_CONTEXTS;
 
 	assert(dirty_mask);
 
+	/* Skip the elements that were set back to what the current context
+	 * already contains, e.g. when a texture is unbound and bound again. */
+	mask = dirty_mask;
+	while (mask) {
+		int i = u_bit_scan(&mask);
+
+		if (!memcmp(desc->shadow + i * desc->element_dw_size,
+			    descriptors[i], element_size))
+			dirty_mask &= ~(1 << i);
+	}
+	desc->dirty_mask = 0;
+
+	if (!dirty_mask) {
+		if (desc->pointer_dirty)
+			si_emit_shader_pointer(rctx, desc);
+		return;
+	}
+
 	va_base = r600_resource_va(rctx->b.b.screen, &desc->buffer->b.b);
 
-	/* Copy the descriptors to a new context slot. */
+	/* Copy the descriptors to a new context slot.  Only the elements
+	 * which are in use and aren't overwritten below are needed. */
 	/* XXX Consider using TC or L2 for this copy on CIK. */
-	si_emit_cp_dma_copy_buffer(rctx,
-				   va_base + new_context_id * desc->context_size,
-				   va_base + desc->current_context_id * desc->context_size,
-				   desc->context_size, R600_CP_DMA_SYNC);
+	copy_mask = ~dirty_mask &
+		    (unsigned)(((uint64_t)1 << desc->num_used_elements) - 1);
+	if (copy_mask) {
+		unsigned first = ffs(copy_mask) - 1;
+		unsigned offset = first * element_size;
+
+		si_emit_cp_dma_copy_buffer(rctx,
+					   va_base + new_context_id * desc->context_size + offset,
+					   va_base + desc->current_context_id * desc->context_size + offset,
+					   (util_last_bit(copy_mask) - first) * element_size,
+					   R600_CP_DMA_SYNC);
+	}
 
 	va_base += new_context_id * desc->context_size;
 
@@ -227,11 +271,16 @@ static void si_emit_descriptors(struct r600_context *rctx,
 		}
 
 		radeon_emit_array(cs, descriptors[i], desc->element_dw_size);
+		memcpy(desc->shadow + i * desc->element_dw_size, descriptors[i],
+		       element_size);
+
+		if (i >= desc->num_used_elements &&
+		    memcmp(descriptors[i], null_desc, element_size))
+			desc->num_used_elements = i + 1;
 
 		last_index = i;
 	}
 
-	desc->dirty_mask = 0;
 	desc->current_context_id = new_context_id;
 
 	/* Now update the shader userdata pointer. */
@@ -298,7 +347,7 @@ static void si_sampler_views_begin_new_cs(struct r600_context *rctx,
 
 	r600_context_bo_reloc(&rctx->b, &rctx->b.rings.gfx, views->desc.buffer, RADEON_USAGE_READWRITE);
 
-	si_emit_shader_pointer(rctx, &views->desc);
+	si_descriptors_begin_new_cs(rctx, &views->desc);
 }
 
 void si_set_sampler_view(struct r600_context *rctx, unsigned shader,
@@ -395,7 +444,7 @@ static void si_buffer_resources_begin_new_cs(struct r600_context *rctx,
 	r600_context_bo_reloc(&rctx->b, &rctx->b.rings.gfx,
 			      buffers->desc.buffer, RADEON_USAGE_READWRITE);
 
-	si_emit_shader_pointer(rctx, &buffers->desc);
+	si_descriptors_begin_new_cs(rctx, &buffers->desc);
 }
 
 /* CONSTANT BUFFERS */
@@ -138,6 +138,15 @@ struct si_descriptors {
 	/* The size of a context, should be equal to 4*element_dw_size*num_elements. */
 	unsigned context_size;
 
+	/* CPU copy of the current context, used to skip dirty elements
+	 * whose descriptors didn't actually change. */
+	uint32_t *shadow;
+	/* Elements at this index and above have never been set to anything
+	 * but zeros, so they are zero in every context and aren't copied. */
+	unsigned num_used_elements;
+	/* The shader pointer must be emitted again (new CS). */
+	bool pointer_dirty;
+
 	/* The shader userdata register where the 64-bit pointer to the descriptor
 	 * array will be stored. */
 	unsigned shader_userdata_reg;
@@ -188,6 +197,19 @@ struct si_buffer_resources {
 		} \
 	} while(0)
 
+/* For states rebuilt at every draw: if the new state is identical to the
+ * queued one, keep the queued one, so that it isn't emitted again. */
+#define si_pm4_set_state_cached(rctx, member, value) \
+	do { \
+		if ((rctx)->queued.named.member && \
+		    si_pm4_state_equal((struct si_pm4_state *)(rctx)->queued.named.member, \
+				       (value))) { \
+			si_pm4_free_state(rctx, (value), ~0); \
+		} else { \
+			si_pm4_set_state(rctx, member, value); \
+		} \
+	} while(0)
+
 /* si_descriptors.c */
 void si_set_sampler_view(struct r600_context *rctx, unsigned shader,
 			 unsigned slot, struct pipe_sampler_view *view,
@@ -375,7 +375,7 @@ static bool si_update_draw_info_state(struct r600_context *rctx,
 		       (vs->clip_dist_write ? 0 :
 			rctx->queued.named.rasterizer->clip_plane_enable & 0x3F));
 
-	si_pm4_set_state(rctx, draw_info, pm4);
+	si_pm4_set_state_cached(rctx, draw_info, pm4);
 	return true;
 }
 
@@ -433,7 +433,7 @@ bcolor:
 		}
 	}
 
-	si_pm4_set_state(rctx, spi, pm4);
+	si_pm4_set_state_cached(rctx, spi, pm4);
 }
 
 static void si_update_derived_state(struct r600_context *rctx)
@@ -553,7 +553,7 @@ static void si_vertex_buffer_update(struct r600_context *rctx)
 		}
 	}
 	si_pm4_sh_data_end(pm4, R_00B130_SPI_SHADER_USER_DATA_VS_0, SI_SGPR_VERTEX_BUFFER);
-	si_pm4_set_state(rctx, vertex_buffers, pm4);
+	si_pm4_set_state_cached(rctx, vertex_buffers, pm4);
 }
 
 static void si_state_draw(struct r600_context *rctx,
@@ -38,6 +38,7 @@
 #include "sp_clear.h"
 #include "sp_context.h"
 #include "sp_query.h"
+#include "sp_threads.h"
 #include "sp_tile_cache.h"
 
 
@@ -62,6 +63,10 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
    if (!softpipe_check_render_cond(softpipe))
       return;
 
+   /* the clear goes through our own tile caches */
+   if (softpipe->threads)
+      sp_threads_release(softpipe->threads);
+
 #if 0
    softpipe_update_derived(softpipe, PIPE_PRIM_TRIANGLES); /* not needed?? */
 #endif
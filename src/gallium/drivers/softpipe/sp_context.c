@@ -52,6 +52,7 @@
 #include "sp_query.h"
 #include "sp_screen.h"
 #include "sp_tex_sample.h"
+#include "sp_threads.h"
 
 
 static void
@@ -75,17 +76,10 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
-   if (softpipe->quad.shade)
-      softpipe->quad.shade->destroy( softpipe->quad.shade );
+   if (softpipe->threads)
+      sp_threads_destroy(softpipe->threads);
 
-   if (softpipe->quad.depth_test)
-      softpipe->quad.depth_test->destroy( softpipe->quad.depth_test );
-
-   if (softpipe->quad.blend)
-      softpipe->quad.blend->destroy( softpipe->quad.blend );
-
-   if (softpipe->quad.pstipple)
-      softpipe->quad.pstipple->destroy( softpipe->quad.pstipple );
+   sp_quad_pipe_destroy(&softpipe->quad);
 
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
       sp_destroy_tile_cache(softpipe->cbuf_cache[i]);
@@ -251,10 +245,18 @@ softpipe_create_context( struct pipe_screen *screen,
    softpipe->fs_machine = tgsi_exec_machine_create();
 
    /* setup quad rendering stages */
-   softpipe->quad.shade = sp_quad_shade_stage(softpipe);
-   softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
-   softpipe->quad.blend = sp_quad_blend_stage(softpipe);
-   softpipe->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+   if (!sp_quad_pipe_init(&softpipe->quad, softpipe))
+      goto fail;
+
+   softpipe->quad.fs_machine = softpipe->fs_machine;
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      softpipe->quad.cbuf_cache[i] = softpipe->cbuf_cache[i];
+   softpipe->quad.zsbuf_cache = softpipe->zsbuf_cache;
+   softpipe->quad.occlusion_count = &softpipe->occlusion_count;
+   softpipe->quad.ps_invocations =
+      &softpipe->pipeline_statistics.ps_invocations;
+
+   softpipe->threads = sp_threads_create(softpipe);
 
 
    /*
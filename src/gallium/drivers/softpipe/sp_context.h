@@ -55,6 +55,7 @@ struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
 struct sp_so_state;
+struct sp_threads;
 
 struct softpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -152,13 +153,10 @@ struct softpipe_context {
    } pstipple;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct sp_quad_pipe quad;
+
+   /** Rasterizer threads, NULL unless SOFTPIPE_NUM_THREADS is set */
+   struct sp_threads *threads;
 
    /** TGSI exec things */
    struct {
@@ -38,6 +38,7 @@
 #include "sp_state.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_threads.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
 
@@ -52,6 +53,10 @@ softpipe_flush( struct pipe_context *pipe,
 
    draw_flush(softpipe->draw);
 
+   /* get the threads' tiles back into the surfaces */
+   if (softpipe->threads)
+      sp_threads_release(softpipe->threads);
+
    if (flags & SP_FLUSH_TEXTURE_CACHE) {
       unsigned sh;
 
@@ -60,6 +65,9 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+
+      if (softpipe->threads)
+         sp_threads_flush_tex_caches(softpipe->threads);
    }
 
    /* If this is a swapbuffers, just flush color buffers.
@@ -67,9 +67,9 @@ exec_prepare( const struct sp_fragment_shader_variant *var,
    /*
     * Bind tokens/shader to the interpreter's machine state.
     */
-   tgsi_exec_machine_bind_shader(machine,
-                                 var->tokens,
-                                 sampler);
+   tgsi_exec_machine_bind_decoded(machine,
+                                  var->decoded,
+                                  sampler);
 }
 
 
@@ -179,10 +179,11 @@ static void
 exec_delete(struct sp_fragment_shader_variant *var,
             struct tgsi_exec_machine *machine)
 {
-   if (machine->Tokens == var->tokens) {
-      tgsi_exec_machine_bind_shader(machine, NULL, NULL);
+   if (machine->Decoded == var->decoded) {
+      tgsi_exec_machine_bind_decoded(machine, NULL, NULL);
    }
 
+   tgsi_free_decoded_shader(var->decoded);
    FREE( (void *) var->tokens );
    FREE(var);
 }
@@ -137,11 +137,12 @@ sp_vbuf_set_primitive(struct vbuf_render *vbr, unsigned prim)
 {
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
    struct setup_context *setup_ctx = cvbr->setup;
-   
-   sp_setup_prepare( setup_ctx );
 
+   /* before sp_setup_prepare(), which looks at it */
    cvbr->softpipe->reduced_prim = u_reduced_prim(prim);
    cvbr->prim = prim;
+
+   sp_setup_prepare( setup_ctx );
 }
 
 
@@ -345,6 +346,9 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   /* the vertices go away once we return */
+   sp_setup_flush( setup );
 }
 
 
@@ -585,6 +589,9 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   /* the vertices go away once we return */
+   sp_setup_flush( setup );
 }
 
 /*
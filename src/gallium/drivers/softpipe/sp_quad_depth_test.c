@@ -785,7 +785,7 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
       data.ps = qs->softpipe->framebuffer.zsbuf;
       data.format = data.ps->format;
-      data.tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache, 
+      data.tile = sp_get_cached_tile(qs->qp->zsbuf_cache, 
                                      quads[0]->input.x0, 
                                      quads[0]->input.y0);
 
@@ -822,7 +822,7 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
    if (qs->softpipe->active_query_count) {
       for (i = 0; i < nr; i++) 
-         qs->softpipe->occlusion_count += mask_count[quads[i]->inout.mask];
+         *qs->qp->occlusion_count += mask_count[quads[i]->inout.mask];
    }
 
    if (nr)
@@ -31,9 +31,14 @@
 #ifndef SP_QUAD_PIPE_H
 #define SP_QUAD_PIPE_H
 
+#include "pipe/p_state.h"
+
 
 struct softpipe_context;
+struct softpipe_tile_cache;
+struct tgsi_exec_machine;
 struct quad_header;
+struct sp_quad_pipe;
 
 
 /**
@@ -43,6 +48,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct sp_quad_pipe *qp;   /**< the pipeline this stage is part of */
 
    struct quad_stage *next;
 
@@ -67,6 +73,34 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
-void sp_build_quad_pipeline(struct softpipe_context *sp);
+
+/**
+ * One instance of the quad pipeline, with everything its stages write to:
+ * the shader machine, the framebuffer tile caches and the fragment
+ * counters.  The context has one, and each rasterizer thread has its own
+ * (see sp_threads.c) so that the threads don't share any mutable state.
+ */
+struct sp_quad_pipe {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *first; /**< points to one of the above stages */
+
+   struct tgsi_exec_machine *fs_machine;
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+
+   uint64_t *occlusion_count;
+   uint64_t *ps_invocations;
+};
+
+
+boolean sp_quad_pipe_init(struct sp_quad_pipe *qp,
+                          struct softpipe_context *sp);
+void sp_quad_pipe_destroy(struct sp_quad_pipe *qp);
+
+void sp_build_quad_pipeline(struct softpipe_context *sp,
+                            struct sp_quad_pipe *qp);
 
 #endif /* SP_QUAD_PIPE_H */
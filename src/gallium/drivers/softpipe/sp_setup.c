@@ -32,11 +32,15 @@
  * \author  Brian Paul
  */
 
+#include <limits.h>
+
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
 #include "sp_setup.h"
 #include "sp_state.h"
+#include "sp_threads.h"
+#include "sp_tile_cache.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vertex.h"
 #include "pipe/p_shader_tokens.h"
@@ -74,6 +78,14 @@ struct edge {
  */
 struct setup_context {
    struct softpipe_context *softpipe;
+   struct sp_quad_pipe *qp;  /**< the quad pipeline we feed */
+
+   /** Only pixel rows band_miny .. band_maxy - 1 are drawn */
+   int band_miny;
+   int band_maxy;
+
+   /** Pass triangles to the rasterizer threads instead of drawing them */
+   boolean binning;
 
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
@@ -161,13 +173,13 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip( setup, quad );
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct quad_stage *first = setup->qp->first;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      first->run( first, &quad, 1 );
    }
 }
 
@@ -202,7 +214,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = setup->qp->first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -712,8 +724,8 @@ subtriangle(struct setup_context *setup,
    const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect;
    const int minx = (int) cliprect->minx;
    const int maxx = (int) cliprect->maxx;
-   const int miny = (int) cliprect->miny;
-   const int maxy = (int) cliprect->maxy;
+   const int miny = MAX2((int) cliprect->miny, setup->band_miny);
+   const int maxy = MIN2((int) cliprect->maxy, setup->band_maxy);
    int y, start_y, finish_y;
    int sy = (int)eleft->sy;
 
@@ -737,7 +749,6 @@ subtriangle(struct setup_context *setup,
    */
 
    for (y = start_y; y < finish_y; y++) {
-
       /* avoid accumulating adds as floats don't have the precision to
        * accurately iterate large triangle edges that way.  luckily we
        * can just multiply these days.
@@ -796,6 +807,68 @@ calc_det(const float (*v0)[4],
 }
 
 
+/**
+ * Render the triangle sorted by setup_sort_vertices().
+ */
+static void
+setup_tri_rasterize(struct setup_context *setup)
+{
+   setup_tri_coefficients( setup );
+   setup_tri_edges( setup );
+
+   assert(setup->softpipe->reduced_prim == PIPE_PRIM_TRIANGLES);
+
+   setup->span.y = 0;
+   setup->span.right[0] = 0;
+   setup->span.right[1] = 0;
+   /*   setup->span.z_mode = tri_z_mode( setup->ctx ); */
+
+   /*   init_constant_attribs( setup ); */
+
+   if (setup->oneoverarea < 0.0) {
+      /* emaj on left:
+       */
+      subtriangle( setup, &setup->emaj, &setup->ebot, setup->ebot.lines );
+      subtriangle( setup, &setup->emaj, &setup->etop, setup->etop.lines );
+   }
+   else {
+      /* emaj on right:
+       */
+      subtriangle( setup, &setup->ebot, &setup->emaj, setup->ebot.lines );
+      subtriangle( setup, &setup->etop, &setup->emaj, setup->etop.lines );
+   }
+
+   flush_spans( setup );
+}
+
+
+/**
+ * Pass the triangle sorted by setup_sort_vertices() to the rasterizer
+ * threads of the tile rows it may cover.
+ */
+static void
+setup_tri_bin(struct setup_context *setup,
+              const float (*v0)[4],
+              const float (*v1)[4],
+              const float (*v2)[4])
+{
+   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect;
+   /* one pixel of slack covers the pixel offset and rounding */
+   const float miny = MAX2(setup->vmin[0][1] - 1.0f, (float) cliprect->miny);
+   const float maxy = MIN2(setup->vmax[0][1] + 1.0f,
+                           (float) cliprect->maxy - 1.0f);
+
+   if (miny > maxy)
+      return;
+
+   sp_threads_bin_tri(setup->softpipe->threads,
+                      setup->cull_face,
+                      (unsigned) miny >> TILE_SIZE_LOG2,
+                      (unsigned) maxy >> TILE_SIZE_LOG2,
+                      v0, v1, v2);
+}
+
+
 /**
  * Do setup for triangle rasterization, then render the triangle.
  */
@@ -830,32 +903,10 @@ sp_setup_tri(struct setup_context *setup,
    if (!setup_sort_vertices( setup, det, v0, v1, v2 ))
       return;
 
-   setup_tri_coefficients( setup );
-   setup_tri_edges( setup );
-
-   assert(setup->softpipe->reduced_prim == PIPE_PRIM_TRIANGLES);
-
-   setup->span.y = 0;
-   setup->span.right[0] = 0;
-   setup->span.right[1] = 0;
-   /*   setup->span.z_mode = tri_z_mode( setup->ctx ); */
-
-   /*   init_constant_attribs( setup ); */
-
-   if (setup->oneoverarea < 0.0) {
-      /* emaj on left:
-       */
-      subtriangle( setup, &setup->emaj, &setup->ebot, setup->ebot.lines );
-      subtriangle( setup, &setup->emaj, &setup->etop, setup->etop.lines );
-   }
-   else {
-      /* emaj on right:
-       */
-      subtriangle( setup, &setup->ebot, &setup->emaj, setup->ebot.lines );
-      subtriangle( setup, &setup->etop, &setup->emaj, setup->etop.lines );
-   }
-
-   flush_spans( setup );
+   if (setup->binning)
+      setup_tri_bin( setup, v0, v1, v2 );
+   else
+      setup_tri_rasterize( setup );
 
    if (setup->softpipe->active_statistics_queries) {
       setup->softpipe->pipeline_statistics.c_primitives++;
@@ -1414,7 +1465,21 @@ sp_setup_prepare(struct setup_context *setup)
    /* Note: nr_attrs is only used for debugging (vertex printing) */
    setup->nr_vertex_attrs = draw_num_shader_outputs(sp->draw);
 
-   sp->quad.first->begin( sp->quad.first );
+   if (sp->threads &&
+       sp->reduced_prim == PIPE_PRIM_TRIANGLES &&
+       !sp->no_rast &&
+       !sp->rasterizer->rasterizer_discard) {
+      /* triangles are binned and drawn by sp_setup_flush() */
+      sp_threads_acquire(sp->threads);
+      setup->binning = TRUE;
+   }
+   else {
+      if (sp->threads)
+         sp_threads_release(sp->threads);
+      setup->binning = FALSE;
+
+      sp->quad.first->begin( sp->quad.first );
+   }
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1429,6 +1494,63 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Called by vbuf code once it's done with the vertices of the primitives
+ * it passed us.  Draws the triangles binned since the last call.
+ */
+void
+sp_setup_flush(struct setup_context *setup)
+{
+   if (setup->binning)
+      sp_threads_rasterize(setup->softpipe->threads, setup->cull_face);
+}
+
+
+/**
+ * Make the context draw only pixel rows miny .. maxy - 1, into the given
+ * quad pipeline.  Used by the rasterizer threads.
+ */
+void
+sp_setup_set_band(struct setup_context *setup,
+                  struct sp_quad_pipe *qp,
+                  int miny,
+                  int maxy)
+{
+   setup->qp = qp;
+   setup->band_miny = miny;
+   setup->band_maxy = maxy;
+}
+
+
+/**
+ * Called by a rasterizer thread before drawing the triangles binned for
+ * its band, with the cull mode of the context that binned them.
+ */
+void
+sp_setup_begin_band(struct setup_context *setup, unsigned cull_face)
+{
+   setup->cull_face = cull_face;
+
+   setup->qp->first->begin( setup->qp->first );
+}
+
+
+/**
+ * Render the part of a binned triangle that lies in the context's band.
+ */
+void
+sp_setup_band_tri(struct setup_context *setup,
+                  const float (*v0)[4],
+                  const float (*v1)[4],
+                  const float (*v2)[4])
+{
+   float det = calc_det(v0, v1, v2);
+
+   if (setup_sort_vertices( setup, det, v0, v1, v2 ))
+      setup_tri_rasterize( setup );
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
@@ -1446,6 +1568,8 @@ sp_setup_create_context(struct softpipe_context *softpipe)
    unsigned i;
 
    setup->softpipe = softpipe;
+   setup->qp = &softpipe->quad;
+   setup->band_maxy = INT_MAX;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
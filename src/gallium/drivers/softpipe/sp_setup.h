@@ -29,6 +29,7 @@
 
 struct setup_context;
 struct softpipe_context;
+struct sp_quad_pipe;
 
 void 
 sp_setup_tri( struct setup_context *setup,
@@ -48,6 +49,17 @@ sp_setup_point( struct setup_context *setup,
 
 struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
 void sp_setup_prepare( struct setup_context *setup );
+void sp_setup_flush( struct setup_context *setup );
 void sp_setup_destroy_context( struct setup_context *setup );
 
+void sp_setup_set_band( struct setup_context *setup,
+                        struct sp_quad_pipe *qp,
+                        int miny,
+                        int maxy );
+void sp_setup_begin_band( struct setup_context *setup, unsigned cull_face );
+void sp_setup_band_tri( struct setup_context *setup,
+                        const float (*v0)[4],
+                        const float (*v1)[4],
+                        const float (*v2)[4] );
+
 #endif
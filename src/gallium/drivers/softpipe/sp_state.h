@@ -69,6 +69,7 @@ struct sp_fragment_shader_variant_key
 struct sp_fragment_shader_variant
 {
    const struct tgsi_token *tokens;
+   struct tgsi_decoded_shader *decoded;
    struct sp_fragment_shader_variant_key key;
    struct tgsi_shader_info info;
 
@@ -38,6 +38,7 @@
 #include "sp_texture.h"
 #include "sp_tex_sample.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_threads.h"
 
 
 /**
@@ -397,7 +398,10 @@ softpipe_update_derived(struct softpipe_context *softpipe, unsigned prim)
                           SP_NEW_DEPTH_STENCIL_ALPHA |
                           SP_NEW_FRAMEBUFFER |
                           SP_NEW_FS))
-      sp_build_quad_pipeline(softpipe);
+      sp_build_quad_pipeline(softpipe, &softpipe->quad);
+
+   if (softpipe->threads)
+      sp_threads_update_derived(softpipe->threads);
 
    softpipe->dirty = 0;
 }
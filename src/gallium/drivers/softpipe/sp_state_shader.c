@@ -71,7 +71,16 @@ create_fs_variant(struct softpipe_context *softpipe,
       var->tokens = tgsi_dup_tokens(curfs->tokens);
       var->stipple_sampler_unit = unit;
 
-      tgsi_scan_shader(var->tokens, &var->info);
+      /* decoded once, the machine is rebound to it at every draw */
+      var->decoded = var->tokens ? tgsi_decode_shader(var->tokens) : NULL;
+      if (!var->decoded) {
+         var->delete(var, softpipe->fs_machine);
+         var = NULL;
+      }
+   }
+
+   if (var) {
+      tgsi_scan_decoded_shader(var->decoded, &var->info);
 
       /* See comments elsewhere about draw fragment shaders */
 #if 0
@@ -41,7 +41,11 @@
 #include "sp_texture.h"
 #include "sp_tex_tile_cache.h"
 
-   
+
+DEBUG_GET_ONCE_NUM_OPTION(tex_cache_size, "SOFTPIPE_TEX_CACHE_SIZE", NUM_TEX_TILE_ENTRIES)
+DEBUG_GET_ONCE_NUM_OPTION(tex_cache_ways, "SOFTPIPE_TEX_CACHE_WAYS", NUM_TEX_TILE_WAYS)
+DEBUG_GET_ONCE_BOOL_OPTION(tex_cache_stats, "SOFTPIPE_CACHE_STATS", FALSE)
+
 
 struct softpipe_tex_tile_cache *
 sp_create_tex_tile_cache( struct pipe_context *pipe )
@@ -54,8 +58,25 @@ sp_create_tex_tile_cache( struct pipe_context *pipe )
 
    tc = CALLOC_STRUCT( softpipe_tex_tile_cache );
    if (tc) {
+      unsigned num_entries = CLAMP(debug_get_option_tex_cache_size(),
+                                   1, MAX_TEX_TILE_ENTRIES);
+
       tc->pipe = pipe;
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
+      tc->num_ways = CLAMP(debug_get_option_tex_cache_ways(),
+                           1, num_entries);
+      tc->num_sets = num_entries / tc->num_ways;
+      num_entries = tc->num_sets * tc->num_ways;
+
+      tc->entries = CALLOC(num_entries, sizeof(*tc->entries));
+      tc->last_used = CALLOC(num_entries, sizeof(*tc->last_used));
+      if (!tc->entries || !tc->last_used) {
+         FREE(tc->entries);
+         FREE(tc->last_used);
+         FREE(tc);
+         return NULL;
+      }
+
+      for (pos = 0; pos < num_entries; pos++) {
          tc->entries[pos].addr.bits.invalid = 1;
       }
       tc->last_tile = &tc->entries[0]; /* any tile */
@@ -68,11 +89,14 @@ void
 sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
    if (tc) {
-      uint pos;
-
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
+      if (debug_get_option_tex_cache_stats() && tc->lookups) {
+         debug_printf("softpipe: texture cache %u x %u: %llu lookups, "
+                      "%llu misses\n",
+                      tc->num_sets, tc->num_ways,
+                      (unsigned long long) tc->lookups,
+                      (unsigned long long) tc->misses);
       }
+
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
@@ -80,6 +104,8 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
          tc->pipe->transfer_unmap(tc->pipe, tc->tex_trans);
       }
 
+      FREE( tc->entries );
+      FREE( tc->last_used );
       FREE( tc );
    }
 }
@@ -97,7 +123,7 @@ sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
    assert(tc);
    assert(tc->texture);
 
-   for (i = 0; i < Elements(tc->entries); i++) {
+   for (i = 0; i < tc->num_sets * tc->num_ways; i++) {
       tc->entries[i].addr.bits.invalid = 1;
    }
 }
@@ -147,7 +173,7 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 
       /* mark as entries as invalid/empty */
       /* XXX we should try to avoid this when the teximage hasn't changed */
-      for (i = 0; i < Elements(tc->entries); i++) {
+      for (i = 0; i < tc->num_sets * tc->num_ways; i++) {
          tc->entries[i].addr.bits.invalid = 1;
       }
 
@@ -169,7 +195,7 @@ sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 
    if (tc->texture) {
       /* caching a texture, mark all entries as empty */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
+      for (pos = 0; pos < tc->num_sets * tc->num_ways; pos++) {
          tc->entries[pos].addr.bits.invalid = 1;
       }
       tc->tex_face = -1;
@@ -180,21 +206,18 @@ sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 
 /**
  * Given the texture face, level, zslice, x and y values, compute
- * the cache entry position/index where we'd hope to find the
- * cached texture tile.
- * This is basically a direct-map cache.
- * XXX There's probably lots of ways in which we can improve this.
+ * the first cache entry position/index of the set where we'd hope to
+ * find the cached texture tile.
+ * All the address bits are mixed by a multiplicative hash so that
+ * neighbouring tiles, slices and levels spread over the sets.
  */
 static INLINE uint
-tex_cache_pos( union tex_tile_address addr )
+tex_cache_pos( const struct softpipe_tex_tile_cache *tc,
+               union tex_tile_address addr )
 {
-   uint entry = (addr.bits.x + 
-                 addr.bits.y * 9 + 
-                 addr.bits.z * 3 + 
-                 addr.bits.face + 
-                 addr.bits.level * 7);
+   uint entry = (uint) ((addr.value * 0x9E3779B97F4A7C15ULL) >> 32);
 
-   return entry % NUM_TEX_TILE_ENTRIES;
+   return entry % tc->num_sets * tc->num_ways;
 }
 
 /**
@@ -207,11 +230,35 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
 {
    struct softpipe_tex_cached_tile *tile;
    boolean zs = util_format_is_depth_or_stencil(tc->format);
+   const uint first = tex_cache_pos( tc, addr );
+   uint pos, i;
 
-   tile = tc->entries + tex_cache_pos( addr );
+   tc->lookups++;
+
+   /* look for the tile in its set, else take the least recently used
+    * entry, empty entries first
+    */
+   pos = first;
+   for (i = 0; i < tc->num_ways; i++) {
+      const uint p = first + i;
+
+      if (tc->entries[p].addr.value == addr.value) {
+         pos = p;
+         break;
+      }
+      if (!tc->entries[pos].addr.bits.invalid &&
+          (tc->entries[p].addr.bits.invalid ||
+           tc->last_used[p] < tc->last_used[pos]))
+         pos = p;
+   }
+
+   tc->last_used[pos] = ++tc->tick;
+   tile = tc->entries + pos;
 
    if (addr.value != tile->addr.value) {
 
+      tc->misses++;
+
       /* cache miss.  Most misses are because we've invalidated the
        * texture cache previously -- most commonly on binding a new
        * texture.  Currently we effectively flush the cache on texture
@@ -74,12 +74,12 @@ struct softpipe_tex_cached_tile
 };
 
 /*
- * The number of cache entries.
- * Should not be decreased to lower than 16, and even that
- * seems too low to avoid cache thrashing in some cases (because
- * the cache is direct mapped, see tex_cache_pos() function).
+ * Default number of cache entries and of entries per set.  They can be
+ * changed with SOFTPIPE_TEX_CACHE_SIZE and SOFTPIPE_TEX_CACHE_WAYS.
  */
 #define NUM_TEX_TILE_ENTRIES 16
+#define NUM_TEX_TILE_WAYS 4
+#define MAX_TEX_TILE_ENTRIES 256
 
 struct softpipe_tex_tile_cache
 {
@@ -90,7 +90,12 @@ struct softpipe_tex_tile_cache
    struct pipe_resource *texture;  /**< if caching a texture */
    unsigned timestamp;
 
-   struct softpipe_tex_cached_tile entries[NUM_TEX_TILE_ENTRIES];
+   unsigned num_sets, num_ways;
+   struct softpipe_tex_cached_tile *entries;  /**< num_sets * num_ways */
+   unsigned *last_used;  /**< tick of the last lookup of each entry */
+   unsigned tick;
+
+   uint64_t lookups, misses;
 
    struct pipe_transfer *tex_trans;
    void *tex_trans_map;
@@ -229,6 +229,50 @@ softpipe_resource_from_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Create a buffer or single level 2D texture which uses the given user
+ * memory as storage.  Our layout is always tightly packed, so any size
+ * will do.
+ */
+static struct pipe_resource *
+softpipe_resource_from_user_memory(struct pipe_screen *screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory)
+{
+   struct softpipe_resource *spr;
+
+   if (templat->target != PIPE_BUFFER) {
+      if ((templat->target != PIPE_TEXTURE_2D &&
+           templat->target != PIPE_TEXTURE_RECT) ||
+          templat->last_level != 0 ||
+          templat->depth0 != 1 ||
+          templat->array_size != 1 ||
+          (templat->bind & (PIPE_BIND_DISPLAY_TARGET |
+                            PIPE_BIND_SCANOUT |
+                            PIPE_BIND_SHARED)))
+         return NULL;
+   }
+
+   spr = CALLOC_STRUCT(softpipe_resource);
+   if (!spr)
+      return NULL;
+
+   spr->base = *templat;
+   pipe_reference_init(&spr->base.reference, 1);
+   spr->base.screen = screen;
+
+   if (!softpipe_resource_layout(screen, spr, FALSE)) {
+      FREE(spr);
+      return NULL;
+   }
+
+   spr->userBuffer = TRUE;
+   spr->data = user_memory;
+
+   return &spr->base;
+}
+
+
 static boolean
 softpipe_resource_get_handle(struct pipe_screen *screen,
                              struct pipe_resource *pt,
@@ -521,6 +565,7 @@ softpipe_init_screen_texture_funcs(struct pipe_screen *screen)
    screen->resource_create = softpipe_resource_create;
    screen->resource_destroy = softpipe_resource_destroy;
    screen->resource_from_handle = softpipe_resource_from_handle;
+   screen->resource_from_user_memory = softpipe_resource_from_user_memory;
    screen->resource_get_handle = softpipe_resource_get_handle;
    screen->can_create_resource = softpipe_can_create_resource;
 }
@@ -0,0 +1,486 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Rasterizer threads.
+ *
+ * With SOFTPIPE_NUM_THREADS=n, the framebuffer is split into n bands of
+ * tile rows, one per thread, and each triangle is binned to the bands its
+ * bounding box touches.  Only those threads set it up, so most triangles
+ * are set up once.  Each tile belongs to a single thread, which draws the
+ * triangles touching it in submission order, so the results are the same
+ * as without threads.  The bands are contiguous, so a frame with its
+ * geometry in a few rows keeps only some of the threads busy.
+ *
+ * Every thread has its own setup context and quad pipeline, with its own
+ * shader machine, sampler views and tile caches, so the threads don't
+ * write to any shared state.  Their fragment counters are added to the
+ * context's once they are done.
+ *
+ * The threads own the framebuffer between sp_threads_acquire() and
+ * sp_threads_release().  Acquiring writes back the context's tile caches,
+ * releasing writes back the threads' ones.  Anything else touching the
+ * framebuffer (clears, flushes, surface changes, points and lines) releases
+ * first.
+ *
+ * The binned triangles point into the vbuf vertex buffer, so they are drawn
+ * before the vbuf code is done with it, see sp_setup_flush().
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_debug.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+#include "tgsi/tgsi_exec.h"
+#include "sp_context.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_texture.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_tile_cache.h"
+#include "sp_threads.h"
+
+
+struct sp_thread_tri
+{
+   const float (*v[3])[4];
+};
+
+
+struct sp_thread
+{
+   struct sp_threads *threads;
+
+   struct setup_context *setup;
+   struct sp_quad_pipe quad;
+
+   /** Fragment sampler views and their tile caches */
+   struct sp_tgsi_sampler *sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   /** Tile rows of the thread's band, empty if first_row > last_row */
+   int first_row;
+   int last_row;
+
+   /** Triangles touching the thread's band, in submission order */
+   struct sp_thread_tri *tris;
+   unsigned num_tris;
+   unsigned max_tris;
+
+   struct util_queue_fence fence;
+};
+
+
+struct sp_threads
+{
+   struct softpipe_context *softpipe;
+   struct util_queue *queue;
+
+   unsigned cull_face;   /**< of the triangles being drawn */
+   boolean acquired;     /**< the threads' tile caches map the framebuffer */
+
+   unsigned num_threads;
+   struct sp_thread thread[SP_MAX_THREADS];
+};
+
+
+struct sp_threads *
+sp_threads_create(struct softpipe_context *sp)
+{
+   unsigned num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   struct sp_threads *threads;
+   unsigned i, j;
+
+   if (num_threads == 0)
+      return NULL;
+
+   threads = CALLOC_STRUCT(sp_threads);
+   if (!threads)
+      return NULL;
+
+   threads->softpipe = sp;
+   threads->queue = util_queue_ref_shared();
+   if (!threads->queue)
+      goto fail;
+
+   num_threads = MIN2(num_threads, SP_MAX_THREADS);
+
+   for (i = 0; i < num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      thread->threads = threads;
+      util_queue_fence_init(&thread->fence);
+      threads->num_threads++;
+
+      if (!sp_quad_pipe_init(&thread->quad, sp))
+         goto fail;
+
+      thread->quad.fs_machine = tgsi_exec_machine_create();
+      if (!thread->quad.fs_machine)
+         goto fail;
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         thread->quad.cbuf_cache[j] = sp_create_tile_cache(&sp->pipe);
+         if (!thread->quad.cbuf_cache[j])
+            goto fail;
+      }
+
+      thread->quad.zsbuf_cache = sp_create_tile_cache(&sp->pipe);
+      if (!thread->quad.zsbuf_cache)
+         goto fail;
+
+      thread->quad.occlusion_count = &thread->occlusion_count;
+      thread->quad.ps_invocations = &thread->ps_invocations;
+
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         thread->tex_cache[j] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!thread->tex_cache[j])
+            goto fail;
+      }
+
+      thread->sampler = sp_create_tgsi_sampler();
+      if (!thread->sampler)
+         goto fail;
+
+      thread->setup = sp_setup_create_context(sp);
+      if (!thread->setup)
+         goto fail;
+
+      /* the bands are set when the framebuffer is acquired */
+      thread->first_row = 0;
+      thread->last_row = -1;
+      sp_setup_set_band(thread->setup, &thread->quad, 0, 0);
+   }
+
+   return threads;
+
+fail:
+   sp_threads_destroy(threads);
+   return NULL;
+}
+
+
+void
+sp_threads_destroy(struct sp_threads *threads)
+{
+   unsigned i, j;
+
+   sp_threads_release(threads);
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      if (thread->setup)
+         sp_setup_destroy_context(thread->setup);
+
+      sp_quad_pipe_destroy(&thread->quad);
+      tgsi_exec_machine_destroy(thread->quad.fs_machine);
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         sp_destroy_tile_cache(thread->quad.cbuf_cache[j]);
+      sp_destroy_tile_cache(thread->quad.zsbuf_cache);
+
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         if (thread->tex_cache[j]) {
+            /* drop the texture reference */
+            sp_tex_tile_cache_set_sampler_view(thread->tex_cache[j], NULL);
+            sp_destroy_tex_tile_cache(thread->tex_cache[j]);
+         }
+      }
+
+      FREE(thread->sampler);
+      FREE(thread->tris);
+      util_queue_fence_destroy(&thread->fence);
+   }
+
+   if (threads->queue)
+      util_queue_unref_shared(threads->queue);
+
+   FREE(threads);
+}
+
+
+/**
+ * Bring the threads' quad pipelines, shader machines and samplers up to
+ * date.  Called at the end of softpipe_update_derived().
+ */
+void
+sp_threads_update_derived(struct sp_threads *threads)
+{
+   struct softpipe_context *sp = threads->softpipe;
+   const struct sp_tgsi_sampler *sampler =
+      sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i, j;
+
+   if (!sp->fs_variant || !sp->depth_stencil)
+      return;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      sp_build_quad_pipeline(sp, &thread->quad);
+
+      /* The views double as scratch space while sampling, so each thread
+       * samples through copies of its own.
+       */
+      memcpy(thread->sampler, sampler, sizeof(*sampler));
+
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         struct softpipe_tex_tile_cache *tc = thread->tex_cache[j];
+         struct pipe_sampler_view *view =
+            sp->sampler_views[PIPE_SHADER_FRAGMENT][j];
+
+         sp_tex_tile_cache_set_sampler_view(tc, view);
+         if (tc->texture) {
+            struct softpipe_resource *spt = softpipe_resource(tc->texture);
+            if (spt->timestamp != tc->timestamp) {
+               sp_tex_tile_cache_validate_texture(tc);
+               tc->timestamp = spt->timestamp;
+            }
+         }
+
+         if (view)
+            thread->sampler->sp_sview[j].cache = tc;
+      }
+
+      sp->fs_variant->prepare(sp->fs_variant, thread->quad.fs_machine,
+                              &thread->sampler->base);
+   }
+}
+
+
+/**
+ * Hand the framebuffer over to the threads.
+ */
+void
+sp_threads_acquire(struct sp_threads *threads)
+{
+   struct softpipe_context *sp = threads->softpipe;
+   const struct pipe_framebuffer_state *fb = &sp->framebuffer;
+   const int num_rows = (fb->height + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+   const int n = threads->num_threads;
+   int i;
+   unsigned j;
+
+   if (threads->acquired)
+      return;
+
+   /* write back the context's tiles, and its pending clears */
+   for (j = 0; j < fb->nr_cbufs; j++)
+      sp_flush_tile_cache(sp->cbuf_cache[j]);
+   sp_flush_tile_cache(sp->zsbuf_cache);
+
+   for (i = 0; i < n; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      thread->first_row = i * num_rows / n;
+      thread->last_row = (i + 1) * num_rows / n - 1;
+      sp_setup_set_band(thread->setup, &thread->quad,
+                        thread->first_row << TILE_SIZE_LOG2,
+                        (thread->last_row + 1) << TILE_SIZE_LOG2);
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         sp_tile_cache_set_surface(thread->quad.cbuf_cache[j],
+                                   j < fb->nr_cbufs ? fb->cbufs[j] : NULL);
+      }
+      sp_tile_cache_set_surface(thread->quad.zsbuf_cache, fb->zsbuf);
+   }
+
+   threads->acquired = TRUE;
+}
+
+
+static void
+sp_thread_flush_tile_caches(void *job, unsigned thread_index)
+{
+   struct sp_thread *thread = (struct sp_thread *) job;
+   unsigned j;
+
+   for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+      sp_flush_tile_cache(thread->quad.cbuf_cache[j]);
+   sp_flush_tile_cache(thread->quad.zsbuf_cache);
+}
+
+
+/**
+ * Write back the threads' tiles and give the framebuffer back to the
+ * context.
+ */
+void
+sp_threads_release(struct sp_threads *threads)
+{
+   unsigned i, j;
+
+   if (!threads->acquired)
+      return;
+
+   /* the tiles of different threads never overlap */
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      util_queue_add_job(threads->queue, thread, &thread->fence,
+                         sp_thread_flush_tile_caches,
+                         UTIL_QUEUE_PRIORITY_HIGH);
+   }
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      util_queue_fence_wait(&thread->fence);
+
+      /* unmapping goes through the context, so it's done here */
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         sp_tile_cache_set_surface(thread->quad.cbuf_cache[j], NULL);
+      sp_tile_cache_set_surface(thread->quad.zsbuf_cache, NULL);
+   }
+
+   threads->acquired = FALSE;
+}
+
+
+void
+sp_threads_flush_tex_caches(struct sp_threads *threads)
+{
+   unsigned i, j;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++)
+         sp_flush_tex_tile_cache(threads->thread[i].tex_cache[j]);
+   }
+}
+
+
+/**
+ * Queue a triangle for the threads whose bands touch tile rows first_row to
+ * last_row.
+ */
+void
+sp_threads_bin_tri(struct sp_threads *threads,
+                   unsigned cull_face,
+                   unsigned first_row,
+                   unsigned last_row,
+                   const float (*v0)[4],
+                   const float (*v1)[4],
+                   const float (*v2)[4])
+{
+   unsigned i;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+      struct sp_thread_tri *tri;
+
+      if (thread->first_row > thread->last_row ||
+          (int) last_row < thread->first_row ||
+          (int) first_row > thread->last_row)
+         continue;
+
+      if (thread->num_tris == thread->max_tris) {
+         unsigned max_tris = MAX2(thread->max_tris * 2, 256);
+         struct sp_thread_tri *tris =
+            REALLOC(thread->tris,
+                    thread->max_tris * sizeof(*tris),
+                    max_tris * sizeof(*tris));
+         if (!tris) {
+            /* Out of memory: draw what's binned, then the triangle itself.
+             * The threads are idle once sp_threads_rasterize() returns.
+             */
+            sp_threads_rasterize(threads, cull_face);
+            sp_setup_begin_band(thread->setup, cull_face);
+            sp_setup_band_tri(thread->setup, v0, v1, v2);
+            continue;
+         }
+
+         thread->tris = tris;
+         thread->max_tris = max_tris;
+      }
+
+      tri = &thread->tris[thread->num_tris++];
+      tri->v[0] = v0;
+      tri->v[1] = v1;
+      tri->v[2] = v2;
+   }
+}
+
+
+static void
+sp_thread_rasterize(void *job, unsigned thread_index)
+{
+   struct sp_thread *thread = (struct sp_thread *) job;
+   unsigned i;
+
+   sp_setup_begin_band(thread->setup, thread->threads->cull_face);
+
+   for (i = 0; i < thread->num_tris; i++) {
+      const struct sp_thread_tri *tri = &thread->tris[i];
+
+      sp_setup_band_tri(thread->setup, tri->v[0], tri->v[1], tri->v[2]);
+   }
+}
+
+
+/**
+ * Draw the binned triangles, and wait for them.
+ */
+void
+sp_threads_rasterize(struct sp_threads *threads, unsigned cull_face)
+{
+   struct softpipe_context *sp = threads->softpipe;
+   unsigned i;
+
+   /* computed on first use, so make sure it's not done by the threads */
+   (void) softpipe_get_vertex_info(sp);
+
+   threads->cull_face = cull_face;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      if (thread->num_tris) {
+         util_queue_add_job(threads->queue, thread, &thread->fence,
+                            sp_thread_rasterize,
+                            UTIL_QUEUE_PRIORITY_HIGH);
+      }
+   }
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_thread *thread = &threads->thread[i];
+
+      if (thread->num_tris) {
+         util_queue_fence_wait(&thread->fence);
+         thread->num_tris = 0;
+      }
+
+      sp->occlusion_count += thread->occlusion_count;
+      sp->pipeline_statistics.ps_invocations += thread->ps_invocations;
+      thread->occlusion_count = 0;
+      thread->ps_invocations = 0;
+   }
+}
@@ -0,0 +1,68 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef SP_THREADS_H
+#define SP_THREADS_H
+
+
+struct softpipe_context;
+struct sp_threads;
+
+
+/** Max number of rasterizer threads */
+#define SP_MAX_THREADS 16
+
+
+struct sp_threads *
+sp_threads_create(struct softpipe_context *sp);
+
+void
+sp_threads_destroy(struct sp_threads *threads);
+
+void
+sp_threads_update_derived(struct sp_threads *threads);
+
+void
+sp_threads_acquire(struct sp_threads *threads);
+
+void
+sp_threads_release(struct sp_threads *threads);
+
+void
+sp_threads_flush_tex_caches(struct sp_threads *threads);
+
+void
+sp_threads_bin_tri(struct sp_threads *threads,
+                   unsigned cull_face,
+                   unsigned first_row,
+                   unsigned last_row,
+                   const float (*v0)[4],
+                   const float (*v1)[4],
+                   const float (*v2)[4]);
+
+void
+sp_threads_rasterize(struct sp_threads *threads, unsigned cull_face);
+
+
+#endif /* SP_THREADS_H */
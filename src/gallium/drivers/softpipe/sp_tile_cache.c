@@ -35,6 +35,7 @@
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_memory.h"
+#include "util/u_surface.h"
 #include "util/u_tile.h"
 #include "sp_tile_cache.h"
 
@@ -42,14 +43,20 @@ static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
+DEBUG_GET_ONCE_NUM_OPTION(tile_cache_size, "SOFTPIPE_TILE_CACHE_SIZE", NUM_ENTRIES)
+DEBUG_GET_ONCE_NUM_OPTION(tile_cache_ways, "SOFTPIPE_TILE_CACHE_WAYS", NUM_WAYS)
+DEBUG_GET_ONCE_BOOL_OPTION(cache_stats, "SOFTPIPE_CACHE_STATS", FALSE)
+
+
 /**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
+ * Return the first cache position of the set holding the tile at addr.
+ * Neighbouring tiles go to different sets.
  */
-#define CACHE_POS(x, y) \
-   (((x) + (y) * 5) % NUM_ENTRIES)
+static INLINE unsigned
+cache_set(const struct softpipe_tile_cache *tc, union tile_address addr)
+{
+   return (addr.bits.x + addr.bits.y * 5) % tc->num_sets * tc->num_ways;
+}
 
 
 
@@ -98,22 +105,39 @@ sp_create_tile_cache( struct pipe_context *pipe )
 
    tc = CALLOC_STRUCT( softpipe_tile_cache );
    if (tc) {
+      unsigned num_entries = CLAMP(debug_get_option_tile_cache_size(),
+                                   1, MAX_ENTRIES);
+
       tc->pipe = pipe;
-      for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
-         tc->tile_addrs[pos].bits.invalid = 1;
-      }
-      tc->last_tile_addr.bits.invalid = 1;
+      tc->num_ways = CLAMP(debug_get_option_tile_cache_ways(),
+                           1, num_entries);
+      tc->num_sets = num_entries / tc->num_ways;
+      num_entries = tc->num_sets * tc->num_ways;
+
+      tc->tile_addrs = CALLOC(num_entries, sizeof(*tc->tile_addrs));
+      tc->entries = CALLOC(num_entries, sizeof(*tc->entries));
+      tc->last_used = CALLOC(num_entries, sizeof(*tc->last_used));
 
       /* this allocation allows us to guarantee that allocation
        * failures are never fatal later
        */
       tc->tile = MALLOC_STRUCT( softpipe_cached_tile );
-      if (!tc->tile)
+
+      if (!tc->tile_addrs || !tc->entries || !tc->last_used || !tc->tile)
       {
+         FREE(tc->tile_addrs);
+         FREE(tc->entries);
+         FREE(tc->last_used);
+         FREE(tc->tile);
          FREE(tc);
          return NULL;
       }
 
+      for (pos = 0; pos < num_entries; pos++) {
+         tc->tile_addrs[pos].bits.invalid = 1;
+      }
+      tc->last_tile_addr.bits.invalid = 1;
+
       /* XXX this code prevents valgrind warnings about use of uninitialized
        * memory in programs that don't clear the surface before rendering.
        * However, it breaks clearing in other situations (such as in
@@ -132,13 +156,29 @@ void
 sp_destroy_tile_cache(struct softpipe_tile_cache *tc)
 {
    if (tc) {
+      const struct softpipe_tile_cache_stats *stats = &tc->stats;
       uint pos;
 
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
+      if (debug_get_option_cache_stats() && stats->lookups) {
+         debug_printf("softpipe: tile cache %u x %u: %llu lookups, "
+                      "%llu misses, %llu writebacks, %llu cleared, "
+                      "%llu flushed\n",
+                      tc->num_sets, tc->num_ways,
+                      (unsigned long long) stats->lookups,
+                      (unsigned long long) stats->misses,
+                      (unsigned long long) stats->writebacks,
+                      (unsigned long long) stats->clears,
+                      (unsigned long long) stats->flushes);
+      }
+
+      for (pos = 0; pos < tc->num_sets * tc->num_ways; pos++) {
          /*assert(tc->entries[pos].x < 0);*/
          FREE( tc->entries[pos] );
       }
       FREE( tc->tile );
+      FREE( tc->tile_addrs );
+      FREE( tc->entries );
+      FREE( tc->last_used );
 
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
@@ -314,8 +354,12 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
    const uint h = tc->transfer->box.height;
    uint x, y;
    uint numCleared = 0;
+   uint x0 = 0, y0 = 0, w0 = 0, h0 = 0;
 
    assert(pt->resource);
+   if (!tc->clear_pending)
+      return;
+
    if (!tc->tile)
       tc->tile = sp_alloc_tile(tc);
 
@@ -332,8 +376,17 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
          union tile_address addr = tile_address(x, y);
 
          if (is_clear_flag_set(tc->clear_flags, addr)) {
+            const uint tw = MIN2(TILE_SIZE, w - x);
+            const uint th = MIN2(TILE_SIZE, h - y);
+
+            if (tw <= w0 && th <= h0) {
+               /* copy the first tile written, no need to convert again */
+               util_copy_rect(tc->transfer_map, pt->resource->format,
+                              pt->stride, x, y, tw, th,
+                              tc->transfer_map, pt->stride, x0, y0);
+            }
             /* write the scratch tile to the surface */
-            if (tc->depth_stencil) {
+            else if (tc->depth_stencil) {
                pipe_put_tile_raw(pt, tc->transfer_map,
                                  x, y, TILE_SIZE, TILE_SIZE,
                                  tc->tile->data.any, 0/*STRIDE*/);
@@ -355,6 +408,13 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
                                      (float *) tc->tile->data.color);
                }
             }
+
+            if (tw * th > w0 * h0) {
+               x0 = x;
+               y0 = y;
+               w0 = tw;
+               h0 = th;
+            }
             numCleared++;
          }
       }
@@ -362,6 +422,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
 
    /* reset all clear flags to zero */
    memset(tc->clear_flags, 0, sizeof(tc->clear_flags));
+   tc->clear_pending = FALSE;
 
 #if 0
    debug_printf("num cleared: %u\n", numCleared);
@@ -372,6 +433,7 @@ static void
 sp_flush_tile(struct softpipe_tile_cache* tc, unsigned pos)
 {
    if (!tc->tile_addrs[pos].bits.invalid) {
+      tc->stats.flushes++;
       if (tc->depth_stencil) {
          pipe_put_tile_raw(tc->transfer, tc->transfer_map,
                            tc->tile_addrs[pos].bits.x * TILE_SIZE,
@@ -419,7 +481,7 @@ sp_flush_tile_cache(struct softpipe_tile_cache *tc)
 
    if (pt) {
       /* caching a drawing transfer */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
+      for (pos = 0; pos < tc->num_sets * tc->num_ways; pos++) {
          struct softpipe_cached_tile *tile = tc->entries[pos];
          if (!tile)
          {
@@ -452,7 +514,7 @@ sp_alloc_tile(struct softpipe_tile_cache *tc)
       if (!tc->tile)
       {
          unsigned pos;
-         for (pos = 0; pos < Elements(tc->entries); ++pos) {
+         for (pos = 0; pos < tc->num_sets * tc->num_ways; ++pos) {
             if (!tc->entries[pos])
                continue;
 
@@ -484,11 +546,32 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
                     union tile_address addr )
 {
    struct pipe_transfer *pt = tc->transfer;
-   /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y);
-   struct softpipe_cached_tile *tile = tc->entries[pos];
+   const unsigned first = cache_set(tc, addr);
+   struct softpipe_cached_tile *tile;
+   unsigned pos, i;
+
+   tc->stats.lookups++;
+
+   /* look for the tile in its set, else pick the least recently used way,
+    * empty ways first
+    */
+   pos = first;
+   for (i = 0; i < tc->num_ways; i++) {
+      const unsigned p = first + i;
+
+      if (tc->tile_addrs[p].value == addr.value) {
+         pos = p;
+         break;
+      }
+      if (!tc->tile_addrs[pos].bits.invalid &&
+          (tc->tile_addrs[p].bits.invalid ||
+           tc->last_used[p] < tc->last_used[pos]))
+         pos = p;
+   }
+
+   tc->last_used[pos] = ++tc->tick;
 
+   tile = tc->entries[pos];
    if (!tile) {
       tile = sp_alloc_tile(tc);
       tc->entries[pos] = tile;
@@ -496,9 +579,12 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 
    if (addr.value != tc->tile_addrs[pos].value) {
 
+      tc->stats.misses++;
+
       assert(pt->resource);
       if (tc->tile_addrs[pos].bits.invalid == 0) {
          /* put dirty tile back in framebuffer */
+         tc->stats.writebacks++;
          if (tc->depth_stencil) {
             pipe_put_tile_raw(pt, tc->transfer_map,
                               tc->tile_addrs[pos].bits.x * TILE_SIZE,
@@ -536,6 +622,7 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 
       if (is_clear_flag_set(tc->clear_flags, addr)) {
          /* don't get tile from framebuffer, just clear it */
+         tc->stats.clears++;
          if (tc->depth_stencil) {
             clear_tile(tile, pt->resource->format, tc->clear_val);
          }
@@ -608,8 +695,9 @@ sp_tile_cache_clear(struct softpipe_tile_cache *tc,
    /* set flags to indicate all the tiles are cleared */
    memset(tc->clear_flags, 255, sizeof(tc->clear_flags));
 
-   for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
+   for (pos = 0; pos < tc->num_sets * tc->num_ways; pos++) {
       tc->tile_addrs[pos].bits.invalid = 1;
    }
    tc->last_tile_addr.bits.invalid = 1;
+   tc->clear_pending = TRUE;
 }
@@ -75,7 +75,24 @@ struct softpipe_cached_tile
    } data;
 };
 
-#define NUM_ENTRIES 50
+/**
+ * Default number of cache entries, and of entries per set.  They can be
+ * changed with SOFTPIPE_TILE_CACHE_SIZE and SOFTPIPE_TILE_CACHE_WAYS.
+ * Tiles are only allocated when first used.
+ */
+#define NUM_ENTRIES 64
+#define NUM_WAYS 4
+#define MAX_ENTRIES 1024
+
+
+struct softpipe_tile_cache_stats
+{
+   uint64_t lookups;     /**< sp_find_cached_tile() calls */
+   uint64_t misses;      /**< lookups not finding the tile */
+   uint64_t writebacks;  /**< dirty tiles written back on eviction */
+   uint64_t clears;      /**< misses on a cleared tile, not read back */
+   uint64_t flushes;     /**< tiles written back by sp_flush_tile_cache() */
+};
 
 
 struct softpipe_tile_cache
@@ -85,9 +102,16 @@ struct softpipe_tile_cache
    struct pipe_transfer *transfer;
    void *transfer_map;
 
-   union tile_address tile_addrs[NUM_ENTRIES];
-   struct softpipe_cached_tile *entries[NUM_ENTRIES];
+   /** The cache is num_sets sets of num_ways entries, LRU replacement */
+   unsigned num_sets;
+   unsigned num_ways;
+   union tile_address *tile_addrs;
+   struct softpipe_cached_tile **entries;
+   unsigned *last_used;
+   unsigned tick;
+
    uint clear_flags[(MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE) / 32];
+   boolean clear_pending; /**< Are any clear_flags set? */
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
    boolean depth_stencil; /**< Is the surface a depth/stencil format? */
@@ -96,6 +120,8 @@ struct softpipe_tile_cache
 
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
+
+   struct softpipe_tile_cache_stats stats;
 };
 
 
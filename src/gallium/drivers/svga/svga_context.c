@@ -30,7 +30,9 @@
 #include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_bitmask.h"
+#include "util/u_hash_table.h"
 #include "util/u_upload_mgr.h"
+#include "tgsi/tgsi_parse.h"
 
 #include "svga_context.h"
 #include "svga_screen.h"
@@ -51,6 +53,29 @@ DEBUG_GET_ONCE_NUM_OPTION(disable_shader, "SVGA_DISABLE_SHADER", ~0);
 DEBUG_GET_ONCE_BOOL_OPTION(no_line_width, "SVGA_NO_LINE_WIDTH", FALSE);
 DEBUG_GET_ONCE_BOOL_OPTION(force_hw_line_stipple, "SVGA_FORCE_HW_LINE_STIPPLE", FALSE);
 
+static unsigned
+svga_shader_key_hash(void *key)
+{
+   const struct svga_shader *shader = key;
+
+   return (unsigned) (shader->hash ^ (shader->hash >> 32));
+}
+
+static int
+svga_shader_key_compare(void *key1, void *key2)
+{
+   const struct svga_shader *shader1 = key1;
+   const struct svga_shader *shader2 = key2;
+   const unsigned num_tokens = tgsi_num_tokens(shader1->tokens);
+
+   if (shader1->hash != shader2->hash ||
+       num_tokens != tgsi_num_tokens(shader2->tokens))
+      return 1;
+
+   return memcmp(shader1->tokens, shader2->tokens,
+                 num_tokens * sizeof(struct tgsi_token));
+}
+
 static void svga_destroy( struct pipe_context *pipe )
 {
    struct svga_context *svga = svga_context( pipe );
@@ -75,6 +100,8 @@ static void svga_destroy( struct pipe_context *pipe )
    util_bitmask_destroy( svga->vs_bm );
    util_bitmask_destroy( svga->fs_bm );
 
+   util_hash_table_destroy( svga->shaders );
+
    for(shader = 0; shader < PIPE_SHADER_TYPES; ++shader)
       pipe_resource_reference( &svga->curr.cb[shader], NULL );
 
@@ -136,6 +163,11 @@ struct pipe_context *svga_context_create( struct pipe_screen *screen,
    if (svga->vs_bm == NULL)
       goto no_vs_bm;
 
+   svga->shaders = util_hash_table_create(svga_shader_key_hash,
+                                          svga_shader_key_compare);
+   if (svga->shaders == NULL)
+      goto no_shaders;
+
    svga->upload_ib = u_upload_create( &svga->pipe,
                                       32 * 1024,
                                       16,
@@ -188,6 +220,8 @@ no_hwtnl:
 no_upload_vb:
    u_upload_destroy( svga->upload_ib );
 no_upload_ib:
+   util_hash_table_destroy( svga->shaders );
+no_shaders:
    util_bitmask_destroy( svga->vs_bm );
 no_vs_bm:
    util_bitmask_destroy( svga->fs_bm );
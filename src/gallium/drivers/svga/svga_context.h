@@ -53,17 +53,22 @@ struct draw_fragment_shader;
 struct svga_shader_result;
 struct SVGACmdMemory;
 struct util_bitmask;
+struct util_hash_table;
 struct u_upload_mgr;
 
 
 struct svga_shader
 {
    const struct tgsi_token *tokens;
+   uint64_t hash;  /**< tgsi_hash_tokens() of tokens */
 
    struct tgsi_shader_info info;
 
    struct svga_shader_result *results;
 
+   /** Number of create_xs_state() calls this shader was returned for */
+   unsigned refcount;
+
    unsigned id;  /**< for debugging only */
 };
 
@@ -260,6 +265,10 @@ struct svga_hw_clear_state
    struct {
       float zmin, zmax;
    } depthrange;
+
+   struct {
+      unsigned x,y,w,h;
+   } scissor;
    
    struct pipe_framebuffer_state framebuffer;
    struct svga_prescale prescale;
@@ -281,6 +290,7 @@ struct svga_hw_draw_state
    unsigned rs[SVGA3D_RS_MAX];
    unsigned ts[SVGA3D_PIXEL_SAMPLERREG_MAX][SVGA3D_TS_MAX];
    float cb[PIPE_SHADER_TYPES][SVGA3D_CONSTREG_MAX][4];
+   float clip_planes[SVGA3D_MAX_CLIP_PLANES][4];
 
    struct svga_shader_result *fs;
    struct svga_shader_result *vs;
@@ -347,6 +357,12 @@ struct svga_context
    struct util_bitmask *fs_bm;
    struct util_bitmask *vs_bm;
 
+   /**
+    * Live shaders by their tokens, so that creating a shader identical to a
+    * live one returns the live one and its host shaders.
+    */
+   struct util_hash_table *shaders;
+
    struct {
       unsigned dirty[SVGA_STATE_MAX];
 
@@ -128,6 +128,35 @@ void svga_hwtnl_vdecl( struct svga_hwtnl *hwtnl,
 }
 
 
+/**
+ * Determine whether setting these vertex declarations would change the
+ * current ones.  Declarations without a buffer are left alone by the
+ * caller and therefore not compared.
+ */
+boolean
+svga_hwtnl_vdecls_changed( struct svga_hwtnl *hwtnl,
+                           unsigned count,
+                           const SVGA3dVertexDecl *decls,
+                           struct pipe_resource **vbs )
+{
+   unsigned i;
+
+   if (count != hwtnl->cmd.vdecl_count)
+      return TRUE;
+
+   for (i = 0; i < count; i++) {
+      if (!vbs[i])
+         continue;
+
+      if (vbs[i] != hwtnl->cmd.vdecl_vb[i] ||
+          memcmp(&decls[i], &hwtnl->cmd.vdecl[i], sizeof(decls[i])) != 0)
+         return TRUE;
+   }
+
+   return FALSE;
+}
+
+
 /**
  * Determine whether the specified buffer is referred in the primitive queue,
  * for which no commands have been written yet.
@@ -287,6 +316,83 @@ void svga_hwtnl_set_index_bias( struct svga_hwtnl *hwtnl,
  * Internal functions:
  */
 
+/**
+ * Number of vertices used by a range, when it is a list primitive.
+ * Ranges of other types can't be concatenated.
+ */
+static unsigned
+list_vertex_count( const SVGA3dPrimitiveRange *range )
+{
+   switch (range->primType) {
+   case SVGA3D_PRIMITIVE_POINTLIST:
+      return range->primitiveCount;
+   case SVGA3D_PRIMITIVE_LINELIST:
+      return range->primitiveCount * 2;
+   case SVGA3D_PRIMITIVE_TRIANGLELIST:
+      return range->primitiveCount * 3;
+   default:
+      return 0;
+   }
+}
+
+
+/**
+ * Try to append the range to the last queued one.  This happens when the
+ * same list is drawn with several consecutive draw calls, or when only
+ * redundant state was set in between.
+ */
+static boolean
+merge_prim( struct svga_hwtnl *hwtnl,
+            const SVGA3dPrimitiveRange *range,
+            int index_bias,
+            unsigned min_index,
+            unsigned max_index,
+            struct pipe_resource *ib )
+{
+   unsigned last = hwtnl->cmd.prim_count - 1;
+   SVGA3dPrimitiveRange *prev;
+   unsigned prev_count;
+
+   if (!hwtnl->cmd.prim_count)
+      return FALSE;
+
+   prev = &hwtnl->cmd.prim[last];
+   prev_count = list_vertex_count(prev);
+
+   if (!prev_count ||
+       prev->primType != range->primType ||
+       hwtnl->cmd.prim_ib[last] != ib)
+      return FALSE;
+
+   if (ib) {
+      /* the indices must follow each other in the same buffer */
+      if (prev->indexWidth != range->indexWidth ||
+          prev->indexArray.stride != range->indexArray.stride ||
+          prev->indexBias != index_bias ||
+          prev->indexArray.offset + prev_count * prev->indexWidth !=
+          range->indexArray.offset)
+         return FALSE;
+
+      hwtnl->cmd.min_index[last] = MIN2(hwtnl->cmd.min_index[last],
+                                        min_index);
+      hwtnl->cmd.max_index[last] = MAX2(hwtnl->cmd.max_index[last],
+                                        max_index);
+   }
+   else {
+      /* the vertices must follow each other */
+      if (prev->indexBias + (int) prev_count != index_bias)
+         return FALSE;
+
+      hwtnl->cmd.max_index[last] = MAX2(hwtnl->cmd.max_index[last],
+                                        prev_count + max_index);
+   }
+
+   prev->primitiveCount += range->primitiveCount;
+
+   return TRUE;
+}
+
+
 enum pipe_error svga_hwtnl_prim( struct svga_hwtnl *hwtnl,
                                  const SVGA3dPrimitiveRange *range,
                                  unsigned min_index,
@@ -421,6 +527,10 @@ enum pipe_error svga_hwtnl_prim( struct svga_hwtnl *hwtnl,
    }
 #endif
 
+   if (merge_prim( hwtnl, range, range->indexBias + hwtnl->index_bias,
+                   min_index, max_index, ib ))
+      return PIPE_OK;
+
    if (hwtnl->cmd.prim_count+1 >= QSZ) {
       ret = svga_hwtnl_flush( hwtnl );
       if (ret != PIPE_OK)
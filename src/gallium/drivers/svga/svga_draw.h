@@ -58,6 +58,12 @@ void svga_hwtnl_vdecl( struct svga_hwtnl *hwtnl,
 void svga_hwtnl_reset_vdecl( struct svga_hwtnl *hwtnl,
                              unsigned count );
 
+boolean
+svga_hwtnl_vdecls_changed( struct svga_hwtnl *hwtnl,
+                           unsigned count,
+                           const SVGA3dVertexDecl *decls,
+                           struct pipe_resource **vbs );
+
 
 enum pipe_error 
 svga_hwtnl_draw_arrays( struct svga_hwtnl *hwtnl,
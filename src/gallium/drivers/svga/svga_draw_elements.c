@@ -33,6 +33,7 @@
 #include "svga_resource_buffer.h"
 #include "svga_winsys.h"
 #include "svga_context.h"
+#include "svga_screen.h"
 #include "svga_hw_reg.h"
 
 
@@ -46,12 +47,31 @@ translate_indices( struct svga_hwtnl *hwtnl,
                    struct pipe_resource **out_buf )
 {
    struct pipe_context *pipe = &hwtnl->svga->pipe;
+   struct svga_buffer *sbuf = svga_buffer(src);
    struct pipe_transfer *src_transfer = NULL;
    struct pipe_transfer *dst_transfer = NULL;
    unsigned size = index_size * nr;
    const void *src_map = NULL;
    struct pipe_resource *dst = NULL;
    void *dst_map = NULL;
+   boolean cache;
+
+   /* Static index buffers tend to be drawn with the same range over and
+    * over, so keep their last translation.
+    */
+   cache = svga_screen(pipe->screen)->cache_translated_indices &&
+           !svga_buffer_is_user_buffer(src) &&
+           (src->usage == PIPE_USAGE_STATIC ||
+            src->usage == PIPE_USAGE_IMMUTABLE);
+
+   if (cache &&
+       sbuf->translated.buffer &&
+       sbuf->translated.translate == translate &&
+       sbuf->translated.offset == offset &&
+       sbuf->translated.nr == nr) {
+      pipe_resource_reference( out_buf, sbuf->translated.buffer );
+      return PIPE_OK;
+   }
 
    dst = pipe_buffer_create( pipe->screen,
 			     PIPE_BIND_INDEX_BUFFER,
@@ -75,6 +95,13 @@ translate_indices( struct svga_hwtnl *hwtnl,
    pipe_buffer_unmap( pipe, src_transfer );
    pipe_buffer_unmap( pipe, dst_transfer );
 
+   if (cache) {
+      pipe_resource_reference( &sbuf->translated.buffer, dst );
+      sbuf->translated.translate = translate;
+      sbuf->translated.offset = offset;
+      sbuf->translated.nr = nr;
+   }
+
    *out_buf = dst;
    return PIPE_OK;
 
@@ -213,11 +240,8 @@ svga_hwtnl_draw_range_elements( struct svga_hwtnl *hwtnl,
       struct pipe_resource *gen_buf = NULL;
 
       /* Need to allocate a new index buffer and run the translate
-       * func to populate it.  Could potentially cache this translated
-       * index buffer with the original to avoid future
-       * re-translations.  Not much point if we're just accelerating
-       * GL though, as index buffers are typically used only once
-       * there.
+       * func to populate it, unless translate_indices() still has the
+       * translation of a static index buffer.
        */
       ret = translate_indices( hwtnl,
                                index_buffer,
@@ -27,6 +27,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_bitmask.h"
+#include "util/u_hash_table.h"
 #include "tgsi/tgsi_parse.h"
 #include "draw/draw_context.h"
 
@@ -43,12 +44,24 @@ svga_create_fs_state(struct pipe_context *pipe,
 {
    struct svga_context *svga = svga_context(pipe);
    struct svga_fragment_shader *fs;
+   struct svga_shader key;
+
+   /* share the shader, and its host shaders, with an identical live one */
+   key.tokens = templ->tokens;
+   key.hash = tgsi_shader_state_hash(templ);
+   fs = util_hash_table_get(svga->shaders, &key);
+   if (fs) {
+      fs->base.refcount++;
+      return fs;
+   }
 
    fs = CALLOC_STRUCT(svga_fragment_shader);
    if (!fs)
       return NULL;
 
    fs->base.tokens = tgsi_dup_tokens(templ->tokens);
+   fs->base.hash = key.hash;
+   fs->base.refcount = 1;
 
    /* Collect basic info that we'll need later:
     */
@@ -62,6 +75,9 @@ svga_create_fs_state(struct pipe_context *pipe,
 
    fs->draw_shader = draw_create_fragment_shader(svga->swtnl.draw, templ);
 
+   if (fs->base.tokens)
+      util_hash_table_set(svga->shaders, &fs->base, fs);
+
    if (SVGA_DEBUG & DEBUG_TGSI || 0) {
       debug_printf("%s id: %u, inputs: %u, outputs: %u\n",
                    __FUNCTION__, fs->base.id,
@@ -91,6 +107,12 @@ svga_delete_fs_state(struct pipe_context *pipe, void *shader)
    struct svga_shader_result *result, *tmp;
    enum pipe_error ret;
 
+   if (--fs->base.refcount)
+      return;
+
+   if (util_hash_table_get(svga->shaders, &fs->base) == fs)
+      util_hash_table_remove(svga->shaders, &fs->base);
+
    svga_hwtnl_flush_retry(svga);
 
    draw_delete_fragment_shader(svga->swtnl.draw, fs->draw_shader);
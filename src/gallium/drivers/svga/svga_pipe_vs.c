@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_bitmask.h"
+#include "util/u_hash_table.h"
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_text.h"
 
@@ -98,14 +99,31 @@ svga_create_vs_state(struct pipe_context *pipe,
                      const struct pipe_shader_state *templ)
 {
    struct svga_context *svga = svga_context(pipe);
-   struct svga_vertex_shader *vs = CALLOC_STRUCT(svga_vertex_shader);
-   if (!vs)
-      return NULL;
+   struct svga_vertex_shader *vs;
+   struct svga_shader key;
 
    /* substitute a debug shader?
     */
-   vs->base.tokens = tgsi_dup_tokens(substitute_vs(svga->debug.shader_id,
-                                                   templ->tokens));
+   key.tokens = substitute_vs(svga->debug.shader_id, templ->tokens);
+   key.hash = (key.tokens == templ->tokens) ?
+      tgsi_shader_state_hash(templ) : tgsi_hash_tokens(key.tokens);
+
+   /* share the shader, and its host shaders, with an identical live one */
+   if (!templ->stream_output.num_outputs) {
+      vs = util_hash_table_get(svga->shaders, &key);
+      if (vs) {
+         vs->base.refcount++;
+         return vs;
+      }
+   }
+
+   vs = CALLOC_STRUCT(svga_vertex_shader);
+   if (!vs)
+      return NULL;
+
+   vs->base.tokens = tgsi_dup_tokens(key.tokens);
+   vs->base.hash = key.hash;
+   vs->base.refcount = 1;
 
    /* Collect basic info that we'll need later:
     */
@@ -117,6 +135,7 @@ svga_create_vs_state(struct pipe_context *pipe,
        */
       struct pipe_shader_state tmp2 = *templ;
       tmp2.tokens = vs->base.tokens;
+      tmp2.hash = 0;
       vs->draw_shader = draw_create_vertex_shader(svga->swtnl.draw, &tmp2);
    }
 
@@ -128,6 +147,9 @@ svga_create_vs_state(struct pipe_context *pipe,
                    vs->base.info.num_inputs, vs->base.info.num_outputs);
    }
 
+   if (vs->base.tokens && !templ->stream_output.num_outputs)
+      util_hash_table_set(svga->shaders, &vs->base, vs);
+
    return vs;
 }
 
@@ -151,6 +173,12 @@ svga_delete_vs_state(struct pipe_context *pipe, void *shader)
    struct svga_shader_result *result, *tmp;
    enum pipe_error ret;
 
+   if (--vs->base.refcount)
+      return;
+
+   if (util_hash_table_get(svga->shaders, &vs->base) == vs)
+      util_hash_table_remove(svga->shaders, &vs->base);
+
    svga_hwtnl_flush_retry(svga);
 
    draw_delete_vertex_shader(svga->swtnl.draw, vs->draw_shader);
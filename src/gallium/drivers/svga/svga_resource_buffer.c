@@ -88,6 +88,8 @@ svga_buffer_transfer_map(struct pipe_context *pipe,
    transfer->box = *box;
 
    if (usage & PIPE_TRANSFER_WRITE) {
+      pipe_resource_reference(&sbuf->translated.buffer, NULL);
+
       if (usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE) {
          /*
           * Flush any pending primitives, finish writing any pending DMA
@@ -292,6 +294,9 @@ svga_buffer_destroy( struct pipe_screen *screen,
    if(sbuf->uploaded.buffer)
       pipe_resource_reference(&sbuf->uploaded.buffer, NULL);
 
+   if(sbuf->translated.buffer)
+      pipe_resource_reference(&sbuf->translated.buffer, NULL);
+
    if(sbuf->hwbuf)
       svga_buffer_destroy_hw_storage(ss, sbuf);
    
@@ -32,6 +32,7 @@
 #include "util/u_transfer.h"
 
 #include "util/u_double_list.h"
+#include "indices/u_indices.h"
 
 #include "svga_screen_cache.h"
 
@@ -136,6 +137,19 @@ struct svga_buffer
       unsigned end;
    } uploaded;
 
+   /**
+    * Last translation of this index buffer, kept for static buffers so that
+    * drawing the same range again doesn't translate it again.
+    *
+    * Dropped whenever the buffer is mapped for writing.
+    */
+   struct {
+      struct pipe_resource *buffer;
+      u_translate_func translate;
+      unsigned offset;
+      unsigned nr;
+   } translated;
+
    /**
     * DMA'ble memory.
     *
@@ -274,6 +274,8 @@ svga_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return 1;
    case PIPE_CAP_ENDIANNESS:
       return PIPE_ENDIAN_LITTLE;
+   case PIPE_CAP_SHAREABLE_STATE_OBJECTS:
+      return 0;
    }
 
    debug_printf("Unexpected PIPE_CAP_ query %u\n", param);
@@ -323,6 +325,9 @@ static int svga_get_shader_param(struct pipe_screen *screen, unsigned shader, en
          return 0;
       case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
          return 0;
+      case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
+      case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
+         return 1;
       case PIPE_SHADER_CAP_INDIRECT_OUTPUT_ADDR:
       case PIPE_SHADER_CAP_INDIRECT_TEMP_ADDR:
       case PIPE_SHADER_CAP_INDIRECT_CONST_ADDR:
@@ -369,7 +374,9 @@ static int svga_get_shader_param(struct pipe_screen *screen, unsigned shader, en
       case PIPE_SHADER_CAP_TGSI_CONT_SUPPORTED:
          return 0;
       case PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED:
+      case PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED:
          return 0;
+      case PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED:
       case PIPE_SHADER_CAP_INDIRECT_INPUT_ADDR:
       case PIPE_SHADER_CAP_INDIRECT_OUTPUT_ADDR:
          return 1;
@@ -568,6 +575,9 @@ svga_screen_create(struct svga_winsys_screen *sws)
    svgascreen->debug.no_sampler_view =
       debug_get_bool_option("SVGA_NO_SAMPLER_VIEW", FALSE);
 
+   svgascreen->cache_translated_indices =
+      debug_get_bool_option("SVGA_CACHE_INDICES", TRUE);
+
    screen = &svgascreen->screen;
 
    screen->destroy = svga_destroy_screen;
@@ -59,6 +59,9 @@ struct svga_screen
       boolean no_sampler_view;
    } debug;
 
+   /** Keep translated index buffers of static buffers, SVGA_CACHE_INDICES */
+   boolean cache_translated_indices;
+
    unsigned texture_timestamp;
    pipe_mutex tex_mutex; 
 
@@ -74,6 +77,9 @@ struct svga_screen
 
    struct svga_host_surface_cache cache;
 
+   /** Translated shaders shared by all contexts */
+   struct svga_shader_cache shader_cache;
+
    /** Memory used by all resources (buffers and surfaces) */
    uint64_t total_resource_bytes;
 };
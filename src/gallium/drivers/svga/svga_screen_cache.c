@@ -26,6 +26,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_hash.h"
+#include "tgsi/tgsi_parse.h"
 
 #include "svga_debug.h"
 #include "svga_format.h"
@@ -331,6 +332,61 @@ svga_screen_cache_flush(struct svga_screen *svgascreen,
 }
 
 
+static void
+svga_shader_cache_entry_destroy(struct svga_shader_cache_entry *entry)
+{
+   FREE(entry->tgsi);
+   FREE(entry->tokens);
+   FREE(entry);
+}
+
+
+static INLINE unsigned
+svga_shader_cache_entry_size(const struct svga_shader_cache_entry *entry)
+{
+   return entry->nr_tgsi_tokens * sizeof(struct tgsi_token) +
+          entry->nr_tokens * sizeof(unsigned);
+}
+
+
+static void
+svga_shader_cache_cleanup(struct svga_shader_cache *cache)
+{
+   struct list_head *curr, *next;
+
+   SVGA_DBG(DEBUG_CACHE, "shader cache: %u hits, %u misses, %u bytes\n",
+            cache->hits, cache->misses, cache->total_size);
+
+   curr = cache->lru.next;
+   next = curr->next;
+   while (curr != &cache->lru) {
+      struct svga_shader_cache_entry *entry =
+         LIST_ENTRY(struct svga_shader_cache_entry, curr, head);
+
+      svga_shader_cache_entry_destroy(entry);
+
+      curr = next;
+      next = curr->next;
+   }
+
+   pipe_mutex_destroy(cache->mutex);
+}
+
+
+static void
+svga_shader_cache_init(struct svga_shader_cache *cache)
+{
+   unsigned i;
+
+   pipe_mutex_init(cache->mutex);
+
+   for (i = 0; i < SVGA_SHADER_CACHE_BUCKETS; ++i)
+      LIST_INITHEAD(&cache->bucket[i]);
+
+   LIST_INITHEAD(&cache->lru);
+}
+
+
 /**
  * Free all the surfaces in the cache.
  * Called when destroying the svga screen object.
@@ -357,6 +413,8 @@ svga_screen_cache_cleanup(struct svga_screen *svgascreen)
    }
 
    pipe_mutex_destroy(cache->mutex);
+
+   svga_shader_cache_cleanup(&svgascreen->shader_cache);
 }
 
 
@@ -368,6 +426,8 @@ svga_screen_cache_init(struct svga_screen *svgascreen)
 
    assert(cache->total_size == 0);
 
+   svga_shader_cache_init(&svgascreen->shader_cache);
+
    pipe_mutex_init(cache->mutex);
 
    for (i = 0; i < SVGA_HOST_SURFACE_CACHE_BUCKETS; ++i)
@@ -524,3 +584,159 @@ svga_screen_cache_dump(const struct svga_screen *svgascreen)
 
    debug_printf("%u surfaces, %u bytes\n", count, cache->total_size);
 }
+
+
+/**
+ * Compute the bucket for this shader.
+ */
+static INLINE unsigned
+svga_shader_cache_bucket(unsigned type, uint64_t hash,
+                         const struct svga_compile_key *key)
+{
+   const unsigned key_hash = util_hash_crc32(key, sizeof *key);
+
+   return (unsigned) (hash ^ (hash >> 32) ^ key_hash ^ type) %
+      SVGA_SHADER_CACHE_BUCKETS;
+}
+
+
+/**
+ * Search the shader cache for a translation of the TGSI tokens with the key.
+ * Must be called with the cache mutex held.
+ */
+static struct svga_shader_cache_entry *
+svga_shader_cache_find(struct svga_shader_cache *cache, unsigned type,
+                       const struct tgsi_token *tgsi, unsigned nr_tgsi_tokens,
+                       uint64_t hash, const struct svga_compile_key *key)
+{
+   const unsigned bucket = svga_shader_cache_bucket(type, hash, key);
+   struct list_head *curr;
+
+   for (curr = cache->bucket[bucket].next;
+        curr != &cache->bucket[bucket];
+        curr = curr->next) {
+      struct svga_shader_cache_entry *entry =
+         LIST_ENTRY(struct svga_shader_cache_entry, curr, bucket_head);
+
+      if (entry->type == type &&
+          entry->hash == hash &&
+          entry->nr_tgsi_tokens == nr_tgsi_tokens &&
+          memcmp(&entry->key, key, sizeof *key) == 0 &&
+          memcmp(entry->tgsi, tgsi, nr_tgsi_tokens * sizeof(*tgsi)) == 0)
+         return entry;
+   }
+
+   return NULL;
+}
+
+
+/**
+ * Return a copy of the SVGA3D bytecode translated from the TGSI tokens with
+ * the key, or NULL if there is none in the cache.
+ */
+unsigned *
+svga_screen_shader_lookup(struct svga_screen *svgascreen, unsigned type,
+                          const struct tgsi_token *tgsi, uint64_t hash,
+                          const struct svga_compile_key *key,
+                          unsigned *nr_tokens)
+{
+   struct svga_shader_cache *cache = &svgascreen->shader_cache;
+   struct svga_shader_cache_entry *entry;
+   unsigned *tokens = NULL;
+
+   pipe_mutex_lock(cache->mutex);
+
+   entry = svga_shader_cache_find(cache, type, tgsi, tgsi_num_tokens(tgsi),
+                                  hash, key);
+   if (entry) {
+      tokens = MALLOC(entry->nr_tokens * sizeof(unsigned));
+      if (tokens) {
+         memcpy(tokens, entry->tokens, entry->nr_tokens * sizeof(unsigned));
+         *nr_tokens = entry->nr_tokens;
+
+         /* move to the head of the LRU list */
+         LIST_DEL(&entry->head);
+         LIST_ADD(&entry->head, &cache->lru);
+      }
+   }
+
+   if (tokens)
+      cache->hits++;
+   else
+      cache->misses++;
+
+   pipe_mutex_unlock(cache->mutex);
+
+   return tokens;
+}
+
+
+/**
+ * Add the SVGA3D bytecode translated from the TGSI tokens with the key to
+ * the cache.  The least recently used entries are evicted to keep the cache
+ * under SVGA_SHADER_CACHE_BYTES.
+ */
+void
+svga_screen_shader_add(struct svga_screen *svgascreen, unsigned type,
+                       const struct tgsi_token *tgsi, uint64_t hash,
+                       const struct svga_compile_key *key,
+                       const unsigned *tokens, unsigned nr_tokens)
+{
+   struct svga_shader_cache *cache = &svgascreen->shader_cache;
+   const unsigned nr_tgsi_tokens = tgsi_num_tokens(tgsi);
+   struct svga_shader_cache_entry *entry;
+   unsigned size;
+
+   entry = CALLOC_STRUCT(svga_shader_cache_entry);
+   if (!entry)
+      return;
+
+   entry->type = type;
+   entry->hash = hash;
+   entry->nr_tgsi_tokens = nr_tgsi_tokens;
+   entry->key = *key;
+   entry->nr_tokens = nr_tokens;
+
+   entry->tgsi = MALLOC(nr_tgsi_tokens * sizeof(*tgsi));
+   entry->tokens = MALLOC(nr_tokens * sizeof(unsigned));
+   if (!entry->tgsi || !entry->tokens) {
+      svga_shader_cache_entry_destroy(entry);
+      return;
+   }
+
+   memcpy(entry->tgsi, tgsi, nr_tgsi_tokens * sizeof(*tgsi));
+   memcpy(entry->tokens, tokens, nr_tokens * sizeof(unsigned));
+
+   size = svga_shader_cache_entry_size(entry);
+   if (size > SVGA_SHADER_CACHE_BYTES) {
+      svga_shader_cache_entry_destroy(entry);
+      return;
+   }
+
+   pipe_mutex_lock(cache->mutex);
+
+   /* another context may have added it */
+   if (svga_shader_cache_find(cache, type, tgsi, nr_tgsi_tokens,
+                              hash, key)) {
+      pipe_mutex_unlock(cache->mutex);
+      svga_shader_cache_entry_destroy(entry);
+      return;
+   }
+
+   while (cache->total_size + size > SVGA_SHADER_CACHE_BYTES) {
+      struct svga_shader_cache_entry *lru =
+         LIST_ENTRY(struct svga_shader_cache_entry, cache->lru.prev, head);
+
+      LIST_DEL(&lru->head);
+      LIST_DEL(&lru->bucket_head);
+      cache->total_size -= svga_shader_cache_entry_size(lru);
+      svga_shader_cache_entry_destroy(lru);
+   }
+
+   LIST_ADD(&entry->head, &cache->lru);
+   LIST_ADD(&entry->bucket_head,
+            &cache->bucket[svga_shader_cache_bucket(type, hash, key)]);
+   cache->total_size += size;
+
+   pipe_mutex_unlock(cache->mutex);
+}
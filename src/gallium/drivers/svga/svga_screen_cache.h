@@ -36,6 +36,8 @@
 
 #include "util/u_double_list.h"
 
+#include "svga_tgsi.h"
+
 
 /* Guess the storage size of cached surfaces and try and keep it under
  * this amount:
@@ -51,8 +53,18 @@
 #define SVGA_HOST_SURFACE_CACHE_BUCKETS 256
 
 
+/* Keep the translated shaders under this amount:
+ */
+#define SVGA_SHADER_CACHE_BYTES (4 * 1024 * 1024)
+
+/* Number of hash buckets for the shader cache:
+ */
+#define SVGA_SHADER_CACHE_BUCKETS 256
+
+
 struct svga_winsys_surface;
 struct svga_screen;
+struct tgsi_token;
 
 /**
  * Same as svga_winsys_screen::surface_create.
@@ -124,6 +136,48 @@ struct svga_host_surface_cache
 };
 
 
+/**
+ * A translated shader.  Contexts can not share host shaders, as shader IDs
+ * are per-context, but they can share the SVGA3D bytecode.
+ */
+struct svga_shader_cache_entry
+{
+   /** Head for the LRU list, svga_shader_cache::lru */
+   struct list_head head;
+
+   /** Head for the bucket lists. */
+   struct list_head bucket_head;
+
+   unsigned type;               /**< SVGA3D_SHADERTYPE_x */
+   uint64_t hash;               /**< tgsi_hash_tokens() of tgsi */
+   struct tgsi_token *tgsi;
+   unsigned nr_tgsi_tokens;
+   struct svga_compile_key key;
+
+   unsigned *tokens;
+   unsigned nr_tokens;
+};
+
+
+/**
+ * Cache of the translated shaders of all contexts.
+ */
+struct svga_shader_cache
+{
+   pipe_mutex mutex;
+
+   struct list_head bucket[SVGA_SHADER_CACHE_BUCKETS];
+
+   /** Entries ordered from most to least recently used */
+   struct list_head lru;
+
+   /** Sum of sizes of all entries (in bytes) */
+   unsigned total_size;
+
+   unsigned hits, misses;
+};
+
+
 void
 svga_screen_cache_cleanup(struct svga_screen *svgascreen);
 
@@ -148,4 +202,17 @@ void
 svga_screen_cache_dump(const struct svga_screen *svgascreen);
 
 
+unsigned *
+svga_screen_shader_lookup(struct svga_screen *svgascreen, unsigned type,
+                          const struct tgsi_token *tgsi, uint64_t hash,
+                          const struct svga_compile_key *key,
+                          unsigned *nr_tokens);
+
+void
+svga_screen_shader_add(struct svga_screen *svgascreen, unsigned type,
+                       const struct tgsi_token *tgsi, uint64_t hash,
+                       const struct svga_compile_key *key,
+                       const unsigned *tokens, unsigned nr_tokens);
+
+
 #endif /* SVGA_SCREEN_CACHE_H_ */
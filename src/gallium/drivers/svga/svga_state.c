@@ -127,9 +127,11 @@ update_state(struct svga_context *svga,
    enum pipe_error ret = PIPE_OK;
    unsigned i;
 
-   ret = svga_hwtnl_flush( svga->hwtnl );
-   if (ret != PIPE_OK)
-      return ret;
+   /* The queued primitives are not flushed here.  Each atom flushes them
+    * itself right before emitting a command, so that state which only
+    * bounces back to what the host already has doesn't split the draw
+    * command.
+    */
 
    if (debug) {
       /* Debug version which enforces various sanity checks on the
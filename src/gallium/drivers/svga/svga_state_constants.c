@@ -29,6 +29,7 @@
 #include "svga_screen.h"
 #include "svga_context.h"
 #include "svga_state.h"
+#include "svga_draw.h"
 #include "svga_cmd.h"
 #include "svga_tgsi.h"
 #include "svga_debug.h"
@@ -88,6 +89,10 @@ emit_const(struct svga_context *svga, unsigned shader, unsigned i,
                       value[2],
                       value[3]);
 
+      ret = svga_hwtnl_flush( svga->hwtnl );
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetShaderConst( svga->swc,
                                    i,
                                    svga_shader_type(shader),
@@ -185,6 +190,10 @@ emit_const_range(struct svga_context *svga,
 
          /* Send them all together.
           */
+         ret = svga_hwtnl_flush( svga->hwtnl );
+         if (ret != PIPE_OK)
+            return ret;
+
          ret = SVGA3D_SetShaderConsts(svga->swc,
                                       offset + i, j - i,
                                       svga_shader_type(shader),
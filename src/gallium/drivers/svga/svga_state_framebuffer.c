@@ -29,6 +29,7 @@
 
 #include "svga_context.h"
 #include "svga_state.h"
+#include "svga_draw.h"
 #include "svga_cmd.h"
 #include "svga_debug.h"
 
@@ -59,6 +60,10 @@ emit_framebuffer( struct svga_context *svga,
          if (svga->curr.nr_fbs++ > 8)
             return PIPE_ERROR_OUT_OF_MEMORY;
 
+         ret = svga_hwtnl_flush(svga->hwtnl);
+         if (ret != PIPE_OK)
+            return ret;
+
          ret = SVGA3D_SetRenderTarget(svga->swc, SVGA3D_RT_COLOR0 + i, curr->cbufs[i]);
          if (ret != PIPE_OK)
             return ret;
@@ -70,6 +75,10 @@ emit_framebuffer( struct svga_context *svga,
    
    if (curr->zsbuf != hw->zsbuf ||
        (reemit && hw->zsbuf)) {
+      ret = svga_hwtnl_flush(svga->hwtnl);
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetRenderTarget(svga->swc, SVGA3D_RT_DEPTH, curr->zsbuf);
       if (ret != PIPE_OK)
          return ret;
@@ -415,6 +424,10 @@ out:
    }
 
    if (memcmp(&rect, &svga->state.hw_clear.viewport, sizeof(rect)) != 0) {
+      ret = svga_hwtnl_flush(svga->hwtnl);
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetViewport(svga->swc, &rect);
       if(ret != PIPE_OK)
          return ret;
@@ -426,6 +439,10 @@ out:
    if (svga->state.hw_clear.depthrange.zmin != range_min ||
        svga->state.hw_clear.depthrange.zmax != range_max) 
    {
+      ret = svga_hwtnl_flush(svga->hwtnl);
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetZRange(svga->swc, range_min, range_max );
       if(ret != PIPE_OK)
          return ret;
@@ -463,13 +480,28 @@ emit_scissor_rect( struct svga_context *svga,
 {
    const struct pipe_scissor_state *scissor = &svga->curr.scissor;
    SVGA3dRect rect;
+   enum pipe_error ret;
 
    rect.x = scissor->minx;
    rect.y = scissor->miny;
    rect.w = scissor->maxx - scissor->minx; /* + 1 ?? */
    rect.h = scissor->maxy - scissor->miny; /* + 1 ?? */
-   
-   return SVGA3D_SetScissorRect(svga->swc, &rect);
+
+   if (memcmp(&rect, &svga->state.hw_clear.scissor, sizeof(rect)) == 0)
+      return PIPE_OK;
+
+   ret = svga_hwtnl_flush(svga->hwtnl);
+   if (ret != PIPE_OK)
+      return ret;
+
+   ret = SVGA3D_SetScissorRect(svga->swc, &rect);
+   if (ret != PIPE_OK)
+      return ret;
+
+   assert(sizeof(rect) == sizeof(svga->state.hw_clear.scissor));
+   memcpy(&svga->state.hw_clear.scissor, &rect, sizeof(rect));
+
+   return PIPE_OK;
 }
 
 
@@ -514,9 +546,19 @@ emit_clip_planes( struct svga_context *svga,
       plane[2] = 2.0f * c;
       plane[3] = d - c;
 
+      if (memcmp(plane, svga->state.hw_draw.clip_planes[i],
+                 sizeof(plane)) == 0)
+         continue;
+
+      ret = svga_hwtnl_flush(svga->hwtnl);
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetClipPlane(svga->swc, i, plane);
       if(ret != PIPE_OK)
          return ret;
+
+      memcpy(svga->state.hw_draw.clip_planes[i], plane, sizeof(plane));
    }
 
    return PIPE_OK;
@@ -28,10 +28,13 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_bitmask.h"
+#include "util/u_hash_table.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
 
 #include "svga_context.h"
 #include "svga_state.h"
+#include "svga_draw.h"
 #include "svga_cmd.h"
 #include "svga_tgsi.h"
 
@@ -108,7 +111,7 @@ static enum pipe_error compile_fs( struct svga_context *svga,
    struct svga_shader_result *result;
    enum pipe_error ret = PIPE_ERROR;
 
-   result = svga_translate_fragment_program( fs, key );
+   result = svga_translate_fragment_program( svga, fs, key );
    if (result == NULL) {
       /* some problem during translation, try the dummy shader */
       const struct tgsi_token *dummy = get_dummy_fragment_shader();
@@ -117,9 +120,15 @@ static enum pipe_error compile_fs( struct svga_context *svga,
          goto fail;
       }
       debug_printf("Failed to compile fragment shader, using dummy shader instead.\n");
+
+      /* the tokens no longer match the ones it was created with */
+      if (util_hash_table_get(svga->shaders, &fs->base) == fs)
+         util_hash_table_remove(svga->shaders, &fs->base);
+
       FREE((void *) fs->base.tokens);
       fs->base.tokens = dummy;
-      result = svga_translate_fragment_program(fs, key);
+      fs->base.hash = tgsi_hash_tokens(dummy);
+      result = svga_translate_fragment_program(svga, fs, key);
       if (result == NULL) {
          ret = PIPE_ERROR;
          goto fail;
@@ -279,6 +288,10 @@ emit_hw_fs(struct svga_context *svga, unsigned dirty)
    assert(id != SVGA3D_INVALID_ID);
 
    if (result != svga->state.hw_draw.fs) {
+      ret = svga_hwtnl_flush( svga->hwtnl );
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetShader(svga->swc,
                              SVGA3D_SHADERTYPE_PS,
                              id );
@@ -32,6 +32,7 @@
 #include "svga_context.h"
 #include "svga_screen.h"
 #include "svga_state.h"
+#include "svga_draw.h"
 #include "svga_cmd.h"
 
 
@@ -44,20 +45,16 @@ struct rs_queue {
 #define EMIT_RS(svga, value, token, fail)                       \
 do {                                                            \
    assert(SVGA3D_RS_##token < Elements(svga->state.hw_draw.rs)); \
-   if (svga->state.hw_draw.rs[SVGA3D_RS_##token] != value) {    \
+   if (svga->state.hw_draw.rs[SVGA3D_RS_##token] != value)      \
       svga_queue_rs( &queue, SVGA3D_RS_##token, value );        \
-      svga->state.hw_draw.rs[SVGA3D_RS_##token] = value;        \
-   }                                                            \
 } while (0)
 
 #define EMIT_RS_FLOAT(svga, fvalue, token, fail)                \
 do {                                                            \
    unsigned value = fui(fvalue);                                \
    assert(SVGA3D_RS_##token < Elements(svga->state.hw_draw.rs)); \
-   if (svga->state.hw_draw.rs[SVGA3D_RS_##token] != value) {    \
+   if (svga->state.hw_draw.rs[SVGA3D_RS_##token] != value)      \
       svga_queue_rs( &queue, SVGA3D_RS_##token, value );        \
-      svga->state.hw_draw.rs[SVGA3D_RS_##token] = value;        \
-   }                                                            \
 } while (0)
 
 
@@ -75,6 +72,10 @@ svga_queue_rs( struct rs_queue *q,
 /* Compare old and new render states and emit differences between them
  * to hardware.  Simplest implementation would be to emit the whole of
  * the "to" state.
+ *
+ * The cached hardware state is only updated once the command has been
+ * reserved, so a failed attempt leaves it describing what the host
+ * really has.
  */
 static enum pipe_error
 emit_rss(struct svga_context *svga, unsigned dirty)
@@ -267,30 +268,30 @@ emit_rss(struct svga_context *svga, unsigned dirty)
 
    if (queue.rs_count) {
       SVGA3dRenderState *rs;
+      enum pipe_error ret;
+      unsigned i;
+
+      /* The queued primitives were drawn with the old state */
+      ret = svga_hwtnl_flush( svga->hwtnl );
+      if (ret != PIPE_OK)
+         return ret;
 
       if (SVGA3D_BeginSetRenderState( svga->swc,
                                       &rs,
                                       queue.rs_count ) != PIPE_OK)
-         goto fail;
+         return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy( rs,
               queue.rs,
               queue.rs_count * sizeof queue.rs[0]);
 
       SVGA_FIFOCommitAll( svga->swc );
+
+      for (i = 0; i < queue.rs_count; i++)
+         svga->state.hw_draw.rs[queue.rs[i].state] = queue.rs[i].uintValue;
    }
 
    return PIPE_OK;
-
-fail:
-   /* XXX: need to poison cached hardware state on failure to ensure
-    * dirty state gets re-emitted.  Fix this by re-instating partial
-    * FIFOCommit command and only updating cached hw state once the
-    * initial allocation has succeeded.
-    */
-   memset(svga->state.hw_draw.rs, 0xcd, sizeof(svga->state.hw_draw.rs));
-
-   return PIPE_ERROR_OUT_OF_MEMORY;
 }
 
 
@@ -29,9 +29,11 @@
 #include "util/u_math.h"
 
 #include "svga_sampler_view.h"
+#include "svga_resource_texture.h"
 #include "svga_winsys.h"
 #include "svga_context.h"
 #include "svga_state.h"
+#include "svga_draw.h"
 #include "svga_cmd.h"
 
 
@@ -63,6 +65,27 @@ struct bind_queue {
 };
 
 
+static struct pipe_resource *
+get_view_lods(const struct svga_context *svga, unsigned i,
+              unsigned *min_lod, unsigned *max_lod)
+{
+   const struct svga_sampler_state *s = svga->curr.sampler[i];
+   struct pipe_sampler_view *sv = svga->curr.sampler_views[i];
+
+   if (sv) {
+      *min_lod = MAX2(0, (s->view_min_lod + sv->u.tex.first_level));
+      *max_lod = MIN2(s->view_max_lod + sv->u.tex.first_level,
+                      sv->texture->last_level);
+      return sv->texture;
+   }
+   else {
+      *min_lod = 0;
+      *max_lod = 0;
+      return NULL;
+   }
+}
+
+
 static enum pipe_error
 update_tss_binding(struct svga_context *svga, 
                    unsigned dirty )
@@ -77,23 +100,35 @@ update_tss_binding(struct svga_context *svga,
    struct bind_queue queue;
 
    queue.bind_count = 0;
-   
+
+   /* Binding a new view and refreshing the copy held by an old one both
+    * emit commands, which the queued primitives must not see.
+    */
    for (i = 0; i < count; i++) {
-      const struct svga_sampler_state *s = svga->curr.sampler[i];
       struct svga_hw_view_state *view = &svga->state.hw_draw.views[i];
-      struct pipe_resource *texture = NULL;
-      struct pipe_sampler_view *sv = svga->curr.sampler_views[i];
-
-      /* get min max lod */
-      if (sv) {
-         min_lod = MAX2(0, (s->view_min_lod + sv->u.tex.first_level));
-         max_lod = MIN2(s->view_max_lod + sv->u.tex.first_level,
-                        sv->texture->last_level);
-         texture = sv->texture;
-      } else {
-         min_lod = 0;
-         max_lod = 0;
+      struct pipe_resource *texture = get_view_lods(svga, i, &min_lod,
+                                                    &max_lod);
+
+      boolean separate_surface = view->v &&
+         view->v->handle != svga_texture(view->v->texture)->handle;
+
+      if (view->texture != texture ||
+          view->min_lod != min_lod ||
+          view->max_lod != max_lod ||
+          view->dirty ||
+          (view->v && reemit) ||
+          separate_surface) {
+         enum pipe_error ret = svga_hwtnl_flush( svga->hwtnl );
+         if (ret != PIPE_OK)
+            return ret;
+         break;
       }
+   }
+   
+   for (i = 0; i < count; i++) {
+      struct svga_hw_view_state *view = &svga->state.hw_draw.views[i];
+      struct pipe_resource *texture = get_view_lods(svga, i, &min_lod,
+                                                    &max_lod);
 
       if (view->texture != texture ||
           view->min_lod != min_lod ||
@@ -254,10 +289,8 @@ struct ts_queue {
 do {                                                                    \
    assert(unit < Elements(svga->state.hw_draw.ts));                     \
    assert(SVGA3D_TS_##token < Elements(svga->state.hw_draw.ts[unit]));  \
-   if (svga->state.hw_draw.ts[unit][SVGA3D_TS_##token] != val) {        \
+   if (svga->state.hw_draw.ts[unit][SVGA3D_TS_##token] != val)          \
       svga_queue_tss( &queue, unit, SVGA3D_TS_##token, val );           \
-      svga->state.hw_draw.ts[unit][SVGA3D_TS_##token] = val;            \
-   }                                                                    \
 } while (0)
 
 #define EMIT_TS_FLOAT(svga, unit, fvalue, token, fail)                  \
@@ -265,10 +298,8 @@ do {                                                                    \
    unsigned val = fui(fvalue);                                          \
    assert(unit < Elements(svga->state.hw_draw.ts));                     \
    assert(SVGA3D_TS_##token < Elements(svga->state.hw_draw.ts[unit]));  \
-   if (svga->state.hw_draw.ts[unit][SVGA3D_TS_##token] != val) {        \
+   if (svga->state.hw_draw.ts[unit][SVGA3D_TS_##token] != val)          \
       svga_queue_tss( &queue, unit, SVGA3D_TS_##token, val );           \
-      svga->state.hw_draw.ts[unit][SVGA3D_TS_##token] = val;            \
-   }                                                                    \
 } while (0)
 
 
@@ -325,30 +356,33 @@ update_tss(struct svga_context *svga,
  
    if (queue.ts_count) {
       SVGA3dTextureState *ts;
+      enum pipe_error ret;
+
+      /* The queued primitives were drawn with the old state */
+      ret = svga_hwtnl_flush( svga->hwtnl );
+      if (ret != PIPE_OK)
+         return ret;
 
       if (SVGA3D_BeginSetTextureState( svga->swc,
                                        &ts,
                                        queue.ts_count ) != PIPE_OK)
-         goto fail;
+         return PIPE_ERROR_OUT_OF_MEMORY;
 
       memcpy( ts,
               queue.ts,
               queue.ts_count * sizeof queue.ts[0]);
       
       SVGA_FIFOCommitAll( svga->swc );
+
+      /* Only update the cached hardware state once the command has been
+       * reserved, so that a failed attempt is simply retried.
+       */
+      for (i = 0; i < queue.ts_count; i++)
+         svga->state.hw_draw.ts[queue.ts[i].stage][queue.ts[i].name] =
+            queue.ts[i].value;
    }
 
    return PIPE_OK;
-
-fail:
-   /* XXX: need to poison cached hardware state on failure to ensure
-    * dirty state gets re-emitted.  Fix this by re-instating partial
-    * FIFOCommit command and only updating cached hw state once the
-    * initial allocation has succeeded.
-    */
-   memset(svga->state.hw_draw.ts, 0xcd, sizeof(svga->state.hw_draw.ts));
-
-   return PIPE_ERROR_OUT_OF_MEMORY;
 }
 
 
@@ -42,15 +42,16 @@ static enum pipe_error
 emit_hw_vs_vdecl(struct svga_context *svga, unsigned dirty)
 {
    const struct pipe_vertex_element *ve = svga->curr.velems->velem;
+   SVGA3dVertexDecl decls[SVGA3D_INPUTREG_MAX];
+   struct pipe_resource *vbs[SVGA3D_INPUTREG_MAX];
+   unsigned count = svga->curr.velems->count;
    unsigned i;
    unsigned neg_bias = 0;
+   enum pipe_error ret;
 
    assert(svga->curr.velems->count >=
           svga->curr.vs->base.info.file_count[TGSI_FILE_INPUT]);
-
-   /* specify number of vertex element declarations to come */
-   svga_hwtnl_reset_vdecl( svga->hwtnl,
-                           svga->curr.velems->count );
+   assert(count <= SVGA3D_INPUTREG_MAX);
 
    /**
     * We can't set the VDECL offset to something negative, so we
@@ -92,12 +93,16 @@ emit_hw_vs_vdecl(struct svga_context *svga, unsigned dirty)
       const struct svga_buffer *buffer;
       SVGA3dVertexDecl decl;
 
+      vbs[i] = NULL;
       if (!vb->buffer)
          continue;
 
       buffer = svga_buffer(vb->buffer);
       svga_generate_vdecl_semantics( i, &usage, &index );
 
+      /* the declarations are compared with memcmp() */
+      memset(&decl, 0, sizeof decl);
+
       /* SVGA_NEW_VELEMENT
        */
       decl.identity.type = svga->state.sw.ve_format[i];
@@ -116,11 +121,25 @@ emit_hw_vs_vdecl(struct svga_context *svga, unsigned dirty)
 
       assert(decl.array.offset >= 0);
 
-      svga_hwtnl_vdecl( svga->hwtnl,
-                        i,
-                        &decl,
-                        buffer->uploaded.buffer ? buffer->uploaded.buffer :
-                        vb->buffer );
+      decls[i] = decl;
+      vbs[i] = buffer->uploaded.buffer ? buffer->uploaded.buffer : vb->buffer;
+   }
+
+   /* The index bias is applied to each primitive as it is queued, so only
+    * a change of the declarations themselves ends the draw command.
+    */
+   if (svga_hwtnl_vdecls_changed( svga->hwtnl, count, decls, vbs )) {
+      ret = svga_hwtnl_flush( svga->hwtnl );
+      if (ret != PIPE_OK)
+         return ret;
+
+      /* specify number of vertex element declarations to come */
+      svga_hwtnl_reset_vdecl( svga->hwtnl, count );
+
+      for (i = 0; i < count; i++) {
+         if (vbs[i])
+            svga_hwtnl_vdecl( svga->hwtnl, i, &decls[i], vbs[i] );
+      }
    }
 
    svga_hwtnl_set_index_bias( svga->hwtnl, -(int) neg_bias );
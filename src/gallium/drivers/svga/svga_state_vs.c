@@ -29,11 +29,14 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_bitmask.h"
+#include "util/u_hash_table.h"
 #include "translate/translate.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
 
 #include "svga_context.h"
 #include "svga_state.h"
+#include "svga_draw.h"
 #include "svga_cmd.h"
 #include "svga_tgsi.h"
 
@@ -106,7 +109,7 @@ static enum pipe_error compile_vs( struct svga_context *svga,
    struct svga_shader_result *result;
    enum pipe_error ret = PIPE_ERROR;
 
-   result = svga_translate_vertex_program( vs, key );
+   result = svga_translate_vertex_program( svga, vs, key );
    if (result == NULL) {
       /* some problem during translation, try the dummy shader */
       const struct tgsi_token *dummy = get_dummy_vertex_shader();
@@ -115,9 +118,15 @@ static enum pipe_error compile_vs( struct svga_context *svga,
          goto fail;
       }
       debug_printf("Failed to compile vertex shader, using dummy shader instead.\n");
+
+      /* the tokens no longer match the ones it was created with */
+      if (util_hash_table_get(svga->shaders, &vs->base) == vs)
+         util_hash_table_remove(svga->shaders, &vs->base);
+
       FREE((void *) vs->base.tokens);
       vs->base.tokens = dummy;
-      result = svga_translate_vertex_program(vs, key);
+      vs->base.hash = tgsi_hash_tokens(dummy);
+      result = svga_translate_vertex_program(svga, vs, key);
       if (result == NULL) {
          ret = PIPE_ERROR;
          goto fail;
@@ -193,6 +202,10 @@ emit_hw_vs(struct svga_context *svga, unsigned dirty)
    }
 
    if (result != svga->state.hw_draw.vs) {
+      ret = svga_hwtnl_flush( svga->hwtnl );
+      if (ret != PIPE_OK)
+         return ret;
+
       ret = SVGA3D_SetShader(svga->swc,
                              SVGA3D_SHADERTYPE_VS,
                              id );
@@ -37,6 +37,8 @@
 #include "svgadump/svga_shader_dump.h"
 
 #include "svga_context.h"
+#include "svga_screen.h"
+#include "svga_screen_cache.h"
 #include "svga_tgsi.h"
 #include "svga_tgsi_emit.h"
 #include "svga_debug.h"
@@ -265,11 +267,36 @@ svga_remap_generic_index(int8_t remap_table[MAX_GENERIC_VARYING],
  * it is, it will be copied to a hardware buffer for upload.
  */
 static struct svga_shader_result *
-svga_tgsi_translate(const struct svga_shader *shader,
+svga_tgsi_translate(struct svga_context *svga,
+                    const struct svga_shader *shader,
                     const struct svga_compile_key *key, unsigned unit)
 {
+   struct svga_screen *svgascreen = svga_screen(svga->pipe.screen);
+   const unsigned type = (unit == PIPE_SHADER_VERTEX) ?
+      SVGA3D_SHADERTYPE_VS : SVGA3D_SHADERTYPE_PS;
    struct svga_shader_result *result = NULL;
    struct svga_shader_emitter emit;
+   unsigned *tokens;
+   unsigned nr_tokens;
+
+   /* another context, or a deleted shader, may have translated it */
+   tokens = svga_screen_shader_lookup(svgascreen, type, shader->tokens,
+                                      shader->hash, key, &nr_tokens);
+   if (tokens) {
+      result = CALLOC_STRUCT(svga_shader_result);
+      if (result == NULL) {
+         FREE(tokens);
+         return NULL;
+      }
+
+      result->shader = shader;
+      result->tokens = tokens;
+      result->nr_tokens = nr_tokens;
+      memcpy(&result->key, key, sizeof(*key));
+      result->id = UTIL_BITMASK_INVALID_INDEX;
+
+      return result;
+   }
 
    memset(&emit, 0, sizeof(emit));
 
@@ -327,6 +354,9 @@ svga_tgsi_translate(const struct svga_shader *shader,
    memcpy(&result->key, key, sizeof(*key));
    result->id = UTIL_BITMASK_INVALID_INDEX;
 
+   svga_screen_shader_add(svgascreen, type, shader->tokens, shader->hash,
+                          key, result->tokens, result->nr_tokens);
+
    if (SVGA_DEBUG & DEBUG_TGSI) {
       debug_printf("#####################################\n");
       debug_printf("Shader %u below\n", shader->id);
@@ -348,7 +378,8 @@ svga_tgsi_translate(const struct svga_shader *shader,
 
 
 struct svga_shader_result *
-svga_translate_fragment_program(const struct svga_fragment_shader *fs,
+svga_translate_fragment_program(struct svga_context *svga,
+                                const struct svga_fragment_shader *fs,
                                 const struct svga_fs_compile_key *fkey)
 {
    struct svga_compile_key key;
@@ -360,12 +391,13 @@ svga_translate_fragment_program(const struct svga_fragment_shader *fs,
    memcpy(key.generic_remap_table, fs->generic_remap_table,
           sizeof(fs->generic_remap_table));
 
-   return svga_tgsi_translate(&fs->base, &key, PIPE_SHADER_FRAGMENT);
+   return svga_tgsi_translate(svga, &fs->base, &key, PIPE_SHADER_FRAGMENT);
 }
 
 
 struct svga_shader_result *
-svga_translate_vertex_program(const struct svga_vertex_shader *vs,
+svga_translate_vertex_program(struct svga_context *svga,
+                              const struct svga_vertex_shader *vs,
                               const struct svga_vs_compile_key *vkey)
 {
    struct svga_compile_key key;
@@ -379,7 +411,7 @@ svga_translate_vertex_program(const struct svga_vertex_shader *vs,
     */
    svga_remap_generics(vkey->fs_generic_inputs, key.generic_remap_table);
 
-   return svga_tgsi_translate(&vs->base, &key, PIPE_SHADER_VERTEX);
+   return svga_tgsi_translate(svga, &vs->base, &key, PIPE_SHADER_VERTEX);
 }
 
 
@@ -143,12 +143,16 @@ static INLINE unsigned svga_fs_key_size( const struct svga_fs_compile_key *key )
    return (const char *)&key->tex[key->num_textures] - (const char *)key;
 }
 
+struct svga_context;
+
 struct svga_shader_result *
-svga_translate_fragment_program( const struct svga_fragment_shader *fs,
+svga_translate_fragment_program( struct svga_context *svga,
+                                 const struct svga_fragment_shader *fs,
                                  const struct svga_fs_compile_key *fkey );
 
 struct svga_shader_result *
-svga_translate_vertex_program( const struct svga_vertex_shader *fs,
+svga_translate_vertex_program( struct svga_context *svga,
+                               const struct svga_vertex_shader *fs,
                                const struct svga_vs_compile_key *vkey );
 
 
@@ -30,10 +30,10 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect.  GALLIUM_TRACE_FORMAT=binary
+ * selects the compact encoding of tr_dump_binary.h instead, which is much
+ * cheaper to produce.
  *
  * @author Jose Fonseca <jrfonseca@tungstengraphics.com>
  */
@@ -53,6 +53,7 @@
 #include "util/u_format.h"
 
 #include "tr_dump.h"
+#include "tr_dump_binary.h"
 #include "tr_screen.h"
 #include "tr_texture.h"
 
@@ -62,6 +63,7 @@ static FILE *stream = NULL;
 pipe_static_mutex(call_mutex);
 static long unsigned call_no = 0;
 static boolean dumping = FALSE;
+static boolean binary = FALSE;
 
 
 static INLINE void
@@ -218,7 +220,8 @@ trace_dump_tag_end(const char *name)
 void
 trace_dump_trace_flush(void)
 {
-   if(stream) {
+   /* Binary traces are written a chunk at a time. */
+   if(stream && !binary) {
       fflush(stream);
    }
 }
@@ -227,7 +230,13 @@ static void
 trace_dump_trace_close(void)
 {
    if(stream) {
-      trace_dump_writes("</trace>\n");
+      if (binary) {
+         /* later calls fall back to the stream checks of the XML path */
+         trace_binary_close();
+         binary = FALSE;
+      }
+      else
+         trace_dump_writes("</trace>\n");
       if (close_stream) {
          fclose(stream);
          close_stream = FALSE;
@@ -241,7 +250,11 @@ trace_dump_trace_close(void)
 static void
 trace_dump_call_time(int64_t time)
 {
-   if (stream) {
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_CALL_END);
+      trace_binary_sint(time);
+   }
+   else if (stream) {
       trace_dump_indent(2);
       trace_dump_tag_begin("time");
       trace_dump_int(time);
@@ -261,6 +274,8 @@ trace_dump_trace_begin(void)
       return FALSE;
 
    if(!stream) {
+      binary = strcmp(debug_get_option("GALLIUM_TRACE_FORMAT", "xml"),
+                      "binary") == 0;
 
       if (strcmp(filename, "stderr") == 0) {
          close_stream = FALSE;
@@ -272,14 +287,26 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = TRUE;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, binary ? "wb" : "wt");
          if (!stream)
             return FALSE;
       }
 
-      trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
-      trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
-      trace_dump_writes("<trace version='0.1'>\n");
+      if (binary) {
+         if (!trace_binary_open(stream,
+                                debug_get_bool_option("GALLIUM_TRACE_THREAD",
+                                                      FALSE))) {
+            if (close_stream)
+               fclose(stream);
+            stream = NULL;
+            return FALSE;
+         }
+      }
+      else {
+         trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
+         trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
+         trace_dump_writes("<trace version='0.1'>\n");
+      }
 
       /* Many applications don't exit cleanly, others may create and destroy a
        * screen multiple times, so we only write </trace> tag and close at exit
@@ -364,6 +391,16 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_CALL_BEGIN);
+      trace_binary_uint(call_no);
+      trace_binary_name(klass);
+      trace_binary_name(method);
+      call_start_time = os_time_get();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -387,6 +424,9 @@ void trace_dump_call_end_locked(void)
    call_end_time = os_time_get();
 
    trace_dump_call_time(call_end_time - call_start_time);
+   if (binary)
+      return;
+
    trace_dump_indent(1);
    trace_dump_tag_end("call");
    trace_dump_newline();
@@ -410,13 +450,19 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_ARG);
+      trace_binary_name(name);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
 
 void trace_dump_arg_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("arg");
@@ -428,13 +474,18 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_RET);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
 
 void trace_dump_ret_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("ret");
@@ -446,6 +497,12 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_BOOL);
+      trace_binary_uint(value ? 1 : 0);
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -454,6 +511,12 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_INT);
+      trace_binary_sint(value);
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -462,6 +525,12 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_UINT);
+      trace_binary_uint(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -470,6 +539,12 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_FLOAT);
+      trace_binary_double(value);
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -483,6 +558,12 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_BYTES);
+      trace_binary_data(data, size);
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -527,6 +608,12 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_STRING);
+      trace_binary_data(str, strlen(str));
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -537,6 +624,12 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_ENUM);
+      trace_binary_name(value);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -547,6 +640,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_ARRAY_BEGIN);
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -555,12 +653,17 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_ARRAY_END);
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
 void trace_dump_elem_begin(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("<elem>");
@@ -568,7 +671,7 @@ void trace_dump_elem_begin(void)
 
 void trace_dump_elem_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</elem>");
@@ -579,6 +682,12 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_STRUCT_BEGIN);
+      trace_binary_name(name);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -587,6 +696,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_STRUCT_END);
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -595,12 +709,18 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_MEMBER);
+      trace_binary_name(name);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
 void trace_dump_member_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</member>");
@@ -611,6 +731,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_binary_op(TRACE_BINARY_NULL);
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -619,7 +744,11 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
-   if(value)
+   if (binary && value) {
+      trace_binary_op(TRACE_BINARY_PTR);
+      trace_binary_uint((uintptr_t)value);
+   }
+   else if(value)
       trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
    else
       trace_dump_null();
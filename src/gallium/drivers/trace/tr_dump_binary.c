@@ -0,0 +1,444 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace writer.
+ *
+ * Encoded calls are accumulated in fixed size chunks.  Without a writer
+ * thread full chunks are written out as is by the traced thread.  With one
+ * the traced thread only hands them over, and the writer thread compresses
+ * them before writing, so that tracing costs little more than the encoding
+ * itself.
+ */
+
+#include <string.h>
+
+#include "os/os_thread.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "tr_dump_binary.h"
+
+
+#define TRACE_BINARY_CHUNK_SIZE (256 * 1024)
+#define TRACE_BINARY_NUM_CHUNKS 4
+
+#define NAME_TABLE_SIZE 4096
+
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT 12
+#define LZ4_MAX_OFFSET 65535
+
+#define LZ4_COMPRESS_BOUND(size) ((size) + (size) / 255 + 16)
+
+
+static FILE *bin_stream = NULL;
+
+static uint8_t *chunk_data[TRACE_BINARY_NUM_CHUNKS];
+static unsigned chunk_size[TRACE_BINARY_NUM_CHUNKS];
+static unsigned chunk_current = 0;
+
+static boolean threaded = FALSE;
+static pipe_thread writer_thread;
+static pipe_semaphore chunk_filled;
+static pipe_semaphore chunk_free;
+static uint8_t *compressed = NULL;
+
+static const char *name_keys[NAME_TABLE_SIZE];
+static unsigned name_ids[NAME_TABLE_SIZE];
+static unsigned num_names = 0;
+static unsigned next_name_id = 0;
+
+
+static INLINE uint32_t
+read32(const uint8_t *p)
+{
+   uint32_t value;
+   memcpy(&value, p, sizeof value);
+   return value;
+}
+
+
+static uint8_t *
+lz4_length(uint8_t *op, unsigned length)
+{
+   while (length >= 255) {
+      *op++ = 255;
+      length -= 255;
+   }
+   *op++ = length;
+   return op;
+}
+
+
+static uint8_t *
+lz4_sequence(uint8_t *op, const uint8_t *literals, unsigned num_literals,
+             unsigned offset, unsigned match_length)
+{
+   uint8_t *token = op++;
+
+   if (num_literals >= 15) {
+      *token = 15 << 4;
+      op = lz4_length(op, num_literals - 15);
+   }
+   else {
+      *token = num_literals << 4;
+   }
+   memcpy(op, literals, num_literals);
+   op += num_literals;
+
+   if (!match_length)
+      return op;
+
+   *op++ = offset & 0xff;
+   *op++ = offset >> 8;
+
+   match_length -= LZ4_MIN_MATCH;
+   if (match_length >= 15) {
+      *token |= 15;
+      op = lz4_length(op, match_length - 15);
+   }
+   else {
+      *token |= match_length;
+   }
+   return op;
+}
+
+
+/**
+ * Greedy LZ4 block compressor.  It favours speed over ratio, but trace
+ * data is repetitive enough for that not to matter much.
+ */
+static unsigned
+lz4_compress(const uint8_t *src, unsigned size, uint8_t *dst)
+{
+   static uint32_t table[1 << LZ4_HASH_BITS];
+   uint8_t *op = dst;
+   unsigned ip = 0, anchor = 0;
+
+   memset(table, 0, sizeof table);
+
+   if (size > LZ4_MF_LIMIT) {
+      unsigned limit = size - LZ4_MF_LIMIT;
+      unsigned match_limit = size - LZ4_LAST_LITERALS;
+
+      while (ip < limit) {
+         uint32_t sequence = read32(src + ip);
+         unsigned hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+         unsigned ref = table[hash];
+         unsigned length;
+
+         /* Positions are stored one-based, zero means empty. */
+         table[hash] = ip + 1;
+         if (!ref || ip - (ref - 1) > LZ4_MAX_OFFSET ||
+             read32(src + ref - 1) != sequence) {
+            ip++;
+            continue;
+         }
+         ref--;
+
+         length = LZ4_MIN_MATCH;
+         while (ip + length < match_limit && src[ref + length] == src[ip + length])
+            length++;
+
+         op = lz4_sequence(op, src + anchor, ip - anchor, ip - ref, length);
+         ip += length;
+         anchor = ip;
+      }
+   }
+
+   op = lz4_sequence(op, src + anchor, size - anchor, 0, 0);
+   return op - dst;
+}
+
+
+static void
+write32(uint8_t *p, uint32_t value)
+{
+   p[0] = value;
+   p[1] = value >> 8;
+   p[2] = value >> 16;
+   p[3] = value >> 24;
+}
+
+
+static void
+trace_binary_write_chunk(const uint8_t *data, unsigned size)
+{
+   uint8_t header[8];
+   unsigned compressed_size = 0;
+
+   if (compressed) {
+      compressed_size = lz4_compress(data, size, compressed);
+      if (compressed_size < size)
+         data = compressed;
+      else
+         compressed_size = 0;
+   }
+
+   write32(header, size);
+   write32(header + 4, compressed_size);
+   fwrite(header, sizeof header, 1, bin_stream);
+   fwrite(data, compressed_size ? compressed_size : size, 1, bin_stream);
+}
+
+
+static PIPE_THREAD_ROUTINE(trace_binary_writer, param)
+{
+   unsigned index = 0;
+
+   while (1) {
+      pipe_semaphore_wait(&chunk_filled);
+
+      /* An empty chunk is only ever handed over to stop the thread. */
+      if (!chunk_size[index])
+         break;
+
+      trace_binary_write_chunk(chunk_data[index], chunk_size[index]);
+      chunk_size[index] = 0;
+      index = (index + 1) % TRACE_BINARY_NUM_CHUNKS;
+
+      pipe_semaphore_signal(&chunk_free);
+   }
+
+   fflush(bin_stream);
+   return NULL;
+}
+
+
+static void
+trace_binary_submit(void)
+{
+   if (threaded) {
+      pipe_semaphore_signal(&chunk_filled);
+      pipe_semaphore_wait(&chunk_free);
+      chunk_current = (chunk_current + 1) % TRACE_BINARY_NUM_CHUNKS;
+   }
+   else {
+      trace_binary_write_chunk(chunk_data[chunk_current],
+                               chunk_size[chunk_current]);
+      chunk_size[chunk_current] = 0;
+   }
+}
+
+
+static void
+trace_binary_write(const void *data, size_t size)
+{
+   const uint8_t *p = data;
+
+   while (size) {
+      unsigned used = chunk_size[chunk_current];
+      unsigned n = MIN2(size, TRACE_BINARY_CHUNK_SIZE - used);
+
+      memcpy(chunk_data[chunk_current] + used, p, n);
+      chunk_size[chunk_current] = used + n;
+      p += n;
+      size -= n;
+
+      if (chunk_size[chunk_current] == TRACE_BINARY_CHUNK_SIZE)
+         trace_binary_submit();
+   }
+}
+
+
+boolean
+trace_binary_open(FILE *stream, boolean thread)
+{
+   uint8_t version[4];
+   unsigned num_chunks = thread ? TRACE_BINARY_NUM_CHUNKS : 1;
+   unsigned i;
+
+   for (i = 0; i < num_chunks; i++) {
+      chunk_data[i] = MALLOC(TRACE_BINARY_CHUNK_SIZE);
+      chunk_size[i] = 0;
+      if (!chunk_data[i])
+         goto fail;
+   }
+
+   bin_stream = stream;
+   chunk_current = 0;
+
+   if (thread) {
+      compressed = MALLOC(LZ4_COMPRESS_BOUND(TRACE_BINARY_CHUNK_SIZE));
+      if (!compressed)
+         goto fail;
+
+      pipe_semaphore_init(&chunk_filled, 0);
+      pipe_semaphore_init(&chunk_free, TRACE_BINARY_NUM_CHUNKS - 1);
+      writer_thread = pipe_thread_create(trace_binary_writer, NULL);
+      threaded = TRUE;
+   }
+
+   write32(version, TRACE_BINARY_VERSION);
+   fwrite(TRACE_BINARY_MAGIC, 8, 1, stream);
+   fwrite(version, sizeof version, 1, stream);
+   return TRUE;
+
+fail:
+   FREE(compressed);
+   compressed = NULL;
+   for (i = 0; i < num_chunks; i++) {
+      FREE(chunk_data[i]);
+      chunk_data[i] = NULL;
+   }
+   bin_stream = NULL;
+   return FALSE;
+}
+
+
+void
+trace_binary_close(void)
+{
+   unsigned i;
+
+   if (!bin_stream)
+      return;
+
+   if (chunk_size[chunk_current])
+      trace_binary_submit();
+
+   if (threaded) {
+      pipe_semaphore_signal(&chunk_filled);
+      pipe_thread_wait(writer_thread);
+      pipe_semaphore_destroy(&chunk_filled);
+      pipe_semaphore_destroy(&chunk_free);
+      threaded = FALSE;
+   }
+   else {
+      fflush(bin_stream);
+   }
+
+   FREE(compressed);
+   compressed = NULL;
+   for (i = 0; i < TRACE_BINARY_NUM_CHUNKS; i++) {
+      FREE(chunk_data[i]);
+      chunk_data[i] = NULL;
+   }
+
+   memset(name_keys, 0, sizeof name_keys);
+   num_names = 0;
+   next_name_id = 0;
+   bin_stream = NULL;
+}
+
+
+void
+trace_binary_op(enum trace_binary_op op)
+{
+   uint8_t byte = op;
+   trace_binary_write(&byte, 1);
+}
+
+
+void
+trace_binary_uint(uint64_t value)
+{
+   uint8_t buf[10];
+   unsigned n = 0;
+
+   while (value >= 0x80) {
+      buf[n++] = (value & 0x7f) | 0x80;
+      value >>= 7;
+   }
+   buf[n++] = value;
+
+   trace_binary_write(buf, n);
+}
+
+
+void
+trace_binary_sint(int64_t value)
+{
+   trace_binary_uint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+void
+trace_binary_double(double value)
+{
+   uint64_t bits;
+   uint8_t buf[8];
+   unsigned i;
+
+   memcpy(&bits, &value, sizeof bits);
+   for (i = 0; i < 8; i++)
+      buf[i] = bits >> (8 * i);
+
+   trace_binary_write(buf, sizeof buf);
+}
+
+
+void
+trace_binary_data(const void *data, size_t size)
+{
+   trace_binary_uint(size);
+   trace_binary_write(data, size);
+}
+
+
+static INLINE unsigned
+name_hash(const char *name)
+{
+   return (unsigned)((uintptr_t)name >> 2) * 2654435761u;
+}
+
+
+void
+trace_binary_name(const char *name)
+{
+   unsigned i = name_hash(name);
+   size_t length;
+
+   for (;;) {
+      i &= NAME_TABLE_SIZE - 1;
+      if (name_keys[i] == name) {
+         trace_binary_uint(name_ids[i] + 1);
+         return;
+      }
+      if (!name_keys[i])
+         break;
+      i++;
+   }
+
+   /* The ids keep growing, so when the table fills up simply forget
+    * everything and send the names again.
+    */
+   if (num_names >= NAME_TABLE_SIZE / 2) {
+      memset(name_keys, 0, sizeof name_keys);
+      num_names = 0;
+      i = name_hash(name) & (NAME_TABLE_SIZE - 1);
+   }
+
+   name_keys[i] = name;
+   name_ids[i] = next_name_id++;
+   num_names++;
+
+   length = strlen(name);
+   trace_binary_uint(0);
+   trace_binary_data(name, length);
+}
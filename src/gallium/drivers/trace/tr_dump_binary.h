@@ -0,0 +1,107 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace encoding.
+ *
+ * A binary trace starts with TRACE_BINARY_MAGIC and a 32-bit version, and
+ * is followed by chunks.  Each chunk has a header with the raw size and
+ * the compressed size of its payload, both 32-bit little-endian.  A
+ * compressed size of zero means the payload is stored as is, otherwise it
+ * is a single LZ4 block.
+ *
+ * The payload is a stream of opcodes mirroring the XML elements.  Numbers
+ * are LEB128 varints, signed ones zigzag-encoded first.  Names (classes,
+ * methods, arguments, members, structs and enums) are sent in full the
+ * first time, as a zero followed by a length and the bytes, and then as
+ * their id plus one, ids being given out in order.  They must be string
+ * constants as they are looked up by address.
+ *
+ * Keep in sync with src/gallium/tools/trace/parse.py.
+ */
+
+#ifndef TR_DUMP_BINARY_H
+#define TR_DUMP_BINARY_H
+
+
+#include <stdio.h>
+
+#include "pipe/p_compiler.h"
+
+
+#define TRACE_BINARY_MAGIC "GTRACEB\n"
+#define TRACE_BINARY_VERSION 1
+
+
+enum trace_binary_op
+{
+   TRACE_BINARY_CALL_BEGIN = 0x01,  /* no, class name, method name */
+   TRACE_BINARY_CALL_END = 0x02,    /* signed time */
+   TRACE_BINARY_ARG = 0x03,         /* name, value */
+   TRACE_BINARY_RET = 0x04,         /* value */
+
+   TRACE_BINARY_NULL = 0x10,
+   TRACE_BINARY_BOOL = 0x11,        /* 0 or 1 */
+   TRACE_BINARY_INT = 0x12,         /* signed */
+   TRACE_BINARY_UINT = 0x13,        /* unsigned */
+   TRACE_BINARY_FLOAT = 0x14,       /* little-endian double */
+   TRACE_BINARY_STRING = 0x15,      /* length, bytes */
+   TRACE_BINARY_ENUM = 0x16,        /* name */
+   TRACE_BINARY_BYTES = 0x17,       /* length, bytes */
+   TRACE_BINARY_PTR = 0x18,         /* unsigned */
+   TRACE_BINARY_ARRAY_BEGIN = 0x19, /* values */
+   TRACE_BINARY_ARRAY_END = 0x1a,
+   TRACE_BINARY_STRUCT_BEGIN = 0x1b,/* name, members */
+   TRACE_BINARY_STRUCT_END = 0x1c,
+   TRACE_BINARY_MEMBER = 0x1d       /* name, value */
+};
+
+
+boolean
+trace_binary_open(FILE *stream, boolean threaded);
+
+void
+trace_binary_close(void);
+
+void
+trace_binary_op(enum trace_binary_op op);
+
+void
+trace_binary_uint(uint64_t value);
+
+void
+trace_binary_sint(int64_t value);
+
+void
+trace_binary_double(double value);
+
+void
+trace_binary_data(const void *data, size_t size);
+
+void
+trace_binary_name(const char *name);
+
+
+#endif /* TR_DUMP_BINARY_H */
@@ -169,6 +169,15 @@ struct pipe_context {
    void   (*bind_gs_state)(struct pipe_context *, void *);
    void   (*delete_gs_state)(struct pipe_context *, void *);
 
+   /**
+    * Size in bytes of the native code of a shader made by create_fs/vs/gs_state,
+    * for shader statistics.  Optional, -1 means the size isn't known.
+    *
+    * \param shader  PIPE_SHADER_x
+    */
+   int    (*get_shader_code_size)(struct pipe_context *, unsigned shader,
+                                  void *state);
+
    void * (*create_vertex_elements_state)(struct pipe_context *,
                                           unsigned num_elements,
                                           const struct pipe_vertex_element *);
@@ -56,6 +56,8 @@ struct pipe_fence_handle;
 struct pipe_resource;
 struct pipe_surface;
 struct pipe_transfer;
+struct pipe_box;
+struct tgsi_opcode_cost;
 
 
 /**
@@ -88,6 +90,15 @@ struct pipe_screen {
     */
    int (*get_shader_param)( struct pipe_screen *, unsigned shader, enum pipe_shader_cap param );
 
+   /**
+    * Adjust the relative cost of a TGSI opcode in the given shader stage,
+    * used by compiler heuristics.  \p cost holds the generic cost from
+    * tgsi_get_opcode_cost() on entry.  Optional.
+    */
+   void (*get_shader_opcode_cost)( struct pipe_screen *, unsigned shader,
+                                   unsigned opcode,
+                                   struct tgsi_opcode_cost *cost );
+
    /**
     * Query an integer-valued capability/parameter/limit for a codec/profile
     * \param param  one of PIPE_VIDEO_CAP_x
@@ -162,6 +173,20 @@ struct pipe_screen {
 						  const struct pipe_resource *templat,
 						  struct winsys_handle *handle);
 
+   /**
+    * Create a buffer whose storage is the given user memory, which must
+    * stay allocated until the buffer is destroyed.  Optional; drivers
+    * that can't map user memory leave it NULL or return NULL.
+    *
+    * Drivers may also accept single level 2D textures, in which case the
+    * memory holds the image tightly packed, with a row stride of
+    * util_format_get_stride(format, width0).  Drivers that would need
+    * another layout for the given template return NULL.
+    */
+   struct pipe_resource * (*resource_from_user_memory)(struct pipe_screen *,
+                                                       const struct pipe_resource *templat,
+                                                       void *user_memory);
+
    /**
     * Get a winsys_handle from a texture. Some platforms/winsys requires
     * that the texture is created with a special usage flag like
@@ -181,11 +206,14 @@ struct pipe_screen {
     * displayed, eg copy fake frontbuffer.
     * \param winsys_drawable_handle  an opaque handle that the calling context
     *                                gets out-of-band
+    * \param sub_box  the region of the resource that changed and needs to
+    *                 be displayed, or NULL for the whole resource
     */
    void (*flush_frontbuffer)( struct pipe_screen *screen,
                               struct pipe_resource *resource,
                               unsigned level, unsigned layer,
-                              void *winsys_drawable_handle );
+                              void *winsys_drawable_handle,
+                              struct pipe_box *sub_box );
 
 
 
@@ -210,6 +210,7 @@ struct pipe_shader_state
 {
    const struct tgsi_token *tokens;
    struct pipe_stream_output_info stream_output;
+   uint64_t hash;  /**< tgsi_hash_tokens() of tokens, or 0 if not known */
 };
 
 
@@ -13,6 +13,14 @@ struct drisw_loader_funcs
 {
    void (*put_image) (struct dri_drawable *dri_drawable,
                       void *data, unsigned width, unsigned height);
+
+   /**
+    * Optional.  If set, the winsys allocates the display targets in SysV
+    * shared memory and presents them with this instead of put_image.
+    */
+   void (*put_image_shm) (struct dri_drawable *dri_drawable,
+                          int shmid, char *shmaddr, unsigned offset,
+                          unsigned width, unsigned height, unsigned stride);
 };
 
 /**
@@ -159,6 +159,7 @@ enum st_context_resource_type {
  */
 #define ST_FLUSH_FRONT                    (1 << 0)
 #define ST_FLUSH_END_OF_FRAME             (1 << 1)
+#define ST_FLUSH_DEFERRED                 (1 << 2)
 
 /**
  * Value to st_manager->get_param function.
@@ -245,6 +246,7 @@ struct st_config_options
    boolean force_glsl_extensions_warn;
    unsigned force_glsl_version;
    boolean force_s3tc_enable;
+   boolean discard_glsl_ir;
 };
 
 /**
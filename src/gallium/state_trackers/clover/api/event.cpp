@@ -177,12 +177,19 @@ clEnqueueMarker(cl_command_queue q, cl_event *ev) try {
 }
 
 PUBLIC cl_int
-clEnqueueBarrier(cl_command_queue q) {
+clEnqueueBarrier(cl_command_queue q) try {
    if (!q)
-      return CL_INVALID_COMMAND_QUEUE;
+      throw error(CL_INVALID_COMMAND_QUEUE);
+
+   // In order queues preserve data ordering strictly, out of order
+   // queues need an event the commands queued later depend on.
+   if (q->props() & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)
+      ref_ptr<hard_event> hev = transfer(new hard_event(*q, 0, { }));
 
-   // No need to do anything, q preserves data ordering strictly.
    return CL_SUCCESS;
+
+} catch(error &e) {
+   return e.get();
 }
 
 PUBLIC cl_int
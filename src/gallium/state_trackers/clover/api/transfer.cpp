@@ -120,6 +120,20 @@ namespace {
       };
    }
 
+   ///
+   /// Write from host memory \a src_ptr to the buffer \a dst_obj through
+   /// the driver, so the write can overlap with commands still using
+   /// the buffer.
+   ///
+   std::function<void (event &)>
+   hard_write_op(cl_command_queue q, memory_obj *dst_obj, size_t dst_offset,
+                 const void *src_ptr, size_t size) {
+      return [=](event &) {
+         dst_obj->resource(q).write(*q, { dst_offset }, { size, 1, 1 },
+                                    src_ptr, size, size);
+      };
+   }
+
    ///
    /// Hardware copy from \a src_obj to \a dst_obj.
    ///
@@ -172,10 +186,7 @@ clEnqueueWriteBuffer(cl_command_queue q, cl_mem obj, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       *q, CL_COMMAND_WRITE_BUFFER, { deps, deps + num_deps },
-      soft_copy_op(q,
-                   obj, { offset }, { 1 },
-                   ptr, { 0 }, { 1 },
-                   { size, 1, 1 }));
+      hard_write_op(q, obj, offset, ptr, size));
 
    ret_object(ev, hev);
    return CL_SUCCESS;
@@ -59,6 +59,10 @@ namespace clover {
                                const compat::string &opts);
 
    module compile_program_tgsi(const compat::string &source);
+
+   /// Identify the LLVM compiler, so that cached modules built by a
+   /// different one are not reused.
+   compat::string compiler_version_llvm();
 }
 
 #endif
@@ -147,7 +147,7 @@ _cl_kernel::exec_context::bind(clover::command_queue *__q) {
    std::swap(q, __q);
 
    // Bind kernel arguments.
-   auto margs = kern.module(*q).sym(kern.name()).args;
+   const auto &margs = kern.module(*q).sym(kern.name()).args;
    for_each([=](std::unique_ptr<kernel::argument> &karg,
                 const module::argument &marg) {
          karg->bind(*this, marg);
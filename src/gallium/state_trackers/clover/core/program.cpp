@@ -22,9 +22,104 @@
 
 #include "core/program.hpp"
 #include "core/compiler.hpp"
+#include "util/u_disk_cache.h"
+#include "util/u_memory.h"
+
+#ifdef PACKAGE_VERSION
+#define CLOVER_CACHE_VERSION PACKAGE_VERSION
+#else
+#define CLOVER_CACHE_VERSION ""
+#endif
 
 using namespace clover;
 
+namespace {
+   ///
+   /// Persistent cache of the modules built from source, stored in the
+   /// same serialized format as CL_PROGRAM_BINARIES.  Disabled unless
+   /// MESA_SHADER_CACHE_DIR is set.  Like the devices it is never freed.
+   ///
+   struct u_disk_cache *
+   disk_cache() {
+      static struct u_disk_cache *cache = u_disk_cache_create("clover");
+      return cache;
+   }
+
+   void
+   append_key(std::string &key, const std::string &s) {
+      uint32_t n = s.size();
+
+      key.append(reinterpret_cast<const char *>(&n), sizeof(n));
+      key.append(s);
+   }
+
+   ///
+   /// Everything the LLVM build depends on.  Returns an empty key if the
+   /// module can't be cached because its options name include
+   /// directories, whose headers may change behind our back.
+   ///
+   std::string
+   cache_key(clover::device *dev, const std::string &source,
+             const std::string &opts) {
+      std::string key;
+
+      if (opts.find("-I") != std::string::npos)
+         return key;
+
+      append_key(key, CLOVER_CACHE_VERSION);
+      append_key(key, compiler_version_llvm());
+      append_key(key, dev->vendor_name());
+      append_key(key, dev->device_name());
+      append_key(key, std::to_string(dev->ir_format()));
+      append_key(key, dev->ir_target());
+      append_key(key, opts);
+      append_key(key, source);
+      return key;
+   }
+
+   module
+   compile_program_cached(clover::device *dev, const std::string &source,
+                          const std::string &opts) {
+      struct u_disk_cache *cache = disk_cache();
+      std::string key = (cache ? cache_key(dev, source, opts) : "");
+
+      if (!key.empty()) {
+         unsigned size;
+         void *data = u_disk_cache_get(cache, key.data(), key.size(), &size);
+
+         if (data) {
+            try {
+               compat::istream::buffer_t bin(
+                  static_cast<const unsigned char *>(data), size);
+               compat::istream s(bin);
+               module m = module::deserialize(s);
+
+               FREE(data);
+               return m;
+
+            } catch (compat::istream::error &e) {
+               // Truncated entry, rebuild it.
+               FREE(data);
+            }
+         }
+      }
+
+      module m = compile_program_llvm(source, dev->ir_format(),
+                                      dev->ir_target(), opts);
+
+      if (!key.empty()) {
+         compat::ostream::buffer_t bin;
+         compat::ostream s(bin);
+
+         m.serialize(s);
+         u_disk_cache_put(cache, key.data(), key.size(),
+                          bin.begin(), bin.size());
+      }
+
+      return m;
+   }
+}
+
 _cl_program::_cl_program(clover::context &ctx,
                          const std::string &source) :
    ctx(ctx), __source(source) {
@@ -53,8 +148,8 @@ _cl_program::build(const std::vector<clover::device *> &devs,
       try {
          auto module = (dev->ir_format() == PIPE_SHADER_IR_TGSI ?
                         compile_program_tgsi(__source) :
-                        compile_program_llvm(__source, dev->ir_format(),
-                        dev->ir_target(), build_opts(dev)));
+                        compile_program_cached(dev, __source,
+                                               build_opts(dev)));
          __binaries.insert({ dev, module });
 
       } catch (build_error &e) {
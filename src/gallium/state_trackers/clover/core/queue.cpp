@@ -47,10 +47,12 @@ _cl_command_queue::flush() {
    pipe_fence_handle *fence = NULL;
 
    if (!queued_events.empty()) {
-      // Find out which events have already been signalled.
+      // Find out which events have already been signalled.  Out of
+      // order queues may have signalled events after pending ones.
       auto first = queued_events.begin();
-      auto last = std::find_if(queued_events.begin(), queued_events.end(),
-                               [](event_ptr &ev) { return !ev->signalled(); });
+      auto last = std::stable_partition(
+         queued_events.begin(), queued_events.end(),
+         [](const event_ptr &ev) { return ev->signalled(); });
 
       // Flush and fence them.
       pipe->flush(pipe, &fence, 0);
@@ -58,12 +60,29 @@ _cl_command_queue::flush() {
       screen->fence_reference(screen, &fence, NULL);
       queued_events.erase(first, last);
    }
+
+   if (barrier && barrier->signalled())
+      barrier.reset();
 }
 
 void
 _cl_command_queue::sequence(clover::hard_event *ev) {
-   if (!queued_events.empty())
+   if (__props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) {
+      // Markers, barriers and waits are ordered with respect to
+      // everything, other commands only with respect to them.
+      if (ev->command() == CL_COMMAND_MARKER || !ev->command()) {
+         for (auto &qev : queued_events)
+            qev->chain(ev);
+
+         barrier = ev;
+
+      } else if (barrier) {
+         barrier->chain(ev);
+      }
+
+   } else if (!queued_events.empty()) {
       queued_events.back()->chain(ev);
+   }
 
    queued_events.push_back(ev);
 }
@@ -59,7 +59,8 @@ public:
 
 private:
    /// Serialize a hardware event with respect to the previous ones,
-   /// and push it to the pending list.
+   /// and push it to the pending list.  Out of order queues only
+   /// serialize events with respect to the last barrier.
    void sequence(clover::hard_event *ev);
 
    cl_command_queue_properties __props;
@@ -67,6 +68,7 @@ private:
 
    typedef clover::ref_ptr<clover::hard_event> event_ptr;
    std::vector<event_ptr> queued_events;
+   event_ptr barrier;
 };
 
 #endif
@@ -62,6 +62,24 @@ resource::copy(command_queue &q, const point &origin, const point &region,
                                 box(src_res.offset + src_origin, region));
 }
 
+void
+resource::write(command_queue &q, const point &origin, const point &region,
+                const void *data, size_t row_pitch, size_t slice_pitch) {
+   point p = offset + origin;
+   unsigned usage = PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DISCARD_RANGE;
+
+   // The whole storage can be renamed unless the application holds a
+   // mapping of it, which sub-resources can't tell.
+   if (dynamic_cast<root_resource *>(this) && maps.empty() &&
+       !p[0] && !p[1] && !p[2] &&
+       region[0] == pipe->width0 && region[1] == pipe->height0 &&
+       region[2] == pipe->depth0)
+      usage |= PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE;
+
+   q.pipe->transfer_inline_write(q.pipe, pipe, 0, usage, box(p, region),
+                                 data, row_pitch, slice_pitch);
+}
+
 void *
 resource::add_map(command_queue &q, cl_map_flags flags, bool blocking,
                   const point &origin, const point &region) {
@@ -137,6 +155,18 @@ root_resource::root_resource(clover::device &dev, clover::memory_obj &obj,
                 PIPE_BIND_TRANSFER_READ |
                 PIPE_BIND_TRANSFER_WRITE);
 
+   // Buffers can use the host memory as storage directly, if the
+   // driver is able to.
+   bool use_host_ptr = (obj.flags() & CL_MEM_USE_HOST_PTR);
+
+   if (use_host_ptr && info.target == PIPE_BUFFER &&
+       dev.pipe->resource_from_user_memory) {
+      pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info,
+                                                 obj.host_ptr());
+      if (pipe)
+         return;
+   }
+
    pipe = dev.pipe->resource_create(dev.pipe, &info);
    if (!pipe)
       throw error(CL_OUT_OF_RESOURCES);
@@ -148,6 +178,16 @@ root_resource::root_resource(clover::device &dev, clover::memory_obj &obj,
       q.pipe->transfer_inline_write(q.pipe, pipe, 0, PIPE_TRANSFER_WRITE,
                                     rect, data.data(), cpp * info.width0,
                                     cpp * info.width0 * info.height0);
+
+   } else if (use_host_ptr) {
+      // Otherwise start from a copy of the host memory.
+      box rect { { 0, 0, 0 }, { info.width0, info.height0, info.depth0 } };
+      image *img = dynamic_cast<image *>(&obj);
+
+      q.pipe->transfer_inline_write(q.pipe, pipe, 0, PIPE_TRANSFER_WRITE,
+                                    rect, obj.host_ptr(),
+                                    img ? img->row_pitch() : obj.size(),
+                                    img ? img->slice_pitch() : obj.size());
    }
 }
 
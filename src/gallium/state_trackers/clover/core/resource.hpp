@@ -47,6 +47,11 @@ namespace clover {
       void copy(command_queue &q, const point &origin, const point &region,
                 resource &src_resource, const point &src_origin);
 
+      /// Write \a data to the resource without waiting for the commands
+      /// using it to complete, the driver stages the data if needed.
+      void write(command_queue &q, const point &origin, const point &region,
+                 const void *data, size_t row_pitch, size_t slice_pitch);
+
       void *add_map(command_queue &q, cl_map_flags flags, bool blocking,
                     const point &origin, const point &region);
       void del_map(void *p);
@@ -386,6 +386,14 @@ namespace {
    }
 } // End anonymous namespace
 
+#define __CLOVER_STR(x) #x
+#define CLOVER_STR(x) __CLOVER_STR(x)
+
+compat::string
+clover::compiler_version_llvm() {
+   return "llvm-" CLOVER_STR(HAVE_LLVM);
+}
+
 module
 clover::compile_program_llvm(const compat::string &source,
                              enum pipe_shader_ir ir,
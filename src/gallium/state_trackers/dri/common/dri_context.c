@@ -54,6 +54,8 @@ static void dri_fill_st_options(struct st_config_options *options,
       driQueryOptioni(optionCache, "force_glsl_version");
    options->force_s3tc_enable =
       driQueryOptionb(optionCache, "force_s3tc_enable");
+   options->discard_glsl_ir =
+      driQueryOptionb(optionCache, "discard_glsl_ir");
 }
 
 GLboolean
@@ -69,6 +69,7 @@ PUBLIC const char __driConfigOptions[] =
 
       DRI_CONF_SECTION_MISCELLANEOUS
          DRI_CONF_ALWAYS_HAVE_DEPTH_BUFFER("false")
+         DRI_CONF_DISCARD_GLSL_IR("false")
       DRI_CONF_SECTION_END
    DRI_CONF_END;
 
@@ -608,6 +608,10 @@ egl_g3d_initialize(_EGLDriver *drv, _EGLDisplay *dpy)
       dpy->Extensions.NV_post_sub_buffer = EGL_TRUE;
    }
 
+   /* backends without region support present the whole surface */
+   dpy->Extensions.EXT_buffer_age = EGL_TRUE;
+   dpy->Extensions.EXT_swap_buffers_with_damage = EGL_TRUE;
+
    if (egl_g3d_add_configs(drv, dpy, 1) == 1) {
       _eglError(EGL_NOT_INITIALIZED, "eglInitialize(unable to add configs)");
       goto fail;
@@ -605,6 +605,55 @@ egl_g3d_swap_buffers_region(_EGLDriver *drv, _EGLDisplay *dpy, _EGLSurface *surf
 }
 #endif /* EGL_NOK_swap_region */
 
+#ifdef EGL_EXT_swap_buffers_with_damage
+static EGLBoolean
+egl_g3d_swap_buffers_with_damage(_EGLDriver *drv, _EGLDisplay *dpy,
+                                 _EGLSurface *surf,
+                                 const EGLint *rects, EGLint n_rects)
+{
+   struct egl_g3d_surface *gsurf = egl_g3d_surface(surf);
+   EGLint *flipped = NULL;
+   EGLBoolean ret;
+   EGLint i;
+
+   if (n_rects) {
+      flipped = MALLOC(n_rects * 4 * sizeof(*flipped));
+      if (!flipped)
+         return _eglError(EGL_BAD_ALLOC, "eglSwapBuffersWithDamageEXT");
+
+      /* Note: y=0=bottom */
+      for (i = 0; i < n_rects; i++) {
+         flipped[i * 4 + 0] = rects[i * 4 + 0];
+         flipped[i * 4 + 1] = surf->Height - rects[i * 4 + 1] - rects[i * 4 + 3];
+         flipped[i * 4 + 2] = rects[i * 4 + 2];
+         flipped[i * 4 + 3] = rects[i * 4 + 3];
+      }
+   }
+
+   ret = swap_buffers(drv, dpy, surf, n_rects, flipped,
+                      (gsurf->base.SwapBehavior == EGL_BUFFER_PRESERVED));
+
+   FREE(flipped);
+
+   return ret;
+}
+#endif /* EGL_EXT_swap_buffers_with_damage */
+
+static EGLint
+egl_g3d_query_buffer_age(_EGLDriver *drv, _EGLDisplay *dpy,
+                         _EGLSurface *surf)
+{
+   struct egl_g3d_surface *gsurf = egl_g3d_surface(surf);
+
+   /* only window surfaces have back buffers to age */
+   if (gsurf->base.Type != EGL_WINDOW_BIT ||
+       gsurf->stvis.render_buffer == ST_ATTACHMENT_FRONT_LEFT ||
+       !gsurf->native->query_buffer_age)
+      return 0;
+
+   return gsurf->native->query_buffer_age(gsurf->native);
+}
+
 static EGLBoolean
 egl_g3d_post_sub_buffer(_EGLDriver *drv, _EGLDisplay *dpy, _EGLSurface *surf,
                         EGLint x, EGLint y, EGLint width, EGLint height)
@@ -935,6 +984,10 @@ egl_g3d_init_driver_api(_EGLDriver *drv)
 #ifdef EGL_NOK_swap_region
    drv->API.SwapBuffersRegionNOK = egl_g3d_swap_buffers_region;
 #endif
+#ifdef EGL_EXT_swap_buffers_with_damage
+   drv->API.SwapBuffersWithDamageEXT = egl_g3d_swap_buffers_with_damage;
+#endif
 
    drv->API.PostSubBufferNV = egl_g3d_post_sub_buffer;
+   drv->API.QueryBufferAge = egl_g3d_query_buffer_age;
 }
@@ -145,6 +145,12 @@ struct native_surface {
     * Wait until all native commands affecting the surface has been executed.
     */
    void (*wait)(struct native_surface *nsurf);
+
+   /**
+    * Return the age of the back buffer as defined by EGL_EXT_buffer_age, or
+    * 0 when its contents are unknown.  It is optional.
+    */
+   int (*query_buffer_age)(struct native_surface *nsurf);
 };
 
 /**
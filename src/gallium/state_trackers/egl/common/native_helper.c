@@ -52,6 +52,13 @@ struct resource_surface {
    uint resource_mask;
    uint width, height;
 
+   /**
+    * Number of frames presented, and the frame whose contents each of the
+    * resources holds (0 when unknown).  They give the buffer ages.
+    */
+   unsigned int frame;
+   unsigned int content_frames[NUM_NATIVE_ATTACHMENTS];
+
    /**
     * Swap fences.
     */
@@ -91,6 +98,7 @@ resource_surface_free_resources(struct resource_surface *rsurf)
       for (i = 0; i < NUM_NATIVE_ATTACHMENTS; i++) {
          if (rsurf->resources[i])
             pipe_resource_reference(&rsurf->resources[i], NULL);
+         rsurf->content_frames[i] = 0;
       }
       rsurf->resource_mask = 0x0;
    }
@@ -158,6 +166,7 @@ resource_surface_add_resources(struct resource_surface *rsurf,
 
          rsurf->resources[i] =
             rsurf->screen->resource_create(rsurf->screen, &templ);
+         rsurf->content_frames[i] = 0;
          if (rsurf->resources[i])
             rsurf->resource_mask |= 1 << i;
       }
@@ -173,6 +182,7 @@ resource_surface_import_resource(struct resource_surface *rsurf,
 {
 	pipe_resource_reference(&rsurf->resources[which], pres);
 	rsurf->resource_mask |= 1 << which;
+	rsurf->content_frames[which] = 0;
 }
 
 void
@@ -215,6 +225,7 @@ resource_surface_swap_buffers(struct resource_surface *rsurf,
 {
    const uint buf1_bit = 1 << buf1;
    const uint buf2_bit = 1 << buf2;
+   unsigned int content_frame;
    uint mask;
 
    if (only_if_exist && !(rsurf->resources[buf1] && rsurf->resources[buf2]))
@@ -223,6 +234,10 @@ resource_surface_swap_buffers(struct resource_surface *rsurf,
    pointer_swap((const void **) &rsurf->resources[buf1],
                 (const void **) &rsurf->resources[buf2]);
 
+   content_frame = rsurf->content_frames[buf1];
+   rsurf->content_frames[buf1] = rsurf->content_frames[buf2];
+   rsurf->content_frames[buf2] = content_frame;
+
    /* swap mask bits */
    mask = rsurf->resource_mask & ~(buf1_bit | buf2_bit);
    if (rsurf->resource_mask & buf1_bit)
@@ -233,18 +248,80 @@ resource_surface_swap_buffers(struct resource_surface *rsurf,
    rsurf->resource_mask = mask;
 }
 
+void
+resource_surface_mark_presented(struct resource_surface *rsurf,
+                                enum native_attachment which)
+{
+   rsurf->content_frames[which] = ++rsurf->frame;
+}
+
+int
+resource_surface_get_buffer_age(struct resource_surface *rsurf,
+                                enum native_attachment which)
+{
+   if (!rsurf->resources[which] || !rsurf->content_frames[which])
+      return 0;
+
+   return rsurf->frame - rsurf->content_frames[which] + 1;
+}
+
+/**
+ * Return the bounding box of the rectangles, clipped to the surface.
+ * FALSE is returned when nothing is left.
+ */
+static boolean
+resource_surface_get_region_box(struct resource_surface *rsurf,
+                                int num_rects, const int *rects,
+                                struct pipe_box *box)
+{
+   int x0 = rsurf->width, y0 = rsurf->height, x1 = 0, y1 = 0;
+   int i;
+
+   for (i = 0; i < num_rects; i++) {
+      const int *rect = &rects[i * 4];
+
+      x0 = MIN2(x0, rect[0]);
+      y0 = MIN2(y0, rect[1]);
+      x1 = MAX2(x1, rect[0] + rect[2]);
+      y1 = MAX2(y1, rect[1] + rect[3]);
+   }
+
+   x0 = MAX2(x0, 0);
+   y0 = MAX2(y0, 0);
+   x1 = MIN2(x1, (int) rsurf->width);
+   y1 = MIN2(y1, (int) rsurf->height);
+   if (x0 >= x1 || y0 >= y1)
+      return FALSE;
+
+   u_box_2d(x0, y0, x1 - x0, y1 - y0, box);
+
+   return TRUE;
+}
+
 boolean
 resource_surface_present(struct resource_surface *rsurf,
                          enum native_attachment which,
+                         int num_rects, const int *rects,
                          void *winsys_drawable_handle)
 {
    struct pipe_resource *pres = rsurf->resources[which];
+   struct pipe_box box;
 
    if (!pres)
       return TRUE;
 
-   rsurf->screen->flush_frontbuffer(rsurf->screen,
-         pres, 0, 0, winsys_drawable_handle);
+   if (num_rects) {
+      if (resource_surface_get_region_box(rsurf, num_rects, rects, &box)) {
+         rsurf->screen->flush_frontbuffer(rsurf->screen,
+               pres, 0, 0, winsys_drawable_handle, &box);
+      }
+   }
+   else {
+      rsurf->screen->flush_frontbuffer(rsurf->screen,
+            pres, 0, 0, winsys_drawable_handle, NULL);
+   }
+
+   resource_surface_mark_presented(rsurf, which);
 
    return TRUE;
 }
@@ -255,7 +332,8 @@ resource_surface_present(struct resource_surface *rsurf,
  */
 boolean
 resource_surface_copy_swap(struct resource_surface *rsurf,
-			   struct native_display *ndpy)
+			   struct native_display *ndpy,
+			   int num_rects, const int *rects)
 {
    struct pipe_resource *ftex;
    struct pipe_resource *btex;
@@ -276,9 +354,20 @@ resource_surface_copy_swap(struct resource_surface *rsurf,
    if (!btex)
       goto out_no_btex;
 
-   u_box_origin_2d(ftex->width0, ftex->height0, &src_box);
-   pipe->resource_copy_region(pipe, ftex, 0, 0, 0, 0,
-			      btex, 0, &src_box);
+   if (!num_rects) {
+      u_box_origin_2d(ftex->width0, ftex->height0, &src_box);
+      pipe->resource_copy_region(pipe, ftex, 0, 0, 0, 0,
+				 btex, 0, &src_box);
+   }
+   else if (resource_surface_get_region_box(rsurf, num_rects, rects,
+					    &src_box)) {
+      pipe->resource_copy_region(pipe, ftex, 0, src_box.x, src_box.y, 0,
+				 btex, 0, &src_box);
+   }
+
+   /* both buffers now hold the presented frame */
+   resource_surface_mark_presented(rsurf, NATIVE_ATTACHMENT_BACK_LEFT);
+   rsurf->content_frames[NATIVE_ATTACHMENT_FRONT_LEFT] = rsurf->frame;
    ret = TRUE;
 
  out_no_btex:
@@ -71,18 +71,42 @@ resource_surface_swap_buffers(struct resource_surface *rsurf,
                               enum native_attachment buf2,
                               boolean only_if_exist);
 
+/**
+ * Record that the contents of the given attachment have been presented as
+ * a new frame.  resource_surface_present and resource_surface_copy_swap do
+ * this themselves.
+ */
+void
+resource_surface_mark_presented(struct resource_surface *rsurf,
+                                enum native_attachment which);
+
+/**
+ * Return the age of the contents of the given attachment, as defined by
+ * EGL_EXT_buffer_age, or 0 when they are unknown.
+ */
+int
+resource_surface_get_buffer_age(struct resource_surface *rsurf,
+                                enum native_attachment which);
+
+/**
+ * Present the given attachment.  When num_rects is not 0, only the region
+ * covered by the rects (x, y, width, height, y=0=top) needs to be updated.
+ */
 boolean
 resource_surface_present(struct resource_surface *rsurf,
                          enum native_attachment which,
+                         int num_rects, const int *rects,
                          void *winsys_drawable_handle);
 
 /**
  * Perform a gallium copy blit between the back left and front left
- * surfaces. Needs to be followed by a call to resource_surface_flush.
+ * surfaces, limited to the rects when num_rects is not 0. Needs to be
+ * followed by a call to resource_surface_flush.
  */
 boolean
 resource_surface_copy_swap(struct resource_surface *rsurf,
-			   struct native_display *ndpy);
+			   struct native_display *ndpy,
+			   int num_rects, const int *rects);
 
 /**
  * Throttle on outstanding rendering using the copy context. For example
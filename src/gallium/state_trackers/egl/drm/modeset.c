@@ -118,31 +118,54 @@ drm_surface_init_framebuffers(struct native_surface *nsurf, boolean need_back)
 }
 
 static boolean
-drm_surface_flush_frontbuffer(struct native_surface *nsurf)
+drm_surface_flush_frontbuffer(struct native_surface *nsurf,
+                              int num_rects, const int *rects)
 {
 #ifdef DRM_MODE_FEATURE_DIRTYFB
    struct drm_surface *drmsurf = drm_surface(nsurf);
    struct drm_display *drmdpy = drmsurf->drmdpy;
+   drmModeClip clips[16], *clip = NULL;
+   int i;
+
+   if (!drmsurf->front_fb.is_passive)
+      return TRUE;
 
-   if (drmsurf->front_fb.is_passive)
-      drmModeDirtyFB(drmdpy->fd, drmsurf->front_fb.buffer_id, NULL, 0);
+   /* mark only the given rects dirty */
+   if (num_rects > 0 && num_rects <= (int) Elements(clips)) {
+      for (i = 0; i < num_rects; i++) {
+         const int *rect = &rects[i * 4];
+
+         clips[i].x1 = MAX2(rect[0], 0);
+         clips[i].y1 = MAX2(rect[1], 0);
+         clips[i].x2 = MIN2(rect[0] + rect[2], (int) drmsurf->width);
+         clips[i].y2 = MIN2(rect[1] + rect[3], (int) drmsurf->height);
+      }
+      clip = clips;
+   }
+   else {
+      num_rects = 0;
+   }
+
+   drmModeDirtyFB(drmdpy->fd, drmsurf->front_fb.buffer_id, clip, num_rects);
 #endif
 
    return TRUE;
 }
 
 static boolean
-drm_surface_copy_swap(struct native_surface *nsurf)
+drm_surface_copy_swap(struct native_surface *nsurf,
+                      int num_rects, const int *rects)
 {
    struct drm_surface *drmsurf = drm_surface(nsurf);
    struct drm_display *drmdpy = drmsurf->drmdpy;
 
    (void) resource_surface_throttle(drmsurf->rsurf);
-   if (!resource_surface_copy_swap(drmsurf->rsurf, &drmdpy->base))
+   if (!resource_surface_copy_swap(drmsurf->rsurf, &drmdpy->base,
+                                   num_rects, rects))
       return FALSE;
 
    (void) resource_surface_flush(drmsurf->rsurf, &drmdpy->base);
-   if (!drm_surface_flush_frontbuffer(nsurf))
+   if (!drm_surface_flush_frontbuffer(nsurf, num_rects, rects))
       return FALSE;
 
    drmsurf->sequence_number++;
@@ -151,7 +174,8 @@ drm_surface_copy_swap(struct native_surface *nsurf)
 }
 
 static boolean
-drm_surface_swap_buffers(struct native_surface *nsurf)
+drm_surface_swap_buffers(struct native_surface *nsurf,
+                         int num_rects, const int *rects)
 {
    struct drm_surface *drmsurf = drm_surface(nsurf);
    struct drm_crtc *drmcrtc = &drmsurf->current_crtc;
@@ -160,7 +184,7 @@ drm_surface_swap_buffers(struct native_surface *nsurf)
    int err;
 
    if (!drmsurf->have_pageflip)
-      return drm_surface_copy_swap(nsurf);
+      return drm_surface_copy_swap(nsurf, num_rects, rects);
 
    if (!drmsurf->back_fb.buffer_id) {
       if (!drm_surface_init_framebuffers(&drmsurf->base, TRUE))
@@ -172,7 +196,7 @@ drm_surface_swap_buffers(struct native_surface *nsurf)
 			    drmsurf->back_fb.buffer_id, 0, NULL);
       if (err) {
 	 drmsurf->have_pageflip = FALSE;
-         return drm_surface_copy_swap(nsurf);
+         return drm_surface_copy_swap(nsurf, num_rects, rects);
       }
    }
 
@@ -181,6 +205,7 @@ drm_surface_swap_buffers(struct native_surface *nsurf)
    drmsurf->front_fb = drmsurf->back_fb;
    drmsurf->back_fb = tmp_fb;
 
+   resource_surface_mark_presented(drmsurf->rsurf, NATIVE_ATTACHMENT_BACK_LEFT);
    resource_surface_swap_buffers(drmsurf->rsurf,
          NATIVE_ATTACHMENT_FRONT_LEFT, NATIVE_ATTACHMENT_BACK_LEFT, FALSE);
    /* the front/back textures are swapped */
@@ -202,13 +227,14 @@ drm_surface_present(struct native_surface *nsurf,
 
    switch (ctrl->natt) {
    case NATIVE_ATTACHMENT_FRONT_LEFT:
-      ret = drm_surface_flush_frontbuffer(nsurf);
+      ret = drm_surface_flush_frontbuffer(nsurf,
+            ctrl->num_rects, ctrl->rects);
       break;
    case NATIVE_ATTACHMENT_BACK_LEFT:
       if (ctrl->preserve)
-	 ret = drm_surface_copy_swap(nsurf);
+	 ret = drm_surface_copy_swap(nsurf, ctrl->num_rects, ctrl->rects);
       else
-	 ret = drm_surface_swap_buffers(nsurf);
+	 ret = drm_surface_swap_buffers(nsurf, ctrl->num_rects, ctrl->rects);
       break;
    default:
       ret = FALSE;
@@ -226,6 +252,15 @@ drm_surface_wait(struct native_surface *nsurf)
    resource_surface_wait(drmsurf->rsurf);
 }
 
+static int
+drm_surface_query_buffer_age(struct native_surface *nsurf)
+{
+   struct drm_surface *drmsurf = drm_surface(nsurf);
+
+   return resource_surface_get_buffer_age(drmsurf->rsurf,
+         NATIVE_ATTACHMENT_BACK_LEFT);
+}
+
 static void
 drm_surface_destroy(struct native_surface *nsurf)
 {
@@ -283,6 +318,7 @@ drm_display_create_surface(struct native_display *ndpy,
    drmsurf->base.present = drm_surface_present;
    drmsurf->base.validate = drm_surface_validate;
    drmsurf->base.wait = drm_surface_wait;
+   drmsurf->base.query_buffer_age = drm_surface_query_buffer_age;
 
    return drmsurf;
 }
@@ -318,6 +354,7 @@ drm_display_create_surface_from_resource(struct native_display *ndpy,
    drmsurf->base.present = drm_surface_present;
    drmsurf->base.validate = drm_surface_validate;
    drmsurf->base.wait = drm_surface_wait;
+   drmsurf->base.query_buffer_age = drm_surface_query_buffer_age;
 
    return &drmsurf->base;
 }
@@ -106,6 +106,10 @@ drm_display_get_param(struct native_display *ndpy,
    int val;
 
    switch (param) {
+   case NATIVE_PARAM_PRESENT_REGION:
+      /* the copies and the dirty fb are limited to the region */
+      val = TRUE;
+      break;
    case NATIVE_PARAM_USE_NATIVE_BUFFER:
    case NATIVE_PARAM_PRESERVE_BUFFER:
    case NATIVE_PARAM_MAX_SWAP_INTERVAL:
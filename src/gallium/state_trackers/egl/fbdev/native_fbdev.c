@@ -203,8 +203,8 @@ fbdev_surface_present(struct native_surface *nsurf,
 
       /* present the surface */
       if (fbdev_surface_update_drawable(&fbsurf->base, &vinfo)) {
-         ret = resource_surface_present(fbsurf->rsurf,
-               ctrl->natt, (void *) &fbsurf->drawable);
+         ret = resource_surface_present(fbsurf->rsurf, ctrl->natt,
+               ctrl->num_rects, ctrl->rects, (void *) &fbsurf->drawable);
       }
 
       fbsurf->width = vinfo.xres;
@@ -220,8 +220,8 @@ fbdev_surface_present(struct native_surface *nsurf,
    }
    else {
       /* the drawable never changes */
-      ret = resource_surface_present(fbsurf->rsurf,
-            ctrl->natt, (void *) &fbsurf->drawable);
+      ret = resource_surface_present(fbsurf->rsurf, ctrl->natt,
+            ctrl->num_rects, ctrl->rects, (void *) &fbsurf->drawable);
    }
 
    return ret;
@@ -233,6 +233,16 @@ fbdev_surface_wait(struct native_surface *nsurf)
    /* no-op */
 }
 
+static int
+fbdev_surface_query_buffer_age(struct native_surface *nsurf)
+{
+   struct fbdev_surface *fbsurf = fbdev_surface(nsurf);
+
+   /* the back buffer is copied and never swapped */
+   return resource_surface_get_buffer_age(fbsurf->rsurf,
+         NATIVE_ATTACHMENT_BACK_LEFT);
+}
+
 static void
 fbdev_surface_destroy(struct native_surface *nsurf)
 {
@@ -296,6 +306,7 @@ fbdev_display_create_window_surface(struct native_display *ndpy,
    fbsurf->base.present = fbdev_surface_present;
    fbsurf->base.validate = fbdev_surface_validate;
    fbsurf->base.wait = fbdev_surface_wait;
+   fbsurf->base.query_buffer_age = fbdev_surface_query_buffer_age;
 
    return &fbsurf->base;
 }
@@ -393,6 +404,7 @@ fbdev_display_get_param(struct native_display *ndpy,
 
    switch (param) {
    case NATIVE_PARAM_PRESERVE_BUFFER:
+   case NATIVE_PARAM_PRESENT_REGION:
       val = 1;
       break;
    case NATIVE_PARAM_USE_NATIVE_BUFFER:
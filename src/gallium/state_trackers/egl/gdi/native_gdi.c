@@ -121,7 +121,8 @@ gdi_surface_invalidate(struct native_surface *nsurf)
 }
 
 static boolean
-gdi_surface_flush_frontbuffer(struct native_surface *nsurf)
+gdi_surface_flush_frontbuffer(struct native_surface *nsurf,
+                              const struct native_present_control *ctrl)
 {
    struct gdi_surface *gsurf = gdi_surface(nsurf);
    HDC hDC;
@@ -129,7 +130,8 @@ gdi_surface_flush_frontbuffer(struct native_surface *nsurf)
 
    hDC = GetDC(gsurf->hWnd);
    ret = resource_surface_present(gsurf->rsurf,
-         NATIVE_ATTACHMENT_FRONT_LEFT, (void *) hDC);
+         NATIVE_ATTACHMENT_FRONT_LEFT, ctrl->num_rects, ctrl->rects,
+         (void *) hDC);
    ReleaseDC(gsurf->hWnd, hDC);
 
    /* force buffers to be updated in next validation call */
@@ -139,7 +141,8 @@ gdi_surface_flush_frontbuffer(struct native_surface *nsurf)
 }
 
 static boolean
-gdi_surface_swap_buffers(struct native_surface *nsurf)
+gdi_surface_swap_buffers(struct native_surface *nsurf,
+                         const struct native_present_control *ctrl)
 {
    struct gdi_surface *gsurf = gdi_surface(nsurf);
    HDC hDC;
@@ -147,7 +150,8 @@ gdi_surface_swap_buffers(struct native_surface *nsurf)
 
    hDC = GetDC(gsurf->hWnd);
    ret = resource_surface_present(gsurf->rsurf,
-         NATIVE_ATTACHMENT_BACK_LEFT, (void *) hDC);
+         NATIVE_ATTACHMENT_BACK_LEFT, ctrl->num_rects, ctrl->rects,
+         (void *) hDC);
    ReleaseDC(gsurf->hWnd, hDC);
 
    resource_surface_swap_buffers(gsurf->rsurf,
@@ -169,10 +173,10 @@ gdi_surface_present(struct native_surface *nsurf,
 
    switch (ctrl->natt) {
    case NATIVE_ATTACHMENT_FRONT_LEFT:
-      ret = gdi_surface_flush_frontbuffer(nsurf);
+      ret = gdi_surface_flush_frontbuffer(nsurf, ctrl);
       break;
    case NATIVE_ATTACHMENT_BACK_LEFT:
-      ret = gdi_surface_swap_buffers(nsurf);
+      ret = gdi_surface_swap_buffers(nsurf, ctrl);
       break;
    default:
       ret = FALSE;
@@ -214,6 +218,15 @@ gdi_surface_wait(struct native_surface *nsurf)
    /* no-op */
 }
 
+static int
+gdi_surface_query_buffer_age(struct native_surface *nsurf)
+{
+   struct gdi_surface *gsurf = gdi_surface(nsurf);
+
+   return resource_surface_get_buffer_age(gsurf->rsurf,
+         NATIVE_ATTACHMENT_BACK_LEFT);
+}
+
 static void
 gdi_surface_destroy(struct native_surface *nsurf)
 {
@@ -257,6 +270,7 @@ gdi_display_create_window_surface(struct native_display *ndpy,
    gsurf->base.present = gdi_surface_present;
    gsurf->base.validate = gdi_surface_validate;
    gsurf->base.wait = gdi_surface_wait;
+   gsurf->base.query_buffer_age = gdi_surface_query_buffer_age;
 
    return &gsurf->base;
 }
@@ -126,6 +126,7 @@ wayland_display_get_param(struct native_display *ndpy,
 
    switch (param) {
    case NATIVE_PARAM_PREMULTIPLIED_ALPHA:
+   case NATIVE_PARAM_PRESENT_REGION:
       val = 1;
       break;
    case NATIVE_PARAM_USE_NATIVE_BUFFER:
@@ -265,6 +266,8 @@ wayland_surface_swap_buffers(struct native_surface *nsurf)
                       display->queue);
 
    if (surface->type == WL_WINDOW_SURFACE) {
+      resource_surface_mark_presented(surface->rsurf,
+                                      NATIVE_ATTACHMENT_BACK_LEFT);
       resource_surface_swap_buffers(surface->rsurf,
                                     NATIVE_ATTACHMENT_FRONT_LEFT,
                                     NATIVE_ATTACHMENT_BACK_LEFT, FALSE);
@@ -301,6 +304,7 @@ wayland_surface_present(struct native_surface *nsurf,
    struct wayland_surface *surface = wayland_surface(nsurf);
    uint width, height;
    boolean ret;
+   int i;
 
    if (ctrl->preserve || ctrl->swap_interval)
       return FALSE;
@@ -332,8 +336,18 @@ wayland_surface_present(struct native_surface *nsurf,
    }
 
    if (surface->type == WL_WINDOW_SURFACE) {
-      resource_surface_get_size(surface->rsurf, &width, &height);
-      wl_surface_damage(surface->win->surface, 0, 0, width, height);
+      if (ctrl->num_rects > 0) {
+         /* let the compositor repaint only the damaged region */
+         for (i = 0; i < ctrl->num_rects; i++) {
+            const int *rect = &ctrl->rects[i * 4];
+            wl_surface_damage(surface->win->surface,
+                              rect[0], rect[1], rect[2], rect[3]);
+         }
+      }
+      else {
+         resource_surface_get_size(surface->rsurf, &width, &height);
+         wl_surface_damage(surface->win->surface, 0, 0, width, height);
+      }
       wl_surface_commit(surface->win->surface);
    }
 
@@ -346,6 +360,15 @@ wayland_surface_wait(struct native_surface *nsurf)
    /* no-op */
 }
 
+static int
+wayland_surface_query_buffer_age(struct native_surface *nsurf)
+{
+   struct wayland_surface *surface = wayland_surface(nsurf);
+
+   return resource_surface_get_buffer_age(surface->rsurf,
+                                          NATIVE_ATTACHMENT_BACK_LEFT);
+}
+
 static void
 wayland_surface_destroy(struct native_surface *nsurf)
 {
@@ -406,6 +429,7 @@ wayland_create_window_surface(struct native_display *ndpy,
    surface->base.present = wayland_surface_present;
    surface->base.validate = wayland_surface_validate;
    surface->base.wait = wayland_surface_wait;
+   surface->base.query_buffer_age = wayland_surface_query_buffer_age;
 
    return &surface->base;
 }
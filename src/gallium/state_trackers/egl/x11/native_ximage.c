@@ -137,13 +137,15 @@ ximage_surface_invalidate(struct native_surface *nsurf)
 }
 
 static boolean
-ximage_surface_flush_frontbuffer(struct native_surface *nsurf)
+ximage_surface_flush_frontbuffer(struct native_surface *nsurf,
+                                 const struct native_present_control *ctrl)
 {
    struct ximage_surface *xsurf = ximage_surface(nsurf);
    boolean ret;
 
    ret = resource_surface_present(xsurf->rsurf,
-         NATIVE_ATTACHMENT_FRONT_LEFT, (void *) &xsurf->xdraw);
+         NATIVE_ATTACHMENT_FRONT_LEFT, ctrl->num_rects, ctrl->rects,
+         (void *) &xsurf->xdraw);
    /* force buffers to be updated in next validation call */
    ximage_surface_invalidate(&xsurf->base);
 
@@ -151,13 +153,15 @@ ximage_surface_flush_frontbuffer(struct native_surface *nsurf)
 }
 
 static boolean
-ximage_surface_swap_buffers(struct native_surface *nsurf)
+ximage_surface_swap_buffers(struct native_surface *nsurf,
+                            const struct native_present_control *ctrl)
 {
    struct ximage_surface *xsurf = ximage_surface(nsurf);
    boolean ret;
 
    ret = resource_surface_present(xsurf->rsurf,
-         NATIVE_ATTACHMENT_BACK_LEFT, (void *) &xsurf->xdraw);
+         NATIVE_ATTACHMENT_BACK_LEFT, ctrl->num_rects, ctrl->rects,
+         (void *) &xsurf->xdraw);
 
    resource_surface_swap_buffers(xsurf->rsurf,
          NATIVE_ATTACHMENT_FRONT_LEFT, NATIVE_ATTACHMENT_BACK_LEFT, TRUE);
@@ -178,10 +182,10 @@ ximage_surface_present(struct native_surface *nsurf,
 
    switch (ctrl->natt) {
    case NATIVE_ATTACHMENT_FRONT_LEFT:
-      ret = ximage_surface_flush_frontbuffer(nsurf);
+      ret = ximage_surface_flush_frontbuffer(nsurf, ctrl);
       break;
    case NATIVE_ATTACHMENT_BACK_LEFT:
-      ret = ximage_surface_swap_buffers(nsurf);
+      ret = ximage_surface_swap_buffers(nsurf, ctrl);
       break;
    default:
       ret = FALSE;
@@ -225,6 +229,15 @@ ximage_surface_wait(struct native_surface *nsurf)
    /* TODO XGetImage and update the front texture */
 }
 
+static int
+ximage_surface_query_buffer_age(struct native_surface *nsurf)
+{
+   struct ximage_surface *xsurf = ximage_surface(nsurf);
+
+   return resource_surface_get_buffer_age(xsurf->rsurf,
+         NATIVE_ATTACHMENT_BACK_LEFT);
+}
+
 static void
 ximage_surface_destroy(struct native_surface *nsurf)
 {
@@ -275,6 +288,7 @@ ximage_display_create_surface(struct native_display *ndpy,
    xsurf->base.present = ximage_surface_present;
    xsurf->base.validate = ximage_surface_validate;
    xsurf->base.wait = ximage_surface_wait;
+   xsurf->base.query_buffer_age = ximage_surface_query_buffer_age;
 
    return xsurf;
 }
@@ -476,7 +490,7 @@ ximage_display_copy_to_pixmap(struct native_display *ndpy,
       xdraw.drawable = (Drawable) pix;
 
       xdpy->base.screen->flush_frontbuffer(xdpy->base.screen,
-            src, 0, 0, &xdraw);
+            src, 0, 0, &xdraw, NULL);
 
       return TRUE;
    }
@@ -495,6 +509,10 @@ ximage_display_get_param(struct native_display *ndpy,
       /* private buffers are allocated */
       val = FALSE;
       break;
+   case NATIVE_PARAM_PRESENT_REGION:
+      /* only the region is put to the window */
+      val = TRUE;
+      break;
    case NATIVE_PARAM_PRESERVE_BUFFER:
    case NATIVE_PARAM_MAX_SWAP_INTERVAL:
    default:
@@ -31,16 +31,16 @@
  * Otherwise we use softpipe.  The GALLIUM_DRIVER environment variable
  * may be set to "softpipe" or "llvmpipe" to override.
  *
- * With softpipe we could render directly into the user's buffer by using a
- * display target resource.  However, softpipe doesn't suport "upside-down"
- * rendering which would be needed for the OSMESA_Y_UP=TRUE case.
+ * When the app sets OSMESA_Y_UP=FALSE and doesn't pad its rows, the color
+ * buffer is created with resource_from_user_memory() so that we render
+ * directly into the user's buffer.  Neither driver supports "upside-down"
+ * rendering which would be needed for the OSMESA_Y_UP=TRUE case, and
+ * llvmpipe only accepts buffers whose rows fill whole cache lines and whose
+ * height is a multiple of 4.
  *
- * With llvmpipe we could only render directly into the user's buffer when its
- * width and height is a multiple of the tile size (64 pixels).
- *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Otherwise we render into ordinary resources then copy the results to
+ * the user's buffer in the flush_front() function which is called when the
+ * app calls glFlush/Finish.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -82,6 +82,9 @@ struct osmesa_buffer
 
    void *map;
 
+   boolean want_direct;  /**< did the last validate try direct rendering? */
+   boolean direct;       /**< is the color buffer the user's memory? */
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -282,6 +285,36 @@ stfbi_to_osbuffer(struct st_framebuffer_iface *stfbi)
 }
 
 
+/**
+ * Can the color buffer be the user's memory, given the context's pixel
+ * store state?  The driver may still refuse it.
+ */
+static boolean
+osmesa_want_direct(const struct osmesa_context *osmesa,
+                   const struct osmesa_buffer *osbuffer)
+{
+   struct pipe_screen *screen = get_st_manager()->screen;
+
+   return !osmesa->y_up &&
+          (!osmesa->user_row_length ||
+           osmesa->user_row_length == osbuffer->width) &&
+          screen->resource_from_user_memory != NULL;
+}
+
+
+/**
+ * Make the st manager revalidate the buffer when the pixel store state
+ * changed whether we want to render directly into the user's memory.
+ */
+static void
+osmesa_check_direct(const struct osmesa_context *osmesa,
+                    struct osmesa_buffer *osbuffer)
+{
+   if (osmesa_want_direct(osmesa, osbuffer) != osbuffer->want_direct)
+      p_atomic_inc(&osbuffer->stfb->stamp);
+}
+
+
 /**
  * Called via glFlush/glFinish.  This is where we copy the contents
  * of the driver's color buffer into the user-specified buffer.
@@ -307,6 +340,14 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
                             &transfer);
 
+   if (statt == ST_ATTACHMENT_FRONT_LEFT && osbuffer->direct) {
+      /* the map only waited for rendering to finish, there's nothing to
+       * copy
+       */
+      pipe->transfer_unmap(pipe, transfer);
+      return TRUE;
+   }
+
    /*
     * Copy the color buffer from the resource to the user's buffer.
     */
@@ -349,6 +390,7 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
                                struct pipe_resource **out)
 {
    struct pipe_screen *screen = get_st_manager()->screen;
+   OSMesaContext osmesa = (OSMesaContext) stctx->st_manager_private;
    enum st_attachment_type i;
    struct osmesa_buffer *osbuffer = stfbi_to_osbuffer(stfbi);
    struct pipe_resource templat;
@@ -365,6 +407,9 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
    templat.bind = 0; /* setup below */
    templat.flags = 0;
 
+   osbuffer->want_direct = osmesa_want_direct(osmesa, osbuffer);
+   osbuffer->direct = FALSE;
+
    for (i = 0; i < count; i++) {
       enum pipe_format format = PIPE_FORMAT_NONE;
       unsigned bind = 0;
@@ -393,8 +438,18 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
 
       templat.format = format;
       templat.bind = bind;
-      out[i] = osbuffer->textures[i] =
-         screen->resource_create(screen, &templat);
+      out[i] = NULL;
+
+      if (statts[i] == ST_ATTACHMENT_FRONT_LEFT && osbuffer->want_direct) {
+         out[i] = screen->resource_from_user_memory(screen, &templat,
+                                                    osbuffer->map);
+         osbuffer->direct = out[i] != NULL;
+      }
+
+      if (!out[i])
+         out[i] = screen->resource_create(screen, &templat);
+
+      osbuffer->textures[i] = out[i];
    }
 
    return TRUE;
@@ -549,6 +604,7 @@ OSMesaCreateContextExt(GLenum format, GLint depthBits, GLint stencilBits,
    attribs.options.disable_shader_bit_encoding = FALSE;
    attribs.options.force_s3tc_enable = FALSE;
    attribs.options.force_glsl_version = 0;
+   attribs.options.discard_glsl_ir = FALSE;
 
    osmesa_init_st_visual(&attribs.visual,
                          PIPE_FORMAT_R8G8B8A8_UNORM,
@@ -642,6 +698,11 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
                                       osmesa->accum_format);
    }
 
+   /* the resources are only recreated when the stamp changes */
+   if (osbuffer->width != width || osbuffer->height != height ||
+       (osbuffer->direct && osbuffer->map != buffer))
+      p_atomic_inc(&osbuffer->stfb->stamp);
+
    osbuffer->width = width;
    osbuffer->height = height;
    osbuffer->map = buffer;
@@ -652,6 +713,8 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
    osmesa->current_buffer = osbuffer;
    osmesa->type = type;
 
+   osmesa_check_direct(osmesa, osbuffer);
+
    stapi->make_current(stapi, osmesa->stctx, osbuffer->stfb, osbuffer->stfb);
 
    return GL_TRUE;
@@ -685,6 +748,9 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   if (osmesa->current_buffer)
+      osmesa_check_direct(osmesa, osmesa->current_buffer);
 }
 
 
@@ -149,9 +149,11 @@ vlVdpOutputSurfaceDestroy(VdpOutputSurface surface)
    pipe_sampler_view_reference(&vlsurface->sampler_view, NULL);
    pipe->screen->fence_reference(pipe->screen, &vlsurface->fence, NULL);
    vl_compositor_cleanup_state(&vlsurface->cstate);
-   pipe_mutex_unlock(vlsurface->device->mutex);
 
+   /* the presentation thread looks surfaces up under the device mutex */
    vlRemoveDataHTAB(surface);
+   pipe_mutex_unlock(vlsurface->device->mutex);
+
    FREE(vlsurface);
 
    return VDP_STATUS_OK;
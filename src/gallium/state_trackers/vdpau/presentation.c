@@ -33,6 +33,163 @@
 
 #include "vdpau_private.h"
 
+/**
+ * Composite a surface to the drawable and flip, the flip is scheduled for
+ * the earliest presentation time by the winsys.
+ */
+static VdpStatus
+vlVdpPresentationQueuePresent(vlVdpPresentationQueue *pq, const vlVdpPresentationJob *job)
+{
+   static int dump_window = -1;
+
+   vlVdpOutputSurface *surf;
+
+   struct pipe_context *pipe;
+   struct pipe_resource *tex;
+   struct pipe_surface surf_templ, *surf_draw;
+   struct u_rect src_rect, dst_clip, *dirty_area;
+
+   struct vl_compositor *compositor;
+   struct vl_compositor_state *cstate;
+
+   pipe = pq->device->context;
+   compositor = &pq->device->compositor;
+   cstate = &pq->cstate;
+
+   pipe_mutex_lock(pq->device->mutex);
+
+   /* looked up under the device mutex, the surface could be gone by now */
+   surf = vlGetDataHTAB(job->surface);
+   if (!surf) {
+      pipe_mutex_unlock(pq->device->mutex);
+      return VDP_STATUS_INVALID_HANDLE;
+   }
+
+   tex = vl_screen_texture_from_drawable(pq->device->vscreen, pq->drawable);
+   if (!tex) {
+      pipe_mutex_unlock(pq->device->mutex);
+      return VDP_STATUS_INVALID_HANDLE;
+   }
+
+   dirty_area = vl_screen_get_dirty_area(pq->device->vscreen);
+
+   memset(&surf_templ, 0, sizeof(surf_templ));
+   surf_templ.format = tex->format;
+   surf_draw = pipe->create_surface(pipe, tex, &surf_templ);
+
+   dst_clip.x0 = 0;
+   dst_clip.y0 = 0;
+   dst_clip.x1 = job->clip_width ? job->clip_width : surf_draw->width;
+   dst_clip.y1 = job->clip_height ? job->clip_height : surf_draw->height;
+
+   if (pq->device->delayed_rendering.surface == job->surface &&
+       dst_clip.x1 == surf_draw->width && dst_clip.y1 == surf_draw->height) {
+
+      // TODO: we correctly support the clipping here, but not the pq background color in the clipped area....
+      cstate = pq->device->delayed_rendering.cstate;
+      vl_compositor_set_dst_clip(cstate, &dst_clip);
+      vlVdpResolveDelayedRendering(pq->device, surf_draw, dirty_area);
+
+   } else {
+      vlVdpResolveDelayedRendering(pq->device, NULL, NULL);
+
+      src_rect.x0 = 0;
+      src_rect.y0 = 0;
+      src_rect.x1 = surf_draw->width;
+      src_rect.y1 = surf_draw->height;
+
+      vl_compositor_clear_layers(cstate);
+      vl_compositor_set_rgba_layer(cstate, compositor, 0, surf->sampler_view, &src_rect, NULL, NULL);
+      vl_compositor_set_dst_clip(cstate, &dst_clip);
+      vl_compositor_render(cstate, compositor, surf_draw, dirty_area, true);
+   }
+
+   vl_screen_set_next_timestamp(pq->device->vscreen, job->earliest_presentation_time);
+   pipe->screen->flush_frontbuffer
+   (
+      pipe->screen, tex, 0, 0,
+      vl_screen_get_private(pq->device->vscreen), NULL
+   );
+
+   pipe->screen->fence_reference(pipe->screen, &surf->fence, NULL);
+   pipe->flush(pipe, &surf->fence, 0);
+   pq->last_surf = surf;
+
+   if (dump_window == -1) {
+      dump_window = debug_get_num_option("VDPAU_DUMP", 0);
+   }
+
+   if (dump_window) {
+      static unsigned int framenum = 0;
+      char cmd[256];
+
+      if (framenum) {
+         sprintf(cmd, "xwd -id %d -silent -out vdpau_frame_%08d.xwd", (int)pq->drawable, framenum);
+         if (system(cmd) != 0)
+            VDPAU_MSG(VDPAU_ERR, "[VDPAU] Dumping surface %d failed.\n", job->surface);
+      }
+      framenum++;
+   }
+
+   pipe_resource_reference(&tex, NULL);
+   pipe_surface_reference(&surf_draw, NULL);
+   pipe_mutex_unlock(pq->device->mutex);
+
+   return VDP_STATUS_OK;
+}
+
+/**
+ * Is the surface still waiting for the presentation thread, the queue
+ * mutex must be held.
+ */
+static bool
+vlVdpPresentationQueueIsQueued(vlVdpPresentationQueue *pq, VdpOutputSurface surface)
+{
+   unsigned i;
+
+   for (i = 0; i < pq->queue.count; ++i)
+      if (pq->queue.jobs[(pq->queue.head + i) % VL_VDPAU_PRESENTATION_QUEUE_DEPTH].surface == surface)
+         return true;
+
+   return false;
+}
+
+/**
+ * Presents the queued surfaces in order. A job stays in the queue while it
+ * is presented, so that its surface is reported as queued until it is
+ * flipped. Waiting for the earliest presentation time is left to the
+ * winsys, the next vl_screen_texture_from_drawable blocks until the
+ * previous flip is done.
+ */
+static PIPE_THREAD_ROUTINE(vlVdpPresentationThread, param)
+{
+   vlVdpPresentationQueue *pq = param;
+
+   pipe_mutex_lock(pq->queue.mutex);
+   while (!pq->queue.quit) {
+      vlVdpPresentationJob job;
+
+      if (!pq->queue.count) {
+         pipe_condvar_wait(pq->queue.cond, pq->queue.mutex);
+         continue;
+      }
+
+      job = pq->queue.jobs[pq->queue.head];
+      pipe_mutex_unlock(pq->queue.mutex);
+
+      if (vlVdpPresentationQueuePresent(pq, &job) != VDP_STATUS_OK)
+         VDPAU_MSG(VDPAU_WARN, "[VDPAU] Presenting surface %d failed.\n", job.surface);
+
+      pipe_mutex_lock(pq->queue.mutex);
+      pq->queue.head = (pq->queue.head + 1) % VL_VDPAU_PRESENTATION_QUEUE_DEPTH;
+      pq->queue.count--;
+      pipe_condvar_broadcast(pq->queue.cond);
+   }
+   pipe_mutex_unlock(pq->queue.mutex);
+
+   return NULL;
+}
+
 /**
  * Create a VdpPresentationQueue.
  */
@@ -79,9 +236,19 @@ vlVdpPresentationQueueCreate(VdpDevice device,
       goto no_handle;
    }
 
+   /* without the thread, surfaces are presented from the display call */
+   pipe_mutex_init(pq->queue.mutex);
+   pipe_condvar_init(pq->queue.cond);
+   pq->queue.thread = pipe_thread_create(vlVdpPresentationThread, pq);
+   pq->queue.running = pq->queue.thread != 0;
+
    return VDP_STATUS_OK;
 
 no_handle:
+   pipe_mutex_lock(dev->mutex);
+   vl_compositor_cleanup_state(&pq->cstate);
+   pipe_mutex_unlock(dev->mutex);
+
 no_compositor:
    FREE(pq);
    return ret;
@@ -99,6 +266,17 @@ vlVdpPresentationQueueDestroy(VdpPresentationQueue presentation_queue)
    if (!pq)
       return VDP_STATUS_INVALID_HANDLE;
 
+   /* surfaces which are still queued are dropped */
+   if (pq->queue.running) {
+      pipe_mutex_lock(pq->queue.mutex);
+      pq->queue.quit = true;
+      pipe_condvar_broadcast(pq->queue.cond);
+      pipe_mutex_unlock(pq->queue.mutex);
+      pipe_thread_wait(pq->queue.thread);
+   }
+   pipe_condvar_destroy(pq->queue.cond);
+   pipe_mutex_destroy(pq->queue.mutex);
+
    pipe_mutex_lock(pq->device->mutex);
    vl_compositor_cleanup_state(&pq->cstate);
    pipe_mutex_unlock(pq->device->mutex);
@@ -200,18 +378,9 @@ vlVdpPresentationQueueDisplay(VdpPresentationQueue presentation_queue,
                               uint32_t clip_height,
                               VdpTime  earliest_presentation_time)
 {
-   static int dump_window = -1;
-
    vlVdpPresentationQueue *pq;
    vlVdpOutputSurface *surf;
-
-   struct pipe_context *pipe;
-   struct pipe_resource *tex;
-   struct pipe_surface surf_templ, *surf_draw;
-   struct u_rect src_rect, dst_clip, *dirty_area;
-
-   struct vl_compositor *compositor;
-   struct vl_compositor_state *cstate;
+   vlVdpPresentationJob *job;
 
    pq = vlGetDataHTAB(presentation_queue);
    if (!pq)
@@ -221,80 +390,26 @@ vlVdpPresentationQueueDisplay(VdpPresentationQueue presentation_queue,
    if (!surf)
       return VDP_STATUS_INVALID_HANDLE;
 
-   pipe = pq->device->context;
-   compositor = &pq->device->compositor;
-   cstate = &pq->cstate;
-
-   pipe_mutex_lock(pq->device->mutex);
-   tex = vl_screen_texture_from_drawable(pq->device->vscreen, pq->drawable);
-   if (!tex) {
-      pipe_mutex_unlock(pq->device->mutex);
-      return VDP_STATUS_INVALID_HANDLE;
-   }
-
-   dirty_area = vl_screen_get_dirty_area(pq->device->vscreen);
-
-   memset(&surf_templ, 0, sizeof(surf_templ));
-   surf_templ.format = tex->format;
-   surf_draw = pipe->create_surface(pipe, tex, &surf_templ);
-
-   dst_clip.x0 = 0;
-   dst_clip.y0 = 0;
-   dst_clip.x1 = clip_width ? clip_width : surf_draw->width;
-   dst_clip.y1 = clip_height ? clip_height : surf_draw->height;
-
-   if (pq->device->delayed_rendering.surface == surface &&
-       dst_clip.x1 == surf_draw->width && dst_clip.y1 == surf_draw->height) {
-
-      // TODO: we correctly support the clipping here, but not the pq background color in the clipped area....
-      cstate = pq->device->delayed_rendering.cstate;
-      vl_compositor_set_dst_clip(cstate, &dst_clip);
-      vlVdpResolveDelayedRendering(pq->device, surf_draw, dirty_area);
-
-   } else {
-      vlVdpResolveDelayedRendering(pq->device, NULL, NULL);
-
-      src_rect.x0 = 0;
-      src_rect.y0 = 0;
-      src_rect.x1 = surf_draw->width;
-      src_rect.y1 = surf_draw->height;
-
-      vl_compositor_clear_layers(cstate);
-      vl_compositor_set_rgba_layer(cstate, compositor, 0, surf->sampler_view, &src_rect, NULL, NULL);
-      vl_compositor_set_dst_clip(cstate, &dst_clip);
-      vl_compositor_render(cstate, compositor, surf_draw, dirty_area, true);
-   }
-
-   vl_screen_set_next_timestamp(pq->device->vscreen, earliest_presentation_time);
-   pipe->screen->flush_frontbuffer
-   (
-      pipe->screen, tex, 0, 0,
-      vl_screen_get_private(pq->device->vscreen)
-   );
-
-   pipe->screen->fence_reference(pipe->screen, &surf->fence, NULL);
-   pipe->flush(pipe, &surf->fence, 0);
-   pq->last_surf = surf;
-
-   if (dump_window == -1) {
-      dump_window = debug_get_num_option("VDPAU_DUMP", 0);
+   if (!pq->queue.running) {
+      vlVdpPresentationJob sync_job = {
+         surface, clip_width, clip_height, earliest_presentation_time
+      };
+      return vlVdpPresentationQueuePresent(pq, &sync_job);
    }
 
-   if (dump_window) {
-      static unsigned int framenum = 0;
-      char cmd[256];
+   pipe_mutex_lock(pq->queue.mutex);
+   while (pq->queue.count == VL_VDPAU_PRESENTATION_QUEUE_DEPTH)
+      pipe_condvar_wait(pq->queue.cond, pq->queue.mutex);
 
-      if (framenum) {
-         sprintf(cmd, "xwd -id %d -silent -out vdpau_frame_%08d.xwd", (int)pq->drawable, framenum);
-         if (system(cmd) != 0)
-            VDPAU_MSG(VDPAU_ERR, "[VDPAU] Dumping surface %d failed.\n", surface);
-      }
-      framenum++;
-   }
+   job = &pq->queue.jobs[(pq->queue.head + pq->queue.count) % VL_VDPAU_PRESENTATION_QUEUE_DEPTH];
+   job->surface = surface;
+   job->clip_width = clip_width;
+   job->clip_height = clip_height;
+   job->earliest_presentation_time = earliest_presentation_time;
+   pq->queue.count++;
 
-   pipe_resource_reference(&tex, NULL);
-   pipe_surface_reference(&surf_draw, NULL);
-   pipe_mutex_unlock(pq->device->mutex);
+   pipe_condvar_broadcast(pq->queue.cond);
+   pipe_mutex_unlock(pq->queue.mutex);
 
    return VDP_STATUS_OK;
 }
@@ -322,6 +437,13 @@ vlVdpPresentationQueueBlockUntilSurfaceIdle(VdpPresentationQueue presentation_qu
    if (!surf)
       return VDP_STATUS_INVALID_HANDLE;
 
+   if (pq->queue.running) {
+      pipe_mutex_lock(pq->queue.mutex);
+      while (vlVdpPresentationQueueIsQueued(pq, surface))
+         pipe_condvar_wait(pq->queue.cond, pq->queue.mutex);
+      pipe_mutex_unlock(pq->queue.mutex);
+   }
+
    pipe_mutex_lock(pq->device->mutex);
    if (surf->fence) {
       screen = pq->device->vscreen->pscreen;
@@ -359,6 +481,19 @@ vlVdpPresentationQueueQuerySurfaceStatus(VdpPresentationQueue presentation_queue
 
    *first_presentation_time = 0;
 
+   if (pq->queue.running) {
+      bool queued;
+
+      pipe_mutex_lock(pq->queue.mutex);
+      queued = vlVdpPresentationQueueIsQueued(pq, surface);
+      pipe_mutex_unlock(pq->queue.mutex);
+
+      if (queued) {
+         *status = VDP_PRESENTATION_QUEUE_STATUS_QUEUED;
+         return VDP_STATUS_OK;
+      }
+   }
+
    if (!surf->fence) {
       if (pq->last_surf == surf)
          *status = VDP_PRESENTATION_QUEUE_STATUS_VISIBLE;
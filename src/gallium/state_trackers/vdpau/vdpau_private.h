@@ -399,12 +399,33 @@ typedef struct
    Drawable drawable;
 } vlVdpPresentationQueueTarget;
 
+/* surfaces VdpPresentationQueueDisplay can queue before it blocks */
+#define VL_VDPAU_PRESENTATION_QUEUE_DEPTH 8
+
+typedef struct
+{
+   VdpOutputSurface surface;
+   uint32_t clip_width, clip_height;
+   VdpTime earliest_presentation_time;
+} vlVdpPresentationJob;
+
 typedef struct
 {
    vlVdpDevice *device;
    Drawable drawable;
    struct vl_compositor_state cstate;
    vlVdpOutputSurface *last_surf;
+
+   /* surfaces waiting for the presentation thread, if it could be started */
+   struct {
+      bool running, quit;
+      pipe_thread thread;
+      pipe_mutex mutex;
+      pipe_condvar cond;
+
+      unsigned head, count;
+      vlVdpPresentationJob jobs[VL_VDPAU_PRESENTATION_QUEUE_DEPTH];
+   } queue;
 } vlVdpPresentationQueue;
 
 typedef struct
@@ -465,13 +465,73 @@ bind_samplers(struct xa_context *ctx,
 				   ctx->bound_sampler_views);
 }
 
+static void
+picture_key(struct xa_composite_picture_key *key,
+	    const struct xa_picture *pic)
+{
+    key->tex = pic->srf ? pic->srf->tex : NULL;
+    key->pict_format = pic->pict_format;
+    key->solid = pic->src_pict &&
+	pic->src_pict->type == xa_src_pict_solid_fill;
+    key->has_transform = pic->has_transform;
+    key->component_alpha = pic->component_alpha;
+    key->wrap = pic->wrap;
+    key->filter = pic->filter;
+}
+
+static void
+composite_key(struct xa_composite_key *key,
+	      const struct xa_composite *comp)
+{
+    memset(key, 0, sizeof(*key));
+    key->dst_tex = comp->dst->srf->tex;
+    key->dst_format = comp->dst->pict_format;
+    key->op = comp->op;
+    picture_key(&key->src, comp->src);
+    if (comp->mask) {
+	key->has_mask = 1;
+	picture_key(&key->mask, comp->mask);
+    }
+}
+
+/*
+ * Draw the rects of the open composite batch, and release its state.
+ */
+void
+xa_ctx_composite_flush(struct xa_context *ctx)
+{
+    if (!ctx->comp_pending)
+	return;
+
+    renderer_draw_flush(ctx);
+
+    ctx->comp = NULL;
+    ctx->has_solid_color = FALSE;
+    xa_ctx_sampler_views_destroy(ctx);
+    ctx->comp_pending = 0;
+}
+
 XA_EXPORT int
 xa_composite_prepare(struct xa_context *ctx,
 		     const struct xa_composite *comp)
 {
     struct xa_surface *dst_srf = comp->dst->srf;
+    struct xa_composite_key key;
     int ret;
 
+    composite_key(&key, comp);
+    if (ctx->comp_pending &&
+	memcmp(&key, &ctx->comp_key, sizeof(key)) == 0) {
+	/* the solid color goes into the vertices, the state is the same */
+	if (ctx->has_solid_color)
+	    xa_pixel_to_float4(comp->src->src_pict->solid_fill.color,
+			       ctx->solid_color);
+	ctx->comp = comp;
+	return XA_ERR_NONE;
+    }
+
+    xa_ctx_composite_flush(ctx);
+
     ret = xa_ctx_srf_create(ctx, dst_srf);
     if (ret != XA_ERR_NONE)
 	return ret;
@@ -495,6 +555,9 @@ xa_composite_prepare(struct xa_context *ctx,
 	ctx->comp = comp;
     }
 
+    memcpy(&ctx->comp_key, &key, sizeof(key));
+    ctx->comp_pending = 1;
+
     xa_ctx_srf_destroy(ctx);
     return XA_ERR_NONE;
 }
@@ -526,11 +589,11 @@ xa_composite_rect(struct xa_context *ctx,
 XA_EXPORT void
 xa_composite_done(struct xa_context *ctx)
 {
-    renderer_draw_flush(ctx);
-
-    ctx->comp = NULL;
-    ctx->has_solid_color = FALSE;
-    xa_ctx_sampler_views_destroy(ctx);
+    /*
+     * The batch is drawn by the next composite with a different key, or
+     * by any other operation of the context.
+     */
+    (void) ctx;
 }
 
 static const struct xa_composite_allocation a = {
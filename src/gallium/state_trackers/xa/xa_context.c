@@ -37,6 +37,7 @@
 XA_EXPORT void
 xa_context_flush(struct xa_context *ctx)
 {
+	xa_ctx_composite_flush(ctx);
 	ctx->pipe->flush(ctx->pipe, &ctx->last_fence, 0);
 }
 
@@ -72,6 +73,8 @@ xa_context_destroy(struct xa_context *r)
     if (*fsbuf)
 	pipe_resource_reference(fsbuf, NULL);
 
+    xa_ctx_composite_flush(r);
+
     if (r->shaders) {
 	xa_shaders_destroy(r->shaders);
 	r->shaders = NULL;
@@ -101,6 +104,8 @@ xa_surface_dma(struct xa_context *ctx,
     enum pipe_transfer_usage transfer_direction;
     struct pipe_context *pipe = ctx->pipe;
 
+    xa_ctx_composite_flush(ctx);
+
     transfer_direction = (to_surface ? PIPE_TRANSFER_WRITE :
 			  PIPE_TRANSFER_READ);
 
@@ -149,6 +154,8 @@ xa_surface_map(struct xa_context *ctx,
     if (!transfer_direction)
 	return NULL;
 
+    xa_ctx_composite_flush(ctx);
+
     map = pipe_transfer_map(pipe, srf->tex, 0, 0,
                             transfer_direction, 0, 0,
                             srf->tex->width0, srf->tex->height0,
@@ -206,6 +213,8 @@ xa_copy_prepare(struct xa_context *ctx,
     if (src == dst || ctx->srf != NULL)
 	return -XA_ERR_INVAL;
 
+    xa_ctx_composite_flush(ctx);
+
     if (src->tex->format != dst->tex->format) {
 	int ret = xa_ctx_srf_create(ctx, dst);
 	if (ret != XA_ERR_NONE)
@@ -276,6 +285,8 @@ xa_solid_prepare(struct xa_context *ctx, struct xa_surface *dst,
     int width, height;
     int ret;
 
+    xa_ctx_composite_flush(ctx);
+
     ret = xa_ctx_srf_create(ctx, dst);
     if (ret != XA_ERR_NONE)
 	return ret;
@@ -44,7 +44,7 @@
 #define XA_EXPORT
 #endif
 
-#define XA_VB_SIZE (100 * 4 * 3 * 4)
+#define XA_VB_SIZE (1024 * 4 * 3 * 4)
 #define XA_LAST_SURFACE_TYPE (xa_type_yuv_component + 1)
 #define XA_MAX_SAMPLERS 3
 
@@ -69,6 +69,28 @@ struct xa_surface {
     struct pipe_context *mapping_pipe;
 };
 
+/*
+ * What the state of a composite batch depends on. The vertices are
+ * computed per rect, so transforms and solid colors aren't part of it.
+ */
+struct xa_composite_picture_key {
+    struct pipe_resource *tex;
+    int pict_format;
+    int solid;
+    int has_transform;
+    int component_alpha;
+    int wrap;
+    int filter;
+};
+
+struct xa_composite_key {
+    struct pipe_resource *dst_tex;
+    int dst_format;
+    int op;
+    int has_mask;
+    struct xa_composite_picture_key src, mask;
+};
+
 struct xa_tracker {
     enum xa_formats *supported_formats;
     unsigned int format_map[XA_LAST_SURFACE_TYPE][2];
@@ -112,6 +134,14 @@ struct xa_context {
     unsigned int num_bound_samplers;
     struct pipe_sampler_view *bound_sampler_views[XA_MAX_SAMPLERS];
     const struct xa_composite *comp;
+
+    /*
+     * xa_composite_done() leaves the batch open, so that following
+     * composites with the same key (e.g. glyphs from one glyph cache
+     * picture) just add their rects to it.
+     */
+    int comp_pending;
+    struct xa_composite_key comp_key;
 };
 
 enum xa_vs_traits {
@@ -218,6 +248,12 @@ xa_ctx_srf_destroy(struct xa_context *ctx);
 extern void
 xa_ctx_sampler_views_destroy(struct xa_context *ctx);
 
+/*
+ * xa_composite.c
+ */
+extern void
+xa_ctx_composite_flush(struct xa_context *ctx);
+
 /*
  * xa_renderer.c
  */
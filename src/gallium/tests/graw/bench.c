@@ -0,0 +1,514 @@
+/* Measure the throughput of a pipe driver: cost of state changes, draw
+ * calls per second, vertex and fill rate, texture upload bandwidth and
+ * shader creation latency.  Results are printed as CSV, one line per
+ * benchmark.
+ *
+ * Usage: bench [-t <seconds>] [-b <benchmark>] [-l]
+ *
+ * -t sets how long each benchmark runs, 1 second by default.
+ * -b only runs the named benchmark, and may be given several times.
+ * -l lists the benchmarks.
+ *
+ * The driver is whatever the graw target picks, eg. GALLIUM_DRIVER with
+ * graw-xlib.  Each benchmark is run once untimed, so that shaders get
+ * compiled, and waits for the driver to finish before the clock stops.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "graw_util.h"
+
+#include "os/os_time.h"
+#include "util/u_string.h"
+
+
+#define WIDTH 512
+#define HEIGHT 512
+
+/** Number of vertices of the vertex throughput mesh */
+#define GRID_SIZE 128
+#define GRID_VERTICES (GRID_SIZE * GRID_SIZE * 6)
+
+#define TEX_SIZE 1024
+
+#define MAX_SELECTED 16
+
+static struct graw_info info;
+
+static double Seconds = 1.0;
+static const char *Selected[MAX_SELECTED];
+static unsigned NumSelected = 0;
+
+
+struct vertex {
+   float position[4];
+};
+
+/* the same triangle twice, so that it can be drawn from two offsets */
+static struct vertex small_tri[6] =
+{
+   { { -0.01f, -0.01f, 0.0f, 1.0f } },
+   { {  0.01f, -0.01f, 0.0f, 1.0f } },
+   { {  0.0f,   0.01f, 0.0f, 1.0f } },
+   { { -0.01f, -0.01f, 0.0f, 1.0f } },
+   { {  0.01f, -0.01f, 0.0f, 1.0f } },
+   { {  0.0f,   0.01f, 0.0f, 1.0f } }
+};
+
+static struct vertex full_quad[6] =
+{
+   { { -1.0f, -1.0f, 0.0f, 1.0f } },
+   { {  1.0f, -1.0f, 0.0f, 1.0f } },
+   { {  1.0f,  1.0f, 0.0f, 1.0f } },
+   { { -1.0f, -1.0f, 0.0f, 1.0f } },
+   { {  1.0f,  1.0f, 0.0f, 1.0f } },
+   { { -1.0f,  1.0f, 0.0f, 1.0f } }
+};
+
+static struct pipe_resource *small_vbuf, *quad_vbuf, *grid_vbuf;
+static void *blend[2];
+static void *fs[2];
+static void *vs;
+static struct pipe_resource *tex;
+static void *tex_data;
+static unsigned shader_count = 0;
+
+
+static const char *vs_text =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL OUT[0], POSITION\n"
+   "  0: MOV OUT[0], IN[0]\n"
+   "  1: END\n";
+
+static const char *fs_text[2] = {
+   "FRAG\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL CONST[0]\n"
+   "  0: MOV OUT[0], CONST[0]\n"
+   "  1: END\n",
+
+   "FRAG\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL CONST[0]\n"
+   "  0: MOV OUT[0], CONST[0].wzyx\n"
+   "  1: END\n"
+};
+
+
+static struct pipe_resource *
+create_vbuf(const void *data, unsigned size)
+{
+   return pipe_buffer_create_with_data(info.ctx,
+                                       PIPE_BIND_VERTEX_BUFFER,
+                                       PIPE_USAGE_STATIC,
+                                       size, data);
+}
+
+
+static void
+bind_vbuf(struct pipe_resource *buf, unsigned offset)
+{
+   struct pipe_vertex_buffer vbuf;
+
+   memset(&vbuf, 0, sizeof vbuf);
+   vbuf.stride = sizeof(struct vertex);
+   vbuf.buffer_offset = offset;
+   vbuf.buffer = buf;
+
+   info.ctx->set_vertex_buffers(info.ctx, 0, 1, &vbuf);
+}
+
+
+static void
+set_color(float r, float g, float b, float a)
+{
+   struct pipe_constant_buffer cb;
+   float color[4];
+
+   color[0] = r;
+   color[1] = g;
+   color[2] = b;
+   color[3] = a;
+
+   memset(&cb, 0, sizeof cb);
+   cb.buffer_size = sizeof color;
+   cb.user_buffer = color;
+
+   info.ctx->set_constant_buffer(info.ctx, PIPE_SHADER_FRAGMENT, 0, &cb);
+}
+
+
+/** Wait until the driver is done with everything queued so far. */
+static void
+finish(void)
+{
+   struct pipe_fence_handle *fence = NULL;
+
+   info.ctx->flush(info.ctx, &fence, 0);
+   if (fence) {
+      info.screen->fence_finish(info.screen, fence, PIPE_TIMEOUT_INFINITE);
+      info.screen->fence_reference(info.screen, &fence, NULL);
+   }
+}
+
+
+/*
+ * The benchmarks.  Each step does a batch of work and returns how many
+ * units of work it was.
+ */
+
+static double
+step_draw_calls(void)
+{
+   unsigned i;
+
+   for (i = 0; i < 64; i++)
+      util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 3);
+
+   return 64;
+}
+
+
+static double
+step_state_blend(void)
+{
+   unsigned i;
+
+   for (i = 0; i < 64; i++) {
+      info.ctx->bind_blend_state(info.ctx, blend[i & 1]);
+      util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 3);
+   }
+
+   return 64;
+}
+
+
+static double
+step_state_fs(void)
+{
+   unsigned i;
+
+   for (i = 0; i < 64; i++) {
+      info.ctx->bind_fs_state(info.ctx, fs[i & 1]);
+      util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 3);
+   }
+
+   return 64;
+}
+
+
+static double
+step_state_constants(void)
+{
+   unsigned i;
+
+   for (i = 0; i < 64; i++) {
+      set_color(i / 64.0f, 0.5f, 0.5f, 1.0f);
+      util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 3);
+   }
+
+   return 64;
+}
+
+
+static double
+step_state_vbuf(void)
+{
+   unsigned i;
+
+   for (i = 0; i < 64; i++) {
+      bind_vbuf(small_vbuf, (i & 1) * 3 * sizeof(struct vertex));
+      util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 3);
+   }
+
+   return 64;
+}
+
+
+static double
+step_vertex(void)
+{
+   util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, GRID_VERTICES);
+
+   return GRID_VERTICES;
+}
+
+
+static double
+step_fill(void)
+{
+   util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 6);
+
+   return WIDTH * HEIGHT;
+}
+
+
+static double
+step_texture_upload(void)
+{
+   const unsigned stride = TEX_SIZE * 4;
+   struct pipe_box box;
+
+   u_box_2d(0, 0, TEX_SIZE, TEX_SIZE, &box);
+
+   info.ctx->transfer_inline_write(info.ctx, tex, 0,
+                                   PIPE_TRANSFER_WRITE |
+                                   PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                                   &box, tex_data, stride,
+                                   stride * TEX_SIZE);
+
+   return stride * TEX_SIZE;
+}
+
+
+static double
+step_shader_create(void)
+{
+   char text[512];
+   void *handle;
+
+   /* a new immediate each time, so that no driver side cache hits */
+   util_snprintf(text, sizeof text,
+                 "FRAG\n"
+                 "DCL OUT[0], COLOR\n"
+                 "DCL CONST[0]\n"
+                 "IMM FLT32 { %u.0, 0.5, 0.25, 1.0 }\n"
+                 "  0: MUL OUT[0], CONST[0], IMM[0]\n"
+                 "  1: END\n",
+                 shader_count++);
+
+   /* drivers may only compile at the first draw */
+   handle = graw_parse_fragment_shader(info.ctx, text);
+   info.ctx->bind_fs_state(info.ctx, handle);
+   util_draw_arrays(info.ctx, PIPE_PRIM_TRIANGLES, 0, 3);
+   info.ctx->bind_fs_state(info.ctx, fs[0]);
+   info.ctx->delete_fs_state(info.ctx, handle);
+
+   return 1;
+}
+
+
+static void
+setup_small_tri(void)
+{
+   bind_vbuf(small_vbuf, 0);
+}
+
+
+static void
+setup_vertex(void)
+{
+   bind_vbuf(grid_vbuf, 0);
+}
+
+
+static void
+setup_fill(void)
+{
+   bind_vbuf(quad_vbuf, 0);
+}
+
+
+struct benchmark
+{
+   const char *name;
+   const char *unit;
+   void (*setup)(void);
+   double (*step)(void);
+};
+
+static const struct benchmark benchmarks[] = {
+   { "draw-calls", "draws", setup_small_tri, step_draw_calls },
+   { "state-blend", "changes", setup_small_tri, step_state_blend },
+   { "state-fs", "changes", setup_small_tri, step_state_fs },
+   { "state-constants", "changes", setup_small_tri, step_state_constants },
+   { "state-vbuf", "changes", setup_small_tri, step_state_vbuf },
+   { "vertex", "vertices", setup_vertex, step_vertex },
+   { "fill", "pixels", setup_fill, step_fill },
+   { "texture-upload", "bytes", NULL, step_texture_upload },
+   { "shader-create", "shaders", setup_small_tri, step_shader_create },
+};
+
+
+static void
+run_benchmark(const struct benchmark *b)
+{
+   int64_t start, now, end;
+   double units = 0.0, iterations = 0.0, seconds;
+
+   info.ctx->bind_blend_state(info.ctx, blend[0]);
+   info.ctx->bind_fs_state(info.ctx, fs[0]);
+   set_color(0.5f, 0.5f, 0.5f, 1.0f);
+   if (b->setup)
+      b->setup();
+
+   /* warm up */
+   b->step();
+   finish();
+
+   start = os_time_get();
+   end = start + (int64_t) (Seconds * 1000000.0);
+   do {
+      units += b->step();
+      iterations += 1.0;
+
+      /* don't let the driver queue up more than it can do in time */
+      if (((unsigned) iterations & 15) == 0)
+         info.ctx->flush(info.ctx, NULL, 0);
+
+      now = os_time_get();
+   } while (now < end);
+   finish();
+   now = os_time_get();
+
+   seconds = (now - start) / 1000000.0;
+
+   printf("%s,%.0f,%.0f,%s,%.3f,%.1f,%.3f\n",
+          b->name, iterations, units, b->unit, seconds,
+          units / seconds, seconds * 1000000.0 / units);
+   fflush(stdout);
+}
+
+
+static boolean
+is_selected(const char *name)
+{
+   unsigned i;
+
+   if (!NumSelected)
+      return TRUE;
+
+   for (i = 0; i < NumSelected; i++) {
+      if (strcmp(Selected[i], name) == 0)
+         return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+static void
+init(void)
+{
+   struct pipe_blend_state blend_desc;
+   struct pipe_vertex_element ve;
+   struct vertex *grid;
+   unsigned x, y, i;
+
+   if (!graw_util_create_window(&info, WIDTH, HEIGHT, 1, FALSE))
+      exit(1);
+
+   graw_util_default_state(&info, FALSE);
+   graw_util_viewport(&info, 0, 0, WIDTH, HEIGHT, 30, 1000);
+
+   memset(&blend_desc, 0, sizeof blend_desc);
+   blend_desc.rt[0].colormask = PIPE_MASK_RGBA;
+   blend[0] = info.ctx->create_blend_state(info.ctx, &blend_desc);
+   blend_desc.rt[0].blend_enable = 1;
+   blend_desc.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend_desc.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend_desc.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend_desc.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend_desc.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend_desc.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend[1] = info.ctx->create_blend_state(info.ctx, &blend_desc);
+
+   vs = graw_parse_vertex_shader(info.ctx, vs_text);
+   info.ctx->bind_vs_state(info.ctx, vs);
+   fs[0] = graw_parse_fragment_shader(info.ctx, fs_text[0]);
+   fs[1] = graw_parse_fragment_shader(info.ctx, fs_text[1]);
+
+   memset(&ve, 0, sizeof ve);
+   ve.src_offset = Offset(struct vertex, position);
+   ve.src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   info.ctx->bind_vertex_elements_state(info.ctx,
+      info.ctx->create_vertex_elements_state(info.ctx, 1, &ve));
+
+   small_vbuf = create_vbuf(small_tri, sizeof small_tri);
+   quad_vbuf = create_vbuf(full_quad, sizeof full_quad);
+
+   /* two small triangles per grid cell, covering the whole window */
+   grid = MALLOC(GRID_VERTICES * sizeof *grid);
+   if (!grid)
+      exit(1);
+   i = 0;
+   for (y = 0; y < GRID_SIZE; y++) {
+      for (x = 0; x < GRID_SIZE; x++) {
+         static const unsigned corners[6][2] = {
+            { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 }
+         };
+         unsigned j;
+
+         for (j = 0; j < 6; j++, i++) {
+            grid[i].position[0] = (x + corners[j][0]) * 2.0f / GRID_SIZE - 1.0f;
+            grid[i].position[1] = (y + corners[j][1]) * 2.0f / GRID_SIZE - 1.0f;
+            grid[i].position[2] = 0.0f;
+            grid[i].position[3] = 1.0f;
+         }
+      }
+   }
+   grid_vbuf = create_vbuf(grid, GRID_VERTICES * sizeof *grid);
+   FREE(grid);
+
+   tex_data = CALLOC(TEX_SIZE * TEX_SIZE, 4);
+   tex = graw_util_create_tex2d(&info, TEX_SIZE, TEX_SIZE,
+                                PIPE_FORMAT_B8G8R8A8_UNORM, tex_data);
+
+   if (!small_vbuf || !quad_vbuf || !grid_vbuf || !tex || !tex_data) {
+      debug_printf("bench: failed to create resources\n");
+      exit(1);
+   }
+}
+
+
+static void
+args(int argc, char *argv[])
+{
+   int i;
+   unsigned j;
+
+   for (i = 1; i < argc; ) {
+      if (graw_parse_args(&i, argc, argv)) {
+         /* ok */
+      }
+      else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+         Seconds = atof(argv[i + 1]);
+         i += 2;
+      }
+      else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc &&
+               NumSelected < MAX_SELECTED) {
+         Selected[NumSelected++] = argv[i + 1];
+         i += 2;
+      }
+      else if (strcmp(argv[i], "-l") == 0) {
+         for (j = 0; j < Elements(benchmarks); j++)
+            printf("%s\n", benchmarks[j].name);
+         exit(0);
+      }
+      else {
+         printf("Invalid arg %s\n", argv[i]);
+         exit(1);
+      }
+   }
+}
+
+
+int main( int argc, char *argv[] )
+{
+   unsigned i;
+
+   args(argc, argv);
+   init();
+
+   printf("benchmark,iterations,units,unit,seconds,units_per_second,"
+          "usec_per_unit\n");
+
+   for (i = 0; i < Elements(benchmarks); i++) {
+      if (is_selected(benchmarks[i].name))
+         run_benchmark(&benchmarks[i]);
+   }
+
+   return 0;
+}
@@ -0,0 +1,133 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Cost of a GL call through the public entry points and the current
+ * dispatch table, with one and with several threads having made a table
+ * current.  Without TLS the second case goes through pthread_getspecific.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+#include "GL/gl.h"
+#include "os/os_thread.h"
+
+extern "C" {
+#include "glapi/glapi.h"
+}
+
+#include "perf_harness.h"
+
+
+#define CALLS 1024
+
+
+static unsigned flush_count;
+
+
+static void GLAPIENTRY
+count_flush(void)
+{
+   flush_count++;
+}
+
+
+static void GLAPIENTRY
+noop(void)
+{
+}
+
+
+static struct _glapi_table *
+create_table(void)
+{
+   const unsigned size = _glapi_get_dispatch_table_size();
+   _glapi_proc *table = (_glapi_proc *) malloc(size * sizeof(_glapi_proc));
+
+   for (unsigned i = 0; i < size; i++)
+      table[i] = noop;
+   table[_glapi_get_proc_offset("glFlush")] = count_flush;
+
+   return (struct _glapi_table *) table;
+}
+
+
+static void
+call_flush(void *data)
+{
+   for (unsigned i = 0; i < CALLS; i++)
+      glFlush();
+}
+
+
+static void
+get_context(void *data)
+{
+   for (unsigned i = 0; i < CALLS; i++) {
+      if (!_glapi_get_context())
+         abort();
+   }
+}
+
+
+static PIPE_THREAD_ROUTINE(make_current, table)
+{
+   _glapi_check_multithread();
+   _glapi_set_dispatch((struct _glapi_table *) table);
+   return NULL;
+}
+
+
+TEST(GlapiPerf, Dispatch)
+{
+   struct _glapi_table *table = create_table();
+   static int context;
+
+   _glapi_check_multithread();
+   _glapi_set_dispatch(table);
+   _glapi_set_context(&context);
+
+   /* ns per call */
+   perf_measure("glapi.dispatch", call_flush, NULL, CALLS);
+   perf_measure("glapi.get_context", get_context, NULL, CALLS);
+
+   /* Once a second thread makes a table current, the non-TLS paths stop
+    * trusting the global pointers.
+    */
+   pipe_thread thread = pipe_thread_create(make_current, table);
+   pipe_thread_wait(thread);
+   _glapi_set_dispatch(table);
+   _glapi_set_context(&context);
+
+   perf_measure("glapi.dispatch_mt", call_flush, NULL, CALLS);
+   perf_measure("glapi.get_context_mt", get_context, NULL, CALLS);
+
+   EXPECT_GT(flush_count, 0u);
+
+   _glapi_set_dispatch(NULL);
+   _glapi_set_context(NULL);
+   free(table);
+}
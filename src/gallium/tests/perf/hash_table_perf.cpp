@@ -0,0 +1,120 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Insertion, lookup and removal in the open addressing hash table of
+ * mesa/main/hash_table.c.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "main/hash_table.h"
+
+#include "perf_harness.h"
+
+
+#define COUNT 4096
+
+
+struct hash_job {
+   struct hash_table *ht;
+   uintptr_t keys[COUNT];
+};
+
+
+static uint32_t
+key_hash(uintptr_t key)
+{
+   return _mesa_hash_data(&key, sizeof(key));
+}
+
+
+static void
+insert_remove(void *data)
+{
+   struct hash_job *job = (struct hash_job *) data;
+   struct hash_table *ht = _mesa_hash_table_create(NULL,
+                                                   _mesa_key_pointer_equal);
+
+   for (unsigned i = 0; i < COUNT; i++)
+      _mesa_hash_table_insert(ht, key_hash(job->keys[i]),
+                              (void *) job->keys[i], NULL);
+
+   for (unsigned i = 0; i < COUNT; i++) {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(ht, key_hash(job->keys[i]),
+                                 (void *) job->keys[i]);
+      _mesa_hash_table_remove(ht, entry);
+   }
+
+   _mesa_hash_table_destroy(ht, NULL);
+}
+
+
+static void
+search(void *data)
+{
+   struct hash_job *job = (struct hash_job *) data;
+
+   for (unsigned i = 0; i < COUNT; i++)
+      _mesa_hash_table_search(job->ht, key_hash(job->keys[i]),
+                              (void *) job->keys[i]);
+}
+
+
+static void
+search_missing(void *data)
+{
+   struct hash_job *job = (struct hash_job *) data;
+
+   for (unsigned i = 0; i < COUNT; i++) {
+      uintptr_t key = job->keys[i] + 1;
+      _mesa_hash_table_search(job->ht, key_hash(key), (void *) key);
+   }
+}
+
+
+TEST(HashTablePerf, Ops)
+{
+   struct hash_job *job = new hash_job;
+
+   /* pointer like keys, which is what the table is mostly used with */
+   for (unsigned i = 0; i < COUNT; i++)
+      job->keys[i] = 0x10000 + i * 64;
+
+   job->ht = _mesa_hash_table_create(NULL, _mesa_key_pointer_equal);
+   for (unsigned i = 0; i < COUNT; i++)
+      _mesa_hash_table_insert(job->ht, key_hash(job->keys[i]),
+                              (void *) job->keys[i], NULL);
+
+   /* ns per key */
+   perf_measure("hash_table.insert_remove", insert_remove, job, COUNT);
+   perf_measure("hash_table.search", search, job, COUNT);
+   perf_measure("hash_table.search_missing", search_missing, job, COUNT);
+
+   _mesa_hash_table_destroy(job->ht, NULL);
+   delete job;
+}
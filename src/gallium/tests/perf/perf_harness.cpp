@@ -0,0 +1,158 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+#include "os/os_time.h"
+
+#include "perf_harness.h"
+
+
+static std::map<std::string, double> *baseline = NULL;
+
+
+static void
+load_baseline(void)
+{
+   const char *file_name = getenv("PERF_BASELINE");
+   char line[512];
+   FILE *fp;
+
+   baseline = new std::map<std::string, double>;
+
+   if (!file_name)
+      return;
+
+   fp = fopen(file_name, "r");
+   if (!fp) {
+      fprintf(stderr, "perf: can't open baseline %s\n", file_name);
+      return;
+   }
+
+   while (fgets(line, sizeof line, fp)) {
+      char name[256];
+      double ns;
+
+      if (line[0] == '#')
+         continue;
+      if (sscanf(line, "%255s %lf", name, &ns) == 2)
+         (*baseline)[name] = ns;
+   }
+
+   fclose(fp);
+}
+
+
+static double
+get_tolerance(void)
+{
+   const char *value = getenv("PERF_TOLERANCE");
+
+   return (value ? atof(value) : 10.0) / 100.0;
+}
+
+
+/**
+ * Number of calls of func that take at least PERF_SAMPLE_NS.
+ */
+static unsigned
+calibrate(perf_func func, void *data)
+{
+   unsigned calls = 1;
+
+   for (;;) {
+      int64_t start = os_time_get_nano();
+      for (unsigned i = 0; i < calls; i++)
+         func(data);
+      if (os_time_get_nano() - start >= PERF_SAMPLE_NS || calls >= (1u << 30))
+         return calls;
+      calls *= 2;
+   }
+}
+
+
+void
+perf_measure(const char *name, perf_func func, void *data, unsigned ops)
+{
+   double samples[PERF_SAMPLES];
+   int64_t start, end;
+   unsigned calls;
+
+   if (!baseline)
+      load_baseline();
+
+   start = os_time_get_nano();
+   do {
+      func(data);
+   } while (os_time_get_nano() - start < PERF_WARMUP_NS);
+
+   calls = calibrate(func, data);
+
+   for (unsigned s = 0; s < PERF_SAMPLES; s++) {
+      start = os_time_get_nano();
+      for (unsigned i = 0; i < calls; i++)
+         func(data);
+      end = os_time_get_nano();
+
+      samples[s] = (double) (end - start) / ((double) calls * ops);
+   }
+
+   std::sort(samples, samples + PERF_SAMPLES);
+
+   const double q1 = samples[PERF_SAMPLES / 4];
+   const double median = samples[PERF_SAMPLES / 2];
+   const double q3 = samples[PERF_SAMPLES * 3 / 4];
+
+   printf("[   PERF   ] %s: %.3f ns (%.3f - %.3f)\n", name, median, q1, q3);
+
+   const char *output = getenv("PERF_OUTPUT");
+   if (output) {
+      FILE *fp = fopen(output, "a");
+      if (fp) {
+         fprintf(fp, "%s %.3f\n", name, median);
+         fclose(fp);
+      }
+   }
+
+   std::map<std::string, double>::const_iterator it = baseline->find(name);
+   if (it == baseline->end())
+      return;
+
+   const double tolerance = get_tolerance();
+
+   EXPECT_LE(q1, it->second * (1.0 + tolerance))
+      << name << " regressed: " << median << " ns against a baseline of "
+      << it->second << " ns";
+
+   if (q3 < it->second * (1.0 - tolerance))
+      printf("[   PERF   ] %s is faster than its baseline of %.3f ns, "
+             "update it\n", name, it->second);
+}
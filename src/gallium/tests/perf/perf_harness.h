@@ -0,0 +1,69 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Timing harness of the performance regression tests.
+ *
+ * perf_measure() runs a function until warm, then takes PERF_SAMPLES
+ * samples of it, each one long enough to be well above the clock
+ * resolution.  The median time per operation is printed and, if
+ * PERF_BASELINE names a baseline file, compared against it:
+ *
+ *  - a test fails when even the first quartile of the samples is slower
+ *    than the baseline by more than PERF_TOLERANCE percent (10 by
+ *    default), so that a single noisy sample can't fail it;
+ *  - when the third quartile is faster by as much, a note says that the
+ *    baseline should be updated.
+ *
+ * Tests without a baseline always pass.  PERF_OUTPUT names a file the
+ * results are appended to, in the baseline format: one "<name> <ns>" line
+ * per measurement, '#' starting a comment.
+ */
+
+#ifndef PERF_HARNESS_H
+#define PERF_HARNESS_H
+
+
+#define PERF_SAMPLES 21
+
+/** Minimum length of a sample, in nanoseconds */
+#define PERF_SAMPLE_NS 2000000
+
+/** Time each function is run before it is measured, in nanoseconds */
+#define PERF_WARMUP_NS 20000000
+
+
+typedef void (*perf_func)(void *data);
+
+
+/**
+ * Measure func, which does the given number of operations per call, and
+ * check the median nanoseconds per operation against the baseline.
+ */
+void
+perf_measure(const char *name, perf_func func, void *data, unsigned ops);
+
+
+#endif /* PERF_HARNESS_H */
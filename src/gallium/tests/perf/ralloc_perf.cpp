@@ -0,0 +1,114 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * ralloc allocation patterns of the GLSL compiler: many small children of
+ * a context, strings, and freeing a whole tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ralloc.h"
+
+#include "perf_harness.h"
+
+
+#define COUNT 1024
+
+
+static void
+alloc_free_tree(void *data)
+{
+   void *ctx = ralloc_context(NULL);
+
+   (void) data;
+
+   for (unsigned i = 0; i < COUNT; i++)
+      ralloc_size(ctx, 16 + (i & 63));
+
+   ralloc_free(ctx);
+}
+
+
+static void
+nested(void *data)
+{
+   void *ctx = ralloc_context(NULL);
+   void *parent = ctx;
+
+   (void) data;
+
+   for (unsigned i = 0; i < COUNT; i++) {
+      void *child = ralloc_size(parent, 32);
+      if ((i & 7) == 7)
+         parent = child;
+   }
+
+   ralloc_free(ctx);
+}
+
+
+static void
+free_each(void *data)
+{
+   void *ctx = ralloc_context(NULL);
+   void *ptrs[COUNT];
+
+   (void) data;
+
+   for (unsigned i = 0; i < COUNT; i++)
+      ptrs[i] = ralloc_size(ctx, 24);
+   for (unsigned i = 0; i < COUNT; i++)
+      ralloc_free(ptrs[i]);
+
+   ralloc_free(ctx);
+}
+
+
+static void
+strings(void *data)
+{
+   void *ctx = ralloc_context(NULL);
+   char *str = ralloc_strdup(ctx, "");
+
+   (void) data;
+
+   for (unsigned i = 0; i < COUNT; i++) {
+      ralloc_strdup(ctx, "gl_FragColor");
+      ralloc_asprintf_append(&str, "%u,", i);
+   }
+
+   ralloc_free(ctx);
+}
+
+
+TEST(RallocPerf, Ops)
+{
+   /* ns per allocation */
+   perf_measure("ralloc.alloc_free_tree", alloc_free_tree, NULL, COUNT);
+   perf_measure("ralloc.nested", nested, NULL, COUNT);
+   perf_measure("ralloc.free_each", free_each, NULL, COUNT);
+   perf_measure("ralloc.strings", strings, NULL, COUNT * 2);
+}
@@ -0,0 +1,107 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Walking the tokens of a shader with tgsi_parse, as every driver
+ * compiler and tgsi utility does.
+ */
+
+#include <gtest/gtest.h>
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_memory.h"
+
+#include "perf_harness.h"
+
+
+/* a typical per pixel lighting shader */
+static const char *shader_text =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL IN[1], GENERIC[1], PERSPECTIVE\n"
+   "DCL IN[2], GENERIC[2], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL CONST[0..7]\n"
+   "DCL TEMP[0..5]\n"
+   "IMM FLT32 { 0.0, 1.0, 2.0, 16.0 }\n"
+   "  0: DP3 TEMP[0].x, IN[1], IN[1]\n"
+   "  1: RSQ TEMP[0].x, TEMP[0].xxxx\n"
+   "  2: MUL TEMP[0].xyz, IN[1], TEMP[0].xxxx\n"
+   "  3: DP3 TEMP[1].x, IN[2], IN[2]\n"
+   "  4: RSQ TEMP[1].x, TEMP[1].xxxx\n"
+   "  5: MUL TEMP[1].xyz, IN[2], TEMP[1].xxxx\n"
+   "  6: DP3_SAT TEMP[2].x, TEMP[0], TEMP[1]\n"
+   "  7: ADD TEMP[3].xyz, TEMP[0], CONST[0]\n"
+   "  8: DP3 TEMP[3].w, TEMP[3], TEMP[3]\n"
+   "  9: RSQ TEMP[3].w, TEMP[3].wwww\n"
+   " 10: MUL TEMP[3].xyz, TEMP[3], TEMP[3].wwww\n"
+   " 11: DP3_SAT TEMP[3].x, TEMP[3], TEMP[1]\n"
+   " 12: POW TEMP[3].x, TEMP[3].xxxx, IMM[0].wwww\n"
+   " 13: TEX TEMP[4], IN[0], SAMP[0], 2D\n"
+   " 14: MUL TEMP[5], TEMP[4], CONST[1]\n"
+   " 15: MAD TEMP[5], TEMP[5], TEMP[2].xxxx, CONST[2]\n"
+   " 16: MAD TEMP[5].xyz, CONST[3], TEMP[3].xxxx, TEMP[5]\n"
+   " 17: CMP TEMP[5], -TEMP[2].xxxx, TEMP[5], CONST[4]\n"
+   " 18: LRP TEMP[5].xyz, CONST[5].wwww, CONST[5], TEMP[5]\n"
+   " 19: MIN TEMP[5], TEMP[5], IMM[0].yyyy\n"
+   " 20: MAX TEMP[5], TEMP[5], IMM[0].xxxx\n"
+   " 21: MOV OUT[0], TEMP[5]\n"
+   " 22: END\n";
+
+
+static void
+parse_shader(void *data)
+{
+   const struct tgsi_token *tokens = (const struct tgsi_token *) data;
+   struct tgsi_parse_context parse;
+
+   tgsi_parse_init(&parse, tokens);
+   while (!tgsi_parse_end_of_tokens(&parse))
+      tgsi_parse_token(&parse);
+   tgsi_parse_free(&parse);
+}
+
+
+TEST(TgsiParsePerf, Parse)
+{
+   struct tgsi_token tokens[1024];
+   struct tgsi_parse_context parse;
+   unsigned count = 0;
+
+   ASSERT_TRUE(tgsi_text_translate(shader_text, tokens, Elements(tokens)));
+
+   tgsi_parse_init(&parse, tokens);
+   while (!tgsi_parse_end_of_tokens(&parse)) {
+      tgsi_parse_token(&parse);
+      count++;
+   }
+   tgsi_parse_free(&parse);
+
+   /* ns per declaration, immediate or instruction */
+   perf_measure("tgsi_parse.shader", parse_shader, tokens, count);
+}
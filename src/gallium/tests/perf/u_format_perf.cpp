@@ -0,0 +1,140 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * u_format pack/unpack of whole rows, through the per-format functions
+ * drivers and the state trackers call.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "util/u_format.h"
+#include "util/u_memory.h"
+
+#include "perf_harness.h"
+
+
+#define WIDTH 256
+#define HEIGHT 16
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_R8G8B8A8_UNORM,
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_B5G6R5_UNORM,
+   PIPE_FORMAT_R16G16B16A16_FLOAT,
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+   PIPE_FORMAT_Z24_UNORM_S8_UINT,
+};
+
+
+struct format_job {
+   const struct util_format_description *desc;
+   uint8_t *packed;
+   unsigned packed_stride;
+   uint8_t *rgba8;
+   float *rgbaf;
+};
+
+
+static void
+unpack_8unorm(void *data)
+{
+   struct format_job *job = (struct format_job *) data;
+   job->desc->unpack_rgba_8unorm(job->rgba8, WIDTH * 4,
+                                 job->packed, job->packed_stride,
+                                 WIDTH, HEIGHT);
+}
+
+
+static void
+pack_8unorm(void *data)
+{
+   struct format_job *job = (struct format_job *) data;
+   job->desc->pack_rgba_8unorm(job->packed, job->packed_stride,
+                               job->rgba8, WIDTH * 4,
+                               WIDTH, HEIGHT);
+}
+
+
+static void
+unpack_float(void *data)
+{
+   struct format_job *job = (struct format_job *) data;
+   job->desc->unpack_rgba_float(job->rgbaf, WIDTH * 4 * sizeof(float),
+                                job->packed, job->packed_stride,
+                                WIDTH, HEIGHT);
+}
+
+
+static void
+pack_float(void *data)
+{
+   struct format_job *job = (struct format_job *) data;
+   job->desc->pack_rgba_float(job->packed, job->packed_stride,
+                              job->rgbaf, WIDTH * 4 * sizeof(float),
+                              WIDTH, HEIGHT);
+}
+
+
+TEST(UFormatPerf, PackUnpack)
+{
+   struct format_job job;
+
+   job.packed_stride = WIDTH * 16;
+   job.packed = (uint8_t *) CALLOC(job.packed_stride, HEIGHT);
+   job.rgba8 = (uint8_t *) CALLOC(WIDTH * 4, HEIGHT);
+   job.rgbaf = (float *) CALLOC(WIDTH * 4 * sizeof(float), HEIGHT);
+
+   for (unsigned i = 0; i < WIDTH * 4 * HEIGHT; i++) {
+      job.rgba8[i] = i * 7;
+      job.rgbaf[i] = (i % 255) / 255.0f;
+   }
+
+   for (unsigned i = 0; i < Elements(formats); i++) {
+      std::string name = util_format_short_name(formats[i]);
+
+      job.desc = util_format_description(formats[i]);
+      ASSERT_TRUE(job.desc != NULL);
+
+      /* ns per pixel */
+      if (job.desc->unpack_rgba_8unorm)
+         perf_measure((name + ".unpack_rgba_8unorm").c_str(),
+                      unpack_8unorm, &job, WIDTH * HEIGHT);
+      if (job.desc->pack_rgba_8unorm)
+         perf_measure((name + ".pack_rgba_8unorm").c_str(),
+                      pack_8unorm, &job, WIDTH * HEIGHT);
+      if (job.desc->unpack_rgba_float)
+         perf_measure((name + ".unpack_rgba_float").c_str(),
+                      unpack_float, &job, WIDTH * HEIGHT);
+      if (job.desc->pack_rgba_float)
+         perf_measure((name + ".pack_rgba_float").c_str(),
+                      pack_float, &job, WIDTH * HEIGHT);
+   }
+
+   FREE(job.packed);
+   FREE(job.rgba8);
+   FREE(job.rgbaf);
+}
@@ -0,0 +1,153 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * u_indices translation and generation, as used by drivers without
+ * native support for some primitives or index sizes.
+ */
+
+#include <gtest/gtest.h>
+
+#include "pipe/p_defines.h"
+#include "util/u_memory.h"
+
+extern "C" {
+#include "indices/u_indices.h"
+}
+
+#include "perf_harness.h"
+
+
+#define COUNT (64 * 1024)
+
+
+struct indices_job {
+   u_translate_func translate;
+   u_generate_func generate;
+   unsigned nr;
+   void *in;
+   void *out;
+};
+
+
+static void
+translate(void *data)
+{
+   struct indices_job *job = (struct indices_job *) data;
+   job->translate(job->in, job->nr, job->out);
+}
+
+
+static void
+generate(void *data)
+{
+   struct indices_job *job = (struct indices_job *) data;
+   job->generate(job->nr, job->out);
+}
+
+
+TEST(UIndicesPerf, Translate)
+{
+   static const struct {
+      const char *name;
+      unsigned prim;
+      unsigned in_size;
+      unsigned in_pv;
+   } cases[] = {
+      { "quads.ushort", PIPE_PRIM_QUADS, 2, PV_LAST },
+      { "quads.uint", PIPE_PRIM_QUADS, 4, PV_LAST },
+      { "tristrip.ushort", PIPE_PRIM_TRIANGLE_STRIP, 2, PV_LAST },
+      { "trifan.uint", PIPE_PRIM_TRIANGLE_FAN, 4, PV_LAST },
+      { "tris.ubyte", PIPE_PRIM_TRIANGLES, 1, PV_LAST },
+      { "tris.ushort.pv", PIPE_PRIM_TRIANGLES, 2, PV_FIRST },
+   };
+   struct indices_job job;
+
+   u_index_init();
+
+   job.in = CALLOC(COUNT, 4);
+   job.out = CALLOC(COUNT * 3, 4);
+
+   for (unsigned i = 0; i < Elements(cases); i++) {
+      unsigned out_prim, out_size, out_nr;
+      int ret;
+
+      ret = u_index_translator(1 << PIPE_PRIM_TRIANGLES, cases[i].prim,
+                               cases[i].in_size, COUNT,
+                               cases[i].in_pv, PV_LAST,
+                               &out_prim, &out_size, &out_nr,
+                               &job.translate);
+      ASSERT_NE(U_TRANSLATE_ERROR, ret);
+      if (ret == U_TRANSLATE_MEMCPY)
+         continue;
+
+      /* ns per output index */
+      job.nr = out_nr;
+      perf_measure((std::string("u_index_translator.") + cases[i].name).c_str(),
+                   translate, &job, out_nr);
+   }
+
+   FREE(job.in);
+   FREE(job.out);
+}
+
+
+TEST(UIndicesPerf, Generate)
+{
+   static const struct {
+      const char *name;
+      unsigned prim;
+   } cases[] = {
+      { "quads", PIPE_PRIM_QUADS },
+      { "tristrip", PIPE_PRIM_TRIANGLE_STRIP },
+      { "lineloop", PIPE_PRIM_LINE_LOOP },
+   };
+   struct indices_job job;
+
+   u_index_init();
+
+   job.out = CALLOC(COUNT * 3, 4);
+
+   for (unsigned i = 0; i < Elements(cases); i++) {
+      unsigned out_prim, out_size, out_nr;
+      int ret;
+
+      ret = u_index_generator((1 << PIPE_PRIM_TRIANGLES) |
+                              (1 << PIPE_PRIM_LINES),
+                              cases[i].prim, 0, COUNT,
+                              PV_LAST, PV_LAST,
+                              &out_prim, &out_size, &out_nr,
+                              &job.generate);
+      ASSERT_NE(U_TRANSLATE_ERROR, ret);
+      if (ret == U_GENERATE_LINEAR)
+         continue;
+
+      job.nr = out_nr;
+      perf_measure((std::string("u_index_generator.") + cases[i].name).c_str(),
+                   generate, &job, out_nr);
+   }
+
+   FREE(job.out);
+}
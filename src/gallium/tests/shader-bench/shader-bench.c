@@ -0,0 +1,474 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Compile benchmark for the GLSL to TGSI path of the state tracker.
+ *
+ * Compiles and links every shader-db/piglit style .shader_test file found
+ * in the given files and directories on an OSMesa context, then draws a
+ * point so that st/mesa translates the linked program to TGSI.  The
+ * screen is the noop driver on top of softpipe, so nothing is rendered.
+ *
+ * For each program it prints the link and translation times and the TGSI
+ * instruction and temporary counts of each stage, followed by totals.
+ *
+ * Usage: shader-bench [-n iterations] <file or directory>...
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "GL/osmesa.h"
+#include "GL/glext.h"
+
+#include "main/context.h"
+#include "main/shaderobj.h"
+#include "os/os_time.h"
+#include "pipe/p_screen.h"
+#include "state_tracker/sw_winsys.h"
+#include "sw/null/null_sw_winsys.h"
+#include "softpipe/sp_public.h"
+#include "noop/noop_public.h"
+#include "tgsi/tgsi_scan.h"
+#include "util/u_math.h"
+#include "state_tracker/st_program.h"
+
+
+#define MAX_SHADERS 8
+
+struct shader_source {
+   GLenum type;
+   const char *text;
+};
+
+struct stage_count {
+   unsigned instructions;
+   unsigned temps;
+};
+
+struct bench_totals {
+   unsigned programs;
+   unsigned failed;
+   unsigned skipped;
+   int64_t link_time;
+   int64_t translate_time;
+   struct stage_count stage[MESA_SHADER_TYPES];
+};
+
+static PFNGLCREATESHADERPROC CreateShader;
+static PFNGLSHADERSOURCEPROC ShaderSource;
+static PFNGLCOMPILESHADERPROC CompileShader;
+static PFNGLGETSHADERIVPROC GetShaderiv;
+static PFNGLATTACHSHADERPROC AttachShader;
+static PFNGLDELETESHADERPROC DeleteShader;
+static PFNGLCREATEPROGRAMPROC CreateProgram;
+static PFNGLLINKPROGRAMPROC LinkProgram;
+static PFNGLGETPROGRAMIVPROC GetProgramiv;
+static PFNGLUSEPROGRAMPROC UseProgram;
+static PFNGLDELETEPROGRAMPROC DeleteProgram;
+static void (GLAPIENTRYP DrawArrays)(GLenum mode, GLint first, GLsizei count);
+
+static unsigned iterations = 1;
+static const char *stage_names[MESA_SHADER_TYPES] = { "VS", "GS", "FS" };
+
+
+/**
+ * Called by the OSMesa state tracker to create its screen.
+ */
+struct pipe_screen *
+osmesa_create_screen(void);
+
+struct pipe_screen *
+osmesa_create_screen(void)
+{
+   struct sw_winsys *winsys;
+   struct pipe_screen *screen;
+
+   winsys = null_sw_create();
+   if (!winsys)
+      return NULL;
+
+   screen = softpipe_create_screen(winsys);
+   if (!screen) {
+      winsys->destroy(winsys);
+      return NULL;
+   }
+
+   return noop_screen_create(screen);
+}
+
+
+static void *
+get_proc(const char *name)
+{
+   void *proc = (void *) OSMesaGetProcAddress(name);
+
+   if (!proc) {
+      fprintf(stderr, "shader-bench: %s not available\n", name);
+      exit(1);
+   }
+   return proc;
+}
+
+
+static char *
+read_file(const char *filename)
+{
+   FILE *file = fopen(filename, "rb");
+   char *text;
+   long size;
+
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   text = malloc(size + 1);
+   if (text && fread(text, 1, size, file) != (size_t) size) {
+      free(text);
+      text = NULL;
+   }
+   if (text)
+      text[size] = '\0';
+
+   fclose(file);
+   return text;
+}
+
+
+/**
+ * Split a .shader_test file into its GLSL sections, in place.
+ *
+ * \return the number of shaders, or -1 if the file uses sections this
+ *         harness can't compile (ARB programs).
+ */
+static int
+parse_shader_test(char *text, struct shader_source *shaders)
+{
+   int num_shaders = 0;
+   char *line = text;
+
+   while (line && *line) {
+      char *next = strchr(line, '\n');
+
+      if (next)
+         next++;
+
+      if (line[0] == '[') {
+         GLenum type = 0;
+
+         *line = '\0';   /* terminate the previous section */
+
+         if (strncmp(line + 1, "vertex shader]", 14) == 0)
+            type = GL_VERTEX_SHADER;
+         else if (strncmp(line + 1, "geometry shader]", 16) == 0)
+            type = GL_GEOMETRY_SHADER;
+         else if (strncmp(line + 1, "fragment shader]", 16) == 0)
+            type = GL_FRAGMENT_SHADER;
+         else if (strncmp(line + 1, "vertex program]", 15) == 0 ||
+                  strncmp(line + 1, "fragment program]", 17) == 0)
+            return -1;
+
+         if (type && next && num_shaders < MAX_SHADERS) {
+            shaders[num_shaders].type = type;
+            shaders[num_shaders].text = next;
+            num_shaders++;
+         }
+      }
+
+      line = next;
+   }
+
+   return num_shaders;
+}
+
+
+static void
+count_tokens(const struct tgsi_token *tokens, struct stage_count *count)
+{
+   struct tgsi_shader_info info;
+
+   tgsi_scan_shader(tokens, &info);
+   count->instructions = info.num_instructions;
+   count->temps = info.file_max[TGSI_FILE_TEMPORARY] + 1;
+}
+
+
+/**
+ * Find the TGSI st/mesa generated for each stage of the current draw.
+ */
+static void
+count_program(GLuint name, struct stage_count *counts)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct gl_shader_program *shProg = _mesa_lookup_shader_program(ctx, name);
+   struct gl_shader **linked = shProg->_LinkedShaders;
+
+   memset(counts, 0, sizeof(counts[0]) * MESA_SHADER_TYPES);
+
+   if (linked[MESA_SHADER_VERTEX]) {
+      struct st_vertex_program *stvp = st_vertex_program(
+         (struct gl_vertex_program *) linked[MESA_SHADER_VERTEX]->Program);
+
+      if (stvp->variants && stvp->variants->tgsi.tokens)
+         count_tokens(stvp->variants->tgsi.tokens,
+                      &counts[MESA_SHADER_VERTEX]);
+   }
+
+   if (linked[MESA_SHADER_GEOMETRY]) {
+      struct st_geometry_program *stgp = st_geometry_program(
+         (struct gl_geometry_program *) linked[MESA_SHADER_GEOMETRY]->Program);
+
+      if (stgp->tgsi.tokens)
+         count_tokens(stgp->tgsi.tokens, &counts[MESA_SHADER_GEOMETRY]);
+   }
+
+   if (linked[MESA_SHADER_FRAGMENT]) {
+      struct st_fragment_program *stfp = st_fragment_program(
+         (struct gl_fragment_program *) linked[MESA_SHADER_FRAGMENT]->Program);
+
+      if (stfp->variants && stfp->variants->tgsi.tokens)
+         count_tokens(stfp->variants->tgsi.tokens,
+                      &counts[MESA_SHADER_FRAGMENT]);
+   }
+}
+
+
+/**
+ * Compile, link and translate one program.
+ *
+ * \return FALSE if it failed to compile or link.
+ */
+static GLboolean
+build_program(const struct shader_source *shaders, int num_shaders,
+              int64_t *link_time, int64_t *translate_time,
+              struct stage_count *counts)
+{
+   GLuint shader_names[MAX_SHADERS];
+   GLuint prog;
+   GLint status = GL_TRUE;
+   int64_t start;
+   int i;
+
+   start = os_time_get();
+
+   prog = CreateProgram();
+   for (i = 0; i < num_shaders; i++) {
+      GLint compiled;
+
+      shader_names[i] = CreateShader(shaders[i].type);
+      ShaderSource(shader_names[i], 1, &shaders[i].text, NULL);
+      CompileShader(shader_names[i]);
+      GetShaderiv(shader_names[i], GL_COMPILE_STATUS, &compiled);
+      if (!compiled)
+         status = GL_FALSE;
+      AttachShader(prog, shader_names[i]);
+   }
+
+   if (status) {
+      LinkProgram(prog);
+      GetProgramiv(prog, GL_LINK_STATUS, &status);
+   }
+
+   *link_time = os_time_get() - start;
+   *translate_time = 0;
+
+   if (status) {
+      /* Draw to make st/mesa translate the program to TGSI. */
+      start = os_time_get();
+      UseProgram(prog);
+      DrawArrays(GL_POINTS, 0, 1);
+      *translate_time = os_time_get() - start;
+
+      count_program(prog, counts);
+      UseProgram(0);
+   }
+
+   for (i = 0; i < num_shaders; i++)
+      DeleteShader(shader_names[i]);
+   DeleteProgram(prog);
+
+   return status;
+}
+
+
+static void
+bench_file(const char *filename, struct bench_totals *totals)
+{
+   struct shader_source shaders[MAX_SHADERS];
+   struct stage_count counts[MESA_SHADER_TYPES];
+   int64_t link_time = 0, translate_time = 0;
+   char *text = read_file(filename);
+   int num_shaders;
+   unsigned n, i;
+
+   if (!text) {
+      fprintf(stderr, "shader-bench: can't read %s\n", filename);
+      return;
+   }
+
+   num_shaders = parse_shader_test(text, shaders);
+   if (num_shaders <= 0) {
+      totals->skipped++;
+      free(text);
+      return;
+   }
+
+   for (n = 0; n < iterations; n++) {
+      int64_t link, translate;
+
+      if (!build_program(shaders, num_shaders, &link, &translate, counts)) {
+         printf("%s: FAIL\n", filename);
+         totals->failed++;
+         free(text);
+         return;
+      }
+      link_time += link;
+      translate_time += translate;
+   }
+
+   link_time /= iterations;
+   translate_time /= iterations;
+
+   printf("%s: link %.3f ms, translate %.3f ms",
+          filename, link_time / 1000.0, translate_time / 1000.0);
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      if (counts[i].instructions) {
+         printf(", %s %u instructions %u temps", stage_names[i],
+                counts[i].instructions, counts[i].temps);
+      }
+      totals->stage[i].instructions += counts[i].instructions;
+      totals->stage[i].temps += counts[i].temps;
+   }
+   printf("\n");
+
+   totals->programs++;
+   totals->link_time += link_time;
+   totals->translate_time += translate_time;
+
+   free(text);
+}
+
+
+static void
+bench_path(const char *path, struct bench_totals *totals)
+{
+   struct stat st;
+   size_t len;
+
+   if (stat(path, &st) != 0) {
+      fprintf(stderr, "shader-bench: can't stat %s\n", path);
+      return;
+   }
+
+   if (S_ISDIR(st.st_mode)) {
+      DIR *dir = opendir(path);
+      struct dirent *entry;
+
+      if (!dir)
+         return;
+
+      while ((entry = readdir(dir)) != NULL) {
+         char child[4096];
+
+         if (entry->d_name[0] == '.')
+            continue;
+
+         snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+         bench_path(child, totals);
+      }
+      closedir(dir);
+      return;
+   }
+
+   len = strlen(path);
+   if (len > 12 && strcmp(path + len - 12, ".shader_test") == 0)
+      bench_file(path, totals);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct bench_totals totals;
+   OSMesaContext osmesa;
+   static GLubyte buffer[4 * 4 * 4];
+   int i = 1;
+   unsigned s;
+
+   if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+      iterations = MAX2(atoi(argv[2]), 1);
+      i = 3;
+   }
+
+   if (i >= argc) {
+      fprintf(stderr, "usage: %s [-n iterations] <file or directory>...\n",
+              argv[0]);
+      return 1;
+   }
+
+   /* Select the noop screen unless the user asked for a real driver. */
+   setenv("GALLIUM_NOOP", "1", 0);
+
+   osmesa = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, NULL);
+   if (!osmesa || !OSMesaMakeCurrent(osmesa, buffer, GL_UNSIGNED_BYTE, 4, 4)) {
+      fprintf(stderr, "shader-bench: failed to create a context\n");
+      return 1;
+   }
+
+   CreateShader = get_proc("glCreateShader");
+   ShaderSource = get_proc("glShaderSource");
+   CompileShader = get_proc("glCompileShader");
+   GetShaderiv = get_proc("glGetShaderiv");
+   AttachShader = get_proc("glAttachShader");
+   DeleteShader = get_proc("glDeleteShader");
+   CreateProgram = get_proc("glCreateProgram");
+   LinkProgram = get_proc("glLinkProgram");
+   GetProgramiv = get_proc("glGetProgramiv");
+   UseProgram = get_proc("glUseProgram");
+   DeleteProgram = get_proc("glDeleteProgram");
+   DrawArrays = get_proc("glDrawArrays");
+
+   memset(&totals, 0, sizeof(totals));
+   for (; i < argc; i++)
+      bench_path(argv[i], &totals);
+
+   printf("\n%u programs, %u failed, %u skipped\n",
+          totals.programs, totals.failed, totals.skipped);
+   printf("total link %.3f ms, translate %.3f ms\n",
+          totals.link_time / 1000.0, totals.translate_time / 1000.0);
+   for (s = 0; s < MESA_SHADER_TYPES; s++) {
+      printf("total %s: %u instructions, %u temps\n", stage_names[s],
+             totals.stage[s].instructions, totals.stage[s].temps);
+   }
+
+   OSMesaDestroyContext(osmesa);
+   return 0;
+}
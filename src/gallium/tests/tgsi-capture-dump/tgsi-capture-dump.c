@@ -0,0 +1,192 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Pretty-prints a TGSI_CAPTURE ring file, oldest shader first.
+ *
+ * Usage: tgsi-capture-dump [-u] <file>
+ *
+ * -u prints each distinct shader (by hash) only once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tgsi/tgsi_capture.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+
+
+#define MAX_SEEN 65536
+
+
+static uint8_t *
+read_file(const char *filename, long *size)
+{
+   FILE *file = fopen(filename, "rb");
+   uint8_t *data;
+
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   *size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   data = malloc(*size > 0 ? *size : 1);
+   if (data && fread(data, 1, *size, file) != (size_t) *size) {
+      free(data);
+      data = NULL;
+   }
+
+   fclose(file);
+   return data;
+}
+
+
+static boolean
+seen_before(uint64_t *seen, unsigned *num_seen, uint64_t hash)
+{
+   unsigned i;
+
+   for (i = 0; i < *num_seen; i++) {
+      if (seen[i] == hash)
+         return TRUE;
+   }
+
+   if (*num_seen < MAX_SEEN)
+      seen[(*num_seen)++] = hash;
+   return FALSE;
+}
+
+
+int
+main(int argc, char **argv)
+{
+   const struct tgsi_capture_header *header;
+   const uint8_t *ring;
+   boolean unique = FALSE;
+   const char *filename = NULL;
+   uint64_t *seen;
+   unsigned num_seen = 0, printed = 0;
+   uint8_t *data;
+   uint32_t pos, steps;
+   long size;
+   int i;
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-u") == 0)
+         unique = TRUE;
+      else
+         filename = argv[i];
+   }
+
+   if (!filename) {
+      fprintf(stderr, "usage: %s [-u] <file>\n", argv[0]);
+      return 1;
+   }
+
+   data = read_file(filename, &size);
+   if (!data) {
+      fprintf(stderr, "%s: couldn't read %s\n", argv[0], filename);
+      return 1;
+   }
+
+   header = (const struct tgsi_capture_header *) data;
+   if (size < (long) sizeof(*header) ||
+       header->magic != TGSI_CAPTURE_MAGIC ||
+       header->size > size - sizeof(*header) ||
+       header->head >= header->size || header->tail >= header->size) {
+      fprintf(stderr, "%s: %s is not a TGSI capture\n", argv[0], filename);
+      free(data);
+      return 1;
+   }
+
+   ring = (const uint8_t *) (header + 1);
+   seen = malloc(MAX_SEEN * sizeof(*seen));
+
+   /* Walk from tail to head.  The step limit guards against garbage left
+    * by a writer that died in the middle of a record.
+    */
+   pos = header->tail;
+   for (steps = 0; pos != header->head && steps < header->size / 8; steps++) {
+      const struct tgsi_capture_record *record;
+      const struct tgsi_token *tokens;
+
+      if (header->size - pos < 8) {
+         pos = 0;
+         continue;
+      }
+
+      record = (const struct tgsi_capture_record *) (ring + pos);
+      if (record->magic == TGSI_CAPTURE_PAD) {
+         pos = 0;
+         continue;
+      }
+
+      if (record->magic != TGSI_CAPTURE_RECORD ||
+          record->size < sizeof(*record) ||
+          record->size > header->size - pos ||
+          record->num_tokens * sizeof(struct tgsi_token) >
+          record->size - sizeof(*record)) {
+         fprintf(stderr, "%s: corrupt record at offset %u\n", argv[0], pos);
+         break;
+      }
+
+      tokens = (const struct tgsi_token *) (record + 1);
+
+      if (!unique || !seen || !seen_before(seen, &num_seen, record->hash)) {
+         printf("; shader %u, hash %016llx, time %lld ns, %u tokens\n",
+                record->sequence, (unsigned long long) record->hash,
+                (long long) record->time, record->num_tokens);
+         if (record->num_tokens >= 2 &&
+             tgsi_num_tokens(tokens) <= record->num_tokens) {
+            /* tgsi_dump() would go to stderr */
+            size_t text_size = record->num_tokens * 64 + 1024;
+            char *text = malloc(text_size);
+
+            if (text) {
+               tgsi_dump_str(tokens, 0, text, text_size);
+               fputs(text, stdout);
+               free(text);
+            }
+         }
+         printf("\n");
+         printed++;
+      }
+
+      pos += record->size;
+      if (pos >= header->size)
+         pos = 0;
+   }
+
+   fprintf(stderr, "%u shaders printed, %u captured in total\n",
+           printed, header->count);
+
+   free(seen);
+   free(data);
+   return 0;
+}
@@ -0,0 +1,1460 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Trace reader, see trace-parse.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/u_math.h"
+#include "util/u_string.h"
+#include "trace/tr_dump_binary.h"
+
+#include "trace-parse.h"
+
+
+#define INPUT_SIZE (256 * 1024)
+#define POOL_BLOCK_SIZE (64 * 1024)
+#define ATTR_SIZE 256
+#define MAX_ATTRS 4
+
+
+/*
+ * Memory pool for the values of the current call.
+ */
+
+struct pool_block
+{
+   struct pool_block *next;
+   size_t used;
+   size_t size;
+};
+
+
+static void *
+pool_alloc(struct pool_block **pool, size_t size)
+{
+   struct pool_block *block = *pool;
+   void *ptr;
+
+   size = (size + 7) & ~(size_t) 7;
+
+   if (!block || block->size - block->used < size) {
+      size_t block_size = MAX2(size, POOL_BLOCK_SIZE);
+
+      block = malloc(sizeof *block + block_size);
+      if (!block)
+         return NULL;
+      block->next = *pool;
+      block->used = 0;
+      block->size = block_size;
+      *pool = block;
+   }
+
+   ptr = (char *) (block + 1) + block->used;
+   block->used += size;
+   return ptr;
+}
+
+
+/**
+ * Keep the most recent block, which is usually big enough for a whole call.
+ */
+static void
+pool_reset(struct pool_block **pool)
+{
+   struct pool_block *block = *pool, *next;
+
+   if (!block)
+      return;
+
+   for (next = block->next; next; ) {
+      struct pool_block *tmp = next->next;
+      free(next);
+      next = tmp;
+   }
+
+   block->next = NULL;
+   block->used = 0;
+}
+
+
+static void
+pool_free(struct pool_block **pool)
+{
+   pool_reset(pool);
+   free(*pool);
+   *pool = NULL;
+}
+
+
+/*
+ * Interned strings, in an open addressing table that never shrinks.
+ */
+
+struct intern_table
+{
+   char **strings;
+   unsigned num;
+   unsigned size;
+};
+
+
+static unsigned
+intern_hash(const char *str, size_t len)
+{
+   unsigned hash = 2166136261u;
+   size_t i;
+
+   for (i = 0; i < len; i++)
+      hash = (hash ^ (uint8_t) str[i]) * 16777619u;
+   return hash;
+}
+
+
+static boolean
+intern_grow(struct intern_table *table)
+{
+   unsigned size = table->size ? table->size * 2 : 1024;
+   char **strings = calloc(size, sizeof *strings);
+   unsigned i;
+
+   if (!strings)
+      return FALSE;
+
+   for (i = 0; i < table->size; i++) {
+      char *str = table->strings[i];
+      unsigned j;
+
+      if (!str)
+         continue;
+      j = intern_hash(str, strlen(str)) & (size - 1);
+      while (strings[j])
+         j = (j + 1) & (size - 1);
+      strings[j] = str;
+   }
+
+   free(table->strings);
+   table->strings = strings;
+   table->size = size;
+   return TRUE;
+}
+
+
+static const char *
+intern(struct intern_table *table, const char *str, size_t len)
+{
+   unsigned i;
+   char *copy;
+
+   if ((table->num + 1) * 2 > table->size && !intern_grow(table))
+      return NULL;
+
+   i = intern_hash(str, len) & (table->size - 1);
+   while (table->strings[i]) {
+      if (strncmp(table->strings[i], str, len) == 0 &&
+          table->strings[i][len] == 0)
+         return table->strings[i];
+      i = (i + 1) & (table->size - 1);
+   }
+
+   copy = malloc(len + 1);
+   if (!copy)
+      return NULL;
+   memcpy(copy, str, len);
+   copy[len] = 0;
+
+   table->strings[i] = copy;
+   table->num++;
+   return copy;
+}
+
+
+static void
+intern_free(struct intern_table *table)
+{
+   unsigned i;
+
+   for (i = 0; i < table->size; i++)
+      free(table->strings[i]);
+   free(table->strings);
+}
+
+
+/*
+ * Reader state.
+ */
+
+enum xml_token
+{
+   XML_EOF,
+   XML_START,
+   XML_END,
+   XML_TEXT
+};
+
+
+struct trace_reader
+{
+   FILE *file;
+   boolean binary;
+   boolean error;
+   boolean started;
+
+   /* Input, raw file bytes for XML and decompressed chunks for binary */
+   uint8_t *buf;
+   size_t pos;
+   size_t len;
+   size_t size;
+   uint8_t *chunk;
+   size_t chunk_size;
+
+   struct intern_table strings;
+   struct pool_block *pool;
+
+   /* Binary name table */
+   const char **names;
+   unsigned num_names;
+   unsigned max_names;
+
+   /* XML tokenizer */
+   enum xml_token token;
+   boolean pending_end;
+   char tag[32];
+   unsigned num_attrs;
+   char attr_names[MAX_ATTRS][32];
+   char attr_values[MAX_ATTRS][ATTR_SIZE];
+   char *text;
+   size_t text_len;
+   size_t text_size;
+};
+
+
+static const struct trace_value null_value = { TRACE_VALUE_NULL };
+
+
+static void
+parse_error(struct trace_reader *reader, const char *message)
+{
+   if (!reader->error)
+      fprintf(stderr, "trace: %s\n", message);
+   reader->error = TRUE;
+}
+
+
+/**
+ * Decompress a single LZ4 block.  Returns FALSE on corrupt input.
+ */
+static boolean
+lz4_decompress(const uint8_t *src, size_t src_size,
+               uint8_t *dst, size_t dst_size)
+{
+   const uint8_t *src_end = src + src_size;
+   size_t out = 0;
+
+   while (src < src_end) {
+      unsigned token = *src++;
+      size_t length = token >> 4;
+      size_t offset;
+
+      if (length == 15) {
+         unsigned byte;
+         do {
+            if (src >= src_end)
+               return FALSE;
+            byte = *src++;
+            length += byte;
+         } while (byte == 255);
+      }
+      if (length > (size_t) (src_end - src) || length > dst_size - out)
+         return FALSE;
+      memcpy(dst + out, src, length);
+      src += length;
+      out += length;
+
+      /* The last sequence has no match */
+      if (src >= src_end)
+         break;
+
+      if (src_end - src < 2)
+         return FALSE;
+      offset = src[0] | (src[1] << 8);
+      src += 2;
+      if (offset == 0 || offset > out)
+         return FALSE;
+
+      length = token & 15;
+      if (length == 15) {
+         unsigned byte;
+         do {
+            if (src >= src_end)
+               return FALSE;
+            byte = *src++;
+            length += byte;
+         } while (byte == 255);
+      }
+      length += 4;
+      if (length > dst_size - out)
+         return FALSE;
+
+      /* Byte by byte, as the match may overlap its own output */
+      while (length--) {
+         dst[out] = dst[out - offset];
+         out++;
+      }
+   }
+
+   return out == dst_size;
+}
+
+
+static uint32_t
+read32(const uint8_t *p)
+{
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+/**
+ * Make room for \p size more bytes at the end of the input buffer, moving
+ * what's left to the front.
+ */
+static boolean
+input_reserve(struct trace_reader *reader, size_t size)
+{
+   if (reader->pos) {
+      memmove(reader->buf, reader->buf + reader->pos,
+              reader->len - reader->pos);
+      reader->len -= reader->pos;
+      reader->pos = 0;
+   }
+
+   if (reader->size - reader->len < size) {
+      size_t new_size = MAX2(reader->size * 2, reader->len + size);
+      uint8_t *buf = realloc(reader->buf, new_size);
+
+      if (!buf)
+         return FALSE;
+      reader->buf = buf;
+      reader->size = new_size;
+   }
+
+   return TRUE;
+}
+
+
+static boolean
+input_read_chunk(struct trace_reader *reader)
+{
+   uint8_t header[8];
+   uint32_t raw_size, compressed_size;
+
+   if (fread(header, sizeof header, 1, reader->file) != 1)
+      return FALSE;
+   raw_size = read32(header);
+   compressed_size = read32(header + 4);
+
+   if (!input_reserve(reader, raw_size))
+      return FALSE;
+
+   if (!compressed_size) {
+      if (fread(reader->buf + reader->len, 1, raw_size, reader->file) !=
+          raw_size)
+         return FALSE;
+   }
+   else {
+      if (reader->chunk_size < compressed_size) {
+         free(reader->chunk);
+         reader->chunk = malloc(compressed_size);
+         reader->chunk_size = reader->chunk ? compressed_size : 0;
+         if (!reader->chunk)
+            return FALSE;
+      }
+      if (fread(reader->chunk, 1, compressed_size, reader->file) !=
+          compressed_size)
+         return FALSE;
+      if (!lz4_decompress(reader->chunk, compressed_size,
+                          reader->buf + reader->len, raw_size)) {
+         parse_error(reader, "corrupt compressed chunk");
+         return FALSE;
+      }
+   }
+
+   reader->len += raw_size;
+   return TRUE;
+}
+
+
+/**
+ * Make sure at least \p size bytes are buffered.  Returns FALSE at the end
+ * of the input, which also covers traces cut short by a crash.
+ */
+static boolean
+input_fill(struct trace_reader *reader, size_t size)
+{
+   while (reader->len - reader->pos < size) {
+      if (reader->binary) {
+         if (!input_read_chunk(reader))
+            return FALSE;
+      }
+      else {
+         size_t n;
+
+         if (!input_reserve(reader, INPUT_SIZE))
+            return FALSE;
+         n = fread(reader->buf + reader->len, 1, INPUT_SIZE, reader->file);
+         if (!n)
+            return FALSE;
+         reader->len += n;
+      }
+   }
+   return TRUE;
+}
+
+
+static INLINE int
+input_peek(struct trace_reader *reader)
+{
+   if (reader->pos == reader->len && !input_fill(reader, 1))
+      return -1;
+   return reader->buf[reader->pos];
+}
+
+
+static INLINE int
+input_get(struct trace_reader *reader)
+{
+   int c = input_peek(reader);
+
+   if (c >= 0)
+      reader->pos++;
+   return c;
+}
+
+
+static struct trace_value *
+value_new(struct trace_reader *reader, enum trace_value_type type)
+{
+   struct trace_value *value = pool_alloc(&reader->pool, sizeof *value);
+
+   if (!value) {
+      parse_error(reader, "out of memory");
+      return NULL;
+   }
+   memset(value, 0, sizeof *value);
+   value->type = type;
+   return value;
+}
+
+
+/**
+ * Append a value to an array or a struct.  The arrays double in the pool
+ * and the old copies are simply left there until the next call.
+ */
+static void
+list_append(struct trace_reader *reader, struct trace_value *list,
+            const char *name, struct trace_value *value)
+{
+   unsigned num = list->u.list.num;
+
+   /* Grows at 0, 4, 8, 16... */
+   if (num == 0 || (num >= 4 && !(num & (num - 1)))) {
+      unsigned max = num ? num * 2 : 4;
+      const char **names = pool_alloc(&reader->pool, max * sizeof *names);
+      struct trace_value **values =
+         pool_alloc(&reader->pool, max * sizeof *values);
+
+      if (!names || !values) {
+         parse_error(reader, "out of memory");
+         return;
+      }
+      if (num) {
+         memcpy(names, list->u.list.names, num * sizeof *names);
+         memcpy(values, list->u.list.values, num * sizeof *values);
+      }
+      list->u.list.names = names;
+      list->u.list.values = values;
+   }
+
+   list->u.list.names[num] = name;
+   list->u.list.values[num] = value;
+   list->u.list.num++;
+}
+
+
+static const char *
+call_name(struct trace_reader *reader, const char *klass, const char *method)
+{
+   char name[256];
+
+   util_snprintf(name, sizeof name, "%s::%s", klass, method);
+   return intern(&reader->strings, name, strlen(name));
+}
+
+
+/*
+ * XML traces.
+ */
+
+static boolean
+text_append(struct trace_reader *reader, char c)
+{
+   if (reader->text_len + 1 >= reader->text_size) {
+      size_t size = MAX2(reader->text_size * 2, 256);
+      char *text = realloc(reader->text, size);
+
+      if (!text) {
+         parse_error(reader, "out of memory");
+         return FALSE;
+      }
+      reader->text = text;
+      reader->text_size = size;
+   }
+   reader->text[reader->text_len++] = c;
+   reader->text[reader->text_len] = 0;
+   return TRUE;
+}
+
+
+/**
+ * Read one character of text or of an attribute value, decoding the
+ * entities written by trace_dump_escape().
+ */
+static int
+xml_get_char(struct trace_reader *reader)
+{
+   char entity[16];
+   unsigned len = 0;
+   int c = input_get(reader);
+
+   if (c != '&')
+      return c;
+
+   while ((c = input_get(reader)) >= 0 && c != ';') {
+      if (len + 1 < sizeof entity)
+         entity[len++] = c;
+   }
+   entity[len] = 0;
+
+   if (entity[0] == '#')
+      return (uint8_t) strtoul(entity + 1, NULL, 10);
+   if (strcmp(entity, "lt") == 0)
+      return '<';
+   if (strcmp(entity, "gt") == 0)
+      return '>';
+   if (strcmp(entity, "amp") == 0)
+      return '&';
+   if (strcmp(entity, "apos") == 0)
+      return '\'';
+   if (strcmp(entity, "quot") == 0)
+      return '"';
+   return '?';
+}
+
+
+static boolean
+xml_is_name_char(int c)
+{
+   return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+          (c >= '0' && c <= '9') || c == '_' || c == '-' || c == ':' ||
+          c == '.';
+}
+
+
+static void
+xml_read_name(struct trace_reader *reader, char *name, size_t size)
+{
+   size_t len = 0;
+   int c;
+
+   while ((c = input_peek(reader)) >= 0 && xml_is_name_char(c)) {
+      input_get(reader);
+      if (len + 1 < size)
+         name[len++] = c;
+   }
+   name[len] = 0;
+}
+
+
+static void
+xml_skip_space(struct trace_reader *reader)
+{
+   int c;
+
+   while ((c = input_peek(reader)) == ' ' || c == '\t' || c == '\n' ||
+          c == '\r')
+      input_get(reader);
+}
+
+
+static void
+xml_start_tag(struct trace_reader *reader)
+{
+   int c;
+
+   xml_read_name(reader, reader->tag, sizeof reader->tag);
+   reader->num_attrs = 0;
+
+   for (;;) {
+      xml_skip_space(reader);
+      c = input_peek(reader);
+
+      if (c < 0) {
+         reader->token = XML_EOF;
+         return;
+      }
+      if (c == '>') {
+         input_get(reader);
+         break;
+      }
+      if (c == '/') {
+         input_get(reader);
+         input_get(reader);
+         reader->pending_end = TRUE;
+         break;
+      }
+
+      if (c == '=' || c == '\'' || c == '"' || !xml_is_name_char(c)) {
+         input_get(reader);
+         continue;
+      }
+
+      {
+         char name[32];
+         size_t len = 0;
+         int quote;
+
+         xml_read_name(reader, name, sizeof name);
+         xml_skip_space(reader);
+         if (input_get(reader) != '=')
+            continue;
+         xml_skip_space(reader);
+         quote = input_get(reader);
+         if (quote != '\'' && quote != '"')
+            continue;
+
+         if (reader->num_attrs < MAX_ATTRS) {
+            char *value = reader->attr_values[reader->num_attrs];
+
+            strcpy(reader->attr_names[reader->num_attrs], name);
+            while (input_peek(reader) >= 0 && input_peek(reader) != quote) {
+               c = xml_get_char(reader);
+               if (len + 1 < ATTR_SIZE)
+                  value[len++] = c;
+            }
+            value[len] = 0;
+            reader->num_attrs++;
+         }
+         else {
+            while (input_peek(reader) >= 0 && input_peek(reader) != quote)
+               input_get(reader);
+         }
+         input_get(reader);
+      }
+   }
+
+   reader->token = XML_START;
+}
+
+
+static void
+xml_skip_until(struct trace_reader *reader, char last)
+{
+   int c;
+
+   while ((c = input_get(reader)) >= 0 && c != last)
+      ;
+}
+
+
+/**
+ * Advance to the next token.  Whitespace between elements is dropped, and
+ * empty elements come out as a start and an end tag.
+ */
+static void
+xml_next(struct trace_reader *reader)
+{
+   int c;
+
+   if (reader->pending_end) {
+      reader->pending_end = FALSE;
+      reader->token = XML_END;
+      return;
+   }
+
+   for (;;) {
+      c = input_peek(reader);
+
+      if (c < 0) {
+         reader->token = XML_EOF;
+         return;
+      }
+
+      if (c == '<') {
+         input_get(reader);
+         c = input_peek(reader);
+         if (c == '?' || c == '!') {
+            xml_skip_until(reader, '>');
+            continue;
+         }
+         if (c == '/') {
+            input_get(reader);
+            xml_read_name(reader, reader->tag, sizeof reader->tag);
+            xml_skip_until(reader, '>');
+            reader->token = XML_END;
+            return;
+         }
+         xml_start_tag(reader);
+         return;
+      }
+
+      reader->text_len = 0;
+      while ((c = input_peek(reader)) >= 0 && c != '<') {
+         if (!text_append(reader, xml_get_char(reader)))
+            return;
+      }
+
+      {
+         size_t i;
+
+         for (i = 0; i < reader->text_len; i++) {
+            c = reader->text[i];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+               reader->token = XML_TEXT;
+               return;
+            }
+         }
+      }
+   }
+}
+
+
+static const char *
+xml_attr(struct trace_reader *reader, const char *name)
+{
+   unsigned i;
+
+   for (i = 0; i < reader->num_attrs; i++) {
+      if (strcmp(reader->attr_names[i], name) == 0)
+         return reader->attr_values[i];
+   }
+   return "";
+}
+
+
+static const char *
+xml_attr_intern(struct trace_reader *reader, const char *name)
+{
+   const char *value = xml_attr(reader, name);
+
+   return intern(&reader->strings, value, strlen(value));
+}
+
+
+static boolean
+xml_is_start(struct trace_reader *reader, const char *tag)
+{
+   return reader->token == XML_START && strcmp(reader->tag, tag) == 0;
+}
+
+
+static void
+xml_expect_end(struct trace_reader *reader, const char *tag)
+{
+   if (reader->token != XML_END || strcmp(reader->tag, tag) != 0) {
+      parse_error(reader, reader->token == XML_EOF ?
+                  "unexpected end of trace" : "malformed XML trace");
+      return;
+   }
+   xml_next(reader);
+}
+
+
+/**
+ * Skip the current element and anything inside it.
+ */
+static void
+xml_skip_element(struct trace_reader *reader)
+{
+   unsigned depth = 0;
+
+   do {
+      if (reader->token == XML_START)
+         depth++;
+      else if (reader->token == XML_END)
+         depth--;
+      else if (reader->token == XML_EOF)
+         return;
+      xml_next(reader);
+   } while (depth);
+}
+
+
+static int
+hex_digit(char c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   return 0;
+}
+
+
+static struct trace_value *
+xml_parse_value(struct trace_reader *reader)
+{
+   struct trace_value *value;
+   char tag[sizeof reader->tag];
+   const char *text;
+
+   if (reader->token != XML_START) {
+      parse_error(reader, "expected a value");
+      return NULL;
+   }
+
+   strcpy(tag, reader->tag);
+
+   if (strcmp(tag, "array") == 0) {
+      value = value_new(reader, TRACE_VALUE_ARRAY);
+      xml_next(reader);
+      while (value && !reader->error && xml_is_start(reader, "elem")) {
+         struct trace_value *elem;
+
+         xml_next(reader);
+         elem = xml_parse_value(reader);
+         xml_expect_end(reader, "elem");
+         list_append(reader, value, NULL, elem);
+      }
+      xml_expect_end(reader, "array");
+      return value;
+   }
+
+   if (strcmp(tag, "struct") == 0) {
+      value = value_new(reader, TRACE_VALUE_STRUCT);
+      if (value)
+         value->u.list.name = xml_attr_intern(reader, "name");
+      xml_next(reader);
+      while (value && !reader->error && xml_is_start(reader, "member")) {
+         const char *name = xml_attr_intern(reader, "name");
+         struct trace_value *member;
+
+         xml_next(reader);
+         member = xml_parse_value(reader);
+         xml_expect_end(reader, "member");
+         list_append(reader, value, name, member);
+      }
+      xml_expect_end(reader, "struct");
+      return value;
+   }
+
+   /* Scalars */
+   xml_next(reader);
+   text = "";
+   if (reader->token == XML_TEXT) {
+      text = reader->text;
+      xml_next(reader);
+   }
+
+   if (strcmp(tag, "null") == 0) {
+      value = value_new(reader, TRACE_VALUE_NULL);
+   }
+   else if (strcmp(tag, "bool") == 0 || strcmp(tag, "int") == 0) {
+      value = value_new(reader, tag[0] == 'b' ? TRACE_VALUE_BOOL :
+                                                TRACE_VALUE_INT);
+      if (value)
+         value->u.i = strtoll(text, NULL, 10);
+   }
+   else if (strcmp(tag, "uint") == 0) {
+      value = value_new(reader, TRACE_VALUE_UINT);
+      if (value)
+         value->u.u = strtoull(text, NULL, 10);
+   }
+   else if (strcmp(tag, "ptr") == 0) {
+      value = value_new(reader, TRACE_VALUE_PTR);
+      if (value)
+         value->u.u = strtoull(text, NULL, 16);
+   }
+   else if (strcmp(tag, "float") == 0) {
+      value = value_new(reader, TRACE_VALUE_FLOAT);
+      if (value)
+         value->u.f = strtod(text, NULL);
+   }
+   else if (strcmp(tag, "enum") == 0) {
+      value = value_new(reader, TRACE_VALUE_ENUM);
+      if (value)
+         value->u.name = intern(&reader->strings, text, strlen(text));
+   }
+   else if (strcmp(tag, "string") == 0 || strcmp(tag, "bytes") == 0) {
+      boolean bytes = tag[0] == 'b';
+      size_t len = strlen(text);
+      size_t size = bytes ? len / 2 : len;
+      char *data = pool_alloc(&reader->pool, size + 1);
+
+      value = value_new(reader, bytes ? TRACE_VALUE_BYTES :
+                                        TRACE_VALUE_STRING);
+      if (value && data) {
+         size_t i;
+
+         if (bytes) {
+            for (i = 0; i < size; i++)
+               data[i] = (hex_digit(text[2 * i]) << 4) |
+                         hex_digit(text[2 * i + 1]);
+         }
+         else {
+            memcpy(data, text, size);
+         }
+         data[size] = 0;
+         value->u.bytes.data = data;
+         value->u.bytes.size = size;
+      }
+   }
+   else {
+      parse_error(reader, "unknown value type");
+      return NULL;
+   }
+
+   xml_expect_end(reader, tag);
+   return value;
+}
+
+
+static boolean
+xml_next_call(struct trace_reader *reader, struct trace_call *call)
+{
+   if (!reader->started) {
+      xml_next(reader);
+      while (reader->token != XML_EOF && !xml_is_start(reader, "trace"))
+         xml_next(reader);
+      xml_next(reader);
+      reader->started = TRUE;
+   }
+
+   while (reader->token == XML_TEXT ||
+          (reader->token == XML_START && !xml_is_start(reader, "call")))
+      xml_skip_element(reader);
+
+   if (reader->error || !xml_is_start(reader, "call"))
+      return FALSE;
+
+   call->no = strtoul(xml_attr(reader, "no"), NULL, 10);
+   call->klass = xml_attr_intern(reader, "class");
+   call->method = xml_attr_intern(reader, "method");
+   xml_next(reader);
+
+   while (!reader->error && reader->token == XML_START) {
+      if (xml_is_start(reader, "arg")) {
+         const char *name = xml_attr_intern(reader, "name");
+         struct trace_value args = { TRACE_VALUE_ARRAY };
+         struct trace_value *value;
+
+         xml_next(reader);
+         value = xml_parse_value(reader);
+         xml_expect_end(reader, "arg");
+
+         args.u.list.num = call->num_args;
+         args.u.list.names = call->arg_names;
+         args.u.list.values = call->args;
+         list_append(reader, &args, name, value);
+         call->num_args = args.u.list.num;
+         call->arg_names = args.u.list.names;
+         call->args = args.u.list.values;
+      }
+      else if (xml_is_start(reader, "ret")) {
+         xml_next(reader);
+         call->ret = xml_parse_value(reader);
+         xml_expect_end(reader, "ret");
+      }
+      else if (xml_is_start(reader, "time")) {
+         xml_next(reader);
+         if (reader->token == XML_START) {
+            struct trace_value *time = xml_parse_value(reader);
+            call->time = trace_value_int(time);
+         }
+         xml_expect_end(reader, "time");
+      }
+      else {
+         xml_skip_element(reader);
+      }
+   }
+
+   xml_expect_end(reader, "call");
+   return !reader->error;
+}
+
+
+/*
+ * Binary traces.
+ */
+
+static int
+bin_op(struct trace_reader *reader)
+{
+   if (reader->pos == reader->len && !input_fill(reader, 1))
+      return -1;
+   return reader->buf[reader->pos++];
+}
+
+
+static uint64_t
+bin_uint(struct trace_reader *reader)
+{
+   uint64_t value = 0;
+   unsigned shift = 0;
+   int byte;
+
+   do {
+      byte = bin_op(reader);
+      if (byte < 0) {
+         parse_error(reader, "unexpected end of trace");
+         return 0;
+      }
+      if (shift < 64)
+         value |= (uint64_t) (byte & 0x7f) << shift;
+      shift += 7;
+   } while (byte & 0x80);
+
+   return value;
+}
+
+
+static int64_t
+bin_sint(struct trace_reader *reader)
+{
+   uint64_t value = bin_uint(reader);
+
+   return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+
+static const uint8_t *
+bin_read(struct trace_reader *reader, size_t size)
+{
+   const uint8_t *data;
+
+   if (!input_fill(reader, size)) {
+      parse_error(reader, "unexpected end of trace");
+      return NULL;
+   }
+   data = reader->buf + reader->pos;
+   reader->pos += size;
+   return data;
+}
+
+
+static const char *
+bin_name(struct trace_reader *reader)
+{
+   uint64_t ref = bin_uint(reader);
+
+   if (ref == 0) {
+      size_t len = bin_uint(reader);
+      const uint8_t *data = bin_read(reader, len);
+      const char *name;
+
+      if (!data)
+         return "";
+      name = intern(&reader->strings, (const char *) data, len);
+      if (!name) {
+         parse_error(reader, "out of memory");
+         return "";
+      }
+
+      if (reader->num_names == reader->max_names) {
+         unsigned max = reader->max_names ? reader->max_names * 2 : 256;
+         const char **names = realloc(reader->names, max * sizeof *names);
+
+         if (!names) {
+            parse_error(reader, "out of memory");
+            return "";
+         }
+         reader->names = names;
+         reader->max_names = max;
+      }
+      reader->names[reader->num_names++] = name;
+      return name;
+   }
+
+   if (ref > reader->num_names) {
+      parse_error(reader, "corrupt binary trace");
+      return "";
+   }
+   return reader->names[ref - 1];
+}
+
+
+static struct trace_value *
+bin_parse_value(struct trace_reader *reader, int op)
+{
+   struct trace_value *value = NULL;
+
+   switch (op) {
+   case TRACE_BINARY_NULL:
+      return value_new(reader, TRACE_VALUE_NULL);
+   case TRACE_BINARY_BOOL:
+   case TRACE_BINARY_INT:
+      value = value_new(reader, op == TRACE_BINARY_BOOL ? TRACE_VALUE_BOOL :
+                                                          TRACE_VALUE_INT);
+      if (value)
+         value->u.i = op == TRACE_BINARY_BOOL ? (int64_t) bin_uint(reader) :
+                                                bin_sint(reader);
+      return value;
+   case TRACE_BINARY_UINT:
+   case TRACE_BINARY_PTR:
+      value = value_new(reader, op == TRACE_BINARY_PTR ? TRACE_VALUE_PTR :
+                                                         TRACE_VALUE_UINT);
+      if (value)
+         value->u.u = bin_uint(reader);
+      return value;
+   case TRACE_BINARY_FLOAT: {
+      const uint8_t *data = bin_read(reader, 8);
+      union { uint64_t u; double f; } bits;
+
+      value = value_new(reader, TRACE_VALUE_FLOAT);
+      if (value && data) {
+         bits.u = read32(data) | ((uint64_t) read32(data + 4) << 32);
+         value->u.f = bits.f;
+      }
+      return value;
+   }
+   case TRACE_BINARY_STRING:
+   case TRACE_BINARY_BYTES: {
+      size_t size = bin_uint(reader);
+      const uint8_t *data = bin_read(reader, size);
+      char *copy = pool_alloc(&reader->pool, size + 1);
+
+      value = value_new(reader, op == TRACE_BINARY_BYTES ?
+                                TRACE_VALUE_BYTES : TRACE_VALUE_STRING);
+      if (value && data && copy) {
+         memcpy(copy, data, size);
+         copy[size] = 0;
+         value->u.bytes.data = copy;
+         value->u.bytes.size = size;
+      }
+      return value;
+   }
+   case TRACE_BINARY_ENUM:
+      value = value_new(reader, TRACE_VALUE_ENUM);
+      if (value)
+         value->u.name = bin_name(reader);
+      return value;
+   case TRACE_BINARY_ARRAY_BEGIN:
+      value = value_new(reader, TRACE_VALUE_ARRAY);
+      while (value && !reader->error &&
+             (op = bin_op(reader)) != TRACE_BINARY_ARRAY_END) {
+         if (op < 0) {
+            parse_error(reader, "unexpected end of trace");
+            break;
+         }
+         list_append(reader, value, NULL, bin_parse_value(reader, op));
+      }
+      return value;
+   case TRACE_BINARY_STRUCT_BEGIN:
+      value = value_new(reader, TRACE_VALUE_STRUCT);
+      if (value)
+         value->u.list.name = bin_name(reader);
+      while (value && !reader->error &&
+             (op = bin_op(reader)) == TRACE_BINARY_MEMBER) {
+         const char *name = bin_name(reader);
+
+         list_append(reader, value, name,
+                     bin_parse_value(reader, bin_op(reader)));
+      }
+      if (op != TRACE_BINARY_STRUCT_END)
+         parse_error(reader, "corrupt binary trace");
+      return value;
+   default:
+      parse_error(reader, op < 0 ? "unexpected end of trace" :
+                                   "corrupt binary trace");
+      return NULL;
+   }
+}
+
+
+static boolean
+bin_next_call(struct trace_reader *reader, struct trace_call *call)
+{
+   int op = bin_op(reader);
+
+   if (op < 0)
+      return FALSE;
+   if (op != TRACE_BINARY_CALL_BEGIN) {
+      parse_error(reader, "corrupt binary trace");
+      return FALSE;
+   }
+
+   call->no = bin_uint(reader);
+   call->klass = bin_name(reader);
+   call->method = bin_name(reader);
+
+   while (!reader->error) {
+      op = bin_op(reader);
+
+      if (op == TRACE_BINARY_ARG) {
+         struct trace_value args = { TRACE_VALUE_ARRAY };
+         const char *name = bin_name(reader);
+
+         args.u.list.num = call->num_args;
+         args.u.list.names = call->arg_names;
+         args.u.list.values = call->args;
+         list_append(reader, &args, name,
+                     bin_parse_value(reader, bin_op(reader)));
+         call->num_args = args.u.list.num;
+         call->arg_names = args.u.list.names;
+         call->args = args.u.list.values;
+      }
+      else if (op == TRACE_BINARY_RET) {
+         call->ret = bin_parse_value(reader, bin_op(reader));
+      }
+      else if (op == TRACE_BINARY_CALL_END) {
+         call->time = bin_sint(reader);
+         break;
+      }
+      else {
+         /* A trace cut short in the middle of a call ends here too */
+         parse_error(reader, op < 0 ? "unexpected end of trace" :
+                                      "corrupt binary trace");
+      }
+   }
+
+   return !reader->error;
+}
+
+
+/*
+ * Public interface.
+ */
+
+struct trace_reader *
+trace_reader_open(const char *filename)
+{
+   struct trace_reader *reader;
+   char magic[8];
+
+   reader = calloc(1, sizeof *reader);
+   if (!reader)
+      return NULL;
+
+   reader->file = fopen(filename, "rb");
+   if (!reader->file) {
+      free(reader);
+      return NULL;
+   }
+
+   if (fread(magic, sizeof magic, 1, reader->file) == 1 &&
+       memcmp(magic, TRACE_BINARY_MAGIC, sizeof magic) == 0) {
+      uint8_t version[4];
+
+      if (fread(version, sizeof version, 1, reader->file) != 1 ||
+          read32(version) != TRACE_BINARY_VERSION) {
+         fprintf(stderr, "trace: unsupported binary trace version\n");
+         fclose(reader->file);
+         free(reader);
+         return NULL;
+      }
+      reader->binary = TRUE;
+   }
+   else {
+      rewind(reader->file);
+   }
+
+   return reader;
+}
+
+
+boolean
+trace_reader_next(struct trace_reader *reader, struct trace_call *call)
+{
+   boolean ret;
+
+   pool_reset(&reader->pool);
+   memset(call, 0, sizeof *call);
+
+   if (reader->error)
+      return FALSE;
+
+   ret = reader->binary ? bin_next_call(reader, call) :
+                          xml_next_call(reader, call);
+   if (!ret)
+      return FALSE;
+
+   call->name = call_name(reader, call->klass, call->method);
+   if (!call->klass || !call->method || !call->name) {
+      parse_error(reader, "out of memory");
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+void
+trace_reader_close(struct trace_reader *reader)
+{
+   fclose(reader->file);
+   pool_free(&reader->pool);
+   intern_free(&reader->strings);
+   free(reader->names);
+   free(reader->text);
+   free(reader->chunk);
+   free(reader->buf);
+   free(reader);
+}
+
+
+const struct trace_value *
+trace_call_arg(const struct trace_call *call, unsigned index)
+{
+   if (index >= call->num_args || !call->args[index])
+      return &null_value;
+   return call->args[index];
+}
+
+
+const struct trace_value *
+trace_value_member(const struct trace_value *value, const char *name)
+{
+   unsigned i;
+
+   if (!value || value->type != TRACE_VALUE_STRUCT)
+      return &null_value;
+
+   for (i = 0; i < value->u.list.num; i++) {
+      if (strcmp(value->u.list.names[i], name) == 0)
+         return value->u.list.values[i] ? value->u.list.values[i] :
+                                          &null_value;
+   }
+   return &null_value;
+}
+
+
+const struct trace_value *
+trace_value_elem(const struct trace_value *value, unsigned index)
+{
+   if (!value || value->type != TRACE_VALUE_ARRAY ||
+       index >= value->u.list.num || !value->u.list.values[index])
+      return &null_value;
+   return value->u.list.values[index];
+}
+
+
+unsigned
+trace_value_count(const struct trace_value *value)
+{
+   if (!value || (value->type != TRACE_VALUE_ARRAY &&
+                  value->type != TRACE_VALUE_STRUCT))
+      return 0;
+   return value->u.list.num;
+}
+
+
+uint64_t
+trace_value_uint(const struct trace_value *value)
+{
+   return (uint64_t) trace_value_int(value);
+}
+
+
+int64_t
+trace_value_int(const struct trace_value *value)
+{
+   if (!value)
+      return 0;
+
+   switch (value->type) {
+   case TRACE_VALUE_BOOL:
+   case TRACE_VALUE_INT:
+      return value->u.i;
+   case TRACE_VALUE_UINT:
+   case TRACE_VALUE_PTR:
+      return (int64_t) value->u.u;
+   case TRACE_VALUE_FLOAT:
+      return (int64_t) value->u.f;
+   default:
+      return 0;
+   }
+}
+
+
+double
+trace_value_float(const struct trace_value *value)
+{
+   if (!value)
+      return 0.0;
+
+   switch (value->type) {
+   case TRACE_VALUE_FLOAT:
+      return value->u.f;
+   case TRACE_VALUE_UINT:
+      return (double) value->u.u;
+   case TRACE_VALUE_BOOL:
+   case TRACE_VALUE_INT:
+      return (double) value->u.i;
+   default:
+      return 0.0;
+   }
+}
+
+
+uint64_t
+trace_value_ptr(const struct trace_value *value)
+{
+   if (!value || value->type != TRACE_VALUE_PTR)
+      return 0;
+   return value->u.u;
+}
+
+
+const char *
+trace_value_string(const struct trace_value *value)
+{
+   if (!value)
+      return NULL;
+
+   switch (value->type) {
+   case TRACE_VALUE_STRING:
+   case TRACE_VALUE_BYTES:
+      return value->u.bytes.data;
+   case TRACE_VALUE_ENUM:
+      return value->u.name;
+   default:
+      return NULL;
+   }
+}
+
+
+size_t
+trace_value_size(const struct trace_value *value)
+{
+   if (!value || (value->type != TRACE_VALUE_STRING &&
+                  value->type != TRACE_VALUE_BYTES))
+      return 0;
+   return value->u.bytes.size;
+}
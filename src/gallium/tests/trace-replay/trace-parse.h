@@ -0,0 +1,151 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Reader for the traces written by the trace driver, in either the XML or
+ * the binary format.
+ *
+ * Calls are returned one at a time as trees of trace_value.  The memory of
+ * a call lives until the next call is read; names (classes, methods,
+ * arguments, members and enums) are interned and live as long as the
+ * reader.
+ */
+
+#ifndef TRACE_PARSE_H
+#define TRACE_PARSE_H
+
+
+#include "pipe/p_compiler.h"
+
+
+enum trace_value_type
+{
+   TRACE_VALUE_NULL,
+   TRACE_VALUE_BOOL,
+   TRACE_VALUE_INT,
+   TRACE_VALUE_UINT,
+   TRACE_VALUE_FLOAT,
+   TRACE_VALUE_STRING,
+   TRACE_VALUE_ENUM,
+   TRACE_VALUE_BYTES,
+   TRACE_VALUE_PTR,
+   TRACE_VALUE_ARRAY,
+   TRACE_VALUE_STRUCT
+};
+
+
+struct trace_value
+{
+   enum trace_value_type type;
+
+   union {
+      int64_t i;            /* bool, int */
+      uint64_t u;           /* uint, ptr */
+      double f;
+      const char *name;     /* enum */
+      struct {
+         char *data;        /* NUL terminated */
+         size_t size;
+      } bytes;              /* string, bytes */
+      struct {
+         const char *name;  /* struct name */
+         unsigned num;
+         const char **names;
+         struct trace_value **values;
+      } list;               /* array elements, struct members */
+   } u;
+};
+
+
+struct trace_call
+{
+   unsigned no;
+   const char *klass;
+   const char *method;
+   const char *name;        /* "klass::method", interned too */
+
+   unsigned num_args;
+   const char **arg_names;
+   struct trace_value **args;
+   struct trace_value *ret;
+
+   int64_t time;
+};
+
+
+struct trace_reader;
+
+
+struct trace_reader *
+trace_reader_open(const char *filename);
+
+/**
+ * Read the next call.  Returns FALSE at the end of the trace.
+ */
+boolean
+trace_reader_next(struct trace_reader *reader, struct trace_call *call);
+
+void
+trace_reader_close(struct trace_reader *reader);
+
+
+/*
+ * Accessors.  They accept NULL and missing values, and return zero for
+ * those, so that callers can convert states without checking each member.
+ */
+
+const struct trace_value *
+trace_call_arg(const struct trace_call *call, unsigned index);
+
+const struct trace_value *
+trace_value_member(const struct trace_value *value, const char *name);
+
+const struct trace_value *
+trace_value_elem(const struct trace_value *value, unsigned index);
+
+unsigned
+trace_value_count(const struct trace_value *value);
+
+uint64_t
+trace_value_uint(const struct trace_value *value);
+
+int64_t
+trace_value_int(const struct trace_value *value);
+
+double
+trace_value_float(const struct trace_value *value);
+
+uint64_t
+trace_value_ptr(const struct trace_value *value);
+
+/** String, enum or bytes data, NULL for anything else. */
+const char *
+trace_value_string(const struct trace_value *value);
+
+size_t
+trace_value_size(const struct trace_value *value);
+
+
+#endif /* TRACE_PARSE_H */
@@ -0,0 +1,1905 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Replays a trace written by the trace driver on any pipe-loader device
+ * and reports how long the driver spent in each kind of call, per-frame
+ * timings and, optionally, driver queries.
+ *
+ * Usage: trace-replay [-d <device>] [-f] [-n <frames>] [-q <query,...>]
+ *                     <trace>
+ *
+ * -d picks the device, by index in the pipe-loader probe order.
+ * -f prints a line per frame.
+ * -n stops after that many frames.
+ * -q samples driver queries (see "-q help") at each frame.
+ *
+ * A frame ends at pipe_screen::flush_frontbuffer or at a flush with
+ * PIPE_FLUSH_END_OF_FRAME, and is then synchronized with a fence so that
+ * its time includes the GPU work.  Call times only cover the driver entry
+ * point, not the decoding of the trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "pipe-loader/pipe_loader.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_format.h"
+#include "util/u_hash_table.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#include "trace-parse.h"
+
+
+#define MAX_QUERIES 16
+
+/** Smallest stand-in for the user buffers the trace doesn't capture */
+#define ZERO_BUFFER_SIZE (1024 * 1024)
+
+
+struct replay;
+
+typedef void (*replay_func)(struct replay *r, const struct trace_call *call);
+
+
+struct call_stats
+{
+   const char *name;
+   replay_func func;
+   unsigned count;
+   int64_t time;
+   struct call_stats *next;
+};
+
+
+struct replay_query
+{
+   struct pipe_driver_query_info info;
+   struct pipe_query *query;
+   uint64_t value;       /* last frame */
+   uint64_t total;
+};
+
+
+struct replay
+{
+   struct pipe_screen *screen;
+
+   /** Last context used, which gets flushed at the end of frames */
+   struct pipe_context *pipe;
+
+   /** Trace pointers to replayed objects */
+   struct util_hash_table *objects;
+   /** Interned enum names to formats plus one */
+   struct util_hash_table *formats;
+   /** Interned call names to call_stats */
+   struct util_hash_table *calls;
+   struct call_stats *first_call;
+
+   struct pipe_resource *zero_buffer;
+
+   /** Driver time of the current call */
+   int64_t call_time;
+
+   boolean per_frame;
+   unsigned max_frames;
+   unsigned num_frames;
+   unsigned frames_size;
+   double *frame_times;
+   int64_t frame_start;
+   int64_t frame_driver_time;
+   unsigned num_replayed;
+   unsigned num_ignored;
+
+   /** Driver queries, sampled on the first context */
+   struct replay_query queries[MAX_QUERIES];
+   unsigned num_queries;
+   struct pipe_context *query_pipe;
+   boolean queries_active;
+};
+
+
+#define TIMED(r, stmt) \
+   do { \
+      int64_t _start = os_time_get_nano(); \
+      stmt; \
+      (r)->call_time += os_time_get_nano() - _start; \
+   } while (0)
+
+#define ARG(i) trace_call_arg(call, i)
+
+
+/*
+ * Objects.
+ */
+
+static INLINE void *
+obj_key(uint64_t ptr)
+{
+   return (void *) (uintptr_t) ptr;
+}
+
+
+static void *
+lookup(struct replay *r, const struct trace_value *value)
+{
+   uint64_t ptr = trace_value_ptr(value);
+
+   return ptr ? util_hash_table_get(r->objects, obj_key(ptr)) : NULL;
+}
+
+
+static void
+insert(struct replay *r, const struct trace_value *value, void *obj)
+{
+   uint64_t ptr = trace_value_ptr(value);
+
+   if (ptr && obj)
+      util_hash_table_set(r->objects, obj_key(ptr), obj);
+}
+
+
+static void *
+take(struct replay *r, const struct trace_value *value)
+{
+   void *obj = lookup(r, value);
+
+   if (obj)
+      util_hash_table_remove(r->objects, obj_key(trace_value_ptr(value)));
+   return obj;
+}
+
+
+static struct pipe_context *
+context_arg(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = lookup(r, ARG(0));
+
+   if (pipe)
+      r->pipe = pipe;
+   return pipe;
+}
+
+
+static enum pipe_format
+format_value(struct replay *r, const struct trace_value *value)
+{
+   const char *name = trace_value_string(value);
+   uintptr_t cached;
+   unsigned format;
+
+   if (!name)
+      return PIPE_FORMAT_NONE;
+
+   cached = (uintptr_t) util_hash_table_get(r->formats, (void *) name);
+   if (cached)
+      return (enum pipe_format) (cached - 1);
+
+   for (format = 0; format < PIPE_FORMAT_COUNT; format++) {
+      if (strcmp(util_format_name(format), name) == 0)
+         break;
+   }
+   if (format == PIPE_FORMAT_COUNT) {
+      fprintf(stderr, "trace-replay: unknown format %s\n", name);
+      format = PIPE_FORMAT_NONE;
+   }
+
+   util_hash_table_set(r->formats, (void *) name,
+                       (void *) (uintptr_t) (format + 1));
+   return format;
+}
+
+
+static unsigned
+member_uint(const struct trace_value *value, const char *name)
+{
+   return (unsigned) trace_value_uint(trace_value_member(value, name));
+}
+
+
+static float
+member_float(const struct trace_value *value, const char *name)
+{
+   return (float) trace_value_float(trace_value_member(value, name));
+}
+
+
+static void
+floats(const struct trace_value *array, float *dst, unsigned num)
+{
+   unsigned i;
+
+   for (i = 0; i < num; i++)
+      dst[i] = (float) trace_value_float(trace_value_elem(array, i));
+}
+
+
+static void
+box_value(const struct trace_value *value, struct pipe_box *box)
+{
+   box->x = member_uint(value, "x");
+   box->y = member_uint(value, "y");
+   box->z = member_uint(value, "z");
+   box->width = member_uint(value, "width");
+   box->height = member_uint(value, "height");
+   box->depth = member_uint(value, "depth");
+}
+
+
+static void
+scissor_value(const struct trace_value *value, struct pipe_scissor_state *s)
+{
+   s->minx = member_uint(value, "minx");
+   s->miny = member_uint(value, "miny");
+   s->maxx = member_uint(value, "maxx");
+   s->maxy = member_uint(value, "maxy");
+}
+
+
+/**
+ * Buffer standing in for a user buffer, which the trace driver doesn't
+ * capture: vertex, index and constant data all read as zeros.
+ */
+static struct pipe_resource *
+zero_buffer(struct replay *r, struct pipe_context *pipe, unsigned size)
+{
+   void *zeros;
+
+   if (r->zero_buffer && r->zero_buffer->width0 >= size)
+      return r->zero_buffer;
+
+   size = util_next_power_of_two(MAX2(size, ZERO_BUFFER_SIZE));
+   pipe_resource_reference(&r->zero_buffer, NULL);
+   r->zero_buffer = pipe_buffer_create(r->screen,
+                                       PIPE_BIND_VERTEX_BUFFER |
+                                       PIPE_BIND_INDEX_BUFFER |
+                                       PIPE_BIND_CONSTANT_BUFFER,
+                                       PIPE_USAGE_DEFAULT, size);
+   zeros = CALLOC(1, size);
+   if (r->zero_buffer && zeros)
+      pipe_buffer_write(pipe, r->zero_buffer, 0, size, zeros);
+   FREE(zeros);
+   return r->zero_buffer;
+}
+
+
+/*
+ * Frames and driver queries.
+ */
+
+static void
+queries_begin(struct replay *r)
+{
+   struct pipe_context *pipe = r->query_pipe;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   for (i = 0; i < r->num_queries; i++) {
+      struct replay_query *q = &r->queries[i];
+
+      if (!q->query)
+         q->query = pipe->create_query(pipe, q->info.query_type);
+      if (q->query)
+         pipe->begin_query(pipe, q->query);
+   }
+   r->queries_active = TRUE;
+}
+
+
+static void
+queries_end(struct replay *r, boolean destroy)
+{
+   struct pipe_context *pipe = r->query_pipe;
+   unsigned i;
+
+   if (!r->queries_active)
+      return;
+
+   for (i = 0; i < r->num_queries; i++) {
+      struct replay_query *q = &r->queries[i];
+      union pipe_query_result result;
+
+      q->value = 0;
+      if (!q->query)
+         continue;
+
+      pipe->end_query(pipe, q->query);
+      if (pipe->get_query_result(pipe, q->query, TRUE, &result))
+         q->value = result.u64;
+      q->total += q->value;
+
+      if (destroy) {
+         pipe->destroy_query(pipe, q->query);
+         q->query = NULL;
+      }
+   }
+   r->queries_active = FALSE;
+}
+
+
+static void
+frame_end(struct replay *r)
+{
+   struct pipe_fence_handle *fence = NULL;
+   int64_t now;
+   double ms;
+   unsigned i;
+
+   if (r->pipe) {
+      r->pipe->flush(r->pipe, &fence, 0);
+      if (fence) {
+         r->screen->fence_finish(r->screen, fence, PIPE_TIMEOUT_INFINITE);
+         r->screen->fence_reference(r->screen, &fence, NULL);
+      }
+   }
+   now = os_time_get_nano();
+   ms = (now - r->frame_start) / 1000000.0;
+
+   queries_end(r, FALSE);
+
+   if (r->num_frames == r->frames_size) {
+      unsigned size = r->frames_size ? r->frames_size * 2 : 1024;
+      double *times = REALLOC(r->frame_times,
+                              r->frames_size * sizeof *times,
+                              size * sizeof *times);
+
+      if (times) {
+         r->frame_times = times;
+         r->frames_size = size;
+      }
+   }
+   if (r->num_frames < r->frames_size)
+      r->frame_times[r->num_frames] = ms;
+   r->num_frames++;
+
+   if (r->per_frame) {
+      printf("frame %u: %.3f ms, %.3f ms in the driver",
+             r->num_frames, ms, r->frame_driver_time / 1000000.0);
+      for (i = 0; i < r->num_queries; i++)
+         printf(", %s %llu", r->queries[i].info.name,
+                (unsigned long long) r->queries[i].value);
+      printf("\n");
+   }
+
+   queries_begin(r);
+   r->frame_driver_time = 0;
+   r->frame_start = os_time_get_nano();
+}
+
+
+/*
+ * Screen calls.
+ */
+
+static void
+replay_context_create(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe;
+
+   TIMED(r, pipe = r->screen->context_create(r->screen, NULL));
+   if (!pipe)
+      return;
+
+   insert(r, call->ret, pipe);
+   if (!r->pipe)
+      r->pipe = pipe;
+   if (!r->query_pipe && r->num_queries) {
+      r->query_pipe = pipe;
+      queries_begin(r);
+   }
+}
+
+
+static void
+replay_resource_create(struct replay *r, const struct trace_call *call)
+{
+   const struct trace_value *templat = ARG(1);
+   struct pipe_resource templ, *res;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = member_uint(templat, "target");
+   templ.format = format_value(r, trace_value_member(templat, "format"));
+   templ.width0 = member_uint(templat, "width");
+   templ.height0 = member_uint(templat, "height");
+   templ.depth0 = member_uint(templat, "depth");
+   templ.array_size = member_uint(templat, "array_size");
+   templ.last_level = member_uint(templat, "last_level");
+   templ.nr_samples = member_uint(templat, "nr_samples");
+   templ.usage = member_uint(templat, "usage");
+   templ.bind = member_uint(templat, "bind");
+   templ.flags = member_uint(templat, "flags");
+
+   TIMED(r, res = r->screen->resource_create(r->screen, &templ));
+   insert(r, call->ret, res);
+}
+
+
+static void
+replay_resource_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_resource *res = take(r, ARG(1));
+
+   TIMED(r, pipe_resource_reference(&res, NULL));
+}
+
+
+static void
+replay_flush_frontbuffer(struct replay *r, const struct trace_call *call)
+{
+   /* There's no window to present to, so this only ends the frame */
+   frame_end(r);
+}
+
+
+/*
+ * Context calls.
+ */
+
+static void
+replay_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = take(r, ARG(0));
+
+   if (!pipe)
+      return;
+
+   if (pipe == r->query_pipe) {
+      queries_end(r, TRUE);
+      r->query_pipe = NULL;
+   }
+   if (pipe == r->pipe)
+      r->pipe = NULL;
+   TIMED(r, pipe->destroy(pipe));
+}
+
+
+static void
+replay_draw_vbo(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   struct pipe_draw_info info;
+
+   if (!pipe)
+      return;
+
+   memset(&info, 0, sizeof info);
+   info.indexed = member_uint(v, "indexed");
+   info.mode = member_uint(v, "mode");
+   info.start = member_uint(v, "start");
+   info.count = member_uint(v, "count");
+   info.start_instance = member_uint(v, "start_instance");
+   info.instance_count = member_uint(v, "instance_count");
+   info.index_bias = (int) trace_value_int(trace_value_member(v,
+                                                              "index_bias"));
+   info.min_index = member_uint(v, "min_index");
+   info.max_index = member_uint(v, "max_index");
+   info.primitive_restart = member_uint(v, "primitive_restart");
+   info.restart_index = member_uint(v, "restart_index");
+   info.count_from_stream_output =
+      lookup(r, trace_value_member(v, "count_from_stream_output"));
+
+   TIMED(r, pipe->draw_vbo(pipe, &info));
+}
+
+
+static void
+replay_create_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_query *query;
+
+   if (!pipe)
+      return;
+
+   TIMED(r, query = pipe->create_query(pipe, trace_value_uint(ARG(1))));
+   insert(r, call->ret, query);
+}
+
+
+static void
+replay_destroy_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_query *query = take(r, ARG(1));
+
+   if (pipe && query)
+      TIMED(r, pipe->destroy_query(pipe, query));
+}
+
+
+static void
+replay_begin_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_query *query = lookup(r, ARG(1));
+
+   if (pipe && query)
+      TIMED(r, pipe->begin_query(pipe, query));
+}
+
+
+static void
+replay_end_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_query *query = lookup(r, ARG(1));
+
+   if (pipe && query)
+      TIMED(r, pipe->end_query(pipe, query));
+}
+
+
+static void
+replay_render_condition(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+
+   if (pipe)
+      TIMED(r, pipe->render_condition(pipe, lookup(r, ARG(1)),
+                                      trace_value_uint(ARG(2)),
+                                      trace_value_uint(ARG(3))));
+}
+
+
+static void
+replay_create_blend_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   const struct trace_value *rts = trace_value_member(v, "rt");
+   struct pipe_blend_state state;
+   void *cso;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   memset(&state, 0, sizeof state);
+   state.dither = member_uint(v, "dither");
+   state.logicop_enable = member_uint(v, "logicop_enable");
+   state.logicop_func = member_uint(v, "logicop_func");
+   state.independent_blend_enable = member_uint(v, "independent_blend_enable");
+   for (i = 0; i < MIN2(trace_value_count(rts), PIPE_MAX_COLOR_BUFS); i++) {
+      const struct trace_value *rt = trace_value_elem(rts, i);
+
+      state.rt[i].blend_enable = member_uint(rt, "blend_enable");
+      state.rt[i].rgb_func = member_uint(rt, "rgb_func");
+      state.rt[i].rgb_src_factor = member_uint(rt, "rgb_src_factor");
+      state.rt[i].rgb_dst_factor = member_uint(rt, "rgb_dst_factor");
+      state.rt[i].alpha_func = member_uint(rt, "alpha_func");
+      state.rt[i].alpha_src_factor = member_uint(rt, "alpha_src_factor");
+      state.rt[i].alpha_dst_factor = member_uint(rt, "alpha_dst_factor");
+      state.rt[i].colormask = member_uint(rt, "colormask");
+   }
+
+   TIMED(r, cso = pipe->create_blend_state(pipe, &state));
+   insert(r, call->ret, cso);
+}
+
+
+static void
+replay_create_sampler_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   struct pipe_sampler_state state;
+   void *cso;
+
+   if (!pipe)
+      return;
+
+   memset(&state, 0, sizeof state);
+   state.wrap_s = member_uint(v, "wrap_s");
+   state.wrap_t = member_uint(v, "wrap_t");
+   state.wrap_r = member_uint(v, "wrap_r");
+   state.min_img_filter = member_uint(v, "min_img_filter");
+   state.min_mip_filter = member_uint(v, "min_mip_filter");
+   state.mag_img_filter = member_uint(v, "mag_img_filter");
+   state.compare_mode = member_uint(v, "compare_mode");
+   state.compare_func = member_uint(v, "compare_func");
+   state.normalized_coords = member_uint(v, "normalized_coords");
+   state.max_anisotropy = member_uint(v, "max_anisotropy");
+   state.lod_bias = member_float(v, "lod_bias");
+   state.min_lod = member_float(v, "min_lod");
+   state.max_lod = member_float(v, "max_lod");
+   floats(trace_value_member(v, "border_color.f"), state.border_color.f, 4);
+
+   TIMED(r, cso = pipe->create_sampler_state(pipe, &state));
+   insert(r, call->ret, cso);
+}
+
+
+static void
+replay_create_rasterizer_state(struct replay *r,
+                               const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   struct pipe_rasterizer_state state;
+   void *cso;
+
+   if (!pipe)
+      return;
+
+   memset(&state, 0, sizeof state);
+   state.flatshade = member_uint(v, "flatshade");
+   state.light_twoside = member_uint(v, "light_twoside");
+   state.clamp_vertex_color = member_uint(v, "clamp_vertex_color");
+   state.clamp_fragment_color = member_uint(v, "clamp_fragment_color");
+   state.front_ccw = member_uint(v, "front_ccw");
+   state.cull_face = member_uint(v, "cull_face");
+   state.fill_front = member_uint(v, "fill_front");
+   state.fill_back = member_uint(v, "fill_back");
+   state.offset_point = member_uint(v, "offset_point");
+   state.offset_line = member_uint(v, "offset_line");
+   state.offset_tri = member_uint(v, "offset_tri");
+   state.scissor = member_uint(v, "scissor");
+   state.poly_smooth = member_uint(v, "poly_smooth");
+   state.poly_stipple_enable = member_uint(v, "poly_stipple_enable");
+   state.point_smooth = member_uint(v, "point_smooth");
+   state.sprite_coord_enable = member_uint(v, "sprite_coord_enable");
+   state.sprite_coord_mode = member_uint(v, "sprite_coord_mode");
+   state.point_quad_rasterization = member_uint(v, "point_quad_rasterization");
+   state.point_size_per_vertex = member_uint(v, "point_size_per_vertex");
+   state.multisample = member_uint(v, "multisample");
+   state.line_smooth = member_uint(v, "line_smooth");
+   state.line_stipple_enable = member_uint(v, "line_stipple_enable");
+   state.line_stipple_factor = member_uint(v, "line_stipple_factor");
+   state.line_stipple_pattern = member_uint(v, "line_stipple_pattern");
+   state.line_last_pixel = member_uint(v, "line_last_pixel");
+   state.flatshade_first = member_uint(v, "flatshade_first");
+   state.half_pixel_center = member_uint(v, "half_pixel_center");
+   state.bottom_edge_rule = member_uint(v, "bottom_edge_rule");
+   state.rasterizer_discard = member_uint(v, "rasterizer_discard");
+   state.depth_clip = member_uint(v, "depth_clip");
+   state.clip_halfz = member_uint(v, "clip_halfz");
+   state.clip_plane_enable = member_uint(v, "clip_plane_enable");
+   state.line_width = member_float(v, "line_width");
+   state.point_size = member_float(v, "point_size");
+   state.offset_units = member_float(v, "offset_units");
+   state.offset_scale = member_float(v, "offset_scale");
+   state.offset_clamp = member_float(v, "offset_clamp");
+
+   TIMED(r, cso = pipe->create_rasterizer_state(pipe, &state));
+   insert(r, call->ret, cso);
+}
+
+
+static void
+replay_create_depth_stencil_alpha_state(struct replay *r,
+                                        const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   const struct trace_value *depth = trace_value_member(v, "depth");
+   const struct trace_value *stencil = trace_value_member(v, "stencil");
+   const struct trace_value *alpha = trace_value_member(v, "alpha");
+   struct pipe_depth_stencil_alpha_state state;
+   void *cso;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   memset(&state, 0, sizeof state);
+   state.depth.enabled = member_uint(depth, "enabled");
+   state.depth.writemask = member_uint(depth, "writemask");
+   state.depth.func = member_uint(depth, "func");
+   for (i = 0; i < 2; i++) {
+      const struct trace_value *s = trace_value_elem(stencil, i);
+
+      state.stencil[i].enabled = member_uint(s, "enabled");
+      state.stencil[i].func = member_uint(s, "func");
+      state.stencil[i].fail_op = member_uint(s, "fail_op");
+      state.stencil[i].zpass_op = member_uint(s, "zpass_op");
+      state.stencil[i].zfail_op = member_uint(s, "zfail_op");
+      state.stencil[i].valuemask = member_uint(s, "valuemask");
+      state.stencil[i].writemask = member_uint(s, "writemask");
+   }
+   state.alpha.enabled = member_uint(alpha, "enabled");
+   state.alpha.func = member_uint(alpha, "func");
+   state.alpha.ref_value = member_float(alpha, "ref_value");
+
+   TIMED(r, cso = pipe->create_depth_stencil_alpha_state(pipe, &state));
+   insert(r, call->ret, cso);
+}
+
+
+static void
+replay_create_shader_state(struct replay *r, const struct trace_call *call,
+                           unsigned shader)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   const struct trace_value *so = trace_value_member(v, "stream_output");
+   const struct trace_value *outputs = trace_value_member(so, "output");
+   const char *text = trace_value_string(trace_value_member(v, "tokens"));
+   struct pipe_shader_state state;
+   struct tgsi_token *tokens;
+   unsigned num_tokens, i;
+   void *cso = NULL;
+
+   if (!pipe || !text)
+      return;
+
+   /* Generous, the text has several characters per token */
+   num_tokens = strlen(text) / 2 + 1024;
+   tokens = MALLOC(num_tokens * sizeof *tokens);
+   if (!tokens)
+      return;
+
+   if (!tgsi_text_translate(text, tokens, num_tokens)) {
+      fprintf(stderr, "trace-replay: call %u: failed to parse shader\n",
+              call->no);
+      FREE(tokens);
+      return;
+   }
+
+   memset(&state, 0, sizeof state);
+   state.tokens = tokens;
+   state.stream_output.num_outputs =
+      MIN2(member_uint(so, "num_outputs"), PIPE_MAX_SO_OUTPUTS);
+   for (i = 0; i < PIPE_MAX_SO_BUFFERS; i++)
+      state.stream_output.stride[i] =
+         trace_value_uint(trace_value_elem(trace_value_member(so, "stride"),
+                                           i));
+   for (i = 0; i < state.stream_output.num_outputs; i++) {
+      const struct trace_value *o = trace_value_elem(outputs, i);
+
+      state.stream_output.output[i].register_index =
+         member_uint(o, "register_index");
+      state.stream_output.output[i].start_component =
+         member_uint(o, "start_component");
+      state.stream_output.output[i].num_components =
+         member_uint(o, "num_components");
+      state.stream_output.output[i].output_buffer =
+         member_uint(o, "output_buffer");
+      state.stream_output.output[i].dst_offset =
+         member_uint(o, "dst_offset");
+   }
+
+   switch (shader) {
+   case PIPE_SHADER_VERTEX:
+      TIMED(r, cso = pipe->create_vs_state(pipe, &state));
+      break;
+   case PIPE_SHADER_GEOMETRY:
+      if (pipe->create_gs_state)
+         TIMED(r, cso = pipe->create_gs_state(pipe, &state));
+      break;
+   default:
+      TIMED(r, cso = pipe->create_fs_state(pipe, &state));
+      break;
+   }
+
+   /* Drivers copy the tokens */
+   FREE(tokens);
+   insert(r, call->ret, cso);
+}
+
+
+static void
+replay_create_vs_state(struct replay *r, const struct trace_call *call)
+{
+   replay_create_shader_state(r, call, PIPE_SHADER_VERTEX);
+}
+
+
+static void
+replay_create_gs_state(struct replay *r, const struct trace_call *call)
+{
+   replay_create_shader_state(r, call, PIPE_SHADER_GEOMETRY);
+}
+
+
+static void
+replay_create_fs_state(struct replay *r, const struct trace_call *call)
+{
+   replay_create_shader_state(r, call, PIPE_SHADER_FRAGMENT);
+}
+
+
+static void
+replay_create_vertex_elements_state(struct replay *r,
+                                    const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *elements = ARG(2);
+   struct pipe_vertex_element velems[PIPE_MAX_ATTRIBS];
+   unsigned num = MIN2(trace_value_uint(ARG(1)), PIPE_MAX_ATTRIBS);
+   unsigned i;
+   void *cso;
+
+   if (!pipe)
+      return;
+
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < num; i++) {
+      const struct trace_value *e = trace_value_elem(elements, i);
+
+      velems[i].src_offset = member_uint(e, "src_offset");
+      velems[i].vertex_buffer_index = member_uint(e, "vertex_buffer_index");
+      velems[i].src_format =
+         format_value(r, trace_value_member(e, "src_format"));
+   }
+
+   TIMED(r, cso = pipe->create_vertex_elements_state(pipe, num, velems));
+   insert(r, call->ret, cso);
+}
+
+
+/* The CSO bind and delete calls only differ by the entry point */
+#define REPLAY_BIND_DELETE(name) \
+   static void \
+   replay_bind_##name(struct replay *r, const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = context_arg(r, call); \
+      if (pipe) \
+         TIMED(r, pipe->bind_##name(pipe, lookup(r, ARG(1)))); \
+   } \
+   \
+   static void \
+   replay_delete_##name(struct replay *r, const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = context_arg(r, call); \
+      void *cso = take(r, ARG(1)); \
+      if (pipe && cso) \
+         TIMED(r, pipe->delete_##name(pipe, cso)); \
+   }
+
+REPLAY_BIND_DELETE(blend_state)
+REPLAY_BIND_DELETE(rasterizer_state)
+REPLAY_BIND_DELETE(depth_stencil_alpha_state)
+REPLAY_BIND_DELETE(vs_state)
+REPLAY_BIND_DELETE(gs_state)
+REPLAY_BIND_DELETE(fs_state)
+REPLAY_BIND_DELETE(vertex_elements_state)
+
+
+static void
+replay_delete_sampler_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   void *cso = take(r, ARG(1));
+
+   if (pipe && cso)
+      TIMED(r, pipe->delete_sampler_state(pipe, cso));
+}
+
+
+static void
+replay_bind_sampler_states(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   unsigned num = MIN2(trace_value_uint(ARG(3)), PIPE_MAX_SAMPLERS);
+   void *samplers[PIPE_MAX_SAMPLERS];
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   for (i = 0; i < num; i++)
+      samplers[i] = lookup(r, trace_value_elem(ARG(4), i));
+
+   TIMED(r, pipe->bind_sampler_states(pipe, trace_value_uint(ARG(1)),
+                                      trace_value_uint(ARG(2)), num,
+                                      samplers));
+}
+
+
+static void
+replay_set_blend_color(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_blend_color state;
+
+   if (!pipe)
+      return;
+
+   floats(trace_value_member(ARG(1), "color"), state.color, 4);
+   TIMED(r, pipe->set_blend_color(pipe, &state));
+}
+
+
+static void
+replay_set_stencil_ref(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *ref = trace_value_member(ARG(1), "ref_value");
+   struct pipe_stencil_ref state;
+
+   if (!pipe)
+      return;
+
+   state.ref_value[0] = trace_value_uint(trace_value_elem(ref, 0));
+   state.ref_value[1] = trace_value_uint(trace_value_elem(ref, 1));
+   TIMED(r, pipe->set_stencil_ref(pipe, &state));
+}
+
+
+static void
+replay_set_clip_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *ucp = trace_value_member(ARG(1), "ucp");
+   struct pipe_clip_state state;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   for (i = 0; i < PIPE_MAX_CLIP_PLANES; i++)
+      floats(trace_value_elem(ucp, i), state.ucp[i], 4);
+   TIMED(r, pipe->set_clip_state(pipe, &state));
+}
+
+
+static void
+replay_set_sample_mask(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+
+   if (pipe)
+      TIMED(r, pipe->set_sample_mask(pipe, trace_value_uint(ARG(1))));
+}
+
+
+static void
+replay_set_constant_buffer(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(3);
+   struct pipe_constant_buffer cb;
+
+   if (!pipe)
+      return;
+
+   if (v->type == TRACE_VALUE_NULL) {
+      TIMED(r, pipe->set_constant_buffer(pipe, trace_value_uint(ARG(1)),
+                                         trace_value_uint(ARG(2)), NULL));
+      return;
+   }
+
+   memset(&cb, 0, sizeof cb);
+   cb.buffer = lookup(r, trace_value_member(v, "buffer"));
+   cb.buffer_offset = member_uint(v, "buffer_offset");
+   cb.buffer_size = member_uint(v, "buffer_size");
+   if (!cb.buffer && cb.buffer_size) {
+      cb.buffer = zero_buffer(r, pipe, cb.buffer_size);
+      cb.buffer_offset = 0;
+   }
+
+   TIMED(r, pipe->set_constant_buffer(pipe, trace_value_uint(ARG(1)),
+                                      trace_value_uint(ARG(2)), &cb));
+}
+
+
+static void
+replay_set_framebuffer_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   const struct trace_value *cbufs = trace_value_member(v, "cbufs");
+   struct pipe_framebuffer_state state;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   memset(&state, 0, sizeof state);
+   state.width = member_uint(v, "width");
+   state.height = member_uint(v, "height");
+   state.nr_cbufs = MIN2(member_uint(v, "nr_cbufs"), PIPE_MAX_COLOR_BUFS);
+   for (i = 0; i < state.nr_cbufs; i++)
+      state.cbufs[i] = lookup(r, trace_value_elem(cbufs, i));
+   state.zsbuf = lookup(r, trace_value_member(v, "zsbuf"));
+
+   TIMED(r, pipe->set_framebuffer_state(pipe, &state));
+}
+
+
+static void
+replay_set_polygon_stipple(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *stipple = trace_value_member(ARG(1), "stipple");
+   struct pipe_poly_stipple state;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   for (i = 0; i < Elements(state.stipple); i++)
+      state.stipple[i] = trace_value_uint(trace_value_elem(stipple, i));
+   TIMED(r, pipe->set_polygon_stipple(pipe, &state));
+}
+
+
+/* Only the first scissor and viewport are traced, they get replicated */
+
+static void
+replay_set_scissor_states(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_scissor_state states[PIPE_MAX_VIEWPORTS];
+   unsigned num = MIN2(trace_value_uint(ARG(2)), PIPE_MAX_VIEWPORTS);
+   unsigned i;
+
+   if (!pipe || !num)
+      return;
+
+   scissor_value(ARG(3), &states[0]);
+   for (i = 1; i < num; i++)
+      states[i] = states[0];
+   TIMED(r, pipe->set_scissor_states(pipe, trace_value_uint(ARG(1)), num,
+                                     states));
+}
+
+
+static void
+replay_set_viewport_states(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_viewport_state states[PIPE_MAX_VIEWPORTS];
+   unsigned num = MIN2(trace_value_uint(ARG(2)), PIPE_MAX_VIEWPORTS);
+   unsigned i;
+
+   if (!pipe || !num)
+      return;
+
+   floats(trace_value_member(ARG(3), "scale"), states[0].scale, 4);
+   floats(trace_value_member(ARG(3), "translate"), states[0].translate, 4);
+   for (i = 1; i < num; i++)
+      states[i] = states[0];
+   TIMED(r, pipe->set_viewport_states(pipe, trace_value_uint(ARG(1)), num,
+                                      states));
+}
+
+
+static void
+replay_create_sampler_view(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_resource *res = lookup(r, ARG(1));
+   const struct trace_value *v = ARG(2);
+   const struct trace_value *u = trace_value_member(v, "u");
+   struct pipe_sampler_view templ, *view;
+
+   if (!pipe || !res)
+      return;
+
+   memset(&templ, 0, sizeof templ);
+   templ.format = format_value(r, trace_value_member(v, "format"));
+   if (res->target == PIPE_BUFFER) {
+      const struct trace_value *buf = trace_value_member(u, "buf");
+
+      templ.u.buf.first_element = member_uint(buf, "first_element");
+      templ.u.buf.last_element = member_uint(buf, "last_element");
+   }
+   else {
+      const struct trace_value *tex = trace_value_member(u, "tex");
+
+      templ.u.tex.first_layer = member_uint(tex, "first_layer");
+      templ.u.tex.last_layer = member_uint(tex, "last_layer");
+      templ.u.tex.first_level = member_uint(tex, "first_level");
+      templ.u.tex.last_level = member_uint(tex, "last_level");
+   }
+   templ.swizzle_r = member_uint(v, "swizzle_r");
+   templ.swizzle_g = member_uint(v, "swizzle_g");
+   templ.swizzle_b = member_uint(v, "swizzle_b");
+   templ.swizzle_a = member_uint(v, "swizzle_a");
+
+   TIMED(r, view = pipe->create_sampler_view(pipe, res, &templ));
+   insert(r, call->ret, view);
+}
+
+
+static void
+replay_sampler_view_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_sampler_view *view = take(r, ARG(1));
+
+   TIMED(r, pipe_sampler_view_reference(&view, NULL));
+}
+
+
+static void
+replay_create_surface(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_resource *res = lookup(r, ARG(1));
+   const struct trace_value *v = ARG(2);
+   const struct trace_value *u = trace_value_member(v, "u");
+   struct pipe_surface templ, *surf;
+
+   if (!pipe || !res)
+      return;
+
+   memset(&templ, 0, sizeof templ);
+   templ.format = format_value(r, trace_value_member(v, "format"));
+   if (res->target == PIPE_BUFFER) {
+      const struct trace_value *buf = trace_value_member(u, "buf");
+
+      templ.u.buf.first_element = member_uint(buf, "first_element");
+      templ.u.buf.last_element = member_uint(buf, "last_element");
+   }
+   else {
+      const struct trace_value *tex = trace_value_member(u, "tex");
+
+      templ.u.tex.level = member_uint(tex, "level");
+      templ.u.tex.first_layer = member_uint(tex, "first_layer");
+      templ.u.tex.last_layer = member_uint(tex, "last_layer");
+   }
+
+   TIMED(r, surf = pipe->create_surface(pipe, res, &templ));
+   insert(r, call->ret, surf);
+}
+
+
+static void
+replay_surface_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_surface *surf = take(r, ARG(1));
+
+   TIMED(r, pipe_surface_reference(&surf, NULL));
+}
+
+
+static void
+replay_set_sampler_views(struct replay *r, const struct trace_call *call,
+                         unsigned shader)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_sampler_view *views[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned num = MIN2(trace_value_uint(ARG(1)),
+                       PIPE_MAX_SHADER_SAMPLER_VIEWS);
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   for (i = 0; i < num; i++)
+      views[i] = lookup(r, trace_value_elem(ARG(2), i));
+
+   switch (shader) {
+   case PIPE_SHADER_VERTEX:
+      TIMED(r, pipe->set_vertex_sampler_views(pipe, num, views));
+      break;
+   case PIPE_SHADER_GEOMETRY:
+      if (pipe->set_geometry_sampler_views)
+         TIMED(r, pipe->set_geometry_sampler_views(pipe, num, views));
+      break;
+   default:
+      TIMED(r, pipe->set_fragment_sampler_views(pipe, num, views));
+      break;
+   }
+}
+
+
+static void
+replay_set_vertex_sampler_views(struct replay *r,
+                                const struct trace_call *call)
+{
+   replay_set_sampler_views(r, call, PIPE_SHADER_VERTEX);
+}
+
+
+static void
+replay_set_geometry_sampler_views(struct replay *r,
+                                  const struct trace_call *call)
+{
+   replay_set_sampler_views(r, call, PIPE_SHADER_GEOMETRY);
+}
+
+
+static void
+replay_set_fragment_sampler_views(struct replay *r,
+                                  const struct trace_call *call)
+{
+   replay_set_sampler_views(r, call, PIPE_SHADER_FRAGMENT);
+}
+
+
+static void
+replay_set_vertex_buffers(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_vertex_buffer buffers[PIPE_MAX_ATTRIBS];
+   unsigned num = MIN2(trace_value_uint(ARG(2)), PIPE_MAX_ATTRIBS);
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   memset(buffers, 0, sizeof buffers);
+   for (i = 0; i < num; i++) {
+      const struct trace_value *vb = trace_value_elem(ARG(3), i);
+
+      buffers[i].stride = member_uint(vb, "stride");
+      buffers[i].buffer_offset = member_uint(vb, "buffer_offset");
+      buffers[i].buffer = lookup(r, trace_value_member(vb, "buffer"));
+      if (!buffers[i].buffer && buffers[i].stride) {
+         buffers[i].buffer = zero_buffer(r, pipe, 0);
+         buffers[i].buffer_offset = 0;
+      }
+   }
+
+   TIMED(r, pipe->set_vertex_buffers(pipe, trace_value_uint(ARG(1)), num,
+                                     trace_value_count(ARG(3)) ? buffers :
+                                                                 NULL));
+}
+
+
+static void
+replay_set_index_buffer(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   struct pipe_index_buffer ib;
+
+   if (!pipe)
+      return;
+
+   if (v->type == TRACE_VALUE_NULL) {
+      TIMED(r, pipe->set_index_buffer(pipe, NULL));
+      return;
+   }
+
+   memset(&ib, 0, sizeof ib);
+   ib.index_size = member_uint(v, "index_size");
+   ib.offset = member_uint(v, "offset");
+   ib.buffer = lookup(r, trace_value_member(v, "buffer"));
+   if (!ib.buffer) {
+      ib.buffer = zero_buffer(r, pipe, 0);
+      ib.offset = 0;
+   }
+
+   TIMED(r, pipe->set_index_buffer(pipe, &ib));
+}
+
+
+static void
+replay_create_stream_output_target(struct replay *r,
+                                   const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_resource *res = lookup(r, ARG(1));
+   struct pipe_stream_output_target *target;
+
+   if (!pipe || !res || !pipe->create_stream_output_target)
+      return;
+
+   TIMED(r, target = pipe->create_stream_output_target(
+                        pipe, res, trace_value_uint(ARG(2)),
+                        trace_value_uint(ARG(3))));
+   insert(r, call->ret, target);
+}
+
+
+static void
+replay_stream_output_target_destroy(struct replay *r,
+                                    const struct trace_call *call)
+{
+   struct pipe_stream_output_target *target = take(r, ARG(1));
+
+   TIMED(r, pipe_so_target_reference(&target, NULL));
+}
+
+
+static void
+replay_set_stream_output_targets(struct replay *r,
+                                 const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_stream_output_target *targets[PIPE_MAX_SO_BUFFERS];
+   unsigned num = MIN2(trace_value_uint(ARG(1)), PIPE_MAX_SO_BUFFERS);
+   unsigned i;
+
+   if (!pipe || !pipe->set_stream_output_targets)
+      return;
+
+   for (i = 0; i < num; i++)
+      targets[i] = lookup(r, trace_value_elem(ARG(2), i));
+
+   TIMED(r, pipe->set_stream_output_targets(pipe, num, targets,
+                                            trace_value_uint(ARG(3))));
+}
+
+
+static void
+replay_resource_copy_region(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_resource *dst = lookup(r, ARG(1));
+   struct pipe_resource *src = lookup(r, ARG(6));
+   struct pipe_box box;
+
+   if (!pipe || !dst || !src)
+      return;
+
+   box_value(ARG(8), &box);
+   TIMED(r, pipe->resource_copy_region(pipe, dst, trace_value_uint(ARG(2)),
+                                       trace_value_uint(ARG(3)),
+                                       trace_value_uint(ARG(4)),
+                                       trace_value_uint(ARG(5)),
+                                       src, trace_value_uint(ARG(7)), &box));
+}
+
+
+static void
+replay_blit(struct replay *r, const struct trace_call *call)
+{
+   static const char mask_chars[] = "RGBAZS";
+   static const unsigned mask_bits[] = {
+      PIPE_MASK_R, PIPE_MASK_G, PIPE_MASK_B, PIPE_MASK_A,
+      PIPE_MASK_Z, PIPE_MASK_S
+   };
+   struct pipe_context *pipe = context_arg(r, call);
+   const struct trace_value *v = ARG(1);
+   const struct trace_value *dst = trace_value_member(v, "dst");
+   const struct trace_value *src = trace_value_member(v, "src");
+   const char *mask = trace_value_string(trace_value_member(v, "mask"));
+   struct pipe_blit_info info;
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   memset(&info, 0, sizeof info);
+   info.dst.resource = lookup(r, trace_value_member(dst, "resource"));
+   info.dst.level = member_uint(dst, "level");
+   info.dst.format = format_value(r, trace_value_member(dst, "format"));
+   box_value(trace_value_member(dst, "box"), &info.dst.box);
+   info.src.resource = lookup(r, trace_value_member(src, "resource"));
+   info.src.level = member_uint(src, "level");
+   info.src.format = format_value(r, trace_value_member(src, "format"));
+   box_value(trace_value_member(src, "box"), &info.src.box);
+   for (i = 0; mask && mask[i] && i < Elements(mask_bits); i++) {
+      if (mask[i] == mask_chars[i])
+         info.mask |= mask_bits[i];
+   }
+   info.filter = member_uint(v, "filter");
+   info.scissor_enable = member_uint(v, "scissor_enable");
+   scissor_value(trace_value_member(v, "scissor"), &info.scissor);
+
+   if (info.dst.resource && info.src.resource)
+      TIMED(r, pipe->blit(pipe, &info));
+}
+
+
+static void
+replay_flush_resource(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_resource *res = lookup(r, ARG(1));
+
+   if (pipe && res && pipe->flush_resource)
+      TIMED(r, pipe->flush_resource(pipe, res));
+}
+
+
+static void
+replay_clear(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   union pipe_color_union color;
+
+   if (!pipe)
+      return;
+
+   memset(&color, 0, sizeof color);
+   floats(ARG(2), color.f, 4);
+   TIMED(r, pipe->clear(pipe, trace_value_uint(ARG(1)), &color,
+                        trace_value_float(ARG(3)),
+                        trace_value_uint(ARG(4))));
+}
+
+
+static void
+replay_clear_render_target(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_surface *dst = lookup(r, ARG(1));
+   union pipe_color_union color;
+
+   if (!pipe || !dst)
+      return;
+
+   floats(ARG(2), color.f, 4);
+   TIMED(r, pipe->clear_render_target(pipe, dst, &color,
+                                      trace_value_uint(ARG(3)),
+                                      trace_value_uint(ARG(4)),
+                                      trace_value_uint(ARG(5)),
+                                      trace_value_uint(ARG(6))));
+}
+
+
+static void
+replay_clear_depth_stencil(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_surface *dst = lookup(r, ARG(1));
+
+   if (!pipe || !dst)
+      return;
+
+   TIMED(r, pipe->clear_depth_stencil(pipe, dst, trace_value_uint(ARG(2)),
+                                      trace_value_float(ARG(3)),
+                                      trace_value_uint(ARG(4)),
+                                      trace_value_uint(ARG(5)),
+                                      trace_value_uint(ARG(6)),
+                                      trace_value_uint(ARG(7)),
+                                      trace_value_uint(ARG(8))));
+}
+
+
+static void
+replay_flush(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   unsigned flags = trace_value_uint(ARG(1));
+
+   if (!pipe)
+      return;
+
+   TIMED(r, pipe->flush(pipe, NULL, flags));
+   if (flags & PIPE_FLUSH_END_OF_FRAME)
+      frame_end(r);
+}
+
+
+static void
+replay_transfer_inline_write(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+   struct pipe_resource *res = lookup(r, ARG(1));
+   const struct trace_value *data = ARG(5);
+   struct pipe_box box;
+
+   /* Only buffer contents are traced */
+   if (!pipe || !res || !trace_value_size(data))
+      return;
+
+   box_value(ARG(4), &box);
+   TIMED(r, pipe->transfer_inline_write(pipe, res, trace_value_uint(ARG(2)),
+                                        trace_value_uint(ARG(3)), &box,
+                                        trace_value_string(data),
+                                        trace_value_uint(ARG(6)),
+                                        trace_value_uint(ARG(7))));
+}
+
+
+static void
+replay_texture_barrier(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = context_arg(r, call);
+
+   if (pipe && pipe->texture_barrier)
+      TIMED(r, pipe->texture_barrier(pipe));
+}
+
+
+/**
+ * Calls not in here don't change any state, or can't be replayed, like
+ * pipe_context::get_query_result whose query isn't traced.
+ */
+static const struct {
+   const char *name;
+   replay_func func;
+} replay_funcs[] = {
+#define CALL(klass, method) { #klass "::" #method, replay_##method }
+   CALL(pipe_screen, context_create),
+   CALL(pipe_screen, resource_create),
+   CALL(pipe_screen, resource_destroy),
+   CALL(pipe_screen, flush_frontbuffer),
+   CALL(pipe_context, destroy),
+   CALL(pipe_context, draw_vbo),
+   CALL(pipe_context, create_query),
+   CALL(pipe_context, destroy_query),
+   CALL(pipe_context, begin_query),
+   CALL(pipe_context, end_query),
+   CALL(pipe_context, render_condition),
+   CALL(pipe_context, create_blend_state),
+   CALL(pipe_context, bind_blend_state),
+   CALL(pipe_context, delete_blend_state),
+   CALL(pipe_context, create_sampler_state),
+   CALL(pipe_context, bind_sampler_states),
+   CALL(pipe_context, delete_sampler_state),
+   CALL(pipe_context, create_rasterizer_state),
+   CALL(pipe_context, bind_rasterizer_state),
+   CALL(pipe_context, delete_rasterizer_state),
+   CALL(pipe_context, create_depth_stencil_alpha_state),
+   CALL(pipe_context, bind_depth_stencil_alpha_state),
+   CALL(pipe_context, delete_depth_stencil_alpha_state),
+   CALL(pipe_context, create_vs_state),
+   CALL(pipe_context, bind_vs_state),
+   CALL(pipe_context, delete_vs_state),
+   CALL(pipe_context, create_gs_state),
+   CALL(pipe_context, bind_gs_state),
+   CALL(pipe_context, delete_gs_state),
+   CALL(pipe_context, create_fs_state),
+   CALL(pipe_context, bind_fs_state),
+   CALL(pipe_context, delete_fs_state),
+   CALL(pipe_context, create_vertex_elements_state),
+   CALL(pipe_context, bind_vertex_elements_state),
+   CALL(pipe_context, delete_vertex_elements_state),
+   CALL(pipe_context, set_blend_color),
+   CALL(pipe_context, set_stencil_ref),
+   CALL(pipe_context, set_clip_state),
+   CALL(pipe_context, set_sample_mask),
+   CALL(pipe_context, set_constant_buffer),
+   CALL(pipe_context, set_framebuffer_state),
+   CALL(pipe_context, set_polygon_stipple),
+   CALL(pipe_context, set_scissor_states),
+   CALL(pipe_context, set_viewport_states),
+   CALL(pipe_context, create_sampler_view),
+   CALL(pipe_context, sampler_view_destroy),
+   CALL(pipe_context, create_surface),
+   CALL(pipe_context, surface_destroy),
+   CALL(pipe_context, set_vertex_sampler_views),
+   CALL(pipe_context, set_geometry_sampler_views),
+   CALL(pipe_context, set_fragment_sampler_views),
+   CALL(pipe_context, set_vertex_buffers),
+   CALL(pipe_context, set_index_buffer),
+   CALL(pipe_context, create_stream_output_target),
+   CALL(pipe_context, stream_output_target_destroy),
+   CALL(pipe_context, set_stream_output_targets),
+   CALL(pipe_context, resource_copy_region),
+   CALL(pipe_context, blit),
+   CALL(pipe_context, flush_resource),
+   CALL(pipe_context, clear),
+   CALL(pipe_context, clear_render_target),
+   CALL(pipe_context, clear_depth_stencil),
+   CALL(pipe_context, flush),
+   CALL(pipe_context, transfer_inline_write),
+   CALL(pipe_context, texture_barrier),
+#undef CALL
+};
+
+
+static struct call_stats *
+call_stats(struct replay *r, const char *name)
+{
+   struct call_stats *stats = util_hash_table_get(r->calls, (void *) name);
+   unsigned i;
+
+   if (stats)
+      return stats;
+
+   stats = CALLOC_STRUCT(call_stats);
+   if (!stats)
+      return NULL;
+
+   stats->name = name;
+   for (i = 0; i < Elements(replay_funcs); i++) {
+      if (strcmp(replay_funcs[i].name, name) == 0) {
+         stats->func = replay_funcs[i].func;
+         break;
+      }
+   }
+
+   stats->next = r->first_call;
+   r->first_call = stats;
+   util_hash_table_set(r->calls, (void *) name, stats);
+   return stats;
+}
+
+
+static boolean
+replay_call(struct replay *r, const struct trace_call *call)
+{
+   struct call_stats *stats = call_stats(r, call->name);
+   unsigned num_frames = r->num_frames;
+
+   if (!stats || !stats->func) {
+      r->num_ignored++;
+      return TRUE;
+   }
+
+   r->call_time = 0;
+   stats->func(r, call);
+   stats->count++;
+   stats->time += r->call_time;
+   r->frame_driver_time += r->call_time;
+   r->num_replayed++;
+
+   return !(r->max_frames && r->num_frames != num_frames &&
+            r->num_frames >= r->max_frames);
+}
+
+
+/*
+ * Report.
+ */
+
+static int
+compare_stats(const void *a, const void *b)
+{
+   const struct call_stats *sa = *(const struct call_stats * const *) a;
+   const struct call_stats *sb = *(const struct call_stats * const *) b;
+
+   return sa->time < sb->time ? 1 : sa->time > sb->time ? -1 : 0;
+}
+
+
+static int
+compare_double(const void *a, const void *b)
+{
+   double da = *(const double *) a, db = *(const double *) b;
+
+   return da < db ? -1 : da > db ? 1 : 0;
+}
+
+
+static void
+print_report(struct replay *r, int64_t elapsed)
+{
+   struct call_stats *stats, **sorted;
+   unsigned num_calls = 0, num_frames, i;
+   int64_t total = 0;
+
+   printf("%u calls replayed, %u ignored, %u frames in %.3f s\n",
+          r->num_replayed, r->num_ignored, r->num_frames,
+          elapsed / 1000000000.0);
+
+   num_frames = MIN2(r->num_frames, r->frames_size);
+   if (num_frames) {
+      double sum = 0.0;
+
+      for (i = 0; i < num_frames; i++)
+         sum += r->frame_times[i];
+      qsort(r->frame_times, num_frames, sizeof *r->frame_times,
+            compare_double);
+
+      printf("\nframe time: avg %.3f ms (%.1f fps), min %.3f ms, "
+             "median %.3f ms, 95%% %.3f ms, max %.3f ms\n",
+             sum / num_frames, num_frames * 1000.0 / sum,
+             r->frame_times[0], r->frame_times[num_frames / 2],
+             r->frame_times[(num_frames * 95) / 100],
+             r->frame_times[num_frames - 1]);
+   }
+
+   if (r->num_queries && r->num_frames) {
+      printf("\n%-32s %16s %16s\n", "query", "total", "per frame");
+      for (i = 0; i < r->num_queries; i++)
+         printf("%-32s %16llu %16.1f\n", r->queries[i].info.name,
+                (unsigned long long) r->queries[i].total,
+                (double) r->queries[i].total / r->num_frames);
+   }
+
+   for (stats = r->first_call; stats; stats = stats->next) {
+      if (stats->count) {
+         num_calls++;
+         total += stats->time;
+      }
+   }
+   if (!num_calls)
+      return;
+
+   sorted = MALLOC(num_calls * sizeof *sorted);
+   if (!sorted)
+      return;
+
+   i = 0;
+   for (stats = r->first_call; stats; stats = stats->next) {
+      if (stats->count)
+         sorted[i++] = stats;
+   }
+   qsort(sorted, num_calls, sizeof *sorted, compare_stats);
+
+   printf("\n%-48s %10s %12s %10s %6s\n",
+          "call", "count", "total ms", "avg us", "%");
+   for (i = 0; i < num_calls; i++) {
+      stats = sorted[i];
+      printf("%-48s %10u %12.3f %10.3f %5.1f%%\n", stats->name, stats->count,
+             stats->time / 1000000.0, stats->time / 1000.0 / stats->count,
+             total ? stats->time * 100.0 / total : 0.0);
+   }
+   printf("%-48s %10s %12.3f\n", "total", "", total / 1000000.0);
+
+   FREE(sorted);
+}
+
+
+/*
+ * Main.
+ */
+
+static boolean
+setup_queries(struct replay *r, const char *names)
+{
+   int num = r->screen->get_driver_query_info ?
+             r->screen->get_driver_query_info(r->screen, 0, NULL) : 0;
+   boolean list = strcmp(names, "help") == 0;
+   const char *name = names;
+   int i;
+
+   if (list) {
+      printf("driver queries:\n");
+      for (i = 0; i < num; i++) {
+         struct pipe_driver_query_info info;
+
+         if (r->screen->get_driver_query_info(r->screen, i, &info))
+            printf("   %s\n", info.name);
+      }
+      return FALSE;
+   }
+
+   while (*name) {
+      size_t len = strcspn(name, ",");
+
+      for (i = 0; i < num; i++) {
+         struct pipe_driver_query_info info;
+
+         if (r->screen->get_driver_query_info(r->screen, i, &info) &&
+             strlen(info.name) == len &&
+             strncmp(info.name, name, len) == 0) {
+            if (r->num_queries < MAX_QUERIES)
+               r->queries[r->num_queries++].info = info;
+            break;
+         }
+      }
+      if (i == num) {
+         fprintf(stderr, "trace-replay: unknown driver query %.*s, "
+                 "try -q help\n", (int) len, name);
+         return FALSE;
+      }
+
+      name += len;
+      if (*name == ',')
+         name++;
+   }
+
+   return TRUE;
+}
+
+
+static void
+destroy_stats(struct replay *r)
+{
+   while (r->first_call) {
+      struct call_stats *next = r->first_call->next;
+
+      FREE(r->first_call);
+      r->first_call = next;
+   }
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct replay r;
+   struct pipe_loader_device **devs = NULL;
+   struct trace_reader *reader;
+   struct trace_call call;
+   const char *filename = NULL, *queries = NULL;
+   int ndev, device = 0, i;
+   int64_t start;
+
+   memset(&r, 0, sizeof r);
+
+   for (i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+         device = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-f") == 0)
+         r.per_frame = TRUE;
+      else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+         r.max_frames = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+         queries = argv[++i];
+      else if (argv[i][0] != '-' && !filename)
+         filename = argv[i];
+      else {
+         filename = NULL;
+         break;
+      }
+   }
+
+   if (!filename && !(queries && strcmp(queries, "help") == 0)) {
+      fprintf(stderr, "usage: %s [-d <device>] [-f] [-n <frames>] "
+              "[-q <query,...>|help] <trace>\n", argv[0]);
+      return 1;
+   }
+
+   ndev = pipe_loader_probe(NULL, 0);
+   if (ndev > 0) {
+      devs = CALLOC(ndev, sizeof *devs);
+      pipe_loader_probe(devs, ndev);
+   }
+   if (device < 0 || device >= ndev) {
+      fprintf(stderr, "trace-replay: no device %d, %d available:\n",
+              device, ndev);
+      for (i = 0; i < ndev; i++)
+         fprintf(stderr, "   %d: %s\n", i, devs[i]->driver_name);
+      pipe_loader_release(devs, ndev);
+      FREE(devs);
+      return 1;
+   }
+
+   r.screen = pipe_loader_create_screen(devs[device], PIPE_SEARCH_DIR);
+   if (!r.screen) {
+      fprintf(stderr, "trace-replay: couldn't create a %s screen\n",
+              devs[device]->driver_name);
+      pipe_loader_release(devs, ndev);
+      FREE(devs);
+      return 1;
+   }
+   printf("replaying on %s (%s)\n", r.screen->get_name(r.screen),
+          devs[device]->driver_name);
+
+   if (queries && !setup_queries(&r, queries)) {
+      r.screen->destroy(r.screen);
+      pipe_loader_release(devs, ndev);
+      FREE(devs);
+      return strcmp(queries, "help") == 0 ? 0 : 1;
+   }
+
+   reader = trace_reader_open(filename);
+   if (!reader) {
+      fprintf(stderr, "trace-replay: couldn't open %s\n", filename);
+      r.screen->destroy(r.screen);
+      pipe_loader_release(devs, ndev);
+      FREE(devs);
+      return 1;
+   }
+
+   r.objects = util_hash_table_create_ptr_keys();
+   r.formats = util_hash_table_create_ptr_keys();
+   r.calls = util_hash_table_create_ptr_keys();
+
+   start = r.frame_start = os_time_get_nano();
+   while (trace_reader_next(reader, &call) && replay_call(&r, &call))
+      ;
+
+   print_report(&r, os_time_get_nano() - start);
+
+   /* Objects the trace didn't destroy are left to the process exit, so
+    * the screen isn't destroyed either.
+    */
+   queries_end(&r, TRUE);
+   pipe_resource_reference(&r.zero_buffer, NULL);
+
+   trace_reader_close(reader);
+   destroy_stats(&r);
+   util_hash_table_destroy(r.calls);
+   util_hash_table_destroy(r.formats);
+   util_hash_table_destroy(r.objects);
+   FREE(r.frame_times);
+   pipe_loader_release(devs, ndev);
+   FREE(devs);
+   return 0;
+}
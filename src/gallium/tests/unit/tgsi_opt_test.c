@@ -0,0 +1,298 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for tgsi_optimize().
+ *
+ * Runs the passes on small shaders and compares the dump of the result
+ * with the dump of the expected shader.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_opt.h"
+#include "tgsi/tgsi_text.h"
+#include "tgsi/tgsi_ureg.h"
+#include "util/u_memory.h"
+
+
+#define MAX_TOKENS 1024
+#define MAX_TEXT 4096
+
+
+struct opt_test
+{
+   const char *name;
+   unsigned passes;
+   const char *input;
+   const char *expected;
+};
+
+
+static const struct opt_test tests[] = {
+   {
+      "copy propagation",
+      TGSI_OPT_COPY_PROPAGATE | TGSI_OPT_DEAD_CODE,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0]\n"
+      "  0: MOV TEMP[0], IN[0].wzyx\n"
+      "  1: ADD OUT[0], TEMP[0].yxzw, IN[0]\n"
+      "  2: END\n",
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0]\n"
+      "  0: ADD OUT[0], IN[0].zwyx, IN[0]\n"
+      "  1: END\n"
+   },
+   {
+      "copies end with the block",
+      TGSI_OPT_COPY_PROPAGATE,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0]\n"
+      "  0: MOV TEMP[0], IN[0]\n"
+      "  1: IF IN[0].xxxx :3\n"
+      "  2: MOV OUT[0], TEMP[0]\n"
+      "  3: ENDIF\n"
+      "  4: END\n",
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0]\n"
+      "  0: MOV TEMP[0], IN[0]\n"
+      "  1: IF IN[0].xxxx :3\n"
+      "  2: MOV OUT[0], TEMP[0]\n"
+      "  3: ENDIF\n"
+      "  4: END\n"
+   },
+   {
+      "constant folding",
+      TGSI_OPT_ALL,
+      "FRAG\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0]\n"
+      "IMM[0] FLT32 {    1.0000,     2.0000,     3.0000,     4.0000}\n"
+      "  0: ADD TEMP[0], IMM[0], IMM[0].wzyx\n"
+      "  1: MUL OUT[0], TEMP[0], IMM[0]\n"
+      "  2: END\n",
+      "FRAG\n"
+      "DCL OUT[0], COLOR\n"
+      "IMM[0] FLT32 {    1.0000,     2.0000,     3.0000,     4.0000}\n"
+      "IMM[1] FLT32 {    5.0000,    10.0000,    15.0000,    20.0000}\n"
+      "  0: MOV OUT[0], IMM[1]\n"
+      "  1: END\n"
+   },
+   {
+      "dead channels",
+      TGSI_OPT_DEAD_CODE,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0..1]\n"
+      "  0: MUL TEMP[0], IN[0], IN[0]\n"
+      "  1: MOV TEMP[1], IN[0]\n"
+      "  2: MOV OUT[0], TEMP[0].xyxy\n"
+      "  3: END\n",
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0..1]\n"
+      "  0: MUL TEMP[0].xy, IN[0], IN[0]\n"
+      "  1: MOV OUT[0], TEMP[0].xyxy\n"
+      "  2: END\n"
+   },
+   {
+      "temp compaction",
+      TGSI_OPT_DEAD_CODE | TGSI_OPT_COMPACT_TEMPS,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0..3]\n"
+      "  0: MOV TEMP[0], IN[0]\n"
+      "  1: MUL TEMP[3], IN[0], IN[0]\n"
+      "  2: ADD OUT[0], TEMP[3], IN[0]\n"
+      "  3: END\n",
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0]\n"
+      "  0: MUL TEMP[0], IN[0], IN[0]\n"
+      "  1: ADD OUT[0], TEMP[0], IN[0]\n"
+      "  2: END\n"
+   },
+   {
+      "indirect temps are left alone",
+      TGSI_OPT_ALL,
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0..1]\n"
+      "DCL ADDR[0]\n"
+      "  0: MOV TEMP[0], IN[0]\n"
+      "  1: ARL ADDR[0].x, IN[0].xxxx\n"
+      "  2: MOV OUT[0], TEMP[ADDR[0].x]\n"
+      "  3: END\n",
+      "FRAG\n"
+      "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL TEMP[0..1]\n"
+      "DCL ADDR[0]\n"
+      "  0: MOV TEMP[0], IN[0]\n"
+      "  1: ARL ADDR[0].x, IN[0].xxxx\n"
+      "  2: MOV OUT[0], TEMP[ADDR[0].x]\n"
+      "  3: END\n"
+   },
+};
+
+
+static boolean
+dump(const struct tgsi_token *tokens, char *text)
+{
+   if (!tokens)
+      return FALSE;
+
+   tgsi_dump_str(tokens, 0, text, MAX_TEXT);
+   return TRUE;
+}
+
+
+static boolean
+run_test(const struct opt_test *test)
+{
+   struct tgsi_token input[MAX_TOKENS], expected[MAX_TOKENS];
+   struct tgsi_token *output;
+   static char output_text[MAX_TEXT], expected_text[MAX_TEXT];
+   boolean success;
+
+   if (!tgsi_text_translate(test->input, input, MAX_TOKENS) ||
+       !tgsi_text_translate(test->expected, expected, MAX_TOKENS)) {
+      printf("%s: couldn't parse the shaders\n", test->name);
+      return FALSE;
+   }
+
+   output = tgsi_optimize(input, test->passes);
+
+   success = dump(output, output_text) && dump(expected, expected_text) &&
+             strcmp(output_text, expected_text) == 0;
+   if (!success)
+      printf("%s: got\n%s\nexpected\n%s\n", test->name,
+             output ? output_text : "(null)\n", expected_text);
+
+   FREE(output);
+   return success;
+}
+
+
+/**
+ * Temps only read as texture offsets must stay live, and be renumbered
+ * with the others.  tgsi_text can't parse offsets, so use ureg.
+ */
+static boolean
+test_tex_offsets(void)
+{
+   struct ureg_program *ureg;
+   struct ureg_src in, sampler;
+   struct ureg_dst out, dead, offset;
+   struct tgsi_texture_offset tex_offset;
+   struct tgsi_token *output;
+   static char output_text[MAX_TEXT];
+   const struct tgsi_token *tokens;
+   boolean success;
+
+   ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
+   if (!ureg)
+      return FALSE;
+
+   in = ureg_DECL_fs_input(ureg, TGSI_SEMANTIC_GENERIC, 0,
+                           TGSI_INTERPOLATE_PERSPECTIVE);
+   out = ureg_DECL_output(ureg, TGSI_SEMANTIC_COLOR, 0);
+   sampler = ureg_DECL_sampler(ureg, 0);
+   dead = ureg_DECL_temporary(ureg);
+   offset = ureg_DECL_temporary(ureg);
+
+   ureg_MOV(ureg, dead, in);
+   ureg_F2I(ureg, offset, in);
+
+   memset(&tex_offset, 0, sizeof(tex_offset));
+   tex_offset.File = TGSI_FILE_TEMPORARY;
+   tex_offset.Index = offset.Index;
+   tex_offset.SwizzleX = TGSI_SWIZZLE_X;
+   tex_offset.SwizzleY = TGSI_SWIZZLE_Y;
+   tex_offset.SwizzleZ = TGSI_SWIZZLE_Z;
+   {
+      struct ureg_src src[2];
+
+      src[0] = in;
+      src[1] = sampler;
+      ureg_tex_insn(ureg, TGSI_OPCODE_TEX, &out, 1, TGSI_TEXTURE_2D,
+                    &tex_offset, 1, src, 2);
+   }
+   ureg_END(ureg);
+
+   tokens = ureg_get_tokens(ureg, NULL);
+   output = tokens ? tgsi_optimize(tokens, TGSI_OPT_ALL) : NULL;
+
+   success = dump(output, output_text) &&
+             strstr(output_text, "DCL TEMP[0]\n") &&
+             strstr(output_text, "F2I TEMP[0].xyz, IN[0]\n") &&
+             strstr(output_text, "2D, TEMP[0].xyz\n") &&
+             !strstr(output_text, "MOV");
+   if (!success)
+      printf("texture offsets: got\n%s\n",
+             output ? output_text : "(null)\n");
+
+   FREE(output);
+   if (tokens)
+      ureg_free_tokens(tokens);
+   ureg_destroy(ureg);
+   return success;
+}
+
+
+int main()
+{
+   unsigned i;
+   int failed = 0;
+
+   for (i = 0; i < Elements(tests); i++) {
+      if (!run_test(&tests[i]))
+         failed = 1;
+   }
+
+   if (!test_tex_offsets())
+      failed = 1;
+
+   printf("tgsi_opt_test %s\n", failed ? "failed" : "passed");
+
+   return failed;
+}
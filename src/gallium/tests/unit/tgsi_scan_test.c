@@ -0,0 +1,128 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Test case for tgsi_scan_liveness().
+ */
+
+
+#include <stdio.h>
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_scan.h"
+#include "tgsi/tgsi_text.h"
+
+
+#define MAX_TOKENS 1024
+
+
+static const char shader[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL CONST[2..9]\n"
+   "DCL TEMP[0..3]\n"
+   "  0: MOV TEMP[0].xy, IN[0]\n"
+   "  1: MOV TEMP[1], CONST[3]\n"
+   "  2: BGNLOOP :6\n"
+   "  3:   ADD TEMP[2].x, TEMP[0].xxxx, CONST[5].yyyy\n"
+   "  4:   BRK\n"
+   "  5: ENDLOOP :2\n"
+   "  6: MOV OUT[0], TEMP[2].xxxx\n"
+   "  7: MOV OUT[0].y, TEMP[1].zzzz\n"
+   "  8: END\n";
+
+
+static boolean
+check_temp(const struct tgsi_shader_liveness *live, unsigned index,
+           int first, int last, unsigned read_mask, unsigned write_mask)
+{
+   const struct tgsi_temp_usage *temp = &live->temps[index];
+
+   if (temp->first == first && temp->last == last &&
+       temp->read_mask == read_mask && temp->write_mask == write_mask)
+      return TRUE;
+
+   printf("TEMP[%u]: got %d..%d read %x written %x, "
+          "expected %d..%d read %x written %x\n", index,
+          temp->first, temp->last, temp->read_mask, temp->write_mask,
+          first, last, read_mask, write_mask);
+   return FALSE;
+}
+
+
+int main()
+{
+   struct tgsi_token tokens[MAX_TOKENS];
+   struct tgsi_decoded_shader *decoded;
+   struct tgsi_shader_liveness *live;
+   static const ubyte loop_depth[] = { 0, 0, 0, 1, 1, 0, 0, 0, 0 };
+   int failed = 0;
+   unsigned n;
+
+   if (!tgsi_text_translate(shader, tokens, MAX_TOKENS) ||
+       !(decoded = tgsi_decode_shader(tokens)) ||
+       !(live = tgsi_scan_liveness(decoded))) {
+      printf("couldn't scan the shader\n");
+      return 1;
+   }
+
+   if (live->num_temps != 4 || live->num_instructions != 9) {
+      printf("%u temps, %u instructions\n",
+             live->num_temps, live->num_instructions);
+      failed = 1;
+   }
+   else {
+      /* TEMP[0] is read in the loop, so stays live until its end. */
+      if (!check_temp(live, 0, 0, 5, TGSI_WRITEMASK_X, TGSI_WRITEMASK_XY) ||
+          !check_temp(live, 1, 1, 7, TGSI_WRITEMASK_Z, TGSI_WRITEMASK_XYZW) ||
+          !check_temp(live, 2, 2, 6, TGSI_WRITEMASK_X, TGSI_WRITEMASK_X) ||
+          !check_temp(live, 3, -1, -1, 0, 0))
+         failed = 1;
+
+      for (n = 0; n < live->num_instructions; n++) {
+         if (live->loop_depth[n] != loop_depth[n]) {
+            printf("instruction %u: loop depth %u\n", n, live->loop_depth[n]);
+            failed = 1;
+         }
+      }
+   }
+
+   if (live->const_range[0].first != 3 || live->const_range[0].last != 5 ||
+       live->const_range[1].first <= live->const_range[1].last) {
+      printf("constants %d..%d read\n",
+             live->const_range[0].first, live->const_range[0].last);
+      failed = 1;
+   }
+
+   tgsi_free_liveness(live);
+   tgsi_free_decoded_shader(decoded);
+
+   printf("tgsi_scan_test %s\n", failed ? "failed" : "passed");
+
+   return failed;
+}
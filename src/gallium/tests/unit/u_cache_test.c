@@ -63,6 +63,59 @@ cache_test_compare(const void *key1, const void *key2) {
 }
 
 
+static int
+cache_test_compare_value(const void *key1, const void *key2) {
+   return *(const cache_test_key *) key1 != *(const cache_test_key *) key2;
+}
+
+
+/*
+ * Cycle through a working set larger than the cache: a fixed size cache
+ * misses every time, one with a budget grows until the set fits.
+ */
+static void
+test_growth(void)
+{
+   const unsigned working_set = 1000;
+   struct util_cache_stats stats;
+   struct util_cache *cache;
+   cache_test_key *keys;
+   unsigned round, i;
+
+   keys = malloc(working_set * sizeof(*keys));
+   for (i = 0; i < working_set; i++)
+      keys[i] = i;
+
+   cache = util_cache_create(cache_test_hash, cache_test_compare_value,
+                             NULL, 64);
+   util_cache_set_budget(cache, 1024 * 1024, sizeof(cache_test_key));
+
+   for (round = 0; round < 20; round++) {
+      for (i = 0; i < working_set; i++) {
+         if (!util_cache_get(cache, &keys[i]))
+            util_cache_set(cache, &keys[i], &keys[i]);
+      }
+   }
+
+   util_cache_get_stats(cache, &stats);
+   printf("Growth: %u of %u entries, %llu hits, %llu misses, "
+          "%llu evictions.\n", stats.count, stats.size,
+          (unsigned long long) stats.hits,
+          (unsigned long long) stats.misses,
+          (unsigned long long) stats.evictions);
+   assert(stats.size >= working_set);
+   assert(stats.count == working_set);
+   assert(stats.hits > stats.misses);
+
+   /* Everything is still reachable after the rehashes. */
+   for (i = 0; i < working_set; i++)
+      assert(util_cache_get(cache, &keys[i]) == &keys[i]);
+
+   util_cache_destroy(cache);
+   free(keys);
+}
+
+
 int main() {
    unsigned cache_size;
    unsigned cache_count;
@@ -117,5 +170,7 @@ int main() {
       }
    }
 
+   test_growth();
+
    return 0;
 }
@@ -29,9 +29,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
 
+#include "os/os_time.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_half.h"
 #include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
 
@@ -725,13 +730,228 @@ test_all(void)
 }
 
 
+/*
+ * The test cases above are single pixels, which the SIMD code paths never
+ * see.  Convert rows of random pixels with and without them and compare.
+ */
+
+#define ROW_WIDTH 1027
+
+/* R64G64B64A64_FLOAT */
+#define MAX_PIXEL_BYTES 32
+
+
+static struct util_cpu_caps detected_caps;
+
+
+static void
+enable_simd(boolean enable)
+{
+   util_cpu_caps.has_sse2 = enable ? detected_caps.has_sse2 : 0;
+   util_cpu_caps.has_ssse3 = enable ? detected_caps.has_ssse3 : 0;
+}
+
+
+static boolean
+is_row_format(const struct util_format_description *format_desc)
+{
+   return format_desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+          format_desc->unpack_rgba_8unorm &&
+          format_desc->unpack_rgba_float &&
+          format_desc->pack_rgba_8unorm &&
+          format_desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+          format_desc->block.width == 1 &&
+          format_desc->block.height == 1 &&
+          !util_format_is_pure_integer(format_desc->format);
+}
+
+
+static boolean
+test_rows(const struct util_format_description *format_desc)
+{
+   static uint8_t packed[ROW_WIDTH * MAX_PIXEL_BYTES];
+   static uint8_t rgba[ROW_WIDTH * 4];
+   static uint8_t simd_8unorm[ROW_WIDTH * 4], scalar_8unorm[ROW_WIDTH * 4];
+   static float simd_float[ROW_WIDTH * 4], scalar_float[ROW_WIDTH * 4];
+   static uint8_t simd_packed[ROW_WIDTH * MAX_PIXEL_BYTES];
+   static uint8_t scalar_packed[ROW_WIDTH * MAX_PIXEL_BYTES];
+   const unsigned packed_size = ROW_WIDTH * format_desc->block.bits / 8;
+   boolean success = TRUE;
+   unsigned i;
+
+   for (i = 0; i < sizeof packed; i++)
+      packed[i] = rand();
+   for (i = 0; i < sizeof rgba; i++)
+      rgba[i] = rand();
+
+   /* Avoid NaNs, which don't compare equal. */
+   if (format_desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT) {
+      for (i = 0; i + 1 < packed_size; i += 2)
+         packed[i + 1] &= 0x3f;
+   }
+
+   enable_simd(TRUE);
+   format_desc->unpack_rgba_8unorm(simd_8unorm, 0, packed, 0, ROW_WIDTH, 1);
+   format_desc->unpack_rgba_float(simd_float, 0, packed, 0, ROW_WIDTH, 1);
+   memset(simd_packed, 0, sizeof simd_packed);
+   format_desc->pack_rgba_8unorm(simd_packed, 0, rgba, 0, ROW_WIDTH, 1);
+
+   enable_simd(FALSE);
+   format_desc->unpack_rgba_8unorm(scalar_8unorm, 0, packed, 0, ROW_WIDTH, 1);
+   format_desc->unpack_rgba_float(scalar_float, 0, packed, 0, ROW_WIDTH, 1);
+   memset(scalar_packed, 0, sizeof scalar_packed);
+   format_desc->pack_rgba_8unorm(scalar_packed, 0, rgba, 0, ROW_WIDTH, 1);
+
+   enable_simd(TRUE);
+
+   if (memcmp(simd_8unorm, scalar_8unorm, sizeof simd_8unorm) != 0) {
+      printf("FAILED: util_format_%s_unpack_rgba_8unorm rows differ\n",
+             format_desc->short_name);
+      success = FALSE;
+   }
+
+   if (memcmp(simd_float, scalar_float, sizeof simd_float) != 0) {
+      printf("FAILED: util_format_%s_unpack_rgba_float rows differ\n",
+             format_desc->short_name);
+      success = FALSE;
+   }
+
+   if (memcmp(simd_packed, scalar_packed, packed_size) != 0) {
+      printf("FAILED: util_format_%s_pack_rgba_8unorm rows differ\n",
+             format_desc->short_name);
+      success = FALSE;
+   }
+
+   return success;
+}
+
+
+static boolean
+test_all_rows(void)
+{
+   enum pipe_format format;
+   boolean success = TRUE;
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+      const struct util_format_description *format_desc;
+
+      format_desc = util_format_description(format);
+      if (!format_desc || !is_row_format(format_desc)) {
+         continue;
+      }
+
+      if (!test_rows(format_desc)) {
+         success = FALSE;
+      }
+   }
+
+   return success;
+}
+
+
+/*
+ * With -b, time the conversions of a 1024x256 image, with and without SIMD.
+ */
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 256
+
+
+static double
+bench_one(const struct util_format_description *format_desc,
+          unsigned func, const uint8_t *packed, void *unpacked)
+{
+   const unsigned packed_stride = BENCH_WIDTH * format_desc->block.bits / 8;
+   int64_t start, end;
+   unsigned i;
+
+   start = os_time_get_nano();
+   for (i = 0; i < 4; i++) {
+      switch (func) {
+      case 0:
+         format_desc->unpack_rgba_8unorm(unpacked, BENCH_WIDTH * 4,
+                                         packed, packed_stride,
+                                         BENCH_WIDTH, BENCH_HEIGHT);
+         break;
+      case 1:
+         format_desc->unpack_rgba_float(unpacked, BENCH_WIDTH * 16,
+                                        packed, packed_stride,
+                                        BENCH_WIDTH, BENCH_HEIGHT);
+         break;
+      default:
+         format_desc->pack_rgba_8unorm((uint8_t *) packed, packed_stride,
+                                       unpacked, BENCH_WIDTH * 4,
+                                       BENCH_WIDTH, BENCH_HEIGHT);
+         break;
+      }
+   }
+   end = os_time_get_nano();
+
+   /* Mpixel/s */
+   return 4.0 * BENCH_WIDTH * BENCH_HEIGHT * 1000.0 / MAX2(end - start, 1);
+}
+
+
+static void
+bench_all(void)
+{
+   static const char *names[] = {
+      "unpack_rgba_8unorm", "unpack_rgba_float", "pack_rgba_8unorm"
+   };
+   uint8_t *packed = CALLOC(BENCH_WIDTH * BENCH_HEIGHT,
+                            MAX_PIXEL_BYTES);
+   float *unpacked = CALLOC(BENCH_WIDTH * BENCH_HEIGHT * 4, sizeof(float));
+   enum pipe_format format;
+   unsigned func;
+
+   printf("%-24s %-20s %10s %10s  (Mpixel/s)\n",
+          "format", "function", "scalar", "simd");
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; ++format) {
+      const struct util_format_description *format_desc;
+
+      format_desc = util_format_description(format);
+      if (!format_desc || !is_row_format(format_desc)) {
+         continue;
+      }
+
+      for (func = 0; func < Elements(names); func++) {
+         double scalar, simd;
+
+         enable_simd(FALSE);
+         scalar = bench_one(format_desc, func, packed, unpacked);
+         enable_simd(TRUE);
+         simd = bench_one(format_desc, func, packed, unpacked);
+
+         printf("%-24s %-20s %10.1f %10.1f\n",
+                format_desc->short_name, names[func], scalar, simd);
+      }
+   }
+
+   FREE(packed);
+   FREE(unpacked);
+}
+
+
 int main(int argc, char **argv)
 {
    boolean success;
 
+   util_cpu_detect();
+   detected_caps = util_cpu_caps;
+
    util_format_s3tc_init();
 
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      bench_all();
+      return 0;
+   }
+
    success = test_all();
 
+   if (!test_all_rows()) {
+      success = FALSE;
+   }
+
    return success ? 0 : 1;
 }
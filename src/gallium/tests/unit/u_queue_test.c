@@ -0,0 +1,133 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for u_queue.
+ *
+ * Adds jobs of all priorities, some of them adding more jobs, and checks
+ * that each runs exactly once with its fence signalled afterwards.
+ */
+
+
+#include <stdio.h>
+
+#include "util/u_atomic.h"
+#include "util/u_queue.h"
+
+
+#define NUM_JOBS 10000
+#define NUM_THREADS 4
+
+
+static struct util_queue *queue;
+static struct util_queue_fence fences[NUM_JOBS];
+static int runs[NUM_JOBS];
+static int32_t num_children;
+static boolean bad_thread_index;
+
+
+static void
+child_job(void *job, unsigned thread_index)
+{
+   p_atomic_inc(&num_children);
+}
+
+
+static void
+test_job(void *job, unsigned thread_index)
+{
+   intptr_t i = (intptr_t) job;
+
+   if (thread_index >= util_queue_num_threads(queue))
+      bad_thread_index = TRUE;
+
+   runs[i]++;
+
+   if (i % 7 == 0)
+      util_queue_add_job(queue, NULL, NULL, child_job,
+                         UTIL_QUEUE_PRIORITY_LOW);
+}
+
+
+static boolean
+test_queue(void)
+{
+   intptr_t i;
+
+   num_children = 0;
+
+   for (i = 0; i < NUM_JOBS; i++) {
+      util_queue_fence_init(&fences[i]);
+      runs[i] = 0;
+   }
+
+   for (i = 0; i < NUM_JOBS; i++)
+      util_queue_add_job(queue, (void *) i, &fences[i], test_job,
+                         i % UTIL_QUEUE_PRIORITY_COUNT);
+
+   for (i = 0; i < NUM_JOBS; i++) {
+      util_queue_fence_wait(&fences[i]);
+      if (runs[i] != 1) {
+         printf("job %d ran %d times\n", (int) i, runs[i]);
+         return FALSE;
+      }
+      util_queue_fence_destroy(&fences[i]);
+   }
+
+   return TRUE;
+}
+
+
+int main()
+{
+   int failed = 0;
+
+   queue = util_queue_create(NUM_THREADS);
+   if (!test_queue())
+      failed = 1;
+   util_queue_destroy(queue);
+
+   /* The children were all run by util_queue_destroy(). */
+   if (num_children != (NUM_JOBS + 6) / 7) {
+      printf("%d of %d child jobs ran\n", num_children, (NUM_JOBS + 6) / 7);
+      failed = 1;
+   }
+
+   queue = util_queue_ref_shared();
+   if (queue) {
+      if (!test_queue())
+         failed = 1;
+      util_queue_unref_shared(queue);
+   }
+
+   if (bad_thread_index) {
+      printf("bad thread index\n");
+      failed = 1;
+   }
+
+   printf("u_queue_test %s\n", failed ? "failed" : "passed");
+
+   return failed;
+}
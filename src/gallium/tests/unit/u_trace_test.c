@@ -0,0 +1,140 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for u_trace.
+ *
+ * Records nested spans on a few threads, with ids given, inherited and
+ * set late, writes them and checks what ends up in the file.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os/os_thread.h"
+#include "util/u_trace.h"
+
+
+#define NUM_THREADS 4
+#define NUM_SPANS 100
+#define FILENAME "u_trace_test.json"
+
+
+static PIPE_THREAD_ROUTINE(thread_func, param)
+{
+   unsigned i;
+
+   for (i = 0; i < NUM_SPANS; i++) {
+      util_trace_begin("outer", 0x1000 + i);
+      util_trace_begin("inherited", 0);
+      util_trace_end();
+      util_trace_begin("late", 0);
+      util_trace_set_id(0x2000 + i);
+      util_trace_begin("late_child", 0);
+      util_trace_end();
+      util_trace_end();
+      util_trace_end();
+   }
+
+   return 0;
+}
+
+
+static unsigned
+count(const char *text, const char *pattern)
+{
+   unsigned n = 0;
+
+   while ((text = strstr(text, pattern))) {
+      text++;
+      n++;
+   }
+
+   return n;
+}
+
+
+int main()
+{
+   pipe_thread threads[NUM_THREADS];
+   char *text;
+   long size;
+   FILE *f;
+   int failed = 0;
+   unsigned i;
+
+   putenv((char *) "GALLIUM_TRACE_EVENTS=" FILENAME);
+
+   if (!util_trace_enabled()) {
+      printf("tracing not enabled\n");
+      return 1;
+   }
+
+   /* Unbalanced ends are ignored. */
+   util_trace_end();
+
+   for (i = 0; i < NUM_THREADS; i++)
+      threads[i] = pipe_thread_create(thread_func, NULL);
+   for (i = 0; i < NUM_THREADS; i++)
+      pipe_thread_wait(threads[i]);
+
+   if (!util_trace_write(FILENAME)) {
+      printf("couldn't write " FILENAME "\n");
+      return 1;
+   }
+
+   f = fopen(FILENAME, "r");
+   fseek(f, 0, SEEK_END);
+   size = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   text = calloc(1, size + 1);
+   fread(text, 1, size, f);
+   fclose(f);
+
+   if (count(text, "\"ph\":\"X\"") != NUM_THREADS * NUM_SPANS * 4) {
+      printf("%u spans written\n", count(text, "\"ph\":\"X\""));
+      failed = 1;
+   }
+
+   if (!strstr(text, "\"name\":\"inherited\",\"ph\":\"X\",\"pid\":1") ||
+       count(text, "\"shader\":\"00001063\"") != NUM_THREADS * 2 ||
+       count(text, "\"shader\":\"00002063\"") != NUM_THREADS * 2) {
+      printf("wrong shader ids\n");
+      failed = 1;
+   }
+
+   if (!strstr(text, "\"dropped\":0}")) {
+      printf("spans dropped\n");
+      failed = 1;
+   }
+
+   free(text);
+
+   printf("u_trace_test %s\n", failed ? "failed" : "passed");
+
+   return failed;
+}
@@ -216,7 +216,7 @@ class Screen(Dispatcher):
     def fence_reference(self, dst, src):
         pass
     
-    def flush_frontbuffer(self, resource):
+    def flush_frontbuffer(self, resource, level=0, layer=0, sub_box=None):
         pass
 
 
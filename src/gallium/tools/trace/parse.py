@@ -28,6 +28,8 @@
 
 
 import sys
+import struct
+import binascii
 import xml.parsers.expat
 import optparse
 
@@ -187,13 +189,174 @@ class XmlParser:
         return data
 
 
+# Binary trace encoding, see src/gallium/drivers/trace/tr_dump_binary.h
+BINARY_MAGIC = b'GTRACEB\n'
+BINARY_VERSION = 1
+
+(BINARY_CALL_BEGIN, BINARY_CALL_END, BINARY_ARG, BINARY_RET) = range(0x01, 0x05)
+
+(BINARY_NULL, BINARY_BOOL, BINARY_INT, BINARY_UINT, BINARY_FLOAT,
+ BINARY_STRING, BINARY_ENUM, BINARY_BYTES, BINARY_PTR,
+ BINARY_ARRAY_BEGIN, BINARY_ARRAY_END,
+ BINARY_STRUCT_BEGIN, BINARY_STRUCT_END, BINARY_MEMBER) = range(0x10, 0x1e)
+
+
+def lz4_decompress(src, size):
+    '''Decompress a single LZ4 block.'''
+
+    src = bytearray(src)
+    dst = bytearray()
+    end = len(src)
+    i = 0
+    while i < end:
+        token = src[i]
+        i += 1
+
+        length = token >> 4
+        if length == 15:
+            while True:
+                byte = src[i]
+                i += 1
+                length += byte
+                if byte != 255:
+                    break
+        dst += src[i:i + length]
+        i += length
+        if i >= end:
+            break
+
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                byte = src[i]
+                i += 1
+                length += byte
+                if byte != 255:
+                    break
+        length += 4
+
+        start = len(dst) - offset
+        if offset >= length:
+            dst += dst[start:start + length]
+        else:
+            for j in range(length):
+                dst.append(dst[start + j])
+
+    if len(dst) != size:
+        raise ValueError('corrupt compressed chunk')
+    return dst
+
+
+class BinaryReader:
+    '''Reads the values of a binary trace, chunk by chunk.'''
+
+    def __init__(self, fp):
+        self.fp = fp
+        self.buf = bytearray()
+        self.pos = 0
+        self.names = []
+
+        version, = struct.unpack('<I', self.fp.read(4))
+        if version != BINARY_VERSION:
+            raise ValueError('unsupported binary trace version %u' % version)
+
+    def fill(self, size):
+        while len(self.buf) - self.pos < size:
+            header = self.fp.read(8)
+            if len(header) < 8:
+                return False
+            raw_size, compressed_size = struct.unpack('<II', header)
+            if compressed_size:
+                data = self.fp.read(compressed_size)
+                if len(data) < compressed_size:
+                    return False
+                data = lz4_decompress(data, raw_size)
+            else:
+                data = bytearray(self.fp.read(raw_size))
+            del self.buf[:self.pos]
+            self.pos = 0
+            self.buf += data
+        return True
+
+    def op(self):
+        '''Next opcode, or None at the end of the trace.'''
+        if not self.fill(1):
+            return None
+        op = self.buf[self.pos]
+        self.pos += 1
+        return op
+
+    def read(self, size):
+        if not self.fill(size):
+            raise EOFError
+        data = bytes(self.buf[self.pos:self.pos + size])
+        self.pos += size
+        return data
+
+    def uint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.op()
+            if byte is None:
+                raise EOFError
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if byte < 0x80:
+                return value
+
+    def sint(self):
+        value = self.uint()
+        return (value >> 1) ^ -(value & 1)
+
+    def double(self):
+        return struct.unpack('<d', self.read(8))[0]
+
+    def data(self):
+        return self.read(self.uint())
+
+    def string(self):
+        # The XML writer escapes each non-ASCII byte as a character reference
+        return self.data().decode('latin-1')
+
+    def name(self):
+        ref = self.uint()
+        if ref == 0:
+            self.names.append(self.string())
+            return self.names[-1]
+        return self.names[ref - 1]
+
+
+class PrefixedFile:
+    '''File object giving back the bytes already read to sniff the format.'''
+
+    def __init__(self, prefix, fp):
+        self.prefix = prefix
+        self.fp = fp
+
+    def read(self, size):
+        prefix = self.prefix
+        self.prefix = b''
+        return prefix + self.fp.read(size - len(prefix))
+
+
 class TraceParser(XmlParser):
 
     def __init__(self, fp):
-        XmlParser.__init__(self, fp)
+        magic = fp.read(len(BINARY_MAGIC))
+        if magic == BINARY_MAGIC:
+            self.reader = BinaryReader(fp)
+        else:
+            self.reader = None
+            XmlParser.__init__(self, PrefixedFile(magic, fp))
         self.last_call_no = 0
     
     def parse(self):
+        if self.reader is not None:
+            self.parse_binary()
+            return
         self.element_start('trace')
         while self.token.type not in (ELEMENT_END, EOF):
             call = self.parse_call()
@@ -346,6 +509,93 @@ class TraceParser(XmlParser):
 
         return Pointer(address)
 
+    def parse_binary(self):
+        try:
+            while True:
+                op = self.reader.op()
+                if op is None:
+                    break
+                if op != BINARY_CALL_BEGIN:
+                    raise ValueError('call expected, opcode 0x%02x found' % op)
+                call = self.parse_binary_call()
+                self.handle_call(call)
+        except EOFError:
+            # truncated trace, e.g. the application crashed
+            pass
+
+    def parse_binary_call(self):
+        reader = self.reader
+        no = reader.uint()
+        klass = reader.name()
+        method = reader.name()
+        self.last_call_no = no
+        args = []
+        ret = None
+        time = None
+        while True:
+            op = reader.op()
+            if op == BINARY_ARG:
+                name = reader.name()
+                args.append((name, self.parse_binary_value(reader.op())))
+            elif op == BINARY_RET:
+                ret = self.parse_binary_value(reader.op())
+            elif op == BINARY_CALL_BEGIN:
+                # ignore nested function calls
+                self.parse_binary_call()
+            elif op == BINARY_CALL_END:
+                time = Literal(reader.sint())
+                break
+            elif op is None:
+                raise EOFError
+            else:
+                raise ValueError('argument expected, opcode 0x%02x found' % op)
+
+        return Call(no, klass, method, args, ret, time)
+
+    def parse_binary_value(self, op):
+        reader = self.reader
+        if op == BINARY_NULL:
+            return Literal(None)
+        if op == BINARY_BOOL:
+            return Literal(reader.uint())
+        if op == BINARY_INT:
+            return Literal(reader.sint())
+        if op == BINARY_UINT:
+            return Literal(reader.uint())
+        if op == BINARY_FLOAT:
+            return Literal(reader.double())
+        if op == BINARY_STRING:
+            return Literal(reader.string())
+        if op == BINARY_ENUM:
+            return NamedConstant(reader.name())
+        if op == BINARY_BYTES:
+            return Blob(binascii.b2a_hex(reader.data()))
+        if op == BINARY_PTR:
+            return Pointer('0x%08x' % reader.uint())
+        if op == BINARY_ARRAY_BEGIN:
+            elems = []
+            while True:
+                op = reader.op()
+                if op == BINARY_ARRAY_END:
+                    break
+                elems.append(self.parse_binary_value(op))
+            return Array(elems)
+        if op == BINARY_STRUCT_BEGIN:
+            name = reader.name()
+            members = []
+            while True:
+                op = reader.op()
+                if op == BINARY_STRUCT_END:
+                    break
+                if op != BINARY_MEMBER:
+                    raise ValueError('member expected, opcode %r found' % op)
+                member = reader.name()
+                members.append((member, self.parse_binary_value(reader.op())))
+            return Struct(name, members)
+        if op is None:
+            raise EOFError
+        raise ValueError('value expected, opcode %r found' % op)
+
     def handle_call(self, call):
         pass
     
@@ -378,12 +628,12 @@ class Main:
         for arg in args:
             if arg.endswith('.gz'):
                 from gzip import GzipFile
-                stream = GzipFile(arg, 'rt')
+                stream = GzipFile(arg, 'rb')
             elif arg.endswith('.bz2'):
                 from bz2 import BZ2File
-                stream = BZ2File(arg, 'rU')
+                stream = BZ2File(arg, 'rb')
             else:
-                stream = open(arg, 'rt')
+                stream = open(arg, 'rb')
             self.process_arg(stream, options)
 
     def get_optparser(self):
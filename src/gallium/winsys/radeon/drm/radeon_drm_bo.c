@@ -666,18 +666,6 @@ static void radeon_bomgr_destroy(struct pb_manager *_mgr)
     FREE(mgr);
 }
 
-#define PTR_TO_UINT(x) ((unsigned)((intptr_t)(x)))
-
-static unsigned handle_hash(void *key)
-{
-    return PTR_TO_UINT(key);
-}
-
-static int handle_compare(void *key1, void *key2)
-{
-    return PTR_TO_UINT(key1) != PTR_TO_UINT(key2);
-}
-
 struct pb_manager *radeon_bomgr_create(struct radeon_drm_winsys *rws)
 {
     struct radeon_bomgr *mgr;
@@ -692,7 +680,7 @@ struct pb_manager *radeon_bomgr_create(struct radeon_drm_winsys *rws)
     mgr->base.is_buffer_busy = radeon_bomgr_is_buffer_busy;
 
     mgr->rws = rws;
-    mgr->bo_handles = util_hash_table_create(handle_hash, handle_compare);
+    mgr->bo_handles = util_hash_table_create_ptr_keys();
     pipe_mutex_init(mgr->bo_handles_mutex);
     pipe_mutex_init(mgr->bo_va_mutex);
 
@@ -65,6 +65,7 @@
 #include "radeon_drm_cs.h"
 
 #include "util/u_memory.h"
+#include "os/os_time.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -106,9 +107,10 @@
 #define RELOC_DWORDS (sizeof(struct drm_radeon_cs_reloc) / sizeof(uint32_t))
 
 static boolean radeon_init_cs_context(struct radeon_cs_context *csc,
-                                      struct radeon_drm_winsys *ws)
+                                      struct radeon_drm_cs *cs)
 {
-    csc->fd = ws->fd;
+    csc->owner = cs;
+    csc->fd = cs->ws->fd;
     csc->nrelocs = 512;
     csc->relocs_bo = (struct radeon_bo**)
                      CALLOC(1, csc->nrelocs * sizeof(struct radeon_bo*));
@@ -173,29 +175,31 @@ static struct radeon_winsys_cs *radeon_drm_cs_create(struct radeon_winsys *rws,
 {
     struct radeon_drm_winsys *ws = radeon_drm_winsys(rws);
     struct radeon_drm_cs *cs;
+    unsigned i;
 
     cs = CALLOC_STRUCT(radeon_drm_cs);
     if (!cs) {
         return NULL;
     }
-    pipe_semaphore_init(&cs->flush_completed, 1);
 
     cs->ws = ws;
     cs->trace_buf = (struct radeon_bo*)trace_buf;
 
-    if (!radeon_init_cs_context(&cs->csc1, cs->ws)) {
-        FREE(cs);
-        return NULL;
-    }
-    if (!radeon_init_cs_context(&cs->csc2, cs->ws)) {
-        radeon_destroy_cs_context(&cs->csc1);
-        FREE(cs);
-        return NULL;
+    for (i = 0; i < RADEON_CS_QUEUE_DEPTH; i++) {
+        if (!radeon_init_cs_context(&cs->csc_ring[i], cs)) {
+            while (i--)
+                radeon_destroy_cs_context(&cs->csc_ring[i]);
+            FREE(cs);
+            return NULL;
+        }
     }
 
+    pipe_mutex_init(cs->flush_mutex);
+    pipe_condvar_init(cs->flush_completed);
+
     /* Set the first command buffer as current. */
-    cs->csc = &cs->csc1;
-    cs->cst = &cs->csc2;
+    cs->csc_index = 0;
+    cs->csc = &cs->csc_ring[0];
     cs->base.buf = cs->csc->buf;
     cs->base.ring_type = ring_type;
 
@@ -301,10 +305,12 @@ static unsigned radeon_add_reloc(struct radeon_drm_cs *cs,
         }
     }
 
-    /* New relocation, check if the backing array is large enough. */
+    /* New relocation, check if the backing array is large enough.
+     * The arrays are kept across flushes, so grow them geometrically and
+     * each context soon stops reallocating at all. */
     if (csc->crelocs >= csc->nrelocs) {
         uint32_t size;
-        csc->nrelocs += 10;
+        csc->nrelocs *= 2;
 
         size = csc->nrelocs * sizeof(struct radeon_bo*);
         csc->relocs_bo = realloc(csc->relocs_bo, size);
@@ -419,9 +425,14 @@ static void radeon_drm_cs_write_reloc(struct radeon_winsys_cs *rcs,
 void radeon_drm_cs_emit_ioctl_oneshot(struct radeon_drm_cs *cs, struct radeon_cs_context *csc)
 {
     unsigned i;
+    uint64_t time = os_time_get_nano();
+    int r;
+
+    r = drmCommandWriteRead(csc->fd, DRM_RADEON_CS,
+                            &csc->cs, sizeof(struct drm_radeon_cs));
+    cs->ws->cs_ioctl_time += os_time_get_nano() - time;
 
-    if (drmCommandWriteRead(csc->fd, DRM_RADEON_CS,
-                            &csc->cs, sizeof(struct drm_radeon_cs))) {
+    if (r) {
         if (debug_get_bool_option("RADEON_DUMP_CS", FALSE)) {
             unsigned i;
 
@@ -445,6 +456,36 @@ void radeon_drm_cs_emit_ioctl_oneshot(struct radeon_drm_cs *cs, struct radeon_cs
     radeon_cs_context_cleanup(csc);
 }
 
+/*
+ * Called by the submission thread once it is done with a CS context.
+ */
+void radeon_drm_cs_flush_completed(struct radeon_drm_cs *cs)
+{
+    pipe_mutex_lock(cs->flush_mutex);
+    assert(cs->num_in_flight);
+    cs->num_in_flight--;
+    pipe_condvar_broadcast(cs->flush_completed);
+    pipe_mutex_unlock(cs->flush_mutex);
+}
+
+/*
+ * Wait until at most max_in_flight submissions of this cs are pending.
+ */
+static void radeon_drm_cs_wait_in_flight(struct radeon_drm_cs *cs,
+                                         unsigned max_in_flight)
+{
+    pipe_mutex_lock(cs->flush_mutex);
+    if (cs->num_in_flight > max_in_flight) {
+        uint64_t time = os_time_get_nano();
+
+        while (cs->num_in_flight > max_in_flight)
+            pipe_condvar_wait(cs->flush_completed, cs->flush_mutex);
+
+        cs->ws->cs_wait_time += os_time_get_nano() - time;
+    }
+    pipe_mutex_unlock(cs->flush_mutex);
+}
+
 /*
  * Make sure previous submission of this cs are completed
  */
@@ -454,8 +495,7 @@ void radeon_drm_cs_sync_flush(struct radeon_winsys_cs *rcs)
 
     /* Wait for any pending ioctl to complete. */
     if (cs->ws->thread) {
-        pipe_semaphore_wait(&cs->flush_completed);
-        pipe_semaphore_signal(&cs->flush_completed);
+        radeon_drm_cs_wait_in_flight(cs, 0);
     }
 }
 
@@ -464,7 +504,7 @@ DEBUG_GET_ONCE_BOOL_OPTION(noop, "RADEON_NOOP", FALSE)
 static void radeon_drm_cs_flush(struct radeon_winsys_cs *rcs, unsigned flags, uint32_t cs_trace_id)
 {
     struct radeon_drm_cs *cs = radeon_drm_cs(rcs);
-    struct radeon_cs_context *tmp;
+    struct radeon_cs_context *csc = cs->csc;
 
     switch (cs->base.ring_type) {
     case RING_DMA:
@@ -506,76 +546,78 @@ static void radeon_drm_cs_flush(struct radeon_winsys_cs *rcs, unsigned flags, ui
        fprintf(stderr, "radeon: command stream overflowed\n");
     }
 
-    radeon_drm_cs_sync_flush(rcs);
-
-    /* Flip command streams. */
-    tmp = cs->csc;
-    cs->csc = cs->cst;
-    cs->cst = tmp;
-
-    cs->cst->cs_trace_id = cs_trace_id;
+    csc->cs_trace_id = cs_trace_id;
 
     /* If the CS is not empty or overflowed, emit it in a separate thread. */
     if (cs->base.cdw && cs->base.cdw <= RADEON_MAX_CMDBUF_DWORDS && !debug_get_option_noop()) {
-        unsigned i, crelocs = cs->cst->crelocs;
+        unsigned i, crelocs = csc->crelocs;
 
-        cs->cst->chunks[0].length_dw = cs->base.cdw;
+        csc->chunks[0].length_dw = cs->base.cdw;
 
         for (i = 0; i < crelocs; i++) {
             /* Update the number of active asynchronous CS ioctls for the buffer. */
-            p_atomic_inc(&cs->cst->relocs_bo[i]->num_active_ioctls);
+            p_atomic_inc(&csc->relocs_bo[i]->num_active_ioctls);
         }
 
         switch (cs->base.ring_type) {
         case RING_DMA:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_DMA;
-            cs->cst->cs.num_chunks = 3;
+            csc->flags[0] = 0;
+            csc->flags[1] = RADEON_CS_RING_DMA;
+            csc->cs.num_chunks = 3;
             if (cs->ws->info.r600_virtual_address) {
-                cs->cst->flags[0] |= RADEON_CS_USE_VM;
+                csc->flags[0] |= RADEON_CS_USE_VM;
             }
             break;
 
         case RING_UVD:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_UVD;
-            cs->cst->cs.num_chunks = 3;
+            csc->flags[0] = 0;
+            csc->flags[1] = RADEON_CS_RING_UVD;
+            csc->cs.num_chunks = 3;
             break;
 
         default:
         case RING_GFX:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_GFX;
-            cs->cst->cs.num_chunks = 2;
+            csc->flags[0] = 0;
+            csc->flags[1] = RADEON_CS_RING_GFX;
+            csc->cs.num_chunks = 2;
             if (flags & RADEON_FLUSH_KEEP_TILING_FLAGS) {
-                cs->cst->flags[0] |= RADEON_CS_KEEP_TILING_FLAGS;
-                cs->cst->cs.num_chunks = 3;
+                csc->flags[0] |= RADEON_CS_KEEP_TILING_FLAGS;
+                csc->cs.num_chunks = 3;
             }
             if (cs->ws->info.r600_virtual_address) {
-                cs->cst->flags[0] |= RADEON_CS_USE_VM;
-                cs->cst->cs.num_chunks = 3;
+                csc->flags[0] |= RADEON_CS_USE_VM;
+                csc->cs.num_chunks = 3;
             }
             if (flags & RADEON_FLUSH_END_OF_FRAME) {
-                cs->cst->flags[0] |= RADEON_CS_END_OF_FRAME;
-                cs->cst->cs.num_chunks = 3;
+                csc->flags[0] |= RADEON_CS_END_OF_FRAME;
+                csc->cs.num_chunks = 3;
             }
             if (flags & RADEON_FLUSH_COMPUTE) {
-                cs->cst->flags[1] = RADEON_CS_RING_COMPUTE;
-                cs->cst->cs.num_chunks = 3;
+                csc->flags[1] = RADEON_CS_RING_COMPUTE;
+                csc->cs.num_chunks = 3;
             }
             break;
         }
 
         if (cs->ws->thread) {
-            pipe_semaphore_wait(&cs->flush_completed);
-            radeon_drm_ws_queue_cs(cs->ws, cs);
+            pipe_mutex_lock(cs->flush_mutex);
+            cs->num_in_flight++;
+            pipe_mutex_unlock(cs->flush_mutex);
+
+            radeon_drm_ws_queue_cs(cs->ws, csc);
+
+            /* The next context must be free before we start filling it. */
+            radeon_drm_cs_wait_in_flight(cs, RADEON_CS_QUEUE_DEPTH - 1);
+            cs->csc_index = (cs->csc_index + 1) % RADEON_CS_QUEUE_DEPTH;
+            cs->csc = &cs->csc_ring[cs->csc_index];
+
             if (!(flags & RADEON_FLUSH_ASYNC))
                 radeon_drm_cs_sync_flush(rcs);
         } else {
-            radeon_drm_cs_emit_ioctl_oneshot(cs, cs->cst);
+            radeon_drm_cs_emit_ioctl_oneshot(cs, csc);
         }
     } else {
-        radeon_cs_context_cleanup(cs->cst);
+        radeon_cs_context_cleanup(csc);
     }
 
     /* Prepare a new CS. */
@@ -586,14 +628,14 @@ static void radeon_drm_cs_flush(struct radeon_winsys_cs *rcs, unsigned flags, ui
 static void radeon_drm_cs_destroy(struct radeon_winsys_cs *rcs)
 {
     struct radeon_drm_cs *cs = radeon_drm_cs(rcs);
+    unsigned i;
 
     radeon_drm_cs_sync_flush(rcs);
-    pipe_semaphore_destroy(&cs->flush_completed);
-    radeon_cs_context_cleanup(&cs->csc1);
-    radeon_cs_context_cleanup(&cs->csc2);
+    pipe_condvar_destroy(cs->flush_completed);
+    pipe_mutex_destroy(cs->flush_mutex);
     p_atomic_dec(&cs->ws->num_cs);
-    radeon_destroy_cs_context(&cs->csc1);
-    radeon_destroy_cs_context(&cs->csc2);
+    for (i = 0; i < RADEON_CS_QUEUE_DEPTH; i++)
+        radeon_destroy_cs_context(&cs->csc_ring[i]);
     FREE(cs);
 }
 
@@ -30,9 +30,16 @@
 #include "radeon_drm_bo.h"
 #include <radeon_drm.h>
 
+/* Number of CS contexts of each radeon_drm_cs: one being filled by the
+ * pipe driver, the others queued for the kernel. */
+#define RADEON_CS_QUEUE_DEPTH 4
+
+struct radeon_drm_cs;
+
 struct radeon_cs_context {
     uint32_t                    buf[RADEON_MAX_CMDBUF_DWORDS];
 
+    struct radeon_drm_cs        *owner;
     int                         fd;
     struct drm_radeon_cs        cs;
     struct drm_radeon_cs_chunk  chunks[3];
@@ -59,15 +66,14 @@ struct radeon_cs_context {
 struct radeon_drm_cs {
     struct radeon_winsys_cs base;
 
-    /* We flip between these two CS. While one is being consumed
-     * by the kernel in another thread, the other one is being filled
-     * by the pipe driver. */
-    struct radeon_cs_context csc1;
-    struct radeon_cs_context csc2;
+    /* We cycle through these CS. While some are queued for or being
+     * consumed by the kernel in the submission thread, the next one is
+     * being filled by the pipe driver. The thread submits them in order,
+     * so they come back in order too. */
+    struct radeon_cs_context csc_ring[RADEON_CS_QUEUE_DEPTH];
+    unsigned csc_index;
     /* The currently-used CS. */
     struct radeon_cs_context *csc;
-    /* The CS being currently-owned by the other thread. */
-    struct radeon_cs_context *cst;
 
     /* The winsys. */
     struct radeon_drm_winsys *ws;
@@ -76,7 +82,11 @@ struct radeon_drm_cs {
     void (*flush_cs)(void *ctx, unsigned flags);
     void *flush_data;
 
-    pipe_semaphore flush_completed;
+    /* Number of CS owned by the submission thread. */
+    pipe_mutex flush_mutex;
+    pipe_condvar flush_completed;
+    unsigned num_in_flight;
+
     struct radeon_bo                    *trace_buf;
 };
 
@@ -120,6 +130,7 @@ radeon_bo_is_referenced_by_any_cs(struct radeon_bo *bo)
 }
 
 void radeon_drm_cs_sync_flush(struct radeon_winsys_cs *rcs);
+void radeon_drm_cs_flush_completed(struct radeon_drm_cs *cs);
 void radeon_drm_cs_init_functions(struct radeon_drm_winsys *ws);
 void radeon_drm_cs_emit_ioctl_oneshot(struct radeon_drm_cs *cs, struct radeon_cs_context *csc);
 
@@ -430,6 +430,7 @@ static void radeon_winsys_destroy(struct radeon_winsys *rws)
         pipe_thread_wait(ws->thread);
     }
     pipe_semaphore_destroy(&ws->cs_queued);
+    pipe_semaphore_destroy(&ws->cs_queue_space);
 
     pipe_mutex_destroy(ws->hyperz_owner_mutex);
     pipe_mutex_destroy(ws->cmask_owner_mutex);
@@ -494,6 +495,7 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
                                    enum radeon_value_id value)
 {
     struct radeon_drm_winsys *ws = (struct radeon_drm_winsys*)rws;
+    struct pb_cache_stats stats;
     uint64_t ts = 0;
 
     switch (value) {
@@ -512,6 +514,19 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
         radeon_get_drm_value(ws->fd, RADEON_INFO_TIMESTAMP, "timestamp",
                              (uint32_t*)&ts);
         return ts;
+    case RADEON_BUFFER_CACHE_HITS:
+        pb_cache_manager_get_stats(ws->cman, &stats);
+        return stats.hits;
+    case RADEON_BUFFER_CACHE_MISSES:
+        pb_cache_manager_get_stats(ws->cman, &stats);
+        return stats.misses;
+    case RADEON_BUFFER_CACHE_BYTES:
+        pb_cache_manager_get_stats(ws->cman, &stats);
+        return stats.bytes;
+    case RADEON_CS_IOCTL_TIME_NS:
+        return ws->cs_ioctl_time;
+    case RADEON_CS_WAIT_TIME_NS:
+        return ws->cs_wait_time;
     }
     return 0;
 }
@@ -538,61 +553,56 @@ static int compare_fd(void *key1, void *key2)
            stat1.st_rdev != stat2.st_rdev;
 }
 
-void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws, struct radeon_drm_cs *cs)
+void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws,
+                            struct radeon_cs_context *csc)
 {
-retry:
+    /* Wait for room in the FIFO. */
+    pipe_semaphore_wait(&ws->cs_queue_space);
+
     pipe_mutex_lock(ws->cs_stack_lock);
-    if (p_atomic_read(&ws->ncs) >= RING_LAST) {
-        /* no room left for a flush */
-        pipe_mutex_unlock(ws->cs_stack_lock);
-        goto retry;
-    }
-    ws->cs_stack[p_atomic_read(&ws->ncs)] = cs;
-    p_atomic_inc(&ws->ncs);
+    ws->cs_queue[(ws->cs_queue_head + ws->ncs) % RADEON_MAX_QUEUED_CS] = csc;
+    ws->ncs++;
     pipe_mutex_unlock(ws->cs_stack_lock);
     pipe_semaphore_signal(&ws->cs_queued);
 }
 
+static struct radeon_cs_context *radeon_drm_ws_dequeue_cs(struct radeon_drm_winsys *ws)
+{
+    struct radeon_cs_context *csc = NULL;
+
+    pipe_mutex_lock(ws->cs_stack_lock);
+    if (ws->ncs) {
+        csc = ws->cs_queue[ws->cs_queue_head];
+        ws->cs_queue[ws->cs_queue_head] = NULL;
+        ws->cs_queue_head = (ws->cs_queue_head + 1) % RADEON_MAX_QUEUED_CS;
+        ws->ncs--;
+    }
+    pipe_mutex_unlock(ws->cs_stack_lock);
+
+    if (csc)
+        pipe_semaphore_signal(&ws->cs_queue_space);
+    return csc;
+}
+
 static PIPE_THREAD_ROUTINE(radeon_drm_cs_emit_ioctl, param)
 {
     struct radeon_drm_winsys *ws = (struct radeon_drm_winsys *)param;
-    struct radeon_drm_cs *cs;
-    unsigned i, empty_stack;
+    struct radeon_cs_context *csc;
 
     while (1) {
         pipe_semaphore_wait(&ws->cs_queued);
         if (ws->kill_thread)
             break;
-next:
-        pipe_mutex_lock(ws->cs_stack_lock);
-        cs = ws->cs_stack[0];
-        pipe_mutex_unlock(ws->cs_stack_lock);
-
-        if (cs) {
-            radeon_drm_cs_emit_ioctl_oneshot(cs, cs->cst);
-
-            pipe_mutex_lock(ws->cs_stack_lock);
-            for (i = 1; i < p_atomic_read(&ws->ncs); i++) {
-                ws->cs_stack[i - 1] = ws->cs_stack[i];
-            }
-            ws->cs_stack[p_atomic_read(&ws->ncs) - 1] = NULL;
-            empty_stack = p_atomic_dec_zero(&ws->ncs);
-            pipe_mutex_unlock(ws->cs_stack_lock);
-
-            pipe_semaphore_signal(&cs->flush_completed);
-
-            if (!empty_stack) {
-                goto next;
-            }
+
+        csc = radeon_drm_ws_dequeue_cs(ws);
+        if (csc) {
+            radeon_drm_cs_emit_ioctl_oneshot(csc->owner, csc);
+            radeon_drm_cs_flush_completed(csc->owner);
         }
     }
-    pipe_mutex_lock(ws->cs_stack_lock);
-    for (i = 0; i < p_atomic_read(&ws->ncs); i++) {
-        pipe_semaphore_signal(&ws->cs_stack[i]->flush_completed);
-        ws->cs_stack[i] = NULL;
-    }
-    p_atomic_set(&ws->ncs, 0);
-    pipe_mutex_unlock(ws->cs_stack_lock);
+
+    while ((csc = radeon_drm_ws_dequeue_cs(ws)))
+        radeon_drm_cs_flush_completed(csc->owner);
     return NULL;
 }
 
@@ -627,7 +637,10 @@ struct radeon_winsys *radeon_drm_winsys_create(int fd)
     ws->kman = radeon_bomgr_create(ws);
     if (!ws->kman)
         goto fail;
-    ws->cman = pb_cache_manager_create(ws->kman, 1000000);
+    /* Don't keep more than 1/8 of the memory in idle buffers. */
+    ws->cman = pb_cache_manager_create(ws->kman, 1000000,
+                                       ((uint64_t)ws->info.vram_size +
+                                        ws->info.gart_size) / 8);
     if (!ws->cman)
         goto fail;
 
@@ -655,8 +668,10 @@ struct radeon_winsys *radeon_drm_winsys_create(int fd)
     pipe_mutex_init(ws->cmask_owner_mutex);
     pipe_mutex_init(ws->cs_stack_lock);
 
-    p_atomic_set(&ws->ncs, 0);
+    ws->ncs = 0;
+    ws->cs_queue_head = 0;
     pipe_semaphore_init(&ws->cs_queued, 0);
+    pipe_semaphore_init(&ws->cs_queue_space, RADEON_MAX_QUEUED_CS);
     if (ws->num_cpus > 1 && debug_get_option_thread())
         ws->thread = pipe_thread_create(radeon_drm_cs_emit_ioctl, ws);
 
@@ -34,6 +34,9 @@
 #include "os/os_thread.h"
 
 struct radeon_drm_cs;
+struct radeon_cs_context;
+
+#define RADEON_MAX_QUEUED_CS 32
 
 enum radeon_generation {
     DRV_R300,
@@ -49,6 +52,8 @@ struct radeon_drm_winsys {
     uint64_t allocated_vram;
     uint64_t allocated_gtt;
     uint64_t buffer_wait_time; /* time spent in buffer_wait in ns */
+    uint64_t cs_ioctl_time; /* time spent in the CS ioctl in ns */
+    uint64_t cs_wait_time; /* time spent waiting for queued CS in ns */
 
     enum radeon_generation gen;
     struct radeon_info info;
@@ -64,13 +69,15 @@ struct radeon_drm_winsys {
     struct radeon_drm_cs *cmask_owner;
     pipe_mutex cmask_owner_mutex;
 
-    /* rings submission thread */
+    /* rings submission thread, with a FIFO of the CS to submit */
     pipe_mutex cs_stack_lock;
     pipe_semaphore cs_queued;
+    pipe_semaphore cs_queue_space;
     pipe_thread thread;
     int kill_thread;
     int ncs;
-    struct radeon_drm_cs *cs_stack[RING_LAST];
+    unsigned cs_queue_head;
+    struct radeon_cs_context *cs_queue[RADEON_MAX_QUEUED_CS];
 };
 
 static INLINE struct radeon_drm_winsys *
@@ -79,6 +86,7 @@ radeon_drm_winsys(struct radeon_winsys *base)
     return (struct radeon_drm_winsys*)base;
 }
 
-void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws, struct radeon_drm_cs *cs);
+void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws,
+                            struct radeon_cs_context *csc);
 
 #endif
@@ -155,7 +155,12 @@ enum radeon_value_id {
     RADEON_REQUESTED_VRAM_MEMORY,
     RADEON_REQUESTED_GTT_MEMORY,
     RADEON_BUFFER_WAIT_TIME_NS,
-    RADEON_TIMESTAMP
+    RADEON_TIMESTAMP,
+    RADEON_BUFFER_CACHE_HITS,
+    RADEON_BUFFER_CACHE_MISSES,
+    RADEON_BUFFER_CACHE_BYTES,
+    RADEON_CS_IOCTL_TIME_NS,
+    RADEON_CS_WAIT_TIME_NS
 };
 
 struct winsys_handle;
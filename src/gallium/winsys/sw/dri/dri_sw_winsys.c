@@ -36,6 +36,9 @@
 #include "state_tracker/sw_winsys.h"
 #include "dri_sw_winsys.h"
 
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
 
 struct dri_sw_displaytarget
 {
@@ -46,6 +49,9 @@ struct dri_sw_displaytarget
 
    void *data;
    void *mapped;
+
+   /** SysV shared memory segment holding data, or -1 */
+   int shmid;
 };
 
 struct dri_sw_winsys
@@ -77,6 +83,34 @@ dri_sw_is_displaytarget_format_supported( struct sw_winsys *ws,
    return TRUE;
 }
 
+/**
+ * Allocate the storage in shared memory, which the loader can give to the
+ * X server as is.
+ */
+static void *
+alloc_shm(struct dri_sw_displaytarget *dri_sw_dt, unsigned size)
+{
+   void *addr;
+
+   dri_sw_dt->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT|0777);
+   if (dri_sw_dt->shmid < 0)
+      return NULL;
+
+   addr = shmat(dri_sw_dt->shmid, NULL, 0);
+
+   /* Mark the segment for deletion right away, so that it doesn't outlive
+    * the process.  It stays usable until the last detach.
+    */
+   shmctl(dri_sw_dt->shmid, IPC_RMID, NULL);
+
+   if (addr == (void *) -1) {
+      dri_sw_dt->shmid = -1;
+      return NULL;
+   }
+
+   return addr;
+}
+
 static struct sw_displaytarget *
 dri_sw_displaytarget_create(struct sw_winsys *winsys,
                             unsigned tex_usage,
@@ -102,9 +136,15 @@ dri_sw_displaytarget_create(struct sw_winsys *winsys,
    nblocksy = util_format_get_nblocksy(format, height);
    size = dri_sw_dt->stride * nblocksy;
 
-   dri_sw_dt->data = align_malloc(size, alignment);
-   if(!dri_sw_dt->data)
-      goto no_data;
+   dri_sw_dt->shmid = -1;
+   if (dri_sw_winsys(winsys)->lf->put_image_shm)
+      dri_sw_dt->data = alloc_shm(dri_sw_dt, size);
+
+   if (!dri_sw_dt->data) {
+      dri_sw_dt->data = align_malloc(size, alignment);
+      if(!dri_sw_dt->data)
+         goto no_data;
+   }
 
    *stride = dri_sw_dt->stride;
    return (struct sw_displaytarget *)dri_sw_dt;
@@ -121,7 +161,10 @@ dri_sw_displaytarget_destroy(struct sw_winsys *ws,
 {
    struct dri_sw_displaytarget *dri_sw_dt = dri_sw_displaytarget(dt);
 
-   FREE(dri_sw_dt->data);
+   if (dri_sw_dt->shmid >= 0)
+      shmdt(dri_sw_dt->data);
+   else
+      align_free(dri_sw_dt->data);
 
    FREE(dri_sw_dt);
 }
@@ -166,7 +209,8 @@ dri_sw_displaytarget_get_handle(struct sw_winsys *winsys,
 static void
 dri_sw_displaytarget_display(struct sw_winsys *ws,
                              struct sw_displaytarget *dt,
-                             void *context_private)
+                             void *context_private,
+                             struct pipe_box *box)
 {
    struct dri_sw_winsys *dri_sw_ws = dri_sw_winsys(ws);
    struct dri_sw_displaytarget *dri_sw_dt = dri_sw_displaytarget(dt);
@@ -181,6 +225,13 @@ dri_sw_displaytarget_display(struct sw_winsys *ws,
 
    height = dri_sw_dt->height;
 
+   if (dri_sw_dt->shmid >= 0) {
+      dri_sw_ws->lf->put_image_shm(dri_drawable, dri_sw_dt->shmid,
+                                   dri_sw_dt->data, 0,
+                                   width, height, dri_sw_dt->stride);
+      return;
+   }
+
    dri_sw_ws->lf->put_image(dri_drawable, dri_sw_dt->data, width, height);
 }
 
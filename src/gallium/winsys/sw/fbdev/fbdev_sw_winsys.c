@@ -30,6 +30,7 @@
 #include <linux/fb.h>
 
 #include "pipe/p_compiler.h"
+#include "pipe/p_state.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -74,13 +75,14 @@ fbdev_sw_winsys(struct sw_winsys *ws)
 static void
 fbdev_displaytarget_display(struct sw_winsys *ws,
                             struct sw_displaytarget *dt,
-                            void *winsys_private)
+                            void *winsys_private,
+                            struct pipe_box *box)
 {
    struct fbdev_sw_winsys *fbdev = fbdev_sw_winsys(ws);
    struct fbdev_sw_displaytarget *src = fbdev_sw_displaytarget(dt);
    const struct fbdev_sw_drawable *dst =
       (const struct fbdev_sw_drawable *) winsys_private;
-   unsigned height, row_offset, row_len, i;
+   unsigned height, row_offset, row_len, first_row, col_offset, i;
    void *fbmem;
 
    /* FIXME format conversion */
@@ -108,14 +110,33 @@ fbdev_displaytarget_display(struct sw_winsys *ws,
       row_len = fbdev->stride - row_offset;
    }
 
+   /* only copy the damaged region */
+   first_row = 0;
+   col_offset = 0;
+   if (box) {
+      unsigned x0 = MAX2(box->x, 0), y0 = MAX2(box->y, 0);
+      unsigned x1 = MAX2(box->x + box->width, 0);
+      unsigned y1 = MAX2(box->y + box->height, 0);
+
+      col_offset = util_format_get_stride(dst->format, x0);
+      row_len = MIN2(util_format_get_stride(dst->format, x1), row_len);
+      height = MIN2(y1, height);
+      if (col_offset >= row_len || y0 >= height)
+         return;
+
+      row_len -= col_offset;
+      first_row = y0;
+   }
+
    fbmem = mmap(0, fbdev->finfo.smem_len,
          PROT_WRITE, MAP_SHARED, fbdev->fd, 0);
    if (fbmem == MAP_FAILED)
       return;
 
-   for (i = 0; i < height; i++) {
-      char *from = (char *) src->data + src->stride * i;
-      char *to = (char *) fbmem + fbdev->stride * (dst->y + i) + row_offset;
+   for (i = first_row; i < height; i++) {
+      char *from = (char *) src->data + src->stride * i + col_offset;
+      char *to = (char *) fbmem + fbdev->stride * (dst->y + i) +
+         row_offset + col_offset;
 
       memcpy(to, from, row_len);
    }
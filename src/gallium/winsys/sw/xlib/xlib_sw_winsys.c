@@ -34,6 +34,7 @@
 
 #include "pipe/p_format.h"
 #include "pipe/p_context.h"
+#include "pipe/p_state.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
@@ -289,17 +290,19 @@ xlib_displaytarget_destroy(struct sw_winsys *ws,
 
 /**
  * Display/copy the image in the surface into the X window specified
- * by the display target.
+ * by the display target.  Only the given box is copied, if there is one.
  */
 static void
 xlib_sw_display(struct xlib_drawable *xlib_drawable,
-                struct sw_displaytarget *dt)
+                struct sw_displaytarget *dt,
+                const struct pipe_box *box)
 {
    static boolean no_swap = 0;
    static boolean firsttime = 1;
    struct xlib_displaytarget *xlib_dt = xlib_displaytarget(dt);
    Display *display = xlib_dt->display;
    XImage *ximage;
+   int x = 0, y = 0, w = xlib_dt->width, h = xlib_dt->height;
 
    if (firsttime) {
       no_swap = getenv("SP_NO_RAST") != NULL;
@@ -309,6 +312,15 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
    if (no_swap)
       return;
 
+   if (box) {
+      x = MAX2(box->x, 0);
+      y = MAX2(box->y, 0);
+      w = MIN2(box->x + box->width, w) - x;
+      h = MIN2(box->y + box->height, h) - y;
+      if (w <= 0 || h <= 0)
+         return;
+   }
+
    if (xlib_dt->drawable != xlib_drawable->drawable) {
       if (xlib_dt->gc) {
          XFreeGC(display, xlib_dt->gc);
@@ -344,7 +356,7 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
 
       /* _debug_printf("XSHM\n"); */
       XShmPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
-                   ximage, 0, 0, 0, 0, xlib_dt->width, xlib_dt->height, False);
+                   ximage, x, y, x, y, w, h, False);
    }
    else {
       /* display image in Window */
@@ -362,7 +374,7 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
 
       /* _debug_printf("XPUT\n"); */
       XPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
-                ximage, 0, 0, 0, 0, xlib_dt->width, xlib_dt->height);
+                ximage, x, y, x, y, w, h);
    }
 
    XFlush(xlib_dt->display);
@@ -376,10 +388,11 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
 static void
 xlib_displaytarget_display(struct sw_winsys *ws,
                            struct sw_displaytarget *dt,
-                           void *context_private)
+                           void *context_private,
+                           struct pipe_box *box)
 {
    struct xlib_drawable *xlib_drawable = (struct xlib_drawable *)context_private;
-   xlib_sw_display(xlib_drawable, dt);
+   xlib_sw_display(xlib_drawable, dt, box);
 }
 
 
@@ -49,7 +49,8 @@ struct YYLTYPE;
  */
 class ast_node {
 public:
-   DECLARE_RALLOC_CXX_OPERATORS(ast_node);
+   /* Nodes are allocated from _mesa_glsl_parse_state::linalloc. */
+   DECLARE_LINEAR_ALLOC_CXX_OPERATORS(ast_node);
 
    /**
     * Print an AST node in something approximating the original GLSL code
@@ -57,6 +57,7 @@
 #include <stdio.h>
 #include "main/core.h" /* for struct gl_shader */
 #include "main/shaderobj.h"
+#include "glapi/glthread.h"
 #include "ir_builder.h"
 #include "glsl_parser_extras.h"
 #include "program/prog_instruction.h"
@@ -334,7 +335,9 @@ public:
    ~builtin_builder();
 
    void initialize();
-   void release();
+   void release(bool unused_only);
+   void hold(void *owner);
+   static void drop_hold(void *hold);
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
 
@@ -355,6 +358,8 @@ private:
 
    void create_shader();
    void create_builtins();
+   void initialize_locked();
+   void release_locked();
 
    /**
     * IR builder helpers:
@@ -573,6 +578,12 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     * that the "no matching signature" error will list potential candidates
     * from the available built-ins.
     */
+   /* Hold the library for the rest of the compile, in which the IR calls
+    * the signatures found.
+    */
+   if (state->num_builtins_to_link == 0)
+      hold(state);
+
    state->builtins_to_link[0] = shader;
    state->num_builtins_to_link = 1;
 
@@ -587,20 +598,35 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+/**
+ * Serializes construction and release of the built-in library.
+ *
+ * The library is built once per process and then shared read-only by every
+ * context and thread; only the first caller pays for create_builtins().
+ */
+_glthread_DECLARE_STATIC_MUTEX(builtins_mutex);
+
+/**
+ * Number of live holds on the library, see builtin_builder::hold().  A
+ * release asked for while there are some is done when the last one goes.
+ */
+static unsigned builtins_holds;
+static bool builtins_release_pending;
+
 void
-builtin_builder::initialize()
+builtin_builder::initialize_locked()
 {
    /* If already initialized, don't do it again. */
-   if (mem_ctx != NULL)
-      return;
-
-   mem_ctx = ralloc_context(NULL);
-   create_shader();
-   create_builtins();
+   if (mem_ctx == NULL) {
+      mem_ctx = ralloc_context(NULL);
+      create_shader();
+      create_builtins();
+   }
+   builtins_release_pending = false;
 }
 
 void
-builtin_builder::release()
+builtin_builder::release_locked()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
@@ -609,6 +635,49 @@ builtin_builder::release()
    shader = NULL;
 }
 
+void
+builtin_builder::initialize()
+{
+   _glthread_LOCK_MUTEX(builtins_mutex);
+   initialize_locked();
+   _glthread_UNLOCK_MUTEX(builtins_mutex);
+}
+
+/**
+ * Free the library.  With \c unused_only, as for glReleaseShaderCompiler(),
+ * wait until no compile or compiled shader holds it any more.
+ */
+void
+builtin_builder::release(bool unused_only)
+{
+   _glthread_LOCK_MUTEX(builtins_mutex);
+
+   if (unused_only && builtins_holds != 0)
+      builtins_release_pending = true;
+   else
+      release_locked();
+
+   _glthread_UNLOCK_MUTEX(builtins_mutex);
+}
+
+/**
+ * Keep the library alive as long as \c owner, a ralloc context holding IR
+ * which calls into it or links against it.  Builds the library if it was
+ * released, which a compile may do at any point before the hold.
+ */
+void
+builtin_builder::hold(void *owner)
+{
+   void *hold = ralloc_size(owner, 1);
+
+   _glthread_LOCK_MUTEX(builtins_mutex);
+   initialize_locked();
+   builtins_holds++;
+   _glthread_UNLOCK_MUTEX(builtins_mutex);
+
+   ralloc_set_destructor(hold, drop_hold);
+}
+
 void
 builtin_builder::create_shader()
 {
@@ -3800,6 +3869,19 @@ builtin_builder::_mulExtended(const glsl_type *type)
 /* The singleton instance of builtin_builder. */
 static builtin_builder builtins;
 
+void
+builtin_builder::drop_hold(void *hold)
+{
+   (void) hold;
+
+   _glthread_LOCK_MUTEX(builtins_mutex);
+   if (--builtins_holds == 0 && builtins_release_pending) {
+      builtins_release_pending = false;
+      builtins.release_locked();
+   }
+   _glthread_UNLOCK_MUTEX(builtins_mutex);
+}
+
 /**
  * External API (exposing the built-in module to the rest of the compiler):
  *  @{
@@ -3813,7 +3895,19 @@ _mesa_glsl_initialize_builtin_functions()
 void
 _mesa_glsl_release_builtin_functions()
 {
-   builtins.release();
+   builtins.release(false);
+}
+
+void
+_mesa_glsl_release_unused_builtin_functions()
+{
+   builtins.release(true);
+}
+
+void
+_mesa_glsl_hold_builtin_functions(void *owner)
+{
+   builtins.hold(owner);
 }
 
 ir_function_signature *
@@ -253,6 +253,7 @@ control_line:
 		if (macro) {
 			hash_table_remove (parser->defines, $2);
 			ralloc_free (macro);
+			parser->defines_generation++;
 		}
 		ralloc_free ($2);
 	}
@@ -745,7 +746,9 @@ _token_create_str (void *ctx, int type, char *str)
 {
 	token_t *token;
 
-	token = ralloc (ctx, token_t);
+	/* Zeroed so that tokens made during expansion have a defined,
+	 * if meaningless, location. */
+	token = rzalloc (ctx, token_t);
 	token->type = type;
 	token->value.str = str;
 
@@ -759,7 +762,7 @@ _token_create_ival (void *ctx, int type, int ival)
 {
 	token_t *token;
 
-	token = ralloc (ctx, token_t);
+	token = rzalloc (ctx, token_t);
 	token->type = type;
 	token->value.ival = ival;
 
@@ -1183,6 +1186,10 @@ glcpp_parser_create (const struct gl_extensions *extensions, int api)
 
 	parser->is_gles = false;
 
+	parser->expansion_memo = hash_table_ctor (32, hash_table_string_hash,
+						  hash_table_string_compare);
+	parser->defines_generation = 0;
+
 	/* Add pre-defined macros. */
 	if (api == API_OPENGLES2) {
            parser->is_gles = true;
@@ -1268,6 +1275,7 @@ glcpp_parser_destroy (glcpp_parser_t *parser)
 {
 	glcpp_lex_destroy (parser->scanner);
 	hash_table_dtor (parser->defines);
+	hash_table_dtor (parser->expansion_memo);
 	ralloc_free (parser);
 }
 
@@ -1449,6 +1457,109 @@ _glcpp_parser_apply_pastes (glcpp_parser_t *parser, token_list_t *list)
 	list->non_space_tail = list->tail;
 }
 
+typedef struct expansion_memo {
+	unsigned generation;
+	YYLTYPE location;	/* of the macro name that was expanded */
+	token_list_t *expansion;
+} expansion_memo_t;
+
+/* Build the expansion memo key for an invocation of the function-like
+ * macro 'identifier' with 'arguments', or return NULL if the expansion
+ * can't be reused.
+ *
+ * The expanded arguments only depend on the arguments themselves and the
+ * set of defined macros, except while another expansion is being
+ * rescanned (the active macros are not expanded again) and for __LINE__
+ * and __FILE__.
+ */
+static char *
+_expansion_memo_key (glcpp_parser_t *parser, const char *identifier,
+		     argument_list_t *arguments)
+{
+	argument_node_t *arg;
+	token_node_t *node;
+	char *key;
+	size_t len = 0;
+
+	if (parser->active)
+		return NULL;
+
+	key = ralloc_strdup (parser, identifier);
+	len = strlen (key);
+
+	for (arg = arguments->head; arg; arg = arg->next) {
+		ralloc_asprintf_rewrite_tail (&key, &len, "\x01");
+		for (node = arg->argument->head; node; node = node->next) {
+			token_t *token = node->token;
+
+			if (token->type == IDENTIFIER &&
+			    (strcmp (token->value.str, "__LINE__") == 0 ||
+			     strcmp (token->value.str, "__FILE__") == 0))
+			{
+				ralloc_free (key);
+				return NULL;
+			}
+
+			/* The token type matters, not just its text: an
+			 * OTHER is never expanded, a COMMA_FINAL never
+			 * separates arguments. */
+			ralloc_asprintf_rewrite_tail (&key, &len, "\x02%x:",
+						      token->type);
+			_token_print (&key, &len, token);
+		}
+	}
+
+	return key;
+}
+
+/* Return a copy of the memoized expansion for 'key', or NULL. */
+static token_list_t *
+_expansion_memo_find (glcpp_parser_t *parser, const char *key,
+		      token_node_t *node)
+{
+	expansion_memo_t *memo;
+	token_list_t *expansion;
+	token_node_t *n;
+
+	memo = hash_table_find (parser->expansion_memo, key);
+	if (memo == NULL || memo->generation != parser->defines_generation)
+		return NULL;
+
+	expansion = _token_list_copy (parser, memo->expansion);
+
+	/* Tokens that came from the arguments carry the location of the
+	 * invocation that filled the memo.  Move them to this one, so
+	 * that diagnostics from rescanning point at the right line. */
+	for (n = expansion->head; n; n = n->next) {
+		if (n->token->location.source == memo->location.source &&
+		    n->token->location.first_line == memo->location.first_line)
+			n->token->location = node->token->location;
+	}
+
+	return expansion;
+}
+
+static void
+_expansion_memo_store (glcpp_parser_t *parser, char *key,
+		       token_node_t *node, token_list_t *expansion)
+{
+	expansion_memo_t *memo;
+
+	memo = hash_table_find (parser->expansion_memo, key);
+	if (memo) {
+		ralloc_free (memo->expansion);
+		ralloc_free (key);
+	} else {
+		memo = ralloc (parser, expansion_memo_t);
+		ralloc_steal (memo, key);
+		hash_table_insert (parser->expansion_memo, memo, key);
+	}
+
+	memo->generation = parser->defines_generation;
+	memo->location = node->token->location;
+	memo->expansion = _token_list_copy (memo, expansion);
+}
+
 /* This is a helper function that's essentially part of the
  * implementation of _glcpp_parser_expand_node. It shouldn't be called
  * except for by that function.
@@ -1478,6 +1589,8 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 	function_status_t status;
 	token_list_t *substituted;
 	int parameter_index;
+	token_node_t *call = node;
+	char *memo_key;
 
 	identifier = node->token->value.str;
 
@@ -1518,6 +1631,16 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 		return NULL;
 	}
 
+	memo_key = _expansion_memo_key (parser, identifier, arguments);
+	if (memo_key) {
+		substituted = _expansion_memo_find (parser, memo_key, call);
+		if (substituted) {
+			ralloc_free (memo_key);
+			ralloc_free (arguments);
+			return substituted;
+		}
+	}
+
 	/* Perform argument substitution on the replacement list. */
 	substituted = _token_list_create (arguments);
 
@@ -1562,6 +1685,9 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 
 	_glcpp_parser_apply_pastes (parser, substituted);
 
+	if (memo_key)
+		_expansion_memo_store (parser, memo_key, call, substituted);
+
 	return substituted;
 }
 
@@ -1856,6 +1982,7 @@ _define_object_macro (glcpp_parser_t *parser,
 	}
 
 	hash_table_insert (parser->defines, macro, identifier);
+	parser->defines_generation++;
 }
 
 void
@@ -1888,6 +2015,7 @@ _define_function_macro (glcpp_parser_t *parser,
 	}
 
 	hash_table_insert (parser->defines, macro, identifier);
+	parser->defines_generation++;
 }
 
 static int
@@ -2062,6 +2190,7 @@ _glcpp_parser_handle_version_declaration(glcpp_parser_t *parser, intmax_t versio
 	if (macro) {
 		hash_table_remove (parser->defines, "__VERSION__");
 		ralloc_free (macro);
+		parser->defines_generation++;
 	}
 	add_builtin_define (parser, "__VERSION__", version);
 
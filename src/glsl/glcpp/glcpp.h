@@ -185,6 +185,14 @@ struct glcpp_parser {
 	bool has_new_source_number;
 	int new_source_number;
 	bool is_gles;
+
+	/* Function-like macro expansions already computed, keyed by the
+	 * macro name and its arguments.  Entries are only valid for the
+	 * defines_generation they were computed with, which changes on
+	 * every #define and #undef.
+	 */
+	struct hash_table *expansion_memo;
+	unsigned defines_generation;
 };
 
 struct gl_extensions;
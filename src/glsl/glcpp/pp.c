@@ -134,22 +134,130 @@ remove_line_continuations(glcpp_parser_t *ctx, const char *shader)
 	return clean;
 }
 
+/* Finish the current output line of copy_without_directives(): drop any
+ * trailing space, unless there is nothing else on the line, and append a
+ * newline.  This matches how the parser prints a text line.
+ */
+static void
+end_copied_line(char *out, size_t *len, size_t line_start, size_t non_space_end)
+{
+	if (non_space_end > line_start)
+		*len = non_space_end;
+	out[(*len)++] = '\n';
+}
+
+/* Fast path for shaders that don't need preprocessing.
+ *
+ * If the shader has no directives and mentions no predefined macro, the
+ * preprocessor would only strip comments and collapse horizontal space.
+ * Do that directly, producing exactly the output the lexer and parser
+ * would have, and skip tokenizing the shader.
+ *
+ * Returns NULL if the shader needs the full preprocessor.  That is the
+ * case for any '#' outside a comment, for any word containing "GL_" or
+ * "__" (all predefined macros are named that way, and user macros need a
+ * directive), for an unterminated comment, and for the whitespace
+ * characters other than space, tab and newline, which the lexer handles
+ * specially.
+ */
+static char *
+copy_without_directives(glcpp_parser_t *ctx, const char *shader)
+{
+	size_t length = strlen(shader);
+	/* Comments and space runs never grow, and the end of input adds
+	 * up to two newlines.
+	 */
+	char *out = ralloc_size(ctx, length + 3);
+	size_t len = 0, line_start = 0, non_space_end = 0;
+	const char *p = shader;
+
+	if (out == NULL)
+		return NULL;
+
+	while (*p) {
+		const char c = *p;
+
+		if (c == '\n') {
+			end_copied_line(out, &len, line_start, non_space_end);
+			line_start = non_space_end = len;
+			p++;
+		} else if (c == ' ' || c == '\t') {
+			out[len++] = ' ';
+			while (*p == ' ' || *p == '\t')
+				p++;
+		} else if (c == '/' && p[1] == '/') {
+			while (*p && *p != '\n')
+				p++;
+		} else if (c == '/' && p[1] == '*') {
+			p += 2;
+			while (*p && !(p[0] == '*' && p[1] == '/')) {
+				if (*p == '\n') {
+					end_copied_line(out, &len, line_start,
+							non_space_end);
+					line_start = non_space_end = len;
+				}
+				p++;
+			}
+			if (*p == '\0')
+				return NULL;
+			out[len++] = ' ';
+			p += 2;
+		} else if (c == '_' || isalnum((unsigned char) c)) {
+			const char *word = p, *s;
+
+			while (*p == '_' || isalnum((unsigned char) *p))
+				p++;
+
+			for (s = word; s + 1 < p; s++) {
+				if ((s[0] == '_' && s[1] == '_') ||
+				    (s + 2 < p && s[0] == 'G' && s[1] == 'L' &&
+				     s[2] == '_'))
+					return NULL;
+			}
+
+			memcpy(out + len, word, p - word);
+			len += p - word;
+			non_space_end = len;
+		} else if (c == '#' || isspace((unsigned char) c)) {
+			return NULL;
+		} else {
+			out[len++] = c;
+			non_space_end = len;
+			p++;
+		}
+	}
+
+	/* The lexer ends the last line at the end of input, whether or not
+	 * the shader itself ends with a newline.
+	 */
+	end_copied_line(out, &len, line_start, non_space_end);
+	out[len] = '\0';
+
+	return out;
+}
+
 int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 	   const struct gl_extensions *extensions, struct gl_context *gl_ctx)
 {
 	int errors;
+	char *copied;
 	glcpp_parser_t *parser = glcpp_parser_create (extensions, gl_ctx->API);
 
 	if (! gl_ctx->Const.DisableGLSLLineContinuations)
 		*shader = remove_line_continuations(parser, *shader);
 
-	glcpp_lex_set_source_string (parser, *shader);
+	copied = copy_without_directives(parser, *shader);
+	if (copied != NULL) {
+		parser->output = copied;
+	} else {
+		glcpp_lex_set_source_string (parser, *shader);
 
-	glcpp_parser_parse (parser);
+		glcpp_parser_parse (parser);
 
-	if (parser->skip_stack)
-		glcpp_error (&parser->skip_stack->loc, parser, "Unterminated #if\n");
+		if (parser->skip_stack)
+			glcpp_error (&parser->skip_stack->loc, parser, "Unterminated #if\n");
+	}
 
 	ralloc_strcat(info_log, parser->info_log);
 
@@ -0,0 +1,7 @@
+#define foo(x,y) ((x)*(y))
+#define bar 1
+foo(bar,baz)
+foo(bar,baz)
+#undef bar
+#define bar 2
+foo(bar,baz)
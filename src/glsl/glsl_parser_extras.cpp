@@ -66,6 +66,7 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
    this->scanner = NULL;
    this->translation_unit.make_empty();
    this->symbols = new(mem_ctx) glsl_symbol_table;
+   this->linalloc = linear_context(this);
 
    this->num_uniform_blocks = 0;
    this->uniform_block_array_size = 0;
@@ -713,7 +714,7 @@ _mesa_ast_set_aggregate_type(const ast_type_specifier *type,
                              ast_expression *expr,
                              _mesa_glsl_parse_state *state)
 {
-   void *ctx = state;
+   void *ctx = state->linalloc;
    ast_aggregate_initializer *ai = (ast_aggregate_initializer *)expr;
    ai->constructor_type = (ast_type_specifier *)type;
 
@@ -1459,6 +1460,8 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       new(shader) _mesa_glsl_parse_state(ctx, shader->Type, shader);
    const char *source = shader->Source;
 
+   _mesa_trace_begin(ctx, "_mesa_glsl_compile_shader", shader->SourceChecksum);
+
    state->error = glcpp_preprocess(state, &source, &state->info_log,
                              &ctx->Extensions, ctx);
 
@@ -1498,9 +1501,19 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
-      while (do_common_optimization(shader->ir, false, false, 32, options))
+      opt_pass_tracker tracker;
+      if (ctx->Shader.Flags & GLSL_DUMP)
+         tracker.log = ralloc_strdup(state, "");
+
+      while (do_common_optimization(shader->ir, false, false, 32, options,
+                                    &tracker))
          ;
 
+      if (tracker.log != NULL && tracker.log[0] != '\0') {
+         printf("GLSL loop unrolling for shader %d:\n", shader->Name);
+         printf("%s\n", tracker.log);
+      }
+
       validate_ir_tree(shader->ir);
    }
 
@@ -1530,10 +1543,90 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
    /* Retain any live IR, but trash the rest. */
    reparent_ir(shader->ir, shader->ir);
 
+   /* The IR calls built-ins, and links against them, until it is freed. */
+   if (shader->num_builtins_to_link)
+      _mesa_glsl_hold_builtin_functions(shader->ir);
+
    ralloc_free(state);
+
+   _mesa_trace_end(ctx);
+}
+
+
+/**
+ * Free the IR and symbol table of a compiled shader that has been linked
+ * (gl_constants::DiscardGLSLIR).
+ *
+ * Shaders without source, such as the ones Mesa builds itself, can't be
+ * compiled again and keep their IR.
+ */
+void
+_mesa_glsl_discard_shader_ir(struct gl_shader *shader)
+{
+   if (shader->Source == NULL || shader->ir == NULL)
+      return;
+
+   ralloc_free(shader->ir);
+   shader->ir = NULL;
+
+   delete shader->symbols;
+   shader->symbols = NULL;
+}
+
+
+/**
+ * Compile a shader whose IR was discarded again, from the same source.
+ */
+void
+_mesa_glsl_restore_shader_ir(struct gl_context *ctx, struct gl_shader *shader)
+{
+   if (shader->ir != NULL || !shader->CompileStatus)
+      return;
+
+   shader->Pragmas = ctx->ShaderCompilerOptions[
+      _mesa_shader_type_to_index(shader->Type)].DefaultPragmas;
+   _mesa_glsl_compile_shader(ctx, shader, false, false);
 }
 
 } /* extern "C" */
+
+
+opt_pass_tracker::opt_pass_tracker()
+   : runs(0), skipped(0), log(NULL), generation(1)
+{
+   memset(clean, 0, sizeof(clean));
+}
+
+
+bool
+opt_pass_tracker::should_run(enum opt_pass pass)
+{
+   if (clean[pass] == generation) {
+      skipped++;
+      return false;
+   }
+
+   return true;
+}
+
+
+/**
+ * Record the result of a pass that ran and return \c progress.
+ */
+bool
+opt_pass_tracker::record(enum opt_pass pass, bool progress)
+{
+   runs++;
+
+   if (progress)
+      generation++;
+   else
+      clean[pass] = generation;
+
+   return progress;
+}
+
+
 /**
  * Do the set of common optimizations passes
  *
@@ -1551,58 +1644,80 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
  *                                    unrolled.  Setting to 0 disables loop
  *                                    unrolling.
  * \param options                     The driver's preferred shader options.
+ * \param tracker                     Optional pass tracker shared by the
+ *                                    calls of a fixed-point loop, so that
+ *                                    they skip passes that can't make
+ *                                    progress.
  */
 bool
 do_common_optimization(exec_list *ir, bool linked,
 		       bool uniform_locations_assigned,
 		       unsigned max_unroll_iterations,
-                       const struct gl_shader_compiler_options *options)
+                       const struct gl_shader_compiler_options *options,
+                       opt_pass_tracker *tracker)
 {
+   opt_pass_tracker local_tracker;
    GLboolean progress = GL_FALSE;
 
-   progress = lower_instructions(ir, SUB_TO_ADD_NEG) || progress;
+   if (!tracker)
+      tracker = &local_tracker;
+
+#define OPT(pass, call) \
+   (tracker->should_run(pass) && tracker->record(pass, call))
+
+   progress = OPT(OPT_LOWER_SUB, lower_instructions(ir, SUB_TO_ADD_NEG)) || progress;
 
    if (linked) {
-      progress = do_function_inlining(ir) || progress;
-      progress = do_dead_functions(ir) || progress;
-      progress = do_structure_splitting(ir) || progress;
+      progress = OPT(OPT_FUNCTION_INLINING, do_function_inlining(ir)) || progress;
+      progress = OPT(OPT_DEAD_FUNCTIONS, do_dead_functions(ir)) || progress;
+      progress = OPT(OPT_STRUCTURE_SPLITTING, do_structure_splitting(ir)) || progress;
    }
-   progress = do_if_simplification(ir) || progress;
-   progress = opt_flatten_nested_if_blocks(ir) || progress;
-   progress = do_copy_propagation(ir) || progress;
-   progress = do_copy_propagation_elements(ir) || progress;
+   progress = OPT(OPT_IF_SIMPLIFICATION, do_if_simplification(ir)) || progress;
+   progress = OPT(OPT_FLATTEN_NESTED_IFS, opt_flatten_nested_if_blocks(ir)) || progress;
+   progress = OPT(OPT_COPY_PROPAGATION, do_copy_propagation(ir)) || progress;
+   progress = OPT(OPT_COPY_PROPAGATION_ELEMENTS, do_copy_propagation_elements(ir)) || progress;
 
    if (options->PreferDP4 && !linked)
-      progress = opt_flip_matrices(ir) || progress;
+      progress = OPT(OPT_FLIP_MATRICES, opt_flip_matrices(ir)) || progress;
 
    if (linked)
-      progress = do_dead_code(ir, uniform_locations_assigned) || progress;
+      progress = OPT(OPT_DEAD_CODE, do_dead_code(ir, uniform_locations_assigned)) || progress;
    else
-      progress = do_dead_code_unlinked(ir) || progress;
-   progress = do_dead_code_local(ir) || progress;
-   progress = do_tree_grafting(ir) || progress;
-   progress = do_constant_propagation(ir) || progress;
+      progress = OPT(OPT_DEAD_CODE, do_dead_code_unlinked(ir)) || progress;
+   progress = OPT(OPT_DEAD_CODE_LOCAL, do_dead_code_local(ir)) || progress;
+   progress = OPT(OPT_TREE_GRAFTING, do_tree_grafting(ir)) || progress;
+   progress = OPT(OPT_CONSTANT_PROPAGATION, do_constant_propagation(ir)) || progress;
    if (linked)
-      progress = do_constant_variable(ir) || progress;
+      progress = OPT(OPT_CONSTANT_VARIABLE, do_constant_variable(ir)) || progress;
    else
-      progress = do_constant_variable_unlinked(ir) || progress;
-   progress = do_constant_folding(ir) || progress;
-   progress = do_algebraic(ir) || progress;
-   progress = do_lower_jumps(ir) || progress;
-   progress = do_vec_index_to_swizzle(ir) || progress;
-   progress = lower_vector_insert(ir, false) || progress;
-   progress = do_swizzle_swizzle(ir) || progress;
-   progress = do_noop_swizzle(ir) || progress;
-
-   progress = optimize_split_arrays(ir, linked) || progress;
-   progress = optimize_redundant_jumps(ir) || progress;
-
-   loop_state *ls = analyze_loop_variables(ir);
-   if (ls->loop_found) {
-      progress = set_loop_controls(ir, ls) || progress;
-      progress = unroll_loops(ir, ls, max_unroll_iterations) || progress;
+      progress = OPT(OPT_CONSTANT_VARIABLE, do_constant_variable_unlinked(ir)) || progress;
+   progress = OPT(OPT_CONSTANT_FOLDING, do_constant_folding(ir)) || progress;
+   progress = OPT(OPT_ALGEBRAIC, do_algebraic(ir)) || progress;
+   if (options->OptimizeCSE)
+      progress = OPT(OPT_CSE, do_cse(ir)) || progress;
+   progress = OPT(OPT_LOWER_JUMPS, do_lower_jumps(ir)) || progress;
+   progress = OPT(OPT_VEC_INDEX_TO_SWIZZLE, do_vec_index_to_swizzle(ir)) || progress;
+   progress = OPT(OPT_LOWER_VECTOR_INSERT, lower_vector_insert(ir, false)) || progress;
+   progress = OPT(OPT_SWIZZLE_SWIZZLE, do_swizzle_swizzle(ir)) || progress;
+   progress = OPT(OPT_NOOP_SWIZZLE, do_noop_swizzle(ir)) || progress;
+
+   progress = OPT(OPT_SPLIT_ARRAYS, optimize_split_arrays(ir, linked)) || progress;
+   progress = OPT(OPT_REDUNDANT_JUMPS, optimize_redundant_jumps(ir)) || progress;
+
+#undef OPT
+
+   if (tracker->should_run(OPT_LOOPS)) {
+      bool loop_progress = false;
+      loop_state *ls = analyze_loop_variables(ir);
+      if (ls->loop_found) {
+         loop_progress = set_loop_controls(ir, ls) || loop_progress;
+         loop_progress = unroll_loops(ir, ls, max_unroll_iterations, options,
+                                      tracker->log ? &tracker->log : NULL) ||
+            loop_progress;
+      }
+      delete ls;
+      progress = tracker->record(OPT_LOOPS, loop_progress) || progress;
    }
-   delete ls;
 
    return progress;
 }
@@ -1621,6 +1736,7 @@ _mesa_destroy_shader_compiler(void)
 {
    _mesa_destroy_shader_compiler_caches();
 
+   _mesa_glsl_release_builtin_functions();
    _mesa_glsl_release_types();
 }
 
@@ -1632,7 +1748,11 @@ _mesa_destroy_shader_compiler(void)
 void
 _mesa_destroy_shader_compiler_caches(void)
 {
-   _mesa_glsl_release_builtin_functions();
+   /* The built-in function library is shared by every context in the
+    * process.  Shaders compiled by any of them keep it until their IR is
+    * freed, so it may only go away then.
+    */
+   _mesa_glsl_release_unused_builtin_functions();
 }
 
 }
@@ -139,6 +139,12 @@ struct _mesa_glsl_parse_state {
    exec_list translation_unit;
    glsl_symbol_table *symbols;
 
+   /**
+    * Linear context the AST is allocated from, freed with the parse state.
+    * Nothing that outlives the AST may be allocated from it.
+    */
+   void *linalloc;
+
    unsigned num_uniform_blocks;
    unsigned uniform_block_array_size;
    struct gl_uniform_block *uniform_blocks;
@@ -23,6 +23,9 @@
  */
 
 #include "glsl_symbol_table.h"
+extern "C" {
+#include "program/hash_table.h"
+}
 
 class symbol_table_entry {
 public:
@@ -94,32 +97,202 @@ public:
    const class ast_type_specifier *a;
 };
 
+struct glsl_symbol_table::symbol {
+   symbol_table_entry entry;
+   symbol *next;        /**< Declaration of the same name in an outer scope */
+   unsigned depth;
+   unsigned serial;     /**< Serial number of the declaring scope */
+};
+
+struct glsl_symbol_table::name_slot {
+   const char *name;    /**< NULL for an unused slot */
+   unsigned hash;
+   symbol *symbols;     /**< Declarations, innermost first */
+};
+
+/** Number of declarations allocated at once */
+#define SYMBOL_ARENA_SIZE 256
+
 glsl_symbol_table::glsl_symbol_table()
 {
    this->separate_function_namespace = false;
-   this->table = _mesa_symbol_table_ctor();
    this->mem_ctx = ralloc_context(NULL);
+
+   this->num_slots = 256;
+   this->num_names = 0;
+   this->slots = rzalloc_array(mem_ctx, name_slot, this->num_slots);
+
+   /* Start with the global scope and the outermost scope open. */
+   this->scope_capacity = 16;
+   this->scope_serials = ralloc_array(mem_ctx, unsigned, this->scope_capacity);
+   this->scope_serials[0] = 0;
+   this->scope_serials[1] = 1;
+   this->depth = 1;
+   this->next_serial = 2;
+
+   this->free_symbols = NULL;
+   this->arena = NULL;
+   this->arena_left = 0;
 }
 
 glsl_symbol_table::~glsl_symbol_table()
 {
-   _mesa_symbol_table_dtor(table);
    ralloc_free(mem_ctx);
 }
 
 void glsl_symbol_table::push_scope()
 {
-   _mesa_symbol_table_push_scope(table);
+   if (++this->depth == this->scope_capacity) {
+      this->scope_capacity *= 2;
+      this->scope_serials = reralloc(mem_ctx, this->scope_serials, unsigned,
+                                     this->scope_capacity);
+   }
+
+   this->scope_serials[this->depth] = this->next_serial++;
 }
 
 void glsl_symbol_table::pop_scope()
 {
-   _mesa_symbol_table_pop_scope(table);
+   assert(this->depth > 1);
+   this->depth--;
+}
+
+bool glsl_symbol_table::is_live(const symbol *sym) const
+{
+   return sym->depth <= this->depth &&
+          this->scope_serials[sym->depth] == sym->serial;
+}
+
+/**
+ * Find the slot of \c name, or the unused slot it would go in.  Returns
+ * NULL if the name isn't in the table and \c create is false.
+ */
+glsl_symbol_table::name_slot *
+glsl_symbol_table::find_slot(const char *name, bool create)
+{
+   const unsigned hash = hash_table_string_hash(name);
+   const unsigned mask = this->num_slots - 1;
+
+   for (unsigned i = hash & mask; ; i = (i + 1) & mask) {
+      name_slot *slot = &this->slots[i];
+
+      if (slot->name == NULL) {
+         if (!create)
+            return NULL;
+
+         if ((this->num_names + 1) * 4 > this->num_slots * 3) {
+            grow_slots();
+            return find_slot(name, true);
+         }
+
+         slot->name = ralloc_strdup(mem_ctx, name);
+         slot->hash = hash;
+         this->num_names++;
+         return slot;
+      }
+
+      if (slot->hash == hash && strcmp(slot->name, name) == 0)
+         return slot;
+   }
+}
+
+void glsl_symbol_table::grow_slots()
+{
+   name_slot *const old_slots = this->slots;
+   const unsigned old_num_slots = this->num_slots;
+
+   this->num_slots *= 2;
+   this->slots = rzalloc_array(mem_ctx, name_slot, this->num_slots);
+
+   const unsigned mask = this->num_slots - 1;
+   for (unsigned i = 0; i < old_num_slots; i++) {
+      if (old_slots[i].name == NULL)
+         continue;
+
+      unsigned j = old_slots[i].hash & mask;
+      while (this->slots[j].name != NULL)
+         j = (j + 1) & mask;
+
+      this->slots[j] = old_slots[i];
+   }
+
+   ralloc_free(old_slots);
+}
+
+/**
+ * Return the innermost visible declaration of a name.
+ *
+ * Scopes are closed innermost first and declarations are kept innermost
+ * first, so the declarations of closed scopes are always at the front of
+ * the list.  Recycle them on the way.
+ */
+glsl_symbol_table::symbol *
+glsl_symbol_table::innermost(name_slot *slot)
+{
+   while (slot->symbols != NULL && !is_live(slot->symbols)) {
+      symbol *const dead = slot->symbols;
+
+      slot->symbols = dead->next;
+      dead->next = this->free_symbols;
+      this->free_symbols = dead;
+   }
+
+   return slot->symbols;
+}
+
+glsl_symbol_table::symbol *
+glsl_symbol_table::new_symbol(const symbol_table_entry &entry, unsigned depth)
+{
+   symbol *sym;
+
+   if (this->free_symbols != NULL) {
+      sym = this->free_symbols;
+      this->free_symbols = sym->next;
+   } else {
+      if (this->arena_left == 0) {
+         this->arena = (symbol *)
+            ralloc_size(mem_ctx, SYMBOL_ARENA_SIZE * sizeof(symbol));
+         this->arena_left = SYMBOL_ARENA_SIZE;
+      }
+
+      sym = this->arena++;
+      this->arena_left--;
+   }
+
+   ::new(&sym->entry) symbol_table_entry(entry);
+   sym->next = NULL;
+   sym->depth = depth;
+   sym->serial = this->scope_serials[depth];
+   return sym;
+}
+
+/**
+ * Declare \c name in the current scope.  Fails if the name is already
+ * declared in this scope.
+ */
+bool glsl_symbol_table::add_entry(const char *name,
+                                  const symbol_table_entry &entry)
+{
+   name_slot *const slot = find_slot(name, true);
+   symbol *const outer = innermost(slot);
+
+   if (outer != NULL && outer->depth == this->depth)
+      return false;
+
+   symbol *const sym = new_symbol(entry, this->depth);
+   sym->next = outer;
+   slot->symbols = sym;
+   return true;
 }
 
 bool glsl_symbol_table::name_declared_this_scope(const char *name)
 {
-   return _mesa_symbol_table_symbol_scope(table, -1, name) == 0;
+   name_slot *const slot = find_slot(name, false);
+   if (slot == NULL)
+      return false;
+
+   symbol *const sym = innermost(slot);
+   return sym != NULL && sym->depth == this->depth;
 }
 
 bool glsl_symbol_table::add_variable(ir_variable *v)
@@ -140,11 +313,11 @@ bool glsl_symbol_table::add_variable(ir_variable *v)
 	  * entry includes a function, propagate that to this block - otherwise
 	  * the new variable declaration would shadow the function.
 	  */
-	 symbol_table_entry *entry = new(mem_ctx) symbol_table_entry(v);
+	 symbol_table_entry entry(v);
 	 if (existing != NULL)
-	    entry->f = existing->f;
-	 int added = _mesa_symbol_table_add_symbol(table, -1, v->name, entry);
-	 assert(added == 0);
+	    entry.f = existing->f;
+	 bool added = add_entry(v->name, entry);
+	 assert(added);
 	 (void)added;
 	 return true;
       }
@@ -152,14 +325,12 @@ bool glsl_symbol_table::add_variable(ir_variable *v)
    }
 
    /* 1.20+ rules: */
-   symbol_table_entry *entry = new(mem_ctx) symbol_table_entry(v);
-   return _mesa_symbol_table_add_symbol(table, -1, v->name, entry) == 0;
+   return add_entry(v->name, symbol_table_entry(v));
 }
 
 bool glsl_symbol_table::add_type(const char *name, const glsl_type *t)
 {
-   symbol_table_entry *entry = new(mem_ctx) symbol_table_entry(t);
-   return _mesa_symbol_table_add_symbol(table, -1, name, entry) == 0;
+   return add_entry(name, symbol_table_entry(t));
 }
 
 static char *make_ast_name(const char *name)
@@ -172,9 +343,8 @@ static char *make_ast_name(const char *name)
 
 bool glsl_symbol_table::add_type_ast(const char *name, const class ast_type_specifier *a)
 {
-   symbol_table_entry *entry = new(mem_ctx) symbol_table_entry(a);
    char *ast_name = make_ast_name(name);
-   bool ret = _mesa_symbol_table_add_symbol(table, -1, ast_name, entry) == 0;
+   bool ret = add_entry(ast_name, symbol_table_entry(a));
    delete [] ast_name;
    return ret;
 }
@@ -185,10 +355,8 @@ bool glsl_symbol_table::add_interface(const char *name, const glsl_type *i,
    assert(i->is_interface());
    symbol_table_entry *entry = get_entry(name);
    if (entry == NULL) {
-      symbol_table_entry *entry =
-         new(mem_ctx) symbol_table_entry(i, mode);
       bool add_interface_symbol_result =
-         _mesa_symbol_table_add_symbol(table, -1, name, entry) == 0;
+         add_entry(name, symbol_table_entry(i, mode));
       assert(add_interface_symbol_result);
       return add_interface_symbol_result;
    } else {
@@ -206,16 +374,22 @@ bool glsl_symbol_table::add_function(ir_function *f)
 	 return true;
       }
    }
-   symbol_table_entry *entry = new(mem_ctx) symbol_table_entry(f);
-   return _mesa_symbol_table_add_symbol(table, -1, f->name, entry) == 0;
+   return add_entry(f->name, symbol_table_entry(f));
 }
 
 void glsl_symbol_table::add_global_function(ir_function *f)
 {
-   symbol_table_entry *entry = new(mem_ctx) symbol_table_entry(f);
-   int added = _mesa_symbol_table_add_global_symbol(table, -1, f->name, entry);
-   assert(added == 0);
-   (void)added;
+   name_slot *const slot = find_slot(f->name, true);
+   symbol *sym = innermost(slot);
+
+   /* Global declarations go behind those of every other scope. */
+   symbol **link = &slot->symbols;
+   for (; sym != NULL; sym = sym->next) {
+      assert(sym->depth != 0);
+      link = &sym->next;
+   }
+
+   *link = new_symbol(symbol_table_entry(f), 0);
 }
 
 ir_variable *glsl_symbol_table::get_variable(const char *name)
@@ -253,8 +427,12 @@ ir_function *glsl_symbol_table::get_function(const char *name)
 
 symbol_table_entry *glsl_symbol_table::get_entry(const char *name)
 {
-   return (symbol_table_entry *)
-      _mesa_symbol_table_find_symbol(table, -1, name);
+   name_slot *const slot = find_slot(name, false);
+   if (slot == NULL)
+      return NULL;
+
+   symbol *const sym = innermost(slot);
+   return sym != NULL ? &sym->entry : NULL;
 }
 
 void
@@ -28,19 +28,20 @@
 
 #include <new>
 
-extern "C" {
-#include "program/symbol_table.h"
-}
 #include "ir.h"
 #include "glsl_types.h"
 
 class symbol_table_entry;
 
 /**
- * Facade class for _mesa_symbol_table
+ * Scoped symbol table of the GLSL front end
  *
- * Wraps the existing \c _mesa_symbol_table data structure to enforce some
- * type safe and some symbol table invariants.
+ * Names live in a single open-addressing hash table.  Each name heads a
+ * list of its declarations, innermost first, and each declaration is
+ * tagged with the depth and serial number of the scope it was made in.
+ * Popping a scope only forgets its serial number; declarations from
+ * scopes that are no longer open are dropped lazily when their name is
+ * next looked up.  Declarations are allocated from an arena and recycled.
  */
 struct glsl_symbol_table {
 private:
@@ -130,9 +131,36 @@ public:
    void disable_variable(const char *name);
 
 private:
+   struct symbol;
+   struct name_slot;
+
    symbol_table_entry *get_entry(const char *name);
 
-   struct _mesa_symbol_table *table;
+   name_slot *find_slot(const char *name, bool create);
+   void grow_slots();
+   bool is_live(const symbol *sym) const;
+   symbol *innermost(name_slot *slot);
+   symbol *new_symbol(const symbol_table_entry &entry, unsigned depth);
+   bool add_entry(const char *name, const symbol_table_entry &entry);
+
+   name_slot *slots;
+   unsigned num_slots;          /**< Always a power of two */
+   unsigned num_names;
+
+   /**
+    * Serial number of the scope open at each depth.  Depth 0 holds the
+    * symbols added by add_global_function(); the outermost scope that
+    * push_scope() nests in is depth 1.
+    */
+   unsigned *scope_serials;
+   unsigned scope_capacity;
+   unsigned depth;
+   unsigned next_serial;
+
+   symbol *free_symbols;        /**< Recycled declarations */
+   symbol *arena;               /**< Unused part of the current arena block */
+   unsigned arena_left;
+
    void *mem_ctx;
 };
 
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "main/core.h" /* for Elements */
+#include "glapi/glthread.h"
 #include "glsl_symbol_table.h"
 #include "glsl_parser_extras.h"
 #include "glsl_types.h"
@@ -31,11 +32,146 @@ extern "C" {
 #include "program/hash_table.h"
 }
 
-hash_table *glsl_type::array_types = NULL;
-hash_table *glsl_type::record_types = NULL;
-hash_table *glsl_type::interface_types = NULL;
+glsl_type_table *volatile glsl_type::array_types = NULL;
+glsl_type_table *volatile glsl_type::record_types = NULL;
+glsl_type_table *volatile glsl_type::interface_types = NULL;
 void *glsl_type::mem_ctx = NULL;
 
+/**
+ * Serializes insertions into the type tables above and allocations from
+ * glsl_type::mem_ctx, so that shaders can be compiled on several threads at
+ * once.  Lookups don't take the lock.
+ */
+_glthread_DECLARE_STATIC_MUTEX(glsl_type_mutex);
+
+/**
+ * Makes the stores before it visible to other threads before the stores
+ * after it.  Used to publish fully initialized type table entries to
+ * lookups that don't take glsl_type_mutex.
+ */
+#if defined(__GNUC__)
+#define type_table_barrier() __sync_synchronize()
+#elif defined(_MSC_VER)
+#include <intrin.h>
+/* x86 doesn't reorder stores, so a compiler barrier is enough. */
+#define type_table_barrier() _ReadWriteBarrier()
+#else
+#error "Need a memory barrier for the glsl_type tables"
+#endif
+
+struct glsl_type_table_entry {
+   const glsl_type *type;
+   unsigned hash;
+   glsl_type_table_entry *next;
+};
+
+/**
+ * Hash table of interned types.
+ *
+ * Entries are never modified or removed once they are reachable, and the
+ * bucket array is never rehashed in place: growing the table builds a new
+ * one and publishes it, leaving the old one intact for lookups that are
+ * still walking it.  Superseded tables are only freed by
+ * _mesa_glsl_release_types().
+ */
+struct glsl_type_table {
+   unsigned size;       /**< Number of buckets, a power of two */
+   unsigned entries;
+   glsl_type_table_entry *volatile *buckets;
+};
+
+/** Parent of all type tables and their entries */
+static void *type_table_mem_ctx = NULL;
+
+/**
+ * Arrays of scalars, vectors and matrices up to this size bypass the array
+ * type table.
+ */
+#define FAST_ARRAY_SIZE 16
+
+/**
+ * Array types of the built-in numeric and boolean types, indexed by base
+ * type, matrix columns, vector elements and array size.
+ */
+static const glsl_type *volatile
+fast_array_types[GLSL_TYPE_BOOL + 1][4][4][FAST_ARRAY_SIZE + 1];
+
+static glsl_type_table *
+type_table_create(unsigned size)
+{
+   if (type_table_mem_ctx == NULL)
+      type_table_mem_ctx = ralloc_context(NULL);
+
+   glsl_type_table *table = rzalloc(type_table_mem_ctx, glsl_type_table);
+   table->size = size;
+   table->buckets = rzalloc_array(table, glsl_type_table_entry *, size);
+
+   return table;
+}
+
+static inline const glsl_type_table_entry *
+type_table_bucket(const glsl_type_table *table, unsigned hash)
+{
+   if (table == NULL)
+      return NULL;
+
+   return table->buckets[hash & (table->size - 1)];
+}
+
+static void
+type_table_add_entry(glsl_type_table *table, const glsl_type *type,
+                     unsigned hash)
+{
+   glsl_type_table_entry *entry = ralloc(table, glsl_type_table_entry);
+   glsl_type_table_entry *volatile *bucket =
+      &table->buckets[hash & (table->size - 1)];
+
+   entry->type = type;
+   entry->hash = hash;
+   entry->next = *bucket;
+
+   type_table_barrier();
+   *bucket = entry;
+   table->entries++;
+}
+
+/**
+ * Add \p type to the table pointed to by \p table_ptr, growing it if
+ * needed.  Must be called with glsl_type_mutex held.
+ */
+static void
+type_table_insert(glsl_type_table *volatile *table_ptr,
+                  const glsl_type *type, unsigned hash)
+{
+   glsl_type_table *table = *table_ptr;
+
+   if (table == NULL) {
+      table = type_table_create(64);
+      type_table_barrier();
+      *table_ptr = table;
+   } else if (table->entries >= table->size) {
+      glsl_type_table *bigger = type_table_create(table->size * 2);
+
+      for (unsigned i = 0; i < table->size; i++) {
+         for (const glsl_type_table_entry *entry = table->buckets[i];
+              entry != NULL; entry = entry->next)
+            type_table_add_entry(bigger, entry->type, entry->hash);
+      }
+
+      type_table_barrier();
+      *table_ptr = table = bigger;
+   }
+
+   type_table_add_entry(table, type, hash);
+}
+
+static inline unsigned
+pointer_hash(const void *p)
+{
+   /* The low bits of an allocation are mostly zero. */
+   return (unsigned) ((uintptr_t) p >> 3) * 2654435761u;
+}
+
 void
 glsl_type::init_ralloc_type_ctx(void)
 {
@@ -241,15 +377,13 @@ const glsl_type *glsl_type::get_scalar_type() const
 void
 _mesa_glsl_release_types(void)
 {
-   if (glsl_type::array_types != NULL) {
-      hash_table_dtor(glsl_type::array_types);
-      glsl_type::array_types = NULL;
-   }
+   glsl_type::array_types = NULL;
+   glsl_type::record_types = NULL;
+   glsl_type::interface_types = NULL;
+   memset((void *) fast_array_types, 0, sizeof(fast_array_types));
 
-   if (glsl_type::record_types != NULL) {
-      hash_table_dtor(glsl_type::record_types);
-      glsl_type::record_types = NULL;
-   }
+   ralloc_free(type_table_mem_ctx);
+   type_table_mem_ctx = NULL;
 }
 
 
@@ -393,28 +527,59 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns)
 }
 
 
+static const glsl_type *
+find_array_type(const glsl_type_table *table, unsigned hash,
+                const glsl_type *base, unsigned array_size)
+{
+   for (const glsl_type_table_entry *entry = type_table_bucket(table, hash);
+        entry != NULL; entry = entry->next) {
+      if (entry->hash == hash &&
+          entry->type->fields.array == base &&
+          entry->type->length == array_size)
+         return entry->type;
+   }
+
+   return NULL;
+}
+
+
 const glsl_type *
 glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
 {
-
-   if (array_types == NULL) {
-      array_types = hash_table_ctor(64, hash_table_string_hash,
-				    hash_table_string_compare);
+   const glsl_type *volatile *fast_slot = NULL;
+
+   if (base->base_type <= GLSL_TYPE_BOOL && array_size <= FAST_ARRAY_SIZE) {
+      fast_slot = &fast_array_types[base->base_type]
+                                   [base->matrix_columns - 1]
+                                   [base->vector_elements - 1]
+                                   [array_size];
+      if (*fast_slot != NULL)
+         return *fast_slot;
    }
 
-   /* Generate a name using the base type pointer in the key.  This is
-    * done because the name of the base type may not be unique across
-    * shaders.  For example, two shaders may have different record types
-    * named 'foo'.
+   /* Key on the base type pointer rather than its name, because the name
+    * of the base type may not be unique across shaders.  For example, two
+    * shaders may have different record types named 'foo'.
     */
-   char key[128];
-   snprintf(key, sizeof(key), "%p[%u]", (void *) base, array_size);
+   const unsigned hash = pointer_hash(base) ^ (array_size * 40503u);
 
-   const glsl_type *t = (glsl_type *) hash_table_find(array_types, key);
+   const glsl_type *t = find_array_type(array_types, hash, base, array_size);
    if (t == NULL) {
-      t = new glsl_type(base, array_size);
+      _glthread_LOCK_MUTEX(glsl_type_mutex);
 
-      hash_table_insert(array_types, (void *) t, ralloc_strdup(mem_ctx, key));
+      /* Another thread may have added it since the lookup above. */
+      t = find_array_type(array_types, hash, base, array_size);
+      if (t == NULL) {
+         t = new glsl_type(base, array_size);
+         type_table_insert(&array_types, t, hash);
+      }
+
+      _glthread_UNLOCK_MUTEX(glsl_type_mutex);
+   }
+
+   if (fast_slot != NULL) {
+      type_table_barrier();
+      *fast_slot = t;
    }
 
    assert(t->base_type == GLSL_TYPE_ARRAY);
@@ -425,60 +590,64 @@ glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
 }
 
 
-int
-glsl_type::record_key_compare(const void *a, const void *b)
+bool
+glsl_type::record_key_matches(const glsl_struct_field *fields,
+                              unsigned num_fields,
+                              enum glsl_interface_packing packing,
+                              const char *name) const
 {
-   const glsl_type *const key1 = (glsl_type *) a;
-   const glsl_type *const key2 = (glsl_type *) b;
-
-   /* Return zero is the types match (there is zero difference) or non-zero
-    * otherwise.
-    */
-   if (strcmp(key1->name, key2->name) != 0)
-      return 1;
+   if (this->length != num_fields)
+      return false;
 
-   if (key1->length != key2->length)
-      return 1;
+   if (this->interface_packing != (unsigned) packing)
+      return false;
 
-   if (key1->interface_packing != key2->interface_packing)
-      return 1;
+   if (strcmp(this->name, name) != 0)
+      return false;
 
-   for (unsigned i = 0; i < key1->length; i++) {
-      if (key1->fields.structure[i].type != key2->fields.structure[i].type)
-	 return 1;
-      if (strcmp(key1->fields.structure[i].name,
-		 key2->fields.structure[i].name) != 0)
-	 return 1;
-      if (key1->fields.structure[i].row_major
-         != key2->fields.structure[i].row_major)
-        return 1;
-      if (key1->fields.structure[i].location
-          != key2->fields.structure[i].location)
-         return 1;
+   for (unsigned i = 0; i < num_fields; i++) {
+      if (this->fields.structure[i].type != fields[i].type)
+         return false;
+      if (strcmp(this->fields.structure[i].name, fields[i].name) != 0)
+         return false;
+      if (this->fields.structure[i].row_major != fields[i].row_major)
+         return false;
+      if (this->fields.structure[i].location != fields[i].location)
+         return false;
    }
 
-   return 0;
+   return true;
 }
 
 
 unsigned
-glsl_type::record_key_hash(const void *a)
+glsl_type::record_key_hash(const glsl_struct_field *fields,
+                           unsigned num_fields, const char *name)
 {
-   const glsl_type *const key = (glsl_type *) a;
-   char hash_key[128];
-   unsigned size = 0;
+   unsigned hash = hash_table_string_hash(name) ^ (num_fields * 40503u);
 
-   size = snprintf(hash_key, sizeof(hash_key), "%08x", key->length);
+   for (unsigned i = 0; i < num_fields; i++)
+      hash = (hash * 31) ^ pointer_hash(fields[i].type);
+
+   return hash;
+}
 
-   for (unsigned i = 0; i < key->length; i++) {
-      if (size >= sizeof(hash_key))
-	 break;
 
-      size += snprintf(& hash_key[size], sizeof(hash_key) - size,
-		       "%p", (void *) key->fields.structure[i].type);
+const glsl_type *
+glsl_type::find_record_type(const glsl_type_table *table, unsigned hash,
+                            const glsl_struct_field *fields,
+                            unsigned num_fields,
+                            enum glsl_interface_packing packing,
+                            const char *name)
+{
+   for (const glsl_type_table_entry *entry = type_table_bucket(table, hash);
+        entry != NULL; entry = entry->next) {
+      if (entry->hash == hash &&
+          entry->type->record_key_matches(fields, num_fields, packing, name))
+         return entry->type;
    }
 
-   return hash_table_string_hash(& hash_key);
+   return NULL;
 }
 
 
@@ -487,17 +656,24 @@ glsl_type::get_record_instance(const glsl_struct_field *fields,
 			       unsigned num_fields,
 			       const char *name)
 {
-   const glsl_type key(fields, num_fields, name);
+   /* Record types have no packing; their interface_packing is 0. */
+   const enum glsl_interface_packing packing =
+      (enum glsl_interface_packing) 0;
+   const unsigned hash = record_key_hash(fields, num_fields, name);
 
-   if (record_types == NULL) {
-      record_types = hash_table_ctor(64, record_key_hash, record_key_compare);
-   }
-
-   const glsl_type *t = (glsl_type *) hash_table_find(record_types, & key);
+   const glsl_type *t = find_record_type(record_types, hash,
+                                         fields, num_fields, packing, name);
    if (t == NULL) {
-      t = new glsl_type(fields, num_fields, name);
+      _glthread_LOCK_MUTEX(glsl_type_mutex);
+
+      t = find_record_type(record_types, hash,
+                           fields, num_fields, packing, name);
+      if (t == NULL) {
+         t = new glsl_type(fields, num_fields, name);
+         type_table_insert(&record_types, t, hash);
+      }
 
-      hash_table_insert(record_types, (void *) t, t);
+      _glthread_UNLOCK_MUTEX(glsl_type_mutex);
    }
 
    assert(t->base_type == GLSL_TYPE_STRUCT);
@@ -514,17 +690,22 @@ glsl_type::get_interface_instance(const glsl_struct_field *fields,
 				  enum glsl_interface_packing packing,
 				  const char *block_name)
 {
-   const glsl_type key(fields, num_fields, packing, block_name);
+   const unsigned hash = record_key_hash(fields, num_fields, block_name);
 
-   if (interface_types == NULL) {
-      interface_types = hash_table_ctor(64, record_key_hash, record_key_compare);
-   }
-
-   const glsl_type *t = (glsl_type *) hash_table_find(interface_types, & key);
+   const glsl_type *t = find_record_type(interface_types, hash,
+                                         fields, num_fields, packing,
+                                         block_name);
    if (t == NULL) {
-      t = new glsl_type(fields, num_fields, packing, block_name);
+      _glthread_LOCK_MUTEX(glsl_type_mutex);
+
+      t = find_record_type(interface_types, hash,
+                           fields, num_fields, packing, block_name);
+      if (t == NULL) {
+         t = new glsl_type(fields, num_fields, packing, block_name);
+         type_table_insert(&interface_types, t, hash);
+      }
 
-      hash_table_insert(interface_types, (void *) t, t);
+      _glthread_UNLOCK_MUTEX(glsl_type_mutex);
    }
 
    assert(t->base_type == GLSL_TYPE_INTERFACE);
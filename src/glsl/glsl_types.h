@@ -36,6 +36,7 @@ extern "C" {
 
 struct _mesa_glsl_parse_state;
 struct glsl_symbol_table;
+struct glsl_type_table;
 
 extern void
 _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
@@ -541,17 +542,27 @@ private:
    /** Constructor for array types */
    glsl_type(const glsl_type *array, unsigned length);
 
-   /** Hash table containing the known array types. */
-   static struct hash_table *array_types;
-
-   /** Hash table containing the known record types. */
-   static struct hash_table *record_types;
-
-   /** Hash table containing the known interface types. */
-   static struct hash_table *interface_types;
-
-   static int record_key_compare(const void *a, const void *b);
-   static unsigned record_key_hash(const void *key);
+   /** Interned table containing the known array types. */
+   static struct glsl_type_table *volatile array_types;
+
+   /** Interned table containing the known record types. */
+   static struct glsl_type_table *volatile record_types;
+
+   /** Interned table containing the known interface types. */
+   static struct glsl_type_table *volatile interface_types;
+
+   static unsigned record_key_hash(const glsl_struct_field *fields,
+                                   unsigned num_fields, const char *name);
+   bool record_key_matches(const glsl_struct_field *fields,
+                           unsigned num_fields,
+                           enum glsl_interface_packing packing,
+                           const char *name) const;
+   static const glsl_type *find_record_type(const glsl_type_table *table,
+                                            unsigned hash,
+                                            const glsl_struct_field *fields,
+                                            unsigned num_fields,
+                                            enum glsl_interface_packing packing,
+                                            const char *name);
 
    /**
     * \name Built-in type flyweights
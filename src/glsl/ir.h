@@ -2252,6 +2252,12 @@ _mesa_glsl_release_functions(void);
 extern void
 _mesa_glsl_release_builtin_functions(void);
 
+extern void
+_mesa_glsl_release_unused_builtin_functions(void);
+
+extern void
+_mesa_glsl_hold_builtin_functions(void *owner);
+
 extern void
 reparent_ir(exec_list *list, void *mem_ctx);
 
@@ -65,10 +65,80 @@ enum lower_packing_builtins_op {
    LOWER_UNPACK_UNORM_4x8               = 0x0800
 };
 
+/**
+ * The passes run by do_common_optimization(), as tracked by
+ * opt_pass_tracker.
+ */
+enum opt_pass {
+   OPT_LOWER_SUB,
+   OPT_FUNCTION_INLINING,
+   OPT_DEAD_FUNCTIONS,
+   OPT_STRUCTURE_SPLITTING,
+   OPT_IF_SIMPLIFICATION,
+   OPT_FLATTEN_NESTED_IFS,
+   OPT_COPY_PROPAGATION,
+   OPT_COPY_PROPAGATION_ELEMENTS,
+   OPT_FLIP_MATRICES,
+   OPT_DEAD_CODE,
+   OPT_DEAD_CODE_LOCAL,
+   OPT_TREE_GRAFTING,
+   OPT_CONSTANT_PROPAGATION,
+   OPT_CONSTANT_VARIABLE,
+   OPT_CONSTANT_FOLDING,
+   OPT_ALGEBRAIC,
+   OPT_LOWER_JUMPS,
+   OPT_VEC_INDEX_TO_SWIZZLE,
+   OPT_LOWER_VECTOR_INSERT,
+   OPT_SWIZZLE_SWIZZLE,
+   OPT_NOOP_SWIZZLE,
+   OPT_SPLIT_ARRAYS,
+   OPT_REDUNDANT_JUMPS,
+   OPT_CSE,
+   OPT_LOOPS,               /**< loop analysis, controls and unrolling */
+   OPT_PASS_COUNT
+};
+
+/**
+ * Lets repeated calls of do_common_optimization() skip passes that can't
+ * make progress.
+ *
+ * A pass that ran without making progress finds nothing to do again until
+ * the IR changes.  The tracker numbers the states of the IR with a
+ * generation that every successful pass bumps, and remembers for each pass
+ * the generation at which it last found nothing to do.  Callers that change
+ * the IR with other passes between calls must call ir_changed().
+ */
+class opt_pass_tracker {
+public:
+   opt_pass_tracker();
+
+   bool should_run(enum opt_pass pass);
+   bool record(enum opt_pass pass, bool progress);
+
+   void ir_changed()
+   {
+      generation++;
+   }
+
+   unsigned runs;      /**< passes run */
+   unsigned skipped;   /**< passes skipped as unable to make progress */
+
+   /**
+    * Decisions of heuristic passes such as loop unrolling, appended to
+    * when not \c NULL.  Allocated with ralloc.
+    */
+   char *log;
+
+private:
+   unsigned generation;
+   unsigned clean[OPT_PASS_COUNT];
+};
+
 bool do_common_optimization(exec_list *ir, bool linked,
 			    bool uniform_locations_assigned,
 			    unsigned max_unroll_iterations,
-                            const struct gl_shader_compiler_options *options);
+                            const struct gl_shader_compiler_options *options,
+                            opt_pass_tracker *tracker = NULL);
 
 bool do_algebraic(exec_list *instructions);
 bool do_constant_folding(exec_list *instructions);
@@ -76,6 +146,7 @@ bool do_constant_variable(exec_list *instructions);
 bool do_constant_variable_unlinked(exec_list *instructions);
 bool do_copy_propagation(exec_list *instructions);
 bool do_copy_propagation_elements(exec_list *instructions);
+bool do_cse(exec_list *instructions);
 bool do_constant_propagation(exec_list *instructions);
 void do_dead_builtin_varyings(struct gl_context *ctx,
                               gl_shader *producer, gl_shader *consumer,
@@ -92,7 +163,8 @@ bool do_lower_texture_projection(exec_list *instructions);
 bool do_if_simplification(exec_list *instructions);
 bool opt_flatten_nested_if_blocks(exec_list *instructions);
 bool do_discard_simplification(exec_list *instructions);
-bool lower_if_to_cond_assign(exec_list *instructions, unsigned max_depth = 0);
+bool lower_if_to_cond_assign(exec_list *instructions, unsigned max_depth = 0,
+                             unsigned max_flatten_cost = 0);
 bool do_mat_op_to_vec(exec_list *instructions);
 bool do_noop_swizzle(exec_list *instructions);
 bool do_structure_splitting(exec_list *instructions);
@@ -124,6 +124,12 @@ struct gl_uniform_storage {
    unsigned num_driver_storage;
    struct gl_uniform_driver_storage *driver_storage;
 
+   /**
+    * Whether all of \c ::driver_storage is in \c uniform_native format, so
+    * that values of the uniform's own type can be copied in unconverted.
+    */
+   bool native_driver_storage;
+
    /**
     * Storage used by Mesa for the uniform
     *
@@ -288,6 +288,24 @@ tfeedback_decl::init(struct gl_context *ctx, const void *mem_ctx,
  * Determine whether two tfeedback_decl objects refer to the same variable and
  * array index (if applicable).
  */
+/**
+ * Name of the varying with the array subscript in a normalized form, so that
+ * two declarations have the same canonical name iff is_same() is true for
+ * them.  Allocated in mem_ctx.
+ */
+const char *
+tfeedback_decl::get_canonical_name(const void *mem_ctx) const
+{
+   assert(this->is_varying());
+
+   if (!this->is_subscripted)
+      return this->var_name;
+
+   return ralloc_asprintf(mem_ctx, "%s[%u]", this->var_name,
+                          this->array_subscript);
+}
+
+
 bool
 tfeedback_decl::is_same(const tfeedback_decl &x, const tfeedback_decl &y)
 {
@@ -497,6 +515,9 @@ parse_tfeedback_decls(struct gl_context *ctx, struct gl_shader_program *prog,
                       const void *mem_ctx, unsigned num_names,
                       char **varying_names, tfeedback_decl *decls)
 {
+   hash_table *seen = hash_table_ctor(0, hash_table_string_hash,
+                                      hash_table_string_compare);
+
    for (unsigned i = 0; i < num_names; ++i) {
       decls[i].init(ctx, mem_ctx, varying_names[i]);
 
@@ -513,17 +534,22 @@ parse_tfeedback_decls(struct gl_context *ctx, struct gl_shader_program *prog,
        * specify the same varying variable and array index", since transform
        * feedback of arrays would be useless otherwise.
        */
-      for (unsigned j = 0; j < i; ++j) {
-         if (!decls[j].is_varying())
-            continue;
-
-         if (tfeedback_decl::is_same(decls[i], decls[j])) {
-            linker_error(prog, "Transform feedback varying %s specified "
-                         "more than once.", varying_names[i]);
-            return false;
-         }
+      const char *const key = decls[i].get_canonical_name(mem_ctx);
+      const tfeedback_decl *const other =
+         (const tfeedback_decl *) hash_table_find(seen, key);
+
+      if (other) {
+         assert(tfeedback_decl::is_same(decls[i], *other));
+         linker_error(prog, "Transform feedback varying %s specified "
+                      "more than once.", varying_names[i]);
+         hash_table_dtor(seen);
+         return false;
       }
+
+      hash_table_insert(seen, &decls[i], key);
    }
+
+   hash_table_dtor(seen);
    return true;
 }
 
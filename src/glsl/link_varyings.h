@@ -128,6 +128,8 @@ public:
       return this->location;
    }
 
+   const char *get_canonical_name(const void *mem_ctx) const;
+
 private:
    /**
     * The name that was supplied to glTransformFeedbackVaryings.  Used for
@@ -64,6 +64,8 @@
  * \author Ian Romanick <ian.d.romanick@intel.com>
  */
 
+#include <time.h>
+
 #include "main/core.h"
 #include "glsl_symbol_table.h"
 #include "glsl_parser_extras.h"
@@ -1988,11 +1990,87 @@ check_resources(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 }
 
+/**
+ * Time spent in each phase of link_shaders(), printed with MESA_GLSL=linkstats.
+ */
+enum link_phase {
+   LINK_PHASE_INTRASTAGE,
+   LINK_PHASE_INTERSTAGE,
+   LINK_PHASE_OPTIMIZE,
+   LINK_PHASE_VARYINGS,
+   LINK_PHASE_UNIFORMS,
+   LINK_PHASE_COUNT
+};
+
+struct link_stats {
+   bool enabled;
+   uint64_t start;
+   uint64_t last;
+   uint64_t phase_us[LINK_PHASE_COUNT];
+};
+
+static uint64_t
+link_stats_time_us(void)
+{
+#ifdef CLOCK_MONOTONIC
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+   return (uint64_t) clock() * 1000000 / CLOCKS_PER_SEC;
+#endif
+}
+
+static void
+link_stats_init(struct link_stats *stats, bool enabled)
+{
+   memset(stats, 0, sizeof(*stats));
+   stats->enabled = enabled;
+   if (enabled)
+      stats->start = stats->last = link_stats_time_us();
+}
+
+/**
+ * Charge the time since the previous call to \c phase.
+ */
+static void
+link_stats_end_phase(struct link_stats *stats, enum link_phase phase)
+{
+   if (!stats->enabled)
+      return;
+
+   const uint64_t now = link_stats_time_us();
+   stats->phase_us[phase] += now - stats->last;
+   stats->last = now;
+}
+
+static void
+link_stats_print(const struct link_stats *stats,
+                 const struct gl_shader_program *prog)
+{
+   if (!stats->enabled)
+      return;
+
+   printf("GLSL link stats: program %u: intrastage=%u interstage=%u "
+          "optimize=%u varyings=%u uniforms=%u total=%u us%s\n",
+          prog->Name,
+          (unsigned) stats->phase_us[LINK_PHASE_INTRASTAGE],
+          (unsigned) stats->phase_us[LINK_PHASE_INTERSTAGE],
+          (unsigned) stats->phase_us[LINK_PHASE_OPTIMIZE],
+          (unsigned) stats->phase_us[LINK_PHASE_VARYINGS],
+          (unsigned) stats->phase_us[LINK_PHASE_UNIFORMS],
+          (unsigned) (link_stats_time_us() - stats->start),
+          prog->LinkStatus ? "" : " (failed)");
+}
+
 void
 link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 {
    tfeedback_decl *tfeedback_decls = NULL;
    unsigned num_tfeedback_decls = prog->TransformFeedback.NumVarying;
+   struct link_stats stats;
+
+   link_stats_init(&stats, (ctx->Shader.Flags & GLSL_LINK_STATS) != 0);
 
    void *mem_ctx = ralloc_context(NULL); // temporary linker context
 
@@ -2138,6 +2216,8 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 			     sh);
    }
 
+   link_stats_end_phase(&stats, LINK_PHASE_INTRASTAGE);
+
    /* Here begins the inter-stage linking phase.  Some initial validation is
     * performed, then locations are assigned for uniforms, attributes, and
     * varyings.
@@ -2196,6 +2276,8 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
    if (!interstage_cross_validate_uniform_blocks(prog))
       goto done;
 
+   link_stats_end_phase(&stats, LINK_PHASE_INTERSTAGE);
+
    /* Do common optimization before assigning storage for attributes,
     * uniforms, and varyings.  Later optimization could possibly make
     * some of that unused.
@@ -2214,10 +2296,23 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 
       unsigned max_unroll = ctx->ShaderCompilerOptions[i].MaxUnrollIterations;
 
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false, max_unroll, &ctx->ShaderCompilerOptions[i]))
+      opt_pass_tracker tracker;
+      if (ctx->Shader.Flags & GLSL_DUMP)
+         tracker.log = ralloc_strdup(mem_ctx, "");
+
+      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false, max_unroll, &ctx->ShaderCompilerOptions[i], &tracker))
 	 ;
+
+      if (tracker.log != NULL && tracker.log[0] != '\0') {
+         printf("GLSL loop unrolling for %s shader of program %d:\n",
+                _mesa_glsl_shader_target_name(prog->_LinkedShaders[i]->Type),
+                prog->Name);
+         printf("%s\n", tracker.log);
+      }
    }
 
+   link_stats_end_phase(&stats, LINK_PHASE_OPTIMIZE);
+
    /* Mark all generic shader inputs and outputs as unpaired. */
    if (prog->_LinkedShaders[MESA_SHADER_VERTEX] != NULL) {
       link_invalidate_variable_locations(
@@ -2365,11 +2460,14 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
    if (!store_tfeedback_info(ctx, prog, num_tfeedback_decls, tfeedback_decls))
       goto done;
 
+   link_stats_end_phase(&stats, LINK_PHASE_VARYINGS);
+
    update_array_sizes(prog);
    link_assign_uniform_locations(prog);
    store_fragdepth_layout(prog);
 
    check_resources(ctx, prog);
+   link_stats_end_phase(&stats, LINK_PHASE_UNIFORMS);
    if (!prog->LinkStatus)
       goto done;
 
@@ -2410,4 +2508,6 @@ done:
    }
 
    ralloc_free(mem_ctx);
+
+   link_stats_print(&stats, prog);
 }
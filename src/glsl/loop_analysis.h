@@ -56,8 +56,17 @@ extern bool
 set_loop_controls(exec_list *instructions, loop_state *ls);
 
 
+/**
+ * Unroll loops that a cost model expects to pay off
+ *
+ * Loops of up to \c max_iterations iterations are unrolled when, after the
+ * folding that known induction variable values allow, their unrolled bodies
+ * fit the instruction and temporary budgets in \c options.  When \c log is
+ * not \c NULL, the decision for each loop is appended to it.
+ */
 extern bool
-unroll_loops(exec_list *instructions, loop_state *ls, unsigned max_iterations);
+unroll_loops(exec_list *instructions, loop_state *ls, unsigned max_iterations,
+             const struct gl_shader_compiler_options *options, char **log);
 
 
 /**
@@ -24,16 +24,23 @@
 #include "glsl_types.h"
 #include "loop_analysis.h"
 #include "ir_hierarchical_visitor.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
 
 namespace {
 
 class loop_unroll_visitor : public ir_hierarchical_visitor {
 public:
-   loop_unroll_visitor(loop_state *state, unsigned max_iterations)
+   loop_unroll_visitor(loop_state *state, unsigned max_iterations,
+                       const struct gl_shader_compiler_options *options,
+                       char **log)
    {
       this->state = state;
       this->progress = false;
       this->max_iterations = max_iterations;
+      this->options = options;
+      this->log = log;
+      this->num_loops = 0;
    }
 
    virtual ir_visitor_status visit_leave(ir_loop *ir);
@@ -42,6 +49,18 @@ public:
 
    bool progress;
    unsigned max_iterations;
+   const struct gl_shader_compiler_options *options;
+
+private:
+   bool should_unroll(ir_loop *ir, loop_variable_state *ls, int iterations,
+                      unsigned loop, unsigned *instructions);
+   void report(unsigned loop, const char *fmt, ...) PRINTFLIKE(3, 4);
+
+   /** Unroll decisions, appended to when non-NULL */
+   char **log;
+
+   /** Number of loops seen, to identify them in the log */
+   unsigned num_loops;
 };
 
 } /* anonymous namespace */
@@ -53,39 +72,256 @@ is_break(ir_instruction *ir)
 		     && ((ir_loop_jump *) ir)->is_break();
 }
 
-class loop_unroll_count : public ir_hierarchical_visitor {
+/**
+ * Estimate the cost of one iteration of a loop once it is unrolled.
+ *
+ * In each unrolled copy of the body the induction variables have known
+ * values, so constant propagation and folding reduce expressions of
+ * induction variables and constants to constants, remove the updates of
+ * the induction variables, and turn array accesses they index into direct
+ * accesses.  Only what survives that counts.
+ */
+class loop_unroll_cost : public ir_hierarchical_visitor {
 public:
-   int nodes;
-   bool fail;
+   /** IR instructions left per iteration after folding */
+   unsigned cost;
+
+   /** Expressions and assignments expected to fold away per iteration */
+   unsigned folded;
+
+   /** vec4 temporaries declared by one copy of the body */
+   unsigned temps;
 
-   loop_unroll_count(exec_list *list)
+   /** Does the body index an array with an induction variable? */
+   bool constant_indexing;
+
+   /** Does the body contain another loop? */
+   bool nested;
+
+   loop_unroll_cost(loop_variable_state *ls, exec_list *list)
    {
-      nodes = 0;
-      fail = false;
+      this->ls = ls;
+      cost = 0;
+      folded = 0;
+      temps = 0;
+      constant_indexing = false;
+      nested = false;
 
       run(list);
    }
 
+   virtual ir_visitor_status visit(ir_variable *ir)
+   {
+      temps += MAX2((ir->type->component_slots() + 3) / 4, 1);
+      return visit_continue;
+   }
+
    virtual ir_visitor_status visit_enter(ir_assignment *ir)
    {
-      nodes++;
+      if (is_counter(ir->whole_variable_written())) {
+         folded++;
+         return visit_continue_with_parent;
+      }
+
+      cost++;
       return visit_continue;
    }
 
    virtual ir_visitor_status visit_enter(ir_expression *ir)
    {
-      nodes++;
+      if (folds(ir)) {
+         folded++;
+         return visit_continue_with_parent;
+      }
+
+      cost++;
       return visit_continue;
    }
 
-   virtual ir_visitor_status visit_enter(ir_loop *ir)
+   virtual ir_visitor_status visit_enter(ir_texture *ir)
    {
-      fail = true;
+      cost++;
       return visit_continue;
    }
+
+   virtual ir_visitor_status visit_enter(ir_call *ir)
+   {
+      cost++;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_if *ir)
+   {
+      if (folds(ir->condition))
+         folded++;
+      else
+         cost++;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_dereference_array *ir)
+   {
+      if (ir->array_index->as_constant() == NULL && folds(ir->array_index))
+         constant_indexing = true;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_loop *ir)
+   {
+      nested = true;
+      return visit_stop;
+   }
+
+private:
+   /**
+    * Is \c var an induction variable stepped by a constant?
+    *
+    * Its value in each unrolled copy follows from the value before the
+    * loop, which the iteration count analysis required to be known.
+    */
+   bool is_counter(ir_variable *var)
+   {
+      loop_variable *lv = var != NULL ? ls->get(var) : NULL;
+
+      return lv != NULL && lv->increment != NULL &&
+         lv->increment->as_constant() != NULL;
+   }
+
+   /** Is \c ir a constant in each unrolled copy of the body? */
+   bool folds(ir_rvalue *ir)
+   {
+      switch (ir->ir_type) {
+      case ir_type_constant:
+         return true;
+
+      case ir_type_dereference_variable: {
+         ir_variable *var = ((ir_dereference_variable *) ir)->var;
+
+         return var->constant_value != NULL || is_counter(var);
+      }
+
+      case ir_type_swizzle:
+         return folds(((ir_swizzle *) ir)->val);
+
+      case ir_type_expression: {
+         ir_expression *expr = (ir_expression *) ir;
+
+         for (unsigned i = 0; i < expr->get_num_operands(); i++) {
+            if (!folds(expr->operands[i]))
+               return false;
+         }
+         return true;
+      }
+
+      default:
+         return false;
+      }
+   }
+
+   loop_variable_state *ls;
 };
 
 
+void
+loop_unroll_visitor::report(unsigned loop, const char *fmt, ...)
+{
+   if (this->log == NULL)
+      return;
+
+   va_list args;
+
+   ralloc_asprintf_append(this->log, "loop %u: ", loop);
+   va_start(args, fmt);
+   ralloc_vasprintf_append(this->log, fmt, args);
+   va_end(args);
+   ralloc_strcat(this->log, "\n");
+}
+
+
+/**
+ * Decide from the cost model whether unrolling \c ir pays off.
+ *
+ * \param instructions_out  Estimated size of the unrolled loop
+ */
+bool
+loop_unroll_visitor::should_unroll(ir_loop *ir, loop_variable_state *ls,
+                                   int iterations, unsigned loop,
+                                   unsigned *instructions_out)
+{
+   /* Don't try to unroll loops where the number of iterations is not known
+    * at compile-time.
+    */
+   if (iterations < 0) {
+      report(loop, "kept, unknown iteration count");
+      return false;
+   }
+
+   /* Don't try to unroll loops that have zillions of iterations either.
+    */
+   if (iterations > (int) max_iterations) {
+      report(loop, "kept, %d iterations exceed the limit of %u",
+             iterations, max_iterations);
+      return false;
+   }
+
+   loop_unroll_cost cost(ls, &ir->body_instructions);
+
+   /* Don't try to unroll nested loops.
+    */
+   if (cost.nested) {
+      report(loop, "kept, contains a loop");
+      return false;
+   }
+
+   const unsigned instructions = cost.cost * iterations;
+
+   /* Hardware without loops can't run the loop any other way, so only the
+    * iteration limit applies.
+    */
+   if (options->EmitNoLoops) {
+      *instructions_out = instructions;
+      return true;
+   }
+
+   unsigned budget = options->MaxUnrollInstructions != 0
+      ? options->MaxUnrollInstructions : max_iterations * 5;
+
+   /* Accesses that become direct save the indirect addressing, or the
+    * if-ladders it is lowered to on hardware without it.
+    */
+   if (cost.constant_indexing)
+      budget *= 2;
+
+   if (instructions > budget) {
+      report(loop, "kept, %d iterations would leave %u instructions, "
+             "budget %u", iterations, instructions, budget);
+      return false;
+   }
+
+   /* The variables of one copy are dead once the next one starts, so the
+    * copies can share registers and the peak is that of a single copy.
+    */
+   if (options->MaxUnrollTemps != 0 && cost.temps > options->MaxUnrollTemps) {
+      report(loop, "kept, the body declares %u temporaries, budget %u",
+             cost.temps, options->MaxUnrollTemps);
+      return false;
+   }
+
+   /* Hardware that runs loops gains little from a large unrolled body
+    * where nothing folds.
+    */
+   if (cost.folded == 0 && !cost.constant_indexing &&
+       instructions > budget / 4) {
+      report(loop, "kept, %d iterations would leave %u instructions and "
+             "nothing folds", iterations, instructions);
+      return false;
+   }
+
+   *instructions_out = instructions;
+   return true;
+}
+
+
 ir_visitor_status
 loop_unroll_visitor::visit_leave(ir_loop *ir)
 {
@@ -102,27 +338,18 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
 
    iterations = ls->max_iterations;
 
-   /* Don't try to unroll loops where the number of iterations is not known
-    * at compile-time.
-    */
-   if (iterations < 0)
-      return visit_continue;
+   const unsigned loop = this->num_loops++;
 
-   /* Don't try to unroll loops that have zillions of iterations either.
-    */
-   if (iterations > (int) max_iterations)
+   if (ls->num_loop_jumps > 1) {
+      report(loop, "kept, %u loop jumps", ls->num_loop_jumps);
       return visit_continue;
+   }
 
-   /* Don't try to unroll nested loops and loops with a huge body.
-    */
-   loop_unroll_count count(&ir->body_instructions);
-
-   if (count.fail || count.nodes * iterations > (int)max_iterations * 5)
+   unsigned instructions;
+   if (!should_unroll(ir, ls, iterations, loop, &instructions))
       return visit_continue;
 
-   if (ls->num_loop_jumps > 1)
-      return visit_continue;
-   else if (ls->num_loop_jumps) {
+   if (ls->num_loop_jumps) {
       ir_instruction *last_ir = (ir_instruction *) ir->body_instructions.get_tail();
       assert(last_ir != NULL);
 
@@ -174,8 +401,10 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
             }
          }
 
-         if (break_ir == NULL)
+         if (break_ir == NULL) {
+            report(loop, "not unrolled, the loop jump is not a break");
             return visit_continue;
+         }
 
          /* move instructions after then if in the continue branch */
          while (!ir_if->get_next()->is_tail_sentinel()) {
@@ -219,6 +448,8 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
 
          ir_to_replace->remove();
 
+         report(loop, "unrolled %d iterations, about %u instructions",
+                iterations, instructions);
          this->progress = true;
          return visit_continue;
       }
@@ -240,15 +471,18 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
     */
    ir->remove();
 
+   report(loop, "unrolled %d iterations, about %u instructions",
+          iterations, instructions);
    this->progress = true;
    return visit_continue;
 }
 
 
 bool
-unroll_loops(exec_list *instructions, loop_state *ls, unsigned max_iterations)
+unroll_loops(exec_list *instructions, loop_state *ls, unsigned max_iterations,
+             const struct gl_shader_compiler_options *options, char **log)
 {
-   loop_unroll_visitor v(ls, max_iterations);
+   loop_unroll_visitor v(ls, max_iterations, options, log);
 
    v.run(instructions);
 
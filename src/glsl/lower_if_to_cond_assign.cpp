@@ -43,20 +43,33 @@
  *    lower_if_to_cond_assign(instructions, N)
  *
  * to attempt to flatten any if-statements appearing at depth > N.
+ *
+ * If-statements within the maximum depth are kept, unless their branches
+ * are so cheap that executing both costs less than branching.  Drivers
+ * that want those flattened pass the largest cost to flatten:
+ *
+ *    lower_if_to_cond_assign(instructions, N, cost)
+ *
+ * The cost of an if-statement is the number of assignments, expressions
+ * and texture lookups in its then and else blocks, a texture lookup
+ * counting as TEXTURE_COST.
  */
 
 #include "glsl_types.h"
 #include "ir.h"
 #include "program/hash_table.h"
 
+#define TEXTURE_COST 4
+
 namespace {
 
 class ir_if_to_cond_assign_visitor : public ir_hierarchical_visitor {
 public:
-   ir_if_to_cond_assign_visitor(unsigned max_depth)
+   ir_if_to_cond_assign_visitor(unsigned max_depth, unsigned max_flatten_cost)
    {
       this->progress = false;
       this->max_depth = max_depth;
+      this->max_flatten_cost = max_flatten_cost;
       this->depth = 0;
 
       this->condition_variables = hash_table_ctor(0, hash_table_pointer_hash,
@@ -73,6 +86,7 @@ public:
 
    bool progress;
    unsigned max_depth;
+   unsigned max_flatten_cost;
    unsigned depth;
 
    struct hash_table *condition_variables;
@@ -81,12 +95,13 @@ public:
 } /* anonymous namespace */
 
 bool
-lower_if_to_cond_assign(exec_list *instructions, unsigned max_depth)
+lower_if_to_cond_assign(exec_list *instructions, unsigned max_depth,
+                        unsigned max_flatten_cost)
 {
-   if (max_depth == UINT_MAX)
+   if (max_depth == UINT_MAX && max_flatten_cost == 0)
       return false;
 
-   ir_if_to_cond_assign_visitor v(max_depth);
+   ir_if_to_cond_assign_visitor v(max_depth, max_flatten_cost);
 
    visit_list_elements(&v, instructions);
 
@@ -110,6 +125,31 @@ check_control_flow(ir_instruction *ir, void *data)
    }
 }
 
+struct branch_cost {
+   bool found_control_flow;
+   unsigned cost;
+};
+
+static void
+check_control_flow_and_cost(ir_instruction *ir, void *data)
+{
+   struct branch_cost *bc = (struct branch_cost *) data;
+
+   check_control_flow(ir, &bc->found_control_flow);
+
+   switch (ir->ir_type) {
+   case ir_type_assignment:
+   case ir_type_expression:
+      bc->cost++;
+      break;
+   case ir_type_texture:
+      bc->cost += TEXTURE_COST;
+      break;
+   default:
+      break;
+   }
+}
+
 void
 move_block_to_cond_assign(void *mem_ctx,
 			  ir_if *if_ir, ir_rvalue *cond_expr,
@@ -170,23 +210,30 @@ ir_if_to_cond_assign_visitor::visit_enter(ir_if *ir)
 ir_visitor_status
 ir_if_to_cond_assign_visitor::visit_leave(ir_if *ir)
 {
-   /* Only flatten when beyond the GPU's maximum supported nesting depth. */
-   if (this->depth-- <= this->max_depth)
+   /* Flatten when beyond the GPU's maximum supported nesting depth, or
+    * when the branches are cheap enough.
+    */
+   const bool beyond_max_depth = this->depth-- > this->max_depth;
+
+   if (!beyond_max_depth && this->max_flatten_cost == 0)
       return visit_continue;
 
-   bool found_control_flow = false;
+   struct branch_cost bc = { false, 0 };
    ir_assignment *assign;
 
    /* Check that both blocks don't contain anything we can't support. */
    foreach_iter(exec_list_iterator, then_iter, ir->then_instructions) {
       ir_instruction *then_ir = (ir_instruction *)then_iter.get();
-      visit_tree(then_ir, check_control_flow, &found_control_flow);
+      visit_tree(then_ir, check_control_flow_and_cost, &bc);
    }
    foreach_iter(exec_list_iterator, else_iter, ir->else_instructions) {
       ir_instruction *else_ir = (ir_instruction *)else_iter.get();
-      visit_tree(else_ir, check_control_flow, &found_control_flow);
+      visit_tree(else_ir, check_control_flow_and_cost, &bc);
    }
-   if (found_control_flow)
+   if (bc.found_control_flow)
+      return visit_continue;
+
+   if (!beyond_max_depth && bc.cost > this->max_flatten_cost)
       return visit_continue;
 
    void *mem_ctx = ralloc_parent(ir);
@@ -31,16 +31,42 @@
  * This relieves drivers of the responsibility to deal with tricky UBO
  * layout issues like std140 structures and row_major matrices on
  * their own.
+ *
+ * The scalars and vectors a dereference is made of are loaded together
+ * when they share a vec4 of the block, as the members of a struct or the
+ * rows of a row_major matrix do, so that drivers see one load per vec4.
  */
 
 #include "ir.h"
 #include "ir_builder.h"
 #include "ir_rvalue_visitor.h"
 #include "main/macros.h"
+#include "program/prog_instruction.h"
 
 using namespace ir_builder;
 
 namespace {
+
+/**
+ * A scalar or vector of a dereference that emit_ubo_loads() has yet to
+ * load from the block.
+ */
+class ubo_load_entry : public exec_node {
+public:
+   ubo_load_entry(ir_dereference *lhs, const glsl_type *type,
+                  unsigned offset, unsigned write_mask)
+      : lhs(lhs), type(type), offset(offset), write_mask(write_mask),
+        done(false)
+   {
+   }
+
+   ir_dereference *lhs;
+   const glsl_type *type;
+   unsigned offset;     /**< From the start of the dereference, in bytes */
+   unsigned write_mask; /**< Of the assignment to lhs, 0 for all of it */
+   bool done;
+};
+
 class lower_ubo_reference_visitor : public ir_rvalue_enter_visitor {
 public:
    lower_ubo_reference_visitor(struct gl_shader *shader)
@@ -53,6 +79,12 @@ public:
 		       unsigned int deref_offset);
    ir_expression *ubo_load(const struct glsl_type *type,
 			   ir_rvalue *offset);
+   void add_ubo_load(ir_dereference *lhs, const glsl_type *type,
+		     unsigned offset, unsigned write_mask);
+   void flush_ubo_loads(ir_variable *base_offset);
+
+   /** List of ubo_load_entry */
+   exec_list pending_loads;
 
    void *mem_ctx;
    struct gl_shader *shader;
@@ -254,6 +286,7 @@ lower_ubo_reference_visitor::handle_rvalue(ir_rvalue **rvalue)
 
    deref = new(mem_ctx) ir_dereference_variable(load_var);
    emit_ubo_loads(deref, load_offset, const_offset);
+   flush_ubo_loads(load_offset);
    *rvalue = deref;
 
    progress = true;
@@ -340,10 +373,7 @@ lower_ubo_reference_visitor::emit_ubo_loads(ir_dereference *deref,
 	  deref->type->is_vector());
 
    if (!ubo_var->RowMajor) {
-      ir_rvalue *offset = add(base_offset,
-			      new(mem_ctx) ir_constant(deref_offset));
-      base_ir->insert_before(assign(deref->clone(mem_ctx, NULL),
-				    ubo_load(deref->type, offset)));
+      add_ubo_load(deref, deref->type, deref_offset, 0);
    } else {
       /* We're dereffing a column out of a row-major matrix, so we
        * gather the vector from each stored row.
@@ -357,16 +387,109 @@ lower_ubo_reference_visitor::emit_ubo_loads(ir_dereference *deref,
       unsigned matrix_stride = 16;
 
       for (unsigned i = 0; i < deref->type->vector_elements; i++) {
-	 ir_rvalue *chan_offset =
-	    add(base_offset,
-		new(mem_ctx) ir_constant(deref_offset + i * matrix_stride));
-
-	 base_ir->insert_before(assign(deref->clone(mem_ctx, NULL),
-				       ubo_load(glsl_type::float_type,
-						chan_offset),
-				       (1U << i)));
+	 add_ubo_load(deref, glsl_type::float_type,
+		      deref_offset + i * matrix_stride, 1U << i);
+      }
+   }
+}
+
+void
+lower_ubo_reference_visitor::add_ubo_load(ir_dereference *lhs,
+					  const glsl_type *type,
+					  unsigned offset,
+					  unsigned write_mask)
+{
+   pending_loads.push_tail(new(mem_ctx) ubo_load_entry(lhs, type, offset,
+							write_mask));
+}
+
+/**
+ * Emit the loads recorded by emit_ubo_loads(), one per vec4 of the block
+ * and base type, and assign their components to the dereferences.
+ */
+void
+lower_ubo_reference_visitor::flush_ubo_loads(ir_variable *base_offset)
+{
+   foreach_list(node, &pending_loads) {
+      ubo_load_entry *first = (ubo_load_entry *) node;
+
+      if (first->done)
+	 continue;
+
+      /* Find the components of the vec4 this is in that are loaded with
+       * the same type.
+       */
+      const unsigned vec4_offset = first->offset & ~15u;
+      unsigned first_comp = 4, last_comp = 0, count = 0;
+
+      for (exec_node *n = first; !n->is_tail_sentinel(); n = n->next) {
+	 ubo_load_entry *e = (ubo_load_entry *) n;
+
+	 if (e->done || (e->offset & ~15u) != vec4_offset ||
+	     e->type->base_type != first->type->base_type)
+	    continue;
+
+	 const unsigned comp = e->offset % 16 / 4;
+	 first_comp = MIN2(first_comp, comp);
+	 last_comp = MAX2(last_comp, comp + e->type->vector_elements - 1);
+	 count++;
+      }
+
+      if (count == 1) {
+	 ir_rvalue *offset = add(base_offset,
+				 new(mem_ctx) ir_constant(first->offset));
+	 ir_expression *load = ubo_load(first->type, offset);
+
+	 if (first->write_mask)
+	    base_ir->insert_before(assign(first->lhs->clone(mem_ctx, NULL),
+					  load, first->write_mask));
+	 else
+	    base_ir->insert_before(assign(first->lhs->clone(mem_ctx, NULL),
+					  load));
+	 first->done = true;
+	 continue;
+      }
+
+      const glsl_type *vec_type =
+	 glsl_type::get_instance(first->type->base_type,
+				 last_comp - first_comp + 1, 1);
+      ir_variable *vec = new(mem_ctx) ir_variable(vec_type,
+						  "ubo_load_vec",
+						  ir_var_temporary);
+      base_ir->insert_before(vec);
+
+      ir_rvalue *offset =
+	 add(base_offset,
+	     new(mem_ctx) ir_constant(vec4_offset + first_comp * 4));
+      base_ir->insert_before(assign(vec, ubo_load(vec_type, offset)));
+
+      for (exec_node *n = first; !n->is_tail_sentinel(); n = n->next) {
+	 ubo_load_entry *e = (ubo_load_entry *) n;
+
+	 if (e->done || (e->offset & ~15u) != vec4_offset ||
+	     e->type->base_type != first->type->base_type)
+	    continue;
+
+	 const unsigned comp = e->offset % 16 / 4 - first_comp;
+	 const unsigned n_comps = e->type->vector_elements;
+	 ir_swizzle *rhs =
+	    swizzle(vec,
+		    MAKE_SWIZZLE4(comp,
+				  comp + MIN2(1, n_comps - 1),
+				  comp + MIN2(2, n_comps - 1),
+				  comp + MIN2(3, n_comps - 1)),
+		    n_comps);
+
+	 if (e->write_mask)
+	    base_ir->insert_before(assign(e->lhs->clone(mem_ctx, NULL),
+					  rhs, e->write_mask));
+	 else
+	    base_ir->insert_before(assign(e->lhs->clone(mem_ctx, NULL), rhs));
+	 e->done = true;
       }
    }
+
+   pending_loads.make_empty();
 }
 
 } /* unnamed namespace */
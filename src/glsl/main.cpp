@@ -21,6 +21,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #include <getopt.h>
+#include <time.h>
+#include <sys/resource.h>
 
 /** @file main.cpp
  *
@@ -243,6 +245,7 @@ int dump_ast = 0;
 int dump_hir = 0;
 int dump_lir = 0;
 int do_link = 0;
+int bench_iterations = 0;
 
 const struct option compiler_opts[] = {
    { "dump-ast", no_argument, &dump_ast, 1 },
@@ -250,6 +253,7 @@ const struct option compiler_opts[] = {
    { "dump-lir", no_argument, &dump_lir, 1 },
    { "link",     no_argument, &do_link,  1 },
    { "version",  required_argument, NULL, 'v' },
+   { "bench",    required_argument, NULL, 'b' },
    { NULL, 0, NULL, 0 }
 };
 
@@ -263,6 +267,9 @@ usage_fail(const char *name)
    const char *header =
       "usage: %s [options] <file.vert | file.geom | file.frag>\n"
       "\n"
+      "With --bench <n>, the files are compiled and linked n times and the\n"
+      "time spent in each phase is reported.\n"
+      "\n"
       "Possible options are:\n";
    printf(header, name, name);
    for (const struct option *o = compiler_opts; o->name != 0; ++o) {
@@ -288,6 +295,214 @@ compile_shader(struct gl_context *ctx, struct gl_shader *shader)
    return;
 }
 
+
+/**
+ * Shader type from the file name extension, or 0.
+ */
+static GLenum
+shader_type_from_name(const char *name)
+{
+   const unsigned len = strlen(name);
+   if (len < 6)
+      return 0;
+
+   const char *const ext = & name[len - 5];
+   if (strncmp(".vert", ext, 5) == 0 || strncmp(".glsl", ext, 5) == 0)
+      return GL_VERTEX_SHADER;
+   else if (strncmp(".geom", ext, 5) == 0)
+      return GL_GEOMETRY_SHADER;
+   else if (strncmp(".frag", ext, 5) == 0)
+      return GL_FRAGMENT_SHADER;
+   else
+      return 0;
+}
+
+
+enum bench_phase {
+   BENCH_PREPROCESS,
+   BENCH_PARSE,
+   BENCH_AST_TO_HIR,
+   BENCH_OPTIMIZE,
+   BENCH_LINK,
+   BENCH_PHASES
+};
+
+static const char *const bench_phase_names[BENCH_PHASES] = {
+   "preprocess",
+   "parse",
+   "ast_to_hir",
+   "optimize",
+   "link",
+};
+
+struct bench_stats {
+   uint64_t ns[BENCH_PHASES];
+   size_t ralloc_bytes[BENCH_PHASES];  /**< allocated by the phase */
+   size_t ralloc_peak;
+};
+
+static uint64_t
+get_time_ns()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/**
+ * Account the time and ralloc memory since the last call to the phase.
+ */
+static void
+bench_phase_end(struct bench_stats *stats, enum bench_phase phase,
+                uint64_t *time, size_t *size)
+{
+   const uint64_t now = get_time_ns();
+   const size_t total = ralloc_total_size();
+
+   stats->ns[phase] += now - *time;
+   if (total > *size)
+      stats->ralloc_bytes[phase] += total - *size;
+   stats->ralloc_peak = MAX2(stats->ralloc_peak, total);
+
+   *time = get_time_ns();
+   *size = ralloc_total_size();
+}
+
+
+/**
+ * Run the phases of _mesa_glsl_compile_shader() one by one and time them.
+ * The results are thrown away, the shader itself is compiled again with
+ * _mesa_glsl_compile_shader() so that it can be linked.
+ */
+static void
+bench_compile_phases(struct gl_context *ctx, struct gl_shader *shader,
+                     struct bench_stats *stats)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   uint64_t time = get_time_ns();
+   size_t size = ralloc_total_size();
+
+   struct _mesa_glsl_parse_state *state =
+      new(mem_ctx) _mesa_glsl_parse_state(ctx, shader->Type, mem_ctx);
+   const char *source = shader->Source;
+
+   state->error = glcpp_preprocess(state, &source, &state->info_log,
+                                   &ctx->Extensions, ctx);
+   bench_phase_end(stats, BENCH_PREPROCESS, &time, &size);
+
+   if (!state->error) {
+      _mesa_glsl_lexer_ctor(state, source);
+      _mesa_glsl_parse(state);
+      _mesa_glsl_lexer_dtor(state);
+   }
+   bench_phase_end(stats, BENCH_PARSE, &time, &size);
+
+   exec_list *ir = new(mem_ctx) exec_list;
+   if (!state->error && !state->translation_unit.is_empty())
+      _mesa_ast_to_hir(ir, state);
+   bench_phase_end(stats, BENCH_AST_TO_HIR, &time, &size);
+
+   if (!state->error && !ir->is_empty()) {
+      struct gl_shader_compiler_options *options =
+         &ctx->ShaderCompilerOptions[_mesa_shader_type_to_index(shader->Type)];
+      opt_pass_tracker tracker;
+
+      while (do_common_optimization(ir, false, false, 32, options, &tracker))
+         ;
+   }
+   bench_phase_end(stats, BENCH_OPTIMIZE, &time, &size);
+
+   ralloc_free(mem_ctx);
+}
+
+
+/**
+ * Compile and link the given files the given number of times, and print
+ * the average time and ralloc memory of each phase.  The first round
+ * isn't counted, as it also builds the built-in functions.
+ */
+static int
+run_bench(struct gl_context *ctx, int iterations,
+          int num_files, char *const *files)
+{
+   struct bench_stats stats;
+   struct rusage usage;
+
+   memset(&stats, 0, sizeof(stats));
+   ralloc_enable_total_size();
+
+   for (int i = -1; i < iterations; i++) {
+      struct bench_stats round;
+      memset(&round, 0, sizeof(round));
+
+      struct gl_shader_program *prog = rzalloc(NULL, struct gl_shader_program);
+      prog->InfoLog = ralloc_strdup(prog, "");
+      prog->Shaders = rzalloc_array(prog, struct gl_shader *, num_files);
+
+      for (int f = 0; f < num_files; f++) {
+         struct gl_shader *shader = rzalloc(prog, gl_shader);
+
+         shader->Type = shader_type_from_name(files[f]);
+         shader->Source = load_text_file(prog, files[f]);
+         if (shader->Type == 0 || shader->Source == NULL) {
+            printf("Can't load \"%s\".\n", files[f]);
+            return EXIT_FAILURE;
+         }
+
+         prog->Shaders[prog->NumShaders++] = shader;
+
+         bench_compile_phases(ctx, shader, &round);
+
+         _mesa_glsl_compile_shader(ctx, shader, false, false);
+         if (!shader->CompileStatus) {
+            printf("Info log for %s:\n%s\n", files[f], shader->InfoLog);
+            return EXIT_FAILURE;
+         }
+      }
+
+      uint64_t time = get_time_ns();
+      size_t size = ralloc_total_size();
+      link_shaders(ctx, prog);
+      bench_phase_end(&round, BENCH_LINK, &time, &size);
+
+      if (!prog->LinkStatus) {
+         printf("Info log for linking:\n%s\n", prog->InfoLog);
+         return EXIT_FAILURE;
+      }
+
+      for (unsigned j = 0; j < MESA_SHADER_TYPES; j++)
+         ralloc_free(prog->_LinkedShaders[j]);
+      ralloc_free(prog);
+
+      if (i < 0)
+         continue;
+
+      for (unsigned p = 0; p < BENCH_PHASES; p++) {
+         stats.ns[p] += round.ns[p];
+         stats.ralloc_bytes[p] += round.ralloc_bytes[p];
+      }
+      stats.ralloc_peak = MAX2(stats.ralloc_peak, round.ralloc_peak);
+   }
+
+   uint64_t total_ns = 0;
+   printf("%-12s %12s %14s\n", "phase", "usec", "ralloc bytes");
+   for (unsigned p = 0; p < BENCH_PHASES; p++) {
+      total_ns += stats.ns[p];
+      printf("%-12s %12.1f %14lu\n", bench_phase_names[p],
+             stats.ns[p] / 1000.0 / iterations,
+             (unsigned long) (stats.ralloc_bytes[p] / iterations));
+   }
+   printf("%-12s %12.1f\n", "total", total_ns / 1000.0 / iterations);
+
+   printf("\nralloc peak: %lu bytes\n", (unsigned long) stats.ralloc_peak);
+   if (getrusage(RUSAGE_SELF, &usage) == 0)
+      printf("peak rss: %ld KiB\n", usage.ru_maxrss);
+
+   return EXIT_SUCCESS;
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -321,6 +536,11 @@ main(int argc, char **argv)
             break;
          }
          break;
+      case 'b':
+         bench_iterations = strtol(optarg, NULL, 10);
+         if (bench_iterations < 1)
+            usage_fail(argv[0]);
+         break;
       default:
          break;
       }
@@ -332,6 +552,15 @@ main(int argc, char **argv)
 
    initialize_context(ctx, (glsl_es) ? API_OPENGLES2 : API_OPENGL_COMPAT);
 
+   if (bench_iterations) {
+      status = run_bench(ctx, bench_iterations, argc - optind, argv + optind);
+
+      _mesa_glsl_release_types();
+      _mesa_glsl_release_builtin_functions();
+
+      return status;
+   }
+
    struct gl_shader_program *whole_program;
 
    whole_program = rzalloc (NULL, struct gl_shader_program);
@@ -349,18 +578,8 @@ main(int argc, char **argv)
       whole_program->Shaders[whole_program->NumShaders] = shader;
       whole_program->NumShaders++;
 
-      const unsigned len = strlen(argv[optind]);
-      if (len < 6)
-	 usage_fail(argv[0]);
-
-      const char *const ext = & argv[optind][len - 5];
-      if (strncmp(".vert", ext, 5) == 0 || strncmp(".glsl", ext, 5) == 0)
-	 shader->Type = GL_VERTEX_SHADER;
-      else if (strncmp(".geom", ext, 5) == 0)
-	 shader->Type = GL_GEOMETRY_SHADER;
-      else if (strncmp(".frag", ext, 5) == 0)
-	 shader->Type = GL_FRAGMENT_SHADER;
-      else
+      shader->Type = shader_type_from_name(argv[optind]);
+      if (shader->Type == 0)
 	 usage_fail(argv[0]);
 
       shader->Source = load_text_file(whole_program, argv[optind]);
@@ -0,0 +1,664 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_cse.cpp
+ *
+ * Common subexpression elimination within basic blocks.
+ *
+ * Each basic block keeps the expressions and texture lookups it has
+ * computed so far in a hash table, looked up by a structural hash.  When an
+ * equal value is computed again before any of the variables it reads is
+ * written, the first computation is moved into a temporary, and both places
+ * read the temporary instead.  The values are also indexed by the variables
+ * they read, so that an assignment only visits the values it invalidates.
+ *
+ * The values are forgotten at every control flow boundary and after function
+ * calls, which may write any variable through their out parameters.
+ */
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_rvalue_visitor.h"
+#include "ir_optimization.h"
+#include "glsl_types.h"
+#include "main/hash_table.h"
+
+namespace {
+
+class ae_entry;
+
+/**
+ * A variable read by an ae_entry, in the list of the entries reading it.
+ */
+class ae_use : public exec_node {
+public:
+   ae_use(ae_entry *entry)
+      : entry(entry)
+   {
+   }
+
+   ae_entry *entry;
+};
+
+/**
+ * A value available in the current basic block.
+ */
+class ae_entry : public exec_node {
+public:
+   ae_entry(ir_instruction *base_ir, ir_rvalue **val, unsigned hash)
+      : base_ir(base_ir), val(val), expr(*val), hash(hash), var(NULL),
+        uses(NULL), num_uses(0)
+   {
+   }
+
+   /** Instruction before which the value can be moved to a temporary */
+   ir_instruction *base_ir;
+
+   /** Where the value was first computed */
+   ir_rvalue **val;
+
+   /** The value itself, which stays valid after it is moved */
+   ir_rvalue *expr;
+
+   unsigned hash;
+
+   /** Temporary holding the value, once there is a second use */
+   ir_variable *var;
+
+   /**
+    * One per variable the value read when it was recorded.  Parts of the
+    * value that are moved to temporaries later don't update them, which
+    * only makes kill() forget it more eagerly.
+    */
+   ae_use **uses;
+   unsigned num_uses;
+};
+
+class cse_visitor : public ir_rvalue_visitor {
+public:
+   cse_visitor()
+   {
+      this->progress = false;
+      this->mem_ctx = ralloc_context(NULL);
+      this->values = _mesa_hash_table_create(this->mem_ctx, rvalues_equal);
+      this->var_uses = _mesa_hash_table_create(this->mem_ctx,
+                                               _mesa_key_pointer_equal);
+   }
+
+   ~cse_visitor()
+   {
+      ralloc_free(this->mem_ctx);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_function_signature *ir);
+   virtual ir_visitor_status visit_enter(ir_loop *ir);
+   virtual ir_visitor_status visit_enter(ir_if *ir);
+   virtual ir_visitor_status visit_leave(ir_assignment *ir);
+   virtual ir_visitor_status visit_leave(ir_call *ir);
+
+   virtual void handle_rvalue(ir_rvalue **rvalue);
+
+   bool progress;
+
+private:
+   static bool rvalues_equal(const void *a, const void *b);
+
+   void add(ir_rvalue **rvalue, unsigned hash);
+   void forget(ae_entry *entry);
+   void end_block();
+   void kill(ir_variable *var);
+   void forget_contained(ir_instruction *base_ir, ir_rvalue *tree,
+                         ae_entry *except);
+   void materialize(ae_entry *entry);
+
+   /** Parent of the entries and the tables */
+   void *mem_ctx;
+
+   /** The available values, in the order they were computed */
+   exec_list ae;
+
+   /** The available values, keyed by ae_entry::expr */
+   struct hash_table *values;
+
+   /** ir_variable -> list of the ae_use of the values reading it */
+   struct hash_table *var_uses;
+};
+
+
+/**
+ * Collect the variables an rvalue reads, each once.
+ */
+class read_vars_visitor : public ir_hierarchical_visitor {
+public:
+   read_vars_visitor(void *mem_ctx)
+      : mem_ctx(mem_ctx), vars(NULL), num_vars(0)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      for (unsigned i = 0; i < num_vars; i++) {
+         if (vars[i] == ir->var)
+            return visit_continue;
+      }
+
+      vars = reralloc(mem_ctx, vars, ir_variable *, num_vars + 1);
+      vars[num_vars++] = ir->var;
+      return visit_continue;
+   }
+
+   void *mem_ctx;
+   ir_variable **vars;
+   unsigned num_vars;
+};
+
+
+class contains_visitor : public ir_hierarchical_visitor {
+public:
+   contains_visitor(const ir_instruction *target)
+      : target(target), found(false)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      return check(ir);
+   }
+
+   virtual ir_visitor_status visit(ir_constant *ir)
+   {
+      if (ir == target) {
+         found = true;
+         return visit_stop;
+      }
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_expression *ir)
+   {
+      return check(ir);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_texture *ir)
+   {
+      return check(ir);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_swizzle *ir)
+   {
+      return check(ir);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_dereference_array *ir)
+   {
+      return check(ir);
+   }
+
+   virtual ir_visitor_status visit_enter(ir_dereference_record *ir)
+   {
+      return check(ir);
+   }
+
+   const ir_instruction *target;
+   bool found;
+
+private:
+   ir_visitor_status check(ir_instruction *ir)
+   {
+      if (ir == target) {
+         found = true;
+         return visit_stop;
+      }
+      return visit_continue;
+   }
+};
+
+} /* unnamed namespace */
+
+
+/** Is \c node part of \c tree? */
+static bool
+contains(ir_rvalue *tree, const ir_instruction *node)
+{
+   contains_visitor v(node);
+   tree->accept(&v);
+   return v.found;
+}
+
+static unsigned
+hash_rvalue(const ir_rvalue *ir)
+{
+   if (ir == NULL)
+      return 0;
+
+   unsigned hash = ir->ir_type * 31u + (unsigned) (uintptr_t) ir->type;
+
+   switch (ir->ir_type) {
+   case ir_type_dereference_variable:
+      return hash ^ (unsigned) (uintptr_t)
+         ((const ir_dereference_variable *) ir)->var;
+
+   case ir_type_dereference_array: {
+      const ir_dereference_array *deref = (const ir_dereference_array *) ir;
+      return hash ^ (hash_rvalue(deref->array) * 7) ^
+         hash_rvalue(deref->array_index);
+   }
+
+   case ir_type_dereference_record: {
+      const ir_dereference_record *deref = (const ir_dereference_record *) ir;
+      return hash ^ hash_rvalue(deref->record);
+   }
+
+   case ir_type_swizzle: {
+      const ir_swizzle *swiz = (const ir_swizzle *) ir;
+      return hash ^ hash_rvalue(swiz->val) ^
+         (swiz->mask.x | swiz->mask.y << 2 | swiz->mask.z << 4 |
+          swiz->mask.w << 6 | swiz->mask.num_components << 8);
+   }
+
+   case ir_type_constant: {
+      const ir_constant *c = (const ir_constant *) ir;
+      for (unsigned i = 0; i < c->type->components(); i++)
+         hash = hash * 31 + c->value.u[i];
+      return hash;
+   }
+
+   case ir_type_expression: {
+      const ir_expression *expr = (const ir_expression *) ir;
+      hash = hash * 31 + expr->operation;
+      for (unsigned i = 0; i < expr->get_num_operands(); i++)
+         hash = hash * 31 + hash_rvalue(expr->operands[i]);
+      return hash;
+   }
+
+   case ir_type_texture: {
+      const ir_texture *tex = (const ir_texture *) ir;
+      return hash * 31 + tex->op + hash_rvalue(tex->sampler) +
+         hash_rvalue(tex->coordinate) * 31;
+   }
+
+   default:
+      return hash;
+   }
+}
+
+static bool
+equal_rvalues(const ir_rvalue *a, const ir_rvalue *b)
+{
+   if (a == b)
+      return true;
+
+   if (a == NULL || b == NULL ||
+       a->ir_type != b->ir_type || a->type != b->type)
+      return false;
+
+   switch (a->ir_type) {
+   case ir_type_dereference_variable:
+      return ((const ir_dereference_variable *) a)->var ==
+         ((const ir_dereference_variable *) b)->var;
+
+   case ir_type_dereference_array: {
+      const ir_dereference_array *da = (const ir_dereference_array *) a;
+      const ir_dereference_array *db = (const ir_dereference_array *) b;
+      return equal_rvalues(da->array, db->array) &&
+         equal_rvalues(da->array_index, db->array_index);
+   }
+
+   case ir_type_dereference_record: {
+      const ir_dereference_record *da = (const ir_dereference_record *) a;
+      const ir_dereference_record *db = (const ir_dereference_record *) b;
+      return strcmp(da->field, db->field) == 0 &&
+         equal_rvalues(da->record, db->record);
+   }
+
+   case ir_type_swizzle: {
+      const ir_swizzle *sa = (const ir_swizzle *) a;
+      const ir_swizzle *sb = (const ir_swizzle *) b;
+      return sa->mask.x == sb->mask.x &&
+         sa->mask.y == sb->mask.y &&
+         sa->mask.z == sb->mask.z &&
+         sa->mask.w == sb->mask.w &&
+         sa->mask.num_components == sb->mask.num_components &&
+         equal_rvalues(sa->val, sb->val);
+   }
+
+   case ir_type_constant:
+      return ((const ir_constant *) a)->has_value((const ir_constant *) b);
+
+   case ir_type_expression: {
+      const ir_expression *ea = (const ir_expression *) a;
+      const ir_expression *eb = (const ir_expression *) b;
+
+      if (ea->operation != eb->operation)
+         return false;
+
+      for (unsigned i = 0; i < ea->get_num_operands(); i++) {
+         if (!equal_rvalues(ea->operands[i], eb->operands[i]))
+            return false;
+      }
+      return true;
+   }
+
+   case ir_type_texture: {
+      const ir_texture *ta = (const ir_texture *) a;
+      const ir_texture *tb = (const ir_texture *) b;
+
+      if (ta->op != tb->op ||
+          !equal_rvalues(ta->sampler, tb->sampler) ||
+          !equal_rvalues(ta->coordinate, tb->coordinate) ||
+          !equal_rvalues(ta->projector, tb->projector) ||
+          !equal_rvalues(ta->shadow_comparitor, tb->shadow_comparitor) ||
+          !equal_rvalues(ta->offset, tb->offset))
+         return false;
+
+      switch (ta->op) {
+      case ir_tex:
+      case ir_lod:
+      case ir_query_levels:
+         return true;
+      case ir_txb:
+         return equal_rvalues(ta->lod_info.bias, tb->lod_info.bias);
+      case ir_txf:
+      case ir_txl:
+      case ir_txs:
+         return equal_rvalues(ta->lod_info.lod, tb->lod_info.lod);
+      case ir_txf_ms:
+         return equal_rvalues(ta->lod_info.sample_index,
+                              tb->lod_info.sample_index);
+      case ir_txd:
+         return equal_rvalues(ta->lod_info.grad.dPdx, tb->lod_info.grad.dPdx) &&
+            equal_rvalues(ta->lod_info.grad.dPdy, tb->lod_info.grad.dPdy);
+      case ir_tg4:
+         return equal_rvalues(ta->lod_info.component,
+                              tb->lod_info.component);
+      }
+      return false;
+   }
+
+   default:
+      return false;
+   }
+}
+
+/**
+ * Is \c ir worth keeping in a temporary when it's computed twice?
+ *
+ * Negation and absolute value are free source modifiers for most
+ * backends, so a temporary would only cost a move.
+ */
+static bool
+is_cse_candidate(ir_rvalue *ir)
+{
+   if (!ir->type->is_numeric() && !ir->type->is_boolean())
+      return false;
+
+   if (ir->ir_type == ir_type_texture)
+      return true;
+
+   ir_expression *expr = ir->as_expression();
+   if (expr == NULL)
+      return false;
+
+   return expr->operation != ir_unop_neg && expr->operation != ir_unop_abs;
+}
+
+
+bool
+cse_visitor::rvalues_equal(const void *a, const void *b)
+{
+   return equal_rvalues((const ir_rvalue *) a, (const ir_rvalue *) b);
+}
+
+/** Record the value at \c rvalue, computed by \c base_ir. */
+void
+cse_visitor::add(ir_rvalue **rvalue, unsigned hash)
+{
+   ae_entry *entry = new(this->mem_ctx) ae_entry(this->base_ir, rvalue, hash);
+   read_vars_visitor v(this->mem_ctx);
+
+   (*rvalue)->accept(&v);
+
+   entry->uses = ralloc_array(this->mem_ctx, ae_use *, v.num_vars);
+   for (unsigned i = 0; i < v.num_vars; i++) {
+      const uint32_t var_hash = _mesa_hash_pointer(v.vars[i]);
+      struct hash_entry *e =
+         _mesa_hash_table_search(this->var_uses, var_hash, v.vars[i]);
+      exec_list *list;
+
+      if (e != NULL) {
+         list = (exec_list *) e->data;
+      } else {
+         list = new(this->mem_ctx) exec_list;
+         _mesa_hash_table_insert(this->var_uses, var_hash, v.vars[i], list);
+      }
+
+      entry->uses[i] = new(this->mem_ctx) ae_use(entry);
+      list->push_tail(entry->uses[i]);
+   }
+   entry->num_uses = v.num_vars;
+   ralloc_free(v.vars);
+
+   this->ae.push_tail(entry);
+   _mesa_hash_table_insert(this->values, hash, entry->expr, entry);
+}
+
+/** Remove \c entry from the list and the tables. */
+void
+cse_visitor::forget(ae_entry *entry)
+{
+   struct hash_entry *e =
+      _mesa_hash_table_search(this->values, entry->hash, entry->expr);
+
+   /* An equal value recorded later may have replaced the entry. */
+   if (e != NULL && e->data == entry)
+      _mesa_hash_table_remove(this->values, e);
+
+   for (unsigned i = 0; i < entry->num_uses; i++)
+      entry->uses[i]->remove();
+
+   entry->remove();
+}
+
+void
+cse_visitor::end_block()
+{
+   foreach_list_safe(n, &this->ae)
+      forget((ae_entry *) n);
+}
+
+/** Forget the values that read \c var. */
+void
+cse_visitor::kill(ir_variable *var)
+{
+   struct hash_entry *e =
+      _mesa_hash_table_search(this->var_uses, _mesa_hash_pointer(var), var);
+
+   if (e == NULL)
+      return;
+
+   /* An entry has a single use per variable, so forgetting it only removes
+    * the current node from this list.
+    */
+   foreach_list_safe(n, (exec_list *) e->data)
+      forget(((ae_use *) n)->entry);
+}
+
+/** Forget the values of \c base_ir that are part of \c tree. */
+void
+cse_visitor::forget_contained(ir_instruction *base_ir, ir_rvalue *tree,
+                              ae_entry *except)
+{
+   foreach_list_safe(n, &this->ae) {
+      ae_entry *entry = (ae_entry *) n;
+
+      if (entry != except && entry->base_ir == base_ir &&
+          contains(tree, entry->expr))
+         forget(entry);
+   }
+}
+
+/**
+ * Move the first computation of \c entry into a temporary.
+ */
+void
+cse_visitor::materialize(ae_entry *entry)
+{
+   if (entry->var != NULL)
+      return;
+
+   void *ctx = ralloc_parent(entry->expr);
+   ir_variable *var = new(ctx) ir_variable(entry->expr->type, "cse",
+                                           ir_var_temporary);
+   ir_assignment *assign =
+      new(ctx) ir_assignment(new(ctx) ir_dereference_variable(var),
+                             entry->expr, NULL);
+
+   entry->base_ir->insert_before(var);
+   entry->base_ir->insert_before(assign);
+   *entry->val = new(ctx) ir_dereference_variable(var);
+
+   /* Values inside the moved tree now have to be computed before the new
+    * assignment rather than the instruction the tree came from.  Values
+    * around it now read the temporary, so hash them again for the
+    * enclosing expressions of the next copy to match.
+    */
+   foreach_list(n, &this->ae) {
+      ae_entry *other = (ae_entry *) n;
+
+      if (other == entry || other->base_ir != entry->base_ir)
+         continue;
+
+      if (contains(entry->expr, other->expr)) {
+         other->base_ir = assign;
+         continue;
+      }
+
+      struct hash_entry *e =
+         _mesa_hash_table_search(this->values, other->hash, other->expr);
+      if (e != NULL && e->data == other)
+         _mesa_hash_table_remove(this->values, e);
+
+      other->hash = hash_rvalue(other->expr);
+      if (_mesa_hash_table_search(this->values, other->hash,
+                                  other->expr) == NULL)
+         _mesa_hash_table_insert(this->values, other->hash, other->expr,
+                                 other);
+   }
+
+   entry->base_ir = assign;
+   entry->var = var;
+}
+
+void
+cse_visitor::handle_rvalue(ir_rvalue **rvalue)
+{
+   if (*rvalue == NULL || !is_cse_candidate(*rvalue))
+      return;
+
+   const unsigned hash = hash_rvalue(*rvalue);
+   struct hash_entry *e = _mesa_hash_table_search(this->values, hash, *rvalue);
+
+   if (e == NULL) {
+      add(rvalue, hash);
+      return;
+   }
+
+   ae_entry *entry = (ae_entry *) e->data;
+
+   materialize(entry);
+
+   /* Values recorded for the parts of this copy are about to go away
+    * with it.
+    */
+   forget_contained(this->base_ir, *rvalue, entry);
+
+   void *ctx = ralloc_parent(*rvalue);
+   *rvalue = new(ctx) ir_dereference_variable(entry->var);
+   this->progress = true;
+}
+
+ir_visitor_status
+cse_visitor::visit_enter(ir_function_signature *ir)
+{
+   end_block();
+   visit_list_elements(this, &ir->body);
+   end_block();
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+cse_visitor::visit_enter(ir_loop *ir)
+{
+   end_block();
+   visit_list_elements(this, &ir->body_instructions);
+   end_block();
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+cse_visitor::visit_enter(ir_if *ir)
+{
+   /* The condition is evaluated in the enclosing block. */
+   ir->condition->accept(this);
+   handle_rvalue(&ir->condition);
+
+   end_block();
+   visit_list_elements(this, &ir->then_instructions);
+   end_block();
+   visit_list_elements(this, &ir->else_instructions);
+   end_block();
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+cse_visitor::visit_leave(ir_assignment *ir)
+{
+   ir_visitor_status s = ir_rvalue_visitor::visit_leave(ir);
+
+   kill(ir->lhs->variable_referenced());
+
+   return s;
+}
+
+ir_visitor_status
+cse_visitor::visit_leave(ir_call *ir)
+{
+   ir_visitor_status s = ir_rvalue_visitor::visit_leave(ir);
+
+   /* Out parameters and the return value may write anything. */
+   end_block();
+
+   return s;
+}
+
+bool
+do_cse(exec_list *instructions)
+{
+   cse_visitor v;
+
+   visit_list_elements(&v, instructions);
+
+   return v.progress;
+}
@@ -32,6 +32,12 @@ extern void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 			  bool dump_ast, bool dump_hir);
 
+extern void
+_mesa_glsl_discard_shader_ir(struct gl_shader *shader);
+
+extern void
+_mesa_glsl_restore_shader_ir(struct gl_context *ctx, struct gl_shader *shader);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -51,11 +51,38 @@ _CRTIMP int _vscprintf(const char *format, va_list argptr);
 
 #define CANARY 0x5A1106
 
+/* Bytes allocated through ralloc, headers included, see ralloc_total_size().
+ * Kept with atomic adds, as contexts are used from several threads, and
+ * only once ralloc_enable_total_size() was called.
+ */
+static size_t total_size;
+static bool total_size_enabled;
+
+#if defined(__GNUC__)
+#define total_size_add(n) __sync_fetch_and_add(&total_size, (size_t) (n))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#ifdef _WIN64
+#define total_size_add(n) \
+   _InterlockedExchangeAdd64((volatile __int64 *) &total_size, (__int64) (n))
+#else
+#define total_size_add(n) \
+   _InterlockedExchangeAdd((volatile long *) &total_size, (long) (n))
+#endif
+#else
+#define total_size_add(n) (total_size += (size_t) (n))
+#endif
+
 struct ralloc_header
 {
    /* A canary value used to determine whether a pointer is ralloc'd. */
    unsigned canary;
 
+   /* Bytes of the block, header included, counted in total_size.  0 for
+    * blocks allocated before counting was enabled.
+    */
+   size_t size;
+
    struct ralloc_header *parent;
 
    /* The first child (head of a linked list) */
@@ -118,6 +145,10 @@ ralloc_size(const void *ctx, size_t size)
    add_child(parent, info);
 
    info->canary = CANARY;
+   if (unlikely(total_size_enabled)) {
+      info->size = size + sizeof(ralloc_header);
+      total_size_add(info->size);
+   }
 
    return PTR_FROM_HEADER(info);
 }
@@ -136,13 +167,20 @@ static void *
 resize(void *ptr, size_t size)
 {
    ralloc_header *child, *old, *info;
+   size_t old_size;
 
    old = get_header(ptr);
+   old_size = old->size;
    info = realloc(old, size + sizeof(ralloc_header));
 
    if (info == NULL)
       return NULL;
 
+   if (unlikely(total_size_enabled)) {
+      info->size = size + sizeof(ralloc_header);
+      total_size_add(info->size - old_size);
+   }
+
    /* Update parent and sibling's links to the reallocated node. */
    if (info != old && info->parent != NULL) {
       if (info->parent->child == old)
@@ -246,6 +284,8 @@ unsafe_free(ralloc_header *info)
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
+   if (unlikely(info->size))
+      total_size_add(-info->size);
    free(info);
 }
 
@@ -295,6 +335,18 @@ ralloc_autofree_context(void)
    return autofree_context;
 }
 
+void
+ralloc_enable_total_size(void)
+{
+   total_size_enabled = true;
+}
+
+size_t
+ralloc_total_size(void)
+{
+   return total_size;
+}
+
 void
 ralloc_set_destructor(const void *ptr, void(*destructor)(void *))
 {
@@ -484,3 +536,109 @@ ralloc_vasprintf_rewrite_tail(char **str, size_t *start, const char *fmt,
    *start += new_length;
    return true;
 }
+
+/*
+ * Linear allocation
+ */
+
+#define LINEAR_CANARY 0x5A1107
+
+/* Chunks hold at least this much, larger allocations get their own chunk. */
+#define LINEAR_CHUNK_SIZE (32 * 1024)
+
+#define LINEAR_ALIGN(n) (((n) + 7) & ~(size_t) 7)
+
+struct linear_chunk
+{
+   size_t size;
+   size_t used;
+};
+
+struct linear_ctx
+{
+   unsigned canary;
+
+   /* The chunk being filled, a ralloc child of the linear context like all
+    * the others.
+    */
+   struct linear_chunk *current;
+};
+
+static struct linear_chunk *
+linear_new_chunk(struct linear_ctx *lin, size_t size)
+{
+   struct linear_chunk *chunk =
+      ralloc_size(lin, LINEAR_ALIGN(sizeof(struct linear_chunk)) + size);
+
+   if (unlikely(chunk == NULL))
+      return NULL;
+
+   chunk->size = size;
+   chunk->used = 0;
+   return chunk;
+}
+
+void *
+linear_context(const void *ctx)
+{
+   struct linear_ctx *lin = ralloc_size(ctx, sizeof(struct linear_ctx));
+
+   if (unlikely(lin == NULL))
+      return NULL;
+
+   lin->canary = LINEAR_CANARY;
+   lin->current = NULL;
+   return lin;
+}
+
+void *
+linear_alloc(void *lin_ctx, size_t size)
+{
+   struct linear_ctx *lin = (struct linear_ctx *) lin_ctx;
+   struct linear_chunk *chunk = lin->current;
+   char *ptr;
+
+   assert(lin->canary == LINEAR_CANARY);
+
+   size = LINEAR_ALIGN(size);
+
+   if (chunk == NULL || chunk->size - chunk->used < size) {
+      if (size > LINEAR_CHUNK_SIZE / 4) {
+         /* Don't waste what is left of the current chunk. */
+         chunk = linear_new_chunk(lin, size);
+      } else {
+         chunk = linear_new_chunk(lin, LINEAR_CHUNK_SIZE);
+         lin->current = chunk;
+      }
+
+      if (unlikely(chunk == NULL))
+         return NULL;
+   }
+
+   ptr = (char *) chunk + LINEAR_ALIGN(sizeof(struct linear_chunk)) +
+         chunk->used;
+   chunk->used += size;
+
+   /* ralloc_size() zeroes, so linear allocations do too.  Chunks come
+    * zeroed from calloc and are never reused.
+    */
+   return ptr;
+}
+
+char *
+linear_strdup(void *lin_ctx, const char *str)
+{
+   size_t n;
+   char *ptr;
+
+   if (unlikely(str == NULL))
+      return NULL;
+
+   n = strlen(str);
+   ptr = linear_alloc(lin_ctx, n + 1);
+   if (unlikely(ptr == NULL))
+      return NULL;
+
+   memcpy(ptr, str, n + 1);
+   return ptr;
+}
@@ -248,6 +248,23 @@ void *ralloc_parent(const void *ptr);
  */
 void *ralloc_autofree_context(void);
 
+/**
+ * Start counting the bytes allocated through ralloc, for
+ * ralloc_total_size().  Blocks allocated before aren't counted.
+ *
+ * Counting costs an atomic add per allocation and free, so it is off
+ * unless a debugging tool asks for it.
+ */
+void ralloc_enable_total_size(void);
+
+/**
+ * Return the number of bytes currently allocated through ralloc by the
+ * whole process since ralloc_enable_total_size(), headers included.
+ *
+ * This is mostly GLSL IR, which is what it is meant to measure.
+ */
+size_t ralloc_total_size(void);
+
 /**
  * Set a callback to occur just before an object is freed.
  */
@@ -400,6 +417,39 @@ bool ralloc_asprintf_append (char **str, const char *fmt, ...)
 bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
 /// @}
 
+/**
+ * \defgroup linear Linear Allocation @{
+ *
+ * A linear context hands out memory from large chunks, without a header per
+ * allocation.  Its allocations can't be freed, stolen, resized or used as
+ * ralloc contexts individually; they all go away together with the linear
+ * context.  This suits the many small objects a compiler pass allocates and
+ * drops all at once.
+ *
+ * The linear context itself is an ordinary ralloc allocation: it is freed
+ * with its parent or with ralloc_free(), and ralloc_steal() moves it along
+ * with everything allocated from it.
+ */
+
+/**
+ * Create a linear context as a child of \p ctx.
+ */
+void *linear_context(const void *ctx);
+
+/**
+ * Allocate \p size bytes from the linear context \p lin_ctx.
+ *
+ * The memory is zeroed and aligned to 8 bytes.
+ */
+void *linear_alloc(void *lin_ctx, size_t size);
+
+/**
+ * Duplicate a string, allocating the memory from the linear context
+ * \p lin_ctx.
+ */
+char *linear_strdup(void *lin_ctx, const char *str);
+/// @}
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -427,5 +477,33 @@ bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
       ralloc_free(p);                                                    \
    }
 
+/**
+ * Declare C++ new and delete operators which allocate from a linear
+ * context, as in
+ *
+ * TYPE *var = new(lin_ctx) TYPE(...);
+ *
+ * Deleting such an object only runs its destructor; the memory is
+ * reclaimed with the linear context.
+ */
+#define DECLARE_LINEAR_ALLOC_CXX_OPERATORS(TYPE)                         \
+   static void* operator new(size_t size, void *lin_ctx)                 \
+   {                                                                     \
+      void *p = linear_alloc(lin_ctx, size);                             \
+      assert(p != NULL);                                                 \
+      return p;                                                          \
+   }                                                                     \
+                                                                         \
+   static void operator delete(void *p)                                  \
+   {                                                                     \
+      (void) p;                                                          \
+   }                                                                     \
+                                                                         \
+   static void operator delete(void *p, void *lin_ctx)                   \
+   {                                                                     \
+      (void) p;                                                          \
+      (void) lin_ctx;                                                    \
+   }
+
 
 #endif
@@ -77,6 +77,8 @@ do_optimization(struct exec_list *ir, const char *optimization,
       return do_copy_propagation(ir);
    } else if (strcmp(optimization, "do_copy_propagation_elements") == 0) {
       return do_copy_propagation_elements(ir);
+   } else if (strcmp(optimization, "do_cse") == 0) {
+      return do_cse(ir);
    } else if (strcmp(optimization, "do_constant_propagation") == 0) {
       return do_constant_propagation(ir);
    } else if (strcmp(optimization, "do_dead_code") == 0) {
@@ -98,6 +100,9 @@ do_optimization(struct exec_list *ir, const char *optimization,
       return do_lower_texture_projection(ir);
    } else if (strcmp(optimization, "do_if_simplification") == 0) {
       return do_if_simplification(ir);
+   } else if (sscanf(optimization, "lower_if_to_cond_assign ( %d , %d ) ",
+                     &int_0, &int_1) == 2) {
+      return lower_if_to_cond_assign(ir, int_0, int_1);
    } else if (sscanf(optimization, "lower_if_to_cond_assign ( %d ) ",
                      &int_0) == 1) {
       return lower_if_to_cond_assign(ir, int_0);
@@ -0,0 +1,268 @@
+# coding=utf-8
+#
+# Copyright © 2013 Intel Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# DEALINGS IN THE SOFTWARE.
+
+
+import os
+import os.path
+import re
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..')) # For access to sexps.py, which is in parent dir
+from sexps import *
+
+def make_test_case(f_name, ret_type, body):
+    """Create a simple optimization test case consisting of a single
+    function with the given name, return type, and body.
+
+    Global declarations are automatically created for any undeclared
+    variables that are referenced by the function.  Variables which
+    are assigned are outputs, the others inputs.  All undeclared
+    variables are assumed to be floats.
+    """
+    check_sexp(body)
+    declarations = {}
+    declared = set()
+    def make_declarations(sexp):
+        if isinstance(sexp, list):
+            if len(sexp) >= 4 and sexp[0] == 'declare':
+                declared.add(sexp[3])
+            elif len(sexp) == 2 and sexp[0] == 'var_ref':
+                if sexp[1] not in declared and sexp[1] not in declarations:
+                    declarations[sexp[1]] = [
+                        'declare', ['in'], 'float', sexp[1]]
+            elif len(sexp) == 4 and sexp[0] == 'assign':
+                name = sexp[2][1]
+                if name not in declared:
+                    declarations[name] = ['declare', ['out'], 'float', name]
+                make_declarations(sexp[3])
+            else:
+                for s in sexp:
+                    make_declarations(s)
+    make_declarations(body)
+    return declarations.values() + \
+        [['function', f_name, ['signature', ret_type, ['parameters'], body]]]
+
+
+# The following functions can be used to build expressions.
+
+def var(name):
+    """Create a dereference of the variable <name>."""
+    return ['var_ref', name]
+
+def binop(op, a, b):
+    """Create the float expression <a> <op> <b>."""
+    return ['expression', 'float', op, a, b]
+
+def add(a, b):
+    return binop('+', a, b)
+
+def mul(a, b):
+    return binop('*', a, b)
+
+def neg(a):
+    return ['expression', 'float', 'neg', a]
+
+def gt_zero(var_name):
+    """Create the expression var_name > 0.  Zero is written the way
+    the IR printer writes it.
+    """
+    return ['expression', 'bool', '>', ['var_ref', var_name],
+            ['constant', 'float', ['0.0']]]
+
+
+# The following functions can be used to build statements.  All of
+# these functions return statement lists (even those which only create
+# a single statement), so that statements can be sequenced together
+# using the '+' operator.
+
+def simple_if(var_name, then_statements, else_statements = None):
+    """Create a statement of the form
+
+    if (var_name > 0.0) {
+       <then_statements>
+    } else {
+       <else_statements>
+    }
+
+    else_statements may be omitted.
+    """
+    if else_statements is None:
+        else_statements = []
+    check_sexp(then_statements)
+    check_sexp(else_statements)
+    return [['if', gt_zero(var_name), then_statements, else_statements]]
+
+def declare_temp(var_type, var_name):
+    """Create a declaration of the form
+
+    (declare (temporary) <var_type> <var_name)
+    """
+    return [['declare', ['temporary'], var_type, var_name]]
+
+def assign_x(var_name, value):
+    """Create a statement that assigns <value> to the variable
+    <var_name>.  The assignment uses the mask (x).
+    """
+    check_sexp(value)
+    return [['assign', ['x'], ['var_ref', var_name], value]]
+
+def declare_cse(value, name = 'cse'):
+    """Create the temporary do_cse moves <value> to.  The temporaries
+    after the first one are named cse@2, cse@3...
+    """
+    return declare_temp('float', name) + assign_x(name, value)
+
+def bash_quote(*args):
+    """Quote the arguments appropriately so that bash will understand
+    each argument as a single word.
+    """
+    def quote_word(word):
+        for c in word:
+            if not (c.isalpha() or c.isdigit() or c in '@%_-+=:,./'):
+                break
+        else:
+            return word
+        return "'{0}'".format(word.replace("'", "'\"'\"'"))
+    return ' '.join(quote_word(word) for word in args)
+
+def create_test_case(doc_string, input_sexp, expected_sexp, test_name):
+    """Create a test case that verifies that do_cse transforms the
+    given code in the expected way.
+    """
+    doc_lines = [line.strip() for line in doc_string.splitlines()]
+    doc_string = ''.join('# {0}\n'.format(line) for line in doc_lines if line != '')
+    check_sexp(input_sexp)
+    check_sexp(expected_sexp)
+    input_str = sexp_to_string(sort_decls(input_sexp))
+    expected_output = sexp_to_string(sort_decls(expected_sexp))
+
+    args = ['../../glsl_test', 'optpass', '--quiet', '--input-ir', 'do_cse']
+    test_file = '{0}.opt_test'.format(test_name)
+    with open(test_file, 'w') as f:
+        f.write('#!/bin/bash\n#\n# This file was generated by create_test_cases.py.\n#\n')
+        f.write(doc_string)
+        f.write('{0} <<EOF\n'.format(bash_quote(*args)))
+        f.write('{0}\nEOF\n'.format(input_str))
+    os.chmod(test_file, 0774)
+    expected_file = '{0}.opt_test.expected'.format(test_name)
+    with open(expected_file, 'w') as f:
+        f.write('{0}\n'.format(expected_output))
+
+def test_cse_basic():
+    doc_string = """Test that an expression computed twice is computed
+    once into a temporary.
+    """
+    input_sexp = make_test_case('main', 'void', (
+            assign_x('x', add(var('a'), var('b'))) +
+            assign_x('y', add(var('a'), var('b')))
+            ))
+    expected_sexp = make_test_case('main', 'void', (
+            declare_cse(add(var('a'), var('b'))) +
+            assign_x('x', var('cse')) +
+            assign_x('y', var('cse'))
+            ))
+    create_test_case(doc_string, input_sexp, expected_sexp, 'cse_basic')
+
+def test_cse_nested():
+    doc_string = """Test that the parts of a repeated expression are
+    found before the whole, and that the copy of the whole then reads
+    the temporary of its part.
+    """
+    input_sexp = make_test_case('main', 'void', (
+            assign_x('x', mul(add(var('a'), var('b')), var('c'))) +
+            assign_x('y', mul(add(var('a'), var('b')), var('c')))
+            ))
+    expected_sexp = make_test_case('main', 'void', (
+            declare_cse(add(var('a'), var('b'))) +
+            declare_cse(mul(var('cse'), var('c')), 'cse@2') +
+            assign_x('x', var('cse@2')) +
+            assign_x('y', var('cse@2'))
+            ))
+    create_test_case(doc_string, input_sexp, expected_sexp, 'cse_nested')
+
+def test_cse_killed():
+    doc_string = """Test that an expression is computed again after one
+    of the variables it reads is written.
+    """
+    input_sexp = make_test_case('main', 'void', (
+            declare_temp('float', 't') +
+            assign_x('t', var('a')) +
+            assign_x('x', add(var('t'), var('b'))) +
+            assign_x('t', var('c')) +
+            assign_x('y', add(var('t'), var('b')))
+            ))
+    create_test_case(doc_string, input_sexp, input_sexp, 'cse_killed')
+
+def test_cse_kill_keeps_others():
+    doc_string = """Test that writing a variable keeps the expressions
+    which don't read it.
+    """
+    input_sexp = make_test_case('main', 'void', (
+            declare_temp('float', 't') +
+            assign_x('t', var('a')) +
+            assign_x('x', add(var('t'), var('b'))) +
+            assign_x('y', mul(var('c'), var('d'))) +
+            assign_x('t', var('c')) +
+            assign_x('z', add(add(var('t'), var('b')),
+                              mul(var('c'), var('d'))))
+            ))
+    expected_sexp = make_test_case('main', 'void', (
+            declare_temp('float', 't') +
+            assign_x('t', var('a')) +
+            assign_x('x', add(var('t'), var('b'))) +
+            declare_cse(mul(var('c'), var('d'))) +
+            assign_x('y', var('cse')) +
+            assign_x('t', var('c')) +
+            assign_x('z', add(add(var('t'), var('b')), var('cse')))
+            ))
+    create_test_case(doc_string, input_sexp, expected_sexp,
+                     'cse_kill_keeps_others')
+
+def test_cse_if_boundary():
+    doc_string = """Test that expressions are not reused across the
+    boundaries of basic blocks.
+    """
+    input_sexp = make_test_case('main', 'void', (
+            assign_x('x', add(var('a'), var('b'))) +
+            simple_if('c', assign_x('y', add(var('a'), var('b'))))
+            ))
+    create_test_case(doc_string, input_sexp, input_sexp, 'cse_if_boundary')
+
+def test_cse_neg():
+    doc_string = """Test that negations, which are free source modifiers
+    in most backends, are left alone.
+    """
+    input_sexp = make_test_case('main', 'void', (
+            assign_x('x', neg(var('a'))) +
+            assign_x('y', neg(var('a')))
+            ))
+    create_test_case(doc_string, input_sexp, input_sexp, 'cse_neg')
+
+if __name__ == '__main__':
+    test_cse_basic()
+    test_cse_nested()
+    test_cse_killed()
+    test_cse_kill_keeps_others()
+    test_cse_if_boundary()
+    test_cse_neg()
@@ -36,3 +36,79 @@ TEST(ralloc_test, null_parent)
    EXPECT_EQ(NULL, ralloc_parent(mem_ctx));
 }
 /*@}*/
+
+/**
+ * \name Linear allocation
+ */
+/*@{*/
+TEST(ralloc_test, linear_alloc)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   void *lin_ctx = linear_context(mem_ctx);
+   char *small[100];
+
+   EXPECT_EQ(mem_ctx, ralloc_parent(lin_ctx));
+
+   for (unsigned i = 0; i < 100; i++) {
+      small[i] = (char *) linear_alloc(lin_ctx, i + 1);
+      ASSERT_TRUE(small[i] != NULL);
+      EXPECT_EQ(0u, (uintptr_t) small[i] % 8);
+      for (unsigned j = 0; j <= i; j++)
+         EXPECT_EQ(0, small[i][j]);
+      memset(small[i], 0xff, i + 1);
+   }
+
+   /* Larger than a chunk, and what comes after still fits with the rest. */
+   char *large = (char *) linear_alloc(lin_ctx, 100000);
+   ASSERT_TRUE(large != NULL);
+   memset(large, 0xff, 100000);
+
+   char *str = linear_strdup(lin_ctx, "linear");
+   EXPECT_STREQ("linear", str);
+
+   ralloc_free(mem_ctx);
+}
+
+TEST(ralloc_test, linear_steal)
+{
+   void *old_ctx = ralloc_context(NULL);
+   void *new_ctx = ralloc_context(NULL);
+   void *lin_ctx = linear_context(old_ctx);
+   char *str = linear_strdup(lin_ctx, "moved");
+
+   ralloc_steal(new_ctx, lin_ctx);
+   ralloc_free(old_ctx);
+
+   EXPECT_EQ(new_ctx, ralloc_parent(lin_ctx));
+   EXPECT_STREQ("moved", str);
+
+   ralloc_free(new_ctx);
+}
+/*@}*/
+
+/**
+ * \name Size accounting
+ */
+/*@{*/
+TEST(ralloc_test, total_size)
+{
+   /* Blocks from before counting was enabled are freed without being
+    * subtracted.
+    */
+   void *before = ralloc_size(NULL, 100);
+   ralloc_enable_total_size();
+   const size_t base = ralloc_total_size();
+
+   void *mem_ctx = ralloc_context(NULL);
+   void *block = ralloc_size(mem_ctx, 1000);
+   EXPECT_LE(base + 1000, ralloc_total_size());
+
+   block = reralloc_size(mem_ctx, block, 100000);
+   ASSERT_TRUE(block != NULL);
+   EXPECT_LE(base + 100000, ralloc_total_size());
+
+   ralloc_free(before);
+   ralloc_free(mem_ctx);
+   EXPECT_EQ(base, ralloc_total_size());
+}
+/*@}*/
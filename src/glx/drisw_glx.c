@@ -24,6 +24,9 @@
 #if defined(GLX_DIRECT_RENDERING) && !defined(GLX_USE_APPLEGL)
 
 #include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include "glxclient.h"
 #include <dlfcn.h>
 #include "dri_common.h"
@@ -65,6 +68,13 @@ struct drisw_drawable
    __DRIdrawable *driDrawable;
    XVisualInfo *visinfo;
    XImage *ximage;
+
+   /* Segment of the driver attached to the server by swrastPutImageShm,
+    * shmid -1 if none.
+    */
+   XShmSegmentInfo shminfo;
+   XImage *shm_ximage;
+   Bool shm_failed;
 };
 
 static Bool
@@ -111,12 +121,29 @@ XCreateDrawable(struct drisw_drawable * pdp,
   if (pdp->ximage->bits_per_pixel == 24)
      pdp->ximage->bits_per_pixel = 32;
 
+   pdp->shminfo.shmid = -1;
+   pdp->shm_failed = !XShmQueryExtension(dpy);
+
    return True;
 }
 
+static void
+detach_shm_image(struct drisw_drawable * pdp, Display * dpy)
+{
+   if (pdp->shminfo.shmid < 0)
+      return;
+
+   XShmDetach(dpy, &pdp->shminfo);
+   pdp->shm_ximage->data = NULL;
+   XDestroyImage(pdp->shm_ximage);
+   pdp->shm_ximage = NULL;
+   pdp->shminfo.shmid = -1;
+}
+
 static void
 XDestroyDrawable(struct drisw_drawable * pdp, Display * dpy, XID drawable)
 {
+   detach_shm_image(pdp, dpy);
    XDestroyImage(pdp->ximage);
    free(pdp->visinfo);
 
@@ -206,6 +233,113 @@ swrastPutImage(__DRIdrawable * draw, int op,
    ximage->data = NULL;
 }
 
+static int xshm_error;
+
+static int
+handle_xshm_error(Display * dpy, XErrorEvent * event)
+{
+   (void) dpy;
+   (void) event;
+   xshm_error = 1;
+   return 0;
+}
+
+/**
+ * Attach the driver's segment to the server, unless it already is.
+ *
+ * Fails on remote displays, after which we stick to XPutImage.
+ */
+static Bool
+attach_shm_image(struct drisw_drawable * pdp, Display * dpy,
+                 int shmid, char *shmaddr)
+{
+   int (*old_handler)(Display *, XErrorEvent *);
+
+   if (pdp->shminfo.shmid == shmid && pdp->shminfo.shmaddr == shmaddr)
+      return True;
+
+   detach_shm_image(pdp, dpy);
+
+   pdp->shm_ximage = XShmCreateImage(dpy,
+                                     pdp->visinfo->visual,
+                                     pdp->visinfo->depth,
+                                     ZPixmap, NULL, &pdp->shminfo, 0, 0);
+   if (!pdp->shm_ximage) {
+      pdp->shm_failed = True;
+      return False;
+   }
+
+   pdp->shminfo.shmid = shmid;
+   pdp->shminfo.shmaddr = shmaddr;
+   pdp->shminfo.readOnly = True;
+
+   xshm_error = 0;
+   old_handler = XSetErrorHandler(handle_xshm_error);
+   XShmAttach(dpy, &pdp->shminfo);
+   XSync(dpy, False);
+   (void) XSetErrorHandler(old_handler);
+
+   if (xshm_error) {
+      XDestroyImage(pdp->shm_ximage);
+      pdp->shm_ximage = NULL;
+      pdp->shminfo.shmid = -1;
+      pdp->shm_failed = True;
+      return False;
+   }
+
+   return True;
+}
+
+static void
+swrastPutImageShm(__DRIdrawable * draw, int op,
+                  int x, int y, int w, int h, int stride,
+                  int shmid, char *shmaddr, unsigned offset,
+                  void *loaderPrivate)
+{
+   struct drisw_drawable *pdp = loaderPrivate;
+   __GLXDRIdrawable *pdraw = &(pdp->base);
+   Display *dpy = pdraw->psc->dpy;
+   XImage *ximage;
+   GC gc;
+
+   switch (op) {
+   case __DRI_SWRAST_IMAGE_OP_DRAW:
+      gc = pdp->gc;
+      break;
+   case __DRI_SWRAST_IMAGE_OP_SWAP:
+      gc = pdp->swapgc;
+      break;
+   default:
+      return;
+   }
+
+   if (pdp->shm_failed || !attach_shm_image(pdp, dpy, shmid, shmaddr)) {
+      /* same as swrastPutImage(), but with the driver's stride */
+      ximage = pdp->ximage;
+      ximage->data = shmaddr + offset;
+      ximage->width = w;
+      ximage->height = h;
+      ximage->bytes_per_line = stride;
+
+      XPutImage(dpy, pdraw->xDrawable, gc, ximage, 0, 0, x, y, w, h);
+
+      ximage->data = NULL;
+      return;
+   }
+
+   /* The server derives the stride from the image width. */
+   ximage = pdp->shm_ximage;
+   ximage->data = shmaddr + offset;
+   ximage->width = stride * 8 / ximage->bits_per_pixel;
+   ximage->height = h;
+   ximage->bytes_per_line = stride;
+
+   XShmPutImage(dpy, pdraw->xDrawable, gc, ximage, 0, 0, x, y, w, h, False);
+
+   /* The driver renders the next frame into the same memory. */
+   XSync(dpy, False);
+}
+
 static void
 swrastGetImage(__DRIdrawable * read,
                int x, int y, int w, int h,
@@ -234,7 +368,8 @@ static const __DRIswrastLoaderExtension swrastLoaderExtension = {
    {__DRI_SWRAST_LOADER, __DRI_SWRAST_LOADER_VERSION},
    swrastGetDrawableInfo,
    swrastPutImage,
-   swrastGetImage
+   swrastGetImage,
+   swrastPutImageShm
 };
 
 static const __DRIextension *loader_extensions[] = {
@@ -321,3 +321,8 @@ DRI_CONF_SECTION_BEGIN \
 DRI_CONF_OPT_BEGIN_B(always_have_depth_buffer, def) \
         DRI_CONF_DESC(en,gettext("Create all visuals with a depth buffer")) \
 DRI_CONF_OPT_END
+
+#define DRI_CONF_DISCARD_GLSL_IR(def) \
+DRI_CONF_OPT_BEGIN_B(discard_glsl_ir, def) \
+        DRI_CONF_DESC(en,gettext("Free the GLSL IR of linked programs, recompiling shaders from source if they are linked again")) \
+DRI_CONF_OPT_END
@@ -100,15 +100,11 @@ _mesa_max_buffer_index(struct gl_context *ctx, GLuint count, GLenum type,
 
 
 /**
- * Check if OK to draw arrays/elements.
+ * The API specific part of check_valid_to_render().
  */
 static GLboolean
-check_valid_to_render(struct gl_context *ctx, const char *function)
+check_valid_arrays(struct gl_context *ctx)
 {
-   if (!_mesa_valid_to_render(ctx, function)) {
-      return GL_FALSE;
-   }
-
    switch (ctx->API) {
    case API_OPENGLES2:
       /* For ES2, we can draw if any vertex array is enabled (and we
@@ -148,13 +144,48 @@ check_valid_to_render(struct gl_context *ctx, const char *function)
       break;
 
    default:
-      assert(!"Invalid API value in check_valid_to_render()");
+      assert(!"Invalid API value in check_valid_arrays()");
    }
 
    return GL_TRUE;
 }
 
 
+/**
+ * Check if OK to draw arrays/elements.
+ *
+ * Once the checks pass, ctx->_DrawValid skips them until the next state
+ * update, since all they depend on is flagged in ctx->NewState.  The
+ * exceptions are checked again: the framebuffer status, which is reset
+ * when an attachment changes, and the link status of the current programs,
+ * which can be relinked from other contexts.
+ */
+static GLboolean
+check_valid_to_render(struct gl_context *ctx, const char *function)
+{
+   if (ctx->_DrawValid && !ctx->NewState &&
+       ctx->DrawBuffer->_Status == GL_FRAMEBUFFER_COMPLETE_EXT &&
+       (!ctx->Shader.CurrentVertexProgram ||
+        ctx->Shader.CurrentVertexProgram->LinkStatus) &&
+       (!ctx->Shader.CurrentGeometryProgram ||
+        ctx->Shader.CurrentGeometryProgram->LinkStatus) &&
+       (!ctx->Shader.CurrentFragmentProgram ||
+        ctx->Shader.CurrentFragmentProgram->LinkStatus))
+      return GL_TRUE;
+
+   if (!_mesa_valid_to_render(ctx, function)) {
+      return GL_FALSE;
+   }
+
+   if (!check_valid_arrays(ctx))
+      return GL_FALSE;
+
+   /* GLSL_LOG wants to see each program used for the first time */
+   ctx->_DrawValid = !(ctx->Shader.Flags & GLSL_LOG);
+   return GL_TRUE;
+}
+
+
 /**
  * Do bounds checking on array element indexes.  Check that the vertices
  * pointed to by the indices don't lie outside buffer object bounds.
@@ -1057,6 +1057,7 @@ _mesa_BufferData(GLenum target, GLsizeiptrARB size,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   _mesa_bufferobj_invalidate_minmax(bufObj);
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1092,6 +1093,7 @@ _mesa_BufferSubData(GLenum target, GLintptrARB offset,
       return;
 
    bufObj->Written = GL_TRUE;
+   _mesa_bufferobj_invalidate_minmax(bufObj);
 
    ASSERT(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData( ctx, offset, size, data, bufObj );
@@ -1183,8 +1185,10 @@ _mesa_MapBuffer(GLenum target, GLenum access)
       bufObj->AccessFlags = accessFlags;
    }
 
-   if (access == GL_WRITE_ONLY_ARB || access == GL_READ_WRITE_ARB)
+   if (access == GL_WRITE_ONLY_ARB || access == GL_READ_WRITE_ARB) {
       bufObj->Written = GL_TRUE;
+      _mesa_bufferobj_invalidate_minmax(bufObj);
+   }
 
 #ifdef VBO_DEBUG
    printf("glMapBufferARB(%u, sz %ld, access 0x%x)\n",
@@ -1470,6 +1474,8 @@ _mesa_CopyBufferSubData(GLenum readTarget, GLenum writeTarget,
       }
    }
 
+   _mesa_bufferobj_invalidate_minmax(dst);
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
@@ -1583,6 +1589,9 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
       return bufObj->Pointer;
    }
 
+   if (access & GL_MAP_WRITE_BIT)
+      _mesa_bufferobj_invalidate_minmax(bufObj);
+
    ASSERT(ctx->Driver.MapBufferRange);
    map = ctx->Driver.MapBufferRange(ctx, offset, length, access, bufObj);
    if (!map) {
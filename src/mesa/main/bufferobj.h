@@ -55,6 +55,18 @@ _mesa_is_bufferobj(const struct gl_buffer_object *obj)
    return obj != NULL && obj->Name != 0;
 }
 
+/**
+ * Forget the cached index bounds of a buffer object whose contents are
+ * about to change.
+ */
+static inline void
+_mesa_bufferobj_invalidate_minmax(struct gl_buffer_object *obj)
+{
+   _glthread_LOCK_MUTEX(obj->Mutex);
+   obj->NumMinMaxCache = 0;
+   _glthread_UNLOCK_MUTEX(obj->Mutex);
+}
+
 
 extern void
 _mesa_init_buffer_objects( struct gl_context *ctx );
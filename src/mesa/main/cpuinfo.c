@@ -25,6 +25,7 @@
 
 #include "main/compiler.h"
 #include "main/cpuinfo.h"
+#include "main/imports.h"
 
 
 /**
@@ -89,3 +90,34 @@ _mesa_get_cpu_string(void)
 
    return buffer;
 }
+
+
+/**
+ * Return the MESA_SSE_CAP_x bits of the CPU, for choosing between the
+ * SSE kernels built with MESA_SSE_TARGETS.  Like the assembly code, they
+ * are disabled by MESA_NO_ASM and MESA_NO_SSE.
+ */
+unsigned
+_mesa_get_sse_caps(void)
+{
+#ifdef MESA_SSE_TARGETS
+   static int caps = -1;
+
+   if (caps < 0) {
+      unsigned c = 0;
+
+      if (!_mesa_getenv("MESA_NO_ASM") && !_mesa_getenv("MESA_NO_SSE")) {
+         __builtin_cpu_init();
+         if (__builtin_cpu_supports("sse2"))
+            c |= MESA_SSE_CAP_SSE2;
+         if (__builtin_cpu_supports("ssse3"))
+            c |= MESA_SSE_CAP_SSSE3;
+      }
+      caps = c;
+   }
+
+   return caps;
+#else
+   return 0;
+#endif
+}
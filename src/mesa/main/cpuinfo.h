@@ -40,4 +40,22 @@ extern char *
 _mesa_get_cpu_string(void);
 
 
+/**
+ * Whether SSE kernels can be built with __attribute__((target)), and
+ * selected at runtime with _mesa_get_sse_caps(), without any special
+ * compiler flags.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define MESA_SSE_TARGETS 1
+#endif
+
+#define MESA_SSE_CAP_SSE2  0x1
+#define MESA_SSE_CAP_SSSE3 0x2
+
+extern unsigned
+_mesa_get_sse_caps(void);
+
+
 #endif /* CPUINFO_H */
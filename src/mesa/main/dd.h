@@ -434,6 +434,50 @@ struct dd_function_table {
     * own transformations on it for the purposes of code generation.
     */
    GLboolean (*LinkShader)(struct gl_context *ctx, struct gl_shader_program *shader);
+
+   /**
+    * Serialize a linked program for glGetProgramBinary().
+    *
+    * Returns the size of the binary, or 0 if the program can't be
+    * serialized.  The binary is only written if it fits into \c bufSize,
+    * so passing a NULL \c binary just queries the size.
+    */
+   GLsizei (*GetProgramBinary)(struct gl_context *ctx,
+                               struct gl_shader_program *shader,
+                               GLsizei bufSize, GLvoid *binary);
+
+   /**
+    * Restore a program from a binary returned by GetProgramBinary, in
+    * place of linking it.  Returns GL_FALSE if the binary is rejected.
+    */
+   GLboolean (*ProgramBinary)(struct gl_context *ctx,
+                              struct gl_shader_program *shader,
+                              const GLvoid *binary, GLsizei length);
+
+   /**
+    * Whether compiling \c shader can be skipped, because it has been
+    * linked before into a program LinkCachedProgram can restore.  The
+    * shader is then compiled by a link which misses the cache.  Optional,
+    * and may be called on the shader queue's thread.
+    */
+   GLboolean (*ShaderIsCached)(struct gl_context *ctx,
+                               struct gl_shader *shader);
+
+   /**
+    * Restore a program from the driver's cache of linked programs, in
+    * place of linking it.  Returns GL_FALSE on a miss.  Optional.
+    */
+   GLboolean (*LinkCachedProgram)(struct gl_context *ctx,
+                                  struct gl_shader_program *shader);
+
+   /**
+    * Mark the beginning and the end of a step of compiling or linking,
+    * for the driver's tracing.  Optional.  Spans nest and are ended on
+    * the thread which began them.  \c id identifies the shader, 0 for
+    * the one of the enclosing span.
+    */
+   void (*BeginTrace)(struct gl_context *ctx, const char *name, GLuint id);
+   void (*EndTrace)(struct gl_context *ctx);
    /*@}*/
 
    /**
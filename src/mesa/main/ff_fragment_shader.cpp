@@ -1281,7 +1281,8 @@ emit_instructions(texenv_fragment_program *p)
  * current texture env/combine mode.
  */
 static struct gl_shader_program *
-create_new_program(struct gl_context *ctx, struct state_key *key)
+create_new_program(struct gl_context *ctx, struct state_key *key,
+                   GLuint keySize)
 {
    texenv_fragment_program p;
    unsigned int unit;
@@ -1297,6 +1298,10 @@ create_new_program(struct gl_context *ctx, struct state_key *key)
    p.instructions = p.shader->ir;
    p.state = key;
    p.shader_program = ctx->Driver.NewShaderProgram(ctx, 0);
+   p.shader_program->FixedFunctionKey =
+      (GLubyte *) ralloc_size(p.shader_program, keySize);
+   memcpy(p.shader_program->FixedFunctionKey, key, keySize);
+   p.shader_program->FixedFunctionKeySize = keySize;
 
    /* Tell the linker to ignore the fact that we're building a
     * separate shader, in case we're in a GLES2 context that would
@@ -1376,14 +1381,21 @@ _mesa_get_fixed_func_fragment_program(struct gl_context *ctx)
    keySize = make_state_key(ctx, &key);
 
    shader_program = (struct gl_shader_program *)
-      _mesa_search_program_cache(ctx->FragmentProgram.Cache,
+      _mesa_search_program_cache(ctx->Shared->FixedFuncFragmentProgramCache,
                                  &key, keySize);
+   if (!shader_program)
+      shader_program = (struct gl_shader_program *)
+         _mesa_search_program_cache(ctx->FragmentProgram.Cache,
+                                    &key, keySize);
 
    if (!shader_program) {
-      shader_program = create_new_program(ctx, &key);
+      shader_program = create_new_program(ctx, &key, keySize);
 
-      _mesa_shader_cache_insert(ctx, ctx->FragmentProgram.Cache,
-				&key, keySize, shader_program);
+      if (!_mesa_shader_cache_insert(ctx,
+                                     ctx->Shared->FixedFuncFragmentProgramCache,
+                                     &key, keySize, shader_program))
+         _mesa_shader_cache_insert(ctx, ctx->FragmentProgram.Cache,
+                                   &key, keySize, shader_program);
    }
 
    return shader_program;
@@ -1662,7 +1662,12 @@ _mesa_get_fixed_func_vertex_program(struct gl_context *ctx)
    /* Look for an already-prepared program for this state:
     */
    prog = gl_vertex_program(
-      _mesa_search_program_cache(ctx->VertexProgram.Cache, &key, sizeof(key)));
+      _mesa_search_program_cache(ctx->Shared->FixedFuncVertexProgramCache,
+                                 &key, sizeof(key)));
+   if (!prog)
+      prog = gl_vertex_program(
+         _mesa_search_program_cache(ctx->VertexProgram.Cache,
+                                    &key, sizeof(key)));
 
    if (!prog) {
       /* OK, we'll have to build a new one */
@@ -1682,8 +1687,11 @@ _mesa_get_fixed_func_vertex_program(struct gl_context *ctx)
          ctx->Driver.ProgramStringNotify( ctx, GL_VERTEX_PROGRAM_ARB,
                                           &prog->Base );
 #endif
-      _mesa_program_cache_insert(ctx, ctx->VertexProgram.Cache,
-                                 &key, sizeof(key), &prog->Base);
+      if (!_mesa_program_cache_insert(ctx,
+                                      ctx->Shared->FixedFuncVertexProgramCache,
+                                      &key, sizeof(key), &prog->Base))
+         _mesa_program_cache_insert(ctx, ctx->VertexProgram.Cache,
+                                    &key, sizeof(key), &prog->Base);
    }
 
    return prog;
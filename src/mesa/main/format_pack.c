@@ -38,6 +38,7 @@
 
 #include "colormac.h"
 #include "format_pack.h"
+#include "format_sse.h"
 #include "macros.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
@@ -2218,6 +2219,14 @@ _mesa_pack_float_rgba_row(gl_format format, GLuint n,
                           const GLfloat src[][4], void *dst)
 {
    pack_float_rgba_row_func packrow = get_pack_float_rgba_row_function(format);
+   GLuint done = _mesa_sse_pack_float_rgba_row(format, n, src, dst);
+
+   if (done) {
+      src += done;
+      dst = (GLubyte *) dst + done * _mesa_get_format_bytes(format);
+      n -= done;
+   }
+
    if (packrow) {
       /* use "fast" function */
       packrow(n, src, dst);
@@ -2249,6 +2258,14 @@ _mesa_pack_ubyte_rgba_row(gl_format format, GLuint n,
                           const GLubyte src[][4], void *dst)
 {
    pack_ubyte_rgba_row_func packrow = get_pack_ubyte_rgba_row_function(format);
+   GLuint done = _mesa_sse_pack_ubyte_rgba_row(format, n, src, dst);
+
+   if (done) {
+      src += done;
+      dst = (GLubyte *) dst + done * _mesa_get_format_bytes(format);
+      n -= done;
+   }
+
    if (packrow) {
       /* use "fast" function */
       packrow(n, src, dst);
@@ -0,0 +1,611 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file format_sse.c
+ * SSE2 row functions for the most common formats, with the same results
+ * as the C versions in format_pack.c and format_unpack.c.
+ *
+ * Like texstore_sse.c, the kernels are built with the target attribute
+ * and chosen with _mesa_get_sse_caps().  They do four pixels at a time
+ * and leave the rest of the row to the C code.
+ */
+
+
+#include "glheader.h"
+#include "colormac.h"
+#include "cpuinfo.h"
+#include "format_sse.h"
+#include "macros.h"
+
+
+#ifdef MESA_SSE_TARGETS
+
+#include <emmintrin.h>
+
+
+/**
+ * Reorder the bytes of four 8888 pixels, \p swz being an _MM_SHUFFLE()
+ * that says where to find each output byte of a pixel.
+ */
+#define SWIZZLE_8888(v, swz, zero)                                        \
+   _mm_packus_epi16(                                                      \
+      _mm_shufflehi_epi16(                                                \
+         _mm_shufflelo_epi16(_mm_unpacklo_epi8(v, zero), swz), swz),      \
+      _mm_shufflehi_epi16(                                                \
+         _mm_shufflelo_epi16(_mm_unpackhi_epi8(v, zero), swz), swz))
+
+
+/**
+ * Unpack an 8888 format to float RGBA.  \p swz selects the R, G, B and A
+ * bytes of a pixel in memory order.  The division matches the values of
+ * UBYTE_TO_FLOAT().
+ */
+#define UNPACK_FLOAT_8888(name, swz)                                      \
+__attribute__((target("sse2")))                                           \
+static GLuint                                                             \
+name(GLuint n, const void *src, GLfloat dst[][4])                         \
+{                                                                         \
+   const __m128i *s = (const __m128i *) src;                              \
+   const __m128i zero = _mm_setzero_si128();                              \
+   const __m128 scale = _mm_set1_ps(255.0F);                              \
+   GLuint i;                                                              \
+                                                                          \
+   for (i = 0; i + 4 <= n; i += 4) {                                      \
+      const __m128i p = _mm_loadu_si128(s++);                             \
+      const __m128i lo = _mm_unpacklo_epi8(p, zero);                      \
+      const __m128i hi = _mm_unpackhi_epi8(p, zero);                      \
+      __m128i c[4];                                                       \
+      GLuint j;                                                           \
+                                                                          \
+      c[0] = _mm_unpacklo_epi16(lo, zero);                                \
+      c[1] = _mm_unpackhi_epi16(lo, zero);                                \
+      c[2] = _mm_unpacklo_epi16(hi, zero);                                \
+      c[3] = _mm_unpackhi_epi16(hi, zero);                                \
+                                                                          \
+      for (j = 0; j < 4; j++) {                                           \
+         const __m128i v = _mm_shuffle_epi32(c[j], swz);                  \
+         _mm_storeu_ps(dst[i + j],                                        \
+                       _mm_div_ps(_mm_cvtepi32_ps(v), scale));            \
+      }                                                                   \
+   }                                                                      \
+                                                                          \
+   return i;                                                              \
+}
+
+/**
+ * Copy 8888 pixels reordering their bytes, which is both the ubyte
+ * unpack and the ubyte pack of those formats.
+ */
+#define REORDER_8888(name, swz)                                           \
+__attribute__((target("sse2")))                                           \
+static GLuint                                                             \
+name(GLuint n, const void *src, void *dst)                                \
+{                                                                         \
+   const __m128i *s = (const __m128i *) src;                              \
+   __m128i *d = (__m128i *) dst;                                          \
+   const __m128i zero = _mm_setzero_si128();                              \
+   GLuint i;                                                              \
+                                                                          \
+   for (i = 0; i + 4 <= n; i += 4) {                                      \
+      const __m128i p = _mm_loadu_si128(s++);                             \
+      _mm_storeu_si128(d++, SWIZZLE_8888(p, swz, zero));                  \
+   }                                                                      \
+                                                                          \
+   return i;                                                              \
+}
+
+/*
+ * Little endian byte order of the formats:
+ *   RGBA8888       A B G R
+ *   RGBA8888_REV   R G B A
+ *   ARGB8888       B G R A
+ *   ARGB8888_REV   A R G B
+ */
+UNPACK_FLOAT_8888(unpack_float_RGBA8888, _MM_SHUFFLE(0, 1, 2, 3))
+UNPACK_FLOAT_8888(unpack_float_RGBA8888_REV, _MM_SHUFFLE(3, 2, 1, 0))
+UNPACK_FLOAT_8888(unpack_float_ARGB8888, _MM_SHUFFLE(3, 0, 1, 2))
+UNPACK_FLOAT_8888(unpack_float_ARGB8888_REV, _MM_SHUFFLE(0, 3, 2, 1))
+
+REORDER_8888(reorder_RGBA8888, _MM_SHUFFLE(0, 1, 2, 3))
+REORDER_8888(reorder_ARGB8888, _MM_SHUFFLE(3, 0, 1, 2))
+REORDER_8888(unpack_ubyte_ARGB8888_REV, _MM_SHUFFLE(0, 3, 2, 1))
+REORDER_8888(pack_ubyte_ARGB8888_REV, _MM_SHUFFLE(2, 1, 0, 3))
+
+
+__attribute__((target("sse2")))
+static GLuint
+unpack_float_RGB565(GLuint n, const void *src, GLfloat dst[][4])
+{
+   const GLushort *s = (const GLushort *) src;
+   const __m128i zero = _mm_setzero_si128();
+   const __m128 scale5 = _mm_set1_ps(1.0F / 31.0F);
+   const __m128 scale6 = _mm_set1_ps(1.0F / 63.0F);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i p =
+         _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) (s + i)), zero);
+      __m128 r, g, b, a;
+
+      r = _mm_cvtepi32_ps(_mm_srli_epi32(p, 11));
+      g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 5),
+                                        _mm_set1_epi32(0x3f)));
+      b = _mm_cvtepi32_ps(_mm_and_si128(p, _mm_set1_epi32(0x1f)));
+      r = _mm_mul_ps(r, scale5);
+      g = _mm_mul_ps(g, scale6);
+      b = _mm_mul_ps(b, scale5);
+      a = _mm_set1_ps(1.0F);
+
+      _MM_TRANSPOSE4_PS(r, g, b, a);
+      _mm_storeu_ps(dst[i + 0], r);
+      _mm_storeu_ps(dst[i + 1], g);
+      _mm_storeu_ps(dst[i + 2], b);
+      _mm_storeu_ps(dst[i + 3], a);
+   }
+
+   return i;
+}
+
+
+/**
+ * Four Z values of Z24_S8 / Z24_X8, scaled in double precision like
+ * unpack_float_z_Z24_X8().
+ */
+__attribute__((target("sse2")))
+static inline __m128
+z24_to_float(const GLuint *s)
+{
+   const __m128d scale = _mm_set1_pd(1.0 / (GLdouble) 0xffffff);
+   const __m128i z = _mm_srli_epi32(_mm_loadu_si128((const __m128i *) s), 8);
+   const __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(z), scale);
+   const __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(z, 8)),
+                                 scale);
+
+   return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+__attribute__((target("sse2")))
+static GLuint
+unpack_float_z_Z24_X8(GLuint n, const void *src, GLfloat *dst)
+{
+   const GLuint *s = (const GLuint *) src;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4)
+      _mm_storeu_ps(dst + i, z24_to_float(s + i));
+
+   return i;
+}
+
+/**
+ * (z, z, z, 1) from a vector of z.
+ */
+__attribute__((target("sse2")))
+static inline __m128
+z_to_rgba(__m128 z)
+{
+   const __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(~0, ~0, ~0, 0));
+   const __m128 one = _mm_setr_ps(0.0F, 0.0F, 0.0F, 1.0F);
+
+   return _mm_or_ps(_mm_and_ps(z, xyz), one);
+}
+
+__attribute__((target("sse2")))
+static GLuint
+unpack_float_Z24_X8(GLuint n, const void *src, GLfloat dst[][4])
+{
+   const GLuint *s = (const GLuint *) src;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 z = z24_to_float(s + i);
+
+      _mm_storeu_ps(dst[i + 0],
+                    z_to_rgba(_mm_shuffle_ps(z, z, _MM_SHUFFLE(0, 0, 0, 0))));
+      _mm_storeu_ps(dst[i + 1],
+                    z_to_rgba(_mm_shuffle_ps(z, z, _MM_SHUFFLE(1, 1, 1, 1))));
+      _mm_storeu_ps(dst[i + 2],
+                    z_to_rgba(_mm_shuffle_ps(z, z, _MM_SHUFFLE(2, 2, 2, 2))));
+      _mm_storeu_ps(dst[i + 3],
+                    z_to_rgba(_mm_shuffle_ps(z, z, _MM_SHUFFLE(3, 3, 3, 3))));
+   }
+
+   return i;
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+unpack_float_R_FLOAT32(GLuint n, const void *src, GLfloat dst[][4])
+{
+   const GLfloat *s = (const GLfloat *) src;
+   const __m128 gba = _mm_setr_ps(0.0F, 0.0F, 0.0F, 1.0F);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 r = _mm_loadu_ps(s + i);
+
+      _mm_storeu_ps(dst[i + 0], _mm_move_ss(gba, r));
+      _mm_storeu_ps(dst[i + 1],
+                    _mm_move_ss(gba, _mm_shuffle_ps(r, r,
+                                                    _MM_SHUFFLE(1, 1, 1, 1))));
+      _mm_storeu_ps(dst[i + 2], _mm_move_ss(gba, _mm_unpackhi_ps(r, r)));
+      _mm_storeu_ps(dst[i + 3],
+                    _mm_move_ss(gba, _mm_shuffle_ps(r, r,
+                                                    _MM_SHUFFLE(3, 3, 3, 3))));
+   }
+
+   return i;
+}
+
+
+/**
+ * _mesa_half_to_float() of four halves in the low 16 bits of each lane.
+ */
+__attribute__((target("sse2")))
+static inline __m128
+half_to_float(__m128i h)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i m = _mm_and_si128(h, _mm_set1_epi32(0x3ff));
+   const __m128i e = _mm_and_si128(_mm_srli_epi32(h, 10),
+                                   _mm_set1_epi32(0x1f));
+   const __m128i s = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)),
+                                    16);
+   const __m128i is_denorm = _mm_cmpeq_epi32(e, zero);
+   const __m128i is_special = _mm_cmpeq_epi32(e, _mm_set1_epi32(31));
+   __m128i normal, denorm, special, result;
+
+   normal = _mm_or_si128(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(112)),
+                                        23),
+                         _mm_slli_epi32(m, 13));
+
+   /* m * 2^-24 is exact, and zero for a zero mantissa. */
+   denorm = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(m),
+                                        _mm_set1_ps(1.0F / (1 << 24))));
+
+   /* Infinity, or the NaN with a mantissa of 1. */
+   special = _mm_or_si128(_mm_set1_epi32(0x7f800000),
+                          _mm_andnot_si128(_mm_cmpeq_epi32(m, zero),
+                                           _mm_set1_epi32(1)));
+
+   result = _mm_or_si128(_mm_and_si128(is_special, special),
+                         _mm_andnot_si128(is_special, normal));
+   result = _mm_or_si128(_mm_and_si128(is_denorm, denorm),
+                         _mm_andnot_si128(is_denorm, result));
+
+   return _mm_castsi128_ps(_mm_or_si128(result, s));
+}
+
+__attribute__((target("sse2")))
+static GLuint
+unpack_float_RGBA_FLOAT16(GLuint n, const void *src, GLfloat dst[][4])
+{
+   const __m128i *s = (const __m128i *) src;
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 2 <= n; i += 2) {
+      const __m128i h = _mm_loadu_si128(s++);
+
+      _mm_storeu_ps(dst[i + 0], half_to_float(_mm_unpacklo_epi16(h, zero)));
+      _mm_storeu_ps(dst[i + 1], half_to_float(_mm_unpackhi_epi16(h, zero)));
+   }
+
+   return i;
+}
+
+
+/**
+ * RGB565 of four RGBA ubyte pixels, in the low 64 bits.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+ubytes_to_565(__m128i v)
+{
+   const __m128i mask = _mm_set1_epi32(0xff);
+   const __m128i r = _mm_and_si128(v, _mm_set1_epi32(0xf8));
+   const __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8),
+                                   _mm_set1_epi32(0xfc));
+   const __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), mask);
+   __m128i c;
+
+   c = _mm_or_si128(_mm_slli_epi32(r, 8), _mm_slli_epi32(g, 3));
+   c = _mm_or_si128(c, _mm_srli_epi32(b, 3));
+
+   /* Sign extend so that the saturating pack keeps the low 16 bits. */
+   c = _mm_srai_epi32(_mm_slli_epi32(c, 16), 16);
+   return _mm_packs_epi32(c, c);
+}
+
+__attribute__((target("sse2")))
+static GLuint
+pack_ubyte_RGB565(GLuint n, const GLubyte src[][4], void *dst)
+{
+   GLushort *d = (GLushort *) dst;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i v = _mm_loadu_si128((const __m128i *) src[i]);
+      _mm_storel_epi64((__m128i *) (d + i), ubytes_to_565(v));
+   }
+
+   return i;
+}
+
+
+#if defined(USE_IEEE) && !defined(DEBUG)
+
+/**
+ * UNCLAMPED_FLOAT_TO_UBYTE() of one RGBA pixel, in 32-bit lanes.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+float_to_ubyte(const GLfloat *src)
+{
+   const __m128 f = _mm_loadu_ps(src);
+   const __m128i bits = _mm_castps_si128(f);
+   const __m128i negative = _mm_cmplt_epi32(bits, _mm_setzero_si128());
+   const __m128i saturated = _mm_cmpgt_epi32(bits,
+                                             _mm_set1_epi32(IEEE_ONE - 1));
+   const __m128 scaled = _mm_mul_ps(f, _mm_set1_ps(255.0F / 256.0F));
+   __m128i ub;
+
+   ub = _mm_castps_si128(_mm_add_ps(scaled, _mm_set1_ps(32768.0F)));
+   ub = _mm_and_si128(ub, _mm_set1_epi32(0xff));
+   ub = _mm_or_si128(ub, saturated);
+   return _mm_and_si128(_mm_andnot_si128(negative, ub), _mm_set1_epi32(0xff));
+}
+
+/**
+ * Four float RGBA pixels as ubyte RGBA.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+floats_to_ubytes(const GLfloat src[][4])
+{
+   const __m128i p01 = _mm_packs_epi32(float_to_ubyte(src[0]),
+                                       float_to_ubyte(src[1]));
+   const __m128i p23 = _mm_packs_epi32(float_to_ubyte(src[2]),
+                                       float_to_ubyte(src[3]));
+
+   return _mm_packus_epi16(p01, p23);
+}
+
+#define PACK_FLOAT_8888(name, swz)                                        \
+__attribute__((target("sse2")))                                           \
+static GLuint                                                             \
+name(GLuint n, const GLfloat src[][4], void *dst)                         \
+{                                                                         \
+   __m128i *d = (__m128i *) dst;                                          \
+   const __m128i zero = _mm_setzero_si128();                              \
+   GLuint i;                                                              \
+                                                                          \
+   for (i = 0; i + 4 <= n; i += 4) {                                      \
+      const __m128i v = floats_to_ubytes(src + i);                        \
+      _mm_storeu_si128(d++, SWIZZLE_8888(v, swz, zero));                  \
+   }                                                                      \
+                                                                          \
+   return i;                                                              \
+}
+
+PACK_FLOAT_8888(pack_float_RGBA8888, _MM_SHUFFLE(0, 1, 2, 3))
+PACK_FLOAT_8888(pack_float_ARGB8888, _MM_SHUFFLE(3, 0, 1, 2))
+PACK_FLOAT_8888(pack_float_ARGB8888_REV, _MM_SHUFFLE(2, 1, 0, 3))
+
+__attribute__((target("sse2")))
+static GLuint
+pack_float_RGBA8888_REV(GLuint n, const GLfloat src[][4], void *dst)
+{
+   __m128i *d = (__m128i *) dst;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4)
+      _mm_storeu_si128(d++, floats_to_ubytes(src + i));
+
+   return i;
+}
+
+__attribute__((target("sse2")))
+static GLuint
+pack_float_RGB565(GLuint n, const GLfloat src[][4], void *dst)
+{
+   GLushort *d = (GLushort *) dst;
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i v = floats_to_ubytes(src + i);
+      _mm_storel_epi64((__m128i *) (d + i), ubytes_to_565(v));
+   }
+
+   return i;
+}
+
+#endif /* USE_IEEE && !DEBUG */
+
+#endif /* MESA_SSE_TARGETS */
+
+
+/**
+ * Unpack the start of a row like _mesa_unpack_rgba_row().
+ */
+GLuint
+_mesa_sse_unpack_rgba_row(gl_format format, GLuint n,
+                          const void *src, GLfloat dst[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return 0;
+
+   switch (format) {
+   case MESA_FORMAT_RGBA8888:
+      return unpack_float_RGBA8888(n, src, dst);
+   case MESA_FORMAT_RGBA8888_REV:
+      return unpack_float_RGBA8888_REV(n, src, dst);
+   case MESA_FORMAT_ARGB8888:
+      return unpack_float_ARGB8888(n, src, dst);
+   case MESA_FORMAT_ARGB8888_REV:
+      return unpack_float_ARGB8888_REV(n, src, dst);
+   case MESA_FORMAT_RGB565:
+      return unpack_float_RGB565(n, src, dst);
+   case MESA_FORMAT_Z24_S8:
+   case MESA_FORMAT_Z24_X8:
+      return unpack_float_Z24_X8(n, src, dst);
+   case MESA_FORMAT_R_FLOAT32:
+      return unpack_float_R_FLOAT32(n, src, dst);
+   case MESA_FORMAT_RGBA_FLOAT16:
+      return unpack_float_RGBA_FLOAT16(n, src, dst);
+   default:
+      break;
+   }
+#endif
+   (void) format;
+   (void) n;
+   (void) src;
+   (void) dst;
+   return 0;
+}
+
+
+/**
+ * Unpack the start of a row like _mesa_unpack_ubyte_rgba_row().
+ */
+GLuint
+_mesa_sse_unpack_ubyte_rgba_row(gl_format format, GLuint n,
+                                const void *src, GLubyte dst[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return 0;
+
+   switch (format) {
+   case MESA_FORMAT_RGBA8888:
+      return reorder_RGBA8888(n, src, dst);
+   case MESA_FORMAT_ARGB8888:
+      return reorder_ARGB8888(n, src, dst);
+   case MESA_FORMAT_ARGB8888_REV:
+      return unpack_ubyte_ARGB8888_REV(n, src, dst);
+   default:
+      break;
+   }
+#endif
+   (void) format;
+   (void) n;
+   (void) src;
+   (void) dst;
+   return 0;
+}
+
+
+/**
+ * Unpack the start of a row like _mesa_unpack_float_z_row().
+ */
+GLuint
+_mesa_sse_unpack_float_z_row(gl_format format, GLuint n,
+                             const void *src, GLfloat *dst)
+{
+#ifdef MESA_SSE_TARGETS
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return 0;
+
+   switch (format) {
+   case MESA_FORMAT_Z24_S8:
+   case MESA_FORMAT_Z24_X8:
+      return unpack_float_z_Z24_X8(n, src, dst);
+   default:
+      break;
+   }
+#endif
+   (void) format;
+   (void) n;
+   (void) src;
+   (void) dst;
+   return 0;
+}
+
+
+/**
+ * Pack the start of a row like _mesa_pack_float_rgba_row().
+ */
+GLuint
+_mesa_sse_pack_float_rgba_row(gl_format format, GLuint n,
+                              const GLfloat src[][4], void *dst)
+{
+#if defined(MESA_SSE_TARGETS) && defined(USE_IEEE) && !defined(DEBUG)
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return 0;
+
+   switch (format) {
+   case MESA_FORMAT_RGBA8888:
+      return pack_float_RGBA8888(n, src, dst);
+   case MESA_FORMAT_RGBA8888_REV:
+      return pack_float_RGBA8888_REV(n, src, dst);
+   case MESA_FORMAT_ARGB8888:
+      return pack_float_ARGB8888(n, src, dst);
+   case MESA_FORMAT_ARGB8888_REV:
+      return pack_float_ARGB8888_REV(n, src, dst);
+   case MESA_FORMAT_RGB565:
+      return pack_float_RGB565(n, src, dst);
+   default:
+      break;
+   }
+#endif
+   (void) format;
+   (void) n;
+   (void) src;
+   (void) dst;
+   return 0;
+}
+
+
+/**
+ * Pack the start of a row like _mesa_pack_ubyte_rgba_row().
+ */
+GLuint
+_mesa_sse_pack_ubyte_rgba_row(gl_format format, GLuint n,
+                              const GLubyte src[][4], void *dst)
+{
+#ifdef MESA_SSE_TARGETS
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return 0;
+
+   switch (format) {
+   case MESA_FORMAT_RGBA8888:
+      return reorder_RGBA8888(n, src, dst);
+   case MESA_FORMAT_ARGB8888:
+      return reorder_ARGB8888(n, src, dst);
+   case MESA_FORMAT_ARGB8888_REV:
+      return pack_ubyte_ARGB8888_REV(n, src, dst);
+   case MESA_FORMAT_RGB565:
+      return pack_ubyte_RGB565(n, src, dst);
+   default:
+      break;
+   }
+#endif
+   (void) format;
+   (void) n;
+   (void) src;
+   (void) dst;
+   return 0;
+}
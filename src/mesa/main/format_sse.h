@@ -0,0 +1,71 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file format_sse.h
+ * SSE2 versions of the format_pack.c and format_unpack.c row functions
+ * for the most common formats.
+ *
+ * Each function returns the number of pixels it converted, 0 if it has
+ * no kernel for the format or the CPU, and the caller converts the rest
+ * of the row.
+ */
+
+
+#ifndef FORMAT_SSE_H
+#define FORMAT_SSE_H
+
+
+#include "formats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+extern GLuint
+_mesa_sse_unpack_rgba_row(gl_format format, GLuint n,
+                          const void *src, GLfloat dst[][4]);
+
+extern GLuint
+_mesa_sse_unpack_ubyte_rgba_row(gl_format format, GLuint n,
+                                const void *src, GLubyte dst[][4]);
+
+extern GLuint
+_mesa_sse_unpack_float_z_row(gl_format format, GLuint n,
+                             const void *src, GLfloat *dst);
+
+extern GLuint
+_mesa_sse_pack_float_rgba_row(gl_format format, GLuint n,
+                              const GLfloat src[][4], void *dst);
+
+extern GLuint
+_mesa_sse_pack_ubyte_rgba_row(gl_format format, GLuint n,
+                              const GLubyte src[][4], void *dst);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FORMAT_SSE_H */
@@ -24,6 +24,7 @@
 
 
 #include "colormac.h"
+#include "format_sse.h"
 #include "format_unpack.h"
 #include "macros.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
@@ -2501,6 +2502,14 @@ _mesa_unpack_rgba_row(gl_format format, GLuint n,
                       const void *src, GLfloat dst[][4])
 {
    unpack_rgba_func unpack = get_unpack_rgba_function(format);
+   GLuint done = _mesa_sse_unpack_rgba_row(format, n, src, dst);
+
+   if (done) {
+      src = (const GLubyte *) src + done * _mesa_get_format_bytes(format);
+      dst += done;
+      n -= done;
+   }
+
    unpack(src, dst, n);
 }
 
@@ -2873,6 +2882,14 @@ void
 _mesa_unpack_ubyte_rgba_row(gl_format format, GLuint n,
                             const void *src, GLubyte dst[][4])
 {
+   GLuint done = _mesa_sse_unpack_ubyte_rgba_row(format, n, src, dst);
+
+   if (done) {
+      src = (const GLubyte *) src + done * _mesa_get_format_bytes(format);
+      dst += done;
+      n -= done;
+   }
+
    switch (format) {
    case MESA_FORMAT_RGBA8888:
       unpack_ubyte_RGBA8888(src, dst, n);
@@ -3907,6 +3924,13 @@ _mesa_unpack_float_z_row(gl_format format, GLuint n,
                          const void *src, GLfloat *dst)
 {
    unpack_float_z_func unpack;
+   GLuint done = _mesa_sse_unpack_float_z_row(format, n, src, dst);
+
+   if (done) {
+      src = (const GLubyte *) src + done * _mesa_get_format_bytes(format);
+      dst += done;
+      n -= done;
+   }
 
    switch (format) {
    case MESA_FORMAT_Z24_S8:
@@ -93,6 +93,10 @@ typedef void *GLeglImageOES;
 #define GL_PROGRAM_BINARY_LENGTH_OES 0x8741
 #endif
 
+#ifndef GL_PROGRAM_BINARY_FORMAT_MESA
+#define GL_PROGRAM_BINARY_FORMAT_MESA 0x875F
+#endif
+
 /* GLES 2.0 tokens */
 #ifndef GL_RGB565
 #define GL_RGB565 0x8D62
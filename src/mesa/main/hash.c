@@ -53,6 +53,31 @@
  */
 #define DELETED_KEY_VALUE 1
 
+/**
+ * Lookups of keys below this may be answered without taking the mutex,
+ * see struct direct_array.
+ */
+#define MAX_DIRECT_KEYS (1 << 16)
+
+#if defined(__GNUC__)
+#define DIRECT_LOOKUPS 1
+#define direct_barrier() __sync_synchronize()
+#endif
+
+/**
+ * Copy of the data of the small keys, which are most GL object names,
+ * indexed by key.  It is only written with the mutex held, and replaced
+ * by a larger copy when a larger key is inserted, so that lookups can
+ * read it without locking.  Replaced arrays stay allocated until the
+ * table is deleted, since a lookup may still be reading them; growing
+ * by powers of two keeps them below the size of the current one.
+ */
+struct direct_array {
+   struct direct_array *prev;            /**< replaced array */
+   GLuint size;
+   void * volatile data[1];
+};
+
 /**
  * The hash table data structure.  
  */
@@ -64,6 +89,7 @@ struct _mesa_HashTable {
    GLboolean InDeleteAll;                /**< Debug check */
    /** Value that would be in the table for DELETED_KEY_VALUE. */
    void *deleted_key_data;
+   struct direct_array * volatile direct;
 };
 
 /** @{
@@ -104,6 +130,69 @@ uint_key(GLuint id)
 }
 /** @} */
 
+/**
+ * Make the direct array cover \p key, if it is small enough.  Called
+ * with the mutex held.
+ */
+static void
+direct_reserve(struct _mesa_HashTable *table, GLuint key)
+{
+#ifdef DIRECT_LOOKUPS
+   struct direct_array *old = table->direct, *array;
+   GLuint size = old ? old->size : 256;
+   struct hash_entry *entry;
+   GLuint i;
+
+   if (key >= MAX_DIRECT_KEYS || (old && key < old->size))
+      return;
+
+   while (size <= key)
+      size *= 2;
+
+   array = calloc(1, sizeof(*array) + (size - 1) * sizeof(array->data[0]));
+   if (!array)
+      return;
+
+   array->prev = old;
+   array->size = size;
+   if (old) {
+      for (i = 0; i < old->size; i++)
+         array->data[i] = old->data[i];
+   }
+
+   /* Keys inserted while they were too large for the old array. */
+   hash_table_foreach(table->ht, entry) {
+      GLuint k = (uintptr_t)entry->key;
+
+      if (k >= (old ? old->size : 0) && k < size)
+         array->data[k] = entry->data;
+   }
+   if (!old)
+      array->data[DELETED_KEY_VALUE] = table->deleted_key_data;
+
+   /* Lookups must see the copied data before the new array. */
+   direct_barrier();
+   table->direct = array;
+#else
+   (void) table;
+   (void) key;
+#endif
+}
+
+
+/**
+ * Update the direct array entry of \p key, with the mutex held.
+ */
+static inline void
+direct_set(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+   struct direct_array *array = table->direct;
+
+   if (array && key < array->size)
+      array->data[key] = data;
+}
+
+
 /**
  * Create a new hash table.
  * 
@@ -144,6 +233,13 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   while (table->direct) {
+      struct direct_array *prev = table->direct->prev;
+
+      free(table->direct);
+      table->direct = prev;
+   }
+
    _glthread_DESTROY_MUTEX(table->Mutex);
    _glthread_DESTROY_MUTEX(table->WalkMutex);
    free(table);
@@ -176,6 +272,10 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * Keys covered by the direct array are looked up without locking, so
+ * that contexts binding objects of a shared table on several threads
+ * don't contend for the mutex.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -186,7 +286,18 @@ void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
    void *res;
+#ifdef DIRECT_LOOKUPS
+   const struct direct_array *array;
+#endif
+
    assert(table);
+
+#ifdef DIRECT_LOOKUPS
+   array = table->direct;
+   if (array && key < array->size)
+      return array->data[key];
+#endif
+
    _glthread_LOCK_MUTEX(table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    _glthread_UNLOCK_MUTEX(table->Mutex);
@@ -216,6 +327,9 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
+   direct_reserve(table, key);
+   direct_set(table, key, data);
+
    if (key == DELETED_KEY_VALUE) {
       table->deleted_key_data = data;
    } else {
@@ -257,6 +371,7 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
    }
 
    _glthread_LOCK_MUTEX(table->Mutex);
+   direct_set(table, key, NULL);
    if (key == DELETED_KEY_VALUE) {
       table->deleted_key_data = NULL;
    } else {
@@ -289,10 +404,12 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
    _glthread_LOCK_MUTEX(table->Mutex);
    table->InDeleteAll = GL_TRUE;
    hash_table_foreach(table->ht, entry) {
+      direct_set(table, (uintptr_t)entry->key, NULL);
       callback((uintptr_t)entry->key, entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
    }
    if (table->deleted_key_data) {
+      direct_set(table, DELETED_KEY_VALUE, NULL);
       callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
       table->deleted_key_data = NULL;
    }
@@ -37,6 +37,7 @@
 #include "texstore.h"
 #include "image.h"
 #include "macros.h"
+#include "mipmap_sse.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
@@ -160,6 +161,20 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    assert(srcWidth == dstWidth || srcWidth == 2 * dstWidth);
    */
 
+   if (srcWidth != dstWidth) {
+      const GLint done = _mesa_sse_downsample_row(datatype, comps, dstWidth,
+                                                  srcRowA, srcRowB, dstRow);
+      if (done) {
+         const GLint bpt = bytes_per_pixel(datatype, comps);
+
+         srcRowA = (const GLubyte *) srcRowA + 2 * done * bpt;
+         srcRowB = (const GLubyte *) srcRowB + 2 * done * bpt;
+         dstRow = (GLubyte *) dstRow + done * bpt;
+         srcWidth -= 2 * done;
+         dstWidth -= done;
+      }
+   }
+
    if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
       GLuint i, j, k;
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
@@ -1405,6 +1420,196 @@ do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
 }
 
 
+/**
+ * The rows of large 2D images are filtered in bands, by a pool of worker
+ * threads together with the calling thread.  MESA_MIPMAP_THREADS sets the
+ * number of threads including the caller, 1 disables the pool, and the
+ * default is one per CPU.
+ */
+#define MAX_MIPMAP_THREADS 16
+
+/** Smallest destination image, in bytes, worth splitting across threads */
+#define MIN_THREADED_BYTES (256 * 1024)
+
+typedef void (*band_func)(void *data, GLint first, GLint last);
+
+#ifdef HAVE_PTHREAD
+
+#include <pthread.h>
+#include <unistd.h>
+
+/** Protects pool_job and pool_serial */
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Broadcast when a job is started */
+static pthread_cond_t pool_start = PTHREAD_COND_INITIALIZER;
+
+/** Signalled when the last band of a job is done */
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Held by the thread running a job.  Others filter their images alone
+ * rather than wait for the pool.
+ */
+static pthread_mutex_t pool_owner = PTHREAD_MUTEX_INITIALIZER;
+
+/** Threads including the caller, 0 until the pool is started */
+static GLint pool_threads;
+
+static unsigned pool_serial;
+
+static struct {
+   band_func func;
+   void *data;
+   GLint count, band;
+   GLint next;        /**< first row of the next band to hand out */
+   GLint remaining;   /**< rows not done yet */
+} pool_job;
+
+
+/**
+ * Run bands of the current job until none are left to start.  Called
+ * and returns with pool_mutex held.
+ */
+static void
+run_bands(void)
+{
+   while (pool_job.next < pool_job.count) {
+      const band_func func = pool_job.func;
+      void *data = pool_job.data;
+      const GLint first = pool_job.next;
+      const GLint last = MIN2(first + pool_job.band, pool_job.count);
+
+      pool_job.next = last;
+      pthread_mutex_unlock(&pool_mutex);
+      func(data, first, last);
+      pthread_mutex_lock(&pool_mutex);
+
+      pool_job.remaining -= last - first;
+      if (pool_job.remaining == 0)
+         pthread_cond_signal(&pool_done);
+   }
+}
+
+
+static void *
+pool_main(void *arg)
+{
+   unsigned serial = 0;
+
+   (void) arg;
+
+   pthread_mutex_lock(&pool_mutex);
+   for (;;) {
+      while (serial == pool_serial)
+         pthread_cond_wait(&pool_start, &pool_mutex);
+      serial = pool_serial;
+      run_bands();
+   }
+
+   return NULL;
+}
+
+
+/**
+ * Start the worker threads.  Called with pool_owner held.
+ */
+static void
+start_pool(void)
+{
+   const char *env = _mesa_getenv("MESA_MIPMAP_THREADS");
+   long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+   pthread_attr_t attr;
+
+   n = CLAMP(n, 1, MAX_MIPMAP_THREADS);
+   pool_threads = 1;
+
+   pthread_attr_init(&attr);
+   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+   while (pool_threads < n) {
+      pthread_t thread;
+
+      if (pthread_create(&thread, &attr, pool_main, NULL) != 0)
+         break;
+      pool_threads++;
+   }
+   pthread_attr_destroy(&attr);
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+/**
+ * Call \p func for rows [0, count) of an image, split in bands across the
+ * thread pool if the image size \p bytes reaches MIN_THREADED_BYTES.
+ */
+static void
+run_rows(band_func func, void *data, GLint count, GLintptr bytes)
+{
+#ifdef HAVE_PTHREAD
+   if (count > 1 && bytes >= MIN_THREADED_BYTES &&
+       pthread_mutex_trylock(&pool_owner) == 0) {
+      if (!pool_threads)
+         start_pool();
+
+      if (pool_threads > 1) {
+         pthread_mutex_lock(&pool_mutex);
+         pool_job.func = func;
+         pool_job.data = data;
+         pool_job.count = count;
+         /* a few bands per thread, for the load to even out */
+         pool_job.band = MAX2(count / (pool_threads * 4), 1);
+         pool_job.next = 0;
+         pool_job.remaining = count;
+         pool_serial++;
+         pthread_cond_broadcast(&pool_start);
+
+         run_bands();
+         while (pool_job.remaining)
+            pthread_cond_wait(&pool_done, &pool_mutex);
+         pthread_mutex_unlock(&pool_mutex);
+
+         pthread_mutex_unlock(&pool_owner);
+         return;
+      }
+
+      pthread_mutex_unlock(&pool_owner);
+   }
+#else
+   (void) bytes;
+#endif
+
+   func(data, 0, count);
+}
+
+
+/** Parameters of downsample_rows() */
+struct mipmap_rows
+{
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth, dstWidth;
+   const GLubyte *srcA, *srcB;
+   GLint srcStep;   /**< from one pair of source rows to the next */
+   GLubyte *dst;
+   GLint dstRowStride;
+};
+
+static void
+downsample_rows(void *data, GLint first, GLint last)
+{
+   const struct mipmap_rows *rows = (const struct mipmap_rows *) data;
+   GLint row;
+
+   for (row = first; row < last; row++) {
+      do_row(rows->datatype, rows->comps, rows->srcWidth,
+             rows->srcA + (GLintptr) row * rows->srcStep,
+             rows->srcB + (GLintptr) row * rows->srcStep,
+             rows->dstWidth, rows->dst + (GLintptr) row * rows->dstRowStride);
+   }
+}
+
+
 /*
  * These functions generate a 1/2-size mipmap image from a source image.
  * Texture borders are handled by copying or averaging the source image's
@@ -1455,6 +1660,7 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLubyte *srcA, *srcB;
    GLubyte *dst;
    GLint row, srcRowStep;
+   struct mipmap_rows rows;
 
    /* Compute src and dst pointers, skipping any border */
    srcA = srcPtr + border * ((srcWidth + 1) * bpt);
@@ -1471,13 +1677,17 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   rows.datatype = datatype;
+   rows.comps = comps;
+   rows.srcWidth = srcWidthNB;
+   rows.dstWidth = dstWidthNB;
+   rows.srcA = srcA;
+   rows.srcB = srcB;
+   rows.srcStep = srcRowStep * srcRowStride;
+   rows.dst = dst;
+   rows.dstRowStride = dstRowStride;
+   run_rows(downsample_rows, &rows, dstHeightNB,
+            (GLintptr) dstHeightNB * dstRowStride);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
@@ -0,0 +1,236 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file mipmap_sse.c
+ * SSE2 kernels for the do_row() box filter of mipmap.c, when the row
+ * width is halved.  Each destination texel is the average of a pair of
+ * texels from two source rows, computed like the C code: truncating
+ * integer division for GLubyte, and the same order of additions for
+ * GLfloat so that the results are identical.
+ */
+
+
+#include "glheader.h"
+#include "cpuinfo.h"
+#include "mipmap_sse.h"
+
+
+#ifdef MESA_SSE_TARGETS
+
+#include <emmintrin.h>
+
+
+/**
+ * Sum of four vectors of 8 bit values, widened to 16 bits, divided by 4.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+average_epu8(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i lo, hi;
+
+   lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                    _mm_unpacklo_epi8(b, zero)),
+                      _mm_add_epi16(_mm_unpacklo_epi8(c, zero),
+                                    _mm_unpacklo_epi8(d, zero)));
+   hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                    _mm_unpackhi_epi8(b, zero)),
+                      _mm_add_epi16(_mm_unpackhi_epi8(c, zero),
+                                    _mm_unpackhi_epi8(d, zero)));
+
+   return _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2));
+}
+
+
+/** Four RGBA8 texels from eight */
+__attribute__((target("sse2")))
+static GLuint
+downsample_ubyte4(GLuint n, const GLubyte *a, const GLubyte *b, GLubyte *dst)
+{
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 a0 = _mm_loadu_ps((const float *) (a + 8 * i));
+      const __m128 a1 = _mm_loadu_ps((const float *) (a + 8 * i + 16));
+      const __m128 b0 = _mm_loadu_ps((const float *) (b + 8 * i));
+      const __m128 b1 = _mm_loadu_ps((const float *) (b + 8 * i + 16));
+
+      /* split even and odd texels, the shuffles don't touch the bits */
+      _mm_storeu_si128((__m128i *) (dst + 4 * i),
+         average_epu8(
+            _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1))),
+            _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)))));
+   }
+
+   return i;
+}
+
+
+/** Sixteen 8 bit texels from 32 */
+__attribute__((target("sse2")))
+static GLuint
+downsample_ubyte1(GLuint n, const GLubyte *a, const GLubyte *b, GLubyte *dst)
+{
+   const __m128i mask = _mm_set1_epi16(0xff);
+   GLuint i;
+
+   for (i = 0; i + 16 <= n; i += 16) {
+      __m128i s[4], sum[2];
+      GLuint j;
+
+      s[0] = _mm_loadu_si128((const __m128i *) (a + 2 * i));
+      s[1] = _mm_loadu_si128((const __m128i *) (a + 2 * i + 16));
+      s[2] = _mm_loadu_si128((const __m128i *) (b + 2 * i));
+      s[3] = _mm_loadu_si128((const __m128i *) (b + 2 * i + 16));
+
+      /* each 16 bit lane holds an even and an odd texel */
+      for (j = 0; j < 2; j++) {
+         sum[j] = _mm_add_epi16(
+            _mm_add_epi16(_mm_and_si128(s[j], mask), _mm_srli_epi16(s[j], 8)),
+            _mm_add_epi16(_mm_and_si128(s[j + 2], mask),
+                          _mm_srli_epi16(s[j + 2], 8)));
+         sum[j] = _mm_srli_epi16(sum[j], 2);
+      }
+
+      _mm_storeu_si128((__m128i *) (dst + i),
+                       _mm_packus_epi16(sum[0], sum[1]));
+   }
+
+   return i;
+}
+
+
+/**
+ * (a0 + a1 + b0 + b1) * 0.25 in the order of the C code.
+ */
+__attribute__((target("sse2")))
+static inline __m128
+average_ps(__m128 a0, __m128 a1, __m128 b0, __m128 b1)
+{
+   return _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a0, a1), b0), b1),
+                     _mm_set1_ps(0.25F));
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+downsample_float1(GLuint n, const GLfloat *a, const GLfloat *b, GLfloat *dst)
+{
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 a0 = _mm_loadu_ps(a + 2 * i);
+      const __m128 a1 = _mm_loadu_ps(a + 2 * i + 4);
+      const __m128 b0 = _mm_loadu_ps(b + 2 * i);
+      const __m128 b1 = _mm_loadu_ps(b + 2 * i + 4);
+
+      _mm_storeu_ps(dst + i,
+                    average_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)),
+                               _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)),
+                               _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)),
+                               _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1))));
+   }
+
+   return i;
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+downsample_float2(GLuint n, const GLfloat *a, const GLfloat *b, GLfloat *dst)
+{
+   GLuint i;
+
+   for (i = 0; i + 2 <= n; i += 2) {
+      const __m128 a0 = _mm_loadu_ps(a + 4 * i);
+      const __m128 a1 = _mm_loadu_ps(a + 4 * i + 4);
+      const __m128 b0 = _mm_loadu_ps(b + 4 * i);
+      const __m128 b1 = _mm_loadu_ps(b + 4 * i + 4);
+
+      _mm_storeu_ps(dst + 2 * i,
+                    average_ps(_mm_movelh_ps(a0, a1), _mm_movehl_ps(a1, a0),
+                               _mm_movelh_ps(b0, b1), _mm_movehl_ps(b1, b0)));
+   }
+
+   return i;
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+downsample_float4(GLuint n, const GLfloat *a, const GLfloat *b, GLfloat *dst)
+{
+   GLuint i;
+
+   for (i = 0; i < n; i++) {
+      _mm_storeu_ps(dst + 4 * i,
+                    average_ps(_mm_loadu_ps(a + 8 * i),
+                               _mm_loadu_ps(a + 8 * i + 4),
+                               _mm_loadu_ps(b + 8 * i),
+                               _mm_loadu_ps(b + 8 * i + 4)));
+   }
+
+   return i;
+}
+
+#endif /* MESA_SSE_TARGETS */
+
+
+/**
+ * Average pairs of texels of two rows into \p dstWidth texels, like
+ * do_row() with a source row twice as wide.
+ *
+ * \return the number of texels done, the caller does the rest
+ */
+GLuint
+_mesa_sse_downsample_row(GLenum datatype, GLuint comps, GLuint dstWidth,
+                         const GLvoid *srcRowA, const GLvoid *srcRowB,
+                         GLvoid *dstRow)
+{
+#ifdef MESA_SSE_TARGETS
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return 0;
+
+   if (datatype == GL_UNSIGNED_BYTE && comps == 4)
+      return downsample_ubyte4(dstWidth, srcRowA, srcRowB, dstRow);
+   if (datatype == GL_UNSIGNED_BYTE && comps == 1)
+      return downsample_ubyte1(dstWidth, srcRowA, srcRowB, dstRow);
+   if (datatype == GL_FLOAT && comps == 4)
+      return downsample_float4(dstWidth, srcRowA, srcRowB, dstRow);
+   if (datatype == GL_FLOAT && comps == 2)
+      return downsample_float2(dstWidth, srcRowA, srcRowB, dstRow);
+   if (datatype == GL_FLOAT && comps == 1)
+      return downsample_float1(dstWidth, srcRowA, srcRowB, dstRow);
+#endif
+   (void) datatype;
+   (void) comps;
+   (void) dstWidth;
+   (void) srcRowA;
+   (void) srcRowB;
+   (void) dstRow;
+   return 0;
+}
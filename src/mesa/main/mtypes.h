@@ -1403,6 +1403,24 @@ struct gl_viewport_attrib
 /**
  * GL_ARB_vertex/pixel_buffer_object buffer object
  */
+/** Number of index ranges cached per buffer object */
+#define MAX_MINMAX_CACHE 8
+
+/**
+ * Bounds of a range of indices in a buffer object, see
+ * vbo_get_minmax_indices().
+ */
+struct gl_minmax_cache_entry
+{
+   GLintptr Offset;             /**< of the first index, in bytes */
+   GLuint Count;
+   GLenum Type;
+   GLboolean Restart;           /**< primitive restart was enabled */
+   GLuint RestartIndex;
+   GLuint Min, Max;
+};
+
+
 struct gl_buffer_object
 {
    _glthread_Mutex Mutex;
@@ -1422,6 +1440,11 @@ struct gl_buffer_object
    GLboolean DeletePending;   /**< true if buffer object is removed from the hash */
    GLboolean Written;   /**< Ever written to? (for debugging) */
    GLboolean Purgeable; /**< Is the buffer purgeable under memory pressure? */
+
+   /** Index bounds, emptied when the contents change (protected by Mutex) */
+   struct gl_minmax_cache_entry MinMaxCache[MAX_MINMAX_CACHE];
+   GLuint NumMinMaxCache;
+   GLuint NextMinMaxCache;      /**< entry to replace when full */
 };
 
 
@@ -2212,6 +2235,7 @@ struct gl_shader
    GLint RefCount;  /**< Reference count */
    GLboolean DeletePending;
    GLboolean CompileStatus;
+   GLuint PendingJobs;  /**< Queued compiles and links using the shader */
    const GLchar *Source;  /**< Source code string */
    GLuint SourceChecksum;       /**< for debug/logging purposes */
    struct gl_program *Program;  /**< Post-compile assembly code */
@@ -2400,6 +2424,14 @@ struct gl_shader_program
     */
    GLboolean InternalSeparateShader;
 
+   /**
+    * State key of a program generated for fixed function state (ralloc'd
+    * on the program), NULL for programs built from application sources.
+    * It stands in for the sources in the on-disk shader cache key.
+    */
+   GLubyte *FixedFunctionKey;
+   GLuint FixedFunctionKeySize;
+
    GLuint NumShaders;          /**< number of attached shaders */
    struct gl_shader **Shaders; /**< List of attached the shaders */
 
@@ -2514,6 +2546,8 @@ struct gl_shader_program
    struct string_to_uint_map *UniformHash;
 
    GLboolean LinkStatus;   /**< GL_LINK_STATUS */
+   GLuint PendingJobs;     /**< Queued links of the program */
+   GLboolean DriverLinkPending; /**< Linked IR not given to the driver yet */
    GLboolean Validated;
    GLboolean _Used;        /**< Ever used for drawing? */
    GLchar *InfoLog;
@@ -2542,6 +2576,8 @@ struct gl_shader_program
 #define GLSL_USE_PROG 0x80  /**< Log glUseProgram calls */
 #define GLSL_REPORT_ERRORS 0x100  /**< Print compilation errors */
 #define GLSL_DUMP_ON_ERROR 0x200 /**< Dump shaders to stderr on compile error */
+#define GLSL_ASYNC   0x400  /**< Compile and link on a worker thread */
+#define GLSL_LINK_STATS 0x800  /**< Print the time spent in each link phase */
 
 
 /**
@@ -2570,6 +2606,8 @@ struct gl_shader_state
    struct gl_shader_program *ActiveProgram;
 
    GLbitfield Flags;                    /**< Mask of GLSL_x flags */
+
+   GLuint PendingJobs;   /**< Queued compiles and links from this context */
 };
 
 
@@ -2599,14 +2637,42 @@ struct gl_shader_compiler_options
    /*@}*/
 
    GLuint MaxIfDepth;               /**< Maximum nested IF blocks */
+
+   /**
+    * Largest cost, in IR instructions, of the branches of an IF block that
+    * is flattened to conditional assignments even within MaxIfDepth.
+    * Zero only flattens the blocks the driver can't nest.
+    */
+   GLuint MaxFlattenIfCost;
+
    GLuint MaxUnrollIterations;
 
+   /**
+    * \name Loop unrolling budgets
+    *
+    * Estimated size of an unrolled loop after constant folding, in IR
+    * instructions and vec4 temporaries.  A zero instruction budget means
+    * 5 * MaxUnrollIterations, a zero temporary budget means no limit.
+    * Neither applies with EmitNoLoops, where loops must be unrolled.
+    */
+   /*@{*/
+   GLuint MaxUnrollInstructions;
+   GLuint MaxUnrollTemps;
+   /*@}*/
+
    /**
     * Prefer DP4 instructions (rather than MUL/MAD) for matrix * vector
     * operations, such as position transformation.
     */
    GLboolean PreferDP4;
 
+   /**
+    * Replace repeated computations of an expression or texture lookup
+    * within a basic block by a temporary.  Backends without a value
+    * numbering pass of their own should set this.
+    */
+   GLboolean OptimizeCSE;
+
    struct gl_sl_pragmas DefaultPragmas; /**< Default #pragma settings */
 };
 
@@ -2703,6 +2769,13 @@ struct gl_shared_state
    struct gl_vertex_program *DefaultVertexProgram;
    struct gl_fragment_program *DefaultFragmentProgram;
    struct gl_geometry_program *DefaultGeometryProgram;
+
+   /**
+    * Programs generated for fixed function state, searched before the
+    * per-context VertexProgram.Cache and FragmentProgram.Cache.
+    */
+   struct gl_program_cache *FixedFuncVertexProgramCache;
+   struct gl_program_cache *FixedFuncFragmentProgramCache;
    /*@}*/
 
    /* GL_ATI_fragment_shader */
@@ -3033,6 +3106,13 @@ struct gl_constants
 
    GLuint GLSLVersion;  /**< GLSL version supported (ex: 120 = 1.20) */
 
+   /**
+    * Number of GL_ARB_get_program_binary formats, 0 or 1.  The only format
+    * is GL_PROGRAM_BINARY_FORMAT_MESA, handled by Driver.GetProgramBinary
+    * and Driver.ProgramBinary.
+    */
+   GLuint NumProgramBinaryFormats;
+
    /**
     * Changes default GLSL extension behavior from "error" to "warn".  It's out
     * of spec, but it can make some apps work that otherwise wouldn't.
@@ -3152,6 +3232,14 @@ struct gl_constants
     */
    GLboolean DisableGLSLLineContinuations;
 
+   /**
+    * Free the GLSL IR and symbol tables of shaders once a program using
+    * them has linked.  A shader is compiled again from its source when it
+    * is linked into another program.  Set by drivers that keep no use for
+    * the linked IR once LinkShader() has translated it.
+    */
+   GLboolean DiscardGLSLIR;
+
    /** GL_ARB_texture_multisample */
    GLint MaxColorTextureSamples;
    GLint MaxDepthTextureSamples;
@@ -3792,6 +3880,12 @@ struct gl_context
    GLboolean _NeedEyeCoords;
    GLboolean _ForceEyeCoords; 
 
+   /**
+    * The state checks of the draw calls passed since the last state
+    * update, see check_valid_to_render().
+    */
+   GLboolean _DrawValid;
+
    GLuint TextureStateTimestamp; /**< detect changes to shared state */
 
    struct gl_list_extensions *ListExt; /**< driver dlist extensions */
@@ -243,6 +243,7 @@ _mesa_map_pbo_dest(struct gl_context *ctx,
 
    if (_mesa_is_bufferobj(pack->BufferObj)) {
       /* pack into PBO */
+      _mesa_bufferobj_invalidate_minmax(pack->BufferObj);
       buf = (GLubyte *) ctx->Driver.MapBufferRange(ctx, 0,
 						   pack->BufferObj->Size,
 						   GL_MAP_WRITE_BIT,
@@ -945,6 +945,10 @@ _mesa_ReadnPixelsARB( GLint x, GLint y, GLsizei width, GLsizei height,
       return;
    }
 
+   /* Drivers may write the PBO without mapping it. */
+   if (_mesa_is_bufferobj(ctx->Pack.BufferObj))
+      _mesa_bufferobj_invalidate_minmax(ctx->Pack.BufferObj);
+
    /* OpenGL ES 1.x and OpenGL ES 2.0 impose additional restrictions on the
     * combinations of format and type that can be used.
     *
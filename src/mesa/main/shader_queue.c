@@ -0,0 +1,246 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file shader_queue.c
+ * Worker thread for glCompileShader and glLinkProgram.
+ *
+ * Without thread support, queueing fails and the callers compile and link
+ * synchronously.
+ */
+
+
+#include <stdlib.h>
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/mtypes.h"
+#include "main/shader_queue.h"
+
+
+#ifdef HAVE_PTHREAD
+
+#include <pthread.h>
+
+
+struct shader_job {
+   struct shader_job *next;
+   struct gl_context *ctx;
+   shader_job_func func;
+   void *data;
+   unsigned num_pending;
+   GLuint *pending[1];   /**< num_pending counters, then the context's */
+};
+
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Signalled when a job is queued or the worker should exit */
+static pthread_cond_t queue_added = PTHREAD_COND_INITIALIZER;
+
+/** Broadcast when a job is done */
+static pthread_cond_t queue_done = PTHREAD_COND_INITIALIZER;
+
+static struct shader_job *queue_head;
+static struct shader_job **queue_tail = &queue_head;
+
+static pthread_t worker;
+static GLboolean worker_started;
+static GLboolean worker_exit;
+
+
+static void *
+worker_main(void *arg)
+{
+   (void) arg;
+
+   pthread_mutex_lock(&queue_mutex);
+
+   for (;;) {
+      struct shader_job *job;
+      unsigned i;
+
+      while (queue_head == NULL && !worker_exit)
+         pthread_cond_wait(&queue_added, &queue_mutex);
+
+      if (queue_head == NULL)
+         break;
+
+      job = queue_head;
+      queue_head = job->next;
+      if (queue_head == NULL)
+         queue_tail = &queue_head;
+
+      pthread_mutex_unlock(&queue_mutex);
+      job->func(job->ctx, job->data);
+      pthread_mutex_lock(&queue_mutex);
+
+      for (i = 0; i <= job->num_pending; i++)
+         (*job->pending[i])--;
+      pthread_cond_broadcast(&queue_done);
+
+      free(job);
+   }
+
+   pthread_mutex_unlock(&queue_mutex);
+   return NULL;
+}
+
+
+/**
+ * Queue \c func(ctx, data) on the worker thread.
+ *
+ * \param pending      Counters of the objects the job uses.  Each is
+ *                     incremented now and decremented once the job is done.
+ * \return GL_FALSE if the job could not be queued, in which case the caller
+ *         should run it itself.
+ */
+GLboolean
+_mesa_queue_shader_job(struct gl_context *ctx, shader_job_func func,
+                       void *data, GLuint **pending, unsigned num_pending)
+{
+   struct shader_job *job;
+   unsigned i;
+
+   job = malloc(sizeof(*job) + num_pending * sizeof(job->pending[0]));
+   if (!job)
+      return GL_FALSE;
+
+   job->next = NULL;
+   job->ctx = ctx;
+   job->func = func;
+   job->data = data;
+   job->num_pending = num_pending;
+   for (i = 0; i < num_pending; i++)
+      job->pending[i] = pending[i];
+   job->pending[num_pending] = &ctx->Shader.PendingJobs;
+
+   pthread_mutex_lock(&queue_mutex);
+
+   if (!worker_started && !worker_exit) {
+      if (pthread_create(&worker, NULL, worker_main, NULL) == 0) {
+         worker_started = GL_TRUE;
+         /* Registered after the compiler's own atexit handler, so that the
+          * worker is gone before the compiler is torn down.
+          */
+         atexit(_mesa_destroy_shader_queue);
+      }
+   }
+
+   if (!worker_started) {
+      pthread_mutex_unlock(&queue_mutex);
+      free(job);
+      return GL_FALSE;
+   }
+
+   for (i = 0; i <= num_pending; i++)
+      (*job->pending[i])++;
+
+   *queue_tail = job;
+   queue_tail = &job->next;
+   pthread_cond_signal(&queue_added);
+
+   pthread_mutex_unlock(&queue_mutex);
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Wait for the jobs counted by \c pending to finish.
+ */
+void
+_mesa_wait_shader_job(GLuint *pending)
+{
+   pthread_mutex_lock(&queue_mutex);
+   while (*pending != 0)
+      pthread_cond_wait(&queue_done, &queue_mutex);
+   pthread_mutex_unlock(&queue_mutex);
+}
+
+
+/**
+ * Wait for all the jobs queued from \c ctx, which is about to be destroyed.
+ */
+void
+_mesa_finish_shader_jobs(struct gl_context *ctx)
+{
+   _mesa_wait_shader_job(&ctx->Shader.PendingJobs);
+}
+
+
+/**
+ * Finish the queued jobs and stop the worker thread.
+ */
+void
+_mesa_destroy_shader_queue(void)
+{
+   GLboolean started;
+
+   pthread_mutex_lock(&queue_mutex);
+   worker_exit = GL_TRUE;
+   started = worker_started;
+   worker_started = GL_FALSE;
+   pthread_cond_signal(&queue_added);
+   pthread_mutex_unlock(&queue_mutex);
+
+   if (started)
+      pthread_join(worker, NULL);
+}
+
+
+#else /* HAVE_PTHREAD */
+
+
+GLboolean
+_mesa_queue_shader_job(struct gl_context *ctx, shader_job_func func,
+                       void *data, GLuint **pending, unsigned num_pending)
+{
+   (void) ctx;
+   (void) func;
+   (void) data;
+   (void) pending;
+   (void) num_pending;
+   return GL_FALSE;
+}
+
+
+void
+_mesa_wait_shader_job(GLuint *pending)
+{
+   (void) pending;
+}
+
+
+void
+_mesa_finish_shader_jobs(struct gl_context *ctx)
+{
+   (void) ctx;
+}
+
+
+void
+_mesa_destroy_shader_queue(void)
+{
+}
+
+
+#endif /* HAVE_PTHREAD */
@@ -0,0 +1,65 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SHADER_QUEUE_H
+#define SHADER_QUEUE_H
+
+
+#include "main/glheader.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+
+/**
+ * Background compile and link of GLSL shaders (MESA_GLSL=async).
+ *
+ * Jobs run in order on a single worker thread.  Every object a job reads
+ * or writes has a counter of the jobs pending on it, and the API thread
+ * waits for the counter to drop to zero before it touches the object
+ * again, which it does whenever the object is looked up by name.
+ */
+
+typedef void (*shader_job_func)(struct gl_context *ctx, void *data);
+
+extern GLboolean
+_mesa_queue_shader_job(struct gl_context *ctx, shader_job_func func,
+                       void *data, GLuint **pending, unsigned num_pending);
+
+extern void
+_mesa_wait_shader_job(GLuint *pending);
+
+extern void
+_mesa_finish_shader_jobs(struct gl_context *ctx);
+
+extern void
+_mesa_destroy_shader_queue(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHADER_QUEUE_H */
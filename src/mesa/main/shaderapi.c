@@ -46,6 +46,7 @@
 #include "main/mtypes.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shader_queue.h"
 #include "main/transformfeedback.h"
 #include "main/uniforms.h"
 #include "program/program.h"
@@ -92,6 +93,10 @@ get_shader_flags(void)
          flags |= GLSL_USE_PROG;
       if (strstr(env, "errors"))
          flags |= GLSL_REPORT_ERRORS;
+      if (strstr(env, "async"))
+         flags |= GLSL_ASYNC;
+      if (strstr(env, "linkstats"))
+         flags |= GLSL_LINK_STATS;
    }
 
    return flags;
@@ -130,6 +135,8 @@ _mesa_init_shader_state(struct gl_context *ctx)
 void
 _mesa_free_shader_state(struct gl_context *ctx)
 {
+   _mesa_finish_shader_jobs(ctx);
+
    _mesa_reference_shader_program(ctx, &ctx->Shader.CurrentVertexProgram, NULL);
    _mesa_reference_shader_program(ctx, &ctx->Shader.CurrentGeometryProgram,
 				  NULL);
@@ -617,7 +624,10 @@ get_programiv(struct gl_context *ctx, GLuint program, GLenum pname, GLint *param
       *params = shProg->BinaryRetreivableHint;
       return;
    case GL_PROGRAM_BINARY_LENGTH:
-      *params = 0;
+      if (shProg->LinkStatus && ctx->Driver.GetProgramBinary)
+         *params = ctx->Driver.GetProgramBinary(ctx, shProg, 0, NULL);
+      else
+         *params = 0;
       return;
    default:
       break;
@@ -720,6 +730,11 @@ shader_source(struct gl_context *ctx, GLuint shader, const GLchar *source)
    if (!sh)
       return;
 
+   /* The last compile, not the new source, is what gets linked, so bring
+    * back the IR of that compile while its source is still around.
+    */
+   _mesa_glsl_restore_shader_ir(ctx, sh);
+
    /* free old shader source string and install new one */
    free((void *)sh->Source);
    sh->Source = source;
@@ -731,28 +746,30 @@ shader_source(struct gl_context *ctx, GLuint shader, const GLchar *source)
 
 
 /**
- * Compile a shader.
+ * Compile a shader, on the worker thread in async mode.
  */
 static void
-compile_shader(struct gl_context *ctx, GLuint shaderObj)
+compile_shader_job(struct gl_context *ctx, void *data)
 {
-   struct gl_shader *sh;
-   struct gl_shader_compiler_options *options;
+   struct gl_shader *sh = (struct gl_shader *) data;
 
-   sh = _mesa_lookup_shader_err(ctx, shaderObj, "glCompileShader");
-   if (!sh)
-      return;
-
-   options = &ctx->ShaderCompilerOptions[_mesa_shader_type_to_index(sh->Type)];
-
-   /* set default pragma state for shader */
-   sh->Pragmas = options->DefaultPragmas;
+   _mesa_trace_begin(ctx, "glCompileShader", sh->SourceChecksum);
 
    if (!sh->Source) {
       /* If the user called glCompileShader without first calling
        * glShaderSource, we should fail to compile, but not raise a GL_ERROR.
        */
       sh->CompileStatus = GL_FALSE;
+   } else if (ctx->Driver.ShaderIsCached &&
+              ctx->Driver.ShaderIsCached(ctx, sh)) {
+      /* This source compiled and linked before.  Leave the compile to a
+       * link which misses the driver's program cache, if any, through
+       * _mesa_glsl_restore_shader_ir().
+       */
+      _mesa_glsl_discard_shader_ir(sh);
+      sh->CompileStatus = GL_TRUE;
+      ralloc_free(sh->InfoLog);
+      sh->InfoLog = ralloc_strdup(sh, "");
    } else {
       if (ctx->Shader.Flags & GLSL_DUMP) {
          printf("GLSL source for %s shader %d:\n",
@@ -797,35 +814,71 @@ compile_shader(struct gl_context *ctx, GLuint shaderObj)
                      sh->Name, sh->InfoLog);
       }
    }
+
+   _mesa_trace_end(ctx);
 }
 
 
 /**
- * Link a program's shaders.
+ * Compile a shader.
  */
 static void
-link_program(struct gl_context *ctx, GLuint program)
+compile_shader(struct gl_context *ctx, GLuint shaderObj)
 {
-   struct gl_shader_program *shProg;
+   struct gl_shader *sh;
+   struct gl_shader_compiler_options *options;
 
-   shProg = _mesa_lookup_shader_program_err(ctx, program, "glLinkProgram");
-   if (!shProg)
+   sh = _mesa_lookup_shader_err(ctx, shaderObj, "glCompileShader");
+   if (!sh)
       return;
 
-   /* From the ARB_transform_feedback2 specification:
-    * "The error INVALID_OPERATION is generated by LinkProgram if <program> is
-    *  the name of a program being used by one or more transform feedback
-    *  objects, even if the objects are not currently bound or are paused."
-    */
-   if (_mesa_transform_feedback_is_using_program(ctx, shProg)) {
-      _mesa_error(ctx, GL_INVALID_OPERATION,
-                  "glLinkProgram(transform feedback is using the program)");
-      return;
+   options = &ctx->ShaderCompilerOptions[_mesa_shader_type_to_index(sh->Type)];
+
+   /* set default pragma state for shader */
+   sh->Pragmas = options->DefaultPragmas;
+
+   if (ctx->Shader.Flags & GLSL_ASYNC) {
+      GLuint *pending = &sh->PendingJobs;
+
+      if (_mesa_queue_shader_job(ctx, compile_shader_job, sh, &pending, 1))
+         return;
    }
 
-   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+   compile_shader_job(ctx, sh);
+}
+
+
+/**
+ * Link a program's GLSL IR, on the worker thread in async mode.
+ *
+ * The driver's part of the link creates programs, releases variants and
+ * compiles through the context's pipe, none of which may happen off the
+ * context's thread.  It is left to _mesa_finish_program_link(), called
+ * when the job is waited for.
+ */
+static void
+link_program_job(struct gl_context *ctx, void *data)
+{
+   struct gl_shader_program *shProg = (struct gl_shader_program *) data;
+
+   _mesa_trace_begin(ctx, "glLinkProgram", 0);
+   _mesa_glsl_link_shader_ir(ctx, shProg);
+   _mesa_trace_end(ctx);
+
+   shProg->DriverLinkPending = GL_TRUE;
+}
+
+
+/**
+ * Give a program whose IR was linked to the driver, and report the result.
+ */
+void
+_mesa_finish_program_link(struct gl_context *ctx,
+                          struct gl_shader_program *shProg)
+{
+   shProg->DriverLinkPending = GL_FALSE;
 
-   _mesa_glsl_link_shader(ctx, shProg);
+   _mesa_glsl_link_shader_driver(ctx, shProg);
 
    if (shProg->LinkStatus == GL_FALSE && 
        (ctx->Shader.Flags & GLSL_REPORT_ERRORS)) {
@@ -850,6 +903,124 @@ link_program(struct gl_context *ctx, GLuint program)
 }
 
 
+/**
+ * Restore \c shProg from the driver's cache of linked programs.
+ * \return GL_TRUE on a hit.
+ */
+static GLboolean
+link_cached_program(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
+   GLboolean hit;
+   GLuint i;
+
+   if (!ctx->Driver.LinkCachedProgram)
+      return GL_FALSE;
+
+   /* Linking must still fail with shaders which didn't compile. */
+   for (i = 0; i < shProg->NumShaders; i++) {
+      _mesa_wait_shader_job(&shProg->Shaders[i]->PendingJobs);
+      if (!shProg->Shaders[i]->CompileStatus)
+         return GL_FALSE;
+   }
+
+   _mesa_trace_begin(ctx, "glLinkProgram", 0);
+   hit = ctx->Driver.LinkCachedProgram(ctx, shProg);
+   _mesa_trace_end(ctx);
+
+   /* On a miss the program is linked as usual, which resets its state. */
+   if (!hit)
+      return GL_FALSE;
+
+   shProg->LinkStatus = GL_TRUE;
+   shProg->Validated = GL_FALSE;
+   shProg->_Used = GL_FALSE;
+   return GL_TRUE;
+}
+
+
+/**
+ * Can \c shProg be relinked behind the back of the context?
+ *
+ * Relinking a program in use replaces the state rendering and glUniform
+ * calls read without looking the program up, so such links are done
+ * synchronously.
+ */
+static GLboolean
+can_link_async(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
+   return ctx->Shader.CurrentVertexProgram != shProg &&
+          ctx->Shader.CurrentGeometryProgram != shProg &&
+          ctx->Shader.CurrentFragmentProgram != shProg &&
+          ctx->Shader.ActiveProgram != shProg;
+}
+
+
+/**
+ * Link a program's shaders.
+ */
+static void
+link_program(struct gl_context *ctx, GLuint program)
+{
+   struct gl_shader_program *shProg;
+
+   shProg = _mesa_lookup_shader_program_err(ctx, program, "glLinkProgram");
+   if (!shProg)
+      return;
+
+   /* From the ARB_transform_feedback2 specification:
+    * "The error INVALID_OPERATION is generated by LinkProgram if <program> is
+    *  the name of a program being used by one or more transform feedback
+    *  objects, even if the objects are not currently bound or are paused."
+    */
+   if (_mesa_transform_feedback_is_using_program(ctx, shProg)) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glLinkProgram(transform feedback is using the program)");
+      return;
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+
+   if (link_cached_program(ctx, shProg))
+      return;
+
+   if ((ctx->Shader.Flags & GLSL_ASYNC) && can_link_async(ctx, shProg)) {
+      /* The link reads the attached shaders, which must not change under
+       * it either.
+       */
+      GLuint **pending = malloc((shProg->NumShaders + 1) * sizeof(*pending));
+
+      if (pending) {
+         GLboolean queued;
+         GLuint i;
+
+         /* The linker deletes the previous linked shaders, and with them
+          * the driver's programs, so do that here and not on the worker.
+          */
+         for (i = 0; i < MESA_SHADER_TYPES; i++) {
+            if (shProg->_LinkedShaders[i]) {
+               ctx->Driver.DeleteShader(ctx, shProg->_LinkedShaders[i]);
+               shProg->_LinkedShaders[i] = NULL;
+            }
+         }
+
+         pending[0] = &shProg->PendingJobs;
+         for (i = 0; i < shProg->NumShaders; i++)
+            pending[i + 1] = &shProg->Shaders[i]->PendingJobs;
+
+         queued = _mesa_queue_shader_job(ctx, link_program_job, shProg,
+                                         pending, shProg->NumShaders + 1);
+         free(pending);
+
+         if (queued)
+            return;
+      }
+   }
+
+   link_program_job(ctx, shProg);
+   _mesa_finish_program_link(ctx, shProg);
+}
+
+
 /**
  * Print basic shader info (for debug).
  */
@@ -965,6 +1136,9 @@ use_shader_program(struct gl_context *ctx, GLenum type,
 void
 _mesa_use_program(struct gl_context *ctx, struct gl_shader_program *shProg)
 {
+   if (shProg && (ctx->Shader.Flags & GLSL_ASYNC))
+      _mesa_wait_shader_program(ctx, shProg);
+
    use_shader_program(ctx, GL_VERTEX_SHADER, shProg);
    use_shader_program(ctx, GL_GEOMETRY_SHADER_ARB, shProg);
    use_shader_program(ctx, GL_FRAGMENT_SHADER, shProg);
@@ -1572,6 +1746,7 @@ _mesa_GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
                        GLenum *binaryFormat, GLvoid *binary)
 {
    struct gl_shader_program *shProg;
+   GLsizei size = 0;
    GET_CURRENT_CONTEXT(ctx);
 
    shProg = _mesa_lookup_shader_program_err(ctx, program, "glGetProgramBinary");
@@ -1590,15 +1765,30 @@ _mesa_GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
       return;
    }
 
+   if (ctx->Driver.GetProgramBinary)
+      size = ctx->Driver.GetProgramBinary(ctx, shProg, bufSize, binary);
+
+   /* The ARB_get_program_binary spec says:
+    *
+    *     "If <bufSize> is less than the number of bytes indicated by the
+    *     value of PROGRAM_BINARY_LENGTH, the error INVALID_OPERATION is
+    *     generated."
+    */
+   if (size > bufSize) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glGetProgramBinary(bufSize too small)");
+      return;
+   }
+
    /* The ARB_get_program_binary spec says:
     *
     *     "If <length> is NULL, then no length is returned."
     */
    if (length != NULL)
-      *length = 0;
+      *length = size;
 
-   (void) binaryFormat;
-   (void) binary;
+   if (binaryFormat != NULL)
+      *binaryFormat = GL_PROGRAM_BINARY_FORMAT_MESA;
 }
 
 void GLAPIENTRY
@@ -1612,10 +1802,45 @@ _mesa_ProgramBinary(GLuint program, GLenum binaryFormat,
    if (!shProg)
       return;
 
-   (void) binaryFormat;
-   (void) binary;
-   (void) length;
-   _mesa_error(ctx, GL_INVALID_OPERATION, __FUNCTION__);
+   if (!ctx->Driver.ProgramBinary || ctx->Const.NumProgramBinaryFormats == 0) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, __FUNCTION__);
+      return;
+   }
+
+   if (binaryFormat != GL_PROGRAM_BINARY_FORMAT_MESA) {
+      _mesa_error(ctx, GL_INVALID_ENUM, "glProgramBinary(binaryFormat)");
+      return;
+   }
+
+   if (length < 0) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "glProgramBinary(length < 0)");
+      return;
+   }
+
+   /* Loading a binary replaces the linked program just like glLinkProgram
+    * does, so the same transform feedback restriction applies.
+    */
+   if (_mesa_transform_feedback_is_using_program(ctx, shProg)) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glProgramBinary(transform feedback is using the program)");
+      return;
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_PROGRAM);
+
+   _mesa_clear_shader_program_data(ctx, shProg);
+   shProg->Validated = GL_FALSE;
+   shProg->_Used = GL_FALSE;
+
+   /* The ARB_get_program_binary spec says:
+    *
+    *     "If ProgramBinary failed to load the binary, LINK_STATUS will be
+    *     set to FALSE."
+    */
+   shProg->LinkStatus = ctx->Driver.ProgramBinary(ctx, shProg, binary, length);
+   if (!shProg->LinkStatus)
+      ralloc_strcat(&shProg->InfoLog,
+                    "program binary is invalid or incompatible\n");
 }
 
 
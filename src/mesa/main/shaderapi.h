@@ -47,6 +47,10 @@ _mesa_copy_string(GLchar *dst, GLsizei maxLength,
 extern void
 _mesa_use_program(struct gl_context *ctx, struct gl_shader_program *shProg);
 
+extern void
+_mesa_finish_program_link(struct gl_context *ctx,
+                          struct gl_shader_program *shProg);
+
 extern void
 _mesa_active_program(struct gl_context *ctx, struct gl_shader_program *shProg,
 		     const char *caller);
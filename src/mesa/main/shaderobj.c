@@ -34,7 +34,9 @@
 #include "main/context.h"
 #include "main/hash.h"
 #include "main/mtypes.h"
+#include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shader_queue.h"
 #include "main/uniforms.h"
 #include "program/program.h"
 #include "program/prog_parameter.h"
@@ -147,6 +149,8 @@ _mesa_lookup_shader(struct gl_context *ctx, GLuint name)
       if (sh && sh->Type == GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      if (sh && (ctx->Shader.Flags & GLSL_ASYNC))
+         _mesa_wait_shader_job(&sh->PendingJobs);
       return sh;
    }
    return NULL;
@@ -174,6 +178,8 @@ _mesa_lookup_shader_err(struct gl_context *ctx, GLuint name, const char *caller)
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      if (ctx->Shader.Flags & GLSL_ASYNC)
+         _mesa_wait_shader_job(&sh->PendingJobs);
       return sh;
    }
 }
@@ -370,6 +376,21 @@ _mesa_delete_shader_program(struct gl_context *ctx, struct gl_shader_program *sh
 }
 
 
+/**
+ * Wait for the queued links of \c shProg, and finish the last one on this
+ * thread.
+ */
+void
+_mesa_wait_shader_program(struct gl_context *ctx,
+                          struct gl_shader_program *shProg)
+{
+   _mesa_wait_shader_job(&shProg->PendingJobs);
+
+   if (shProg->DriverLinkPending)
+      _mesa_finish_program_link(ctx, shProg);
+}
+
+
 /**
  * Lookup a GLSL program object.
  */
@@ -387,6 +408,8 @@ _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name)
       if (shProg && shProg->Type != GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      if (shProg && (ctx->Shader.Flags & GLSL_ASYNC))
+         _mesa_wait_shader_program(ctx, shProg);
       return shProg;
    }
    return NULL;
@@ -415,6 +438,8 @@ _mesa_lookup_shader_program_err(struct gl_context *ctx, GLuint name,
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      if (ctx->Shader.Flags & GLSL_ASYNC)
+         _mesa_wait_shader_program(ctx, shProg);
       return shProg;
    }
 }
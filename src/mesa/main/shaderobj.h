@@ -74,6 +74,10 @@ _mesa_new_shader(struct gl_context *ctx, GLuint name, GLenum type);
 extern void
 _mesa_init_shader_program(struct gl_context *ctx, struct gl_shader_program *prog);
 
+extern void
+_mesa_wait_shader_program(struct gl_context *ctx,
+                          struct gl_shader_program *shProg);
+
 extern struct gl_shader_program *
 _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name);
 
@@ -118,6 +122,26 @@ _mesa_shader_type_to_index(GLenum v)
 }
 
 
+/**
+ * Begin a span of shader work, see dd_function_table::BeginTrace.
+ * \p name must be a string literal.
+ */
+static inline void
+_mesa_trace_begin(struct gl_context *ctx, const char *name, GLuint id)
+{
+   if (ctx->Driver.BeginTrace)
+      ctx->Driver.BeginTrace(ctx, name, id);
+}
+
+
+static inline void
+_mesa_trace_end(struct gl_context *ctx)
+{
+   if (ctx->Driver.EndTrace)
+      ctx->Driver.EndTrace(ctx);
+}
+
+
 static inline GLenum
 _mesa_shader_index_to_type(GLuint i)
 {
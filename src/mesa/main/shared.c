@@ -35,6 +35,7 @@
 #include "bufferobj.h"
 #include "shared.h"
 #include "program/program.h"
+#include "program/prog_cache.h"
 #include "dlist.h"
 #include "samplerobj.h"
 #include "set.h"
@@ -74,6 +75,9 @@ _mesa_alloc_shared_state(struct gl_context *ctx)
       gl_fragment_program(ctx->Driver.NewProgram(ctx,
                                                  GL_FRAGMENT_PROGRAM_ARB, 0));
 
+   shared->FixedFuncVertexProgramCache = _mesa_new_shared_program_cache();
+   shared->FixedFuncFragmentProgramCache = _mesa_new_shared_program_cache();
+
    shared->ATIShaders = _mesa_NewHashTable();
    shared->DefaultFragmentShader = _mesa_new_ati_fragment_shader(ctx, 0);
 
@@ -306,6 +310,9 @@ free_shared_state(struct gl_context *ctx, struct gl_shared_state *shared)
    _mesa_HashDeleteAll(shared->DisplayList, delete_displaylist_cb, ctx);
    _mesa_DeleteHashTable(shared->DisplayList);
 
+   _mesa_delete_program_cache(ctx, shared->FixedFuncVertexProgramCache);
+   _mesa_delete_shader_cache(ctx, shared->FixedFuncFragmentProgramCache);
+
    _mesa_HashWalk(shared->ShaderObjects, free_shader_program_data_cb, ctx);
    _mesa_HashDeleteAll(shared->ShaderObjects, delete_shader_cb, ctx);
    _mesa_DeleteHashTable(shared->ShaderObjects);
@@ -333,6 +333,8 @@ _mesa_update_state_locked( struct gl_context *ctx )
    GLbitfield prog_flags = _NEW_PROGRAM;
    GLbitfield new_prog_state = 0x0;
 
+   ctx->_DrawValid = GL_FALSE;
+
    if (new_state == _NEW_CURRENT_ATTRIB) 
       goto out;
 
@@ -0,0 +1,309 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the format_sse.c row functions give the same results as
+ * the C ones, which are used one pixel at a time.
+ *
+ * DISABLED_Benchmark times the row functions; run it with
+ * --gtest_also_run_disabled_tests, and again with MESA_NO_SSE=1 for the
+ * C numbers.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include "main/cpuinfo.h"
+#include "main/format_pack.h"
+#include "main/format_unpack.h"
+#include "main/macros.h"
+}
+
+
+static const gl_format unpack_formats[] = {
+   MESA_FORMAT_RGBA8888,
+   MESA_FORMAT_RGBA8888_REV,
+   MESA_FORMAT_ARGB8888,
+   MESA_FORMAT_ARGB8888_REV,
+   MESA_FORMAT_RGB565,
+   MESA_FORMAT_Z24_S8,
+   MESA_FORMAT_R_FLOAT32,
+   MESA_FORMAT_RGBA_FLOAT16,
+};
+
+static const gl_format ubyte_formats[] = {
+   MESA_FORMAT_RGBA8888,
+   MESA_FORMAT_RGBA8888_REV,
+   MESA_FORMAT_ARGB8888,
+   MESA_FORMAT_ARGB8888_REV,
+   MESA_FORMAT_RGB565,
+};
+
+#define COUNT 64
+
+
+class FormatSSE : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      /* as done by one_time_init() */
+      for (unsigned i = 0; i < 256; i++)
+         _mesa_ubyte_to_float_color_tab[i] = (float) i / 255.0F;
+      srand(1);
+   }
+
+   void random_bytes(void *data, unsigned size)
+   {
+      for (unsigned i = 0; i < size; i++)
+         ((GLubyte *) data)[i] = rand();
+   }
+};
+
+
+TEST_F(FormatSSE, UnpackRGBA)
+{
+   GLubyte src[COUNT * 16];
+   GLfloat dst[COUNT][4], expected[COUNT][4];
+
+   for (unsigned f = 0; f < ARRAY_SIZE(unpack_formats); f++) {
+      const gl_format format = unpack_formats[f];
+      const GLuint bytes = _mesa_get_format_bytes(format);
+
+      for (unsigned iter = 0; iter < 100; iter++) {
+         const GLuint n = rand() % COUNT;
+
+         random_bytes(src, sizeof(src));
+         memset(dst, 0, sizeof(dst));
+         memset(expected, 0, sizeof(expected));
+
+         _mesa_unpack_rgba_row(format, n, src, dst);
+         for (GLuint i = 0; i < n; i++)
+            _mesa_unpack_rgba_row(format, 1, src + i * bytes, expected + i);
+
+         ASSERT_EQ(0, memcmp(dst, expected, sizeof(dst)))
+            << _mesa_get_format_name(format) << ", " << n << " pixels";
+      }
+   }
+}
+
+
+TEST_F(FormatSSE, UnpackUbyteRGBA)
+{
+   GLubyte src[COUNT * 4];
+   GLubyte dst[COUNT][4], expected[COUNT][4];
+
+   for (unsigned f = 0; f < ARRAY_SIZE(ubyte_formats); f++) {
+      const gl_format format = ubyte_formats[f];
+      const GLuint bytes = _mesa_get_format_bytes(format);
+
+      for (unsigned iter = 0; iter < 100; iter++) {
+         const GLuint n = rand() % COUNT;
+
+         random_bytes(src, sizeof(src));
+         memset(dst, 0, sizeof(dst));
+         memset(expected, 0, sizeof(expected));
+
+         _mesa_unpack_ubyte_rgba_row(format, n, src, dst);
+         for (GLuint i = 0; i < n; i++)
+            _mesa_unpack_ubyte_rgba_row(format, 1, src + i * bytes,
+                                        expected + i);
+
+         ASSERT_EQ(0, memcmp(dst, expected, sizeof(dst)))
+            << _mesa_get_format_name(format) << ", " << n << " pixels";
+      }
+   }
+}
+
+
+TEST_F(FormatSSE, UnpackFloatZ)
+{
+   GLuint src[COUNT];
+   GLfloat dst[COUNT], expected[COUNT];
+
+   for (unsigned iter = 0; iter < 100; iter++) {
+      const GLuint n = rand() % COUNT;
+
+      random_bytes(src, sizeof(src));
+      memset(dst, 0, sizeof(dst));
+      memset(expected, 0, sizeof(expected));
+
+      _mesa_unpack_float_z_row(MESA_FORMAT_Z24_S8, n, src, dst);
+      for (GLuint i = 0; i < n; i++)
+         _mesa_unpack_float_z_row(MESA_FORMAT_Z24_S8, 1, src + i,
+                                  expected + i);
+
+      ASSERT_EQ(0, memcmp(dst, expected, sizeof(dst))) << n << " pixels";
+   }
+}
+
+
+TEST_F(FormatSSE, PackFloatRGBA)
+{
+   static const GLfloat special[] = {
+      0.0F, -0.0F, 1.0F, -1.0F, 0.5F, 1.0F / 255.0F, 254.5F / 255.0F,
+      1.0e-30F, 2.0F, 1.0e30F, -1.0e30F,
+   };
+   GLfloat src[COUNT][4];
+   GLubyte dst[COUNT * 4], expected[COUNT * 4];
+
+   for (unsigned f = 0; f < ARRAY_SIZE(ubyte_formats); f++) {
+      const gl_format format = ubyte_formats[f];
+      const GLuint bytes = _mesa_get_format_bytes(format);
+
+      for (unsigned iter = 0; iter < 100; iter++) {
+         const GLuint n = rand() % COUNT;
+
+         for (GLuint i = 0; i < COUNT; i++) {
+            for (GLuint c = 0; c < 4; c++) {
+               if (rand() % 8 == 0)
+                  src[i][c] = special[rand() % ARRAY_SIZE(special)];
+               else
+                  src[i][c] = (GLfloat) rand() / RAND_MAX * 1.5F - 0.25F;
+            }
+         }
+         memset(dst, 0, sizeof(dst));
+         memset(expected, 0, sizeof(expected));
+
+         _mesa_pack_float_rgba_row(format, n, src, dst);
+         for (GLuint i = 0; i < n; i++)
+            _mesa_pack_float_rgba_row(format, 1, src + i,
+                                      expected + i * bytes);
+
+         ASSERT_EQ(0, memcmp(dst, expected, sizeof(dst)))
+            << _mesa_get_format_name(format) << ", " << n << " pixels";
+      }
+   }
+}
+
+
+TEST_F(FormatSSE, PackUbyteRGBA)
+{
+   GLubyte src[COUNT][4];
+   GLubyte dst[COUNT * 4], expected[COUNT * 4];
+
+   for (unsigned f = 0; f < ARRAY_SIZE(ubyte_formats); f++) {
+      const gl_format format = ubyte_formats[f];
+      const GLuint bytes = _mesa_get_format_bytes(format);
+
+      for (unsigned iter = 0; iter < 100; iter++) {
+         const GLuint n = rand() % COUNT;
+
+         random_bytes(src, sizeof(src));
+         memset(dst, 0, sizeof(dst));
+         memset(expected, 0, sizeof(expected));
+
+         _mesa_pack_ubyte_rgba_row(format, n, src, dst);
+         for (GLuint i = 0; i < n; i++)
+            _mesa_pack_ubyte_rgba_row(format, 1, src + i,
+                                      expected + i * bytes);
+
+         ASSERT_EQ(0, memcmp(dst, expected, sizeof(dst)))
+            << _mesa_get_format_name(format) << ", " << n << " pixels";
+      }
+   }
+}
+
+
+static double
+seconds(clock_t start)
+{
+   return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+TEST_F(FormatSSE, DISABLED_Benchmark)
+{
+   const GLuint width = 1024, rows = 2048;
+   GLubyte *packed = new GLubyte[width * 16];
+   GLfloat (*rgba)[4] = new GLfloat[width][4];
+   GLubyte (*ubyte)[4] = new GLubyte[width][4];
+
+   printf("%s row functions\n",
+          (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2) ? "SSE2" : "C");
+
+   random_bytes(packed, width * 16);
+   random_bytes(ubyte, width * 4);
+   for (GLuint i = 0; i < width; i++) {
+      for (GLuint c = 0; c < 4; c++)
+         rgba[i][c] = (GLfloat) rand() / RAND_MAX;
+   }
+
+   for (unsigned f = 0; f < ARRAY_SIZE(unpack_formats); f++) {
+      const gl_format format = unpack_formats[f];
+      const clock_t start = clock();
+
+      for (GLuint row = 0; row < rows; row++)
+         _mesa_unpack_rgba_row(format, width, packed, rgba);
+
+      printf("unpack float %-24s %8.1f Mpixels/s\n",
+             _mesa_get_format_name(format),
+             width * rows / seconds(start) / 1e6);
+   }
+
+   for (unsigned f = 0; f < ARRAY_SIZE(ubyte_formats); f++) {
+      const gl_format format = ubyte_formats[f];
+      clock_t start = clock();
+
+      for (GLuint row = 0; row < rows; row++)
+         _mesa_unpack_ubyte_rgba_row(format, width, packed, ubyte);
+
+      printf("unpack ubyte %-24s %8.1f Mpixels/s\n",
+             _mesa_get_format_name(format),
+             width * rows / seconds(start) / 1e6);
+
+      start = clock();
+      for (GLuint row = 0; row < rows; row++)
+         _mesa_pack_float_rgba_row(format, width, rgba, packed);
+
+      printf("pack float   %-24s %8.1f Mpixels/s\n",
+             _mesa_get_format_name(format),
+             width * rows / seconds(start) / 1e6);
+
+      start = clock();
+      for (GLuint row = 0; row < rows; row++)
+         _mesa_pack_ubyte_rgba_row(format, width, ubyte, packed);
+
+      printf("pack ubyte   %-24s %8.1f Mpixels/s\n",
+             _mesa_get_format_name(format),
+             width * rows / seconds(start) / 1e6);
+   }
+
+   {
+      GLfloat *z = new GLfloat[width];
+      const clock_t start = clock();
+
+      for (GLuint row = 0; row < rows; row++)
+         _mesa_unpack_float_z_row(MESA_FORMAT_Z24_S8, width, packed, z);
+
+      printf("unpack z     %-24s %8.1f Mpixels/s\n",
+             _mesa_get_format_name(MESA_FORMAT_Z24_S8),
+             width * rows / seconds(start) / 1e6);
+      delete[] z;
+   }
+
+   delete[] packed;
+   delete[] rgba;
+   delete[] ubyte;
+}
@@ -0,0 +1,226 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks _mesa_generate_mipmap_level() against a plain box filter, for
+ * the formats with SSE2 kernels, odd sizes, and images large enough to
+ * be split across the thread pool.
+ *
+ * DISABLED_Benchmark times a full 2D mipmap chain; run it with
+ * --gtest_also_run_disabled_tests, and with MESA_NO_SSE=1 or
+ * MESA_MIPMAP_THREADS=1 to compare.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include "main/cpuinfo.h"
+#include "main/macros.h"
+#include "main/mipmap.h"
+}
+
+
+struct mipmap_type {
+   GLenum datatype;
+   GLuint comps;
+   GLuint size;   /**< bytes per component */
+};
+
+static const mipmap_type types[] = {
+   { GL_UNSIGNED_BYTE, 1, 1 },
+   { GL_UNSIGNED_BYTE, 2, 1 },
+   { GL_UNSIGNED_BYTE, 3, 1 },
+   { GL_UNSIGNED_BYTE, 4, 1 },
+   { GL_FLOAT, 1, 4 },
+   { GL_FLOAT, 2, 4 },
+   { GL_FLOAT, 4, 4 },
+};
+
+static const GLint sizes[][2] = {
+   { 64, 64 },
+   { 37, 19 },
+   { 33, 1 },
+   { 1, 40 },
+   { 1024, 512 },   /* split across threads */
+};
+
+
+class Mipmap : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      srand(1);
+   }
+
+   /**
+    * The box filter of do_row(): average pairs of texels from pairs of
+    * rows, or single ones along a dimension that doesn't shrink.
+    */
+   void reference(const mipmap_type &t, GLint srcWidth, GLint srcHeight,
+                  const GLubyte *src, GLint dstWidth, GLint dstHeight,
+                  GLubyte *dst)
+   {
+      const GLint bpt = t.comps * t.size;
+      const GLint xStep = srcWidth != dstWidth ? 1 : 0;
+      const GLint yStep = srcHeight > 1 && srcHeight > dstHeight ? 1 : 0;
+
+      for (GLint y = 0; y < dstHeight; y++) {
+         const GLint ya = y * (yStep + 1);
+
+         for (GLint x = 0; x < dstWidth; x++) {
+            const GLint xa = x * (xStep + 1);
+
+            for (GLuint c = 0; c < t.comps; c++) {
+               const GLint o[4] = {
+                  (ya * srcWidth + xa) * bpt,
+                  (ya * srcWidth + xa + xStep) * bpt,
+                  ((ya + yStep) * srcWidth + xa) * bpt,
+                  ((ya + yStep) * srcWidth + xa + xStep) * bpt,
+               };
+               GLubyte *d = dst + (y * dstWidth + x) * bpt + c * t.size;
+
+               if (t.datatype == GL_FLOAT) {
+                  const GLfloat *f[4];
+                  for (int i = 0; i < 4; i++)
+                     f[i] = (const GLfloat *) (src + o[i]) + c;
+                  *(GLfloat *) d = (*f[0] + *f[1] + *f[2] + *f[3]) * 0.25F;
+               }
+               else {
+                  *d = (src[o[0] + c] + src[o[1] + c] +
+                        src[o[2] + c] + src[o[3] + c]) / 4;
+               }
+            }
+         }
+      }
+   }
+
+   void random_data(const mipmap_type &t, GLubyte *data, GLint count)
+   {
+      if (t.datatype == GL_FLOAT) {
+         for (GLint i = 0; i < count; i++)
+            ((GLfloat *) data)[i] = (GLfloat) rand() / RAND_MAX * 4.0F - 2.0F;
+      }
+      else {
+         for (GLint i = 0; i < count; i++)
+            data[i] = rand();
+      }
+   }
+};
+
+
+TEST_F(Mipmap, Level2D)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(types); i++) {
+      const mipmap_type &t = types[i];
+      const GLint bpt = t.comps * t.size;
+
+      for (unsigned j = 0; j < ARRAY_SIZE(sizes); j++) {
+         const GLint srcWidth = sizes[j][0], srcHeight = sizes[j][1];
+         const GLint dstWidth = MAX2(srcWidth / 2, 1);
+         const GLint dstHeight = MAX2(srcHeight / 2, 1);
+         GLubyte *src = new GLubyte[srcWidth * srcHeight * bpt];
+         GLubyte *dst = new GLubyte[dstWidth * dstHeight * bpt];
+         GLubyte *ref = new GLubyte[dstWidth * dstHeight * bpt];
+         const GLubyte *srcData[1] = { src };
+         GLubyte *dstData[1] = { dst };
+
+         random_data(t, src, srcWidth * srcHeight * t.comps);
+         reference(t, srcWidth, srcHeight, src, dstWidth, dstHeight, ref);
+
+         _mesa_generate_mipmap_level(GL_TEXTURE_2D, t.datatype, t.comps, 0,
+                                     srcWidth, srcHeight, 1,
+                                     srcData, srcWidth * bpt,
+                                     dstWidth, dstHeight, 1,
+                                     dstData, dstWidth * bpt);
+
+         EXPECT_EQ(0, memcmp(dst, ref, dstWidth * dstHeight * bpt))
+            << "type 0x" << std::hex << t.datatype << std::dec
+            << " comps " << t.comps
+            << " size " << srcWidth << "x" << srcHeight;
+
+         delete [] src;
+         delete [] dst;
+         delete [] ref;
+      }
+   }
+}
+
+
+static double
+wall_seconds(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+TEST_F(Mipmap, DISABLED_Benchmark)
+{
+   static const mipmap_type bench_types[] = {
+      { GL_UNSIGNED_BYTE, 4, 1 },
+      { GL_FLOAT, 4, 4 },
+   };
+   const GLint size = 4096;
+
+   printf("%s kernels\n",
+          (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2) ? "SSE2" : "C");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(bench_types); i++) {
+      const mipmap_type &t = bench_types[i];
+      const GLint bpt = t.comps * t.size;
+      GLubyte *levels[2];
+      GLint width = size, height = size;
+      double start;
+
+      levels[0] = new GLubyte[size * size * bpt];
+      levels[1] = new GLubyte[size * size * bpt / 4];
+      random_data(t, levels[0], size * size * t.comps);
+
+      start = wall_seconds();
+      for (int level = 0; width > 1 || height > 1; level++) {
+         const GLint dstWidth = MAX2(width / 2, 1);
+         const GLint dstHeight = MAX2(height / 2, 1);
+         const GLubyte *srcData[1] = { levels[level & 1] };
+         GLubyte *dstData[1] = { levels[(level + 1) & 1] };
+
+         _mesa_generate_mipmap_level(GL_TEXTURE_2D, t.datatype, t.comps, 0,
+                                     width, height, 1,
+                                     srcData, width * bpt,
+                                     dstWidth, dstHeight, 1,
+                                     dstData, dstWidth * bpt);
+         width = dstWidth;
+         height = dstHeight;
+      }
+
+      printf("%dx%d %s %u comps: %.1f ms\n", size, size,
+             t.datatype == GL_FLOAT ? "float" : "ubyte", t.comps,
+             (wall_seconds() - start) * 1000.0);
+
+      delete [] levels[0];
+      delete [] levels[1];
+   }
+}
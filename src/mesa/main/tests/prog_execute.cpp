@@ -0,0 +1,256 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the programs decoded by _mesa_begin_program_batch() give
+ * the same results as the generic interpreter of _mesa_execute_program().
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "main/mtypes.h"
+#include "program/prog_execute.h"
+#include "program/prog_instruction.h"
+}
+
+
+#define NUM_ELEMENTS 8
+
+
+class prog_execute : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct prog_instruction *emit(gl_inst_opcode opcode,
+                                 gl_register_file file, GLuint index,
+                                 GLuint writeMask);
+   void src(struct prog_instruction *inst, GLuint i,
+            gl_register_file file, GLint index,
+            GLuint swizzle = SWIZZLE_NOOP, GLuint negate = NEGATE_NONE,
+            GLboolean abs = GL_FALSE);
+   void run(GLboolean expect_decoded);
+
+   struct gl_context *ctx;
+   struct gl_program prog;
+   struct prog_instruction insts[32];
+   GLfloat (*attribs)[PROG_MAX_WIDTH][4];
+};
+
+
+void
+prog_execute::SetUp()
+{
+   ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+   attribs = (GLfloat (*)[PROG_MAX_WIDTH][4])
+      calloc(VARYING_SLOT_MAX, sizeof(*attribs));
+   memset(&prog, 0, sizeof prog);
+   memset(insts, 0, sizeof insts);
+   prog.Instructions = insts;
+   prog.Target = GL_VERTEX_PROGRAM_ARB;
+
+   for (GLuint i = 0; i < MAX_PROGRAM_ENV_PARAMS; i++) {
+      for (GLuint c = 0; c < 4; c++) {
+         ctx->VertexProgram.Parameters[i][c] = (i + 1) * 0.375f - c * 0.625f;
+         ctx->FragmentProgram.Parameters[i][c] = c * 0.25f - i * 0.125f;
+      }
+   }
+
+   for (GLuint attr = 0; attr < VARYING_SLOT_MAX; attr++) {
+      for (GLuint e = 0; e < NUM_ELEMENTS; e++) {
+         for (GLuint c = 0; c < 4; c++)
+            attribs[attr][e][c] = (GLfloat) ((attr * 7 + e * 3 + c) % 11) / 5.0f - 1.0f;
+      }
+   }
+}
+
+
+void
+prog_execute::TearDown()
+{
+   free(attribs);
+   free(ctx);
+}
+
+
+struct prog_instruction *
+prog_execute::emit(gl_inst_opcode opcode, gl_register_file file, GLuint index,
+                   GLuint writeMask)
+{
+   struct prog_instruction *inst = &insts[prog.NumInstructions++];
+
+   inst->Opcode = opcode;
+   inst->DstReg.File = file;
+   inst->DstReg.Index = index;
+   inst->DstReg.WriteMask = writeMask;
+   inst->DstReg.CondMask = COND_TR;
+   inst->DstReg.CondSwizzle = SWIZZLE_NOOP;
+   return inst;
+}
+
+
+void
+prog_execute::src(struct prog_instruction *inst, GLuint i,
+                  gl_register_file file, GLint index,
+                  GLuint swizzle, GLuint negate, GLboolean abs)
+{
+   inst->SrcReg[i].File = file;
+   inst->SrcReg[i].Index = index;
+   inst->SrcReg[i].Swizzle = swizzle;
+   inst->SrcReg[i].Negate = negate;
+   inst->SrcReg[i].Abs = abs;
+}
+
+
+/**
+ * Run the program for each element with both interpreters and compare
+ * the outputs and kills bit for bit.
+ */
+void
+prog_execute::run(GLboolean expect_decoded)
+{
+   struct gl_program_machine *generic = (struct gl_program_machine *)
+      calloc(1, sizeof(*generic));
+   struct gl_program_machine *decoded = (struct gl_program_machine *)
+      calloc(1, sizeof(*decoded));
+
+   emit(OPCODE_END, PROGRAM_UNDEFINED, 0, 0);
+
+   generic->Attribs = attribs;
+   decoded->Attribs = attribs;
+
+   EXPECT_EQ(expect_decoded, _mesa_begin_program_batch(ctx, &prog, decoded));
+
+   for (GLuint e = 0; e < NUM_ELEMENTS; e++) {
+      for (GLuint c = 0; c < 4; c++) {
+         generic->VertAttribs[0][c] = decoded->VertAttribs[0][c] =
+            attribs[VARYING_SLOT_TEX0][e][c];
+      }
+      generic->CurElement = decoded->CurElement = e;
+
+      GLboolean alive_generic = _mesa_execute_program(ctx, &prog, generic);
+      GLboolean alive_decoded = _mesa_execute_program(ctx, &prog, decoded);
+
+      EXPECT_EQ(alive_generic, alive_decoded) << "element " << e;
+      EXPECT_EQ(0, memcmp(generic->Outputs, decoded->Outputs,
+                          sizeof generic->Outputs)) << "element " << e;
+      EXPECT_EQ(0, memcmp(generic->Temporaries, decoded->Temporaries,
+                          sizeof generic->Temporaries)) << "element " << e;
+   }
+
+   _mesa_end_program_batch(decoded);
+   _mesa_free_program_machine(decoded);
+   free(decoded);
+   free(generic);
+}
+
+
+TEST_F(prog_execute, vertex_arithmetic)
+{
+   struct prog_instruction *inst;
+
+   inst = emit(OPCODE_MAD, PROGRAM_TEMPORARY, 0, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_INPUT, 0, MAKE_SWIZZLE4(3, 1, 0, 2), NEGATE_XYZW);
+   src(inst, 1, PROGRAM_ENV_PARAM, 1, SWIZZLE_NOOP, NEGATE_NONE, GL_TRUE);
+   src(inst, 2, PROGRAM_ENV_PARAM, 2);
+
+   inst = emit(OPCODE_DP4, PROGRAM_OUTPUT, 0, WRITEMASK_XZ);
+   src(inst, 0, PROGRAM_TEMPORARY, 0);
+   src(inst, 1, PROGRAM_ENV_PARAM, 3);
+
+   inst = emit(OPCODE_LIT, PROGRAM_OUTPUT, 1, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_TEMPORARY, 0, MAKE_SWIZZLE4(1, 0, 2, 3),
+       NEGATE_NONE, GL_TRUE);
+   inst->SaturateMode = SATURATE_ZERO_ONE;
+
+   inst = emit(OPCODE_RSQ, PROGRAM_TEMPORARY, 1, WRITEMASK_YW);
+   src(inst, 0, PROGRAM_TEMPORARY, 0, SWIZZLE_ZZZZ, NEGATE_XYZW);
+
+   inst = emit(OPCODE_XPD, PROGRAM_TEMPORARY, 2, WRITEMASK_XYZ);
+   src(inst, 0, PROGRAM_TEMPORARY, 1);
+   src(inst, 1, PROGRAM_INPUT, 0, MAKE_SWIZZLE4(3, 2, 1, 0));
+
+   inst = emit(OPCODE_POW, PROGRAM_OUTPUT, 2, WRITEMASK_X);
+   src(inst, 0, PROGRAM_TEMPORARY, 2, SWIZZLE_YYYY, NEGATE_NONE, GL_TRUE);
+   src(inst, 1, PROGRAM_ENV_PARAM, 0, SWIZZLE_WWWW);
+
+   inst = emit(OPCODE_SLT, PROGRAM_OUTPUT, 3, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_TEMPORARY, 2);
+   src(inst, 1, PROGRAM_TEMPORARY, 0);
+
+   inst = emit(OPCODE_FRC, PROGRAM_OUTPUT, 4, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_TEMPORARY, 0, SWIZZLE_NOOP, NEGATE_XYZW);
+
+   inst = emit(OPCODE_EX2, PROGRAM_OUTPUT, 4, WRITEMASK_W);
+   src(inst, 0, PROGRAM_TEMPORARY, 0, SWIZZLE_XXXX);
+
+   run(GL_TRUE);
+}
+
+
+TEST_F(prog_execute, fragment_inputs_and_kill)
+{
+   struct prog_instruction *inst;
+
+   prog.Target = GL_FRAGMENT_PROGRAM_ARB;
+
+   inst = emit(OPCODE_SUB, PROGRAM_TEMPORARY, 0, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_INPUT, VARYING_SLOT_COL0);
+   src(inst, 1, PROGRAM_INPUT, VARYING_SLOT_TEX1, SWIZZLE_YYYY);
+
+   inst = emit(OPCODE_LRP, PROGRAM_OUTPUT, FRAG_RESULT_COLOR, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_TEMPORARY, 0, SWIZZLE_NOOP, NEGATE_NONE, GL_TRUE);
+   src(inst, 1, PROGRAM_INPUT, VARYING_SLOT_COL0, MAKE_SWIZZLE4(3, 2, 1, 0));
+   src(inst, 2, PROGRAM_ENV_PARAM, 3);
+   inst->SaturateMode = SATURATE_ZERO_ONE;
+
+   inst = emit(OPCODE_CMP, PROGRAM_OUTPUT, FRAG_RESULT_DEPTH, WRITEMASK_Z);
+   src(inst, 0, PROGRAM_TEMPORARY, 0);
+   src(inst, 1, PROGRAM_ENV_PARAM, 1);
+   src(inst, 2, PROGRAM_INPUT, VARYING_SLOT_TEX1, SWIZZLE_NOOP, NEGATE_XYZW);
+
+   inst = emit(OPCODE_KIL, PROGRAM_UNDEFINED, 0, 0);
+   src(inst, 0, PROGRAM_TEMPORARY, 0, SWIZZLE_XXXX);
+
+   inst = emit(OPCODE_MOV, PROGRAM_OUTPUT, FRAG_RESULT_DATA0, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_TEMPORARY, 0);
+
+   run(GL_TRUE);
+}
+
+
+TEST_F(prog_execute, cond_update_uses_generic_path)
+{
+   struct prog_instruction *inst;
+
+   inst = emit(OPCODE_ADD, PROGRAM_TEMPORARY, 0, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_INPUT, 0);
+   src(inst, 1, PROGRAM_ENV_PARAM, 2);
+   inst->CondUpdate = GL_TRUE;
+
+   inst = emit(OPCODE_MOV, PROGRAM_OUTPUT, 0, WRITEMASK_XYZW);
+   src(inst, 0, PROGRAM_TEMPORARY, 0);
+
+   run(GL_FALSE);
+}
@@ -0,0 +1,454 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the swrast/s_span_sse.c kernels give the same results as
+ * the C loops of s_blend.c, s_depth.c and s_texfilter.c, which are
+ * copied here.
+ *
+ * DISABLED_Benchmark times the kernels; run it with
+ * --gtest_also_run_disabled_tests, and again with MESA_NO_SSE=1 for the
+ * C numbers.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include "main/cpuinfo.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "swrast/s_span_sse.h"
+}
+
+
+#define COUNT 67
+
+#define DIV255(X)  (divtemp = (X), ((divtemp << 8) + divtemp + 256) >> 16)
+#define LERP(T, A, B)  ( (A) + (T) * ((B) - (A)) )
+
+
+enum blend_op {
+   BLEND_TRANSPARENCY,
+   BLEND_ADD,
+   BLEND_MIN,
+   BLEND_MAX,
+   BLEND_MODULATE,
+};
+
+
+static void
+blend_c(enum blend_op op, GLuint first, GLuint n, const GLubyte mask[],
+        GLubyte rgba[][4], const GLubyte dest[][4])
+{
+   for (GLuint i = first; i < n; i++) {
+      if (!mask[i])
+         continue;
+
+      const GLint t = rgba[i][ACOMP];
+
+      for (GLuint c = 0; c < 4; c++) {
+         const GLint s = rgba[i][c], d = dest[i][c];
+         GLint divtemp;
+
+         switch (op) {
+         case BLEND_TRANSPARENCY:
+            if (t == 0)
+               rgba[i][c] = d;
+            else if (t != 255)
+               rgba[i][c] = DIV255((s - d) * t) + d;
+            break;
+         case BLEND_ADD:
+            rgba[i][c] = MIN2(s + d, 255);
+            break;
+         case BLEND_MIN:
+            rgba[i][c] = MIN2(s, d);
+            break;
+         case BLEND_MAX:
+            rgba[i][c] = MAX2(s, d);
+            break;
+         case BLEND_MODULATE:
+            rgba[i][c] = DIV255(s * d);
+            break;
+         }
+      }
+   }
+}
+
+
+static GLuint
+blend_sse(enum blend_op op, GLuint n, const GLubyte mask[],
+          GLubyte rgba[][4], const GLubyte dest[][4])
+{
+   switch (op) {
+   case BLEND_TRANSPARENCY:
+      return _swrast_sse_blend_transparency_ubyte(n, mask, rgba, dest);
+   case BLEND_ADD:
+      return _swrast_sse_blend_add_ubyte(n, mask, rgba, dest);
+   case BLEND_MIN:
+      return _swrast_sse_blend_min_ubyte(n, mask, rgba, dest);
+   case BLEND_MAX:
+      return _swrast_sse_blend_max_ubyte(n, mask, rgba, dest);
+   case BLEND_MODULATE:
+      return _swrast_sse_blend_modulate_ubyte(n, mask, rgba, dest);
+   }
+   return 0;
+}
+
+
+static bool
+depth_pass(GLenum func, GLuint zfrag, GLuint zbuf)
+{
+   switch (func) {
+   case GL_LESS:
+      return zfrag < zbuf;
+   case GL_LEQUAL:
+      return zfrag <= zbuf;
+   case GL_GEQUAL:
+      return zfrag >= zbuf;
+   case GL_GREATER:
+      return zfrag > zbuf;
+   case GL_NOTEQUAL:
+      return zfrag != zbuf;
+   case GL_EQUAL:
+      return zfrag == zbuf;
+   default:
+      return true;
+   }
+}
+
+
+template<typename T>
+static GLuint
+depth_test_c(GLenum func, GLboolean write, GLuint first, GLuint n,
+             T zbuffer[], const GLuint zfrag[], GLubyte mask[])
+{
+   GLuint passed = 0;
+
+   for (GLuint i = first; i < n; i++) {
+      if (mask[i]) {
+         if (depth_pass(func, zfrag[i], zbuffer[i])) {
+            if (write)
+               zbuffer[i] = zfrag[i];
+            passed++;
+         }
+         else {
+            mask[i] = 0;
+         }
+      }
+   }
+
+   return passed;
+}
+
+
+static void
+sample_linear_c(const GLubyte *texels, GLint rowStride, GLuint width,
+                GLuint height, GLuint first, GLuint n,
+                const GLfloat texcoords[][4], GLfloat rgba[][4])
+{
+   for (GLuint k = first; k < n; k++) {
+      const GLfloat u = texcoords[k][0] * width - 0.5F;
+      const GLfloat v = texcoords[k][1] * height - 0.5F;
+      const GLint i[2] = { IFLOOR(u) & (GLint) (width - 1),
+                           (IFLOOR(u) + 1) & (GLint) (width - 1) };
+      const GLint j[2] = { IFLOOR(v) & (GLint) (height - 1),
+                           (IFLOOR(v) + 1) & (GLint) (height - 1) };
+      const GLfloat a = u - IFLOOR(u), b = v - IFLOOR(v);
+      GLfloat t[2][2][4];
+
+      for (unsigned y = 0; y < 2; y++) {
+         for (unsigned x = 0; x < 2; x++) {
+            const GLuint s =
+               *((const GLuint *) (texels + rowStride * j[y]) + i[x]);
+            t[y][x][RCOMP] = UBYTE_TO_FLOAT(s >> 24);
+            t[y][x][GCOMP] = UBYTE_TO_FLOAT((s >> 16) & 0xff);
+            t[y][x][BCOMP] = UBYTE_TO_FLOAT((s >> 8) & 0xff);
+            t[y][x][ACOMP] = UBYTE_TO_FLOAT(s & 0xff);
+         }
+      }
+
+      for (unsigned c = 0; c < 4; c++) {
+         const GLfloat t0 = LERP(a, t[0][0][c], t[0][1][c]);
+         const GLfloat t1 = LERP(a, t[1][0][c], t[1][1][c]);
+         rgba[k][c] = LERP(b, t0, t1);
+      }
+   }
+}
+
+
+class SpanSSE : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      /* as done by one_time_init() */
+      for (unsigned i = 0; i < 256; i++)
+         _mesa_ubyte_to_float_color_tab[i] = (float) i / 255.0F;
+      srand(1);
+   }
+
+   void random_bytes(void *data, unsigned size)
+   {
+      for (unsigned i = 0; i < size; i++)
+         ((GLubyte *) data)[i] = rand();
+   }
+
+   void random_mask(GLubyte mask[], unsigned n)
+   {
+      for (unsigned i = 0; i < n; i++)
+         mask[i] = (rand() % 4) ? 1 + rand() % 2 : 0;
+   }
+};
+
+
+TEST_F(SpanSSE, Blend)
+{
+   static const enum blend_op ops[] = {
+      BLEND_TRANSPARENCY, BLEND_ADD, BLEND_MIN, BLEND_MAX, BLEND_MODULATE,
+   };
+   GLubyte rgba[COUNT][4], expected[COUNT][4], dest[COUNT][4];
+   GLubyte mask[COUNT];
+
+   for (unsigned o = 0; o < ARRAY_SIZE(ops); o++) {
+      for (unsigned iter = 0; iter < 100; iter++) {
+         const GLuint n = rand() % COUNT;
+
+         random_bytes(rgba, sizeof(rgba));
+         random_bytes(dest, sizeof(dest));
+         random_mask(mask, COUNT);
+         /* the special cases of blend_transparency_ubyte() */
+         for (GLuint i = 0; i < COUNT; i += 3)
+            rgba[i][ACOMP] = (rand() % 2) ? 0 : 255;
+         memcpy(expected, rgba, sizeof(rgba));
+
+         const GLuint done = blend_sse(ops[o], n, mask, rgba, dest);
+         ASSERT_LE(done, n);
+         blend_c(ops[o], done, n, mask, rgba, dest);
+         blend_c(ops[o], 0, n, mask, expected, dest);
+
+         ASSERT_EQ(0, memcmp(rgba, expected, sizeof(rgba)))
+            << "op " << ops[o] << ", " << n << " pixels";
+      }
+   }
+}
+
+
+TEST_F(SpanSSE, DepthTest)
+{
+   static const GLenum funcs[] = {
+      GL_LESS, GL_LEQUAL, GL_GEQUAL, GL_GREATER, GL_NOTEQUAL, GL_EQUAL,
+      GL_ALWAYS,
+   };
+   GLuint zfrag[COUNT], z32[COUNT], z32_expected[COUNT];
+   GLushort z16[COUNT], z16_expected[COUNT];
+   GLubyte mask[COUNT], mask_expected[COUNT];
+
+   for (unsigned f = 0; f < ARRAY_SIZE(funcs); f++) {
+      for (unsigned iter = 0; iter < 200; iter++) {
+         const GLuint n = rand() % COUNT;
+         const GLboolean write = iter & 1;
+         /* 16, 24 or 32 bit values, with some equal ones */
+         const GLuint bits = (iter % 3 == 0) ? 16 : (iter % 3 == 1) ? 24 : 32;
+         const GLuint zmask = (GLuint) (~0ull >> (64 - bits));
+         GLuint passed, passed_expected, done;
+
+         random_bytes(zfrag, sizeof(zfrag));
+         random_bytes(z32, sizeof(z32));
+         random_mask(mask, COUNT);
+         for (GLuint i = 0; i < COUNT; i++) {
+            zfrag[i] &= zmask;
+            z32[i] = (rand() % 4) ? z32[i] & zmask : zfrag[i];
+            z16[i] = z32[i];
+         }
+
+         if (bits == 16) {
+            memcpy(z16_expected, z16, sizeof(z16));
+            memcpy(mask_expected, mask, sizeof(mask));
+            passed = 0;
+            done = _swrast_sse_depth_test_span16(funcs[f], write, n, z16,
+                                                 zfrag, mask, &passed);
+            ASSERT_LE(done, n);
+            passed += depth_test_c(funcs[f], write, done, n, z16, zfrag,
+                                   mask);
+            passed_expected = depth_test_c(funcs[f], write, 0, n,
+                                           z16_expected, zfrag,
+                                           mask_expected);
+
+            ASSERT_EQ(0, memcmp(z16, z16_expected, sizeof(z16)));
+         }
+         else {
+            memcpy(z32_expected, z32, sizeof(z32));
+            memcpy(mask_expected, mask, sizeof(mask));
+            passed = 0;
+            done = _swrast_sse_depth_test_span32(funcs[f], write, n, z32,
+                                                 zfrag, mask, &passed);
+            ASSERT_LE(done, n);
+            passed += depth_test_c(funcs[f], write, done, n, z32, zfrag,
+                                   mask);
+            passed_expected = depth_test_c(funcs[f], write, 0, n,
+                                           z32_expected, zfrag,
+                                           mask_expected);
+
+            ASSERT_EQ(0, memcmp(z32, z32_expected, sizeof(z32)));
+         }
+
+         ASSERT_EQ(0, memcmp(mask, mask_expected, sizeof(mask)))
+            << "func 0x" << std::hex << funcs[f] << ", " << bits << " bits";
+         ASSERT_EQ(passed_expected, passed);
+      }
+   }
+}
+
+
+TEST_F(SpanSSE, SampleLinear)
+{
+   static const GLuint sizes[][2] = { { 1, 1 }, { 2, 8 }, { 16, 4 }, { 64, 32 } };
+   GLfloat texcoords[COUNT][4], rgba[COUNT][4], expected[COUNT][4];
+
+   for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+      const GLuint width = sizes[s][0], height = sizes[s][1];
+      /* a row stride that isn't the width */
+      const GLint rowStride = width * 4 + 12;
+      GLubyte *texels = new GLubyte[rowStride * height];
+
+      random_bytes(texels, rowStride * height);
+
+      for (unsigned iter = 0; iter < 100; iter++) {
+         const GLuint n = rand() % COUNT;
+
+         for (GLuint k = 0; k < COUNT; k++) {
+            texcoords[k][0] = (GLfloat) rand() / RAND_MAX * 4.0F - 2.0F;
+            texcoords[k][1] = (GLfloat) rand() / RAND_MAX * 4.0F - 2.0F;
+            /* on the texel centers */
+            if (k % 5 == 0)
+               texcoords[k][0] = (GLfloat) (rand() % width + 0.5) / width;
+         }
+         memset(rgba, 0, sizeof(rgba));
+         memset(expected, 0, sizeof(expected));
+
+         const GLuint done =
+            _swrast_sse_sample_2d_linear_rgba8888(texels, rowStride, width,
+                                                  height, n, texcoords, rgba);
+         ASSERT_LE(done, n);
+         sample_linear_c(texels, rowStride, width, height, done, n,
+                         texcoords, rgba);
+         sample_linear_c(texels, rowStride, width, height, 0, n,
+                         texcoords, expected);
+
+         ASSERT_EQ(0, memcmp(rgba, expected, sizeof(rgba)))
+            << width << "x" << height << ", " << n << " pixels";
+      }
+
+      delete[] texels;
+   }
+}
+
+
+static double
+seconds(clock_t start)
+{
+   return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+TEST_F(SpanSSE, DISABLED_Benchmark)
+{
+   const GLuint width = 1024, rows = 4096;
+   GLubyte (*rgba)[4] = new GLubyte[width][4];
+   GLubyte (*dest)[4] = new GLubyte[width][4];
+   GLubyte *mask = new GLubyte[width];
+   GLuint *zfrag = new GLuint[width];
+   GLuint *z32 = new GLuint[width];
+   GLushort *z16 = new GLushort[width];
+   GLfloat (*texcoords)[4] = new GLfloat[width][4];
+   GLfloat (*texels)[4] = new GLfloat[width][4];
+   GLuint *texture = new GLuint[256 * 256];
+   clock_t start;
+
+   printf("%s span functions\n",
+          (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2) ? "SSE2" : "C");
+
+   random_bytes(rgba, width * 4);
+   random_bytes(dest, width * 4);
+   random_bytes(zfrag, width * 4);
+   random_bytes(texture, 256 * 256 * 4);
+   memset(mask, 1, width);
+   for (GLuint i = 0; i < width; i++) {
+      z32[i] = zfrag[i] >> 8;
+      z16[i] = zfrag[i] >> 16;
+      texcoords[i][0] = (GLfloat) i / width;
+      texcoords[i][1] = 0.3F;
+   }
+
+   start = clock();
+   for (GLuint row = 0; row < rows; row++) {
+      GLuint i = _swrast_sse_blend_transparency_ubyte(width, mask, rgba, dest);
+      blend_c(BLEND_TRANSPARENCY, i, width, mask, rgba, dest);
+   }
+   printf("blend transparency %8.1f Mpixels/s\n",
+          width * rows / seconds(start) / 1e6);
+
+   start = clock();
+   for (GLuint row = 0; row < rows; row++) {
+      GLuint passed = 0;
+      GLuint i = _swrast_sse_depth_test_span16(GL_LEQUAL, GL_FALSE, width,
+                                               z16, zfrag, mask, &passed);
+      depth_test_c(GL_LEQUAL, GL_FALSE, i, width, z16, zfrag, mask);
+      memset(mask, 1, width);
+   }
+   printf("depth test z16     %8.1f Mpixels/s\n",
+          width * rows / seconds(start) / 1e6);
+
+   start = clock();
+   for (GLuint row = 0; row < rows; row++) {
+      GLuint passed = 0;
+      GLuint i = _swrast_sse_depth_test_span32(GL_LEQUAL, GL_FALSE, width,
+                                               z32, zfrag, mask, &passed);
+      depth_test_c(GL_LEQUAL, GL_FALSE, i, width, z32, zfrag, mask);
+      memset(mask, 1, width);
+   }
+   printf("depth test z24     %8.1f Mpixels/s\n",
+          width * rows / seconds(start) / 1e6);
+
+   start = clock();
+   for (GLuint row = 0; row < rows; row++) {
+      GLuint i = _swrast_sse_sample_2d_linear_rgba8888(
+         (const GLubyte *) texture, 256 * 4, 256, 256, width, texcoords,
+         texels);
+      sample_linear_c((const GLubyte *) texture, 256 * 4, 256, 256, i,
+                      width, texcoords, texels);
+   }
+   printf("bilinear rgba8888  %8.1f Mpixels/s\n",
+          width * rows / seconds(start) / 1e6);
+
+   delete[] rgba;
+   delete[] dest;
+   delete[] mask;
+   delete[] zfrag;
+   delete[] z32;
+   delete[] z16;
+   delete[] texcoords;
+   delete[] texels;
+   delete[] texture;
+}
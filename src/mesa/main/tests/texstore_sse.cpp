@@ -0,0 +1,232 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks the texstore_sse.c kernels against the C code.  The DISABLED_
+ * tests time both, run them with --gtest_also_run_disabled_tests.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include "main/imports.h"
+#include "main/texstore_sse.h"
+}
+
+
+static const GLubyte map_rgb_to_rgba[4] = { 0, 1, 2, 5 };
+static const GLubyte map_bgra_to_rgba[4] = { 2, 1, 0, 3 };
+static const GLubyte map_rgba_to_rgb[4] = { 0, 1, 2, 4 };
+
+
+static void
+swizzle_reference(GLubyte *dst, GLuint dstComponents,
+                  const GLubyte *src, GLuint srcComponents,
+                  const GLubyte *map, GLuint count)
+{
+   for (GLuint i = 0; i < count; i++) {
+      GLubyte tmp[6] = { 0, 0, 0, 0, 0x0, 0xff };
+
+      for (GLuint j = 0; j < srcComponents; j++)
+         tmp[j] = src[i * srcComponents + j];
+      for (GLuint j = 0; j < dstComponents; j++)
+         dst[i * dstComponents + j] = tmp[map[j]];
+   }
+}
+
+
+static void
+swizzle_sse(GLubyte *dst, GLuint dstComponents,
+            const GLubyte *src, GLuint srcComponents,
+            const GLubyte *map, GLuint count)
+{
+   GLuint done = _mesa_sse_swizzle_ubyte(dst, dstComponents,
+                                         src, srcComponents, map, count);
+
+   swizzle_reference(dst + done * dstComponents, dstComponents,
+                     src + done * srcComponents, srcComponents,
+                     map, count - done);
+}
+
+
+static void
+float_to_half_sse(GLhalfARB *dst, const GLfloat *src, GLuint count)
+{
+   for (GLuint i = _mesa_sse_float_to_half(dst, src, count); i < count; i++)
+      dst[i] = _mesa_float_to_half(src[i]);
+}
+
+
+static void
+float_to_half_reference(GLhalfARB *dst, const GLfloat *src, GLuint count)
+{
+   for (GLuint i = 0; i < count; i++)
+      dst[i] = _mesa_float_to_half(src[i]);
+}
+
+
+TEST(TexstoreSSE, SwizzleMatchesC)
+{
+   GLubyte src[64], dst[64], expected[64];
+
+   srand(1);
+
+   for (unsigned iter = 0; iter < 100000; iter++) {
+      GLuint srcComponents = 1 + rand() % 4;
+      GLuint dstComponents = 1 + rand() % 4;
+      GLuint count = rand() % 17;
+      GLubyte map[4];
+
+      for (unsigned j = 0; j < 4; j++) {
+         unsigned r = rand() % (srcComponents + 2);
+         map[j] = r < srcComponents ? r : (r == srcComponents ? 4 : 5);
+      }
+
+      for (unsigned i = 0; i < sizeof(src); i++)
+         src[i] = rand();
+      memset(dst, 0x55, sizeof(dst));
+      memset(expected, 0x55, sizeof(expected));
+
+      swizzle_sse(dst, dstComponents, src, srcComponents, map, count);
+      swizzle_reference(expected, dstComponents, src, srcComponents,
+                        map, count);
+
+      ASSERT_EQ(0, memcmp(dst, expected, sizeof(dst)))
+         << srcComponents << " -> " << dstComponents
+         << " components, " << count << " pixels";
+   }
+}
+
+
+TEST(TexstoreSSE, FloatToHalfMatchesC)
+{
+   const GLuint count = 1 << 16;
+   GLfloat *src = new GLfloat[count];
+   GLhalfARB *dst = new GLhalfARB[count];
+
+   /* Every 251st bit pattern, which covers all exponents and signs, and
+    * then the floats around the largest half.
+    */
+   for (uint64_t base = 0; base < (1ull << 32); base += 251ull * count) {
+      for (GLuint i = 0; i < count; i++) {
+         fi_type fi;
+
+         fi.i = (GLuint) (base + i * 251ull);
+         src[i] = fi.f;
+      }
+
+      float_to_half_sse(dst, src, count);
+
+      for (GLuint i = 0; i < count; i++) {
+         ASSERT_EQ(_mesa_float_to_half(src[i]), dst[i])
+            << "for float bits 0x" << std::hex << (GLuint) (base + i * 251ull);
+      }
+   }
+
+   for (GLuint i = 0; i < count; i++) {
+      fi_type fi;
+
+      fi.i = 0x477fe000 - count / 2 + i;
+      src[i] = fi.f;
+   }
+
+   float_to_half_sse(dst, src, count);
+
+   for (GLuint i = 0; i < count; i++)
+      ASSERT_EQ(_mesa_float_to_half(src[i]), dst[i]);
+
+   delete[] src;
+   delete[] dst;
+}
+
+
+static double
+seconds(clock_t start)
+{
+   return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+static void
+bench_swizzle(const char *name, GLuint srcComponents, GLuint dstComponents,
+              const GLubyte *map)
+{
+   const GLuint width = 1024, rows = 4096;
+   GLubyte *src = new GLubyte[width * srcComponents];
+   GLubyte *dst = new GLubyte[width * dstComponents];
+   clock_t start;
+   double c_time, sse_time;
+
+   memset(src, 0x40, width * srcComponents);
+
+   start = clock();
+   for (GLuint row = 0; row < rows; row++)
+      swizzle_reference(dst, dstComponents, src, srcComponents, map, width);
+   c_time = seconds(start);
+
+   start = clock();
+   for (GLuint row = 0; row < rows; row++)
+      swizzle_sse(dst, dstComponents, src, srcComponents, map, width);
+   sse_time = seconds(start);
+
+   printf("%-14s C %7.1f Mpixels/s, SSE %7.1f Mpixels/s\n", name,
+          width * rows / c_time / 1e6, width * rows / sse_time / 1e6);
+
+   delete[] src;
+   delete[] dst;
+}
+
+
+TEST(TexstoreSSE, DISABLED_Benchmark)
+{
+   const GLuint count = 1024 * 1024;
+   GLfloat *src = new GLfloat[count];
+   GLhalfARB *dst = new GLhalfARB[count];
+   clock_t start;
+   double c_time, sse_time;
+
+   bench_swizzle("RGB -> RGBA", 3, 4, map_rgb_to_rgba);
+   bench_swizzle("BGRA -> RGBA", 4, 4, map_bgra_to_rgba);
+   bench_swizzle("RGBA -> RGB", 4, 3, map_rgba_to_rgb);
+
+   for (GLuint i = 0; i < count; i++)
+      src[i] = (GLfloat) i / count;
+
+   start = clock();
+   for (unsigned iter = 0; iter < 16; iter++)
+      float_to_half_reference(dst, src, count);
+   c_time = seconds(start);
+
+   start = clock();
+   for (unsigned iter = 0; iter < 16; iter++)
+      float_to_half_sse(dst, src, count);
+   sse_time = seconds(start);
+
+   printf("%-14s C %7.1f Mvalues/s, SSE %7.1f Mvalues/s\n", "float -> half",
+          16.0 * count / c_time / 1e6, 16.0 * count / sse_time / 1e6);
+
+   delete[] src;
+   delete[] dst;
+}
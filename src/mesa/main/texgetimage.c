@@ -919,6 +919,10 @@ _mesa_GetnTexImageARB( GLenum target, GLint level, GLenum format,
                   format, type);
    }
 
+   /* Drivers may write the PBO without mapping it. */
+   if (_mesa_is_bufferobj(ctx->Pack.BufferObj))
+      _mesa_bufferobj_invalidate_minmax(ctx->Pack.BufferObj);
+
    _mesa_lock_texture(ctx, texObj);
    {
       ctx->Driver.GetTexImage(ctx, format, type, pixels, texImage);
@@ -1049,6 +1053,9 @@ _mesa_GetnCompressedTexImageARB(GLenum target, GLint level, GLsizei bufSize,
                   texImage->Width, texImage->Height);
    }
 
+   if (_mesa_is_bufferobj(ctx->Pack.BufferObj))
+      _mesa_bufferobj_invalidate_minmax(ctx->Pack.BufferObj);
+
    _mesa_lock_texture(ctx, texObj);
    {
       ctx->Driver.GetCompressedTexImage(ctx, texImage, img);
@@ -69,6 +69,7 @@
 #include "texcompress_etc.h"
 #include "teximage.h"
 #include "texstore.h"
+#include "texstore_sse.h"
 #include "enums.h"
 #include "glformats.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
@@ -699,6 +700,7 @@ swizzle_copy(GLubyte *dst, GLuint dstComponents, const GLubyte *src,
    } while (0)
 
    GLubyte tmp[6];
+   GLuint done;
 
    tmp[ZERO] = 0x0;
    tmp[ONE] = 0xff;
@@ -706,6 +708,12 @@ swizzle_copy(GLubyte *dst, GLuint dstComponents, const GLubyte *src,
    ASSERT(srcComponents <= 4);
    ASSERT(dstComponents <= 4);
 
+   done = _mesa_sse_swizzle_ubyte(dst, dstComponents, src, srcComponents,
+                                  map, count);
+   dst += done * dstComponents;
+   src += done * srcComponents;
+   count -= done;
+
    switch (dstComponents) {
    case 4:
       switch (srcComponents) {
@@ -2772,8 +2780,9 @@ _mesa_texstore_rgba_float16(TEXSTORE_PARAMS)
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
             GLhalfARB *dstTexel = (GLhalfARB *) dstRow;
-            GLint i;
-            for (i = 0; i < srcWidth * components; i++) {
+            GLint i = _mesa_sse_float_to_half(dstTexel, src,
+                                              srcWidth * components);
+            for (; i < srcWidth * components; i++) {
                dstTexel[i] = _mesa_float_to_half(src[i]);
             }
             dstRow += dstRowStride;
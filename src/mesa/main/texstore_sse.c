@@ -0,0 +1,211 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file texstore_sse.c
+ * SSE2/SSSE3 versions of the texstore inner loops.
+ *
+ * The kernels are compiled with the target attribute, so that no special
+ * compiler flags are needed, and are only called after checking the
+ * CPU with _mesa_get_sse_caps().
+ */
+
+
+#include "cpuinfo.h"
+#include "texstore_sse.h"
+
+
+#ifdef MESA_SSE_TARGETS
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+
+/**
+ * Swizzle four pixels at a time with PSHUFB.  Map entries above 3 select
+ * 0 (4) or 0xff (5), as in texstore.c.
+ *
+ * Every iteration loads and stores 16 bytes, which may go past the four
+ * pixels, so the loop stops while that still lies within the row; the
+ * extra bytes stored belong to pixels that are written afterwards.
+ */
+__attribute__((target("ssse3")))
+static GLuint
+swizzle_ubyte_ssse3(GLubyte *dst, GLuint dstComponents,
+                    const GLubyte *src, GLuint srcComponents,
+                    const GLubyte *map, GLuint count)
+{
+   GLubyte shuffle[16], ones[16];
+   __m128i shuffle_reg, ones_reg;
+   GLuint i, j;
+
+   for (i = 0; i < 16; i++) {
+      shuffle[i] = 0x80;
+      ones[i] = 0;
+   }
+
+   for (i = 0; i < 4; i++) {
+      for (j = 0; j < dstComponents; j++) {
+         if (map[j] < 4)
+            shuffle[i * dstComponents + j] = i * srcComponents + map[j];
+         else if (map[j] == 5)
+            ones[i * dstComponents + j] = 0xff;
+      }
+   }
+
+   shuffle_reg = _mm_loadu_si128((const __m128i *) shuffle);
+   ones_reg = _mm_loadu_si128((const __m128i *) ones);
+
+   for (i = 0; (count - i) * srcComponents >= 16 &&
+               (count - i) * dstComponents >= 16; i += 4) {
+      __m128i pixels = _mm_loadu_si128((const __m128i *) src);
+
+      pixels = _mm_shuffle_epi8(pixels, shuffle_reg);
+      pixels = _mm_or_si128(pixels, ones_reg);
+      _mm_storeu_si128((__m128i *) dst, pixels);
+
+      src += 4 * srcComponents;
+      dst += 4 * dstComponents;
+   }
+
+   return i;
+}
+
+
+/**
+ * Four at a time version of _mesa_float_to_half(), with the same results
+ * for every input, including denormals (flushed to zero), NaN (0x7c01)
+ * and values that round to infinity.
+ */
+__attribute__((target("sse2")))
+static GLuint
+float_to_half_sse2(GLhalfARB *dst, const GLfloat *src, GLuint count)
+{
+   const __m128i exp_mask = _mm_set1_epi32(0xff);
+   const __m128i mant_mask = _mm_set1_epi32(0x7fffff);
+   const __m128i abs_mask = _mm_set1_epi32(0x7fffffff);
+   const __m128i infinity = _mm_set1_epi32(0x7c00);
+   const __m128i one = _mm_set1_epi32(1);
+   const __m128 denorm_scale = _mm_set1_ps((float) (1 << 24));
+   GLuint i;
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i bits = _mm_castps_si128(_mm_loadu_ps(src + i));
+      __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16),
+                                   _mm_set1_epi32(0x8000));
+      __m128i e = _mm_and_si128(_mm_srli_epi32(bits, 23), exp_mask);
+      __m128i m = _mm_and_si128(bits, mant_mask);
+      __m128i is_zero, is_special, is_nan, is_small, is_large;
+      __m128i normal, small, tie, special, result;
+      __m128 scaled;
+
+      is_zero = _mm_cmpeq_epi32(e, _mm_setzero_si128());
+      is_special = _mm_cmpeq_epi32(e, exp_mask);
+      is_nan = _mm_andnot_si128(_mm_cmpeq_epi32(m, _mm_setzero_si128()),
+                                is_special);
+      is_small = _mm_cmplt_epi32(e, _mm_set1_epi32(127 - 14));
+      is_large = _mm_cmpgt_epi32(e, _mm_set1_epi32(127 + 15));
+
+      /* Round the mantissa to even; a carry bumps the exponent. */
+      normal = _mm_add_epi32(m, _mm_set1_epi32(0xfff));
+      normal = _mm_add_epi32(normal,
+                             _mm_and_si128(_mm_srli_epi32(m, 13), one));
+      normal = _mm_add_epi32(_mm_slli_epi32(_mm_sub_epi32(e,
+                                               _mm_set1_epi32(127 - 15)), 10),
+                             _mm_srli_epi32(normal, 13));
+
+      /* Below the half normals the magnitude rounds to a subnormal, with
+       * 1024 conveniently being the smallest normal.  This is done like
+       * _mesa_round_to_even(), including the float addition of 0.5 that
+       * may round up a value just below n + 0.5.
+       */
+      scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_and_si128(bits, abs_mask)),
+                          denorm_scale);
+      small = _mm_cvttps_epi32(_mm_add_ps(scaled, _mm_set1_ps(0.5f)));
+      tie = _mm_castps_si128(_mm_cmpeq_ps(_mm_sub_ps(scaled,
+                                _mm_cvtepi32_ps(_mm_cvttps_epi32(scaled))),
+                                          _mm_set1_ps(0.5f)));
+      small = _mm_sub_epi32(small, _mm_and_si128(tie,
+                                                 _mm_and_si128(small, one)));
+
+      special = _mm_or_si128(infinity, _mm_and_si128(is_nan, one));
+
+      result = _mm_or_si128(_mm_and_si128(is_small, small),
+                            _mm_andnot_si128(is_small, normal));
+      result = _mm_or_si128(_mm_and_si128(is_large, infinity),
+                            _mm_andnot_si128(is_large, result));
+      result = _mm_or_si128(_mm_and_si128(is_special, special),
+                            _mm_andnot_si128(is_special, result));
+      result = _mm_andnot_si128(is_zero, result);
+      result = _mm_or_si128(result, sign);
+
+      /* Sign extend so that the saturating pack keeps the low 16 bits. */
+      result = _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+      result = _mm_packs_epi32(result, result);
+      _mm_storel_epi64((__m128i *) (dst + i), result);
+   }
+
+   return i;
+}
+
+#endif /* MESA_SSE_TARGETS */
+
+
+/**
+ * Swizzle up to \p count pixels of 1 to 4 ubyte components, see
+ * swizzle_copy() in texstore.c.
+ */
+GLuint
+_mesa_sse_swizzle_ubyte(GLubyte *dst, GLuint dstComponents,
+                        const GLubyte *src, GLuint srcComponents,
+                        const GLubyte *map, GLuint count)
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSSE3)
+      return swizzle_ubyte_ssse3(dst, dstComponents, src, srcComponents,
+                                 map, count);
+#endif
+   (void) dst;
+   (void) dstComponents;
+   (void) src;
+   (void) srcComponents;
+   (void) map;
+   (void) count;
+   return 0;
+}
+
+
+/**
+ * Convert up to \p count floats with _mesa_float_to_half().
+ */
+GLuint
+_mesa_sse_float_to_half(GLhalfARB *dst, const GLfloat *src, GLuint count)
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return float_to_half_sse2(dst, src, count);
+#endif
+   (void) dst;
+   (void) src;
+   (void) count;
+   return 0;
+}
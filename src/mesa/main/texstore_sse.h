@@ -0,0 +1,57 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file texstore_sse.h
+ * SSE2/SSSE3 versions of the texstore inner loops.
+ *
+ * Each function converts as much of a row as it can, selecting the
+ * kernel by the CPU it runs on, and returns the number of pixels or
+ * values done.  The caller converts the rest with the C code.
+ */
+
+
+#ifndef TEXSTORE_SSE_H
+#define TEXSTORE_SSE_H
+
+
+#include "glheader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+extern GLuint
+_mesa_sse_swizzle_ubyte(GLubyte *dst, GLuint dstComponents,
+                        const GLubyte *src, GLuint srcComponents,
+                        const GLubyte *map, GLuint count);
+
+extern GLuint
+_mesa_sse_float_to_half(GLhalfARB *dst, const GLfloat *src, GLuint count);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEXSTORE_SSE_H */
@@ -443,6 +443,9 @@ _mesa_BeginTransformFeedback(GLenum mode)
 
    obj->shader_program = ctx->Shader.CurrentVertexProgram;
 
+   for (i = 0; i < info->NumBuffers; ++i)
+      _mesa_bufferobj_invalidate_minmax(obj->Buffers[i]);
+
    assert(ctx->Driver.BeginTransformFeedback);
    ctx->Driver.BeginTransformFeedback(ctx, mode, obj);
 }
@@ -452,6 +455,7 @@ void GLAPIENTRY
 _mesa_EndTransformFeedback(void)
 {
    struct gl_transform_feedback_object *obj;
+   GLuint i;
    GET_CURRENT_CONTEXT(ctx);
 
    obj = ctx->TransformFeedback.CurrentObject;
@@ -471,6 +475,12 @@ _mesa_EndTransformFeedback(void)
 
    assert(ctx->Driver.EndTransformFeedback);
    ctx->Driver.EndTransformFeedback(ctx, obj);
+
+   /* Index bounds may have been cached while the buffers were written. */
+   for (i = 0; i < MAX_FEEDBACK_BUFFERS; i++) {
+      if (obj->Buffers[i])
+         _mesa_bufferobj_invalidate_minmax(obj->Buffers[i]);
+   }
 }
 
 
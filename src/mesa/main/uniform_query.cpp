@@ -36,6 +36,7 @@
 #include "../glsl/glsl_parser_extras.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "program/prog_parameter.h"
 #include "uniforms.h"
 
 
@@ -573,6 +574,105 @@ _mesa_propagate_uniforms_to_driver_storage(struct gl_uniform_storage *uni,
    }
 }
 
+/**
+ * Record which parameters the driver storage of \c uni just written by
+ * _mesa_propagate_uniforms_to_driver_storage() lives in, so drivers can
+ * upload only those.
+ */
+static void
+mark_parameters_dirty(struct gl_shader_program *shProg,
+                      const struct gl_uniform_storage *uni,
+                      unsigned array_index, unsigned count)
+{
+   const unsigned components = MAX2(1, uni->type->vector_elements);
+   const unsigned vectors = MAX2(1, uni->type->matrix_columns);
+   unsigned i, j;
+
+   if (count == 0)
+      return;
+
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      struct gl_program_parameter_list *params;
+      const uint8_t *begin, *end;
+
+      if (!shProg->_LinkedShaders[i] ||
+          !shProg->_LinkedShaders[i]->Program ||
+          !shProg->_LinkedShaders[i]->Program->Parameters)
+         continue;
+
+      params = shProg->_LinkedShaders[i]->Program->Parameters;
+      begin = (const uint8_t *) params->ParameterValues;
+      end = (const uint8_t *) (params->ParameterValues +
+                               params->NumParameters);
+
+      for (j = 0; j < uni->num_driver_storage; j++) {
+         const struct gl_uniform_driver_storage *store =
+            &uni->driver_storage[j];
+         const uint8_t *dst = (const uint8_t *) store->data +
+            array_index * store->element_stride;
+         const unsigned size = (count - 1) * store->element_stride +
+            vectors * MAX2(store->vector_stride, components * 4);
+         const unsigned vec4 = sizeof(params->ParameterValues[0]);
+
+         if (dst >= begin && dst < end) {
+            const unsigned first = (dst - begin) / vec4;
+            const unsigned last = (dst + size - 1 - begin) / vec4;
+
+            _mesa_parameter_values_dirty(params, first, last - first + 1);
+         }
+      }
+   }
+}
+
+/**
+ * Fast path of _mesa_uniform() and _mesa_uniform_matrix() for values of the
+ * uniform's own type going to \c uniform_native driver storage: copy them
+ * straight into the backing store and each driver storage, a single memcpy
+ * when the driver packs the elements as tightly as the caller.
+ */
+static void
+store_uniform_native(struct gl_uniform_storage *uni,
+                     unsigned offset, unsigned count, const void *values)
+{
+   const unsigned components = uni->type->vector_elements;
+   const unsigned vectors = uni->type->matrix_columns;
+   const unsigned vector_size = components * sizeof(uni->storage[0]);
+   const unsigned element_size = vectors * vector_size;
+   unsigned s;
+
+   memcpy(&uni->storage[components * vectors * offset], values,
+          element_size * count);
+   uni->initialized = true;
+
+   for (s = 0; s < uni->num_driver_storage; s++) {
+      const struct gl_uniform_driver_storage *store = &uni->driver_storage[s];
+      const uint8_t *src = (const uint8_t *) values;
+      uint8_t *dst = (uint8_t *) store->data + offset * store->element_stride;
+
+      if (vectors == 1 || store->vector_stride == vector_size) {
+         if (store->element_stride == element_size || count == 1) {
+            memcpy(dst, src, element_size * count);
+            continue;
+         }
+
+         for (unsigned i = 0; i < count; i++) {
+            memcpy(dst, src, element_size);
+            src += element_size;
+            dst += store->element_stride;
+         }
+         continue;
+      }
+
+      for (unsigned i = 0; i < count; i++) {
+         for (unsigned v = 0; v < vectors; v++) {
+            memcpy(dst + v * store->vector_stride, src, vector_size);
+            src += vector_size;
+         }
+         dst += store->element_stride;
+      }
+   }
+}
+
 /**
  * Called via glUniform*() functions.
  */
@@ -593,6 +693,20 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
 
    uni = &shProg->UniformStorage[loc];
 
+   /* Values of exactly the uniform's type, which excludes booleans and
+    * samplers, need neither the checks below nor any conversion.
+    */
+   if (type == uni->type->gl_type && uni->native_driver_storage &&
+       !(ctx->Shader.Flags & GLSL_UNIFORMS)) {
+      if (uni->array_elements != 0)
+         count = MIN2(count, (int) (uni->array_elements - offset));
+
+      FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+      store_uniform_native(uni, offset, count, values);
+      mark_parameters_dirty(shProg, uni, offset, count);
+      return;
+   }
+
    /* Verify that the types are compatible.
     */
    switch (type) {
@@ -766,6 +880,7 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
    uni->initialized = true;
 
    _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   mark_parameters_dirty(shProg, uni, offset, count);
 
    /* If the uniform is a sampler, do the extra magic necessary to propagate
     * the changes through.
@@ -895,6 +1010,12 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
 
    FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
 
+   if (!transpose && uni->native_driver_storage) {
+      store_uniform_native(uni, offset, count, values);
+      mark_parameters_dirty(shProg, uni, offset, count);
+      return;
+   }
+
    /* Store the data in the "actual type" backing storage for the uniform.
     */
    elements = components * vectors;
@@ -923,6 +1044,7 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
    uni->initialized = true;
 
    _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   mark_parameters_dirty(shProg, uni, offset, count);
 }
 
 
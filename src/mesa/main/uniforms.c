@@ -115,6 +115,9 @@ _mesa_uniform_attach_driver_storage(struct gl_uniform_storage *uni,
    uni->driver_storage[uni->num_driver_storage].format = (uint8_t) format;
    uni->driver_storage[uni->num_driver_storage].data = data;
 
+   uni->native_driver_storage =
+      (uni->num_driver_storage == 0 || uni->native_driver_storage) &&
+      format == uniform_native;
    uni->num_driver_storage++;
 }
 
@@ -131,6 +134,7 @@ _mesa_uniform_detach_all_driver_storage(struct gl_uniform_storage *uni)
    free(uni->driver_storage);
    uni->driver_storage = NULL;
    uni->num_driver_storage = 0;
+   uni->native_driver_storage = false;
 }
 
 void GLAPIENTRY
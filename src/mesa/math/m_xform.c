@@ -40,6 +40,7 @@
 #include "m_matrix.h"
 #include "m_translate.h"
 #include "m_xform.h"
+#include "m_xform_sse.h"
 
 
 #ifdef DEBUG_MATH
@@ -112,6 +113,8 @@ _math_init_transformation( void )
    _math_test_all_cliptest_functions( "default" );
 #endif
 
+   _math_init_sse_transformation();
+
 #ifdef USE_X86_ASM
    _mesa_init_all_x86_transform_asm();
 #elif defined( USE_SPARC_ASM )
@@ -0,0 +1,593 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file m_xform_sse.c
+ * SSE2 versions of the point transform, normal transform and clip test
+ * functions of m_xform_tmp.h, m_norm_tmp.h and m_clip_tmp.h.
+ *
+ * A vertex is kept in one register, so each function handles every size
+ * and stride the C code does, and only reads the components the vector
+ * has.  The additions are done in the order of the C code.  The point
+ * transforms evaluate the whole matrix for every matrix type, since the
+ * entries the specialized C versions skip are exactly 0 or 1; the
+ * results only differ from them for infinite or NaN coordinates.  The
+ * normal transforms and clip tests give identical results.
+ */
+
+
+#include "main/glheader.h"
+#include "main/cpuinfo.h"
+#include "main/macros.h"
+
+#include "m_xform.h"
+#include "m_xform_sse.h"
+
+#ifdef DEBUG_MATH
+#include "m_debug.h"
+#endif
+
+
+#ifdef MESA_SSE_TARGETS
+
+#include <emmintrin.h>
+
+
+static const GLuint size_flags[5] = {
+   0, VEC_SIZE_1, VEC_SIZE_2, VEC_SIZE_3, VEC_SIZE_4
+};
+
+
+/** (x, y, 0, 0) */
+__attribute__((target("sse2")))
+static inline __m128
+load2(const GLfloat *v)
+{
+   return _mm_castpd_ps(_mm_load_sd((const double *) v));
+}
+
+
+/** (x, y, z, 0) */
+__attribute__((target("sse2")))
+static inline __m128
+load3(const GLfloat *v)
+{
+   return _mm_movelh_ps(load2(v), _mm_load_ss(v + 2));
+}
+
+
+#define SPLAT(v, c) _mm_shuffle_ps(v, v, _MM_SHUFFLE(c, c, c, c))
+
+
+/**
+ * to = m * from for points of \p in_size components, the missing ones
+ * being (0, 0, 1).  The result has \p out_size components.
+ */
+__attribute__((target("sse2")))
+static inline void
+transform_points(GLvector4f *to_vec, const GLfloat m[16],
+                 const GLvector4f *from_vec, GLuint in_size, GLuint out_size)
+{
+   const GLuint stride = from_vec->stride;
+   const GLuint count = from_vec->count;
+   const GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4]) to_vec->start;
+   const __m128 c0 = _mm_loadu_ps(m);
+   const __m128 c1 = _mm_loadu_ps(m + 4);
+   const __m128 c2 = _mm_loadu_ps(m + 8);
+   const __m128 c3 = _mm_loadu_ps(m + 12);
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      __m128 r = _mm_mul_ps(c0, _mm_set1_ps(from[0]));
+
+      if (in_size > 1)
+         r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(from[1])));
+      if (in_size > 2)
+         r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(from[2])));
+      if (in_size > 3)
+         r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(from[3])));
+      else
+         r = _mm_add_ps(r, c3);
+
+      _mm_storeu_ps(to[i], r);
+   }
+
+   to_vec->size = out_size;
+   to_vec->flags |= size_flags[out_size];
+   to_vec->count = count;
+}
+
+
+__attribute__((target("sse2")))
+static inline void
+transform_points_identity(GLvector4f *to_vec, const GLvector4f *from_vec,
+                          GLuint size)
+{
+   const GLuint stride = from_vec->stride;
+   const GLuint count = from_vec->count;
+   const GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4]) to_vec->start;
+   GLuint i, j;
+
+   if (to_vec == from_vec)
+      return;
+
+   if (size == 4) {
+      for (i = 0; i < count; i++, STRIDE_F(from, stride))
+         _mm_storeu_ps(to[i], _mm_loadu_ps(from));
+   }
+   else {
+      for (i = 0; i < count; i++, STRIDE_F(from, stride))
+         for (j = 0; j < size; j++)
+            to[i][j] = from[j];
+   }
+
+   to_vec->size = size;
+   to_vec->flags |= size_flags[size];
+   to_vec->count = count;
+}
+
+
+#define XFORM_FUNC(in_size, type, out_size)                              \
+__attribute__((target("sse2")))                                         \
+static void _XFORMAPI                                                   \
+transform_points##in_size##_##type(GLvector4f *to_vec,                  \
+                                   const GLfloat m[16],                 \
+                                   const GLvector4f *from_vec)          \
+{                                                                       \
+   transform_points(to_vec, m, from_vec, in_size, out_size);            \
+}
+
+#define IDENTITY_FUNC(size)                                             \
+__attribute__((target("sse2")))                                         \
+static void _XFORMAPI                                                   \
+transform_points##size##_identity(GLvector4f *to_vec,                   \
+                                  const GLfloat m[16],                  \
+                                  const GLvector4f *from_vec)           \
+{                                                                       \
+   (void) m;                                                            \
+   transform_points_identity(to_vec, from_vec, size);                   \
+}
+
+/* The output sizes of m_xform_tmp.h */
+XFORM_FUNC(1, general, 4)
+XFORM_FUNC(1, 2d, 2)
+XFORM_FUNC(1, 2d_no_rot, 2)
+XFORM_FUNC(1, 3d, 3)
+XFORM_FUNC(1, 3d_no_rot, 3)
+XFORM_FUNC(1, perspective, 4)
+IDENTITY_FUNC(1)
+
+XFORM_FUNC(2, general, 4)
+XFORM_FUNC(2, 2d, 2)
+XFORM_FUNC(2, 2d_no_rot, 2)
+XFORM_FUNC(2, 3d, 3)
+XFORM_FUNC(2, 3d_no_rot, m[14] == 0.0F ? 2 : 3)
+XFORM_FUNC(2, perspective, 4)
+IDENTITY_FUNC(2)
+
+XFORM_FUNC(3, general, 4)
+XFORM_FUNC(3, 2d, 3)
+XFORM_FUNC(3, 2d_no_rot, 3)
+XFORM_FUNC(3, 3d, 3)
+XFORM_FUNC(3, 3d_no_rot, 3)
+XFORM_FUNC(3, perspective, 4)
+IDENTITY_FUNC(3)
+
+XFORM_FUNC(4, general, 4)
+XFORM_FUNC(4, 2d, 4)
+XFORM_FUNC(4, 2d_no_rot, 4)
+XFORM_FUNC(4, 3d, 4)
+XFORM_FUNC(4, 3d_no_rot, 4)
+XFORM_FUNC(4, perspective, 4)
+IDENTITY_FUNC(4)
+
+#undef XFORM_FUNC
+#undef IDENTITY_FUNC
+
+
+/**
+ * The rows of the upper 3x3 of the inverse matrix, as normals are
+ * multiplied by its transpose.
+ */
+__attribute__((target("sse2")))
+static inline void
+load_normal_matrix(const GLfloat *m, GLfloat scale, __m128 c[3])
+{
+   c[0] = _mm_setr_ps(m[0], m[4], m[8], 0.0F);
+   c[1] = _mm_setr_ps(m[1], m[5], m[9], 0.0F);
+   c[2] = _mm_setr_ps(m[2], m[6], m[10], 0.0F);
+
+   if (scale != 1.0F) {
+      const __m128 s = _mm_set1_ps(scale);
+      c[0] = _mm_mul_ps(c[0], s);
+      c[1] = _mm_mul_ps(c[1], s);
+      c[2] = _mm_mul_ps(c[2], s);
+   }
+}
+
+
+__attribute__((target("sse2")))
+static inline __m128
+transform_normal(const __m128 c[3], __m128 u)
+{
+   return _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0], SPLAT(u, 0)),
+                                _mm_mul_ps(c[1], SPLAT(u, 1))),
+                     _mm_mul_ps(c[2], SPLAT(u, 2)));
+}
+
+
+/**
+ * x * x + y * y + z * z in the low element.
+ */
+__attribute__((target("sse2")))
+static inline __m128
+length_squared(__m128 t)
+{
+   const __m128 sq = _mm_mul_ps(t, t);
+
+   return _mm_add_ss(_mm_add_ss(sq, SPLAT(sq, 1)), SPLAT(sq, 2));
+}
+
+
+/**
+ * t divided by its length, or \p zero if the length squared isn't above
+ * \p min_len.
+ */
+__attribute__((target("sse2")))
+static inline __m128
+normalize3(__m128 t, __m128 zero, GLdouble min_len)
+{
+   const __m128 len = length_squared(t);
+
+   if (_mm_cvtss_f32(len) > min_len) {
+      const __m128 inv = _mm_div_ss(_mm_set_ss(1.0F), _mm_sqrt_ss(len));
+      return _mm_mul_ps(t, SPLAT(inv, 0));
+   }
+
+   return zero;
+}
+
+
+/**
+ * The normal functions of m_norm_tmp.h: \p transform and \p no_rot choose
+ * the matrix, \p rescale multiplies it by scale, \p normalize divides by
+ * the length, or multiplies by the given one.
+ */
+__attribute__((target("sse2")))
+static inline void
+normals(const GLmatrix *mat, GLfloat scale, const GLvector4f *in,
+        const GLfloat *lengths, GLvector4f *dest,
+        GLboolean transform, GLboolean no_rot, GLboolean rescale,
+        GLboolean normalize)
+{
+   GLfloat (*out)[4] = (GLfloat (*)[4]) dest->start;
+   const GLfloat *from = in->start;
+   const GLuint stride = in->stride;
+   const GLuint count = in->count;
+   const GLfloat *m = mat->inv;
+   __m128 c[3], diag, s;
+   GLuint i;
+
+   if (normalize && lengths && transform)
+      rescale = GL_TRUE;
+
+   if (no_rot) {
+      diag = _mm_setr_ps(m[0], m[5], m[10], 0.0F);
+      if (rescale)
+         diag = _mm_mul_ps(diag, _mm_set1_ps(scale));
+   }
+   else if (transform) {
+      load_normal_matrix(m, rescale ? scale : 1.0F, c);
+   }
+
+   s = _mm_set1_ps(scale);
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      const __m128 u = load3(from);
+      __m128 t;
+
+      if (no_rot)
+         t = _mm_mul_ps(u, diag);
+      else if (transform)
+         t = transform_normal(c, u);
+      else if (rescale)
+         t = _mm_mul_ps(u, s);
+      else
+         t = u;
+
+      if (normalize) {
+         if (lengths)
+            t = _mm_mul_ps(t, _mm_set1_ps(lengths[i]));
+         else if (transform)
+            t = normalize3(t, _mm_setzero_ps(), 1e-20);
+         else
+            t = normalize3(t, t, 1e-50);
+      }
+
+      _mm_storeu_ps(out[i], t);
+   }
+
+   dest->count = in->count;
+}
+
+
+#define NORMAL_FUNC(name, transform, no_rot, rescale, normalize)        \
+__attribute__((target("sse2")))                                         \
+static void _XFORMAPI                                                   \
+name(const GLmatrix *mat, GLfloat scale, const GLvector4f *in,          \
+     const GLfloat *lengths, GLvector4f *dest)                          \
+{                                                                       \
+   normals(mat, scale, in, lengths, dest,                               \
+           transform, no_rot, rescale, normalize);                      \
+}
+
+NORMAL_FUNC(transform_normals, GL_TRUE, GL_FALSE, GL_FALSE, GL_FALSE)
+NORMAL_FUNC(transform_normals_no_rot, GL_TRUE, GL_TRUE, GL_FALSE, GL_FALSE)
+NORMAL_FUNC(transform_rescale_normals, GL_TRUE, GL_FALSE, GL_TRUE, GL_FALSE)
+NORMAL_FUNC(transform_rescale_normals_no_rot,
+            GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE)
+NORMAL_FUNC(transform_normalize_normals,
+            GL_TRUE, GL_FALSE, GL_FALSE, GL_TRUE)
+NORMAL_FUNC(transform_normalize_normals_no_rot,
+            GL_TRUE, GL_TRUE, GL_FALSE, GL_TRUE)
+NORMAL_FUNC(rescale_normals, GL_FALSE, GL_FALSE, GL_TRUE, GL_FALSE)
+NORMAL_FUNC(normalize_normals, GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE)
+
+#undef NORMAL_FUNC
+
+
+/** Clip bits of the x, y and z comparisons, indexed by _mm_movemask_ps() */
+static const GLubyte clip_pos_bits[8] = {
+   0,
+   CLIP_RIGHT_BIT,
+   CLIP_TOP_BIT,
+   CLIP_RIGHT_BIT | CLIP_TOP_BIT,
+   CLIP_FAR_BIT,
+   CLIP_RIGHT_BIT | CLIP_FAR_BIT,
+   CLIP_TOP_BIT | CLIP_FAR_BIT,
+   CLIP_RIGHT_BIT | CLIP_TOP_BIT | CLIP_FAR_BIT
+};
+
+static const GLubyte clip_neg_bits[8] = {
+   0,
+   CLIP_LEFT_BIT,
+   CLIP_BOTTOM_BIT,
+   CLIP_LEFT_BIT | CLIP_BOTTOM_BIT,
+   CLIP_NEAR_BIT,
+   CLIP_LEFT_BIT | CLIP_NEAR_BIT,
+   CLIP_BOTTOM_BIT | CLIP_NEAR_BIT,
+   CLIP_LEFT_BIT | CLIP_BOTTOM_BIT | CLIP_NEAR_BIT
+};
+
+
+/**
+ * cliptest_points4 and cliptest_np_points4, which also does the
+ * projective divide when \p project is set.
+ */
+__attribute__((target("sse2")))
+static inline GLvector4f *
+cliptest4(GLvector4f *clip_vec, GLvector4f *proj_vec, GLubyte clipMask[],
+          GLubyte *orMask, GLubyte *andMask, GLboolean viewport_z_clip,
+          GLboolean project)
+{
+   const GLuint stride = clip_vec->stride;
+   const GLfloat *from = (GLfloat *) clip_vec->start;
+   const GLuint count = clip_vec->count;
+   const int xyz = viewport_z_clip ? 0x7 : 0x3;
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0F);
+   const __m128 clipped = _mm_setr_ps(0.0F, 0.0F, 0.0F, 1.0F);
+   GLfloat (*vProj)[4] = (GLfloat (*)[4]) proj_vec->start;
+   GLuint c = 0;
+   GLubyte tmpAndMask = *andMask;
+   GLubyte tmpOrMask = *orMask;
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      const __m128 v = _mm_loadu_ps(from);
+      const __m128 w = SPLAT(v, 3);
+      const int pos = _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(w, v), zero));
+      const int neg = _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(v, w), zero));
+      const GLubyte mask = clip_pos_bits[pos & xyz] | clip_neg_bits[neg & xyz];
+
+      clipMask[i] = mask;
+      if (mask) {
+         c++;
+         tmpAndMask &= mask;
+         tmpOrMask |= mask;
+         if (project)
+            _mm_storeu_ps(vProj[i], clipped);
+      }
+      else if (project) {
+         const __m128 oow = _mm_div_ps(one, w);
+         const __m128 p = _mm_mul_ps(v, oow);
+         /* (x / w, y / w, z / w, 1 / w) */
+         _mm_storeu_ps(vProj[i],
+                       _mm_shuffle_ps(p, _mm_unpackhi_ps(p, oow),
+                                      _MM_SHUFFLE(1, 0, 1, 0)));
+      }
+   }
+
+   *orMask = tmpOrMask;
+   *andMask = (GLubyte) (c < count ? 0 : tmpAndMask);
+
+   if (project) {
+      proj_vec->flags |= VEC_SIZE_4;
+      proj_vec->size = 4;
+      proj_vec->count = clip_vec->count;
+      return proj_vec;
+   }
+
+   return clip_vec;
+}
+
+
+/**
+ * cliptest_points3 and cliptest_points2, against the [-1, 1] cube.
+ */
+__attribute__((target("sse2")))
+static inline GLvector4f *
+cliptest_ndc(GLvector4f *clip_vec, GLubyte clipMask[], GLubyte *orMask,
+             GLubyte *andMask, GLboolean viewport_z_clip, GLuint size)
+{
+   const GLuint stride = clip_vec->stride;
+   const GLfloat *from = (GLfloat *) clip_vec->start;
+   const GLuint count = clip_vec->count;
+   const int xyz = (viewport_z_clip && size == 3) ? 0x7 : 0x3;
+   const __m128 one = _mm_set1_ps(1.0F);
+   const __m128 minus_one = _mm_set1_ps(-1.0F);
+   GLubyte tmpAndMask = *andMask;
+   GLubyte tmpOrMask = *orMask;
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      const __m128 v = size == 3 ? load3(from) : load2(from);
+      const int pos = _mm_movemask_ps(_mm_cmpgt_ps(v, one));
+      const int neg = _mm_movemask_ps(_mm_cmplt_ps(v, minus_one));
+      const GLubyte mask = clip_pos_bits[pos & xyz] | clip_neg_bits[neg & xyz];
+
+      clipMask[i] = mask;
+      tmpOrMask |= mask;
+      tmpAndMask &= mask;
+   }
+
+   *orMask = tmpOrMask;
+   *andMask = tmpAndMask;
+   return clip_vec;
+}
+
+
+__attribute__((target("sse2")))
+static GLvector4f * _XFORMAPI
+cliptest_points4(GLvector4f *clip_vec, GLvector4f *proj_vec,
+                 GLubyte clipMask[], GLubyte *orMask, GLubyte *andMask,
+                 GLboolean viewport_z_clip)
+{
+   return cliptest4(clip_vec, proj_vec, clipMask, orMask, andMask,
+                    viewport_z_clip, GL_TRUE);
+}
+
+
+__attribute__((target("sse2")))
+static GLvector4f * _XFORMAPI
+cliptest_np_points4(GLvector4f *clip_vec, GLvector4f *proj_vec,
+                    GLubyte clipMask[], GLubyte *orMask, GLubyte *andMask,
+                    GLboolean viewport_z_clip)
+{
+   return cliptest4(clip_vec, proj_vec, clipMask, orMask, andMask,
+                    viewport_z_clip, GL_FALSE);
+}
+
+
+__attribute__((target("sse2")))
+static GLvector4f * _XFORMAPI
+cliptest_points3(GLvector4f *clip_vec, GLvector4f *proj_vec,
+                 GLubyte clipMask[], GLubyte *orMask, GLubyte *andMask,
+                 GLboolean viewport_z_clip)
+{
+   (void) proj_vec;
+   return cliptest_ndc(clip_vec, clipMask, orMask, andMask,
+                       viewport_z_clip, 3);
+}
+
+
+__attribute__((target("sse2")))
+static GLvector4f * _XFORMAPI
+cliptest_points2(GLvector4f *clip_vec, GLvector4f *proj_vec,
+                 GLubyte clipMask[], GLubyte *orMask, GLubyte *andMask,
+                 GLboolean viewport_z_clip)
+{
+   (void) proj_vec;
+   return cliptest_ndc(clip_vec, clipMask, orMask, andMask,
+                       viewport_z_clip, 2);
+}
+
+#endif /* MESA_SSE_TARGETS */
+
+
+#define INIT_XFORM(size)                                                \
+do {                                                                    \
+   _mesa_transform_tab[size][MATRIX_GENERAL] =                          \
+      transform_points##size##_general;                                 \
+   _mesa_transform_tab[size][MATRIX_IDENTITY] =                         \
+      transform_points##size##_identity;                                \
+   _mesa_transform_tab[size][MATRIX_3D_NO_ROT] =                        \
+      transform_points##size##_3d_no_rot;                               \
+   _mesa_transform_tab[size][MATRIX_PERSPECTIVE] =                      \
+      transform_points##size##_perspective;                             \
+   _mesa_transform_tab[size][MATRIX_2D] =                               \
+      transform_points##size##_2d;                                      \
+   _mesa_transform_tab[size][MATRIX_2D_NO_ROT] =                        \
+      transform_points##size##_2d_no_rot;                               \
+   _mesa_transform_tab[size][MATRIX_3D] =                               \
+      transform_points##size##_3d;                                      \
+} while (0)
+
+
+/**
+ * Hook the SSE2 functions into the tables, if the CPU has SSE2.  Called
+ * after the C functions are set up, and before the assembly ones, which
+ * replace some of these.
+ */
+void
+_math_init_sse_transformation(void)
+{
+#ifdef MESA_SSE_TARGETS
+   if (!(_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2))
+      return;
+
+   INIT_XFORM(1);
+   INIT_XFORM(2);
+   INIT_XFORM(3);
+   INIT_XFORM(4);
+
+   _mesa_normal_tab[NORM_TRANSFORM_NO_ROT] = transform_normals_no_rot;
+   _mesa_normal_tab[NORM_TRANSFORM_NO_ROT | NORM_RESCALE] =
+      transform_rescale_normals_no_rot;
+   _mesa_normal_tab[NORM_TRANSFORM_NO_ROT | NORM_NORMALIZE] =
+      transform_normalize_normals_no_rot;
+   _mesa_normal_tab[NORM_TRANSFORM] = transform_normals;
+   _mesa_normal_tab[NORM_TRANSFORM | NORM_RESCALE] =
+      transform_rescale_normals;
+   _mesa_normal_tab[NORM_TRANSFORM | NORM_NORMALIZE] =
+      transform_normalize_normals;
+   _mesa_normal_tab[NORM_RESCALE] = rescale_normals;
+   _mesa_normal_tab[NORM_NORMALIZE] = normalize_normals;
+
+   _mesa_clip_tab[4] = cliptest_points4;
+   _mesa_clip_tab[3] = cliptest_points3;
+   _mesa_clip_tab[2] = cliptest_points2;
+
+   _mesa_clip_np_tab[4] = cliptest_np_points4;
+   _mesa_clip_np_tab[3] = cliptest_points3;
+   _mesa_clip_np_tab[2] = cliptest_points2;
+
+#ifdef DEBUG_MATH
+   _math_test_all_transform_functions("SSE2");
+   _math_test_all_normal_transform_functions("SSE2");
+   _math_test_all_cliptest_functions("SSE2");
+#endif
+#endif
+}
@@ -272,6 +272,16 @@ public:
 	 free(dup_key);
    }
 
+   /**
+    * Call \c func on each mapping, in no particular order.  \c data is the
+    * stored value plus one, see ::put.
+    */
+   void iterate(void (*func)(const void *key, void *data, void *closure),
+                void *closure)
+   {
+      hash_table_call_foreach(this->ht, func, closure);
+   }
+
 private:
    static void delete_key(const void *key, void *data, void *closure)
    {
@@ -3067,7 +3067,8 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 	 if (options->MaxIfDepth == 0)
 	    progress = lower_discard(ir) || progress;
 
-	 progress = lower_if_to_cond_assign(ir, options->MaxIfDepth) || progress;
+	 progress = lower_if_to_cond_assign(ir, options->MaxIfDepth,
+					    options->MaxFlattenIfCost) || progress;
 
 	 if (options->EmitNoNoise)
 	    progress = lower_noise(ir) || progress;
@@ -3119,10 +3120,12 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 }
 
 /**
- * Link a GLSL shader program.  Called via glLinkProgram().
+ * Link the GLSL IR of a shader program, without calling into the driver.
+ * This is the part of the link which may run on the shader queue's thread.
  */
 void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+_mesa_glsl_link_shader_ir(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
 {
    unsigned int i;
 
@@ -3134,11 +3137,23 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       if (!prog->Shaders[i]->CompileStatus) {
 	 linker_error(prog, "linking with uncompiled shader");
       }
+      _mesa_glsl_restore_shader_ir(ctx, prog->Shaders[i]);
    }
 
    if (prog->LinkStatus) {
       link_shaders(ctx, prog);
    }
+}
+
+/**
+ * Hand a program linked by _mesa_glsl_link_shader_ir() to the driver.
+ * Must be called from the context's thread.
+ */
+void
+_mesa_glsl_link_shader_driver(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
+   unsigned int i;
 
    if (prog->LinkStatus) {
       if (!ctx->Driver.LinkShader(ctx, prog)) {
@@ -3146,6 +3161,11 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       }
    }
 
+   if (prog->LinkStatus && ctx->Const.DiscardGLSLIR) {
+      for (i = 0; i < prog->NumShaders; i++)
+         _mesa_glsl_discard_shader_ir(prog->Shaders[i]);
+   }
+
    if (ctx->Shader.Flags & GLSL_DUMP) {
       if (!prog->LinkStatus) {
 	 printf("GLSL shader program %d failed to link\n", prog->Name);
@@ -3158,4 +3178,14 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 }
 
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   _mesa_glsl_link_shader_ir(ctx, prog);
+   _mesa_glsl_link_shader_driver(ctx, prog);
+}
+
 } /* extern "C" */
@@ -34,6 +34,8 @@ struct gl_shader;
 struct gl_shader_program;
 
 void _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog);
+void _mesa_glsl_link_shader_ir(struct gl_context *ctx, struct gl_shader_program *prog);
+void _mesa_glsl_link_shader_driver(struct gl_context *ctx, struct gl_shader_program *prog);
 GLboolean _mesa_ir_compile_shader(struct gl_context *ctx, struct gl_shader *shader);
 GLboolean _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog);
 
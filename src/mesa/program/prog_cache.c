@@ -34,6 +34,13 @@
 #include "program/program.h"
 
 
+/** Number of buckets a private cache grows to before it gets cleared */
+#define MAX_BUCKETS 4096
+
+/** Entries in a shared cache; inserts fail once it is full */
+#define MAX_SHARED_ITEMS 4096
+
+
 struct cache_item
 {
    GLuint hash;
@@ -47,32 +54,54 @@ struct gl_program_cache
 {
    struct cache_item **items;
    struct cache_item *last;
-   GLuint size, n_items;
+   GLuint size, n_items;   /**< size is a power of two */
+
+   /**
+    * Shared caches are used by several contexts: they are locked, and
+    * never evict an entry since other contexts may still be using it.
+    */
+   GLboolean shared;
+   _glthread_Mutex Mutex;
 };
 
 
 
+static inline GLuint
+mix(GLuint hash)
+{
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6b;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+
 /**
- * Compute hash index from state key.
+ * Compute hash index from state key.  All bytes of the key count, fixed
+ * function keys mostly differ in a few bits of the last words.
  */
 static GLuint
 hash_key(const void *key, GLuint key_size)
 {
-   const GLuint *ikey = (const GLuint *) key;
-   GLuint hash = 0, i;
+   const GLubyte *bytes = (const GLubyte *) key;
+   GLuint hash = key_size, word, i;
 
    assert(key_size >= 4);
 
-   /* Make a slightly better attempt at a hash function:
-    */
-   for (i = 0; i < key_size / sizeof(*ikey); i++)
-   {
-      hash += ikey[i];
-      hash += (hash << 10);
-      hash ^= (hash >> 6);
+   for (i = 0; i + 4 <= key_size; i += 4) {
+      memcpy(&word, bytes + i, 4);
+      hash = mix(hash ^ word) + 0x9e3779b9;
    }
 
-   return hash;
+   if (i < key_size) {
+      word = 0;
+      memcpy(&word, bytes + i, key_size - i);
+      hash = mix(hash ^ word) + 0x9e3779b9;
+   }
+
+   return mix(hash);
 }
 
 
@@ -86,17 +115,18 @@ rehash(struct gl_program_cache *cache)
    struct cache_item *c, *next;
    GLuint size, i;
 
-   cache->last = NULL;
+   size = cache->size * 2;
+   items = calloc(size, sizeof(*items));
+   if (!items)
+      return;
 
-   size = cache->size * 3;
-   items = malloc(size * sizeof(*items));
-   memset(items, 0, size * sizeof(*items));
+   cache->last = NULL;
 
    for (i = 0; i < cache->size; i++)
       for (c = cache->items[i]; c; c = next) {
 	 next = c->next;
-	 c->next = items[c->hash % size];
-	 items[c->hash % size] = c;
+	 c->next = items[c->hash & (size - 1)];
+	 items[c->hash & (size - 1)] = c;
       }
 
    free(cache->items);
@@ -135,45 +165,72 @@ clear_cache(struct gl_context *ctx, struct gl_program_cache *cache,
 }
 
 
-
-struct gl_program_cache *
-_mesa_new_program_cache(void)
+static struct gl_program_cache *
+new_cache(GLuint size, GLboolean shared)
 {
    struct gl_program_cache *cache = CALLOC_STRUCT(gl_program_cache);
    if (cache) {
-      cache->size = 17;
+      cache->size = size;
       cache->items =
-         calloc(1, cache->size * sizeof(struct cache_item));
+         calloc(1, cache->size * sizeof(struct cache_item *));
       if (!cache->items) {
          free(cache);
          return NULL;
       }
+      cache->shared = shared;
+      if (shared)
+         _glthread_INIT_MUTEX(cache->Mutex);
    }
    return cache;
 }
 
 
-void
-_mesa_delete_program_cache(struct gl_context *ctx, struct gl_program_cache *cache)
+static void
+delete_cache(struct gl_context *ctx, struct gl_program_cache *cache,
+             GLboolean shader)
 {
-   clear_cache(ctx, cache, GL_FALSE);
+   clear_cache(ctx, cache, shader);
+   if (cache->shared)
+      _glthread_DESTROY_MUTEX(cache->Mutex);
    free(cache->items);
    free(cache);
 }
 
+
+struct gl_program_cache *
+_mesa_new_program_cache(void)
+{
+   return new_cache(16, GL_FALSE);
+}
+
+
+/**
+ * Create a cache which several contexts of a share group may search and
+ * insert into concurrently.  It holds up to MAX_SHARED_ITEMS entries.
+ */
+struct gl_program_cache *
+_mesa_new_shared_program_cache(void)
+{
+   return new_cache(256, GL_TRUE);
+}
+
+
+void
+_mesa_delete_program_cache(struct gl_context *ctx, struct gl_program_cache *cache)
+{
+   delete_cache(ctx, cache, GL_FALSE);
+}
+
 void
 _mesa_delete_shader_cache(struct gl_context *ctx,
 			  struct gl_program_cache *cache)
 {
-   clear_cache(ctx, cache, GL_TRUE);
-   free(cache->items);
-   free(cache);
+   delete_cache(ctx, cache, GL_TRUE);
 }
 
 
-struct gl_program *
-_mesa_search_program_cache(struct gl_program_cache *cache,
-                           const void *key, GLuint keysize)
+static struct gl_program *
+search_cache(struct gl_program_cache *cache, const void *key, GLuint keysize)
 {
    if (cache->last &&
        cache->last->keysize == keysize &&
@@ -184,7 +241,7 @@ _mesa_search_program_cache(struct gl_program_cache *cache,
       const GLuint hash = hash_key(key, keysize);
       struct cache_item *c;
 
-      for (c = cache->items[hash % cache->size]; c; c = c->next) {
+      for (c = cache->items[hash & (cache->size - 1)]; c; c = c->next) {
          if (c->hash == hash &&
              c->keysize == keysize &&
              memcmp(c->key, key, keysize) == 0) {
@@ -199,60 +256,134 @@ _mesa_search_program_cache(struct gl_program_cache *cache,
 }
 
 
-void
-_mesa_program_cache_insert(struct gl_context *ctx,
-                           struct gl_program_cache *cache,
-                           const void *key, GLuint keysize,
-                           struct gl_program *program)
+struct gl_program *
+_mesa_search_program_cache(struct gl_program_cache *cache,
+                           const void *key, GLuint keysize)
+{
+   struct gl_program *program;
+
+   if (!cache->shared)
+      return search_cache(cache, key, keysize);
+
+   _glthread_LOCK_MUTEX(cache->Mutex);
+   program = search_cache(cache, key, keysize);
+   _glthread_UNLOCK_MUTEX(cache->Mutex);
+
+   return program;
+}
+
+
+static GLboolean
+cache_insert(struct gl_context *ctx, struct gl_program_cache *cache,
+             const void *key, GLuint keysize, struct gl_program *program,
+             GLboolean shader)
 {
    const GLuint hash = hash_key(key, keysize);
-   struct cache_item *c = CALLOC_STRUCT(cache_item);
+   struct cache_item *c;
+
+   if (cache->shared && cache->n_items >= MAX_SHARED_ITEMS)
+      return GL_FALSE;
+
+   c = CALLOC_STRUCT(cache_item);
+   if (!c)
+      return GL_FALSE;
 
    c->hash = hash;
 
    c->key = malloc(keysize);
+   if (!c->key) {
+      free(c);
+      return GL_FALSE;
+   }
    memcpy(c->key, key, keysize);
    c->keysize = keysize;
 
    c->program = program;  /* no refcount change */
 
-   if (cache->n_items > cache->size * 1.5) {
-      if (cache->size < 1000)
+   if (cache->n_items > cache->size + cache->size / 2) {
+      if (cache->shared || cache->size < MAX_BUCKETS)
 	 rehash(cache);
       else 
-	 clear_cache(ctx, cache, GL_FALSE);
+	 clear_cache(ctx, cache, shader);
    }
 
    cache->n_items++;
-   c->next = cache->items[hash % cache->size];
-   cache->items[hash % cache->size] = c;
+   c->next = cache->items[hash & (cache->size - 1)];
+   cache->items[hash & (cache->size - 1)] = c;
+
+   return GL_TRUE;
 }
 
-void
+
+static GLboolean
+locked_insert(struct gl_context *ctx, struct gl_program_cache *cache,
+              const void *key, GLuint keysize, struct gl_program *program,
+              GLboolean shader)
+{
+   GLboolean inserted;
+
+   if (!cache->shared)
+      return cache_insert(ctx, cache, key, keysize, program, shader);
+
+   _glthread_LOCK_MUTEX(cache->Mutex);
+   /* Another context may have generated the same program meanwhile, ours
+    * is then only referenced by the caller's private cache.
+    */
+   if (search_cache(cache, key, keysize))
+      inserted = GL_FALSE;
+   else
+      inserted = cache_insert(ctx, cache, key, keysize, program, shader);
+   _glthread_UNLOCK_MUTEX(cache->Mutex);
+
+   return inserted;
+}
+
+
+/**
+ * Insert a program, the cache takes over the caller's reference.
+ *
+ * \return GL_FALSE if the program wasn't inserted, which only happens with
+ * full shared caches or out of memory.  The caller then still owns it.
+ */
+GLboolean
+_mesa_program_cache_insert(struct gl_context *ctx,
+                           struct gl_program_cache *cache,
+                           const void *key, GLuint keysize,
+                           struct gl_program *program)
+{
+   return locked_insert(ctx, cache, key, keysize, program, GL_FALSE);
+}
+
+GLboolean
 _mesa_shader_cache_insert(struct gl_context *ctx,
 			  struct gl_program_cache *cache,
 			  const void *key, GLuint keysize,
 			  struct gl_shader_program *program)
 {
-   const GLuint hash = hash_key(key, keysize);
-   struct cache_item *c = CALLOC_STRUCT(cache_item);
+   return locked_insert(ctx, cache, key, keysize,
+                        (struct gl_program *) program, GL_TRUE);
+}
 
-   c->hash = hash;
 
-   c->key = malloc(keysize);
-   memcpy(c->key, key, keysize);
-   c->keysize = keysize;
+/**
+ * Call \p callback for each program in the cache (gl_program or
+ * gl_shader_program, depending on how they were inserted).
+ */
+void
+_mesa_program_cache_walk(struct gl_program_cache *cache,
+                         void (*callback)(void *program, void *data),
+                         void *data)
+{
+   struct cache_item *c;
+   GLuint i;
 
-   c->program = (struct gl_program *)program;  /* no refcount change */
+   if (cache->shared)
+      _glthread_LOCK_MUTEX(cache->Mutex);
 
-   if (cache->n_items > cache->size * 1.5) {
-      if (cache->size < 1000)
-	 rehash(cache);
-      else
-	 clear_cache(ctx, cache, GL_TRUE);
-   }
+   for (i = 0; i < cache->size; i++)
+      for (c = cache->items[i]; c; c = c->next)
+         callback(c->program, data);
 
-   cache->n_items++;
-   c->next = cache->items[hash % cache->size];
-   cache->items[hash % cache->size] = c;
+   if (cache->shared)
+      _glthread_UNLOCK_MUTEX(cache->Mutex);
 }
@@ -41,6 +41,9 @@ struct gl_program_cache;
 extern struct gl_program_cache *
 _mesa_new_program_cache(void);
 
+extern struct gl_program_cache *
+_mesa_new_shared_program_cache(void);
+
 extern void
 _mesa_delete_program_cache(struct gl_context *ctx, struct gl_program_cache *pc);
 
@@ -52,17 +55,22 @@ extern struct gl_program *
 _mesa_search_program_cache(struct gl_program_cache *cache,
                            const void *key, GLuint keysize);
 
-extern void
+extern GLboolean
 _mesa_program_cache_insert(struct gl_context *ctx,
                            struct gl_program_cache *cache,
                            const void *key, GLuint keysize,
                            struct gl_program *program);
 
-void
+GLboolean
 _mesa_shader_cache_insert(struct gl_context *ctx,
 			  struct gl_program_cache *cache,
 			  const void *key, GLuint keysize,
 			  struct gl_shader_program *program);
 
+extern void
+_mesa_program_cache_walk(struct gl_program_cache *cache,
+                         void (*callback)(void *program, void *data),
+                         void *data);
+
 
 #endif /* PROG_CACHE_H */
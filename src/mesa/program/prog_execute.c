@@ -566,6 +566,691 @@ store_vector4ui(const struct prog_instruction *inst,
 }
 
 
+/**
+ * \name Pre-decoded programs
+ *
+ * Straight-line programs which only use the common arithmetic and texture
+ * instructions (that is, most ARB and fixed-function programs) can be
+ * decoded once per span or vertex buffer by _mesa_begin_program_batch().
+ * Each instruction then becomes a function specialized for its opcode,
+ * with its register pointers, swizzles and modifiers resolved up front,
+ * which _mesa_execute_program() runs for each element of the batch.
+ * The results are the same as the ones of the generic interpreter below.
+ */
+/*@{*/
+
+struct prog_decoded_inst;
+
+/**
+ * Execute one decoded instruction.
+ * \return GL_FALSE if the fragment was killed.
+ */
+typedef GLboolean (*prog_decoded_func)(struct gl_context *ctx,
+                                       const struct gl_program_machine *machine,
+                                       const struct prog_decoded_inst *inst);
+
+/**
+ * A source register with its address resolved.
+ */
+struct prog_decoded_src
+{
+   const GLfloat *Base;  /**< the register, or the one of element zero */
+   GLuint Stride;        /**< floats between elements (fragment inputs) */
+   GLubyte Swizzle[4];
+   GLboolean Direct;     /**< no swizzle, abs or negate: use Base as is */
+   GLuint AndMask;       /**< clears the sign bit for abs */
+   GLuint XorMask;       /**< flips the sign bit for negate */
+};
+
+struct prog_decoded_inst
+{
+   prog_decoded_func Func;
+   struct prog_decoded_src Src[3];
+   GLfloat *Dst;
+   GLuint WriteMask;
+   GLboolean Saturate;
+   const struct prog_instruction *Inst;
+};
+
+struct prog_decoded_program
+{
+   const struct gl_program *Program;  /**< NULL unless inside a batch */
+   struct prog_decoded_inst *Inst;
+   GLuint NumInst;
+   GLuint MaxInst;                    /**< size of the Inst array */
+};
+
+
+/**
+ * Fetch a 4-element vector from a decoded source register, into tmp
+ * unless the register can be used directly.
+ */
+static inline const GLfloat *
+decoded_fetch4(const struct prog_decoded_src *source,
+               const struct gl_program_machine *machine, fi_type tmp[4])
+{
+   const fi_type *src = (const fi_type *)
+      (source->Base + machine->CurElement * source->Stride);
+
+   if (source->Direct)
+      return &src->f;
+
+   tmp[0].u = (src[source->Swizzle[0]].u & source->AndMask) ^ source->XorMask;
+   tmp[1].u = (src[source->Swizzle[1]].u & source->AndMask) ^ source->XorMask;
+   tmp[2].u = (src[source->Swizzle[2]].u & source->AndMask) ^ source->XorMask;
+   tmp[3].u = (src[source->Swizzle[3]].u & source->AndMask) ^ source->XorMask;
+   return &tmp[0].f;
+}
+
+
+/**
+ * Fetch the first (swizzled) component of a decoded source register.
+ */
+static inline GLfloat
+decoded_fetch1(const struct prog_decoded_src *source,
+               const struct gl_program_machine *machine)
+{
+   const fi_type *src = (const fi_type *)
+      (source->Base + machine->CurElement * source->Stride);
+   fi_type tmp;
+
+   tmp.u = (src[source->Swizzle[0]].u & source->AndMask) ^ source->XorMask;
+   return tmp.f;
+}
+
+
+/**
+ * Store 4 floats into the destination of a decoded instruction.
+ */
+static inline void
+decoded_store4(const struct prog_decoded_inst *inst, const GLfloat value[4])
+{
+   GLfloat *dst = inst->Dst;
+   GLfloat clampedValue[4];
+
+   if (inst->Saturate) {
+      clampedValue[0] = CLAMP(value[0], 0.0F, 1.0F);
+      clampedValue[1] = CLAMP(value[1], 0.0F, 1.0F);
+      clampedValue[2] = CLAMP(value[2], 0.0F, 1.0F);
+      clampedValue[3] = CLAMP(value[3], 0.0F, 1.0F);
+      value = clampedValue;
+   }
+
+   if (inst->WriteMask == WRITEMASK_XYZW) {
+      COPY_4V(dst, value);
+   }
+   else {
+      if (inst->WriteMask & WRITEMASK_X)
+         dst[0] = value[0];
+      if (inst->WriteMask & WRITEMASK_Y)
+         dst[1] = value[1];
+      if (inst->WriteMask & WRITEMASK_Z)
+         dst[2] = value[2];
+      if (inst->WriteMask & WRITEMASK_W)
+         dst[3] = value[3];
+   }
+}
+
+
+static inline void
+decoded_store1(const struct prog_decoded_inst *inst, GLfloat value)
+{
+   GLfloat result[4];
+   result[0] = result[1] = result[2] = result[3] = value;
+   decoded_store4(inst, result);
+}
+
+
+#define FETCH4(n, v) \
+   fi_type v##_tmp[4]; \
+   const GLfloat *v = decoded_fetch4(&inst->Src[n], machine, v##_tmp)
+
+#define FETCH1(n) decoded_fetch1(&inst->Src[n], machine)
+
+
+static GLboolean
+decoded_abs(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   GLfloat result[4];
+   result[0] = FABSF(a[0]);
+   result[1] = FABSF(a[1]);
+   result[2] = FABSF(a[2]);
+   result[3] = FABSF(a[3]);
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_add(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = a[0] + b[0];
+   result[1] = a[1] + b[1];
+   result[2] = a[2] + b[2];
+   result[3] = a[3] + b[3];
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_cmp(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   FETCH4(2, c);
+   GLfloat result[4];
+   result[0] = a[0] < 0.0F ? b[0] : c[0];
+   result[1] = a[1] < 0.0F ? b[1] : c[1];
+   result[2] = a[2] < 0.0F ? b[2] : c[2];
+   result[3] = a[3] < 0.0F ? b[3] : c[3];
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_dp2(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   decoded_store1(inst, DOT2(a, b));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_dp3(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   decoded_store1(inst, DOT3(a, b));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_dp4(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   decoded_store1(inst, DOT4(a, b));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_dph(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   decoded_store1(inst, DOT3(a, b) + b[3]);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_ex2(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   decoded_store1(inst, (GLfloat) pow(2.0, FETCH1(0)));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_flr(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   GLfloat result[4];
+   result[0] = FLOORF(a[0]);
+   result[1] = FLOORF(a[1]);
+   result[2] = FLOORF(a[2]);
+   result[3] = FLOORF(a[3]);
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_frc(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   GLfloat result[4];
+   result[0] = a[0] - FLOORF(a[0]);
+   result[1] = a[1] - FLOORF(a[1]);
+   result[2] = a[2] - FLOORF(a[2]);
+   result[3] = a[3] - FLOORF(a[3]);
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_kil(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   return !(a[0] < 0.0F || a[1] < 0.0F || a[2] < 0.0F || a[3] < 0.0F);
+}
+
+static GLboolean
+decoded_lg2(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   const GLfloat a = FETCH1(0);
+   /* The fast LOG2 macro doesn't meet the precision requirements.
+    */
+   decoded_store1(inst, a == 0.0F ? -FLT_MAX : (float)(log(a) * 1.442695F));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_lit(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   const GLfloat epsilon = 1.0F / 256.0F;      /* from NV VP spec */
+   FETCH4(0, src);
+   GLfloat a[4], result[4];
+   a[0] = MAX2(src[0], 0.0F);
+   a[1] = MAX2(src[1], 0.0F);
+   a[3] = CLAMP(src[3], -(128.0F - epsilon), (128.0F - epsilon));
+   result[0] = 1.0F;
+   result[1] = a[0];
+   if (a[0] > 0.0F) {
+      if (a[1] == 0.0 && a[3] == 0.0)
+         result[2] = 1.0F;
+      else
+         result[2] = (GLfloat) pow(a[1], a[3]);
+   }
+   else {
+      result[2] = 0.0F;
+   }
+   result[3] = 1.0F;
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_lrp(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   FETCH4(2, c);
+   GLfloat result[4];
+   result[0] = a[0] * b[0] + (1.0F - a[0]) * c[0];
+   result[1] = a[1] * b[1] + (1.0F - a[1]) * c[1];
+   result[2] = a[2] * b[2] + (1.0F - a[2]) * c[2];
+   result[3] = a[3] * b[3] + (1.0F - a[3]) * c[3];
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_mad(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   FETCH4(2, c);
+   GLfloat result[4];
+   result[0] = a[0] * b[0] + c[0];
+   result[1] = a[1] * b[1] + c[1];
+   result[2] = a[2] * b[2] + c[2];
+   result[3] = a[3] * b[3] + c[3];
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_max(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = MAX2(a[0], b[0]);
+   result[1] = MAX2(a[1], b[1]);
+   result[2] = MAX2(a[2], b[2]);
+   result[3] = MAX2(a[3], b[3]);
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_min(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = MIN2(a[0], b[0]);
+   result[1] = MIN2(a[1], b[1]);
+   result[2] = MIN2(a[2], b[2]);
+   result[3] = MIN2(a[3], b[3]);
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_mov(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   GLfloat result[4];
+   COPY_4V(result, a);
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_mul(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = a[0] * b[0];
+   result[1] = a[1] * b[1];
+   result[2] = a[2] * b[2];
+   result[3] = a[3] * b[3];
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_pow(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   decoded_store1(inst, (GLfloat) pow(FETCH1(0), FETCH1(1)));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_rcp(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   decoded_store1(inst, 1.0F / FETCH1(0));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_rsq(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   decoded_store1(inst, INV_SQRTF(FABSF(FETCH1(0))));
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_sge(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = (a[0] >= b[0]) ? 1.0F : 0.0F;
+   result[1] = (a[1] >= b[1]) ? 1.0F : 0.0F;
+   result[2] = (a[2] >= b[2]) ? 1.0F : 0.0F;
+   result[3] = (a[3] >= b[3]) ? 1.0F : 0.0F;
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_slt(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = (a[0] < b[0]) ? 1.0F : 0.0F;
+   result[1] = (a[1] < b[1]) ? 1.0F : 0.0F;
+   result[2] = (a[2] < b[2]) ? 1.0F : 0.0F;
+   result[3] = (a[3] < b[3]) ? 1.0F : 0.0F;
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_sub(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = a[0] - b[0];
+   result[1] = a[1] - b[1];
+   result[2] = a[2] - b[2];
+   result[3] = a[3] - b[3];
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_tex(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   GLfloat texcoord[4], color[4];
+   COPY_4V(texcoord, a);
+   /* See OPCODE_TEX in _mesa_execute_program() */
+   texcoord[3] = 1.0f;
+   fetch_texel(ctx, machine, inst->Inst, texcoord, 0.0, color);
+   decoded_store4(inst, color);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_txb(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, texcoord);
+   GLfloat color[4];
+   /* texcoord[3] is the bias to add to lambda */
+   fetch_texel(ctx, machine, inst->Inst, texcoord, texcoord[3], color);
+   decoded_store4(inst, color);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_txp(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   GLfloat texcoord[4], color[4];
+   COPY_4V(texcoord, a);
+   if (texcoord[3] != 0.0) {
+      texcoord[0] /= texcoord[3];
+      texcoord[1] /= texcoord[3];
+      texcoord[2] /= texcoord[3];
+   }
+   fetch_texel(ctx, machine, inst->Inst, texcoord, 0.0, color);
+   decoded_store4(inst, color);
+   return GL_TRUE;
+}
+
+static GLboolean
+decoded_xpd(struct gl_context *ctx, const struct gl_program_machine *machine,
+            const struct prog_decoded_inst *inst)
+{
+   FETCH4(0, a);
+   FETCH4(1, b);
+   GLfloat result[4];
+   result[0] = a[1] * b[2] - a[2] * b[1];
+   result[1] = a[2] * b[0] - a[0] * b[2];
+   result[2] = a[0] * b[1] - a[1] * b[0];
+   result[3] = 1.0;
+   decoded_store4(inst, result);
+   return GL_TRUE;
+}
+
+#undef FETCH4
+#undef FETCH1
+
+
+/**
+ * Return the decoded function for an opcode, or NULL if the opcode is
+ * left to the generic interpreter.
+ */
+static prog_decoded_func
+decoded_opcode_func(gl_inst_opcode opcode)
+{
+   switch (opcode) {
+   case OPCODE_ABS: return decoded_abs;
+   case OPCODE_ADD: return decoded_add;
+   case OPCODE_CMP: return decoded_cmp;
+   case OPCODE_DP2: return decoded_dp2;
+   case OPCODE_DP3: return decoded_dp3;
+   case OPCODE_DP4: return decoded_dp4;
+   case OPCODE_DPH: return decoded_dph;
+   case OPCODE_EX2: return decoded_ex2;
+   case OPCODE_FLR: return decoded_flr;
+   case OPCODE_FRC: return decoded_frc;
+   case OPCODE_KIL: return decoded_kil;
+   case OPCODE_LG2: return decoded_lg2;
+   case OPCODE_LIT: return decoded_lit;
+   case OPCODE_LRP: return decoded_lrp;
+   case OPCODE_MAD: return decoded_mad;
+   case OPCODE_MAX: return decoded_max;
+   case OPCODE_MIN: return decoded_min;
+   case OPCODE_MOV: return decoded_mov;
+   case OPCODE_MUL: return decoded_mul;
+   case OPCODE_POW: return decoded_pow;
+   case OPCODE_RCP: return decoded_rcp;
+   case OPCODE_RSQ: return decoded_rsq;
+   case OPCODE_SGE: return decoded_sge;
+   case OPCODE_SLT: return decoded_slt;
+   case OPCODE_SUB: return decoded_sub;
+   case OPCODE_TEX: return decoded_tex;
+   case OPCODE_TXB: return decoded_txb;
+   case OPCODE_TXP: return decoded_txp;
+   case OPCODE_XPD: return decoded_xpd;
+   default:         return NULL;
+   }
+}
+
+
+/**
+ * Resolve a source register, as get_src_register_pointer() and
+ * fetch_vector4() would do for every element.
+ */
+static GLboolean
+decode_src(const struct prog_src_register *source,
+           const struct gl_program_machine *machine,
+           struct prog_decoded_src *decoded)
+{
+   const struct gl_program *prog = machine->CurProgram;
+   const GLint reg = source->Index;
+   GLuint i;
+
+   if (source->RelAddr)
+      return GL_FALSE;
+
+   for (i = 0; i < 4; i++) {
+      decoded->Swizzle[i] = GET_SWZ(source->Swizzle, i);
+      if (decoded->Swizzle[i] > SWIZZLE_W)
+         return GL_FALSE;
+   }
+
+   decoded->Stride = 0;
+   decoded->AndMask = source->Abs ? 0x7fffffff : ~0u;
+   decoded->XorMask = source->Negate ? 0x80000000 : 0u;
+   decoded->Direct = source->Swizzle == SWIZZLE_NOOP &&
+                     !source->Abs && !source->Negate;
+
+   if (source->File == PROGRAM_INPUT &&
+       prog->Target != GL_VERTEX_PROGRAM_ARB &&
+       reg < VARYING_SLOT_MAX) {
+      decoded->Base = machine->Attribs[reg][0];
+      decoded->Stride = 4;
+      return GL_TRUE;
+   }
+
+   switch (source->File) {
+   case PROGRAM_TEMPORARY:
+   case PROGRAM_INPUT:
+   case PROGRAM_OUTPUT:
+   case PROGRAM_LOCAL_PARAM:
+   case PROGRAM_ENV_PARAM:
+   case PROGRAM_STATE_VAR:
+   case PROGRAM_CONSTANT:
+   case PROGRAM_UNIFORM:
+   case PROGRAM_SYSTEM_VALUE:
+      decoded->Base = get_src_register_pointer(source, machine);
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * Decode one instruction.
+ * \return GL_FALSE if it needs the generic interpreter.
+ */
+static GLboolean
+decode_instruction(const struct prog_instruction *inst,
+                   struct gl_program_machine *machine,
+                   struct prog_decoded_inst *decoded)
+{
+   const GLuint numSrc = _mesa_num_inst_src_regs(inst->Opcode);
+   GLuint i;
+
+   decoded->Func = decoded_opcode_func(inst->Opcode);
+   decoded->Inst = inst;
+   if (!decoded->Func)
+      return GL_FALSE;
+
+   for (i = 0; i < numSrc; i++) {
+      if (!decode_src(&inst->SrcReg[i], machine, &decoded->Src[i]))
+         return GL_FALSE;
+   }
+
+   if (_mesa_num_inst_dst_regs(inst->Opcode)) {
+      const struct prog_dst_register *dstReg = &inst->DstReg;
+
+      if (dstReg->RelAddr ||
+          dstReg->CondMask != COND_TR ||
+          inst->CondUpdate ||
+          (dstReg->File != PROGRAM_TEMPORARY &&
+           dstReg->File != PROGRAM_OUTPUT))
+         return GL_FALSE;
+
+      decoded->Dst = get_dst_register_pointer(dstReg, machine);
+      decoded->WriteMask = dstReg->WriteMask;
+      decoded->Saturate = inst->SaturateMode == SATURATE_ZERO_ONE;
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Run a decoded program for the current element of the machine.
+ */
+static GLboolean
+execute_decoded_program(struct gl_context *ctx,
+                        const struct prog_decoded_program *decoded,
+                        const struct gl_program_machine *machine)
+{
+   const struct prog_decoded_inst *inst = decoded->Inst;
+   const struct prog_decoded_inst *end = inst + decoded->NumInst;
+
+   for (; inst != end; inst++) {
+      if (!inst->Func(ctx, machine, inst))
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+/*@}*/
+
 
 /**
  * Execute the given vertex/fragment program.
@@ -597,6 +1282,10 @@ _mesa_execute_program(struct gl_context * ctx,
       machine->EnvParams = ctx->FragmentProgram.Parameters;
    }
 
+   if (machine->Decoded && machine->Decoded->Program == program) {
+      return execute_decoded_program(ctx, machine->Decoded, machine);
+   }
+
    for (pc = 0; pc < numInst; pc++) {
       const struct prog_instruction *inst = program->Instructions + pc;
 
@@ -1687,3 +2376,93 @@ _mesa_execute_program(struct gl_context * ctx,
 
    return GL_TRUE;
 }
+
+
+/**
+ * Decode the program, if it can be, for running it through the faster
+ * path of _mesa_execute_program() until _mesa_end_program_batch().
+ *
+ * The registers of the program must not move between these (the machine,
+ * its fragment input attribs and the parameter values).
+ *
+ * \return GL_TRUE if the program was decoded.
+ */
+GLboolean
+_mesa_begin_program_batch(struct gl_context *ctx,
+                          const struct gl_program *program,
+                          struct gl_program_machine *machine)
+{
+   struct prog_decoded_program *decoded = machine->Decoded;
+   const GLuint numInst = program->NumInstructions;
+   GLuint pc, n = 0;
+
+   if (DEBUG_PROG)
+      return GL_FALSE;
+
+   if (!decoded) {
+      decoded = CALLOC_STRUCT(prog_decoded_program);
+      if (!decoded)
+         return GL_FALSE;
+      machine->Decoded = decoded;
+   }
+
+   decoded->Program = NULL;
+
+   if (decoded->MaxInst < numInst) {
+      free(decoded->Inst);
+      decoded->Inst = malloc(numInst * sizeof(decoded->Inst[0]));
+      if (!decoded->Inst) {
+         decoded->MaxInst = 0;
+         return GL_FALSE;
+      }
+      decoded->MaxInst = numInst;
+   }
+
+   machine->CurProgram = program;
+   if (program->Target == GL_VERTEX_PROGRAM_ARB) {
+      machine->EnvParams = ctx->VertexProgram.Parameters;
+   }
+   else {
+      machine->EnvParams = ctx->FragmentProgram.Parameters;
+   }
+
+   for (pc = 0; pc < numInst; pc++) {
+      const struct prog_instruction *inst = program->Instructions + pc;
+
+      if (inst->Opcode == OPCODE_END)
+         break;
+      if (inst->Opcode == OPCODE_NOP)
+         continue;
+      if (!decode_instruction(inst, machine, &decoded->Inst[n++]))
+         return GL_FALSE;
+   }
+
+   decoded->NumInst = n;
+   decoded->Program = program;
+   return GL_TRUE;
+}
+
+
+/**
+ * Go back to the generic interpreter.
+ */
+void
+_mesa_end_program_batch(struct gl_program_machine *machine)
+{
+   if (machine->Decoded)
+      machine->Decoded->Program = NULL;
+}
+
+
+/**
+ * Free what the machine allocated, but not the machine itself.
+ */
+void
+_mesa_free_program_machine(struct gl_program_machine *machine)
+{
+   if (machine->Decoded) {
+      free(machine->Decoded->Inst);
+      free(machine->Decoded);
+      machine->Decoded = NULL;
+   }
+}
@@ -43,6 +43,9 @@ typedef void (*FetchTexelDerivFunc)(struct gl_context *ctx, const GLfloat texcoo
 #define PROG_MAX_WIDTH 16384
 
 
+struct prog_decoded_program;
+
+
 /**
  * Virtual machine state used during execution of vertex/fragment programs.
  */
@@ -75,6 +78,9 @@ struct gl_program_machine
    /** Texture fetch functions */
    FetchTexelLodFunc FetchTexelLod;
    FetchTexelDerivFunc FetchTexelDeriv;
+
+   /** Pre-decoded program, see _mesa_begin_program_batch() */
+   struct prog_decoded_program *Decoded;
 };
 
 
@@ -87,5 +93,16 @@ _mesa_execute_program(struct gl_context *ctx,
                       const struct gl_program *program,
                       struct gl_program_machine *machine);
 
+extern GLboolean
+_mesa_begin_program_batch(struct gl_context *ctx,
+                          const struct gl_program *program,
+                          struct gl_program_machine *machine);
+
+extern void
+_mesa_end_program_batch(struct gl_program_machine *machine);
+
+extern void
+_mesa_free_program_machine(struct gl_program_machine *machine);
+
 
 #endif /* PROG_EXECUTE_H */
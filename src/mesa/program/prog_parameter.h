@@ -87,6 +87,11 @@ struct gl_program_parameter_list
    gl_constant_value (*ParameterValues)[4]; /**< Array [Size] of constant[4] */
    GLbitfield StateFlags; /**< _NEW_* flags indicating which state changes
                                might invalidate ParameterValues[] */
+   /**
+    * Range of ParameterValues[] written by glUniform since the driver last
+    * uploaded them, or empty if DirtyEnd is zero.
+    */
+   GLuint DirtyStart, DirtyEnd;
 };
 
 
@@ -112,6 +117,22 @@ _mesa_num_parameters(const struct gl_program_parameter_list *list)
    return list ? list->NumParameters : 0;
 }
 
+static inline void
+_mesa_parameter_values_dirty(struct gl_program_parameter_list *list,
+                             GLuint first, GLuint count)
+{
+   if (list->DirtyEnd == 0) {
+      list->DirtyStart = first;
+      list->DirtyEnd = first + count;
+   }
+   else {
+      if (first < list->DirtyStart)
+         list->DirtyStart = first;
+      if (first + count > list->DirtyEnd)
+         list->DirtyEnd = first + count;
+   }
+}
+
 extern GLint
 _mesa_add_parameter(struct gl_program_parameter_list *paramList,
                     gl_register_file type, const char *name,
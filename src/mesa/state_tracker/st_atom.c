@@ -30,6 +30,10 @@
 #include "main/context.h"
 
 #include "pipe/p_defines.h"
+#include "os/os_time.h"
+#include "util/u_counter.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
@@ -73,21 +77,84 @@ static const struct st_tracked_state *atoms[] =
 };
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(atom_stats, "ST_ATOM_STATS", FALSE)
+
+
+/**
+ * Build the mapping from each dirty bit to the atoms which check it, so
+ * that validation only looks at the atoms of the bits which are set.
+ */
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   GLuint i, bit;
+
+   STATIC_ASSERT(Elements(atoms) <= 32);
+
+   memset(st->mesa_atoms, 0, sizeof(st->mesa_atoms));
+   memset(st->st_atoms, 0, sizeof(st->st_atoms));
+
+   for (i = 0; i < Elements(atoms); i++) {
+      const struct st_tracked_state *atom = atoms[i];
+
+      if (!(atom->dirty.mesa || atom->dirty.st) ||
+          !atom->update) {
+         printf("malformed atom %s\n", atom->name);
+         assert(0);
+      }
+
+      for (bit = 0; bit < 32; bit++) {
+         if (atom->dirty.mesa & (1u << bit))
+            st->mesa_atoms[bit] |= 1u << i;
+         if (atom->dirty.st & (1u << bit))
+            st->st_atoms[bit] |= 1u << i;
+      }
+   }
+
+   /* Specialized uniform values are part of the shader variant keys. */
+   if (st_specializing_uniforms()) {
+      bit = ffs(_NEW_PROGRAM_CONSTANTS) - 1;
+      for (i = 0; i < Elements(atoms); i++) {
+         if (atoms[i] == &st_update_fp || atoms[i] == &st_update_vp)
+            st->mesa_atoms[bit] |= 1u << i;
+      }
+   }
+
+   if (debug_get_option_atom_stats())
+      st->atom_stats = calloc(Elements(atoms), sizeof(*st->atom_stats));
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   GLuint i;
+
+   if (!st->atom_stats)
+      return;
+
+   debug_printf("st: %-32s %12s %12s %10s\n",
+                "atom", "calls", "total us", "avg ns");
+   for (i = 0; i < Elements(atoms); i++) {
+      const struct st_atom_stats *stats = &st->atom_stats[i];
+
+      if (!stats->calls)
+         continue;
+
+      debug_printf("st: %-32s %12llu %12llu %10llu\n",
+                   atoms[i]->name,
+                   (unsigned long long) stats->calls,
+                   (unsigned long long) (stats->time / 1000),
+                   (unsigned long long) (stats->time / stats->calls));
+   }
+
+   free(st->atom_stats);
+   st->atom_stats = NULL;
 }
 
 
 /***********************************************************************
  */
 
+#ifdef DEBUG
 static GLboolean check_state( const struct st_state_flags *a,
 			      const struct st_state_flags *b )
 {
@@ -101,6 +168,7 @@ static void accumulate_state( struct st_state_flags *a,
    a->mesa |= b->mesa;
    a->st |= b->st;
 }
+#endif
 
 
 static void xor_states( struct st_state_flags *result,
@@ -145,6 +213,24 @@ static void check_attrib_edgeflag(struct st_context *st)
 }
 
 
+/**
+ * Bitmask of the atoms which check any of the given dirty bits.
+ */
+static unsigned atoms_for_state( const struct st_context *st,
+                                 const struct st_state_flags *state )
+{
+   unsigned mesa = state->mesa, bits = state->st;
+   unsigned mask = 0;
+
+   while (mesa)
+      mask |= st->mesa_atoms[u_bit_scan(&mesa)];
+   while (bits)
+      mask |= st->st_atoms[u_bit_scan(&bits)];
+
+   return mask;
+}
+
+
 /***********************************************************************
  * Update all derived state:
  */
@@ -152,7 +238,15 @@ static void check_attrib_edgeflag(struct st_context *st)
 void st_validate_state( struct st_context *st )
 {
    struct st_state_flags *state = &st->dirty;
+   int64_t start = util_counter_begin();
+   unsigned mask;
    GLuint i;
+#ifdef DEBUG
+   struct st_state_flags examined;
+   GLuint examined_atoms = 0;
+
+   memset(&examined, 0, sizeof(examined));
+#endif
 
    /* Get Mesa driver state. */
    st->dirty.st |= st->ctx->NewDriverState;
@@ -167,62 +261,54 @@ void st_validate_state( struct st_context *st )
 
    st_manager_validate_framebuffers(st);
 
-   if (state->st == 0)
+   if (state->st == 0) {
+      util_counter_end(UTIL_COUNTER_VALIDATE_USECS, start);
       return;
+   }
 
    /*printf("%s %x/%x\n", __FUNCTION__, state->mesa, state->st);*/
 
-#ifdef DEBUG
-   if (1) {
-#else
-   if (0) {
-#endif
-      /* Debug version which enforces various sanity checks on the
-       * state flags which are generated and checked to help ensure
-       * state atoms are ordered correctly in the list.
-       */
-      struct st_state_flags examined, prev;      
-      memset(&examined, 0, sizeof(examined));
+   mask = atoms_for_state(st, state);
+
+   while (mask) {
+      const struct st_tracked_state *atom;
+      struct st_state_flags prev, generated;
+
+      i = u_bit_scan(&mask);
+      atom = atoms[i];
       prev = *state;
 
-      for (i = 0; i < Elements(atoms); i++) {	 
-	 const struct st_tracked_state *atom = atoms[i];
-	 struct st_state_flags generated;
-	 
-	 /*printf("atom %s %x/%x\n", atom->name, atom->dirty.mesa, atom->dirty.st);*/
-
-	 if (!(atom->dirty.mesa || atom->dirty.st) ||
-	     !atom->update) {
-	    printf("malformed atom %s\n", atom->name);
-	    assert(0);
-	 }
-
-	 if (check_state(state, &atom->dirty)) {
-	    atoms[i]->update( st );
-	    /*printf("after: %x\n", atom->dirty.mesa);*/
-	 }
-
-	 accumulate_state(&examined, &atom->dirty);
-
-	 /* generated = (prev ^ state)
-	  * if (examined & generated)
-	  *     fail;
-	  */
-	 xor_states(&generated, &prev, state);
-	 assert(!check_state(&examined, &generated));
-	 prev = *state;
+      if (st->atom_stats) {
+         int64_t start = os_time_get_nano();
+         atom->update( st );
+         st->atom_stats[i].time += os_time_get_nano() - start;
+         st->atom_stats[i].calls++;
+      }
+      else {
+         atom->update( st );
       }
-      /*printf("\n");*/
 
-   }
-   else {
-      for (i = 0; i < Elements(atoms); i++) {	 
-	 if (check_state(state, &atoms[i]->dirty))
-	    atoms[i]->update( st );
+      /* An atom may flag state for the atoms after it, but not for
+       * itself or the ones before it.  Check that ordering in debug
+       * builds.
+       */
+#ifdef DEBUG
+      for (; examined_atoms <= i; examined_atoms++)
+         accumulate_state(&examined, &atoms[examined_atoms]->dirty);
+#endif
+
+      xor_states(&generated, &prev, state);
+      if (generated.mesa || generated.st) {
+#ifdef DEBUG
+         assert(!check_state(&examined, &generated));
+#endif
+         mask |= atoms_for_state(st, &generated) & ~((2u << i) - 1);
       }
    }
 
    memset(state, 0, sizeof(*state));
+
+   util_counter_end(UTIL_COUNTER_VALIDATE_USECS, start);
 }
 
 
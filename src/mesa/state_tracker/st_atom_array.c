@@ -356,7 +356,8 @@ is_interleaved_arrays(const struct st_vertex_program *vp,
  * \param velements  returns vertex element info
  */
 static boolean
-setup_interleaved_attribs(const struct st_vertex_program *vp,
+setup_interleaved_attribs(struct st_context *st,
+                          const struct st_vertex_program *vp,
                           const struct st_vp_variant *vpv,
                           const struct gl_client_array **arrays,
                           struct pipe_vertex_buffer *vbuffer,
@@ -435,6 +436,7 @@ setup_interleaved_attribs(const struct st_vertex_program *vp,
       if (!stobj || !stobj->buffer) {
          return FALSE; /* out-of-memory error probably */
       }
+      st_bufferobj_sync(st, stobj);
 
       vbuffer->buffer = stobj->buffer;
       vbuffer->user_buffer = NULL;
@@ -487,6 +489,7 @@ setup_non_interleaved_attribs(struct st_context *st,
          if (!stobj || !stobj->buffer) {
             return FALSE; /* out-of-memory error probably */
          }
+         st_bufferobj_sync(st, stobj);
 
          vbuffer[attr].buffer = stobj->buffer;
          vbuffer[attr].user_buffer = NULL;
@@ -554,7 +557,7 @@ static void update_array(struct st_context *st)
     * Setup the vbuffer[] and velements[] arrays.
     */
    if (is_interleaved_arrays(vp, vpv, arrays)) {
-      if (!setup_interleaved_attribs(vp, vpv, arrays, vbuffer, velements)) {
+      if (!setup_interleaved_attribs(st, vp, vpv, arrays, vbuffer, velements)) {
          st->vertex_array_out_of_memory = TRUE;
          return;
       }
@@ -32,11 +32,13 @@
  */
 
 #include "main/imports.h"
+#include "main/mtypes.h"
 #include "program/prog_parameter.h"
 #include "program/prog_print.h"
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
+#include "util/u_box.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "cso_cache/cso_context.h"
@@ -48,6 +50,123 @@
 #include "st_program.h"
 #include "st_cb_bufferobjects.h"
 
+/**
+ * Build the constant buffer for \p params from the one uploaded last time
+ * for the same parameters.  Only the values which may have changed, those
+ * written by glUniform and the state variables, are written by the CPU;
+ * the GPU copies the rest.
+ * \return FALSE if all the values have to be uploaded
+ */
+static boolean
+upload_changed_constants(struct st_context *st,
+                         struct gl_program_parameter_list *params,
+                         unsigned shader_type, unsigned paramBytes,
+                         struct pipe_constant_buffer *cb)
+{
+   const unsigned vec4 = sizeof(params->ParameterValues[0]);
+   const unsigned num = params->NumParameters;
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_resource *prev = st->state.constants[shader_type].buffer;
+   const unsigned prev_offset = st->state.constants[shader_type].offset;
+   unsigned ranges[2][2], num_ranges = 0, written = 0;
+   unsigned state_start = num, state_end = 0;
+   unsigned program_flag, pos, i;
+   ubyte *map;
+
+   switch (shader_type) {
+   case PIPE_SHADER_VERTEX:
+      program_flag = ST_NEW_VERTEX_PROGRAM;
+      break;
+   case PIPE_SHADER_FRAGMENT:
+      program_flag = ST_NEW_FRAGMENT_PROGRAM;
+      break;
+   default:
+      program_flag = ST_NEW_GEOMETRY_PROGRAM;
+      break;
+   }
+
+   /* Other contexts may have consumed the glUniform ranges. */
+   if (!prev ||
+       st->state.constants[shader_type].ptr != params->ParameterValues ||
+       st->state.constants[shader_type].size != paramBytes ||
+       (st->dirty.st & program_flag) ||
+       st->ctx->Shared->RefCount > 1)
+      return FALSE;
+
+   for (i = 0; i < num; i++) {
+      if (params->Parameters[i].Type == PROGRAM_STATE_VAR) {
+         state_start = MIN2(state_start, i);
+         state_end = i + 1;
+      }
+   }
+
+   if (params->DirtyEnd) {
+      ranges[num_ranges][0] = MIN2(params->DirtyStart, num);
+      ranges[num_ranges][1] = MIN2(params->DirtyEnd, num);
+      num_ranges++;
+   }
+   if (state_end) {
+      if (num_ranges &&
+          state_start <= ranges[0][1] && state_end >= ranges[0][0]) {
+         ranges[0][0] = MIN2(ranges[0][0], state_start);
+         ranges[0][1] = MAX2(ranges[0][1], state_end);
+      }
+      else if (num_ranges && state_start < ranges[0][0]) {
+         ranges[1][0] = ranges[0][0];
+         ranges[1][1] = ranges[0][1];
+         ranges[0][0] = state_start;
+         ranges[0][1] = state_end;
+         num_ranges++;
+      }
+      else {
+         ranges[num_ranges][0] = state_start;
+         ranges[num_ranges][1] = state_end;
+         num_ranges++;
+      }
+   }
+
+   for (i = 0; i < num_ranges; i++)
+      written += ranges[i][1] - ranges[i][0];
+
+   /* Not worth the copies. */
+   if (written * 2 >= num)
+      return FALSE;
+
+   cb->buffer = NULL;
+   cb->user_buffer = NULL;
+   if (u_upload_alloc(st->constbuf_uploader, 0, paramBytes,
+                      &cb->buffer_offset, &cb->buffer,
+                      (void **) &map) != PIPE_OK)
+      return FALSE;
+
+   for (i = 0; i < num_ranges; i++) {
+      memcpy(map + ranges[i][0] * vec4,
+             params->ParameterValues + ranges[i][0],
+             (ranges[i][1] - ranges[i][0]) * vec4);
+   }
+   u_upload_unmap(st->constbuf_uploader);
+
+   /* Copy the unchanged values in between from the previous buffer. */
+   pos = 0;
+   for (i = 0; i <= num_ranges; i++) {
+      const unsigned end = i < num_ranges ? ranges[i][0] : num;
+
+      if (end > pos) {
+         struct pipe_box box;
+
+         u_box_1d(prev_offset + pos * vec4, (end - pos) * vec4, &box);
+         pipe->resource_copy_region(pipe, cb->buffer, 0,
+                                    cb->buffer_offset + pos * vec4, 0, 0,
+                                    prev, 0, &box);
+      }
+      if (i < num_ranges)
+         pos = ranges[i][1];
+   }
+
+   return TRUE;
+}
+
+
 /**
  * Pass the given program parameters to the graphics pipe as a
  * constant buffer.
@@ -78,11 +197,15 @@ void st_upload_constants( struct st_context *st,
        * Let's use a user buffer to avoid an unnecessary copy.
        */
       if (st->constbuf_uploader) {
-         cb.buffer = NULL;
-         cb.user_buffer = NULL;
-         u_upload_data(st->constbuf_uploader, 0, paramBytes,
-                       params->ParameterValues, &cb.buffer_offset, &cb.buffer);
-         u_upload_unmap(st->constbuf_uploader);
+         if (!upload_changed_constants(st, params, shader_type, paramBytes,
+                                       &cb)) {
+            cb.buffer = NULL;
+            cb.user_buffer = NULL;
+            u_upload_data(st->constbuf_uploader, 0, paramBytes,
+                          params->ParameterValues, &cb.buffer_offset,
+                          &cb.buffer);
+            u_upload_unmap(st->constbuf_uploader);
+         }
       } else {
          cb.buffer = NULL;
          cb.user_buffer = params->ParameterValues;
@@ -98,15 +221,21 @@ void st_upload_constants( struct st_context *st,
       }
 
       cso_set_constant_buffer(st->cso_context, shader_type, 0, &cb);
-      pipe_resource_reference(&cb.buffer, NULL);
 
       st->state.constants[shader_type].ptr = params->ParameterValues;
       st->state.constants[shader_type].size = paramBytes;
+      st->state.constants[shader_type].offset = cb.buffer_offset;
+      pipe_resource_reference(&st->state.constants[shader_type].buffer,
+                              NULL);
+      st->state.constants[shader_type].buffer = cb.buffer;
+      params->DirtyEnd = 0;
    }
    else if (st->state.constants[shader_type].ptr) {
       /* Unbind. */
       st->state.constants[shader_type].ptr = NULL;
       st->state.constants[shader_type].size = 0;
+      pipe_resource_reference(&st->state.constants[shader_type].buffer,
+                              NULL);
       cso_set_constant_buffer(st->cso_context, shader_type, 0, NULL);
    }
 }
@@ -194,6 +323,7 @@ static void st_bind_ubos(struct st_context *st,
 
       binding = &st->ctx->UniformBufferBindings[shader->UniformBlocks[i].Binding];
       st_obj = st_buffer_object(binding->BufferObject);
+      st_bufferobj_sync(st, st_obj);
 
       cb.buffer = st_obj->buffer;
 
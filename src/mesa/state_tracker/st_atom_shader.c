@@ -82,12 +82,12 @@ update_fp( struct st_context *st )
    stfp = st_fragment_program(st->ctx->FragmentProgram._Current);
    assert(stfp->Base.Base.Target == GL_FRAGMENT_PROGRAM_ARB);
 
-   memset(&key, 0, sizeof(key));
-   key.st = st;
-
    /* _NEW_FRAG_CLAMP */
-   key.clamp_color = st->clamp_frag_color_in_shader &&
-                     st->ctx->Color._ClampFragmentColor;
+   st_make_fp_variant_key(st, &key);
+
+   /* _NEW_PROGRAM_CONSTANTS, see st_init_atoms() */
+   key.uniform_hash = st_specialized_uniform_hash(&stfp->specialized,
+                                                  stfp->Base.Base.Parameters);
 
    st->fp_variant = st_get_fp_variant(st, stfp, &key);
 
@@ -133,22 +133,12 @@ update_vp( struct st_context *st )
    stvp = st_vertex_program(st->ctx->VertexProgram._Current);
    assert(stvp->Base.Base.Target == GL_VERTEX_PROGRAM_ARB);
 
-   memset(&key, 0, sizeof key);
-   key.st = st;  /* variants are per-context */
-
-   /* When this is true, we will add an extra input to the vertex
-    * shader translation (for edgeflags), an extra output with
-    * edgeflag semantics, and extend the vertex shader to pass through
-    * the input to the output.  We'll need to use similar logic to set
-    * up the extra vertex_element input for edgeflags.
-    * _NEW_POLYGON, ST_NEW_EDGEFLAGS_DATA
-    */
-   key.passthrough_edgeflags = (st->vertdata_edgeflags && (
-                                st->ctx->Polygon.FrontMode != GL_FILL ||
-                                st->ctx->Polygon.BackMode != GL_FILL));
+   /* _NEW_POLYGON, ST_NEW_EDGEFLAGS_DATA */
+   st_make_vp_variant_key(st, &key);
 
-   key.clamp_color = st->clamp_vert_color_in_shader &&
-                     st->ctx->Light._ClampVertexColor;
+   /* _NEW_PROGRAM_CONSTANTS, see st_init_atoms() */
+   key.uniform_hash = st_specialized_uniform_hash(&stvp->specialized,
+                                                  stvp->Base.Base.Parameters);
 
    st->vp_variant = st_get_vp_variant(st, stvp, &key);
 
@@ -186,8 +176,7 @@ update_gp( struct st_context *st )
    stgp = st_geometry_program(st->ctx->GeometryProgram._Current);
    assert(stgp->Base.Base.Target == MESA_GEOMETRY_PROGRAM);
 
-   memset(&key, 0, sizeof(key));
-   key.st = st;
+   st_make_gp_variant_key(st, &key);
 
    st->gp_variant = st_get_gp_variant(st, stgp, &key);
 
@@ -50,6 +50,7 @@
 #include "pipe/p_shader_tokens.h"
 #include "util/u_inlines.h"
 #include "util/u_draw_quad.h"
+#include "util/u_hash.h"
 #include "util/u_simple_shaders.h"
 #include "util/u_upload_mgr.h"
 #include "program/prog_instruction.h"
@@ -70,41 +71,52 @@
 
 
 /**
- * The bitmap cache attempts to accumulate multiple glBitmap calls in a
- * buffer which is then rendered en mass upon a flush, state change, etc.
- * A wide, short buffer is used to target the common case of a series
- * of glBitmap calls being used to draw text.
+ * The bitmap cache keeps the images of small glBitmap calls, typically
+ * the glyphs of text, in a persistent atlas texture, found again by
+ * their contents.  The calls are queued as quads into the atlas and
+ * drawn en mass upon a flush, state change, color change, etc.
  */
 static GLboolean UseBitmapCache = GL_TRUE;
 
 
-#define BITMAP_CACHE_WIDTH  512
-#define BITMAP_CACHE_HEIGHT 32
+#define BITMAP_ATLAS_SIZE  512
+#define BITMAP_GLYPH_MAX   64    /**< max width and height of a cached bitmap */
+#define BITMAP_HASH_SIZE   256
+#define BITMAP_MAX_QUADS   256
 
-struct bitmap_cache
+/** A bitmap image in the atlas */
+struct bitmap_glyph
 {
-   /** Window pos to render the cached image */
-   GLint xpos, ypos;
-   /** Bounds of region used in window coords */
-   GLint xmin, ymin, xmax, ymax;
-
-   GLfloat color[4];
-
-   /** Bitmap's Z position */
-   GLfloat zpos;
+   struct bitmap_glyph *next;   /**< in the hash chain */
+   uint32_t hash;
+   GLuint width, height;
+   GLuint x, y;                 /**< position in the atlas */
+   ubyte bits[1];               /**< width * height texels, as in the atlas */
+};
 
+struct bitmap_cache
+{
+   /** I8 atlas of the glyphs, and a sampler view of it */
    struct pipe_resource *texture;
-   struct pipe_transfer *trans;
+   struct pipe_sampler_view *view;
 
-   GLboolean empty;
+   /** Atlas space is handed out in shelves, left to right */
+   GLuint shelf_x, shelf_y, shelf_height;
 
-   /** An I8 texture image: */
-   ubyte *buffer;
-};
+   struct bitmap_glyph *glyphs[BITMAP_HASH_SIZE];
 
-
-/** Epsilon for Z comparisons */
-#define Z_EPSILON 1e-06
+   /** Queued glBitmap calls, all with this color */
+   GLfloat color[4];
+   GLuint num_quads;
+   struct {
+      GLint x, y;
+      GLfloat z;
+      const struct bitmap_glyph *glyph;
+   } quads[BITMAP_MAX_QUADS];
+
+   /** The image of the bitmap being looked up */
+   ubyte scratch[BITMAP_GLYPH_MAX * BITMAP_GLYPH_MAX];
+};
 
 
 /**
@@ -395,22 +407,21 @@ setup_bitmap_vertex_data(struct st_context *st, bool normalized,
 
 
 /**
- * Render a glBitmap by drawing a textured quad
+ * Render glBitmaps by drawing textured primitives from the given vertex
+ * buffer, which have the layout of setup_bitmap_vertex_data().
  */
 static void
-draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
-                 GLsizei width, GLsizei height,
-                 struct pipe_sampler_view *sv,
-                 const GLfloat *color)
+draw_bitmap_vertices(struct gl_context *ctx,
+                     struct pipe_sampler_view *sv,
+                     const GLfloat *color,
+                     struct pipe_resource *vbuf, unsigned offset,
+                     unsigned prim, unsigned num_verts)
 {
    struct st_context *st = st_context(ctx);
    struct pipe_context *pipe = st->pipe;
    struct cso_context *cso = st->cso_context;
    struct st_fp_variant *fpv;
    struct st_fp_variant_key key;
-   GLuint maxSize;
-   GLuint offset;
-   struct pipe_resource *vbuf = NULL;
 
    memset(&key, 0, sizeof(key));
    key.st = st;
@@ -435,16 +446,6 @@ draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
       COPY_4V(ctx->Current.Attrib[VERT_ATTRIB_COLOR0], colorSave);
    }
 
-
-   /* limit checks */
-   /* XXX if the bitmap is larger than the max texture size, break
-    * it up into chunks.
-    */
-   maxSize = 1 << (pipe->screen->get_param(pipe->screen,
-                                    PIPE_CAP_MAX_TEXTURE_2D_LEVELS) - 1);
-   assert(width <= (GLsizei)maxSize);
-   assert(height <= (GLsizei)maxSize);
-
    cso_save_rasterizer(cso);
    cso_save_samplers(cso, PIPE_SHADER_FRAGMENT);
    cso_save_sampler_views(cso, PIPE_SHADER_FRAGMENT);
@@ -515,21 +516,12 @@ draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
    cso_set_vertex_elements(cso, 3, st->velems_util_draw);
    cso_set_stream_outputs(st->cso_context, 0, NULL, 0);
 
-   /* convert Z from [0,1] to [-1,-1] to match viewport Z scale/bias */
-   z = z * 2.0f - 1.0f;
-
-   /* draw textured quad */
-   setup_bitmap_vertex_data(st, sv->texture->target != PIPE_TEXTURE_RECT,
-			    x, y, width, height, z, color, &vbuf, &offset);
-
-   if (vbuf) {
-      util_draw_vertex_buffer(pipe, st->cso_context, vbuf,
-                              cso_get_aux_vertex_buffer_slot(st->cso_context),
-                              offset,
-                              PIPE_PRIM_TRIANGLE_FAN,
-                              4,  /* verts */
-                              3); /* attribs/vert */
-   }
+   util_draw_vertex_buffer(pipe, st->cso_context, vbuf,
+                           cso_get_aux_vertex_buffer_slot(st->cso_context),
+                           offset,
+                           prim,
+                           num_verts,
+                           3); /* attribs/vert */
 
    /* restore state */
    cso_restore_rasterizer(cso);
@@ -542,134 +534,250 @@ draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
    cso_restore_vertex_elements(cso);
    cso_restore_aux_vertex_buffer_slot(cso);
    cso_restore_stream_outputs(cso);
+}
+
+
+/**
+ * Render a glBitmap by drawing a textured quad
+ */
+static void
+draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
+                 GLsizei width, GLsizei height,
+                 struct pipe_sampler_view *sv,
+                 const GLfloat *color)
+{
+   struct st_context *st = st_context(ctx);
+   struct pipe_context *pipe = st->pipe;
+   GLuint maxSize;
+   GLuint offset;
+   struct pipe_resource *vbuf = NULL;
+
+   /* limit checks */
+   /* XXX if the bitmap is larger than the max texture size, break
+    * it up into chunks.
+    */
+   maxSize = 1 << (pipe->screen->get_param(pipe->screen,
+                                    PIPE_CAP_MAX_TEXTURE_2D_LEVELS) - 1);
+   assert(width <= (GLsizei)maxSize);
+   assert(height <= (GLsizei)maxSize);
+
+   /* convert Z from [0,1] to [-1,-1] to match viewport Z scale/bias */
+   z = z * 2.0f - 1.0f;
+
+   /* draw textured quad */
+   setup_bitmap_vertex_data(st, sv->texture->target != PIPE_TEXTURE_RECT,
+			    x, y, width, height, z, color, &vbuf, &offset);
+
+   if (vbuf) {
+      draw_bitmap_vertices(ctx, sv, color, vbuf, offset,
+                           PIPE_PRIM_TRIANGLE_FAN, 4);
+   }
 
    pipe_resource_reference(&vbuf, NULL);
 }
 
 
+/**
+ * Free the glyphs and start over with a new, blank atlas texture.  Any
+ * queued quads must have been drawn.
+ */
 static void
 reset_cache(struct st_context *st)
 {
+   struct pipe_context *pipe = st->pipe;
    struct bitmap_cache *cache = st->bitmap.cache;
+   struct pipe_transfer *transfer;
+   ubyte *dest;
+   GLuint i;
+
+   assert(cache->num_quads == 0);
+
+   for (i = 0; i < BITMAP_HASH_SIZE; i++) {
+      struct bitmap_glyph *glyph = cache->glyphs[i];
 
-   /*memset(cache->buffer, 0xff, sizeof(cache->buffer));*/
-   cache->empty = GL_TRUE;
+      while (glyph) {
+         struct bitmap_glyph *next = glyph->next;
+         free(glyph);
+         glyph = next;
+      }
+      cache->glyphs[i] = NULL;
+   }
 
-   cache->xmin = 1000000;
-   cache->xmax = -1000000;
-   cache->ymin = 1000000;
-   cache->ymax = -1000000;
+   cache->shelf_x = 0;
+   cache->shelf_y = 0;
+   cache->shelf_height = 0;
 
-   assert(!cache->texture);
+   /* Draws still in flight keep the old texture alive, so glyphs can be
+    * written into the new one without synchronization.
+    */
+   pipe_sampler_view_reference(&cache->view, NULL);
+   pipe_resource_reference(&cache->texture, NULL);
 
-   /* allocate a new texture */
    cache->texture = st_texture_create(st, PIPE_TEXTURE_2D,
                                       st->bitmap.tex_format, 0,
-                                      BITMAP_CACHE_WIDTH, BITMAP_CACHE_HEIGHT,
+                                      BITMAP_ATLAS_SIZE, BITMAP_ATLAS_SIZE,
                                       1, 1, 0,
 				      PIPE_BIND_SAMPLER_VIEW);
-}
-
+   if (!cache->texture)
+      return;
 
-/** Print bitmap image to stdout (debug) */
-static void
-print_cache(const struct bitmap_cache *cache)
-{
-   int i, j, k;
-
-   for (i = 0; i < BITMAP_CACHE_HEIGHT; i++) {
-      k = BITMAP_CACHE_WIDTH * (BITMAP_CACHE_HEIGHT - i - 1);
-      for (j = 0; j < BITMAP_CACHE_WIDTH; j++) {
-         if (cache->buffer[k])
-            printf("X");
-         else
-            printf(" ");
-         k++;
-      }
-      printf("\n");
+   /* init image to all 0xff, "off" */
+   dest = pipe_transfer_map(pipe, cache->texture, 0, 0,
+                            PIPE_TRANSFER_WRITE, 0, 0,
+                            BITMAP_ATLAS_SIZE, BITMAP_ATLAS_SIZE, &transfer);
+   if (dest) {
+      memset(dest, 0xff, transfer->stride * BITMAP_ATLAS_SIZE);
+      pipe_transfer_unmap(pipe, transfer);
    }
+
+   cache->view = st_create_texture_sampler_view(pipe, cache->texture);
 }
 
 
 /**
- * Create gallium pipe_transfer object for the bitmap cache.
+ * Write the vertices of a glBitmap quad from the atlas for
+ * PIPE_PRIM_TRIANGLES, in the layout of setup_bitmap_vertex_data().
  */
 static void
-create_cache_trans(struct st_context *st)
+emit_atlas_quad(struct st_context *st, float (*vertices)[3][4],
+                GLint x, GLint y, GLfloat z,
+                const struct bitmap_glyph *glyph, const GLfloat color[4])
 {
-   struct pipe_context *pipe = st->pipe;
-   struct bitmap_cache *cache = st->bitmap.cache;
+   static const unsigned corners[6] = { 0, 1, 2, 0, 2, 3 };
+   const GLfloat fb_width = (GLfloat)st->state.framebuffer.width;
+   const GLfloat fb_height = (GLfloat)st->state.framebuffer.height;
+   const GLfloat scale = 1.0f / BITMAP_ATLAS_SIZE;
+   GLfloat pos[4][2], tex[4][2];
+   GLuint i;
 
-   if (cache->trans)
-      return;
+   pos[0][0] = pos[3][0] = (GLfloat)x / fb_width * 2.0f - 1.0f;
+   pos[1][0] = pos[2][0] = (GLfloat)(x + glyph->width) / fb_width * 2.0f - 1.0f;
+   pos[0][1] = pos[1][1] = (GLfloat)y / fb_height * 2.0f - 1.0f;
+   pos[2][1] = pos[3][1] = (GLfloat)(y + glyph->height) / fb_height * 2.0f - 1.0f;
 
-   /* Map the texture transfer.
-    * Subsequent glBitmap calls will write into the texture image.
-    */
-   cache->buffer = pipe_transfer_map(pipe, cache->texture, 0, 0,
-                                     PIPE_TRANSFER_WRITE, 0, 0,
-                                     BITMAP_CACHE_WIDTH,
-                                     BITMAP_CACHE_HEIGHT, &cache->trans);
+   tex[0][0] = tex[3][0] = glyph->x * scale;
+   tex[1][0] = tex[2][0] = (glyph->x + glyph->width) * scale;
+   tex[0][1] = tex[1][1] = glyph->y * scale;
+   tex[2][1] = tex[3][1] = (glyph->y + glyph->height) * scale;
 
-   /* init image to all 0xff */
-   memset(cache->buffer, 0xff, cache->trans->stride * BITMAP_CACHE_HEIGHT);
+   for (i = 0; i < 6; i++) {
+      const unsigned c = corners[i];
+
+      vertices[i][0][0] = pos[c][0];
+      vertices[i][0][1] = pos[c][1];
+      vertices[i][0][2] = z;
+      vertices[i][0][3] = 1.0f;
+      vertices[i][1][0] = color[0];
+      vertices[i][1][1] = color[1];
+      vertices[i][1][2] = color[2];
+      vertices[i][1][3] = color[3];
+      vertices[i][2][0] = tex[c][0];
+      vertices[i][2][1] = tex[c][1];
+      vertices[i][2][2] = 0.0f; /*R*/
+      vertices[i][2][3] = 1.0f; /*Q*/
+   }
 }
 
 
 /**
- * If there's anything in the bitmap cache, draw/flush it now.
+ * If there are queued glBitmap calls, draw them now.
  */
 void
 st_flush_bitmap_cache(struct st_context *st)
 {
-   if (!st->bitmap.cache->empty) {
-      struct bitmap_cache *cache = st->bitmap.cache;
-
-      struct pipe_context *pipe = st->pipe;
-      struct pipe_sampler_view *sv;
-
-      assert(cache->xmin <= cache->xmax);
-
-/*    printf("flush size %d x %d  at %d, %d\n",
-             cache->xmax - cache->xmin,
-             cache->ymax - cache->ymin,
-             cache->xpos, cache->ypos);
-*/
-
-      /* The texture transfer has been mapped until now.
-          * So unmap and release the texture transfer before drawing.
-          */
-      if (cache->trans && cache->buffer) {
-         if (0)
-            print_cache(cache);
-         pipe_transfer_unmap(pipe, cache->trans);
-         cache->buffer = NULL;
-         cache->trans = NULL;
-      }
+   struct bitmap_cache *cache = st->bitmap.cache;
+   struct pipe_resource *vbuf = NULL;
+   float (*vertices)[3][4];
+   unsigned offset;
+   GLuint i;
 
-      sv = st_create_texture_sampler_view(st->pipe, cache->texture);
-      if (sv) {
-         draw_bitmap_quad(st->ctx,
-                          cache->xpos,
-                          cache->ypos,
-                          cache->zpos,
-                          BITMAP_CACHE_WIDTH, BITMAP_CACHE_HEIGHT,
-                          sv,
-                          cache->color);
+   if (!cache->num_quads)
+      return;
 
-         pipe_sampler_view_reference(&sv, NULL);
+   if (u_upload_alloc(st->uploader, 0,
+                      cache->num_quads * 6 * sizeof(vertices[0]),
+                      &offset, &vbuf, (void **) &vertices) == PIPE_OK) {
+      for (i = 0; i < cache->num_quads; i++) {
+         emit_atlas_quad(st, vertices + i * 6,
+                         cache->quads[i].x, cache->quads[i].y,
+                         cache->quads[i].z, cache->quads[i].glyph,
+                         cache->color);
       }
+      u_upload_unmap(st->uploader);
 
-      /* release/free the texture */
-      pipe_resource_reference(&cache->texture, NULL);
+      draw_bitmap_vertices(st->ctx, cache->view, cache->color,
+                           vbuf, offset,
+                           PIPE_PRIM_TRIANGLES, cache->num_quads * 6);
 
-      reset_cache(st);
+      pipe_resource_reference(&vbuf, NULL);
    }
+
+   cache->num_quads = 0;
 }
 
 
 /**
- * Try to accumulate this glBitmap call in the bitmap cache.
+ * Find the glyph with the image in cache->scratch, or put it into the
+ * atlas.
+ * \return  NULL if there's no room left in the atlas
+ */
+static struct bitmap_glyph *
+find_glyph(struct st_context *st, GLuint width, GLuint height)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct bitmap_cache *cache = st->bitmap.cache;
+   const GLuint size = width * height;
+   uint32_t hash = util_hash_crc32(cache->scratch, size) ^
+                   (width << 16) ^ height;
+   struct bitmap_glyph **bucket = &cache->glyphs[hash % BITMAP_HASH_SIZE];
+   struct bitmap_glyph *glyph;
+   struct pipe_box box;
+
+   for (glyph = *bucket; glyph; glyph = glyph->next) {
+      if (glyph->hash == hash &&
+          glyph->width == width && glyph->height == height &&
+          memcmp(glyph->bits, cache->scratch, size) == 0)
+         return glyph;
+   }
+
+   /* Allocate atlas space, keeping a texel of space to the neighbours. */
+   if (cache->shelf_x + width > BITMAP_ATLAS_SIZE) {
+      cache->shelf_x = 0;
+      cache->shelf_y += cache->shelf_height + 1;
+      cache->shelf_height = 0;
+   }
+   if (cache->shelf_y + height > BITMAP_ATLAS_SIZE)
+      return NULL;
+
+   glyph = malloc(sizeof(*glyph) + size);
+   if (!glyph)
+      return NULL;
+
+   glyph->hash = hash;
+   glyph->width = width;
+   glyph->height = height;
+   glyph->x = cache->shelf_x;
+   glyph->y = cache->shelf_y;
+   memcpy(glyph->bits, cache->scratch, size);
+
+   cache->shelf_x += width + 1;
+   cache->shelf_height = MAX2(cache->shelf_height, height);
+
+   /* Nothing has sampled this part of the atlas yet. */
+   u_box_2d(glyph->x, glyph->y, width, height, &box);
+   pipe->transfer_inline_write(pipe, cache->texture, 0,
+                               PIPE_TRANSFER_WRITE |
+                               PIPE_TRANSFER_UNSYNCHRONIZED,
+                               &box, glyph->bits, width, 0);
+
+   glyph->next = *bucket;
+   *bucket = glyph;
+   return glyph;
+}
+
+
+/**
+ * Try to queue this glBitmap call in the bitmap cache.
  * \return  GL_TRUE for success, GL_FALSE if bitmap is too large, etc.
  */
 static GLboolean
@@ -680,65 +788,56 @@ accum_bitmap(struct gl_context *ctx,
 {
    struct st_context *st = ctx->st;
    struct bitmap_cache *cache = st->bitmap.cache;
-   int px = -999, py = -999;
-   const GLfloat z = st->ctx->Current.RasterPos[2];
+   const struct bitmap_glyph *glyph;
 
-   if (width > BITMAP_CACHE_WIDTH ||
-       height > BITMAP_CACHE_HEIGHT)
+   if (width > BITMAP_GLYPH_MAX ||
+       height > BITMAP_GLYPH_MAX)
       return GL_FALSE; /* too big to cache */
 
-   if (!cache->empty) {
-      px = x - cache->xpos;  /* pos in buffer */
-      py = y - cache->ypos;
-      if (px < 0 || px + width > BITMAP_CACHE_WIDTH ||
-          py < 0 || py + height > BITMAP_CACHE_HEIGHT ||
-          !TEST_EQ_4V(st->ctx->Current.RasterColor, cache->color) ||
-          ((fabs(z - cache->zpos) > Z_EPSILON))) {
-         /* This bitmap would extend beyond cache bounds, or the bitmap
-          * color is changing
-          * so flush and continue.
-          */
-         st_flush_bitmap_cache(st);
-      }
-   }
-
-   if (cache->empty) {
-      /* Initialize.  Center bitmap vertically in the buffer. */
-      px = 0;
-      py = (BITMAP_CACHE_HEIGHT - height) / 2;
-      cache->xpos = x;
-      cache->ypos = y - py;
-      cache->zpos = z;
-      cache->empty = GL_FALSE;
-      COPY_4FV(cache->color, st->ctx->Current.RasterColor);
+   if (cache->num_quads &&
+       (cache->num_quads == BITMAP_MAX_QUADS ||
+        !TEST_EQ_4V(st->ctx->Current.RasterColor, cache->color))) {
+      /* The queue is full or the bitmap color is changing,
+       * so flush and continue.
+       */
+      st_flush_bitmap_cache(st);
    }
 
-   assert(px != -999);
-   assert(py != -999);
-
-   if (x < cache->xmin)
-      cache->xmin = x;
-   if (y < cache->ymin)
-      cache->ymin = y;
-   if (x + width > cache->xmax)
-      cache->xmax = x + width;
-   if (y + height > cache->ymax)
-      cache->ymax = y + height;
-
-   /* create the transfer if needed */
-   create_cache_trans(st);
-
    /* PBO source... */
    bitmap = _mesa_map_pbo_source(ctx, unpack, bitmap);
    if (!bitmap) {
       return FALSE;
    }
 
-   unpack_bitmap(st, px, py, width, height, unpack, bitmap,
-                 cache->buffer, BITMAP_CACHE_WIDTH);
+   memset(cache->scratch, 0xff, width * height);
+   unpack_bitmap(st, 0, 0, width, height, unpack, bitmap,
+                 cache->scratch, width);
 
    _mesa_unmap_pbo_source(ctx, unpack);
 
+   glyph = cache->texture ? find_glyph(st, width, height) : NULL;
+   if (!glyph) {
+      /* The atlas is full: draw what uses it and start a new one. */
+      st_flush_bitmap_cache(st);
+      reset_cache(st);
+      if (!cache->texture || !cache->view)
+         return GL_FALSE;
+      glyph = find_glyph(st, width, height);
+      if (!glyph)
+         return GL_FALSE;
+   }
+
+   if (!cache->num_quads)
+      COPY_4FV(cache->color, st->ctx->Current.RasterColor);
+
+   cache->quads[cache->num_quads].x = x;
+   cache->quads[cache->num_quads].y = y;
+   /* convert Z from [0,1] to [-1,-1] to match viewport Z scale/bias */
+   cache->quads[cache->num_quads].z =
+      st->ctx->Current.RasterPos[2] * 2.0f - 1.0f;
+   cache->quads[cache->num_quads].glyph = glyph;
+   cache->num_quads++;
+
    return GL_TRUE; /* accumulated */
 }
 
@@ -775,6 +874,9 @@ st_Bitmap(struct gl_context *ctx, GLint x, GLint y,
    if (UseBitmapCache && accum_bitmap(ctx, x, y, width, height, unpack, bitmap))
       return;
 
+   /* keep the queued bitmaps in order with this one */
+   st_flush_bitmap_cache(st);
+
    pt = make_bitmap_texture(ctx, width, height, unpack, bitmap);
    if (pt) {
       struct pipe_sampler_view *sv =
@@ -861,7 +963,6 @@ st_init_bitmap(struct st_context *st)
 void
 st_destroy_bitmap(struct st_context *st)
 {
-   struct pipe_context *pipe = st->pipe;
    struct bitmap_cache *cache = st->bitmap.cache;
 
    if (st->bitmap.vs) {
@@ -870,10 +971,19 @@ st_destroy_bitmap(struct st_context *st)
    }
 
    if (cache) {
-      if (cache->trans && cache->buffer) {
-         pipe_transfer_unmap(pipe, cache->trans);
+      GLuint i;
+
+      for (i = 0; i < BITMAP_HASH_SIZE; i++) {
+         struct bitmap_glyph *glyph = cache->glyphs[i];
+
+         while (glyph) {
+            struct bitmap_glyph *next = glyph->next;
+            free(glyph);
+            glyph = next;
+         }
       }
-      pipe_resource_reference(&st->bitmap.cache->texture, NULL);
+      pipe_sampler_view_reference(&cache->view, NULL);
+      pipe_resource_reference(&cache->texture, NULL);
       free(st->bitmap.cache);
       st->bitmap.cache = NULL;
    }
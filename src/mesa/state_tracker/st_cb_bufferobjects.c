@@ -35,6 +35,7 @@
 #include "main/mtypes.h"
 #include "main/arrayobj.h"
 #include "main/bufferobj.h"
+#include "main/image.h"
 
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
@@ -42,7 +43,118 @@
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
+#include "util/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_vbuf.h"
+
+
+static void
+discard_readbacks(struct st_buffer_object *st_obj)
+{
+   while (st_obj->readbacks) {
+      struct st_pbo_readback *readback = st_obj->readbacks;
+
+      st_obj->readbacks = readback->next;
+      pipe_resource_reference(&readback->texture, NULL);
+      free(readback);
+   }
+}
+
+
+/**
+ * Queue the pixels of a glReadPixels, which have been blitted to the given
+ * staging texture, to be copied into the buffer later.
+ * \return GL_FALSE if out of memory
+ */
+GLboolean
+st_bufferobj_add_readback(struct st_buffer_object *obj,
+                          struct pipe_resource *texture,
+                          GLsizei width, GLsizei height,
+                          GLenum format, GLenum type,
+                          const struct gl_pixelstore_attrib *pack,
+                          const GLvoid *offset)
+{
+   struct st_pbo_readback *readback = ST_CALLOC_STRUCT(st_pbo_readback);
+   struct st_pbo_readback **tail = &obj->readbacks;
+
+   if (!readback)
+      return GL_FALSE;
+
+   pipe_resource_reference(&readback->texture, texture);
+   readback->pack = *pack;
+   readback->pack.BufferObj = NULL;
+   readback->offset = offset;
+   readback->width = width;
+   readback->height = height;
+   readback->format = format;
+   readback->type = type;
+
+   while (*tail)
+      tail = &(*tail)->next;
+   *tail = readback;
+   return GL_TRUE;
+}
+
+
+/**
+ * Copy the pixels of the pending glReadPixels into the buffer, waiting for
+ * the blits if necessary.
+ * \param usage  extra PIPE_TRANSFER_x flags for mapping the textures
+ * \return GL_FALSE if PIPE_TRANSFER_DONTBLOCK was given and a blit was
+ *         still busy
+ */
+GLboolean
+st_bufferobj_finish_readbacks(struct st_context *st,
+                              struct st_buffer_object *obj,
+                              unsigned usage)
+{
+   struct pipe_context *pipe = st->pipe;
+
+   while (obj->readbacks) {
+      struct st_pbo_readback *readback = obj->readbacks;
+      struct pipe_transfer *tex_xfer, *buf_xfer;
+      ubyte *map, *dest;
+
+      map = pipe_transfer_map(pipe, readback->texture, 0, 0,
+                              PIPE_TRANSFER_READ | usage, 0, 0,
+                              readback->width, readback->height, &tex_xfer);
+      if (!map && (usage & PIPE_TRANSFER_DONTBLOCK))
+         return GL_FALSE;
+
+      dest = map && obj->buffer ?
+         pipe_buffer_map(pipe, obj->buffer, PIPE_TRANSFER_WRITE, &buf_xfer) :
+         NULL;
+
+      if (dest) {
+         const uint bytesPerRow = readback->width *
+            util_format_get_blocksize(readback->texture->format);
+         GLint row;
+
+         for (row = 0; row < readback->height; row++) {
+            GLvoid *row_dest =
+               _mesa_image_address2d(&readback->pack,
+                                     dest + (uintptr_t) readback->offset,
+                                     readback->width, readback->height,
+                                     readback->format, readback->type,
+                                     row, 0);
+            memcpy(row_dest, map, bytesPerRow);
+            map += tex_xfer->stride;
+         }
+
+         pipe_buffer_unmap(pipe, buf_xfer);
+         u_vbuf_resource_written(obj->buffer);
+      }
+
+      if (map)
+         pipe_transfer_unmap(pipe, tex_xfer);
+
+      obj->readbacks = readback->next;
+      pipe_resource_reference(&readback->texture, NULL);
+      free(readback);
+   }
+
+   return GL_TRUE;
+}
 
 
 /**
@@ -78,6 +190,8 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
    assert(obj->RefCount == 0);
    assert(st_obj->transfer == NULL);
 
+   discard_readbacks(st_obj);
+
    if (st_obj->buffer)
       pipe_resource_reference(&st_obj->buffer, NULL);
 
@@ -122,6 +236,8 @@ st_bufferobj_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_bufferobj_sync(st_context(ctx), st_obj);
+
    /* Now that transfers are per-context, we don't have to figure out
     * flushing here.  Usually drivers won't need to flush in this case
     * even if the buffer is currently referenced by hardware - they
@@ -131,6 +247,7 @@ st_bufferobj_subdata(struct gl_context *ctx,
    pipe_buffer_write(st_context(ctx)->pipe,
 		     st_obj->buffer,
 		     offset, size, data);
+   u_vbuf_resource_written(st_obj->buffer);
 }
 
 
@@ -158,6 +275,8 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_bufferobj_sync(st_context(ctx), st_obj);
+
    pipe_buffer_read(st_context(ctx)->pipe, st_obj->buffer,
                     offset, size, data);
 }
@@ -183,6 +302,9 @@ st_bufferobj_data(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    unsigned bind, pipe_usage;
 
+   /* The old contents are gone, pending readbacks included. */
+   discard_readbacks(st_obj);
+
    if (size && data && st_obj->buffer &&
        st_obj->Base.Size == size && st_obj->Base.Usage == usage) {
       /* Just discard the old contents and write new data.
@@ -195,6 +317,7 @@ st_bufferobj_data(struct gl_context *ctx,
       pipe->transfer_inline_write(pipe, st_obj->buffer, 0,
                                   PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
                                   &box, data, 0, 0);
+      u_vbuf_resource_written(st_obj->buffer);
       return GL_TRUE;
    }
 
@@ -317,6 +440,13 @@ st_bufferobj_map_range(struct gl_context *ctx,
    assert(offset < obj->Size);
    assert(offset + length <= obj->Size);
 
+   if (st_obj->readbacks &&
+       !(access & GL_MAP_INVALIDATE_BUFFER_BIT) &&
+       !st_bufferobj_finish_readbacks(st_context(ctx), st_obj,
+                                      flags & PIPE_TRANSFER_DONTBLOCK))
+      return NULL;
+   discard_readbacks(st_obj);
+
    obj->Pointer = pipe_buffer_map_range(pipe,
                                         st_obj->buffer,
                                         offset, length,
@@ -326,6 +456,9 @@ st_bufferobj_map_range(struct gl_context *ctx,
       obj->Offset = offset;
       obj->Length = length;
       obj->AccessFlags = access;
+
+      if (flags & PIPE_TRANSFER_WRITE)
+         u_vbuf_resource_written(st_obj->buffer);
    }
    else {
       st_obj->transfer = NULL;
@@ -399,10 +532,14 @@ st_copy_buffer_subdata(struct gl_context *ctx,
    assert(!src->Pointer);
    assert(!dst->Pointer);
 
+   st_bufferobj_sync(st_context(ctx), srcObj);
+   st_bufferobj_sync(st_context(ctx), dstObj);
+
    u_box_1d(readOffset, size, &box);
 
    pipe->resource_copy_region(pipe, dstObj->buffer, 0, writeOffset, 0, 0,
                               srcObj->buffer, 0, &box);
+   u_vbuf_resource_written(dstObj->buffer);
 }
 
 
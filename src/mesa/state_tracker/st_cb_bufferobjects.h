@@ -35,6 +35,22 @@ struct dd_function_table;
 struct pipe_resource;
 struct st_context;
 
+/**
+ * A glReadPixels into a pixel pack buffer whose pixels are still in a
+ * staging texture, in the final format.  They are copied into the
+ * buffer when it's used next, so that the read back is pipelined with
+ * the rendering.
+ */
+struct st_pbo_readback
+{
+   struct st_pbo_readback *next;
+   struct pipe_resource *texture;
+   struct gl_pixelstore_attrib pack;   /**< with BufferObj cleared */
+   const GLvoid *offset;               /**< the pixels pointer */
+   GLsizei width, height;
+   GLenum format, type;
+};
+
 /**
  * State_tracker vertex/pixel buffer object, derived from Mesa's
  * gl_buffer_object.
@@ -44,6 +60,7 @@ struct st_buffer_object
    struct gl_buffer_object Base;
    struct pipe_resource *buffer;     /* GPU storage */
    struct pipe_transfer *transfer; /* In-progress map information */
+   struct st_pbo_readback *readbacks; /* Pending, oldest first */
 };
 
 
@@ -55,6 +72,32 @@ st_buffer_object(struct gl_buffer_object *obj)
 }
 
 
+extern GLboolean
+st_bufferobj_add_readback(struct st_buffer_object *obj,
+                          struct pipe_resource *texture,
+                          GLsizei width, GLsizei height,
+                          GLenum format, GLenum type,
+                          const struct gl_pixelstore_attrib *pack,
+                          const GLvoid *offset);
+
+extern GLboolean
+st_bufferobj_finish_readbacks(struct st_context *st,
+                              struct st_buffer_object *obj,
+                              unsigned usage);
+
+
+/**
+ * Copy the pixels of pending glReadPixels into the buffer, before its
+ * contents are used.
+ */
+static INLINE void
+st_bufferobj_sync(struct st_context *st, struct st_buffer_object *obj)
+{
+   if (obj->readbacks)
+      st_bufferobj_finish_readbacks(st, obj, 0);
+}
+
+
 extern void
 st_bufferobj_validate_usage(struct st_context *st,
 			    struct st_buffer_object *obj,
@@ -61,6 +61,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/u_box.h"
 #include "util/u_draw_quad.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
@@ -487,14 +488,17 @@ make_texture(struct st_context *st,
    struct pipe_resource *pt;
    enum pipe_format pipeFormat;
    GLenum baseInternalFormat;
+   GLboolean matching;
 
    /* Choose a pixel format for the temp texture which will hold the
     * image to draw.
     */
-   pipeFormat = st_choose_matching_format(pipe->screen, PIPE_BIND_SAMPLER_VIEW,
+   pipeFormat = st_choose_matching_format(st, PIPE_BIND_SAMPLER_VIEW,
                                           format, type, unpack->SwapBytes);
 
-   if (pipeFormat != PIPE_FORMAT_NONE) {
+   matching = pipeFormat != PIPE_FORMAT_NONE;
+
+   if (matching) {
       mformat = st_pipe_format_to_mesa_format(pipeFormat);
       baseInternalFormat = _mesa_get_format_base_format(mformat);
    }
@@ -510,6 +514,39 @@ make_texture(struct st_context *st,
       mformat = st_pipe_format_to_mesa_format(pipeFormat);
    }
 
+   /* If the pixels are in a PBO and need no conversion, let the driver
+    * copy them straight into the texture.  Pixel transfer is done in a
+    * fragment shader, so it doesn't count here.
+    */
+   if (matching && _mesa_is_bufferobj(unpack->BufferObj)) {
+      const GLbitfield imageTransferStateSave = ctx->_ImageTransferState;
+      GLboolean memcpy_ok;
+
+      ctx->_ImageTransferState = 0x0;
+      memcpy_ok = _mesa_texstore_can_use_memcpy(ctx, baseInternalFormat,
+                                                mformat, format, type,
+                                                unpack);
+      ctx->_ImageTransferState = imageTransferStateSave;
+
+      if (memcpy_ok) {
+         pt = alloc_texture(st, width, height, pipeFormat,
+                            PIPE_BIND_SAMPLER_VIEW);
+         if (!pt)
+            return NULL;
+
+         {
+            struct pipe_box box;
+
+            u_box_2d(0, 0, width, height, &box);
+            if (st_texture_image_data_pbo(st, pt, 0, &box, format, type,
+                                          unpack, pixels))
+               return pt;
+         }
+
+         pipe_resource_reference(&pt, NULL);
+      }
+   }
+
    pixels = _mesa_map_pbo_source(ctx, unpack, pixels);
    if (!pixels)
       return NULL;
@@ -490,6 +490,7 @@ st_validate_attachment(struct gl_context *ctx,
 		       const struct gl_renderbuffer_attachment *att,
 		       unsigned bindings)
 {
+   struct st_context *st = st_context(ctx);
    const struct st_texture_object *stObj = st_texture_object(att->Texture);
    enum pipe_format format;
    gl_format texFormat;
@@ -514,7 +515,7 @@ st_validate_attachment(struct gl_context *ctx,
    if (!ctx->Extensions.EXT_framebuffer_sRGB &&
        _mesa_get_format_color_encoding(texFormat) == GL_SRGB) {
       const gl_format linearFormat = _mesa_get_srgb_format_linear(texFormat);
-      format = st_mesa_format_to_pipe_format(linearFormat);
+      format = st_mesa_format_to_pipe_format(st, linearFormat);
    }
 
    valid = screen->is_format_supported(screen, format,
@@ -46,7 +46,10 @@
 #include "util/u_gen_mipmap.h"
 
 
-/** Check if we have a front color buffer and if it's been drawn to. */
+/**
+ * Check if we have a front color buffer and if it's been drawn to since
+ * it was last displayed.
+ */
 static INLINE GLboolean
 is_front_buffer_dirty(struct st_context *st)
 {
@@ -71,6 +74,13 @@ display_front_buffer(struct st_context *st)
       /* Hook for copying "fake" frontbuffer if necessary:
        */
       st_manager_flush_frontbuffer(st);
+
+      /* Don't display it again on the next flushes (such as the ones of
+       * every context switch) unless it's drawn to again: the framebuffer
+       * atom sets defined when it next binds the buffer for drawing.
+       */
+      strb->defined = GL_FALSE;
+      st->dirty.st |= ST_NEW_FRAMEBUFFER;
    }
 }
 
@@ -118,7 +128,7 @@ static void st_glFlush(struct gl_context *ctx)
     * synchronization issues.  Calling finish() here will just hide
     * problems that need to be fixed elsewhere.
     */
-   st_flush(st, NULL, 0);
+   st_flush(st, NULL, st->releasing ? PIPE_FLUSH_DEFERRED : 0);
 
    if (is_front_buffer_dirty(st)) {
       display_front_buffer(st);
@@ -45,6 +45,7 @@
 #include "st_mesa_to_tgsi.h"
 #include "st_cb_program.h"
 #include "st_glsl_to_tgsi.h"
+#include "st_program_binary.h"
 
 
 
@@ -186,6 +187,7 @@ st_is_program_native(struct gl_context *ctx,
  * Called via ctx->Driver.ProgramStringNotify()
  * Called when the program's text/code is changed.  We have to free
  * all shader variants and corresponding gallium shaders when this happens.
+ * The variant the current state would select is then created right away.
  */
 static GLboolean
 st_program_string_notify( struct gl_context *ctx,
@@ -224,6 +226,9 @@ st_program_string_notify( struct gl_context *ctx,
 	 st->dirty.st |= ST_NEW_VERTEX_PROGRAM;
    }
 
+   /* Translate the most likely variant now rather than on first use. */
+   st_precompile_shader_variant(st, prog);
+
    /* XXX check if program is legal, within limits */
    return GL_TRUE;
 }
@@ -245,4 +250,8 @@ st_init_program_functions(struct dd_function_table *functions)
    functions->NewShader = st_new_shader;
    functions->NewShaderProgram = st_new_shader_program;
    functions->LinkShader = st_link_shader;
+   functions->GetProgramBinary = st_get_program_binary;
+   functions->ProgramBinary = st_program_binary;
+   functions->ShaderIsCached = st_shader_is_cached;
+   functions->LinkCachedProgram = st_link_cached_program;
 }
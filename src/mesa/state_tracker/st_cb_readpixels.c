@@ -25,6 +25,7 @@
  * 
  **************************************************************************/
 
+#include "main/bufferobj.h"
 #include "main/image.h"
 #include "main/pbo.h"
 #include "main/imports.h"
@@ -38,6 +39,7 @@
 #include "st_atom.h"
 #include "st_context.h"
 #include "st_cb_bitmap.h"
+#include "st_cb_bufferobjects.h"
 #include "st_cb_readpixels.h"
 #include "state_tracker/st_cb_texture.h"
 #include "state_tracker/st_format.h"
@@ -52,6 +54,11 @@
  *
  * If such a format isn't available, we fall back to _mesa_readpixels.
  *
+ * When reading into a pixel pack buffer, the copy into the buffer is
+ * left until the buffer is used, so that we don't wait for the blit
+ * here.  For that reason PBOs also take this path if the renderbuffer
+ * format already matches.
+ *
  * NOTE: Some drivers use a blit to convert between tiled and linear
  *       texture layouts during texture uploads/downloads, so the blit
  *       we do here should be free in such cases.
@@ -77,6 +84,7 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    unsigned bind = PIPE_BIND_TRANSFER_READ;
    struct pipe_transfer *tex_xfer;
    ubyte *map = NULL;
+   const GLboolean is_pbo = _mesa_is_bufferobj(pack->BufferObj);
 
    /* Validate state (to be sure we have up-to-date framebuffer surfaces)
     * and flush the bitmap cache prior to reading. */
@@ -114,7 +122,8 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    /* See if the texture format already matches the format and type,
     * in which case the memcpy-based fast path will likely be used and
     * we don't have to blit. */
-   if (_mesa_format_matches_format_and_type(rb->Format, format,
+   if (!is_pbo &&
+       _mesa_format_matches_format_and_type(rb->Format, format,
                                             type, pack->SwapBytes)) {
       goto fallback;
    }
@@ -143,7 +152,7 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
 
    /* Choose the destination format by finding the best match
     * for the format+type combo. */
-   dst_format = st_choose_matching_format(screen, bind, format, type,
+   dst_format = st_choose_matching_format(st, bind, format, type,
                                           pack->SwapBytes);
    if (dst_format == PIPE_FORMAT_NONE) {
       goto fallback;
@@ -192,6 +201,17 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    /* blit */
    st->pipe->blit(st->pipe, &blit);
 
+   if (is_pbo &&
+       st_bufferobj_add_readback(st_buffer_object(pack->BufferObj), dst,
+                                 width, height, format, type, pack, pixels)) {
+      pipe_resource_reference(&dst, NULL);
+
+      /* Make the atoms which bind buffers copy the pixels in. */
+      st->dirty.st |= ST_NEW_VERTEX_ARRAYS | ST_NEW_UNIFORM_BUFFER;
+      st->dirty.mesa |= _NEW_TEXTURE;
+      return;
+   }
+
    /* map resources */
    pixels = _mesa_map_pbo_dest(ctx, pack, pixels);
 
@@ -37,6 +37,7 @@
 #include "main/pbo.h"
 #include "main/pixeltransfer.h"
 #include "main/texcompress.h"
+#include "main/texcompress_etc.h"
 #include "main/texgetimage.h"
 #include "main/teximage.h"
 #include "main/texobj.h"
@@ -63,6 +64,7 @@
 #include "util/u_sampler.h"
 #include "util/u_math.h"
 #include "util/u_box.h"
+#include "util/u_queue.h"
 
 #define DBG if (0) printf
 
@@ -182,6 +184,102 @@ st_FreeTextureImageBuffer(struct gl_context *ctx,
 }
 
 
+/**
+ * Whether the image is ETC1 data stored decompressed because the driver
+ * can't sample ETC1 (see st_mesa_format_to_pipe_format()).
+ */
+static GLboolean
+etc_fallback(const struct st_context *st, const struct gl_texture_image *img)
+{
+   return img->TexFormat == MESA_FORMAT_ETC1_RGB8 && !st->has_etc1;
+}
+
+
+/** Images at least this big are decoded on the worker threads */
+#define ETC_THREADED_PIXELS (256 * 256)
+#define ETC_MAX_BANDS 16
+
+struct etc_band
+{
+   struct util_queue_fence fence;
+   uint8_t *dst;
+   unsigned dst_stride;
+   const uint8_t *src;
+   unsigned src_stride;
+   unsigned width, height;
+};
+
+
+static void
+etc_decode_band(void *job, unsigned thread_index)
+{
+   struct etc_band *band = (struct etc_band *) job;
+
+   _mesa_etc1_unpack_rgba8888(band->dst, band->dst_stride,
+                              band->src, band->src_stride,
+                              band->width, band->height);
+}
+
+
+/**
+ * Decode ETC1 blocks to RGBA8888.  Big images are split into bands of
+ * block rows, which are decoded on the shared thread pool with the last
+ * band done by the calling thread.
+ */
+static void
+etc_unpack(struct st_context *st,
+           uint8_t *dst, unsigned dst_stride,
+           const uint8_t *src, unsigned src_stride,
+           unsigned width, unsigned height)
+{
+   struct etc_band bands[ETC_MAX_BANDS];
+   const unsigned block_rows = (height + 3) / 4;
+   unsigned num_bands = 1, band_rows, i;
+
+   if (width * height >= ETC_THREADED_PIXELS) {
+      if (!st->decode_queue)
+         st->decode_queue = util_queue_ref_shared();
+      if (st->decode_queue)
+         num_bands = MIN3(util_queue_num_threads(st->decode_queue) + 1,
+                          ETC_MAX_BANDS, block_rows);
+   }
+
+   if (num_bands <= 1) {
+      _mesa_etc1_unpack_rgba8888(dst, dst_stride, src, src_stride,
+                                 width, height);
+      return;
+   }
+
+   band_rows = (block_rows + num_bands - 1) / num_bands;
+   num_bands = (block_rows + band_rows - 1) / band_rows;
+
+   for (i = 0; i < num_bands; i++) {
+      struct etc_band *band = &bands[i];
+      unsigned y = i * band_rows * 4;
+
+      band->dst = dst + y * dst_stride;
+      band->dst_stride = dst_stride;
+      band->src = src + i * band_rows * src_stride;
+      band->src_stride = src_stride;
+      band->width = width;
+      band->height = MIN2(band_rows * 4, height - y);
+
+      if (i < num_bands - 1) {
+         util_queue_fence_init(&band->fence);
+         util_queue_add_job(st->decode_queue, band, &band->fence,
+                            etc_decode_band, UTIL_QUEUE_PRIORITY_HIGH);
+      }
+   }
+
+   etc_decode_band(&bands[num_bands - 1], 0);
+
+   for (i = 0; i < num_bands - 1; i++) {
+      util_queue_fence_wait(&bands[i].fence);
+      util_queue_fence_destroy(&bands[i].fence);
+   }
+}
+
+
 /** called via ctx->Driver.MapTextureImage() */
 static void
 st_MapTextureImage(struct gl_context *ctx,
@@ -204,7 +302,28 @@ st_MapTextureImage(struct gl_context *ctx,
       pipeMode |= PIPE_TRANSFER_DISCARD_RANGE;
 
    map = st_texture_image_map(st, stImage, pipeMode, x, y, slice, w, h, 1);
-   if (map) {
+
+   if (map && etc_fallback(st, texImage)) {
+      /* The compressed data is written to a staging buffer and decoded
+       * into the texture at unmap time.  Like i965, reading back the
+       * compressed data isn't supported.
+       */
+      assert(!(mode & GL_MAP_READ_BIT));
+      stImage->etc_map = map;
+      stImage->etc_data = malloc(_mesa_format_image_size(texImage->TexFormat,
+                                                         w, h, 1));
+      if (stImage->etc_data) {
+         *mapOut = stImage->etc_data;
+         *rowStrideOut = _mesa_format_row_stride(texImage->TexFormat, w);
+      }
+      else {
+         st_texture_image_unmap(st, stImage);
+         stImage->etc_map = NULL;
+         *mapOut = NULL;
+         *rowStrideOut = 0;
+      }
+   }
+   else if (map) {
       *mapOut = map;
       *rowStrideOut = stImage->transfer->stride;
    }
@@ -223,6 +342,19 @@ st_UnmapTextureImage(struct gl_context *ctx,
 {
    struct st_context *st = st_context(ctx);
    struct st_texture_image *stImage  = st_texture_image(texImage);
+
+   if (stImage->etc_data) {
+      struct pipe_transfer *transfer = stImage->transfer;
+
+      etc_unpack(st, stImage->etc_map, transfer->stride, stImage->etc_data,
+                 _mesa_format_row_stride(texImage->TexFormat,
+                                         transfer->box.width),
+                 transfer->box.width, transfer->box.height);
+      free(stImage->etc_data);
+      stImage->etc_data = NULL;
+      stImage->etc_map = NULL;
+   }
+
    st_texture_image_unmap(st, stImage);
 }
 
@@ -396,7 +528,7 @@ guess_and_alloc_texture(struct st_context *st,
    stObj->height0 = height;
    stObj->depth0 = depth;
 
-   fmt = st_mesa_format_to_pipe_format(stImage->base.TexFormat);
+   fmt = st_mesa_format_to_pipe_format(st, stImage->base.TexFormat);
 
    bindings = default_bindings(st, fmt);
 
@@ -447,7 +579,7 @@ st_AllocTextureImageBuffer(struct gl_context *ctx,
    /* Look if the parent texture object has space for this image */
    if (stObj->pt &&
        level <= stObj->pt->last_level &&
-       st_texture_match_image(stObj->pt, texImage)) {
+       st_texture_match_image(st, stObj->pt, texImage)) {
       /* this image will fit in the existing texture object's memory */
       pipe_resource_reference(&stImage->pt, stObj->pt);
       return GL_TRUE;
@@ -470,7 +602,7 @@ st_AllocTextureImageBuffer(struct gl_context *ctx,
    }
 
    if (stObj->pt &&
-       st_texture_match_image(stObj->pt, texImage)) {
+       st_texture_match_image(st, stObj->pt, texImage)) {
       /* The image will live in the object's mipmap memory */
       pipe_resource_reference(&stImage->pt, stObj->pt);
       assert(stImage->pt);
@@ -484,7 +616,7 @@ st_AllocTextureImageBuffer(struct gl_context *ctx,
        * level.
        */
       enum pipe_format format =
-         st_mesa_format_to_pipe_format(texImage->TexFormat);
+         st_mesa_format_to_pipe_format(st, texImage->TexFormat);
       GLuint bindings = default_bindings(st, format);
       GLuint ptWidth, ptHeight, ptDepth, ptLayers;
 
@@ -611,11 +743,34 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    unsigned bind;
    GLubyte *map;
 
-   if (!st->prefer_blit_based_texture_transfer) {
+   if (!dst) {
       goto fallback;
    }
 
-   if (!dst) {
+   /* If the pixels come from a PBO in the format of the texture, have the
+    * driver copy them out of the buffer instead of mapping both. */
+   if (_mesa_is_bufferobj(unpack->BufferObj) &&
+       texImage->_BaseFormat ==
+       _mesa_get_format_base_format(texImage->TexFormat) &&
+       _mesa_texstore_can_use_memcpy(ctx, texImage->_BaseFormat,
+                                     texImage->TexFormat, format, type,
+                                     unpack)) {
+      struct pipe_box box;
+
+      if (gl_target == GL_TEXTURE_1D_ARRAY)
+         u_box_3d(xoffset, 0, yoffset, width, 1, height, &box);
+      else
+         u_box_3d(xoffset, yoffset, zoffset + texImage->Face,
+                  width, height, depth, &box);
+
+      if (st_texture_image_data_pbo(st, dst,
+                                    stObj->pt != stImage->pt ? 0 :
+                                    texImage->Level,
+                                    &box, format, type, unpack, pixels))
+         return;
+   }
+
+   if (!st->prefer_blit_based_texture_transfer) {
       goto fallback;
    }
 
@@ -658,7 +813,7 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
    }
 
    /* Choose the source format. */
-   src_format = st_choose_matching_format(screen, PIPE_BIND_SAMPLER_VIEW,
+   src_format = st_choose_matching_format(st, PIPE_BIND_SAMPLER_VIEW,
                                           format, type, unpack->SwapBytes);
    if (!src_format) {
       goto fallback;
@@ -927,7 +1082,7 @@ st_GetTexImage(struct gl_context * ctx,
 
    /* Choose the destination format by finding the best match
     * for the format+type combo. */
-   dst_format = st_choose_matching_format(screen, bind, format, type,
+   dst_format = st_choose_matching_format(st, bind, format, type,
 					  ctx->Pack.SwapBytes);
 
    if (dst_format == PIPE_FORMAT_NONE) {
@@ -1485,6 +1640,8 @@ st_finalize_texture(struct gl_context *ctx,
    if (tObj->Target == GL_TEXTURE_BUFFER) {
       struct st_buffer_object *st_obj = st_buffer_object(tObj->BufferObject);
 
+      st_bufferobj_sync(st, st_obj);
+
       if (st_obj->buffer != stObj->pt) {
          pipe_resource_reference(&stObj->pt, st_obj->buffer);
          pipe_sampler_view_release(st->pipe, &stObj->sampler_view);
@@ -1517,7 +1674,7 @@ st_finalize_texture(struct gl_context *ctx,
    }
 
    /* Find gallium format for the Mesa texture */
-   firstImageFormat = st_mesa_format_to_pipe_format(firstImage->base.TexFormat);
+   firstImageFormat = st_mesa_format_to_pipe_format(st, firstImage->base.TexFormat);
 
    /* Find size of level=0 Gallium mipmap image, plus number of texture layers */
    {
@@ -1635,7 +1792,7 @@ st_AllocTextureStorage(struct gl_context *ctx,
    stObj->depth0 = depth;
    stObj->lastLevel = levels - 1;
 
-   fmt = st_mesa_format_to_pipe_format(texImage->TexFormat);
+   fmt = st_mesa_format_to_pipe_format(st, texImage->TexFormat);
 
    bindings = default_bindings(st, fmt);
 
@@ -1714,7 +1871,7 @@ st_TestProxyTexImage(struct gl_context *ctx, GLenum target,
       memset(&pt, 0, sizeof(pt));
 
       pt.target = gl_target_to_pipe(target);
-      pt.format = st_mesa_format_to_pipe_format(format);
+      pt.format = st_mesa_format_to_pipe_format(st, format);
 
       st_gl_texture_dims_to_pipe_dims(target,
                                       width, height, depth,
@@ -45,6 +45,7 @@
 #include "pipe/p_context.h"
 #include "util/u_draw.h"
 #include "util/u_inlines.h"
+#include "util/u_vbuf.h"
 #include "cso_cache/cso_context.h"
 
 struct st_transform_feedback_object {
@@ -122,6 +123,8 @@ st_begin_transform_feedback(struct gl_context *ctx, GLenum mode,
       struct st_buffer_object *bo = st_buffer_object(sobj->base.Buffers[i]);
 
       if (bo) {
+         st_bufferobj_sync(st, bo);
+
          /* Check whether we need to recreate the target. */
          if (!sobj->targets[i] ||
              sobj->targets[i] == sobj->draw_count ||
@@ -150,12 +153,26 @@ st_begin_transform_feedback(struct gl_context *ctx, GLenum mode,
 }
 
 
+/* The buffers have been written by the draws since Begin or Resume. */
+static void
+st_transform_feedback_written(struct st_transform_feedback_object *sobj)
+{
+   unsigned i;
+
+   for (i = 0; i < sobj->num_targets; i++) {
+      if (sobj->targets[i])
+         u_vbuf_resource_written(sobj->targets[i]->buffer);
+   }
+}
+
+
 static void
 st_pause_transform_feedback(struct gl_context *ctx,
                            struct gl_transform_feedback_object *obj)
 {
    struct st_context *st = st_context(ctx);
    cso_set_stream_outputs(st->cso_context, 0, NULL, 0);
+   st_transform_feedback_written(st_transform_feedback_object(obj));
 }
 
 
@@ -199,6 +216,7 @@ st_end_transform_feedback(struct gl_context *ctx,
          st_transform_feedback_object(obj);
 
    cso_set_stream_outputs(st->cso_context, 0, NULL, 0);
+   st_transform_feedback_written(sobj);
 
    pipe_so_target_reference(&sobj->draw_count,
                             st_transform_feedback_get_draw_target(obj));
@@ -0,0 +1,157 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "os/os_thread.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+
+#include "st_compile_stats.h"
+
+
+static const char *phase_names[ST_COMPILE_NUM_PHASES] = {
+   "lower",
+   "optimize",
+   "visit",
+   "simplify_cmp",
+   "copy_propagate",
+   "dead_code",
+   "reg_alloc",
+   "translate"
+};
+
+static const char *stage_names[MESA_SHADER_TYPES] = {
+   "VS",
+   "GS",
+   "FS"
+};
+
+pipe_static_mutex(totals_mutex);
+static struct st_compile_stats totals;
+static boolean totals_registered = FALSE;
+
+
+void
+st_compile_stats_init(struct st_compile_stats *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+}
+
+
+/**
+ * Account one run of a phase which started at time \p start.
+ */
+void
+st_compile_stats_record(struct st_compile_stats *stats,
+                        unsigned stage, enum st_compile_phase phase,
+                        int64_t start, unsigned iterations,
+                        unsigned instructions)
+{
+   struct st_compile_phase_stats *ps;
+
+   assert(stage < MESA_SHADER_TYPES);
+   assert(phase < ST_COMPILE_NUM_PHASES);
+
+   ps = &stats->phase[stage][phase];
+   ps->time += os_time_get() - start;
+   ps->runs++;
+   ps->iterations += iterations;
+   ps->instructions = instructions;
+}
+
+
+static void
+print_stats(const struct st_compile_stats *stats, boolean totals)
+{
+   unsigned stage, phase;
+
+   for (stage = 0; stage < MESA_SHADER_TYPES; stage++) {
+      int64_t stage_time = 0;
+
+      for (phase = 0; phase < ST_COMPILE_NUM_PHASES; phase++) {
+         const struct st_compile_phase_stats *ps = &stats->phase[stage][phase];
+
+         if (!ps->runs)
+            continue;
+
+         stage_time += ps->time;
+         debug_printf("  %s %-16s %10lld us  %6u runs  %6u iterations",
+                      stage_names[stage], phase_names[phase],
+                      (long long) ps->time, ps->runs, ps->iterations);
+         if (ps->skipped)
+            debug_printf("  %6u skipped passes", ps->skipped);
+         if (totals)
+            debug_printf("\n");
+         else
+            debug_printf("  %6u instructions\n", ps->instructions);
+      }
+
+      if (stage_time)
+         debug_printf("  %s %-16s %10lld us\n", stage_names[stage], "total",
+                      (long long) stage_time);
+   }
+}
+
+
+static void
+print_totals(void)
+{
+   pipe_mutex_lock(totals_mutex);
+   debug_printf("st: compile statistics for the whole run:\n");
+   print_stats(&totals, TRUE);
+   pipe_mutex_unlock(totals_mutex);
+}
+
+
+/**
+ * Print the statistics of one link or translation and add them to the
+ * totals for the whole run.
+ */
+void
+st_compile_stats_report(const struct st_compile_stats *stats,
+                        const char *what, GLuint name)
+{
+   unsigned stage, phase;
+
+   debug_printf("st: compile statistics for %s of program %u:\n", what, name);
+   print_stats(stats, FALSE);
+
+   pipe_mutex_lock(totals_mutex);
+   for (stage = 0; stage < MESA_SHADER_TYPES; stage++) {
+      for (phase = 0; phase < ST_COMPILE_NUM_PHASES; phase++) {
+         const struct st_compile_phase_stats *ps = &stats->phase[stage][phase];
+         struct st_compile_phase_stats *total = &totals.phase[stage][phase];
+
+         total->time += ps->time;
+         total->runs += ps->runs;
+         total->iterations += ps->iterations;
+         total->instructions += ps->instructions;
+         total->skipped += ps->skipped;
+      }
+   }
+   if (!totals_registered) {
+      totals_registered = TRUE;
+      atexit(print_totals);
+   }
+   pipe_mutex_unlock(totals_mutex);
+}
@@ -0,0 +1,96 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Compile-time statistics for GLSL programs, enabled with ST_DEBUG=compile.
+ *
+ * Each link (and each later translation to TGSI) records the wall time,
+ * iteration count and instruction count of its phases, prints them, and
+ * adds them to process-wide totals which are printed at exit.
+ */
+
+#ifndef ST_COMPILE_STATS_H
+#define ST_COMPILE_STATS_H
+
+#include "main/mtypes.h"
+#include "os/os_time.h"
+
+#include "st_debug.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum st_compile_phase {
+   ST_COMPILE_LOWER,          /**< GLSL IR lowering in st_link_shader() */
+   ST_COMPILE_OPTIMIZE,       /**< do_common_optimization() fixed point */
+   ST_COMPILE_VISIT,          /**< GLSL IR to glsl_to_tgsi instructions */
+   ST_COMPILE_SIMPLIFY_CMP,
+   ST_COMPILE_COPY_PROPAGATE,
+   ST_COMPILE_DEAD_CODE,
+   ST_COMPILE_REG_ALLOC,
+   ST_COMPILE_TRANSLATE,      /**< st_translate_program() */
+   ST_COMPILE_NUM_PHASES
+};
+
+struct st_compile_phase_stats {
+   int64_t time;              /**< wall time in microseconds */
+   unsigned runs;             /**< number of times the phase ran */
+   unsigned iterations;       /**< pass iterations of fixed-point loops */
+   unsigned instructions;     /**< instructions after the phase */
+   unsigned skipped;          /**< passes skipped as unable to make progress */
+};
+
+struct st_compile_stats {
+   struct st_compile_phase_stats
+      phase[MESA_SHADER_TYPES][ST_COMPILE_NUM_PHASES];
+};
+
+
+static INLINE boolean
+st_compile_stats_enabled(void)
+{
+   return (ST_DEBUG & DEBUG_COMPILE) != 0;
+}
+
+
+void
+st_compile_stats_init(struct st_compile_stats *stats);
+
+void
+st_compile_stats_record(struct st_compile_stats *stats,
+                        unsigned stage, enum st_compile_phase phase,
+                        int64_t start, unsigned iterations,
+                        unsigned instructions);
+
+void
+st_compile_stats_report(const struct st_compile_stats *stats,
+                        const char *what, GLuint name);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_COMPILE_STATS_H */
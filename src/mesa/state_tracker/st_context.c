@@ -31,11 +31,13 @@
 #include "main/context.h"
 #include "main/samplerobj.h"
 #include "main/shaderobj.h"
+#include "main/shader_queue.h"
 #include "main/version.h"
 #include "main/vtxfmt.h"
 #include "program/prog_cache.h"
 #include "vbo/vbo.h"
 #include "glapi/glapi.h"
+#include "ralloc.h"
 #include "st_context.h"
 #include "st_debug.h"
 #include "st_cb_bitmap.h"
@@ -65,13 +67,18 @@
 #include "st_extensions.h"
 #include "st_gen_mipmap.h"
 #include "st_program.h"
+#include "st_shader_cache.h"
 #include "pipe/p_context.h"
+#include "util/u_counter.h"
 #include "util/u_inlines.h"
+#include "util/u_queue.h"
+#include "util/u_trace.h"
 #include "util/u_upload_mgr.h"
 #include "cso_cache/cso_context.h"
 
 
 DEBUG_GET_ONCE_BOOL_OPTION(mesa_mvp_dp4, "MESA_MVP_DP4", FALSE)
+DEBUG_GET_ONCE_BOOL_OPTION(count_glsl_ir, "ST_COUNT_GLSL_IR", FALSE)
 
 
 /**
@@ -118,6 +125,12 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
 
    /* XXX: this is one-off, per-screen init: */
    st_debug_init();
+
+   /* The GLSL IR lives in ralloc, which counts itself on request. */
+   if (debug_get_option_count_glsl_ir()) {
+      ralloc_enable_total_size();
+      util_counter_set_source(UTIL_COUNTER_MEM_GLSL_IR, ralloc_total_size);
+   }
    
    /* state tracker needs the VBO module */
    _vbo_CreateContext(ctx);
@@ -136,8 +149,9 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
       unsigned alignment =
          screen->get_param(screen, PIPE_CAP_CONSTANT_BUFFER_OFFSET_ALIGNMENT);
 
-      st->constbuf_uploader = u_upload_create(pipe, 128 * 1024, alignment,
-                                              PIPE_BIND_CONSTANT_BUFFER);
+      st->constbuf_uploader = u_upload_create_ring(pipe, 128 * 1024, 4,
+                                                   alignment,
+                                                   PIPE_BIND_CONSTANT_BUFFER);
    }
 
    st->cso_context = cso_create_context(pipe);
@@ -147,6 +161,7 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st_init_clear(st);
    st_init_draw( st );
    st_init_generate_mipmap(st);
+   st_init_shader_cache(st);
 
    if(pipe->screen->get_param(pipe->screen, PIPE_CAP_NPOT_TEXTURES))
       st->internal_target = PIPE_TEXTURE_2D;
@@ -183,6 +198,9 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st->has_stencil_export =
       screen->get_param(screen, PIPE_CAP_SHADER_STENCIL_EXPORT);
    st->has_shader_model3 = screen->get_param(screen, PIPE_CAP_SM3);
+   st->has_etc1 = screen->is_format_supported(screen, PIPE_FORMAT_ETC1_RGB8,
+                                              PIPE_TEXTURE_2D, 0,
+                                              PIPE_BIND_SAMPLER_VIEW);
    st->prefer_blit_based_texture_transfer = screen->get_param(screen,
                               PIPE_CAP_PREFER_BLIT_BASED_TEXTURE_TRANSFER);
 
@@ -252,6 +270,10 @@ static void st_destroy_context_priv( struct st_context *st )
    st_destroy_bitmap(st);
    st_destroy_drawpix(st);
    st_destroy_drawtex(st);
+   st_destroy_shader_cache(st);
+
+   if (st->decode_queue)
+      util_queue_unref_shared(st->decode_queue);
 
    for (shader = 0; shader < Elements(st->state.sampler_views); shader++) {
       for (i = 0; i < Elements(st->state.sampler_views[0]); i++) {
@@ -260,6 +282,10 @@ static void st_destroy_context_priv( struct st_context *st )
       }
    }
 
+   for (shader = 0; shader < Elements(st->state.constants); shader++) {
+      pipe_resource_reference(&st->state.constants[shader].buffer, NULL);
+   }
+
    if (st->default_texture) {
       st->ctx->Driver.DeleteTexture(st->ctx, st->default_texture);
       st->default_texture = NULL;
@@ -283,6 +309,9 @@ void st_destroy_context( struct st_context *st )
    struct gl_context *ctx = st->ctx;
    GLuint i;
 
+   /* compiles and links queued from this context still use it */
+   _mesa_finish_shader_jobs(ctx);
+
    /* need to unbind and destroy CSO objects before anything else */
    cso_release_all(st->cso_context);
 
@@ -322,6 +351,20 @@ void st_destroy_context( struct st_context *st )
 }
 
 
+static void
+st_begin_trace(struct gl_context *ctx, const char *name, GLuint id)
+{
+   util_trace_begin_span(name, id);
+}
+
+
+static void
+st_end_trace(struct gl_context *ctx)
+{
+   util_trace_end_span();
+}
+
+
 void st_init_driver_functions(struct dd_function_table *functions)
 {
    _mesa_init_shader_object_functions(functions);
@@ -357,4 +400,9 @@ void st_init_driver_functions(struct dd_function_table *functions)
    st_init_syncobj_functions(functions);
 
    functions->UpdateState = st_invalidate_state;
+
+   if (util_trace_enabled()) {
+      functions->BeginTrace = st_begin_trace;
+      functions->EndTrace = st_end_trace;
+   }
 }
@@ -40,7 +40,9 @@ struct draw_stage;
 struct gen_mipmap_state;
 struct st_context;
 struct st_fragment_program;
+struct u_disk_cache;
 struct u_upload_mgr;
+struct util_queue;
 
 
 #define ST_NEW_MESA                    (1 << 0) /* Mesa state has changed */
@@ -65,6 +67,12 @@ struct st_tracked_state {
    void (*update)( struct st_context *st );
 };
 
+/** With ST_ATOM_STATS, how often and how long each atom ran */
+struct st_atom_stats {
+   uint64_t calls;
+   uint64_t time;  /**< nanoseconds */
+};
+
 
 
 struct st_context
@@ -77,6 +85,8 @@ struct st_context
 
    struct u_upload_mgr *uploader, *indexbuf_uploader, *constbuf_uploader;
 
+   struct util_queue *decode_queue; /**< for decompressing ETC1 on upload */
+
    struct draw_context *draw;  /**< For selection/feedback/rastpos only */
    struct draw_stage *feedback_stage;  /**< For GL_FEEDBACK rendermode */
    struct draw_stage *selection_stage;  /**< For GL_SELECT rendermode */
@@ -84,6 +94,7 @@ struct st_context
    GLboolean clamp_frag_color_in_shader;
    GLboolean clamp_vert_color_in_shader;
    boolean has_stencil_export; /**< can do shader stencil export? */
+   boolean has_etc1; /**< can sample ETC1, else it's decompressed on upload */
    boolean has_time_elapsed;
    boolean has_shader_model3;
    boolean prefer_blit_based_texture_transfer;
@@ -98,6 +109,9 @@ struct st_context
 
    boolean vertex_array_out_of_memory;
 
+   /** Being released by st_api_make_current(), so flushing can be deferred */
+   boolean releasing;
+
    /* Some state is contained in constant objects.
     * Other state is just parameter values.
     */
@@ -113,6 +127,9 @@ struct st_context
       struct {
          void *ptr;
          unsigned size;
+         /** The uploaded copy, if constbuf_uploader is used */
+         struct pipe_resource *buffer;
+         unsigned offset;
       } constants[PIPE_SHADER_TYPES];
       struct pipe_framebuffer_state framebuffer;
       struct pipe_scissor_state scissor;
@@ -129,6 +146,11 @@ struct st_context
 
    struct st_state_flags dirty;
 
+   /** Bitmask of the atoms to update for each dirty bit, see st_atom.c */
+   GLuint mesa_atoms[32];
+   GLuint st_atoms[32];
+   struct st_atom_stats *atom_stats;
+
    GLboolean missing_textures;
    GLboolean vertdata_edgeflags;
 
@@ -190,6 +212,11 @@ struct st_context
 
    struct cso_context *cso_context;
 
+   /** on-disk TGSI cache, NULL unless MESA_SHADER_CACHE_DIR is set */
+   struct u_disk_cache *shader_cache;
+   /** on-disk program binary cache, likewise */
+   struct u_disk_cache *program_cache;
+
    void *winsys_drawable_handle;
 
    /* The number of vertex buffers from the last call of validate_arrays. */
@@ -29,14 +29,18 @@
 #include "main/context.h"
 #include "program/prog_print.h"
 
+#include "pipe/p_context.h"
 #include "pipe/p_state.h"
 #include "pipe/p_shader_tokens.h"
+#include "os/os_time.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_scan.h"
 
 #include "cso_cache/cso_cache.h"
 
 #include "st_context.h"
 #include "st_debug.h"
+#include "st_glsl_to_tgsi.h"
 #include "st_program.h"
 
 
@@ -55,6 +59,9 @@ static const struct debug_named_value st_debug_flags[] = {
    { "query",    DEBUG_QUERY, NULL },
    { "draw",     DEBUG_DRAW, NULL },
    { "buffer",   DEBUG_BUFFER, NULL },
+   { "compile",  DEBUG_COMPILE, NULL },
+   { "variants", DEBUG_VARIANTS, NULL },
+   { "shaderstats", DEBUG_SHADER_STATS, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -102,3 +109,77 @@ st_print_current(void)
 }
 
 
+
+
+/**
+ * Print the statistics of a newly translated shader variant on one line
+ * of "key=value" fields, for scripts comparing shader compilers:
+ *
+ *   stage        VS, FS or GS
+ *   program      GL name of the GLSL program, or of the ARB program
+ *   ir           GLSL IR nodes the variant was translated from, -1 if the
+ *                program isn't GLSL or came from the shader cache
+ *   instructions, temps, immediates, constants, loops, branches
+ *                TGSI counts
+ *   translate_us time spent in the state tracker
+ *   compile_us   time spent in the driver's create_*_state
+ *   driver_size  bytes of native code, -1 if the driver doesn't say
+ *
+ * \param start       os_time_get() when the translation started
+ * \param translated  os_time_get() before the driver got the tokens
+ */
+void
+st_print_shader_stats(struct st_context *st, unsigned processor,
+                      const struct gl_program *prog,
+                      const struct glsl_to_tgsi_visitor *glsl_to_tgsi,
+                      const struct tgsi_token *tokens, void *driver_shader,
+                      int64_t start, int64_t translated)
+{
+   struct pipe_context *pipe = st->pipe;
+   const int64_t compiled = os_time_get();
+   struct tgsi_shader_info info;
+   const char *stage;
+   unsigned shader;
+   GLuint name = prog->Id;
+   int ir_count = -1;
+   int driver_size = -1;
+
+   switch (processor) {
+   case TGSI_PROCESSOR_VERTEX:
+      stage = "VS";
+      shader = PIPE_SHADER_VERTEX;
+      break;
+   case TGSI_PROCESSOR_GEOMETRY:
+      stage = "GS";
+      shader = PIPE_SHADER_GEOMETRY;
+      break;
+   default:
+      stage = "FS";
+      shader = PIPE_SHADER_FRAGMENT;
+      break;
+   }
+
+   if (glsl_to_tgsi)
+      st_glsl_to_tgsi_info(glsl_to_tgsi, &name, &ir_count);
+
+   if (driver_shader && pipe->get_shader_code_size)
+      driver_size = pipe->get_shader_code_size(pipe, shader, driver_shader);
+
+   tgsi_scan_shader(tokens, &info);
+
+   debug_printf("st: shader stats: stage=%s program=%u ir=%d "
+                "instructions=%u temps=%d immediates=%u constants=%d "
+                "loops=%u branches=%u translate_us=%lld compile_us=%lld "
+                "driver_size=%d\n",
+                stage, name, ir_count,
+                info.num_instructions,
+                info.file_max[TGSI_FILE_TEMPORARY] + 1,
+                info.immediate_count,
+                info.file_max[TGSI_FILE_CONSTANT] + 1,
+                info.opcode_count[TGSI_OPCODE_BGNLOOP],
+                info.opcode_count[TGSI_OPCODE_IF] +
+                info.opcode_count[TGSI_OPCODE_UIF],
+                (long long) (translated - start),
+                (long long) (compiled - translated),
+                driver_size);
+}
@@ -46,6 +46,9 @@ st_print_current(void);
 #define DEBUG_SCREEN    0x80
 #define DEBUG_DRAW      0x100
 #define DEBUG_BUFFER    0x200
+#define DEBUG_COMPILE   0x400
+#define DEBUG_VARIANTS  0x800
+#define DEBUG_SHADER_STATS 0x1000
 
 #ifdef DEBUG
 extern int ST_DEBUG;
@@ -57,6 +60,18 @@ extern int ST_DEBUG;
 
 void st_debug_init( void );
 
+struct gl_program;
+struct glsl_to_tgsi_visitor;
+struct st_context;
+struct tgsi_token;
+
+void
+st_print_shader_stats(struct st_context *st, unsigned processor,
+                      const struct gl_program *prog,
+                      const struct glsl_to_tgsi_visitor *glsl_to_tgsi,
+                      const struct tgsi_token *tokens, void *driver_shader,
+                      int64_t start, int64_t translated);
+
 static INLINE void
 ST_DBG( unsigned flag, const char *fmt, ... )
 {
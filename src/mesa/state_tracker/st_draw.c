@@ -100,6 +100,7 @@ setup_index_buffer(struct st_context *st,
    /* get/create the index buffer object */
    if (_mesa_is_bufferobj(bufobj)) {
       /* indices are in a real VBO */
+      st_bufferobj_sync(st, st_buffer_object(bufobj));
       ibuffer->buffer = st_buffer_object(bufobj)->buffer;
       ibuffer->offset = pointer_to_offset(ib->ptr);
    }
@@ -181,6 +182,38 @@ translate_prim(const struct gl_context *ctx, unsigned prim)
 }
 
 
+/**
+ * Whether \p next can be drawn in the same pipe draw as \p prim, as with
+ * glMultiDrawArrays/Elements of consecutive ranges: both are the same kind
+ * of independent primitives, \p next starts where \p prim ends, and
+ * \p prim has no incomplete primitive at its end.
+ */
+static boolean
+prims_mergeable(unsigned pipe_mode,
+                const struct _mesa_prim *prim,
+                const struct _mesa_prim *next)
+{
+   switch (pipe_mode) {
+   case PIPE_PRIM_POINTS:
+   case PIPE_PRIM_LINES:
+   case PIPE_PRIM_TRIANGLES:
+   case PIPE_PRIM_QUADS:
+   case PIPE_PRIM_LINES_ADJACENCY:
+   case PIPE_PRIM_TRIANGLES_ADJACENCY:
+      break;
+   default:
+      return FALSE;
+   }
+
+   return next->mode == prim->mode &&
+          next->start == prim->start + prim->count &&
+          next->basevertex == prim->basevertex &&
+          next->num_instances == prim->num_instances &&
+          next->base_instance == prim->base_instance &&
+          prim->count % u_prim_vertex_count(pipe_mode)->incr == 0;
+}
+
+
 /**
  * This function gets plugged into the VBO module and is called when
  * we have something to render.
@@ -262,6 +295,14 @@ st_draw_vbo(struct gl_context *ctx,
       info.start_instance = prims[i].base_instance;
       info.instance_count = prims[i].num_instances;
       info.index_bias = prims[i].basevertex;
+
+      /* Draw the following prims which just continue this one along. */
+      while (i + 1 < nr_prims && !info.count_from_stream_output &&
+             prims_mergeable(info.mode, &prims[i], &prims[i + 1])) {
+         i++;
+         info.count += prims[i].count;
+      }
+
       if (!ib) {
          info.min_index = info.start;
          info.max_index = info.start + info.count - 1;
@@ -186,6 +186,7 @@ st_feedback_draw_vbo(struct gl_context *ctx,
           */
          struct st_buffer_object *stobj = st_buffer_object(bufobj);
          assert(stobj->buffer);
+         st_bufferobj_sync(st, stobj);
 
          vbuffers[attr].buffer = NULL;
          vbuffers[attr].user_buffer = NULL;
@@ -242,6 +243,7 @@ st_feedback_draw_vbo(struct gl_context *ctx,
       if (bufobj && bufobj->Name) {
          struct st_buffer_object *stobj = st_buffer_object(bufobj);
 
+         st_bufferobj_sync(st, stobj);
          pipe_resource_reference(&ibuffer.buffer, stobj->buffer);
          ibuffer.offset = pointer_to_offset(ib->ptr);
 
@@ -35,10 +35,18 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 
+#include "util/u_debug.h"
+
 #include "st_context.h"
 #include "st_extensions.h"
 #include "st_format.h"
 
+/**
+ * Largest cost of the branches of an if-statement that is flattened to
+ * conditional assignments although the driver can branch around it.
+ */
+DEBUG_GET_ONCE_NUM_OPTION(flatten_if_cost, "ST_FLATTEN_IF_COST", 0)
+
 static unsigned _min(unsigned a, unsigned b)
 {
    return (a < b) ? a : b;
@@ -216,6 +224,7 @@ void st_init_limits(struct st_context *st)
 
       /* TODO: make these more fine-grained if anyone needs it */
       options->MaxIfDepth = screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_MAX_CONTROL_FLOW_DEPTH);
+      options->MaxFlattenIfCost = debug_get_option_flatten_if_cost();
       options->EmitNoLoops = !screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_MAX_CONTROL_FLOW_DEPTH);
       options->EmitNoFunctions = !screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_SUBROUTINES);
       options->EmitNoMainReturn = !screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_SUBROUTINES);
@@ -236,11 +245,15 @@ void st_init_limits(struct st_context *st)
          can_ubo = FALSE;
       }
 
-      if (options->EmitNoLoops)
+      if (options->EmitNoLoops) {
          options->MaxUnrollIterations = MIN2(screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_MAX_INSTRUCTIONS), 65536);
-      else
+      } else {
          options->MaxUnrollIterations = 255; /* SM3 limit */
+         options->MaxUnrollTemps =
+            screen->get_shader_param(screen, sh, PIPE_SHADER_CAP_MAX_TEMPS);
+      }
       options->LowerClipDistance = true;
+      options->OptimizeCSE = true;
    }
 
    /* This depends on program constants. */
@@ -289,6 +302,9 @@ void st_init_limits(struct st_context *st)
          c->FragmentProgram.MaxUniformBlocks;
       assert(c->MaxCombinedUniformBlocks <= MAX_COMBINED_UNIFORM_BUFFERS);
    }
+
+   /* GLSL programs can be saved with glGetProgramBinary. */
+   c->NumProgramBinaryFormats = 1;
 }
 
 
@@ -493,7 +509,9 @@ void st_init_extensions(struct st_context *st)
         GL_TRUE }, /* at least one format must be supported */
 
       { { o(OES_compressed_ETC1_RGB8_texture) },
-        { PIPE_FORMAT_ETC1_RGB8 } },
+        { PIPE_FORMAT_ETC1_RGB8,
+          PIPE_FORMAT_R8G8B8A8_UNORM },
+        GL_TRUE }, /* ETC1 is decompressed on upload if unsupported */
    };
 
    /* Required: vertex fetch support. */
@@ -738,6 +756,9 @@ void st_init_extensions(struct st_context *st)
    if (st->options.disable_glsl_line_continuations)
       ctx->Const.DisableGLSLLineContinuations = 1;
 
+   if (st->options.discard_glsl_ir)
+      ctx->Const.DiscardGLSLIR = GL_TRUE;
+
    ctx->Const.MinMapBufferAlignment =
       screen->get_param(screen, PIPE_CAP_MIN_MAP_BUFFER_ALIGNMENT);
    if (ctx->Const.MinMapBufferAlignment >= 64) {
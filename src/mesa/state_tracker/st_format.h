@@ -38,10 +38,11 @@
 
 struct gl_context;
 struct pipe_screen;
+struct st_context;
 
 
 extern enum pipe_format
-st_mesa_format_to_pipe_format(gl_format mesaFormat);
+st_mesa_format_to_pipe_format(struct st_context *st, gl_format mesaFormat);
 
 extern gl_format
 st_pipe_format_to_mesa_format(enum pipe_format pipeFormat);
@@ -58,7 +59,7 @@ st_choose_renderbuffer_format(struct st_context *st,
                               GLenum internalFormat, unsigned sample_count);
 
 extern enum pipe_format
-st_choose_matching_format(struct pipe_screen *screen, unsigned bind,
+st_choose_matching_format(struct st_context *st, unsigned bind,
 			  GLenum format, GLenum type, GLboolean swapBytes);
 
 extern gl_format
@@ -34,7 +34,9 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
+#include "util/u_format_s3tc.h"
 #include "util/u_gen_mipmap.h"
+#include "util/u_math.h"
 
 #include "st_debug.h"
 #include "st_context.h"
@@ -77,6 +79,7 @@ st_render_mipmap(struct st_context *st,
    struct pipe_screen *screen = pipe->screen;
    struct pipe_sampler_view *psv;
    const uint face = _mesa_tex_target_to_face(target);
+   enum pipe_format format = stObj->pt->format;
 
 #if 0
    assert(target != GL_TEXTURE_3D); /* implemented but untested */
@@ -85,13 +88,23 @@ st_render_mipmap(struct st_context *st,
    /* check if we can render in the texture's format */
    /* XXX should probably kill this and always use util_gen_mipmap
       since this implements a sw fallback as well */
-   if (!screen->is_format_supported(screen, stObj->pt->format,
+   if (!screen->is_format_supported(screen, format,
                                     stObj->pt->target,
                                     0, PIPE_BIND_RENDER_TARGET)) {
-      return FALSE;
+      /* Render sRGB textures through their linear format.  Like
+       * _mesa_generate_mipmap(), this filters the encoded values.
+       */
+      format = util_format_linear(format);
+      if (format == stObj->pt->format ||
+          !screen->is_format_supported(screen, format,
+                                       stObj->pt->target,
+                                       0, PIPE_BIND_RENDER_TARGET |
+                                          PIPE_BIND_SAMPLER_VIEW)) {
+         return FALSE;
+      }
    }
 
-   psv = st_create_texture_sampler_view(pipe, stObj->pt);
+   psv = st_create_texture_sampler_view_format(pipe, stObj->pt, format);
 
    util_gen_mipmap(st->gen_mipmap, psv, face, baseLevel, lastLevel,
                    PIPE_TEX_FILTER_LINEAR);
@@ -101,6 +114,142 @@ st_render_mipmap(struct st_context *st,
    return TRUE;
 }
 
+/**
+ * Generate mipmap levels of a compressed texture: the base level is
+ * decompressed into an RGBA8 texture, filtered there by rendering, and
+ * only the compression of the new levels is done on the CPU.
+ * \return TRUE if successful, FALSE if not possible
+ */
+static boolean
+st_render_mipmap_compressed(struct st_context *st,
+                            GLenum target,
+                            struct st_texture_object *stObj,
+                            uint baseLevel, uint lastLevel)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_resource *pt = stObj->pt;
+   const uint face = _mesa_tex_target_to_face(target);
+   const enum pipe_format format = util_format_linear(pt->format);
+   const enum pipe_format tmp_format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   const struct util_format_description *desc;
+   const uint first_layer = pt->target == PIPE_TEXTURE_CUBE ? face : 0;
+   const uint num_layers = pt->target == PIPE_TEXTURE_CUBE ?
+                           1 : pt->array_size;
+   struct pipe_resource *tmp;
+   struct pipe_sampler_view *psv;
+   struct pipe_blit_info blit;
+   uint level, layer;
+
+   desc = util_format_description(format);
+
+   /* Only the formats we can compress to. */
+   if (desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      if (!util_format_s3tc_enabled)
+         return FALSE;
+   }
+   else if (desc->layout != UTIL_FORMAT_LAYOUT_RGTC ||
+            desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED) {
+      return FALSE;
+   }
+
+   if (pt->target == PIPE_TEXTURE_3D ||
+       !screen->is_format_supported(screen, format, pt->target, 0,
+                                    PIPE_BIND_SAMPLER_VIEW) ||
+       !screen->is_format_supported(screen, tmp_format, pt->target, 0,
+                                    PIPE_BIND_RENDER_TARGET |
+                                    PIPE_BIND_SAMPLER_VIEW)) {
+      return FALSE;
+   }
+
+   tmp = st_texture_create(st, pt->target, tmp_format, lastLevel,
+                           pt->width0, pt->height0, pt->depth0,
+                           pt->array_size, 0,
+                           PIPE_BIND_RENDER_TARGET | PIPE_BIND_SAMPLER_VIEW);
+   if (!tmp)
+      return FALSE;
+
+   /* decompress the base level */
+   memset(&blit, 0, sizeof(blit));
+   blit.src.resource = pt;
+   blit.src.level = baseLevel;
+   blit.src.format = format;
+   blit.dst.resource = tmp;
+   blit.dst.level = baseLevel;
+   blit.dst.format = tmp_format;
+   blit.src.box.z = blit.dst.box.z = first_layer;
+   blit.src.box.width = blit.dst.box.width = u_minify(pt->width0, baseLevel);
+   blit.src.box.height = blit.dst.box.height =
+      u_minify(pt->height0, baseLevel);
+   blit.src.box.depth = blit.dst.box.depth = num_layers;
+   blit.mask = PIPE_MASK_RGBA;
+   blit.filter = PIPE_TEX_FILTER_NEAREST;
+
+   pipe->blit(pipe, &blit);
+
+   psv = st_create_texture_sampler_view(pipe, tmp);
+   util_gen_mipmap(st->gen_mipmap, psv, face, baseLevel, lastLevel,
+                   PIPE_TEX_FILTER_LINEAR);
+   pipe_sampler_view_reference(&psv, NULL);
+
+   /* compress the new levels */
+   for (level = baseLevel + 1; level <= lastLevel; level++) {
+      const uint width = u_minify(pt->width0, level);
+      const uint height = u_minify(pt->height0, level);
+      const uint padded_width = align(width, desc->block.width);
+      const uint padded_height = align(height, desc->block.height);
+      ubyte *padded = malloc(padded_width * padded_height * 4);
+
+      if (!padded)
+         break;
+
+      for (layer = first_layer; layer < first_layer + num_layers; layer++) {
+         struct pipe_transfer *src_xfer, *dst_xfer;
+         const ubyte *src;
+         ubyte *dst;
+         uint x, y;
+
+         src = pipe_transfer_map(pipe, tmp, level, layer,
+                                 PIPE_TRANSFER_READ,
+                                 0, 0, width, height, &src_xfer);
+         if (!src)
+            continue;
+
+         dst = pipe_transfer_map(pipe, pt, level, layer,
+                                 PIPE_TRANSFER_WRITE,
+                                 0, 0, width, height, &dst_xfer);
+         if (dst) {
+            /* The packers read whole blocks, so fill the partial blocks
+             * at the edges by replicating the last column and row.
+             */
+            for (y = 0; y < padded_height; y++) {
+               const ubyte *row = src + MIN2(y, height - 1) * src_xfer->stride;
+               ubyte *padded_row = padded + y * padded_width * 4;
+
+               memcpy(padded_row, row, width * 4);
+               for (x = width; x < padded_width; x++)
+                  memcpy(padded_row + x * 4, row + (width - 1) * 4, 4);
+            }
+
+            desc->pack_rgba_8unorm(dst, dst_xfer->stride,
+                                   padded, padded_width * 4,
+                                   width, height);
+
+            pipe_transfer_unmap(pipe, dst_xfer);
+         }
+
+         pipe_transfer_unmap(pipe, src_xfer);
+      }
+
+      free(padded);
+   }
+
+   pipe_resource_reference(&tmp, NULL);
+
+   return level > lastLevel;
+}
+
+
 /**
  * Compute the expected number of mipmap levels in the texture given
  * the width/height/depth of the base image and the GL_TEXTURE_BASE_LEVEL/
@@ -198,7 +347,8 @@ st_generate_mipmap(struct gl_context *ctx, GLenum target,
    /* Try to generate the mipmap by rendering/texturing.  If that fails,
     * use the software fallback.
     */
-   if (!st_render_mipmap(st, target, stObj, baseLevel, lastLevel)) {
+   if (!st_render_mipmap(st, target, stObj, baseLevel, lastLevel) &&
+       !st_render_mipmap_compressed(st, target, stObj, baseLevel, lastLevel)) {
       /* since the util code actually also has a fallback, should
          probably make it never fail and kill this */
       _mesa_generate_mipmap(ctx, target, texObj);
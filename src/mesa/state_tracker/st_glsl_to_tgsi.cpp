@@ -41,10 +41,11 @@
 #include "ir_optimization.h"
 #include "ast.h"
 
+#include "main/bitset.h"
 #include "main/mtypes.h"
 #include "main/shaderobj.h"
 #include "main/uniforms.h"
-#include "program/hash_table.h"
+#include "main/hash_table.h"
 
 extern "C" {
 #include "main/shaderapi.h"
@@ -60,11 +61,18 @@ extern "C" {
 #include "pipe/p_screen.h"
 #include "pipe/p_shader_tokens.h"
 #include "pipe/p_state.h"
+#include "os/os_thread.h"
+#include "util/u_counter.h"
 #include "util/u_math.h"
+#include "util/u_trace.h"
 #include "tgsi/tgsi_ureg.h"
 #include "tgsi/tgsi_info.h"
+#include "st_compile_stats.h"
 #include "st_context.h"
+#include "st_debug.h"
 #include "st_program.h"
+#include "st_program_binary.h"
+#include "st_shader_cache.h"
 #include "st_glsl_to_tgsi.h"
 #include "st_mesa_to_tgsi.h"
 }
@@ -89,6 +97,22 @@ extern "C" {
  */
 #define MAX_ARRAYS        256
 
+/**
+ * Use the per-channel linear scan allocator instead of merge_registers() for
+ * temporary registers.
+ */
+DEBUG_GET_ONCE_BOOL_OPTION(linear_scan_ra, "ST_LINEAR_SCAN_RA", FALSE)
+
+/**
+ * Run global_copy_propagate() after the per-block copy propagation.
+ */
+DEBUG_GET_ONCE_BOOL_OPTION(global_copy_prop, "ST_GLOBAL_COPY_PROPAGATION", FALSE)
+
+/**
+ * Lower and optimize the stages of a program on separate threads.
+ */
+DEBUG_GET_ONCE_BOOL_OPTION(parallel_link, "ST_PARALLEL_LINK", FALSE)
+
 /* will be 4 for GLSL 4.00 */
 #define MAX_GLSL_TEXTURE_OFFSET 1
 
@@ -97,6 +121,107 @@ class st_dst_reg;
 
 static int swizzle_for_size(int size);
 
+/**
+ * Bump allocator for the many small, short-lived objects created while
+ * translating one shader: instructions, relative addressing registers and
+ * scratch tables of the optimization passes.
+ *
+ * Memory is carved out of large ralloc'ed chunks which are all freed at
+ * once together with the owning context.  Scratch memory can be returned
+ * early by releasing back to a mark; the chunks are then reused.
+ */
+class glsl_to_tgsi_arena {
+   struct chunk {
+      struct chunk *next;
+      size_t size;
+      size_t used;
+   };
+
+public:
+   struct mark {
+      struct chunk *chunk;
+      size_t used;
+   };
+
+   glsl_to_tgsi_arena(void *mem_ctx)
+      : mem_ctx(mem_ctx), first(NULL), current(NULL)
+   {
+      /* empty */
+   }
+
+   void *alloc(size_t size)
+   {
+      size = (size + 7) & ~(size_t) 7;
+
+      if (!current || current->used + size > current->size)
+         next_chunk(size);
+
+      void *ptr = (char *) (current + 1) + current->used;
+      current->used += size;
+      return ptr;
+   }
+
+   void *zalloc(size_t size)
+   {
+      void *ptr = alloc(size);
+      memset(ptr, 0, size);
+      return ptr;
+   }
+
+   struct mark get_mark() const
+   {
+      struct mark m;
+      m.chunk = current;
+      m.used = current ? current->used : 0;
+      return m;
+   }
+
+   /** Frees everything allocated since \p m was taken. */
+   void release(const struct mark &m)
+   {
+      current = m.chunk;
+      if (current)
+         current->used = m.used;
+   }
+
+private:
+   enum { CHUNK_SIZE = 64 * 1024 };
+
+   /* Moves on to the chunk after the current one, which must have room for
+    * \p size bytes.  Chunks left over from a release are reused when they
+    * are big enough.
+    */
+   void next_chunk(size_t size)
+   {
+      struct chunk *next = current ? current->next : first;
+
+      if (next && next->size >= size) {
+         current = next;
+         current->used = 0;
+         return;
+      }
+
+      size_t chunk_size = MAX2(size, (size_t) CHUNK_SIZE);
+      struct chunk *c =
+         (struct chunk *) ralloc_size(mem_ctx, sizeof(struct chunk) + chunk_size);
+      c->size = chunk_size;
+      c->used = 0;
+
+      if (current) {
+         c->next = current->next;
+         current->next = c;
+      } else {
+         c->next = first;
+         first = c;
+      }
+      current = c;
+   }
+
+   void *mem_ctx;
+   struct chunk *first;
+   struct chunk *current;
+};
+
 /**
  * This struct is a corresponding struct to TGSI ureg_src.
  */
@@ -111,6 +236,7 @@ public:
       else
          this->swizzle = SWIZZLE_XYZW;
       this->negate = 0;
+      this->abs = 0;
       this->index2D = 0;
       this->type = type ? type->base_type : GLSL_TYPE_ERROR;
       this->reladdr = NULL;
@@ -124,6 +250,7 @@ public:
       this->index2D = 0;
       this->swizzle = SWIZZLE_XYZW;
       this->negate = 0;
+      this->abs = 0;
       this->reladdr = NULL;
    }
 
@@ -135,6 +262,7 @@ public:
       this->index2D = index2D;
       this->swizzle = SWIZZLE_XYZW;
       this->negate = 0;
+      this->abs = 0;
       this->reladdr = NULL;
    }
 
@@ -146,6 +274,7 @@ public:
       this->index2D = 0;
       this->swizzle = 0;
       this->negate = 0;
+      this->abs = 0;
       this->reladdr = NULL;
    }
 
@@ -156,6 +285,7 @@ public:
    int index2D;
    GLuint swizzle; /**< SWIZZLE_XYZWONEZERO swizzles from Mesa. */
    int negate; /**< NEGATE_XYZW mask from mesa */
+   int abs; /**< Take the absolute value, before negate is applied */
    int type; /** GLSL_TYPE_* from GLSL IR (enum glsl_base_type) */
    /** Register index should be offset by the integer in this reg. */
    st_src_reg *reladdr;
@@ -201,6 +331,7 @@ st_src_reg::st_src_reg(st_dst_reg reg)
    this->index = reg.index;
    this->swizzle = SWIZZLE_XYZW;
    this->negate = 0;
+   this->abs = 0;
    this->reladdr = reg.reladdr;
    this->index2D = 0;
 }
@@ -217,7 +348,24 @@ st_dst_reg::st_dst_reg(st_src_reg reg)
 
 class glsl_to_tgsi_instruction : public exec_node {
 public:
-   DECLARE_RALLOC_CXX_OPERATORS(glsl_to_tgsi_instruction)
+   /* Instructions are allocated from the visitor's arena, and their memory
+    * is only reclaimed when the whole visitor is freed.
+    */
+   static void *operator new(size_t size, glsl_to_tgsi_arena *arena)
+   {
+      return arena->zalloc(size);
+   }
+
+   static void operator delete(void *p)
+   {
+      (void) p;
+   }
+
+   static void operator delete(void *p, glsl_to_tgsi_arena *arena)
+   {
+      (void) p;
+      (void) arena;
+   }
 
    unsigned op;
    st_dst_reg dst;
@@ -263,6 +411,42 @@ public:
    int type; /**< GL_FLOAT, GL_INT, GL_BOOL, or GL_UNSIGNED_INT */
 };
 
+/**
+ * Values add_constant() has already placed in an immediate: they are read
+ * from the immediate at \c index through \c swizzle.
+ */
+class immediate_slot {
+public:
+   gl_constant_value values[4];
+   int size;
+   int type;
+
+   int index;
+   unsigned swizzle;
+};
+
+static uint32_t
+immediate_slot_hash(const immediate_slot *slot)
+{
+   uint32_t hash = slot->type * 31 + slot->size;
+
+   for (int i = 0; i < slot->size; i++)
+      hash = (hash * 0x01000193) ^ slot->values[i].u;
+
+   return hash;
+}
+
+static bool
+immediate_slot_equal(const void *key1, const void *key2)
+{
+   const immediate_slot *a = (const immediate_slot *) key1;
+   const immediate_slot *b = (const immediate_slot *) key2;
+
+   return a->type == b->type && a->size == b->size &&
+          memcmp(a->values, b->values,
+                 a->size * sizeof(gl_constant_value)) == 0;
+}
+
 class function_entry : public exec_node {
 public:
    ir_function_signature *sig;
@@ -295,6 +479,30 @@ public:
    st_src_reg return_reg;
 };
 
+/**
+ * First and last accesses of a temporary register, as instruction indices.
+ *
+ * Accesses inside a loop are widened to the enclosing outermost loop: reads
+ * and writes start at its BGNLOOP and last reads and writes end at its
+ * ENDLOOP.  A value of -1 means the register is never accessed that way.
+ */
+struct temp_live_range {
+   int first_read;
+   int last_read;
+   int first_write;
+   int last_write;
+};
+
+/**
+ * Live interval of a single channel of a temporary register, with the same
+ * loop widening as temp_live_range.
+ */
+struct temp_channel_interval {
+   int start; /**< first access, or -1 if the channel is never accessed */
+   int end; /**< last access */
+   bool starts_with_read; /**< first access is a read, not a write */
+};
+
 struct glsl_to_tgsi_visitor : public ir_visitor {
 public:
    glsl_to_tgsi_visitor();
@@ -319,6 +527,13 @@ public:
    int glsl_version;
    bool native_integers;
    bool have_sqrt;
+   bool fuse_mad; /**< MAD is no more expensive than MUL + ADD */
+   bool fuse_lrp; /**< LRP is no more expensive than ADD + MUL + MAD */
+   bool have_dp2a;
+   bool have_src_abs; /**< The driver takes the Absolute source modifier */
+
+   /** GLSL IR nodes of the linked shader, -1 if not known */
+   int ir_count;
 
    variable_storage *find_variable_storage(ir_variable *var);
 
@@ -372,6 +587,18 @@ public:
    exec_list immediates;
    unsigned num_immediates;
 
+   /** immediate_slot of every value in immediates added by this visitor */
+   struct hash_table *immediate_slots;
+
+   /**
+    * Last immediate added by this visitor, which scalars and vec2s of the
+    * same type are packed into while it has free components.
+    */
+   immediate_storage *last_immediate;
+
+   void add_immediate_slot(const gl_constant_value *values, int size,
+                           int type, int index, unsigned swizzle);
+
    /** List of function_entry */
    exec_list function_signatures;
    int next_signature_id;
@@ -379,6 +606,17 @@ public:
    /** List of glsl_to_tgsi_instruction */
    exec_list instructions;
 
+   /**
+    * The instructions as a dense array, so the optimization passes can walk
+    * them without chasing list pointers and use array indices as instruction
+    * positions.  Built by build_instruction_array() once all instructions
+    * have been emitted; passes that remove instructions keep it up to date.
+    */
+   glsl_to_tgsi_instruction **inst_array;
+   unsigned num_insts;
+
+   void build_instruction_array(void);
+
    glsl_to_tgsi_instruction *emit(ir_instruction *ir, unsigned op);
 
    glsl_to_tgsi_instruction *emit(ir_instruction *ir, unsigned op,
@@ -415,10 +653,15 @@ public:
    void emit_scs(ir_instruction *ir, unsigned op,
         	 st_dst_reg dst, const st_src_reg &src);
 
+   void accept_operand(ir_rvalue *operand);
+
    bool try_emit_mad(ir_expression *ir,
               int mul_operand);
    bool try_emit_mad_for_and_not(ir_expression *ir,
               int mul_operand);
+   bool try_emit_lrp(ir_expression *ir, int operand);
+   bool try_emit_dp2a(ir_expression *ir, int operand);
+   bool try_emit_fused(ir_expression *ir);
    bool try_emit_sat(ir_expression *ir);
 
    void emit_swz(ir_expression *ir);
@@ -428,21 +671,33 @@ public:
    void simplify_cmp(void);
 
    void rename_temp_register(int index, int new_index);
+   void rename_temp_registers(const int *renames);
+   void get_temp_live_ranges(struct temp_live_range *ranges);
    int get_first_temp_read(int index);
    int get_first_temp_write(int index);
    int get_last_temp_read(int index);
    int get_last_temp_write(int index);
 
    void copy_propagate(void);
+   bool global_copy_propagate(void);
    void eliminate_dead_code(void);
    int eliminate_dead_code_advanced(void);
+   bool eliminate_dead_code_liveness(void);
    void merge_registers(void);
    void renumber_registers(void);
+   void get_temp_channel_intervals(struct temp_channel_interval *intervals);
+   bool allocate_temp_registers(void);
 
    void emit_block_mov(ir_assignment *ir, const struct glsl_type *type,
                        st_dst_reg *l, st_src_reg *r);
 
    void *mem_ctx;
+
+   /** Allocator for instructions, reladdr registers and pass scratch */
+   glsl_to_tgsi_arena *arena;
+
+   /** Link-time part of the disk cache key, empty if the cache is off */
+   struct st_shader_cache_key cache_key;
 };
 
 static st_src_reg undef_src = st_src_reg(PROGRAM_UNDEFINED, 0, GLSL_TYPE_ERROR);
@@ -505,7 +760,7 @@ glsl_to_tgsi_visitor::emit(ir_instruction *ir, unsigned op,
         		 st_dst_reg dst,
         		 st_src_reg src0, st_src_reg src1, st_src_reg src2)
 {
-   glsl_to_tgsi_instruction *inst = new(mem_ctx) glsl_to_tgsi_instruction();
+   glsl_to_tgsi_instruction *inst = new(arena) glsl_to_tgsi_instruction();
    int num_reladdr = 0, i;
    
    op = get_opcode(ir, op, dst, src0, src1);
@@ -872,32 +1127,84 @@ glsl_to_tgsi_visitor::add_constant(gl_register_file file,
       return _mesa_add_typed_unnamed_constant(this->prog->Parameters, values,
                                               size, datatype, swizzle_out);
    } else {
-      int index = 0;
-      immediate_storage *entry;
+      immediate_slot key;
+      immediate_slot *slot;
+      struct hash_entry *entry;
+      unsigned swz[4];
+      int index, offset;
       assert(file == PROGRAM_IMMEDIATE);
 
-      /* Search immediate storage to see if we already have an identical
-       * immediate that we can use instead of adding a duplicate entry.
+      /* Look for an immediate that already holds these values. */
+      memcpy(key.values, values, size * sizeof(gl_constant_value));
+      key.size = size;
+      key.type = datatype;
+      entry = _mesa_hash_table_search(this->immediate_slots,
+                                      immediate_slot_hash(&key), &key);
+      if (entry) {
+         slot = (immediate_slot *) entry->data;
+         *swizzle_out = slot->swizzle;
+         return slot->index;
+      }
+
+      /* Pack scalars and vec2s into the free components of the last
+       * immediate, otherwise add an immediate to the list.
        */
-      foreach_iter(exec_list_iterator, iter, this->immediates) {
-         entry = (immediate_storage *)iter.get();
-         
-         if (entry->size == size &&
-             entry->type == datatype &&
-             !memcmp(entry->values, values, size * sizeof(gl_constant_value))) {
-             return index;
+      if (size <= 2 && this->last_immediate &&
+          this->last_immediate->type == datatype &&
+          this->last_immediate->size + size <= 4) {
+         offset = this->last_immediate->size;
+         memcpy(&this->last_immediate->values[offset], values,
+                size * sizeof(gl_constant_value));
+         this->last_immediate->size += size;
+         index = this->num_immediates - 1;
+      } else {
+         this->last_immediate = new(mem_ctx) immediate_storage(values, size,
+                                                               datatype);
+         this->immediates.push_tail(this->last_immediate);
+         offset = 0;
+         index = this->num_immediates++;
+      }
+
+      for (int i = 0; i < 4; i++)
+         swz[i] = offset + MIN2(i, size - 1);
+      *swizzle_out = MAKE_SWIZZLE4(swz[0], swz[1], swz[2], swz[3]);
+
+      add_immediate_slot(values, size, datatype, index, *swizzle_out);
+
+      /* The components of a vector can be used as scalars too. */
+      if (size > 1) {
+         for (int i = 0; i < size; i++) {
+            add_immediate_slot(&values[i], 1, datatype, index,
+                               MAKE_SWIZZLE4(swz[i], swz[i], swz[i], swz[i]));
          }
-         index++;
       }
-      
-      /* Add this immediate to the list. */
-      entry = new(mem_ctx) immediate_storage(values, size, datatype);
-      this->immediates.push_tail(entry);
-      this->num_immediates++;
+
       return index;
    }
 }
 
+void
+glsl_to_tgsi_visitor::add_immediate_slot(const gl_constant_value *values,
+                                         int size, int type, int index,
+                                         unsigned swizzle)
+{
+   immediate_slot *slot = ralloc(mem_ctx, immediate_slot);
+   uint32_t hash;
+
+   memcpy(slot->values, values, size * sizeof(gl_constant_value));
+   slot->size = size;
+   slot->type = type;
+   hash = immediate_slot_hash(slot);
+   if (_mesa_hash_table_search(this->immediate_slots, hash, slot)) {
+      ralloc_free(slot);
+      return;
+   }
+
+   slot->index = index;
+   slot->swizzle = swizzle;
+   _mesa_hash_table_insert(this->immediate_slots, hash, slot, slot);
+}
+
 st_src_reg
 glsl_to_tgsi_visitor::st_src_reg_for_float(float val)
 {
@@ -991,6 +1298,7 @@ glsl_to_tgsi_visitor::get_temp(const glsl_type *type)
    src.type = native_integers ? type->base_type : GLSL_TYPE_FLOAT;
    src.reladdr = NULL;
    src.negate = 0;
+   src.abs = 0;
 
    if (!options->EmitNoIndirectTemp &&
        (type->is_array() || type->is_matrix())) {
@@ -1218,15 +1526,18 @@ glsl_to_tgsi_visitor::try_emit_mad(ir_expression *ir, int mul_operand)
    st_src_reg a, b, c;
    st_dst_reg result_dst;
 
+   if (!fuse_mad)
+      return false;
+
    ir_expression *expr = ir->operands[mul_operand]->as_expression();
    if (!expr || expr->operation != ir_binop_mul)
       return false;
 
-   expr->operands[0]->accept(this);
+   accept_operand(expr->operands[0]);
    a = this->result;
-   expr->operands[1]->accept(this);
+   accept_operand(expr->operands[1]);
    b = this->result;
-   ir->operands[nonmul_operand]->accept(this);
+   accept_operand(ir->operands[nonmul_operand]);
    c = this->result;
 
    this->result = get_temp(ir->type);
@@ -1277,6 +1588,191 @@ glsl_to_tgsi_visitor::try_emit_mad_for_and_not(ir_expression *ir, int try_operan
    return true;
 }
 
+/**
+ * Whether a and b are known to evaluate to the same value: the same
+ * variable, the same swizzle of it, or equal constants.  Expressions have
+ * no side effects, so two reads of a variable within one tree agree.
+ */
+static bool
+is_same_value(ir_rvalue *a, ir_rvalue *b)
+{
+   if (a == b)
+      return true;
+
+   if (a->type != b->type)
+      return false;
+
+   ir_dereference_variable *deref_a = a->as_dereference_variable();
+   ir_dereference_variable *deref_b = b->as_dereference_variable();
+   if (deref_a && deref_b)
+      return deref_a->var == deref_b->var;
+
+   ir_swizzle *swiz_a = a->as_swizzle();
+   ir_swizzle *swiz_b = b->as_swizzle();
+   if (swiz_a && swiz_b) {
+      return swiz_a->mask.num_components == swiz_b->mask.num_components &&
+             swiz_a->mask.x == swiz_b->mask.x &&
+             swiz_a->mask.y == swiz_b->mask.y &&
+             swiz_a->mask.z == swiz_b->mask.z &&
+             swiz_a->mask.w == swiz_b->mask.w &&
+             is_same_value(swiz_a->val, swiz_b->val);
+   }
+
+   ir_constant *const_a = a->as_constant();
+   ir_constant *const_b = b->as_constant();
+   if (const_a && const_b)
+      return const_a->has_value(const_b);
+
+   return false;
+}
+
+/**
+ * If ir is (1 - t), in either its sub or its add-of-neg form, return t.
+ */
+static ir_rvalue *
+match_one_minus(ir_rvalue *ir)
+{
+   ir_expression *expr = ir->as_expression();
+   if (!expr)
+      return NULL;
+
+   if (expr->operation == ir_binop_sub && expr->operands[0]->is_one())
+      return expr->operands[1];
+
+   if (expr->operation == ir_binop_add) {
+      for (int i = 0; i < 2; i++) {
+         ir_expression *neg = expr->operands[1 - i]->as_expression();
+
+         if (expr->operands[i]->is_one() &&
+             neg && neg->operation == ir_unop_neg)
+            return neg->operands[0];
+      }
+   }
+
+   return NULL;
+}
+
+/**
+ * Emit LRP(t, y, x) instead of ADD(MUL(x, 1 - t), MUL(y, t))
+ *
+ * This is what mix() looks like when a shader spells it out by hand, and
+ * what it becomes after inlining a user function that does.
+ */
+bool
+glsl_to_tgsi_visitor::try_emit_lrp(ir_expression *ir, int operand)
+{
+   st_src_reg t, x, y;
+   st_dst_reg result_dst;
+
+   if (!fuse_lrp || ir->type->base_type != GLSL_TYPE_FLOAT)
+      return false;
+
+   ir_expression *x_mul = ir->operands[operand]->as_expression();
+   ir_expression *y_mul = ir->operands[1 - operand]->as_expression();
+   if (!x_mul || x_mul->operation != ir_binop_mul ||
+       !y_mul || y_mul->operation != ir_binop_mul)
+      return false;
+
+   for (int i = 0; i < 2; i++) {
+      ir_rvalue *t_ir = match_one_minus(x_mul->operands[i]);
+      if (!t_ir)
+         continue;
+
+      for (int j = 0; j < 2; j++) {
+         if (!is_same_value(y_mul->operands[j], t_ir))
+            continue;
+
+         accept_operand(t_ir);
+         t = this->result;
+         accept_operand(y_mul->operands[1 - j]);
+         y = this->result;
+         accept_operand(x_mul->operands[1 - i]);
+         x = this->result;
+
+         this->result = get_temp(ir->type);
+         result_dst = st_dst_reg(this->result);
+         result_dst.writemask = (1 << ir->type->vector_elements) - 1;
+         emit(ir, TGSI_OPCODE_LRP, result_dst, t, y, x);
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/**
+ * Emit DP2A(a, b, c) instead of ADD(DP2(a, b), c) for a scalar c
+ */
+bool
+glsl_to_tgsi_visitor::try_emit_dp2a(ir_expression *ir, int operand)
+{
+   st_src_reg a, b, c;
+   st_dst_reg result_dst;
+
+   if (!have_dp2a)
+      return false;
+
+   ir_expression *dot = ir->operands[operand]->as_expression();
+   if (!dot || dot->operation != ir_binop_dot ||
+       dot->operands[0]->type->vector_elements != 2 ||
+       !ir->operands[1 - operand]->type->is_scalar())
+      return false;
+
+   accept_operand(dot->operands[0]);
+   a = this->result;
+   accept_operand(dot->operands[1]);
+   b = this->result;
+   accept_operand(ir->operands[1 - operand]);
+   c = this->result;
+
+   this->result = get_temp(ir->type);
+   result_dst = st_dst_reg(this->result);
+   result_dst.writemask = WRITEMASK_X;
+   emit(ir, TGSI_OPCODE_DP2A, result_dst, a, b, c);
+
+   return true;
+}
+
+/**
+ * Patterns of expression trees that map to a single TGSI instruction.
+ *
+ * Each entry is tried, in order, on expressions of the given operation;
+ * operand says which operand of the root holds the inner expression.  The
+ * try_emit function checks the rest of the tree and whether the driver
+ * wants the fused instruction, and emits nothing when it returns false.
+ */
+static const struct {
+   ir_expression_operation operation;
+   bool (glsl_to_tgsi_visitor::*try_emit)(ir_expression *ir, int operand);
+   int operand;
+} fused_patterns[] = {
+   /* LRP(t, y, x) for x * (1 - t) + y * t */
+   { ir_binop_add, &glsl_to_tgsi_visitor::try_emit_lrp, 0 },
+   { ir_binop_add, &glsl_to_tgsi_visitor::try_emit_lrp, 1 },
+   /* DP2A(a, b, c) for dot(a, b) + c */
+   { ir_binop_add, &glsl_to_tgsi_visitor::try_emit_dp2a, 1 },
+   { ir_binop_add, &glsl_to_tgsi_visitor::try_emit_dp2a, 0 },
+   /* MAD(a, b, c) for a * b + c */
+   { ir_binop_add, &glsl_to_tgsi_visitor::try_emit_mad, 1 },
+   { ir_binop_add, &glsl_to_tgsi_visitor::try_emit_mad, 0 },
+   /* MAD(a, -b, a) for a && !b */
+   { ir_binop_logic_and, &glsl_to_tgsi_visitor::try_emit_mad_for_and_not, 1 },
+   { ir_binop_logic_and, &glsl_to_tgsi_visitor::try_emit_mad_for_and_not, 0 },
+};
+
+bool
+glsl_to_tgsi_visitor::try_emit_fused(ir_expression *ir)
+{
+   for (unsigned i = 0; i < Elements(fused_patterns); i++) {
+      if (fused_patterns[i].operation == ir->operation &&
+          (this->*fused_patterns[i].try_emit)(ir, fused_patterns[i].operand))
+         return true;
+   }
+
+   return false;
+}
+
 bool
 glsl_to_tgsi_visitor::try_emit_sat(ir_expression *ir)
 {
@@ -1324,6 +1820,27 @@ glsl_to_tgsi_visitor::try_emit_sat(ir_expression *ir)
    return true;
 }
 
+/**
+ * Visit an operand of a float instruction, folding abs() of it into the
+ * source modifier instead of emitting an ABS, if the driver takes it.
+ * neg() needs no help: it already comes back as a negated source.
+ */
+void
+glsl_to_tgsi_visitor::accept_operand(ir_rvalue *operand)
+{
+   ir_expression *expr = operand->as_expression();
+
+   if (have_src_abs && expr && expr->operation == ir_unop_abs &&
+       expr->type->base_type == GLSL_TYPE_FLOAT) {
+      expr->operands[0]->accept(this);
+      this->result.abs = 1;
+      this->result.negate = 0;
+      return;
+   }
+
+   operand->accept(this);
+}
+
 void
 glsl_to_tgsi_visitor::reladdr_to_temp(ir_instruction *ir,
         			    st_src_reg *reg, int *num_reladdr)
@@ -1351,23 +1868,9 @@ glsl_to_tgsi_visitor::visit(ir_expression *ir)
    st_src_reg result_src;
    st_dst_reg result_dst;
 
-   /* Quick peephole: Emit MAD(a, b, c) instead of ADD(MUL(a, b), c)
-    */
-   if (ir->operation == ir_binop_add) {
-      if (try_emit_mad(ir, 1))
-         return;
-      if (try_emit_mad(ir, 0))
-         return;
-   }
-
-   /* Quick peephole: Emit OPCODE_MAD(-a, -b, a) instead of AND(a, NOT(b))
-    */
-   if (ir->operation == ir_binop_logic_and) {
-      if (try_emit_mad_for_and_not(ir, 1))
-	 return;
-      if (try_emit_mad_for_and_not(ir, 0))
-	 return;
-   }
+   /* Quick peepholes: emit MAD, LRP, DP2A for the trees they implement */
+   if (try_emit_fused(ir))
+      return;
 
    if (try_emit_sat(ir))
       return;
@@ -1375,9 +1878,20 @@ glsl_to_tgsi_visitor::visit(ir_expression *ir)
    if (ir->operation == ir_quadop_vector)
       assert(!"ir_quadop_vector should have been lowered");
 
+   /* Bitcasts reinterpret the source register as is, and UCMP is untyped,
+    * so a float modifier on their sources would be applied as an integer
+    * one.
+    */
+   const bool fold_abs = ir->operation != ir_unop_bitcast_f2i &&
+                         ir->operation != ir_unop_bitcast_f2u &&
+                         ir->operation != ir_triop_csel;
+
    for (operand = 0; operand < ir->get_num_operands(); operand++) {
       this->result.file = PROGRAM_UNDEFINED;
-      ir->operands[operand]->accept(this);
+      if (fold_abs)
+         accept_operand(ir->operands[operand]);
+      else
+         ir->operands[operand]->accept(this);
       if (this->result.file == PROGRAM_UNDEFINED) {
          printf("Failed to get tree for expression operand:\n");
          ir->operands[operand]->print();
@@ -1915,6 +2429,7 @@ glsl_to_tgsi_visitor::visit(ir_expression *ir)
       cbuf.index2D = uniform_block->value.u[0] + 1;
       cbuf.reladdr = NULL;
       cbuf.negate = 0;
+      cbuf.abs = 0;
       
       assert(ir->type->is_vector() || ir->type->is_scalar());
 
@@ -1930,7 +2445,7 @@ glsl_to_tgsi_visitor::visit(ir_expression *ir)
                                     const_offset % 16 / 4,
                                     const_offset % 16 / 4);
 
-      cbuf.reladdr = ralloc(mem_ctx, st_src_reg);
+      cbuf.reladdr = (st_src_reg *) arena->alloc(sizeof(st_src_reg));
       memcpy(cbuf.reladdr, &index_reg, sizeof(index_reg));
 
       if (ir->type->base_type == GLSL_TYPE_BOOL) {
@@ -2138,7 +2653,7 @@ glsl_to_tgsi_visitor::visit(ir_dereference_array *ir)
          index_reg = accum_reg;
       }
 
-      src.reladdr = ralloc(mem_ctx, st_src_reg);
+      src.reladdr = (st_src_reg *) arena->alloc(sizeof(st_src_reg));
       memcpy(src.reladdr, &index_reg, sizeof(index_reg));
    }
 
@@ -2672,6 +3187,7 @@ glsl_to_tgsi_visitor::visit(ir_call *ir)
          r.reladdr = NULL;
          r.swizzle = SWIZZLE_NOOP;
          r.negate = 0;
+         r.abs = 0;
 
          param_rval->accept(this);
          st_dst_reg l = st_dst_reg(this->result);
@@ -3037,21 +3553,35 @@ glsl_to_tgsi_visitor::glsl_to_tgsi_visitor()
    next_array = 0;
    next_signature_id = 1;
    num_immediates = 0;
+   last_immediate = NULL;
    current_function = NULL;
    num_address_regs = 0;
    samplers_used = 0;
    indirect_addr_consts = false;
    glsl_version = 0;
    native_integers = false;
+   fuse_mad = true;
+   fuse_lrp = true;
+   have_dp2a = false;
+   have_src_abs = false;
+   ir_count = -1;
    mem_ctx = ralloc_context(NULL);
+   /* Grows as needed: each vector immediate adds a slot per component. */
+   immediate_slots = _mesa_hash_table_create(mem_ctx, immediate_slot_equal);
+   arena = new glsl_to_tgsi_arena(mem_ctx);
    ctx = NULL;
    prog = NULL;
    shader_program = NULL;
    options = NULL;
+   inst_array = NULL;
+   num_insts = 0;
+   st_shader_cache_key_init(&cache_key);
 }
 
 glsl_to_tgsi_visitor::~glsl_to_tgsi_visitor()
 {
+   st_shader_cache_key_fini(&cache_key);
+   delete arena;
    ralloc_free(mem_ctx);
 }
 
@@ -3060,6 +3590,32 @@ extern "C" void free_glsl_to_tgsi_visitor(glsl_to_tgsi_visitor *v)
    delete v;
 }
 
+/**
+ * Start the disk cache key of a variant from the link-time key of its
+ * program.  Returns false, leaving the key empty, for programs that can't
+ * be cached.
+ */
+extern "C" void
+st_glsl_to_tgsi_info(const glsl_to_tgsi_visitor *v, GLuint *program_name,
+                     int *ir_count)
+{
+   *program_name = v->shader_program ? v->shader_program->Name : 0;
+   *ir_count = v->ir_count;
+}
+
+
+extern "C" boolean
+st_init_variant_cache_key(const glsl_to_tgsi_visitor *v,
+                          struct st_shader_cache_key *key)
+{
+   st_shader_cache_key_init(key);
+   if (!v->cache_key.size)
+      return FALSE;
+
+   st_shader_cache_key_append(key, v->cache_key.data, v->cache_key.size);
+   return TRUE;
+}
+
 
 /**
  * Count resources used by the given gpu program (number of texture
@@ -3206,18 +3762,15 @@ get_src_arg_mask(st_dst_reg dst, st_src_reg src)
 void
 glsl_to_tgsi_visitor::simplify_cmp(void)
 {
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
    unsigned *tempWrites;
    unsigned outputWrites[MAX_PROGRAM_OUTPUTS];
 
-   tempWrites = new unsigned[MAX_TEMPS];
-   if (!tempWrites) {
-      return;
-   }
-   memset(tempWrites, 0, sizeof(unsigned) * MAX_TEMPS);
+   tempWrites = (unsigned *) arena->zalloc(sizeof(unsigned) * MAX_TEMPS);
    memset(outputWrites, 0, sizeof(outputWrites));
 
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
       unsigned prevWriteMask = 0;
 
       /* Give up if we encounter relative addressing or flow control. */
@@ -3255,15 +3808,33 @@ glsl_to_tgsi_visitor::simplify_cmp(void)
       }
    }
 
-   delete [] tempWrites;
+   arena->release(mark);
+}
+
+void
+glsl_to_tgsi_visitor::build_instruction_array(void)
+{
+   unsigned count = 0;
+
+   foreach_list(node, &this->instructions) {
+      count++;
+   }
+
+   this->inst_array = (glsl_to_tgsi_instruction **)
+      arena->alloc(sizeof(glsl_to_tgsi_instruction *) * count);
+   this->num_insts = 0;
+
+   foreach_list(node, &this->instructions) {
+      this->inst_array[this->num_insts++] = (glsl_to_tgsi_instruction *) node;
+   }
 }
 
 /* Replaces all references to a temporary register index with another index. */
 void
 glsl_to_tgsi_visitor::rename_temp_register(int index, int new_index)
 {
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
       unsigned j;
       
       for (j=0; j < num_inst_src_regs(inst->op); j++) {
@@ -3279,17 +3850,132 @@ glsl_to_tgsi_visitor::rename_temp_register(int index, int new_index)
    }
 }
 
-int
-glsl_to_tgsi_visitor::get_first_temp_read(int index)
+/* Replaces all references to temporary registers in one pass over the
+ * instruction list.  renames[i] is the new index for register i, or -1 to
+ * leave register i untouched.
+ */
+void
+glsl_to_tgsi_visitor::rename_temp_registers(const int *renames)
 {
-   int depth = 0; /* loop depth */
-   int loop_start = -1; /* index of the first active BGNLOOP (if any) */
-   unsigned i = 0, j;
-   
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
-      
-      for (j=0; j < num_inst_src_regs(inst->op); j++) {
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+      unsigned j;
+
+      for (j=0; j < num_inst_src_regs(inst->op); j++) {
+         if (inst->src[j].file == PROGRAM_TEMPORARY &&
+             renames[inst->src[j].index] >= 0) {
+            inst->src[j].index = renames[inst->src[j].index];
+         }
+      }
+
+      if (inst->dst.file == PROGRAM_TEMPORARY &&
+          renames[inst->dst.index] >= 0) {
+         inst->dst.index = renames[inst->dst.index];
+      }
+   }
+}
+
+/**
+ * Computes the live range of every temporary register in a single walk of
+ * the instruction list.  The results are identical to calling
+ * get_first_temp_read(), get_last_temp_read(), get_first_temp_write() and
+ * get_last_temp_write() for each register, but cost O(instructions + temps)
+ * instead of O(instructions * temps).
+ *
+ * \param ranges  array of this->next_temp entries to fill in
+ */
+void
+glsl_to_tgsi_visitor::get_temp_live_ranges(struct temp_live_range *ranges)
+{
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   int depth = 0; /* loop depth */
+   int loop_start = -1; /* index of the first active BGNLOOP (if any) */
+   int i = 0;
+   unsigned j;
+   /* Registers accessed inside the current outermost loop, whose last
+    * read or write must be moved to the ENDLOOP.
+    */
+   int *in_loop = (int *) arena->zalloc(sizeof(int) * this->next_temp);
+   int num_in_loop = 0;
+
+   for (j = 0; j < (unsigned) this->next_temp; j++) {
+      ranges[j].first_read = -1;
+      ranges[j].last_read = -1;
+      ranges[j].first_write = -1;
+      ranges[j].last_write = -1;
+   }
+
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+      for (j=0; j < num_inst_src_regs(inst->op); j++) {
+         if (inst->src[j].file == PROGRAM_TEMPORARY) {
+            struct temp_live_range *range = &ranges[inst->src[j].index];
+
+            if (range->first_read == -1)
+               range->first_read = (depth == 0) ? i : loop_start;
+
+            if (depth == 0) {
+               range->last_read = i;
+            } else if (range->last_read != -2) {
+               if (range->last_write != -2)
+                  in_loop[num_in_loop++] = inst->src[j].index;
+               range->last_read = -2;
+            }
+         }
+      }
+
+      if (inst->dst.file == PROGRAM_TEMPORARY) {
+         struct temp_live_range *range = &ranges[inst->dst.index];
+
+         if (range->first_write == -1)
+            range->first_write = (depth == 0) ? i : loop_start;
+
+         if (depth == 0) {
+            range->last_write = i;
+         } else if (range->last_write != -2) {
+            if (range->last_read != -2)
+               in_loop[num_in_loop++] = inst->dst.index;
+            range->last_write = -2;
+         }
+      }
+
+      if (inst->op == TGSI_OPCODE_BGNLOOP) {
+         if(depth++ == 0)
+            loop_start = i;
+      } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
+         if (--depth == 0) {
+            loop_start = -1;
+
+            while (num_in_loop > 0) {
+               struct temp_live_range *range = &ranges[in_loop[--num_in_loop]];
+
+               if (range->last_read == -2)
+                  range->last_read = i;
+               if (range->last_write == -2)
+                  range->last_write = i;
+            }
+         }
+      }
+      assert(depth >= 0);
+
+      i++;
+   }
+
+   arena->release(mark);
+}
+
+int
+glsl_to_tgsi_visitor::get_first_temp_read(int index)
+{
+   int depth = 0; /* loop depth */
+   int loop_start = -1; /* index of the first active BGNLOOP (if any) */
+   unsigned i = 0, j;
+   
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+      
+      for (j=0; j < num_inst_src_regs(inst->op); j++) {
          if (inst->src[j].file == PROGRAM_TEMPORARY && 
              inst->src[j].index == index) {
             return (depth == 0) ? i : loop_start;
@@ -3318,8 +4004,8 @@ glsl_to_tgsi_visitor::get_first_temp_write(int index)
    int loop_start = -1; /* index of the first active BGNLOOP (if any) */
    int i = 0;
    
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
       
       if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == index) {
          return (depth == 0) ? i : loop_start;
@@ -3347,8 +4033,8 @@ glsl_to_tgsi_visitor::get_last_temp_read(int index)
    int last = -1; /* index of last instruction that reads the temporary */
    unsigned i = 0, j;
    
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
       
       for (j=0; j < num_inst_src_regs(inst->op); j++) {
          if (inst->src[j].file == PROGRAM_TEMPORARY && 
@@ -3378,8 +4064,8 @@ glsl_to_tgsi_visitor::get_last_temp_write(int index)
    int last = -1; /* index of last instruction that writes to the temporary */
    int i = 0;
    
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
       
       if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == index)
          last = (depth == 0) ? i : -2;
@@ -3421,14 +4107,14 @@ glsl_to_tgsi_visitor::get_last_temp_write(int index)
 void
 glsl_to_tgsi_visitor::copy_propagate(void)
 {
-   glsl_to_tgsi_instruction **acp = rzalloc_array(mem_ctx,
-        					    glsl_to_tgsi_instruction *,
-        					    this->next_temp * 4);
-   int *acp_level = rzalloc_array(mem_ctx, int, this->next_temp * 4);
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   glsl_to_tgsi_instruction **acp = (glsl_to_tgsi_instruction **)
+      arena->zalloc(sizeof(glsl_to_tgsi_instruction *) * this->next_temp * 4);
+   int *acp_level = (int *) arena->zalloc(sizeof(int) * this->next_temp * 4);
    int level = 0;
 
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
 
       assert(inst->dst.file != PROGRAM_TEMPORARY
              || inst->dst.index < this->next_temp);
@@ -3579,7 +4265,8 @@ glsl_to_tgsi_visitor::copy_propagate(void)
           !inst->dst.reladdr &&
           !inst->saturate &&
           !inst->src[0].reladdr &&
-          !inst->src[0].negate) {
+          !inst->src[0].negate &&
+          !inst->src[0].abs) {
          for (int i = 0; i < 4; i++) {
             if (inst->dst.writemask & (1 << i)) {
                acp[4 * inst->dst.index + i] = inst;
@@ -3589,8 +4276,467 @@ glsl_to_tgsi_visitor::copy_propagate(void)
       }
    }
 
-   ralloc_free(acp_level);
-   ralloc_free(acp);
+   arena->release(mark);
+}
+
+/**
+ * Returns whether \p inst is a copy that global_copy_propagate() tracks:
+ * an unmodified MOV into a temporary from another temporary or from a
+ * register file the program cannot write.
+ */
+static bool
+is_global_copy(const glsl_to_tgsi_instruction *inst)
+{
+   if (inst->op != TGSI_OPCODE_MOV ||
+       inst->dst.file != PROGRAM_TEMPORARY ||
+       inst->dst.reladdr ||
+       inst->saturate ||
+       inst->src[0].reladdr ||
+       inst->src[0].negate ||
+       inst->src[0].abs)
+      return false;
+
+   switch (inst->src[0].file) {
+   case PROGRAM_TEMPORARY:
+      return inst->src[0].index != inst->dst.index;
+   case PROGRAM_OUTPUT:
+   case PROGRAM_ARRAY:
+   case PROGRAM_ADDRESS:
+   case PROGRAM_UNDEFINED:
+      return false;
+   default:
+      return true;
+   }
+}
+
+/**
+ * Table of the copies available in global_copy_propagate(), with lists of
+ * the copies that each temporary channel write invalidates.
+ */
+struct global_copy_table {
+   unsigned num_copies;
+   int *copy_inst; /**< instruction position of each copy */
+   int *copy_chan; /**< destination channel of each copy */
+
+   /** Copies defining temp channel n are def_copies[def_start[n]..[n+1]] */
+   int *def_start;
+   int *def_copies;
+   /** Copies reading temp channel n are use_copies[use_start[n]..[n+1]] */
+   int *use_start;
+   int *use_copies;
+};
+
+/* Applies the effect of \p inst on the set of available copies: clears the
+ * copies it invalidates and sets the copies it makes.  \p kill, if not NULL,
+ * accumulates the invalidated copies.
+ */
+static void
+apply_global_copy_effects(const struct global_copy_table *table,
+                          const glsl_to_tgsi_instruction *inst,
+                          int pos, const int *first_copy,
+                          BITSET_WORD *avail, BITSET_WORD *kill)
+{
+   unsigned words = BITSET_WORDS(table->num_copies);
+
+   if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.reladdr) {
+      /* Any temporary might be written. */
+      memset(avail, 0, words * sizeof(BITSET_WORD));
+      if (kill)
+         memset(kill, 0xff, words * sizeof(BITSET_WORD));
+   } else if (inst->dst.file == PROGRAM_TEMPORARY) {
+      for (int c = 0; c < 4; c++) {
+         if (!(inst->dst.writemask & (1 << c)))
+            continue;
+
+         int n = 4 * inst->dst.index + c;
+         for (int k = table->def_start[n]; k < table->def_start[n + 1]; k++) {
+            BITSET_CLEAR(avail, table->def_copies[k]);
+            if (kill)
+               BITSET_SET(kill, table->def_copies[k]);
+         }
+         for (int k = table->use_start[n]; k < table->use_start[n + 1]; k++) {
+            BITSET_CLEAR(avail, table->use_copies[k]);
+            if (kill)
+               BITSET_SET(kill, table->use_copies[k]);
+         }
+      }
+   }
+
+   for (int e = first_copy[pos]; e < first_copy[pos + 1]; e++) {
+      BITSET_SET(avail, e);
+      if (kill)
+         BITSET_CLEAR(kill, e);
+   }
+}
+
+/**
+ * Copy propagation across basic blocks.
+ *
+ * copy_propagate() forgets all copies at loop boundaries and the copies
+ * made inside an if or else block at its end.  This pass builds a control
+ * flow graph of the instruction list, computes the copies available at the
+ * start of every basic block with the usual forward "available copies"
+ * dataflow analysis, and then propagates them like copy_propagate() does.
+ *
+ * Copies are tracked per channel.  The sources of tracked copies themselves
+ * are never rewritten, as that would invalidate the analysis; run
+ * copy_propagate() first to collapse chains of copies within a block.
+ *
+ * Returns false without changing anything if the program contains
+ * subroutines or control flow the CFG builder doesn't understand.
+ */
+bool
+glsl_to_tgsi_visitor::global_copy_propagate(void)
+{
+   unsigned n = this->num_insts;
+
+   if (n == 0)
+      return true;
+
+   for (unsigned pos = 0; pos < n; pos++) {
+      switch (this->inst_array[pos]->op) {
+      case TGSI_OPCODE_CAL:
+      case TGSI_OPCODE_BGNSUB:
+      case TGSI_OPCODE_ENDSUB:
+         return false;
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_UIF:
+      case TGSI_OPCODE_ELSE:
+      case TGSI_OPCODE_ENDIF:
+      case TGSI_OPCODE_BGNLOOP:
+      case TGSI_OPCODE_ENDLOOP:
+      case TGSI_OPCODE_BRK:
+      case TGSI_OPCODE_CONT:
+      case TGSI_OPCODE_RET:
+      case TGSI_OPCODE_END:
+         break;
+      default:
+         if (tgsi_get_opcode_info(this->inst_array[pos]->op)->is_branch)
+            return false;
+         break;
+      }
+   }
+
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+
+   /* Match up the control flow instructions.  Every control flow
+    * instruction gets a basic block of its own.
+    */
+   int *match = (int *) arena->alloc(sizeof(int) * n);
+   int *stack = (int *) arena->alloc(sizeof(int) * n);
+   int *loop_of = (int *) arena->alloc(sizeof(int) * n);
+   int *block_of = (int *) arena->alloc(sizeof(int) * (n + 1));
+   int *block_start = (int *) arena->alloc(sizeof(int) * (n + 1));
+   int depth = 0, loop = -1, num_blocks = 0;
+   bool leader = true;
+
+   for (unsigned pos = 0; pos < n; pos++) {
+      const glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+      bool is_cf = true;
+
+      match[pos] = -1;
+      loop_of[pos] = loop;
+
+      switch (inst->op) {
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_UIF:
+         stack[depth++] = pos;
+         break;
+      case TGSI_OPCODE_ELSE:
+         assert(depth > 0);
+         match[stack[depth - 1]] = pos;
+         stack[depth - 1] = pos;
+         break;
+      case TGSI_OPCODE_ENDIF:
+         assert(depth > 0);
+         match[stack[--depth]] = pos;
+         break;
+      case TGSI_OPCODE_BGNLOOP:
+         stack[depth++] = pos;
+         loop = pos;
+         break;
+      case TGSI_OPCODE_ENDLOOP:
+         assert(depth > 0);
+         match[stack[--depth]] = pos;
+         match[pos] = stack[depth];
+         /* Find the enclosing loop again. */
+         loop = -1;
+         for (int d = depth - 1; d >= 0; d--) {
+            if (this->inst_array[stack[d]]->op == TGSI_OPCODE_BGNLOOP) {
+               loop = stack[d];
+               break;
+            }
+         }
+         break;
+      case TGSI_OPCODE_BRK:
+      case TGSI_OPCODE_CONT:
+      case TGSI_OPCODE_RET:
+      case TGSI_OPCODE_END:
+         break;
+      default:
+         is_cf = false;
+         break;
+      }
+
+      if (leader || is_cf)
+         block_start[num_blocks++] = pos;
+      block_of[pos] = num_blocks - 1;
+      leader = is_cf;
+   }
+   block_start[num_blocks] = n;
+   block_of[n] = -1; /* falling off the end of the program */
+
+   if (depth != 0) {
+      arena->release(mark);
+      return false;
+   }
+
+   /* Successors of every block, at most two each. */
+   int *succ = (int *) arena->alloc(sizeof(int) * 2 * num_blocks);
+   int *num_preds = (int *) arena->zalloc(sizeof(int) * (num_blocks + 1));
+
+   for (int b = 0; b < num_blocks; b++) {
+      int last = block_start[b + 1] - 1;
+      const glsl_to_tgsi_instruction *inst = this->inst_array[last];
+
+      succ[2 * b] = succ[2 * b + 1] = -1;
+
+      switch (inst->op) {
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_UIF:
+         succ[2 * b] = block_of[last + 1];
+         succ[2 * b + 1] = block_of[match[last] + 1];
+         break;
+      case TGSI_OPCODE_ELSE:
+         succ[2 * b] = block_of[match[last]];
+         break;
+      case TGSI_OPCODE_ENDLOOP:
+         succ[2 * b] = block_of[match[last] + 1];
+         break;
+      case TGSI_OPCODE_BRK:
+         if (loop_of[last] >= 0)
+            succ[2 * b] = block_of[match[loop_of[last]] + 1];
+         break;
+      case TGSI_OPCODE_CONT:
+         if (loop_of[last] >= 0)
+            succ[2 * b] = block_of[match[loop_of[last]]];
+         break;
+      case TGSI_OPCODE_RET:
+      case TGSI_OPCODE_END:
+         break;
+      default:
+         succ[2 * b] = block_of[last + 1];
+         break;
+      }
+
+      for (int i = 0; i < 2; i++) {
+         if (succ[2 * b + i] >= 0)
+            num_preds[succ[2 * b + i]]++;
+      }
+   }
+
+   int *pred_start = (int *) arena->alloc(sizeof(int) * (num_blocks + 1));
+   pred_start[0] = 0;
+   for (int b = 0; b < num_blocks; b++)
+      pred_start[b + 1] = pred_start[b] + num_preds[b];
+   int *preds = (int *) arena->alloc(sizeof(int) * (pred_start[num_blocks] + 1));
+   for (int b = 0; b < num_blocks; b++)
+      num_preds[b] = 0;
+   for (int b = 0; b < num_blocks; b++) {
+      for (int i = 0; i < 2; i++) {
+         int s = succ[2 * b + i];
+         if (s >= 0)
+            preds[pred_start[s] + num_preds[s]++] = b;
+      }
+   }
+
+   /* Enumerate the copies, one per written channel. */
+   struct global_copy_table table;
+   int *first_copy = (int *) arena->alloc(sizeof(int) * (n + 1));
+   int num_chans = this->next_temp * 4;
+
+   table.num_copies = 0;
+   for (unsigned pos = 0; pos < n; pos++) {
+      const glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+      first_copy[pos] = table.num_copies;
+      if (is_global_copy(inst)) {
+         for (int c = 0; c < 4; c++) {
+            if (inst->dst.writemask & (1 << c))
+               table.num_copies++;
+         }
+      }
+   }
+   first_copy[n] = table.num_copies;
+
+   if (table.num_copies == 0) {
+      arena->release(mark);
+      return true;
+   }
+
+   table.copy_inst = (int *) arena->alloc(sizeof(int) * table.num_copies);
+   table.copy_chan = (int *) arena->alloc(sizeof(int) * table.num_copies);
+   table.def_start = (int *) arena->zalloc(sizeof(int) * (num_chans + 1));
+   table.use_start = (int *) arena->zalloc(sizeof(int) * (num_chans + 1));
+   table.def_copies = (int *) arena->alloc(sizeof(int) * table.num_copies);
+   table.use_copies = (int *) arena->alloc(sizeof(int) * table.num_copies);
+
+   for (unsigned pos = 0; pos < n; pos++) {
+      const glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+      int e = first_copy[pos];
+
+      for (int c = 0; c < 4 && e < first_copy[pos + 1]; c++) {
+         if (!(inst->dst.writemask & (1 << c)))
+            continue;
+
+         table.copy_inst[e] = pos;
+         table.copy_chan[e] = c;
+         table.def_start[4 * inst->dst.index + c + 1]++;
+         if (inst->src[0].file == PROGRAM_TEMPORARY &&
+             GET_SWZ(inst->src[0].swizzle, c) <= SWIZZLE_W)
+            table.use_start[4 * inst->src[0].index +
+                            GET_SWZ(inst->src[0].swizzle, c) + 1]++;
+         e++;
+      }
+   }
+   for (int i = 0; i < num_chans; i++) {
+      table.def_start[i + 1] += table.def_start[i];
+      table.use_start[i + 1] += table.use_start[i];
+   }
+   int *def_fill = (int *) arena->zalloc(sizeof(int) * num_chans);
+   int *use_fill = (int *) arena->zalloc(sizeof(int) * num_chans);
+   for (unsigned e = 0; e < table.num_copies; e++) {
+      const glsl_to_tgsi_instruction *inst = this->inst_array[table.copy_inst[e]];
+      int c = table.copy_chan[e];
+      int d = 4 * inst->dst.index + c;
+
+      table.def_copies[table.def_start[d] + def_fill[d]++] = e;
+      if (inst->src[0].file == PROGRAM_TEMPORARY &&
+          GET_SWZ(inst->src[0].swizzle, c) <= SWIZZLE_W) {
+         int u = 4 * inst->src[0].index + GET_SWZ(inst->src[0].swizzle, c);
+         table.use_copies[table.use_start[u] + use_fill[u]++] = e;
+      }
+   }
+
+   /* Compute the per block gen and kill sets. */
+   unsigned words = BITSET_WORDS(table.num_copies);
+   size_t set_size = words * sizeof(BITSET_WORD);
+   BITSET_WORD *gen = (BITSET_WORD *) arena->zalloc(set_size * num_blocks);
+   BITSET_WORD *kill = (BITSET_WORD *) arena->zalloc(set_size * num_blocks);
+   BITSET_WORD *in = (BITSET_WORD *) arena->alloc(set_size * num_blocks);
+   BITSET_WORD *out = (BITSET_WORD *) arena->alloc(set_size * num_blocks);
+   BITSET_WORD *cur = (BITSET_WORD *) arena->alloc(set_size);
+
+   for (int b = 0; b < num_blocks; b++) {
+      for (int pos = block_start[b]; pos < block_start[b + 1]; pos++)
+         apply_global_copy_effects(&table, this->inst_array[pos], pos,
+                                   first_copy,
+                                   &gen[b * words], &kill[b * words]);
+
+      memset(&in[b * words], 0, set_size);
+      memset(&out[b * words], 0xff, set_size);
+   }
+
+   /* Iterate the dataflow equations to a fixed point:
+    *    in[b] = intersection of out[p] over the predecessors p of b
+    *    out[b] = gen[b] | (in[b] & ~kill[b])
+    * The entry block and blocks without predecessors start out empty.
+    */
+   bool progress;
+   do {
+      progress = false;
+
+      for (int b = 0; b < num_blocks; b++) {
+         BITSET_WORD *b_in = &in[b * words];
+         BITSET_WORD *b_out = &out[b * words];
+
+         if (b == 0 || pred_start[b] == pred_start[b + 1]) {
+            memset(b_in, 0, set_size);
+         } else {
+            memcpy(b_in, &out[preds[pred_start[b]] * words], set_size);
+            for (int p = pred_start[b] + 1; p < pred_start[b + 1]; p++) {
+               const BITSET_WORD *p_out = &out[preds[p] * words];
+               for (unsigned w = 0; w < words; w++)
+                  b_in[w] &= p_out[w];
+            }
+         }
+
+         for (unsigned w = 0; w < words; w++) {
+            BITSET_WORD new_out = gen[b * words + w] |
+                                  (b_in[w] & ~kill[b * words + w]);
+            if (new_out != b_out[w]) {
+               b_out[w] = new_out;
+               progress = true;
+            }
+         }
+      }
+   } while (progress);
+
+   /* Finally propagate the available copies into the sources. */
+   for (int b = 0; b < num_blocks; b++) {
+      memcpy(cur, &in[b * words], set_size);
+
+      for (int pos = block_start[b]; pos < block_start[b + 1]; pos++) {
+         glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+         for (int r = 0; r < 3 && !is_global_copy(inst); r++) {
+            glsl_to_tgsi_instruction *chan_copy[4];
+            glsl_to_tgsi_instruction *first = NULL;
+            bool good = true;
+
+            if (inst->src[r].file != PROGRAM_TEMPORARY ||
+                inst->src[r].reladdr)
+               continue;
+
+            for (int i = 0; i < 4 && good; i++) {
+               int src_chan = GET_SWZ(inst->src[r].swizzle, i);
+               int d = 4 * inst->src[r].index + src_chan;
+
+               chan_copy[i] = NULL;
+               if (src_chan > SWIZZLE_W) {
+                  good = false;
+                  break;
+               }
+               for (int k = table.def_start[d]; k < table.def_start[d + 1]; k++) {
+                  if (BITSET_TEST(cur, table.def_copies[k])) {
+                     chan_copy[i] =
+                        this->inst_array[table.copy_inst[table.def_copies[k]]];
+                     break;
+                  }
+               }
+
+               if (!chan_copy[i]) {
+                  good = false;
+               } else if (!first) {
+                  first = chan_copy[i];
+               } else if (first->src[0].file != chan_copy[i]->src[0].file ||
+                          first->src[0].index != chan_copy[i]->src[0].index ||
+                          first->src[0].index2D != chan_copy[i]->src[0].index2D) {
+                  good = false;
+               }
+            }
+
+            if (!good)
+               continue;
+
+            int swizzle = 0;
+            for (int i = 0; i < 4; i++) {
+               int src_chan = GET_SWZ(inst->src[r].swizzle, i);
+               swizzle |= (GET_SWZ(chan_copy[i]->src[0].swizzle, src_chan) <<
+                           (3 * i));
+            }
+            inst->src[r].file = first->src[0].file;
+            inst->src[r].index = first->src[0].index;
+            inst->src[r].index2D = first->src[0].index2D;
+            inst->src[r].swizzle = swizzle;
+         }
+
+         apply_global_copy_effects(&table, inst, pos, first_copy, cur, NULL);
+      }
+   }
+
+   arena->release(mark);
+   return true;
 }
 
 /*
@@ -3614,25 +4760,38 @@ glsl_to_tgsi_visitor::copy_propagate(void)
 void
 glsl_to_tgsi_visitor::eliminate_dead_code(void)
 {
-   int i;
-   
-   for (i=0; i < this->next_temp; i++) {
-      int last_read = get_last_temp_read(i);
-      int j = 0;
-      
-      foreach_iter(exec_list_iterator, iter, this->instructions) {
-         glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   struct temp_live_range *ranges = (struct temp_live_range *)
+      arena->zalloc(sizeof(struct temp_live_range) * this->next_temp);
+   bool progress;
+
+   /* Removing a write also removes the reads done by that instruction, which
+    * can make more writes dead, so repeat until nothing changes.
+    */
+   do {
+      unsigned num_kept = 0;
 
-         if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.index == i &&
-             j > last_read)
+      progress = false;
+      get_temp_live_ranges(ranges);
+
+      for (unsigned pos = 0; pos < this->num_insts; pos++) {
+         glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+         if (inst->dst.file == PROGRAM_TEMPORARY &&
+             (int) pos > ranges[inst->dst.index].last_read)
          {
-            iter.remove();
+            inst->remove();
             delete inst;
+            progress = true;
+            continue;
          }
-         
-         j++;
+
+         this->inst_array[num_kept++] = inst;
       }
-   }
+      this->num_insts = num_kept;
+   } while (progress);
+
+   arena->release(mark);
 }
 
 /*
@@ -3650,15 +4809,15 @@ glsl_to_tgsi_visitor::eliminate_dead_code(void)
 int
 glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
 {
-   glsl_to_tgsi_instruction **writes = rzalloc_array(mem_ctx,
-                                                     glsl_to_tgsi_instruction *,
-                                                     this->next_temp * 4);
-   int *write_level = rzalloc_array(mem_ctx, int, this->next_temp * 4);
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   glsl_to_tgsi_instruction **writes = (glsl_to_tgsi_instruction **)
+      arena->zalloc(sizeof(glsl_to_tgsi_instruction *) * this->next_temp * 4);
+   int *write_level = (int *) arena->zalloc(sizeof(int) * this->next_temp * 4);
    int level = 0;
    int removed = 0;
 
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
 
       assert(inst->dst.file != PROGRAM_TEMPORARY
              || inst->dst.index < this->next_temp);
@@ -3765,25 +4924,263 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
    /* Now actually remove the instructions that are completely dead and update
     * the writemask of other instructions with dead channels.
     */
-   foreach_iter(exec_list_iterator, iter, this->instructions) {
-      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *)iter.get();
+   unsigned num_kept = 0;
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
       
-      if (!inst->dead_mask || !inst->dst.writemask)
-         continue;
-      else if ((inst->dst.writemask & ~inst->dead_mask) == 0) {
-         iter.remove();
-         delete inst;
-         removed++;
-      } else
-         inst->dst.writemask &= ~(inst->dead_mask);
+      if (inst->dead_mask && inst->dst.writemask) {
+         if ((inst->dst.writemask & ~inst->dead_mask) == 0) {
+            inst->remove();
+            delete inst;
+            removed++;
+            continue;
+         } else
+            inst->dst.writemask &= ~(inst->dead_mask);
+      }
+
+      this->inst_array[num_kept++] = inst;
    }
+   this->num_insts = num_kept;
 
-   ralloc_free(write_level);
-   ralloc_free(writes);
-   
+   arena->release(mark);
    return removed;
 }
 
+/**
+ * Mark the temporary channels read by \p inst in \p set, which holds four
+ * bits per temporary.  A relative read may touch any temporary.
+ */
+static void
+mark_temp_reads(BITSET_WORD *set, unsigned words,
+                const glsl_to_tgsi_instruction *inst)
+{
+   for (unsigned i = 0; i < Elements(inst->src); i++) {
+      const st_src_reg *src = &inst->src[i];
+
+      if (src->file != PROGRAM_TEMPORARY)
+         continue;
+
+      if (src->reladdr) {
+         memset(set, 0xff, words * sizeof(BITSET_WORD));
+         return;
+      }
+
+      for (int c = 0; c < 4; c++) {
+         unsigned swz = GET_SWZ(src->swizzle, c);
+         if (swz <= SWIZZLE_W)
+            BITSET_SET(set, 4 * src->index + swz);
+      }
+   }
+
+   for (unsigned i = 0; i < inst->tex_offset_num_offset; i++) {
+      const struct tgsi_texture_offset *off = &inst->tex_offsets[i];
+
+      if (off->File != PROGRAM_TEMPORARY)
+         continue;
+
+      BITSET_SET(set, 4 * off->Index + off->SwizzleX);
+      BITSET_SET(set, 4 * off->Index + off->SwizzleY);
+      BITSET_SET(set, 4 * off->Index + off->SwizzleZ);
+   }
+}
+
+/**
+ * Dead code elimination in a single backward sweep over per-channel temp
+ * liveness.
+ *
+ * An instruction whose written channels are all dead is deleted before its
+ * sources are marked live, so a whole chain of dead computations goes away
+ * in one pass instead of one pass per link as with
+ * eliminate_dead_code_advanced().  Channels that are written but dead are
+ * removed from the writemask.
+ *
+ * Inside a loop every channel read anywhere in the loop is treated as live
+ * at the back edge, which is a safe approximation of the loop-carried
+ * liveness without iterating to a fixed point.
+ *
+ * Returns false without changing anything if the program has subroutines.
+ */
+bool
+glsl_to_tgsi_visitor::eliminate_dead_code_liveness(void)
+{
+   struct dce_frame {
+      bool is_loop;
+      bool has_else;
+      BITSET_WORD *after;       /**< live after ENDIF, or at the loop exit */
+      BITSET_WORD *else_live;   /**< live at the start of the else block */
+      BITSET_WORD *loop_reads;  /**< channels read anywhere in the loop */
+   };
+
+   unsigned depth = 0, max_depth = 0, num_loops = 0;
+
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      switch (this->inst_array[pos]->op) {
+      case TGSI_OPCODE_CAL:
+      case TGSI_OPCODE_BGNSUB:
+      case TGSI_OPCODE_ENDSUB:
+         return false;
+      case TGSI_OPCODE_BGNLOOP:
+         num_loops++;
+         /* fallthrough */
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_UIF:
+         max_depth = MAX2(max_depth, ++depth);
+         break;
+      case TGSI_OPCODE_ENDLOOP:
+      case TGSI_OPCODE_ENDIF:
+         depth--;
+         break;
+      default:
+         break;
+      }
+   }
+
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   const unsigned words = BITSET_WORDS(this->next_temp * 4);
+   const size_t set_size = words * sizeof(BITSET_WORD);
+   BITSET_WORD *live = (BITSET_WORD *) arena->zalloc(set_size);
+   BITSET_WORD *loop_reads =
+      (BITSET_WORD *) arena->zalloc(set_size * MAX2(num_loops, 1));
+   BITSET_WORD *frame_sets =
+      (BITSET_WORD *) arena->alloc(set_size * 2 * MAX2(max_depth, 1));
+   struct dce_frame *frames = (struct dce_frame *)
+      arena->alloc(sizeof(struct dce_frame) * MAX2(max_depth, 1));
+   unsigned *open_loops =
+      (unsigned *) arena->alloc(sizeof(unsigned) * MAX2(num_loops, 1));
+   unsigned *end_loop = (unsigned *) arena->alloc(sizeof(unsigned) *
+                                                  MAX2(this->num_insts, 1));
+   unsigned loop = 0, num_open = 0;
+   unsigned num_kept = 0;
+
+   /* Gather the reads of each loop, including those of its inner loops. */
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+      if (inst->op == TGSI_OPCODE_BGNLOOP) {
+         open_loops[num_open++] = loop++;
+      } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
+         unsigned inner = open_loops[--num_open];
+
+         end_loop[pos] = inner;
+         if (num_open) {
+            BITSET_WORD *outer = &loop_reads[open_loops[num_open - 1] * words];
+            for (unsigned w = 0; w < words; w++)
+               outer[w] |= loop_reads[inner * words + w];
+         }
+      } else if (num_open) {
+         mark_temp_reads(&loop_reads[open_loops[num_open - 1] * words],
+                         words, inst);
+      }
+   }
+
+   depth = 0;
+   for (int pos = this->num_insts - 1; pos >= 0; pos--) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+      struct dce_frame *f;
+
+      switch (inst->op) {
+      case TGSI_OPCODE_ENDIF:
+         f = &frames[depth];
+         f->is_loop = false;
+         f->has_else = false;
+         f->after = &frame_sets[2 * depth * words];
+         f->else_live = &frame_sets[(2 * depth + 1) * words];
+         memcpy(f->after, live, set_size);
+         depth++;
+         break;
+
+      case TGSI_OPCODE_ELSE:
+         f = &frames[depth - 1];
+         f->has_else = true;
+         memcpy(f->else_live, live, set_size);
+         memcpy(live, f->after, set_size);
+         break;
+
+      case TGSI_OPCODE_IF:
+      case TGSI_OPCODE_UIF:
+         f = &frames[--depth];
+         for (unsigned w = 0; w < words; w++)
+            live[w] |= f->has_else ? f->else_live[w] : f->after[w];
+         mark_temp_reads(live, words, inst);
+         break;
+
+      case TGSI_OPCODE_ENDLOOP:
+         f = &frames[depth];
+         f->is_loop = true;
+         f->after = &frame_sets[2 * depth * words];
+         f->loop_reads = &loop_reads[end_loop[pos] * words];
+         memcpy(f->after, live, set_size);
+         for (unsigned w = 0; w < words; w++)
+            live[w] |= f->loop_reads[w];
+         depth++;
+         break;
+
+      case TGSI_OPCODE_BGNLOOP:
+         depth--;
+         break;
+
+      case TGSI_OPCODE_BRK:
+      case TGSI_OPCODE_CONT:
+         f = &frames[depth - 1];
+         while (!f->is_loop)
+            f--;
+         memcpy(live, f->after, set_size);
+         if (inst->op == TGSI_OPCODE_CONT) {
+            for (unsigned w = 0; w < words; w++)
+               live[w] |= f->loop_reads[w];
+         }
+         break;
+
+      case TGSI_OPCODE_RET:
+      case TGSI_OPCODE_END:
+         /* Without subroutines this ends the program. */
+         memset(live, 0, set_size);
+         break;
+
+      default:
+         if (inst->dst.file == PROGRAM_TEMPORARY && !inst->dst.reladdr &&
+             inst->dst.writemask) {
+            unsigned live_mask = 0;
+
+            for (int c = 0; c < 4; c++) {
+               if (BITSET_TEST(live, 4 * inst->dst.index + c))
+                  live_mask |= 1 << c;
+            }
+
+            if ((inst->dst.writemask & live_mask) == 0) {
+               inst->remove();
+               delete inst;
+               this->inst_array[pos] = NULL;
+               continue;
+            }
+
+            inst->dst.writemask &= live_mask;
+
+            /* Saturating writes are kept out of the kill set, as in
+             * eliminate_dead_code_advanced().
+             */
+            if (!inst->saturate) {
+               for (int c = 0; c < 4; c++) {
+                  if (inst->dst.writemask & (1 << c))
+                     BITSET_CLEAR(live, 4 * inst->dst.index + c);
+               }
+            }
+         }
+         mark_temp_reads(live, words, inst);
+         break;
+      }
+   }
+
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      if (this->inst_array[pos])
+         this->inst_array[num_kept++] = this->inst_array[pos];
+   }
+   this->num_insts = num_kept;
+
+   arena->release(mark);
+   return true;
+}
+
 /* Merges temporary registers together where possible to reduce the number of 
  * registers needed to run a program.
  * 
@@ -3792,16 +5189,22 @@ glsl_to_tgsi_visitor::eliminate_dead_code_advanced(void)
 void
 glsl_to_tgsi_visitor::merge_registers(void)
 {
-   int *last_reads = rzalloc_array(mem_ctx, int, this->next_temp);
-   int *first_writes = rzalloc_array(mem_ctx, int, this->next_temp);
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   struct temp_live_range *ranges = (struct temp_live_range *)
+      arena->zalloc(sizeof(struct temp_live_range) * this->next_temp);
+   int *last_reads = (int *) arena->zalloc(sizeof(int) * this->next_temp);
+   int *first_writes = (int *) arena->zalloc(sizeof(int) * this->next_temp);
+   int *renames = (int *) arena->zalloc(sizeof(int) * this->next_temp);
    int i, j;
    
    /* Read the indices of the last read and first write to each temp register
     * into an array so that we don't have to traverse the instruction list as 
     * much. */
+   get_temp_live_ranges(ranges);
    for (i=0; i < this->next_temp; i++) {
-      last_reads[i] = get_last_temp_read(i);
-      first_writes[i] = get_first_temp_write(i);
+      last_reads[i] = ranges[i].last_read;
+      first_writes[i] = ranges[i].first_write;
+      renames[i] = -1;
    }
    
    /* Start looking for registers with non-overlapping usages that can be 
@@ -3821,7 +5224,7 @@ glsl_to_tgsi_visitor::merge_registers(void)
          if (first_writes[i] <= first_writes[j] && 
              last_reads[i] <= first_writes[j])
          {
-            rename_temp_register(j, i); /* Replace all references to j with i.*/
+            renames[j] = i; /* Replace all references to j with i.*/
             
             /* Update the first_writes and last_reads arrays with the new 
              * values for the merged register index, and mark the newly unused 
@@ -3832,27 +5235,299 @@ glsl_to_tgsi_visitor::merge_registers(void)
          }
       }
    }
-   
-   ralloc_free(last_reads);
-   ralloc_free(first_writes);
+
+   /* A merge target may itself be merged into another register later on, so
+    * follow the chains to the final index before applying the renames. */
+   for (i=0; i < this->next_temp; i++) {
+      while (renames[i] >= 0 && renames[renames[i]] >= 0)
+         renames[i] = renames[renames[i]];
+   }
+   rename_temp_registers(renames);
+
+   arena->release(mark);
+}
+
+/* Reassign indices to temporary registers by reusing unused indices created 
+ * by optimization passes. */
+void
+glsl_to_tgsi_visitor::renumber_registers(void)
+{
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   struct temp_live_range *ranges = (struct temp_live_range *)
+      arena->zalloc(sizeof(struct temp_live_range) * this->next_temp);
+   int *renames = (int *) arena->zalloc(sizeof(int) * this->next_temp);
+   int i = 0;
+   int new_index = 0;
+
+   get_temp_live_ranges(ranges);
+   
+   for (i=0; i < this->next_temp; i++) {
+      renames[i] = -1;
+      if (ranges[i].first_read < 0) continue;
+      if (i != new_index)
+         renames[i] = new_index;
+      new_index++;
+   }
+
+   rename_temp_registers(renames);
+   this->next_temp = new_index;
+
+   arena->release(mark);
+}
+
+static void
+record_channel_access(struct temp_channel_interval *ival, int *in_loop,
+                      int *num_in_loop, int slot, int i, int depth,
+                      int loop_start, bool is_read)
+{
+   struct temp_channel_interval *chan = &ival[slot];
+
+   if (chan->start == -1) {
+      chan->start = (depth == 0) ? i : loop_start;
+      chan->starts_with_read = is_read;
+   }
+
+   if (depth == 0) {
+      chan->end = i;
+   } else if (chan->end != -2) {
+      in_loop[(*num_in_loop)++] = slot;
+      chan->end = -2;
+   }
+}
+
+/**
+ * Computes the live interval of every channel of every temporary register
+ * in a single walk of the instruction list.
+ *
+ * \param intervals  array of this->next_temp * 4 entries to fill in
+ */
+void
+glsl_to_tgsi_visitor::get_temp_channel_intervals(struct temp_channel_interval *intervals)
+{
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   int depth = 0; /* loop depth */
+   int loop_start = -1; /* index of the first active BGNLOOP (if any) */
+   int i = 0;
+   int *in_loop = (int *) arena->zalloc(sizeof(int) * this->next_temp * 4);
+   int num_in_loop = 0;
+
+   for (int r = 0; r < this->next_temp * 4; r++) {
+      intervals[r].start = -1;
+      intervals[r].end = -1;
+      intervals[r].starts_with_read = false;
+   }
+
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+      for (unsigned j = 0; j < num_inst_src_regs(inst->op); j++) {
+         if (inst->src[j].file != PROGRAM_TEMPORARY)
+            continue;
+
+         int src_chans = 0;
+         for (int c = 0; c < 4; c++) {
+            int swz = GET_SWZ(inst->src[j].swizzle, c);
+            if (swz <= SWIZZLE_W)
+               src_chans |= 1 << swz;
+         }
+
+         for (int c = 0; c < 4; c++) {
+            if (src_chans & (1 << c))
+               record_channel_access(intervals, in_loop, &num_in_loop,
+                                     4 * inst->src[j].index + c,
+                                     i, depth, loop_start, true);
+         }
+      }
+
+      if (inst->dst.file == PROGRAM_TEMPORARY) {
+         for (int c = 0; c < 4; c++) {
+            if (inst->dst.writemask & (1 << c))
+               record_channel_access(intervals, in_loop, &num_in_loop,
+                                     4 * inst->dst.index + c,
+                                     i, depth, loop_start, false);
+         }
+      }
+
+      if (inst->op == TGSI_OPCODE_BGNLOOP) {
+         if(depth++ == 0)
+            loop_start = i;
+      } else if (inst->op == TGSI_OPCODE_ENDLOOP) {
+         if (--depth == 0) {
+            loop_start = -1;
+            while (num_in_loop > 0)
+               intervals[in_loop[--num_in_loop]].end = i;
+         }
+      }
+      assert(depth >= 0);
+
+      i++;
+   }
+
+   arena->release(mark);
+}
+
+struct temp_alloc_order {
+   int start;
+   int index;
+};
+
+static int
+compare_temp_alloc_order(const void *a, const void *b)
+{
+   const struct temp_alloc_order *ta = (const struct temp_alloc_order *) a;
+   const struct temp_alloc_order *tb = (const struct temp_alloc_order *) b;
+
+   if (ta->start != tb->start)
+      return ta->start - tb->start;
+   return ta->index - tb->index;
+}
+
+/**
+ * Linear scan register allocator for temporary registers.
+ *
+ * Unlike merge_registers(), liveness is tracked per channel, so two
+ * temporaries can share a register whenever the channels they use are
+ * disjoint or are live at different times.  Channels are not moved, so no
+ * swizzles or writemasks have to be rewritten.  Temporaries are visited in
+ * order of their first access and assigned to the lowest register with room
+ * for all of their channels.  This also renumbers the registers, so
+ * renumber_registers() does not need to run afterward.
+ *
+ * Returns false without changing anything if the program contains
+ * subroutine calls or relative addressing of temporaries, since the
+ * intervals computed from the linear instruction order aren't valid then.
+ */
+bool
+glsl_to_tgsi_visitor::allocate_temp_registers(void)
+{
+   for (unsigned pos = 0; pos < this->num_insts; pos++) {
+      glsl_to_tgsi_instruction *inst = this->inst_array[pos];
+
+      if (inst->op == TGSI_OPCODE_CAL)
+         return false;
+      if (inst->dst.file == PROGRAM_TEMPORARY && inst->dst.reladdr)
+         return false;
+      for (unsigned j = 0; j < num_inst_src_regs(inst->op); j++) {
+         if (inst->src[j].file == PROGRAM_TEMPORARY && inst->src[j].reladdr)
+            return false;
+      }
+   }
+
+   glsl_to_tgsi_arena::mark mark = arena->get_mark();
+   struct temp_channel_interval *intervals =
+      (struct temp_channel_interval *)
+      arena->zalloc(sizeof(struct temp_channel_interval) * this->next_temp * 4);
+   struct temp_alloc_order *order =
+      (struct temp_alloc_order *)
+      arena->zalloc(sizeof(struct temp_alloc_order) * this->next_temp);
+   int *reg_end = (int *) arena->zalloc(sizeof(int) * this->next_temp * 4);
+   int *renames = (int *) arena->zalloc(sizeof(int) * this->next_temp);
+   int num_order = 0;
+   int num_regs = 0;
+
+   get_temp_channel_intervals(intervals);
+
+   for (int t = 0; t < this->next_temp; t++) {
+      int start = -1;
+
+      for (int c = 0; c < 4; c++) {
+         int chan_start = intervals[4 * t + c].start;
+         if (chan_start >= 0 && (start < 0 || chan_start < start))
+            start = chan_start;
+      }
+
+      renames[t] = -1;
+      if (start < 0)
+         continue;
+
+      order[num_order].start = start;
+      order[num_order].index = t;
+      num_order++;
+   }
+
+   qsort(order, num_order, sizeof(*order), compare_temp_alloc_order);
+
+   for (int n = 0; n < num_order; n++) {
+      const struct temp_channel_interval *ival = &intervals[4 * order[n].index];
+      int r;
+
+      for (r = 0; r < num_regs; r++) {
+         bool fits = true;
+
+         for (int c = 0; c < 4 && fits; c++) {
+            int end = reg_end[4 * r + c];
+
+            if (ival[c].start < 0)
+               continue;
+
+            /* An instruction reads its sources before writing its
+             * destination, so a channel may be reused by the instruction
+             * that last reads it, as long as that instruction writes the new
+             * value rather than reading it.
+             */
+            if (end > ival[c].start ||
+                (end == ival[c].start && ival[c].starts_with_read))
+               fits = false;
+         }
+
+         if (fits)
+            break;
+      }
+
+      if (r == num_regs) {
+         for (int c = 0; c < 4; c++)
+            reg_end[4 * r + c] = -1;
+         num_regs++;
+      }
+
+      for (int c = 0; c < 4; c++) {
+         if (ival[c].start >= 0)
+            reg_end[4 * r + c] = MAX2(reg_end[4 * r + c], ival[c].end);
+      }
+
+      renames[order[n].index] = r;
+   }
+
+   rename_temp_registers(renames);
+   this->next_temp = num_regs;
+
+   arena->release(mark);
+
+
+   return true;
 }
 
-/* Reassign indices to temporary registers by reusing unused indices created 
- * by optimization passes. */
-void
-glsl_to_tgsi_visitor::renumber_registers(void)
+static void
+count_ir_node(ir_instruction *ir, void *data)
 {
-   int i = 0;
-   int new_index = 0;
-   
-   for (i=0; i < this->next_temp; i++) {
-      if (get_first_temp_read(i) < 0) continue;
-      if (i != new_index)
-         rename_temp_register(i, new_index);
-      new_index++;
+   (void) ir;
+   (*(unsigned *) data)++;
+}
+
+/** Returns the number of GLSL IR nodes, for compile statistics. */
+static unsigned
+count_ir_nodes(exec_list *instructions)
+{
+   unsigned count = 0;
+
+   foreach_list(node, instructions) {
+      visit_tree((ir_instruction *) node, count_ir_node, &count);
    }
-   
-   this->next_temp = new_index;
+
+   return count;
+}
+
+/** Returns the number of glsl_to_tgsi instructions, for compile statistics. */
+static unsigned
+count_instructions(glsl_to_tgsi_visitor *v)
+{
+   unsigned count = 0;
+
+   foreach_list(node, &v->instructions) {
+      count++;
+   }
+
+   return count;
 }
 
 /**
@@ -4060,12 +5735,263 @@ get_bitmap_visitor(struct st_fragment_program *fp,
    fp->glsl_to_tgsi = v;
 }
 
-/* ------------------------- TGSI conversion stuff -------------------------- */
-struct label {
-   unsigned branch_target;
-   unsigned token;
-};
+static void
+write_src_reg(struct st_binary_writer *w, const st_src_reg *reg)
+{
+   st_binary_write_uint32(w, reg->file);
+   st_binary_write_uint32(w, reg->index);
+   st_binary_write_uint32(w, reg->index2D);
+   st_binary_write_uint32(w, reg->swizzle);
+   st_binary_write_uint32(w, reg->negate);
+   st_binary_write_uint32(w, reg->abs);
+   st_binary_write_uint32(w, reg->type);
+   st_binary_write_uint32(w, reg->reladdr != NULL);
+   if (reg->reladdr)
+      write_src_reg(w, reg->reladdr);
+}
+
+static void
+write_dst_reg(struct st_binary_writer *w, const st_dst_reg *reg)
+{
+   st_binary_write_uint32(w, reg->file);
+   st_binary_write_uint32(w, reg->index);
+   st_binary_write_uint32(w, reg->writemask);
+   st_binary_write_uint32(w, reg->cond_mask);
+   st_binary_write_uint32(w, reg->type);
+   st_binary_write_uint32(w, reg->reladdr != NULL);
+   if (reg->reladdr)
+      write_src_reg(w, reg->reladdr);
+}
+
+static gl_register_file
+read_register_file(struct st_binary_reader *r)
+{
+   unsigned file = st_binary_read_uint32(r);
+
+   if (file >= PROGRAM_FILE_MAX) {
+      r->error = TRUE;
+      return PROGRAM_UNDEFINED;
+   }
+   return (gl_register_file) file;
+}
+
+static st_src_reg *read_reladdr(struct st_binary_reader *r,
+                                glsl_to_tgsi_arena *arena);
+
+static void
+read_src_reg(struct st_binary_reader *r, glsl_to_tgsi_arena *arena,
+             st_src_reg *reg)
+{
+   reg->file = read_register_file(r);
+   reg->index = st_binary_read_uint32(r);
+   reg->index2D = st_binary_read_uint32(r);
+   reg->swizzle = st_binary_read_uint32(r);
+   reg->negate = st_binary_read_uint32(r);
+   reg->abs = st_binary_read_uint32(r);
+   reg->type = st_binary_read_uint32(r);
+   reg->reladdr = read_reladdr(r, arena);
+}
+
+static void
+read_dst_reg(struct st_binary_reader *r, glsl_to_tgsi_arena *arena,
+             st_dst_reg *reg)
+{
+   reg->file = read_register_file(r);
+   reg->index = st_binary_read_uint32(r);
+   reg->writemask = st_binary_read_uint32(r);
+   reg->cond_mask = st_binary_read_uint32(r);
+   reg->type = st_binary_read_uint32(r);
+   reg->reladdr = read_reladdr(r, arena);
+}
+
+static st_src_reg *
+read_reladdr(struct st_binary_reader *r, glsl_to_tgsi_arena *arena)
+{
+   if (!st_binary_read_uint32(r) || r->error)
+      return NULL;
+
+   st_src_reg *reladdr = (st_src_reg *) arena->alloc(sizeof(st_src_reg));
+   read_src_reg(r, arena, reladdr);
+
+   /* Address registers are never indirectly addressed themselves. */
+   if (reladdr->reladdr)
+      r->error = TRUE;
+   return reladdr;
+}
+
+/**
+ * Serialize the optimized instruction stream of a linked stage, together
+ * with everything st_translate_program() needs from the visitor.
+ *
+ * Programs that still call subroutines can't be serialized; w->error is
+ * set for them.
+ */
+extern "C" void
+st_serialize_glsl_to_tgsi(const struct glsl_to_tgsi_visitor *v,
+                          struct st_binary_writer *w)
+{
+   st_binary_write_uint32(w, v->glsl_version);
+   st_binary_write_uint32(w, v->native_integers);
+   st_binary_write_uint32(w, v->have_sqrt);
+   st_binary_write_uint32(w, v->next_temp);
+   st_binary_write_uint32(w, v->next_array);
+   st_binary_write(w, v->array_sizes, v->next_array * sizeof(v->array_sizes[0]));
+   st_binary_write_uint32(w, v->num_address_regs);
+   st_binary_write_uint32(w, v->samplers_used);
+   st_binary_write_uint32(w, v->indirect_addr_consts);
+
+   st_binary_write_uint32(w, v->cache_key.size);
+   st_binary_write(w, v->cache_key.data, v->cache_key.size);
+
+   st_binary_write_uint32(w, v->num_immediates);
+   foreach_list(node, &v->immediates) {
+      immediate_storage *imm = (immediate_storage *) node;
+
+      st_binary_write_uint32(w, imm->size);
+      st_binary_write_uint32(w, imm->type);
+      st_binary_write(w, imm->values, sizeof(imm->values));
+   }
+
+   unsigned num_insts = 0;
+   foreach_list(node, &v->instructions)
+      num_insts++;
+
+   st_binary_write_uint32(w, num_insts);
+   foreach_list(node, &v->instructions) {
+      glsl_to_tgsi_instruction *inst = (glsl_to_tgsi_instruction *) node;
+
+      if (inst->function) {
+         w->error = TRUE;
+         return;
+      }
+
+      st_binary_write_uint32(w, inst->op);
+      write_dst_reg(w, &inst->dst);
+      for (unsigned i = 0; i < Elements(inst->src); i++)
+         write_src_reg(w, &inst->src[i]);
+      st_binary_write_uint32(w, inst->cond_update);
+      st_binary_write_uint32(w, inst->saturate);
+      st_binary_write_uint32(w, inst->sampler);
+      st_binary_write_uint32(w, inst->tex_target);
+      st_binary_write_uint32(w, inst->tex_shadow);
+      st_binary_write_uint32(w, inst->tex_offset_num_offset);
+      st_binary_write(w, inst->tex_offsets,
+                      inst->tex_offset_num_offset * sizeof(inst->tex_offsets[0]));
+   }
+}
+
+/**
+ * Rebuild the visitor of a linked stage from st_serialize_glsl_to_tgsi()
+ * output.  \p prog must already have its parameter list.
+ *
+ * \return the new visitor, or NULL if the data is malformed.
+ */
+extern "C" struct glsl_to_tgsi_visitor *
+st_deserialize_glsl_to_tgsi(struct gl_context *ctx,
+                            struct gl_shader_program *shader_program,
+                            struct gl_program *prog,
+                            struct st_binary_reader *r)
+{
+   glsl_to_tgsi_visitor *v = new glsl_to_tgsi_visitor();
+   unsigned stage = _mesa_program_target_to_index(prog->Target);
+   size_t start = r->offset;
+
+   v->ctx = ctx;
+   v->prog = prog;
+   v->shader_program = shader_program;
+   v->options = &ctx->ShaderCompilerOptions[stage];
+
+   v->glsl_version = st_binary_read_uint32(r);
+   v->native_integers = st_binary_read_uint32(r);
+   v->have_sqrt = st_binary_read_uint32(r);
+   v->next_temp = st_binary_read_uint32(r);
+   v->next_array = st_binary_read_uint32(r);
+   if (v->next_temp > MAX_TEMPS || v->next_array > MAX_ARRAYS)
+      goto fail;
+   st_binary_read_bytes(r, v->array_sizes,
+                        v->next_array * sizeof(v->array_sizes[0]));
+   v->num_address_regs = st_binary_read_uint32(r);
+   v->samplers_used = st_binary_read_uint32(r);
+   v->indirect_addr_consts = st_binary_read_uint32(r);
+   if (v->num_address_regs > 1)
+      goto fail;
+
+   {
+      unsigned key_size = st_binary_read_uint32(r);
+      const void *key_data = st_binary_read(r, key_size);
+
+      if (key_data)
+         st_shader_cache_key_append(&v->cache_key, key_data, key_size);
+   }
+
+   {
+      unsigned num_immediates = st_binary_read_uint32(r);
+
+      for (unsigned i = 0; i < num_immediates && !r->error; i++) {
+         gl_constant_value values[4];
+         int size = st_binary_read_uint32(r);
+         int type = st_binary_read_uint32(r);
+
+         st_binary_read_bytes(r, values, sizeof(values));
+         if (size < 1 || size > 4)
+            goto fail;
+
+         immediate_storage *imm =
+            new(v->mem_ctx) immediate_storage(values, size, type);
+         v->immediates.push_tail(imm);
+         v->num_immediates++;
+      }
+   }
+
+   {
+      unsigned num_insts = st_binary_read_uint32(r);
+
+      for (unsigned i = 0; i < num_insts && !r->error; i++) {
+         glsl_to_tgsi_instruction *inst =
+            new(v->arena) glsl_to_tgsi_instruction();
+
+         inst->op = st_binary_read_uint32(r);
+         read_dst_reg(r, v->arena, &inst->dst);
+         for (unsigned j = 0; j < Elements(inst->src); j++)
+            read_src_reg(r, v->arena, &inst->src[j]);
+         inst->cond_update = st_binary_read_uint32(r);
+         inst->saturate = st_binary_read_uint32(r);
+         inst->sampler = st_binary_read_uint32(r);
+         inst->tex_target = st_binary_read_uint32(r);
+         inst->tex_shadow = st_binary_read_uint32(r);
+         inst->tex_offset_num_offset = st_binary_read_uint32(r);
+         if (inst->op >= TGSI_OPCODE_LAST ||
+             (unsigned) inst->sampler >= PIPE_MAX_SAMPLERS ||
+             (unsigned) inst->tex_target >= NUM_TEXTURE_TARGETS ||
+             inst->tex_offset_num_offset > MAX_GLSL_TEXTURE_OFFSET)
+            goto fail;
+         st_binary_read_bytes(r, inst->tex_offsets,
+                              inst->tex_offset_num_offset *
+                              sizeof(inst->tex_offsets[0]));
+
+         v->instructions.push_tail(inst);
+      }
+   }
+
+   if (r->error)
+      goto fail;
+
+   /* The binary was saved with the shader cache disabled, so there is no
+    * source key.  The serialized stream identifies the visitor just as well.
+    */
+   if (v->cache_key.size == 0)
+      st_shader_cache_key_append(&v->cache_key, r->data + start,
+                                 r->offset - start);
+
+   return v;
 
+fail:
+   r->error = TRUE;
+   delete v;
+   return NULL;
+}
+
+/* ------------------------- TGSI conversion stuff -------------------------- */
 /**
  * Intermediate state used during shader translation.
  */
@@ -4087,21 +6013,11 @@ struct st_translate {
    const GLuint *inputMapping;
    const GLuint *outputMapping;
 
-   /* For every instruction that contains a label (eg CALL), keep
-    * details so that we can go back afterwards and emit the correct
-    * tgsi instruction number for each label.
-    */
-   struct label *labels;
-   unsigned labels_size;
-   unsigned labels_count;
-
-   /* Keep a record of the tgsi instruction number that each mesa
-    * instruction starts at, will be used to fix up labels after
-    * translation.
+   /* Every glsl_to_tgsi instruction becomes exactly one TGSI instruction,
+    * so the one a label points to is known before it is emitted: it is the
+    * first one plus the index of its glsl_to_tgsi instruction.
     */
-   unsigned *insn;
-   unsigned insn_size;
-   unsigned insn_count;
+   unsigned insn_start;
 
    unsigned procType;  /**< TGSI_PROCESSOR_VERTEX/FRAGMENT */
 
@@ -4116,49 +6032,39 @@ static unsigned mesa_sysval_to_semantic[SYSTEM_VALUE_MAX] = {
 };
 
 /**
- * Make note of a branch to a label in the TGSI code.
- * After we've emitted all instructions, we'll go over the list
- * of labels built here and patch the TGSI code with the actual
- * location of each label.
+ * Size the ureg token buffers for the program, so that they're allocated
+ * once instead of growing while it's translated.  The instruction count is
+ * exact, the operand and declaration counts are upper bounds but for the
+ * few declarations the translation adds by itself.
  */
-static unsigned *get_label(struct st_translate *t, unsigned branch_target)
+static void
+reserve_tokens(struct st_translate *t,
+               const glsl_to_tgsi_visitor *program,
+               const struct gl_program *proginfo,
+               GLuint numInputs, GLuint numOutputs)
 {
-   unsigned i;
-
-   if (t->labels_count + 1 >= t->labels_size) {
-      t->labels_size = 1 << (util_logbase2(t->labels_size) + 1);
-      t->labels = (struct label *)realloc(t->labels, 
-                                          t->labels_size * sizeof(struct label));
-      if (t->labels == NULL) {
-         static unsigned dummy;
-         t->error = TRUE;
-         return &dummy;
-      }
-   }
+   unsigned insn_tokens = 0;
+   unsigned decl_tokens;
 
-   i = t->labels_count++;
-   t->labels[i].branch_target = branch_target;
-   return &t->labels[i].token;
-}
+   foreach_list(node, &program->instructions) {
+      const glsl_to_tgsi_instruction *inst =
+         (const glsl_to_tgsi_instruction *) node;
 
-/**
- * Called prior to emitting the TGSI code for each instruction.
- * Allocate additional space for instructions if needed.
- * Update the insn[] array so the next glsl_to_tgsi_instruction points to
- * the next TGSI instruction.
- */
-static void set_insn_start(struct st_translate *t, unsigned start)
-{
-   if (t->insn_count + 1 >= t->insn_size) {
-      t->insn_size = 1 << (util_logbase2(t->insn_size) + 1);
-      t->insn = (unsigned *)realloc(t->insn, t->insn_size * sizeof(t->insn[0]));
-      if (t->insn == NULL) {
-         t->error = TRUE;
-         return;
-      }
+      /* instruction, label or texture, and an address and a dimension
+       * with its address for each operand, the sampler included
+       */
+      insn_tokens += 2 + inst->tex_offset_num_offset +
+                     (num_inst_dst_regs(inst->op) +
+                      num_inst_src_regs(inst->op) + 1) * 4;
    }
 
-   t->insn[t->insn_count++] = start;
+   decl_tokens = (numInputs + numOutputs) * 4 +
+                 (program->next_temp + program->next_array) * 3 +
+                 program->num_immediates * 5 + 16;
+   if (proginfo->Parameters)
+      decl_tokens += proginfo->Parameters->NumParameters * 5;
+
+   ureg_reserve_tokens(t->ureg, decl_tokens, insn_tokens);
 }
 
 /**
@@ -4361,6 +6267,9 @@ translate_src(struct st_translate *t, const st_src_reg *src_reg)
                       GET_SWZ(src_reg->swizzle, 2) & 0x3,
                       GET_SWZ(src_reg->swizzle, 3) & 0x3);
 
+   if (src_reg->abs)
+      src = ureg_abs(src);
+
    if ((src_reg->negate & 0xf) == NEGATE_XYZW)
       src = ureg_negate(src);
 
@@ -4426,14 +6335,18 @@ compile_tgsi_instruction(struct st_translate *t,
    case TGSI_OPCODE_ELSE:
    case TGSI_OPCODE_ENDLOOP:
    case TGSI_OPCODE_IF:
-   case TGSI_OPCODE_UIF:
+   case TGSI_OPCODE_UIF: {
+      unsigned label;
+
       assert(num_dst == 0);
       ureg_label_insn(ureg,
                       inst->op,
                       src, num_src,
-                      get_label(t, 
-                                inst->op == TGSI_OPCODE_CAL ? inst->function->sig_id : 0));
+                      &label);
+      ureg_fixup_label(ureg, label, t->insn_start +
+                       (inst->op == TGSI_OPCODE_CAL ? inst->function->sig_id : 0));
       return;
+   }
 
    case TGSI_OPCODE_TEX:
    case TGSI_OPCODE_TXB:
@@ -4734,6 +6647,7 @@ st_translate_program(
    struct st_translate *t;
    unsigned i;
    enum pipe_error ret = PIPE_OK;
+   int64_t start = st_compile_stats_enabled() ? os_time_get() : 0;
 
    assert(numInputs <= Elements(t->inputs));
    assert(numOutputs <= Elements(t->outputs));
@@ -4751,6 +6665,8 @@ st_translate_program(
    t->outputMapping = outputMapping;
    t->ureg = ureg;
 
+   reserve_tokens(t, program, proginfo, numInputs, numOutputs);
+
    if (program->shader_program) {
       for (i = 0; i < program->shader_program->NumUserUniformStorage; i++) {
          struct gl_uniform_storage *const storage =
@@ -4960,19 +6876,12 @@ st_translate_program(
 
    /* Emit each instruction in turn:
     */
+   t->insn_start = ureg_get_instruction_number(ureg);
    foreach_iter(exec_list_iterator, iter, program->instructions) {
-      set_insn_start(t, ureg_get_instruction_number(ureg));
       compile_tgsi_instruction(t, (glsl_to_tgsi_instruction *)iter.get(),
                                clamp_color);
    }
 
-   /* Fix up all emitted labels:
-    */
-   for (i = 0; i < t->labels_count; i++) {
-      ureg_fixup_label(ureg, t->labels[i].token,
-                       t->insn[t->labels[i].branch_target]);
-   }
-
    if (program->shader_program) {
       /* This has to be done last.  Any operation the can cause
        * prog->ParameterValues to get reallocated (e.g., anything that adds a
@@ -4989,8 +6898,6 @@ st_translate_program(
 
 out:
    if (t) {
-      free(t->insn);
-      free(t->labels);
       free(t->constants);
       free(t->immediates);
 
@@ -5001,18 +6908,51 @@ out:
       free(t);
    }
 
+   if (st_compile_stats_enabled()) {
+      struct st_compile_stats stats;
+
+      st_compile_stats_init(&stats);
+      st_compile_stats_record(&stats,
+                              _mesa_program_target_to_index(proginfo->Target),
+                              ST_COMPILE_TRANSLATE, start, 1,
+                              count_instructions(program));
+      st_compile_stats_report(&stats, "translation",
+                              program->shader_program ?
+                              program->shader_program->Name : 0);
+   }
+
    return ret;
 }
 /* ----------------------------- End TGSI code ------------------------------ */
 
+/**
+ * Shader id of a stage for u_trace: the source checksum of its shader,
+ * as given to the compile spans, or a mix of them if there are several.
+ */
+static GLuint
+stage_trace_id(const struct gl_shader_program *prog, GLenum type)
+{
+   GLuint id = 0;
+
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      if (prog->Shaders[i]->Type == type)
+         id = ((id << 5) | (id >> 27)) ^ prog->Shaders[i]->SourceChecksum;
+   }
+
+   return id;
+}
+
 /**
  * Convert a shader's GLSL IR into a Mesa gl_program, although without 
  * generating Mesa IR.
+ *
+ * \param stats  where to record compile statistics, or NULL
  */
 static struct gl_program *
 get_mesa_program(struct gl_context *ctx,
                  struct gl_shader_program *shader_program,
-                 struct gl_shader *shader)
+                 struct gl_shader *shader,
+                 struct st_compile_stats *stats)
 {
    glsl_to_tgsi_visitor* v;
    struct gl_program *prog;
@@ -5022,6 +6962,8 @@ get_mesa_program(struct gl_context *ctx,
          &ctx->ShaderCompilerOptions[_mesa_shader_type_to_index(shader->Type)];
    struct pipe_screen *pscreen = ctx->st->pipe->screen;
    unsigned ptarget;
+   unsigned stage = _mesa_shader_type_to_index(shader->Type);
+   int64_t start = 0;
 
    switch (shader->Type) {
    case GL_VERTEX_SHADER:
@@ -5057,10 +6999,51 @@ get_mesa_program(struct gl_context *ctx,
 
    v->have_sqrt = pscreen->get_shader_param(pscreen, ptarget,
                                             PIPE_SHADER_CAP_TGSI_SQRT_SUPPORTED);
+   v->have_dp2a = pscreen->get_shader_param(pscreen, ptarget,
+                                            PIPE_SHADER_CAP_TGSI_DP2A_SUPPORTED);
+   v->have_src_abs =
+      pscreen->get_shader_param(pscreen, ptarget,
+                                PIPE_SHADER_CAP_TGSI_SRC_ABS_SUPPORTED);
+
+   {
+      struct tgsi_opcode_cost mad, mul, add, lrp;
+
+      tgsi_get_screen_opcode_cost(pscreen, ptarget, TGSI_OPCODE_MAD, &mad);
+      tgsi_get_screen_opcode_cost(pscreen, ptarget, TGSI_OPCODE_MUL, &mul);
+      tgsi_get_screen_opcode_cost(pscreen, ptarget, TGSI_OPCODE_ADD, &add);
+      tgsi_get_screen_opcode_cost(pscreen, ptarget, TGSI_OPCODE_LRP, &lrp);
+      v->fuse_mad = mad.latency <= mul.latency + add.latency &&
+                    mad.throughput <= mul.throughput + add.throughput;
+      /* The unfused form is ADD for 1 - t, then MUL and MAD. */
+      v->fuse_lrp =
+         lrp.latency <= add.latency + mul.latency + mad.latency &&
+         lrp.throughput <= add.throughput + mul.throughput + mad.throughput;
+   }
+
+   if (st_context(ctx)->shader_cache) {
+      const unsigned backend_flags =
+         (debug_get_option_linear_scan_ra() ? 1 : 0) |
+         (debug_get_option_global_copy_prop() ? 2 : 0) |
+         (v->fuse_mad ? 4 : 0) |
+         (v->fuse_lrp ? 8 : 0) |
+         (v->have_dp2a ? 16 : 0);
+
+      if (st_shader_cache_key_program(ctx, &v->cache_key, shader_program)) {
+         st_shader_cache_key_append(&v->cache_key, &ptarget, sizeof(ptarget));
+         st_shader_cache_key_append(&v->cache_key, &backend_flags,
+                                    sizeof(backend_flags));
+      }
+   }
 
    _mesa_generate_parameters_list_for_uniforms(shader_program, shader,
 					       prog->Parameters);
 
+   if (stats)
+      start = os_time_get();
+
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      v->ir_count = count_ir_nodes(shader->ir);
+
    /* Remove reads from output registers. */
    lower_output_reads(shader->ir);
 
@@ -5096,6 +7079,12 @@ get_mesa_program(struct gl_context *ctx,
       }
    } while (progress);
 
+   if (stats)
+      st_compile_stats_record(stats, stage, ST_COMPILE_VISIT, start, 1,
+                              count_instructions(v));
+
+   v->build_instruction_array();
+
 #if 0
    /* Print out some information (for debugging purposes) used by the 
     * optimization passes. */
@@ -5111,13 +7100,45 @@ get_mesa_program(struct gl_context *ctx,
 #endif
 
    /* Perform optimizations on the instructions in the glsl_to_tgsi_visitor. */
+   if (stats)
+      start = os_time_get();
    v->simplify_cmp();
+   if (stats) {
+      st_compile_stats_record(stats, stage, ST_COMPILE_SIMPLIFY_CMP, start, 1,
+                              count_instructions(v));
+      start = os_time_get();
+   }
+
    v->copy_propagate();
-   while (v->eliminate_dead_code_advanced());
+   if (debug_get_option_global_copy_prop())
+      v->global_copy_propagate();
+   if (stats) {
+      st_compile_stats_record(stats, stage, ST_COMPILE_COPY_PROPAGATE, start,
+                              1, count_instructions(v));
+      start = os_time_get();
+   }
+
+   unsigned dce_iterations = 1;
+   if (!v->eliminate_dead_code_liveness()) {
+      while (v->eliminate_dead_code_advanced())
+         dce_iterations++;
+
+      v->eliminate_dead_code();
+   }
+   if (stats) {
+      st_compile_stats_record(stats, stage, ST_COMPILE_DEAD_CODE, start,
+                              dce_iterations, count_instructions(v));
+      start = os_time_get();
+   }
 
-   v->eliminate_dead_code();
-   v->merge_registers();
-   v->renumber_registers();
+   int num_temps = v->next_temp;
+   if (!debug_get_option_linear_scan_ra() || !v->allocate_temp_registers()) {
+      v->merge_registers();
+      v->renumber_registers();
+   }
+   if (stats)
+      st_compile_stats_record(stats, stage, ST_COMPILE_REG_ALLOC, start, 1,
+                              v->next_temp);
    
    /* Write the END instruction. */
    v->emit(NULL, TGSI_OPCODE_END);
@@ -5129,6 +7150,8 @@ get_mesa_program(struct gl_context *ctx,
              shader_program->Name);
       _mesa_print_ir(shader->ir, NULL);
       printf("\n");
+      printf("Register allocation: %d temporaries reduced to %d (%d saved)\n",
+             num_temps, v->next_temp, num_temps - v->next_temp);
       printf("\n");
       fflush(stdout);
    }
@@ -5158,14 +7181,17 @@ get_mesa_program(struct gl_context *ctx,
    case GL_VERTEX_SHADER:
       stvp = (struct st_vertex_program *)prog;
       stvp->glsl_to_tgsi = v;
+      stvp->trace_id = stage_trace_id(shader_program, shader->Type);
       break;
    case GL_FRAGMENT_SHADER:
       stfp = (struct st_fragment_program *)prog;
       stfp->glsl_to_tgsi = v;
+      stfp->trace_id = stage_trace_id(shader_program, shader->Type);
       break;
    case GL_GEOMETRY_SHADER:
       stgp = (struct st_geometry_program *)prog;
       stgp->glsl_to_tgsi = v;
+      stgp->trace_id = stage_trace_id(shader_program, shader->Type);
       break;
    default:
       assert(!"should not be reached");
@@ -5205,84 +7231,212 @@ st_new_shader_program(struct gl_context *ctx, GLuint name)
 }
 
 /**
- * Link a shader.
- * Called via ctx->Driver.LinkShader()
- * This actually involves converting GLSL IR into an intermediate TGSI-like IR 
- * with code lowering and other optimizations.
+ * Lower and optimize the GLSL IR of one linked shader stage.
+ *
+ * This only touches the stage's own IR and its slot in \c stats, so the
+ * stages of a program can be processed concurrently.
  */
-GLboolean
-st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+static void
+st_lower_and_optimize_stage(struct gl_context *ctx,
+                            struct gl_shader_program *prog, unsigned i,
+                            struct st_compile_stats *stats)
 {
-   assert(prog->LinkStatus);
+   bool progress;
+   unsigned iterations = 0;
+   int64_t start = stats ? os_time_get() : 0;
+   exec_list *ir = prog->_LinkedShaders[i]->ir;
+   const struct gl_shader_compiler_options *options =
+         &ctx->ShaderCompilerOptions[_mesa_shader_type_to_index(prog->_LinkedShaders[i]->Type)];
 
-   for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
-      if (prog->_LinkedShaders[i] == NULL)
-         continue;
+   util_trace_begin("st_lower_and_optimize_stage",
+                    stage_trace_id(prog, prog->_LinkedShaders[i]->Type));
 
-      bool progress;
-      exec_list *ir = prog->_LinkedShaders[i]->ir;
-      const struct gl_shader_compiler_options *options =
-            &ctx->ShaderCompilerOptions[_mesa_shader_type_to_index(prog->_LinkedShaders[i]->Type)];
+   /* If there are forms of indirect addressing that the driver
+    * cannot handle, perform the lowering pass.
+    */
+   if (options->EmitNoIndirectInput || options->EmitNoIndirectOutput ||
+       options->EmitNoIndirectTemp || options->EmitNoIndirectUniform) {
+      lower_variable_index_to_cond_assign(ir,
+                                          options->EmitNoIndirectInput,
+                                          options->EmitNoIndirectOutput,
+                                          options->EmitNoIndirectTemp,
+                                          options->EmitNoIndirectUniform);
+   }
+
+   if (ctx->Extensions.ARB_shading_language_packing) {
+      unsigned lower_inst = LOWER_PACK_SNORM_2x16 |
+                            LOWER_UNPACK_SNORM_2x16 |
+                            LOWER_PACK_UNORM_2x16 |
+                            LOWER_UNPACK_UNORM_2x16 |
+                            LOWER_PACK_SNORM_4x8 |
+                            LOWER_UNPACK_SNORM_4x8 |
+                            LOWER_UNPACK_UNORM_4x8 |
+                            LOWER_PACK_UNORM_4x8 |
+                            LOWER_PACK_HALF_2x16 |
+                            LOWER_UNPACK_HALF_2x16;
+
+      lower_packing_builtins(ir, lower_inst);
+   }
+
+   do_mat_op_to_vec(ir);
+   lower_instructions(ir,
+                      MOD_TO_FRACT |
+                      DIV_TO_MUL_RCP |
+                      EXP_TO_EXP2 |
+                      LOG_TO_LOG2 |
+                      (options->EmitNoPow ? POW_TO_EXP2 : 0) |
+                      (!ctx->Const.NativeIntegers ? INT_DIV_TO_MUL_RCP : 0));
+
+   lower_ubo_reference(prog->_LinkedShaders[i], ir);
+   do_vec_index_to_cond_assign(ir);
+   lower_vector_insert(ir, true);
+   lower_quadop_vector(ir, false);
+   lower_noise(ir);
+   if (options->MaxIfDepth == 0) {
+      lower_discard(ir);
+   }
+
+   if (stats) {
+      st_compile_stats_record(stats, i, ST_COMPILE_LOWER, start, 1,
+                              count_ir_nodes(ir));
+      start = os_time_get();
+   }
+
+   /* The passes run around do_common_optimization() change the IR behind
+    * the tracker's back, so tell it when they make progress.
+    */
+   opt_pass_tracker tracker;
 
-      /* If there are forms of indirect addressing that the driver
-       * cannot handle, perform the lowering pass.
-       */
-      if (options->EmitNoIndirectInput || options->EmitNoIndirectOutput ||
-          options->EmitNoIndirectTemp || options->EmitNoIndirectUniform) {
-         lower_variable_index_to_cond_assign(ir,
-                                             options->EmitNoIndirectInput,
-                                             options->EmitNoIndirectOutput,
-                                             options->EmitNoIndirectTemp,
-                                             options->EmitNoIndirectUniform);
-      }
-
-      if (ctx->Extensions.ARB_shading_language_packing) {
-         unsigned lower_inst = LOWER_PACK_SNORM_2x16 |
-                               LOWER_UNPACK_SNORM_2x16 |
-                               LOWER_PACK_UNORM_2x16 |
-                               LOWER_UNPACK_UNORM_2x16 |
-                               LOWER_PACK_SNORM_4x8 |
-                               LOWER_UNPACK_SNORM_4x8 |
-                               LOWER_UNPACK_UNORM_4x8 |
-                               LOWER_PACK_UNORM_4x8 |
-                               LOWER_PACK_HALF_2x16 |
-                               LOWER_UNPACK_HALF_2x16;
-
-         lower_packing_builtins(ir, lower_inst);
-      }
-
-      do_mat_op_to_vec(ir);
-      lower_instructions(ir,
-                         MOD_TO_FRACT |
-                         DIV_TO_MUL_RCP |
-                         EXP_TO_EXP2 |
-                         LOG_TO_LOG2 |
-                         (options->EmitNoPow ? POW_TO_EXP2 : 0) |
-                         (!ctx->Const.NativeIntegers ? INT_DIV_TO_MUL_RCP : 0));
-
-      lower_ubo_reference(prog->_LinkedShaders[i], ir);
-      do_vec_index_to_cond_assign(ir);
-      lower_vector_insert(ir, true);
-      lower_quadop_vector(ir, false);
-      lower_noise(ir);
-      if (options->MaxIfDepth == 0) {
-         lower_discard(ir);
-      }
-
-      do {
-         progress = false;
-
-         progress = do_lower_jumps(ir, true, true, options->EmitNoMainReturn, options->EmitNoCont, options->EmitNoLoops) || progress;
-
-         progress = do_common_optimization(ir, true, true,
-					   options->MaxUnrollIterations, options)
+   do {
+      progress = false;
+      iterations++;
+
+      if (do_lower_jumps(ir, true, true, options->EmitNoMainReturn, options->EmitNoCont, options->EmitNoLoops)) {
+         tracker.ir_changed();
+         progress = true;
+      }
+
+      progress = do_common_optimization(ir, true, true,
+					   options->MaxUnrollIterations, options,
+					   &tracker)
 	   || progress;
 
-         progress = lower_if_to_cond_assign(ir, options->MaxIfDepth) || progress;
+      if (lower_if_to_cond_assign(ir, options->MaxIfDepth,
+                                  options->MaxFlattenIfCost)) {
+         tracker.ir_changed();
+         progress = true;
+      }
+
+   } while (progress);
+
+   if (stats) {
+      st_compile_stats_record(stats, i, ST_COMPILE_OPTIMIZE, start,
+                              iterations, count_ir_nodes(ir));
+      stats->phase[i][ST_COMPILE_OPTIMIZE].skipped += tracker.skipped;
+   }
+
+   validate_ir_tree(ir);
+
+   util_trace_end();
+}
+
+/**
+ * Replace the IR of a translated stage by its input and output variables.
+ *
+ * Variants are translated from the glsl_to_tgsi instructions, so after
+ * linking only the attribute and fragment data location queries look at
+ * the IR, and only at these variables.  This is the same IR a program
+ * restored from a binary has.
+ */
+static void
+discard_linked_ir(struct gl_shader *sh)
+{
+   exec_list *ir = new(sh) exec_list;
+
+   foreach_list_safe(node, sh->ir) {
+      ir_variable *const var = ((ir_instruction *) node)->as_variable();
+
+      if (var && (var->mode == ir_var_shader_in ||
+                  var->mode == ir_var_shader_out)) {
+         var->remove();
+         ir->push_tail(var);
+      }
+   }
+
+   reparent_ir(ir, ir);
+   ralloc_free(sh->ir);
+   sh->ir = ir;
+}
+
+struct st_link_stage_job {
+   struct gl_context *ctx;
+   struct gl_shader_program *prog;
+   unsigned stage;
+   struct st_compile_stats *stats;
+};
+
+static PIPE_THREAD_ROUTINE(st_link_stage_thread, param)
+{
+   struct st_link_stage_job *job = (struct st_link_stage_job *) param;
+
+   st_lower_and_optimize_stage(job->ctx, job->prog, job->stage, job->stats);
+   return NULL;
+}
+
+static GLboolean
+link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   struct st_compile_stats stats_storage;
+   struct st_compile_stats *stats = NULL;
+
+   assert(prog->LinkStatus);
+
+   if (st_compile_stats_enabled()) {
+      stats = &stats_storage;
+      st_compile_stats_init(stats);
+   }
+
+   if (debug_get_option_parallel_link()) {
+      /* Run every stage but the first on its own thread.  A stage whose
+       * thread can't be created is processed on this one instead.
+       */
+      struct st_link_stage_job jobs[MESA_SHADER_TYPES];
+      pipe_thread threads[MESA_SHADER_TYPES];
+      bool started[MESA_SHADER_TYPES];
+      int first = -1;
+
+      for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+         started[i] = false;
+         if (prog->_LinkedShaders[i] == NULL)
+            continue;
+
+         if (first < 0) {
+            first = i;
+            continue;
+         }
+
+         jobs[i].ctx = ctx;
+         jobs[i].prog = prog;
+         jobs[i].stage = i;
+         jobs[i].stats = stats;
+         threads[i] = pipe_thread_create(st_link_stage_thread, &jobs[i]);
+         started[i] = threads[i] != 0;
+      }
 
-      } while (progress);
+      if (first >= 0)
+         st_lower_and_optimize_stage(ctx, prog, first, stats);
 
-      validate_ir_tree(ir);
+      for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+         if (started[i])
+            pipe_thread_wait(threads[i]);
+         else if (prog->_LinkedShaders[i] != NULL && (int) i != first)
+            st_lower_and_optimize_stage(ctx, prog, i, stats);
+      }
+   } else {
+      for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+         if (prog->_LinkedShaders[i] != NULL)
+            st_lower_and_optimize_stage(ctx, prog, i, stats);
+      }
    }
 
    for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
@@ -5291,7 +7445,11 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       if (prog->_LinkedShaders[i] == NULL)
          continue;
 
-      linked_prog = get_mesa_program(ctx, prog, prog->_LinkedShaders[i]);
+      util_trace_begin("get_mesa_program",
+                       stage_trace_id(prog, prog->_LinkedShaders[i]->Type));
+      linked_prog = get_mesa_program(ctx, prog, prog->_LinkedShaders[i],
+                                     stats);
+      util_trace_end();
 
       if (linked_prog) {
 	 _mesa_reference_program(ctx, &prog->_LinkedShaders[i]->Program,
@@ -5302,6 +7460,8 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 	    _mesa_reference_program(ctx, &prog->_LinkedShaders[i]->Program,
 				    NULL);
             _mesa_reference_program(ctx, &linked_prog, NULL);
+            if (stats)
+               st_compile_stats_report(stats, "link", prog->Name);
             return GL_FALSE;
          }
       }
@@ -5309,9 +7469,42 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       _mesa_reference_program(ctx, &linked_prog, NULL);
    }
 
+   if (ctx->Const.DiscardGLSLIR) {
+      for (unsigned i = 0; i < MESA_SHADER_TYPES; i++) {
+         if (prog->_LinkedShaders[i] != NULL)
+            discard_linked_ir(prog->_LinkedShaders[i]);
+      }
+   }
+
+   if (stats)
+      st_compile_stats_report(stats, "link", prog->Name);
+
    return GL_TRUE;
 }
 
+
+/**
+ * Link a shader.
+ * Called via ctx->Driver.LinkShader()
+ * This actually involves converting GLSL IR into an intermediate TGSI-like IR 
+ * with code lowering and other optimizations.
+ */
+GLboolean
+st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   int64_t start = util_counter_begin();
+   GLboolean ret;
+
+   util_trace_begin("st_link_shader", 0);
+   ret = link_shader(ctx, prog);
+   if (ret)
+      st_store_cached_program(ctx, prog);
+   util_trace_end();
+
+   util_counter_end(UTIL_COUNTER_LINK_USECS, start);
+   return ret;
+}
+
 void
 st_translate_stream_output_info(glsl_to_tgsi_visitor *glsl_to_tgsi,
                                 const GLuint outputMapping[],
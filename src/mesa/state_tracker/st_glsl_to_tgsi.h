@@ -33,6 +33,9 @@ struct gl_context;
 struct gl_shader;
 struct gl_shader_program;
 struct glsl_to_tgsi_visitor;
+struct st_binary_reader;
+struct st_binary_writer;
+struct st_shader_cache_key;
 
 enum pipe_error st_translate_program(
    struct gl_context *ctx,
@@ -54,6 +57,17 @@ enum pipe_error st_translate_program(
    boolean clamp_color);
 
 void free_glsl_to_tgsi_visitor(struct glsl_to_tgsi_visitor *v);
+void st_glsl_to_tgsi_info(const struct glsl_to_tgsi_visitor *v,
+                          GLuint *program_name, int *ir_count);
+boolean st_init_variant_cache_key(const struct glsl_to_tgsi_visitor *v,
+                                  struct st_shader_cache_key *key);
+void st_serialize_glsl_to_tgsi(const struct glsl_to_tgsi_visitor *v,
+                               struct st_binary_writer *w);
+struct glsl_to_tgsi_visitor *
+st_deserialize_glsl_to_tgsi(struct gl_context *ctx,
+                            struct gl_shader_program *shader_program,
+                            struct gl_program *prog,
+                            struct st_binary_reader *r);
 void get_pixel_transfer_visitor(struct st_fragment_program *fp,
                                 struct glsl_to_tgsi_visitor *original,
                                 int scale_and_bias, int pixel_maps);
@@ -455,6 +455,9 @@ st_context_flush(struct st_context_iface *stctxi, unsigned flags,
    if (flags & ST_FLUSH_END_OF_FRAME) {
       pipe_flags |= PIPE_FLUSH_END_OF_FRAME;
    }
+   if (flags & ST_FLUSH_DEFERRED) {
+      pipe_flags |= PIPE_FLUSH_DEFERRED;
+   }
 
    st_flush(st, fence, pipe_flags);
    if (flags & ST_FLUSH_FRONT)
@@ -697,11 +700,19 @@ st_api_make_current(struct st_api *stapi, struct st_context_iface *stctxi,
                     struct st_framebuffer_iface *streadi)
 {
    struct st_context *st = (struct st_context *) stctxi;
+   struct st_context *old_st = (struct st_context *) st_api_get_current(stapi);
    struct st_framebuffer *stdraw, *stread;
    boolean ret;
 
    _glapi_check_multithread();
 
+   /* _mesa_make_current() flushes the context it releases.  That flush
+    * only has to get the commands done eventually, so let the driver
+    * defer it instead of submitting on every context switch.
+    */
+   if (old_st && old_st != st)
+      old_st->releasing = TRUE;
+
    if (st) {
       /* reuse or create the draw fb */
       stdraw = st_framebuffer_reuse_or_create(st->ctx->WinSysDrawBuffer,
@@ -741,6 +752,9 @@ st_api_make_current(struct st_api *stapi, struct st_context_iface *stctxi,
       ret = _mesa_make_current(NULL, NULL, NULL);
    }
 
+   if (old_st)
+      old_st->releasing = FALSE;
+
    return ret;
 }
 
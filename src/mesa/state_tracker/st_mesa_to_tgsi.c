@@ -36,11 +36,13 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_shader_tokens.h"
 #include "pipe/p_state.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_ureg.h"
 #include "st_mesa_to_tgsi.h"
 #include "st_context.h"
 #include "program/prog_instruction.h"
 #include "program/prog_parameter.h"
+#include "util/u_counter.h"
 #include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
@@ -1258,6 +1260,18 @@ out:
 }
 
 
+/**
+ * Count tokens kept by a program or variant in mem-tgsi, until they are
+ * given to st_free_tokens().
+ */
+void
+st_account_tokens(const struct tgsi_token *tokens)
+{
+   if (tokens)
+      util_counter_mem_alloc(UTIL_COUNTER_MEM_TGSI, tgsi_tokens_size(tokens));
+}
+
+
 /**
  * Tokens cannot be free with free otherwise the builtin gallium
  * malloc debugging will get confused.
@@ -1265,5 +1279,7 @@ out:
 void
 st_free_tokens(const struct tgsi_token *tokens)
 {
+   if (tokens)
+      util_counter_mem_free(UTIL_COUNTER_MEM_TGSI, tgsi_tokens_size(tokens));
    ureg_free_tokens(tokens);
 }
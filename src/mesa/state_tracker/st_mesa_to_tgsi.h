@@ -62,6 +62,9 @@ st_translate_mesa_program(
    boolean passthrough_edgeflags,
    boolean clamp_color);
 
+void
+st_account_tokens(const struct tgsi_token *tokens);
+
 void
 st_free_tokens(const struct tgsi_token *tokens);
 
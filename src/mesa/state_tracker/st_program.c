@@ -34,6 +34,7 @@
 #include "main/imports.h"
 #include "main/hash.h"
 #include "main/mtypes.h"
+#include "program/prog_cache.h"
 #include "program/prog_parameter.h"
 #include "program/prog_print.h"
 #include "program/programopt.h"
@@ -42,8 +43,16 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_capture.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_opt.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_transform.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/u_counter.h"
+#include "util/u_trace.h"
 
 #include "st_debug.h"
 #include "st_cb_bitmap.h"
@@ -51,14 +60,311 @@
 #include "st_context.h"
 #include "st_program.h"
 #include "st_mesa_to_tgsi.h"
+#include "st_shader_cache.h"
 #include "cso_cache/cso_context.h"
 
 
 
+DEBUG_GET_ONCE_OPTION(specialize_uniforms, "ST_SPECIALIZE_UNIFORMS", NULL)
+
+/**
+ * Protects the variant lists.  Programs of a share group, including the
+ * generated fixed function programs, may be used by contexts of several
+ * threads.
+ */
+pipe_static_mutex(variants_mutex);
+
+/**
+ * Once a program has this many variants specialized for different
+ * uniform values, the uniforms aren't considered static and further
+ * values use the generic variant.
+ */
+#define ST_MAX_SPECIALIZED_VARIANTS 8
+
+
+/**
+ * Whether \p name is in the comma separated \p list.
+ */
+static GLboolean
+name_in_list(const char *list, const char *name)
+{
+   const size_t len = strlen(name);
+
+   while (*list) {
+      const char *end = strchr(list, ',');
+      const size_t n = end ? (size_t) (end - list) : strlen(list);
+
+      if (n == len && strncmp(list, name, len) == 0)
+         return GL_TRUE;
+      if (!end)
+         break;
+      list = end + 1;
+   }
+
+   return GL_FALSE;
+}
+
+
+/**
+ * Find the parameter slots of the uniforms named by ST_SPECIALIZE_UNIFORMS.
+ */
+static void
+resolve_specialized_uniforms(struct st_specialized_uniforms *spec,
+                             const struct gl_program_parameter_list *params)
+{
+   const char *list = debug_get_option_specialize_uniforms();
+   GLuint i;
+
+   spec->resolved = GL_TRUE;
+   spec->num_slots = 0;
+
+   if (!list || !params || !params->NumParameters)
+      return;
+
+   spec->slots = malloc(params->NumParameters * sizeof(*spec->slots));
+   if (!spec->slots)
+      return;
+
+   for (i = 0; i < params->NumParameters; i++) {
+      const struct gl_program_parameter *p = &params->Parameters[i];
+
+      if (p->Type == PROGRAM_UNIFORM && p->Name && name_in_list(list, p->Name))
+         spec->slots[spec->num_slots++] = i;
+   }
+}
+
+
+static void
+release_specialized_uniforms(struct st_specialized_uniforms *spec)
+{
+   free(spec->slots);
+   memset(spec, 0, sizeof(*spec));
+}
+
+
+/**
+ * Whether ST_SPECIALIZE_UNIFORMS is set.
+ */
+GLboolean
+st_specializing_uniforms(void)
+{
+   return debug_get_option_specialize_uniforms() != NULL;
+}
+
+
+/**
+ * Hash of the current values of the specialized uniforms of a program,
+ * for st_fp_variant_key::uniform_hash and st_vp_variant_key::uniform_hash.
+ * Returns 0 if the program has none, so that it uses the generic variant.
+ */
+GLuint
+st_specialized_uniform_hash(struct st_specialized_uniforms *spec,
+                            const struct gl_program_parameter_list *params)
+{
+   GLuint hash = 2166136261u;
+   GLuint i, c;
+
+   if (!st_specializing_uniforms())
+      return 0;
+
+   if (!spec->resolved)
+      resolve_specialized_uniforms(spec, params);
+
+   if (!spec->num_slots)
+      return 0;
+
+   for (i = 0; i < spec->num_slots; i++) {
+      const gl_constant_value *v = params->ParameterValues[spec->slots[i]];
+
+      for (c = 0; c < 4; c++)
+         hash = (hash ^ v[c].u) * 16777619u;
+   }
+
+   return hash ? hash : 1;
+}
+
+
+/**
+ * Whether a variant's folded uniform values are the current ones.  A
+ * variant whose specialization failed has none and matches any values.
+ */
+static GLboolean
+specialized_values_match(const struct st_specialized_uniforms *spec,
+                         const struct gl_program_parameter_list *params,
+                         const gl_constant_value *values)
+{
+   GLuint i;
+
+   if (!values)
+      return GL_TRUE;
+
+   for (i = 0; i < spec->num_slots; i++) {
+      if (memcmp(params->ParameterValues[spec->slots[i]], values + 4 * i,
+                 4 * sizeof(*values)) != 0)
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
+struct specialize_context
+{
+   struct tgsi_transform_context base;
+   const struct st_specialized_uniforms *spec;
+   const gl_constant_value *values;
+   GLuint num_immediates;      /**< in the original shader */
+   GLboolean first_instruction;
+};
+
+
+static void
+specialize_immediate(struct tgsi_transform_context *tctx,
+                     struct tgsi_full_immediate *imm)
+{
+   struct specialize_context *ctx = (struct specialize_context *) tctx;
+
+   ctx->num_immediates++;
+   tctx->emit_immediate(tctx, imm);
+}
+
+
+/**
+ * Index of the specialized value of constant \p index, or -1.
+ */
+static int
+specialized_slot(const struct st_specialized_uniforms *spec, GLuint index)
+{
+   GLuint i;
+
+   for (i = 0; i < spec->num_slots && spec->slots[i] <= index; i++) {
+      if (spec->slots[i] == index)
+         return i;
+   }
+
+   return -1;
+}
+
+
+static void
+specialize_instruction(struct tgsi_transform_context *tctx,
+                       struct tgsi_full_instruction *inst)
+{
+   struct specialize_context *ctx = (struct specialize_context *) tctx;
+   GLuint i, c;
+
+   if (ctx->first_instruction) {
+      /* one immediate per specialized slot, after the original ones */
+      for (i = 0; i < ctx->spec->num_slots; i++) {
+         struct tgsi_full_immediate imm = tgsi_default_full_immediate();
+
+         imm.Immediate.NrTokens = 1 + 4;
+         for (c = 0; c < 4; c++)
+            imm.u[c].Uint = ctx->values[4 * i + c].u;
+         tctx->emit_immediate(tctx, &imm);
+      }
+      ctx->first_instruction = GL_FALSE;
+   }
+
+   /* Indirect reads still see the values in the constant buffer. */
+   for (i = 0; i < inst->Instruction.NumSrcRegs; i++) {
+      struct tgsi_full_src_register *src = &inst->Src[i];
+      int slot;
+
+      if (src->Register.File != TGSI_FILE_CONSTANT ||
+          src->Register.Indirect ||
+          (src->Register.Dimension &&
+           (src->Dimension.Indirect || src->Dimension.Index != 0)))
+         continue;
+
+      slot = specialized_slot(ctx->spec, src->Register.Index);
+      if (slot < 0)
+         continue;
+
+      src->Register.File = TGSI_FILE_IMMEDIATE;
+      src->Register.Index = ctx->num_immediates + slot;
+      src->Register.Dimension = 0;
+   }
+
+   tctx->emit_instruction(tctx, inst);
+}
+
+
+/**
+ * Replace the direct reads of the specialized uniforms in \p tgsi by
+ * immediates of their current values, and optimize the result so that
+ * the driver sees the constant-folded code.  The values are saved in
+ * \p values_out for st_get_vp_variant() and st_get_fp_variant().
+ */
+static void
+specialize_uniforms(struct pipe_shader_state *tgsi,
+                    const struct st_specialized_uniforms *spec,
+                    const struct gl_program_parameter_list *params,
+                    gl_constant_value **values_out)
+{
+   const GLuint max_tokens = tgsi_num_tokens(tgsi->tokens) +
+                             spec->num_slots * 5 + 16;
+   struct specialize_context ctx;
+   struct tgsi_token *tokens, *optimized;
+   gl_constant_value *values;
+   GLuint i;
+
+   values = malloc(spec->num_slots * 4 * sizeof(*values));
+   tokens = tgsi_alloc_tokens(max_tokens);
+   if (!values || !tokens) {
+      free(values);
+      FREE(tokens);
+      return;
+   }
+
+   for (i = 0; i < spec->num_slots; i++)
+      memcpy(values + 4 * i, params->ParameterValues[spec->slots[i]],
+             4 * sizeof(*values));
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.base.transform_instruction = specialize_instruction;
+   ctx.base.transform_immediate = specialize_immediate;
+   ctx.spec = spec;
+   ctx.values = values;
+   ctx.first_instruction = GL_TRUE;
+
+   if (tgsi_transform_shader(tgsi->tokens, tokens, max_tokens,
+                             &ctx.base) <= 0) {
+      free(values);
+      FREE(tokens);
+      return;
+   }
+
+   optimized = tgsi_optimize(tokens, TGSI_OPT_ALL);
+   if (optimized) {
+      FREE(tokens);
+      tokens = optimized;
+   }
+
+   st_free_tokens(tgsi->tokens);
+   tgsi->tokens = tokens;
+   tgsi->hash = 0;
+   st_account_tokens(tokens);
+   *values_out = values;
+}
+
+
 /**
  * Delete a vertex program variant.  Note the caller must unlink
  * the variant from the linked list.
  */
+/**
+ * Give the current trace span the shader id of the TGSI if the program
+ * has none, as ARB and fixed-function programs don't come from GLSL.
+ */
+static void
+trace_tgsi_id(GLuint trace_id, const struct pipe_shader_state *tgsi)
+{
+   if (!trace_id && util_trace_enabled())
+      util_trace_set_id((uint32_t) tgsi_shader_state_hash(tgsi));
+}
+
+
 static void
 delete_vp_variant(struct st_context *st, struct st_vp_variant *vpv)
 {
@@ -70,8 +376,10 @@ delete_vp_variant(struct st_context *st, struct st_vp_variant *vpv)
       
    if (vpv->tgsi.tokens)
       st_free_tokens(vpv->tgsi.tokens);
-      
+
+   free(vpv->uniform_values);
    free( vpv );
+   util_counter_adjust(UTIL_COUNTER_SHADER_VARIANTS, -1);
 }
 
 
@@ -92,6 +400,8 @@ st_release_vp_variants( struct st_context *st,
    }
 
    stvp->variants = NULL;
+   stvp->num_variants = 0;
+   release_specialized_uniforms(&stvp->specialized);
 }
 
 
@@ -103,13 +413,23 @@ st_release_vp_variants( struct st_context *st,
 static void
 delete_fp_variant(struct st_context *st, struct st_fp_variant *fpv)
 {
-   if (fpv->driver_shader) 
+   if (fpv->next_sharing != fpv) {
+      /* Another variant still uses the driver shader; leave the ring. */
+      struct st_fp_variant *prev = fpv->next_sharing;
+
+      while (prev->next_sharing != fpv)
+         prev = prev->next_sharing;
+      prev->next_sharing = fpv->next_sharing;
+   }
+   else if (fpv->driver_shader)
       cso_delete_fragment_shader(st->cso_context, fpv->driver_shader);
    if (fpv->parameters)
       _mesa_free_parameter_list(fpv->parameters);
    if (fpv->tgsi.tokens)
       st_free_tokens(fpv->tgsi.tokens);
+   free(fpv->uniform_values);
    free(fpv);
+   util_counter_adjust(UTIL_COUNTER_SHADER_VARIANTS, -1);
 }
 
 
@@ -128,6 +448,8 @@ st_release_fp_variants(struct st_context *st, struct st_fragment_program *stfp)
    }
 
    stfp->variants = NULL;
+   stfp->num_variants = 0;
+   release_specialized_uniforms(&stfp->specialized);
 }
 
 
@@ -142,6 +464,7 @@ delete_gp_variant(struct st_context *st, struct st_gp_variant *gpv)
       cso_delete_geometry_shader(st->cso_context, gpv->driver_shader);
       
    free(gpv);
+   util_counter_adjust(UTIL_COUNTER_SHADER_VARIANTS, -1);
 }
 
 
@@ -160,6 +483,7 @@ st_release_gp_variants(struct st_context *st, struct st_geometry_program *stgp)
    }
 
    stgp->variants = NULL;
+   stgp->num_variants = 0;
 }
 
 
@@ -300,8 +624,15 @@ st_translate_vertex_program(struct st_context *st,
    struct st_vp_variant *vpv = CALLOC_STRUCT(st_vp_variant);
    struct pipe_context *pipe = st->pipe;
    struct ureg_program *ureg;
+   struct st_shader_cache_key cache_key;
+   const struct gl_program_parameter_list *params = stvp->Base.Base.Parameters;
+   GLuint num_params = params ? params->NumParameters : 0;
    enum pipe_error error;
    unsigned num_outputs;
+   int64_t start = 0, translated = 0;
+
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      start = os_time_get();
 
    st_prepare_vertex_program(st->ctx, stvp);
 
@@ -310,12 +641,6 @@ st_translate_vertex_program(struct st_context *st,
       _mesa_remove_output_reads(&stvp->Base.Base, PROGRAM_OUTPUT);
    }
 
-   ureg = ureg_create( TGSI_PROCESSOR_VERTEX );
-   if (ureg == NULL) {
-      free(vpv);
-      return NULL;
-   }
-
    vpv->key = *key;
 
    vpv->num_inputs = stvp->num_inputs;
@@ -331,6 +656,39 @@ st_translate_vertex_program(struct st_context *st,
       debug_printf("\n");
    }
 
+   st_shader_cache_key_init(&cache_key);
+   if (stvp->glsl_to_tgsi && st->shader_cache &&
+       st_init_variant_cache_key(stvp->glsl_to_tgsi, &cache_key)) {
+      st_shader_cache_key_append(&cache_key, &key->passthrough_edgeflags,
+                                 sizeof(key->passthrough_edgeflags));
+      st_shader_cache_key_append(&cache_key, &key->clamp_color,
+                                 sizeof(key->clamp_color));
+      st_shader_cache_key_append(&cache_key, &stvp->num_inputs,
+                                 sizeof(stvp->num_inputs));
+      st_shader_cache_key_append(&cache_key, stvp->input_to_index,
+                                 sizeof(stvp->input_to_index));
+      st_shader_cache_key_append(&cache_key, &stvp->num_outputs,
+                                 sizeof(stvp->num_outputs));
+      st_shader_cache_key_append(&cache_key, stvp->result_to_output,
+                                 sizeof(stvp->result_to_output));
+      st_shader_cache_key_append(&cache_key, stvp->output_semantic_name,
+                                 sizeof(stvp->output_semantic_name));
+      st_shader_cache_key_append(&cache_key, stvp->output_semantic_index,
+                                 sizeof(stvp->output_semantic_index));
+      st_shader_cache_key_parameters(&cache_key, params);
+
+      vpv->tgsi.tokens = st_shader_cache_load(st, &cache_key);
+      if (vpv->tgsi.tokens)
+         goto translated;
+   }
+
+   ureg = ureg_create( TGSI_PROCESSOR_VERTEX );
+   if (ureg == NULL) {
+      st_shader_cache_key_fini(&cache_key);
+      free(vpv);
+      return NULL;
+   }
+
    if (stvp->glsl_to_tgsi)
       error = st_translate_program(st->ctx,
                                    TGSI_PROCESSOR_VERTEX,
@@ -379,13 +737,39 @@ st_translate_vertex_program(struct st_context *st,
 
    ureg_destroy( ureg );
 
+   /* A translation that added parameters produced a program that no
+    * longer matches the key it was looked up with.
+    */
+   if (params && params->NumParameters == num_params)
+      st_shader_cache_store(st, &cache_key, vpv->tgsi.tokens);
+
+translated:
+   st_shader_cache_key_fini(&cache_key);
+   st_account_tokens(vpv->tgsi.tokens);
+
    if (stvp->glsl_to_tgsi) {
       st_translate_stream_output_info(stvp->glsl_to_tgsi,
                                       stvp->result_to_output,
                                       &vpv->tgsi.stream_output);
    }
 
+   if (key->uniform_hash)
+      specialize_uniforms(&vpv->tgsi, &stvp->specialized,
+                          stvp->Base.Base.Parameters, &vpv->uniform_values);
+
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      translated = os_time_get();
+
+   trace_tgsi_id(stvp->trace_id, &vpv->tgsi);
+   util_trace_begin("create_vs_state", 0);
    vpv->driver_shader = pipe->create_vs_state(pipe, &vpv->tgsi);
+   util_trace_end();
+   tgsi_capture_tokens(vpv->tgsi.tokens, vpv->tgsi.hash);
+
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      st_print_shader_stats(st, TGSI_PROCESSOR_VERTEX, &stvp->Base.Base,
+                            stvp->glsl_to_tgsi, vpv->tgsi.tokens,
+                            vpv->driver_shader, start, translated);
 
    if (ST_DEBUG & DEBUG_TGSI) {
       tgsi_dump( vpv->tgsi.tokens, 0 );
@@ -399,35 +783,89 @@ fail:
    _mesa_print_program(&stvp->Base.Base);
    debug_assert(0);
 
+   st_shader_cache_key_fini(&cache_key);
    ureg_destroy( ureg );
    return NULL;
 }
 
 
+/**
+ * Vertex program variant key for the current state.
+ */
+void
+st_make_vp_variant_key(struct st_context *st, struct st_vp_variant_key *key)
+{
+   memset(key, 0, sizeof *key);
+   key->st = st;  /* variants are per-context */
+
+   /* When this is true, we will add an extra input to the vertex
+    * shader translation (for edgeflags), an extra output with
+    * edgeflag semantics, and extend the vertex shader to pass through
+    * the input to the output.  We'll need to use similar logic to set
+    * up the extra vertex_element input for edgeflags.
+    */
+   key->passthrough_edgeflags = (st->vertdata_edgeflags && (
+                                 st->ctx->Polygon.FrontMode != GL_FILL ||
+                                 st->ctx->Polygon.BackMode != GL_FILL));
+
+   key->clamp_color = st->clamp_vert_color_in_shader &&
+                      st->ctx->Light._ClampVertexColor;
+}
+
+
 /**
  * Find/create a vertex program variant.
  */
-struct st_vp_variant *
-st_get_vp_variant(struct st_context *st,
-                  struct st_vertex_program *stvp,
-                  const struct st_vp_variant_key *key)
+static struct st_vp_variant *
+get_vp_variant(struct st_context *st,
+               struct st_vertex_program *stvp,
+               const struct st_vp_variant_key *key)
 {
-   struct st_vp_variant *vpv;
+   struct st_vp_variant *vpv, **prevPtr = &stvp->variants;
 
-   /* Search for existing variant */
-   for (vpv = stvp->variants; vpv; vpv = vpv->next) {
-      if (memcmp(&vpv->key, key, sizeof(*key)) == 0) {
+   /* Search for existing variant, and move it to the front of the list
+    * so that the next lookup with the same key finds it first.
+    */
+   for (vpv = stvp->variants; vpv; prevPtr = &vpv->next, vpv = vpv->next) {
+      if (memcmp(&vpv->key, key, sizeof(*key)) == 0 &&
+          (!key->uniform_hash ||
+           specialized_values_match(&stvp->specialized,
+                                    stvp->Base.Base.Parameters,
+                                    vpv->uniform_values))) {
+         if (prevPtr != &stvp->variants) {
+            *prevPtr = vpv->next;
+            vpv->next = stvp->variants;
+            stvp->variants = vpv;
+         }
          break;
       }
    }
 
+   if (!vpv && key->uniform_hash &&
+       stvp->specialized.num_variants >= ST_MAX_SPECIALIZED_VARIANTS) {
+      struct st_vp_variant_key generic = *key;
+
+      generic.uniform_hash = 0;
+      return get_vp_variant(st, stvp, &generic);
+   }
+
    if (!vpv) {
       /* create now */
+      util_trace_begin("st_translate_vertex_program", stvp->trace_id);
       vpv = st_translate_vertex_program(st, stvp, key);
+      util_trace_end();
       if (vpv) {
+         util_counter_add(UTIL_COUNTER_SHADER_COMPILES, 1);
+         util_counter_adjust(UTIL_COUNTER_SHADER_VARIANTS, 1);
+
          /* insert into list */
          vpv->next = stvp->variants;
          stvp->variants = vpv;
+         stvp->num_variants++;
+         if (key->uniform_hash)
+            stvp->specialized.num_variants++;
+         ST_DBG(DEBUG_VARIANTS, "st: vertex program %u has %u variants\n",
+                stvp->Base.Base.Id, stvp->num_variants);
       }
    }
 
@@ -435,6 +873,24 @@ st_get_vp_variant(struct st_context *st,
 }
 
 
+/**
+ * Locked get_vp_variant().
+ */
+struct st_vp_variant *
+st_get_vp_variant(struct st_context *st,
+                  struct st_vertex_program *stvp,
+                  const struct st_vp_variant_key *key)
+{
+   struct st_vp_variant *variant;
+
+   pipe_mutex_lock(variants_mutex);
+   variant = get_vp_variant(st, stvp, key);
+   pipe_mutex_unlock(variants_mutex);
+
+   return variant;
+}
+
+
 static unsigned
 st_translate_interp(enum glsl_interp_qualifier glsl_qual, bool is_color)
 {
@@ -456,6 +912,34 @@ st_translate_interp(enum glsl_interp_qualifier glsl_qual, bool is_color)
 }
 
 
+/**
+ * Find a variant of stfp for the same context whose tokens are identical
+ * to tgsi, so that its driver shader can be reused.  Key bits such as
+ * clamp_color on drivers that clamp in hardware often don't change the
+ * generated code.
+ */
+static struct st_fp_variant *
+find_fp_variant_with_tokens(const struct st_context *st,
+                            const struct st_fragment_program *stfp,
+                            const struct pipe_shader_state *tgsi)
+{
+   const unsigned size = tgsi_num_tokens(tgsi->tokens);
+   struct st_fp_variant *fpv;
+
+   for (fpv = stfp->variants; fpv; fpv = fpv->next) {
+      if (fpv->key.st == st &&
+          fpv->driver_shader &&
+          fpv->tgsi.hash == tgsi->hash &&
+          tgsi_num_tokens(fpv->tgsi.tokens) == size &&
+          memcmp(fpv->tgsi.tokens, tgsi->tokens,
+                 size * sizeof(struct tgsi_token)) == 0)
+         return fpv;
+   }
+
+   return NULL;
+}
+
+
 /**
  * Translate a Mesa fragment shader into a TGSI shader using extra info in
  * the key.
@@ -468,6 +952,8 @@ st_translate_fragment_program(struct st_context *st,
 {
    struct pipe_context *pipe = st->pipe;
    struct st_fp_variant *variant = CALLOC_STRUCT(st_fp_variant);
+   struct st_fragment_program *const orig_stfp = stfp; /* owns the variants */
+   struct st_fp_variant *shared;
    GLboolean deleteFP = GL_FALSE;
 
    GLuint outputMapping[FRAG_RESULT_MAX];
@@ -476,6 +962,8 @@ st_translate_fragment_program(struct st_context *st,
    GLuint attr;
    GLbitfield64 inputsRead;
    struct ureg_program *ureg;
+   struct st_shader_cache_key cache_key;
+   GLuint num_params;
 
    GLboolean write_all = GL_FALSE;
 
@@ -487,10 +975,14 @@ st_translate_fragment_program(struct st_context *st,
    ubyte fs_output_semantic_name[PIPE_MAX_SHADER_OUTPUTS];
    ubyte fs_output_semantic_index[PIPE_MAX_SHADER_OUTPUTS];
    uint fs_num_outputs = 0;
+   int64_t start = 0, translated = 0;
 
    if (!variant)
       return NULL;
 
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      start = os_time_get();
+
    assert(!(key->bitmap && key->drawpixels));
 
    if (key->bitmap) {
@@ -691,8 +1183,52 @@ st_translate_fragment_program(struct st_context *st,
       }
    }
 
+   /* glBitmap and glDrawPixels variants are built from temporary programs
+    * that aren't worth caching.
+    */
+   st_shader_cache_key_init(&cache_key);
+   num_params = stfp->Base.Base.Parameters ?
+      stfp->Base.Base.Parameters->NumParameters : 0;
+   if (stfp->glsl_to_tgsi && st->shader_cache &&
+       !key->bitmap && !key->drawpixels &&
+       st_init_variant_cache_key(stfp->glsl_to_tgsi, &cache_key)) {
+      GLbitfield64 outputsWritten = stfp->Base.Base.OutputsWritten;
+      GLuint clamp_color = key->clamp_color;
+      GLuint depth_layout = stfp->Base.FragDepthLayout;
+
+      st_shader_cache_key_append(&cache_key, &clamp_color,
+                                 sizeof(clamp_color));
+      st_shader_cache_key_append(&cache_key, &inputsRead, sizeof(inputsRead));
+      st_shader_cache_key_append(&cache_key, &fs_num_inputs,
+                                 sizeof(fs_num_inputs));
+      st_shader_cache_key_append(&cache_key, input_semantic_name,
+                                 fs_num_inputs * sizeof(input_semantic_name[0]));
+      st_shader_cache_key_append(&cache_key, input_semantic_index,
+                                 fs_num_inputs * sizeof(input_semantic_index[0]));
+      st_shader_cache_key_append(&cache_key, interpMode,
+                                 fs_num_inputs * sizeof(interpMode[0]));
+      st_shader_cache_key_append(&cache_key, is_centroid,
+                                 fs_num_inputs * sizeof(is_centroid[0]));
+      st_shader_cache_key_append(&cache_key, &outputsWritten,
+                                 sizeof(outputsWritten));
+      st_shader_cache_key_append(&cache_key, &fs_num_outputs,
+                                 sizeof(fs_num_outputs));
+      st_shader_cache_key_append(&cache_key, fs_output_semantic_name,
+                                 fs_num_outputs * sizeof(fs_output_semantic_name[0]));
+      st_shader_cache_key_append(&cache_key, fs_output_semantic_index,
+                                 fs_num_outputs * sizeof(fs_output_semantic_index[0]));
+      st_shader_cache_key_append(&cache_key, &depth_layout,
+                                 sizeof(depth_layout));
+      st_shader_cache_key_parameters(&cache_key, stfp->Base.Base.Parameters);
+
+      variant->tgsi.tokens = st_shader_cache_load(st, &cache_key);
+      if (variant->tgsi.tokens)
+         goto translated;
+   }
+
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL) {
+      st_shader_cache_key_fini(&cache_key);
       free(variant);
       return NULL;
    }
@@ -764,10 +1300,49 @@ st_translate_fragment_program(struct st_context *st,
    variant->tgsi.tokens = ureg_get_tokens( ureg, NULL );
    ureg_destroy( ureg );
 
+   /* emit_wpos() may add state parameters; see st_translate_vertex_program */
+   if (stfp->Base.Base.Parameters &&
+       stfp->Base.Base.Parameters->NumParameters == num_params)
+      st_shader_cache_store(st, &cache_key, variant->tgsi.tokens);
+
+translated:
+   st_shader_cache_key_fini(&cache_key);
+   st_account_tokens(variant->tgsi.tokens);
+
+   if (key->uniform_hash)
+      specialize_uniforms(&variant->tgsi, &stfp->specialized,
+                          stfp->Base.Base.Parameters,
+                          &variant->uniform_values);
+
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      translated = os_time_get();
+
    /* fill in variant */
-   variant->driver_shader = pipe->create_fs_state(pipe, &variant->tgsi);
+   variant->tgsi.hash = tgsi_hash_tokens(variant->tgsi.tokens);
+   shared = find_fp_variant_with_tokens(st, orig_stfp, &variant->tgsi);
+   if (shared) {
+      variant->driver_shader = shared->driver_shader;
+      variant->next_sharing = shared->next_sharing;
+      shared->next_sharing = variant;
+      ST_DBG(DEBUG_VARIANTS, "st: fragment program %u variant shares "
+             "the driver shader of an identical one\n",
+             orig_stfp->Base.Base.Id);
+   }
+   else {
+      trace_tgsi_id(orig_stfp->trace_id, &variant->tgsi);
+      util_trace_begin("create_fs_state", 0);
+      variant->driver_shader = pipe->create_fs_state(pipe, &variant->tgsi);
+      util_trace_end();
+      variant->next_sharing = variant;
+      tgsi_capture_tokens(variant->tgsi.tokens, variant->tgsi.hash);
+   }
    variant->key = *key;
 
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      st_print_shader_stats(st, TGSI_PROCESSOR_FRAGMENT, &stfp->Base.Base,
+                            stfp->glsl_to_tgsi, variant->tgsi.tokens,
+                            variant->driver_shader, start, translated);
+
    if (ST_DEBUG & DEBUG_TGSI) {
       tgsi_dump( variant->tgsi.tokens, 0/*TGSI_DUMP_VERBOSE*/ );
       debug_printf("\n");
@@ -783,30 +1358,73 @@ st_translate_fragment_program(struct st_context *st,
 }
 
 
+/**
+ * Fragment program variant key for the current state.
+ */
+void
+st_make_fp_variant_key(struct st_context *st, struct st_fp_variant_key *key)
+{
+   memset(key, 0, sizeof *key);
+   key->st = st;
+
+   key->clamp_color = st->clamp_frag_color_in_shader &&
+                      st->ctx->Color._ClampFragmentColor;
+}
+
+
 /**
  * Translate fragment program if needed.
  */
-struct st_fp_variant *
-st_get_fp_variant(struct st_context *st,
-                  struct st_fragment_program *stfp,
-                  const struct st_fp_variant_key *key)
+static struct st_fp_variant *
+get_fp_variant(struct st_context *st,
+               struct st_fragment_program *stfp,
+               const struct st_fp_variant_key *key)
 {
-   struct st_fp_variant *fpv;
+   struct st_fp_variant *fpv, **prevPtr = &stfp->variants;
 
-   /* Search for existing variant */
-   for (fpv = stfp->variants; fpv; fpv = fpv->next) {
-      if (memcmp(&fpv->key, key, sizeof(*key)) == 0) {
+   /* Search for existing variant, and move it to the front of the list
+    * so that the next lookup with the same key finds it first.
+    */
+   for (fpv = stfp->variants; fpv; prevPtr = &fpv->next, fpv = fpv->next) {
+      if (memcmp(&fpv->key, key, sizeof(*key)) == 0 &&
+          (!key->uniform_hash ||
+           specialized_values_match(&stfp->specialized,
+                                    stfp->Base.Base.Parameters,
+                                    fpv->uniform_values))) {
+         if (prevPtr != &stfp->variants) {
+            *prevPtr = fpv->next;
+            fpv->next = stfp->variants;
+            stfp->variants = fpv;
+         }
          break;
       }
    }
 
+   if (!fpv && key->uniform_hash &&
+       stfp->specialized.num_variants >= ST_MAX_SPECIALIZED_VARIANTS) {
+      struct st_fp_variant_key generic = *key;
+
+      generic.uniform_hash = 0;
+      return get_fp_variant(st, stfp, &generic);
+   }
+
    if (!fpv) {
       /* create new */
+      util_trace_begin("st_translate_fragment_program", stfp->trace_id);
       fpv = st_translate_fragment_program(st, stfp, key);
+      util_trace_end();
       if (fpv) {
+         util_counter_add(UTIL_COUNTER_SHADER_COMPILES, 1);
+         util_counter_adjust(UTIL_COUNTER_SHADER_VARIANTS, 1);
+
          /* insert into list */
          fpv->next = stfp->variants;
          stfp->variants = fpv;
+         stfp->num_variants++;
+         if (key->uniform_hash)
+            stfp->specialized.num_variants++;
+         ST_DBG(DEBUG_VARIANTS, "st: fragment program %u has %u variants\n",
+                stfp->Base.Base.Id, stfp->num_variants);
       }
    }
 
@@ -814,6 +1432,24 @@ st_get_fp_variant(struct st_context *st,
 }
 
 
+/**
+ * Locked get_fp_variant().
+ */
+struct st_fp_variant *
+st_get_fp_variant(struct st_context *st,
+                  struct st_fragment_program *stfp,
+                  const struct st_fp_variant_key *key)
+{
+   struct st_fp_variant *variant;
+
+   pipe_mutex_lock(variants_mutex);
+   variant = get_fp_variant(st, stfp, key);
+   pipe_mutex_unlock(variants_mutex);
+
+   return variant;
+}
+
+
 /**
  * Translate a geometry program to create a new variant.
  */
@@ -829,6 +1465,7 @@ st_translate_geometry_program(struct st_context *st,
    GLbitfield64 inputsRead;
    GLuint vslot = 0;
    GLuint num_generic = 0;
+   int64_t start = 0, translated = 0;
 
    uint gs_num_inputs = 0;
    uint gs_builtin_inputs = 0;
@@ -848,6 +1485,9 @@ st_translate_geometry_program(struct st_context *st,
    if (!gpv)
       return NULL;
 
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      start = os_time_get();
+
    _mesa_remove_output_reads(&stgp->Base.Base, PROGRAM_OUTPUT);
 
    ureg = ureg_create( TGSI_PROCESSOR_GEOMETRY );
@@ -1051,7 +1691,9 @@ st_translate_geometry_program(struct st_context *st,
 
    stgp->num_inputs = gs_num_inputs;
    stgp->tgsi.tokens = ureg_get_tokens( ureg, NULL );
+   stgp->tgsi.hash = 0;
    ureg_destroy( ureg );
+   st_account_tokens(stgp->tgsi.tokens);
 
    if (stgp->glsl_to_tgsi) {
       st_translate_stream_output_info(stgp->glsl_to_tgsi,
@@ -1059,10 +1701,22 @@ st_translate_geometry_program(struct st_context *st,
                                       &stgp->tgsi.stream_output);
    }
 
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      translated = os_time_get();
+
    /* fill in new variant */
+   trace_tgsi_id(stgp->trace_id, &stgp->tgsi);
+   util_trace_begin("create_gs_state", 0);
    gpv->driver_shader = pipe->create_gs_state(pipe, &stgp->tgsi);
+   util_trace_end();
+   tgsi_capture_tokens(stgp->tgsi.tokens, stgp->tgsi.hash);
    gpv->key = *key;
 
+   if (ST_DEBUG & DEBUG_SHADER_STATS)
+      st_print_shader_stats(st, TGSI_PROCESSOR_GEOMETRY, &stgp->Base.Base,
+                            stgp->glsl_to_tgsi, stgp->tgsi.tokens,
+                            gpv->driver_shader, start, translated);
+
    if ((ST_DEBUG & DEBUG_TGSI) && (ST_DEBUG & DEBUG_MESA)) {
       _mesa_print_program(&stgp->Base.Base);
       debug_printf("\n");
@@ -1077,30 +1731,56 @@ st_translate_geometry_program(struct st_context *st,
 }
 
 
+/**
+ * Geometry program variant key for the current state.
+ */
+void
+st_make_gp_variant_key(struct st_context *st, struct st_gp_variant_key *key)
+{
+   memset(key, 0, sizeof *key);
+   key->st = st;
+}
+
+
 /**
  * Get/create geometry program variant.
  */
-struct st_gp_variant *
-st_get_gp_variant(struct st_context *st,
-                  struct st_geometry_program *stgp,
-                  const struct st_gp_variant_key *key)
+static struct st_gp_variant *
+get_gp_variant(struct st_context *st,
+               struct st_geometry_program *stgp,
+               const struct st_gp_variant_key *key)
 {
-   struct st_gp_variant *gpv;
+   struct st_gp_variant *gpv, **prevPtr = &stgp->variants;
 
-   /* Search for existing variant */
-   for (gpv = stgp->variants; gpv; gpv = gpv->next) {
+   /* Search for existing variant, and move it to the front of the list
+    * so that the next lookup with the same key finds it first.
+    */
+   for (gpv = stgp->variants; gpv; prevPtr = &gpv->next, gpv = gpv->next) {
       if (memcmp(&gpv->key, key, sizeof(*key)) == 0) {
+         if (prevPtr != &stgp->variants) {
+            *prevPtr = gpv->next;
+            gpv->next = stgp->variants;
+            stgp->variants = gpv;
+         }
          break;
       }
    }
 
    if (!gpv) {
       /* create new */
+      util_trace_begin("st_translate_geometry_program", stgp->trace_id);
       gpv = st_translate_geometry_program(st, stgp, key);
+      util_trace_end();
       if (gpv) {
+         util_counter_add(UTIL_COUNTER_SHADER_COMPILES, 1);
+         util_counter_adjust(UTIL_COUNTER_SHADER_VARIANTS, 1);
+
          /* insert into list */
          gpv->next = stgp->variants;
          stgp->variants = gpv;
+         stgp->num_variants++;
+         ST_DBG(DEBUG_VARIANTS, "st: geometry program %u has %u variants\n",
+                stgp->Base.Base.Id, stgp->num_variants);
       }
    }
 
@@ -1108,6 +1788,74 @@ st_get_gp_variant(struct st_context *st,
 }
 
 
+/**
+ * Locked get_gp_variant().
+ */
+struct st_gp_variant *
+st_get_gp_variant(struct st_context *st,
+                  struct st_geometry_program *stgp,
+                  const struct st_gp_variant_key *key)
+{
+   struct st_gp_variant *variant;
+
+   pipe_mutex_lock(variants_mutex);
+   variant = get_gp_variant(st, stgp, key);
+   pipe_mutex_unlock(variants_mutex);
+
+   return variant;
+}
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(precompile, "ST_PRECOMPILE", TRUE)
+
+
+/**
+ * Create the variant of a new program which the current state would
+ * select, so that its translation and the driver's compile happen when
+ * the program is specified or linked rather than on its first draw.
+ * Keys made from state that changes before that draw just cost one
+ * unused variant.
+ *
+ * Only done on the thread the context is current on: the key is read
+ * from the context's state and the compile goes through its pipe, so
+ * programs created on a shader queue thread are left for the first draw.
+ */
+void
+st_precompile_shader_variant(struct st_context *st, struct gl_program *prog)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!debug_get_option_precompile() || ctx != st->ctx)
+      return;
+
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB: {
+      struct st_vp_variant_key key;
+
+      st_make_vp_variant_key(st, &key);
+      st_get_vp_variant(st, (struct st_vertex_program *) prog, &key);
+      break;
+   }
+   case GL_FRAGMENT_PROGRAM_ARB: {
+      struct st_fp_variant_key key;
+
+      st_make_fp_variant_key(st, &key);
+      st_get_fp_variant(st, (struct st_fragment_program *) prog, &key);
+      break;
+   }
+   case MESA_GEOMETRY_PROGRAM: {
+      struct st_gp_variant_key key;
+
+      st_make_gp_variant_key(st, &key);
+      st_get_gp_variant(st, (struct st_geometry_program *) prog, &key);
+      break;
+   }
+   default:
+      break;
+   }
+}
+
+
 
 
 /**
@@ -1179,7 +1927,10 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
                /* unlink from list */
                *prevPtr = next;
                /* destroy this variant */
+               if (vpv->key.uniform_hash)
+                  stvp->specialized.num_variants--;
                delete_vp_variant(st, vpv);
+               stvp->num_variants--;
             }
             else {
                prevPtr = &vpv->next;
@@ -1200,7 +1951,10 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
                /* unlink from list */
                *prevPtr = next;
                /* destroy this variant */
+               if (fpv->key.uniform_hash)
+                  stfp->specialized.num_variants--;
                delete_fp_variant(st, fpv);
+               stfp->num_variants--;
             }
             else {
                prevPtr = &fpv->next;
@@ -1222,6 +1976,7 @@ destroy_program_variants(struct st_context *st, struct gl_program *program)
                *prevPtr = next;
                /* destroy this variant */
                delete_gp_variant(st, gpv);
+               stgp->num_variants--;
             }
             else {
                prevPtr = &gpv->next;
@@ -1289,6 +2044,23 @@ destroy_program_variants_cb(GLuint key, void *data, void *userData)
 }
 
 
+/**
+ * Callbacks for _mesa_program_cache_walk.
+ */
+static void
+destroy_cached_program_variants_cb(void *program, void *data)
+{
+   destroy_program_variants((struct st_context *) data,
+                            (struct gl_program *) program);
+}
+
+static void
+destroy_cached_shader_variants_cb(void *program, void *data)
+{
+   destroy_shader_program_variants_cb(0, program, data);
+}
+
+
 /**
  * Walk over all shaders and programs to delete any variants which
  * belong to the given context.
@@ -1297,13 +2069,24 @@ destroy_program_variants_cb(GLuint key, void *data, void *userData)
 void
 st_destroy_program_variants(struct st_context *st)
 {
+   struct gl_shared_state *shared = st->ctx->Shared;
+
+   pipe_mutex_lock(variants_mutex);
+
    /* ARB vert/frag program */
-   _mesa_HashWalk(st->ctx->Shared->Programs,
-                  destroy_program_variants_cb, st);
+   _mesa_HashWalk(shared->Programs, destroy_program_variants_cb, st);
 
    /* GLSL vert/frag/geom shaders */
-   _mesa_HashWalk(st->ctx->Shared->ShaderObjects,
+   _mesa_HashWalk(shared->ShaderObjects,
                   destroy_shader_program_variants_cb, st);
+
+   /* fixed function programs, which outlive this context */
+   _mesa_program_cache_walk(shared->FixedFuncVertexProgramCache,
+                            destroy_cached_program_variants_cb, st);
+   _mesa_program_cache_walk(shared->FixedFuncFragmentProgramCache,
+                            destroy_cached_shader_variants_cb, st);
+
+   pipe_mutex_unlock(variants_mutex);
 }
 
 
@@ -36,11 +36,26 @@
 
 #include "main/mtypes.h"
 #include "program/program.h"
+#include "program/prog_parameter.h"
 #include "pipe/p_state.h"
 #include "st_context.h"
 #include "st_glsl_to_tgsi.h"
 
 
+/**
+ * The uniforms of a program named by ST_SPECIALIZE_UNIFORMS, whose
+ * values are folded into its vertex and fragment program variants as
+ * immediates.
+ */
+struct st_specialized_uniforms
+{
+   GLboolean resolved;      /**< slots were looked up */
+   GLuint num_slots;
+   GLuint *slots;           /**< parameter indexes, in increasing order */
+   GLuint num_variants;     /**< variants with a nonzero uniform_hash */
+};
+
+
 /** Fragment program variant key */
 struct st_fp_variant_key
 {
@@ -58,6 +73,9 @@ struct st_fp_variant_key
 
    /** for ARB_color_buffer_float */
    GLuint clamp_color:1;
+
+   /** st_specialized_uniform_hash() of the folded uniforms, or 0 */
+   GLuint uniform_hash;
 };
 
 
@@ -74,10 +92,20 @@ struct st_fp_variant
    /** Driver's compiled shader */
    void *driver_shader;
 
+   /**
+    * Ring of the variants whose tokens are identical to these, which all
+    * use the same driver_shader.  Points back to this variant if there are
+    * none.
+    */
+   struct st_fp_variant *next_sharing;
+
    /** For glBitmap variants */
    struct gl_program_parameter_list *parameters;
    uint bitmap_sampler;
 
+   /** Values folded into the code if key.uniform_hash is set */
+   gl_constant_value *uniform_values;
+
    /** next in linked list */
    struct st_fp_variant *next;
 };
@@ -90,8 +118,13 @@ struct st_fragment_program
 {
    struct gl_fragment_program Base;
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
+   /** Shader id of the GLSL source for u_trace, 0 for other programs */
+   GLuint trace_id;
+
+   struct st_specialized_uniforms specialized;
 
    struct st_fp_variant *variants;
+   GLuint num_variants;
 };
 
 
@@ -104,6 +137,9 @@ struct st_vp_variant_key
 
    /** for ARB_color_buffer_float */
    boolean clamp_color;
+
+   /** st_specialized_uniform_hash() of the folded uniforms, or 0 */
+   GLuint uniform_hash;
 };
 
 
@@ -135,6 +171,9 @@ struct st_vp_variant
 
    /** similar to that in st_vertex_program, but with edgeflags info too */
    GLuint num_inputs;
+
+   /** Values folded into the code if key.uniform_hash is set */
+   gl_constant_value *uniform_values;
 };
 
 
@@ -145,6 +184,10 @@ struct st_vertex_program
 {
    struct gl_vertex_program Base;  /**< The Mesa vertex program */
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
+   /** Shader id of the GLSL source for u_trace, 0 for other programs */
+   GLuint trace_id;
+
+   struct st_specialized_uniforms specialized;
 
    /** maps a Mesa VERT_ATTRIB_x to a packed TGSI input index */
    GLuint input_to_index[VERT_ATTRIB_MAX];
@@ -161,6 +204,7 @@ struct st_vertex_program
    /** List of translated variants of this vertex program.
     */
    struct st_vp_variant *variants;
+   GLuint num_variants;
 };
 
 
@@ -194,6 +238,8 @@ struct st_geometry_program
 {
    struct gl_geometry_program Base;  /**< The Mesa geometry program */
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
+   /** Shader id of the GLSL source for u_trace, 0 for other programs */
+   GLuint trace_id;
 
    /** map GP input back to VP output */
    GLuint input_map[PIPE_MAX_SHADER_INPUTS];
@@ -214,6 +260,7 @@ struct st_geometry_program
    struct pipe_shader_state tgsi;
 
    struct st_gp_variant *variants;
+   GLuint num_variants;
 };
 
 
@@ -268,6 +315,25 @@ st_reference_fragprog(struct st_context *st,
 }
 
 
+extern void
+st_make_vp_variant_key(struct st_context *st, struct st_vp_variant_key *key);
+
+extern void
+st_make_fp_variant_key(struct st_context *st, struct st_fp_variant_key *key);
+
+extern void
+st_make_gp_variant_key(struct st_context *st, struct st_gp_variant_key *key);
+
+extern void
+st_precompile_shader_variant(struct st_context *st, struct gl_program *prog);
+
+extern GLboolean
+st_specializing_uniforms(void);
+
+extern GLuint
+st_specialized_uniform_hash(struct st_specialized_uniforms *spec,
+                            const struct gl_program_parameter_list *params);
+
 extern struct st_vp_variant *
 st_get_vp_variant(struct st_context *st,
                   struct st_vertex_program *stvp,
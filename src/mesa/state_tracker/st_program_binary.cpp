@@ -0,0 +1,1486 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Serialization of linked GLSL programs (GL_ARB_get_program_binary).
+ *
+ * A binary is a small header followed by the payload:
+ *
+ *    magic, payload size, payload CRC32
+ *    driver identity: GL version string, screen name and vendor, and a
+ *       CRC32 of the context limits, extensions and compiler options
+ *    program state: version, geometry and vertex state, transform feedback,
+ *       uniform storage, uniform blocks
+ *    for each stage: linked gl_shader (sampler and uniform block state, and
+ *       the input and output variables the attribute and frag data queries
+ *       walk), its gl_program and parameter list, and the glsl_to_tgsi
+ *       instruction stream
+ *
+ * A binary is only accepted by the same driver build and context
+ * configuration that produced it.
+ */
+
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/shaderobj.h"
+#include "main/uniforms.h"
+#include "program/hash_table.h"
+#include "program/ir_to_mesa.h"
+#include "program/prog_parameter.h"
+#include "program/program.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "util/u_disk_cache.h"
+#include "util/u_hash.h"
+#include "util/u_memory.h"
+#include "glsl_types.h"
+#include "ir.h"
+#include "ir_uniform.h"
+
+#include "st_context.h"
+#include "st_glsl_to_tgsi.h"
+#include "st_program.h"
+#include "st_program_binary.h"
+#include "st_shader_cache.h"
+
+
+/** "STB2"; bump the digit whenever the layout changes */
+#define ST_PROGRAM_BINARY_MAGIC 0x32425453
+
+#define ST_PROGRAM_BINARY_HEADER_SIZE (3 * sizeof(uint32_t))
+
+/** Length written for NULL strings */
+#define ST_BINARY_NULL_STRING 0xffffffff
+
+enum st_binary_type_kind {
+   ST_BINARY_TYPE_BUILTIN,
+   ST_BINARY_TYPE_ARRAY
+};
+
+
+/* --------------------------- buffer helpers ----------------------------- */
+
+extern "C" void
+st_binary_writer_init(struct st_binary_writer *w)
+{
+   w->data = NULL;
+   w->size = 0;
+   w->capacity = 0;
+   w->error = FALSE;
+}
+
+
+extern "C" void
+st_binary_writer_fini(struct st_binary_writer *w)
+{
+   FREE(w->data);
+   st_binary_writer_init(w);
+}
+
+
+extern "C" void
+st_binary_write(struct st_binary_writer *w, const void *data, size_t size)
+{
+   if (w->error || size == 0)
+      return;
+
+   if (w->size + size > w->capacity) {
+      size_t capacity = MAX2(w->capacity * 2, w->size + size);
+      uint8_t *new_data = (uint8_t *) REALLOC(w->data, w->capacity, capacity);
+
+      if (!new_data) {
+         w->error = TRUE;
+         return;
+      }
+      w->data = new_data;
+      w->capacity = capacity;
+   }
+
+   memcpy(w->data + w->size, data, size);
+   w->size += size;
+}
+
+
+extern "C" void
+st_binary_write_uint32(struct st_binary_writer *w, uint32_t value)
+{
+   st_binary_write(w, &value, sizeof(value));
+}
+
+
+/**
+ * Strings are stored with their length and terminating zero, so that the
+ * reader can hand out pointers into the buffer.  NULL is allowed.
+ */
+extern "C" void
+st_binary_write_string(struct st_binary_writer *w, const char *str)
+{
+   if (!str) {
+      st_binary_write_uint32(w, ST_BINARY_NULL_STRING);
+      return;
+   }
+
+   size_t len = strlen(str);
+   st_binary_write_uint32(w, len);
+   st_binary_write(w, str, len + 1);
+}
+
+
+extern "C" void
+st_binary_reader_init(struct st_binary_reader *r,
+                      const void *data, size_t size)
+{
+   r->data = (const uint8_t *) data;
+   r->size = size;
+   r->offset = 0;
+   r->error = FALSE;
+}
+
+
+/**
+ * \return a pointer to the next \p size bytes, or NULL if there aren't
+ * that many left.
+ */
+extern "C" const void *
+st_binary_read(struct st_binary_reader *r, size_t size)
+{
+   if (r->error || size > r->size - r->offset) {
+      r->error = TRUE;
+      return NULL;
+   }
+
+   const void *ptr = r->data + r->offset;
+   r->offset += size;
+   return ptr;
+}
+
+
+/** Like st_binary_read(), but copies the data; \p dst is zeroed on error. */
+extern "C" void
+st_binary_read_bytes(struct st_binary_reader *r, void *dst, size_t size)
+{
+   const void *src = st_binary_read(r, size);
+
+   if (src)
+      memcpy(dst, src, size);
+   else
+      memset(dst, 0, size);
+}
+
+
+extern "C" uint32_t
+st_binary_read_uint32(struct st_binary_reader *r)
+{
+   uint32_t value;
+
+   st_binary_read_bytes(r, &value, sizeof(value));
+   return value;
+}
+
+
+extern "C" const char *
+st_binary_read_string(struct st_binary_reader *r)
+{
+   uint32_t len = st_binary_read_uint32(r);
+
+   if (r->error || len == ST_BINARY_NULL_STRING)
+      return NULL;
+
+   if (len >= r->size - r->offset) {
+      r->error = TRUE;
+      return NULL;
+   }
+
+   const char *str = (const char *) st_binary_read(r, len + 1);
+   if (str[len] != '\0') {
+      r->error = TRUE;
+      return NULL;
+   }
+   return str;
+}
+
+
+/**
+ * Read an element count.  Every element takes at least one byte, so a
+ * count bigger than the rest of the buffer is malformed; checking that
+ * here keeps bogus counts from turning into huge allocations.
+ */
+static unsigned
+read_count(struct st_binary_reader *r)
+{
+   uint32_t count = st_binary_read_uint32(r);
+
+   if (count > r->size - r->offset) {
+      r->error = TRUE;
+      return 0;
+   }
+   return count;
+}
+
+
+static void
+write_uint64(struct st_binary_writer *w, uint64_t value)
+{
+   st_binary_write(w, &value, sizeof(value));
+}
+
+
+static uint64_t
+read_uint64(struct st_binary_reader *r)
+{
+   uint64_t value;
+
+   st_binary_read_bytes(r, &value, sizeof(value));
+   return value;
+}
+
+
+static char *
+read_ralloc_string(struct st_binary_reader *r, void *mem_ctx)
+{
+   const char *str = st_binary_read_string(r);
+
+   return str ? ralloc_strdup(mem_ctx, str) : NULL;
+}
+
+
+/* ------------------------------- types ---------------------------------- */
+
+static const glsl_type *
+builtin_type_for_gl_type(GLenum gl_type)
+{
+#define DECL_TYPE(NAME, ...)                            \
+   if (glsl_type::NAME##_type->gl_type == gl_type)      \
+      return glsl_type::NAME##_type;
+#define STRUCT_TYPE(NAME)
+#include "builtin_type_macros.h"
+#undef DECL_TYPE
+#undef STRUCT_TYPE
+
+   return NULL;
+}
+
+
+/**
+ * Everything the linker leaves in the serialized state has a built-in
+ * scalar, vector, matrix or sampler type, or is an array of one;
+ * structures and interface blocks only show up flattened into their
+ * members.  Built-in types are identified by their GL enum.
+ */
+static void
+write_type(struct st_binary_writer *w, const glsl_type *type)
+{
+   if (type->is_array()) {
+      st_binary_write_uint32(w, ST_BINARY_TYPE_ARRAY);
+      st_binary_write_uint32(w, type->length);
+      write_type(w, type->fields.array);
+      return;
+   }
+
+   if (type->is_record() || type->is_interface() ||
+       type->gl_type == GL_INVALID_ENUM) {
+      w->error = TRUE;
+      return;
+   }
+
+   st_binary_write_uint32(w, ST_BINARY_TYPE_BUILTIN);
+   st_binary_write_uint32(w, type->gl_type);
+}
+
+
+static const glsl_type *
+read_type(struct st_binary_reader *r)
+{
+   switch (st_binary_read_uint32(r)) {
+   case ST_BINARY_TYPE_ARRAY: {
+      unsigned length = st_binary_read_uint32(r);
+
+      /* There are no arrays of arrays. */
+      if (st_binary_read_uint32(r) != ST_BINARY_TYPE_BUILTIN)
+         break;
+
+      const glsl_type *element =
+         builtin_type_for_gl_type(st_binary_read_uint32(r));
+      if (!element || r->error)
+         break;
+
+      return glsl_type::get_array_instance(element, length);
+   }
+   case ST_BINARY_TYPE_BUILTIN: {
+      GLenum gl_type = st_binary_read_uint32(r);
+      const glsl_type *type;
+
+      if (gl_type == GL_INVALID_ENUM)
+         break;
+
+      type = builtin_type_for_gl_type(gl_type);
+      if (type && !r->error)
+         return type;
+      break;
+   }
+   }
+
+   r->error = TRUE;
+   return glsl_type::error_type;
+}
+
+
+/* --------------------------- program state ------------------------------ */
+
+static void
+write_driver_identity(struct st_binary_writer *w, struct gl_context *ctx)
+{
+   struct pipe_screen *screen = st_context(ctx)->pipe->screen;
+   uint32_t crc;
+
+   st_binary_write_string(w, ctx->VersionString);
+   st_binary_write_string(w, screen->get_name(screen));
+   st_binary_write_string(w, screen->get_vendor(screen));
+
+   crc = util_hash_crc32(&ctx->Const, sizeof(ctx->Const));
+   crc ^= util_hash_crc32(&ctx->Extensions, sizeof(ctx->Extensions));
+   crc ^= util_hash_crc32(ctx->ShaderCompilerOptions,
+                          sizeof(ctx->ShaderCompilerOptions));
+   st_binary_write_uint32(w, crc);
+}
+
+
+static bool
+check_driver_identity(struct st_binary_reader *r, struct gl_context *ctx)
+{
+   struct st_binary_writer w;
+   bool match;
+
+   st_binary_writer_init(&w);
+   write_driver_identity(&w, ctx);
+
+   const void *data = st_binary_read(r, w.size);
+   match = !w.error && data && memcmp(data, w.data, w.size) == 0;
+   st_binary_writer_fini(&w);
+   return match;
+}
+
+
+static void
+write_transform_feedback(struct st_binary_writer *w,
+                         const struct gl_transform_feedback_info *info)
+{
+   unsigned i;
+
+   st_binary_write_uint32(w, info->NumOutputs);
+   for (i = 0; i < info->NumOutputs; i++) {
+      const struct gl_transform_feedback_output *out = &info->Outputs[i];
+
+      st_binary_write_uint32(w, out->OutputRegister);
+      st_binary_write_uint32(w, out->OutputBuffer);
+      st_binary_write_uint32(w, out->NumComponents);
+      st_binary_write_uint32(w, out->DstOffset);
+      st_binary_write_uint32(w, out->ComponentOffset);
+   }
+
+   st_binary_write_uint32(w, info->NumVarying);
+   for (i = 0; i < (unsigned) info->NumVarying; i++) {
+      st_binary_write_string(w, info->Varyings[i].Name);
+      st_binary_write_uint32(w, info->Varyings[i].Type);
+      st_binary_write_uint32(w, info->Varyings[i].Size);
+   }
+
+   st_binary_write_uint32(w, info->NumBuffers);
+   for (i = 0; i < MAX_FEEDBACK_BUFFERS; i++)
+      st_binary_write_uint32(w, info->BufferStride[i]);
+}
+
+
+static void
+read_transform_feedback(struct st_binary_reader *r,
+                        struct gl_shader_program *shProg)
+{
+   struct gl_transform_feedback_info *info = &shProg->LinkedTransformFeedback;
+   unsigned i;
+
+   info->NumOutputs = read_count(r);
+   info->Outputs = rzalloc_array(shProg, struct gl_transform_feedback_output,
+                                 info->NumOutputs);
+   for (i = 0; i < info->NumOutputs && !r->error; i++) {
+      struct gl_transform_feedback_output *out = &info->Outputs[i];
+
+      out->OutputRegister = st_binary_read_uint32(r);
+      out->OutputBuffer = st_binary_read_uint32(r);
+      out->NumComponents = st_binary_read_uint32(r);
+      out->DstOffset = st_binary_read_uint32(r);
+      out->ComponentOffset = st_binary_read_uint32(r);
+
+      if (out->OutputRegister >= VARYING_SLOT_MAX ||
+          out->OutputBuffer >= MAX_FEEDBACK_BUFFERS)
+         r->error = TRUE;
+   }
+
+   info->NumVarying = read_count(r);
+   info->Varyings = rzalloc_array(shProg,
+                                  struct gl_transform_feedback_varying_info,
+                                  info->NumVarying);
+   for (i = 0; i < (unsigned) info->NumVarying && !r->error; i++) {
+      info->Varyings[i].Name = read_ralloc_string(r, info->Varyings);
+      info->Varyings[i].Type = st_binary_read_uint32(r);
+      info->Varyings[i].Size = st_binary_read_uint32(r);
+   }
+
+   info->NumBuffers = st_binary_read_uint32(r);
+   for (i = 0; i < MAX_FEEDBACK_BUFFERS; i++)
+      info->BufferStride[i] = st_binary_read_uint32(r);
+}
+
+
+/** Number of gl_constant_value slots of a uniform's Mesa storage */
+static unsigned
+uniform_storage_slots(const struct gl_uniform_storage *uni)
+{
+   const unsigned elements = MAX2(uni->array_elements, 1);
+
+   if (uni->type->is_sampler())
+      return elements;
+   return uni->type->component_slots() * elements;
+}
+
+
+static void
+write_uniforms(struct st_binary_writer *w,
+               const struct gl_shader_program *shProg)
+{
+   unsigned num_slots = 0;
+   unsigned i, j;
+
+   st_binary_write_uint32(w, shProg->NumUserUniformStorage);
+
+   for (i = 0; i < shProg->NumUserUniformStorage; i++)
+      num_slots += uniform_storage_slots(&shProg->UniformStorage[i]);
+   st_binary_write_uint32(w, num_slots);
+
+   for (i = 0; i < shProg->NumUserUniformStorage; i++) {
+      const struct gl_uniform_storage *uni = &shProg->UniformStorage[i];
+
+      st_binary_write_string(w, uni->name);
+      write_type(w, uni->type);
+      st_binary_write_uint32(w, uni->array_elements);
+      st_binary_write_uint32(w, uni->initialized);
+      for (j = 0; j < MESA_SHADER_TYPES; j++) {
+         st_binary_write_uint32(w, uni->sampler[j].index);
+         st_binary_write_uint32(w, uni->sampler[j].active);
+      }
+      st_binary_write_uint32(w, uni->block_index);
+      st_binary_write_uint32(w, uni->offset);
+      st_binary_write_uint32(w, uni->matrix_stride);
+      st_binary_write_uint32(w, uni->array_stride);
+      st_binary_write_uint32(w, uni->row_major);
+      st_binary_write(w, uni->storage,
+                      uniform_storage_slots(uni) * sizeof(uni->storage[0]));
+   }
+
+   st_binary_write_uint32(w, shProg->UniformLocationBaseScale);
+}
+
+
+/**
+ * Restore the uniform storage the way link_assign_uniform_locations()
+ * lays it out: one array of gl_uniform_storage and one block of values
+ * hanging off it.
+ */
+static void
+read_uniforms(struct st_binary_reader *r, struct gl_shader_program *shProg)
+{
+   struct gl_uniform_storage *uniforms;
+   union gl_constant_value *data;
+   unsigned num_uniforms, num_slots, slot = 0;
+   unsigned i, j;
+
+   num_uniforms = read_count(r);
+   num_slots = read_count(r);
+   if (r->error)
+      return;
+
+   uniforms = rzalloc_array(shProg, struct gl_uniform_storage, num_uniforms);
+   data = rzalloc_array(uniforms, union gl_constant_value, num_slots);
+   shProg->UniformStorage = uniforms;
+   shProg->UniformHash = new string_to_uint_map;
+
+   for (i = 0; i < num_uniforms && !r->error; i++) {
+      struct gl_uniform_storage *uni = &uniforms[i];
+      unsigned uni_slots;
+
+      uni->name = read_ralloc_string(r, uniforms);
+      uni->type = read_type(r);
+      uni->array_elements = st_binary_read_uint32(r);
+      uni->initialized = st_binary_read_uint32(r);
+      for (j = 0; j < MESA_SHADER_TYPES; j++) {
+         uni->sampler[j].index = st_binary_read_uint32(r);
+         uni->sampler[j].active = st_binary_read_uint32(r);
+      }
+      uni->block_index = st_binary_read_uint32(r);
+      uni->offset = st_binary_read_uint32(r);
+      uni->matrix_stride = st_binary_read_uint32(r);
+      uni->array_stride = st_binary_read_uint32(r);
+      uni->row_major = st_binary_read_uint32(r);
+      if (r->error || !uni->name || uni->type->is_array())
+         break;
+
+      uni_slots = uniform_storage_slots(uni);
+      if (uni_slots > num_slots - slot)
+         break;
+
+      uni->storage = &data[slot];
+      st_binary_read_bytes(r, uni->storage, uni_slots * sizeof(data[0]));
+      slot += uni_slots;
+
+      /* The linker maps exactly the storage names. */
+      shProg->UniformHash->put(i, uni->name);
+
+      /* Storage is only counted once it is complete, so that
+       * _mesa_clear_shader_program_data() never sees a partial entry.
+       */
+      shProg->NumUserUniformStorage = i + 1;
+   }
+
+   if (shProg->NumUserUniformStorage != num_uniforms || slot != num_slots)
+      r->error = TRUE;
+
+   shProg->UniformLocationBaseScale = st_binary_read_uint32(r);
+   if (shProg->UniformLocationBaseScale < 1)
+      r->error = TRUE;
+}
+
+
+static void
+write_uniform_blocks(struct st_binary_writer *w,
+                     const struct gl_uniform_block *blocks,
+                     unsigned num_blocks)
+{
+   unsigned i, j;
+
+   st_binary_write_uint32(w, num_blocks);
+   for (i = 0; i < num_blocks; i++) {
+      const struct gl_uniform_block *block = &blocks[i];
+
+      st_binary_write_string(w, block->Name);
+      st_binary_write_uint32(w, block->NumUniforms);
+      for (j = 0; j < block->NumUniforms; j++) {
+         const struct gl_uniform_buffer_variable *var = &block->Uniforms[j];
+
+         st_binary_write_string(w, var->Name);
+         st_binary_write_string(w, var->IndexName);
+         write_type(w, var->Type);
+         st_binary_write_uint32(w, var->Offset);
+         st_binary_write_uint32(w, var->RowMajor);
+      }
+      st_binary_write_uint32(w, block->Binding);
+      st_binary_write_uint32(w, block->UniformBufferSize);
+      st_binary_write_uint32(w, block->_Packing);
+   }
+}
+
+
+static struct gl_uniform_block *
+read_uniform_blocks(struct st_binary_reader *r, void *mem_ctx,
+                    unsigned *num_blocks)
+{
+   struct gl_uniform_block *blocks;
+   unsigned i, j;
+
+   *num_blocks = read_count(r);
+   if (*num_blocks == 0)
+      return NULL;
+
+   blocks = rzalloc_array(mem_ctx, struct gl_uniform_block, *num_blocks);
+   for (i = 0; i < *num_blocks && !r->error; i++) {
+      struct gl_uniform_block *block = &blocks[i];
+
+      block->Name = read_ralloc_string(r, blocks);
+      block->NumUniforms = read_count(r);
+      block->Uniforms = rzalloc_array(blocks,
+                                      struct gl_uniform_buffer_variable,
+                                      block->NumUniforms);
+      for (j = 0; j < block->NumUniforms && !r->error; j++) {
+         struct gl_uniform_buffer_variable *var = &block->Uniforms[j];
+
+         var->Name = read_ralloc_string(r, blocks);
+         var->IndexName = read_ralloc_string(r, blocks);
+         var->Type = read_type(r);
+         var->Offset = st_binary_read_uint32(r);
+         var->RowMajor = st_binary_read_uint32(r);
+      }
+      block->Binding = st_binary_read_uint32(r);
+      block->UniformBufferSize = st_binary_read_uint32(r);
+      block->_Packing =
+         (enum gl_uniform_block_packing) st_binary_read_uint32(r);
+   }
+
+   return blocks;
+}
+
+
+/* ---------------------------- linked stages ----------------------------- */
+
+static void
+write_linked_shader(struct st_binary_writer *w, const struct gl_shader *sh)
+{
+   unsigned num_vars = 0;
+   unsigned i;
+
+   st_binary_write_uint32(w, sh->Version);
+   st_binary_write_uint32(w, sh->IsES);
+   st_binary_write_uint32(w, sh->num_samplers);
+   st_binary_write_uint32(w, sh->active_samplers);
+   st_binary_write_uint32(w, sh->shadow_samplers);
+   st_binary_write(w, sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   for (i = 0; i < MAX_SAMPLERS; i++)
+      st_binary_write_uint32(w, sh->SamplerTargets[i]);
+   st_binary_write_uint32(w, sh->num_uniform_components);
+   st_binary_write_uint32(w, sh->num_combined_uniform_components);
+   write_uniform_blocks(w, sh->UniformBlocks, sh->NumUniformBlocks);
+   st_binary_write_uint32(w, sh->Geom.VerticesOut);
+   st_binary_write_uint32(w, sh->Geom.InputType);
+   st_binary_write_uint32(w, sh->Geom.OutputType);
+
+   /* Of the IR only the inputs and outputs are kept, for the
+    * glGetActiveAttrib() and glGetFragDataLocation() style queries.
+    */
+   foreach_list(node, sh->ir) {
+      const ir_variable *const var = ((ir_instruction *) node)->as_variable();
+
+      if (var && (var->mode == ir_var_shader_in ||
+                  var->mode == ir_var_shader_out))
+         num_vars++;
+   }
+
+   st_binary_write_uint32(w, num_vars);
+   foreach_list(node, sh->ir) {
+      const ir_variable *const var = ((ir_instruction *) node)->as_variable();
+
+      if (!var || (var->mode != ir_var_shader_in &&
+                   var->mode != ir_var_shader_out))
+         continue;
+
+      st_binary_write_string(w, var->name);
+      st_binary_write_uint32(w, var->mode);
+      write_type(w, var->type);
+      st_binary_write_uint32(w, var->location);
+      st_binary_write_uint32(w, var->index);
+      st_binary_write_uint32(w, var->explicit_location);
+      st_binary_write_uint32(w, var->explicit_index);
+   }
+}
+
+
+static struct gl_shader *
+read_linked_shader(struct st_binary_reader *r, struct gl_context *ctx,
+                   GLenum type)
+{
+   struct gl_shader *sh = ctx->Driver.NewShader(ctx, 0, type);
+   unsigned num_vars, i;
+
+   sh->Version = st_binary_read_uint32(r);
+   sh->IsES = st_binary_read_uint32(r);
+   sh->num_samplers = st_binary_read_uint32(r);
+   sh->active_samplers = st_binary_read_uint32(r);
+   sh->shadow_samplers = st_binary_read_uint32(r);
+   st_binary_read_bytes(r, sh->SamplerUnits, sizeof(sh->SamplerUnits));
+   for (i = 0; i < MAX_SAMPLERS; i++) {
+      GLuint target = st_binary_read_uint32(r);
+
+      if (sh->SamplerUnits[i] >= MAX_COMBINED_TEXTURE_IMAGE_UNITS ||
+          target >= NUM_TEXTURE_TARGETS) {
+         r->error = TRUE;
+         target = 0;
+      }
+      sh->SamplerTargets[i] = (gl_texture_index) target;
+   }
+   sh->num_uniform_components = st_binary_read_uint32(r);
+   sh->num_combined_uniform_components = st_binary_read_uint32(r);
+   sh->UniformBlocks = read_uniform_blocks(r, sh, &sh->NumUniformBlocks);
+   sh->Geom.VerticesOut = st_binary_read_uint32(r);
+   sh->Geom.InputType = st_binary_read_uint32(r);
+   sh->Geom.OutputType = st_binary_read_uint32(r);
+
+   sh->ir = new(sh) exec_list;
+   num_vars = read_count(r);
+   for (i = 0; i < num_vars && !r->error; i++) {
+      const char *name = st_binary_read_string(r);
+      ir_variable_mode mode = (ir_variable_mode) st_binary_read_uint32(r);
+      const glsl_type *var_type = read_type(r);
+
+      if (!name || (mode != ir_var_shader_in && mode != ir_var_shader_out)) {
+         r->error = TRUE;
+         break;
+      }
+
+      ir_variable *var = new(sh) ir_variable(var_type, name, mode);
+      var->location = st_binary_read_uint32(r);
+      var->index = st_binary_read_uint32(r);
+      var->explicit_location = st_binary_read_uint32(r) != 0;
+      var->explicit_index = st_binary_read_uint32(r) != 0;
+      sh->ir->push_tail(var);
+   }
+
+   return sh;
+}
+
+
+static void
+write_parameters(struct st_binary_writer *w,
+                 const struct gl_program_parameter_list *params)
+{
+   unsigned i;
+
+   st_binary_write_uint32(w, params->NumParameters);
+   st_binary_write_uint32(w, params->StateFlags);
+   for (i = 0; i < params->NumParameters; i++) {
+      const struct gl_program_parameter *p = &params->Parameters[i];
+
+      st_binary_write_string(w, p->Name);
+      st_binary_write_uint32(w, p->Type);
+      st_binary_write_uint32(w, p->DataType);
+      st_binary_write_uint32(w, p->Size);
+      st_binary_write_uint32(w, p->Initialized);
+      st_binary_write(w, p->StateIndexes, sizeof(p->StateIndexes));
+   }
+   st_binary_write(w, params->ParameterValues,
+                   params->NumParameters * sizeof(params->ParameterValues[0]));
+}
+
+
+static struct gl_program_parameter_list *
+read_parameters(struct st_binary_reader *r)
+{
+   struct gl_program_parameter_list *params;
+   unsigned num_params = read_count(r);
+   unsigned i;
+
+   params = _mesa_new_parameter_list_sized(num_params);
+   if (!params) {
+      r->error = TRUE;
+      return NULL;
+   }
+
+   params->StateFlags = st_binary_read_uint32(r);
+   for (i = 0; i < num_params && !r->error; i++) {
+      struct gl_program_parameter *p = &params->Parameters[i];
+      const char *name = st_binary_read_string(r);
+      unsigned file = st_binary_read_uint32(r);
+
+      p->Name = name ? strdup(name) : NULL;
+      p->Type = (gl_register_file) (file < PROGRAM_FILE_MAX ? file : 0);
+      p->DataType = st_binary_read_uint32(r);
+      p->Size = st_binary_read_uint32(r);
+      p->Initialized = st_binary_read_uint32(r);
+      st_binary_read_bytes(r, p->StateIndexes, sizeof(p->StateIndexes));
+
+      /* Count it right away so that the name is freed with the list. */
+      params->NumParameters = i + 1;
+
+      if (file >= PROGRAM_FILE_MAX)
+         r->error = TRUE;
+   }
+   st_binary_read_bytes(r, params->ParameterValues,
+                        num_params * sizeof(params->ParameterValues[0]));
+
+   return params;
+}
+
+
+static struct glsl_to_tgsi_visitor **
+program_visitor(struct gl_program *prog)
+{
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB:
+      return &st_vertex_program((struct gl_vertex_program *) prog)->glsl_to_tgsi;
+   case GL_FRAGMENT_PROGRAM_ARB:
+      return &st_fragment_program((struct gl_fragment_program *) prog)->glsl_to_tgsi;
+   case GL_GEOMETRY_PROGRAM_NV:
+      return &st_geometry_program((struct gl_geometry_program *) prog)->glsl_to_tgsi;
+   default:
+      return NULL;
+   }
+}
+
+
+static void
+write_program(struct st_binary_writer *w, struct gl_program *prog)
+{
+   struct glsl_to_tgsi_visitor **v = program_visitor(prog);
+
+   if (!v || !*v || !prog->Parameters) {
+      w->error = TRUE;
+      return;
+   }
+
+   write_uint64(w, prog->InputsRead);
+   write_uint64(w, prog->OutputsWritten);
+   st_binary_write_uint32(w, prog->SystemValuesRead);
+   st_binary_write(w, prog->InputFlags, sizeof(prog->InputFlags));
+   st_binary_write(w, prog->OutputFlags, sizeof(prog->OutputFlags));
+   st_binary_write_uint32(w, prog->SamplersUsed);
+   st_binary_write_uint32(w, prog->ShadowSamplers);
+   st_binary_write_uint32(w, prog->UsesGather);
+   st_binary_write_uint32(w, prog->IndirectRegisterFiles);
+
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB: {
+      struct gl_vertex_program *vp = (struct gl_vertex_program *) prog;
+
+      st_binary_write_uint32(w, vp->IsPositionInvariant);
+      st_binary_write_uint32(w, vp->UsesClipDistance);
+      break;
+   }
+   case GL_GEOMETRY_PROGRAM_NV: {
+      struct gl_geometry_program *gp = (struct gl_geometry_program *) prog;
+
+      st_binary_write_uint32(w, gp->VerticesIn);
+      st_binary_write_uint32(w, gp->VerticesOut);
+      st_binary_write_uint32(w, gp->InputType);
+      st_binary_write_uint32(w, gp->OutputType);
+      st_binary_write_uint32(w, gp->UsesClipDistance);
+      st_binary_write_uint32(w, gp->UsesEndPrimitive);
+      break;
+   }
+   case GL_FRAGMENT_PROGRAM_ARB: {
+      struct gl_fragment_program *fp = (struct gl_fragment_program *) prog;
+      unsigned i;
+
+      st_binary_write_uint32(w, fp->UsesKill);
+      st_binary_write_uint32(w, fp->UsesDFdy);
+      st_binary_write_uint32(w, fp->OriginUpperLeft);
+      st_binary_write_uint32(w, fp->PixelCenterInteger);
+      st_binary_write_uint32(w, fp->FragDepthLayout);
+      for (i = 0; i < VARYING_SLOT_MAX; i++)
+         st_binary_write_uint32(w, fp->InterpQualifier[i]);
+      write_uint64(w, fp->IsCentroid);
+      break;
+   }
+   }
+
+   write_parameters(w, prog->Parameters);
+   st_serialize_glsl_to_tgsi(*v, w);
+}
+
+
+/**
+ * Counterpart of get_mesa_program(): create the gl_program of a linked
+ * stage and hook it up to the program's uniform storage.
+ */
+static struct gl_program *
+read_program(struct st_binary_reader *r, struct gl_context *ctx,
+             struct gl_shader_program *shProg, GLenum target)
+{
+   struct gl_program *prog;
+   struct glsl_to_tgsi_visitor **v;
+
+   prog = ctx->Driver.NewProgram(ctx, target, shProg->Name);
+   if (!prog) {
+      r->error = TRUE;
+      return NULL;
+   }
+
+   prog->InputsRead = read_uint64(r);
+   prog->OutputsWritten = read_uint64(r);
+   prog->SystemValuesRead = st_binary_read_uint32(r);
+   st_binary_read_bytes(r, prog->InputFlags, sizeof(prog->InputFlags));
+   st_binary_read_bytes(r, prog->OutputFlags, sizeof(prog->OutputFlags));
+   prog->SamplersUsed = st_binary_read_uint32(r);
+   prog->ShadowSamplers = st_binary_read_uint32(r);
+   prog->UsesGather = st_binary_read_uint32(r);
+   prog->IndirectRegisterFiles = st_binary_read_uint32(r);
+
+   switch (target) {
+   case GL_VERTEX_PROGRAM_ARB: {
+      struct gl_vertex_program *vp = (struct gl_vertex_program *) prog;
+
+      vp->IsPositionInvariant = st_binary_read_uint32(r);
+      vp->UsesClipDistance = st_binary_read_uint32(r);
+      break;
+   }
+   case GL_GEOMETRY_PROGRAM_NV: {
+      struct gl_geometry_program *gp = (struct gl_geometry_program *) prog;
+
+      gp->VerticesIn = st_binary_read_uint32(r);
+      gp->VerticesOut = st_binary_read_uint32(r);
+      gp->InputType = st_binary_read_uint32(r);
+      gp->OutputType = st_binary_read_uint32(r);
+      gp->UsesClipDistance = st_binary_read_uint32(r);
+      gp->UsesEndPrimitive = st_binary_read_uint32(r);
+      break;
+   }
+   case GL_FRAGMENT_PROGRAM_ARB: {
+      struct gl_fragment_program *fp = (struct gl_fragment_program *) prog;
+      unsigned i;
+
+      fp->UsesKill = st_binary_read_uint32(r);
+      fp->UsesDFdy = st_binary_read_uint32(r);
+      fp->OriginUpperLeft = st_binary_read_uint32(r);
+      fp->PixelCenterInteger = st_binary_read_uint32(r);
+      fp->FragDepthLayout =
+         (enum gl_frag_depth_layout) st_binary_read_uint32(r);
+      for (i = 0; i < VARYING_SLOT_MAX; i++)
+         fp->InterpQualifier[i] =
+            (enum glsl_interp_qualifier) st_binary_read_uint32(r);
+      fp->IsCentroid = read_uint64(r);
+      break;
+   }
+   }
+
+   prog->Parameters = read_parameters(r);
+   if (r->error)
+      return prog;
+
+   v = program_visitor(prog);
+   *v = st_deserialize_glsl_to_tgsi(ctx, shProg, prog, r);
+   if (r->error)
+      return prog;
+
+   _mesa_update_shader_textures_used(shProg, prog);
+   _mesa_associate_uniform_storage(ctx, shProg, prog->Parameters);
+
+   return prog;
+}
+
+
+static const GLenum shader_types[MESA_SHADER_TYPES] = {
+   GL_VERTEX_SHADER,
+   GL_GEOMETRY_SHADER,
+   GL_FRAGMENT_SHADER
+};
+
+
+static void
+write_program_binary(struct st_binary_writer *w, struct gl_context *ctx,
+                     struct gl_shader_program *shProg)
+{
+   unsigned i;
+
+   write_driver_identity(w, ctx);
+
+   st_binary_write_uint32(w, shProg->Version);
+   st_binary_write_uint32(w, shProg->IsES);
+   st_binary_write_uint32(w, shProg->FragDepthLayout);
+   st_binary_write_uint32(w, shProg->Geom.VerticesIn);
+   st_binary_write_uint32(w, shProg->Geom.VerticesOut);
+   st_binary_write_uint32(w, shProg->Geom.InputType);
+   st_binary_write_uint32(w, shProg->Geom.OutputType);
+   st_binary_write_uint32(w, shProg->Geom.UsesClipDistance);
+   st_binary_write_uint32(w, shProg->Geom.ClipDistanceArraySize);
+   st_binary_write_uint32(w, shProg->Geom.UsesEndPrimitive);
+   st_binary_write_uint32(w, shProg->Vert.UsesClipDistance);
+   st_binary_write_uint32(w, shProg->Vert.ClipDistanceArraySize);
+
+   write_transform_feedback(w, &shProg->LinkedTransformFeedback);
+   write_uniforms(w, shProg);
+   write_uniform_blocks(w, shProg->UniformBlocks, shProg->NumUniformBlocks);
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      const int *stage_index = shProg->UniformBlockStageIndex[i];
+
+      st_binary_write_uint32(w, stage_index != NULL);
+      if (stage_index)
+         st_binary_write(w, stage_index,
+                         shProg->NumUniformBlocks * sizeof(stage_index[0]));
+   }
+
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      struct gl_shader *sh = shProg->_LinkedShaders[i];
+
+      st_binary_write_uint32(w, sh != NULL);
+      if (!sh)
+         continue;
+
+      if (!sh->Program) {
+         w->error = TRUE;
+         return;
+      }
+
+      write_linked_shader(w, sh);
+      write_program(w, sh->Program);
+   }
+}
+
+
+/**
+ * Drop the state a previous link or binary left behind, the way
+ * link_shaders() does before linking.  The uniform storage is freed by
+ * _mesa_clear_shader_program_data().
+ */
+static void
+reset_linked_state(struct gl_context *ctx, struct gl_shader_program *shProg)
+{
+   unsigned i;
+
+   ralloc_free(shProg->UniformBlocks);
+   shProg->UniformBlocks = NULL;
+   shProg->NumUniformBlocks = 0;
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      ralloc_free(shProg->UniformBlockStageIndex[i]);
+      shProg->UniformBlockStageIndex[i] = NULL;
+   }
+
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      if (shProg->_LinkedShaders[i] != NULL)
+         ctx->Driver.DeleteShader(ctx, shProg->_LinkedShaders[i]);
+      shProg->_LinkedShaders[i] = NULL;
+   }
+
+   ralloc_free(shProg->LinkedTransformFeedback.Varyings);
+   ralloc_free(shProg->LinkedTransformFeedback.Outputs);
+   memset(&shProg->LinkedTransformFeedback, 0,
+          sizeof(shProg->LinkedTransformFeedback));
+}
+
+
+static bool
+read_program_binary(struct st_binary_reader *r, struct gl_context *ctx,
+                    struct gl_shader_program *shProg)
+{
+   unsigned i;
+
+   if (!check_driver_identity(r, ctx))
+      return false;
+
+   shProg->Version = st_binary_read_uint32(r);
+   shProg->IsES = st_binary_read_uint32(r);
+   shProg->FragDepthLayout =
+      (enum gl_frag_depth_layout) st_binary_read_uint32(r);
+   shProg->Geom.VerticesIn = st_binary_read_uint32(r);
+   shProg->Geom.VerticesOut = st_binary_read_uint32(r);
+   shProg->Geom.InputType = st_binary_read_uint32(r);
+   shProg->Geom.OutputType = st_binary_read_uint32(r);
+   shProg->Geom.UsesClipDistance = st_binary_read_uint32(r);
+   shProg->Geom.ClipDistanceArraySize = st_binary_read_uint32(r);
+   shProg->Geom.UsesEndPrimitive = st_binary_read_uint32(r);
+   shProg->Vert.UsesClipDistance = st_binary_read_uint32(r);
+   shProg->Vert.ClipDistanceArraySize = st_binary_read_uint32(r);
+
+   read_transform_feedback(r, shProg);
+   read_uniforms(r, shProg);
+   shProg->UniformBlocks =
+      read_uniform_blocks(r, shProg, &shProg->NumUniformBlocks);
+   for (i = 0; i < MESA_SHADER_TYPES && !r->error; i++) {
+      if (!st_binary_read_uint32(r))
+         continue;
+
+      shProg->UniformBlockStageIndex[i] =
+         ralloc_array(shProg, int, shProg->NumUniformBlocks);
+      st_binary_read_bytes(r, shProg->UniformBlockStageIndex[i],
+                           shProg->NumUniformBlocks * sizeof(int));
+   }
+
+   for (i = 0; i < MESA_SHADER_TYPES && !r->error; i++) {
+      struct gl_shader *sh;
+      struct gl_program *prog;
+
+      if (!st_binary_read_uint32(r))
+         continue;
+
+      sh = read_linked_shader(r, ctx, shader_types[i]);
+      shProg->_LinkedShaders[i] = sh;
+      if (r->error)
+         break;
+
+      prog = read_program(r, ctx, shProg, _mesa_program_index_to_target(i));
+      _mesa_reference_program(ctx, &sh->Program, prog);
+      _mesa_reference_program(ctx, &prog, NULL);
+   }
+
+   if (r->error || r->offset != r->size || !shProg->LinkStatus)
+      return false;
+
+   for (i = 0; i < MESA_SHADER_TYPES; i++) {
+      struct gl_shader *sh = shProg->_LinkedShaders[i];
+
+      if (sh &&
+          !ctx->Driver.ProgramStringNotify(ctx,
+                                           _mesa_program_index_to_target(i),
+                                           sh->Program))
+         return false;
+   }
+
+   return true;
+}
+
+
+/**
+ * Serialize \p shProg into \p w, header included.
+ */
+static void
+write_binary(struct st_binary_writer *w, struct gl_context *ctx,
+             struct gl_shader_program *shProg)
+{
+   uint32_t header[3];
+
+   memset(header, 0, sizeof(header));
+   st_binary_write(w, header, sizeof(header));
+   write_program_binary(w, ctx, shProg);
+
+   if (w->error || w->size > (size_t) INT_MAX) {
+      w->error = TRUE;
+      return;
+   }
+
+   header[0] = ST_PROGRAM_BINARY_MAGIC;
+   header[1] = w->size - ST_PROGRAM_BINARY_HEADER_SIZE;
+   header[2] = util_hash_crc32(w->data + ST_PROGRAM_BINARY_HEADER_SIZE,
+                               header[1]);
+   memcpy(w->data, header, sizeof(header));
+}
+
+
+/**
+ * Called via ctx->Driver.GetProgramBinary().
+ *
+ * \return the size of the binary, or 0 if the program can't be
+ * serialized.  The binary is only written if it fits into \p bufSize.
+ */
+extern "C" GLsizei
+st_get_program_binary(struct gl_context *ctx,
+                      struct gl_shader_program *shProg,
+                      GLsizei bufSize, GLvoid *binary)
+{
+   struct st_binary_writer w;
+   GLsizei size = 0;
+
+   st_binary_writer_init(&w);
+   write_binary(&w, ctx, shProg);
+
+   if (!w.error) {
+      size = w.size;
+
+      if (binary && size <= bufSize)
+         memcpy(binary, w.data, w.size);
+   }
+
+   st_binary_writer_fini(&w);
+   return size;
+}
+
+
+/**
+ * Called via ctx->Driver.ProgramBinary().  Replaces the linked state of
+ * \p shProg by the one in \p binary.
+ *
+ * \return GL_TRUE if the binary was restored, GL_FALSE if it is malformed
+ * or was produced by a different driver or context configuration, in
+ * which case \p shProg is left unlinked.
+ */
+extern "C" GLboolean
+st_program_binary(struct gl_context *ctx, struct gl_shader_program *shProg,
+                  const GLvoid *binary, GLsizei length)
+{
+   struct st_binary_reader r;
+   uint32_t header[3];
+   bool ok = false;
+
+   reset_linked_state(ctx, shProg);
+
+   if (length >= (GLsizei) ST_PROGRAM_BINARY_HEADER_SIZE) {
+      memcpy(header, binary, sizeof(header));
+      st_binary_reader_init(&r, (const uint8_t *) binary + sizeof(header),
+                            length - sizeof(header));
+
+      if (header[0] == ST_PROGRAM_BINARY_MAGIC &&
+          header[1] == r.size &&
+          header[2] == util_hash_crc32(r.data, r.size)) {
+         shProg->LinkStatus = GL_TRUE;
+         ok = read_program_binary(&r, ctx, shProg);
+      }
+   }
+
+   if (!ok) {
+      reset_linked_state(ctx, shProg);
+      _mesa_clear_shader_program_data(ctx, shProg);
+   }
+
+   return ok;
+}
+
+
+/**
+ * \name Linked program cache
+ *
+ * With MESA_SHADER_CACHE_DIR set, each program st_link_shader() links
+ * from sources is stored as a program binary, keyed by everything the
+ * link depends on.  Linking the same sources with the same link state
+ * again restores the binary instead (st_link_cached_program()).
+ *
+ * The shaders of a stored program are recorded too, so that compiling
+ * them again can be skipped (st_shader_is_cached()).  If a link then
+ * misses the cache, the linker compiles them from their sources after
+ * all, see _mesa_glsl_restore_shader_ir().
+ */
+/*@{*/
+
+struct binding {
+   const char *name;
+   uintptr_t value;
+};
+
+struct binding_list {
+   struct binding *bindings;
+   unsigned count;
+   unsigned capacity;
+   bool error;
+};
+
+
+static void
+add_binding(const void *key, void *data, void *closure)
+{
+   struct binding_list *list = (struct binding_list *) closure;
+
+   if (list->count == list->capacity) {
+      unsigned capacity = MAX2(list->capacity * 2, 8);
+      struct binding *bindings = (struct binding *)
+         REALLOC(list->bindings, list->capacity * sizeof(*bindings),
+                 capacity * sizeof(*bindings));
+
+      if (!bindings) {
+         list->error = true;
+         return;
+      }
+      list->bindings = bindings;
+      list->capacity = capacity;
+   }
+
+   list->bindings[list->count].name = (const char *) key;
+   list->bindings[list->count].value = (uintptr_t) data;
+   list->count++;
+}
+
+
+static int
+compare_bindings(const void *a, const void *b)
+{
+   return strcmp(((const struct binding *) a)->name,
+                 ((const struct binding *) b)->name);
+}
+
+
+/**
+ * Record the bindings of \p map, sorted by name since the order of the
+ * hash table depends on the order they were made in.
+ *
+ * \return false if out of memory.
+ */
+static bool
+key_bindings(struct st_shader_cache_key *key, struct string_to_uint_map *map)
+{
+   struct binding_list list;
+   unsigned i;
+
+   memset(&list, 0, sizeof(list));
+   if (map)
+      map->iterate(add_binding, &list);
+
+   if (list.count)
+      qsort(list.bindings, list.count, sizeof(*list.bindings),
+            compare_bindings);
+
+   st_shader_cache_key_append(key, &list.count, sizeof(list.count));
+   for (i = 0; i < list.count; i++) {
+      st_shader_cache_key_append_string(key, list.bindings[i].name);
+      st_shader_cache_key_append(key, &list.bindings[i].value,
+                                 sizeof(list.bindings[i].value));
+   }
+
+   FREE(list.bindings);
+   return !list.error;
+}
+
+
+/**
+ * Record what linking \p shProg depends on: the attached shaders and the
+ * state set through the API before the link.
+ *
+ * \return false if the program can't be cached.
+ */
+static bool
+key_linked_program(struct gl_context *ctx, struct st_shader_cache_key *key,
+                   struct gl_shader_program *shProg)
+{
+   unsigned i;
+
+   if (!shProg->NumShaders)
+      return false;
+
+   for (i = 0; i < shProg->NumShaders; i++) {
+      if (!shProg->Shaders[i]->Source)
+         return false;
+   }
+
+   st_shader_cache_key_context(ctx, key);
+   st_shader_cache_key_append_string(key, "program");
+
+   st_shader_cache_key_append(key, &shProg->NumShaders,
+                              sizeof(shProg->NumShaders));
+   for (i = 0; i < shProg->NumShaders; i++) {
+      st_shader_cache_key_append(key, &shProg->Shaders[i]->Type,
+                                 sizeof(shProg->Shaders[i]->Type));
+      st_shader_cache_key_append_string(key, shProg->Shaders[i]->Source);
+   }
+
+   if (!key_bindings(key, shProg->AttributeBindings) ||
+       !key_bindings(key, shProg->FragDataBindings) ||
+       !key_bindings(key, shProg->FragDataIndexBindings))
+      return false;
+
+   st_shader_cache_key_append(key, &shProg->TransformFeedback.BufferMode,
+                              sizeof(shProg->TransformFeedback.BufferMode));
+   st_shader_cache_key_append(key, &shProg->TransformFeedback.NumVarying,
+                              sizeof(shProg->TransformFeedback.NumVarying));
+   for (i = 0; i < shProg->TransformFeedback.NumVarying; i++)
+      st_shader_cache_key_append_string(key,
+                                        shProg->TransformFeedback.VaryingNames[i]);
+
+   st_shader_cache_key_append(key, &shProg->Geom.VerticesOut,
+                              sizeof(shProg->Geom.VerticesOut));
+   st_shader_cache_key_append(key, &shProg->Geom.InputType,
+                              sizeof(shProg->Geom.InputType));
+   st_shader_cache_key_append(key, &shProg->Geom.OutputType,
+                              sizeof(shProg->Geom.OutputType));
+
+   return key->size != 0;
+}
+
+
+static void
+key_shader(struct gl_context *ctx, struct st_shader_cache_key *key,
+           const struct gl_shader *sh)
+{
+   st_shader_cache_key_context(ctx, key);
+   st_shader_cache_key_append_string(key, "shader");
+   st_shader_cache_key_append(key, &sh->Type, sizeof(sh->Type));
+   st_shader_cache_key_append_string(key, sh->Source);
+}
+
+
+/**
+ * Store a program st_link_shader() just linked, and mark its shaders as
+ * cached.
+ */
+extern "C" void
+st_store_cached_program(struct gl_context *ctx,
+                        struct gl_shader_program *shProg)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_shader_cache_key key;
+   struct st_binary_writer w;
+   unsigned i;
+
+   if (!st->program_cache)
+      return;
+
+   st_shader_cache_key_init(&key);
+   if (!key_linked_program(ctx, &key, shProg)) {
+      st_shader_cache_key_fini(&key);
+      return;
+   }
+
+   st_binary_writer_init(&w);
+   write_binary(&w, ctx, shProg);
+   if (!w.error)
+      u_disk_cache_put(st->program_cache, key.data, key.size, w.data, w.size);
+   st_binary_writer_fini(&w);
+
+   for (i = 0; i < shProg->NumShaders; i++) {
+      st_shader_cache_key_fini(&key);
+      key_shader(ctx, &key, shProg->Shaders[i]);
+      if (key.size)
+         u_disk_cache_put(st->program_cache, key.data, key.size, "", 0);
+   }
+
+   st_shader_cache_key_fini(&key);
+}
+
+
+/**
+ * Called via ctx->Driver.ShaderIsCached(), possibly on the shader queue's
+ * thread.
+ *
+ * \return GL_TRUE if \p sh compiled and linked successfully into a
+ * program which was stored before.
+ */
+extern "C" GLboolean
+st_shader_is_cached(struct gl_context *ctx, struct gl_shader *sh)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_shader_cache_key key;
+   unsigned size;
+   void *data = NULL;
+   GLboolean hit;
+
+   if (!st->program_cache || !sh->Source)
+      return GL_FALSE;
+
+   st_shader_cache_key_init(&key);
+   key_shader(ctx, &key, sh);
+   if (key.size)
+      data = u_disk_cache_get(st->program_cache, key.data, key.size, &size);
+   st_shader_cache_key_fini(&key);
+
+   hit = data != NULL;
+   FREE(data);
+   return hit;
+}
+
+
+/**
+ * Called via ctx->Driver.LinkCachedProgram().  Restores \p shProg from
+ * the binary stored by an earlier link of the same sources and state,
+ * like glProgramBinary() does.
+ *
+ * \return GL_TRUE on a hit.  On a miss \p shProg is left alone, or
+ * unlinked if the stored binary was rejected.
+ */
+extern "C" GLboolean
+st_link_cached_program(struct gl_context *ctx,
+                       struct gl_shader_program *shProg)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_shader_cache_key key;
+   unsigned size;
+   void *binary = NULL;
+   GLboolean ok;
+
+   if (!st->program_cache)
+      return GL_FALSE;
+
+   st_shader_cache_key_init(&key);
+   if (key_linked_program(ctx, &key, shProg))
+      binary = u_disk_cache_get(st->program_cache, key.data, key.size, &size);
+   st_shader_cache_key_fini(&key);
+
+   if (!binary)
+      return GL_FALSE;
+
+   _mesa_clear_shader_program_data(ctx, shProg);
+   ok = st_program_binary(ctx, shProg, binary, size);
+   FREE(binary);
+
+   return ok;
+}
+
+/*@}*/
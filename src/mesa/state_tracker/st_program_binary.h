@@ -0,0 +1,123 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Serialization of linked GLSL programs (GL_ARB_get_program_binary).
+ *
+ * A binary holds the state st_link_shader() and the GLSL linker leave in
+ * a gl_shader_program: uniform, uniform block and transform feedback
+ * layout, the inputs and outputs of each linked stage, and for each stage
+ * the gl_program with its parameter list and the optimized glsl_to_tgsi
+ * instruction stream.  TGSI is generated from the latter per variant, as
+ * for a freshly linked program, so restoring a binary skips the GLSL
+ * compiler and the IR optimizations.
+ */
+
+#ifndef ST_PROGRAM_BINARY_H
+#define ST_PROGRAM_BINARY_H
+
+#include "main/mtypes.h"
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Growable output buffer of a serializer */
+struct st_binary_writer {
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+   boolean error;  /**< out of memory, or state that can't be serialized */
+};
+
+/** Input buffer of a deserializer */
+struct st_binary_reader {
+   const uint8_t *data;
+   size_t size;
+   size_t offset;
+   boolean error;  /**< read past the end, or malformed data */
+};
+
+
+void
+st_binary_writer_init(struct st_binary_writer *w);
+
+void
+st_binary_writer_fini(struct st_binary_writer *w);
+
+void
+st_binary_write(struct st_binary_writer *w, const void *data, size_t size);
+
+void
+st_binary_write_uint32(struct st_binary_writer *w, uint32_t value);
+
+void
+st_binary_write_string(struct st_binary_writer *w, const char *str);
+
+
+void
+st_binary_reader_init(struct st_binary_reader *r,
+                      const void *data, size_t size);
+
+const void *
+st_binary_read(struct st_binary_reader *r, size_t size);
+
+void
+st_binary_read_bytes(struct st_binary_reader *r, void *dst, size_t size);
+
+uint32_t
+st_binary_read_uint32(struct st_binary_reader *r);
+
+const char *
+st_binary_read_string(struct st_binary_reader *r);
+
+
+GLsizei
+st_get_program_binary(struct gl_context *ctx,
+                      struct gl_shader_program *shProg,
+                      GLsizei bufSize, GLvoid *binary);
+
+GLboolean
+st_program_binary(struct gl_context *ctx, struct gl_shader_program *shProg,
+                  const GLvoid *binary, GLsizei length);
+
+
+void
+st_store_cached_program(struct gl_context *ctx,
+                        struct gl_shader_program *shProg);
+
+GLboolean
+st_shader_is_cached(struct gl_context *ctx, struct gl_shader *sh);
+
+GLboolean
+st_link_cached_program(struct gl_context *ctx,
+                       struct gl_shader_program *shProg);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_PROGRAM_BINARY_H */
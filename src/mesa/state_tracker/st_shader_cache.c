@@ -0,0 +1,259 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Persistent cache of the TGSI generated for GLSL program variants.
+ */
+
+#include "main/mtypes.h"
+#include "program/prog_parameter.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/u_disk_cache.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "st_context.h"
+#include "st_shader_cache.h"
+
+
+void
+st_init_shader_cache(struct st_context *st)
+{
+   st->shader_cache = u_disk_cache_create("tgsi");
+   st->program_cache = u_disk_cache_create("program");
+}
+
+
+void
+st_destroy_shader_cache(struct st_context *st)
+{
+   u_disk_cache_destroy(st->shader_cache);
+   st->shader_cache = NULL;
+   u_disk_cache_destroy(st->program_cache);
+   st->program_cache = NULL;
+}
+
+
+void
+st_shader_cache_key_init(struct st_shader_cache_key *key)
+{
+   key->data = NULL;
+   key->size = 0;
+   key->capacity = 0;
+}
+
+
+void
+st_shader_cache_key_fini(struct st_shader_cache_key *key)
+{
+   FREE(key->data);
+   st_shader_cache_key_init(key);
+}
+
+
+void
+st_shader_cache_key_append(struct st_shader_cache_key *key,
+                           const void *data, unsigned size)
+{
+   if (key->size + size > key->capacity) {
+      unsigned capacity = MAX2(key->capacity * 2, key->size + size);
+      uint8_t *new_data = REALLOC(key->data, key->capacity, capacity);
+
+      if (!new_data) {
+         /* Leave an empty key behind; it never gets looked up. */
+         st_shader_cache_key_fini(key);
+         return;
+      }
+
+      key->data = new_data;
+      key->capacity = capacity;
+   }
+
+   memcpy(key->data + key->size, data, size);
+   key->size += size;
+}
+
+
+void
+st_shader_cache_key_append_string(struct st_shader_cache_key *key,
+                                  const char *str)
+{
+   /* Include the terminator so "ab" + "c" differs from "a" + "bc". */
+   if (str)
+      st_shader_cache_key_append(key, str, strlen(str) + 1);
+   else
+      st_shader_cache_key_append(key, "", 1);
+}
+
+
+/**
+ * Record the driver and the context configuration, which everything the
+ * GLSL compiler and st_link_shader() produce depends on.
+ */
+void
+st_shader_cache_key_context(struct gl_context *ctx,
+                            struct st_shader_cache_key *key)
+{
+   struct pipe_screen *screen = st_context(ctx)->pipe->screen;
+
+   st_shader_cache_key_append_string(key, ctx->VersionString);
+   st_shader_cache_key_append_string(key, screen->get_name(screen));
+   st_shader_cache_key_append_string(key, screen->get_vendor(screen));
+
+   st_shader_cache_key_append(key, &ctx->Const, sizeof(ctx->Const));
+   st_shader_cache_key_append(key, &ctx->Extensions, sizeof(ctx->Extensions));
+   st_shader_cache_key_append(key, ctx->ShaderCompilerOptions,
+                              sizeof(ctx->ShaderCompilerOptions));
+}
+
+
+/**
+ * Record everything the linked program produced by st_link_shader()
+ * depends on.  Programs generated for fixed function state are identified
+ * by their state key instead of sources.
+ *
+ * \return FALSE, with an empty key, if the program can't be cached
+ * because some shader has no sources.
+ */
+boolean
+st_shader_cache_key_program(struct gl_context *ctx,
+                            struct st_shader_cache_key *key,
+                            const struct gl_shader_program *prog)
+{
+   unsigned i;
+
+   if (!prog->FixedFunctionKey) {
+      for (i = 0; i < prog->NumShaders; i++) {
+         if (!prog->Shaders[i]->Source)
+            return FALSE;
+      }
+   }
+
+   st_shader_cache_key_context(ctx, key);
+
+   st_shader_cache_key_append(key, &prog->NumShaders,
+                              sizeof(prog->NumShaders));
+   for (i = 0; i < prog->NumShaders; i++) {
+      st_shader_cache_key_append(key, &prog->Shaders[i]->Type,
+                                 sizeof(prog->Shaders[i]->Type));
+      st_shader_cache_key_append_string(key, prog->Shaders[i]->Source);
+   }
+
+   st_shader_cache_key_append(key, &prog->FixedFunctionKeySize,
+                              sizeof(prog->FixedFunctionKeySize));
+   if (prog->FixedFunctionKey)
+      st_shader_cache_key_append(key, prog->FixedFunctionKey,
+                                 prog->FixedFunctionKeySize);
+
+   st_shader_cache_key_append(key, &prog->TransformFeedback.BufferMode,
+                              sizeof(prog->TransformFeedback.BufferMode));
+   st_shader_cache_key_append(key, &prog->TransformFeedback.NumVarying,
+                              sizeof(prog->TransformFeedback.NumVarying));
+   for (i = 0; i < prog->TransformFeedback.NumVarying; i++)
+      st_shader_cache_key_append_string(key,
+                                        prog->TransformFeedback.VaryingNames[i]);
+
+   for (i = 0; i < prog->NumUniformBlocks; i++)
+      st_shader_cache_key_append(key, &prog->UniformBlocks[i].UniformBufferSize,
+                                 sizeof(prog->UniformBlocks[i].UniformBufferSize));
+
+   return TRUE;
+}
+
+
+/**
+ * Record the layout of a program's parameter list.  Constant values end
+ * up as immediates in the TGSI, so they are part of the key too.
+ */
+void
+st_shader_cache_key_parameters(struct st_shader_cache_key *key,
+                               const struct gl_program_parameter_list *params)
+{
+   unsigned i;
+
+   if (!params) {
+      i = 0;
+      st_shader_cache_key_append(key, &i, sizeof(i));
+      return;
+   }
+
+   st_shader_cache_key_append(key, &params->NumParameters,
+                              sizeof(params->NumParameters));
+   for (i = 0; i < params->NumParameters; i++) {
+      const struct gl_program_parameter *p = &params->Parameters[i];
+
+      st_shader_cache_key_append(key, &p->Type, sizeof(p->Type));
+      st_shader_cache_key_append(key, &p->DataType, sizeof(p->DataType));
+      st_shader_cache_key_append(key, &p->Size, sizeof(p->Size));
+      st_shader_cache_key_append(key, p->StateIndexes, sizeof(p->StateIndexes));
+      if (p->Type == PROGRAM_CONSTANT)
+         st_shader_cache_key_append(key, params->ParameterValues[i],
+                                    sizeof(params->ParameterValues[i]));
+   }
+}
+
+
+/**
+ * Look up the tokens for a variant.  The result is freed with
+ * st_free_tokens() like tokens coming from ureg.
+ */
+const struct tgsi_token *
+st_shader_cache_load(struct st_context *st,
+                     const struct st_shader_cache_key *key)
+{
+   struct tgsi_token *tokens;
+   unsigned size;
+
+   if (!st->shader_cache || !key->size)
+      return NULL;
+
+   tokens = u_disk_cache_get(st->shader_cache, key->data, key->size, &size);
+   if (!tokens)
+      return NULL;
+
+   /* Reject a truncated or foreign blob rather than hand it to a driver. */
+   if (size < sizeof(struct tgsi_header) + sizeof(struct tgsi_processor) ||
+       size % sizeof(struct tgsi_token) != 0 ||
+       tgsi_num_tokens(tokens) * sizeof(struct tgsi_token) != size) {
+      FREE(tokens);
+      return NULL;
+   }
+
+   return tokens;
+}
+
+
+void
+st_shader_cache_store(struct st_context *st,
+                      const struct st_shader_cache_key *key,
+                      const struct tgsi_token *tokens)
+{
+   if (!st->shader_cache || !key->size || !tokens)
+      return;
+
+   u_disk_cache_put(st->shader_cache, key->data, key->size, tokens,
+                    tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+}
@@ -0,0 +1,109 @@
+/**************************************************************************
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Persistent cache of the TGSI generated for GLSL program variants,
+ * enabled by setting MESA_SHADER_CACHE_DIR.
+ *
+ * The key of an entry is built in two steps: when a program is linked,
+ * get_mesa_program() records everything the GLSL compiler's output
+ * depends on (sources, compiler options, context limits and extensions,
+ * driver identity).  When a variant is translated, st_program.c appends
+ * the variant key and the input/output/parameter layout handed to
+ * st_translate_program().  A hit replaces the translation to TGSI.
+ *
+ * Linked programs are cached too, as program binaries, see
+ * st_link_cached_program().
+ */
+
+#ifndef ST_SHADER_CACHE_H
+#define ST_SHADER_CACHE_H
+
+#include "main/mtypes.h"
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct st_context;
+struct tgsi_token;
+
+struct st_shader_cache_key {
+   uint8_t *data;
+   unsigned size;
+   unsigned capacity;
+};
+
+
+void
+st_init_shader_cache(struct st_context *st);
+
+void
+st_destroy_shader_cache(struct st_context *st);
+
+
+void
+st_shader_cache_key_init(struct st_shader_cache_key *key);
+
+void
+st_shader_cache_key_fini(struct st_shader_cache_key *key);
+
+void
+st_shader_cache_key_append(struct st_shader_cache_key *key,
+                           const void *data, unsigned size);
+
+void
+st_shader_cache_key_append_string(struct st_shader_cache_key *key,
+                                  const char *str);
+
+void
+st_shader_cache_key_context(struct gl_context *ctx,
+                            struct st_shader_cache_key *key);
+
+boolean
+st_shader_cache_key_program(struct gl_context *ctx,
+                            struct st_shader_cache_key *key,
+                            const struct gl_shader_program *prog);
+
+void
+st_shader_cache_key_parameters(struct st_shader_cache_key *key,
+                               const struct gl_program_parameter_list *params);
+
+
+const struct tgsi_token *
+st_shader_cache_load(struct st_context *st,
+                     const struct st_shader_cache_key *key);
+
+void
+st_shader_cache_store(struct st_context *st,
+                      const struct st_shader_cache_key *key,
+                      const struct tgsi_token *tokens);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_SHADER_CACHE_H */
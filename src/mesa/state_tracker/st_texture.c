@@ -31,7 +31,10 @@
 #include "st_format.h"
 #include "st_texture.h"
 #include "st_cb_fbo.h"
+#include "st_cb_bufferobjects.h"
+#include "main/bufferobj.h"
 #include "main/enums.h"
+#include "main/image.h"
 
 #include "pipe/p_state.h"
 #include "pipe/p_context.h"
@@ -196,7 +199,8 @@ st_gl_texture_dims_to_pipe_dims(GLenum texture,
  * Check if a texture image can be pulled into a unified mipmap texture.
  */
 GLboolean
-st_texture_match_image(const struct pipe_resource *pt,
+st_texture_match_image(struct st_context *st,
+                       const struct pipe_resource *pt,
                        const struct gl_texture_image *image)
 {
    GLuint ptWidth, ptHeight, ptDepth, ptLayers;
@@ -208,7 +212,7 @@ st_texture_match_image(const struct pipe_resource *pt,
 
    /* Check if this image's format matches the established texture's format.
     */
-   if (st_mesa_format_to_pipe_format(image->TexFormat) != pt->format)
+   if (st_mesa_format_to_pipe_format(st, image->TexFormat) != pt->format)
       return GL_FALSE;
 
    st_gl_texture_dims_to_pipe_dims(image->TexObject->Target,
@@ -314,6 +318,77 @@ st_texture_image_data(struct st_context *st,
 }
 
 
+/**
+ * Upload the pixels of a pixel unpack buffer, which must already be in
+ * the format of \p dst, into the given region without converting them.
+ * The driver copies straight out of the buffer resource.
+ *
+ * \param box  the region in gallium coordinates; for 1D array textures
+ *             the layers are the rows of the GL image
+ * \return GL_FALSE if there's no unpack buffer or it can't be read here,
+ *         in which case nothing was uploaded
+ */
+GLboolean
+st_texture_image_data_pbo(struct st_context *st,
+                          struct pipe_resource *dst, GLuint level,
+                          const struct pipe_box *box,
+                          GLenum format, GLenum type,
+                          const struct gl_pixelstore_attrib *unpack,
+                          const void *pixels)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_resource *buf;
+   struct pipe_transfer *transfer;
+   const GLboolean is_1d_array = dst->target == PIPE_TEXTURE_1D_ARRAY;
+   const GLint height = is_1d_array ? box->depth : box->height;
+   const GLint depth = is_1d_array ? 1 : box->depth;
+   GLint row_stride, layer_stride;
+   uintptr_t start, end;
+   const GLubyte *map;
+
+   if (!_mesa_is_bufferobj(unpack->BufferObj) ||
+       _mesa_bufferobj_mapped(unpack->BufferObj))
+      return GL_FALSE;
+
+   buf = st_buffer_object(unpack->BufferObj)->buffer;
+   if (!buf)
+      return GL_FALSE;
+
+   st_bufferobj_sync(st, st_buffer_object(unpack->BufferObj));
+
+   row_stride = _mesa_image_row_stride(unpack, box->width, format, type);
+   if (is_1d_array)
+      layer_stride = row_stride;
+   else
+      layer_stride = _mesa_image_image_stride(unpack, box->width, height,
+                                              format, type);
+
+   /* pixels is an offset into the buffer; check the whole image lies
+    * within it, the caller reports errors through the regular path.
+    */
+   start = (uintptr_t) _mesa_image_address3d(unpack, pixels, box->width,
+                                             height, format, type, 0, 0, 0);
+   end = (uintptr_t) _mesa_image_address3d(unpack, pixels, box->width,
+                                           height, format, type,
+                                           depth - 1, height - 1, 0) +
+         box->width * util_format_get_blocksize(dst->format);
+   if (row_stride <= 0 || layer_stride <= 0 ||
+       end < start || end > buf->width0)
+      return GL_FALSE;
+
+   map = pipe_buffer_map_range(pipe, buf, start, end - start,
+                               PIPE_TRANSFER_READ, &transfer);
+   if (!map)
+      return GL_FALSE;
+
+   pipe->transfer_inline_write(pipe, dst, level, PIPE_TRANSFER_WRITE,
+                               box, map, row_stride, layer_stride);
+
+   pipe_buffer_unmap(pipe, transfer);
+   return GL_TRUE;
+}
+
+
 /**
  * For debug only: get/print center pixel in the src resource.
  */
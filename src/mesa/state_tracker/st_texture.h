@@ -36,6 +36,7 @@
 
 
 struct pipe_resource;
+struct st_context;
 
 
 /**
@@ -57,6 +58,12 @@ struct st_texture_image
    struct pipe_resource *pt;
 
    struct pipe_transfer *transfer;
+
+   /** Compressed data of a mapped ETC1 fallback image, decoded into
+    * etc_map when unmapped.
+    */
+   GLubyte *etc_data;
+   GLubyte *etc_map;
 };
 
 
@@ -176,7 +183,8 @@ st_gl_texture_dims_to_pipe_dims(GLenum texture,
 /* Check if an image fits into an existing texture object.
  */
 extern GLboolean
-st_texture_match_image(const struct pipe_resource *pt,
+st_texture_match_image(struct st_context *st,
+                       const struct pipe_resource *pt,
                        const struct gl_texture_image *image);
 
 /* Return a pointer to an image within a texture.  Return image stride as
@@ -209,6 +217,17 @@ st_texture_image_data(struct st_context *st,
                       GLuint src_row_pitch, GLuint src_image_pitch);
 
 
+/* Upload an image from a pixel unpack buffer into a texture
+ */
+extern GLboolean
+st_texture_image_data_pbo(struct st_context *st,
+                          struct pipe_resource *dst, GLuint level,
+                          const struct pipe_box *box,
+                          GLenum format, GLenum type,
+                          const struct gl_pixelstore_attrib *unpack,
+                          const void *pixels);
+
+
 /* Copy an image between two textures
  */
 extern void
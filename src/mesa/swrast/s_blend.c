@@ -43,6 +43,7 @@
 #include "s_blend.h"
 #include "s_context.h"
 #include "s_span.h"
+#include "s_span_sse.h"
 
 
 #if defined(USE_MMX_ASM)
@@ -135,7 +136,8 @@ blend_transparency_ubyte(struct gl_context *ctx, GLuint n, const GLubyte mask[],
 
    (void) ctx;
 
-   for (i = 0; i < n; i++) {
+   i = _swrast_sse_blend_transparency_ubyte(n, mask, rgba, dest);
+   for (; i < n; i++) {
       if (mask[i]) {
          const GLint t = rgba[i][ACOMP];  /* t is in [0, 255] */
          if (t == 0) {
@@ -257,7 +259,8 @@ blend_add(struct gl_context *ctx, GLuint n, const GLubyte mask[],
    if (chanType == GL_UNSIGNED_BYTE) {
       GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
       const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
-      for (i=0;i<n;i++) {
+      i = _swrast_sse_blend_add_ubyte(n, mask, rgba, dest);
+      for (; i < n; i++) {
          if (mask[i]) {
             GLint r = rgba[i][RCOMP] + dest[i][RCOMP];
             GLint g = rgba[i][GCOMP] + dest[i][GCOMP];
@@ -320,7 +323,8 @@ blend_min(struct gl_context *ctx, GLuint n, const GLubyte mask[],
    if (chanType == GL_UNSIGNED_BYTE) {
       GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
       const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
-      for (i=0;i<n;i++) {
+      i = _swrast_sse_blend_min_ubyte(n, mask, rgba, dest);
+      for (; i < n; i++) {
          if (mask[i]) {
             rgba[i][RCOMP] = MIN2( rgba[i][RCOMP], dest[i][RCOMP] );
             rgba[i][GCOMP] = MIN2( rgba[i][GCOMP], dest[i][GCOMP] );
@@ -373,7 +377,8 @@ blend_max(struct gl_context *ctx, GLuint n, const GLubyte mask[],
    if (chanType == GL_UNSIGNED_BYTE) {
       GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
       const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
-      for (i=0;i<n;i++) {
+      i = _swrast_sse_blend_max_ubyte(n, mask, rgba, dest);
+      for (; i < n; i++) {
          if (mask[i]) {
             rgba[i][RCOMP] = MAX2( rgba[i][RCOMP], dest[i][RCOMP] );
             rgba[i][GCOMP] = MAX2( rgba[i][GCOMP], dest[i][GCOMP] );
@@ -425,7 +430,8 @@ blend_modulate(struct gl_context *ctx, GLuint n, const GLubyte mask[],
    if (chanType == GL_UNSIGNED_BYTE) {
       GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
       const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
-      for (i=0;i<n;i++) {
+      i = _swrast_sse_blend_modulate_ubyte(n, mask, rgba, dest);
+      for (; i < n; i++) {
          if (mask[i]) {
 	    GLint divtemp;
             rgba[i][RCOMP] = DIV255(rgba[i][RCOMP] * dest[i][RCOMP]);
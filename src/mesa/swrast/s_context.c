@@ -834,6 +834,8 @@ _swrast_DestroyContext( struct gl_context *ctx )
    free(swrast->stencil_temp.buf3);
    free(swrast->stencil_temp.buf4);
 
+   _mesa_free_program_machine(&swrast->FragProgMachine);
+
    free( swrast );
 
    ctx->swrast_context = 0;
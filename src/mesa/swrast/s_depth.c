@@ -34,13 +34,14 @@
 #include "s_context.h"
 #include "s_depth.h"
 #include "s_span.h"
+#include "s_span_sse.h"
 
 
 
 #define Z_TEST(COMPARE)                      \
    do {                                      \
       GLuint i;                              \
-      for (i = 0; i < n; i++) {              \
+      for (i = first; i < n; i++) {          \
          if (mask[i]) {                      \
             if (COMPARE) {                   \
                /* pass */                    \
@@ -71,6 +72,9 @@ depth_test_span16( struct gl_context *ctx, GLuint n,
 {
    const GLboolean write = ctx->Depth.Mask;
    GLuint passed = 0;
+   const GLuint first = _swrast_sse_depth_test_span16(ctx->Depth.Func, write,
+                                                      n, zbuffer, zfrag,
+                                                      mask, &passed);
 
    /* switch cases ordered from most frequent to less frequent */
    switch (ctx->Depth.Func) {
@@ -119,6 +123,9 @@ depth_test_span32( struct gl_context *ctx, GLuint n,
 {
    const GLboolean write = ctx->Depth.Mask;
    GLuint passed = 0;
+   const GLuint first = _swrast_sse_depth_test_span32(ctx->Depth.Func, write,
+                                                      n, zbuffer, zfrag,
+                                                      mask, &passed);
 
    /* switch cases ordered from most frequent to less frequent */
    switch (ctx->Depth.Func) {
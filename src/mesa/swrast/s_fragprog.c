@@ -215,6 +215,9 @@ run_program(struct gl_context *ctx, SWspan *span, GLuint start, GLuint end)
    struct gl_program_machine *machine = &swrast->FragProgMachine;
    GLuint i;
 
+   machine->Attribs = span->array->attribs;
+   _mesa_begin_program_batch(ctx, &program->Base, machine);
+
    for (i = start; i < end; i++) {
       if (span->array->mask[i]) {
          init_machine(ctx, machine, program, span, i);
@@ -259,6 +262,8 @@ run_program(struct gl_context *ctx, SWspan *span, GLuint start, GLuint end)
          }
       }
    }
+
+   _mesa_end_program_batch(machine);
 }
 
 
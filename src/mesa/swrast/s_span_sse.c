@@ -0,0 +1,645 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file s_span_sse.c
+ * SSE2 kernels for the ubyte blend functions of s_blend.c, the depth
+ * tests of s_depth.c and the GL_REPEAT bilinear sampling of RGBA8888
+ * textures of s_texfilter.c.
+ *
+ * The blend kernels do four fragments at a time, the depth kernels
+ * sixteen, and they leave the rest of the span to the C code.  They do
+ * the integer math of the C code, DIV255() included, and the texture
+ * sampling does the float math of lerp_rgba_2d() in the same order, so
+ * all the results are identical.
+ */
+
+
+#include <string.h>
+
+#include "main/glheader.h"
+#include "main/cpuinfo.h"
+#include "main/imports.h"
+#include "main/macros.h"
+
+#include "s_span_sse.h"
+
+
+#ifdef MESA_SSE_TARGETS
+
+#include <emmintrin.h>
+
+
+/**
+ * A 32-bit lane of ones for each of the four fragments of mask that is
+ * alive.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+load_mask4(const GLubyte mask[])
+{
+   const __m128i zero = _mm_setzero_si128();
+   int bits;
+   __m128i m;
+
+   memcpy(&bits, mask, sizeof(bits));
+   m = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero),
+                          zero);
+
+   return _mm_xor_si128(_mm_cmpeq_epi32(m, zero), _mm_set1_epi32(-1));
+}
+
+
+/** sel ? a : b */
+__attribute__((target("sse2")))
+static inline __m128i
+select_si128(__m128i sel, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(sel, a), _mm_andnot_si128(sel, b));
+}
+
+
+/** DIV255() of 16-bit values up to 255 * 255 */
+__attribute__((target("sse2")))
+static inline __m128i
+div255_epu16(__m128i x)
+{
+   /* ((x << 8) + x + 256) >> 16 is (x + (x >> 8) + 1) >> 8 */
+   return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)),
+                                       _mm_set1_epi16(1)), 8);
+}
+
+
+/** DIV255() of 32-bit values */
+__attribute__((target("sse2")))
+static inline __m128i
+div255_epi32(__m128i x)
+{
+   return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(x, 8), x),
+                                       _mm_set1_epi32(256)), 16);
+}
+
+
+/**
+ * DIV255((s - d) * t) + d of four 16-bit components, widened to 32 bits.
+ */
+__attribute__((target("sse2")))
+static inline void
+transparency4(__m128i s, __m128i d, __m128i t, __m128i *lo, __m128i *hi)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i diff = _mm_sub_epi16(s, d);
+   const __m128i plo = _mm_mullo_epi16(diff, t);
+   const __m128i phi = _mm_mulhi_epi16(diff, t);
+
+   *lo = _mm_add_epi32(div255_epi32(_mm_unpacklo_epi16(plo, phi)),
+                       _mm_unpacklo_epi16(d, zero));
+   *hi = _mm_add_epi32(div255_epi32(_mm_unpackhi_epi16(plo, phi)),
+                       _mm_unpackhi_epi16(d, zero));
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+transparency_ubyte(GLuint n, const GLubyte mask[], GLubyte rgba[][4],
+                   const GLubyte dest[][4])
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);
+      const __m128i s0 = _mm_unpacklo_epi8(s, zero);
+      const __m128i s1 = _mm_unpackhi_epi8(s, zero);
+      /* the alpha of each pixel in its four components */
+      const __m128i t0 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s0, 0xff),
+                                             0xff);
+      const __m128i t1 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s1, 0xff),
+                                             0xff);
+      __m128i r0, r1, r2, r3, r;
+
+      transparency4(s0, _mm_unpacklo_epi8(d, zero), t0, &r0, &r1);
+      transparency4(s1, _mm_unpackhi_epi8(d, zero), t1, &r2, &r3);
+
+      r = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+      _mm_storeu_si128((__m128i *) rgba[i], select_si128(load_mask4(mask + i),
+                                                         r, s));
+   }
+
+   return i;
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+modulate_ubyte(GLuint n, const GLubyte mask[], GLubyte rgba[][4],
+               const GLubyte dest[][4])
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);
+      const __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero),
+                                         _mm_unpacklo_epi8(d, zero));
+      const __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero),
+                                         _mm_unpackhi_epi8(d, zero));
+      const __m128i r = _mm_packus_epi16(div255_epu16(lo), div255_epu16(hi));
+
+      _mm_storeu_si128((__m128i *) rgba[i], select_si128(load_mask4(mask + i),
+                                                         r, s));
+   }
+
+   return i;
+}
+
+
+#define BLEND_FUNC(name, op)                                            \
+__attribute__((target("sse2")))                                         \
+static GLuint                                                           \
+name(GLuint n, const GLubyte mask[], GLubyte rgba[][4],                  \
+     const GLubyte dest[][4])                                           \
+{                                                                       \
+   GLuint i;                                                            \
+                                                                        \
+   for (i = 0; i + 4 <= n; i += 4) {                                    \
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);     \
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);     \
+                                                                        \
+      _mm_storeu_si128((__m128i *) rgba[i],                             \
+                       select_si128(load_mask4(mask + i), op(s, d), s)); \
+   }                                                                    \
+                                                                        \
+   return i;                                                            \
+}
+
+BLEND_FUNC(add_ubyte, _mm_adds_epu8)
+BLEND_FUNC(min_ubyte, _mm_min_epu8)
+BLEND_FUNC(max_ubyte, _mm_max_epu8)
+
+#undef BLEND_FUNC
+
+
+/**
+ * The lanes of zfrag passing the depth test against zbuf.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+depth_compare(GLenum func, __m128i zfrag, __m128i zbuf)
+{
+   /* there are only signed comparisons */
+   const __m128i bias = _mm_set1_epi32(0x80000000);
+   const __m128i ones = _mm_set1_epi32(-1);
+   const __m128i f = _mm_xor_si128(zfrag, bias);
+   const __m128i b = _mm_xor_si128(zbuf, bias);
+
+   switch (func) {
+   case GL_LESS:
+      return _mm_cmplt_epi32(f, b);
+   case GL_LEQUAL:
+      return _mm_xor_si128(_mm_cmpgt_epi32(f, b), ones);
+   case GL_GEQUAL:
+      return _mm_xor_si128(_mm_cmplt_epi32(f, b), ones);
+   case GL_GREATER:
+      return _mm_cmpgt_epi32(f, b);
+   case GL_NOTEQUAL:
+      return _mm_xor_si128(_mm_cmpeq_epi32(f, b), ones);
+   default:
+      ASSERT(func == GL_EQUAL);
+      return _mm_cmpeq_epi32(f, b);
+   }
+}
+/**
+ * Widen the 0x00/0xff bytes of sel to the 32-bit lanes of the four
+ * fragments starting at fragment 4 * k.
+ */
+__attribute__((target("sse2")))
+static inline __m128i
+widen_mask_epi8(__m128i sel, int k)
+{
+   switch (k) {
+   case 0:
+      sel = _mm_unpacklo_epi8(sel, sel);
+      return _mm_unpacklo_epi16(sel, sel);
+   case 1:
+      sel = _mm_unpacklo_epi8(sel, sel);
+      return _mm_unpackhi_epi16(sel, sel);
+   case 2:
+      sel = _mm_unpackhi_epi8(sel, sel);
+      return _mm_unpacklo_epi16(sel, sel);
+   default:
+      sel = _mm_unpackhi_epi8(sel, sel);
+      return _mm_unpackhi_epi16(sel, sel);
+   }
+}
+
+
+/**
+ * Kill the failing fragments of 16 mask bytes, given the 32-bit compare
+ * results of the four groups of four, and count the passing ones.
+ */
+__attribute__((target("sse2")))
+static inline GLuint
+update_mask16(GLubyte mask[], __m128i p0, __m128i p1, __m128i p2,
+              __m128i p3)
+{
+   const __m128i pass = _mm_packs_epi16(_mm_packs_epi32(p0, p1),
+                                        _mm_packs_epi32(p2, p3));
+   const __m128i m = _mm_and_si128(_mm_loadu_si128((const __m128i *) mask),
+                                   pass);
+   GLuint bits;
+
+   _mm_storeu_si128((__m128i *) mask, m);
+
+   /* count the bytes that are still non-zero */
+   bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(m, _mm_setzero_si128())) &
+          0xffff;
+   bits = bits - ((bits >> 1) & 0x5555);
+   bits = (bits & 0x3333) + ((bits >> 2) & 0x3333);
+   bits = (bits + (bits >> 4)) & 0x0f0f;
+   return (bits + (bits >> 8)) & 0x1f;
+}
+
+
+static GLboolean
+depth_func_supported(GLenum func)
+{
+   switch (func) {
+   case GL_LESS:
+   case GL_LEQUAL:
+   case GL_GEQUAL:
+   case GL_GREATER:
+   case GL_NOTEQUAL:
+   case GL_EQUAL:
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * The span loops are inlined into a switch on func, so that each
+ * comparison function gets its own loop.
+ */
+__attribute__((target("sse2"), always_inline))
+static inline GLuint
+depth_test_span16_func(GLenum func, GLboolean write, GLuint n,
+                       GLushort zbuffer[], const GLuint zfrag[],
+                       GLubyte mask[], GLuint *passed)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i, count = 0;
+
+   for (i = 0; i + 16 <= n; i += 16) {
+      const __m128i alive =
+         _mm_xor_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)
+                                                      (mask + i)), zero),
+                       _mm_set1_epi32(-1));
+      __m128i pass[4];
+      int k;
+
+      for (k = 0; k < 4; k++) {
+         const __m128i zf =
+            _mm_loadu_si128((const __m128i *) (zfrag + i + 4 * k));
+         const __m128i zb =
+            _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)
+                                               (zbuffer + i + 4 * k)), zero);
+
+         pass[k] = depth_compare(func, zf, zb);
+
+         if (write) {
+            /* keep the low 16 bits, like the C assignment */
+            __m128i z = select_si128(_mm_and_si128(pass[k],
+                                                   widen_mask_epi8(alive, k)),
+                                     zf, zb);
+            z = _mm_srai_epi32(_mm_slli_epi32(z, 16), 16);
+            _mm_storel_epi64((__m128i *) (zbuffer + i + 4 * k),
+                             _mm_packs_epi32(z, z));
+         }
+      }
+
+      count += update_mask16(mask + i, pass[0], pass[1], pass[2], pass[3]);
+   }
+
+   *passed += count;
+   return i;
+}
+
+
+__attribute__((target("sse2"), always_inline))
+static inline GLuint
+depth_test_span32_func(GLenum func, GLboolean write, GLuint n,
+                       GLuint zbuffer[], const GLuint zfrag[],
+                       GLubyte mask[], GLuint *passed)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i, count = 0;
+
+   for (i = 0; i + 16 <= n; i += 16) {
+      const __m128i alive =
+         _mm_xor_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)
+                                                      (mask + i)), zero),
+                       _mm_set1_epi32(-1));
+      __m128i pass[4];
+      int k;
+
+      for (k = 0; k < 4; k++) {
+         const __m128i zf =
+            _mm_loadu_si128((const __m128i *) (zfrag + i + 4 * k));
+         const __m128i zb =
+            _mm_loadu_si128((const __m128i *) (zbuffer + i + 4 * k));
+
+         pass[k] = depth_compare(func, zf, zb);
+
+         if (write)
+            _mm_storeu_si128((__m128i *) (zbuffer + i + 4 * k),
+                             select_si128(_mm_and_si128(pass[k],
+                                             widen_mask_epi8(alive, k)),
+                                          zf, zb));
+      }
+
+      count += update_mask16(mask + i, pass[0], pass[1], pass[2], pass[3]);
+   }
+
+   *passed += count;
+   return i;
+}
+
+
+#define DEPTH_SPAN_SWITCH(name, type)                                     \
+__attribute__((target("sse2")))                                           \
+static GLuint                                                             \
+name(GLenum func, GLboolean write, GLuint n, type zbuffer[],              \
+     const GLuint zfrag[], GLubyte mask[], GLuint *passed)                \
+{                                                                         \
+   switch (func) {                                                        \
+   case GL_LESS:                                                          \
+      return name##_func(GL_LESS, write, n, zbuffer, zfrag, mask, passed);  \
+   case GL_LEQUAL:                                                        \
+      return name##_func(GL_LEQUAL, write, n, zbuffer, zfrag, mask, passed);\
+   case GL_GEQUAL:                                                        \
+      return name##_func(GL_GEQUAL, write, n, zbuffer, zfrag, mask, passed);\
+   case GL_GREATER:                                                       \
+      return name##_func(GL_GREATER, write, n, zbuffer, zfrag, mask, passed);\
+   case GL_NOTEQUAL:                                                      \
+      return name##_func(GL_NOTEQUAL, write, n, zbuffer, zfrag, mask,     \
+                         passed);                                         \
+   default:                                                               \
+      return name##_func(GL_EQUAL, write, n, zbuffer, zfrag, mask, passed); \
+   }                                                                      \
+}
+
+DEPTH_SPAN_SWITCH(depth_test_span16, GLushort)
+DEPTH_SPAN_SWITCH(depth_test_span32, GLuint)
+
+#undef DEPTH_SPAN_SWITCH
+
+
+/**
+ * A MESA_FORMAT_RGBA8888 texel, as UBYTE_TO_FLOAT() RGBA floats.
+ */
+__attribute__((target("sse2")))
+static inline __m128
+fetch_rgba8888(const GLubyte *texels, GLint rowStride, GLint i, GLint j)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const GLuint *texel = (const GLuint *) (texels + rowStride * j) + i;
+   __m128i t = _mm_cvtsi32_si128(*texel);
+
+   /* the bytes are A, B, G, R in memory */
+   t = _mm_unpacklo_epi16(_mm_unpacklo_epi8(t, zero), zero);
+   t = _mm_shuffle_epi32(t, _MM_SHUFFLE(0, 1, 2, 3));
+
+   return _mm_div_ps(_mm_cvtepi32_ps(t), _mm_set1_ps(255.0F));
+}
+
+
+/** LERP(t, a, b) */
+__attribute__((target("sse2")))
+static inline __m128
+lerp_ps(__m128 t, __m128 a, __m128 b)
+{
+   return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+
+__attribute__((target("sse2")))
+static GLuint
+sample_2d_linear_rgba8888(const GLubyte *texels, GLint rowStride,
+                          GLuint width, GLuint height, GLuint n,
+                          const GLfloat texcoords[][4], GLfloat rgba[][4])
+{
+   GLuint k;
+
+   for (k = 0; k < n; k++) {
+      /* as linear_repeat_texel_location() */
+      const GLfloat u = texcoords[k][0] * width - 0.5F;
+      const GLfloat v = texcoords[k][1] * height - 0.5F;
+      const GLint i0 = IFLOOR(u) & (width - 1);
+      const GLint i1 = (i0 + 1) & (width - 1);
+      const GLint j0 = IFLOOR(v) & (height - 1);
+      const GLint j1 = (j0 + 1) & (height - 1);
+      const __m128 a = _mm_set1_ps(u - IFLOOR(u));
+      const __m128 b = _mm_set1_ps(v - IFLOOR(v));
+      const __m128 t00 = fetch_rgba8888(texels, rowStride, i0, j0);
+      const __m128 t10 = fetch_rgba8888(texels, rowStride, i1, j0);
+      const __m128 t01 = fetch_rgba8888(texels, rowStride, i0, j1);
+      const __m128 t11 = fetch_rgba8888(texels, rowStride, i1, j1);
+
+      _mm_storeu_ps(rgba[k], lerp_ps(b, lerp_ps(a, t00, t10),
+                                     lerp_ps(a, t01, t11)));
+   }
+
+   return n;
+}
+
+#endif /* MESA_SSE_TARGETS */
+
+
+/**
+ * glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) of
+ * blend_transparency_ubyte().
+ */
+GLuint
+_swrast_sse_blend_transparency_ubyte(GLuint n, const GLubyte mask[],
+                                     GLubyte rgba[][4],
+                                     const GLubyte dest[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return transparency_ubyte(n, mask, rgba, dest);
+#endif
+   (void) n;
+   (void) mask;
+   (void) rgba;
+   (void) dest;
+   return 0;
+}
+
+
+/** glBlendFunc(GL_ONE, GL_ONE) of blend_add() */
+GLuint
+_swrast_sse_blend_add_ubyte(GLuint n, const GLubyte mask[],
+                            GLubyte rgba[][4], const GLubyte dest[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return add_ubyte(n, mask, rgba, dest);
+#endif
+   (void) n;
+   (void) mask;
+   (void) rgba;
+   (void) dest;
+   return 0;
+}
+
+
+/** GL_MIN of blend_min() */
+GLuint
+_swrast_sse_blend_min_ubyte(GLuint n, const GLubyte mask[],
+                            GLubyte rgba[][4], const GLubyte dest[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return min_ubyte(n, mask, rgba, dest);
+#endif
+   (void) n;
+   (void) mask;
+   (void) rgba;
+   (void) dest;
+   return 0;
+}
+
+
+/** GL_MAX of blend_max() */
+GLuint
+_swrast_sse_blend_max_ubyte(GLuint n, const GLubyte mask[],
+                            GLubyte rgba[][4], const GLubyte dest[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return max_ubyte(n, mask, rgba, dest);
+#endif
+   (void) n;
+   (void) mask;
+   (void) rgba;
+   (void) dest;
+   return 0;
+}
+
+
+/** src * dest of blend_modulate() */
+GLuint
+_swrast_sse_blend_modulate_ubyte(GLuint n, const GLubyte mask[],
+                                 GLubyte rgba[][4], const GLubyte dest[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return modulate_ubyte(n, mask, rgba, dest);
+#endif
+   (void) n;
+   (void) mask;
+   (void) rgba;
+   (void) dest;
+   return 0;
+}
+
+
+/**
+ * Depth test of depth_test_span16(), for the comparison functions.
+ * \param passed  incremented by the number of fragments that passed
+ */
+GLuint
+_swrast_sse_depth_test_span16(GLenum func, GLboolean write, GLuint n,
+                              GLushort zbuffer[], const GLuint zfrag[],
+                              GLubyte mask[], GLuint *passed)
+{
+#ifdef MESA_SSE_TARGETS
+   if ((_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2) &&
+       depth_func_supported(func))
+      return depth_test_span16(func, write, n, zbuffer, zfrag, mask, passed);
+#endif
+   (void) func;
+   (void) write;
+   (void) n;
+   (void) zbuffer;
+   (void) zfrag;
+   (void) mask;
+   (void) passed;
+   return 0;
+}
+
+
+/**
+ * Depth test of depth_test_span32(), used for 24 and 32-bit Z.
+ * \param passed  incremented by the number of fragments that passed
+ */
+GLuint
+_swrast_sse_depth_test_span32(GLenum func, GLboolean write, GLuint n,
+                              GLuint zbuffer[], const GLuint zfrag[],
+                              GLubyte mask[], GLuint *passed)
+{
+#ifdef MESA_SSE_TARGETS
+   if ((_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2) &&
+       depth_func_supported(func))
+      return depth_test_span32(func, write, n, zbuffer, zfrag, mask, passed);
+#endif
+   (void) func;
+   (void) write;
+   (void) n;
+   (void) zbuffer;
+   (void) zfrag;
+   (void) mask;
+   (void) passed;
+   return 0;
+}
+
+
+/**
+ * sample_2d_linear_repeat() of a MESA_FORMAT_RGBA8888 image without
+ * border, of power of two width and height.
+ */
+GLuint
+_swrast_sse_sample_2d_linear_rgba8888(const GLubyte *texels,
+                                      GLint rowStride,
+                                      GLuint width, GLuint height, GLuint n,
+                                      const GLfloat texcoords[][4],
+                                      GLfloat rgba[][4])
+{
+#ifdef MESA_SSE_TARGETS
+   if (_mesa_get_sse_caps() & MESA_SSE_CAP_SSE2)
+      return sample_2d_linear_rgba8888(texels, rowStride, width, height, n,
+                                       texcoords, rgba);
+#endif
+   (void) texels;
+   (void) rowStride;
+   (void) width;
+   (void) height;
+   (void) n;
+   (void) texcoords;
+   (void) rgba;
+   return 0;
+}
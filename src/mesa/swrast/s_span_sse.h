@@ -0,0 +1,88 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file s_span_sse.h
+ * SSE2 versions of the span loops of blending, depth testing and
+ * bilinear texture sampling.
+ *
+ * Each function does as much of a span as it can, if the CPU has SSE2,
+ * and returns the number of fragments done.  The caller does the rest
+ * with the C code, which gives the same results.
+ */
+
+
+#ifndef S_SPAN_SSE_H
+#define S_SPAN_SSE_H
+
+
+#include "main/glheader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+extern GLuint
+_swrast_sse_blend_transparency_ubyte(GLuint n, const GLubyte mask[],
+                                     GLubyte rgba[][4],
+                                     const GLubyte dest[][4]);
+
+extern GLuint
+_swrast_sse_blend_add_ubyte(GLuint n, const GLubyte mask[],
+                            GLubyte rgba[][4], const GLubyte dest[][4]);
+
+extern GLuint
+_swrast_sse_blend_min_ubyte(GLuint n, const GLubyte mask[],
+                            GLubyte rgba[][4], const GLubyte dest[][4]);
+
+extern GLuint
+_swrast_sse_blend_max_ubyte(GLuint n, const GLubyte mask[],
+                            GLubyte rgba[][4], const GLubyte dest[][4]);
+
+extern GLuint
+_swrast_sse_blend_modulate_ubyte(GLuint n, const GLubyte mask[],
+                                 GLubyte rgba[][4], const GLubyte dest[][4]);
+
+extern GLuint
+_swrast_sse_depth_test_span16(GLenum func, GLboolean write, GLuint n,
+                              GLushort zbuffer[], const GLuint zfrag[],
+                              GLubyte mask[], GLuint *passed);
+
+extern GLuint
+_swrast_sse_depth_test_span32(GLenum func, GLboolean write, GLuint n,
+                              GLuint zbuffer[], const GLuint zfrag[],
+                              GLubyte mask[], GLuint *passed);
+
+extern GLuint
+_swrast_sse_sample_2d_linear_rgba8888(const GLubyte *texels,
+                                      GLint rowStride,
+                                      GLuint width, GLuint height, GLuint n,
+                                      const GLfloat texcoords[][4],
+                                      GLfloat rgba[][4]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* S_SPAN_SSE_H */
@@ -31,6 +31,7 @@
 #include "main/samplerobj.h"
 
 #include "s_context.h"
+#include "s_span_sse.h"
 #include "s_texfilter.h"
 
 
@@ -1388,7 +1389,15 @@ sample_linear_2d(struct gl_context *ctx,
        samp->WrapT == GL_REPEAT &&
        swImg->_IsPowerOfTwo &&
        image->Border == 0) {
-      for (i = 0; i < n; i++) {
+      i = 0;
+      if (image->TexFormat == MESA_FORMAT_RGBA8888) {
+         i = _swrast_sse_sample_2d_linear_rgba8888(swImg->ImageSlices[0],
+                                                   swImg->RowStride,
+                                                   image->Width2,
+                                                   image->Height2,
+                                                   n, texcoords, rgba);
+      }
+      for (; i < n; i++) {
          sample_2d_linear_repeat(ctx, samp, image, texcoords[i], rgba[i]);
       }
    }
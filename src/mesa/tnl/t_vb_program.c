@@ -330,6 +330,8 @@ run_vp( struct gl_context *ctx, struct tnl_pipeline_stage *stage )
 
    map_textures(ctx, program);
 
+   _mesa_begin_program_batch(ctx, &program->Base, machine);
+
    for (i = 0; i < VB->Count; i++) {
       GLuint attr;
 
@@ -403,6 +405,8 @@ run_vp( struct gl_context *ctx, struct tnl_pipeline_stage *stage )
 #endif
    }
 
+   _mesa_end_program_batch(machine);
+
    unmap_textures(ctx, program);
 
    if (program->IsPositionInvariant) {
@@ -509,6 +513,8 @@ dtr(struct tnl_pipeline_stage *stage)
       _mesa_vector4f_free( &store->ndcCoords );
       _mesa_align_free( store->clipmask );
 
+      _mesa_free_program_machine(&store->machine);
+
       free( store );
       stage->privatePtr = NULL;
    }
@@ -70,6 +70,19 @@ struct vbo_exec_eval2_map {
 
 
 
+/** Number of vertex layouts remembered across flushes */
+#define VBO_MAX_VERTEX_FORMATS 4
+
+/**
+ * The attribute sizes of a vertex layout used before a flush reset it,
+ * so that the next vertices with the same attributes don't have to
+ * rebuild it one wrapping attribute at a time.
+ */
+struct vbo_exec_vertex_format {
+   GLubyte attrsz[VBO_ATTRIB_MAX];
+};
+
+
 struct vbo_exec_copied_vtx {
    GLfloat buffer[VBO_ATTRIB_MAX * 4 * VBO_MAX_COPIED_VERTS];
    GLuint nr;
@@ -105,6 +118,11 @@ struct vbo_exec_context
       GLubyte active_sz[VBO_ATTRIB_MAX];
 
       GLfloat *attrptr[VBO_ATTRIB_MAX]; 
+
+      /* Recently reset layouts, most recent first */
+      struct vbo_exec_vertex_format formats[VBO_MAX_VERTEX_FORMATS];
+      GLuint num_formats;
+
       struct gl_client_array arrays[VERT_ATTRIB_MAX];
 
       /* According to program mode, the values above plus current
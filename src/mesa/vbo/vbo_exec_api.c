@@ -226,6 +226,106 @@ vbo_exec_copy_from_current(struct vbo_exec_context *exec)
 }
 
 
+/**
+ * Remember the current vertex layout before reset_attrfv() clears it.
+ */
+static void
+vbo_exec_save_vertex_format(struct vbo_exec_context *exec)
+{
+   struct vbo_exec_vertex_format *formats = exec->vtx.formats;
+   struct vbo_exec_vertex_format format;
+   GLuint i;
+
+   /* Flushing may have rerouted the position to generic attribute 0,
+    * see vbo_exec_bind_arrays().
+    */
+   if (!exec->vtx.vertex_size || !exec->vtx.attrsz[VBO_ATTRIB_POS])
+      return;
+
+   /* Materials given per vertex are rare and make the draw slower. */
+   memcpy(format.attrsz, exec->vtx.attrsz, sizeof(format.attrsz));
+   memset(format.attrsz + VBO_ATTRIB_MAT_FRONT_AMBIENT, 0,
+          VBO_ATTRIB_MAT_BACK_INDEXES - VBO_ATTRIB_MAT_FRONT_AMBIENT + 1);
+
+   for (i = 0; i < exec->vtx.num_formats; i++) {
+      if (memcmp(formats[i].attrsz, format.attrsz,
+                 sizeof(format.attrsz)) == 0)
+         break;
+   }
+
+   if (i == exec->vtx.num_formats) {
+      if (exec->vtx.num_formats < VBO_MAX_VERTEX_FORMATS)
+         exec->vtx.num_formats++;
+      i = exec->vtx.num_formats - 1;
+   }
+
+   memmove(formats + 1, formats, i * sizeof(formats[0]));
+   formats[0] = format;
+}
+
+
+/**
+ * Start an empty vertex layout with one of the recently used layouts
+ * which has \p attr with at least \p newSize components.  Applications
+ * alternating between a few vertex formats then grow the layout once
+ * per flush instead of once per attribute, and don't wrap in the middle
+ * of their first primitive.  The extra attributes hold the current
+ * values, which the vertices would otherwise get from ctx->Current.
+ */
+static GLboolean
+vbo_exec_use_recent_format(struct vbo_exec_context *exec,
+                           GLuint attr, GLuint newSize)
+{
+   struct vbo_context *vbo = vbo_context(exec->ctx);
+   const struct vbo_exec_vertex_format *format = NULL;
+   GLfloat *tmp = exec->vtx.vertex;
+   GLuint i;
+
+   assert(exec->vtx.vertex_size == 0);
+
+   for (i = 0; i < exec->vtx.num_formats; i++) {
+      if (exec->vtx.formats[i].attrsz[attr] >= newSize) {
+         format = &exec->vtx.formats[i];
+         break;
+      }
+   }
+
+   if (!format)
+      return GL_FALSE;
+
+   for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+      exec->vtx.attrsz[i] = format->attrsz[i];
+      exec->vtx.active_sz[i] = format->attrsz[i];
+      if (format->attrsz[i]) {
+         exec->vtx.attrtype[i] = vbo->currval[i].Type;
+         exec->vtx.attrptr[i] = tmp;
+         tmp += format->attrsz[i];
+      }
+      else
+         exec->vtx.attrptr[i] = NULL; /* will not be dereferenced */
+   }
+
+   exec->vtx.vertex_size = tmp - exec->vtx.vertex;
+   vbo_exec_copy_from_current(exec);
+
+   /* The caller only stores newSize components. */
+   if (newSize < exec->vtx.attrsz[attr]) {
+      const GLfloat *id =
+            vbo_get_default_vals_as_float(exec->vtx.attrtype[attr]);
+
+      for (i = newSize; i < exec->vtx.attrsz[attr]; i++)
+         exec->vtx.attrptr[attr][i] = id[i];
+   }
+
+   exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) /
+                         (exec->vtx.vertex_size * sizeof(GLfloat)));
+   exec->vtx.vert_count = 0;
+   exec->vtx.buffer_ptr = exec->vtx.buffer_map;
+
+   return GL_TRUE;
+}
+
+
 /**
  * Flush existing data, set new attrib size, replay copied vertices.
  * This is called when we transition from a small vertex attribute size
@@ -274,6 +374,10 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
       vbo_exec_copy_to_current( exec );
       reset_attrfv( exec );
    }
+   else if (exec->vtx.vertex_size == 0 &&
+            vbo_exec_use_recent_format(exec, attr, newSize)) {
+      return;
+   }
 
    /* Fix up sizes:
     */
@@ -1178,6 +1282,8 @@ static void reset_attrfv( struct vbo_exec_context *exec )
 {   
    GLuint i;
 
+   vbo_exec_save_vertex_format( exec );
+
    for (i = 0 ; i < VBO_ATTRIB_MAX ; i++) {
       exec->vtx.attrsz[i] = 0;
       exec->vtx.attrtype[i] = GL_FLOAT;
@@ -78,6 +78,67 @@ vbo_check_buffers_are_unmapped(struct gl_context *ctx)
 
 
 
+/**
+ * Find the bounds of a range of indices of a buffer object in its
+ * cache, which _mesa_bufferobj_invalidate_minmax() empties whenever the
+ * contents change.
+ */
+static GLboolean
+vbo_minmax_cache_lookup(struct gl_buffer_object *obj, GLintptr offset,
+                        GLuint count, GLenum type, GLboolean restart,
+                        GLuint restartIndex,
+                        GLuint *min_index, GLuint *max_index)
+{
+   GLboolean found = GL_FALSE;
+   GLuint i;
+
+   _glthread_LOCK_MUTEX(obj->Mutex);
+   for (i = 0; i < obj->NumMinMaxCache; i++) {
+      const struct gl_minmax_cache_entry *entry = &obj->MinMaxCache[i];
+
+      if (entry->Offset == offset && entry->Count == count &&
+          entry->Type == type && entry->Restart == restart &&
+          (!restart || entry->RestartIndex == restartIndex)) {
+         *min_index = entry->Min;
+         *max_index = entry->Max;
+         found = GL_TRUE;
+         break;
+      }
+   }
+   _glthread_UNLOCK_MUTEX(obj->Mutex);
+
+   return found;
+}
+
+
+static void
+vbo_minmax_cache_store(struct gl_buffer_object *obj, GLintptr offset,
+                       GLuint count, GLenum type, GLboolean restart,
+                       GLuint restartIndex,
+                       GLuint min_index, GLuint max_index)
+{
+   struct gl_minmax_cache_entry *entry;
+
+   _glthread_LOCK_MUTEX(obj->Mutex);
+   if (obj->NumMinMaxCache < MAX_MINMAX_CACHE) {
+      entry = &obj->MinMaxCache[obj->NumMinMaxCache++];
+   }
+   else {
+      entry = &obj->MinMaxCache[obj->NextMinMaxCache];
+      obj->NextMinMaxCache = (obj->NextMinMaxCache + 1) % MAX_MINMAX_CACHE;
+   }
+
+   entry->Offset = offset;
+   entry->Count = count;
+   entry->Type = type;
+   entry->Restart = restart;
+   entry->RestartIndex = restartIndex;
+   entry->Min = min_index;
+   entry->Max = max_index;
+   _glthread_UNLOCK_MUTEX(obj->Mutex);
+}
+
+
 /**
  * Compute min and max elements by scanning the index buffer for
  * glDraw[Range]Elements() calls.
@@ -100,6 +161,12 @@ vbo_get_minmax_index(struct gl_context *ctx,
    indices = (char *) ib->ptr + prim->start * index_size;
    if (_mesa_is_bufferobj(ib->obj)) {
       GLsizeiptr size = MIN2(count * index_size, ib->obj->Size);
+
+      if (vbo_minmax_cache_lookup(ib->obj, (GLintptr) indices, count,
+                                  ib->type, restart, restartIndex,
+                                  min_index, max_index))
+         return;
+
       indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
                                            GL_MAP_READ_BIT, ib->obj);
    }
@@ -178,6 +245,10 @@ vbo_get_minmax_index(struct gl_context *ctx,
 
    if (_mesa_is_bufferobj(ib->obj)) {
       ctx->Driver.UnmapBuffer(ctx, ib->obj);
+      vbo_minmax_cache_store(ib->obj, (GLintptr) (ib->ptr) +
+                             prim->start * index_size, count,
+                             ib->type, restart, restartIndex,
+                             *min_index, *max_index);
    }
 }
 
@@ -83,6 +83,15 @@ struct vbo_save_vertex_list {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+
+   /* Copy of the vertices without duplicates, followed by GLushort
+    * indices, drawn with indexed_prim instead of prim.  NULL if the
+    * list is drawn from the vertex store.
+    */
+   struct gl_buffer_object *indexed_bufferobj;
+   struct _mesa_prim *indexed_prim;
+   GLuint indexed_vertex_count;
+   GLuint index_offset;         /**< in bytes */
 };
 
 /* These buffers should be a reasonable size to support upload to
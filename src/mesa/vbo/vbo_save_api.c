@@ -336,6 +336,134 @@ merge_prims(struct gl_context *ctx,
    *prim_count = prev_prim - prim_list + 1;
 }
 
+/**
+ * Vertex lists with fewer vertices are always drawn from the vertex
+ * store, see _save_index_vertex_list().
+ */
+#define VBO_SAVE_INDEX_MIN_VERTS 32
+
+#define VBO_SAVE_NO_INDEX 0xffff
+
+
+static GLuint
+hash_vertex(const GLfloat *vertex, GLuint vertex_size)
+{
+   const GLuint *v = (const GLuint *) vertex;
+   GLuint hash = 2166136261u;
+   GLuint i;
+
+   for (i = 0; i < vertex_size; i++)
+      hash = (hash ^ v[i]) * 16777619u;
+
+   return hash;
+}
+
+
+/**
+ * Store a copy of the vertices of a node without duplicates, and the
+ * indices of the original vertex sequence into them, so that shared
+ * vertices are fetched and transformed only once per draw.  Vertices
+ * are numbered in the order of their first use, which keeps the
+ * fetches local.  The primitives themselves are not reordered, since
+ * that would change the rasterization order.
+ *
+ * Lists which don't save a quarter of their vertices keep the
+ * non-indexed draw.
+ */
+static void
+_save_index_vertex_list(struct gl_context *ctx,
+                        struct vbo_save_vertex_list *node,
+                        const GLfloat *vertices)
+{
+   const GLuint vertex_size = node->vertex_size;
+   const GLuint vertex_bytes = vertex_size * sizeof(GLfloat);
+   GLuint table_size = 1, mask, unique = 0, i;
+   struct gl_buffer_object *obj = NULL;
+   GLushort *table, *indices;
+   GLfloat *unique_vertices;
+
+   if (node->count < VBO_SAVE_INDEX_MIN_VERTS || !vertex_size ||
+       !node->prim_count)
+      return;
+
+   /* The vertex store holds fewer than VBO_SAVE_NO_INDEX vertices. */
+   assert(node->count < VBO_SAVE_NO_INDEX);
+
+   while (table_size < node->count * 2)
+      table_size <<= 1;
+   mask = table_size - 1;
+
+   table = malloc(table_size * sizeof(*table));
+   indices = malloc(node->count * sizeof(*indices));
+   unique_vertices = malloc(node->count * vertex_bytes);
+   if (!table || !indices || !unique_vertices)
+      goto out;
+
+   memset(table, 0xff, table_size * sizeof(*table));
+
+   for (i = 0; i < node->count; i++) {
+      const GLfloat *v = vertices + i * vertex_size;
+      GLuint h = hash_vertex(v, vertex_size) & mask;
+
+      while (table[h] != VBO_SAVE_NO_INDEX &&
+             memcmp(unique_vertices + table[h] * vertex_size, v,
+                    vertex_bytes) != 0)
+         h = (h + 1) & mask;
+
+      if (table[h] == VBO_SAVE_NO_INDEX) {
+         table[h] = unique;
+         memcpy(unique_vertices + unique * vertex_size, v, vertex_bytes);
+         unique++;
+      }
+
+      indices[i] = table[h];
+   }
+
+   if (unique * 4 > node->count * 3)
+      goto out;
+
+   node->indexed_prim = malloc(node->prim_count * sizeof(*node->prim));
+   if (!node->indexed_prim)
+      goto out;
+
+   obj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID, GL_ARRAY_BUFFER_ARB);
+   if (!obj ||
+       !ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
+                               unique * vertex_bytes +
+                               node->count * sizeof(*indices),
+                               NULL, GL_STATIC_DRAW_ARB, obj)) {
+      free(node->indexed_prim);
+      node->indexed_prim = NULL;
+      goto out;
+   }
+
+   ctx->Driver.BufferSubData(ctx, 0, unique * vertex_bytes,
+                             unique_vertices, obj);
+   ctx->Driver.BufferSubData(ctx, unique * vertex_bytes,
+                             node->count * sizeof(*indices), indices, obj);
+
+   /* The indices replace the vertex sequence, so the prims keep their
+    * start and count.
+    */
+   for (i = 0; i < node->prim_count; i++) {
+      node->indexed_prim[i] = node->prim[i];
+      node->indexed_prim[i].indexed = 1;
+   }
+
+   node->indexed_bufferobj = obj;
+   node->indexed_vertex_count = unique;
+   node->index_offset = unique * vertex_bytes;
+   obj = NULL;
+
+out:
+   if (obj)
+      _mesa_reference_buffer_object(ctx, &obj, NULL);
+   free(table);
+   free(indices);
+   free(unique_vertices);
+}
+
+
 /**
  * Insert the active immediate struct onto the display list currently
  * being built.
@@ -369,6 +497,10 @@ _save_compile_vertex_list(struct gl_context *ctx)
    node->prim_count = save->prim_count;
    node->vertex_store = save->vertex_store;
    node->prim_store = save->prim_store;
+   node->indexed_bufferobj = NULL;
+   node->indexed_prim = NULL;
+   node->indexed_vertex_count = 0;
+   node->index_offset = 0;
 
    node->vertex_store->refcount++;
    node->prim_store->refcount++;
@@ -416,6 +548,8 @@ _save_compile_vertex_list(struct gl_context *ctx)
 
    merge_prims(ctx, node->prim, &node->prim_count);
 
+   _save_index_vertex_list(ctx, node, save->buffer);
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1491,6 +1625,11 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 
    free(node->current_data);
    node->current_data = NULL;
+
+   if (node->indexed_bufferobj)
+      _mesa_reference_buffer_object(ctx, &node->indexed_bufferobj, NULL);
+   free(node->indexed_prim);
+   node->indexed_prim = NULL;
 }
 
 
@@ -1503,6 +1642,8 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data)
 
    printf("VBO-VERTEX-LIST, %u vertices %d primitives, %d vertsize\n",
           node->count, node->prim_count, node->vertex_size);
+   if (node->indexed_bufferobj)
+      printf("   indexed, %u unique vertices\n", node->indexed_vertex_count);
 
    for (i = 0; i < node->prim_count; i++) {
       struct _mesa_prim *prim = &node->prim[i];
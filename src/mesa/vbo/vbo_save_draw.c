@@ -133,7 +133,9 @@ static void vbo_bind_vertex_list(struct gl_context *ctx,
    struct vbo_context *vbo = vbo_context(ctx);
    struct vbo_save_context *save = &vbo->save;
    struct gl_client_array *arrays = save->arrays;
+   struct gl_buffer_object *bufferobj = node->vertex_store->bufferobj;
    GLuint buffer_offset = node->buffer_offset;
+   GLuint max_element = node->count;
    const GLuint *map;
    GLuint attr;
    GLubyte node_attrsz[VBO_ATTRIB_MAX];  /* copy of node->attrsz[] */
@@ -143,6 +145,12 @@ static void vbo_bind_vertex_list(struct gl_context *ctx,
    memcpy(node_attrsz, node->attrsz, sizeof(node->attrsz));
    memcpy(node_attrtype, node->attrtype, sizeof(node->attrtype));
 
+   if (node->indexed_bufferobj) {
+      bufferobj = node->indexed_bufferobj;
+      buffer_offset = 0;
+      max_element = node->indexed_vertex_count;
+   }
+
    /* Install the default (ie Current) attributes first, then overlay
     * all active ones.
     */
@@ -202,8 +210,8 @@ static void vbo_bind_vertex_list(struct gl_context *ctx,
          arrays[attr]._ElementSize = arrays[attr].Size * sizeof(GLfloat);
          _mesa_reference_buffer_object(ctx,
                                        &arrays[attr].BufferObj,
-                                       node->vertex_store->bufferobj);
-	 arrays[attr]._MaxElement = node->count; /* ??? */
+                                       bufferobj);
+	 arrays[attr]._MaxElement = max_element; /* ??? */
 	 
 	 assert(arrays[attr].BufferObj->Name);
 
@@ -305,7 +313,24 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (ctx->NewState)
 	 _mesa_update_state( ctx );
 
-      if (node->count > 0) {
+      if (node->indexed_bufferobj) {
+         struct _mesa_index_buffer ib;
+
+         ib.count = node->count;
+         ib.type = GL_UNSIGNED_SHORT;
+         ib.obj = node->indexed_bufferobj;
+         ib.ptr = (const GLubyte *) NULL + node->index_offset;
+
+         vbo_context(ctx)->draw_prims(ctx,
+                                      node->indexed_prim,
+                                      node->prim_count,
+                                      &ib,
+                                      GL_TRUE,
+                                      0,
+                                      node->indexed_vertex_count - 1,
+                                      NULL);
+      }
+      else if (node->count > 0) {
          vbo_context(ctx)->draw_prims(ctx, 
                                       node->prim,
                                       node->prim_count,